@@ -26,8 +26,14 @@
 #ifndef BATCH_MODE_H
 #define BATCH_MODE_H
 
+#include <stddef.h>
+
+#include "database/database.h"
 #include "testing/performance_metrics.h"
 
+/** @brief Path of the pack where ::batch_mode_run_packed writes all query outputs to. */
+#define BATCH_MODE_PACK_PATH "Resultados/outputs.pack"
+
 /**
  * @brief Starts batch mode.
  *
@@ -47,4 +53,122 @@ int batch_mode_run(const char            *dataset_dir,
                    const char            *query_file_path,
                    performance_metrics_t *metrics);
 
+/**
+ * @brief   Starts batch mode, writing the outputs of all queries to a single file.
+ * @details Instead of one file per query, outputs are appended to a
+ *          [pack](@ref query_output_pack.h) in ::BATCH_MODE_PACK_PATH, sequentially. That avoids
+ *          creating, opening and closing a file for each query, which dominates the running time
+ *          of very large query files. Duplicate queries don't have their outputs repeated in the
+ *          pack. Use `./programa-principal --extract` to convert the pack to one file per query.
+ *
+ * @param dataset_dir     Path to the directory containing the dataset.
+ * @param query_file_path Path to the file containing the queries
+ * @param metrics         Where to register program performance data to. Can be `NULL` for no
+ *                        profiling.
+ *
+ * @retval 0 Success
+ * @retval 1 Fatal failure (allocation / file IO errors). A message will also be printed to
+ *         `stderr`.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref batch_mode_examples).
+ */
+int batch_mode_run_packed(const char            *dataset_dir,
+                          const char            *query_file_path,
+                          performance_metrics_t *metrics);
+
+/**
+ * @brief   Starts batch mode, running queries in multiple worker processes.
+ * @details The dataset is loaded only once, before the worker processes are created. Because
+ *          queries never modify the database, its memory pages are shared (copy-on-write) between
+ *          all workers, instead of each worker needing its own copy of the database. Queries are
+ *          split between workers so that queries of the same type are kept together as much as
+ *          possible. Profiling isn't supported, as each worker would have its own metrics.
+ *
+ * @param dataset_dir     Path to the directory containing the dataset.
+ * @param query_file_path Path to the file containing the queries
+ * @param nworkers        Number of worker processes. `0` to run queries in the calling process.
+ *
+ * @retval 0 Success
+ * @retval 1 Fatal failure (allocation / file IO errors, or failure of a worker). A message will
+ *         also be printed to `stderr`.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref batch_mode_examples).
+ */
+int batch_mode_run_workers(const char *dataset_dir, const char *query_file_path, size_t nworkers);
+
+/**
+ * @brief   Starts batch mode, with the dataset split among processes that each hold a partition.
+ * @details Each partition of the dataset is loaded by a different process (see
+ *          ::database_set_partition), so that no process needs memory for the whole dataset. Users
+ *          are split among partitions by their identifiers, and their reservations and flights go
+ *          with them, while users and flights themselves are replicated. Queries about a user are
+ *          only run by its partition, and other queries that only need replicated data are spread
+ *          among all partitions. Queries that need data from every partition (e.g.: about hotels)
+ *          are run by all of them, and their outputs merged (see ::query_type_merge_callback_t).
+ *          The default number of threads is split among partitions. Profiling isn't supported, as
+ *          each partition would have its own metrics.
+ * @param dataset_dir     Path to the directory containing the dataset. Can't be
+ *                        ::DATASET_INPUT_MULTIPLEXED_PATH, as every partition reads the dataset.
+ * @param query_file_path Path to the file containing the queries
+ * @param npartitions     Number of partitions (and processes).
+ * @retval 0 Success
+ * @retval 1 Fatal failure (allocation / file IO errors, or failure of a partition). A message will
+ *         also be printed to `stderr`.
+ * #### Examples
+ * See [the header file's documentation](@ref batch_mode_examples).
+ */
+int batch_mode_run_partitioned(const char *dataset_dir,
+                               const char *query_file_path,
+                               size_t      npartitions);
+
+/**
+ * @brief   Starts batch mode, parsing and running the query file in windows of consecutive lines.
+ * @details Only @p window lines of the query file are kept in memory at once: after being parsed,
+ *          each window is grouped by query type, run, and freed before the next window is parsed.
+ *          This bounds the memory used for queries and their outputs in very large query files,
+ *          at the cost of query statistical data only being reused inside each window.
+ *
+ * @param dataset_dir     Path to the directory containing the dataset.
+ * @param query_file_path Path to the file containing the queries
+ * @param window          Maximum number of lines in each window. `0` for the whole file.
+ * @param metrics         Where to register program performance data to. Can be `NULL` for no
+ *                        profiling. Only the statistical data generated for the last window is
+ *                        measured.
+ *
+ * @retval 0 Success
+ * @retval 1 Fatal failure (allocation / file IO errors). A message will also be printed to
+ *         `stderr`.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref batch_mode_examples).
+ */
+int batch_mode_run_windowed(const char            *dataset_dir,
+                            const char            *query_file_path,
+                            size_t                 window,
+                            performance_metrics_t *metrics);
+
+/**
+ * @brief   Runs the queries in a query file on a dataset that was already loaded.
+ * @details Outputs are written to `Resultados` (created if needed), as in ::batch_mode_run, but the
+ *          result cache isn't used and error files aren't written. This lets many query files run
+ *          on the same database, such as in child processes sharing it through copy-on-write pages.
+ *
+ * @param database        Database to run queries on. Must be frozen (see ::database_freeze).
+ * @param query_file_path Path to the file containing the queries
+ * @param metrics         Where to register program performance data to. Can be `NULL` for no
+ *                        profiling.
+ *
+ * @retval 0 Success
+ * @retval 1 Fatal failure (allocation / file IO errors). A message will also be printed to
+ *         `stderr`.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref batch_mode_examples).
+ */
+int batch_mode_run_loaded(const database_t      *database,
+                          const char            *query_file_path,
+                          performance_metrics_t *metrics);
+
 #endif
@@ -33,7 +33,7 @@
  *         return 1;
  *     }
  *
- *     if (dataset_loader_load(database, "/path/to/dataset/directory", NULL, NULL)) {
+ *     if (dataset_loader_load(database, "/path/to/dataset/directory", NULL, NULL, NULL)) {
  *         fputs("Failed to open dataset to be parsed.\n", stderr);
  *         return 1;
  *     }
@@ -48,22 +48,54 @@
  * If you don't wish to use ::dataset_loader_load, you may add entities directly to the base using
  * methods such as:
  *
- *  - Users:       ::database_add_user;
- *  - Flights:     ::database_add_flight (remove a flight using ::database_invalidate_flight);
- *  - Reservation: ::database_add_reservation;
+ *  - Users:       ::database_add_user (or ::database_add_users);
+ *  - Flights:     ::database_add_flight (or ::database_add_flights; remove a flight using
+ *                 ::database_invalidate_flight);
+ *  - Reservation: ::database_add_reservation (or ::database_add_reservations);
  *  - Passengers:  ::database_add_passengers (passengers must be added all at once).
+ *
+ * After adding entities directly, call ::database_freeze before running any queries.
+ *
+ * Every entity added (or removed) is also counted in the day, month and year it happened in, in a
+ * [time cube](@ref time_cube.h) kept for as long as the database is (::database_get_time_cube).
+ * Statistics about all entities are collected in a [catalog](@ref database_catalog.h) when the
+ * database is frozen (::database_get_catalog).
  */
 
 #ifndef DATABASE_H
 #define DATABASE_H
 
+#include "database/database_catalog.h"
 #include "database/flight_manager.h"
+#include "database/index_manager.h"
 #include "database/reservation_manager.h"
+#include "database/time_cube.h"
 #include "database/user_manager.h"
 
 /** @brief A collection of managers of the different entities. */
 typedef struct database database_t;
 
+/**
+ * @brief   Flags for data in a ::database_t that only some query types need.
+ * @details See ::database_set_data.
+ */
+typedef enum {
+    /** @brief Lists of flights of each user (queries 1, 2 and 10). */
+    DATABASE_DATA_USER_FLIGHTS = 1 << 0,
+    /** @brief Lists of reservations of each user (queries 1 and 2). */
+    DATABASE_DATA_USER_RESERVATIONS = 1 << 1,
+    /** @brief Indexes of reservations by hotel, built in ::database_freeze (queries 4 and 8). */
+    DATABASE_DATA_HOTEL_INDEXES = 1 << 2,
+    /** @brief Indexes of flights, built in ::database_freeze (queries 5, 6 and 7). */
+    DATABASE_DATA_FLIGHT_INDEXES = 1 << 3,
+    /** @brief Bloom filters of entity identifiers, built in ::database_freeze (queries 1 and 2). */
+    DATABASE_DATA_ID_FILTERS = 1 << 4,
+    /** @brief Index of user names, built in ::database_freeze (query 9). */
+    DATABASE_DATA_USER_INDEXES = 1 << 5,
+    /** @brief All of the above (the default). */
+    DATABASE_DATA_ALL = (1 << 6) - 1,
+} database_data_t;
+
 /**
  * @brief   Instantiates a new ::database_t.
  * @details The returned value is owned by the caller and should be `free`d with ::database_free.
@@ -75,17 +107,83 @@ typedef struct database database_t;
 database_t *database_create(void);
 
 /**
- * @brief   Creates a deep copy of a database.
- * @details Databases usually contain lots of data, possibly even gigabytes! Keep that in mind for
- *          performance and memory usage reasons.
+ * @brief   Creates a copy of a database.
+ * @details The copy shares all managers with @p database, so this is cheap. A manager is only
+ *          copied by a database right before that database modifies it (e.g.: the flight manager in
+ *          ::database_invalidate_flight), so the other database is never affected. Until then,
+ *          both databases can be read from different threads at the same time.
  *
- * @param database Database to be cloned.
+ * @param database Database to be cloned. Must be frozen (see ::database_freeze), as reading from
+ *                 a database that isn't may modify it.
  *
  * @return A pointer to a new database, that must be `free`d with ::database_free. `NULL` is also
- *         possible on allocations.
+ *         possible on allocations, or if @p database isn't frozen.
  */
 database_t *database_clone(const database_t *database);
 
+/**
+ * @brief   Chooses which optional data is kept in a database.
+ * @details When the queries to be run are known before a dataset is loaded, data none of them
+ *          need can be skipped, making loading faster and using less memory. The lists of flights
+ *          and reservations of users missing from @p data aren't stored as entities are added
+ *          (the number of passengers of each flight still is). Indexes missing from @p data
+ *          aren't built by ::database_freeze, but are still built the first time they're needed,
+ *          so they are only an optimization.
+ *
+ *          Entities are still validated in the same way, so dataset errors don't depend on
+ *          @p data. However, databases that are missing any data other than
+ *          ::DATABASE_DATA_HOTEL_INDEXES and ::DATABASE_DATA_FLIGHT_INDEXES (that aren't stored,
+ *          or only stored when built) mustn't be stored in [snapshots](@ref dataset_snapshot.h).
+ *
+ * @param database Empty database (nothing can have been added to it yet).
+ * @param data     Bitwise OR of the ::database_data_t flags to be kept.
+ */
+void database_set_data(database_t *database, database_data_t data);
+
+/**
+ * @brief  Gets which optional data is kept in a database.
+ * @param  database Database to get the flags from.
+ * @return The flags set with ::database_set_data (::DATABASE_DATA_ALL by default).
+ */
+database_data_t database_get_data(const database_t *database);
+
+/**
+ * @brief   Makes a database only keep a partition of a dataset.
+ * @details Users are split among partitions by a hash of their identifiers (see
+ *          ::database_get_user_partition). Reservations, and the flights of each user, are only
+ *          associated with users (and, for reservations, kept at all) in the partition of their
+ *          user. Users and flights themselves (along with the number of passengers of each flight),
+ *          are replicated in every partition, as they're needed to validate the rest of the
+ *          dataset. Hotels and airports, only known from reservations and flights, are never split.
+ *
+ *          Partitioned databases aren't restored from nor stored in snapshots.
+ *
+ * @param database  Empty database (nothing can have been added to it yet).
+ * @param partition Partition to be kept, lower than @p count.
+ * @param count     Number of partitions the dataset is split into. `1` (the default) keeps the
+ *                  whole dataset.
+ */
+void database_set_partition(database_t *database, size_t partition, size_t count);
+
+/**
+ * @brief  Gets the number of partitions the dataset in a database is split into.
+ * @param  database Database to get the number of partitions from.
+ * @return The number set with ::database_set_partition (`1` by default).
+ */
+size_t database_get_partition_count(const database_t *database);
+
+/**
+ * @brief   Gets the partition a user belongs to.
+ * @details Doesn't depend on any database, so that queries can be routed to the partition of their
+ *          user before the dataset is loaded.
+ *
+ * @param user_id Identifier of the user.
+ * @param count   Number of partitions the dataset is split into.
+ *
+ * @return A partition lower than @p count.
+ */
+size_t database_get_user_partition(const char *user_id, size_t count);
+
 /**
  * @brief   Gets the user manager in a database.
  * @param   database Database to get the user manager from.
@@ -108,7 +206,248 @@ const reservation_manager_t *database_get_reservations(const database_t *databas
 const flight_manager_t *database_get_flights(const database_t *database);
 
 /**
- * @brief Adds a user to @p database.
+ * @brief   Gets all reservations in a hotel.
+ * @details See ::index_manager_get_hotel_reservations.
+ *
+ * @param database Database to get the reservations from.
+ * @param hotel_id Identifier of the hotel.
+ *
+ * @return An array of reservations (::reservation_t), sorted by begin date (from the newest one)
+ *         and then by identifier, or `NULL` if there are no reservations in that hotel. It's valid
+ *         until @p database is modified.
+ *
+ * #### Examples
+ * See [the index manager's documentation](@ref index_manager_examples).
+ */
+const GConstPtrArray *database_get_hotel_reservations(const database_t *database,
+                                                      hotel_id_t        hotel_id);
+
+/**
+ * @brief   Checks if the reservations of every hotel are already indexed.
+ * @details See ::index_manager_has_hotel_reservations.
+ *
+ * @param database Database to be checked.
+ *
+ * @retval 0 ::database_get_hotel_reservations will need to build its index first.
+ * @retval 1 ::database_get_hotel_reservations is a simple lookup.
+ */
+int database_has_hotel_reservations(const database_t *database);
+
+/**
+ * @brief   Gets the nights and prices of all reservations in a hotel.
+ * @details See ::index_manager_get_hotel_nights.
+ *
+ * @param database Database to get the reservations from.
+ * @param hotel_id Identifier of the hotel.
+ *
+ * @return The nights of the hotel's reservations, or `NULL` if there are no reservations in that
+ *         hotel. It's valid until @p database is modified.
+ */
+const index_manager_hotel_nights_t *database_get_hotel_nights(const database_t *database,
+                                                              hotel_id_t        hotel_id);
+
+/**
+ * @brief   Gets all flights departing from an airport.
+ * @details See ::index_manager_get_origin_flights.
+ *
+ * @param database Database to get the flights from.
+ * @param origin   Origin airport.
+ *
+ * @return An array of flights (::flight_t), sorted by scheduled departure date (from the newest
+ *         one) and then by identifier, or `NULL` if there are no flights departing from @p origin.
+ *         It's valid until @p database is modified.
+ */
+const GConstPtrArray *database_get_origin_flights(const database_t *database,
+                                                  airport_code_t    origin);
+
+/**
+ * @brief   Gets the scheduled departure dates of all flights departing from an airport.
+ * @details See ::index_manager_get_origin_departures.
+ *
+ * @param database Database to get the dates from.
+ * @param origin   Origin airport.
+ *
+ * @return A `GArray` of ::date_and_time_t, parallel to the array returned by
+ *         ::database_get_origin_flights, or `NULL` if there are no flights departing from
+ *         @p origin. It's valid until @p database is modified.
+ */
+const GArray *database_get_origin_departures(const database_t *database, airport_code_t origin);
+
+/**
+ * @brief   Iterates through the flights from every origin airport.
+ * @details See ::index_manager_iter_origin_flights.
+ *
+ * @param database  Database to get the flights from.
+ * @param callback  Method to be called for every origin airport.
+ * @param user_data Pointer to be passed to every @p callback, so that it can modify the program's
+ *                  state.
+ *
+ * @return The return value of the last-called @p callback (`0` means success, another value means
+ *         the iteration was stopped by a callback).
+ */
+int database_iter_origin_flights(const database_t                            *database,
+                                 index_manager_iter_origin_flights_callback_t callback,
+                                 void                                        *user_data);
+
+/**
+ * @brief   Gets the number of passengers of every airport in a year.
+ * @details See ::index_manager_get_year_airport_passengers.
+ *
+ * @param database Database to get the passenger counts from.
+ * @param year     Year of the scheduled departure of flights to be considered.
+ *
+ * @return A `GArray` of ::index_manager_airport_passengers_t, sorted by number of passengers
+ *         (from the largest one) and then by airport code, or `NULL` if there are no flights in
+ *         @p year. It's valid until @p database is modified.
+ */
+const GArray *database_get_year_airport_passengers(const database_t *database, uint16_t year);
+
+/**
+ * @brief   Gets the event counts of every day, month and year in a database.
+ * @details Users, flights, passengers and reservations are counted as they're added, and unique
+ *          passengers in ::database_freeze, only if passengers were added or flights removed since
+ *          they were last counted.
+ *
+ * @param database Database to get the time cube from.
+ *
+ * @return The time cube of @p database. It's valid until @p database is modified, and its unique
+ *         passengers are only up to date while @p database is frozen.
+ */
+const time_cube_t *database_get_time_cube(const database_t *database);
+
+/**
+ * @brief   Restores stored unique passenger counts in the time cube of a database, instead of
+ *          counting them in ::database_freeze.
+ * @details See ::time_cube_restore_unique_passengers. The counts are discarded as soon as
+ *          passengers are added or flights are removed.
+ *
+ * @param database Database whose time cube is modified.
+ * @param entries  Counts of the users and flights in @p database.
+ * @param n        Number of elements in @p entries.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or an instant in @p entries isn't counted by time cubes.
+ */
+int database_restore_unique_passengers(database_t                          *database,
+                                       const time_cube_unique_passengers_t *entries,
+                                       size_t                               n);
+
+/**
+ * @brief   Gets the statistics about the entities in a database.
+ * @details The catalog is computed in ::database_freeze, unless it was restored with
+ *          ::database_restore_catalog, and discarded as soon as entities are added or removed.
+ *
+ * @param database Database to get the catalog from.
+ *
+ * @return The catalog of @p database, valid until @p database is modified, or `NULL` if there's
+ *         none (@p database isn't frozen, or computing the catalog failed to allocate memory).
+ */
+const database_catalog_t *database_get_catalog(const database_t *database);
+
+/**
+ * @brief   Restores a stored catalog of a database, instead of computing it in ::database_freeze.
+ * @details The catalog is discarded as soon as entities are added or removed.
+ *
+ * @param database Database whose catalog is restored.
+ * @param catalog  Catalog of the entities in @p database (copied).
+ */
+void database_restore_catalog(database_t *database, const database_catalog_t *catalog);
+
+/**
+ * @brief   Gets the median departure delay of every origin airport.
+ * @details See ::index_manager_get_origin_delay_medians.
+ *
+ * @param database Database to get the medians from.
+ *
+ * @return A `GArray` of ::index_manager_airport_delay_t, sorted by median delay (from the largest
+ *         one) and then by airport code. It's valid until @p database is modified.
+ */
+const GArray *database_get_origin_delay_medians(const database_t *database);
+
+/**
+ * @brief   Gets the index of median departure delays of a database, without building it.
+ * @details See ::index_manager_get_built_origin_delay_medians. Used for storing the index in
+ *          snapshots.
+ *
+ * @param database Database to get the index from.
+ * @param medians  Where to write the `GArray` of ::index_manager_airport_delay_t to.
+ *
+ * @retval 0 Success.
+ * @retval 1 The index hasn't been built yet.
+ */
+int database_get_origin_delay_median_index(const database_t *database, const GArray **medians);
+
+/**
+ * @brief   Restores a stored index of median departure delays in a database, instead of building
+ *          it.
+ * @details See ::index_manager_restore_origin_delay_medians. The index is discarded as soon as
+ *          flights are modified.
+ *
+ * @param database Database where to restore the index.
+ * @param medians  `GArray` of ::index_manager_airport_delay_t, of the flights in @p database.
+ *                 Ownership is taken, even on failure.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int database_restore_origin_delay_median_index(database_t *database, GArray *medians);
+
+/**
+ * @brief   Gets all active users whose name starts with a prefix.
+ * @details See ::index_manager_get_users_by_name_prefix.
+ *
+ * @param database Database to get the users from.
+ * @param prefix   Byte-wise prefix of the names of the users to be found.
+ * @param matches  Where to write the address of the first match to. Matches are sorted by name
+ *                 byte by byte, and are valid until @p database is modified.
+ * @param n        Where to write the number of matches in @p matches to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int database_get_users_by_name_prefix(const database_t                 *database,
+                                      const char                       *prefix,
+                                      const index_manager_user_name_t **matches,
+                                      size_t                           *n);
+
+/**
+ * @brief   Gets the index of user names of a database, without building it.
+ * @details See ::index_manager_get_user_names. Used for storing the index in snapshots.
+ *
+ * @param database Database to get the index from.
+ * @param entries  Where to write the `GArray` of ::index_manager_user_name_t to.
+ * @param trie     Where to write the trie over the names in @p entries to.
+ *
+ * @retval 0 Success.
+ * @retval 1 The index hasn't been built yet.
+ */
+int database_get_user_name_index(const database_t     *database,
+                                 const GArray        **entries,
+                                 const prefix_trie_t **trie);
+
+/**
+ * @brief   Restores a stored index of user names in a database, instead of building it.
+ * @details See ::index_manager_restore_user_names. The index is discarded as soon as users are
+ *          modified.
+ *
+ * @param database  Database where to restore the index.
+ * @param entries   `GArray` of ::index_manager_user_name_t, whose users are in @p database.
+ *                  Ownership is taken, even on failure.
+ * @param trie_data Data of the trie over the names in @p entries.
+ * @param length    Number of bytes in @p trie_data.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or @p trie_data is invalid.
+ */
+int database_restore_user_name_index(database_t *database,
+                                     GArray     *entries,
+                                     const void *trie_data,
+                                     size_t      length);
+
+/**
+ * @brief   Adds a user to @p database.
+ * @details The user's index (see ::user_manager_get_index_by_id) is the number of users in
+ *          @p database before this call.
  *
  * @param database Database to add @p user to.
  * @param user     User to be added to @p database.
@@ -119,7 +458,25 @@ const flight_manager_t *database_get_flights(const database_t *database);
 int database_add_user(database_t *database, const user_t *user);
 
 /**
- * @brief Adds a reservation to @p database.
+ * @brief   Adds many users to @p database at once.
+ * @details Equivalent to calling ::database_add_user for each user, in order, but cheaper (see
+ *          ::user_manager_add_users). Meant for loaders that parse records in chunks.
+ *
+ * @param database Database to add @p users to.
+ * @param users    Users to be added to @p database.
+ * @param n        Number of users in @p users.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (some of @p users may have been added).
+ */
+int database_add_users(database_t *database, const user_t *const *users, size_t n);
+
+/**
+ * @brief   Adds a reservation to @p database.
+ * @details Can be called concurrently with ::database_add_passengers, as long as no other thread
+ *          is modifying @p database. The reservation's user index must refer to a user in
+ *          @p database. In a [partitioned](@ref database_set_partition) database, reservations of
+ *          users of other partitions are ignored.
  *
  * @param database    Database to add @p reservation to.
  * @param reservation Reservation to be added to @p database.
@@ -129,6 +486,48 @@ int database_add_user(database_t *database, const user_t *user);
  */
 int database_add_reservation(database_t *database, const reservation_t *reservation);
 
+/**
+ * @brief   Adds many reservations to @p database at once.
+ * @details Equivalent to calling ::database_add_reservation for each reservation, in order, but
+ *          cheaper (see ::reservation_manager_add_reservations). The same concurrency rules apply.
+ *
+ * @param database     Database to add @p reservations to.
+ * @param reservations Reservations to be added to @p database.
+ * @param n            Number of reservations in @p reservations.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (some of @p reservations may have been added).
+ */
+int database_add_reservations(database_t                 *database,
+                              const reservation_t *const *reservations,
+                              size_t                      n);
+
+/**
+ * @brief   Prepares @p database for a number of users to be added to it.
+ * @details See ::user_manager_reserve.
+ *
+ * @param database Database to be modified.
+ * @param count    Total number of users expected in @p database.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int database_reserve_users(database_t *database, size_t count);
+
+/**
+ * @brief   Prepares @p database for a number of reservations to be added to it.
+ * @details See ::reservation_manager_reserve and ::user_manager_reserve_reservation_associations.
+ *          Can be called concurrently with ::database_add_passengers and
+ *          ::database_reserve_passengers.
+ *
+ * @param database Database to be modified.
+ * @param count    Total number of reservations expected in @p database.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int database_reserve_reservations(database_t *database, size_t count);
+
 /**
  * @brief Adds a flight to @p database.
  *
@@ -140,36 +539,215 @@ int database_add_reservation(database_t *database, const reservation_t *reservat
  */
 int database_add_flight(database_t *database, const flight_t *flight);
 
+/**
+ * @brief   Adds many flights to @p database at once.
+ * @details Equivalent to calling ::database_add_flight for each flight, in order, but cheaper (see
+ *          ::flight_manager_add_flights).
+ *
+ * @param database Database to add @p flights to.
+ * @param flights  Flights to be added to @p database.
+ * @param n        Number of flights in @p flights.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (some of @p flights may have been added).
+ */
+int database_add_flights(database_t *database, const flight_t *const *flights, size_t n);
+
+/**
+ * @brief   Prepares @p database for a number of flights to be added to it.
+ * @details See ::flight_manager_reserve.
+ *
+ * @param database Database to be modified.
+ * @param count    Total number of flights expected in @p database.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int database_reserve_flights(database_t *database, size_t count);
+
+/**
+ * @brief   Prepares @p database for a number of passengers to be added to it.
+ * @details See ::user_manager_reserve_flight_associations. Can be called concurrently with
+ *          ::database_add_reservation and ::database_reserve_reservations.
+ *
+ * @param database Database to be modified.
+ * @param count    Total number of passengers expected in @p database.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int database_reserve_passengers(database_t *database, size_t count);
+
+/**
+ * @brief   Makes @p database keep strings of entities that are in a mapped file where they are,
+ *          instead of copying them.
+ * @details See ::user_manager_borrow_strings, ::flight_manager_borrow_strings and
+ *          ::reservation_manager_borrow_strings. Entities must be added from pool-allocated copies
+ *          (whose strings were also borrowed), as `malloc`-allocated entities own copies of their
+ *          strings.
+ *
+ * @param database Database to be modified.
+ * @param file     File where strings of entities added to @p database may be.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or @p database already borrows strings from a file.
+ */
+int database_borrow_strings(database_t *database, mapped_file_t *file);
+
 /**
  * @brief   Removes a flight from a database.
  * @details It's assumed that there are no users with passenger relations to @p flight. Otherwise,
- *          those will remain, and will point to flights that no longer exist.
+ *          those will remain, and will point to flights that no longer exist. The flight and its
+ *          passengers stop being counted in the database's time cube (see
+ *          ::database_get_time_cube).
  *
  * @param database Database to get a flight removed from.
  * @param id       Identifier of the flight to invalidate.
  *
  * @retval 0 Flight was in @p database and was invalidated.
- * @retval 1 Flight not in @p database to begin with.
+ * @retval 1 Flight not in @p database to begin with, or allocation failure.
  */
 int database_invalidate_flight(database_t *database, flight_id_t id);
 
 /**
  * @brief   Adds user-flight relations (passengers) to the user manager in a database.
- * @details All passengers of a flight must be added in bulk.
+ * @details All passengers of a flight must be added in bulk. Can be called concurrently with
+ *          ::database_add_reservation, as long as no other thread is modifying @p database. In a
+ *          [partitioned](@ref database_set_partition) database, all passengers are counted, but
+ *          only users of the database's partition are associated with the flight.
  *
- * @param database  Database to add passenger relations to.
- * @param flight_id Identifier of the flight to be associated with @p user_ids.
- * @param user_ids  Identifiers of the users to add @p flight_id to.
- * @param n         Number of users in @p user_ids.
+ * @param database     Database to add passenger relations to.
+ * @param flight_id    Identifier of the flight to be associated with @p user_indices.
+ * @param n            Number of users in @p user_indices.
+ * @param user_indices Indices of the users to add @p flight_id to (see
+ *                     ::user_manager_get_index_by_id).
  *
  * @retval 0 Success.
  * @retval 1 Allocation failure, user / flight not found, or too many passengers for number of
  *           flight seats.
  */
-int database_add_passengers(database_t       *database,
-                            flight_id_t       flight_id,
-                            size_t            n,
-                            const char *const user_ids[n]);
+int database_add_passengers(database_t    *database,
+                            flight_id_t    flight_id,
+                            size_t         n,
+                            const uint32_t user_indices[n]);
+
+/**
+ * @brief   Associates a user with a flight, without updating that flight's number of passengers.
+ * @details Meant for restoring databases whose flights already account for all their passengers
+ *          (e.g.: from a [dataset snapshot](@ref dataset_snapshot.h)). Otherwise, use
+ *          ::database_add_passengers.
+ *
+ * @param database   Database to add the user-flight relation to.
+ * @param user_index Index of the user to add @p flight_id to.
+ * @param flight_id  Identifier of the flight to be associated with @p user_index.
+ *
+ * @retval 0 Success.
+ * @retval 1 User not found or allocation failure.
+ */
+int database_add_user_flight_association(database_t *database,
+                                         uint32_t    user_index,
+                                         flight_id_t flight_id);
+
+/**
+ * @brief   Prepares a database for passengers and reservations to be added concurrently.
+ * @details Should be called once all users have been added. Shrinks the table of user
+ *          identifiers (see ::user_manager_shrink_id_table), and stages the associations between
+ *          users and other entities, so that they're added to users in parallel by
+ *          ::database_freeze (see ::user_manager_stage_associations).
+ *
+ * @param database Database to be modified.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int database_prepare_user_associations(database_t *database);
+
+/**
+ * @brief   Prepares a database for queries, once all entities have been added to it.
+ * @details Converts the flights and reservations of every user into contiguous arrays, sorted by
+ *          date, and computes per-user aggregates (see ::user_manager_freeze). Memory reserved for
+ *          entities that were never added is then released (see ::user_manager_compact,
+ *          ::reservation_manager_compact and ::flight_manager_compact), and the indexes of
+ *          reservations, flights and user names shared by many query types are built (see
+ *          ::index_manager_build_hotel_indexes, ::index_manager_build_flight_indexes and
+ *          ::index_manager_build_user_indexes), along with filters of entity identifiers, unless
+ *          they were left out with ::database_set_data, or memory is close to the
+ *          [memory budget](@ref memory_budget.h) (indexes are then built on demand, and filters
+ *          aren't built at all). Staged user associations (see
+ *          ::database_prepare_user_associations) are added to their users first. Unique passengers
+ *          are counted in the database's time cube if they're outdated (see
+ *          ::time_cube_count_unique_passengers), and the database's catalog is computed if there
+ *          isn't one (see ::database_get_catalog).
+ *
+ *          The database is then frozen (see ::database_is_frozen) until entities are added to it,
+ *          which is allowed, but slow, and this method must be called again before running
+ *          queries. Nothing is done if @p database is already frozen.
+ *
+ * @param database Database to be frozen.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int database_freeze(database_t *database);
+
+/**
+ * @brief   Builds the indexes of a frozen database that haven't been built yet.
+ * @details Indexes left out of ::database_freeze with ::database_set_data are otherwise built the
+ *          first time they're needed. This can be called from a background thread while queries
+ *          run on @p database: a query that needs an index being built waits for it to be finished,
+ *          instead of building it again.
+ *
+ * @param database Frozen database whose indexes are to be built.
+ * @param data     Indexes to be built (::DATABASE_DATA_HOTEL_INDEXES,
+ *                 ::DATABASE_DATA_FLIGHT_INDEXES and ::DATABASE_DATA_USER_INDEXES). Other flags
+ *                 are ignored.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int database_build_indexes(const database_t *database, database_data_t data);
+
+/**
+ * @brief   Checks if a database is frozen, i.e., nothing was added to it since ::database_freeze.
+ * @details Features that read from a database without modifying it (sharing it with
+ *          ::database_clone, storing it in a [snapshot](@ref dataset_snapshot.h) or running
+ *          queries in parallel with ::query_dispatcher_dispatch_list) require it to be frozen.
+ *
+ * @param database Database to be checked.
+ *
+ * @return Whether @p database is frozen.
+ */
+int database_is_frozen(const database_t *database);
+
+/**
+ * @brief   Reports how much memory each data structure in a database is using.
+ * @details Every pool, string pool and index of every manager is a separate entry (see
+ *          ::user_manager_add_to_memory_report, ::reservation_manager_add_to_memory_report,
+ *          ::flight_manager_add_to_memory_report and ::index_manager_add_to_memory_report). Unlike
+ *          process-wide memory measurements, this tells which structure dominates memory usage.
+ *
+ * @param database Database to get the memory usage from.
+ *
+ * @return A new ::memory_report_t, that must be freed with ::memory_report_free, or `NULL` on
+ *         allocation failure.
+ */
+memory_report_t *database_get_memory_report(const database_t *database);
+
+/**
+ * @brief   Gets how the lookups in the identifier filters of a database were answered.
+ * @details Sums the statistics of the filters of all managers (see
+ *          ::user_manager_get_id_filter_statistics, ::reservation_manager_get_id_filter_statistics
+ *          and ::flight_manager_get_id_filter_statistics). Filters are only built when
+ *          ::DATABASE_DATA_ID_FILTERS is set.
+ *
+ * @param database   Database to get the statistics from.
+ * @param statistics Where to write the statistics to.
+ *
+ * @retval 0 Success.
+ * @retval 1 No manager in @p database has a filter.
+ */
+int database_get_id_filter_statistics(const database_t          *database,
+                                      bloom_filter_statistics_t *statistics);
 
 /**
  * @brief Frees memory used by a database.
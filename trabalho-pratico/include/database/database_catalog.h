@@ -0,0 +1,185 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    database_catalog.h
+ * @brief   Statistics about the data in a database, collected once it's loaded.
+ * @details Usually, a catalog won't be computed by itself, but by a ::database_t in
+ *          ::database_freeze, and kept in [snapshots](@ref dataset_snapshot.h), so that restored
+ *          databases don't need to compute it again.
+ *
+ *          A catalog holds cheap information to base decisions on (such as the cost models of query
+ *          types, see ::query_type_cost_model_callback_t, or how much memory to reserve):
+ *
+ *          - The number of entities in each manager;
+ *          - The number of distinct airports and hotels;
+ *          - The hotels with the most reservations, and the airports with the most departures
+ *            (heavy hitters);
+ *          - The earliest and latest dates of each kind of entity;
+ *          - How the names of active users are distributed by their first letter.
+ *
+ *          It's computed with a single pass over each manager, and holds no pointers, so it can be
+ *          copied and stored as it is.
+ *
+ * ### Examples
+ *
+ * The following example prints the hotels with the most reservations, assuming the database was
+ * already loaded. See the [database.h header](@ref database_examples) to learn how to do that.
+ *
+ * ```c
+ * void print_busiest_hotels(const database_t *database) {
+ *     const database_catalog_t *const catalog = database_get_catalog(database);
+ *     if (!catalog)
+ *         return;
+ *
+ *     for (size_t i = 0; i < catalog->hotel_hitter_count; ++i) {
+ *         char hotel[HOTEL_ID_SPRINTF_MIN_BUFFER_SIZE];
+ *         hotel_id_sprintf(hotel, catalog->hotel_hitters[i].key);
+ *         printf("%s: %" PRIu32 "\n", hotel, catalog->hotel_hitters[i].count);
+ *     }
+ * }
+ * ```
+ */
+
+#ifndef DATABASE_CATALOG_H
+#define DATABASE_CATALOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "database/flight_manager.h"
+#include "database/reservation_manager.h"
+#include "database/user_manager.h"
+#include "utils/date.h"
+
+/** @brief Maximum number of heavy hitters of each kind kept in a ::database_catalog_t. */
+#define DATABASE_CATALOG_HEAVY_HITTER_COUNT 8
+
+/**
+ * @brief Number of buckets in ::database_catalog_t::name_prefixes: one for each letter from `A` to
+ *        `Z`, and one for names starting with any other character.
+ */
+#define DATABASE_CATALOG_NAME_PREFIX_COUNT 27
+
+/**
+ * @struct database_catalog_heavy_hitter_t
+ * @brief  An entity with many records, and how many it has.
+ *
+ * @var database_catalog_heavy_hitter_t::key
+ *     @brief Hotel (::hotel_id_t) or airport (::airport_code_t).
+ * @var database_catalog_heavy_hitter_t::count
+ *     @brief Number of reservations of a hotel, or of departures from an airport.
+ */
+typedef struct {
+    uint32_t key;
+    uint32_t count;
+} database_catalog_heavy_hitter_t;
+
+/**
+ * @struct database_catalog_date_range_t
+ * @brief  Earliest and latest dates of a kind of entity. Both are `0` when there are no entities.
+ *
+ * @var database_catalog_date_range_t::first
+ *     @brief Earliest date (inclusive).
+ * @var database_catalog_date_range_t::last
+ *     @brief Latest date (inclusive).
+ */
+typedef struct {
+    date_t first, last;
+} database_catalog_date_range_t;
+
+/**
+ * @struct database_catalog_t
+ * @brief  Statistics about the data in a database.
+ *
+ * @var database_catalog_t::users
+ *     @brief Number of users.
+ * @var database_catalog_t::active_users
+ *     @brief Number of users with active accounts.
+ * @var database_catalog_t::flights
+ *     @brief Number of valid flights.
+ * @var database_catalog_t::passengers
+ *     @brief Number of passengers of all valid flights.
+ * @var database_catalog_t::reservations
+ *     @brief Number of reservations.
+ * @var database_catalog_t::airports
+ *     @brief Number of distinct airports flights depart from or arrive at.
+ * @var database_catalog_t::hotels
+ *     @brief Number of distinct hotels with reservations.
+ * @var database_catalog_t::hotel_hitter_count
+ *     @brief Number of elements in ::database_catalog_t::hotel_hitters.
+ * @var database_catalog_t::hotel_hitters
+ *     @brief Hotels with the most reservations, from the one with the most.
+ * @var database_catalog_t::airport_hitter_count
+ *     @brief Number of elements in ::database_catalog_t::airport_hitters.
+ * @var database_catalog_t::airport_hitters
+ *     @brief Airports with the most departures, from the one with the most.
+ * @var database_catalog_t::user_dates
+ *     @brief Range of account creation dates of users.
+ * @var database_catalog_t::flight_dates
+ *     @brief Range of scheduled departure dates of valid flights.
+ * @var database_catalog_t::reservation_dates
+ *     @brief Range of begin dates of reservations.
+ * @var database_catalog_t::name_prefixes
+ *     @brief   Number of active users whose name starts with each letter (case-insensitively).
+ *     @details The last element counts names starting with any character other than an ASCII
+ *              letter.
+ */
+typedef struct {
+    uint64_t users, active_users, flights, passengers, reservations;
+    uint64_t airports, hotels;
+
+    uint32_t                        hotel_hitter_count;
+    database_catalog_heavy_hitter_t hotel_hitters[DATABASE_CATALOG_HEAVY_HITTER_COUNT];
+    uint32_t                        airport_hitter_count;
+    database_catalog_heavy_hitter_t airport_hitters[DATABASE_CATALOG_HEAVY_HITTER_COUNT];
+
+    database_catalog_date_range_t user_dates, flight_dates, reservation_dates;
+    uint64_t                      name_prefixes[DATABASE_CATALOG_NAME_PREFIX_COUNT];
+} database_catalog_t;
+
+/**
+ * @brief Computes the catalog of the entities in some managers.
+ *
+ * @param users        Users to be described.
+ * @param flights      Flights to be described.
+ * @param reservations Reservations to be described.
+ * @param out_catalog  Where to write the catalog to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p out_catalog isn't modified).
+ */
+int database_catalog_compute(const user_manager_t        *users,
+                             const flight_manager_t      *flights,
+                             const reservation_manager_t *reservations,
+                             database_catalog_t          *out_catalog);
+
+/**
+ * @brief   Gets the bucket of ::database_catalog_t::name_prefixes a name is counted in.
+ * @param   name Name of a user.
+ * @return  A number lower than ::DATABASE_CATALOG_NAME_PREFIX_COUNT.
+ */
+size_t database_catalog_get_name_prefix_bucket(const char *name);
+
+/**
+ * @brief Prints a catalog in a human-readable format.
+ *
+ * @param output  Stream to print the catalog to.
+ * @param catalog Catalog to be printed.
+ */
+void database_catalog_print(FILE *output, const database_catalog_t *catalog);
+
+#endif
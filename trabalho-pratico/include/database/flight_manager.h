@@ -97,6 +97,11 @@
  * Another operation (other than iteration) that can be performed on a ::flight_manager_t is a
  * lookup by flight identifier (::flight_manager_get_by_id).
  *
+ * Besides the flights themselves, the manager also keeps the fields most used by queries in
+ * separate contiguous arrays (columns). Scans that only need some of these fields should prefer
+ * ::flight_manager_iter_columns over ::flight_manager_iter, as it doesn't need to jump around
+ * memory to read every flight, nor call a function for each one of them.
+ *
  * If you'd rather not use a database, you could create the flight manager yourself with
  * ::flight_manager_create, add flights to it using ::flight_manager_add_flight, and free it in the
  * end with ::flight_manager_free. Just keep in mind that added flights and their associated strings
@@ -107,6 +112,10 @@
 #define FLIGHT_MANAGER_H
 
 #include "types/flight.h"
+#include "utils/bloom_filter.h"
+#include "utils/mapped_file.h"
+#include "utils/memory_report.h"
+#include "utils/thread_pool.h"
 
 /** @brief A data type that contains and manages all flights in a database. */
 typedef struct flight_manager flight_manager_t;
@@ -123,6 +132,109 @@ typedef struct flight_manager flight_manager_t;
  */
 typedef int (*flight_manager_iter_callback_t)(void *user_data, const flight_t *flight);
 
+/**
+ * @struct flight_manager_columns_t
+ * @brief  A span of rows of the columns in a flight manager.
+ *
+ * @var flight_manager_columns_t::length
+ *     @brief Number of rows in this span. All arrays have this many elements, and elements with
+ *            the same index come from the same flight.
+ * @var flight_manager_columns_t::flights
+ *     @brief Flights these rows refer to.
+ * @var flight_manager_columns_t::origins
+ *     @brief Origin airports of ::flight_manager_columns_t::flights.
+ * @var flight_manager_columns_t::destinations
+ *     @brief Destination airports of ::flight_manager_columns_t::flights.
+ * @var flight_manager_columns_t::schedule_departure_dates
+ *     @brief Scheduled departure dates of ::flight_manager_columns_t::flights.
+ * @var flight_manager_columns_t::real_departure_dates
+ *     @brief Real departure dates of ::flight_manager_columns_t::flights.
+ * @var flight_manager_columns_t::passengers
+ *     @brief Number of passengers of ::flight_manager_columns_t::flights.
+ */
+typedef struct {
+    size_t                 length;
+    const flight_t *const *flights;
+    const airport_code_t  *origins;
+    const airport_code_t  *destinations;
+    const date_and_time_t *schedule_departure_dates;
+    const date_and_time_t *real_departure_dates;
+    const uint16_t        *passengers;
+} flight_manager_columns_t;
+
+/** @brief Maximum number of rows in a ::flight_manager_columns_t. */
+#define FLIGHT_MANAGER_COLUMNS_SPAN_LENGTH 4096
+
+/**
+ * @struct flight_manager_zone_t
+ * @brief   Ranges of values in a span of rows of a flight manager (a zone map).
+ * @details Every span of ::FLIGHT_MANAGER_COLUMNS_SPAN_LENGTH rows has one, so that
+ *          ::flight_manager_iter_columns_filtered can skip spans that can't contain any flight
+ *          of interest. The same type describes the flights of interest: all ranges are inclusive.
+ *          See ::FLIGHT_MANAGER_ZONE_ALL for a zone that matches every flight.
+ *
+ * @var flight_manager_zone_t::min_schedule_departure_date
+ *     @brief Earliest scheduled departure date.
+ * @var flight_manager_zone_t::max_schedule_departure_date
+ *     @brief Latest scheduled departure date.
+ * @var flight_manager_zone_t::min_origin
+ *     @brief Smallest origin airport.
+ * @var flight_manager_zone_t::max_origin
+ *     @brief Largest origin airport.
+ * @var flight_manager_zone_t::min_destination
+ *     @brief Smallest destination airport.
+ * @var flight_manager_zone_t::max_destination
+ *     @brief Largest destination airport.
+ */
+typedef struct {
+    date_and_time_t min_schedule_departure_date, max_schedule_departure_date;
+    airport_code_t  min_origin, max_origin;
+    airport_code_t  min_destination, max_destination;
+} flight_manager_zone_t;
+
+/** @brief A ::flight_manager_zone_t that contains every flight. */
+#define FLIGHT_MANAGER_ZONE_ALL                                                                    \
+    ((flight_manager_zone_t) {.min_schedule_departure_date = 0,                                    \
+                              .max_schedule_departure_date = DATE_AND_TIME_LATEST,                 \
+                              .min_origin                  = 0,                                    \
+                              .max_origin                  = UINT32_MAX,                           \
+                              .min_destination             = 0,                                    \
+                              .max_destination             = UINT32_MAX})
+
+/**
+ * @struct flight_manager_partition_t
+ * @brief   The flights of a flight manager scheduled to depart in a given month.
+ * @details Partitions are built by ::flight_manager_compact (see ::flight_manager_get_partitions).
+ *
+ * @var flight_manager_partition_t::month
+ *     @brief First day of the month of the scheduled departure dates of the flights in the
+ *            partition.
+ * @var flight_manager_partition_t::length
+ *     @brief Number of flights in the partition.
+ * @var flight_manager_partition_t::first_row
+ *     @brief First row of the partition in the manager's columns. Only meaningful to
+ *            ::flight_manager_iter_partition_columns.
+ */
+typedef struct {
+    date_t month;
+    size_t length;
+    size_t first_row;
+} flight_manager_partition_t;
+
+/**
+ * @brief   Callback type for flight manager iterations over columns.
+ * @details Method called by ::flight_manager_iter_columns for every span of rows in a
+ *          ::flight_manager_t.
+ *
+ * @param user_data Argument passed to ::flight_manager_iter_columns, that is then passed to every
+ *                  callback, so that this method can change the program's state.
+ * @param columns   Span of rows in the manager. Its contents are only valid during the callback.
+ *
+ * @return `0` on success, or any other value to order iteration to stop.
+ */
+typedef int (*flight_manager_iter_columns_callback_t)(void                           *user_data,
+                                                      const flight_manager_columns_t *columns);
+
 /**
  * @brief   Instantiates a new ::flight_manager_t.
  * @details The returned value is owned by the caller and should be `free`d with
@@ -154,6 +266,49 @@ flight_manager_t *flight_manager_clone(const flight_manager_t *manager);
  */
 int flight_manager_add_flight(flight_manager_t *manager, const flight_t *flight);
 
+/**
+ * @brief   Prepares a flight manager for a number of flights to be added to it.
+ * @details This is only an optimization: it allocates the identifier lookup table and the pool of
+ *          flights once, instead of growing them repeatedly while the flights are added.
+ *
+ * @param manager Flight manager to be modified.
+ * @param count   Total number of flights expected in @p manager.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int flight_manager_reserve(flight_manager_t *manager, size_t count);
+
+/**
+ * @brief   Makes a flight manager keep strings of flights that are in a mapped file where they are,
+ *          instead of copying them.
+ * @details See ::string_pool_no_duplicates_borrow. Clones of @p manager copy those strings.
+ *
+ * @param manager Flight manager to be modified.
+ * @param file    File where strings of flights added to @p manager may be.
+ *
+ * @retval 0 Success.
+ * @retval 1 @p manager already borrows strings from a file.
+ */
+int flight_manager_borrow_strings(flight_manager_t *manager, mapped_file_t *file);
+
+/**
+ * @brief   Adds many flights to a flight manager at once.
+ * @details Equivalent to calling ::flight_manager_add_flight for each flight, but the manager is
+ *          reserved for all flights (see ::flight_manager_reserve), indexes are only discarded
+ *          once, and the identifier lookup table is prefetched ahead of each insertion.
+ *
+ * @param manager Flight manager to add @p flights to.
+ * @param flights Flights to add to @p manager, in order.
+ * @param n       Number of flights in @p flights.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (some of @p flights may have been added).
+ */
+int flight_manager_add_flights(flight_manager_t      *manager,
+                               const flight_t *const *flights,
+                               size_t                 n);
+
 /**
  * @brief Adds a number of passengers to a flight in a flight manager.
  *
@@ -177,10 +332,71 @@ int flight_manager_add_passagers(flight_manager_t *manager, flight_id_t id, int
  */
 const flight_t *flight_manager_get_by_id(const flight_manager_t *manager, flight_id_t id);
 
+/**
+ * @brief   Gets many flights from a flight manager by their identifiers.
+ * @details Equivalent to calling ::flight_manager_get_by_id for every identifier, but the lookup
+ *          table is prefetched ::ID_TABLE_PREFETCH_DISTANCE identifiers ahead, and every flight
+ *          found is prefetched too, so that cache misses overlap instead of being waited for one at
+ *          a time. Batches should be short enough for their flights to stay in cache until read.
+ *
+ * @param manager Flight manager to get the flights from.
+ * @param n       Number of identifiers in @p ids.
+ * @param ids     Identifiers of the flights to get.
+ * @param flights Where to write the flight with each identifier in @p ids to (`NULL` for the ones
+ *                that don't exist).
+ */
+void flight_manager_get_many_by_id(const flight_manager_t *manager,
+                                   size_t                  n,
+                                   const flight_id_t       ids[n],
+                                   const flight_t         *flights[n]);
+
+/**
+ * @brief   Builds a Bloom filter of the identifiers of the flights in a flight manager.
+ * @details Used by ::flight_manager_get_by_id_filtered. Adding or removing flights discards it, so
+ *          it should only be built once the manager stops being modified. Nothing is done if the
+ *          filter already exists.
+ *
+ * @param manager Flight manager to build the filter for.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int flight_manager_build_id_filter(flight_manager_t *manager);
+
+/**
+ * @brief   Gets a flight stored in a flight manager by its identifier, when it's likely not to
+ *          exist.
+ * @details Same as ::flight_manager_get_by_id, but identifiers not in the manager are rejected by
+ *          the filter built by ::flight_manager_build_id_filter (if any), which only touches one
+ *          cache line. Lookups are counted in the filter's statistics, so this method is meant for
+ *          identifiers from outside the database (e.g.: queries).
+ *
+ * @param manager Flight manager where to perform the lookup.
+ * @param id      Identifier of the flight to find.
+ *
+ * @return The flight with identifier @p id, or `NULL` if it does not exist.
+ */
+const flight_t *flight_manager_get_by_id_filtered(const flight_manager_t *manager, flight_id_t id);
+
+/**
+ * @brief Gets how the lookups in the identifier filter of a flight manager were answered.
+ *
+ * @param manager    Flight manager to get the statistics from.
+ * @param statistics Where to write the statistics to.
+ *
+ * @retval 0 Success.
+ * @retval 1 @p manager has no filter (see ::flight_manager_build_id_filter).
+ */
+int flight_manager_get_id_filter_statistics(const flight_manager_t    *manager,
+                                            bloom_filter_statistics_t *statistics);
+
 /**
  * @brief   Invalidates a flight stored in a manager.
  * @details Memory can't be `free`d by deleting a flight, given the internal structure of the
- *          manager. However, the deleted flight won't appear in later lookups or iterations.
+ *          manager. However, the deleted flight won't appear in later lookups or in
+ *          ::flight_manager_iter. Its row is only marked in a bitmap, and stays in the columns
+ *          until the next ::flight_manager_compact removes all marked rows at once, so column
+ *          iterations must not happen in between.
  *
  * @param manager Flight manager remove a flight from.
  * @param id      Identifier of the flight to invalidate.
@@ -191,7 +407,9 @@ const flight_t *flight_manager_get_by_id(const flight_manager_t *manager, flight
 int flight_manager_invalidate_by_id(flight_manager_t *manager, flight_id_t id);
 
 /**
- * @brief Iterates through every user in a flight manager, calling a callback for each one.
+ * @brief   Iterates through every flight in a flight manager, calling a callback for each one.
+ * @details Flights are visited in the order of their rows (see ::flight_manager_iter_columns),
+ *          skipping invalidated flights not yet removed by ::flight_manager_compact.
  *
  * @param manager   Flight manager to iterate over.
  * @param callback  Method called for every flight in @p manager.
@@ -204,6 +422,143 @@ int flight_manager_iter(const flight_manager_t        *manager,
                         flight_manager_iter_callback_t callback,
                         void                          *user_data);
 
+/**
+ * @brief   Iterates through the columns of every valid flight in a flight manager.
+ * @details Rows are handed out in spans of at most ::FLIGHT_MANAGER_COLUMNS_SPAN_LENGTH flights.
+ *          Once ::flight_manager_compact has been called, the order of flights isn't the order in
+ *          which they were added.
+ *
+ * @param manager   Flight manager to iterate over.
+ * @param callback  Method called for every span of rows in @p manager.
+ * @param user_data Argument passed to @p callback.
+ *
+ * @return The return value of the last-called @p callback (`0` means success, another value means
+ *         the iteration was stopped by a callback).
+ */
+int flight_manager_iter_columns(const flight_manager_t                *manager,
+                                flight_manager_iter_columns_callback_t callback,
+                                void                                  *user_data);
+
+/**
+ * @brief   Iterates through the columns of every valid flight in a flight manager, in parallel.
+ * @details Spans of rows are split into ranges (one per thread in @p pool), and each range gets
+ *          its own accumulator (see ::thread_pool_parallel_reduce). Accumulators are merged in the
+ *          calling thread, in the order of their ranges.
+ *
+ * @param manager   Flight manager to iterate over.
+ * @param pool      Thread pool to iterate in. `NULL` to iterate in the calling thread.
+ * @param init      Method called to create the accumulator of each range.
+ * @param callback  Method called for every span of rows in @p manager. Its `user_data` is the
+ *                  accumulator of the range the span is in.
+ * @param merge     Method called for every accumulator, after the iteration.
+ * @param user_data Argument passed to @p init and @p merge.
+ *
+ * @return `0` on success. Any other value means an allocation failure, or that the iteration was
+ *         stopped by a callback (the return value of the first callback that did so).
+ */
+int flight_manager_parallel_iter_columns(const flight_manager_t                *manager,
+                                         thread_pool_t                         *pool,
+                                         thread_pool_reduce_init_callback_t     init,
+                                         flight_manager_iter_columns_callback_t callback,
+                                         thread_pool_reduce_merge_callback_t    merge,
+                                         void                                  *user_data);
+
+/**
+ * @brief   Iterates through the columns of the flights in a flight manager that may be in a zone.
+ * @details Like ::flight_manager_iter_columns, but spans whose zone map doesn't intersect @p zone
+ *          are skipped. Spans that are visited may still contain flights outside of @p zone, that
+ *          @p callback must filter out. Pruning is most effective after
+ *          ::flight_manager_compact, that clusters flights by scheduled departure date.
+ *
+ * @param manager   Flight manager to iterate over.
+ * @param zone      Ranges of values of the flights of interest.
+ * @param callback  Method called for every span of rows in @p manager that may intersect @p zone.
+ * @param user_data Argument passed to @p callback.
+ *
+ * @return The return value of the last-called @p callback (`0` means success, another value means
+ *         the iteration was stopped by a callback).
+ */
+int flight_manager_iter_columns_filtered(const flight_manager_t                *manager,
+                                         const flight_manager_zone_t           *zone,
+                                         flight_manager_iter_columns_callback_t callback,
+                                         void                                  *user_data);
+
+/**
+ * @brief   Gets the directory of month partitions of a flight manager.
+ * @details Partitions are built by ::flight_manager_compact, and discarded as soon as a flight is
+ *          added or invalidated. Every valid flight is in exactly one partition.
+ *
+ * @param manager Flight manager to get the partitions from.
+ * @param count   Where to write the number of partitions to. `0` when @p manager isn't
+ *                partitioned.
+ *
+ * @return The partitions, sorted by month, or `NULL` when @p manager isn't partitioned. Valid
+ *         until @p manager is modified.
+ */
+const flight_manager_partition_t *flight_manager_get_partitions(const flight_manager_t *manager,
+                                                                size_t                 *count);
+
+/**
+ * @brief   Iterates through the columns of the flights in a month partition of a flight manager.
+ * @details Like ::flight_manager_iter_columns, rows are handed out in spans of at most
+ *          ::FLIGHT_MANAGER_COLUMNS_SPAN_LENGTH flights. Different partitions can be iterated
+ *          through concurrently.
+ *
+ * @param manager   Flight manager to iterate over.
+ * @param partition Partition of @p manager (see ::flight_manager_get_partitions).
+ * @param callback  Method called for every span of rows in @p partition.
+ * @param user_data Argument passed to @p callback.
+ *
+ * @return The return value of the last-called @p callback (`0` means success, another value means
+ *         the iteration was stopped by a callback).
+ */
+int flight_manager_iter_partition_columns(const flight_manager_t                *manager,
+                                          const flight_manager_partition_t      *partition,
+                                          flight_manager_iter_columns_callback_t callback,
+                                          void                                  *user_data);
+
+/**
+ * @brief   Releases memory a flight manager reserved for flights that were never added.
+ * @details Meant to be called once all flights have been added (see ::database_freeze). Pools are
+ *          trimmed (see ::pool_trim) and the identifier lookup table, that may have been reserved
+ *          for an overestimated number of flights (see ::flight_manager_reserve), is shrunk. If
+ *          flight identifiers are dense, the lookup table becomes an array indexed by identifier
+ *          (see ::id_table_compact), so that ::flight_manager_get_by_id doesn't hash.
+ *
+ *          Rows are also clustered by scheduled departure date (skipped if there isn't enough
+ *          memory to sort them), and zone maps are rebuilt to be as narrow as possible (see
+ *          ::flight_manager_iter_columns_filtered). Once sorted, rows are split into month
+ *          partitions (see ::flight_manager_get_partitions). Flights themselves aren't moved, so
+ *          pointers to flights stay valid. Flights can still be added afterwards.
+ *
+ *          Before any of this, the rows of flights invalidated since the last compaction (see
+ *          ::flight_manager_invalidate_by_id) are removed from the columns and from the lookup
+ *          table, in a single pass that keeps the order of the remaining rows.
+ *
+ *          On NUMA machines, columns are interleaved among all nodes (see
+ *          ::numa_topology_interleave), and the lookup table is replicated on every node (see
+ *          ::id_table_replicate).
+ *
+ * @param manager Flight manager to be compacted.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (the lookup table is left as it was).
+ */
+int flight_manager_compact(flight_manager_t *manager);
+
+/**
+ * @brief   Adds the memory used by the data structures of a flight manager to a memory report.
+ * @details Every pool, string pool and index in @p manager is added as a separate entry.
+ *
+ * @param manager Flight manager to get the memory usage from.
+ * @param report  Report to add entries to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int flight_manager_add_to_memory_report(const flight_manager_t *manager,
+                                        memory_report_t        *report);
+
 /**
  * @brief Frees memory used by a flight manager.
  * @param manager Flight manager whose memory is to be `free`'d.
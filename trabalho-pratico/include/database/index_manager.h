@@ -0,0 +1,476 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    index_manager.h
+ * @brief   Secondary indexes over the entities in a database.
+ * @details Usually, an index manager won't be created by itself, but instead by a ::database_t.
+ *
+ *          Many queries need to group entities by something other than their identifier (e.g.:
+ *          reservations by hotel). Instead of every query type regrouping all entities in its
+ *          statistical data, the index manager builds each index once, the first time it's needed,
+ *          and keeps it until the database is modified. Index lookups can be performed from many
+ *          threads at the same time, but not while the database is being modified.
+ *
+ *          Five indexes are available:
+ *
+ *          - Hotel identifier to reservations, sorted by begin date (from the newest one) and then
+ *            by reservation identifier. For faster scans, the nights and prices of those
+ *            reservations are also available as contiguous arrays (::index_manager_hotel_nights_t),
+ *            along with a prefix sum of the hotel's daily revenue, so that the revenue in any date
+ *            range can be found with two lookups;
+ *          - Origin airport to flights, sorted by scheduled departure date (from the newest one)
+ *            and then by flight identifier. Those dates are also available as contiguous arrays,
+ *            so that date ranges can be binary searched quickly;
+ *          - Year to the number of passengers of every airport (departures and arrivals scheduled
+ *            in that year), sorted by passenger count (from the largest one) and then by airport
+ *            code;
+ *          - The median departure delay of every origin airport, sorted by median (from the
+ *            largest one) and then by airport code. Flights never change after a dataset is
+ *            loaded, so medians are only calculated once, and can be stored in snapshots;
+ *          - Names of active users, sorted byte by byte (so that all names starting with a prefix
+ *            are contiguous), along with each user's position in the `en_US.UTF-8` collation
+ *            order of names and identifiers. A path-compressed trie (::prefix_trie_t) over those
+ *            names finds the range of names with a prefix in time proportional to the prefix's
+ *            length.
+ *
+ * @anchor index_manager_examples
+ * ### Examples
+ *
+ * The following example prints all reservations of a hotel, assuming the database was already
+ * loaded. See the [database.h header](@ref database_examples) to learn how to do that.
+ *
+ * ```c
+ * void print_hotel_reservations(const database_t *database, hotel_id_t hotel) {
+ *     const GConstPtrArray *const reservations = database_get_hotel_reservations(database, hotel);
+ *     if (!reservations)
+ *         return; // No reservations in this hotel
+ *
+ *     for (size_t i = 0; i < g_const_ptr_array_get_length(reservations); ++i) {
+ *         char id_str[RESERVATION_ID_SPRINTF_MIN_BUFFER_SIZE];
+ *         reservation_id_sprintf(id_str, reservation_get_id(g_const_ptr_array_index(reservations,
+ *                                                                                   i)));
+ *         puts(id_str);
+ *     }
+ * }
+ * ```
+ */
+
+#ifndef INDEX_MANAGER_H
+#define INDEX_MANAGER_H
+
+#include <glib.h>
+
+#include "database/flight_manager.h"
+#include "database/reservation_manager.h"
+#include "database/user_manager.h"
+#include "types/airport_code.h"
+#include "types/hotel_id.h"
+#include "utils/glib/GConstPtrArray.h"
+#include "utils/prefix_trie.h"
+
+/** @brief Lazily built secondary indexes over the entities in a database. */
+typedef struct index_manager index_manager_t;
+
+/**
+ * @struct index_manager_airport_passengers_t
+ * @brief  An airport and its number of passengers in a given year.
+ *
+ * @var index_manager_airport_passengers_t::airport
+ *     @brief An airport.
+ * @var index_manager_airport_passengers_t::passengers
+ *     @brief Number of passengers of flights departing from or arriving to
+ *            ::index_manager_airport_passengers_t::airport.
+ */
+typedef struct {
+    airport_code_t airport;
+    uint32_t       passengers;
+} index_manager_airport_passengers_t;
+
+/**
+ * @struct index_manager_airport_delay_t
+ * @brief  An origin airport and the median departure delay of its flights.
+ *
+ * @var index_manager_airport_delay_t::airport
+ *     @brief An airport.
+ * @var index_manager_airport_delay_t::median_delay
+ *     @brief Median of the departure delays (in seconds) of the flights departing from
+ *            ::index_manager_airport_delay_t::airport, rounded to the nearest integer.
+ */
+typedef struct {
+    airport_code_t airport;
+    int64_t        median_delay;
+} index_manager_airport_delay_t;
+
+/**
+ * @struct index_manager_hotel_nights_t
+ * @brief  Nights and prices of all reservations in a hotel, as contiguous arrays.
+ *
+ * @var index_manager_hotel_nights_t::length
+ *     @brief Number of reservations in the hotel, and of elements in every array.
+ * @var index_manager_hotel_nights_t::first_nights
+ *     @brief Day number (see ::date_to_day_number) of the begin date of each reservation.
+ * @var index_manager_hotel_nights_t::last_nights
+ *     @brief Day number (see ::date_to_day_number) of the last night of each reservation (the day
+ *            before its end date, or the end date itself if it's the first day of a month).
+ * @var index_manager_hotel_nights_t::prices_per_night
+ *     @brief Price per night of each reservation.
+ * @var index_manager_hotel_nights_t::first_day
+ *     @brief Day number of the first night any reservation in the hotel covers.
+ * @var index_manager_hotel_nights_t::days
+ *     @brief Number of days between the first and the last night any reservation in the hotel
+ *            covers (inclusive).
+ * @var index_manager_hotel_nights_t::revenue_prefix
+ *     @brief   ::index_manager_hotel_nights_t::days `+ 1` revenue sums, where the `i`-th element is
+ *              the hotel's revenue in the `i` days starting at
+ *              ::index_manager_hotel_nights_t::first_day.
+ *     @details `NULL` when the reservations in the hotel are spread over too many days, compared
+ *              to how many reservations there are, so that the index's size stays proportional to
+ *              the number of reservations. Revenues must then be calculated by going through
+ *              every reservation.
+ */
+typedef struct {
+    size_t         length;
+    const int32_t *first_nights;
+    const int32_t *last_nights;
+    const int32_t *prices_per_night;
+
+    int32_t        first_day;
+    size_t         days;
+    const int64_t *revenue_prefix;
+} index_manager_hotel_nights_t;
+
+/**
+ * @struct index_manager_user_name_t
+ * @brief  An entry in the index of user names.
+ *
+ * @var index_manager_user_name_t::user
+ *     @brief An active user.
+ * @var index_manager_user_name_t::collation_rank
+ *     @brief Position of ::index_manager_user_name_t::user when all indexed users are sorted by
+ *            name and then by identifier, according to the `en_US.UTF-8` locale (or the global
+ *            locale, if that one isn't available).
+ */
+typedef struct {
+    const user_t *user;
+    size_t        collation_rank;
+} index_manager_user_name_t;
+
+/**
+ * @brief   Callback type for index manager iterations over flights grouped by origin.
+ * @details Method called by ::index_manager_iter_origin_flights for every origin airport.
+ *
+ * @param user_data Argument passed to ::index_manager_iter_origin_flights, that is then passed to
+ *                  every callback, so that this method can change the program's state.
+ * @param origin    Origin airport.
+ * @param flights   Flights (::flight_t) departing from @p origin, sorted like in
+ *                  ::index_manager_get_origin_flights.
+ *
+ * @return `0` on success, or any other value to order iteration to stop.
+ */
+typedef int (*index_manager_iter_origin_flights_callback_t)(void                 *user_data,
+                                                             airport_code_t        origin,
+                                                             const GConstPtrArray *flights);
+
+/**
+ * @brief   Instantiates a new ::index_manager_t, without any built index.
+ * @details The returned value is owned by the caller and should be `free`d with
+ *          ::index_manager_free.
+ * @return  The new index manager, or `NULL` on allocation failure.
+ */
+index_manager_t *index_manager_create(void);
+
+/**
+ * @brief   Discards all built indexes.
+ * @details Must be called whenever the entities the indexes were built from are modified. Can
+ *          be called from many threads at the same time, as long as no index is built meanwhile
+ *          (i.e.: while the database is being loaded).
+ *
+ * @param manager Index manager whose indexes are to be discarded.
+ */
+void index_manager_invalidate(index_manager_t *manager);
+
+/**
+ * @brief   Gets all reservations in a hotel.
+ * @details The index is built from @p reservations if needed.
+ *
+ * @param manager      Index manager to get the reservations from.
+ * @param reservations Reservations to build the index from.
+ * @param hotel_id     Identifier of the hotel.
+ *
+ * @return An array of reservations (::reservation_t), sorted by begin date (from the newest one)
+ *         and then by identifier, or `NULL` if there are no reservations in that hotel. It's valid
+ *         until the next call to ::index_manager_invalidate.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref index_manager_examples).
+ */
+const GConstPtrArray *
+    index_manager_get_hotel_reservations(index_manager_t             *manager,
+                                         const reservation_manager_t *reservations,
+                                         hotel_id_t                   hotel_id);
+
+/**
+ * @brief   Gets the nights and prices of all reservations in a hotel.
+ * @details The index is built from @p reservations if needed.
+ *
+ * @param manager      Index manager to get the reservations from.
+ * @param reservations Reservations to build the index from.
+ * @param hotel_id     Identifier of the hotel.
+ *
+ * @return The nights of the hotel's reservations, in the same order as in
+ *         ::index_manager_get_hotel_reservations, or `NULL` if there are no reservations in that
+ *         hotel. It's valid until the next call to ::index_manager_invalidate.
+ */
+const index_manager_hotel_nights_t *
+    index_manager_get_hotel_nights(index_manager_t             *manager,
+                                   const reservation_manager_t *reservations,
+                                   hotel_id_t                   hotel_id);
+
+/**
+ * @brief   Builds the indexes of reservations by hotel, if they don't exist yet.
+ * @details Those indexes are otherwise built the first time they're needed, by
+ *          ::index_manager_get_hotel_reservations or ::index_manager_get_hotel_nights. Building
+ *          them before running queries keeps that cost out of any query's execution time. The
+ *          reservations of different hotels are sorted in parallel, when there are enough of them.
+ *
+ * @param manager      Index manager where to build the indexes.
+ * @param reservations Reservations to build the indexes from.
+ */
+void index_manager_build_hotel_indexes(index_manager_t             *manager,
+                                       const reservation_manager_t *reservations);
+
+/**
+ * @brief   Checks if the index of reservations by hotel has already been built.
+ * @details Lets query cost models know whether ::index_manager_get_hotel_reservations will need to
+ *          build that index first.
+ *
+ * @param manager Index manager to be checked.
+ *
+ * @retval 0 The index hasn't been built yet.
+ * @retval 1 The index has been built.
+ */
+int index_manager_has_hotel_reservations(index_manager_t *manager);
+
+/**
+ * @brief   Builds the indexes of flights by origin, of passengers by year and of delays by origin,
+ *          if they don't exist yet.
+ * @details Those indexes are otherwise built the first time they're needed. Building them before
+ *          running queries keeps that cost out of any query's execution time. All indexes are fed
+ *          by a single pass over all flights, instead of one pass each (as when they're built
+ *          lazily). The flights of different origin airports are sorted in parallel, when there
+ *          are enough of them.
+ *
+ * @param manager Index manager where to build the indexes.
+ * @param flights Flights to build the indexes from.
+ */
+void index_manager_build_flight_indexes(index_manager_t        *manager,
+                                        const flight_manager_t *flights);
+
+/**
+ * @brief   Gets all flights departing from an airport.
+ * @details The index is built from @p flights if needed.
+ *
+ * @param manager Index manager to get the flights from.
+ * @param flights Flights to build the index from.
+ * @param origin  Origin airport.
+ *
+ * @return An array of flights (::flight_t), sorted by scheduled departure date (from the newest
+ *         one) and then by identifier, or `NULL` if there are no flights departing from @p origin.
+ *         It's valid until the next call to ::index_manager_invalidate.
+ */
+const GConstPtrArray *index_manager_get_origin_flights(index_manager_t        *manager,
+                                                       const flight_manager_t *flights,
+                                                       airport_code_t          origin);
+
+/**
+ * @brief   Gets the scheduled departure dates of all flights departing from an airport.
+ * @details The index is built from @p flights if needed.
+ *
+ * @param manager Index manager to get the dates from.
+ * @param flights Flights to build the index from.
+ * @param origin  Origin airport.
+ *
+ * @return A `GArray` of ::date_and_time_t, with the scheduled departure date of each flight in
+ *         the array returned by ::index_manager_get_origin_flights (in the same order), or `NULL`
+ *         if there are no flights departing from @p origin. It's valid until the next call to
+ *         ::index_manager_invalidate.
+ */
+const GArray *index_manager_get_origin_departures(index_manager_t        *manager,
+                                                  const flight_manager_t *flights,
+                                                  airport_code_t          origin);
+
+/**
+ * @brief   Iterates through the flights from every origin airport.
+ * @details The index is built from @p flights if needed.
+ *
+ * @param manager   Index manager to get the flights from.
+ * @param flights   Flights to build the index from.
+ * @param callback  Method to be called for every origin airport.
+ * @param user_data Pointer to be passed to every @p callback, so that it can modify the program's
+ *                  state.
+ *
+ * @return The return value of the last-called @p callback (`0` means success, another value means
+ *         the iteration was stopped by a callback).
+ */
+int index_manager_iter_origin_flights(index_manager_t                             *manager,
+                                      const flight_manager_t                      *flights,
+                                      index_manager_iter_origin_flights_callback_t callback,
+                                      void                                        *user_data);
+
+/**
+ * @brief   Gets the number of passengers of every airport in a year.
+ * @details The index is built from @p flights if needed.
+ *
+ * @param manager Index manager to get the passenger counts from.
+ * @param flights Flights to build the index from.
+ * @param year    Year of the scheduled departure of flights to be considered.
+ *
+ * @return A `GArray` of ::index_manager_airport_passengers_t, sorted by number of passengers
+ *         (from the largest one) and then by airport code, or `NULL` if there are no flights in
+ *         @p year. It's valid until the next call to ::index_manager_invalidate.
+ */
+const GArray *index_manager_get_year_airport_passengers(index_manager_t        *manager,
+                                                        const flight_manager_t *flights,
+                                                        uint16_t                year);
+
+/**
+ * @brief   Gets the median departure delay of every origin airport.
+ * @details The index is built from @p flights if needed.
+ *
+ * @param manager Index manager to get the medians from.
+ * @param flights Flights to build the index from.
+ *
+ * @return A `GArray` of ::index_manager_airport_delay_t, sorted by median delay (from the largest
+ *         one) and then by airport code. It's valid until the next call to
+ *         ::index_manager_invalidate.
+ */
+const GArray *index_manager_get_origin_delay_medians(index_manager_t        *manager,
+                                                   const flight_manager_t *flights);
+
+/**
+ * @brief   Gets the median departure delay of every origin airport, if that index was built.
+ * @details Unlike ::index_manager_get_origin_delay_medians, the index isn't built if it doesn't
+ *          exist. Used for storing the index in snapshots.
+ *
+ * @param manager Index manager to get the medians from.
+ * @param medians Where to write the `GArray` of ::index_manager_airport_delay_t to. Valid until the
+ *                next call to ::index_manager_invalidate.
+ *
+ * @retval 0 Success.
+ * @retval 1 The index isn't built.
+ */
+int index_manager_get_built_origin_delay_medians(index_manager_t *manager,
+                                                 const GArray   **medians);
+
+/**
+ * @brief   Replaces the index of median departure delays with one built elsewhere.
+ * @details Used for restoring the index from snapshots, without going through all flights again.
+ *
+ * @param manager Index manager where to place the index.
+ * @param medians `GArray` of ::index_manager_airport_delay_t, sorted like in
+ *                ::index_manager_get_origin_delay_medians. Owned by @p manager after this call.
+ */
+void index_manager_restore_origin_delay_medians(index_manager_t *manager, GArray *medians);
+
+/**
+ * @brief   Gets all active users whose name starts with a prefix.
+ * @details The index is built from @p users if needed.
+ *
+ * @param manager Index manager to get the users from.
+ * @param users   Users to build the index from.
+ * @param prefix  Byte-wise prefix of the names of the users to be found.
+ * @param matches Where to write the address of the first matching ::index_manager_user_name_t
+ *                to. Matches are sorted by name byte by byte, not by collation order. They're
+ *                valid until the next call to ::index_manager_invalidate.
+ * @param n       Where to write the number of matches in @p matches to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure when building the index.
+ */
+int index_manager_get_users_by_name_prefix(index_manager_t                  *manager,
+                                           const user_manager_t             *users,
+                                           const char                       *prefix,
+                                           const index_manager_user_name_t **matches,
+                                           size_t                           *n);
+
+/**
+ * @brief   Builds the index of user names, if it doesn't exist yet.
+ * @details The index is otherwise built the first time it's needed, by
+ *          ::index_manager_get_users_by_name_prefix. Building it before running queries keeps the
+ *          cost of collating all names out of any query's execution time.
+ *
+ * @param manager Index manager where to build the index.
+ * @param users   Users to build the index from.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int index_manager_build_user_indexes(index_manager_t *manager, const user_manager_t *users);
+
+/**
+ * @brief   Gets the index of user names of an index manager, without building it.
+ * @details Used for storing the index (see ::index_manager_restore_user_names).
+ *
+ * @param manager Index manager to get the index from.
+ * @param entries Where to write the `GArray` of ::index_manager_user_name_t to.
+ * @param trie    Where to write the trie over the names in @p entries to.
+ *
+ * @retval 0 Success.
+ * @retval 1 The index hasn't been built yet.
+ */
+int index_manager_get_user_names(index_manager_t      *manager,
+                                 const GArray        **entries,
+                                 const prefix_trie_t **trie);
+
+/**
+ * @brief   Restores a stored index of user names, instead of building it.
+ * @details Any existing index of user names is replaced.
+ *
+ * @param manager   Index manager where to restore the index.
+ * @param entries   `GArray` of ::index_manager_user_name_t, in the same order as the stored index.
+ *                  Ownership is taken, even on failure.
+ * @param trie_data Data of the trie over the names in @p entries (see ::prefix_trie_get_data).
+ * @param length    Number of bytes in @p trie_data.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or @p trie_data is invalid.
+ */
+int index_manager_restore_user_names(index_manager_t *manager,
+                                     GArray          *entries,
+                                     const void      *trie_data,
+                                     size_t           length);
+
+/**
+ * @brief   Adds the memory used by the built indexes of an index manager to a memory report.
+ * @details Indexes that weren't built yet aren't added. The size of hash tables is estimated (see
+ *          ::memory_report_estimate_hash_table), and each array in them counts as a block.
+ *
+ * @param manager Index manager to get the memory usage from.
+ * @param report  Report to add entries to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int index_manager_add_to_memory_report(index_manager_t *manager, memory_report_t *report);
+
+/**
+ * @brief Frees memory used by an index manager, along with all its built indexes.
+ * @param manager Index manager whose memory is to be `free`d.
+ */
+void index_manager_free(index_manager_t *manager);
+
+#endif
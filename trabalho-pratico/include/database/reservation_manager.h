@@ -36,7 +36,7 @@
  * int iter_callback(void *user_data, const reservation_t *reservation) {
  *     (void) user_data;
  *
- *     const char      *user_id         = reservation_get_const_user_id(reservation);
+ *     uint32_t         user_index      = reservation_get_user_index(reservation);
  *     const char      *hotel_name      = reservation_get_const_hotel_name(reservation);
  *     reservation_id_t id              = reservation_get_id(reservation);
  *     uint8_t          rating          = reservation_get_rating(reservation);
@@ -61,10 +61,11 @@
  *     char reservation_id_str[RESERVATION_ID_SPRINTF_MIN_BUFFER_SIZE];
  *     reservation_id_sprintf(reservation_id_str, id);
  *
- *     printf("--- RESERVATION ---\nuser_id: %s\nhotel_name: %s\nincludes_breakfast: %s\n"
- *            "begin_date: %s\nend_date: %s\nid: %s\nrating: " PRIu8 "\nhotel_id: %s\n"
- *            "hotel_stars: " PRIu8 "\n city_tax: " PRIu8 "\nprice_per_night: " PRIu16 "\n\n",
- *            user_id,
+ *     printf("--- RESERVATION ---\nuser_index: %" PRIu32 "\nhotel_name: %s\n"
+ *            "includes_breakfast: %s\nbegin_date: %s\nend_date: %s\nid: %s\nrating: " PRIu8
+ *            "\nhotel_id: %s\nhotel_stars: " PRIu8 "\n city_tax: " PRIu8
+ *            "\nprice_per_night: " PRIu16 "\n\n",
+ *            user_index,
  *            hotel_name,
  *            includes_breakfast,
  *            begin_date,
@@ -101,6 +102,15 @@
  * Another operation (other than iteration) that can be performed on a ::reservation_manager_t is a
  * lookup by reservation identifier (::reservation_manager_get_by_id).
  *
+ * Besides the reservations themselves, the manager also keeps their numeric fields in separate
+ * contiguous arrays (columns). Scans that only need some of these fields should prefer
+ * ::reservation_manager_iter_columns over ::reservation_manager_iter, so that they don't read the
+ * strings and other fields in each reservation, nor call a function for each one of them.
+ *
+ * The sum and number of ratings of each hotel are also kept up to date as reservations are added,
+ * so that the average rating of a hotel (::reservation_manager_get_hotel_average_rating) can be
+ * known without going through its reservations.
+ *
  * If you'd rather not use a database, you could create the reservation manager yourself with
  * ::reservation_manager_create, add reservations to it using ::reservation_manager_add_reservation,
  * and free it in the end with ::reservation_manager_free. Just keep in mind that added reservations
@@ -111,6 +121,10 @@
 #define RESERVATION_MANAGER_H
 
 #include "types/reservation.h"
+#include "utils/bloom_filter.h"
+#include "utils/mapped_file.h"
+#include "utils/memory_report.h"
+#include "utils/thread_pool.h"
 
 /** @brief A data type that contains and manages all reservations in a database. */
 typedef struct reservation_manager reservation_manager_t;
@@ -128,6 +142,110 @@ typedef struct reservation_manager reservation_manager_t;
 typedef int (*reservation_manager_iter_callback_t)(void                *user_data,
                                                    const reservation_t *reservation);
 
+/**
+ * @struct reservation_manager_columns_t
+ * @brief  A span of rows of the columns in a reservation manager.
+ *
+ * @var reservation_manager_columns_t::length
+ *     @brief Number of rows in this span. All arrays have this many elements, and elements with
+ *            the same index come from the same reservation.
+ * @var reservation_manager_columns_t::reservations
+ *     @brief Reservations these rows refer to.
+ * @var reservation_manager_columns_t::hotel_ids
+ *     @brief Hotels of ::reservation_manager_columns_t::reservations.
+ * @var reservation_manager_columns_t::begin_dates
+ *     @brief Begin dates of ::reservation_manager_columns_t::reservations.
+ * @var reservation_manager_columns_t::end_dates
+ *     @brief End dates of ::reservation_manager_columns_t::reservations.
+ * @var reservation_manager_columns_t::prices_per_night
+ *     @brief Prices per night of ::reservation_manager_columns_t::reservations.
+ * @var reservation_manager_columns_t::ratings
+ *     @brief Ratings of ::reservation_manager_columns_t::reservations.
+ * @var reservation_manager_columns_t::city_taxes
+ *     @brief City taxes of ::reservation_manager_columns_t::reservations.
+ */
+typedef struct {
+    size_t                      length;
+    const reservation_t *const *reservations;
+    const hotel_id_t           *hotel_ids;
+    const date_t               *begin_dates;
+    const date_t               *end_dates;
+    const uint16_t             *prices_per_night;
+    const uint8_t              *ratings;
+    const uint8_t              *city_taxes;
+} reservation_manager_columns_t;
+
+/** @brief Maximum number of rows in a ::reservation_manager_columns_t. */
+#define RESERVATION_MANAGER_COLUMNS_SPAN_LENGTH 4096
+
+/**
+ * @struct reservation_manager_zone_t
+ * @brief   Ranges of values in a span of rows of a reservation manager (a zone map).
+ * @details See ::flight_manager_zone_t, which this is analogous to. All ranges are inclusive, and
+ *          ::RESERVATION_MANAGER_ZONE_ALL matches every reservation.
+ *
+ * @var reservation_manager_zone_t::min_begin_date
+ *     @brief Earliest begin date.
+ * @var reservation_manager_zone_t::max_begin_date
+ *     @brief Latest begin date.
+ * @var reservation_manager_zone_t::min_end_date
+ *     @brief Earliest end date.
+ * @var reservation_manager_zone_t::max_end_date
+ *     @brief Latest end date.
+ * @var reservation_manager_zone_t::min_hotel_id
+ *     @brief Smallest hotel identifier.
+ * @var reservation_manager_zone_t::max_hotel_id
+ *     @brief Largest hotel identifier.
+ */
+typedef struct {
+    date_t     min_begin_date, max_begin_date;
+    date_t     min_end_date, max_end_date;
+    hotel_id_t min_hotel_id, max_hotel_id;
+} reservation_manager_zone_t;
+
+/** @brief A ::reservation_manager_zone_t that contains every reservation. */
+#define RESERVATION_MANAGER_ZONE_ALL                                                               \
+    ((reservation_manager_zone_t) {.min_begin_date = 0,                                            \
+                                   .max_begin_date = DATE_LATEST,                                  \
+                                   .min_end_date   = 0,                                            \
+                                   .max_end_date   = DATE_LATEST,                                  \
+                                   .min_hotel_id   = 0,                                            \
+                                   .max_hotel_id   = UINT16_MAX})
+
+/**
+ * @struct reservation_manager_partition_t
+ * @brief   The reservations of a reservation manager that begin in a given month.
+ * @details See ::flight_manager_partition_t, which this is analogous to.
+ *
+ * @var reservation_manager_partition_t::month
+ *     @brief First day of the month of the begin dates of the reservations in the partition.
+ * @var reservation_manager_partition_t::length
+ *     @brief Number of reservations in the partition.
+ * @var reservation_manager_partition_t::first_row
+ *     @brief First row of the partition in the manager's columns. Only meaningful to
+ *            ::reservation_manager_iter_partition_columns.
+ */
+typedef struct {
+    date_t month;
+    size_t length;
+    size_t first_row;
+} reservation_manager_partition_t;
+
+/**
+ * @brief   Callback type for reservation manager iterations over columns.
+ * @details Method called by ::reservation_manager_iter_columns for every span of rows in a
+ *          ::reservation_manager_t.
+ *
+ * @param user_data Argument passed to ::reservation_manager_iter_columns, that is then passed to
+ *                  every callback, so that this method can change the program's state.
+ * @param columns   Span of rows in the manager. Its contents are only valid during the callback.
+ *
+ * @return `0` on success, or any other value to order iteration to stop.
+ */
+typedef int (*reservation_manager_iter_columns_callback_t)(
+    void                                *user_data,
+    const reservation_manager_columns_t *columns);
+
 /**
  * @brief   Instantiates a new ::reservation_manager_t.
  * @details The returned value is owned by the called and should be `free`'d with
@@ -160,6 +278,50 @@ reservation_manager_t *reservation_manager_clone(const reservation_manager_t *ma
 int reservation_manager_add_reservation(reservation_manager_t *manager,
                                         const reservation_t   *reservation);
 
+/**
+ * @brief   Prepares a reservation manager for a number of reservations to be added to it.
+ * @details This is only an optimization: it allocates the identifier lookup table and the pool of
+ *          reservations once, instead of growing them repeatedly while the reservations are added.
+ *
+ * @param manager Reservation manager to be modified.
+ * @param count   Total number of reservations expected in @p manager.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int reservation_manager_reserve(reservation_manager_t *manager, size_t count);
+
+/**
+ * @brief   Makes a reservation manager keep hotel names that are in a mapped file where they are,
+ *          instead of copying them.
+ * @details See ::string_pool_no_duplicates_borrow. Clones of @p manager copy those strings.
+ *
+ * @param manager Reservation manager to be modified.
+ * @param file    File where hotel names of reservations added to @p manager may be.
+ *
+ * @retval 0 Success.
+ * @retval 1 @p manager already borrows strings from a file.
+ */
+int reservation_manager_borrow_strings(reservation_manager_t *manager, mapped_file_t *file);
+
+/**
+ * @brief   Adds many reservations to a reservation manager at once.
+ * @details Equivalent to calling ::reservation_manager_add_reservation for each reservation, but
+ *          the manager is reserved for all reservations (see ::reservation_manager_reserve),
+ *          indexes are only discarded once, and the identifier lookup table is prefetched ahead of
+ *          each insertion.
+ *
+ * @param manager      Reservation manager to add @p reservations to.
+ * @param reservations Reservations to add to @p manager, in order.
+ * @param n            Number of reservations in @p reservations.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (some of @p reservations may have been added).
+ */
+int reservation_manager_add_reservations(reservation_manager_t      *manager,
+                                         const reservation_t *const *reservations,
+                                         size_t                      n);
+
 /**
  * @brief Gets a reservation stored in a reservation manager by its identifier.
  *
@@ -171,6 +333,118 @@ int reservation_manager_add_reservation(reservation_manager_t *manager,
 const reservation_t *reservation_manager_get_by_id(const reservation_manager_t *manager,
                                                    reservation_id_t             id);
 
+/**
+ * @brief   Gets many reservations stored in a reservation manager by their identifiers.
+ * @details Equivalent to calling ::reservation_manager_get_by_id for every identifier, but the
+ *          lookup table is prefetched ::ID_TABLE_PREFETCH_DISTANCE identifiers ahead, and every
+ *          reservation found is prefetched too, so that cache misses overlap. Batches should be
+ *          short enough for their reservations to stay in cache until read.
+ *
+ * @param manager      Reservation manager where to perform the lookups.
+ * @param n            Number of identifiers in @p ids.
+ * @param ids          Identifiers of the reservations to find.
+ * @param reservations Where to write the reservation with each identifier in @p ids to (`NULL`
+ *                     for the ones that aren't found).
+ */
+void reservation_manager_get_many_by_id(const reservation_manager_t *manager,
+                                        size_t                       n,
+                                        const reservation_id_t       ids[n],
+                                        const reservation_t         *reservations[n]);
+
+/**
+ * @brief   Builds a Bloom filter of the identifiers of the reservations in a reservation manager.
+ * @details Used by ::reservation_manager_get_by_id_filtered. Adding reservations discards it, so
+ *          it should only be built once the manager stops being modified. Nothing is done if the
+ *          filter already exists.
+ *
+ * @param manager Reservation manager to build the filter for.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int reservation_manager_build_id_filter(reservation_manager_t *manager);
+
+/**
+ * @brief   Gets a reservation stored in a reservation manager by its identifier, when it's likely
+ *          not to exist.
+ * @details Same as ::reservation_manager_get_by_id, but identifiers not in the manager are rejected
+ *          by the filter built by ::reservation_manager_build_id_filter (if any). Lookups are
+ *          counted in the filter's statistics, so this method is meant for identifiers from
+ *          outside the database (e.g.: queries).
+ *
+ * @param manager Reservation manager where to perform the lookup.
+ * @param id      Identifier of the reservation to find.
+ *
+ * @return The reservation with identifier @p id, or `NULL` if it does not exist.
+ */
+const reservation_t *reservation_manager_get_by_id_filtered(const reservation_manager_t *manager,
+                                                            reservation_id_t             id);
+
+/**
+ * @brief Gets how the lookups in the identifier filter of a reservation manager were answered.
+ *
+ * @param manager    Reservation manager to get the statistics from.
+ * @param statistics Where to write the statistics to.
+ *
+ * @retval 0 Success.
+ * @retval 1 @p manager has no filter (see ::reservation_manager_build_id_filter).
+ */
+int reservation_manager_get_id_filter_statistics(const reservation_manager_t *manager,
+                                                 bloom_filter_statistics_t   *statistics);
+
+/**
+ * @brief   Gets the average rating of a hotel, among all its reservations.
+ * @details This is a constant-time operation, as ratings are aggregated when reservations are
+ *          added to @p manager.
+ *
+ * @param manager  Reservation manager where to perform the lookup.
+ * @param hotel_id Identifier of the hotel.
+ *
+ * @return The average rating of the hotel, or `-NaN` if it has no reservations. That's the
+ *         average of no ratings (`0.0 / 0.0`) on x86, and it's written as `-nan` by `printf`.
+ */
+double reservation_manager_get_hotel_average_rating(const reservation_manager_t *manager,
+                                                    hotel_id_t                   hotel_id);
+
+/**
+ * @brief   Gets the number of reservations of a hotel.
+ * @details This is a constant-time operation, like
+ *          ::reservation_manager_get_hotel_average_rating.
+ *
+ * @param manager  Reservation manager where to perform the lookup.
+ * @param hotel_id Identifier of the hotel.
+ *
+ * @return The number of reservations in the hotel.
+ */
+size_t reservation_manager_get_hotel_reservation_count(const reservation_manager_t *manager,
+                                                       hotel_id_t                   hotel_id);
+
+/**
+ * @brief   Gets the sum of the ratings of all reservations of a hotel.
+ * @details This is a constant-time operation, like
+ *          ::reservation_manager_get_hotel_average_rating. Averages of many reservation managers
+ *          (e.g.: [partitions](@ref database_set_partition) of a dataset) are merged from these
+ *          sums and from ::reservation_manager_get_hotel_reservation_count.
+ *
+ * @param manager  Reservation manager where to perform the lookup.
+ * @param hotel_id Identifier of the hotel.
+ * @param out_sum  Where to write the sum of the hotel's ratings to.
+ *
+ * @retval 0 Success.
+ * @retval 1 No reservation of the hotel was ever added to @p manager (its average rating is
+ *           `-NaN`).
+ */
+int reservation_manager_get_hotel_rating_sum(const reservation_manager_t *manager,
+                                             hotel_id_t                   hotel_id,
+                                             uint64_t                    *out_sum);
+
+/**
+ * @brief  Gets the number of reservations in a reservation manager.
+ * @param  manager Reservation manager to get the number of reservations from.
+ * @return The number of reservations in @p manager.
+ */
+size_t reservation_manager_get_count(const reservation_manager_t *manager);
+
 /**
  * @brief Iterates through every reservation in a reservation manager, calling a callback for each
  *        one.
@@ -190,6 +464,125 @@ int reservation_manager_iter(const reservation_manager_t        *manager,
                              reservation_manager_iter_callback_t callback,
                              void                               *user_data);
 
+/**
+ * @brief   Iterates through the columns of every reservation in a reservation manager.
+ * @details Rows are handed out in spans of at most ::RESERVATION_MANAGER_COLUMNS_SPAN_LENGTH
+ *          reservations, in the order they were added to the manager.
+ *
+ * @param manager   Reservation manager to iterate through.
+ * @param callback  Method to be called for every span of rows in @p manager.
+ * @param user_data Pointer to be passed to every @p callback, so that it can modify the program's
+ *                  state.
+ *
+ * @return The return value of the last-called @p callback (`0` means success, another value means
+ *         the iteration was stopped by a callback).
+ */
+int reservation_manager_iter_columns(const reservation_manager_t                *manager,
+                                     reservation_manager_iter_columns_callback_t callback,
+                                     void                                       *user_data);
+
+/**
+ * @brief   Iterates through the columns of every reservation in a reservation manager, in
+ *          parallel.
+ * @details See ::flight_manager_parallel_iter_columns, which this is analogous to.
+ *
+ * @param manager   Reservation manager to iterate over.
+ * @param pool      Thread pool to iterate in. `NULL` to iterate in the calling thread.
+ * @param init      Method called to create the accumulator of each range.
+ * @param callback  Method called for every span of rows in @p manager. Its `user_data` is the
+ *                  accumulator of the range the span is in.
+ * @param merge     Method called for every accumulator, after the iteration.
+ * @param user_data Argument passed to @p init and @p merge.
+ *
+ * @return `0` on success. Any other value means an allocation failure, or that the iteration was
+ *         stopped by a callback (the return value of the first callback that did so).
+ */
+int reservation_manager_parallel_iter_columns(
+    const reservation_manager_t                *manager,
+    thread_pool_t                              *pool,
+    thread_pool_reduce_init_callback_t          init,
+    reservation_manager_iter_columns_callback_t callback,
+    thread_pool_reduce_merge_callback_t         merge,
+    void                                       *user_data);
+
+/**
+ * @brief   Iterates through the columns of the reservations in a reservation manager that may be
+ *          in a zone.
+ * @details See ::flight_manager_iter_columns_filtered, which this is analogous to. Reservations
+ *          are clustered by begin date.
+ *
+ * @param manager   Reservation manager to iterate over.
+ * @param zone      Ranges of values of the reservations of interest.
+ * @param callback  Method called for every span of rows in @p manager that may intersect @p zone.
+ * @param user_data Argument passed to @p callback.
+ *
+ * @return The return value of the last-called @p callback (`0` means success, another value means
+ *         the iteration was stopped by a callback).
+ */
+int reservation_manager_iter_columns_filtered(
+    const reservation_manager_t                *manager,
+    const reservation_manager_zone_t           *zone,
+    reservation_manager_iter_columns_callback_t callback,
+    void                                       *user_data);
+
+/**
+ * @brief   Gets the directory of month partitions of a reservation manager.
+ * @details See ::flight_manager_get_partitions, which this is analogous to.
+ *
+ * @param manager Reservation manager to get the partitions from.
+ * @param count   Where to write the number of partitions to. `0` when @p manager isn't
+ *                partitioned.
+ *
+ * @return The partitions, sorted by month, or `NULL` when @p manager isn't partitioned. Valid
+ *         until @p manager is modified.
+ */
+const reservation_manager_partition_t *
+    reservation_manager_get_partitions(const reservation_manager_t *manager, size_t *count);
+
+/**
+ * @brief   Iterates through the columns of the reservations in a month partition of a
+ *          reservation manager.
+ * @details See ::flight_manager_iter_partition_columns, which this is analogous to.
+ *
+ * @param manager   Reservation manager to iterate over.
+ * @param partition Partition of @p manager (see ::reservation_manager_get_partitions).
+ * @param callback  Method called for every span of rows in @p partition.
+ * @param user_data Argument passed to @p callback.
+ *
+ * @return The return value of the last-called @p callback (`0` means success, another value means
+ *         the iteration was stopped by a callback).
+ */
+int reservation_manager_iter_partition_columns(
+    const reservation_manager_t                *manager,
+    const reservation_manager_partition_t      *partition,
+    reservation_manager_iter_columns_callback_t callback,
+    void                                       *user_data);
+
+/**
+ * @brief   Releases memory a reservation manager reserved for reservations that were never added.
+ * @details See ::flight_manager_compact, which this is analogous to. Rows are clustered and
+ *          partitioned by begin date.
+ *
+ * @param manager Reservation manager to be compacted.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (the lookup table is left as it was).
+ */
+int reservation_manager_compact(reservation_manager_t *manager);
+
+/**
+ * @brief   Adds the memory used by the data structures of a reservation manager to a memory report.
+ * @details Every pool, string pool and index in @p manager is added as a separate entry.
+ *
+ * @param manager Reservation manager to get the memory usage from.
+ * @param report  Report to add entries to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int reservation_manager_add_to_memory_report(const reservation_manager_t *manager,
+                                             memory_report_t             *report);
+
 /**
  * @brief Frees memory used by a reservation manager.
  * @param manager Reservation manager whose memory is to be `free`d.
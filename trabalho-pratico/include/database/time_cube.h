@@ -0,0 +1,251 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    time_cube.h
+ * @brief   Event counts of every day, month and year in a database.
+ * @details Usually, a time cube won't be created by itself, but instead by a ::database_t, that
+ *          keeps it up to date as entities are added and removed.
+ *
+ *          Users (by account creation date), flights and their passengers (by scheduled departure
+ *          date) and reservations (by begin date) are counted as they're added, in the day they
+ *          happened in, as well as in that day's month and year. Reading the counts of any day,
+ *          month or year is then a single lookup (::time_cube_get).
+ *
+ *          Unique passengers (users with at least one flight in a day, month or year) can't be
+ *          counted that way, as whether a passenger is new to an instant depends on all other
+ *          flights of the same user. They're instead counted from the timelines of all users, by
+ *          ::time_cube_count_unique_passengers, which a database calls in ::database_freeze after
+ *          passengers are added or flights are removed. A frozen user manager rebuilds every
+ *          timeline anyway, so this only costs as much as freezing it.
+ *
+ * ### Examples
+ *
+ * The following example prints the number of flights in every month of 2023, assuming the
+ * database was already loaded. See the [database.h header](@ref database_examples) to learn how to
+ * do that.
+ *
+ * ```c
+ * void print_monthly_flights(const database_t *database) {
+ *     const time_cube_t *const cube = database_get_time_cube(database);
+ *     for (uint8_t month = 1; month <= 12; ++month) {
+ *         const time_cube_cell_t *const cell = time_cube_get(cube, 2023, month, 0);
+ *         printf("%" PRIu8 ": %" PRIu32 "\n", month, cell->flights);
+ *     }
+ * }
+ * ```
+ */
+
+#ifndef TIME_CUBE_H
+#define TIME_CUBE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "database/user_manager.h"
+#include "utils/date.h"
+#include "utils/memory_report.h"
+
+/** @brief Start of the range of event years counted by a ::time_cube_t. */
+#define TIME_CUBE_YEAR_RANGE_START 2000
+/** @brief End of the range of event years counted by a ::time_cube_t (exclusive). */
+#define TIME_CUBE_YEAR_RANGE_END 2064
+
+/** @brief Event counts of every day, month and year in a database. */
+typedef struct time_cube time_cube_t;
+
+/**
+ * @struct time_cube_cell_t
+ * @brief  Event counts of a day, month or year.
+ *
+ * @var time_cube_cell_t::users
+ *     @brief Number of registered users.
+ * @var time_cube_cell_t::flights
+ *     @brief Number of flights.
+ * @var time_cube_cell_t::passengers
+ *     @brief Number of passengers.
+ * @var time_cube_cell_t::unique_passengers
+ *     @brief Number of different users with at least one flight in this day / month / year.
+ * @var time_cube_cell_t::reservations
+ *     @brief Number of hotel reservations.
+ */
+typedef struct {
+    uint32_t users, flights, passengers, unique_passengers, reservations;
+} time_cube_cell_t;
+
+/** @brief Events counted as they're added to a ::time_cube_t (see ::time_cube_add). */
+typedef enum {
+    TIME_CUBE_MEASURE_USERS,        /**< @brief ::time_cube_cell_t::users */
+    TIME_CUBE_MEASURE_FLIGHTS,      /**< @brief ::time_cube_cell_t::flights */
+    TIME_CUBE_MEASURE_PASSENGERS,   /**< @brief ::time_cube_cell_t::passengers */
+    TIME_CUBE_MEASURE_RESERVATIONS, /**< @brief ::time_cube_cell_t::reservations */
+} time_cube_measure_t;
+
+/**
+ * @struct time_cube_unique_passengers_t
+ * @brief  Number of unique passengers of a day, month or year, to be stored in snapshots.
+ *
+ * @var time_cube_unique_passengers_t::year
+ *     @brief Year of the instant.
+ * @var time_cube_unique_passengers_t::month
+ *     @brief Month of the instant, or `0` for a whole year.
+ * @var time_cube_unique_passengers_t::day
+ *     @brief Day of the instant, or `0` for a whole month or year.
+ * @var time_cube_unique_passengers_t::count
+ *     @brief Number of unique passengers in the instant.
+ */
+typedef struct {
+    uint16_t year;
+    uint8_t  month, day;
+    uint32_t count;
+} time_cube_unique_passengers_t;
+
+/**
+ * @brief   Callback type for iterations over the unique passengers in a time cube.
+ * @details Method called by ::time_cube_iter_unique_passengers for every instant with unique
+ *          passengers.
+ *
+ * @param user_data Argument passed to ::time_cube_iter_unique_passengers.
+ * @param entry     Instant and its number of unique passengers.
+ *
+ * @return `0` on success, or any other value to order iteration to stop.
+ */
+typedef int (*time_cube_unique_passengers_callback_t)(
+    void                                *user_data,
+    const time_cube_unique_passengers_t *entry);
+
+/**
+ * @brief   Instantiates a new ::time_cube_t, with no events.
+ * @details The returned value is owned by the caller and should be `free`d with ::time_cube_free.
+ * @return  The new time cube, or `NULL` on allocation failure.
+ */
+time_cube_t *time_cube_create(void);
+
+/**
+ * @brief   Creates a deep copy of a time cube.
+ * @param   cube Time cube to be copied.
+ * @return  The copy of @p cube, or `NULL` on allocation failure.
+ */
+time_cube_t *time_cube_clone(const time_cube_t *cube);
+
+/**
+ * @brief   Counts events in the day of @p date, as well as in its month and year.
+ * @details Events in years outside of [::TIME_CUBE_YEAR_RANGE_START, ::TIME_CUBE_YEAR_RANGE_END)
+ *          aren't counted. Different measures can be counted from different threads at the same
+ *          time.
+ *
+ * @param cube    Time cube to be modified.
+ * @param measure Type of the events.
+ * @param date    Date of the events.
+ * @param count   Number of events. Negative to remove events counted before.
+ */
+void time_cube_add(time_cube_t *cube, time_cube_measure_t measure, date_t date, int32_t count);
+
+/**
+ * @brief   Counts the unique passengers of every day, month and year from the timelines of users.
+ * @details Previous counts are replaced. Users are iterated through in parallel, in the shared
+ *          thread pool.
+ *
+ * @param cube  Time cube to be modified.
+ * @param users Frozen user manager with the timelines of flights of users (see
+ *              ::user_manager_freeze).
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (the unique passengers of @p cube are left uncounted).
+ */
+int time_cube_count_unique_passengers(time_cube_t *cube, const user_manager_t *users);
+
+/**
+ * @brief   Marks the unique passengers of a time cube as outdated.
+ * @details Called when a user gains a flight or a flight is removed. The counts are kept until
+ *          they're recounted, but they're no longer stored in snapshots.
+ *
+ * @param cube Time cube to be modified.
+ */
+void time_cube_invalidate_unique_passengers(time_cube_t *cube);
+
+/**
+ * @brief  Checks if the unique passengers of a time cube are up to date.
+ * @param  cube Time cube to be checked.
+ * @return Whether unique passengers were counted (or restored) since they were last invalidated.
+ */
+int time_cube_has_unique_passengers(const time_cube_t *cube);
+
+/**
+ * @brief Iterates through all days, months and years with unique passengers in a time cube.
+ *
+ * @param cube      Time cube to iterate through.
+ * @param callback  Method called for every instant with at least one unique passenger.
+ * @param user_data Argument passed to @p callback.
+ *
+ * @return `0` on success, `1` if the unique passengers of @p cube are outdated (see
+ *         ::time_cube_has_unique_passengers), or the value returned by the callback that stopped
+ *         iteration.
+ */
+int time_cube_iter_unique_passengers(const time_cube_t                     *cube,
+                                     time_cube_unique_passengers_callback_t callback,
+                                     void                                  *user_data);
+
+/**
+ * @brief   Restores stored unique passenger counts in a time cube, instead of counting them.
+ * @details All other counts are kept. Instants missing from @p entries have no unique passengers.
+ *
+ * @param cube    Time cube to be modified.
+ * @param entries Counts obtained with ::time_cube_iter_unique_passengers.
+ * @param n       Number of elements in @p entries.
+ *
+ * @retval 0 Success.
+ * @retval 1 An instant in @p entries isn't counted by time cubes (nothing is restored).
+ */
+int time_cube_restore_unique_passengers(time_cube_t                         *cube,
+                                        const time_cube_unique_passengers_t *entries,
+                                        size_t                               n);
+
+/**
+ * @brief Gets the event counts of a day, month or year.
+ *
+ * @param cube  Time cube to get the counts from.
+ * @param year  Year of the instant.
+ * @param month Month of the instant (`1` to `12`), or `0` for the whole @p year.
+ * @param day   Day of the instant (`1` to `31`), or `0` for the whole @p month (or @p year, if
+ *              @p month is `0`).
+ *
+ * @return The counts of the instant, or `NULL` if @p year is outside of the range of years counted
+ *         by time cubes, or @p month or @p day are invalid.
+ */
+const time_cube_cell_t *time_cube_get(const time_cube_t *cube,
+                                      uint16_t           year,
+                                      uint8_t            month,
+                                      uint8_t            day);
+
+/**
+ * @brief Adds the memory used by a time cube to a memory report.
+ *
+ * @param cube   Time cube to get the memory usage from.
+ * @param report Report to add an entry to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int time_cube_add_to_memory_report(const time_cube_t *cube, memory_report_t *report);
+
+/**
+ * @brief Frees memory used by a time cube.
+ * @param cube Time cube whose memory is to be `free`d.
+ */
+void time_cube_free(time_cube_t *cube);
+
+#endif
@@ -71,7 +71,7 @@
  *         return 1;
  *     }
  *
- *     if (dataset_loader_load(database, "/path/to/dataset/directory", "Resultados", NULL)) {
+ *     if (dataset_loader_load(database, "/path/to/dataset/directory", "Resultados", NULL, NULL)) {
  *         fputs("Failed to open dataset to be parsed.\n", stderr);
  *         return 1;
  *     }
@@ -84,7 +84,25 @@
  * ```
  *
  * Another operation (other than iteration) that can be performed on a ::user_manager_t is a lookup
- * by user identifier (::user_manager_get_by_id).
+ * by user identifier (::user_manager_get_by_id). Every user is also given a dense index (the number
+ * of users added before it), that can be found with ::user_manager_get_index_by_id. Other entities
+ * refer to users by this index, so that joins are simple array accesses
+ * (::user_manager_get_by_index). A bitmap of which indices belong to active users is also kept, so
+ * that inactive users can be rejected (::user_manager_is_active_by_index) or skipped
+ * (::user_manager_iter_active) without touching their records.
+ *
+ * While a dataset is being loaded, the flights and reservations associated to each user are kept
+ * in linked lists, that can grow in any order, or staged as packed `(user index, identifier)`
+ * pairs (::user_manager_stage_associations). Once loading is done, the manager should be frozen
+ * (::user_manager_freeze), converting these into contiguous arrays, that are much more compact and
+ * faster to iterate through. Each user's arrays are also sorted by date, with the date of every
+ * entity stored next to its identifier, so that users' timelines can be listed without any lookups
+ * in other managers. The passengers of each flight are grouped the other way around, so that they
+ * can be listed too (::user_manager_get_passengers_by_flight). Aggregates over each user's
+ * associations (::user_manager_get_aggregates_by_index) are computed once, while freezing. Users'
+ * flights and reservations can only be read (::user_manager_get_flights_by_index,
+ * ::user_manager_get_reservations_by_index) from frozen managers. Modifying a frozen manager
+ * unfreezes it.
  *
  * If you'd rather not use a database, you could create the user manager yourself with
  * ::user_manager_create, add users to it using ::user_manager_add_user, and free it in the end
@@ -95,14 +113,110 @@
 #ifndef USER_MANAGER_H
 #define USER_MANAGER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "types/flight_id.h"
 #include "types/reservation_id.h"
 #include "types/user.h"
-#include "utils/single_pool_id_linked_list.h"
+#include "utils/bloom_filter.h"
+#include "utils/date_and_time.h"
+#include "utils/mapped_file.h"
+#include "utils/memory_report.h"
+#include "utils/thread_pool.h"
 
 /** @brief A data type that contains and manages all users in a database. */
 typedef struct user_manager user_manager_t;
 
+/**
+ * @struct user_manager_id_span_t
+ * @brief   Contiguous array of identifiers of the flights or reservations associated to a user.
+ * @details Sorted from the most recent to the oldest date, with ties broken by ascending
+ *          identifier.
+ *
+ * @var user_manager_id_span_t::ids
+ *     @brief Identifiers (::flight_id_t or ::reservation_id_t). May be `NULL` if
+ *            ::user_manager_id_span_t::length is `0`.
+ * @var user_manager_id_span_t::dates
+ *     @brief Date of each element in ::user_manager_id_span_t::ids (see
+ *            ::user_manager_date_callback_t). May be `NULL` if ::user_manager_id_span_t::length
+ *            is `0`.
+ * @var user_manager_id_span_t::length
+ *     @brief Number of elements in ::user_manager_id_span_t::ids.
+ */
+typedef struct {
+    const uint32_t        *ids;
+    const date_and_time_t *dates;
+    size_t                 length;
+} user_manager_id_span_t;
+
+/**
+ * @struct user_manager_index_span_t
+ * @brief  Contiguous array of user indices, in ascending order.
+ *
+ * @var user_manager_index_span_t::indices
+ *     @brief User indices (see ::user_manager_get_index_by_id). May be `NULL` if
+ *            ::user_manager_index_span_t::length is `0`.
+ * @var user_manager_index_span_t::length
+ *     @brief Number of elements in ::user_manager_index_span_t::indices.
+ */
+typedef struct {
+    const uint32_t *indices;
+    size_t          length;
+} user_manager_index_span_t;
+
+/**
+ * @brief   Callback type for getting the dates of the flights or reservations associated to users.
+ * @details Called by ::user_manager_freeze, to sort the entities associated to every user. Every
+ *          association of a relation is looked up in a single call, so that lookups can be batched
+ *          and prefetched.
+ *
+ * @param user_data Argument passed to ::user_manager_freeze.
+ * @param n         Number of identifiers in @p ids.
+ * @param ids       Identifiers of the flights or reservations.
+ * @param dates     Where to write the date of the entity with each identifier in @p ids to (the
+ *                  scheduled departure date of a flight, or the midnight of the begin date of a
+ *                  reservation).
+ */
+typedef void (*user_manager_date_callback_t)(void           *user_data,
+                                             size_t          n,
+                                             const uint32_t  ids[n],
+                                             date_and_time_t dates[n]);
+
+/**
+ * @brief   Callback type for getting the prices users paid for their reservations.
+ * @details Called by ::user_manager_freeze, to compute
+ *          ::user_manager_user_aggregates_t::total_spent_cents. Every reservation associated to a
+ *          user is looked up in a single call, so that lookups can be batched and prefetched.
+ *
+ * @param user_data Argument passed to ::user_manager_freeze.
+ * @param n         Number of identifiers in @p ids.
+ * @param ids       Identifiers of the reservations.
+ * @param prices    Where to write the price paid for each reservation in @p ids to, in cents.
+ */
+typedef void (*user_manager_price_callback_t)(void          *user_data,
+                                              size_t         n,
+                                              const uint32_t ids[n],
+                                              uint64_t       prices[n]);
+
+/**
+ * @struct user_manager_user_aggregates_t
+ * @brief  Summary of the flights and reservations associated to a user.
+ *
+ * @var user_manager_user_aggregates_t::number_of_flights
+ *     @brief Number of flights the user travelled in (passengers).
+ * @var user_manager_user_aggregates_t::number_of_reservations
+ *     @brief Number of reservations the user booked.
+ * @var user_manager_user_aggregates_t::total_spent_cents
+ *     @brief Sum of the prices of all reservations the user booked, in cents (see
+ *            ::reservation_calculate_price_cents).
+ */
+typedef struct {
+    size_t   number_of_flights;
+    size_t   number_of_reservations;
+    uint64_t total_spent_cents;
+} user_manager_user_aggregates_t;
+
 /**
  * @brief   Callback type for user manager iterations.
  * @details Method called by ::user_manager_iter for every item in a ::user_manager_t.
@@ -126,10 +240,9 @@ typedef int (*user_manager_iter_callback_t)(void *user_data, const user_t *user)
  *
  * @return `0` on success, or any other value to order iteration to stop.
  */
-typedef int (*user_manager_iter_with_flights_callback_t)(
-    void                               *user_data,
-    const user_t                       *user,
-    const single_pool_id_linked_list_t *flights);
+typedef int (*user_manager_iter_with_flights_callback_t)(void                  *user_data,
+                                                         const user_t          *user,
+                                                         user_manager_id_span_t flights);
 
 /**
  * @brief   Instantiates a new ::user_manager_t.
@@ -152,7 +265,8 @@ user_manager_t *user_manager_create(void);
 user_manager_t *user_manager_clone(const user_manager_t *manager);
 
 /**
- * @brief Adds a user to a user manager.
+ * @brief   Adds a user to a user manager.
+ * @details The index of the added user is the number of users in @p manager before this call.
  *
  * @param manager User manager to add @p user to.
  * @param user    User to be added to @p manager.
@@ -163,32 +277,232 @@ user_manager_t *user_manager_clone(const user_manager_t *manager);
 int user_manager_add_user(user_manager_t *manager, const user_t *user);
 
 /**
- * @brief Adds a user-flight relation (passenger) to a user manager.
+ * @brief   Prepares a user manager for a number of users to be added to it.
+ * @details This is only an optimization: it allocates the pool of users and the table of
+ *          identifiers once, instead of growing them repeatedly while the users are added.
  *
- * @param manager   User manager to add the passenger relation to.
- * @param user_id   Identifier of the user to add @p flight_id to.
- * @param flight_id Identifier of the flight to be associated with @p user_id.
+ * @param manager User manager to be modified.
+ * @param count   Total number of users expected in @p manager.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int user_manager_reserve(user_manager_t *manager, size_t count);
+
+/**
+ * @brief   Makes a user manager keep strings of users that are in a mapped file where they are,
+ *          instead of copying them.
+ * @details See ::string_pool_borrow. Clones of @p manager copy those strings.
+ *
+ * @param manager User manager to be modified.
+ * @param file    File where strings of users added to @p manager may be.
+ *
+ * @retval 0 Success.
+ * @retval 1 @p manager already borrows strings from a file.
+ */
+int user_manager_borrow_strings(user_manager_t *manager, mapped_file_t *file);
+
+/**
+ * @brief   Adds many users to a user manager at once.
+ * @details Equivalent to calling ::user_manager_add_user for each user, but @p manager is only
+ *          thawed and has its identifier indexes discarded once, and its pool of users is reserved
+ *          for all users (see ::user_manager_reserve). User indices are assigned in order.
+ *
+ * @param manager User manager to add @p users to.
+ * @param users   Users to be added to @p manager.
+ * @param n       Number of users in @p users.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (some of @p users may have been added).
+ */
+int user_manager_add_users(user_manager_t *manager, const user_t *const *users, size_t n);
+
+/**
+ * @brief   Adds a user-flight relation (passenger) to a user manager.
+ * @details Can be called concurrently with ::user_manager_add_user_reservation_association, as
+ *          long as no other thread is modifying @p manager and @p manager isn't frozen.
+ *
+ * @param manager    User manager to add the passenger relation to.
+ * @param user_index Index of the user to add @p flight_id to.
+ * @param flight_id  Identifier of the flight to be associated with @p user_index.
  *
  * @retval 0 Success.
  * @retval 1 User not found or allocation failure.
  */
 int user_manager_add_user_flight_association(user_manager_t *manager,
-                                             const char     *user_id,
+                                             uint32_t        user_index,
                                              flight_id_t     flight_id);
 /**
- * @brief Adds a user-reservation relation to a user manager.
+ * @brief   Prepares a user manager for a number of user-flight relations (passengers) to be added.
+ * @details Can be called concurrently with ::user_manager_add_user_reservation_association and
+ *          ::user_manager_reserve_reservation_associations, like
+ *          ::user_manager_add_user_flight_association.
+ *
+ * @param manager User manager to be modified.
+ * @param count   Total number of user-flight relations expected in @p manager.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int user_manager_reserve_flight_associations(user_manager_t *manager, size_t count);
+
+/**
+ * @brief   Adds a user-reservation relation to a user manager.
+ * @details Can be called concurrently with ::user_manager_add_user_flight_association, as long as
+ *          no other thread is modifying @p manager and @p manager isn't frozen.
  *
  * @param manager        User manager to add @p reservation_id to.
- * @param user_id        Identifier of the user to add @p reservation_id to.
- * @param reservation_id Identifier of the reservation to be associated with @p user_id.
+ * @param user_index     Index of the user to add @p reservation_id to.
+ * @param reservation_id Identifier of the reservation to be associated with @p user_index.
  *
  * @retval 0 Success.
  * @retval 1 User not found or allocation failure.
  */
 int user_manager_add_user_reservation_association(user_manager_t  *manager,
-                                                  const char      *user_id,
+                                                  uint32_t         user_index,
                                                   reservation_id_t reservation_id);
 
+/**
+ * @brief   Prepares a user manager for a number of user-reservation relations to be added.
+ * @details Can be called concurrently with ::user_manager_add_user_flight_association and
+ *          ::user_manager_reserve_flight_associations, like
+ *          ::user_manager_add_user_reservation_association.
+ *
+ * @param manager User manager to be modified.
+ * @param count   Total number of user-reservation relations expected in @p manager.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int user_manager_reserve_reservation_associations(user_manager_t *manager, size_t count);
+
+/**
+ * @brief   Releases memory the table of user identifiers reserved for users that were never added.
+ * @details Meant to be called once all users are added, as the table may have been reserved for an
+ *          overestimated number of users (see ::user_manager_reserve). A smaller table also means
+ *          fewer cache misses in ::user_manager_get_index_by_id.
+ *
+ * @param manager User manager whose table is to be shrunk.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (lookups still work, on the larger table).
+ */
+int user_manager_shrink_id_table(user_manager_t *manager);
+
+/**
+ * @brief   Starts staging associations, instead of adding them to their users right away.
+ * @details Once this is called, ::user_manager_add_user_flight_association and
+ *          ::user_manager_add_user_reservation_association only append the associations to a
+ *          buffer per relation. Those can still be called concurrently with each other.
+ *
+ *          Staged associations are added to their users by ::user_manager_commit_associations, in
+ *          parallel shards of users, with the same result as if they had been added one by one.
+ *          ::user_manager_freeze reads them straight from the buffers instead, without linking
+ *          them first.
+ *
+ * @param manager User manager to stage associations in. Unfrozen if frozen.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int user_manager_stage_associations(user_manager_t *manager);
+
+/**
+ * @brief   Adds all staged associations (see ::user_manager_stage_associations) to their users.
+ * @details Associations are no longer staged after this call. Nothing is done if they aren't being
+ *          staged. No other thread can be modifying @p manager during this call.
+ *
+ * @param manager User manager whose staged associations are added.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (associations of some relations may have been added).
+ */
+int user_manager_commit_associations(user_manager_t *manager);
+
+/**
+ * @brief   Converts the flights and reservations associated to users into contiguous arrays.
+ * @details Should be called once all associations have been added, as they can only be read from a
+ *          frozen manager. Adding users or associations to a frozen manager unfreezes it, which is
+ *          slow. Nothing is done if @p manager is already frozen. Staged associations (see
+ *          ::user_manager_stage_associations) are frozen along with linked ones, and discarded.
+ *
+ *          The flights and reservations of each user are sorted by date (see
+ *          ::user_manager_id_span_t), and their dates are stored alongside their identifiers.
+ *          Flight associations are also grouped by flight
+ *          (::user_manager_get_passengers_by_flight). The aggregates of every user
+ *          (::user_manager_get_aggregates_by_index) are also computed.
+ *
+ * @param manager           User manager to be frozen.
+ * @param flight_date       Method that gets the date of a flight.
+ * @param reservation_date  Method that gets the date of a reservation.
+ * @param reservation_price Method that gets the price of a reservation.
+ * @param user_data         Argument passed to @p flight_date, @p reservation_date and
+ *                          @p reservation_price.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p manager is left unfrozen).
+ */
+int user_manager_freeze(user_manager_t               *manager,
+                        user_manager_date_callback_t  flight_date,
+                        user_manager_date_callback_t  reservation_date,
+                        user_manager_price_callback_t reservation_price,
+                        void                         *user_data);
+
+/**
+ * @brief Gets the index of a user stored in a user manager by its identifier.
+ *
+ * @param manager User manager where to perform the lookup.
+ * @param id      Identifier of the user to find.
+ * @param index   Where to write the index of the user to. Not modified if it's not found.
+ *
+ * @retval 0 Success.
+ * @retval 1 User not found.
+ */
+int user_manager_get_index_by_id(const user_manager_t *manager, const char *id, uint32_t *index);
+
+/**
+ * @brief   Builds a Bloom filter of the identifiers of the users in a user manager.
+ * @details Used by ::user_manager_get_index_by_id_filtered. Adding users discards it, so it should
+ *          only be built once all users are added. Nothing is done if the filter already exists.
+ *
+ * @param manager User manager to build the filter for.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int user_manager_build_id_filter(user_manager_t *manager);
+
+/**
+ * @brief   Gets the index of a user stored in a user manager by its identifier, when it's likely
+ *          not to exist.
+ * @details Same as ::user_manager_get_index_by_id, but identifiers not in the manager are rejected
+ *          by the filter built by ::user_manager_build_id_filter (if any), without comparing any
+ *          strings. Lookups are counted in the filter's statistics, so this method is meant for
+ *          identifiers from outside the database (e.g.: queries).
+ *
+ * @param manager User manager where to perform the lookup.
+ * @param id      Identifier of the user to find.
+ * @param index   Where to write the index of the user to. Not modified if it's not found.
+ *
+ * @retval 0 Success.
+ * @retval 1 User not found.
+ */
+int user_manager_get_index_by_id_filtered(const user_manager_t *manager,
+                                          const char           *id,
+                                          uint32_t             *index);
+
+/**
+ * @brief Gets how the lookups in the identifier filter of a user manager were answered.
+ *
+ * @param manager    User manager to get the statistics from.
+ * @param statistics Where to write the statistics to.
+ *
+ * @retval 0 Success.
+ * @retval 1 @p manager has no filter (see ::user_manager_build_id_filter).
+ */
+int user_manager_get_id_filter_statistics(const user_manager_t      *manager,
+                                          bloom_filter_statistics_t *statistics);
+
 /**
  * @brief Gets a user stored in a user manager by its identifier.
  *
@@ -200,30 +514,89 @@ int user_manager_add_user_reservation_association(user_manager_t  *manager,
 const user_t *user_manager_get_by_id(const user_manager_t *manager, const char *id);
 
 /**
- * @brief Given a user identifier, gets the flights that user travelled in (passengers).
+ * @brief Gets a user stored in a user manager by its index.
  *
  * @param manager User manager where to perform the lookup.
- * @param id      Identifier of the user to find.
+ * @param index   Index of the user to find.
  *
- * @return A linked list of flight identifiers if the user was found, `NULL` if it was not.
- *         To distinguish between an empty list and a lookup failure, call ::user_manager_get_by_id
- *         and check its return value.
+ * @return A pointer to a ::user_t if it's found, `NULL` if @p index is out of range.
  */
-const single_pool_id_linked_list_t *user_manager_get_flights_by_id(const user_manager_t *manager,
-                                                                   const char           *id);
+const user_t *user_manager_get_by_index(const user_manager_t *manager, uint32_t index);
 
 /**
- * @brief Given a user identifier, gets the bookings that user booked.
+ * @brief   Checks if the user with a given index has an active account.
+ * @details A single bit test, that doesn't access the user itself.
  *
  * @param manager User manager where to perform the lookup.
- * @param id      Identifier of the user to find.
+ * @param index   Index of the user.
  *
- * @return A linked list of reservation IDs if the user was found, `NULL` if it was not.
- *         To distinguish between an empty list and a lookup failure, call ::user_manager_get_by_id
- *         and check its return value.
+ * @return Whether the user's account status is ::ACCOUNT_STATUS_ACTIVE (`0` if @p index is out of
+ *         range).
+ */
+int user_manager_is_active_by_index(const user_manager_t *manager, uint32_t index);
+
+/**
+ * @brief  Counts the users with active accounts in a user manager.
+ * @param  manager User manager to count active users in.
+ * @return The number of users whose account status is ::ACCOUNT_STATUS_ACTIVE.
  */
-const single_pool_id_linked_list_t *
-    user_manager_get_reservations_by_id(const user_manager_t *manager, const char *id);
+size_t user_manager_get_active_count(const user_manager_t *manager);
+
+/**
+ * @brief Given a user index, gets the flights that user travelled in (passengers).
+ *
+ * @param manager User manager where to perform the lookup. Must be frozen
+ *                (see ::user_manager_freeze).
+ * @param index   Index of the user to find.
+ *
+ * @return The flight identifiers of the user, sorted by date (see ::user_manager_id_span_t). The
+ *         span is empty if the user wasn't found or @p manager isn't frozen. It's valid until
+ *         @p manager is modified.
+ */
+user_manager_id_span_t user_manager_get_flights_by_index(const user_manager_t *manager,
+                                                         uint32_t              index);
+
+/**
+ * @brief Given a user index, gets the bookings that user booked.
+ *
+ * @param manager User manager where to perform the lookup. Must be frozen
+ *                (see ::user_manager_freeze).
+ * @param index   Index of the user to find.
+ *
+ * @return The reservation identifiers of the user, sorted by date (see ::user_manager_id_span_t).
+ *         The span is empty if the user wasn't found or @p manager isn't frozen. It's valid until
+ *         @p manager is modified.
+ */
+user_manager_id_span_t user_manager_get_reservations_by_index(const user_manager_t *manager,
+                                                              uint32_t              index);
+
+/**
+ * @brief Given a flight identifier, gets the users that travelled in that flight (passengers).
+ *
+ * @param manager User manager where to perform the lookup. Must be frozen
+ *                (see ::user_manager_freeze).
+ * @param id      Identifier of the flight.
+ *
+ * @return The indices of the passengers of the flight, in ascending order. The span is empty if
+ *         the flight has no passengers or @p manager isn't frozen. It's valid until @p manager is
+ *         modified.
+ */
+user_manager_index_span_t user_manager_get_passengers_by_flight(const user_manager_t *manager,
+                                                                flight_id_t           id);
+
+/**
+ * @brief   Given a user index, gets a summary of the flights and reservations of that user.
+ * @details This is a constant-time operation, as aggregates are computed by ::user_manager_freeze.
+ *
+ * @param manager User manager where to perform the lookup. Must be frozen
+ *                (see ::user_manager_freeze).
+ * @param index   Index of the user to find.
+ *
+ * @return The aggregates of the user. All of them are `0` if the user wasn't found or @p manager
+ *         isn't frozen.
+ */
+user_manager_user_aggregates_t user_manager_get_aggregates_by_index(const user_manager_t *manager,
+                                                                    uint32_t              index);
 
 /**
  * @brief Iterates through every user in a user manager, calling a callback for each one.
@@ -243,10 +616,28 @@ int user_manager_iter(const user_manager_t        *manager,
                       user_manager_iter_callback_t callback,
                       void                        *user_data);
 
+/**
+ * @brief   Iterates through every user with an active account in a user manager.
+ * @details Users are visited in index order. Inactive users are skipped with the bitmap of active
+ *          users, without being accessed.
+ *
+ * @param manager   User manager to iterate thorugh.
+ * @param callback  Method to be called for every active user stored in @p manager.
+ * @param user_data Pointer to be passed to every @p callback, so that it can modify the program's
+ *                  state.
+ *
+ * @return The return value of the last-called @p callback (`0` means success, another value means
+ *         the iteration was stopped by a callback).
+ */
+int user_manager_iter_active(const user_manager_t        *manager,
+                             user_manager_iter_callback_t callback,
+                             void                        *user_data);
+
 /**
  * @brief   Iterates through every user in a user manager, calling a callback for each one.
  * @details Flights related to every user (passengers) are also provided to callbacks, unlike in
- *          ::user_manager_iter.
+ *          ::user_manager_iter. Users are iterated in index order. @p manager must be frozen
+ *          (see ::user_manager_freeze), or else all users will seem to have no flights.
  *
  * @param manager   User manager to iterate thorugh.
  * @param callback  Method to be called for every user stored in @p manager.
@@ -260,6 +651,77 @@ int user_manager_iter_with_flights(const user_manager_t                     *man
                                    user_manager_iter_with_flights_callback_t callback,
                                    void                                     *user_data);
 
+/**
+ * @brief   Iterates through every user in a user manager, in parallel.
+ * @details Users are split into ranges of indices (one per thread in @p pool), and each range gets
+ *          its own accumulator (see ::thread_pool_parallel_reduce). Accumulators are merged in the
+ *          calling thread, in the order of their ranges.
+ *
+ * @param manager   User manager to iterate through.
+ * @param pool      Thread pool to iterate in. `NULL` to iterate in the calling thread.
+ * @param init      Method called to create the accumulator of each range.
+ * @param callback  Method to be called for every user stored in @p manager. Its `user_data` is the
+ *                  accumulator of the range the user is in.
+ * @param merge     Method called for every accumulator, after the iteration.
+ * @param user_data Argument passed to @p init and @p merge.
+ *
+ * @return `0` on success. Any other value means an allocation failure, or that the iteration was
+ *         stopped by a callback (the return value of the first callback that did so).
+ */
+int user_manager_parallel_iter(const user_manager_t               *manager,
+                               thread_pool_t                      *pool,
+                               thread_pool_reduce_init_callback_t  init,
+                               user_manager_iter_callback_t        callback,
+                               thread_pool_reduce_merge_callback_t merge,
+                               void                               *user_data);
+
+/**
+ * @brief   Iterates through every user in a user manager and their flights, in parallel.
+ * @details Like ::user_manager_parallel_iter, but flights are provided to callbacks, like in
+ *          ::user_manager_iter_with_flights. @p manager must be frozen.
+ *
+ * @param manager   User manager to iterate through.
+ * @param pool      Thread pool to iterate in. `NULL` to iterate in the calling thread.
+ * @param init      Method called to create the accumulator of each range.
+ * @param callback  Method to be called for every user stored in @p manager. Its `user_data` is the
+ *                  accumulator of the range the user is in.
+ * @param merge     Method called for every accumulator, after the iteration.
+ * @param user_data Argument passed to @p init and @p merge.
+ *
+ * @return `0` on success. Any other value means an allocation failure, or that the iteration was
+ *         stopped by a callback (the return value of the first callback that did so).
+ */
+int user_manager_parallel_iter_with_flights(const user_manager_t                     *manager,
+                                            thread_pool_t                            *pool,
+                                            thread_pool_reduce_init_callback_t        init,
+                                            user_manager_iter_with_flights_callback_t callback,
+                                            thread_pool_reduce_merge_callback_t       merge,
+                                            void                                     *user_data);
+
+/**
+ * @brief   Releases memory a user manager reserved for users that were never added.
+ * @details Meant to be called once all users have been added (see ::database_freeze). The pools of
+ *          users and of their strings are trimmed (see ::pool_trim), without moving any user.
+ *          Associations are already compacted by ::user_manager_freeze. On NUMA machines, the
+ *          table of user identifiers is replicated on every node (see ::string_table_replicate).
+ *
+ * @param manager User manager to be compacted.
+ */
+void user_manager_compact(user_manager_t *manager);
+
+/**
+ * @brief   Adds the memory used by the data structures of a user manager to a memory report.
+ * @details Every pool, string pool and index in @p manager is added as a separate entry.
+ *
+ * @param manager User manager to get the memory usage from.
+ * @param report  Report to add entries to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int user_manager_add_to_memory_report(const user_manager_t *manager,
+                                      memory_report_t      *report);
+
 /**
  * @brief Frees memory used by a user manager.
  * @param manager User manager whose memory is to be `free`d.
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    dataset_delta_log.h
+ * @brief   Append-only log of the deltas loaded on top of the
+ *          [snapshot](@ref dataset_snapshot.h) of a dataset.
+ * @details Storing a whole snapshot after every delta (see ::dataset_loader_load_delta) costs as
+ *          much as the whole database. Instead, the files of each delta are appended, as a
+ *          segment, to a log next to the snapshot (::DATASET_DELTA_LOG_FILE_NAME). When the
+ *          dataset is loaded from its snapshot, the deltas in the log are replayed on top of it,
+ *          so that the database also contains their users, flights, passengers and reservations
+ *          (and the invalidations they cause, as replaying a delta parses it again).
+ *
+ *          Each segment starts with a header containing the identifier of the snapshot it applies
+ *          to (see ::dataset_snapshot_get_identity), the lengths of the delta's files, and a
+ *          checksum of their contents. Segments of another snapshot (e.g.: after the dataset
+ *          changed and its snapshot was rebuilt) are stale, and discarded by the next append. A
+ *          segment that was only partially written (or is corrupted) ends the log.
+ *
+ *          Replaying many deltas becomes slower than restoring a snapshot containing them, so the
+ *          log is compacted (see ::dataset_delta_log_compact): the replayed database is stored as
+ *          the new snapshot, and the log is left with only the deltas appended meanwhile. Appends
+ *          and compactions of the same log lock it (with `fcntl`), so that they can happen in
+ *          different processes.
+ *
+ * @anchor dataset_delta_log_examples
+ * ### Example
+ *
+ * See the source code of ::dataset_loader_load and ::dataset_loader_append_delta.
+ */
+
+#ifndef DATASET_DELTA_LOG_H
+#define DATASET_DELTA_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "database/database.h"
+
+/** @brief Name of the delta log file, inside a dataset's directory. */
+#define DATASET_DELTA_LOG_FILE_NAME ".database.deltas"
+
+/**
+ * @struct dataset_delta_log_info_t
+ * @brief  What was replayed from a delta log by ::dataset_delta_log_replay.
+ *
+ * @var dataset_delta_log_info_t::base_identifier
+ *     @brief Identifier of the snapshot the replayed segments apply to.
+ * @var dataset_delta_log_info_t::segments
+ *     @brief Number of replayed segments (deltas).
+ * @var dataset_delta_log_info_t::length
+ *     @brief Number of bytes of the log taken by the replayed segments.
+ */
+typedef struct {
+    uint64_t base_identifier;
+    size_t   segments;
+    uint64_t length;
+} dataset_delta_log_info_t;
+
+/**
+ * @brief Callback called for every delta replayed from a log.
+ *
+ * @param user_data Argument passed to ::dataset_delta_log_replay.
+ * @param contents  Contents of the delta's `users.csv`, `flights.csv`, `passengers.csv` and
+ *                  `reservations.csv`, in that order.
+ * @param lengths   Number of bytes in each element of @p contents.
+ *
+ * @return `0` on success, other value to stop replaying the log and fail.
+ */
+typedef int (*dataset_delta_log_callback_t)(void             *user_data,
+                                            const char *const contents[4],
+                                            const size_t      lengths[4]);
+
+/**
+ * @brief   Appends a delta to the log of a dataset.
+ * @details The segment applies to the dataset's current snapshot. Stale segments are removed
+ *          first.
+ *
+ * @param dataset_path Path to the directory containing the dataset (and its snapshot).
+ * @param delta_path   Path to the directory containing the delta. Its files can't be compressed.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (IO or allocation), or the dataset has no usable snapshot.
+ */
+int dataset_delta_log_append(const char *dataset_path, const char *delta_path);
+
+/**
+ * @brief   Replays the deltas in the log of a dataset.
+ * @details Only segments that apply to @p base_identifier are replayed. Replaying a log that
+ *          doesn't exist succeeds without calling @p callback.
+ *
+ * @param dataset_path    Path to the directory containing the dataset.
+ * @param base_identifier Identifier of the snapshot the database was restored from (see
+ *                        ::dataset_snapshot_load).
+ * @param callback        Method called for every delta, in the order they were appended.
+ * @param user_data       Argument passed to @p callback.
+ * @param out_info        Where to write what was replayed to (even on failure).
+ *
+ * @retval 0 Success.
+ * @retval 1 IO or allocation failure, or @p callback failed.
+ */
+int dataset_delta_log_replay(const char                  *dataset_path,
+                             uint64_t                     base_identifier,
+                             dataset_delta_log_callback_t callback,
+                             void                        *user_data,
+                             dataset_delta_log_info_t    *out_info);
+
+/**
+ * @brief   Checks if replaying a delta log has become expensive enough for it to be compacted.
+ * @details That's the case when many deltas were replayed, or when their size is large compared
+ *          to the size of the snapshot.
+ *
+ * @param dataset_path Path to the directory containing the dataset.
+ * @param info         What was replayed from the log (see ::dataset_delta_log_replay).
+ *
+ * @return Whether the log should be compacted.
+ */
+int dataset_delta_log_needs_compaction(const char                     *dataset_path,
+                                       const dataset_delta_log_info_t *info);
+
+/**
+ * @brief   Compacts the log of a dataset, storing a database with its deltas as the new snapshot.
+ * @details Segments appended after @p info was replayed aren't in @p database, so they're kept,
+ *          and now apply to the new snapshot. Nothing is done if the snapshot was replaced since
+ *          @p info was replayed (e.g.: another process already compacted the log).
+ *
+ * @param database     Database restored from the snapshot, with the deltas in @p info replayed.
+ *                     Must be frozen (see ::database_is_frozen).
+ * @param dataset_path Path to the directory containing the dataset.
+ * @param errors_path  Path to the directory containing the error files output while restoring
+ *                     and replaying the deltas (already closed). See ::dataset_snapshot_save.
+ * @param info         What was replayed from the log (see ::dataset_delta_log_replay).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (IO or allocation). The log is left as it was, unless the new snapshot was
+ *           already stored (then, only deltas appended after @p info was replayed are lost).
+ */
+int dataset_delta_log_compact(const database_t               *database,
+                              const char                     *dataset_path,
+                              const char                     *errors_path,
+                              const dataset_delta_log_info_t *info);
+
+#endif
@@ -31,15 +31,20 @@
 #ifndef DATASET_ERROR_OUTPUT_H
 #define DATASET_ERROR_OUTPUT_H
 
+#include "dataset/dataset_progress.h"
+
 /** @brief Collection of file handles for all dataset error files. */
 typedef struct dataset_error_output dataset_error_output_t;
 
 /**
- * @brief Attempts to open all file handles for dataset error files.
+ * @brief   Attempts to open all file handles for dataset error files.
+ * @details Reported errors are kept in a large buffer for each file, and only written when that
+ *          buffer fills up or in ::dataset_error_output_free.
  *
- * @param path Path to the directory where to create the error files. If that directory does not
- *             exist, it'll be created aswell (but not its parents). Provide `NULL` for no error
- *             output.
+ * @param path     Path to the directory where to create the error files. If that directory does
+ *                 not exist, it'll be created aswell (but not its parents). Provide `NULL` for no
+ *                 error output, where errors are only counted in @p progress.
+ * @param progress Where to count reported errors as rejected lines. Can be `NULL`.
  *
  * @return A collection of file handles that must be `free`d with ::dataset_error_output_free, or
  *         `NULL` on IO error.
@@ -47,7 +52,8 @@ typedef struct dataset_error_output dataset_error_output_t;
  * #### Example
  * See [the header file's documentation](@ref dataset_error_output_examples).
  */
-dataset_error_output_t *dataset_error_output_create(const char *path);
+dataset_error_output_t *dataset_error_output_create(const char         *path,
+                                                    dataset_progress_t *progress);
 
 /**
  * @brief Writes a line to the `users_errors.csv` file.
@@ -81,7 +87,7 @@ void dataset_error_output_report_reservation_error(dataset_error_output_t *outpu
                                                    const char             *error_line);
 
 /**
- * @brief Closes all file handles in @p input and `free`s the data structure.
+ * @brief Writes pending errors, closes all file handles in @p input and `free`s the data structure.
  * @param input Value to be deleted, allocated by ::dataset_error_output_create.
  *
  * #### Example
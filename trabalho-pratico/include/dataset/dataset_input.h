@@ -38,6 +38,21 @@
  * @anchor dataset_input_examples
  * ### Example
  *
+ * @anchor dataset_input_multiplexed
+ * ### Multiplexed datasets
+ *
+ * Instead of a directory, a dataset can be read from `stdin` (see
+ * ::DATASET_INPUT_MULTIPLEXED_PATH), with all its files concatenated in the same stream. Each file
+ * starts with a section marker `==> <file> <==`, like in the output of:
+ *
+ * ```
+ * tail -n +1 users.csv flights.csv passengers.csv reservations.csv
+ * ```
+ *
+ * Directories before the file name are ignored, and so is an empty line right before a marker.
+ * Sections must be in the order above, as files are loaded in that order and the stream can't be
+ * rewound. Missing sections are loaded as empty files.
+ *
  * In order to load a dataset, this module should be used in conjunction with
  * [dataset_error_output](@ref dataset_error_output.h). See the source code of ::dataset_loader_load
  * for a good example on how to use both of these modules.
@@ -48,13 +63,36 @@
 
 #include "database/database.h"
 #include "dataset/dataset_error_output.h"
+#include "dataset/dataset_progress.h"
+#include "testing/performance_metrics.h"
+#include "utils/stream_utils.h"
+
+/** @brief Dataset path for reading a multiplexed dataset from `stdin` (::dataset_input_create). */
+#define DATASET_INPUT_MULTIPLEXED_PATH "-"
 
 /** @brief Collection of file handles for all dataset input files. */
 typedef struct dataset_input dataset_input_t;
 
 /**
- * @brief  Attempts to open all file handles for dataset input files.
- * @param  path Path to the directory containing the files.
+ * @brief   Attempts to open all file handles for dataset input files.
+ * @details When a file (e.g.: `users.csv`) doesn't exist, a compressed version of it
+ *          (`users.csv.gz` or `users.csv.zst`) is looked for. Those are decompressed by a `gzip` or
+ *          `zstd` process running alongside the parser, that the parser reads from through a pipe.
+ *          Files can also be named pipes (FIFOs), opened in the order users, flights, passengers
+ *          and reservations. Each open blocks until the FIFO has a writer, and passengers and
+ *          reservations are only read after users and flights are fully loaded, so every FIFO
+ *          needs its own writer (e.g.: one process per file).
+ *
+ *          If @p path is ::DATASET_INPUT_MULTIPLEXED_PATH, all files are read from `stdin`, split
+ *          by a thread into a pipe for each file (see
+ *          [the header file's documentation](@ref dataset_input_multiplexed)).
+ *
+ *          Streamed files (compressed, FIFOs or multiplexed) can't be split into chunks for
+ *          parallel parsing, and their sizes aren't known beforehand, so the database isn't sized
+ *          for them. If `flights.csv` is streamed, copies of the lines of valid flights are kept
+ *          in memory, so that flights invalidated while loading passengers can be reported.
+ *
+ * @param  path Path to the directory containing the files, or ::DATASET_INPUT_MULTIPLEXED_PATH.
  * @return A collection of file handles that must be `free`'d with ::dataset_input_free, or `NULL`
  *         on IO / allocation error.
  *
@@ -64,75 +102,178 @@ typedef struct dataset_input dataset_input_t;
 dataset_input_t *dataset_input_create(const char *path);
 
 /**
- * @brief Loads all the users in a dataset into a @p database.
+ * @brief   Creates dataset input from the contents of its files, already in memory.
+ * @details Used to replay the deltas stored in a [delta log](@ref dataset_delta_log.h). The
+ *          contents are copied to temporary files, so that they're parsed like any other dataset.
+ *
+ * @param contents Contents of `users.csv`, `flights.csv`, `passengers.csv` and
+ *                 `reservations.csv`, in that order.
+ * @param lengths  Number of bytes in each element of @p contents.
+ *
+ * @return A collection of file handles that must be `free`'d with ::dataset_input_free, or `NULL`
+ *         on IO / allocation error.
+ */
+dataset_input_t *dataset_input_create_from_buffers(const char *const contents[4],
+                                                   const size_t      lengths[4]);
+
+/**
+ * @brief   Checks if any file in a dataset can only be read once, as it isn't a regular file.
+ * @details True for compressed files, FIFOs and multiplexed datasets. The contents of these can't
+ *          be fingerprinted, so database snapshots (see
+ *          [dataset_snapshot](@ref dataset_snapshot.h)) can't be used for them.
+ *
+ * @param  input Collection of file handles for dataset input.
+ * @return Whether any file in @p input is streamed.
+ */
+int dataset_input_is_streamed(const dataset_input_t *input);
+
+/**
+ * @brief Determines how a file in a dataset is going to be read (see ::stream_tokenize_get_method).
+ *
+ * @param input Collection of file handles for dataset input.
+ * @param step  Step of dataset loading where the file is read (`users.csv` for
+ *              ::PERFORMANCE_METRICS_DATASET_STEP_USERS, for example). Musn't be
+ *              ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *              ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ *
+ * @return The method that will be used to read the file.
+ */
+stream_tokenize_method_t dataset_input_get_method(const dataset_input_t             *input,
+                                                  performance_metrics_dataset_step_t step);
+
+/**
+ * @brief   Gets the estimated number of lines in a file of a dataset.
+ * @details Estimated once, when @p input is created (see ::dataset_parser_estimate_line_count).
+ *          The loading methods use these estimates to size the database up front.
+ *
+ * @param input Collection of file handles for dataset input.
+ * @param step  Step of dataset loading where the file is read (see ::dataset_input_get_method).
+ *
+ * @return The estimated number of lines in the file, or `0` if it couldn't be estimated.
+ */
+size_t dataset_input_get_estimated_lines(const dataset_input_t             *input,
+                                         performance_metrics_dataset_step_t step);
+
+/**
+ * @brief   Loads all the users in a dataset into a @p database.
+ * @details Can only be called once. The users file is closed afterwards.
  *
  * @param input    Collection of file handles for dataset input.
  * @param output   Collection of file handles for dataset error output.
  * @param database Database to load the new users into.
+ * @param progress Where to register loading progress to. Can be `NULL`.
  *
  * @retval 0 Success.
- * @retval 1 Failure.
+ * @retval 1 Failure (or cancellation through @p progress).
  *
  * #### Example
  * See [the header file's documentation](@ref dataset_input_examples).
  */
 int dataset_input_load_users(dataset_input_t        *input,
                              dataset_error_output_t *output,
-                             database_t             *database);
+                             database_t             *database,
+                             dataset_progress_t     *progress);
 
 /**
- * @brief Loads all the flights in a dataset into a @p database.
+ * @brief   Loads all the flights in a dataset into a @p database.
+ * @details Can only be called once. The flights file stays open, as lines of flights invalidated
+ *          by passengers are read from it (see ::dataset_input_load_passengers).
  *
  * @param input    Collection of file handles for dataset input.
  * @param output   Collection of file handles for dataset error output.
  * @param database Database to load the new flights into.
+ * @param progress Where to register loading progress to. Can be `NULL`.
  *
  * @retval 0 Success.
- * @retval 1 Failure.
+ * @retval 1 Failure (or cancellation through @p progress).
  *
  * #### Example
  * See [the header file's documentation](@ref dataset_input_examples).
  */
 int dataset_input_load_flights(dataset_input_t        *input,
                                dataset_error_output_t *output,
-                               database_t             *database);
+                               database_t             *database,
+                               dataset_progress_t     *progress);
 
 /**
- * @brief Loads all the user-flight relationships (passengers) in a dataset into a @p database.
+ * @brief   Loads all the user-flight relationships (passengers) in a dataset into a @p database.
+ * @details Can only be called once, after ::dataset_input_load_flights. The passengers and flights
+ *          files are closed afterwards, and the positions of the lines of flights are freed.
  *
  * @param input    Collection of file handles for dataset input.
  * @param output   Collection of file handles for dataset error output.
  * @param database Database to load the new passengers into.
+ * @param progress Where to register loading progress to. Can be `NULL`.
  *
  * @retval 0 Success.
- * @retval 1 Failure.
+ * @retval 1 Failure (or cancellation through @p progress).
  *
  * #### Example
  * See [the header file's documentation](@ref dataset_input_examples).
  */
 int dataset_input_load_passengers(dataset_input_t        *input,
                                   dataset_error_output_t *output,
-                                  database_t             *database);
+                                  database_t             *database,
+                                  dataset_progress_t     *progress);
 
 /**
- * @brief Loads all the reservations in a dataset into a @p database.
+ * @brief   Loads all the reservations in a dataset into a @p database.
+ * @details Can only be called once. The reservations file is closed afterwards.
  *
  * @param input    Collection of file handles for dataset input.
  * @param output   Collection of file handles for dataset error output.
  * @param database Database to load the new reservations into.
+ * @param progress Where to register loading progress to. Can be `NULL`.
  *
  * @retval 0 Success.
- * @retval 1 Failure.
+ * @retval 1 Failure (or cancellation through @p progress).
  *
  * #### Example
  * See [the header file's documentation](@ref dataset_input_examples).
  */
 int dataset_input_load_reservations(dataset_input_t        *input,
                                     dataset_error_output_t *output,
-                                    database_t             *database);
+                                    database_t             *database,
+                                    dataset_progress_t     *progress);
+
+/** @brief What ::dataset_input_set_page_cache does to the files of a dataset. */
+typedef enum {
+    DATASET_INPUT_PAGE_CACHE_EVICT, /**< Remove the files from the page cache. */
+    DATASET_INPUT_PAGE_CACHE_WARM   /**< Read the files, so that they're in the page cache. */
+} dataset_input_page_cache_t;
+
+/**
+ * @brief   Evicts the files of a dataset from the page cache, or loads them into it.
+ * @details Meant for benchmarking: loading a dataset whose files were evicted measures reading them
+ *          from storage (cold cache), while loading it after it's warmed up only measures parsing
+ *          (warm cache). All files that may be read when loading the dataset are affected,
+ *          compressed ones and the database snapshot (if snapshots are on) included. Eviction is
+ *          only a hint to the kernel, and it won't evict pages that are dirty or mapped by other
+ *          processes.
+ *
+ * @param path   Path to the directory containing the dataset.
+ * @param action What to do to the files.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure to open, read, or advise the kernel on one of the files (`errno` is set).
+ */
+int dataset_input_set_page_cache(const char *path, dataset_input_page_cache_t action);
+
+/**
+ * @brief   Waits for a multiplexed dataset stream to be read to its end.
+ * @details Must be called after all files are loaded, as the stream is only checked for errors
+ *          (such as malformed or out-of-order sections) while it's read. Errors are reported to
+ *          `stderr`.
+ *
+ * @param input Collection of file handles for dataset input.
+ *
+ * @retval 0 Success, or @p input isn't multiplexed (see ::DATASET_INPUT_MULTIPLEXED_PATH).
+ * @retval 1 The multiplexed stream was malformed, or reading it failed.
+ */
+int dataset_input_wait(dataset_input_t *input);
 
 /**
- * @brief Closes all file handles in @p input and `free`s the data structure.
+ * @brief Closes all file handles still open in @p input and `free`s the data structure.
  * @param input Value to be deleted, allocated by ::dataset_input_create.
  *
  * #### Example
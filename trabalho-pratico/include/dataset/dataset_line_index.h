@@ -0,0 +1,132 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    dataset_line_index.h
+ * @brief   Index of where lines of a dataset file are, by identifier.
+ * @details Used to print lines of a file that was already parsed (e.g.: flights invalidated while
+ *          loading passengers), without having to look for them in the whole file again. Files that
+ *          can't be read again (e.g.: pipes) need an index that keeps a copy of every line (see
+ *          ::dataset_line_index_create_in_memory).
+ *
+ * @anchor dataset_line_index_examples
+ * ### Example
+ *
+ * ```c
+ * dataset_line_index_t *index = dataset_line_index_create();
+ * dataset_line_index_add(index, 1, 0, "line 1", 6); // At the beginning of the file
+ * dataset_line_index_add(index, 2, 7, "line 2", 6); // After the first line
+ *
+ * char *line = dataset_line_index_read_line(index, file, 2);
+ * if (line)
+ *     puts(line); // "line 2"
+ *
+ * free(line);
+ * dataset_line_index_free(index);
+ * ```
+ */
+
+#ifndef DATASET_LINE_INDEX_H
+#define DATASET_LINE_INDEX_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/** @brief Map from identifiers to the positions of lines in a file. */
+typedef struct dataset_line_index dataset_line_index_t;
+
+/**
+ * @brief   Creates a new empty ::dataset_line_index_t.
+ * @details The returned value is owned by the caller, and should be freed with
+ *          ::dataset_line_index_free.
+ *
+ * @return A new ::dataset_line_index_t, or `NULL` on allocation failure.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref dataset_line_index_examples).
+ */
+dataset_line_index_t *dataset_line_index_create(void);
+
+/**
+ * @brief   Creates a new empty ::dataset_line_index_t that keeps a copy of every line added to it.
+ * @details For files that can't be read again, such as pipes. The memory used grows with the
+ *          length of the lines, instead of only with their number.
+ *
+ * @return A new ::dataset_line_index_t, that must be freed with ::dataset_line_index_free, or
+ *         `NULL` on allocation failure.
+ */
+dataset_line_index_t *dataset_line_index_create_in_memory(void);
+
+/**
+ * @brief Prepares @p index for a number of lines to be added to it.
+ *
+ * @param index Index to be grown.
+ * @param count Total number of lines expected in @p index.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int dataset_line_index_reserve(dataset_line_index_t *index, size_t count);
+
+/**
+ * @brief Registers where the line of an identifier is, replacing any previous position.
+ *
+ * @param index  Index to add the line to.
+ * @param id     Identifier of the entity in the line.
+ * @param offset Offset of the first character of the line in the file.
+ * @param line   Contents of the line, only copied by indexes created with
+ *               ::dataset_line_index_create_in_memory.
+ * @param length Length of the line, not including its delimiter.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref dataset_line_index_examples).
+ */
+int dataset_line_index_add(dataset_line_index_t *index,
+                           uint32_t              id,
+                           uint64_t              offset,
+                           const char           *line,
+                           size_t                length);
+
+/**
+ * @brief   Reads the line of an identifier from a file.
+ * @details @p file's position isn't changed, so this can be called while it's being read.
+ *
+ * @param index Index where the position of the line was registered.
+ * @param file  File the positions in @p index refer to. Not used (and can be `NULL`) by indexes
+ *              created with ::dataset_line_index_create_in_memory.
+ * @param id    Identifier of the entity whose line is wanted.
+ *
+ * @return A null-terminated copy of the line, that must be `free`d, or `NULL` if @p id isn't in
+ *         @p index or on IO / allocation failure.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref dataset_line_index_examples).
+ */
+char *dataset_line_index_read_line(const dataset_line_index_t *index, FILE *file, uint32_t id);
+
+/**
+ * @brief Frees memory used by a ::dataset_line_index_t.
+ * @param index Index to be freed.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref dataset_line_index_examples).
+ */
+void dataset_line_index_free(dataset_line_index_t *index);
+
+#endif
@@ -25,6 +25,8 @@
  *          - `passengers.csv`;
  *          - `reservations.csv`.
  *
+ *          Each of those files may also be compressed (see ::dataset_input_create).
+ *
  * @anchor dataset_loader_examples
  * ### Example
  *
@@ -35,20 +37,43 @@
 #define DATASET_LOADER_H
 
 #include "database/database.h"
+#include "dataset/dataset_progress.h"
 #include "testing/performance_metrics.h"
 
 /**
- * @brief Parses a dataset in @p dataset_path and stores the data in @p database.
+ * @brief   Parses a dataset in @p dataset_path and stores the data in @p database.
+ * @details Independent files are loaded in parallel: `users.csv` alongside `flights.csv`, and
+ *          then `passengers.csv` alongside `reservations.csv`. Each error file is only written to
+ *          by one thread at a time, so its contents are the same as if the dataset was loaded
+ *          sequentially.
+ *
+ *          When snapshots are on (see ::DATASET_SNAPSHOT_DIRECTORY_ENVIRONMENT_VARIABLE), a
+ *          [snapshot](@ref dataset_snapshot.h) of @p database is stored after a successful load,
+ *          and later loads of the same (unmodified) dataset restore
+ *          @p database from that snapshot instead of parsing the dataset again, replaying the
+ *          deltas appended to it since (see ::dataset_loader_append_delta). Snapshots aren't
+ *          used for datasets with streamed files (see ::dataset_input_is_streamed), such as
+ *          multiplexed datasets read from `stdin`.
+ *
+ *          Optional data left out of @p database with ::database_set_data (e.g.: because none of
+ *          the queries to be run need it) isn't stored while loading, nor while restoring a
+ *          snapshot. Dataset errors are the same regardless, but no snapshot is stored, as it
+ *          would be missing that data.
  *
  * @param database     Database where to store the dataset data in.
- * @param dataset_path Path to the directory containing the dataset.
+ * @param dataset_path Path to the directory containing the dataset, or
+ *                     ::DATASET_INPUT_MULTIPLEXED_PATH to read it from `stdin`.
  * @param errors_path  Path to the directory where to output error files to.
  * @param metrics      Where to register program performance data to. Can be `NULL` for no
  *                     profiling.
+ * @param progress     Where to register loading progress to, so that it can be observed from
+ *                     other threads. Can be `NULL`. If it gets cancelled (see
+ *                     ::dataset_progress_cancel), loading stops as soon as possible and fails.
  *
  * @retval 0 Success.
- * @retval 1 Fatal failure (IO or allocation). Errors in the dataset won't cause this method to
- *           fail, and will just be reported to files in @p errors_path.
+ * @retval 1 Fatal failure (IO or allocation) or cancellation. Errors in the dataset won't cause
+ *           this method to fail, and will just be reported to files in @p errors_path. On failure,
+ *           @p database may be partially filled, and should be freed.
  *
  * #### Example
  * See [the header file's documentation](@ref dataset_loader_examples).
@@ -56,6 +81,91 @@
 int dataset_loader_load(database_t            *database,
                         const char            *dataset_path,
                         const char            *errors_path,
-                        performance_metrics_t *metrics);
+                        performance_metrics_t *metrics,
+                        dataset_progress_t    *progress);
+
+/**
+ * @brief   Parses a dataset with new entities in @p delta_path, and adds them to @p database.
+ * @details @p delta_path must contain the same four files as a full dataset (some of them may
+ *          only have a header). Its users, flights, reservations and passengers are appended to
+ *          the ones already in @p database, and can refer to them (e.g.: a reservation of a user
+ *          that was loaded before).
+ *
+ *          Parsing only costs as much as the size of the delta, but @p database is frozen again
+ *          afterwards (see ::database_freeze), which still sorts user timelines and rebuilds
+ *          indexes for the whole database. Snapshots are neither restored nor stored, and the
+ *          snapshot of the original dataset (if any) is left untouched.
+ *
+ * @param database    Database, usually already filled by ::dataset_loader_load, where to add the
+ *                    delta's data to.
+ * @param delta_path  Path to the directory containing the delta.
+ * @param errors_path Path to the directory where to output error files to. Existing error files
+ *                    there are overwritten, so the directory used for the full load shouldn't be
+ *                    used if its files are still needed.
+ * @param metrics     Where to register program performance data to. Can be `NULL` for no
+ *                    profiling.
+ * @param progress    Where to register loading progress to. Can be `NULL`. Cancellation is
+ *                    supported as in ::dataset_loader_load.
+ *
+ * @retval 0 Success.
+ * @retval 1 Fatal failure (IO or allocation) or cancellation. On failure, @p database may contain
+ *           part of the delta, and should be freed.
+ */
+int dataset_loader_load_delta(database_t            *database,
+                              const char            *delta_path,
+                              const char            *errors_path,
+                              performance_metrics_t *metrics,
+                              dataset_progress_t    *progress);
+
+/**
+ * @brief Value returned by ::dataset_loader_append_delta when the delta was added to the database,
+ *        but couldn't be appended to the log.
+ */
+#define DATASET_LOADER_APPEND_RET_NOT_LOGGED 2
+
+/**
+ * @brief   Adds a delta to a database, as in ::dataset_loader_load_delta, and appends it to the
+ *          [delta log](@ref dataset_delta_log.h) of the dataset the database was loaded from.
+ * @details Later loads of the dataset (see ::dataset_loader_load) restore its snapshot and replay
+ *          the deltas in its log, so they include this delta without a new snapshot being stored.
+ *          When replaying becomes expensive, the load that replayed the log compacts it in a
+ *          background process, storing the replayed database as the new snapshot (only if the
+ *          load outputs errors and has all optional data, like when storing snapshots).
+ *
+ * @param database     Database loaded from the snapshot of @p dataset_path (possibly with other
+ *                     deltas already appended).
+ * @param dataset_path Path to the directory containing the dataset.
+ * @param delta_path   Path to the directory containing the delta. Its files can't be compressed.
+ * @param errors_path  See ::dataset_loader_load_delta.
+ * @param metrics      See ::dataset_loader_load_delta.
+ * @param progress     See ::dataset_loader_load_delta.
+ *
+ * @retval 0                                    Success.
+ * @retval 1                                    Failure, as in ::dataset_loader_load_delta.
+ * @retval DATASET_LOADER_APPEND_RET_NOT_LOGGED The delta was added to @p database, but couldn't be
+ *                                              appended to the log (e.g.: the dataset has no
+ *                                              snapshot), so later loads won't include it.
+ */
+int dataset_loader_append_delta(database_t            *database,
+                                const char            *dataset_path,
+                                const char            *delta_path,
+                                const char            *errors_path,
+                                performance_metrics_t *metrics,
+                                dataset_progress_t    *progress);
+
+/**
+ * @brief   Restores a database from a snapshot downloaded from a server (see
+ *          [dataset shipping](@ref dataset_shipping.h)).
+ * @details There are no dataset files to parse, nor to check the snapshot against. Dataset errors
+ *          aren't written anywhere, as the server already reported them.
+ *
+ * @param database  Empty database where to store the dataset's data.
+ * @param directory Path to the directory containing the snapshot (see ::dataset_shipping_fetch).
+ *
+ * @retval 0 Success.
+ * @retval 1 Fatal failure (IO or allocation), or an unusable snapshot. On failure, @p database may
+ *           be partially filled, and should be freed.
+ */
+int dataset_loader_load_shipped(database_t *database, const char *directory);
 
 #endif
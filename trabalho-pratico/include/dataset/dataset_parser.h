@@ -46,7 +46,8 @@
  * #include <string.h>
  *
  * #include "dataset/dataset_parser.h"
- * #include "utils/fixed_n_delimiter_parser.h"
+ * #include "dataset/dataset_progress.h"
+#include "utils/fixed_n_delimiter_parser.h"
  * #include "utils/string_utils.h"
  *
  * #define TEST_FILE "testfile.txt"
@@ -96,9 +97,9 @@
  * // Print line before parsing. Here, it's used for tracing purposes, but, in practice, this
  * // callback usually serves to store the current line being parsed, in case there's a need to
  * // report an error.
- * int before_parse_token(void *user_data, char *token) {
+ * int before_parse_token(void *user_data, char *token, size_t length) {
  *     (void) user_data;
- *     printf("Parsing line: %s\n", token);
+ *     printf("Parsing line: %s (%zu bytes)\n", token, length);
  *     return 0;
  * }
  *
@@ -186,13 +187,51 @@
  *
  * For information about single-line parsing, refer to
  * [fixed_n_delimiter_parser's examples](@ref fixed_n_delimiter_parser_examples).
+ *
+ * ### Batch parsing
+ *
+ * Grammars created with ::dataset_parser_grammar_new_batch parse up to
+ * ::DATASET_PARSER_BATCH_SIZE lines at a time. Each batch of lines is first split into a matrix of
+ * columns, and then each column's callback is called once for all lines in the batch, so that it
+ * can validate and convert a whole column in a tight loop. Each column callback returns a mask of
+ * the lines whose field is valid, and a line is only valid if it has the right number of fields and
+ * its bit is set in the masks of all columns. The batch callback then receives the (unmodified)
+ * lines, in file order, along with the final mask. For example, with a
+ * `person_t batch[DATASET_PARSER_BATCH_SIZE]` field added to `person_dataset_t`:
+ *
+ * ```c
+ * uint64_t parse_ages(void *user_data, char *const *tokens, size_t nrows, size_t ncolumn) {
+ *     person_dataset_t *dataset = user_data;
+ *     uint64_t          valid   = 0;
+ *     for (size_t i = 0; i < nrows; ++i) {
+ *         dataset->batch[i].age = atoi(tokens[i]);
+ *         valid |= (uint64_t) (dataset->batch[i].age >= 0) << i;
+ *     }
+ *     return valid;
+ * }
+ *
+ * int add_batch(void *user_data, char *const *lines, const size_t *lengths, size_t nrows,
+ *               uint64_t valid) {
+ *     for (size_t i = 0; i < nrows; ++i)
+ *         if (valid & ((uint64_t) 1 << i))
+ *             ... // Add ((person_dataset_t *) user_data)->batch[i]
+ *         else
+ *             ... // Report lines[i] as an error
+ *     return 0;
+ * }
+ * ```
+ *
+ * Unlike line-by-line parsing, all columns are always parsed, even for lines already known to be
+ * invalid.
  */
 
 #ifndef DATASET_PARSER_H
 #define DATASET_PARSER_H
 
+#include <stdint.h>
 #include <stdio.h>
 
+#include "dataset/dataset_progress.h"
 #include "utils/fixed_n_delimiter_parser.h"
 
 /** @brief The grammar definition for a dataset parser. */
@@ -207,12 +246,15 @@ typedef struct dataset_parser_grammar dataset_parser_grammar_t;
  *                  the program's state.
  * @param unparsed  Token to be parsed. Do not store in @p user_data without copying it first, as
  *                  the lifetime of @p unparsed is limited to this method.
+ * @param length    Length of @p unparsed, not including its `'\0'` terminator.
  *
  * @return `0` on success, another value for immediate termination of parsing. It's recommeneded
  *         that these values are positive, as negative values have special meanings (see
  *         ::DATASET_PARSER_PARSE_RET_ALLOCATION_FAILURE).
  */
-typedef int (*dataset_parser_token_before_parse_callback)(void *user_data, char *unparsed);
+typedef int (*dataset_parser_token_before_parse_callback)(void  *user_data,
+                                                          char  *unparsed,
+                                                          size_t length);
 
 /**
  * @brief   Callback for each token delimited by the first-order delimiter in a dataset parser
@@ -231,6 +273,53 @@ typedef int (*dataset_parser_token_before_parse_callback)(void *user_data, char
  */
 typedef int (*dataset_parser_token_callback)(void *user_data, int retcode);
 
+/** @brief Maximum number of lines parsed at a time by batch parsers (bits in a row mask). */
+#define DATASET_PARSER_BATCH_SIZE 64
+
+/**
+ * @brief   Callback for a column of a batch of lines in a batch parser.
+ * @details Called once for every column of every batch, even for lines already known to be
+ *          invalid, in column order.
+ *
+ * @param user_data Pointer provided to ::dataset_parser_parse, so that this callback can modify
+ *                  the program's state.
+ * @param tokens    Field of each line in the column, terminated by `'\0'`. Lines without enough
+ *                  fields get an empty string, and lines with too many fields have the rest of the
+ *                  line in their last column. Don't store these, as they're only valid during this
+ *                  call.
+ * @param nrows     Number of lines in the batch (elements in @p tokens). At most
+ *                  ::DATASET_PARSER_BATCH_SIZE.
+ * @param ncolumn   Number of the column (starting at `0`).
+ *
+ * @return A mask of the lines whose field is valid (bit `i` for `tokens[i]`).
+ */
+typedef uint64_t (*dataset_parser_column_callback)(void        *user_data,
+                                                   char *const *tokens,
+                                                   size_t       nrows,
+                                                   size_t       ncolumn);
+
+/**
+ * @brief Callback for each batch of lines in a batch parser, after all its columns are parsed.
+ *
+ * @param user_data Pointer provided to ::dataset_parser_parse, so that this callback can modify
+ *                  the program's state.
+ * @param lines     Lines in the batch, in file order, terminated by `'\0'` and unmodified. Don't
+ *                  store these, as they're only valid during this call.
+ * @param lengths   Length of each line in @p lines.
+ * @param nrows     Number of lines in the batch. At most ::DATASET_PARSER_BATCH_SIZE.
+ * @param valid     Mask of the valid lines (bit `i` for `lines[i]`): the ones with the right number
+ *                  of fields, for which all ::dataset_parser_column_callback succeeded.
+ *
+ * @return `0` on success, another value for immediate termination of parsing. It's recommeneded
+ *         that these values are positive, as negative values have special meanings (see
+ *         ::DATASET_PARSER_PARSE_RET_ALLOCATION_FAILURE).
+ */
+typedef int (*dataset_parser_batch_callback)(void         *user_data,
+                                             char *const  *lines,
+                                             const size_t *lengths,
+                                             size_t        nrows,
+                                             uint64_t      valid);
+
 /**
  * @brief Creates a grammar that defines a dataset parser.
  *
@@ -253,6 +342,61 @@ dataset_parser_grammar_t *
                                dataset_parser_token_before_parse_callback before_parse_callback,
                                dataset_parser_token_callback              token_callback);
 
+/**
+ * @brief Environment variable that, when set to `1`, makes grammars created with
+ *        ::dataset_parser_grammar_new_specialized use their generic token grammar.
+ */
+#define DATASET_PARSER_GENERIC_ENVIRONMENT_VARIABLE "LI3_GENERIC_PARSERS"
+
+/**
+ * @brief   Creates a grammar that defines a dataset parser, whose tokens are parsed by a parser
+ *          specialized for their schema.
+ * @details @p token_parser is usually generated by ::FIXED_N_DELIMITER_PARSER_DEFINE, from the same
+ *          schema as @p token_grammar, so that they behave the same way. @p token_grammar is used
+ *          instead when ::DATASET_PARSER_GENERIC_ENVIRONMENT_VARIABLE is set to `1`, so that the
+ *          results and the performance of both can be compared.
+ *
+ * @param first_order_delimiter Main separator between tokens (e.g.: ``'\n'`` for a CSV table).
+ * @param token_grammar         Generic grammar for each token delimited by
+ *                              @p first_order_delimiter.
+ * @param token_parser          Parser for each token delimited by @p first_order_delimiter,
+ *                              equivalent to @p token_grammar.
+ * @param before_parse_callback Callback called before parsing each token.
+ * @param token_callback        Callback called after parsing each token.
+ *
+ * @return A pointer to a  ::dataset_parser_grammar_t (or `NULL` on allocation failure). This value
+ *         is owned by the function caller, so you must free it with ::dataset_parser_grammar_free
+ *         after you're done using it.
+ */
+dataset_parser_grammar_t *dataset_parser_grammar_new_specialized(
+    char                                       first_order_delimiter,
+    const fixed_n_delimiter_parser_grammar_t  *token_grammar,
+    fixed_n_delimiter_parser_specialized_t     token_parser,
+    dataset_parser_token_before_parse_callback before_parse_callback,
+    dataset_parser_token_callback              token_callback);
+
+/**
+ * @brief   Creates a grammar that defines a batch dataset parser.
+ * @details Lines are parsed in batches of ::DATASET_PARSER_BATCH_SIZE, column by column. See
+ *          [the header file's documentation](@ref dataset_parser_examples).
+ *
+ * @param first_order_delimiter Main separator between lines (e.g.: ``'\n'`` for a CSV table).
+ * @param column_delimiter      Separator between the fields of each line (e.g.: ``';'``).
+ * @param n                     Number of fields in each line.
+ * @param column_callbacks      Callback for each column.
+ * @param batch_callback        Callback called after all columns of a batch are parsed.
+ *
+ * @return A pointer to a  ::dataset_parser_grammar_t (or `NULL` on allocation failure). This value
+ *         is owned by the function caller, so you must free it with ::dataset_parser_grammar_free
+ *         after you're done using it.
+ */
+dataset_parser_grammar_t *
+    dataset_parser_grammar_new_batch(char                                 first_order_delimiter,
+                                     char                                 column_delimiter,
+                                     size_t                               n,
+                                     const dataset_parser_column_callback column_callbacks[n],
+                                     dataset_parser_batch_callback        batch_callback);
+
 /**
  * @brief Creates a deep clone of a grammar that defines a dataset parser.
  * @param grammar Grammar to be cloned.
@@ -263,7 +407,9 @@ dataset_parser_grammar_t *
 dataset_parser_grammar_t *dataset_parser_grammar_clone(const dataset_parser_grammar_t *grammar);
 
 /**
- * @brief Frees memory allocated by ::dataset_parser_grammar_new or ::dataset_parser_grammar_clone.
+ * @brief Frees memory allocated by ::dataset_parser_grammar_new,
+ *        ::dataset_parser_grammar_new_specialized, ::dataset_parser_grammar_new_batch or
+ *        ::dataset_parser_grammar_clone.
  * @param grammar Grammar to be deleted.
  *
  * #### Examples
@@ -271,24 +417,104 @@ dataset_parser_grammar_t *dataset_parser_grammar_clone(const dataset_parser_gram
  */
 void dataset_parser_grammar_free(dataset_parser_grammar_t *grammar);
 
+/**
+ * @brief   Makes parsers defined by @p grammar register their progress in @p progress.
+ * @details The number of lines and bytes of the file that have been processed is periodically
+ *          added to @p progress, and parsing stops with ::DATASET_PARSER_PARSE_RET_CANCELLED when
+ *          @p progress gets cancelled.
+ *
+ * @param grammar  Grammar to be modified.
+ * @param progress Where to register progress to. Can be `NULL`, for no progress to be registered
+ *                 (the default).
+ * @param step     Step of dataset loading where the file parsed by @p grammar is read.
+ */
+void dataset_parser_grammar_set_progress(dataset_parser_grammar_t          *grammar,
+                                         dataset_progress_t                *progress,
+                                         performance_metrics_dataset_step_t step);
+
 /** @brief Value returned by ::dataset_parser_parse when allocations fail. */
 #define DATASET_PARSER_PARSE_RET_ALLOCATION_FAILURE -1
 
+/** @brief Value returned by ::dataset_parser_parse when reading from the file fails. */
+#define DATASET_PARSER_PARSE_RET_IO_FAILURE -2
+
+/** @brief Value returned by ::dataset_parser_parse when the grammar's progress gets cancelled. */
+#define DATASET_PARSER_PARSE_RET_CANCELLED -3
+
 /**
- * @brief Parses a file, using a parser defined by @p grammar.
+ * @brief   Parses a file, using a parser defined by @p grammar.
+ * @details Regular files are memory-mapped, and other types of files (e.g.: pipes) are read in
+ *          large blocks (see ::stream_tokenize_slices). Use ::stream_tokenize_get_method to know
+ *          which method will be used for @p file.
  *
- * @param file      File to parse.
+ * @param file      File to parse, positioned where parsing should start.
  * @param grammar   Grammar that defines the parser to be used.
  * @param user_data Pointer passed to every callback in @p grammar, so that they can edit the
  *                  program's state.
  *
  * @returns `0` on success. Other values are allowed, and happen when any of the callbacks in
  *          @p grammar return a non-`0` value, which is then returned by ::dataset_parser_parse.
- *          Also, ::DATASET_PARSER_PARSE_RET_ALLOCATION_FAILURE is returned when allocations fail.
+ *          Also, ::DATASET_PARSER_PARSE_RET_ALLOCATION_FAILURE is returned when allocations fail,
+ *          ::DATASET_PARSER_PARSE_RET_IO_FAILURE when reading from @p file fails, and
+ *          ::DATASET_PARSER_PARSE_RET_CANCELLED when the load is cancelled (see
+ *          ::dataset_parser_grammar_set_progress).
  *
  * #### Examples
  * See [the header file's documentation](@ref dataset_parser_examples).
  */
 int dataset_parser_parse(FILE *file, const dataset_parser_grammar_t *grammar, void *user_data);
 
+/**
+ * @brief   Calculates into how many chunks a file should be divided for
+ *          ::dataset_parser_parse_chunked.
+ * @details Files that can't be memory-mapped and small files aren't divided. Otherwise, there are
+ *          never more chunks than the threads of the loading stage (see
+ *          ::thread_pool_get_stage_thread_count).
+ *
+ * @param file File to be parsed.
+ *
+ * @return The number of chunks to divide @p file into (at least `1`).
+ */
+size_t dataset_parser_get_chunk_count(FILE *file);
+
+/**
+ * @brief   Estimates how many lines a file has, from its size and the length of its first lines.
+ * @details Used to size tables before loading a file, so that they don't need to grow repeatedly.
+ *          The average line length is measured on a sample at the beginning of @p file, so files
+ *          smaller than that sample have their lines counted exactly. @p file's position isn't
+ *          changed.
+ *
+ * @param file File to be parsed.
+ *
+ * @return An estimate of the number of lines in @p file, or `0` if it can't be read or its size
+ *         can't be known.
+ */
+size_t dataset_parser_estimate_line_count(FILE *file);
+
+/**
+ * @brief   Parses a file, using a parser defined by @p grammar, in @p n parallel chunks.
+ * @details The file is divided into @p n chunks of consecutive lines (see
+ *          ::stream_tokenize_slices_chunked), each parsed in its own thread. The callbacks in
+ *          @p grammar are called with `user_data[i]` for the first-order tokens in chunk `i`, so
+ *          they must only modify state reachable from their `user_data`. Because all tokens in a
+ *          chunk come before the ones in the next chunk, processing the results of each chunk
+ *          in order (after parsing) is the same as processing the results of
+ *          ::dataset_parser_parse.
+ *
+ *          When @p n is `1`, or the file can't be memory-mapped, the whole file is parsed in the
+ *          calling thread with `user_data[0]`.
+ *
+ * @param file      File to parse, positioned where parsing should start.
+ * @param grammar   Grammar that defines the parser to be used.
+ * @param n         Number of chunks to divide @p file into (see ::dataset_parser_get_chunk_count).
+ * @param user_data Pointers passed to callbacks in @p grammar, one for each chunk.
+ *
+ * @returns The same values as ::dataset_parser_parse. When parsing of more than one chunk fails,
+ *          the value returned is the one from the first of those chunks.
+ */
+int dataset_parser_parse_chunked(FILE                           *file,
+                                 const dataset_parser_grammar_t *grammar,
+                                 size_t                          n,
+                                 void *const                     user_data[n]);
+
 #endif
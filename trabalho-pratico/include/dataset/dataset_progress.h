@@ -0,0 +1,278 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    dataset_progress.h
+ * @brief   Progress of a dataset being loaded, that can be observed from other threads.
+ * @details A ::dataset_progress_t is written to by the [dataset_loader](@ref dataset_loader.h)
+ *          (possibly from many threads at once), and read by any other thread, such as the one
+ *          rendering the interactive mode's user interface. No locks are used: every counter is
+ *          updated atomically, so reading it never blocks dataset loading.
+ *
+ *          Counters are only eventually consistent with each other. For example, the number of
+ *          rejected lines of a file may momentarily be ahead of the number of its processed lines.
+ *
+ *          A load can also be cancelled with ::dataset_progress_cancel. The loader will then stop
+ *          as soon as possible and fail, so that the partially loaded database can be discarded.
+ *          It can also be paused (::dataset_progress_pause), for example so that a load in the
+ *          background doesn't compete for the processor with more urgent work. The loader only
+ *          stops at checkpoints (::dataset_progress_checkpoint) between groups of lines, so it
+ *          doesn't stop immediately, and it can't be stopped after all files have been parsed.
+ *
+ * @anchor dataset_progress_examples
+ * ### Examples
+ *
+ * ```c
+ * dataset_progress_t *progress = dataset_progress_create();
+ * // Start a thread that calls dataset_loader_load(database, path, NULL, NULL, progress), and
+ * // then dataset_progress_finish(progress).
+ *
+ * while (!dataset_progress_is_finished(progress)) {
+ *     printf("%.1f%%\n", dataset_progress_get_fraction(progress) * 100.0);
+ *     sleep(1);
+ * }
+ *
+ * // Join the thread
+ * dataset_progress_free(progress);
+ * ```
+ */
+
+#ifndef DATASET_PROGRESS_H
+#define DATASET_PROGRESS_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "testing/performance_metrics.h"
+
+/** @brief Progress of a dataset being loaded. */
+typedef struct dataset_progress dataset_progress_t;
+
+/**
+ * @brief  Creates a new ::dataset_progress_t, where nothing has been loaded yet.
+ * @return A pointer to a new ::dataset_progress_t, that must be deleted with
+ *         ::dataset_progress_free, or `NULL` on allocation failure.
+ */
+dataset_progress_t *dataset_progress_create(void);
+
+/**
+ * @brief Adds to the number of bytes of the file loaded in @p step that must be read.
+ *
+ * @param progress Progress to be modified. Can be `NULL`, for nothing to happen.
+ * @param step     Step of dataset loading where the file is read. Musn't be
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ * @param bytes    Number of bytes to add.
+ */
+void dataset_progress_add_total_bytes(dataset_progress_t                *progress,
+                                      performance_metrics_dataset_step_t step,
+                                      size_t                             bytes);
+
+/**
+ * @brief Registers that some lines of the file loaded in @p step have been read and processed.
+ *
+ * @param progress Progress to be modified. Can be `NULL`, for nothing to happen.
+ * @param step     Step of dataset loading where the file is read. Musn't be
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ * @param lines    Number of lines processed.
+ * @param bytes    Number of bytes in those @p lines, including delimiters.
+ */
+void dataset_progress_add_lines(dataset_progress_t                *progress,
+                                performance_metrics_dataset_step_t step,
+                                size_t                             lines,
+                                size_t                             bytes);
+
+/**
+ * @brief Registers that a line of the file loaded in @p step has been rejected (is invalid).
+ *
+ * @param progress Progress to be modified. Can be `NULL`, for nothing to happen.
+ * @param step     Step of dataset loading where the file is read. Musn't be
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ */
+void dataset_progress_add_rejected(dataset_progress_t                *progress,
+                                   performance_metrics_dataset_step_t step);
+
+/**
+ * @brief   Chooses whether parsers measure the time of each sub-phase of loading a file (see
+ *          ::performance_metrics_dataset_phase_t).
+ * @details Must be called before loading starts. Measuring adds a few clock readings per line, so
+ *          it's only done when performance metrics are collected.
+ *
+ * @param progress  Progress to be modified.
+ * @param measuring Whether to measure sub-phases.
+ */
+void dataset_progress_set_measuring_phases(dataset_progress_t *progress, int measuring);
+
+/**
+ * @brief  Checks if parsers should measure the time of each sub-phase of loading a file.
+ * @param  progress Progress of a dataset being loaded. Can be `NULL`.
+ * @return Whether ::dataset_progress_set_measuring_phases enabled measurements in @p progress.
+ */
+int dataset_progress_is_measuring_phases(const dataset_progress_t *progress);
+
+/**
+ * @brief Adds to the time spent in each sub-phase of loading the file loaded in @p step.
+ *
+ * @param progress Progress to be modified.
+ * @param step     Step of dataset loading where the file is read. Musn't be
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ * @param times    Nanoseconds to add to each ::performance_metrics_dataset_phase_t.
+ */
+void dataset_progress_add_phase_times(
+    dataset_progress_t                *progress,
+    performance_metrics_dataset_step_t step,
+    const uint64_t                     times[PERFORMANCE_METRICS_DATASET_PHASE_COUNT]);
+
+/**
+ * @brief Gets the number of bytes in the file loaded in @p step.
+ *
+ * @param progress Progress of a dataset being loaded.
+ * @param step     Step of dataset loading where the file is read. Musn't be
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ *
+ * @return The number of bytes in the file, or `0` if its reading hasn't started yet.
+ */
+size_t dataset_progress_get_total_bytes(const dataset_progress_t          *progress,
+                                        performance_metrics_dataset_step_t step);
+
+/**
+ * @brief Gets the number of bytes of the file loaded in @p step that have already been processed.
+ *
+ * @param progress Progress of a dataset being loaded.
+ * @param step     Step of dataset loading where the file is read. Musn't be
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ *
+ * @return The number of processed bytes.
+ */
+size_t dataset_progress_get_read_bytes(const dataset_progress_t          *progress,
+                                       performance_metrics_dataset_step_t step);
+
+/**
+ * @brief Gets the number of lines of the file loaded in @p step that have already been processed.
+ *
+ * @param progress Progress of a dataset being loaded.
+ * @param step     Step of dataset loading where the file is read. Musn't be
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ *
+ * @return The number of processed lines, valid or not.
+ */
+size_t dataset_progress_get_lines(const dataset_progress_t          *progress,
+                                  performance_metrics_dataset_step_t step);
+
+/**
+ * @brief Gets the number of rejected lines of the file loaded in @p step.
+ *
+ * @param progress Progress of a dataset being loaded.
+ * @param step     Step of dataset loading where the file is read. Musn't be
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ *
+ * @return The number of rejected lines. File headers are included, as they are reported like
+ *         invalid lines.
+ */
+size_t dataset_progress_get_rejected(const dataset_progress_t          *progress,
+                                     performance_metrics_dataset_step_t step);
+
+/**
+ * @brief Gets the time spent in a sub-phase of loading the file loaded in @p step.
+ *
+ * @param progress Progress of a dataset being loaded.
+ * @param step     Step of dataset loading where the file is read. Musn't be
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                 ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ * @param phase    Sub-phase to get the time of.
+ *
+ * @return The time spent in @p phase (in nanoseconds, summed over all threads), or `0` if it
+ *         wasn't measured (see ::dataset_progress_set_measuring_phases).
+ */
+uint64_t dataset_progress_get_phase_time(const dataset_progress_t           *progress,
+                                         performance_metrics_dataset_step_t  step,
+                                         performance_metrics_dataset_phase_t phase);
+
+/**
+ * @brief  Gets which fraction of all bytes in the dataset has already been processed.
+ * @param  progress Progress of a dataset being loaded.
+ * @return A value between `0.0` and `1.0`. `0.0` is also returned when no file size is known yet.
+ */
+double dataset_progress_get_fraction(const dataset_progress_t *progress);
+
+/**
+ * @brief Requests a dataset load to be stopped as soon as possible.
+ * @param progress Progress of the dataset being loaded. Can be `NULL`, for nothing to happen.
+ */
+void dataset_progress_cancel(dataset_progress_t *progress);
+
+/**
+ * @brief  Checks if ::dataset_progress_cancel has been called on @p progress.
+ * @param  progress Progress of a dataset being loaded. Can be `NULL` (never cancelled).
+ * @return `1` if the load has been cancelled, `0` otherwise.
+ */
+int dataset_progress_is_cancelled(const dataset_progress_t *progress);
+
+/**
+ * @brief   Requests a dataset load to wait, at its next checkpoint, until it's resumed.
+ * @details See ::dataset_progress_checkpoint.
+ * @param   progress Progress of the dataset being loaded.
+ */
+void dataset_progress_pause(dataset_progress_t *progress);
+
+/**
+ * @brief Resumes a dataset load paused by ::dataset_progress_pause.
+ * @param progress Progress of the dataset being loaded.
+ */
+void dataset_progress_resume(dataset_progress_t *progress);
+
+/**
+ * @brief   Checkpoint of a dataset load, called by the loader between groups of lines.
+ * @details Blocks while the load is paused (see ::dataset_progress_pause), unless it's cancelled.
+ *
+ * @param progress Progress of the dataset being loaded. Can be `NULL` (never paused nor
+ *                 cancelled).
+ *
+ * @return `1` if the load has been cancelled, `0` otherwise.
+ */
+int dataset_progress_checkpoint(dataset_progress_t *progress);
+
+/**
+ * @brief   Marks a dataset load as finished, successfully or not.
+ * @details Writes done before calling this method are visible to any thread after
+ *          ::dataset_progress_is_finished returns `1`.
+ *
+ * @param progress Progress of the dataset that was being loaded.
+ */
+void dataset_progress_finish(dataset_progress_t *progress);
+
+/**
+ * @brief  Checks if ::dataset_progress_finish has been called on @p progress.
+ * @param  progress Progress of a dataset being loaded.
+ * @return `1` if the load has finished, `0` otherwise.
+ */
+int dataset_progress_is_finished(const dataset_progress_t *progress);
+
+/**
+ * @brief Frees memory allocated by ::dataset_progress_create.
+ * @param progress Progress to be deleted. No thread can be using it anymore.
+ */
+void dataset_progress_free(dataset_progress_t *progress);
+
+#endif
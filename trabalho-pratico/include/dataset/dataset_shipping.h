@@ -0,0 +1,148 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    dataset_shipping.h
+ * @brief   Transfer of [snapshots](@ref dataset_snapshot.h) from a server to its replicas.
+ * @details A [server](@ref server_mode.h) serves the snapshot of its dataset, over HTTP, on its
+ *          socket, so that replicas can restore the same database without the dataset's files:
+ *
+ *          - `GET /snapshot` answers with the snapshot's manifest. Its first line contains the
+ *            snapshot's identifier (see ::dataset_snapshot_get_identity, in hexadecimal), its
+ *            length and the size of its chunks (::DATASET_SHIPPING_CHUNK_SIZE). Each following
+ *            line is the checksum of a chunk (see ::dataset_snapshot_checksum, in hexadecimal).
+ *          - `GET /snapshot/<identifier>/<chunk>` answers with the bytes of a chunk. If the
+ *            snapshot was replaced meanwhile (its identifier changed), the response is a `404`.
+ *
+ *          Replicas download the snapshot one chunk at a time, to a partial file, verifying each
+ *          chunk against the manifest. A download that was interrupted is resumed: chunks already
+ *          in the partial file whose checksums match the manifest aren't downloaded again. Once
+ *          all chunks are present, the partial file replaces the replica's snapshot.
+ *
+ * @anchor dataset_shipping_examples
+ * ### Examples
+ *
+ * Start a server with `./programa-principal --server dataset /tmp/primary.sock`, and a replica
+ * with `./programa-principal --replica /tmp/primary.sock /tmp/replica /tmp/replica.sock`. The
+ * manifest can also be inspected with `curl`:
+ *
+ * ```text
+ * $ curl --unix-socket /tmp/primary.sock http://localhost/snapshot
+ * 5c0e0b3bd3e5d1a2 20971584 4194304
+ * 9c1e2b7fa84c3d10
+ * ...
+ * ```
+ */
+
+#ifndef DATASET_SHIPPING_H
+#define DATASET_SHIPPING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Number of bytes in each chunk of a shipped snapshot (except, possibly, the last one). */
+#define DATASET_SHIPPING_CHUNK_SIZE (4 << 20)
+
+/**
+ * @brief Name of the file a snapshot is downloaded to, inside a replica's directory, before it's
+ *        complete.
+ */
+#define DATASET_SHIPPING_PARTIAL_FILE_NAME ".database.snapshot.partial"
+
+/**
+ * @brief   The snapshot of a dataset, served to replicas.
+ * @details The manifest of the snapshot is calculated once, and only recalculated after the
+ *          snapshot is replaced.
+ */
+typedef struct dataset_shipping_source dataset_shipping_source_t;
+
+/**
+ * @struct dataset_shipping_response_t
+ * @brief  Response to an HTTP request for (part of) a snapshot.
+ *
+ * @var dataset_shipping_response_t::status
+ *     @brief HTTP status code (`200`, `404` or `500`).
+ * @var dataset_shipping_response_t::body
+ *     @brief Body of the response, to be freed with `free` (`NULL` unless
+ *            ::dataset_shipping_response_t::status is `200`).
+ * @var dataset_shipping_response_t::length
+ *     @brief Number of bytes in ::dataset_shipping_response_t::body.
+ * @var dataset_shipping_response_t::binary
+ *     @brief Whether ::dataset_shipping_response_t::body is a chunk of the snapshot, and not text.
+ */
+typedef struct {
+    int    status;
+    char  *body;
+    size_t length;
+    int    binary;
+} dataset_shipping_response_t;
+
+/**
+ * @brief  Creates a source of snapshots, for the snapshot of a dataset.
+ * @param  dataset_path Path to the directory containing the dataset whose snapshot (see
+ *                      ::dataset_snapshot_get_path) is served. Must outlive the source.
+ * @return A new source of snapshots, or `NULL` on allocation failure.
+ */
+dataset_shipping_source_t *dataset_shipping_source_create(const char *dataset_path);
+
+/**
+ * @brief Frees memory used by a source of snapshots.
+ * @param source Source to be freed.
+ */
+void dataset_shipping_source_free(dataset_shipping_source_t *source);
+
+/**
+ * @brief Checks if the path of an HTTP request is one served by ::dataset_shipping_respond.
+ *
+ * @param path   Path of the HTTP request (not null-terminated).
+ * @param length Number of characters in @p path.
+ *
+ * @return Whether @p path starts with `/snapshot`.
+ */
+int dataset_shipping_is_request(const char *path, size_t length);
+
+/**
+ * @brief Answers an HTTP request for the manifest or a chunk of a snapshot.
+ *
+ * @param source Source of the snapshot.
+ * @param path   Path of the HTTP request (not null-terminated).
+ * @param length Number of characters in @p path.
+ * @param out    Where to write the response to. The status will be `500` on IO / allocation
+ *               failures, and `404` when there's no snapshot or the request is invalid.
+ */
+void dataset_shipping_respond(dataset_shipping_source_t   *source,
+                              const char                  *path,
+                              size_t                       length,
+                              dataset_shipping_response_t *out);
+
+/**
+ * @brief   Downloads the snapshot of a server, resuming any download that was interrupted.
+ * @details See [the header file's documentation](@ref dataset_shipping.h) for the protocol. If the
+ *          local snapshot is already the same as the server's, nothing is downloaded.
+ *
+ * @param socket_path Path of the Unix domain socket of the server.
+ * @param directory   Directory where to store the snapshot (see ::dataset_snapshot_load_shipped).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (connection, IO or allocation errors, or a snapshot that kept being replaced
+ *           while it was downloaded). A message will also be printed to `stderr`.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref dataset_shipping_examples).
+ */
+int dataset_shipping_fetch(const char *socket_path, const char *directory);
+
+#endif
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    dataset_snapshot.h
+ * @brief   Binary snapshots of databases loaded from datasets.
+ * @details Parsing and validating a whole dataset is slow, and repeated runs over the same dataset
+ *          always result in the same database. So, after a dataset is loaded, the resulting
+ *          database (with its index of user names, which is slow to collate, and the contents of
+ *          the error files) can be stored in a snapshot file. Next time the same dataset is loaded,
+ *          the database is restored from that snapshot, as long as none of the dataset's files
+ *          changed in the meantime.
+ *
+ *          Snapshots are kept in a cache directory, chosen with
+ *          ::DATASET_SNAPSHOT_DIRECTORY_ENVIRONMENT_VARIABLE, with a file per dataset (see
+ *          ::dataset_snapshot_get_path). They are off if that variable isn't set, so that a run
+ *          never writes to the dataset's directory unless asked to.
+ *
+ *          A snapshot starts with a header, with a format version, the sizes and modification
+ *          times of all of the dataset's files (used for cache invalidation), and a checksum of
+ *          the snapshot's body. The body doesn't contain any pointers (only fixed-width values and
+ *          length-prefixed strings), so that it can be memory-mapped anywhere and read in place.
+ *          Snapshots are only meant to be read in the same machine they were written in (no byte
+ *          order conversions are performed).
+ *
+ *          When ::DATASET_SNAPSHOT_BORROW_ENVIRONMENT_VARIABLE is set to `1`, strings (names,
+ *          passports, hotel names, ...) aren't copied out of the snapshot. Instead, the snapshot is
+ *          kept mapped for as long as the database uses it, and entities point into it (see
+ *          ::database_borrow_strings). Snapshots are replaced by renaming, never overwritten, so a
+ *          mapping stays valid even if a newer snapshot is saved meanwhile.
+ *
+ *          Setting that variable to `external` instead is meant for datasets larger than memory.
+ *          Strings are borrowed in the same way, but, once the database is restored, the pages of
+ *          the snapshot read while restoring it are given back (see ::mapped_file_evict). Only
+ *          entities, their columns and indexes stay resident: strings are paged in on demand, one
+ *          page at a time for lookups, and with read-ahead for scans of whole managers (see
+ *          ::mapped_file_begin_scan).
+ *
+ * @anchor dataset_snapshot_examples
+ * ### Example
+ *
+ * See the source code of ::dataset_loader_load.
+ */
+
+#ifndef DATASET_SNAPSHOT_H
+#define DATASET_SNAPSHOT_H
+
+#include "database/database.h"
+#include "dataset/dataset_error_output.h"
+
+/**
+ * @brief Environment variable with the path to the directory where snapshots are kept. Snapshots
+ *        are off if unset.
+ */
+#define DATASET_SNAPSHOT_DIRECTORY_ENVIRONMENT_VARIABLE "LI3_SNAPSHOT_DIR"
+
+/**
+ * @brief Name of the snapshot file inside the directory of a snapshot shipped from another machine
+ *        (see ::dataset_snapshot_load_shipped).
+ */
+#define DATASET_SNAPSHOT_FILE_NAME ".database.snapshot"
+
+/**
+ * @brief Name of the environment variable that, when set to `1` (or `external`), makes restored
+ *        databases keep their strings in the snapshot file, instead of copying them.
+ */
+#define DATASET_SNAPSHOT_BORROW_ENVIRONMENT_VARIABLE "LI3_SNAPSHOT_BORROW"
+
+/**
+ * @brief Value returned by ::dataset_snapshot_load when the snapshot doesn't exist, is outdated or
+ *        is corrupted. The database wasn't modified.
+ */
+#define DATASET_SNAPSHOT_LOAD_RET_UNUSABLE 1
+
+/**
+ * @brief Value returned by ::dataset_snapshot_load on allocation failure, after the database
+ *        already started being modified.
+ */
+#define DATASET_SNAPSHOT_LOAD_RET_FATAL -1
+
+/**
+ * @brief   Restores a database from the snapshot of a dataset.
+ * @details Dataset errors stored in the snapshot are reported to @p output.
+ *
+ * @param database       Empty database where to store the dataset's data.
+ * @param dataset_path   Path to the directory containing the dataset.
+ * @param output         Where to output dataset errors to.
+ * @param needs_errors   Whether dataset errors are needed. Snapshots created without errors (see
+ *                       ::dataset_snapshot_save) aren't usable when this is true.
+ * @param out_identifier Where to write the identifier of the restored snapshot to, on success
+ *                       (see ::dataset_snapshot_get_identity). Can be `NULL`.
+ *
+ * @retval 0                                  Success.
+ * @retval DATASET_SNAPSHOT_LOAD_RET_UNUSABLE The snapshot can't be used, or snapshots are off
+ *                                            (see ::dataset_snapshot_get_path). Load the dataset
+ *                                            instead.
+ * @retval DATASET_SNAPSHOT_LOAD_RET_FATAL    Allocation failure. @p database may have been
+ *                                            partially filled.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref dataset_snapshot_examples).
+ */
+int dataset_snapshot_load(database_t             *database,
+                          const char             *dataset_path,
+                          dataset_error_output_t *output,
+                          int                     needs_errors,
+                          uint64_t               *out_identifier);
+
+/**
+ * @brief   Restores a database from a snapshot shipped from another machine (see
+ *          [dataset shipping](@ref dataset_shipping.h)).
+ * @details Unlike ::dataset_snapshot_load, the snapshot isn't checked against the files of a
+ *          dataset, as there are none besides it. Its format and checksum are still verified.
+ *          Dataset errors stored in the snapshot are reported to @p output.
+ *
+ * @param database  Empty database where to store the dataset's data.
+ * @param directory Path to the directory containing the snapshot.
+ * @param output    Where to output dataset errors to.
+ *
+ * @retval 0                                  Success.
+ * @retval DATASET_SNAPSHOT_LOAD_RET_UNUSABLE The snapshot doesn't exist or is corrupted.
+ * @retval DATASET_SNAPSHOT_LOAD_RET_FATAL    Allocation failure. @p database may have been
+ *                                            partially filled.
+ */
+int dataset_snapshot_load_shipped(database_t             *database,
+                                  const char             *directory,
+                                  dataset_error_output_t *output);
+
+/**
+ * @brief   Stores a snapshot of a database loaded from a dataset.
+ * @details The snapshot is first written to a temporary file that then replaces the previous
+ *          snapshot, so that readers never find a partially written snapshot.
+ *
+ * @param database     Database that was just loaded from the dataset in @p dataset_path. Must be
+ *                     frozen (see ::database_is_frozen).
+ * @param dataset_path Path to the directory containing the dataset.
+ * @param errors_path  Path to the directory containing the error files output while loading the
+ *                     dataset (already closed). Can be `NULL`, for a snapshot without errors.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (IO or allocation, @p database isn't frozen, or snapshots are off).
+ *           Snapshots are a cache, so this usually isn't fatal.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref dataset_snapshot_examples).
+ */
+int dataset_snapshot_save(const database_t *database,
+                          const char       *dataset_path,
+                          const char       *errors_path);
+
+/**
+ * @brief   Gets the path to the snapshot of a dataset.
+ * @details The snapshot is in the directory chosen with
+ *          ::DATASET_SNAPSHOT_DIRECTORY_ENVIRONMENT_VARIABLE, named after a checksum of the
+ *          dataset's absolute path. Neither the directory nor the snapshot need to exist.
+ *
+ * @param dataset_path Path to the directory containing the dataset.
+ * @param out_path     Where to write the path to the snapshot to, with `PATH_MAX` characters.
+ *
+ * @retval 0 Success.
+ * @retval 1 Snapshots are off, the dataset doesn't exist, or the path is too long.
+ */
+int dataset_snapshot_get_path(const char *dataset_path, char *out_path);
+
+/**
+ * @brief   Identifies the current contents of a dataset, without reading it.
+ * @details The fingerprint changes whenever a snapshot of the dataset would become outdated (the
+ *          size or modification time of any dataset file changes, or the snapshot format does), or
+ *          when deltas are appended to its [log](@ref dataset_delta_log.h), so it can key data
+ *          derived from the dataset, such as query outputs.
+ *
+ * @param dataset_path    Path to the directory containing the dataset.
+ * @param out_fingerprint Where to write the fingerprint to, on success.
+ *
+ * @retval 0 Success.
+ * @retval 1 A dataset file couldn't be accessed, or isn't a regular file.
+ */
+int dataset_snapshot_get_fingerprint(const char *dataset_path, uint64_t *out_fingerprint);
+
+/**
+ * @brief   Calculates the checksum of some data, in the same way the bodies of snapshots are
+ *          checksummed.
+ * @details Used to verify the chunks of a snapshot sent to another machine.
+ *
+ * @param data   Data to be checksummed.
+ * @param length Number of bytes in @p data.
+ *
+ * @return The checksum of @p data.
+ */
+uint64_t dataset_snapshot_checksum(const void *data, size_t length);
+
+/**
+ * @brief   Identifies the contents of a snapshot file, by reading its header.
+ * @details The identifier is the checksum of the snapshot's body, so two snapshots with the same
+ *          identifier can be used interchangeably.
+ *
+ * @param snapshot_path  Path to the snapshot file.
+ * @param out_identifier Where to write the identifier of the snapshot to, on success.
+ * @param out_length     Where to write the length of the whole snapshot file to, on success.
+ *
+ * @retval 0 Success.
+ * @retval 1 The file couldn't be read, or isn't a snapshot usable in this machine.
+ */
+int dataset_snapshot_get_identity(const char *snapshot_path,
+                                  uint64_t   *out_identifier,
+                                  uint64_t   *out_length);
+
+#endif
@@ -26,17 +26,27 @@
 
 #include "database/database.h"
 #include "dataset/dataset_error_output.h"
+#include "dataset/dataset_line_index.h"
+#include "dataset/dataset_progress.h"
 
 /**
  * @brief Parses a `flights.csv` dataset file.
  *
- * @param stream   File stream with flight data to be loaded.
+ * @param stream   File stream with flight data to be loaded. Must be at the beginning of the file.
  * @param database Database to add flight to.
+ * @param lines    Where to register the position of every valid flight's line in @p stream, so
+ *                 that it can be printed if the flight is invalidated later (e.g.: when loading
+ *                 passengers). Can be `NULL`.
  * @param output   Where to output dataset errors to.
+ * @param progress Where to register loading progress to. Can be `NULL`.
  *
  * @retval 0 Success.
- * @retval 1 Allocation failure.
+ * @retval 1 Allocation failure, or loading cancelled through @p progress.
  */
-int flights_loader_load(FILE *stream, database_t *database, dataset_error_output_t *output);
+int flights_loader_load(FILE                   *stream,
+                        database_t             *database,
+                        dataset_line_index_t   *lines,
+                        dataset_error_output_t *output,
+                        dataset_progress_t     *progress);
 
 #endif
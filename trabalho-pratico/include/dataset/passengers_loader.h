@@ -26,23 +26,31 @@
 
 #include "database/database.h"
 #include "dataset/dataset_error_output.h"
+#include "dataset/dataset_line_index.h"
+#include "dataset/dataset_progress.h"
 
 /**
- * @brief Parses a `passengers.csv` dataset file.
+ * @brief   Parses a `passengers.csv` dataset file.
+ * @details Big files are parsed in parallel chunks (see ::dataset_parser_parse_chunked). Errors are
+ *          still reported in file order.
  *
  * @param passengers_stream File stream with passenger data to be loaded. It is assumed this stream
  *                          is ordered by flight identifier.
- * @param flights_stream    File stream with flight data to be printed in case of errors. It is
- *                          assumed this stream is also ordered by flight identifier.
+ * @param flights_stream    File stream with flight data to be printed in case of errors.
+ * @param flight_lines      Positions of the lines of all valid flights in @p flights_stream,
+ *                          registered by ::flights_loader_load.
  * @param database          Database to add users-flight relations (passengers) to.
  * @param output            Where to output dataset errors to.
+ * @param progress          Where to register loading progress to. Can be `NULL`.
  *
  * @retval 0 Success.
- * @retval 1 Allocation failure.
+ * @retval 1 Allocation failure, or loading cancelled through @p progress.
  */
-int passengers_loader_load(FILE                   *passengers_stream,
-                           FILE                   *flights_stream,
-                           database_t             *database,
-                           dataset_error_output_t *output);
+int passengers_loader_load(FILE                       *passengers_stream,
+                           FILE                       *flights_stream,
+                           const dataset_line_index_t *flight_lines,
+                           database_t                 *database,
+                           dataset_error_output_t     *output,
+                           dataset_progress_t         *progress);
 
 #endif
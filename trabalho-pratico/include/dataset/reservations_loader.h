@@ -26,17 +26,24 @@
 
 #include "database/database.h"
 #include "dataset/dataset_error_output.h"
+#include "dataset/dataset_progress.h"
 
 /**
- * @brief Parses a `reservations.csv` dataset file.
+ * @brief   Parses a `reservations.csv` dataset file.
+ * @details Big files are parsed in parallel chunks (see ::dataset_parser_parse_chunked). Errors are
+ *          still reported in file order.
  *
  * @param stream   File stream with reservation data to be loaded.
  * @param database Database to add users to.
  * @param output   Where to output dataset errors to.
+ * @param progress Where to register loading progress to. Can be `NULL`.
  *
  * @retval 0 Success.
- * @retval 1 Allocation failure.
+ * @retval 1 Allocation failure, or loading cancelled through @p progress.
  */
-int reservations_loader_load(FILE *stream, database_t *database, dataset_error_output_t *output);
+int reservations_loader_load(FILE                   *stream,
+                         database_t             *database,
+                         dataset_error_output_t *output,
+                         dataset_progress_t     *progress);
 
 #endif
@@ -26,6 +26,7 @@
 
 #include "database/database.h"
 #include "dataset/dataset_error_output.h"
+#include "dataset/dataset_progress.h"
 
 /**
  * @brief Parses a `users.csv` dataset file.
@@ -33,10 +34,14 @@
  * @param stream   File stream with user data to be loaded.
  * @param database Database to add users to.
  * @param output   Where to output dataset errors to.
+ * @param progress Where to register loading progress to. Can be `NULL`.
  *
  * @retval 0 Success.
- * @retval 1 Allocation failure.
+ * @retval 1 Allocation failure, or loading cancelled through @p progress.
  */
-int users_loader_load(FILE *stream, database_t *database, dataset_error_output_t *output);
+int users_loader_load(FILE                   *stream,
+                  database_t             *database,
+                  dataset_error_output_t *output,
+                  dataset_progress_t     *progress);
 
 #endif
@@ -40,12 +40,55 @@
  * | Use the ← and → to navigate                   1 / 2 |
  * +-----------------------------------------------------+
  * ```
+ *
+ * When the output is large and expensive to generate, ::activity_paging_run_lazy can be used
+ * instead. Rather than an array with all lines, it takes a callback that is only asked for the
+ * lines around the page being shown (see ::activity_paging_source_callback_t). It can also take a
+ * callback providing a few lines of information about the output (e.g.: how long it took to
+ * generate), shown in a box over the bottom right corner of the page while the user toggles it
+ * with `p` (see ::activity_paging_overlay_callback_t).
  */
 #ifndef ACTIVITY_PAGING_H
 #define ACTIVITY_PAGING_H
 
 #include <stddef.h>
 
+/**
+ * @brief Callback that provides lines to be shown by a paginator, on demand.
+ *
+ * @param source_data Pointer provided to ::activity_paging_run_lazy.
+ * @param first       Index of the first line requested.
+ * @param count       Number of lines requested. Fewer lines may be provided, but not more.
+ * @param out_lines   Where to output the requested lines to. They must remain valid until the
+ *                    next call to this callback, or until the paginator exits.
+ * @param out_count   Where to output the number of lines in @p out_lines to.
+ * @param out_total   Where to output the total number of lines that can be shown to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure. The paginator will exit.
+ */
+typedef int (*activity_paging_source_callback_t)(void               *source_data,
+                                                 size_t              first,
+                                                 size_t              count,
+                                                 const char *const **out_lines,
+                                                 size_t             *out_count,
+                                                 size_t             *out_total);
+
+/**
+ * @brief   Callback that provides the lines shown over the output of a paginator.
+ * @details Called every time the page is rendered while the overlay is shown, always after
+ *          ::activity_paging_source_callback_t, so that the overlay can describe the lines last
+ *          provided. Lines should be short, and only contain ASCII characters.
+ *
+ * @param source_data Pointer provided to ::activity_paging_run_lazy.
+ * @param out_count   Where to output the number of lines to.
+ *
+ * @return The lines to be shown, that must remain valid until the next call to this callback, or
+ *         until the paginator exits. `NULL` for no overlay.
+ */
+typedef const char *const *(*activity_paging_overlay_callback_t)(void   *source_data,
+                                                                  size_t *out_count);
+
 /**
  * @brief Runs a TUI activity for a paginator.
  *
@@ -68,4 +111,29 @@
  */
 int activity_paging_run(size_t n, const char *const lines[n], int blocking, const char *title);
 
+/**
+ * @brief   Runs a TUI activity for a paginator, whose lines are generated on demand.
+ * @details Only lines near the page being displayed are requested from @p source, so that the time
+ *          it takes to show a page doesn't depend on the total number of lines. See
+ *          ::activity_paging_run for information about @p blocking.
+ *
+ * @param source      Callback that provides the lines to be shown.
+ * @param overlay     Callback that provides the lines shown over the output, when the user presses
+ *                    `p`. Can be `NULL`, for no overlay.
+ * @param source_data Pointer passed to @p source and @p overlay.
+ * @param blocking    If text blocks should be considered in page separation.
+ * @param title       The title of the activity.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or failure of @p source.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref activity_paging_examples).
+ */
+int activity_paging_run_lazy(activity_paging_source_callback_t  source,
+                             activity_paging_overlay_callback_t overlay,
+                             void                              *source_data,
+                             int                                blocking,
+                             const char                        *title);
+
 #endif
@@ -164,7 +164,8 @@ size_t ncurses_measure_unicode_string(const unichar_t *str);
  *          not formed by diacritics) aren't supported. Multi-line strings aren't supported as well.
  *
  *          This function is somewhat slow, as it requires lots of lookups in Unicode tables.
- *          Try to keep its use to a minimum.
+ *          Try to keep its use to a minimum. ASCII characters at the start of @p str are measured
+ *          without those lookups, so pure ASCII strings are cheap.
  *
  * @param str Null-terminated UTF-8 string to have its width measured.
  *
@@ -14,23 +14,41 @@
  * limitations under the License.
  */
 
+
 /**
  * @file    screen_loading_dataset.h
- * @brief   An `ncurses` screen that shows that a dataset is being loaded and that the program may
- *          become unresponsive.
+ * @brief   An `ncurses` screen that shows the progress of a dataset being loaded.
  * @details Its appearance on screen will be the following:
  *
  * ```text
- * +------------------------------------------------------------+
- * |                                                            |
- * | Loading dataset. The application will become unresponsive. |
- * |                                                            |
- * +------------------------------------------------------------+
+ * +----------------------------------------------------------+
+ * |                                                          |
+ * | Loading dataset. Press ESC to cancel.                    |
+ * |                                                          |
+ * | [##################--------------------]   45%  ETA 12s  |
+ * |                                                          |
+ * | users.csv            10000 accepted       124 rejected   |
+ * | flights.csv           1000 accepted        12 rejected   |
+ * | passengers.csv       16000 accepted         0 rejected   |
+ * | reservations.csv         0 accepted         0 rejected   |
+ * |                                                          |
+ * +----------------------------------------------------------+
  * ```
  */
 
+#ifndef SCREEN_LOADING_DATASET_H
+#define SCREEN_LOADING_DATASET_H
+
+#include "dataset/dataset_progress.h"
+
 /**
- * @brief Renders an `ncurses`'s screen that shows that a dataset is being loaded and that the
- *        program may become unresponsive.
+ * @brief   Renders an `ncurses`'s screen that shows the progress of a dataset being loaded.
+ * @details This screen is meant to be rendered repeatedly while the dataset is loaded in another
+ *          thread.
+ *
+ * @param progress Progress of the dataset being loaded.
+ * @param elapsed  Time since the load started, in seconds, used to estimate how long it will take.
  */
-void screen_loading_dataset_render(void);
+void screen_loading_dataset_render(const dataset_progress_t *progress, double elapsed);
+
+#endif
@@ -49,4 +49,22 @@
  */
 query_type_t *q02_create(void);
 
+/**
+ * @brief   Executes a query of type 2.
+ * @details The flights and reservations of every user are already sorted by date in the user
+ *          manager (see ::user_manager_freeze), with their dates stored alongside them. Both lists
+ *          are merged while being written, without any lookups or sorting.
+ *
+ * @param database   Database to get information from.
+ * @param statistics Always `NULL`, as this query does not use statistic data.
+ * @param instance   Query instance to be executed.
+ * @param output     Where to output query results to.
+ *
+ * @retval 0 Always successful.
+ */
+int q02_execute(const database_t       *database,
+                const void             *statistics,
+                const query_instance_t *instance,
+                query_writer_t         *output);
+
 #endif
@@ -43,4 +43,20 @@
  */
 query_type_t *q03_create(void);
 
+/**
+ * @brief Method called to execute a query of type 3.
+ *
+ * @param database   Database to get the hotel's average rating from.
+ * @param statistics Statistical data (not used, as ratings are aggregated per hotel in
+ *                   @p database).
+ * @param instance   Query instance to be executed.
+ * @param output     Where to write the query's result to.
+ *
+ * @retval 0 Always successful.
+ */
+int q03_execute(const database_t       *database,
+                const void             *statistics,
+                const query_instance_t *instance,
+                query_writer_t         *output);
+
 #endif
@@ -43,4 +43,20 @@
  */
 query_type_t *q04_create(void);
 
+/**
+ * @brief Method called to execute a query of type 4.
+ *
+ * @param database   Database to get the hotel's reservations from.
+ * @param statistics Reservations grouped by ::__q04_generate_statistics, or `NULL` for them to be
+ *                   looked up in the index of @p database.
+ * @param instance   Query instance to be executed.
+ * @param output     Where to write the query's result to.
+ *
+ * @retval 0 Always successful.
+ */
+int q04_execute(const database_t       *database,
+                const void             *statistics,
+                const query_instance_t *instance,
+                query_writer_t         *output);
+
 #endif
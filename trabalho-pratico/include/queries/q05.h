@@ -44,4 +44,20 @@
  */
 query_type_t *q05_create(void);
 
+/**
+ * @brief Method called to execute a query of type 5.
+ *
+ * @param database   Database to get the airport's flights from.
+ * @param statistics Statistical data (not used, as the airport's flights are indexed in
+ *                   @p database).
+ * @param instance   Query instance to be executed.
+ * @param output     Where to write the query's result to.
+ *
+ * @retval 0 Always successful.
+ */
+int q05_execute(const database_t       *database,
+                const void             *statistics,
+                const query_instance_t *instance,
+                query_writer_t         *output);
+
 #endif
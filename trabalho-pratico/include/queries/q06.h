@@ -43,4 +43,21 @@
  */
 query_type_t *q06_create(void);
 
+/**
+ * @brief   Executes a query of type 6.
+ * @details Prints the top N airports with the most passangers in a given year.
+ *
+ * @param database   Database to get the ranked airports of the year from.
+ * @param statistics Statistical data (not used, as airports are ranked by passengers in
+ *                   @p database).
+ * @param instance   Query instance to be executed.
+ * @param output     Where to write the query's result to.
+ *
+ * @retval 0 Always successful.
+ */
+int q06_execute(const database_t       *database,
+                const void             *statistics,
+                const query_instance_t *instance,
+                query_writer_t         *output);
+
 #endif
@@ -41,4 +41,21 @@
  */
 query_type_t *q07_create(void);
 
+/**
+ * @brief Executes a query of type 7.
+ *
+ * @param database   Database to get data from (not used, as all data is collected in
+ *                   ::__q07_generate_statistics).
+ * @param statistics Value returned by ::__q07_generate_statistics (a pointer to a
+ *                   ::q07_statistical_data_t).
+ * @param instance   Query instance to be executed.
+ * @param output     Where to write the query's output to.
+ *
+ * @retval 0 Always successful.
+ */
+int q07_execute(const database_t       *database,
+                const void             *statistics,
+                const query_instance_t *instance,
+                query_writer_t         *output);
+
 #endif
@@ -47,4 +47,32 @@
  */
 query_type_t *q08_create(void);
 
+/**
+ * @brief   Checks that every implementation of the revenue kernel gives the same results.
+ * @details The kernel that sums the revenue of the reservations of a hotel has SIMD
+ *          implementations, chosen at runtime (see [cpu_features](@ref cpu_features.h)). Each one
+ *          the CPU supports is run on generated reservations and date ranges, and compared with the
+ *          scalar one.
+ *
+ * @retval 0 All implementations agree.
+ * @retval 1 Some implementation gave a different result.
+ */
+int q08_verify_revenue_kernels(void);
+
+/**
+ * @brief Method called to execute a query of type 8.
+ *
+ * @param database   Database to get the hotel's reservations from.
+ * @param statistics Statistical data (not used, as the hotel's reservations are indexed in
+ *                   @p database).
+ * @param instance   Query instance to be executed.
+ * @param output     Where to write the query's result to.
+ *
+ * @retval 0 Always successful.
+ */
+int q08_execute(const database_t       *database,
+                const void             *statistics,
+                const query_instance_t *instance,
+                query_writer_t         *output);
+
 #endif
@@ -45,4 +45,22 @@
  */
 query_type_t *q09_create(void);
 
+/**
+ * @brief   Executes a query of type 9.
+ * @details Users are looked up in the name index of @p database, and sorted by their precomputed
+ *          collation order.
+ *
+ * @param database   Database to get the users from.
+ * @param statistics Statistical data (not used, as users are indexed by name in @p database).
+ * @param instance   Query instance to be executed.
+ * @param output     Where to write the query's output to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int q09_execute(const database_t       *database,
+                const void             *statistics,
+                const query_instance_t *instance,
+                query_writer_t         *output);
+
 #endif
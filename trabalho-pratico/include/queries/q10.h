@@ -43,4 +43,24 @@
  */
 query_type_t *q10_create(void);
 
+/**
+ * @brief   Method called to execute a query of type 10.
+ * @details Every count is read from the database's time cube (see ::database_get_time_cube), kept
+ *          up to date as entities are added, so there's no statistical data to generate. The
+ *          months or days of a year outside the time cube's range are counted by scanning the
+ *          database's users, flights and reservations instead.
+ *
+ * @param database   Database to get data from.
+ * @param statistics Not used (always `NULL`).
+ * @param instance   Query instance to be executed.
+ * @param output     Where to write the query's result to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failed to scan the database (should, in principle, be unreachable).
+ */
+int q10_execute(const database_t       *database,
+                const void             *statistics,
+                const query_instance_t *instance,
+                query_writer_t         *output);
+
 #endif
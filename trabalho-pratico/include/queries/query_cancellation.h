@@ -0,0 +1,141 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    query_cancellation.h
+ * @brief   A way to stop queries that are taking too long, from another thread or by a deadline.
+ * @details Queries are stopped cooperatively: a ::query_cancellation_t is attached to query
+ *          instances (see ::query_instance_set_cancellation), and long loops in queries (and in the
+ *          iterations through database managers they start) check it every
+ *          ::QUERY_CANCELLATION_CHECK_INTERVAL items (see ::query_instance_is_cancelled). The
+ *          dispatcher also checks it before generating statistical data and before executing each
+ *          query. A cancelled query stops as soon as possible, and its output is marked as
+ *          incomplete (see ::query_writer_is_incomplete).
+ *
+ *          Queries are cancelled explicitly, from any thread, with ::query_cancellation_cancel, or
+ *          once the deadline chosen with ::query_cancellation_start is reached. The default time
+ *          budget of a query is chosen with ::QUERY_CANCELLATION_TIMEOUT_ENVIRONMENT_VARIABLE.
+ *
+ * @anchor query_cancellation_examples
+ * ### Examples
+ *
+ * ```c
+ * query_cancellation_t *cancellation = query_cancellation_create();
+ * if (!cancellation)
+ *     return 1;
+ *
+ * query_instance_set_cancellation(query, cancellation);
+ * query_cancellation_start(cancellation, query_cancellation_get_default_timeout());
+ *
+ * // Another thread may call query_cancellation_cancel(cancellation) meanwhile
+ * query_dispatcher_dispatch_single(database, query, output, NULL, NULL, NULL);
+ * if (query_writer_is_incomplete(output))
+ *     puts(query_cancellation_has_timed_out(cancellation) ? "Timed out" : "Cancelled");
+ *
+ * query_cancellation_free(cancellation);
+ * ```
+ */
+
+#ifndef QUERY_CANCELLATION_H
+#define QUERY_CANCELLATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Environment variable with the default time budget of queries, in milliseconds. Queries
+ *        have no time budget if it's unset or `0`.
+ */
+#define QUERY_CANCELLATION_TIMEOUT_ENVIRONMENT_VARIABLE "LI3_QUERY_TIMEOUT"
+
+/**
+ * @brief   Number of items processed by a loop between checks for cancellation.
+ * @details Checking reads the clock, so it's not done for every item.
+ */
+#define QUERY_CANCELLATION_CHECK_INTERVAL 4096
+
+/** @brief A way to stop queries that are taking too long. */
+typedef struct query_cancellation query_cancellation_t;
+
+/**
+ * @brief  Creates a cancellation that isn't cancelled and has no deadline.
+ * @return A pointer to a new ::query_cancellation_t, that must be `free`d with
+ *         ::query_cancellation_free, or `NULL` on allocation failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_cancellation_examples).
+ */
+query_cancellation_t *query_cancellation_create(void);
+
+/**
+ * @brief  Gets the default time budget of queries.
+ * @return The value of ::QUERY_CANCELLATION_TIMEOUT_ENVIRONMENT_VARIABLE, in milliseconds, or `0`
+ *         (no time budget) if it's unset or invalid.
+ */
+uint64_t query_cancellation_get_default_timeout(void);
+
+/**
+ * @brief   Prepares a cancellation for new queries to be run.
+ * @details Any previous cancellation is undone. Mustn't be called while queries that check
+ *          @p cancellation are running.
+ *
+ * @param cancellation Cancellation to be modified.
+ * @param timeout      Milliseconds from now after which queries are cancelled, or `0` for no
+ *                     deadline.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_cancellation_examples).
+ */
+void query_cancellation_start(query_cancellation_t *cancellation, uint64_t timeout);
+
+/**
+ * @brief   Cancels all queries that check a cancellation.
+ * @details Can be called from any thread, while queries are running.
+ * @param   cancellation Cancellation to be cancelled.
+ */
+void query_cancellation_cancel(query_cancellation_t *cancellation);
+
+/**
+ * @brief   Checks if queries should stop.
+ * @details Can be called from any thread. The clock is read if there's a deadline.
+ *
+ * @param cancellation Cancellation to be checked. Can be `NULL`, for queries that can't be
+ *                     cancelled.
+ *
+ * @return Whether ::query_cancellation_cancel was called, or the deadline was reached.
+ */
+int query_cancellation_is_cancelled(const query_cancellation_t *cancellation);
+
+/**
+ * @brief  Checks if the deadline of a cancellation was reached.
+ * @param  cancellation Cancellation to be checked.
+ * @return Whether the deadline chosen with ::query_cancellation_start was reached.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_cancellation_examples).
+ */
+int query_cancellation_has_timed_out(const query_cancellation_t *cancellation);
+
+/**
+ * @brief Frees memory used by a cancellation.
+ * @param cancellation Cancellation to be freed.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_cancellation_examples).
+ */
+void query_cancellation_free(query_cancellation_t *cancellation);
+
+#endif
@@ -33,6 +33,8 @@
 
 #include "database/database.h"
 #include "queries/query_instance_list.h"
+#include "queries/query_materializer.h"
+#include "queries/query_statistics_cache.h"
 #include "testing/performance_metrics.h"
 
 /**
@@ -40,32 +42,82 @@
  * @details If you want to run multiple queries, do not call this method multiple times, as that
  *          will be very innefficient. Queries generate statistical data, shared by all queries of
  *          the same type to improve performance. That can only be taken advantage of by using
- *          ::query_dispatcher_dispatch_list.
+ *          ::query_dispatcher_dispatch_list. For queries run one at a time, provide a
+ *          @p statistics_cache, so that statistical data is reused between queries.
  *
- * @param database       Database, so that the query can get information.
- * @param query_instance Query to be run.
- * @param output         Where the query's result should be written to.
+ *          The arguments of @p query_instance aren't copied, and remain owned by the caller. If
+ *          it's slow, the query is written to the shared slow query log (see
+ *          ::query_slow_log_set_shared).
+ *
+ * @param database         Database, so that the query can get information.
+ * @param query_instance   Query to be run.
+ * @param output           Where the query's result should be written to.
+ * @param statistics_cache Cache of statistical data created for @p database. Can be `NULL`, so
+ *                         that statistical data is generated for this query only.
+ * @param materializer     Rendered outputs of queries on @p database. Can be `NULL`, for the query
+ *                         to always be executed.
+ * @param metrics          Where to write profiling data to. Can be `NULL` for no profiling. Queries
+ *                         written by @p materializer aren't measured.
  *
  * @retval 0 Query preparation success. Running the query itself might have silently failed.
  * @retval 1 Allocation failure or invalid @p query_instance.
  */
-int query_dispatcher_dispatch_single(const database_t       *database,
-                                     const query_instance_t *query_instance,
-                                     query_writer_t         *output);
+int query_dispatcher_dispatch_single(const database_t         *database,
+                                     const query_instance_t   *query_instance,
+                                     query_writer_t           *output,
+                                     query_statistics_cache_t *statistics_cache,
+                                     query_materializer_t     *materializer,
+                                     performance_metrics_t    *metrics);
+
+/**
+ * @brief   Type of the method called when queries are done being executed.
+ * @details Lets their outputs be written to disk while other queries are still being executed
+ *          (see ::query_writer_flush). Calls are never concurrent, but they happen in no particular
+ *          order and from a thread other than the one that called ::query_dispatcher_dispatch_list.
+ *
+ * @param user_data Argument passed to ::query_dispatcher_dispatch_list.
+ * @param n         Number of queries in @p instances.
+ * @param instances Queries that are done being executed.
+ * @param outputs   Writers with the complete output of each query in @p instances.
+ */
+typedef void (*query_dispatcher_flush_callback_t)(void                         *user_data,
+                                                  size_t                        n,
+                                                  const query_instance_t *const instances[n],
+                                                  query_writer_t *const         outputs[n]);
 
 /**
- * @brief Runs a list of queries.
+ * @brief   Runs a list of queries.
+ * @details Queries are run by a pool of threads (as many as the queries stage may use, see
+ *          ::thread_pool_get_stage_thread_count, including the calling thread).
+ *          Statistical data for different query types can be generated at the same time, and the
+ *          queries of the same type are split between threads once their statistics are ready.
+ *          Because of that, query implementations musn't modify the database nor any global state.
+ *          Queries on a database that isn't frozen (see ::database_is_frozen) are all run by the
+ *          calling thread.
+ *          Executed queries are handed over to @p flush by a thread of its own, through a bounded
+ *          queue, so that statistics generation, query execution and output writing form a
+ *          pipeline.
+ *          Queries slower than the threshold of the shared slow query log (see
+ *          ::query_slow_log_set_shared) are written to it.
  *
  * @param database            Database, so that the queries can get information.
  * @param query_instance_list List of queries to be run. Cannot be `const`, as this list may get
  *                            sorted. However, no new items will be added to it.
  * @param outputs             Where the queries' results will be written to. These should be in
  *                            the same order as @p query_instance_list after being sorted.
+ * @param materializer        Rendered outputs of queries on @p database. Can be `NULL`, for all
+ *                            queries to be executed.
  * @param metrics             Where to write profiling data to. Can be `NULL` for no profiling.
+ * @param flush               Method called with the outputs of executed queries. Can be `NULL`,
+ *                            for outputs to be left as they are.
+ * @param flush_data          Argument passed to @p flush.
  */
-void query_dispatcher_dispatch_list(const database_t      *database,
-                                    query_instance_list_t *query_instance_list,
-                                    query_writer_t *const *outputs,
-                                    performance_metrics_t *metrics);
+void query_dispatcher_dispatch_list(const database_t                 *database,
+                                    query_instance_list_t            *query_instance_list,
+                                    query_writer_t *const            *outputs,
+                                    query_materializer_t             *materializer,
+                                    performance_metrics_t            *metrics,
+                                    query_dispatcher_flush_callback_t flush,
+                                    void                             *flush_data);
 
 #endif
@@ -0,0 +1,210 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    query_explain.h
+ * @brief   Reports of how queries were executed: their access paths and the records they touched.
+ * @details Timings (see [the slow query log](@ref query_slow_log.h)) don't tell whether a slow
+ *          query used an index or scanned a whole manager. Explained queries get a line appended to
+ *          a report, with:
+ *
+ *          - The access path chosen by the dispatcher (see ::query_explain_path_t);
+ *          - Whether statistical data was found in a
+ *            [statistics cache](@ref query_statistics_cache.h), when one was used;
+ *          - The costs predicted by the query type's cost model (see
+ *            ::query_type_cost_model_callback_t), and the cost of the chosen path next to the
+ *            actual time spent;
+ *          - The records scanned and the lookups in each manager (see
+ *            [performance_access](@ref performance_access.h)), while generating statistical data
+ *            (shared by all queries in a set) and while executing the query;
+ *          - The number of records emitted and the size of the output.
+ *
+ *          The outputs of queries are never changed. Queries are explained when preceded by
+ *          ::QUERY_PARSER_EXPLAIN_PREFIX (see ::query_instance_get_explain), or when the report
+ *          explains every query. There's a report shared by the whole program
+ *          (::query_explain_set_shared), used by ::query_dispatcher_dispatch_list and
+ *          ::query_dispatcher_dispatch_single. When none is set, prefixed queries are reported to
+ *          `stderr`.
+ *
+ *          Queries are identified by their line (::query_instance_get_line_in_file) and type.
+ *          Queries explained in a set of queries of the same type aren't executed in batches (see
+ *          ::query_type_execute_batch_callback_t), so that each one is measured separately.
+ *
+ * @anchor query_explain_examples
+ * ### Examples
+ *
+ * ```c
+ * query_explain_t *explain = query_explain_create("explain.log", 1); // Every query
+ * if (!explain)
+ *     return 1;
+ *
+ * query_explain_set_shared(explain);
+ * query_dispatcher_dispatch_list(database, list, outputs, NULL, NULL, NULL, NULL);
+ * query_explain_set_shared(NULL);
+ *
+ * query_explain_free(explain);
+ * ```
+ *
+ * A line of the report looks like this (in a single line):
+ *
+ * ```text
+ * line=3 type=4 path=scan statistics_cache=none estimated_us=310 actual_us=284
+ *     index_cost_us=5120 scan_cost_us=1240 statistics_us=1120 shared=4 execution_us=4 rows=12
+ *     output_bytes=640 statistics_scanned=reservations:1000000 statistics_probes=0 scanned=0
+ *     probes=reservations:1
+ * ```
+ */
+
+#ifndef QUERY_EXPLAIN_H
+#define QUERY_EXPLAIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "queries/query_instance.h"
+#include "testing/performance_access.h"
+
+/** @brief Report of how queries were executed. */
+typedef struct query_explain query_explain_t;
+
+/** @brief How a query got to the data it needed. */
+typedef enum {
+    QUERY_EXPLAIN_PATH_DIRECT,       /**< @brief Query type without statistical data. */
+    QUERY_EXPLAIN_PATH_STATISTICS,   /**< @brief Statistical data, without a cost model. */
+    QUERY_EXPLAIN_PATH_SCAN,         /**< @brief Statistical data, predicted to be cheaper. */
+    QUERY_EXPLAIN_PATH_INDEX,        /**< @brief Lookups by every query, predicted to be cheaper. */
+    QUERY_EXPLAIN_PATH_MATERIALIZED, /**< @brief Output written from memory, not executed. */
+} query_explain_path_t;
+
+/** @brief How statistical data was found in a [statistics cache](@ref query_statistics_cache.h). */
+typedef enum {
+    QUERY_EXPLAIN_CACHE_NONE, /**< @brief No statistics cache was used. */
+    QUERY_EXPLAIN_CACHE_HIT,  /**< @brief Statistical data was in the cache. */
+    QUERY_EXPLAIN_CACHE_MISS, /**< @brief Statistical data was generated and added to the cache. */
+} query_explain_cache_t;
+
+/**
+ * @struct query_explain_entry_t
+ * @brief  How a query was executed, to be written to a ::query_explain_t.
+ *
+ * @var query_explain_entry_t::query
+ *     @brief Query that was run.
+ * @var query_explain_entry_t::path
+ *     @brief Access path of the query.
+ * @var query_explain_entry_t::statistics_cache
+ *     @brief How statistical data was found in a statistics cache.
+ * @var query_explain_entry_t::estimated
+ *     @brief Whether the costs below were predicted by a cost model.
+ * @var query_explain_entry_t::index_cost
+ *     @brief Predicted nanoseconds to execute all ::query_explain_entry_t::shared queries
+ *            without statistical data.
+ * @var query_explain_entry_t::scan_cost
+ *     @brief Predicted nanoseconds to generate statistical data for all
+ *            ::query_explain_entry_t::shared queries and to execute them with it.
+ * @var query_explain_entry_t::shared
+ *     @brief Number of queries the predictions and statistical data were for.
+ * @var query_explain_entry_t::statistics_time
+ *     @brief Nanoseconds spent generating (or looking up) statistical data.
+ * @var query_explain_entry_t::execution_time
+ *     @brief Nanoseconds spent executing the query, including formatting its output.
+ * @var query_explain_entry_t::statistics_access
+ *     @brief Records read while generating statistical data.
+ * @var query_explain_entry_t::execution_access
+ *     @brief Records read while executing the query.
+ * @var query_explain_entry_t::rows
+ *     @brief Number of records emitted by the query.
+ * @var query_explain_entry_t::output_size
+ *     @brief Number of bytes of output.
+ */
+typedef struct {
+    const query_instance_t *query;
+    query_explain_path_t    path;
+    query_explain_cache_t   statistics_cache;
+    int                     estimated;
+    uint64_t                index_cost, scan_cost;
+    size_t                  shared;
+    uint64_t                statistics_time, execution_time;
+    performance_access_t    statistics_access, execution_access;
+    size_t                  rows, output_size;
+} query_explain_entry_t;
+
+/**
+ * @brief   Opens a report of how queries were executed.
+ * @details The returned value is owned by the caller, and should be freed with
+ *          ::query_explain_free. The report file is appended to, if it already exists.
+ *
+ * @param path Path to the report file.
+ * @param all  Whether every query is explained, and not only those preceded by
+ *             ::QUERY_PARSER_EXPLAIN_PREFIX.
+ *
+ * @return A new report, or `NULL` on allocation or IO failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_explain_examples).
+ */
+query_explain_t *query_explain_create(const char *path, int all);
+
+/**
+ * @brief  Checks if a query is to be explained in a report.
+ *
+ * @param  explain Report to be checked.
+ * @param  query   Query to be checked.
+ *
+ * @return Whether @p explain explains every query, or @p query was preceded by
+ *         ::QUERY_PARSER_EXPLAIN_PREFIX.
+ */
+int query_explain_is_explained(const query_explain_t *explain, const query_instance_t *query);
+
+/**
+ * @brief   Writes how a query was executed to a report.
+ * @details Thread-safe. IO errors are ignored, as reporting mustn't make queries fail.
+ *
+ * @param explain Report to write to.
+ * @param entry   How the query was executed.
+ */
+void query_explain_write(query_explain_t *explain, const query_explain_entry_t *entry);
+
+/**
+ * @brief   Sets the report used when dispatching queries.
+ * @details Must be set before any queries are dispatched, and not while they're being run. The
+ *          report isn't owned by the program, and must be freed by the caller after being unset.
+ *
+ * @param explain Report of how queries were executed, or `NULL` for prefixed queries to be
+ *                reported to `stderr`.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_explain_examples).
+ */
+void query_explain_set_shared(query_explain_t *explain);
+
+/**
+ * @brief  Gets the report used when dispatching queries.
+ * @return The report set with ::query_explain_set_shared, or one that writes the queries preceded
+ *         by ::QUERY_PARSER_EXPLAIN_PREFIX to `stderr`, if there's none. Never `NULL`.
+ */
+query_explain_t *query_explain_get_shared(void);
+
+/**
+ * @brief Closes a report of how queries were executed and frees memory used by it.
+ * @param explain Report to be freed. Can be `NULL`.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_explain_examples).
+ */
+void query_explain_free(query_explain_t *explain);
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    query_file_compiler.h
+ * @brief   Compiled (binary) forms of query files, that are loaded without being parsed again.
+ * @details Parsing a large query file (see [query_file_parser](@ref query_file_parser.h)) means
+ *          tokenizing every line, parsing its query type, and building its canonical form. A query
+ *          file's compiled form stores the result of that: a record per query, already grouped by
+ *          type (in line order), with its line number, type number, flags (formatted and explain),
+ *          and its arguments, already split, in its canonical form. Loading it only needs the
+ *          arguments of each query to be handed to its type's
+ *          ::query_type_parse_arguments_callback_t, so changes to how arguments are parsed don't
+ *          require recompilation.
+ *
+ *          The text file is always the source of truth. Compiled forms are only used when
+ *          ::QUERY_FILE_COMPILER_CACHE_ENVIRONMENT_VARIABLE names a cache directory (created if
+ *          needed), where each one is named after a hash of the text file's absolute path (with
+ *          ::QUERY_FILE_COMPILER_EXTENSION appended), so that nothing is written next to the query
+ *          file. A compiled form is stored along with the size and modification time of the text
+ *          file it was compiled from. When those don't match (or the compiled form doesn't exist,
+ *          or is of another format version), the text file is parsed, and compiled again. Failing
+ *          to store the compiled form isn't an error, as it's only a cache.
+ *
+ * @anchor query_file_compiler_examples
+ * ### Examples
+ *
+ * See batch_mode.c, where whole query files are parsed through their compiled forms.
+ */
+
+#ifndef QUERY_FILE_COMPILER_H
+#define QUERY_FILE_COMPILER_H
+
+#include <stdio.h>
+
+#include "queries/query_instance_list.h"
+
+/** @brief Extension of the names of compiled forms, in the cache directory. */
+#define QUERY_FILE_COMPILER_EXTENSION ".compiled"
+
+/**
+ * @brief Environment variable with the directory where compiled forms are stored. Query files are
+ *        always parsed from text if it's unset or empty.
+ */
+#define QUERY_FILE_COMPILER_CACHE_ENVIRONMENT_VARIABLE "LI3_QUERY_FILE_CACHE"
+
+/**
+ * @brief   Parses a file containing a query in each line, through its compiled form.
+ * @details The resulting list is the same as the one returned by ::query_file_parser_parse, with
+ *          the same duplicates. If the compiled form is outdated, @p input is parsed, and the
+ *          compiled form is stored again. If there's no cache directory (see
+ *          ::QUERY_FILE_COMPILER_CACHE_ENVIRONMENT_VARIABLE), @p input is always parsed.
+ *
+ * @param path  Path to the query file, that identifies its compiled form.
+ * @param input Query file (already opened from @p path), only read if the compiled form is
+ *              outdated.
+ *
+ * @return A pointer to a ::query_instance_list_t, that must later be `free`'d by
+ *         ::query_instance_list_free, or `NULL` on allocation failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_file_compiler_examples).
+ */
+query_instance_list_t *query_file_compiler_parse(const char *path, FILE *input);
+
+#endif
@@ -24,6 +24,22 @@
  * To parse a file with queries, open the file with `fopen` and pass it to
  * ::query_file_parser_parse. In the end, don't forget to close the file and to free the resulting
  * ::query_instance_list_t using ::query_instance_list_free. See batch_mode.c for a code example.
+ *
+ * Large files don't need to be parsed all at once. ::query_file_parser_parse_window parses only a
+ * window of consecutive lines, and can be called repeatedly until the end of the file:
+ *
+ * ```c
+ * size_t line_number = 1, window_start;
+ * do {
+ *     window_start                = line_number;
+ *     query_instance_list_t *list = query_file_parser_parse_window(file, 1024, &line_number);
+ *     if (!list)
+ *         break;
+ *
+ *     // Use list
+ *     query_instance_list_free(list);
+ * } while (line_number - window_start == 1024);
+ * ```
  */
 
 #ifndef QUERY_FILE_PARSER_H
@@ -36,7 +52,10 @@
 /**
  * @brief   Parses a file containg a query in each line.
  * @details Queries whose parsing fails will neither appear on the returned list nor be reported be
- *          as errors.
+ *          as errors. Repeated queries (same type, formatting and arguments) are only added once
+ *          to the list, and the others are kept track of as duplicates (see
+ *          ::query_instance_list_add_unique). Large regular files are split into chunks at line
+ *          boundaries, parsed in parallel by multiple threads.
  *
  * @param  input Input file stream to be read.
  * @return A pointer to a ::query_instance_list_t, that must later be `free`'d by
@@ -47,4 +66,26 @@
  */
 query_instance_list_t *query_file_parser_parse(FILE *input);
 
+/**
+ * @brief   Parses a window of consecutive lines of a file containg a query in each line.
+ * @details Parsing starts at the current position of @p input, and stops after @p max_lines lines,
+ *          leaving @p input positioned at the beginning of the next line. Like in
+ *          ::query_file_parser_parse, lines that fail to be parsed are ignored, and repeated
+ *          queries are kept track of as duplicates (only the ones in the same window, though).
+ *
+ * @param input       Input file stream to be read.
+ * @param max_lines   Maximum number of lines to be read.
+ * @param line_number Number of the first line in the window, on input. On output, the number of
+ *                    the line after the last one read. If less than @p max_lines lines were read,
+ *                    the end of the file was reached.
+ *
+ * @return A pointer to a ::query_instance_list_t, that must later be `free`'d by
+ *         ::query_instance_list_free, or `NULL` on allocation failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_file_parser_examples).
+ */
+query_instance_list_t *
+    query_file_parser_parse_window(FILE *input, size_t max_lines, size_t *line_number);
+
 #endif
@@ -28,7 +28,8 @@
  * - ::query_instance_set_formatted;
  * - ::query_instance_set_line_in_file (use 1 if not a query in a file);
  * - ::query_instance_set_argument_data (using the ::query_type_parse_arguments_callback_t method
- *   for your query type).
+ *   for your query type). Argument data isn't owned by the query instance: it lives in the
+ *   ::arena_t it was parsed into, which must outlive the instance.
  *
  * To run the query you created, see ::query_dispatcher_dispatch_single. In the end, don't forget to
  * call ::query_instance_free.
@@ -51,7 +52,9 @@
 #endif
 /* clang-format on */
 
+#include "queries/query_cancellation.h"
 #include "queries/query_type.h"
+#include "utils/pool.h"
 
 /**
  * @brief  Creates a new query instance.
@@ -61,12 +64,19 @@
 query_instance_t *query_instance_create(void);
 
 /**
- * @brief  Creates a deep copy of a query instance.
- * @param  query Query to be copied.
- * @return A pointer to a copy of @p query, that must be `free`d with ::query_instance_free, `NULL`
- *         on allocation failure / or invalid query type.
+ * @brief   Creates a copy of a query instance.
+ * @details Argument data isn't copied, as it's not owned by @p query. The copy refers to the same
+ *          arguments as @p query.
+ *
+ * @param allocator Pool where to allocate the copy. Its element size must be the value returned by
+ *                  ::query_instance_sizeof. Can be `NULL`, so that malloc is used instead of a
+ *                  pool.
+ * @param query     Query to be copied.
+ *
+ * @return A pointer to a copy of @p query, that must be `free`d with ::query_instance_free if
+ *         @p allocator is `NULL`. `NULL` is returned on allocation failure.
  */
-query_instance_t *query_instance_clone(const query_instance_t *query);
+query_instance_t *query_instance_clone(pool_t *allocator, const query_instance_t *query);
 
 /**
  * @brief Sets the type of a query instance.
@@ -82,6 +92,13 @@ void query_instance_set_type(query_instance_t *query, const query_type_t *type);
  */
 void query_instance_set_formatted(query_instance_t *query, int formatted);
 
+/**
+ * @brief Sets whether a query should be explained (see [query_explain](@ref query_explain.h)).
+ * @param query   Query instance to have its explain flag set.
+ * @param explain Whether the access paths and records touched by @p query should be reported.
+ */
+void query_instance_set_explain(query_instance_t *query, int explain);
+
 /**
  * @brief Sets the number of the line a query instance was on.
  * @param query        Query instance to have its line number in the file set.
@@ -93,15 +110,27 @@ void query_instance_set_line_in_file(query_instance_t *query, size_t line_in_fil
 /**
  * @brief   Adds parsed arguments to a query. Its data type will depend on the query's type.
  * @details For any query instance, ::query_instance_set_type must be called before this setter.
+ *          @p argument_data isn't copied, so it must outlive @p query.
  *
  * @param query           Query instance to have its arguments set.
  * @param argument_data   Data resulting from parsing the query's arguments.
  *
  * @retval 0 Success.
- * @retval 1 Allocation failure or query type not set.
+ * @retval 1 Query type not set.
  */
 int query_instance_set_argument_data(query_instance_t *query, const void *argument_data);
 
+/**
+ * @brief   Sets what a query checks to know if it should stop.
+ * @details @p cancellation isn't copied, so it must outlive @p query. Clones of @p query share it.
+ *
+ * @param query        Query instance to have its cancellation set.
+ * @param cancellation Cancellation to be checked by @p query. `NULL` (the default) for a query
+ *                     that can't be cancelled.
+ */
+void query_instance_set_cancellation(query_instance_t           *query,
+                                     const query_cancellation_t *cancellation);
+
 /**
  * @brief  Gets the type of a query instance.
  * @param  query Query instance to get the type from.
@@ -116,6 +145,13 @@ const query_type_t *query_instance_get_type(const query_instance_t *query);
  */
 int query_instance_get_formatted(const query_instance_t *query);
 
+/**
+ * @brief  Gets whether a query should be explained.
+ * @param  query Query instance to get the explain flag from.
+ * @return Whether @p query was prefixed with `EXPLAIN` (see ::query_instance_set_explain).
+ */
+int query_instance_get_explain(const query_instance_t *query);
+
 /**
  * @brief  Gets the number of the line a query instance was on.
  * @param  query Query instance to get the line number from.
@@ -132,7 +168,33 @@ size_t query_instance_get_line_in_file(const query_instance_t *query);
 const void *query_instance_get_argument_data(const query_instance_t *query);
 
 /**
- * @brief Frees memory used by a query instance.
+ * @brief  Gets what a query checks to know if it should stop.
+ * @param  query Query instance to get the cancellation from.
+ * @return The cancellation of @p query, or `NULL` if it can't be cancelled.
+ */
+const query_cancellation_t *query_instance_get_cancellation(const query_instance_t *query);
+
+/**
+ * @brief   Checks if a query should stop.
+ * @details Reads the clock when there's a deadline, so long loops should only call this every
+ *          ::QUERY_CANCELLATION_CHECK_INTERVAL iterations.
+ *
+ * @param  query Query instance to be checked.
+ * @return Whether @p query was cancelled or timed out (see ::query_cancellation_is_cancelled).
+ */
+int query_instance_is_cancelled(const query_instance_t *query);
+
+/**
+ * @brief   Gets the size of a ::query_instance_t in memory.
+ * @details Useful for pool allocation.
+ * @return  `sizeof(query_instance_t)`.
+ */
+size_t query_instance_sizeof(void);
+
+/**
+ * @brief   Frees memory used by a query instance.
+ * @details Only call this for instances not allocated in a pool. Argument data isn't freed, as it's
+ *          not owned by @p query.
  * @param query Query instance to be `free`d.
  */
 void query_instance_free(query_instance_t *query);
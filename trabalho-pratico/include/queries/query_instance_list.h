@@ -36,11 +36,19 @@
  * }
  * ```
  *
- * - Add query instances to it, using ::query_instance_list_add.
+ * - Add query instances to it, using ::query_instance_list_add. Their arguments must have been
+ *   parsed into the arena returned by ::query_instance_list_get_argument_allocator, so that they
+ *   live as long as the list.
+ * - Alternatively, use ::query_instance_list_add_unique, which only adds a query if no identical
+ *   query (with the same canonical form) was added before. Duplicate queries can be listed with
+ *   ::query_instance_list_iter_duplicates, so that their output can be copied from the output of
+ *   the identical query that was kept.
  * - When done using the list, free it with ::query_instance_list_free.
  *
- * There are two types of list iterations. Before any of these iterations, the list will be sorted
- * by query type order.
+ * There are two types of list iterations. In both, queries are grouped by type (in type number
+ * order), and queries of the same type are in line order. Queries are kept in a bucket per type as
+ * they're added, so this grouping doesn't require sorting the list. Only queries added out of line
+ * order require a bucket to be sorted before the first iteration.
  *
  * - Query by query iteration using ::query_instance_list_iter. An example of this can be found in
  *   batch_mode.c, to open all files to write query outputs in.
@@ -57,7 +65,7 @@
  *   5 | 3  Erin
  *   ```
  *
- *   This will be sorted, becoming:
+ *   This will be grouped, becoming:
  *
  *   ```text
  *   1 | 1  Alice
@@ -75,6 +83,7 @@
 #define QUERY_INSTANCE_LIST_H
 
 #include "queries/query_instance.h"
+#include "utils/arena.h"
 
 /** @brief A list of ::query_instance_t, sorted by query type. */
 typedef struct query_instance_list query_instance_list_t;
@@ -106,6 +115,48 @@ typedef int (*query_instance_list_iter_types_callback)(void
  */
 typedef int (*query_instance_list_iter_callback)(void *user_data, const query_instance_t *instance);
 
+/**
+ * @brief Method called for every duplicate query, used by ::query_instance_list_iter_duplicates.
+ *
+ * @param user_data    Pointer, kept from call to call, so that this callback can modify the
+ *                     program's state.
+ * @param original     Query in the list identical to the duplicate query.
+ * @param line_in_file Number of the line the duplicate query was on.
+ *
+ * @return `0` on success, another value for immediate termination of iteration.
+ */
+typedef int (*query_instance_list_iter_duplicates_callback)(void                   *user_data,
+                                                            const query_instance_t *original,
+                                                            size_t                  line_in_file);
+
+/**
+ * @brief Method called for every query added with ::query_instance_list_add_unique, used by
+ *        ::query_instance_list_iter_keys.
+ *
+ * @param user_data  Pointer, kept from call to call, so that this callback can modify the
+ *                   program's state.
+ * @param instance   Query instance.
+ * @param key        Canonical form of @p instance (not null-terminated).
+ * @param key_length Number of bytes in @p key.
+ *
+ * @return `0` on success, another value for immediate termination of iteration.
+ */
+typedef int (*query_instance_list_iter_keys_callback)(void                   *user_data,
+                                                      const query_instance_t *instance,
+                                                      const char             *key,
+                                                      size_t                  key_length);
+
+/**
+ * @brief Method that chooses which queries are kept by ::query_instance_list_clone_filtered.
+ *
+ * @param user_data Pointer passed to ::query_instance_list_clone_filtered.
+ * @param instance  Query instance.
+ *
+ * @return Whether @p instance should be kept in the clone.
+ */
+typedef int (*query_instance_list_filter_callback)(void                   *user_data,
+                                                   const query_instance_t *instance);
+
 /**
  * @brief  Creates an empty list of ::query_instance_t.
  * @return A pointer to a new ::query_instance_list_t that must be `free`d with
@@ -117,7 +168,11 @@ typedef int (*query_instance_list_iter_callback)(void *user_data, const query_in
 query_instance_list_t *query_instance_list_create(void);
 
 /**
- * @brief  Creates a deep copy of a list of query instances.
+ * @brief   Creates a copy of a list of query instances.
+ * @details Query instances are copied, but their (immutable) arguments are shared with @p list,
+ *          and only freed when the last list referring to them is freed. Lists sharing arguments
+ *          must not be freed concurrently.
+ *
  * @param  list List to be cloned.
  * @return A pointer to a new ::query_instance_list_t that must be `free`d with
  *         ::query_instance_list_free, or `NULL` on allocation failure.
@@ -125,7 +180,49 @@ query_instance_list_t *query_instance_list_create(void);
 query_instance_list_t *query_instance_list_clone(const query_instance_list_t *list);
 
 /**
- * @brief Copies a query instance into a list of query instances.
+ * @brief   Creates a copy of a part of a list of query instances.
+ * @details @p list is sorted (see ::query_instance_list_iter) and divided into @p n parts of
+ *          consecutive queries, with sizes differing by at most one. Because queries of the same
+ *          type are kept together, few query types end up spread over different parts. Like in
+ *          ::query_instance_list_clone, query arguments are shared with @p list.
+ *
+ * @param list List to be partially cloned. Cannot be constant, as internal sorting may occur.
+ * @param i    Index of the part to be cloned (less than @p n).
+ * @param n    Number of parts to divide @p list into.
+ *
+ * @return A pointer to a new ::query_instance_list_t that must be `free`d with
+ *         ::query_instance_list_free, or `NULL` on allocation failure.
+ */
+query_instance_list_t *
+    query_instance_list_clone_part(query_instance_list_t *list, size_t i, size_t n);
+
+/**
+ * @brief   Creates a copy of the queries in a list chosen by a callback.
+ * @details Like in ::query_instance_list_clone, query arguments are shared with @p list.
+ *
+ * @param list      List to be partially cloned.
+ * @param callback  Method called for every query in @p list, to choose whether it's cloned.
+ * @param user_data Value passed to @p callback.
+ *
+ * @return A pointer to a new ::query_instance_list_t that must be `free`d with
+ *         ::query_instance_list_free, or `NULL` on allocation failure.
+ */
+query_instance_list_t *
+    query_instance_list_clone_filtered(const query_instance_list_t        *list,
+                                       query_instance_list_filter_callback callback,
+                                       void                               *user_data);
+
+/**
+ * @brief  Gets the arena where arguments of queries in a list should be parsed into.
+ * @param  list List of query instances.
+ * @return The arena owned by @p list, that lives as long as @p list.
+ */
+arena_t *query_instance_list_get_argument_allocator(query_instance_list_t *list);
+
+/**
+ * @brief   Copies a query instance into a list of query instances.
+ * @details Arguments of @p query aren't copied, and must have been allocated in the arena returned
+ *          by ::query_instance_list_get_argument_allocator.
  *
  * @param list  List of query instances to add @p query to.
  * @param query Query instance to be added to @p list.
@@ -135,6 +232,41 @@ query_instance_list_t *query_instance_list_clone(const query_instance_list_t *li
  */
 int query_instance_list_add(query_instance_list_t *list, const query_instance_t *query);
 
+/**
+ * @brief   Makes a list of query instances the owner of an arena.
+ * @details Useful when query arguments can't be parsed into the arena returned by
+ *          ::query_instance_list_get_argument_allocator (e.g.: when parsing in multiple threads).
+ *          Queries whose arguments live in @p arena can then be added to @p list, and @p arena
+ *          will be freed along with the arguments of @p list (and of its clones).
+ *
+ * @param list  List of query instances that will own @p arena.
+ * @param arena Arena to be owned by @p list.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p arena isn't owned by @p list).
+ */
+int query_instance_list_adopt_arena(query_instance_list_t *list, arena_t *arena);
+
+/**
+ * @brief   Adds a query instance to a list, unless an identical query instance was already added.
+ * @details Two queries are identical if they have the same canonical form, @p key. It must
+ *          identify the query's type, whether its output is formatted, and its arguments. When
+ *          @p query is a duplicate, it's only registered for ::query_instance_list_iter_duplicates.
+ *          Clones of @p list don't keep track of duplicates.
+ *
+ * @param list       List of query instances to add @p query to.
+ * @param query      Query instance to be added to @p list. See ::query_instance_list_add.
+ * @param key        Canonical form of @p query. Doesn't need to be null-terminated.
+ * @param key_length Number of bytes in @p key.
+ *
+ * @retval 0 Success (@p query was added or registered as a duplicate).
+ * @retval 1 Allocation failure or invalid @p query.
+ */
+int query_instance_list_add_unique(query_instance_list_t  *list,
+                                   const query_instance_t *query,
+                                   const char             *key,
+                                   size_t                  key_length);
+
 /**
  * @brief Iterates over every set of queries of each type in a query instance list.
  *
@@ -169,6 +301,37 @@ int query_instance_list_iter(query_instance_list_t            *list,
                              query_instance_list_iter_callback callback,
                              void                             *user_data);
 
+/**
+ * @brief Iterates over every duplicate query not added by ::query_instance_list_add_unique.
+ *
+ * @param list      List of query instances.
+ * @param callback  Callback called for every duplicate query in @p list.
+ * @param user_data Value passed to @p callback, so that it can modify the program's state.
+ *
+ * @return The last value returned by @p callback (will always be `0` on success, meaning iteration
+ *         reached the end).
+ */
+int query_instance_list_iter_duplicates(const query_instance_list_t                *list,
+                                        query_instance_list_iter_duplicates_callback callback,
+                                        void                                        *user_data);
+
+/**
+ * @brief   Iterates over every query added by ::query_instance_list_add_unique, with its canonical
+ *          form.
+ * @details Queries are iterated through in no particular order. Queries added by
+ *          ::query_instance_list_add and queries in clones aren't iterated through.
+ *
+ * @param list      List of query instances.
+ * @param callback  Callback called for every query in @p list with a canonical form.
+ * @param user_data Value passed to @p callback, so that it can modify the program's state.
+ *
+ * @return The last value returned by @p callback (will always be `0` on success, meaning iteration
+ *         reached the end).
+ */
+int query_instance_list_iter_keys(const query_instance_list_t           *list,
+                                  query_instance_list_iter_keys_callback callback,
+                                  void                                  *user_data);
+
 /**
  * @brief  Gets the length of a ::query_instance_list_t.
  * @param  list List to get the length of.
@@ -176,6 +339,15 @@ int query_instance_list_iter(query_instance_list_t            *list,
  */
 size_t query_instance_list_get_length(const query_instance_list_t *list);
 
+/**
+ * @brief  Gets the number of duplicate queries not added to a ::query_instance_list_t.
+ * @param  list List to get the number of duplicate queries from.
+ * @return The number of duplicate queries not added to @p list by
+ *         ::query_instance_list_add_unique. Duplicates aren't included in
+ *         ::query_instance_list_get_length.
+ */
+size_t query_instance_list_get_duplicate_count(const query_instance_list_t *list);
+
 /**
  * @brief Frees memory in a ::query_instance_list_t.
  * @param list List to be deleted.
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    query_materializer.h
+ * @brief   Already formatted outputs of queries about frequently requested entities.
+ * @details Some users, hotels and airports are requested much more often than others, and queries
+ *          about them (e.g.: types 2, 4 and 5) can output thousands of lines, formatted again every
+ *          time. A materializer counts how many times each entity (see
+ *          ::query_type_entity_key_callback_t) is requested. Once an entity is requested
+ *          ::QUERY_MATERIALIZER_HOT_REQUESTS times, the output of the query requesting it is
+ *          rendered both formatted and not formatted, and later queries with the same output are
+ *          written with a single copy (see ::query_writer_write_rendered).
+ *
+ *          Rendered outputs are kept within the size chosen with
+ *          ::QUERY_MATERIALIZER_SIZE_ENVIRONMENT_VARIABLE. When it's exceeded, the outputs of the
+ *          least requested entities are discarded, but only for entities requested less often than
+ *          the one being rendered. Request counts are halved when too many entities are counted, so
+ *          that entities that stop being requested eventually stop being hot.
+ *
+ *          Materializers are only worth it when the same queries are run many times, such as in
+ *          interactive mode (where a query is rerun for every page shown) or in server mode.
+ *
+ * @anchor query_materializer_examples
+ * ### Examples
+ *
+ * A materializer is only valid for the database it was created for, and should be freed alongside
+ * it:
+ *
+ * ```c
+ * query_materializer_t *materializer = query_materializer_create(database); // Can be NULL
+ *
+ * // Every query about an entity requested many times before is written from memory
+ * for (size_t i = 0; i < n; ++i)
+ *     query_dispatcher_dispatch_single(database, queries[i], outputs[i], NULL, materializer, NULL);
+ *
+ * if (materializer)
+ *     query_materializer_free(materializer);
+ * database_free(database);
+ * ```
+ */
+
+#ifndef QUERY_MATERIALIZER_H
+#define QUERY_MATERIALIZER_H
+
+#include <stddef.h>
+
+#include "database/database.h"
+#include "queries/query_instance.h"
+#include "queries/query_writer.h"
+
+/** @brief Environment variable with the maximum size of rendered outputs, in mebibytes. */
+#define QUERY_MATERIALIZER_SIZE_ENVIRONMENT_VARIABLE "LI3_MATERIALIZE_SIZE"
+
+/** @brief Maximum size of rendered outputs (in mebibytes) when no size is chosen. */
+#define QUERY_MATERIALIZER_DEFAULT_SIZE 32
+
+/** @brief Number of requests after which an entity's outputs are rendered. */
+#define QUERY_MATERIALIZER_HOT_REQUESTS 3
+
+/** @brief Already formatted outputs of queries about frequently requested entities. */
+typedef struct query_materializer query_materializer_t;
+
+/**
+ * @brief   Creates a materializer, with no rendered outputs.
+ * @details The materializer is thread-safe.
+ *
+ * @param database Database queries will be executed on. It must outlive the materializer, and
+ *                 must not be modified while the materializer exists.
+ *
+ * @return A pointer to a new ::query_materializer_t, that must be `free`d with
+ *         ::query_materializer_free, or `NULL` on allocation failure or if
+ *         ::QUERY_MATERIALIZER_SIZE_ENVIRONMENT_VARIABLE is `0` (a message is printed to `stderr`
+ *         if it's invalid).
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_materializer_examples).
+ */
+query_materializer_t *query_materializer_create(const database_t *database);
+
+/**
+ * @brief   Writes the output of a query from its rendered output, if the entity it's about is hot.
+ * @details The request is counted, and the output rendered if the entity just became hot.
+ *
+ * @param materializer Materializer to get the rendered output from.
+ * @param instance     Query whose output is to be written.
+ * @param output       Where to write the query's output to. Nothing must have been written to it.
+ *
+ * @retval 0 @p output was written.
+ * @retval 1 The query wasn't materialized (or its type doesn't support materialization, see
+ *           ::query_type_entity_key_callback_t). It must be executed, and nothing was written to
+ *           @p output.
+ */
+int query_materializer_write(query_materializer_t   *materializer,
+                             const query_instance_t *instance,
+                             query_writer_t         *output);
+
+/**
+ * @brief Frees memory used by a materializer, including all rendered outputs.
+ * @param materializer Materializer to be freed.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_materializer_examples).
+ */
+void query_materializer_free(query_materializer_t *materializer);
+
+#endif
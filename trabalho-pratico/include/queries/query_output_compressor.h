@@ -0,0 +1,209 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    query_output_compressor.h
+ * @brief   Compression of query outputs with [zstd](https://facebook.github.io/zstd/).
+ * @details Outputs of large batches are very repetitive (field names in formatted outputs, dates,
+ *          identifiers), and writing them can take longer than running the queries, on slow (e.g.:
+ *          network) storage. When a compressor is shared by the whole program
+ *          (::query_output_compressor_set_shared), batch mode compresses each output file (see
+ *          ::query_writer_set_compressor), that gets the ::QUERY_OUTPUT_COMPRESSOR_SUFFIX suffix.
+ *          Packs (see [query_output_pack](@ref query_output_pack.h)) aren't compressed.
+ *
+ *          Each output is a single zstd frame, that can also be read with the `zstd` command-line
+ *          tool. Most outputs are small, so they compress much better with a dictionary, that
+ *          can be trained from the outputs of a previous run, and is shared by all of them:
+ *
+ *          ```sh
+ *          zstd --train Resultados/command* -o outputs.dict
+ *          ```
+ *
+ *          The dictionary is then copied to the output directory, with the name
+ *          ::QUERY_OUTPUT_COMPRESSOR_DICTIONARY_NAME, so that [test_diff](@ref test_diff.h) can
+ *          read the compressed outputs. Sizes and compression times are accumulated, and can be
+ *          printed with ::query_output_compressor_print_statistics.
+ *
+ *          Only available if the program is built with `libzstd` (see the Makefile). Otherwise,
+ *          ::query_output_compressor_create always fails.
+ *
+ * @anchor query_output_compressor_examples
+ * ### Examples
+ *
+ * ```c
+ * query_output_compressor_t *compressor = query_output_compressor_create("outputs.dict");
+ * if (!compressor)
+ *     return 1;
+ *
+ * query_output_compressor_set_shared(compressor);
+ * batch_mode_run("dataset", "input.txt", NULL); // Writes Resultados/command1_output.txt.zst, ...
+ * query_output_compressor_set_shared(NULL);
+ *
+ * query_output_compressor_save_dictionary(compressor, "Resultados");
+ * query_output_compressor_print_statistics(stderr, compressor);
+ * query_output_compressor_free(compressor);
+ * ```
+ */
+
+#ifndef QUERY_OUTPUT_COMPRESSOR_H
+#define QUERY_OUTPUT_COMPRESSOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/** @brief Suffix of the names of compressed output files. */
+#define QUERY_OUTPUT_COMPRESSOR_SUFFIX ".zst"
+
+/** @brief Name of the copy of the dictionary kept in a directory of compressed outputs. */
+#define QUERY_OUTPUT_COMPRESSOR_DICTIONARY_NAME ".outputs.dict"
+
+/** @brief zstd compression level of outputs. Low, as compression mustn't slow down writing. */
+#define QUERY_OUTPUT_COMPRESSOR_LEVEL 3
+
+/** @brief Compressor of query outputs, with an optional dictionary. */
+typedef struct query_output_compressor query_output_compressor_t;
+
+/**
+ * @brief Creates a compressor of query outputs.
+ *
+ * @param dictionary_path Path to a zstd dictionary, or `NULL` to compress without one.
+ *
+ * @return A new compressor, that must be freed with ::query_output_compressor_free, or `NULL` on
+ *         allocation or IO failure, or if the program was built without `libzstd`.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_output_compressor_examples).
+ */
+query_output_compressor_t *query_output_compressor_create(const char *dictionary_path);
+
+/**
+ * @brief   Compresses a query's output.
+ * @details Thread-safe. Compression contexts are reused between calls.
+ *
+ * @param compressor Compressor of outputs.
+ * @param data       Output to be compressed.
+ * @param length     Number of bytes in @p data.
+ * @param output     Where to write the compressed output to. Must be `free`d by the caller.
+ * @param out_length Where to write the number of bytes in @p output to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation or compression failure.
+ */
+int query_output_compressor_compress(query_output_compressor_t *compressor,
+                                     const char                *data,
+                                     size_t                     length,
+                                     char                     **output,
+                                     size_t                    *out_length);
+
+/**
+ * @brief  Checks if some data is a compressed output.
+ * @param  data   Data to be checked.
+ * @param  length Number of bytes in @p data.
+ * @return Whether @p data starts with a zstd frame.
+ */
+int query_output_compressor_is_compressed(const char *data, size_t length);
+
+/**
+ * @brief   Decompresses a query's output.
+ * @details Thread-safe.
+ *
+ * @param compressor Compressor with the dictionary @p data was compressed with. Can be `NULL`,
+ *                   for outputs compressed without a dictionary.
+ * @param data       Compressed output.
+ * @param length     Number of bytes in @p data.
+ * @param output     Where to write the decompressed output to. Must be `free`d by the caller.
+ * @param out_length Where to write the number of bytes in @p output to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, corrupted data, or the program was built without `libzstd`.
+ */
+int query_output_compressor_decompress(const query_output_compressor_t *compressor,
+                                       const char                      *data,
+                                       size_t                           length,
+                                       char                           **output,
+                                       size_t                          *out_length);
+
+/**
+ * @brief   Copies the dictionary of a compressor to a directory.
+ * @details The copy is named ::QUERY_OUTPUT_COMPRESSOR_DICTIONARY_NAME. Nothing is done for
+ *          compressors without a dictionary.
+ *
+ * @param compressor Compressor whose dictionary is to be copied.
+ * @param directory  Directory where to write the dictionary to.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO failure.
+ */
+int query_output_compressor_save_dictionary(const query_output_compressor_t *compressor,
+                                            const char                      *directory);
+
+/**
+ * @brief   Gets how much a compressor has compressed so far.
+ * @details Not exact while other threads are compressing.
+ *
+ * @param compressor       Compressor of outputs.
+ * @param files            Where to write the number of compressed outputs to. Can be `NULL`.
+ * @param raw_bytes        Where to write the size of the outputs before compression to. Can be
+ *                         `NULL`.
+ * @param compressed_bytes Where to write the size of the outputs after compression to. Can be
+ *                         `NULL`.
+ * @param time             Where to write the nanoseconds spent compressing to, summed over all
+ *                         threads. Can be `NULL`.
+ */
+void query_output_compressor_get_statistics(const query_output_compressor_t *compressor,
+                                            size_t                          *files,
+                                            uint64_t                        *raw_bytes,
+                                            uint64_t                        *compressed_bytes,
+                                            uint64_t                        *time);
+
+/**
+ * @brief   Prints how much a compressor has compressed so far.
+ * @details The number of outputs, their sizes before and after compression, the compression
+ *          ratio and the time spent compressing are printed in a single line.
+ *
+ * @param output     Stream to print to.
+ * @param compressor Compressor of outputs.
+ */
+void query_output_compressor_print_statistics(FILE                            *output,
+                                              const query_output_compressor_t *compressor);
+
+/**
+ * @brief   Sets the compressor used by batch mode for output files.
+ * @details Must be set before any queries are run. The compressor isn't owned by the program, and
+ *          must be freed by the caller after being unset.
+ *
+ * @param compressor Compressor of outputs, or `NULL` for outputs not to be compressed.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_output_compressor_examples).
+ */
+void query_output_compressor_set_shared(query_output_compressor_t *compressor);
+
+/**
+ * @brief  Gets the compressor used by batch mode for output files.
+ * @return The compressor set with ::query_output_compressor_set_shared, or `NULL` if there's none.
+ */
+query_output_compressor_t *query_output_compressor_get_shared(void);
+
+/**
+ * @brief Frees memory used by a compressor of query outputs.
+ * @param compressor Compressor to be freed. Can be `NULL`.
+ */
+void query_output_compressor_free(query_output_compressor_t *compressor);
+
+#endif
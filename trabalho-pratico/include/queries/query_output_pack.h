@@ -0,0 +1,185 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    query_output_pack.h
+ * @brief   Single-file containers of the outputs of many queries.
+ * @details Batch mode usually creates one file per query, which, for query files with millions of
+ *          lines, makes the file system the bottleneck (each file has to be created, opened and
+ *          closed). Alternatively, all outputs can be written to a single pack file, sequentially.
+ *
+ *          A pack starts with ::QUERY_OUTPUT_PACK_MAGIC, followed by the concatenated outputs of
+ *          all queries (in any order, and with no separators). After those, there's a table with
+ *          one entry per query (its line number in the query file, and where its output starts
+ *          and ends in the pack), sorted by line number. The pack ends with a trailer, containing
+ *          the number of entries in the table and where it starts. Like
+ *          [snapshots](@ref dataset_snapshot.h), packs are only meant to be read in the same
+ *          machine they were written in (no byte order conversions are performed).
+ *
+ *          Batch mode appends outputs in the order of their lines, even though queries are executed
+ *          grouped by type (see [output_sequencer](@ref output_sequencer.h)), so that reading all
+ *          entries of a pack reads its outputs sequentially.
+ *
+ * @anchor query_output_pack_examples
+ * ### Examples
+ *
+ * See the source code of batch_mode.c for how to write a pack. The following example extracts all
+ * outputs in a pack to a directory:
+ *
+ * ```c
+ * query_output_pack_reader_t *pack = query_output_pack_reader_open("outputs.pack");
+ * if (!pack)
+ *     return 1;
+ *
+ * int retval = query_output_pack_reader_extract(pack, "Resultados");
+ * query_output_pack_reader_close(pack);
+ * return retval;
+ * ```
+ */
+
+#ifndef QUERY_OUTPUT_PACK_H
+#define QUERY_OUTPUT_PACK_H
+
+#include <stddef.h>
+
+/** @brief Bytes at the beginning and at the end of every pack file. */
+#define QUERY_OUTPUT_PACK_MAGIC "LI3PACK"
+
+/**
+ * @brief Format of the name of the file each output in a pack corresponds to, in the default
+ *        (one file per query) output layout. Takes the line number of the query.
+ */
+#define QUERY_OUTPUT_PACK_ENTRY_NAME_FORMAT "command%zu_output.txt"
+
+/** @brief A pack file being written. */
+typedef struct query_output_pack_writer query_output_pack_writer_t;
+
+/** @brief A pack file opened for reading. */
+typedef struct query_output_pack_reader query_output_pack_reader_t;
+
+/**
+ * @brief Creates a new pack file.
+ * @param path Path to the file to be created (or overwritten).
+ *
+ * @return A pointer to a ::query_output_pack_writer_t that must be deleted with
+ *         ::query_output_pack_writer_finish, or `NULL` on allocation or IO failure.
+ */
+query_output_pack_writer_t *query_output_pack_writer_create(const char *path);
+
+/**
+ * @brief   Appends the output of a query to a pack.
+ * @details The output is written right away (through a buffered stream), so it doesn't need to be
+ *          kept alive after this call.
+ *
+ * @param writer Pack to write to.
+ * @param line   Number of the line of the query in the query file. Must be unique in the pack.
+ * @param output Output of the query.
+ * @param length Number of bytes in @p output.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation or IO failure.
+ */
+int query_output_pack_writer_add(query_output_pack_writer_t *writer,
+                                 size_t                      line,
+                                 const char                 *output,
+                                 size_t                      length);
+
+/**
+ * @brief   Adds a query to a pack whose output is the same as the output of a previous query.
+ * @details No output is written, as the new entry points to the output of the previous query.
+ *
+ * @param writer        Pack to write to.
+ * @param original_line Line of a query whose output was already added to @p writer.
+ * @param line          Number of the line of the duplicate query. Must be unique in the pack.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or @p original_line isn't in the pack.
+ */
+int query_output_pack_writer_add_duplicate(query_output_pack_writer_t *writer,
+                                           size_t                      original_line,
+                                           size_t                      line);
+
+/**
+ * @brief Writes the table of entries of a pack, closes it and frees @p writer.
+ * @param writer Value returned by ::query_output_pack_writer_create. Always freed.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation or IO failure (at any point while writing the pack). The pack is invalid.
+ */
+int query_output_pack_writer_finish(query_output_pack_writer_t *writer);
+
+/**
+ * @brief   Opens a pack file for reading.
+ * @details The pack is memory-mapped, and its outputs are read in place.
+ *
+ * @param path Path to the pack file.
+ *
+ * @return A pointer to a ::query_output_pack_reader_t that must be deleted with
+ *         ::query_output_pack_reader_close, or `NULL` on allocation or IO failure, or if the file
+ *         isn't a valid pack.
+ */
+query_output_pack_reader_t *query_output_pack_reader_open(const char *path);
+
+/**
+ * @brief  Gets the number of queries whose outputs are in a pack.
+ * @param  reader Pack to get the number of entries from.
+ * @return The number of entries in @p reader.
+ */
+size_t query_output_pack_reader_get_count(const query_output_pack_reader_t *reader);
+
+/**
+ * @brief Gets an output from a pack.
+ *
+ * @param reader Pack to get the output from.
+ * @param i      Index of the entry, from `0` to ::query_output_pack_reader_get_count (exclusive).
+ *               Entries are sorted by line number.
+ * @param line   Where to write the line of the query in the query file to. Can be `NULL`.
+ * @param length Where to write the number of bytes in the output to.
+ *
+ * @return The output of the query (not null-terminated), that lives as long as @p reader.
+ */
+const char *query_output_pack_reader_get(const query_output_pack_reader_t *reader,
+                                         size_t                            i,
+                                         size_t                           *line,
+                                         size_t                           *length);
+
+/**
+ * @brief   Writes all outputs in a pack to a directory.
+ * @details Files are named according to ::QUERY_OUTPUT_PACK_ENTRY_NAME_FORMAT, like in the default
+ *          output layout of batch mode.
+ *
+ * @param reader    Pack to extract.
+ * @param directory Existing directory where to create the files.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_output_pack_examples).
+ */
+int query_output_pack_reader_extract(const query_output_pack_reader_t *reader,
+                                     const char                       *directory);
+
+/**
+ * @brief Closes a pack opened with ::query_output_pack_reader_open.
+ * @param reader Value returned by ::query_output_pack_reader_open.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_output_pack_examples).
+ */
+void query_output_pack_reader_close(query_output_pack_reader_t *reader);
+
+#endif
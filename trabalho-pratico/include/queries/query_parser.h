@@ -33,12 +33,12 @@
  *                               "3  \"unknown query\" \"number\"",
  *                               "3F \"unknown formatted\" \"query\""};
  *
- *     GPtrArray *aux = g_ptr_array_new();
+ *     arena_t *arguments = arena_create(4096);
  *
  *     for (size_t i = 0; i < 4; ++i) {
  *         query_instance_t *query = query_instance_create();
  *
- *         int result = query_parser_parse_string_const(query, queries[i], aux);
+ *         int result = query_parser_parse_string_const(query, queries[i], arguments);
  *         if (result)
  *             fprintf(stderr, "Failed to parse query: %s\n", queries[i]);
  *         else if (query_instance_get_formatted(query))
@@ -46,11 +46,10 @@
  *         else
  *             printf("Query's output should not be formatted!\n\n");
  *
- *         query_instance_free(query, query_list);
+ *         query_instance_free(query);
  *     }
  *
- *     query_type_list_free(query_list);
- *     g_ptr_array_unref(aux);
+ *     arena_free(arguments);
  *     return 0;
  * }
  * ```
@@ -71,26 +70,39 @@
  * Like in query_tokenizer.h, you can have arguments inside or outside of quotes, and multiple
  * consecutive spaces are allowed both in quotes (kept) or outside quotes (discarded).
  *
- * It should be noted that, because we're parsing multiple queries, we used an external `GPtrArray`
- * that we provided to ::query_parser_parse_string_const. This way, we avoid many allocations. For
- * parsing a single query, you can pass `NULL` to the mentioned method's `aux` paramater, and it'll
- * automatically allocate and de-allocate a new array.
+ * A query can be preceded by ::QUERY_PARSER_EXPLAIN_PREFIX (e.g.: `EXPLAIN 3F HTL1001`), for its
+ * access paths and the records it touches to be reported, without changing its output (see
+ * [query_explain](@ref query_explain.h) and ::query_instance_get_explain).
+ *
+ * Parsed arguments are placed in the provided ::arena_t, and not owned by the query instances. All
+ * queries parsed into it are only valid until the arena is freed.
  */
 
 #ifndef QUERY_PARSER_H
 #define QUERY_PARSER_H
 
 #include "queries/query_instance.h"
+#include "queries/query_type.h"
+#include "utils/arena.h"
+
+/**
+ * @brief   Maximum number of arguments in a query.
+ * @details No query type accepts this many, so queries with more arguments are rejected without
+ *          calling their ::query_type_parse_arguments_callback_t.
+ */
+#define QUERY_PARSER_MAX_ARGUMENTS 8
+
+/** @brief Token that can precede a query, for it to be explained (::query_instance_set_explain). */
+#define QUERY_PARSER_EXPLAIN_PREFIX "EXPLAIN"
 
 /**
  * @brief Parses a **MODIFIABLE** string containing a query.
  *
- * @param output Where the parsed query is placed. This **will be modified on failure** too.
- * @param input  String to parse, that will be modified during parsing, but then restored to its
- *               original form, assuming none of the ::query_type_parse_arguments_callback_t
- *               modifies its argument tokens.
- * @param aux    Auxiliary `GPtrArray`, that can be provided to be modified and avoid memory
- *               allocations. If `NULL`, a new array will be instantiated.
+ * @param output    Where the parsed query is placed. This **will be modified on failure** too.
+ * @param input     String to parse, that will be modified during parsing (only to terminate
+ *                  arguments with `'\0'`), but then restored to its original form, assuming none
+ *                  of the ::query_type_parse_arguments_callback_t modifies its argument tokens.
+ * @param allocator Arena where parsed query arguments are placed. It must outlive @p output.
  *
  * @retval 0 Parsing success.
  * @retval 1 Parsing failure.
@@ -98,7 +110,49 @@
  * ### Examples
  * See [the header file's documentation](@ref query_parser_examples).
  */
-int query_parser_parse_string(query_instance_t *output, char *input, GPtrArray *aux);
+int query_parser_parse_string(query_instance_t *output, char *input, arena_t *allocator);
+
+/**
+ * @brief Parses the first token of a query, containing its type and whether it's formatted.
+ *
+ * @param token     Token to parse (e.g.: `"10F"`). Doesn't need to be `'\0'`-terminated.
+ * @param length    Length of @p token.
+ * @param type      Where to write the type of the query to.
+ * @param formatted Where to write whether the query's output must be formatted to.
+ *
+ * @retval 0 Parsing success.
+ * @retval 1 Parsing failure (e.g.: unknown query type).
+ */
+int query_parser_parse_type(const char          *token,
+                            size_t               length,
+                            const query_type_t **type,
+                            int                 *formatted);
+
+/**
+ * @brief   Parses the arguments of a query whose type is already known.
+ * @details Used by ::query_parser_parse_string, after tokenization, and by callers that already
+ *          have the arguments of a query split (e.g.: [query templates](@ref query_template.h)).
+ *          The parsed query isn't explained (see ::query_instance_set_explain).
+ *
+ * @param output    Where the parsed query is placed. This **will be modified on failure** too.
+ * @param type      Type of the query.
+ * @param formatted Whether the query's output must be formatted.
+ * @param argc      Number of arguments.
+ * @param argv      Start of every argument. Arguments don't need to be `'\0'`-terminated, as the
+ *                  byte after each one is temporarily replaced by `'\0'`, and then restored.
+ * @param lengths   Length of every argument in @p argv.
+ * @param allocator Arena where parsed query arguments are placed. It must outlive @p output.
+ *
+ * @retval 0 Parsing success.
+ * @retval 1 Parsing failure (including more than ::QUERY_PARSER_MAX_ARGUMENTS arguments).
+ */
+int query_parser_parse_arguments(query_instance_t   *output,
+                                 const query_type_t *type,
+                                 int                 formatted,
+                                 size_t              argc,
+                                 char *const         argv[argc],
+                                 const size_t        lengths[argc],
+                                 arena_t            *allocator);
 
 /** @brief Value returned by ::query_parser_parse_string_const when `malloc` fails. */
 #define QUERY_PARSER_PARSE_CONST_RET_FAILED_MALLOC -1
@@ -108,10 +162,9 @@ int query_parser_parse_string(query_instance_t *output, char *input, GPtrArray *
  * @details The current implementation copies the provided string to a temporary buffer. Keep that
  *          in mind for performance reasons.
  *
- * @param output Where the parsed query is placed. This **will be modified on failure** too.
- * @param input  String to parse.
- * @param aux    Auxiliary `GPtrArray`, that can be provided to be modified and avoid memory
- *               memory allocations. If `NULL`, a new array will be instantiated.
+ * @param output    Where the parsed query is placed. This **will be modified on failure** too.
+ * @param input     String to parse.
+ * @param allocator Arena where parsed query arguments are placed. It must outlive @p output.
  *
  * @retval 0                                          Parsing success.
  * @retval 1                                          Parsing failure.
@@ -120,6 +173,8 @@ int query_parser_parse_string(query_instance_t *output, char *input, GPtrArray *
  * ### Examples
  * See [the header file's documentation](@ref query_parser_examples).
  */
-int query_parser_parse_string_const(query_instance_t *output, const char *input, GPtrArray *aux);
+int query_parser_parse_string_const(query_instance_t *output,
+                                    const char       *input,
+                                    arena_t          *allocator);
 
 #endif
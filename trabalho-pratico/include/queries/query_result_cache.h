@@ -0,0 +1,150 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    query_result_cache.h
+ * @brief   Outputs of queries run before on the same dataset, kept on disk between runs.
+ * @details Queries are identified by their canonical form (see
+ *          ::query_instance_list_add_unique), along with the fingerprint of the dataset they're
+ *          run on (see ::dataset_snapshot_get_fingerprint), whether statistical data is
+ *          approximate (see ::query_type_get_approximate) and the revision the program was built
+ *          from. Any change to the dataset files or to the program makes every previous output
+ *          unreachable, and eventually evicted.
+ *
+ *          The cache is a directory, chosen with ::QUERY_RESULT_CACHE_ENVIRONMENT_VARIABLE, with a
+ *          file per output and an index of all outputs. Outputs are copied in and out of the
+ *          cache, rather than hard-linked, as output files of later runs are truncated and
+ *          rewritten in place, which would corrupt cached outputs sharing their contents.
+ *
+ *          The index is only written when the cache is closed, after the least recently used
+ *          outputs are evicted to keep the cache under the size chosen with
+ *          ::QUERY_RESULT_CACHE_SIZE_ENVIRONMENT_VARIABLE. A cache directory must not be used by
+ *          more than one program at the same time.
+ *
+ * @anchor query_result_cache_examples
+ * ### Examples
+ *
+ * ```c
+ * query_result_cache_t *cache = query_result_cache_open("dataset");
+ * if (cache) {
+ *     if (query_result_cache_fetch(cache, key, key_length, "Resultados/command1_output.txt")) {
+ *         // Run the query, writing its output to Resultados/command1_output.txt
+ *         query_result_cache_store(cache, key, key_length, "Resultados/command1_output.txt");
+ *     }
+ *     query_result_cache_close(cache);
+ * }
+ * ```
+ */
+
+#ifndef QUERY_RESULT_CACHE_H
+#define QUERY_RESULT_CACHE_H
+
+#include <stddef.h>
+
+/** @brief Environment variable with the path to the cache directory. The cache is off if unset. */
+#define QUERY_RESULT_CACHE_ENVIRONMENT_VARIABLE "LI3_RESULT_CACHE"
+
+/** @brief Environment variable with the maximum size of the cache, in mebibytes. */
+#define QUERY_RESULT_CACHE_SIZE_ENVIRONMENT_VARIABLE "LI3_RESULT_CACHE_SIZE"
+
+/** @brief Maximum size of the cache (in mebibytes) when no size is chosen. */
+#define QUERY_RESULT_CACHE_DEFAULT_SIZE 64
+
+/** @brief Outputs of queries run before on the same dataset, kept on disk between runs. */
+typedef struct query_result_cache query_result_cache_t;
+
+/**
+ * @struct query_result_cache_statistics_t
+ * @brief  How lookups in a ::query_result_cache_t were answered.
+ *
+ * @var query_result_cache_statistics_t::hits
+ *     @brief Number of outputs found in the cache.
+ * @var query_result_cache_statistics_t::misses
+ *     @brief Number of outputs not found in the cache.
+ * @var query_result_cache_statistics_t::stores
+ *     @brief Number of outputs added to the cache.
+ * @var query_result_cache_statistics_t::evictions
+ *     @brief Number of outputs removed from the cache to keep it under its size limit.
+ */
+typedef struct {
+    size_t hits, misses, stores, evictions;
+} query_result_cache_statistics_t;
+
+/**
+ * @brief   Opens the cache in the directory chosen with ::QUERY_RESULT_CACHE_ENVIRONMENT_VARIABLE.
+ * @details The directory is created if it doesn't exist. Outputs cached for other datasets (or
+ *          by other builds of the program) are kept, but can't be fetched.
+ *
+ * @param dataset_path Path to the directory containing the dataset queries will be run on.
+ *
+ * @return The cache, that must be closed with ::query_result_cache_close, or `NULL` if the cache is
+ *         disabled or can't be opened (a message will also be printed to `stderr`).
+ */
+query_result_cache_t *query_result_cache_open(const char *dataset_path);
+
+/**
+ * @brief   Writes the cached output of a query to a file.
+ * @details Any file in @p output_path is replaced, and not modified in place.
+ *
+ * @param cache       Cache to get the output from.
+ * @param key         Canonical form of the query (see ::query_instance_list_add_unique).
+ * @param key_length  Number of bytes in @p key.
+ * @param output_path Where to write the query's output to.
+ *
+ * @retval 0 Cache hit (@p output_path was written).
+ * @retval 1 Cache miss. The query must be run.
+ */
+int query_result_cache_fetch(query_result_cache_t *cache,
+                             const char           *key,
+                             size_t                key_length,
+                             const char           *output_path);
+
+/**
+ * @brief Adds the output of a query to a cache.
+ *
+ * @param cache       Cache to add the output to.
+ * @param key         Canonical form of the query (see ::query_instance_list_add_unique).
+ * @param key_length  Number of bytes in @p key.
+ * @param output_path File with the query's output, to be copied to the cache.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation or file IO failure, or an output too large for the cache. Nothing is added.
+ */
+int query_result_cache_store(query_result_cache_t *cache,
+                             const char           *key,
+                             size_t                key_length,
+                             const char           *output_path);
+
+/**
+ * @brief  Gets how lookups in a cache were answered since it was opened.
+ * @param  cache Cache to get the statistics from.
+ * @return The statistics of @p cache, valid until it's closed.
+ */
+const query_result_cache_statistics_t *
+    query_result_cache_get_statistics(const query_result_cache_t *cache);
+
+/**
+ * @brief   Closes a cache, evicting outputs over its size limit and writing its index.
+ * @details @p cache is freed even on failure.
+ *
+ * @param cache Cache to be closed.
+ *
+ * @retval 0 Success.
+ * @retval 1 File IO failure (outputs added since the cache was opened are lost).
+ */
+int query_result_cache_close(query_result_cache_t *cache);
+
+#endif
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    query_slow_log.h
+ * @brief   Log of queries that took longer than a threshold, with the time spent in each phase.
+ * @details Aggregate measurements (see ::performance_metrics_t) don't explain why a single query
+ *          was slow. For every query above the log's threshold, a line is appended to the log
+ *          file, with the query's text, its type, the time spent generating (or looking up)
+ *          statistical data, executing and formatting its output, the number of records
+ *          outputted and the size of the output. The text of the query is the last field of the
+ *          line, so that it doesn't need to be quoted.
+ *
+ *          Statistical data is shared by all queries of the same type in a batch (see
+ *          ::query_dispatcher_dispatch_list), so each query is only charged its share of the time
+ *          spent generating it when compared to the threshold. The whole duration and the number
+ *          of queries it's shared by are logged too.
+ *
+ *          Lines can be written from many threads at the same time. Once the log file grows
+ *          larger than ::QUERY_SLOW_LOG_MAX_FILE_SIZE, it's renamed to `<path>.1` (replacing the
+ *          previous one) and a new file is started.
+ *
+ *          There's a log shared by the whole program (::query_slow_log_set_shared), used by
+ *          ::query_dispatcher_dispatch_list and ::query_dispatcher_dispatch_single. Only query
+ *          instances are known to them, so the text of each query is provided by the mode that
+ *          parsed it, through a callback (::query_slow_log_set_text_callback).
+ *
+ * @anchor query_slow_log_examples
+ * ### Examples
+ *
+ * ```c
+ * query_slow_log_t *log = query_slow_log_create("slow.log", 100000); // Queries above 100 ms
+ * if (!log)
+ *     return 1;
+ *
+ * query_slow_log_set_shared(log);
+ * query_dispatcher_dispatch_list(database, list, outputs, NULL, NULL, NULL);
+ * query_slow_log_set_shared(NULL);
+ *
+ * query_slow_log_free(log);
+ * ```
+ *
+ * A line of the log looks like this (in a single line):
+ *
+ * ```text
+ * 2023-10-01T12:00:00 type=10 total_us=153210 statistics_us=150000 statistics_shared=1
+ *     execution_us=3005 formatting_us=205 records=12 output_bytes=640 query=10 2023
+ * ```
+ */
+
+#ifndef QUERY_SLOW_LOG_H
+#define QUERY_SLOW_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "queries/query_instance.h"
+
+/** @brief Size of the log file (in bytes) above which it's rotated. */
+#define QUERY_SLOW_LOG_MAX_FILE_SIZE (16 << 20)
+
+/** @brief Log of queries that took longer than a threshold. */
+typedef struct query_slow_log query_slow_log_t;
+
+/**
+ * @brief   Type of the method called to write the text of a query to the log.
+ * @details Called while the log is locked, so it's never called concurrently.
+ *
+ * @param user_data Argument passed to ::query_slow_log_set_text_callback.
+ * @param query     Query whose text is to be written.
+ * @param out       Where to write the text of @p query to (without a new line).
+ */
+typedef void (*query_slow_log_text_callback_t)(void                   *user_data,
+                                               const query_instance_t *query,
+                                               FILE                   *out);
+
+/**
+ * @struct query_slow_log_entry_t
+ * @brief  Measurements of a query, to be written to a ::query_slow_log_t.
+ *
+ * @var query_slow_log_entry_t::query
+ *     @brief Query that was run.
+ * @var query_slow_log_entry_t::statistics
+ *     @brief Microseconds spent generating (or looking up) the statistical data of the query.
+ * @var query_slow_log_entry_t::statistics_shared
+ *     @brief Number of queries ::query_slow_log_entry_t::statistics is shared by.
+ * @var query_slow_log_entry_t::execution
+ *     @brief Microseconds spent executing the query, including formatting its output.
+ * @var query_slow_log_entry_t::formatting
+ *     @brief Microseconds of ::query_slow_log_entry_t::execution spent formatting the output.
+ * @var query_slow_log_entry_t::records
+ *     @brief Number of records outputted by the query.
+ * @var query_slow_log_entry_t::output_size
+ *     @brief Number of bytes of output.
+ */
+typedef struct {
+    const query_instance_t *query;
+    uint64_t                statistics;
+    size_t                  statistics_shared;
+    uint64_t                execution, formatting;
+    size_t                  records, output_size;
+} query_slow_log_entry_t;
+
+/**
+ * @brief   Opens a log of slow queries.
+ * @details The returned value is owned by the caller, and should be freed with
+ *          ::query_slow_log_free. The log file is appended to, if it already exists.
+ *
+ * @param path      Path to the log file.
+ * @param threshold Minimum duration of the queries to be logged, in microseconds.
+ *
+ * @return A new log, or `NULL` on allocation or IO failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_slow_log_examples).
+ */
+query_slow_log_t *query_slow_log_create(const char *path, uint64_t threshold);
+
+/**
+ * @brief Sets the method used to write the text of the queries in a log.
+ *
+ * @param log       Log to be modified.
+ * @param callback  Method that writes the text of a query. `NULL` for only the number of the line
+ *                  of each query (::query_instance_get_line_in_file) to be logged.
+ * @param user_data Argument passed to @p callback.
+ */
+void query_slow_log_set_text_callback(query_slow_log_t              *log,
+                                      query_slow_log_text_callback_t callback,
+                                      void                          *user_data);
+
+/**
+ * @brief  Checks if a query is slow enough to be logged.
+ * @param  log      Log to check the threshold of.
+ * @param  duration Duration of the query, in microseconds.
+ * @return Whether @p duration is at least the threshold of @p log.
+ */
+int query_slow_log_is_slow(const query_slow_log_t *log, uint64_t duration);
+
+/**
+ * @brief   Writes a query to a log.
+ * @details Thread-safe. IO errors are ignored, as logging mustn't make queries fail.
+ *
+ * @param log   Log to write to.
+ * @param entry Measurements of the query.
+ */
+void query_slow_log_write(query_slow_log_t *log, const query_slow_log_entry_t *entry);
+
+/**
+ * @brief   Sets the log used when dispatching queries.
+ * @details Must be set before any queries are dispatched, and not while they're being run. The
+ *          log isn't owned by the program, and must be freed by the caller after being unset.
+ *
+ * @param log Log of slow queries, or `NULL` for queries not to be logged.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_slow_log_examples).
+ */
+void query_slow_log_set_shared(query_slow_log_t *log);
+
+/**
+ * @brief  Gets the log used when dispatching queries.
+ * @return The log set with ::query_slow_log_set_shared, or `NULL` if there's none.
+ */
+query_slow_log_t *query_slow_log_get_shared(void);
+
+/**
+ * @brief Closes a log of slow queries and frees memory used by it.
+ * @param log Log to be freed.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_slow_log_examples).
+ */
+void query_slow_log_free(query_slow_log_t *log);
+
+#endif
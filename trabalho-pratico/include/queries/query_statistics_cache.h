@@ -0,0 +1,113 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    query_statistics_cache.h
+ * @brief   A cache of statistical data generated for single queries.
+ * @details When queries are run one at a time (e.g.: in interactive mode), statistical data can't
+ *          be shared between queries of the same type like in ::query_dispatcher_dispatch_list.
+ *          This cache keeps the statistical data generated for previous queries, so that queries
+ *          whose ::query_type_statistics_key_callback_t gives the same key can reuse it.
+ *
+ * @anchor query_statistics_cache_examples
+ * ### Examples
+ *
+ * A cache is only valid for the database it was created for, and should be freed alongside it:
+ *
+ * ```c
+ * query_statistics_cache_t *cache = query_statistics_cache_create(database);
+ * if (!cache)
+ *     return 1;
+ *
+ * // Every query here will reuse statistics from the queries before it, when possible
+ * for (size_t i = 0; i < n; ++i)
+ *     query_dispatcher_dispatch_single(database, queries[i], outputs[i], cache, NULL, NULL);
+ *
+ * query_statistics_cache_free(cache);
+ * database_free(database);
+ * ```
+ */
+
+#ifndef QUERY_STATISTICS_CACHE_H
+#define QUERY_STATISTICS_CACHE_H
+
+#include "database/database.h"
+#include "queries/query_instance.h"
+
+/** @brief A cache of statistical data generated for single queries. */
+typedef struct query_statistics_cache query_statistics_cache_t;
+
+/**
+ * @brief   Creates an empty cache of statistical data.
+ * @details The cache isn't thread-safe.
+ *
+ * @param database Database statistical data will be generated from. It must outlive the cache.
+ *
+ * @return A pointer to a new ::query_statistics_cache_t, that must be `free`d with
+ *         ::query_statistics_cache_free, or `NULL` on allocation failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_statistics_cache_examples).
+ */
+query_statistics_cache_t *query_statistics_cache_create(const database_t *database);
+
+/**
+ * @brief   Checks if the statistical data of a query's type can be stored in a cache.
+ * @param   type Type of the query.
+ * @return  Whether @p type generates statistical data and has a
+ *          ::query_type_statistics_key_callback_t.
+ */
+int query_statistics_cache_supports_type(const query_type_t *type);
+
+/**
+ * @brief   Gets statistical data for a query, generating it if it isn't in the cache.
+ * @details The least recently used statistical data is freed when the cache is full.
+ *
+ * @param cache          Cache to get statistical data from.
+ * @param instance       Query whose type must be supported (see
+ *                       ::query_statistics_cache_supports_type).
+ * @param out_statistics Where to write the statistical data to. It's owned by @p cache, and only
+ *                       valid until the next call to this method.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure to generate statistical data (or unsupported query type).
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_statistics_cache_examples).
+ */
+int query_statistics_cache_get(query_statistics_cache_t *cache,
+                               const query_instance_t   *instance,
+                               const void              **out_statistics);
+
+/**
+ * @brief  Checks if statistical data was found in a cache, rather than generated.
+ * @param  cache Cache to be checked.
+ * @return Whether the last call to ::query_statistics_cache_get on @p cache found the data it
+ *         returned in @p cache.
+ */
+int query_statistics_cache_was_hit(const query_statistics_cache_t *cache);
+
+/**
+ * @brief Frees memory used by a cache of statistical data, including all data in it.
+ * @param cache Cache to be freed.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_statistics_cache_examples).
+ */
+void query_statistics_cache_free(query_statistics_cache_t *cache);
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    query_template.h
+ * @brief   A query with some of its arguments left as parameters, to be bound later.
+ * @details Templates are written like queries (see [the query parser](@ref query_parser.h)), with
+ *          `?` in place of each parameter (`"?"`, in quotes, is a literal question mark). The query
+ *          type and the constant arguments are parsed once, when the template is created. Binding
+ *          the parameters only requires splitting them, and parsing the arguments of the query's
+ *          type, so queries sent many times with different parameters are cheaper to parse.
+ *
+ * @anchor query_template_examples
+ * ### Examples
+ *
+ * ```c
+ * query_template_t *template = query_template_create("8 HTL1001 ? ?");
+ * if (!template)
+ *     return 1;
+ *
+ * arena_t          *arguments = arena_create(4096);
+ * query_instance_t *query     = query_instance_create();
+ *
+ * char parameters[] = "2023/10/01 2023/10/31";
+ * if (query_template_bind(template, query, parameters, arguments) == 0)
+ *     ...; // Same as parsing "8 HTL1001 2023/10/01 2023/10/31"
+ *
+ * query_instance_free(query);
+ * arena_free(arguments);
+ * query_template_free(template);
+ * ```
+ */
+
+#ifndef QUERY_TEMPLATE_H
+#define QUERY_TEMPLATE_H
+
+#include "queries/query_instance.h"
+#include "utils/arena.h"
+
+/** @brief A query with some of its arguments left as parameters. */
+typedef struct query_template query_template_t;
+
+/**
+ * @brief   Creates a query template from its string representation.
+ * @details The returned value is owned by the caller, and should be freed with
+ *          ::query_template_free. The template doesn't reference @p input.
+ *
+ * @param input Template to parse (e.g.: `"4 ?"`).
+ *
+ * @return A new template, or `NULL` on parsing or allocation failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_template_examples).
+ */
+query_template_t *query_template_create(const char *input);
+
+/**
+ * @brief  Gets the number of parameters of a query template.
+ * @param  template Template to get the number of parameters from.
+ * @return The number of `?` in the template.
+ */
+size_t query_template_get_parameter_count(const query_template_t *template);
+
+/**
+ * @brief   Creates a query from a template, by binding values to its parameters.
+ * @details A template can't be bound from multiple threads at the same time.
+ *
+ * @param template   Template to bind parameters to.
+ * @param output     Where the parsed query is placed. This **will be modified on failure** too.
+ * @param parameters Values of the parameters, separated like query arguments. This string will be
+ *                   modified during parsing, but then restored to its original form.
+ * @param allocator  Arena where parsed query arguments are placed. It must outlive @p output.
+ *
+ * @retval 0 Success.
+ * @retval 1 Parsing failure (including the wrong number of parameters).
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_template_examples).
+ */
+int query_template_bind(const query_template_t *template,
+                        query_instance_t       *output,
+                        char                   *parameters,
+                        arena_t                *allocator);
+
+/**
+ * @brief Frees memory used by a query template.
+ * @param template Template to be freed.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_template_examples).
+ */
+void query_template_free(query_template_t *template);
+
+#endif
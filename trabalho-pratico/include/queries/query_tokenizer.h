@@ -65,8 +65,39 @@
 #ifndef QUERY_TOKENIZER_H
 #define QUERY_TOKENIZER_H
 
+#include <stddef.h>
+
 #include "utils/tokenize_iter_callback.h"
 
+/**
+ * @brief   Callback called by ::query_tokenizer_tokenize_slices for every token read.
+ * @details Tokens aren't `'\0'`-terminated, as they point directly into the input string.
+ *
+ * @param user_data Pointer passed to ::query_tokenizer_tokenize_slices, so that this callback can
+ *                  modify the program's state.
+ * @param token     Start of the token, inside the input string (without quotes).
+ * @param length    Number of bytes in @p token.
+ *
+ * @return `0` on success, other value for immediate termination of tokenization.
+ */
+typedef int (*query_tokenizer_slice_callback_t)(void *user_data, const char *token, size_t length);
+
+/**
+ * @brief   Splits a string into query tokens, without modifying or copying it.
+ * @details The string is only traversed once, and tokens are reported as slices of it. This is the
+ *          preferred method when the token's length is useful, as no `strlen` is needed.
+ *
+ * @param input     String to tokenize.
+ * @param callback  Function called for every token read.
+ * @param user_data Pointer passed to every call of @p callback, so that it can edit program state.
+ *
+ * @return `0` on success, otherwise, the return value from @p callback in case it ordered the
+ *         tokenization to stop.
+ */
+int query_tokenizer_tokenize_slices(const char                      *input,
+                                    query_tokenizer_slice_callback_t callback,
+                                    void                            *user_data);
+
 /**
  * @brief Splits a **MODIFIABLE** string into query tokens.
  *
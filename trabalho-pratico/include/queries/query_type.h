@@ -33,37 +33,68 @@
  *   flag. For example, in `1f a b c`, this method is called with {"a", "b", "c"} for `argv` and `3`
  *   for `argc`. Note that the values in `argv` must be copied in case you want to store them for
  *   later, as they may change when parsing a query file. The function must return the value that
- *   will be stored in ::query_instance::argument_data (or `NULL` on failure).
- *
- * - ::query_type_clone_arguments_callback_t creates deep clones of the values generated by
- *   ::query_type_parse_arguments_callback_t, so that a ::query_instance_t can also be copied.
- *
- * - ::query_type_free_arguments_callback_t `free`s data generated by
- *   ::query_type_parse_arguments_callback_t.
+ *   will be stored in ::query_instance::argument_data (or `NULL` on failure). Any memory it needs
+ *   must be allocated in the provided ::arena_t, which is owned by whoever stores the query
+ *   instance, so that arguments never need to be cloned nor freed one by one.
  *
  * - ::query_type_generate_statistics_callback_t generates statistical data to be used for the
- *   execution of all queries of the same type. This method is optional.
+ *   execution of all queries of the same type. This method is optional. Like arguments, statistical
+ *   data should be allocated in the provided ::arena_t, that is freed all at once after all queries
+ *   that use it are executed.
  *
- * - ::query_type_free_statistics_callback_t frees data generated by
- *   ::query_type_generate_statistics_callback_t. This method is optional.
+ * - ::query_type_free_statistics_callback_t frees memory referenced by statistical data that
+ *   couldn't be allocated in the arena (e.g.: growable arrays). This method is optional.
+ *
+ * - ::query_type_statistics_key_callback_t tells which queries can share statistical data, so
+ *   that it can be cached across runs of single queries (see query_statistics_cache.h). This
+ *   method is optional.
  *
  * - ::query_type_execute_callback_t executes a query.
  *
+ * - ::query_type_execute_batch_callback_t executes many queries of the same type at once, so that
+ *   lookups and formatting can each be done in a tight loop. This method is optional.
+ *
+ * - ::query_type_cost_model_callback_t predicts whether it's cheaper to execute a set of queries
+ *   with per-query lookups or with statistical data generated for the whole set, so that the
+ *   dispatcher can skip ::query_type_generate_statistics_callback_t when it isn't worth it. This
+ *   method is optional.
+ *
+ * - ::query_type_entity_key_callback_t tells which entity (user, hotel, airport, ...) a query is
+ *   about, so that the outputs of queries about frequently requested entities can be kept already
+ *   formatted (see query_materializer.h). This method is optional.
+ * - ::query_type_partition_callback_t tells which partition of a
+ *   [partitioned database](@ref database_set_partition) a query must be sent to. This method is
+ *   optional.
+ * - ::query_type_merge_callback_t merges the outputs of a query sent to all partitions of a
+ *   partitioned database. This method is optional.
+ *
  * After defining these methods, create a constructor for your query using ::query_type_create.
  * Remember that any ::query_type_create call must have a ::query_type_free match. This is usually
  * automatically handled by query_type_list.c. If you're creating a new query, you must modify
  * the source code of query_type_list.c to take your new query into account.
  *
  * For accessing methods of existing queries, use the getters defined in this module.
+ *
+ * Statistical data can be generated approximately, when exact results are too expensive for
+ * huge datasets. Queries that support it check ::query_type_get_approximate before generating
+ * their statistics, and report the error bounds of their results to `stderr`. Exact results are
+ * the default.
+ *
+ * When a dataset is split among [partitions](@ref database_set_partition), each query is sent to
+ * the partition that owns the data it needs, or to all of them. In the latter case, the outputs of
+ * every partition are merged, from *partial* outputs: non-formatted outputs of queries executed
+ * while ::query_type_get_partial is set, which may differ from their usual outputs.
  */
 
 #ifndef QUERY_TYPE_H
 #define QUERY_TYPE_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "database/database.h"
 #include "queries/query_writer.h"
+#include "utils/arena.h"
 
 /** @cond FALSE */
 /* clang-format off */
@@ -79,35 +110,36 @@
 typedef struct query_type query_type_t;
 
 /**
- * @brief Type of the method called for parsing query arguments.
- *
- * @param argc Number of query arguments.
- * @param argv Arguments of the query. These won't include the query type or whether the query's
- *             output must be formatted. Also, do not store these pointers without first making a
- *             copy of each string. They are non-constant so that you can modify them during your
- *             parsing, but will be quickly discarded.
- *
- * @return `NULL` on failure, other value on success. This value will be stored in
- *         ::query_instance::argument_data.
+ * @brief Environment variable that enables approximate statistical data when set to `1`, or only
+ *        when close to the [memory budget](@ref memory_budget.h) when set to `auto` (see
+ *        ::query_type_get_approximate).
  */
-typedef void *(*query_type_parse_arguments_callback_t)(size_t argc, char *const argv[argc]);
+#define QUERY_TYPE_APPROXIMATE_ENVIRONMENT_VARIABLE "LI3_APPROXIMATE"
 
 /**
- * @brief   Type of the method called for cloning query arguments.
- * @details This exists for the sake of ::query_instance_t also being cloneable.
- *
- * @param args_data Value returned by ::query_type_parse_arguments_callback_t.
- *
- * @return A deep clone of @p args, `NULL` on allocation failure.
+ * @brief Size of the blocks of the arenas where statistical data is allocated (see
+ *        ::query_type_generate_statistics_callback_t).
  */
-typedef void *(*query_type_clone_arguments_callback_t)(const void *args_data);
+#define QUERY_TYPE_STATISTICS_ARENA_BLOCK_SIZE 65536
 
 /**
- * @brief Type of the method called for `free`ing what was returned by
- *        ::query_type_parse_arguments_callback_t.
- * @param args_data Non-`NULL` value returned by ::query_type_parse_arguments_callback_t.
+ * @brief Type of the method called for parsing query arguments.
+ *
+ * @param argc      Number of query arguments.
+ * @param argv      Arguments of the query. These won't include the query type or whether the
+ *                  query's output must be formatted. Also, do not store these pointers without
+ *                  first making a copy of each string. They are non-constant so that you can modify
+ *                  them during your parsing, but will be quickly discarded.
+ * @param allocator Where to allocate the parsed arguments (and any strings they refer to) in.
+ *                  Memory in it can't be freed, so only allocate once the arguments are known to
+ *                  be valid.
+ *
+ * @return `NULL` on failure, other value on success. This value will be stored in
+ *         ::query_instance::argument_data.
  */
-typedef void (*query_type_free_arguments_callback_t)(void *args_data);
+typedef void *(*query_type_parse_arguments_callback_t)(size_t      argc,
+                                                       char *const argv[argc],
+                                                       arena_t    *allocator);
 
 /**
  * @brief   Type of the method called to generate statistical data before running all queries of the
@@ -117,6 +149,9 @@ typedef void (*query_type_free_arguments_callback_t)(void *args_data);
  * @param database  Database to collect statistical information from.
  * @param n         Number of query instances in @p instances.
  * @param instances List of query instances that will need to be processed.
+ * @param allocator Where to allocate statistical data in. It's owned by the caller, and only freed
+ *                  (after ::query_type_free_statistics_callback_t, if defined) once no query needs
+ *                  the returned data. It's also freed on failure.
  *
  * @return `NULL` on failure, another value on success. Statistical data will be global to all
  *         queries of the same type.
@@ -124,18 +159,32 @@ typedef void (*query_type_free_arguments_callback_t)(void *args_data);
 typedef void *(*query_type_generate_statistics_callback_t)(
     const database_t             *database,
     size_t                        n,
-    const query_instance_t *const instances[n]);
+    const query_instance_t *const instances[n],
+    arena_t                      *allocator);
 
 /**
  * @brief   Type of method called to free data generated by
- *          ::query_type_generate_statistics_callback_t.
- * @details Can be `NULL` if the query type's ::query_type_generate_statistics_callback_t is also
- *          `NULL`.
+ *          ::query_type_generate_statistics_callback_t outside of its arena.
+ * @details Can be `NULL` when all statistical data is allocated in the arena. It's called before
+ *          the arena is freed.
  *
  * @param   statistics Non-`NULL` value returned by ::query_type_generate_statistics_callback_t.
  */
 typedef void (*query_type_free_statistics_callback_t)(void *statistics);
 
+/**
+ * @brief   Type of the method called to get a key identifying the statistical data a query needs.
+ * @details Statistical data generated for a single query can be reused by any other query of the
+ *          same type whose arguments have the same key. Can be `NULL`, so that statistical data is
+ *          never reused (it's also ignored if the query type's
+ *          ::query_type_generate_statistics_callback_t is `NULL`).
+ *
+ * @param argument_data Data generated by ::query_type_parse_arguments_callback_t.
+ *
+ * @return A key for the statistical data needed by a query with arguments @p argument_data.
+ */
+typedef uint64_t (*query_type_statistics_key_callback_t)(const void *argument_data);
+
 /**
  * @brief Type of method called to execute a query.
  *
@@ -152,6 +201,130 @@ typedef int (*query_type_execute_callback_t)(const database_t       *database,
                                              const query_instance_t *instance,
                                              query_writer_t         *output);
 
+/**
+ * @brief   Type of method called to execute many queries of the same type at once.
+ * @details Can be `NULL`, for queries to always be executed one at a time. Otherwise, it must
+ *          produce the same output as calling ::query_type_execute_callback_t for every query.
+ *
+ * @param database   Database to perform data lookups.
+ * @param statistics Data generated by ::query_type_generate_statistics_callback_t, or `NULL` if
+ *                   that callback isn't defined for a given query type.
+ * @param n          Number of queries in @p instances.
+ * @param instances  Query instances to execute.
+ * @param outputs    Where to write the result of each query in @p instances to.
+ *
+ * @return `0` on success, another value on failure.
+ */
+typedef int (*query_type_execute_batch_callback_t)(const database_t             *database,
+                                                   const void                   *statistics,
+                                                   size_t                        n,
+                                                   const query_instance_t *const instances[n],
+                                                   query_writer_t *const         outputs[n]);
+
+/**
+ * @struct query_type_cost_t
+ * @brief  Predicted cost of each way of executing a set of queries of the same type.
+ *
+ * @var query_type_cost_t::index_cost
+ *     @brief Predicted time (in nanoseconds) to execute all queries without statistical data, each
+ *            performing its own lookups (building any missing database index on the way).
+ * @var query_type_cost_t::scan_cost
+ *     @brief Predicted time (in nanoseconds) to generate statistical data and to execute all
+ *            queries with it.
+ */
+typedef struct {
+    uint64_t index_cost;
+    uint64_t scan_cost;
+} query_type_cost_t;
+
+/**
+ * @brief   Type of the method called to predict the cost of executing a set of queries.
+ * @details Can be `NULL`, for ::query_type_generate_statistics_callback_t to always be called (if
+ *          defined). Otherwise, statistical data is only generated when
+ *          ::query_type_cost_t::scan_cost is lower than ::query_type_cost_t::index_cost, and
+ *          ::query_type_execute_callback_t (and ::query_type_execute_batch_callback_t) must also
+ *          accept `NULL` statistics. Predictions should be based on cheap information, such as the
+ *          number of queries, the cardinality of the database's managers and which database
+ *          indexes are already built.
+ *
+ * @param database  Database the queries will be executed on.
+ * @param n         Number of query instances in @p instances.
+ * @param instances Query instances that will be executed.
+ * @param out_cost  Where to write the predicted costs to.
+ */
+typedef void (*query_type_cost_model_callback_t)(const database_t             *database,
+                                                 size_t                        n,
+                                                 const query_instance_t *const instances[n],
+                                                 query_type_cost_t            *out_cost);
+
+/**
+ * @struct query_type_entity_key_t
+ * @brief  Identifies the output of a query, by the entity it's about and how it's filtered.
+ *
+ * @var query_type_entity_key_t::entity
+ *     @brief Entity (user, hotel, airport, ...) the query is about. Frequently requested entities
+ *            get their outputs materialized (see query_materializer.h).
+ * @var query_type_entity_key_t::variant
+ *     @brief Distinguishes queries about the same entity with different outputs (e.g.: different
+ *            filters or date ranges). Queries with equal keys must have equal outputs.
+ */
+typedef struct {
+    uint32_t entity;
+    uint64_t variant;
+} query_type_entity_key_t;
+
+/**
+ * @brief   Type of the method called to get the entity a query is about.
+ * @details Can be `NULL`, for outputs of queries of this type to never be materialized. Otherwise,
+ *          ::query_type_execute_callback_t must accept `NULL` statistics, and the output of a
+ *          query must only depend on its key and on whether it's formatted.
+ *
+ * @param database      Database the query will be executed on.
+ * @param argument_data Data generated by ::query_type_parse_arguments_callback_t.
+ * @param out_key       Where to write the key of the query's output to.
+ *
+ * @retval 0 Success.
+ * @retval 1 The query isn't about any entity in @p database (its output isn't worth keeping).
+ */
+typedef int (*query_type_entity_key_callback_t)(const database_t        *database,
+                                                const void              *argument_data,
+                                                query_type_entity_key_t *out_key);
+
+/** @brief Value of ::query_type_partition_callback_t for queries sent to all partitions. */
+#define QUERY_TYPE_PARTITION_ALL SIZE_MAX
+
+/**
+ * @brief   Type of the method called to get the partition of a database a query must be sent to.
+ * @details Can be `NULL`, for queries that only need replicated data (users and flights), and that
+ *          can be sent to any partition. See ::database_set_partition.
+ * @param argument_data Data generated by ::query_type_parse_arguments_callback_t.
+ * @param npartitions   Number of partitions the dataset is split into.
+ * @return The partition to send the query to (lower than @p npartitions), or
+ *         ::QUERY_TYPE_PARTITION_ALL for the query to be sent to all partitions.
+ */
+typedef size_t (*query_type_partition_callback_t)(const void *argument_data, size_t npartitions);
+
+/**
+ * @brief   Type of the method called to merge the partial outputs of a query sent to all
+ *          partitions of a database.
+ * @details Can be `NULL`, in which case queries sent to all partitions must have an empty output in
+ *          all but (at most) one of them (e.g.: lookups of entities that only exist in one
+ *          partition), and that output is used as it is, instead of a partial output.
+ * @param argument_data Data generated by ::query_type_parse_arguments_callback_t.
+ * @param n             Number of partitions.
+ * @param partials      Partial output of the query in each partition (see
+ *                      ::query_type_get_partial). Not null-terminated.
+ * @param lengths       Number of characters in each of @p partials.
+ * @param output        Where to write the query's merged output to.
+ * @retval 0 Success.
+ * @retval 1 Malformed partial output.
+ */
+typedef int (*query_type_merge_callback_t)(const void       *argument_data,
+                                           size_t            n,
+                                           const char *const partials[n],
+                                           const size_t      lengths[n],
+                                           query_writer_t   *output);
+
 /**
  * @brief   Creates a query type, defining its behavior.
  * @details For parameter description, see the description for the type of each parameter.
@@ -165,11 +338,15 @@ typedef int (*query_type_execute_callback_t)(const database_t       *database,
  */
 query_type_t *query_type_create(size_t                                    type_number,
                                 query_type_parse_arguments_callback_t     parse_arguments,
-                                query_type_clone_arguments_callback_t     clone_arguments,
-                                query_type_free_arguments_callback_t      free_arguments,
                                 query_type_generate_statistics_callback_t generate_statistics,
                                 query_type_free_statistics_callback_t     free_statistics,
-                                query_type_execute_callback_t             execute);
+                                query_type_statistics_key_callback_t      statistics_key,
+                                query_type_execute_callback_t             execute,
+                                query_type_execute_batch_callback_t       execute_batch,
+                                query_type_cost_model_callback_t          cost_model,
+                                query_type_entity_key_callback_t          entity_key,
+                                query_type_partition_callback_t           partition,
+                                query_type_merge_callback_t               merge);
 
 /**
  * @brief  Creates a deep copy of a query type.
@@ -194,22 +371,6 @@ size_t query_type_get_type_number(const query_type_t *type);
 query_type_parse_arguments_callback_t
     query_type_get_parse_arguments_callback(const query_type_t *type);
 
-/**
- * @brief  Gets the method called for cloning query arguments from a ::query_type_t.
- * @param  type ::query_type_t to get the method called for cloning query arguments from.
- * @return @p type 's method called for deep-cloning query arguments.
- */
-query_type_clone_arguments_callback_t
-    query_type_get_clone_arguments_callback(const query_type_t *type);
-
-/**
- * @brief  Gets the method called for `free`ing query arguments from a ::query_type_t.
- * @param  type ::query_type_t to get the method called for `free`ing query arguments from.
- * @return @p type 's method called for `free`ing query arguments.
- */
-query_type_free_arguments_callback_t
-    query_type_get_free_arguments_callback(const query_type_t *type);
-
 /**
  * @brief  Gets the method called for generating statistical data from a ::query_type_t.
  * @param  type ::query_type_t to get the method called for generating statistical data from.
@@ -226,6 +387,14 @@ query_type_generate_statistics_callback_t
 query_type_free_statistics_callback_t
     query_type_get_free_statistics_callback(const query_type_t *type);
 
+/**
+ * @brief  Gets the method called for getting the key of a query's statistical data.
+ * @param  type ::query_type_t to get the method called for getting statistical data keys from.
+ * @return @p type 's method called for getting statistical data keys.
+ */
+query_type_statistics_key_callback_t
+    query_type_get_statistics_key_callback(const query_type_t *type);
+
 /**
  * @brief  Gets the method called for executing a query from a ::query_type_t.
  * @param  type ::query_type_t to get the method called for query execution from.
@@ -233,6 +402,78 @@ query_type_free_statistics_callback_t
  */
 query_type_execute_callback_t query_type_get_execute_callback(const query_type_t *type);
 
+/**
+ * @brief  Gets the method called for executing many queries at once from a ::query_type_t.
+ * @param  type ::query_type_t to get the method called for batch query execution from.
+ * @return @p type 's method called for executing many queries at once (can be `NULL`).
+ */
+query_type_execute_batch_callback_t
+    query_type_get_execute_batch_callback(const query_type_t *type);
+
+/**
+ * @brief  Gets the method called for predicting the cost of executing a set of queries.
+ * @param  type ::query_type_t to get the cost model from.
+ * @return @p type 's method called for predicting execution costs (can be `NULL`).
+ */
+query_type_cost_model_callback_t query_type_get_cost_model_callback(const query_type_t *type);
+
+/**
+ * @brief  Gets the method called for getting the entity a query is about.
+ * @param  type ::query_type_t to get the method called for getting entity keys from.
+ * @return @p type 's method called for getting entity keys (can be `NULL`).
+ */
+query_type_entity_key_callback_t query_type_get_entity_key_callback(const query_type_t *type);
+
+/**
+ * @brief  Gets the method called for getting the partition of a database a query is sent to.
+ * @param  type ::query_type_t to get the method called for getting partitions from.
+ * @return @p type 's method called for getting partitions (can be `NULL`).
+ */
+query_type_partition_callback_t query_type_get_partition_callback(const query_type_t *type);
+
+/**
+ * @brief  Gets the method called for merging partial outputs of a query.
+ * @param  type ::query_type_t to get the method called for merging outputs from.
+ * @return @p type 's method called for merging partial outputs (can be `NULL`).
+ */
+query_type_merge_callback_t query_type_get_merge_callback(const query_type_t *type);
+
+/**
+ * @brief   Checks if queries should generate approximate statistical data.
+ * @details Approximate mode is enabled with ::query_type_set_approximate or by setting
+ *          ::QUERY_TYPE_APPROXIMATE_ENVIRONMENT_VARIABLE to `1`. When that variable is set to
+ *          `auto`, approximate mode is only enabled under memory pressure (see
+ *          ::MEMORY_BUDGET_DEGRADATION_APPROXIMATE).
+ *
+ * @return Whether approximate mode is enabled.
+ */
+int query_type_get_approximate(void);
+
+/**
+ * @brief   Enables approximate statistical data for all queries that support it.
+ * @details Must be called before any statistics are generated, as they are cached (see
+ *          query_statistics_cache.h).
+ *
+ * @param approximate Whether approximate mode is enabled.
+ */
+void query_type_set_approximate(int approximate);
+
+/**
+ * @brief   Checks if queries should write partial outputs, to be merged with the outputs of other
+ *          partitions of a database (see ::query_type_merge_callback_t).
+ * @return  Whether partial mode is enabled.
+ */
+int query_type_get_partial(void);
+
+/**
+ * @brief   Makes queries with a ::query_type_merge_callback_t write partial outputs.
+ * @details Meant for processes that only hold a partition of a dataset, and that never write final
+ *          outputs.
+ *
+ * @param partial Whether partial mode is enabled.
+ */
+void query_type_set_partial(int partial);
+
 /**
  * @brief Frees memory in a ::query_type_t.
  * @param query Query to be deleted.
@@ -17,7 +17,11 @@
 /**
  * @file    query_type_list.h
  * @brief   The list of all supported queries.
- * @details Essentially, a list of `vtable`s.
+ * @details Essentially, a list of `vtable`s. The query types built into the program are also
+ *          listed at compile time (::QUERY_TYPE_LIST_FOREACH), so that they can be executed through
+ *          a `switch` over their type numbers (::query_type_list_execute), with direct calls that
+ *          the CPU predicts better than calls through a `vtable`, and that link-time optimization
+ *          may inline.
  *
  * @anchor query_type_list_example
  * ### Examples
@@ -43,6 +47,23 @@
 /** @brief Number of queries supported (1 to ::QUERY_TYPE_LIST_COUNT). */
 #define QUERY_TYPE_LIST_COUNT 10
 
+/**
+ * @brief   X-macro over every built-in query type.
+ * @details @p QUERY is called with the type number of each query and the prefix of its methods
+ *          (`qNN_create` and `qNN_execute`, see q01.h, for example).
+ */
+#define QUERY_TYPE_LIST_FOREACH(QUERY)                                                             \
+    QUERY(1, q01)                                                                                  \
+    QUERY(2, q02)                                                                                  \
+    QUERY(3, q03)                                                                                  \
+    QUERY(4, q04)                                                                                  \
+    QUERY(5, q05)                                                                                  \
+    QUERY(6, q06)                                                                                  \
+    QUERY(7, q07)                                                                                  \
+    QUERY(8, q08)                                                                                  \
+    QUERY(9, q09)                                                                                  \
+    QUERY(10, q10)
+
 /**
  * @brief   Gets a query definition by its numerical identifier (type).
  * @details Query indexing starts at `1` instead of `0`.
@@ -56,4 +77,21 @@
  */
 const query_type_t *query_type_list_get_by_index(size_t index);
 
+/**
+ * @brief   Executes a query, calling the method of its type directly.
+ * @details Equivalent to calling the ::query_type_execute_callback_t of the query's type, which is
+ *          still done for types not in this list (created with ::query_type_create elsewhere).
+ *
+ * @param database   Database to run the query on.
+ * @param statistics Statistical data generated for the query's type. Can be `NULL`.
+ * @param instance   Query to be executed.
+ * @param output     Where to write the query's output to.
+ *
+ * @return The value returned by the query's ::query_type_execute_callback_t.
+ */
+int query_type_list_execute(const database_t       *database,
+                            const void             *statistics,
+                            const query_instance_t *instance,
+                            query_writer_t         *output);
+
 #endif
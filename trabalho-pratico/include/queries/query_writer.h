@@ -83,15 +83,84 @@
  * ```
  *
  * Alternatively, we can provide an output file directly to ::query_writer_create, but
- * ::query_writer_get_lines wouldn't work.
+ * ::query_writer_get_lines wouldn't work. Output to files is buffered in memory, and only written
+ * (with a single `write`) when the writer is freed. ::query_writer_create_deferred goes further and
+ * only creates the file at that point, so that no file descriptor is kept open in the meantime.
+ *
+ * When only some lines of output are needed (e.g.: a page of them), ::query_writer_create_window
+ * creates a writer that only keeps (and formats) lines in a range. For example, a query run with
+ * `query_writer_create_window(1, 1, 2)` would only have the following lines as output, while
+ * ::query_writer_get_line_count would still count all of the lines above:
+ *
+ * ```text
+ * value: 0
+ * double: 0
+ * ```
+ *
+ * Large outputs don't need to be kept in memory as a whole: ::query_writer_create_streaming
+ * creates a writer that hands its output, as it would be written to a file, to a callback, in
+ * chunks of about ::QUERY_WRITER_STREAM_CHUNK_SIZE bytes (only split between objects).
+ *
+ * Outputs to files can also be compressed before being written (see ::query_writer_set_compressor).
+ *
+ * For programs reading query results, ::query_writer_create_binary creates a writer whose output
+ * isn't text, but a sequence of typed values (see ::query_writer_binary_tag_t), that doesn't need
+ * to be parsed. Field keys aren't included, and there's no formatted variant. Strings are copied
+ * as they are, and numbers aren't converted to text.
  */
 
 #ifndef QUERY_WRITER_H
 #define QUERY_WRITER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "queries/query_output_compressor.h"
+#include "utils/async_file_writer.h"
+
 /** @brief Information about where to output query results to. */
 typedef struct query_writer query_writer_t;
 
+/**
+ * @brief Number of bytes a streaming writer (see ::query_writer_create_streaming) accumulates
+ *        before handing them to its sink.
+ */
+#define QUERY_WRITER_STREAM_CHUNK_SIZE (1 << 16)
+
+/**
+ * @brief Capacity of a writer's buffer above which it's released by ::query_writer_reset, instead
+ *        of being kept for the next output.
+ */
+#define QUERY_WRITER_RESET_MAX_CAPACITY (1 << 20)
+
+/**
+ * @brief   Callback that receives the output of a streaming writer, one chunk at a time.
+ * @details Called by the thread running the query, that waits for the callback to return. So, the
+ *          callback can block to slow down a query whose output isn't being consumed fast enough.
+ *
+ * @param user_data Pointer provided to ::query_writer_create_streaming.
+ * @param data      Chunk of output (not null-terminated), that ends at the end of an object.
+ * @param length    Number of bytes in @p data.
+ *
+ * @retval 0 Success.
+ * @retval 1 The output can't be delivered. The rest of the output is discarded, and the writer is
+ *           marked as incomplete (see ::query_writer_is_incomplete).
+ */
+typedef int (*query_writer_sink_t)(void *user_data, const char *data, size_t length);
+
+/**
+ * @brief   Tags in the output of a binary writer (see ::query_writer_create_binary).
+ * @details Each tag is a single byte, followed by its value (if any). All integers are
+ *          little-endian.
+ */
+typedef enum {
+    QUERY_WRITER_BINARY_OBJECT   = 1, /**< @brief Start of an object. No value follows. */
+    QUERY_WRITER_BINARY_STRING   = 2, /**< @brief `uint32_t` length, followed by that many bytes. */
+    QUERY_WRITER_BINARY_SIGNED   = 3, /**< @brief `int64_t` value. */
+    QUERY_WRITER_BINARY_UNSIGNED = 4, /**< @brief `uint64_t` value. */
+    QUERY_WRITER_BINARY_NUMBER   = 5, /**< @brief IEEE 754 `double`, as a `uint64_t`. */
+} query_writer_binary_tag_t;
+
 /**
  * @brief Creates a place where to output query results to.
  *
@@ -107,6 +176,88 @@ typedef struct query_writer query_writer_t;
  */
 query_writer_t *query_writer_create(const char *out_file_path, int formatted);
 
+/**
+ * @brief   Creates a writer that outputs query results to a file, only created when the writer is
+ *          freed.
+ * @details Useful when there are many writers alive at the same time, as no file descriptor is
+ *          kept open for each one of them. However, IO errors are silently ignored, as they only
+ *          occur in ::query_writer_free.
+ *
+ * @param out_file_path Path to the file to be written. Cannot be `NULL`.
+ * @param formatted     Whether the output of the query should be formatted (pretty printed).
+ *
+ * @return A pointer to a ::query_writer_t that must be deleted with ::query_writer_free, or `NULL`
+ *         on allocation failure.
+ */
+query_writer_t *query_writer_create_deferred(const char *out_file_path, int formatted);
+
+/**
+ * @brief   Creates a writer that keeps query results in memory, formatted as they'd be in a file.
+ * @details Nothing is written to any file. The output is obtained with ::query_writer_get_output,
+ *          so that it can be written somewhere else (e.g.: a
+ *          [pack of outputs](@ref query_output_pack.h)).
+ *
+ * @param formatted Whether the output of the query should be formatted (pretty printed).
+ *
+ * @return A pointer to a ::query_writer_t that must be deleted with ::query_writer_free, or `NULL`
+ *         on allocation failure.
+ */
+query_writer_t *query_writer_create_buffered(int formatted);
+
+/**
+ * @brief   Creates a writer that hands query results to a callback, as they're written.
+ * @details The output is formatted as it would be in a file. Once at least
+ *          ::QUERY_WRITER_STREAM_CHUNK_SIZE bytes are buffered, they're handed to @p sink before
+ *          the next object starts. The last chunk isn't: it's obtained with
+ *          ::query_writer_get_output, after the query finishes.
+ *
+ * @param formatted Whether the output of the query should be formatted (pretty printed).
+ * @param sink      Callback that receives chunks of output.
+ * @param user_data Argument passed to @p sink.
+ *
+ * @return A new writer, or `NULL` on allocation failure.
+ */
+query_writer_t *query_writer_create_streaming(int                 formatted,
+                                              query_writer_sink_t sink,
+                                              void               *user_data);
+
+/**
+ * @brief   Creates a writer that keeps query results in memory, encoded in binary.
+ * @details Fields are encoded according to their format string: `%s` as a
+ *          ::QUERY_WRITER_BINARY_STRING, integer conversions as a ::QUERY_WRITER_BINARY_SIGNED or
+ *          ::QUERY_WRITER_BINARY_UNSIGNED, and `%.3f` as a ::QUERY_WRITER_BINARY_NUMBER. Any other
+ *          format is formatted as text, and encoded as a string. The output is obtained with
+ *          ::query_writer_get_output.
+ *
+ * @return A new writer, or `NULL` on allocation failure.
+ */
+query_writer_t *query_writer_create_binary(void);
+
+/**
+ * @brief  Checks if a query writer outputs binary data (see ::query_writer_create_binary).
+ * @param  writer Query writer.
+ * @return Whether @p writer outputs binary data instead of text.
+ */
+int query_writer_is_binary(const query_writer_t *writer);
+
+/**
+ * @brief   Creates a writer that outputs query results to a list of strings, only keeping some of
+ *          them.
+ * @details Lines outside of the window aren't formatted, so running a query with a small window is
+ *          much faster than formatting all of its output, when there are many lines of it.
+ *
+ * @param formatted Whether the output of the query should be formatted (pretty printed).
+ * @param first     Index of the first line of output to be kept.
+ * @param count     Maximum number of lines of output to be kept.
+ *
+ * @return A pointer to a ::query_writer_t that must be deleted with ::query_writer_free, or `NULL`
+ *         on allocation failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref query_writer_examples).
+ */
+query_writer_t *query_writer_create_window(int formatted, size_t first, size_t count);
+
 /**
  * @brief Marks that a new object will start to be written (a new flight, a new user, ...).
  * @param writer Where to write a query's output to.
@@ -130,9 +281,28 @@ void query_writer_write_new_object(query_writer_t *writer);
 void query_writer_write_new_field(query_writer_t *writer, const char *key, const char *format, ...)
     __attribute__((format(printf, 3, 4)));
 
+/**
+ * @brief   Writes a query's whole output at once, already formatted.
+ * @details Nothing else can be written to @p writer, before or after this is called. Writers that
+ *          output to files get @p output in a single copy, while lines are only split out of it
+ *          for writers that output to lists of strings.
+ *
+ * @param writer  Where to write the query's output to. Can't be a binary writer.
+ * @param output  Output obtained with ::query_writer_get_output, from a writer with the same
+ *                formatting as @p writer.
+ * @param length  Number of characters in @p output.
+ * @param objects Number of objects in @p output (see ::query_writer_get_object_count).
+ */
+void query_writer_write_rendered(query_writer_t *writer,
+                                 const char     *output,
+                                 size_t          length,
+                                 size_t          objects);
+
 /**
  * @brief   Gets the lines outputted by a query writer.
- * @details Will only work if `NULL` was provided as a file path to ::query_writer_create.
+ * @details Will only work if `NULL` was provided as a file path to ::query_writer_create, or if
+ *          the writer was created with ::query_writer_create_window. In the latter case, only the
+ *          lines in the writer's window are returned.
  *
  * @param writer Where a query's output has been written to. Cannot be `const`, as some internal
  *               buffers may need to be flushed before returning this value.
@@ -146,8 +316,156 @@ void query_writer_write_new_field(query_writer_t *writer, const char *key, const
 const char *const *query_writer_get_lines(query_writer_t *writer, size_t *out_n);
 
 /**
- * @brief Frees memory allocated by ::query_writer_create.
- * @param writer Non-`NULL` value returned by ::query_writer_create.
+ * @brief   Gets everything outputted by a query writer, as it is (or would be) written to a file.
+ * @details Will only work for writers that output to files (including buffered writers, created
+ *          with ::query_writer_create_buffered, and binary ones). Nothing else can be written to
+ *          @p writer after this is called.
+ *
+ * @param writer Where a query's output has been written to. Cannot be `const`, as the last line
+ *               of output may need to be terminated before returning this value.
+ * @param length Where to output the number of characters of output to.
+ *
+ * @return The output of the query (not null-terminated), that lives as long as @p writer, or
+ *         `NULL` if @p writer doesn't output to a file.
+ */
+const char *query_writer_get_output(query_writer_t *writer, size_t *length);
+
+/**
+ * @brief   Gets the total number of lines outputted by a query writer.
+ * @details Unlike ::query_writer_get_lines, lines outside of the window of writers created with
+ *          ::query_writer_create_window are also counted.
+ *
+ * @param writer Where a query's output has been written to. Cannot be `const`, as some internal
+ *               buffers may need to be flushed before returning this value.
+ *
+ * @return The number of lines outputted by a query, or `0` for writers that output to files.
+ */
+size_t query_writer_get_line_count(query_writer_t *writer);
+
+/**
+ * @brief  Gets the number of objects (records) outputted by a query writer.
+ * @param  writer Where a query's output has been written to.
+ * @return The number of calls to ::query_writer_write_new_object on @p writer.
+ */
+size_t query_writer_get_object_count(const query_writer_t *writer);
+
+/**
+ * @brief   Marks the output of a query writer as incomplete.
+ * @details Called when the query writing to @p writer is cancelled (see ::query_cancellation_t).
+ *          What was already written is kept.
+ * @param   writer Writer whose output is incomplete.
+ */
+void query_writer_set_incomplete(query_writer_t *writer);
+
+/**
+ * @brief  Checks if the output of a query writer is incomplete.
+ * @param  writer Where a query's output has been written to.
+ * @return Whether ::query_writer_set_incomplete was called on @p writer.
+ */
+int query_writer_is_incomplete(const query_writer_t *writer);
+
+/**
+ * @brief   Gets the number of characters outputted by a query writer.
+ * @details For writers created with ::query_writer_create_window, only the lines in the window
+ *          are counted. Writers that output to files must not have been flushed yet, and the new
+ *          line that terminates unformatted outputs isn't counted.
+ *
+ * @param writer Where a query's output has been written to. Cannot be `const`, as some internal
+ *               buffers may need to be flushed before returning this value.
+ *
+ * @return The size of the output of @p writer, in bytes.
+ */
+size_t query_writer_get_output_size(query_writer_t *writer);
+
+/**
+ * @brief   Sets whether a query writer measures the time spent formatting its output.
+ * @details Measuring adds two clock readings to every object and field, so it's disabled by
+ *          default.
+ *
+ * @param writer  Writer to be modified.
+ * @param measure Whether to measure the time spent in ::query_writer_write_new_object and
+ *                ::query_writer_write_new_field.
+ */
+void query_writer_set_measure_formatting(query_writer_t *writer, int measure);
+
+/**
+ * @brief  Gets the time a query writer spent formatting its output.
+ * @param  writer Writer that measures formatting (see ::query_writer_set_measure_formatting).
+ * @return The number of nanoseconds spent formatting, while measuring was enabled.
+ */
+uint64_t query_writer_get_formatting_time(const query_writer_t *writer);
+
+/**
+ * @brief   Sets the compressor of the output of a query writer.
+ * @details The output is compressed right before being written to its file (by
+ *          ::query_writer_flush, ::query_writer_flush_async or ::query_writer_free), and written
+ *          as it is if compression fails. The file's name isn't changed (see
+ *          ::QUERY_OUTPUT_COMPRESSOR_SUFFIX).
+ *
+ * @param writer     Writer created with ::query_writer_create_deferred.
+ * @param compressor Compressor of outputs, that must outlive @p writer. `NULL` for no compression.
+ */
+void query_writer_set_compressor(query_writer_t *writer, query_output_compressor_t *compressor);
+
+/**
+ * @brief   Writes a query's output to its file and releases the memory it was buffered in.
+ * @details Meant for outputs that are complete, so that they can be written to disk while other
+ *          queries are still being executed. Nothing else can be written to @p writer afterwards,
+ *          and it still must be freed with ::query_writer_free. For writers created with
+ *          ::query_writer_create_buffered, the output is discarded (get it first with
+ *          ::query_writer_get_output). This does nothing to writers that output to a list of
+ *          strings.
+ *
+ * @param writer Where a query's output has been written to.
+ */
+void query_writer_flush(query_writer_t *writer);
+
+/**
+ * @brief   Like ::query_writer_flush, but hands the output file to an asynchronous file writer.
+ * @details Only writers created with ::query_writer_create_deferred whose file hasn't been opened
+ *          yet are written through @p files (which takes ownership of the output buffer). Every
+ *          other writer is flushed with ::query_writer_flush.
+ *
+ * @param writer Where a query's output has been written to.
+ * @param files  Writer of files where to submit the output file to.
+ *
+ * @retval 0 Success (the file may not have been written yet).
+ * @retval 1 Failure reported by ::async_file_writer_write.
+ */
+int query_writer_flush_async(query_writer_t *writer, async_file_writer_t *files);
+
+/**
+ * @brief   Empties a writer, so that it can be reused for the output of another query.
+ * @details Memory already allocated for output is kept, so that writing output of the same size
+ *          again doesn't allocate anything. Only the first block of a list of strings is kept, and
+ *          large buffers (over ::QUERY_WRITER_RESET_MAX_CAPACITY bytes) are released. Windows (see
+ *          ::query_writer_set_window), sinks (see ::query_writer_create_streaming) and whether
+ *          formatting time is measured are kept.
+ *
+ * @param writer    Writer that doesn't output to a file (created with ::query_writer_create with a
+ *                  `NULL` path, ::query_writer_create_window, ::query_writer_create_buffered,
+ *                  ::query_writer_create_streaming or ::query_writer_create_binary). Lines and
+ *                  outputs previously obtained from it are no longer valid.
+ * @param formatted Whether the next output should be formatted (pretty printed).
+ */
+void query_writer_reset(query_writer_t *writer, int formatted);
+
+/**
+ * @brief Changes which lines of output a writer keeps (see ::query_writer_create_window).
+ *
+ * @param writer Writer that outputs to a list of strings, and that has nothing written to it yet
+ *               (e.g.: after ::query_writer_reset).
+ * @param first  Index of the first line of output to be kept.
+ * @param count  Maximum number of lines of output to be kept.
+ */
+void query_writer_set_window(query_writer_t *writer, size_t first, size_t count);
+
+/**
+ * @brief   Frees memory allocated by ::query_writer_create.
+ * @details When outputting to a file, this is when the output is written to it.
+ * @param   writer Non-`NULL` value returned by ::query_writer_create,
+ *                 ::query_writer_create_deferred, ::query_writer_create_buffered or
+ *                 ::query_writer_create_window.
  *
  * #### Examples
  * See [the header file's documentation](@ref query_writer_examples).
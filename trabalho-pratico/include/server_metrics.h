@@ -0,0 +1,193 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    server_metrics.h
+ * @brief   Live metrics of [server mode](@ref server_mode.h), in Prometheus' text exposition
+ *          format.
+ * @details Unlike ::performance_metrics_t, which keeps every measurement of a run and is printed
+ *          when the program exits, server metrics are a fixed set of counters and histograms,
+ *          that can be read at any time, while the server keeps running. Counters are updated with
+ *          atomic operations, without locks, so they can be updated from any thread (e.g.: the
+ *          thread reloading the dataset).
+ *
+ *          The following metrics are exported:
+ *
+ *          - `li3_requests_total{type}`: requests received, by query type (`prepare`, `invalid`
+ *            and `rejected` for requests that aren't run);
+ *          - `li3_request_duration_seconds{type}`: histogram of the time between receiving a query
+ *            and queuing its response;
+ *          - `li3_batches_total` and `li3_batched_queries_total`: how many queries share the
+ *            statistical data generated for each batch;
+ *          - `li3_id_filter_lookups_total{result}`: how lookups in the database's identifier
+ *            filters were answered;
+ *          - `li3_resident_memory_bytes` and `li3_database_memory_bytes{structure,kind}`: memory
+ *            of the process and of every pool and index in the database;
+ *          - `li3_dataset_load_duration_seconds`, `li3_dataset_reloads_total{result}` and
+ *            `li3_dataset_last_reload_duration_seconds`: loading and reloading of the dataset;
+ *          - `li3_resident_datasets`, `li3_dataset_activations_total{result}` and
+ *            `li3_dataset_evictions_total`: datasets kept in memory, when the server serves more
+ *            than one.
+ *
+ * @anchor server_metrics_examples
+ * ### Examples
+ *
+ * ```c
+ * server_metrics_t *metrics = server_metrics_create();
+ * server_metrics_count_request(metrics, 4, 1500); // A Q4 answered in 1.5 ms
+ *
+ * char *text = server_metrics_format(metrics, database);
+ * fputs(text, stdout);
+ * free(text);
+ *
+ * server_metrics_free(metrics);
+ * ```
+ */
+
+#ifndef SERVER_METRICS_H
+#define SERVER_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "database/database.h"
+
+/** @brief Live metrics of the query server. */
+typedef struct server_metrics server_metrics_t;
+
+/**
+ * @enum  server_metrics_request_t
+ * @brief Requests that aren't queries to be run, counted by ::server_metrics_count_other_request.
+ *
+ * @var server_metrics_request_t::SERVER_METRICS_REQUEST_PREPARE
+ *     @brief A `PREPARE` request.
+ * @var server_metrics_request_t::SERVER_METRICS_REQUEST_PROTOCOL
+ *     @brief A `PROTOCOL` request.
+ * @var server_metrics_request_t::SERVER_METRICS_REQUEST_INVALID
+ *     @brief A request that couldn't be parsed.
+ * @var server_metrics_request_t::SERVER_METRICS_REQUEST_REJECTED
+ *     @brief A request rejected because the server was overloaded.
+ * @var server_metrics_request_t::SERVER_METRICS_REQUEST_TIMED_OUT
+ *     @brief A query stopped because it exceeded its time budget.
+ * @var server_metrics_request_t::SERVER_METRICS_REQUEST_COUNT
+ *     @brief Number of kinds of requests in this enumeration.
+ */
+typedef enum {
+    SERVER_METRICS_REQUEST_PREPARE,
+    SERVER_METRICS_REQUEST_PROTOCOL,
+    SERVER_METRICS_REQUEST_INVALID,
+    SERVER_METRICS_REQUEST_REJECTED,
+    SERVER_METRICS_REQUEST_TIMED_OUT,
+    SERVER_METRICS_REQUEST_COUNT
+} server_metrics_request_t;
+
+/**
+ * @brief   Creates a set of server metrics, with all counters at `0`.
+ * @details The returned value is owned by the caller, and should be freed with
+ *          ::server_metrics_free.
+ *
+ * @return A new ::server_metrics_t, or `NULL` on allocation failure.
+ */
+server_metrics_t *server_metrics_create(void);
+
+/**
+ * @brief Counts a query that was run.
+ *
+ * @param metrics  Metrics to be updated.
+ * @param type     Type of the query (from `1` to ::QUERY_TYPE_LIST_COUNT).
+ * @param duration Microseconds between receiving the query and queuing its response.
+ */
+void server_metrics_count_request(server_metrics_t *metrics, size_t type, uint64_t duration);
+
+/**
+ * @brief Counts a request that didn't result in a query being run.
+ *
+ * @param metrics Metrics to be updated.
+ * @param request Kind of the request.
+ */
+void server_metrics_count_other_request(server_metrics_t        *metrics,
+                                        server_metrics_request_t request);
+
+/**
+ * @brief Counts a batch of queries that was run.
+ *
+ * @param metrics  Metrics to be updated.
+ * @param nqueries Number of queries in the batch.
+ */
+void server_metrics_count_batch(server_metrics_t *metrics, size_t nqueries);
+
+/**
+ * @brief Sets how long the dataset took to load when the server started.
+ *
+ * @param metrics  Metrics to be updated.
+ * @param duration Duration of the load, in microseconds.
+ */
+void server_metrics_set_load_duration(server_metrics_t *metrics, uint64_t duration);
+
+/**
+ * @brief Counts a reload of the dataset.
+ *
+ * @param metrics  Metrics to be updated.
+ * @param success  Whether the new dataset was loaded successfully.
+ * @param duration Duration of the reload, in microseconds.
+ */
+void server_metrics_count_reload(server_metrics_t *metrics, int success, uint64_t duration);
+
+/**
+ * @brief Counts an evicted dataset being restored, to answer queries sent to it.
+ *
+ * @param metrics Metrics to be updated.
+ * @param success Whether the dataset was restored successfully.
+ */
+void server_metrics_count_activation(server_metrics_t *metrics, int success);
+
+/**
+ * @brief Counts a dataset evicted from memory, as it was the least recently used one.
+ * @param metrics Metrics to be updated.
+ */
+void server_metrics_count_eviction(server_metrics_t *metrics);
+
+/**
+ * @brief Sets how many datasets are kept in memory.
+ *
+ * @param metrics  Metrics to be updated.
+ * @param resident Number of datasets in memory.
+ */
+void server_metrics_set_resident_datasets(server_metrics_t *metrics, size_t resident);
+
+/**
+ * @brief   Formats all metrics in Prometheus' text exposition format.
+ * @details Gauges (memory usage, identifier filter statistics) are measured when this method is
+ *          called.
+ *
+ * @param metrics  Metrics to be formatted.
+ * @param database Database whose memory and filters are measured. Can be `NULL`, for only the
+ *                 memory of the process to be measured.
+ *
+ * @return A `malloc`-allocated string, that must be `free`d, or `NULL` on allocation failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref server_metrics_examples).
+ */
+char *server_metrics_format(const server_metrics_t *metrics, const database_t *database);
+
+/**
+ * @brief Frees memory used by server metrics.
+ * @param metrics Metrics to be freed.
+ */
+void server_metrics_free(server_metrics_t *metrics);
+
+#endif
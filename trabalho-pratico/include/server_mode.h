@@ -0,0 +1,186 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    server_mode.h
+ * @brief   Server mode (answer queries sent through a Unix domain socket).
+ * @details The dataset is loaded only once, and then queries can be sent by any number of clients,
+ *          connected to a stream socket. Clients send queries, one per line, in the same syntax as
+ *          query files in [batch mode](@ref batch_mode.h). For each query, in the order they were
+ *          sent, the server answers with a line containing the number of lines of output (or `-1`
+ *          for queries that can't be parsed), followed by those lines of output.
+ *
+ *          All sockets are handled by a single thread, with non-blocking IO and `epoll`, so idle
+ *          connections only cost their buffers. Requests are parsed as soon as complete lines
+ *          arrive, and queries are run by the thread pool of the
+ *          [query dispatcher](@ref query_dispatcher.h).
+ *
+ *          Queries sent many times with different arguments can be prepared once, as a
+ *          [query template](@ref query_template.h), with `PREPARE <template>` (e.g.:
+ *          `PREPARE 8 HTL1001 ? ?`). The response is one line, with the statement's identifier (or
+ *          `-1` on failure). Then, `EXECUTE <id> <parameters>` (e.g.:
+ *          `EXECUTE 0 2023/10/01 2023/10/31`) runs the statement, and is answered like a query.
+ *          Statements belong to the connection that prepared them.
+ *
+ *          Programs can instead get responses in binary, after sending `PROTOCOL BINARY` (and go
+ *          back to text with `PROTOCOL TEXT`). Each response is then an `int64_t` with the number
+ *          of objects (or the negative codes below), followed by the `uint64_t` length of the
+ *          query's output and that output, a sequence of typed fields without keys (see
+ *          ::query_writer_create_binary). The `PROTOCOL` request itself is answered with `0`
+ *          objects, already in the new protocol.
+ *
+ *          Large outputs can be received as they're generated, after sending `PROTOCOL CHUNKED`.
+ *          Responses to queries then start with a line with `*`, followed by chunks of output,
+ *          each preceded by a line with its length in bytes, and end with an empty chunk (`0`) and
+ *          a line with the number of lines of output (or `-3`). Other responses are the same as in
+ *          text. While nothing else is waiting to be sent to a client, chunks are sent by the
+ *          thread running the query, as soon as they're written, so the whole output is never kept
+ *          in memory. That thread waits for the client to read its chunks, and the client is
+ *          disconnected if it doesn't for 30 seconds.
+ *
+ *          Queries that arrive at about the same time, from any clients, are run together with
+ *          ::query_dispatcher_dispatch_list, so that statistical data is generated once per type of
+ *          query, and not once per query. A batching window can be configured, for the server to
+ *          wait for more queries after the first one in a batch. Within a batch, queries whose type
+ *          generates statistical data are run after all others, and responses to cheaper queries
+ *          are sent in between (without reordering the responses to each client). Each client can
+ *          have a limited number of requests in a batch, and the remaining ones wait for the next
+ *          batches.
+ *
+ *          When too many responses are waiting to be sent (clients not reading them), new requests
+ *          are rejected, and answered with `-2` instead of being run. Queries that exceed their
+ *          time budget (in milliseconds, from the `LI3_QUERY_TIMEOUT` environment variable, see
+ *          [query cancellation](@ref query_cancellation.h)) are stopped, and answered with `-3`
+ *          instead of their partial output. The time budget applies to each batch of queries with
+ *          the same priority.
+ *
+ *          A server can serve many named datasets (e.g.: one per region), given as
+ *          `name=path,name=path` instead of the path of a single dataset (named `default`). Each
+ *          client's queries are run on the first dataset, until it selects another one with
+ *          `DATASET <name>`, answered like `PROTOCOL` (or with `-1` for unknown names). Queries
+ *          sent to each dataset in a batch are run together, one priority class at a time over all
+ *          datasets.
+ *
+ *          All datasets are loaded when the server starts, which stores their
+ *          [snapshots](@ref dataset_snapshot.h) when snapshots are on (see
+ *          ::DATASET_SNAPSHOT_DIRECTORY_ENVIRONMENT_VARIABLE). With a budget, in mebibytes, in
+ *          ::SERVER_MODE_RESIDENT_BUDGET_ENVIRONMENT_VARIABLE, the memory reserved by each
+ *          dataset (its entities, indexes and cached statistical data) is measured after every
+ *          batch it's used in, and, while the total exceeds the budget, the least recently used
+ *          datasets are evicted (except the one used last). The next batch with queries to an
+ *          evicted dataset restores it from its snapshot (or parses its files again) first, and
+ *          its queries are answered with `-2` if that fails. Only the first dataset's snapshot is
+ *          served to replicas, and only its memory is in the server's metrics.
+ *
+ *          Sending `SIGHUP` to the server reloads the dataset (e.g.: after its files were
+ *          replaced), without downtime. The new database is loaded (or restored from a
+ *          [snapshot](@ref dataset_snapshot.h)) in a background thread, while queries keep being
+ *          answered with the current one. Loading is paused while queries are run, so that it
+ *          doesn't slow them down. Once the new database is ready, it replaces the current one
+ *          between two batches of queries, and the old one is freed in the background. If the
+ *          reload fails, the current database keeps being used. Datasets in memory are reloaded
+ *          one after the other, and evicted ones are restored from their current files anyway.
+ *
+ *          Metrics of the server (requests, latency, batching, memory usage and reloads) are
+ *          available in [Prometheus' text format](@ref server_metrics.h), by sending an HTTP
+ *          `GET /metrics` request to the same socket. The connection is closed after the response.
+ *
+ *          The [snapshot](@ref dataset_snapshot.h) of the dataset, if snapshots are on, is also
+ *          served on the same socket, so that replicas of the server can answer queries without
+ *          the dataset's files (see [dataset shipping](@ref dataset_shipping.h)). A replica
+ *          downloads the snapshot of its primary server, resuming any previous download, and
+ *          restores the database from it instead of parsing the dataset. Sending `SIGHUP` to a
+ *          replica downloads the primary's current snapshot and reloads the database from it.
+ *
+ *          Requests can be captured, to be replayed later by the
+ *          [load generator](@ref load_generator.h), by setting
+ *          ::SERVER_MODE_REQUEST_LOG_ENVIRONMENT_VARIABLE to the path of a file. A line is appended
+ *          to it for each request (except HTTP ones), with the time it was received (milliseconds
+ *          since the Unix epoch), a tab and the request.
+ *
+ *          The server runs until it receives `SIGINT` or `SIGTERM`.
+ *
+ * @anchor server_mode_examples
+ * ### Examples
+ *
+ * Start the server with `./programa-principal --server dataset /tmp/queries.sock`. Then, for
+ * example, use `socat` to send a query:
+ *
+ * ```text
+ * $ echo "1 0000000291" | socat - UNIX-CONNECT:/tmp/queries.sock
+ * 1
+ * Iberia;B737;FAR;NYC;2022/03/05 17:00:00;2022/03/05 19:30:00;19;60
+ * ```
+ *
+ * Metrics can be scraped with `curl`:
+ *
+ * ```text
+ * $ curl --unix-socket /tmp/queries.sock http://localhost/metrics
+ * ```
+ */
+
+#ifndef SERVER_MODE_H
+#define SERVER_MODE_H
+
+/** @brief Environment variable with the path of the file where requests are captured to. */
+#define SERVER_MODE_REQUEST_LOG_ENVIRONMENT_VARIABLE "LI3_REQUEST_LOG"
+
+/**
+ * @brief Environment variable with the memory budget of the datasets of a server, in mebibytes.
+ *        Datasets aren't evicted if it's unset or `0`.
+ */
+#define SERVER_MODE_RESIDENT_BUDGET_ENVIRONMENT_VARIABLE "LI3_SERVER_RESIDENT_BUDGET"
+
+/**
+ * @brief Starts server mode.
+ *
+ * @param dataset_dir Path to the directory containing the dataset, or a comma-separated list of
+ *                    named datasets (`name=path,name=path`).
+ * @param socket_path Path of the Unix domain socket to be created. If a file already exists in this
+ *                    path, it's replaced.
+ * @param window      Milliseconds to wait for more queries after the first one in a batch, before
+ *                    running it. `0` runs queries as soon as they arrive.
+ *
+ * @retval 0 Success (the server was stopped by a signal).
+ * @retval 1 Fatal failure (allocation / IO errors). A message will also be printed to `stderr`.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref server_mode_examples).
+ */
+int server_mode_run(const char *dataset_dir, const char *socket_path, unsigned int window);
+
+/**
+ * @brief Starts server mode, as a replica of another server.
+ *
+ * @param primary_socket Path of the Unix domain socket of the primary server.
+ * @param directory      Directory where the primary's snapshot is downloaded to (and where
+ *                       previous downloads are resumed from).
+ * @param socket_path    Path of the Unix domain socket to be created. If a file already exists in
+ *                       this path, it's replaced.
+ * @param window         Milliseconds to wait for more queries after the first one in a batch,
+ *                       before running it. `0` runs queries as soon as they arrive.
+ *
+ * @retval 0 Success (the server was stopped by a signal).
+ * @retval 1 Fatal failure (download, allocation or IO errors). A message will also be printed to
+ *           `stderr`.
+ */
+int server_mode_run_replica(const char  *primary_socket,
+                            const char  *directory,
+                            const char  *socket_path,
+                            unsigned int window);
+
+#endif
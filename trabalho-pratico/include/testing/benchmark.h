@@ -0,0 +1,186 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    benchmark.h
+ * @brief   Harness for microbenchmarks, that time a small piece of code many times.
+ * @details A ::benchmark_t runs the same number of operations in every repetition. After
+ *          ::BENCHMARK_WARMUP_RUNS untimed runs (to fill caches and fault pages in), each
+ *          repetition is timed, and ::benchmark_run reports the minimum, the median and the median
+ *          absolute deviation (MAD) of the time per operation. The median and the MAD are much less
+ *          sensitive than the mean and the standard deviation to the outliers caused by other
+ *          processes. CPU cycles per operation are also reported, when hardware counters are
+ *          available (see ::performance_event_get_counter).
+ *
+ *          State that shouldn't be timed (e.g.: an empty pool to allocate from) is created by
+ *          ::benchmark_t::setup and destroyed by ::benchmark_t::teardown, around every repetition.
+ *
+ * @anchor benchmark_example
+ * ### Example
+ *
+ * ```c
+ * void run(void *state) {
+ *     const char *const *strings = state;
+ *     for (size_t i = 0; i < 1000; ++i)
+ *         benchmark_consume(strlen(strings[i % 10]));
+ * }
+ *
+ * int main(void) {
+ *     const char *strings[10] = {"a", "bb", ...};
+ *     const benchmark_t benchmark = {.name       = "strlen",
+ *                                    .operations = 1000,
+ *                                    .setup      = NULL,
+ *                                    .run        = run,
+ *                                    .teardown   = NULL,
+ *                                    .data       = strings};
+ *
+ *     benchmark_result_t result;
+ *     if (benchmark_run(&benchmark, 15, &result))
+ *         return 1;
+ *
+ *     benchmark_print_header(stdout);
+ *     benchmark_print_result(stdout, &benchmark, &result);
+ *     return 0;
+ * }
+ * ```
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/** @brief Number of runs of a ::benchmark_t before the timed repetitions. */
+#define BENCHMARK_WARMUP_RUNS 3
+
+/**
+ * @brief  Creates the state of a repetition of a ::benchmark_t.
+ * @param  data ::benchmark_t::data.
+ * @return The state passed to ::benchmark_t::run and ::benchmark_t::teardown, or `NULL` on
+ *         failure.
+ */
+typedef void *(*benchmark_setup_callback_t)(void *data);
+
+/**
+ * @brief Runs the ::benchmark_t::operations operations of a repetition of a ::benchmark_t.
+ * @param state State returned by ::benchmark_t::setup, or ::benchmark_t::data if there's no setup.
+ */
+typedef void (*benchmark_run_callback_t)(void *state);
+
+/**
+ * @brief Destroys the state of a repetition of a ::benchmark_t.
+ * @param state State returned by ::benchmark_t::setup.
+ */
+typedef void (*benchmark_teardown_callback_t)(void *state);
+
+/**
+ * @struct benchmark_t
+ * @brief  A microbenchmark.
+ *
+ * @var benchmark_t::name
+ *     @brief Name of the benchmark.
+ * @var benchmark_t::operations
+ *     @brief Number of operations in each repetition, that times are divided by.
+ * @var benchmark_t::setup
+ *     @brief Method called before every repetition, without being timed. Can be `NULL`.
+ * @var benchmark_t::run
+ *     @brief Method that runs a repetition.
+ * @var benchmark_t::teardown
+ *     @brief Method called after every repetition, without being timed. Can be `NULL`.
+ * @var benchmark_t::data
+ *     @brief Argument passed to ::benchmark_t::setup (or ::benchmark_t::run, without a setup).
+ */
+typedef struct {
+    const char                   *name;
+    size_t                        operations;
+    benchmark_setup_callback_t    setup;
+    benchmark_run_callback_t      run;
+    benchmark_teardown_callback_t teardown;
+    void                         *data;
+} benchmark_t;
+
+/**
+ * @struct benchmark_result_t
+ * @brief  Statistics of the repetitions of a ::benchmark_t.
+ *
+ * @var benchmark_result_t::min
+ *     @brief Nanoseconds per operation in the fastest repetition.
+ * @var benchmark_result_t::median
+ *     @brief Median of the nanoseconds per operation of all repetitions.
+ * @var benchmark_result_t::mad
+ *     @brief Median absolute deviation of the nanoseconds per operation of all repetitions.
+ * @var benchmark_result_t::operations_per_second
+ *     @brief Operations per second, from ::benchmark_result_t::median.
+ * @var benchmark_result_t::cycles
+ *     @brief Median of the CPU cycles per operation, or a negative value if cycles couldn't be
+ *            counted.
+ */
+typedef struct {
+    double min, median, mad;
+    double operations_per_second;
+    double cycles;
+} benchmark_result_t;
+
+/**
+ * @brief   Makes a value observable, so that the compiler can't optimize away its calculation.
+ * @details Defined in another translation unit, so that calls aren't inlined.
+ * @param   value Value calculated by a benchmark.
+ */
+void benchmark_consume(uint64_t value);
+
+/**
+ * @brief Runs a benchmark.
+ *
+ * @param benchmark   Benchmark to be run.
+ * @param repetitions Number of timed repetitions (at least `1`).
+ * @param result      Where to write the statistics of the repetitions to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or failure in ::benchmark_t::setup.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref benchmark_example).
+ */
+int benchmark_run(const benchmark_t *benchmark, size_t repetitions, benchmark_result_t *result);
+
+/**
+ * @brief Prints the header of a table of benchmark results.
+ * @param output Where to print the header to.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref benchmark_example).
+ */
+void benchmark_print_header(FILE *output);
+
+/**
+ * @brief Prints the results of a benchmark, as a row of the table started by
+ *        ::benchmark_print_header.
+ *
+ * @param output    Where to print the results to.
+ * @param benchmark Benchmark that was run.
+ * @param result    Results of @p benchmark.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref benchmark_example).
+ */
+void benchmark_print_result(FILE                     *output,
+                            const benchmark_t        *benchmark,
+                            const benchmark_result_t *result);
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    dataset_generator.h
+ * @brief   Generator of synthetic datasets and query files, of any size, for benchmarking.
+ * @details The generated files follow the same format as the course's datasets, with similar value
+ *          distributions: a few airports and hotels are much more popular than the others (Zipf
+ *          distributions), and some users fly and book hotels much more than others. A
+ *          configurable fraction of the lines is made invalid, by corrupting one of its fields.
+ *
+ *          Generation is deterministic: the same options always generate the same files, so that
+ *          scaling curves can be reproduced.
+ *
+ *          Besides these average-case datasets, a ::dataset_generator_scenario_t can be chosen, to
+ *          generate a dataset that stresses the worst case of some queries or of the dataset
+ *          loader (e.g.: a single hotel with half of all reservations, and a query file that always
+ *          asks about it).
+ *
+ * @anchor dataset_generator_example
+ * ### Example
+ *
+ * See generator.c, the entry point of the dataset generator program.
+ */
+
+#ifndef DATASET_GENERATOR_H
+#define DATASET_GENERATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Kind of dataset to be generated, each stressing a different worst case. */
+typedef enum {
+    DATASET_GENERATOR_SCENARIO_TYPICAL, /**< Average-case dataset and queries. */
+
+    /** @brief Half of the reservations are in one hotel, the target of all queries 3, 4 and 8. */
+    DATASET_GENERATOR_SCENARIO_HOT_HOTEL,
+
+    /**
+     * @brief Half of the flights depart from (and half arrive to) one airport, the target of all
+     *        queries 5.
+     */
+    DATASET_GENERATOR_SCENARIO_HOT_AIRPORT,
+
+    /**
+     * @brief Half of the passengers and reservations belong to a few users, the targets of all
+     *        queries 1 and 2.
+     */
+    DATASET_GENERATOR_SCENARIO_HEAVY_USERS,
+
+    /** @brief All queries are of type 9, with single-letter prefixes. */
+    DATASET_GENERATOR_SCENARIO_SHORT_PREFIXES,
+
+    /** @brief One in a hundred users, flights and reservations have a very long free-text field. */
+    DATASET_GENERATOR_SCENARIO_LONG_LINES,
+
+    /** @brief At least half of the lines in each file are invalid. */
+    DATASET_GENERATOR_SCENARIO_INVALID_ROWS,
+
+    DATASET_GENERATOR_SCENARIO_COUNT /**< Number of scenarios. Not a valid scenario. */
+} dataset_generator_scenario_t;
+
+/**
+ * @struct dataset_generator_options_t
+ * @brief  Parameters of a dataset to be generated.
+ *
+ * @var dataset_generator_options_t::scale
+ *     @brief Size of the dataset. At scale `1`, 10 000 users, 1 000 flights and 20 000
+ *            reservations are generated, with about 190 000 passengers.
+ * @var dataset_generator_options_t::invalid_rate
+ *     @brief Fraction (between `0` and `1`) of the lines in each file that will be made invalid.
+ * @var dataset_generator_options_t::seed
+ *     @brief Seed of the pseudo-random number generator.
+ * @var dataset_generator_options_t::query_count
+ *     @brief Number of queries in the generated query file.
+ * @var dataset_generator_options_t::scenario
+ *     @brief Worst case the dataset and the query file stress.
+ */
+typedef struct {
+    double                       scale;
+    double                       invalid_rate;
+    uint64_t                     seed;
+    size_t                       query_count;
+    dataset_generator_scenario_t scenario;
+} dataset_generator_options_t;
+
+/**
+ * @brief   Generates a dataset and a query file.
+ * @details `users.csv`, `flights.csv`, `passengers.csv`, `reservations.csv` and `input.txt` (the
+ *          query file) are written to @p output_dir, which must already exist.
+ *
+ * @param output_dir Directory where to create the dataset's files.
+ * @param options    Parameters of the dataset to be generated.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation or IO failure.
+ */
+int dataset_generator_generate(const char *output_dir, const dataset_generator_options_t *options);
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    load_generator.h
+ * @brief   Replay of query workloads against a [server](@ref server_mode.h), to measure it.
+ * @details A workload is a list of requests, read from query files (one query per line) or from
+ *          request logs captured by a server (see `LI3_REQUEST_LOG` in
+ *          [server_mode](@ref server_mode.h)), whose lines are a timestamp in milliseconds, a tab
+ *          and the request.
+ *
+ *          Requests are split among a number of connections, in round-robin, and sent either:
+ *
+ *          - in a closed loop: each connection sends its next request as soon as the response to
+ *            the previous one arrives;
+ *          - in an open loop, at a fixed rate (requests per second over all connections) or at the
+ *            original timing of a captured log. Requests are sent when they're due, whether or
+ *            not previous responses arrived, and latency is measured from when each request was
+ *            due, so that a slow server isn't hidden by requests that were sent late.
+ *
+ *          The report contains the throughput, latency percentiles per query type and the number
+ *          of requests that failed (invalid, rejected, timed out, or lost with a connection).
+ *
+ * @anchor load_generator_example
+ * ### Example
+ *
+ * See load.c, the entry point of the load generator program.
+ */
+
+#ifndef LOAD_GENERATOR_H
+#define LOAD_GENERATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/** @brief List of requests to be sent to a server. */
+typedef struct load_generator_workload load_generator_workload_t;
+
+/**
+ * @struct load_generator_options_t
+ * @brief  How a workload is sent to a server.
+ *
+ * @var load_generator_options_t::socket_path
+ *     @brief Path of the Unix domain socket of the server.
+ * @var load_generator_options_t::connections
+ *     @brief Number of concurrent connections to the server.
+ * @var load_generator_options_t::rate
+ *     @brief Requests per second, over all connections, in an open loop. `0` for a closed loop.
+ * @var load_generator_options_t::replay
+ *     @brief Whether requests are sent at their original timing, in an open loop. Requires all
+ *            requests in the workload to have timestamps. Takes precedence over
+ *            ::load_generator_options_t::rate.
+ * @var load_generator_options_t::duration
+ *     @brief Seconds to keep sending requests for, going through the workload again as many times
+ *            as needed. `0` to send each request once. Ignored when replaying.
+ */
+typedef struct {
+    const char *socket_path;
+    size_t      connections;
+    double      rate;
+    int         replay;
+    double      duration;
+} load_generator_options_t;
+
+/**
+ * @brief  Creates an empty workload.
+ * @return A new workload, or `NULL` on allocation failure.
+ */
+load_generator_workload_t *load_generator_workload_create(void);
+
+/**
+ * @brief   Appends the requests in a file to a workload.
+ * @details Empty lines are skipped. Lines in the format of a captured request log keep their
+ *          timestamps.
+ *
+ * @param workload Workload to be modified.
+ * @param path     Path to a query file or a request log.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO or allocation failure.
+ */
+int load_generator_workload_add_file(load_generator_workload_t *workload, const char *path);
+
+/**
+ * @brief  Gets the number of requests in a workload.
+ * @param  workload Workload to get the number of requests of.
+ * @return The number of requests in @p workload.
+ */
+size_t load_generator_workload_get_length(const load_generator_workload_t *workload);
+
+/**
+ * @brief  Checks if all requests in a workload have timestamps, so that it can be replayed.
+ * @param  workload Workload to be checked.
+ * @return Whether @p workload can be sent with ::load_generator_options_t::replay.
+ */
+int load_generator_workload_is_timed(const load_generator_workload_t *workload);
+
+/**
+ * @brief Frees memory used by a workload.
+ * @param workload Workload to be freed.
+ */
+void load_generator_workload_free(load_generator_workload_t *workload);
+
+/**
+ * @brief Sends a workload to a server, and reports how the server performed.
+ *
+ * @param workload Requests to be sent. Must not be empty.
+ * @param options  How to send the requests.
+ * @param report   Where to write the report to.
+ *
+ * @retval 0 Success (some requests may have failed, as reported).
+ * @retval 1 Failure to connect to the server, or allocation failure.
+ */
+int load_generator_run(const load_generator_workload_t *workload,
+                       const load_generator_options_t  *options,
+                       FILE                            *report);
+
+#endif
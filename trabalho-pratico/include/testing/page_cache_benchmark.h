@@ -0,0 +1,108 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    page_cache_benchmark.h
+ * @brief   Dataset loading with the dataset's files in and out of the page cache.
+ * @details Loading a dataset whose files were just read by another run (or were just written) only
+ *          measures parsing, as the files are still in the kernel's page cache. Before each run
+ *          of a benchmark, the files of the dataset are either evicted from the page cache (cold)
+ *          or read so that they're in it (warm), with
+ *          [dataset_input_set_page_cache](@ref dataset_input_set_page_cache). When runs of both
+ *          kinds are requested, they alternate, starting with a cold one.
+ *
+ *          For every kind of run, the medians of the wall-clock time of dataset loading and of
+ *          the CPU time of all loading steps are reported. The difference between the wall-clock
+ *          times of cold and warm runs is the time spent waiting for storage, and warm runs
+ *          measure the CPU-bound part of loading. Runs restoring the database from a snapshot
+ *          are reported separately from the ones parsing the dataset, as they read different
+ *          files.
+ *
+ * @anchor page_cache_benchmark_example
+ * ### Example
+ *
+ * See test.c, where a benchmark is run when `--page-cache` is provided.
+ */
+
+#ifndef PAGE_CACHE_BENCHMARK_H
+#define PAGE_CACHE_BENCHMARK_H
+
+#include <stdio.h>
+
+#include "testing/performance_metrics.h"
+
+/** @brief State of the page cache before each run of a ::page_cache_benchmark_t. */
+typedef enum {
+    PAGE_CACHE_BENCHMARK_MODE_COLD, /**< Dataset files are evicted before every run. */
+    PAGE_CACHE_BENCHMARK_MODE_WARM, /**< Dataset files are read before every run. */
+    PAGE_CACHE_BENCHMARK_MODE_BOTH  /**< Cold and warm runs alternate. */
+} page_cache_benchmark_mode_t;
+
+/** @brief Dataset loading times of runs with cold and warm page caches. */
+typedef struct page_cache_benchmark page_cache_benchmark_t;
+
+/**
+ * @brief Creates a benchmark of dataset loading with cold and / or warm page caches.
+ *
+ * @param dataset_dir Path to the directory containing the dataset. Must outlive the benchmark.
+ * @param mode        State of the page cache before each run.
+ * @param runs        Maximum number of runs to be added to the benchmark.
+ *
+ * @return A new benchmark, that must be freed with ::page_cache_benchmark_free, or `NULL` on
+ *         allocation failure.
+ */
+page_cache_benchmark_t *page_cache_benchmark_create(const char                 *dataset_dir,
+                                                    page_cache_benchmark_mode_t mode,
+                                                    size_t                      runs);
+
+/**
+ * @brief   Prepares the page cache for the next run of a benchmark.
+ * @details Must be called right before each run, and followed by ::page_cache_benchmark_add_run.
+ *
+ * @param benchmark Benchmark to be run.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure to evict or read the dataset's files (`errno` is set).
+ */
+int page_cache_benchmark_prepare_run(page_cache_benchmark_t *benchmark);
+
+/**
+ * @brief Adds the dataset loading times of a run to a benchmark.
+ *
+ * @param benchmark Benchmark to add the run to. No more runs than the ones it was created for can
+ *                  be added.
+ * @param metrics   Performance metrics of the run, prepared with
+ *                  ::page_cache_benchmark_prepare_run.
+ */
+void page_cache_benchmark_add_run(page_cache_benchmark_t      *benchmark,
+                                  const performance_metrics_t *metrics);
+
+/**
+ * @brief Prints the median loading times of each kind of run in a benchmark.
+ *
+ * @param output    Stream to print the benchmark to.
+ * @param benchmark Benchmark to be printed.
+ */
+void page_cache_benchmark_print(FILE *output, const page_cache_benchmark_t *benchmark);
+
+/**
+ * @brief Frees memory used by a benchmark.
+ * @param benchmark Benchmark to be freed. Can be `NULL`.
+ */
+void page_cache_benchmark_free(page_cache_benchmark_t *benchmark);
+
+#endif
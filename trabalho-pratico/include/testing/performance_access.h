@@ -0,0 +1,125 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    performance_access.h
+ * @brief   Counters of the records each thread reads from the database's managers.
+ * @details Timings don't tell whether a query read a few records through an index or scanned a
+ *          whole manager. Managers count, for the calling thread, the records covered by their
+ *          scans (::performance_access_count_scan) and their lookups by identifier or by key
+ *          (::performance_access_count_probe), so that a measurement
+ *          (::performance_access_start and ::performance_access_stop) can report what a query
+ *          touched.
+ *
+ *          Counters are per thread, like [allocation counters](@ref performance_allocations.h).
+ *          Parallel scans are counted as a whole by the thread that starts them, but lookups made
+ *          by other threads in the ranges of a parallel scan aren't counted. Scans are counted
+ *          when they start, or for every span of columns, so scans stopped early by their
+ *          callbacks are counted as if they had reached the end (or the end of their last span).
+ *
+ * @anchor performance_access_example
+ * ### Example
+ *
+ * ```c
+ * performance_access_t mark;
+ * performance_access_start(&mark);
+ *
+ * const user_t *user = user_manager_get_by_id(database_get_users(database), "JéssiTavares910");
+ *
+ * performance_access_t access;
+ * performance_access_stop(&mark, &access);
+ * printf("%zu user lookups\n", access.probes[PERFORMANCE_ACCESS_MANAGER_USERS]); // 1
+ * ```
+ */
+
+#ifndef PERFORMANCE_ACCESS_H
+#define PERFORMANCE_ACCESS_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/** @brief Part of the database whose accesses are counted. */
+typedef enum {
+    PERFORMANCE_ACCESS_MANAGER_USERS,        /**< @brief ::user_manager_t */
+    PERFORMANCE_ACCESS_MANAGER_FLIGHTS,      /**< @brief ::flight_manager_t */
+    PERFORMANCE_ACCESS_MANAGER_RESERVATIONS, /**< @brief ::reservation_manager_t */
+    PERFORMANCE_ACCESS_MANAGER_INDEXES,      /**< @brief ::index_manager_t */
+    PERFORMANCE_ACCESS_MANAGER_COUNT         /**< @brief Number of managers. */
+} performance_access_manager_t;
+
+/** @brief Names of each ::performance_access_manager_t, as shown in reports. */
+extern const char *const performance_access_manager_names[PERFORMANCE_ACCESS_MANAGER_COUNT];
+
+/**
+ * @struct performance_access_t
+ * @brief  Records read from each manager during a measurement.
+ *
+ * @var performance_access_t::scanned
+ *     @brief Number of records covered by scans of each ::performance_access_manager_t.
+ * @var performance_access_t::probes
+ *     @brief Number of lookups in each ::performance_access_manager_t.
+ */
+typedef struct {
+    size_t scanned[PERFORMANCE_ACCESS_MANAGER_COUNT];
+    size_t probes[PERFORMANCE_ACCESS_MANAGER_COUNT];
+} performance_access_t;
+
+/**
+ * @brief Counts records covered by a scan of a manager, by the calling thread.
+ *
+ * @param manager Manager being scanned.
+ * @param records Number of records covered by the scan.
+ */
+void performance_access_count_scan(performance_access_manager_t manager, size_t records);
+
+/**
+ * @brief Counts a lookup in a manager, by the calling thread.
+ * @param manager Manager where something was looked up.
+ */
+void performance_access_count_probe(performance_access_manager_t manager);
+
+/**
+ * @brief Starts measuring the records read by the calling thread.
+ * @param mark Where to store the state of the thread's counters.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_access_example).
+ */
+void performance_access_start(performance_access_t *mark);
+
+/**
+ * @brief Finishes measuring the records read by the calling thread.
+ *
+ * @param mark Value set by ::performance_access_start, in the same thread.
+ * @param out  Where to write the records read since @p mark to.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_access_example).
+ */
+void performance_access_stop(const performance_access_t *mark, performance_access_t *out);
+
+/**
+ * @brief   Writes the non-zero counts of a measurement, such as `users:1,indexes:2`.
+ * @details `0` is written when every count is zero. IO errors are ignored.
+ *
+ * @param output Where to write to.
+ * @param counts ::performance_access_t::scanned or ::performance_access_t::probes.
+ */
+void performance_access_print_counts(FILE        *output,
+                                     const size_t counts[PERFORMANCE_ACCESS_MANAGER_COUNT]);
+
+#endif
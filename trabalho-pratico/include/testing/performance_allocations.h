@@ -0,0 +1,156 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    performance_allocations.h
+ * @brief   Counters of the memory allocated and freed by each thread.
+ * @details Differences in resident memory are dominated by page granularity and by memory the
+ *          allocator keeps cached, so they're almost always zero or noise for a single query.
+ *          Instead, each thread counts the bytes it allocates and frees, and a measurement
+ *          (::performance_allocations_start and ::performance_allocations_stop) reports how many
+ *          bytes were allocated and freed, and the peak number of live bytes, while it ran.
+ *
+ *          `malloc`, `free` and related functions only report to these counters in
+ *          `programa-testes`, which replaces them with wrappers around the C library's
+ *          allocator (see `performance_allocations_hooks.c`). Those wrappers require glibc, and
+ *          aren't compiled in sanitizer builds, that replace the allocator themselves (see
+ *          ::performance_allocations_is_tracking). Items allocated in [pools](@ref pool.h) (and
+ *          so in [string pools](@ref string_pool.h)) are counted separately, as pools never free
+ *          items individually.
+ *
+ *          Counters are per thread, so a measurement only counts the allocations of the thread
+ *          that started it (e.g.: the threads loading a file in parallel aren't counted), and
+ *          memory freed by a thread other than the one that allocated it counts as freed by the
+ *          former. Measurements in the same thread can't be nested, as starting one resets the
+ *          thread's peak.
+ *
+ * @anchor performance_allocations_example
+ * ### Example
+ *
+ * ```c
+ * performance_allocations_mark_t mark;
+ * performance_allocations_start(&mark);
+ *
+ * char *str = malloc(1024);
+ * free(str);
+ *
+ * performance_allocations_t allocations;
+ * performance_allocations_stop(&mark, &allocations);
+ * if (performance_allocations_is_tracking())
+ *     printf("%zu bytes allocated, peak of %zu\n", allocations.allocated, allocations.peak);
+ * ```
+ */
+
+#ifndef PERFORMANCE_ALLOCATIONS_H
+#define PERFORMANCE_ALLOCATIONS_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * @struct performance_allocations_t
+ * @brief  Memory allocated and freed during a measurement.
+ *
+ * @var performance_allocations_t::allocations
+ *     @brief Number of blocks allocated with `malloc` and related functions.
+ * @var performance_allocations_t::allocated
+ *     @brief Number of bytes allocated with `malloc` and related functions.
+ * @var performance_allocations_t::freed
+ *     @brief Number of bytes freed (including the old blocks of `realloc`).
+ * @var performance_allocations_t::peak
+ *     @brief Maximum number of bytes allocated and not yet freed, relative to the start of the
+ *            measurement.
+ * @var performance_allocations_t::pool_allocated
+ *     @brief Number of bytes of items allocated in pools.
+ */
+typedef struct {
+    size_t allocations, allocated, freed, peak, pool_allocated;
+} performance_allocations_t;
+
+/**
+ * @struct performance_allocations_mark_t
+ * @brief  State of the counters of a thread when a measurement started.
+ *
+ * @var performance_allocations_mark_t::counters
+ *     @brief Values of the thread's counters (::performance_allocations_t::peak is unused).
+ * @var performance_allocations_mark_t::live
+ *     @brief Bytes allocated minus bytes freed by the thread.
+ */
+typedef struct {
+    performance_allocations_t counters;
+    int64_t                   live;
+} performance_allocations_mark_t;
+
+/**
+ * @brief  Checks if `malloc` and related functions report to allocation counters.
+ * @return Whether any allocation was counted, which only happens if they were replaced.
+ */
+int performance_allocations_is_tracking(void);
+
+/**
+ * @brief   Counts a block allocated by the calling thread.
+ * @details Must not allocate memory, as it's called from `malloc`.
+ * @param   bytes Usable size of the block.
+ */
+void performance_allocations_count_allocation(size_t bytes);
+
+/**
+ * @brief   Counts a block freed by the calling thread.
+ * @details Must not allocate memory, as it's called from `free`.
+ * @param   bytes Usable size of the block.
+ */
+void performance_allocations_count_free(size_t bytes);
+
+/**
+ * @brief Counts items allocated in a pool by the calling thread.
+ * @param bytes Number of bytes of the items.
+ */
+void performance_allocations_count_pool(size_t bytes);
+
+/**
+ * @brief Starts measuring the memory allocated by the calling thread.
+ * @param mark Where to store the state of the thread's counters.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_allocations_example).
+ */
+void performance_allocations_start(performance_allocations_mark_t *mark);
+
+/**
+ * @brief Finishes measuring the memory allocated by the calling thread.
+ *
+ * @param mark Value set by ::performance_allocations_start, in the same thread.
+ * @param out  Where to write the memory allocated and freed since @p mark to.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_allocations_example).
+ */
+void performance_allocations_stop(const performance_allocations_mark_t *mark,
+                                  performance_allocations_t            *out);
+
+/**
+ * @brief   Adds the memory allocated in a measurement to another.
+ * @details The peak of the result is the largest of both peaks, as measurements are of tasks that
+ *          didn't run at the same time.
+ *
+ * @param allocations Measurement to be modified.
+ * @param other       Measurement to be added to @p allocations.
+ */
+void performance_allocations_add(performance_allocations_t       *allocations,
+                                 const performance_allocations_t *other);
+
+#endif
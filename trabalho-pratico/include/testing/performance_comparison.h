@@ -0,0 +1,168 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    performance_comparison.h
+ * @brief   Comparison of query and dataset loading times with a saved baseline.
+ * @details A baseline is a CSV file created by ::performance_metrics_export_csv (`--csv` in
+ *          programa-testes). The program is then run multiple times with the same inputs, and each
+ *          run is added to the comparison with ::performance_comparison_add_run. The median of
+ *          each phase (dataset loading step, query statistical data generation and query
+ *          execution, per query type, and whole program) is compared with the baseline.
+ *
+ *          Run-to-run noise is estimated as the relative standard deviation of each phase across
+ *          all runs. A phase is only considered to have regressed if it got slower than the
+ *          baseline by more than the threshold, by more than twice its noise, and by at least
+ *          ::PERFORMANCE_COMPARISON_MIN_REGRESSION, so that phases too short to be measured
+ *          reliably don't fail comparisons.
+ *
+ * @anchor performance_comparison_example
+ * ### Example
+ *
+ * See test.c, where a comparison is made when `--compare` is provided. Comparisons can be printed
+ * with [performance_comparison_output](@ref performance_comparison_output.h).
+ */
+
+#ifndef PERFORMANCE_COMPARISON_H
+#define PERFORMANCE_COMPARISON_H
+
+#include "queries/query_type_list.h"
+#include "testing/performance_metrics.h"
+
+/**
+ * @brief   Number of phases compared in a ::performance_comparison_t.
+ * @details Dataset loading steps, query statistical data generation of each query type, query
+ *          execution of each query type, and the whole program, in this order.
+ */
+#define PERFORMANCE_COMPARISON_PHASE_COUNT                                                         \
+    (PERFORMANCE_METRICS_DATASET_STEP_DONE + 2 * QUERY_TYPE_LIST_COUNT + 1)
+
+/** @brief Minimum slowdown (in microseconds) of a phase for it to be considered a regression. */
+#define PERFORMANCE_COMPARISON_MIN_REGRESSION 1000
+
+/** @brief Comparison of a set of program runs with a baseline. */
+typedef struct performance_comparison performance_comparison_t;
+
+/**
+ * @struct performance_comparison_phase_t
+ * @brief  Comparison of a single phase of the program with the baseline.
+ *
+ * @var performance_comparison_phase_t::baseline
+ *     @brief Time (in microseconds) the phase took in the baseline.
+ * @var performance_comparison_phase_t::median
+ *     @brief Median of the times (in microseconds) the phase took in all runs.
+ * @var performance_comparison_phase_t::delta
+ *     @brief Difference between ::performance_comparison_phase_t::median and
+ *            ::performance_comparison_phase_t::baseline, relative to the baseline (in percent).
+ * @var performance_comparison_phase_t::noise
+ *     @brief Relative standard deviation of the phase's times across all runs (in percent).
+ * @var performance_comparison_phase_t::regression
+ *     @brief Whether the phase got significantly slower than in the baseline.
+ */
+typedef struct {
+    uint64_t baseline, median;
+    double   delta, noise;
+    int      regression;
+} performance_comparison_phase_t;
+
+/**
+ * @brief Loads a baseline to compare program runs against.
+ *
+ * @param baseline_path Path to the CSV file created by ::performance_metrics_export_csv.
+ * @param threshold     Maximum slowdown (in percent) of any phase, for a comparison not to be
+ *                      considered a regression.
+ *
+ * @return A new ::performance_comparison_t, that must be deleted with
+ *         ::performance_comparison_free, or `NULL` on allocation, IO or parsing failure.
+ */
+performance_comparison_t *performance_comparison_create(const char *baseline_path,
+                                                        double      threshold);
+
+/**
+ * @brief   Adds the results of a program run to a comparison.
+ * @details Runs must happen one after the other in the same process, as whole program time is
+ *          measured since the process started (see ::performance_metrics_measure_whole_program).
+ *
+ * @param comparison Comparison to be modified.
+ * @param metrics    Performance metrics of the program run.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int performance_comparison_add_run(performance_comparison_t    *comparison,
+                                   const performance_metrics_t *metrics);
+
+/**
+ * @brief  Gets the number of program runs added to a comparison.
+ * @param  comparison Comparison to get the number of runs from.
+ * @return The number of calls to ::performance_comparison_add_run.
+ */
+size_t performance_comparison_get_run_count(const performance_comparison_t *comparison);
+
+/**
+ * @brief  Gets the build type of the program that generated the baseline.
+ * @param  comparison Comparison to get the build type from.
+ * @return The build type in the baseline (e.g.: `RELEASE`).
+ */
+const char *
+    performance_comparison_get_baseline_build_type(const performance_comparison_t *comparison);
+
+/**
+ * @brief  Gets the git revision of the program that generated the baseline.
+ * @param  comparison Comparison to get the revision from.
+ * @return The output of `git describe` when the program that generated the baseline was built.
+ */
+const char *
+    performance_comparison_get_baseline_revision(const performance_comparison_t *comparison);
+
+/**
+ * @brief  Gets the name of a phase, to be presented to the user.
+ * @param  comparison Comparison to get the name of the phase from.
+ * @param  phase      Index of the phase, less than ::PERFORMANCE_COMPARISON_PHASE_COUNT.
+ * @return The name of the phase (e.g.: `"Execution (Query 1)"`).
+ */
+const char *performance_comparison_get_phase_name(const performance_comparison_t *comparison,
+                                                  size_t                          phase);
+
+/**
+ * @brief Compares a phase of the program runs with the baseline.
+ *
+ * @param comparison Comparison to get the phase from.
+ * @param phase      Index of the phase, less than ::PERFORMANCE_COMPARISON_PHASE_COUNT.
+ * @param out        Where to write the comparison of the phase to, only on success.
+ *
+ * @retval 0 Success.
+ * @retval 1 The phase wasn't measured in the baseline or in the program runs.
+ */
+int performance_comparison_get_phase(const performance_comparison_t *comparison,
+                                     size_t                          phase,
+                                     performance_comparison_phase_t *out);
+
+/**
+ * @brief  Checks if any phase of the program got significantly slower than in the baseline.
+ * @param  comparison Comparison to be checked.
+ * @return Whether any phase regressed (see ::performance_comparison_phase_t::regression).
+ */
+int performance_comparison_has_regressions(const performance_comparison_t *comparison);
+
+/**
+ * @brief Frees memory allocated by ::performance_comparison_create.
+ * @param comparison Value returned by ::performance_comparison_create.
+ */
+void performance_comparison_free(performance_comparison_t *comparison);
+
+#endif
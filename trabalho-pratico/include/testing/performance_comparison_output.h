@@ -0,0 +1,44 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  performance_comparison_output.h
+ * @brief Formatter of information in a ::performance_comparison_t for output to the user.
+ *
+ * @anchor performance_comparison_output_example
+ * ### Example
+ *
+ * See test.c to know how to create a ::performance_comparison_t. Then, just call
+ * ::performance_comparison_output_print with an output file (usually `stdout`).
+ */
+
+#ifndef PERFORMANCE_COMPARISON_OUTPUT_H
+#define PERFORMANCE_COMPARISON_OUTPUT_H
+
+#include <stdio.h>
+
+#include "testing/performance_comparison.h"
+
+/**
+ * @brief Prints the comparison of program runs with a baseline to a file stream.
+ *
+ * @param output     Stream where to output formatted data to.
+ * @param comparison Comparison to be printed.
+ */
+void performance_comparison_output_print(FILE *output, const performance_comparison_t *comparison);
+
+#endif
@@ -52,6 +52,20 @@
  * Time: 87 us
  * Memory: 16388 KiB
  * ```
+ *
+ * Hardware performance counters (cycles, instructions, cache misses, ...) are also collected, when
+ * the system allows it (see `perf_event_open(2)` and `/proc/sys/kernel/perf_event_paranoid`). They
+ * can be read with ::performance_event_get_counter, which fails for unavailable counters.
+ *
+ * When `malloc` reports to [allocation counters](@ref performance_allocations.h), the memory
+ * allocated and freed by the measuring thread is also collected, and can be read with
+ * ::performance_event_get_allocations. Unlike the difference in memory usage, it's accurate even
+ * for very short tasks.
+ *
+ * Measuring memory and hardware counters requires reading `/proc/self/status` and a few system
+ * calls per event, which is too expensive around very short tasks. For those,
+ * ::performance_event_start_measuring_light and ::performance_event_stop_measuring_light only read
+ * the thread's CPU time, and keep the starting timestamp in a slot provided by the caller.
  */
 
 #ifndef PERFORMANCE_EVENT_H
@@ -60,11 +74,28 @@
 #include <inttypes.h>
 #include <stddef.h>
 
+#include "testing/performance_allocations.h"
+
 /** @brief Information about elapsed time and difference in used memory while running a task. */
 typedef struct performance_event performance_event_t;
 
+/** @brief Hardware performance counters measured in a ::performance_event_t. */
+typedef enum {
+    PERFORMANCE_EVENT_COUNTER_CYCLES,        /**< CPU cycles. */
+    PERFORMANCE_EVENT_COUNTER_INSTRUCTIONS,  /**< Retired instructions. */
+    PERFORMANCE_EVENT_COUNTER_CACHE_MISSES,  /**< Last level cache misses. */
+    PERFORMANCE_EVENT_COUNTER_BRANCH_MISSES, /**< Mispredicted branches. */
+    PERFORMANCE_EVENT_COUNTER_DTLB_MISSES,   /**< Data TLB read misses. */
+    PERFORMANCE_EVENT_COUNTER_COUNT          /**< Number of counters (not a counter). */
+} performance_event_counter_t;
+
 /**
- * @brief  Starts collecting data to measure the performance of a task.
+ * @brief   Starts collecting data to measure the performance of a task.
+ * @details Only the CPU time (and hardware counters) of the calling thread are measured, so
+ *          ::performance_event_stop_measuring must be called from the same thread. Memory usage is
+ *          measured for the whole process. Failing to open hardware counters isn't considered a
+ *          measurement failure.
+ *
  * @return A new performance event, that must be deleted with ::performance_event_free, or `NULL` in
  *         case of failure (allocation or measurement).
  *
@@ -73,8 +104,38 @@ typedef struct performance_event performance_event_t;
  */
 performance_event_t *performance_event_start_measuring(void);
 
+/** @brief Start of a lightweight measurement (see ::performance_event_start_measuring_light). */
+typedef uint64_t performance_event_timestamp_t;
+
+/**
+ * @brief   Starts a lightweight measurement of the performance of a task.
+ * @details Only the CPU time of the calling thread is read (no memory usage nor hardware counters),
+ *          and nothing is allocated. ::performance_event_stop_measuring_light must be called from
+ *          the same thread.
+ *
+ * @param slot Where to store the starting timestamp of the measurement, only on success.
+ *
+ * @retval 0 Success.
+ * @retval 1 Measurement failure.
+ */
+int performance_event_start_measuring_light(performance_event_timestamp_t *slot);
+
+/**
+ * @brief   Finishes a lightweight measurement of the performance of a task.
+ * @details The clock is read before allocating the event, so that allocation isn't measured. The
+ *          event's used memory is always `0`, and it has no available hardware counters.
+ *
+ * @param start Timestamp stored by ::performance_event_start_measuring_light.
+ *
+ * @return A new (finished) performance event, that must be deleted with ::performance_event_free,
+ *         or `NULL` in case of failure (allocation or measurement).
+ */
+performance_event_t *performance_event_stop_measuring_light(performance_event_timestamp_t start);
+
 /**
- * @brief  Creates a deep clone of a performance event.
+ * @brief   Creates a deep clone of a performance event.
+ * @details Hardware counters still being measured in @p perf aren't measured in the clone.
+ *
  * @param  perf Performance event to be cloned.
  * @return A pointer to a new ::performance_event_t, that must be deleted using
  *         ::performance_event_free. `NULL` is possible on allocation failure.
@@ -119,6 +180,44 @@ uint64_t performance_event_get_elapsed_time(const performance_event_t *perf);
  */
 size_t performance_event_get_used_memory(const performance_event_t *perf);
 
+/**
+ * @brief Gets the memory allocated and freed by the measuring thread while running a task.
+ *
+ * @param perf   Performance event to get the allocations from. ::performance_event_stop_measuring
+ *               must have been called before this method.
+ * @param output Where to write the allocations to, only on success.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocations weren't measured (`malloc` isn't tracked, or lightweight measurement).
+ */
+int performance_event_get_allocations(const performance_event_t *perf,
+                                      performance_allocations_t *output);
+
+/**
+ * @brief Gets the value of a hardware performance counter measured while running a task.
+ *
+ * @param perf    Performance event to get the counter from. ::performance_event_stop_measuring
+ *                must have been called before this method.
+ * @param counter Counter to get.
+ * @param output  Where to write the value of the counter to, only on success.
+ *
+ * @retval 0 Success.
+ * @retval 1 The counter couldn't be measured (e.g.: not supported by the CPU, or not allowed).
+ */
+int performance_event_get_counter(const performance_event_t  *perf,
+                                  performance_event_counter_t counter,
+                                  uint64_t                   *output);
+
+/**
+ * @brief   Adds the measurements of a performance event to another.
+ * @details Hardware counters are only kept if available in both events. Both events must have
+ *          finished being measured.
+ *
+ * @param perf  Performance event to be modified.
+ * @param other Performance event to be added to @p perf.
+ */
+void performance_event_add(performance_event_t *perf, const performance_event_t *other);
+
 /**
  * @brief Frees memory allocated by a performance event.
  * @param perf Event to have its memory `free`d.
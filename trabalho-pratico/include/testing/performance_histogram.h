@@ -0,0 +1,130 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    performance_histogram.h
+ * @brief   Log-bucketed histogram of performance measurements, for percentile calculation.
+ * @details Like an HDR histogram, values are grouped in buckets whose width grows with the
+ *          magnitude of the value, so that every value is recorded with the same relative
+ *          precision (::PERFORMANCE_HISTOGRAM_SUB_BUCKET_BITS significant bits, about 3 %), in
+ *          constant memory and time, however large the measurements are.
+ *
+ * @anchor performance_histogram_example
+ * ### Example
+ *
+ * ```c
+ * performance_histogram_t *histogram = performance_histogram_create();
+ * if (!histogram)
+ *     return 1;
+ *
+ * for (uint64_t i = 1; i <= 1000; ++i)
+ *     performance_histogram_record(histogram, i);
+ *
+ * printf("p50: %" PRIu64 ", p99: %" PRIu64 ", max: %" PRIu64 "\n",
+ *        performance_histogram_get_percentile(histogram, 50),
+ *        performance_histogram_get_percentile(histogram, 99),
+ *        performance_histogram_get_max(histogram));
+ *
+ * performance_histogram_free(histogram);
+ * return 0;
+ * ```
+ *
+ * Percentiles are the upper bounds of their buckets, so the output is:
+ *
+ * ```text
+ * p50: 503, p99: 991, max: 1000
+ * ```
+ */
+
+#ifndef PERFORMANCE_HISTOGRAM_H
+#define PERFORMANCE_HISTOGRAM_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * @brief Number of significant bits kept for each value in a ::performance_histogram_t. Values
+ *        below `2 ^ PERFORMANCE_HISTOGRAM_SUB_BUCKET_BITS` are recorded exactly.
+ */
+#define PERFORMANCE_HISTOGRAM_SUB_BUCKET_BITS 6
+
+/** @brief Log-bucketed histogram of performance measurements. */
+typedef struct performance_histogram performance_histogram_t;
+
+/**
+ * @brief   Creates an empty histogram.
+ * @details The returned value is owned by the caller, and should be freed with
+ *          ::performance_histogram_free.
+ *
+ * @return A new histogram, or `NULL` on allocation failure.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_histogram_example).
+ */
+performance_histogram_t *performance_histogram_create(void);
+
+/**
+ * @brief Adds a measurement to a histogram.
+ *
+ * @param histogram Histogram to be modified.
+ * @param value     Measurement to be added.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_histogram_example).
+ */
+void performance_histogram_record(performance_histogram_t *histogram, uint64_t value);
+
+/**
+ * @brief  Gets the number of measurements in a histogram.
+ * @param  histogram Histogram to get the number of measurements from.
+ * @return The number of times ::performance_histogram_record was called for @p histogram.
+ */
+size_t performance_histogram_get_count(const performance_histogram_t *histogram);
+
+/**
+ * @brief  Gets the largest measurement in a histogram.
+ * @param  histogram Histogram to get the measurement from.
+ * @return The exact largest measurement in @p histogram, or `0` if it's empty.
+ */
+uint64_t performance_histogram_get_max(const performance_histogram_t *histogram);
+
+/**
+ * @brief   Gets a percentile of the measurements in a histogram.
+ * @details The value returned is the upper bound of the bucket containing the percentile, so it's
+ *          never lower than the exact percentile, and never greater than the largest measurement.
+ *
+ * @param histogram  Histogram to get the percentile from.
+ * @param percentile Percentile to be calculated, between `0` and `100`.
+ *
+ * @return The percentile, or `0` if @p histogram is empty.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_histogram_example).
+ */
+uint64_t performance_histogram_get_percentile(const performance_histogram_t *histogram,
+                                              double                         percentile);
+
+/**
+ * @brief Frees memory used by a histogram.
+ * @param histogram Histogram to be freed.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_histogram_example).
+ */
+void performance_histogram_free(performance_histogram_t *histogram);
+
+#endif
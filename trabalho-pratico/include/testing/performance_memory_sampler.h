@@ -0,0 +1,160 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    performance_memory_sampler.h
+ * @brief   Timeline of the memory usage of the process, with the peak of each phase.
+ * @details [performance_event](@ref performance_event.h) only reads memory usage when a task
+ *          starts and stops, so memory allocated and freed within a task is never seen. While a
+ *          ::performance_memory_sampler_t is running, a background thread reads, every few
+ *          milliseconds, the resident set size of the process (from `/proc/self/statm`) and the
+ *          number of bytes allocated with `malloc` and not yet freed (from `mallinfo2`, when the C
+ *          library provides it). Memory in [pools](@ref pool.h) is only part of the resident set
+ *          size, as pools allocate their blocks with `mmap`.
+ *
+ *          Each sample is attributed to every phase (see
+ *          [performance_profiler](@ref performance_profiler.h)) some thread was in when it was
+ *          taken. As memory is shared by all threads, phases that run in parallel (e.g.: loading
+ *          users and flights) get the same peaks. The peak of each phase is computed from every
+ *          sample, but only up to ::PERFORMANCE_MEMORY_SAMPLER_MAX_SAMPLES samples of the timeline
+ *          are kept: when that number is reached, every other sample is dropped, and the rest of
+ *          the timeline is kept at half the resolution.
+ *
+ * @anchor performance_memory_sampler_example
+ * ### Example
+ *
+ * ```c
+ * performance_memory_sampler_t *sampler =
+ *     performance_memory_sampler_start(PERFORMANCE_MEMORY_SAMPLER_INTERVAL);
+ * if (!sampler)
+ *     return 1;
+ *
+ * batch_mode_run(dataset_path, queries_path, metrics);
+ *
+ * performance_memory_sampler_stop(sampler);
+ * performance_memory_sampler_print(stdout, sampler);
+ * performance_memory_sampler_write(sampler, "memory.csv");
+ * performance_memory_sampler_free(sampler);
+ * ```
+ */
+
+#ifndef PERFORMANCE_MEMORY_SAMPLER_H
+#define PERFORMANCE_MEMORY_SAMPLER_H
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "testing/performance_metrics.h"
+
+/** @brief Default number of microseconds between samples. */
+#define PERFORMANCE_MEMORY_SAMPLER_INTERVAL 1000
+
+/** @brief Maximum number of samples kept in the timeline of a ::performance_memory_sampler_t. */
+#define PERFORMANCE_MEMORY_SAMPLER_MAX_SAMPLES 16384
+
+/** @brief Timeline of the memory usage of the process, with the peak of each phase. */
+typedef struct performance_memory_sampler performance_memory_sampler_t;
+
+/**
+ * @brief   Starts sampling the memory usage of the process in a background thread.
+ * @details Only one sampler can run at a time. The returned value is owned by the caller, and
+ *          should be freed with ::performance_memory_sampler_free.
+ *
+ * @param interval Microseconds between samples. Can't be `0`.
+ *
+ * @return A running sampler, or `NULL` on failure (another sampler is running, allocation failure,
+ *         or failure to read memory usage or to create the thread).
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_memory_sampler_example).
+ */
+performance_memory_sampler_t *performance_memory_sampler_start(uint64_t interval);
+
+/**
+ * @brief Attributes the following samples to a step of loading the dataset, until the calling
+ *        thread calls ::performance_memory_sampler_leave.
+ * @param step Step being run. Can't be ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *             ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ */
+void performance_memory_sampler_enter_dataset(performance_metrics_dataset_step_t step);
+
+/**
+ * @brief Attributes the following samples to the generation of statistical data for a query type,
+ *        until the calling thread calls ::performance_memory_sampler_leave.
+ * @param query_type Number of the query type (starting at `1`).
+ */
+void performance_memory_sampler_enter_query_statistics(size_t query_type);
+
+/**
+ * @brief Attributes the following samples to the execution of a query type, until the calling
+ *        thread calls ::performance_memory_sampler_leave.
+ * @param query_type Number of the query type (starting at `1`).
+ */
+void performance_memory_sampler_enter_query_execution(size_t query_type);
+
+/**
+ * @brief   Stops attributing the following samples to the phase the calling thread entered.
+ * @details Does nothing if the thread didn't enter a phase while a sampler was running.
+ */
+void performance_memory_sampler_leave(void);
+
+/**
+ * @brief   Stops taking samples, waiting for the background thread to exit.
+ * @details Can be called more than once.
+ * @param   sampler Sampler to be stopped.
+ */
+void performance_memory_sampler_stop(performance_memory_sampler_t *sampler);
+
+/**
+ * @brief Prints the number of samples and peak memory usage of each phase with samples.
+ *
+ * @param output  Where to print the table to.
+ * @param sampler Stopped sampler whose samples are printed.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_memory_sampler_example).
+ */
+void performance_memory_sampler_print(FILE *output, const performance_memory_sampler_t *sampler);
+
+/**
+ * @brief   Writes the timeline of a sampler to a CSV file.
+ * @details Each row has the time of the sample (microseconds since the sampler started), the
+ *          resident set size and the bytes allocated with `malloc` (both in KiB, the latter empty
+ *          if unavailable), and the phases the sample was attributed to, separated by spaces.
+ *
+ * @param sampler Stopped sampler whose timeline is written.
+ * @param path    Path to the CSV file to be written.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_memory_sampler_example).
+ */
+int performance_memory_sampler_write(const performance_memory_sampler_t *sampler,
+                                     const char                         *path);
+
+/**
+ * @brief Stops and frees a sampler.
+ * @param sampler Sampler to be freed.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_memory_sampler_example).
+ */
+void performance_memory_sampler_free(performance_memory_sampler_t *sampler);
+
+#endif
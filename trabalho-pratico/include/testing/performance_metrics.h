@@ -25,7 +25,7 @@
  * [performance_metrics_output](@ref performance_metrics_output.h) to display the data in a
  * ::performance_metrics_t.
  *
- * Other methods (such as ::performance_metrics_measure_dataset) are tightly related to the
+ * Other methods (such as ::performance_metrics_start_measuring_dataset) are tightly related to the
  * inner workings of the application, so they are only to be used by the specific modules that
  * constitute the different functionalities of the application.
  */
@@ -33,7 +33,14 @@
 #ifndef PERFORMANCE_METRICS_H
 #define PERFORMANCE_METRICS_H
 
+#include "database/database_catalog.h"
+#include "queries/query_result_cache.h"
 #include "testing/performance_event.h"
+#include "testing/performance_histogram.h"
+#include "utils/async_file_writer.h"
+#include "utils/bloom_filter.h"
+#include "utils/memory_report.h"
+#include "utils/stream_utils.h"
 
 /** @brief Step of loading a dataset, whose performance must be measured. */
 typedef enum {
@@ -45,6 +52,79 @@ typedef enum {
     PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED,  /**< @brief Not yet loading the dataset. */
 } performance_metrics_dataset_step_t;
 
+/**
+ * @brief   Sub-phase of loading a dataset file, that every line goes through.
+ * @details Times of sub-phases are measured around the callbacks of the
+ *          [dataset_parser](@ref dataset_parser.h), so they're the same for every file.
+ */
+typedef enum {
+    /** @brief Reading the file and splitting it into lines (time outside other sub-phases). */
+    PERFORMANCE_METRICS_DATASET_PHASE_INPUT,
+    /** @brief Tokenizing lines, and parsing and validating their fields. */
+    PERFORMANCE_METRICS_DATASET_PHASE_FIELDS,
+    /** @brief Adding valid lines to the database (string pooling, hashing and associations). */
+    PERFORMANCE_METRICS_DATASET_PHASE_INSERTION,
+    /** @brief Writing invalid lines to the error files. */
+    PERFORMANCE_METRICS_DATASET_PHASE_ERRORS,
+    PERFORMANCE_METRICS_DATASET_PHASE_COUNT /**< @brief Number of sub-phases (not a sub-phase). */
+} performance_metrics_dataset_phase_t;
+
+/**
+ * @struct performance_metrics_dataset_breakdown_t
+ * @brief  Where the time of loading a dataset file went (see
+ *         ::performance_metrics_set_dataset_breakdown).
+ *
+ * @var performance_metrics_dataset_breakdown_t::bytes
+ *     @brief Number of bytes read from the file.
+ * @var performance_metrics_dataset_breakdown_t::lines
+ *     @brief Number of lines read from the file, including its header.
+ * @var performance_metrics_dataset_breakdown_t::invalid_lines
+ *     @brief Number of lines written to the error file, including the header of the file.
+ * @var performance_metrics_dataset_breakdown_t::phase_times
+ *     @brief   Time (in nanoseconds) spent in each ::performance_metrics_dataset_phase_t.
+ *     @details Summed over all threads, when a file is parsed in chunks.
+ */
+typedef struct {
+    size_t   bytes, lines, invalid_lines;
+    uint64_t phase_times[PERFORMANCE_METRICS_DATASET_PHASE_COUNT];
+} performance_metrics_dataset_breakdown_t;
+
+/** @brief How the execution of each query is measured. */
+typedef enum {
+    /** @brief CPU time, memory and hardware counters (see ::performance_event_start_measuring). */
+    PERFORMANCE_METRICS_QUERY_MODE_FULL,
+    /** @brief CPU time only (see ::performance_event_start_measuring_light). */
+    PERFORMANCE_METRICS_QUERY_MODE_LIGHT,
+    PERFORMANCE_METRICS_QUERY_MODE_COUNT /**< @brief Number of modes (not a mode). */
+} performance_metrics_query_mode_t;
+
+/** @brief How a set of queries of the same type was executed. */
+typedef enum {
+    /** @brief The query type has no cost model, so there was nothing to choose. */
+    PERFORMANCE_METRICS_QUERY_STRATEGY_NONE,
+    /** @brief Each query performed its own lookups, without statistical data. */
+    PERFORMANCE_METRICS_QUERY_STRATEGY_INDEX,
+    /** @brief Statistical data was generated for all queries. */
+    PERFORMANCE_METRICS_QUERY_STRATEGY_SCAN,
+} performance_metrics_query_strategy_t;
+
+/**
+ * @struct performance_metrics_query_execution_t
+ * @brief  Time it took to execute a query (see ::performance_metrics_get_slowest_query_executions).
+ *
+ * @var performance_metrics_query_execution_t::query_type
+ *     @brief Type of the query.
+ * @var performance_metrics_query_execution_t::line_in_file
+ *     @brief Line of the query in the batch mode's input file.
+ * @var performance_metrics_query_execution_t::time
+ *     @brief Time (in microseconds) it took to execute the query.
+ */
+typedef struct {
+    size_t   query_type;
+    size_t   line_in_file;
+    uint64_t time;
+} performance_metrics_query_execution_t;
+
 /** @brief Performance information about different parts of the application. */
 typedef struct performance_metrics performance_metrics_t;
 
@@ -67,18 +147,84 @@ performance_metrics_t *performance_metrics_create(void);
 performance_metrics_t *performance_metrics_clone(const performance_metrics_t *metrics);
 
 /**
- * @brief   Measures a performance event for a step of loading a dataset.
+ * @brief   Starts measuring a performance event for a step of loading a dataset.
+ * @details When the step is done, call ::performance_metrics_stop_measuring_dataset from the same
+ *          thread. Different steps can be measured at the same time in different threads.
+ *          Measuring failures are reported to `stderr`.
+ *
+ * @param metrics Performance metrics to be modified. Can be `NULL`, for no performance profiling.
+ * @param step    Step of the dataset that is starting to be loaded. Musn't be
+ *                ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ */
+void performance_metrics_start_measuring_dataset(performance_metrics_t             *metrics,
+                                                 performance_metrics_dataset_step_t step);
+
+/**
+ * @brief   Finishes measuring a performance event for a step of loading a dataset.
  * @details Measuring failures are reported to `stderr`.
  *
- *  When a new step of the dataset starts being loaded, it is considered that the previous one is
- *  done. When done parsing the dataset, call this method with the value
- *  ::PERFORMANCE_METRICS_DATASET_STEP_DONE for the parameter @p step.
+ * @param metrics Performance metrics to be modified. Can be `NULL`, for no performance profiling.
+ * @param step    Step of the dataset that is done being loaded. Musn't be
+ *                ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ */
+void performance_metrics_stop_measuring_dataset(performance_metrics_t             *metrics,
+                                                performance_metrics_dataset_step_t step);
+
+/**
+ * @brief   Registers how a dataset file was read, so that the different input methods can be
+ *          compared.
+ * @param metrics Performance metrics to be modified. Can be `NULL`, for no performance profiling.
+ * @param step    Step of the dataset whose file was read with @p method. Musn't be
+ *                ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ * @param method  Method used to read the file.
+ */
+void performance_metrics_set_dataset_input_method(performance_metrics_t             *metrics,
+                                                  performance_metrics_dataset_step_t step,
+                                                  stream_tokenize_method_t           method);
+
+/**
+ * @brief   Registers how many lines a dataset file was estimated to have, and how many it had.
+ * @details Lets the estimates used to size the database before loading be compared to reality.
+ *
+ * @param metrics   Performance metrics to be modified. Can be `NULL`, for no performance profiling.
+ * @param step      Step of the dataset whose file was loaded. Musn't be
+ *                  ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                  ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ * @param estimated Estimated number of lines in the file, before loading it.
+ * @param actual    Number of lines loaded from the file.
+ */
+void performance_metrics_set_dataset_line_counts(performance_metrics_t             *metrics,
+                                                 performance_metrics_dataset_step_t step,
+                                                 size_t                             estimated,
+                                                 size_t                             actual);
+
+/**
+ * @brief   Registers where the time of loading a dataset file went.
+ * @details The counters are collected by the [dataset_progress](@ref dataset_progress.h) of the
+ *          load.
+ *
+ * @param metrics   Performance metrics to be modified. Can be `NULL`, for no performance profiling.
+ * @param step      Step of the dataset whose file was loaded. Musn't be
+ *                  ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                  ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ * @param breakdown Counters and sub-phase times of loading the file.
+ */
+void performance_metrics_set_dataset_breakdown(
+    performance_metrics_t                         *metrics,
+    performance_metrics_dataset_step_t             step,
+    const performance_metrics_dataset_breakdown_t *breakdown);
+
+/**
+ * @brief   Registers the wall-clock time it took to load the whole dataset.
+ * @details Unlike the CPU time of each step, it includes time spent waiting for the disk.
  *
  * @param metrics Performance metrics to be modified. Can be `NULL`, for no performance profiling.
- * @param step    Step of the dataset that is starting to be loaded.
+ * @param time    Time (in microseconds) between starting and finishing loading the dataset.
  */
-void performance_metrics_measure_dataset(performance_metrics_t             *metrics,
-                                         performance_metrics_dataset_step_t step);
+void performance_metrics_set_dataset_wall_time(performance_metrics_t *metrics, uint64_t time);
 
 /**
  * @brief   Starts measuring a performance event for the generation of statistical data for a query.
@@ -108,8 +254,9 @@ void performance_metrics_stop_measuring_query_statistics(performance_metrics_t *
 /**
  * @brief   Starts measuring a performance event for the execution of a query.
  * @details When the query is done executing, call
- *          ::performance_metrics_stop_measuring_query_statistics. Measuring failures are reported
- *          to `stderr`.
+ *          ::performance_metrics_stop_measuring_query_execution. Measuring failures are reported
+ *          to `stderr`. Executions that aren't sampled (see
+ *          ::performance_metrics_set_query_sampling) aren't measured. Calls can't be nested.
  *
  * @param metrics      Performance metrics to be modified. Can be `NULL`, for no performance
  *                     profiling.
@@ -133,6 +280,162 @@ void performance_metrics_stop_measuring_query_execution(performance_metrics_t *m
                                                         size_t                 query_type,
                                                         size_t                 line_in_file);
 
+/**
+ * @brief   Chooses how query executions are measured.
+ * @details With an @p interval of `n`, only one in every `n` executions of each query type is
+ *          measured, so totals of sampled executions underestimate the real ones. By default, all
+ *          executions are measured in ::PERFORMANCE_METRICS_QUERY_MODE_FULL.
+ *
+ * @param metrics  Performance metrics to be modified. Can be `NULL`, for no performance profiling.
+ * @param mode     How to measure each sampled query execution.
+ * @param interval Sampling interval (`1` to measure all executions). `0` is treated as `1`.
+ */
+void performance_metrics_set_query_sampling(performance_metrics_t           *metrics,
+                                            performance_metrics_query_mode_t mode,
+                                            size_t                           interval);
+
+/**
+ * @brief   Copies the query sampling settings of @p source into @p metrics.
+ * @details Meant for the per-thread metrics merged with
+ *          ::performance_metrics_merge_query_measurements.
+ *
+ * @param metrics Performance metrics to be modified. Can be `NULL`, for no performance profiling.
+ * @param source  Performance metrics to copy settings from.
+ */
+void performance_metrics_copy_query_sampling(performance_metrics_t       *metrics,
+                                             const performance_metrics_t *source);
+
+/**
+ * @brief   Measures the overhead of measuring a query execution, in every mode.
+ * @details An empty task is measured a few times in each ::performance_metrics_query_mode_t, timing
+ *          each measurement with a monotonic clock. Results are available from
+ *          ::performance_metrics_get_query_overhead.
+ *
+ * @param metrics Performance metrics to be modified. Can be `NULL`, for no performance profiling.
+ */
+void performance_metrics_measure_query_overhead(performance_metrics_t *metrics);
+
+/**
+ * @brief   Moves query performance measurements from @p source into @p metrics.
+ * @details ::performance_metrics_t isn't thread-safe, so each thread that executes queries must
+ *          register its measurements in its own ::performance_metrics_t, later merged with this
+ *          method. Measurements in @p source replace the ones for the same queries in @p metrics.
+ *          The wall-clock time of each query type's statistics and executions (see
+ *          ::performance_metrics_get_query_execution_wall_time) spans the ones of both.
+ *
+ * @param metrics Performance metrics to be modified. Can be `NULL`, for no performance profiling.
+ * @param source  Performance metrics to move query measurements from. Still must be freed with
+ *                ::performance_metrics_free.
+ */
+void performance_metrics_merge_query_measurements(performance_metrics_t *metrics,
+                                                  performance_metrics_t *source);
+
+/**
+ * @brief   Registers how much memory the statistical data of a query type took.
+ * @details See ::query_type_generate_statistics_callback_t, whose data is allocated in an arena.
+ *          When a query type generates statistical data more than once, only the largest arena is
+ *          kept.
+ *
+ * @param metrics    Performance metrics to be modified. Can be `NULL`, for no performance
+ *                   profiling.
+ * @param query_type Type of the queries.
+ * @param usage      Memory usage of the arena of the statistical data, once generated.
+ */
+void performance_metrics_set_query_statistics_memory(performance_metrics_t *metrics,
+                                                     size_t                 query_type,
+                                                     const memory_usage_t  *usage);
+
+/**
+ * @brief   Registers how a set of queries of the same type was chosen to be executed.
+ * @details The actual cost of the choice is the time of generating statistical data (if any) plus
+ *          the time of executing every query of @p query_type, so it can be compared against the
+ *          prediction for the chosen strategy.
+ *
+ * @param metrics    Performance metrics to be modified. Can be `NULL`, for no performance
+ *                   profiling.
+ * @param query_type Type of the queries.
+ * @param strategy   Chosen strategy.
+ * @param index_cost Predicted time (in nanoseconds) for ::PERFORMANCE_METRICS_QUERY_STRATEGY_INDEX.
+ * @param scan_cost  Predicted time (in nanoseconds) for ::PERFORMANCE_METRICS_QUERY_STRATEGY_SCAN.
+ */
+void performance_metrics_set_query_strategy(performance_metrics_t               *metrics,
+                                            size_t                               query_type,
+                                            performance_metrics_query_strategy_t strategy,
+                                            uint64_t                             index_cost,
+                                            uint64_t                             scan_cost);
+
+/**
+ * @brief   Registers how many queries weren't executed for being duplicates of other queries.
+ * @param metrics Performance metrics to be modified. Can be `NULL`, for no performance profiling.
+ * @param count   Number of duplicate queries, whose output was copied from identical queries.
+ */
+void performance_metrics_set_duplicate_query_count(performance_metrics_t *metrics, size_t count);
+
+/**
+ * @brief   Registers how much memory each data structure in the database was using.
+ * @details See ::database_get_memory_report. Replaces any previously registered report.
+ *
+ * @param metrics Performance metrics to be modified. Can be `NULL`, for no performance profiling.
+ * @param report  Memory report, whose ownership is transferred to @p metrics (it's freed if
+ *                @p metrics is `NULL`). Can be `NULL` (e.g.: measuring failure), for no report.
+ */
+void performance_metrics_set_memory_report(performance_metrics_t *metrics,
+                                           memory_report_t       *report);
+
+/**
+ * @brief   Registers how much memory the database was using before and after being frozen.
+ * @details See ::database_freeze, which releases memory reserved while loading, but also builds
+ *          indexes. Replaces any previously registered values.
+ *
+ * @param metrics Performance metrics to be modified. Can be `NULL`, for no performance profiling.
+ * @param before  Total memory usage of the database before ::database_freeze.
+ * @param after   Total memory usage of the database after ::database_freeze.
+ */
+void performance_metrics_set_freeze_memory(performance_metrics_t *metrics,
+                                           const memory_usage_t  *before,
+                                           const memory_usage_t  *after);
+
+/**
+ * @brief   Registers how query output files were written.
+ * @details See ::async_file_writer_get_statistics. Replaces any previously registered statistics.
+ *
+ * @param metrics    Performance metrics to be modified. Can be `NULL`, for no profiling.
+ * @param statistics Statistics of the writer of query output files (copied to @p metrics).
+ */
+void performance_metrics_set_output_statistics(performance_metrics_t                *metrics,
+                                               const async_file_writer_statistics_t *statistics);
+
+/**
+ * @brief   Registers how lookups in the identifier filters of the database were answered.
+ * @details See ::database_get_id_filter_statistics. Replaces any previously registered statistics.
+ *
+ * @param metrics    Performance metrics to be modified. Can be `NULL`, for no profiling.
+ * @param statistics Statistics of the filters (copied to @p metrics).
+ */
+void performance_metrics_set_id_filter_statistics(performance_metrics_t           *metrics,
+                                                  const bloom_filter_statistics_t *statistics);
+
+/**
+ * @brief   Registers statistics about the data in the database.
+ * @details See ::database_get_catalog. Replaces any previously registered catalog.
+ *
+ * @param metrics Performance metrics to be modified. Can be `NULL`, for no profiling.
+ * @param catalog Catalog of the database (copied to @p metrics).
+ */
+void performance_metrics_set_catalog(performance_metrics_t     *metrics,
+                                     const database_catalog_t *catalog);
+
+/**
+ * @brief   Registers how lookups in the query result cache were answered.
+ * @details See ::query_result_cache_get_statistics. Replaces any previously registered statistics.
+ *
+ * @param metrics    Performance metrics to be modified. Can be `NULL`, for no profiling.
+ * @param statistics Statistics of the cache (copied to @p metrics).
+ */
+void performance_metrics_set_result_cache_statistics(
+    performance_metrics_t                 *metrics,
+    const query_result_cache_statistics_t *statistics);
+
 /**
  * @brief   Measures execution time and peak memory usage of the whole program.
  * @details Must be called after the program is done executing and before @p metrics are displayed.
@@ -160,6 +463,161 @@ const performance_event_t *
     performance_metrics_get_dataset_measurement(const performance_metrics_t       *metrics,
                                                 performance_metrics_dataset_step_t step);
 
+/**
+ * @brief   Gets how a dataset file was read, from a ::performance_metrics_t.
+ * @details Only meaningful if ::performance_metrics_set_dataset_input_method was called for
+ *          @p step.
+ *
+ * @param metrics Performance metrics to get dataset loading information from.
+ * @param step    Phase of dataset loading to be considered. Musn't be
+ *                ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ *
+ * @return The method used to read the file loaded in @p step.
+ */
+stream_tokenize_method_t
+    performance_metrics_get_dataset_input_method(const performance_metrics_t       *metrics,
+                                                 performance_metrics_dataset_step_t step);
+
+/**
+ * @brief   Gets how many lines a dataset file was estimated to have, from a
+ *          ::performance_metrics_t.
+ * @details Only meaningful if ::performance_metrics_set_dataset_line_counts was called for @p step.
+ *
+ * @param metrics Performance metrics to get dataset loading information from.
+ * @param step    Phase of dataset loading to be considered. Musn't be
+ *                ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ *
+ * @return The estimated number of lines in the file loaded in @p step.
+ */
+size_t performance_metrics_get_dataset_estimated_lines(const performance_metrics_t       *metrics,
+                                                       performance_metrics_dataset_step_t step);
+
+/**
+ * @brief   Gets how many lines were loaded from a dataset file, from a ::performance_metrics_t.
+ * @details Only meaningful if ::performance_metrics_set_dataset_line_counts was called for @p step.
+ *
+ * @param metrics Performance metrics to get dataset loading information from.
+ * @param step    Phase of dataset loading to be considered. Musn't be
+ *                ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ *
+ * @return The number of lines loaded from the file loaded in @p step.
+ */
+size_t performance_metrics_get_dataset_lines(const performance_metrics_t       *metrics,
+                                             performance_metrics_dataset_step_t step);
+
+/**
+ * @brief Gets where the time of loading a dataset file went, from a ::performance_metrics_t.
+ *
+ * @param metrics   Performance metrics to get dataset loading information from.
+ * @param step      Phase of dataset loading to be considered. Musn't be
+ *                  ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                  ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ * @param breakdown Where to write the counters and sub-phase times to, on success.
+ *
+ * @retval 0 Success.
+ * @retval 1 ::performance_metrics_set_dataset_breakdown wasn't called for @p step (e.g.: the
+ *           dataset was restored from a snapshot).
+ */
+int performance_metrics_get_dataset_breakdown(const performance_metrics_t             *metrics,
+                                              performance_metrics_dataset_step_t       step,
+                                              performance_metrics_dataset_breakdown_t *breakdown);
+
+/**
+ * @brief  Gets the wall-clock time it took to load the whole dataset, from a
+ *         ::performance_metrics_t.
+ * @param  metrics Performance metrics to get dataset loading information from.
+ * @return The time (in microseconds) registered with ::performance_metrics_set_dataset_wall_time,
+ *         or `0` if the dataset hasn't been loaded.
+ */
+uint64_t performance_metrics_get_dataset_wall_time(const performance_metrics_t *metrics);
+
+/**
+ * @brief   Gets the wall-clock time it took to load a dataset file, from a
+ *          ::performance_metrics_t.
+ * @details Unlike the CPU time in ::performance_metrics_get_dataset_measurement, it includes the
+ *          time spent by other threads helping the one loading the file.
+ *
+ * @param metrics Performance metrics to get dataset loading information from.
+ * @param step    Phase of dataset loading to be considered. Musn't be
+ *                ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ *
+ * @return The time (in microseconds) between starting and finishing @p step, or `0` if it hasn't
+ *         been measured.
+ */
+uint64_t performance_metrics_get_dataset_step_wall_time(const performance_metrics_t       *metrics,
+                                                        performance_metrics_dataset_step_t step);
+
+/**
+ * @brief  Gets the wall-clock time it took to generate a query type's statistical data, from a
+ *         ::performance_metrics_t.
+ * @param  metrics    Performance metrics to get query performance information from.
+ * @param  query_type Type of the queries.
+ * @return The time (in microseconds) between starting and finishing generating the statistical
+ *         data, or `0` if it hasn't been measured.
+ */
+uint64_t performance_metrics_get_query_statistics_wall_time(const performance_metrics_t *metrics,
+                                                            size_t query_type);
+
+/**
+ * @brief   Gets the wall-clock time it took to execute all queries of a type, from a
+ *          ::performance_metrics_t.
+ * @details Executions in different threads overlap, so this is the time between the start of the
+ *          first execution and the end of the last one, including any time between them spent on
+ *          other work. Unsampled executions (see ::performance_metrics_set_query_sampling) are
+ *          also included.
+ *
+ * @param metrics    Performance metrics to get query performance information from.
+ * @param query_type Type of the queries.
+ *
+ * @return The time (in microseconds) it took to execute all queries of @p query_type, or `0` if
+ *         none were measured.
+ */
+uint64_t performance_metrics_get_query_execution_wall_time(const performance_metrics_t *metrics,
+                                                           size_t query_type);
+
+/**
+ * @brief   Gets the peak resident memory of the program when a dataset loading step ended, from a
+ *          ::performance_metrics_t.
+ * @details The peak is the maximum since the program started (`ru_maxrss`), so the step that
+ *          raised it is the first one where it grew.
+ *
+ * @param metrics Performance metrics to get dataset loading information from.
+ * @param step    Phase of dataset loading to be considered. Musn't be
+ *                ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *                ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ *
+ * @return The peak resident set size (in KiB), or `0` if @p step wasn't measured.
+ */
+size_t performance_metrics_get_dataset_peak_rss(const performance_metrics_t       *metrics,
+                                                performance_metrics_dataset_step_t step);
+
+/**
+ * @brief   Gets the peak resident memory of the program after query statistical data was
+ *          generated, from a ::performance_metrics_t.
+ * @details See ::performance_metrics_get_dataset_peak_rss.
+ * @param   metrics Performance metrics to get query statistical data generation information from.
+ * @return  The peak resident set size (in KiB), or `0` if no statistical data was generated.
+ */
+size_t performance_metrics_get_query_statistics_peak_rss(const performance_metrics_t *metrics);
+
+/**
+ * @brief Gets the peak memory usage of the statistical data of a query type, from a
+ *        ::performance_metrics_t.
+ *
+ * @param metrics    Performance metrics to get query statistical data information from.
+ * @param query_type Query type whose statistical data memory usage is to be obtained.
+ *
+ * @return The memory usage registered with ::performance_metrics_set_query_statistics_memory, or
+ *         `NULL` if the query type didn't generate statistical data.
+ */
+const memory_usage_t *
+    performance_metrics_get_query_statistics_memory(const performance_metrics_t *metrics,
+                                                    size_t                       query_type);
+
 /**
  * @brief Gets a measurement of query statistical data generation performance from a
  *        ::performance_metrics_t.
@@ -196,6 +654,186 @@ size_t performance_metrics_get_query_execution_measurements(const performance_me
                                                             size_t   **out_line_numbers,
                                                             uint64_t **out_times);
 
+/**
+ * @brief Gets a measurement of a query's execution from a ::performance_metrics_t.
+ *
+ * @param metrics      Performance metrics to get performance information from.
+ * @param query_type   Type of the query.
+ * @param line_in_file Line of the query in the batch mode's input file.
+ *
+ * @return Performance information about the execution of the query, or `NULL` if that hasn't been
+ *         measured.
+ */
+const performance_event_t *
+    performance_metrics_get_query_execution_measurement(const performance_metrics_t *metrics,
+                                                        size_t                       query_type,
+                                                        size_t                       line_in_file);
+
+/**
+ * @brief   Sums the measurements from executions of all queries of type @p query_type in a
+ *          ::performance_metrics_t.
+ * @details Useful for hardware counters, which are too noisy to be looked at for a single query
+ *          execution.
+ *
+ * @param metrics    Performance metrics to get performance information from.
+ * @param query_type Query type whose executions have been profiled.
+ *
+ * @return A new ::performance_event_t, that must be deleted with ::performance_event_free, or
+ *         `NULL` if no query of type @p query_type was measured or on allocation failure.
+ */
+performance_event_t *
+    performance_metrics_get_query_execution_total(const performance_metrics_t *metrics,
+                                                  size_t                       query_type);
+
+/**
+ * @brief   Gets the distributions of the execution times and memory deltas of all queries of type
+ *          @p query_type in a ::performance_metrics_t.
+ * @details On success, new histograms are written to @p out_times and @p out_memory, that must be
+ *          freed with ::performance_histogram_free.
+ *
+ * @param metrics    Performance metrics to get performance information from.
+ * @param query_type Query type whose executions have been profiled.
+ * @param out_times  Where to output the histogram of execution times (in microseconds).
+ * @param out_memory Where to output the histogram of memory usage differences (in KiB).
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int performance_metrics_get_query_execution_histograms(const performance_metrics_t *metrics,
+                                                       size_t                       query_type,
+                                                       performance_histogram_t    **out_times,
+                                                       performance_histogram_t    **out_memory);
+
+/**
+ * @brief   Gets the slowest query executions (of all types) in a ::performance_metrics_t.
+ * @details On success, a `malloc`-allocated array is written to @p out, which subsequently needs to
+ *          be `free`d. Ties are broken by query type and line number, so that the result doesn't
+ *          depend on hash table order.
+ *
+ * @param metrics Performance metrics to get performance information from.
+ * @param n       Maximum number of query executions to get.
+ * @param out     Where to output the slowest query executions, from the slowest to the fastest.
+ *
+ * @return The number of elements in @p out (at most @p n). `0` is also returned on allocation
+ *         failure, in which case nothing is written to @p out.
+ */
+size_t
+    performance_metrics_get_slowest_query_executions(const performance_metrics_t *metrics,
+                                                     size_t                       n,
+                                                     performance_metrics_query_execution_t **out);
+
+/**
+ * @brief  Gets how query executions were measured, from a ::performance_metrics_t.
+ * @param  metrics Performance metrics to get query information from.
+ * @return The mode set with ::performance_metrics_set_query_sampling.
+ */
+performance_metrics_query_mode_t
+    performance_metrics_get_query_mode(const performance_metrics_t *metrics);
+
+/**
+ * @brief  Gets how often query executions were measured, from a ::performance_metrics_t.
+ * @param  metrics Performance metrics to get query information from.
+ * @return The sampling interval (one in every `n` executions of each query type is measured).
+ */
+size_t performance_metrics_get_query_sampling_interval(const performance_metrics_t *metrics);
+
+/**
+ * @brief Gets the overhead of measuring a query execution, from a ::performance_metrics_t.
+ *
+ * @param metrics Performance metrics to get query information from.
+ * @param mode    Measurement mode to get the overhead of.
+ *
+ * @return The wall-clock time (in nanoseconds) of starting and stopping a measurement, or `0` if
+ *         ::performance_metrics_measure_query_overhead wasn't called (or failed).
+ */
+uint64_t performance_metrics_get_query_overhead(const performance_metrics_t     *metrics,
+                                                performance_metrics_query_mode_t mode);
+
+/**
+ * @brief   Gets how a set of queries of the same type was chosen to be executed, from a
+ *          ::performance_metrics_t.
+ * @details See ::performance_metrics_set_query_strategy.
+ *
+ * @param metrics        Performance metrics to get query information from.
+ * @param query_type     Type of the queries.
+ * @param out_index_cost Where to write the predicted time (in nanoseconds) of executing queries
+ *                       without statistical data to. Not written to if no strategy was chosen.
+ * @param out_scan_cost  Where to write the predicted time (in nanoseconds) of executing queries
+ *                       with statistical data to. Not written to if no strategy was chosen.
+ *
+ * @return The chosen strategy, or ::PERFORMANCE_METRICS_QUERY_STRATEGY_NONE if no choice was made.
+ */
+performance_metrics_query_strategy_t
+    performance_metrics_get_query_strategy(const performance_metrics_t *metrics,
+                                           size_t                       query_type,
+                                           uint64_t                    *out_index_cost,
+                                           uint64_t                    *out_scan_cost);
+
+/**
+ * @brief  Gets how many duplicate queries weren't executed, from a ::performance_metrics_t.
+ * @param  metrics Performance metrics to get query information from.
+ * @return The number of duplicate queries, whose output was copied from identical queries.
+ */
+size_t performance_metrics_get_duplicate_query_count(const performance_metrics_t *metrics);
+
+/**
+ * @brief  Gets the memory usage of each data structure in the database from a
+ *         ::performance_metrics_t.
+ * @param  metrics Performance metrics to get memory information from.
+ * @return The report registered with ::performance_metrics_set_memory_report, or `NULL` if there
+ *         isn't one.
+ */
+const memory_report_t *performance_metrics_get_memory_report(const performance_metrics_t *metrics);
+
+/**
+ * @brief Gets how much memory the database was using before and after being frozen.
+ *
+ * @param metrics    Performance metrics to get memory information from.
+ * @param out_before Where to write the memory usage before freezing to.
+ * @param out_after  Where to write the memory usage after freezing to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Nothing registered with ::performance_metrics_set_freeze_memory.
+ */
+int performance_metrics_get_freeze_memory(const performance_metrics_t *metrics,
+                                          memory_usage_t              *out_before,
+                                          memory_usage_t              *out_after);
+
+/**
+ * @brief  Gets how query output files were written from a ::performance_metrics_t.
+ * @param  metrics Performance metrics to get output information from.
+ * @return The statistics registered with ::performance_metrics_set_output_statistics, or `NULL`
+ *         if there aren't any (e.g.: outputs written to a pack).
+ */
+const async_file_writer_statistics_t *
+    performance_metrics_get_output_statistics(const performance_metrics_t *metrics);
+
+/**
+ * @brief  Gets how lookups in identifier filters were answered from a ::performance_metrics_t.
+ * @param  metrics Performance metrics to get filter information from.
+ * @return The statistics registered with ::performance_metrics_set_id_filter_statistics, or `NULL`
+ *         if there aren't any (e.g.: no filters were built).
+ */
+const bloom_filter_statistics_t *
+    performance_metrics_get_id_filter_statistics(const performance_metrics_t *metrics);
+
+/**
+ * @brief  Gets statistics about the data in the database from a ::performance_metrics_t.
+ * @param  metrics Performance metrics to get the catalog from.
+ * @return The catalog registered with ::performance_metrics_set_catalog, or `NULL` if there isn't
+ *         one.
+ */
+const database_catalog_t *performance_metrics_get_catalog(const performance_metrics_t *metrics);
+
+/**
+ * @brief  Gets how lookups in the query result cache were answered from a ::performance_metrics_t.
+ * @param  metrics Performance metrics to get cache information from.
+ * @return The statistics registered with ::performance_metrics_set_result_cache_statistics, or
+ *         `NULL` if there aren't any (e.g.: the cache is disabled).
+ */
+const query_result_cache_statistics_t *
+    performance_metrics_get_result_cache_statistics(const performance_metrics_t *metrics);
+
 /**
  * @brief   Gets the time it took to run the whole program from a ::performance_metrics_t.
  * @details Must be called after ::performance_metrics_measure_whole_program.
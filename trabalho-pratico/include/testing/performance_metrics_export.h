@@ -0,0 +1,108 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    performance_metrics_export.h
+ * @brief   Machine-readable export of the data in a ::performance_metrics_t.
+ * @details Unlike [performance_metrics_output](@ref performance_metrics_output.h), which is meant
+ *          to be read by humans, these methods output JSON and CSV with a stable schema, so that
+ *          results can be collected and compared across builds. The build type and git revision
+ *          the program was compiled from are included in both formats.
+ *
+ *          All times are in microseconds and all memory quantities in KiB. Hardware counters are
+ *          only exported when available (see ::performance_event_get_counter).
+ *
+ * @anchor performance_metrics_export_example
+ * ### Example
+ *
+ * See test.c, where metrics are exported when `--json` or `--csv` are provided.
+ */
+
+#ifndef PERFORMANCE_METRICS_EXPORT_H
+#define PERFORMANCE_METRICS_EXPORT_H
+
+#include <stdio.h>
+
+#include "testing/performance_metrics.h"
+#include "testing/test_diff.h"
+
+/** @brief Version of the schema of exported data. Must be incremented on incompatible changes. */
+#define PERFORMANCE_METRICS_EXPORT_SCHEMA_VERSION 1
+
+/**
+ * @brief  Gets the type of the current build.
+ * @return `RELEASE`, `DEBUG`, `PROFILE`, or `UNKNOWN` if not provided by the build system.
+ */
+const char *performance_metrics_export_get_build_type(void);
+
+/**
+ * @brief  Gets the git revision the current build was compiled from.
+ * @return The output of `git describe`, or `unknown` if not provided by the build system.
+ */
+const char *performance_metrics_export_get_revision(void);
+
+/**
+ * @brief   Exports the data in @p metrics (and @p diff) as a JSON object.
+ * @details The JSON object has the following keys: `schema_version`, `build` (`type` and
+ *          `revision`), `dataset` (array of steps), `query_statistics` (array, one per query type
+ *          that generates statistical data, with the memory usage of its arena),
+ *          `query_executions` (array, one per sampled line), `query_strategies` (array, one per
+ *          query type with a cost model, with the chosen `strategy` and the predicted cost of each
+ *          one), `query_instrumentation` (`mode`, `sampling_interval` and `overhead_ns` of each
+ *          mode), `database_freeze` (memory before and after ::database_freeze, or `null`),
+ *          `output_files` (how query output files were written, or `null`), `catalog` (number of
+ *          entities, airports and hotels in the database's catalog, or `null`), `result_cache`
+ *          (how lookups in the query result cache were answered, or `null`), `program` (totals)
+ *          and `test_diff` (`null` if @p diff is `NULL`).
+ *
+ * @param output  Stream where to output data.
+ * @param metrics Performance metrics to be exported.
+ * @param diff    Differences between generated and expected output. Can be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation or IO failure.
+ */
+int performance_metrics_export_json(FILE                        *output,
+                                    const performance_metrics_t *metrics,
+                                    const test_diff_t           *diff);
+
+/**
+ * @brief   Exports the data in @p metrics (and @p diff) as a CSV table.
+ * @details Each row has the same columns (see ::performance_metrics_export_csv's implementation
+ *          for the header). The `section` column tells what the row refers to: `dataset`,
+ *          `query_statistics`, `query_execution`, `query_strategy`, `query_instrumentation`,
+ *          `result_cache`, `program`, `test_diff_extra`, `test_diff_missing` or
+ *          `test_diff_error`. Cells that don't apply to a section are left empty.
+ *          `query_instrumentation` rows keep the sampling interval and the overhead (in
+ *          nanoseconds) of each measurement mode in the `lines` column. `query_strategy` rows keep
+ *          the predicted cost (in nanoseconds) of executing queries without and with statistical
+ *          data in the `lines` and `estimated_lines` columns. `query_statistics` rows keep the used
+ *          and reserved bytes of the statistics' arena in the same columns. `result_cache` rows
+ *          keep the number of hits, misses, stores and evictions in the `lines` column.
+ *
+ * @param output  Stream where to output data.
+ * @param metrics Performance metrics to be exported.
+ * @param diff    Differences between generated and expected output. Can be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation or IO failure.
+ */
+int performance_metrics_export_csv(FILE                        *output,
+                                   const performance_metrics_t *metrics,
+                                   const test_diff_t           *diff);
+
+#endif
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    performance_probes.h
+ * @brief   Static tracepoints (USDT probes), for tracing a running program with `bpftrace` or
+ *          `perf`.
+ * @details When `<sys/sdt.h>` (from SystemTap) is found while building, the Makefile defines
+ *          `PERFORMANCE_PROBES_SDT`, and each probe becomes a single `nop` instruction, along
+ *          with an ELF note that tracers use to find it. The `nop` is only replaced by a breakpoint
+ *          while a tracer is attached, so probes cost nothing otherwise, and no special build is
+ *          needed to trace a production binary. Without `<sys/sdt.h>`, probes expand to nothing,
+ *          and their arguments aren't evaluated.
+ *
+ *          All probes are in the `li3` provider. See DEVELOPERS.md for the list of probes and their
+ *          arguments.
+ *
+ * @anchor performance_probes_example
+ * ### Example
+ *
+ * ```c
+ * performance_probe1(query_statistics_begin, type_num);
+ * statistics = generate_statistics(database, n, instances, allocator);
+ * performance_probe1(query_statistics_end, type_num);
+ * ```
+ */
+
+#ifndef PERFORMANCE_PROBES_H
+#define PERFORMANCE_PROBES_H
+
+#ifdef PERFORMANCE_PROBES_SDT
+    #include <sys/sdt.h>
+
+    /**
+     * @brief Fires a probe without arguments.
+     * @param name Name of the probe.
+     */
+    #define performance_probe(name) DTRACE_PROBE(li3, name)
+
+    /**
+     * @brief Fires a probe with one integer argument.
+     *
+     * @param name Name of the probe.
+     * @param arg1 First argument.
+     */
+    #define performance_probe1(name, arg1) DTRACE_PROBE1(li3, name, arg1)
+
+    /**
+     * @brief Fires a probe with two integer arguments.
+     *
+     * @param name Name of the probe.
+     * @param arg1 First argument.
+     * @param arg2 Second argument.
+     */
+    #define performance_probe2(name, arg1, arg2) DTRACE_PROBE2(li3, name, arg1, arg2)
+#else
+    #define performance_probe(name)              ((void) 0)
+    #define performance_probe1(name, arg1)       ((void) 0)
+    #define performance_probe2(name, arg1, arg2) ((void) 0)
+#endif
+
+#endif
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    performance_profiler.h
+ * @brief   Sampling profiler, that attributes CPU time to the phases of the program.
+ * @details While a ::performance_profiler_t is running, a POSIX timer on the process' CPU time
+ *          interrupts a running thread every ::PERFORMANCE_PROFILER_INTERVAL microseconds with
+ *          `SIGPROF`, and the signal handler stores that thread's backtrace and current phase (a
+ *          step of loading the dataset, or the statistics or execution of a query type). Phases
+ *          are set by [performance_metrics](@ref performance_metrics.h), when a phase starts being
+ *          measured, so they are only known when the program runs with performance metrics.
+ *
+ *          Samples are stored in a fixed buffer, and symbolized only after the profiler stops, so
+ *          profiling has little overhead. ::performance_profiler_write writes the samples of each
+ *          phase as folded stacks (one `caller;callee count` line per distinct backtrace), to be
+ *          turned into flame graphs by tools like `flamegraph.pl` or
+ *          [speedscope](https://www.speedscope.app). Function names are only known for functions
+ *          exported by the executable (see `-rdynamic`) and its libraries.
+ *
+ * @anchor performance_profiler_example
+ * ### Example
+ *
+ * ```c
+ * performance_profiler_t *profiler = performance_profiler_start();
+ * if (!profiler)
+ *     return 1;
+ *
+ * batch_mode_run(dataset_path, queries_path, metrics);
+ *
+ * performance_profiler_stop(profiler);
+ * performance_profiler_print(stdout, profiler);
+ * performance_profiler_write(profiler, "profile"); // profile/q1_execution.folded, ...
+ * performance_profiler_free(profiler);
+ * ```
+ */
+
+#ifndef PERFORMANCE_PROFILER_H
+#define PERFORMANCE_PROFILER_H
+
+#include <stdio.h>
+
+#include "queries/query_type_list.h"
+#include "testing/performance_metrics.h"
+
+/** @brief Microseconds of CPU time (of all threads) between samples. */
+#define PERFORMANCE_PROFILER_INTERVAL 1000
+
+/** @brief Maximum number of samples a ::performance_profiler_t keeps. Later ones are dropped. */
+#define PERFORMANCE_PROFILER_MAX_SAMPLES 65536
+
+/** @brief Maximum number of frames in the backtrace of a sample. Outer frames are dropped. */
+#define PERFORMANCE_PROFILER_MAX_DEPTH 48
+
+/**
+ * @brief Number of phases samples are attributed to: each step of loading the dataset, the
+ *        statistics and execution of each query type, and everything else.
+ */
+#define PERFORMANCE_PROFILER_PHASE_COUNT \
+    (1 + PERFORMANCE_METRICS_DATASET_STEP_DONE + 2 * QUERY_TYPE_LIST_COUNT)
+
+/** @brief Sampling profiler, that attributes CPU time to the phases of the program. */
+typedef struct performance_profiler performance_profiler_t;
+
+/**
+ * @brief   Starts profiling the process.
+ * @details Only one profiler can run at a time. The returned value is owned by the caller, and
+ *          should be freed with ::performance_profiler_free.
+ *
+ * @return A running profiler, or `NULL` on failure (another profiler is running, allocation
+ *         failure, or failure to create the timer).
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_profiler_example).
+ */
+performance_profiler_t *performance_profiler_start(void);
+
+/**
+ * @brief Attributes the following samples of the calling thread to a step of loading the dataset.
+ * @param step Step being run. Can't be ::PERFORMANCE_METRICS_DATASET_STEP_DONE or
+ *             ::PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED.
+ */
+void performance_profiler_enter_dataset(performance_metrics_dataset_step_t step);
+
+/**
+ * @brief Attributes the following samples of the calling thread to the generation of statistical
+ *        data for a query type.
+ * @param query_type Number of the query type (starting at `1`).
+ */
+void performance_profiler_enter_query_statistics(size_t query_type);
+
+/**
+ * @brief Attributes the following samples of the calling thread to the execution of a query type.
+ * @param query_type Number of the query type (starting at `1`).
+ */
+void performance_profiler_enter_query_execution(size_t query_type);
+
+/** @brief Stops attributing the following samples of the calling thread to any specific phase. */
+void performance_profiler_leave(void);
+
+/**
+ * @brief  Gets the name of a phase, also used to name its file of folded stacks.
+ * @param  phase Index of the phase (less than ::PERFORMANCE_PROFILER_PHASE_COUNT). Phase `0` is
+ *               everything else, followed by the steps of loading the dataset, the statistics of
+ *               each query type, and the execution of each query type.
+ * @return The name of @p phase (e.g.: `"dataset_users"`, `"q1_statistics"`).
+ */
+const char *performance_profiler_get_phase_name(size_t phase);
+
+/**
+ * @brief   Stops taking samples.
+ * @details Can be called more than once.
+ * @param   profiler Profiler to be stopped.
+ */
+void performance_profiler_stop(performance_profiler_t *profiler);
+
+/**
+ * @brief  Gets the number of samples taken by a profiler.
+ * @param  profiler Profiler to get the number of samples from.
+ * @return The number of samples taken, including the ones dropped for being over
+ *         ::PERFORMANCE_PROFILER_MAX_SAMPLES.
+ */
+size_t performance_profiler_get_sample_count(const performance_profiler_t *profiler);
+
+/**
+ * @brief Prints, for each phase with samples, how many were taken and its hottest function.
+ *
+ * @param output   Where to print the table to.
+ * @param profiler Stopped profiler whose samples are printed.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_profiler_example).
+ */
+void performance_profiler_print(FILE *output, const performance_profiler_t *profiler);
+
+/**
+ * @brief   Writes the samples of each phase to a file of folded stacks.
+ * @details Files are named after their phases (`dataset_users.folded`, `q1_statistics.folded`,
+ *          `q1_execution.folded`, ..., `other.folded`). Phases without samples get no file.
+ *
+ * @param profiler  Stopped profiler whose samples are written.
+ * @param directory Directory where to write the files to. Created if it doesn't exist.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_profiler_example).
+ */
+int performance_profiler_write(const performance_profiler_t *profiler, const char *directory);
+
+/**
+ * @brief Stops and frees a profiler.
+ * @param profiler Profiler to be freed.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_profiler_example).
+ */
+void performance_profiler_free(performance_profiler_t *profiler);
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    performance_scaling.h
+ * @brief   Speedup of each phase of the program as the number of threads grows.
+ * @details The program is run with the same inputs at 1, 2, 4, ... threads, up to a maximum (which
+ *          is always included, even if it isn't a power of two). For every number of threads, the
+ *          wall-clock time of each phase is registered: each dataset file, the whole dataset,
+ *          statistical data generation and execution of each query type, writing query outputs,
+ *          comparing them with the expected outputs, and the whole run. When a number of threads
+ *          is run more than once, the fastest time of each phase is kept.
+ *
+ *          The speedup of a phase is its time with a single thread divided by its time with `n`
+ *          threads, and its parallel efficiency is that speedup divided by `n`. Phases whose
+ *          efficiency drops first are the ones where scaling stops.
+ *
+ *          Wall-clock times of query phases span from the first to the last measurement of the
+ *          phase, over all threads (see ::performance_metrics_get_query_execution_wall_time), so
+ *          they also include time spent by those threads on other work in between. Writing outputs
+ *          is measured as the time threads spent blocked on files (see
+ *          ::async_file_writer_statistics_t::blocked_time), only available when outputs are
+ *          written asynchronously.
+ *
+ * @anchor performance_scaling_example
+ * ### Example
+ *
+ * See test.c, where a scaling study is made when `--scaling` is provided.
+ */
+
+#ifndef PERFORMANCE_SCALING_H
+#define PERFORMANCE_SCALING_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "queries/query_type_list.h"
+#include "testing/performance_metrics.h"
+
+/**
+ * @brief   Number of phases measured in a ::performance_scaling_t.
+ * @details Dataset loading steps, the whole dataset, query statistical data generation of each
+ *          query type, query execution of each query type, writing outputs, comparing outputs and
+ *          the whole run, in this order.
+ */
+#define PERFORMANCE_SCALING_PHASE_COUNT                                                            \
+    (PERFORMANCE_METRICS_DATASET_STEP_DONE + 2 * QUERY_TYPE_LIST_COUNT + 4)
+
+/** @brief Times of each phase of the program, for a range of numbers of threads. */
+typedef struct performance_scaling performance_scaling_t;
+
+/**
+ * @brief Creates a scaling study, without any runs.
+ *
+ * @param max_threads Largest number of threads to be studied (at least `1`).
+ *
+ * @return A new scaling study, that must be freed with ::performance_scaling_free, or `NULL` on
+ *         allocation failure.
+ */
+performance_scaling_t *performance_scaling_create(size_t max_threads);
+
+/**
+ * @brief  Gets how many numbers of threads are studied in a scaling study.
+ * @param  scaling Scaling study to get the numbers of threads from.
+ * @return The number of different numbers of threads the program is to be run with.
+ */
+size_t performance_scaling_get_step_count(const performance_scaling_t *scaling);
+
+/**
+ * @brief  Gets a number of threads studied in a scaling study.
+ * @param  scaling Scaling study to get the number of threads from.
+ * @param  step    Index of the number of threads, less than ::performance_scaling_get_step_count.
+ * @return The number of threads the program is to be run with in @p step. The first step is always
+ *         a single thread.
+ */
+size_t performance_scaling_get_threads(const performance_scaling_t *scaling, size_t step);
+
+/**
+ * @brief Adds the times of a run of the program to a scaling study.
+ *
+ * @param scaling   Scaling study to add the run to.
+ * @param step      Index of the number of threads the program was run with.
+ * @param metrics   Performance metrics of the run.
+ * @param run_time  Wall-clock time (in microseconds) of the whole run.
+ * @param diff_time Wall-clock time (in microseconds) of comparing the run's outputs with the
+ *                  expected ones.
+ */
+void performance_scaling_add_run(performance_scaling_t       *scaling,
+                                 size_t                       step,
+                                 const performance_metrics_t *metrics,
+                                 uint64_t                     run_time,
+                                 uint64_t                     diff_time);
+
+/**
+ * @brief Prints the time, speedup and parallel efficiency of each phase in a scaling study.
+ *
+ * @param output  Stream to print the scaling study to.
+ * @param scaling Scaling study to be printed. Every step should have at least one run.
+ */
+void performance_scaling_print(FILE *output, const performance_scaling_t *scaling);
+
+/**
+ * @brief   Exports a scaling study as a JSON object.
+ * @details The JSON object has the keys `schema_version`, `build` (`type` and `revision`, see
+ *          [performance_metrics_export](@ref performance_metrics_export.h)) and `scaling`, an array
+ *          with an object for each phase and number of threads (`phase`, `threads`, `time_us`,
+ *          `speedup` and `efficiency`). Phases that didn't happen with a single thread aren't
+ *          exported.
+ *
+ * @param output  Stream where to output data.
+ * @param scaling Scaling study to be exported.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO failure.
+ */
+int performance_scaling_export_json(FILE *output, const performance_scaling_t *scaling);
+
+/**
+ * @brief   Exports a scaling study as a CSV table.
+ * @details Columns are `build_type`, `revision`, `phase`, `threads`, `time_us`, `speedup` and
+ *          `efficiency`, with a row for each phase and number of threads, as in
+ *          ::performance_scaling_export_json.
+ *
+ * @param output  Stream where to output data.
+ * @param scaling Scaling study to be exported.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO failure.
+ */
+int performance_scaling_export_csv(FILE *output, const performance_scaling_t *scaling);
+
+/**
+ * @brief Frees memory used by a scaling study.
+ * @param scaling Scaling study to be freed. Can be `NULL`.
+ */
+void performance_scaling_free(performance_scaling_t *scaling);
+
+#endif
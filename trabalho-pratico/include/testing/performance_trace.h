@@ -0,0 +1,109 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    performance_trace.h
+ * @brief   Timeline of what each thread was doing, in the Chrome trace event format.
+ * @details While tracing is enabled (::performance_trace_start), ::performance_trace_begin and
+ *          ::performance_trace_end record when each thread starts and finishes a step (loading a
+ *          file, scanning a manager, generating statistics for a query type, ...). Each thread
+ *          records to its own ring buffer of ::PERFORMANCE_TRACE_THREAD_CAPACITY events, without
+ *          any locking, so the oldest events of busy threads are overwritten.
+ *
+ *          ::performance_trace_stop writes every recorded event to a JSON file, that can be opened
+ *          in [Perfetto](https://ui.perfetto.dev) or in `chrome://tracing`, to see how much work
+ *          happened in parallel and where threads stalled. While tracing is disabled, recording an
+ *          event is a function call that only reads a global flag.
+ *
+ * @anchor performance_trace_example
+ * ### Example
+ *
+ * ```c
+ * performance_trace_start();
+ *
+ * performance_trace_begin("load");
+ * load_dataset();
+ * performance_trace_end();
+ *
+ * performance_trace_begin("queries");
+ * run_queries();
+ * performance_trace_end();
+ *
+ * if (performance_trace_stop("trace.json"))
+ *     fputs("Failed to write trace!\n", stderr);
+ * ```
+ */
+
+#ifndef PERFORMANCE_TRACE_H
+#define PERFORMANCE_TRACE_H
+
+/** @brief Maximum number of events kept for each thread. */
+#define PERFORMANCE_TRACE_THREAD_CAPACITY 65536
+
+/**
+ * @brief   Starts recording events.
+ * @details Tracing can only be started once, as the buffers of threads are freed by
+ *          ::performance_trace_stop.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_trace_example).
+ */
+void performance_trace_start(void);
+
+/**
+ * @brief  Checks if events are being recorded.
+ * @return Whether ::performance_trace_start was called, and ::performance_trace_stop wasn't.
+ */
+int performance_trace_is_enabled(void);
+
+/**
+ * @brief   Records the beginning of a step in the calling thread.
+ * @details Does nothing if tracing isn't enabled, or if the thread's buffer can't be allocated.
+ *
+ * @param name Name of the step. Must be valid until the trace is written, and mustn't need to be
+ *             escaped in JSON, so a string literal is recommended.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_trace_example).
+ */
+void performance_trace_begin(const char *name);
+
+/**
+ * @brief   Records the end of the last step that began in the calling thread.
+ * @details Does nothing if tracing isn't enabled.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_trace_example).
+ */
+void performance_trace_end(void);
+
+/**
+ * @brief   Stops recording events and writes them to a file.
+ * @details No thread may be recording events while this is called. Events are freed even if they
+ *          can't be written. Ends whose beginning was overwritten are dropped.
+ *
+ * @param path Path to the JSON file to be written. Can be `NULL`, to discard the events.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failed to write the file.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref performance_trace_example).
+ */
+int performance_trace_stop(const char *path);
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    query_benchmark.h
+ * @brief   Repeated, isolated runs of the queries of a single type, on a database loaded once.
+ * @details A normal run of programa-testes executes every query once, mixing all types, so the
+ *          first type runs with cold CPU caches and the others don't. Here, the selected queries
+ *          (all queries of one type in a query file, or a single line of it) are run many times,
+ *          with the [benchmark](@ref benchmark.h) harness, and reported separately:
+ *
+ *          - **Statistics**: generation (and freeing) of the statistical data of the queries, in
+ *            every repetition;
+ *          - **Execution (warm)**: execution of all selected queries, with statistical data
+ *            generated only once and reused by every repetition, like in a statistics cache;
+ *          - **Execution (cold)**: only if requested, execution of all selected queries right
+ *            after their statistical data is generated again, dropping the data of the previous
+ *            repetition;
+ *
+ *          The distribution of the execution times of single queries (percentiles across all timed
+ *          repetitions) is also reported. Query outputs are discarded.
+ *
+ * @anchor query_benchmark_example
+ * ### Example
+ *
+ * See test.c, where queries are benchmarked when `--isolate` or `--isolate-line` is provided.
+ */
+
+#ifndef QUERY_BENCHMARK_H
+#define QUERY_BENCHMARK_H
+
+#include <stdio.h>
+
+/**
+ * @struct query_benchmark_options_t
+ * @brief  Which queries to benchmark, and how.
+ *
+ * @var query_benchmark_options_t::type
+ *     @brief Type of the queries of the query file to run (`1` to `10`), or `0` to select them by
+ *            ::query_benchmark_options_t::line.
+ * @var query_benchmark_options_t::line
+ *     @brief Line of the query file (starting at `1`) with the only query to run, if
+ *            ::query_benchmark_options_t::type is `0`.
+ * @var query_benchmark_options_t::repetitions
+ *     @brief Number of timed repetitions of every benchmark (at least `1`).
+ * @var query_benchmark_options_t::cold
+ *     @brief Whether to also benchmark executions with statistical data generated again before
+ *            every repetition.
+ */
+typedef struct {
+    size_t type, line;
+    size_t repetitions;
+    int    cold;
+} query_benchmark_options_t;
+
+/**
+ * @brief   Loads a dataset and benchmarks queries from a query file on it.
+ * @details See [the header file's documentation](@ref query_benchmark.h).
+ *
+ * @param output          Where to print the results to.
+ * @param dataset_dir     Path to the directory containing the dataset.
+ * @param query_file_path Path to the file containing the queries.
+ * @param options         Which queries to benchmark, and how.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (reported to `stderr`), including when no query is selected by @p options.
+ */
+int query_benchmark_run(FILE                            *output,
+                        const char                      *dataset_dir,
+                        const char                      *query_file_path,
+                        const query_benchmark_options_t *options);
+
+#endif
@@ -17,7 +17,19 @@
 /**
  * @file    test_diff.h
  * @brief   Information about differences between generated and expected program output.
- * @details Compares two directories.
+ * @details Compares two directories (or a pack of query outputs and a directory).
+ *
+ *          Expected directories rarely change, so a manifest with the size, modification time and a
+ *          128-bit hash of every expected file is kept in them (::TEST_DIFF_MANIFEST_FILE_NAME).
+ *          Generated files are then only hashed, and expected files are only read when they don't
+ *          match (to find the line of the first difference), or when their manifest entries are
+ *          outdated. Failing to store the manifest (in a read-only directory, for example) isn't an
+ *          error.
+ *
+ *          Generated files may also be compressed (see
+ *          [query_output_compressor](@ref query_output_compressor.h)). They're compared as if they
+ *          weren't, without their ::QUERY_OUTPUT_COMPRESSOR_SUFFIX, and with the dictionary in
+ *          their directory, if any.
  *
  * @anchor test_diff_example
  * ### Example
@@ -29,13 +41,19 @@
 #ifndef TEST_DIFF_H
 #define TEST_DIFF_H
 
+/** @brief Name of the manifest of hashes kept in expected directories, ignored when comparing. */
+#define TEST_DIFF_MANIFEST_FILE_NAME ".test_diff.manifest"
+
 /** @brief Differences between generated and expected program output. */
 typedef struct test_diff test_diff_t;
 
 /**
  * @brief Generates the difference between two directories.
  *
- * @param results  Directory where the program's output was placed into.
+ * @param results  Directory where the program's output was placed into, or the path to a
+ *                 [pack of query outputs](@ref query_output_pack.h), whose outputs are compared
+ *                 as if they were files in the default (one file per query) output layout, along
+ *                 with the other files in the pack's directory (such as dataset error files).
  * @param expected Directory containing expected program results.
  *
  * @return A valid pointer to a ::test_diff_t, that must be `free`d with ::test_diff_free, or
@@ -84,6 +102,13 @@ size_t test_diff_get_common_file_errors(const test_diff_t  *diff,
                                         const char *const **common_files,
                                         const ssize_t     **errors);
 
+/**
+ * @brief  Checks if there are any differences between generated and expected output.
+ * @param  diff Test results to be checked.
+ * @return Whether any file is extra, missing or different (or failed to be compared).
+ */
+int test_diff_has_differences(const test_diff_t *diff);
+
 /**
  * @brief Frees memory allocated by ::test_diff_create.
  * @param diff Value returned by ::test_diff_create.
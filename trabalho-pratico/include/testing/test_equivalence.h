@@ -0,0 +1,131 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    test_equivalence.h
+ * @brief   Checks that optimized configurations of the program give the same outputs as a serial
+ *          reference.
+ * @details The reference configuration runs batch mode with a single thread, scalar kernels (see
+ *          [cpu_features](@ref cpu_features.h)), generic dataset parsers (see
+ *          ::DATASET_PARSER_GENERIC_ENVIRONMENT_VARIABLE) and an output file per query. Each
+ *          optimized configuration enables some optimizations:
+ *
+ *          - `parallel`: the default number of threads (see
+ *            ::thread_pool_get_default_thread_count);
+ *          - `simd`: the best kernels for the CPU;
+ *          - `specialized`: the dataset parsers specialized for each file;
+ *          - `packed`: all query outputs in a single file (see ::batch_mode_run_packed);
+ *          - `combined`: all of the above.
+ *
+ *          `all` selects every configuration. Each configuration runs in a new execution of the
+ *          program (see ::test_equivalence_run_configuration), as kernels are chosen when the
+ *          program starts, with approximate statistical data and the query result cache disabled.
+ *          Its outputs (including the error files) are placed in
+ *          `<work directory>/<configuration>/Resultados` and compared with the reference's (see
+ *          [test_diff](@ref test_diff.h)), with the differences, if any, in
+ *          `<work directory>/<configuration>/diff.txt`.
+ *
+ * @anchor test_equivalence_example
+ * ### Example
+ *
+ * See test.c, where configurations are verified when `--verify` is provided.
+ */
+
+#ifndef TEST_EQUIVALENCE_H
+#define TEST_EQUIVALENCE_H
+
+#include <stdio.h>
+
+/**
+ * @brief Command-line option of the program that runs a configuration (see
+ *        ::test_equivalence_run_configuration), followed by its name, the dataset and the query
+ *        file.
+ */
+#define TEST_EQUIVALENCE_CONFIGURATION_OPTION "--verify-configuration"
+
+/** @brief Configurations to be verified, and their results after being run. */
+typedef struct test_equivalence test_equivalence_t;
+
+/**
+ * @brief Creates a verification of optimized configurations.
+ *
+ * @param configurations Comma-separated list of names of configurations (see
+ *                       [the header file's documentation](@ref test_equivalence.h)), such as
+ *                       `parallel,simd`.
+ *
+ * @return A verification that must be freed with ::test_equivalence_free, or `NULL` on failure
+ *         (an invalid or repeated name, or an allocation failure).
+ */
+test_equivalence_t *test_equivalence_create(const char *configurations);
+
+/**
+ * @brief   Runs the reference and every optimized configuration, and compares their outputs.
+ * @details Configurations run one after the other, so that their times can be compared. Failures
+ *          are reported to `stderr`, and configurations aren't run if the reference fails.
+ *
+ * @param equivalence     Verification to be run. Can only be run once.
+ * @param dataset_dir     Path to the directory containing the dataset.
+ * @param query_file_path Path to the file containing the queries.
+ * @param work_dir        Directory where each configuration's directory is created. Created if
+ *                        needed.
+ *
+ * @retval 0 Every configuration was run, even if its outputs are different.
+ * @retval 1 Fatal failure, or at least one configuration failed to run.
+ */
+int test_equivalence_run(test_equivalence_t *equivalence,
+                         const char         *dataset_dir,
+                         const char         *query_file_path,
+                         const char         *work_dir);
+
+/**
+ * @brief   Runs batch mode in a configuration, in the current directory.
+ * @details This is the entry point of the processes created by ::test_equivalence_run, which
+ *          already set the environment variables of the configuration before the program started.
+ *
+ * @param configuration   Name of the configuration (or `reference`).
+ * @param dataset_dir     Path to the directory containing the dataset.
+ * @param query_file_path Path to the file containing the queries.
+ *
+ * @retval 0 Success.
+ * @retval 1 Unknown configuration, or failure to run batch mode (reported to `stderr`).
+ */
+int test_equivalence_run_configuration(const char *configuration,
+                                       const char *dataset_dir,
+                                       const char *query_file_path);
+
+/**
+ * @brief  Checks if every optimized configuration generated the same outputs as the reference.
+ * @param  equivalence Verification that was run with ::test_equivalence_run.
+ * @return Whether all configurations passed.
+ */
+int test_equivalence_passed(const test_equivalence_t *equivalence);
+
+/**
+ * @brief Prints the result and time of each configuration, and its speedup over the reference.
+ *
+ * @param output      Stream to print the results to.
+ * @param equivalence Verification that was run with ::test_equivalence_run.
+ */
+void test_equivalence_print(FILE *output, const test_equivalence_t *equivalence);
+
+/**
+ * @brief Frees memory used by a verification of optimized configurations.
+ * @param equivalence Verification to be freed. Can be `NULL`.
+ */
+void test_equivalence_free(test_equivalence_t *equivalence);
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    test_runner.h
+ * @brief   Runs many test scenarios, concurrently, from a manifest.
+ * @details A manifest lists test scenarios, one per line, each with a name, a dataset, a query file
+ *          and an expected output directory, separated by semicolons:
+ *
+ *          ```
+ *          # name;dataset;query file;expected output directory
+ *          small;dataset;dataset/input.txt;expected
+ *          invalid;dataset-invalid;dataset-invalid/input.txt;expected-invalid
+ *          ```
+ *
+ *          Empty lines and lines starting with `#` are ignored. Relative paths are relative to the
+ *          manifest's directory, and names must be unique, only containing letters, digits, `-`,
+ *          `_` and `.` (but not starting with `.`).
+ *
+ *          Scenarios with the same dataset share it: the dataset is loaded only once, and then
+ *          every scenario runs in its own child process, which reads the database through
+ *          copy-on-write pages. Up to a number of scenarios run at the same time, and the default
+ *          number of threads (see ::thread_pool_get_default_thread_count) is split among them.
+ *          Each scenario writes its outputs, performance metrics (see
+ *          [performance_metrics_export](@ref performance_metrics_export.h)) and differences to the
+ *          expected outputs to its own directory, `<work directory>/<name>`, and all of them are
+ *          then reported together.
+ *
+ * @anchor test_runner_example
+ * ### Example
+ *
+ * See test.c, where scenarios are run when `--manifest` is provided.
+ */
+
+#ifndef TEST_RUNNER_H
+#define TEST_RUNNER_H
+
+#include <stdio.h>
+
+#include "testing/performance_metrics.h"
+
+/** @brief Test scenarios from a manifest, and their results after being run. */
+typedef struct test_runner test_runner_t;
+
+/**
+ * @brief   Reads a manifest of test scenarios.
+ * @details Errors in the manifest (such as missing files) are reported to `stderr`.
+ *
+ * @param manifest_path Path to the manifest.
+ *
+ * @return A runner with the scenarios in the manifest, that must be freed with ::test_runner_free,
+ *         or `NULL` on failure.
+ */
+test_runner_t *test_runner_create(const char *manifest_path);
+
+/**
+ * @brief   Runs all scenarios in a test runner.
+ * @details See [the header file's documentation](@ref test_runner.h). Failures of single
+ *          scenarios are reported to `stderr` and don't stop the others.
+ *
+ * @param runner     Runner whose scenarios are to be run. Can only be run once.
+ * @param work_dir   Directory where each scenario's directory is created. Created if needed.
+ * @param jobs       Maximum number of scenarios running at the same time (at least `1`).
+ * @param query_mode How to measure query executions.
+ * @param sampling   Sampling interval of query executions (see
+ *                   ::performance_metrics_set_query_sampling).
+ *
+ * @retval 0 Every scenario was run, even if its outputs are wrong.
+ * @retval 1 Fatal failure, or at least one scenario failed to run.
+ */
+int test_runner_run(test_runner_t                   *runner,
+                    const char                      *work_dir,
+                    size_t                           jobs,
+                    performance_metrics_query_mode_t query_mode,
+                    size_t                           sampling);
+
+/**
+ * @brief  Checks if every scenario in a test runner was run and generated the expected outputs.
+ * @param  runner Runner whose scenarios were run with ::test_runner_run.
+ * @return Whether all scenarios passed.
+ */
+int test_runner_passed(const test_runner_t *runner);
+
+/**
+ * @brief Prints the result and times of each scenario in a test runner.
+ *
+ * @param output Stream to print the results to.
+ * @param runner Runner whose scenarios were run with ::test_runner_run.
+ */
+void test_runner_print(FILE *output, const test_runner_t *runner);
+
+/**
+ * @brief   Exports the results of all scenarios as a JSON object.
+ * @details The JSON object has the keys `schema_version`, `build` (`type` and `revision`) and
+ *          `scenarios`, an array with an object for each scenario (`name`, `result`,
+ *          `load_time_us`, `run_time_us` and `metrics`, the scenario's exported metrics and
+ *          differences, as in ::performance_metrics_export_json, or `null` if it failed).
+ *
+ * @param output Stream where to output data.
+ * @param runner Runner whose scenarios were run with ::test_runner_run.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO failure.
+ */
+int test_runner_export_json(FILE *output, const test_runner_t *runner);
+
+/**
+ * @brief   Exports the results of all scenarios as a CSV table.
+ * @details The columns of ::performance_metrics_export_csv, preceded by `scenario` and `result`,
+ *          with the rows of every scenario that didn't fail.
+ *
+ * @param output Stream where to output data.
+ * @param runner Runner whose scenarios were run with ::test_runner_run.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO failure.
+ */
+int test_runner_export_csv(FILE *output, const test_runner_t *runner);
+
+/**
+ * @brief Frees memory used by a test runner.
+ * @param runner Runner to be freed. Can be `NULL`.
+ */
+void test_runner_free(test_runner_t *runner);
+
+#endif
@@ -52,6 +52,7 @@
 #ifndef AIRPORT_CODE_H
 #define AIRPORT_CODE_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 /** @brief An airport code of a ::flight_t. */
@@ -94,4 +95,28 @@ int airport_code_from_string(airport_code_t *output, const char *input);
  */
 void airport_code_sprintf(char *output, airport_code_t airport);
 
+/**
+ * @brief   Number of distinct airport codes, and of dense indices they can be mapped to.
+ * @details See ::airport_code_to_index.
+ */
+#define AIRPORT_CODE_INDEX_COUNT (26 * 26 * 26)
+
+/**
+ * @brief   Maps an airport code to a dense index.
+ * @details Indices range from `0` to ::AIRPORT_CODE_INDEX_COUNT (exclusive), so that per-airport
+ *          data can be stored in plain arrays instead of hash tables. The order of indices is the
+ *          alphabetical order of airport codes.
+ *
+ * @param airport Valid airport code.
+ * @return The index of @p airport.
+ */
+size_t airport_code_to_index(airport_code_t airport);
+
+/**
+ * @brief Maps a dense index back to an airport code (see ::airport_code_to_index).
+ * @param index Index lower than ::AIRPORT_CODE_INDEX_COUNT.
+ * @return The airport code whose index is @p index.
+ */
+airport_code_t airport_code_from_index(size_t index);
+
 #endif
@@ -49,6 +49,7 @@
 #ifndef COUNTRY_CODE_H
 #define COUNTRY_CODE_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 /** @brief A country code of a ::user_t. */
@@ -91,4 +92,28 @@ int country_code_from_string(country_code_t *output, const char *input);
  */
 void country_code_sprintf(char *output, country_code_t country);
 
+/**
+ * @brief   Number of distinct country codes, and of dense indices they can be mapped to.
+ * @details See ::country_code_to_index.
+ */
+#define COUNTRY_CODE_INDEX_COUNT (26 * 26)
+
+/**
+ * @brief   Maps a country code to a dense index.
+ * @details Indices range from `0` to ::COUNTRY_CODE_INDEX_COUNT (exclusive), so that per-country
+ *          data can be stored in plain arrays instead of hash tables. The order of indices is the
+ *          alphabetical order of country codes.
+ *
+ * @param country Valid country code.
+ * @return The index of @p country.
+ */
+size_t country_code_to_index(country_code_t country);
+
+/**
+ * @brief Maps a dense index back to a country code (see ::country_code_to_index).
+ * @param index Index lower than ::COUNTRY_CODE_INDEX_COUNT.
+ * @return The country code whose index is @p index.
+ */
+country_code_t country_code_from_index(size_t index);
+
 #endif
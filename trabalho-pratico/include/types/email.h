@@ -57,8 +57,8 @@
 /**
  * @brief Verifies if a **MODIFIABLE** string is a valid email.
  *
- * @param input String to validate, that will be modified during parsing, but then restored to its
- *              original form. Must be in the format `"user@domain.tld"`.
+ * @param input String to validate. Won't be modified, and is only taken as modifiable for
+ *              compatibility. Must be in the format `"user@domain.tld"`.
  *
  * @retval 0 Valid email.
  * @retval 1 Validation failure.
@@ -71,14 +71,12 @@
 int email_validate_string(char *input);
 
 /**
- * @brief  Verifies if a string is a valid email.
- * @details The current implementation copies the provided string to a temporary buffer. Keep that
- *          in mind for performance reasons.
+ * @brief Verifies if a string is a valid email.
  *
  * @param input String to validate. Must be in the format `"user@domain.tld"`.
  *
  * @retval 0 Valid email.
- * @retval 1 Validation or allocation failure.
+ * @retval 1 Validation failure.
  *
  * #### Examples
  * See [the header file's documentation](@ref email_examples).
@@ -50,7 +50,10 @@ typedef struct flight flight_t;
  *
  * @param allocator Pool where to allocate the flight. The pool's `item_size` (see
  *                  ::pool_create_from_size) must be the value returned by ::flight_sizeof. Can be
- *                  `NULL`, so that malloc is used instead of a pool.
+ *                  `NULL`, so that malloc is used instead of a pool. In that case, the flight owns
+ *                  all its strings, that must be set with a `NULL` string allocator, and it must
+ *                  be freed with ::flight_free. Otherwise, strings must be set with a string pool,
+ *                  and the flight is freed with @p allocator.
  *
  * @return The allocated flight (`NULL` on allocation failure).
  */
@@ -62,8 +65,9 @@ flight_t *flight_create(pool_t *allocator);
  * @param allocator        Pool where to allocate the flight. The pool's `item_size` (see
  *                         ::pool_create_from_size) must be the value returned by ::flight_sizeof.
  *                         Can be `NULL`, so that malloc is used instead of a pool.
- * @param string_allocator Pool where to allocate the strings of a flight. Can be `NULL`, so that
- *                         `strdup` is used instead of a pool.
+ * @param string_allocator Pool where to allocate the strings of a flight. Can be `NULL` (if and
+ *                         only if @p allocator is `NULL`), so that `strdup` is used instead of a
+ *                         pool.
  * @param flight           Flight to be cloned.
  *
  * @return A deep-clone of @p flight (`NULL` on allocation failure).
@@ -307,7 +311,9 @@ int flight_is_valid(const flight_t *flight);
 void flight_invalidate(flight_t *flight);
 
 /**
- * @brief Frees the memory used for a given flight.
+ * @brief   Frees the memory used for a given flight.
+ * @details Only flights allocated with `malloc` (not in pools) can be freed, along with all their
+ *          strings.
  * @param flight Flight to be deleted.
  */
 void flight_free(flight_t *flight);
@@ -32,14 +32,24 @@
 #ifndef RESERVATION_H
 #define RESERVATION_H
 
+#include <inttypes.h>
+#include <stdint.h>
+
 #include "types/hotel_id.h"
 #include "types/includes_breakfast.h"
 #include "types/reservation_id.h"
 #include "utils/date.h"
 #include "utils/pool.h"
-#include "utils/string_pool.h"
 #include "utils/string_pool_no_duplicates.h"
 
+/**
+ * @brief   Format (for `printf`) of a price in cents (see ::reservation_calculate_price_cents),
+ *          with three decimal places.
+ * @details Takes the whole units (`cents / 100`) and the remaining cents (`cents % 100`), both
+ *          `uint64_t`.
+ */
+#define RESERVATION_PRICE_FORMAT "%" PRIu64 ".%02" PRIu64 "0"
+
 /** @brief Value of a reservation's rating when it's not specified. */
 #define RESERVATION_NO_RATING 0
 
@@ -51,7 +61,11 @@ typedef struct reservation reservation_t;
  *
  * @param allocator Pool where to allocate the reservation. The pool's `item_size` (see
  *                  ::pool_create_from_size) must be the value returned by ::reservation_sizeof. Can
- *                  be `NULL`, so that malloc is used instead of a pool.
+ *                  be `NULL`, so that malloc is used instead of a pool. In that case, the
+ *                  reservation owns its hotel name, that must be set with a `NULL` string
+ *                  allocator, and it must be freed with ::reservation_free. Otherwise, the hotel
+ *                  name must be set with a string pool, and the reservation is freed with
+ *                  @p allocator.
  *
  * @return The allocated reservation (`NULL` on allocation failure).
  */
@@ -64,33 +78,25 @@ reservation_t *reservation_create(pool_t *allocator);
  * @param allocator            Pool where to allocate the reservation. Its element size must be the
  *                             value returned by ::reservation_sizeof. Can be `NULL`, so that malloc
  *                             is used instead of a pool.
- * @param user_id_allocator    Pool where to allocate the user identifier in a reservation. Can be
- *                             `NULL`, so that `strdup` is used instead of a pool.
  * @param hotel_name_allocator Pool where to allocate the hotel name in a reservation. Can be
- *                             `NULL`, so that `strdup` is used instead of a pool.
+ *                             `NULL` (if and only if @p allocator is `NULL`), so that `strdup` is
+ *                             used instead of a pool.
  * @param reservation          Reservation to be cloned.
  *
  * @return A deep-clone of @p reservation (`NULL` on allocation failure).
  */
 reservation_t *reservation_clone(pool_t                      *allocator,
-                                 string_pool_t               *user_id_allocator,
                                  string_pool_no_duplicates_t *hotel_name_allocator,
                                  const reservation_t         *reservation);
 
 /**
- * @brief Sets a the identifier of the user that booked a reservation.
+ * @brief Sets the user that booked a reservation.
  *
- * @param allocator   Where to copy @p user_id to. Can be `NULL`, so that `strdup` is used instead
- *                    of a pool.
- * @param reservation Reservation to have its user identifier set.
- * @param user_id     Identifier of the user that booked a reservation. Musn't be empty.
- *
- * @retval 0 Success.
- * @retval 1 Failure due to empty @p user_id or allocation failure. @p reservation wasn't modified.
+ * @param reservation Reservation to have its user set.
+ * @param user_index  Index of the user that booked the reservation, in the database's
+ *                    ::user_manager_t (see ::user_manager_get_index_by_id).
  */
-int reservation_set_user_id(string_pool_t *allocator,
-                            reservation_t *reservation,
-                            const char    *user_id);
+void reservation_set_user_index(reservation_t *reservation, uint32_t user_index);
 
 /**
  * @brief Sets the name of the hotel in a reservation.
@@ -209,11 +215,11 @@ void reservation_set_city_tax(reservation_t *reservation, uint8_t city_tax);
 int reservation_set_price_per_night(reservation_t *reservation, uint16_t price_per_night);
 
 /**
- * @brief  Gets a reservation's user identifier.
- * @param  reservation Reservation to get the user identifier from.
- * @return The reservation's user identifier.
+ * @brief  Gets the index of the user that booked a reservation.
+ * @param  reservation Reservation to get the user index from.
+ * @return The index of the reservation's user, in the database's ::user_manager_t.
  */
-const char *reservation_get_const_user_id(const reservation_t *reservation);
+uint32_t reservation_get_user_index(const reservation_t *reservation);
 
 /**
  * @brief  Gets a reservation's hotel name.
@@ -321,14 +327,20 @@ void reservation_invalidate(reservation_t *reservation);
 double reservation_calculate_hotel_profit(const reservation_t *reservation);
 
 /**
- * @brief  Calculates the price a ::user_t payed for @p reservation.
+ * @brief   Calculates the price a ::user_t payed for @p reservation, in cents.
+ * @details The city tax is a whole percentage, so the price is exact: the price per night, times
+ *          the number of nights, times `100` plus the city tax. Prices of many reservations can
+ *          then be added with no rounding errors.
+ *
  * @param  reservation Reservation to use to calculate user price.
- * @return The price a ::user_t payed for @p reservation.
+ * @return The price a ::user_t payed for @p reservation, in hundredths of a monetary unit.
  */
-double reservation_calculate_price(const reservation_t *reservation);
+uint64_t reservation_calculate_price_cents(const reservation_t *reservation);
 
 /**
- * @brief Frees the memory used for a given reservation.
+ * @brief   Frees the memory used for a given reservation.
+ * @details Only reservations allocated with `malloc` (not in pools) can be freed, along with their
+ *          hotel names.
  * @param reservation Reservation to be deleted.
  */
 void reservation_free(reservation_t *reservation);
@@ -46,12 +46,20 @@ typedef struct user user_t;
  * @brief   Creates a new user with uninitialized fields.
  * @details Before using this user, set all its fields using the setters in this module.
  *
- * @param allocator  Pool where to allocate the user. Its element size must be the value returned by
- *                   ::user_sizeof. Can be `NULL`, so that malloc is used instead of a pool.
+ * @param allocator      Pool where to allocate the user. Its element size must be the value
+ *                       returned by ::user_sizeof. Can be `NULL`, so that malloc is used instead of
+ *                       a pool. In that case, the user owns all its strings, that must be set with
+ *                       a `NULL` string allocator, and it must be freed with ::user_free.
+ *                       Otherwise, strings must be set with a string pool, and the user is freed
+ *                       with @p allocator.
+ * @param cold_allocator Pool where to allocate the fields of the user that are rarely accessed
+ *                       (birth date, country code, sex and passport). Its element size must be the
+ *                       value returned by ::user_cold_sizeof. Must be `NULL` if and only if
+ *                       @p allocator is `NULL`.
  *
  * @return A allocated user (`NULL` on allocation failure).
  */
-user_t *user_create(pool_t *allocator);
+user_t *user_create(pool_t *allocator, pool_t *cold_allocator);
 
 /**
  * @brief Creates a deep clone of a user.
@@ -59,13 +67,19 @@ user_t *user_create(pool_t *allocator);
  * @param allocator        Pool where to allocate the user. Its element size must be the value
  *                         returned by ::user_sizeof. Can be `NULL`, so that malloc is used, instead
  *                         of a pool.
- * @param string_allocator Pool where to allocate the strings of a user. Can be `NULL`, so that
- *                         `strdup` is used, instead of a pool.
+ * @param cold_allocator   Pool where to allocate the rarely accessed fields of the user (see
+ *                         ::user_create). Must be `NULL` if and only if @p allocator is `NULL`.
+ * @param string_allocator Pool where to allocate the strings of a user. Can be `NULL` (if and
+ *                         only if @p allocator is `NULL`), so that `strdup` is used, instead of a
+ *                         pool.
  * @param user             User to be cloned.
  *
  * @return A deep-clone of @p user (`NULL` on allocation failure).
  */
-user_t *user_clone(pool_t *allocator, string_pool_t *string_allocator, const user_t *user);
+user_t *user_clone(pool_t        *allocator,
+                   pool_t        *cold_allocator,
+                   string_pool_t *string_allocator,
+                   const user_t  *user);
 
 /**
  * @brief Sets a user's identifier.
@@ -163,7 +177,7 @@ void user_reset_dates(user_t *user);
 /**
  * @brief  Gets a user's identifier.
  * @param  user User to get the identifier from.
- * @return The user's identifier.
+ * @return The user's identifier. It may be stored inside @p user, so it must not outlive it.
  */
 const char *user_get_const_id(const user_t *user);
 
@@ -174,6 +188,13 @@ const char *user_get_const_id(const user_t *user);
  */
 const char *user_get_const_name(const user_t *user);
 
+/**
+ * @brief  Checks if a user's name is made only of ASCII characters.
+ * @param  user User to check the name of.
+ * @return `1` if the name of @p user is pure ASCII, `0` otherwise.
+ */
+int user_get_name_is_ascii(const user_t *user);
+
 /**
  * @brief  Gets a user's birth date.
  * @param  user User to get the birth date from.
@@ -184,7 +205,7 @@ date_t user_get_birth_date(const user_t *user);
 /**
  * @brief  Gets the user passport.
  * @param  user User to get the passport number from.
- * @return The user's passport number.
+ * @return The user's passport number. It may be stored inside @p user, so it must not outlive it.
  */
 const char *user_get_const_passport(const user_t *user);
 
@@ -223,10 +244,18 @@ date_and_time_t user_get_account_creation_date(const user_t *user);
  */
 size_t user_sizeof(void);
 
+/**
+ * @brief   Gets the size of the rarely accessed fields of a ::user_t in memory.
+ * @details Useful for pool allocation (see ::user_create).
+ * @return  The size of the fields of a user allocated in the cold pool.
+ */
+size_t user_cold_sizeof(void);
+
 /**
  * @brief   Checks if a user in a database is valid.
  * @details Users can be invalidated so that they can be "removed" from pools (not considered
- *          during lookups), even though pools don't support removals.
+ *          during lookups), even though pools don't support removals. Only users allocated in
+ *          pools can be invalidated.
  *
  * @param user User to have its validity checked.
  *
@@ -256,7 +285,8 @@ int32_t user_calculate_age(const user_t *user);
 
 /**
  * @brief      Frees the memory used for a given user.
- * @details    All strings inside the user won't be freed, as they're not owned by the user.
+ * @details    Only users allocated with `malloc` (not in pools) can be freed, along with all their
+ *             strings.
  * @param user User to be deleted.
  */
 void user_free(user_t *user);
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#include "utils/memory_report.h"
+
+/**
+ * @file    arena.h
+ * @brief   An allocator for objects of different sizes, that are all freed at once.
+ * @details Unlike a ::pool_t, where all items have the same size, an arena can store objects of any
+ *          size (e.g.: structures of different types and strings). It's implemented on top of a
+ *          ::pool_t of suitably aligned units, so allocations are a simple pointer bump most of the
+ *          time, and no object can be freed individually.
+ *
+ * @anchor arena_examples
+ * ### Examples
+ *
+ * ```c
+ * #include <stdio.h>
+ * #include "utils/arena.h"
+ *
+ * typedef struct {
+ *     int         number;
+ *     const char *name;
+ * } person_t;
+ *
+ * int main(void) {
+ *     arena_t *arena = arena_create(4096);
+ *     if (!arena)
+ *         return 1;
+ *
+ *     person_t *person = arena_allocate(arena, sizeof(person_t));
+ *     if (!person) {
+ *         arena_free(arena);
+ *         return 1;
+ *     }
+ *
+ *     person->number = 1;
+ *     person->name   = arena_put_string(arena, "Alice"); // Check for NULL in real code
+ *     printf("%d %s\n", person->number, person->name);
+ *
+ *     arena_free(arena); // Frees both person and its name
+ *     return 0;
+ * }
+ * ```
+ */
+
+/** @brief An allocator for objects of different sizes, that are all freed at once. */
+typedef struct arena arena_t;
+
+/**
+ * @brief   Creates a new empty arena.
+ * @details The returned value is owned by the caller, and should be freed with ::arena_free.
+ *
+ * @param block_size Number of bytes in each block of the arena. Larger objects are still
+ *                   supported, but get their own block.
+ *
+ * @return The new arena, or `NULL` on allocation failure.
+ */
+arena_t *arena_create(size_t block_size);
+
+/**
+ * @brief   Allocates space for an object in an arena.
+ * @details The returned memory is aligned for pointers, 64-bit integers and `double`s, and lives
+ *          until @p arena is freed.
+ *
+ * @param arena Arena to allocate the object in.
+ * @param size  Size of the object, in bytes.
+ *
+ * @return A pointer to the uninitialized object, or `NULL` on allocation failure.
+ */
+void *arena_allocate(arena_t *arena, size_t size);
+
+/**
+ * @brief Allocates space for an object in an arena and copies it there.
+ *
+ * @param arena Arena to allocate the object in.
+ * @param data  Object to be copied.
+ * @param size  Size of @p data, in bytes.
+ *
+ * @return A pointer to the copy of @p data, or `NULL` on allocation failure.
+ */
+void *arena_put(arena_t *arena, const void *data, size_t size);
+
+/**
+ * @brief Copies a string to an arena.
+ *
+ * @param arena Arena to allocate the string in.
+ * @param str   String to be copied.
+ *
+ * @return A pointer to the copy of @p str, or `NULL` on allocation failure.
+ */
+char *arena_put_string(arena_t *arena, const char *str);
+
+/**
+ * @brief   Gets the memory accounting counters of an arena.
+ * @details Counters are kept up to date as objects are allocated, so this is cheap to call.
+ *
+ * @param arena Arena to get the counters from.
+ * @param out   Where to write the counters to.
+ */
+void arena_get_memory_usage(const arena_t *arena, memory_usage_t *out);
+
+/**
+ * @brief Frees an arena and all objects allocated in it.
+ * @param arena Arena to be freed.
+ */
+void arena_free(arena_t *arena);
+
+#endif
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    async_file_writer.h
+ * @brief   Writes many whole files with as few blocking system calls as possible.
+ * @details On Linux, file creation, writes and closes are submitted in batches through `io_uring`,
+ *          with a bounded number of files in flight. When `io_uring` isn't available (old kernels,
+ *          sandboxes that block it, ...), files are written with plain `open` / `write` / `close`
+ *          calls, in the calling thread. That is meant to be a thread dedicated to output (such as
+ *          the one that flushes query outputs in query_dispatcher.h), so that the thread that does
+ *          actual work never blocks on the disk.
+ *
+ * @anchor async_file_writer_examples
+ * ### Examples
+ *
+ * ```c
+ * async_file_writer_t *files = async_file_writer_create(ASYNC_FILE_WRITER_METHOD_IO_URING, 64);
+ * for (size_t i = 0; i < n; ++i) {
+ *     char *contents = strdup("Hello, world!\n"); // Error handling omitted
+ *     async_file_writer_write(files, paths[i], contents, 14); // Ownership of contents is passed
+ * }
+ *
+ * if (async_file_writer_finish(files))
+ *     fputs("Failed to write some files!\n", stderr);
+ * async_file_writer_free(files);
+ * ```
+ */
+
+#ifndef ASYNC_FILE_WRITER_H
+#define ASYNC_FILE_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Way files are written by an ::async_file_writer_t. */
+typedef enum {
+    ASYNC_FILE_WRITER_METHOD_SYNC,     /**< @brief Blocking `open`, `write` and `close` calls. */
+    ASYNC_FILE_WRITER_METHOD_IO_URING, /**< @brief Batched submissions through `io_uring`. */
+} async_file_writer_method_t;
+
+/**
+ * @struct async_file_writer_statistics_t
+ * @brief  Information about the files written by an ::async_file_writer_t.
+ *
+ * @var async_file_writer_statistics_t::method
+ *     @brief How files were written.
+ * @var async_file_writer_statistics_t::files
+ *     @brief Number of files written (including failed ones).
+ * @var async_file_writer_statistics_t::failures
+ *     @brief Number of files that couldn't be written.
+ * @var async_file_writer_statistics_t::bytes
+ *     @brief Number of bytes written to all files.
+ * @var async_file_writer_statistics_t::syscalls
+ *     @brief Number of system calls performed to write all files.
+ * @var async_file_writer_statistics_t::blocked_time
+ *     @brief Time (in nanoseconds) the calling threads spent in ::async_file_writer_write and
+ *            ::async_file_writer_finish.
+ */
+typedef struct {
+    async_file_writer_method_t method;
+    size_t                     files, failures, bytes, syscalls;
+    uint64_t                   blocked_time;
+} async_file_writer_statistics_t;
+
+/** @brief A way of writing many whole files, possibly asynchronously. */
+typedef struct async_file_writer async_file_writer_t;
+
+/**
+ * @brief Creates a new writer of files.
+ *
+ * @param method        Preferred way of writing files. ::ASYNC_FILE_WRITER_METHOD_IO_URING falls
+ *                      back to ::ASYNC_FILE_WRITER_METHOD_SYNC when `io_uring` isn't available.
+ * @param max_in_flight Maximum number of files being written at the same time (only used with
+ *                      `io_uring`). Must be positive.
+ *
+ * @return A new ::async_file_writer_t, that must be deleted with ::async_file_writer_free, or
+ *         `NULL` on allocation failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref async_file_writer_examples).
+ */
+async_file_writer_t *async_file_writer_create(async_file_writer_method_t method,
+                                              size_t                     max_in_flight);
+
+/**
+ * @brief   Writes a file, creating it or replacing its contents.
+ * @details Blocks only while the maximum number of files is in flight, or always when writing files
+ *          synchronously. Not thread-safe.
+ *
+ * @param writer   Writer of files.
+ * @param path     Path to the file to be written. Copied, so it can be modified afterwards.
+ * @param contents Contents of the file, allocated with `malloc`. Ownership is passed to @p writer,
+ *                 that will `free` them once they're written. Can be `NULL` if @p length is `0`.
+ * @param length   Number of bytes in @p contents.
+ *
+ * @retval 0 Success (or the file is still being written).
+ * @retval 1 Allocation or IO failure. @p contents are still `free`d.
+ */
+int async_file_writer_write(async_file_writer_t *writer,
+                            const char          *path,
+                            char                *contents,
+                            size_t               length);
+
+/**
+ * @brief Waits for all files to be written.
+ *
+ * @param writer Writer of files.
+ *
+ * @retval 0 Success.
+ * @retval 1 Some file (since the writer was created) failed to be written.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref async_file_writer_examples).
+ */
+int async_file_writer_finish(async_file_writer_t *writer);
+
+/**
+ * @brief  Gets information about the files written by a writer.
+ * @param  writer Writer of files.
+ * @return Statistics about all files written so far.
+ */
+const async_file_writer_statistics_t *
+    async_file_writer_get_statistics(const async_file_writer_t *writer);
+
+/**
+ * @brief   Frees memory allocated by ::async_file_writer_create.
+ * @details Waits for files still in flight (see ::async_file_writer_finish).
+ * @param   writer Writer of files to be deleted.
+ */
+void async_file_writer_free(async_file_writer_t *writer);
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    bloom_filter.h
+ * @brief   Blocked Bloom filter, for answering lookups of keys that aren't in a set cheaply.
+ * @details Each key sets ::BLOOM_FILTER_HASHES bits of a single 64-byte block, so that a lookup
+ *          only touches one cache line. With ::BLOOM_FILTER_BITS_PER_KEY bits per key, about 1 %
+ *          of the keys not in the set are reported as possibly present (false positives). Keys in
+ *          the set are never reported as absent.
+ *
+ *          Filters count how lookups were answered (::bloom_filter_statistics_t), so that their
+ *          effectiveness can be measured. Counters are updated atomically, and lookups are
+ *          otherwise read-only, so a filter can be queried from many threads at the same time.
+ *
+ * @anchor bloom_filter_example
+ * ### Example
+ *
+ * ```c
+ * bloom_filter_t *filter = bloom_filter_create(2);
+ * if (!filter)
+ *     return 1;
+ *
+ * bloom_filter_add(filter, bloom_filter_hash_string("JéssiTavares910"));
+ * bloom_filter_add(filter, bloom_filter_hash_integer(42));
+ *
+ * printf("%d %d\n",
+ *        bloom_filter_may_contain(filter, bloom_filter_hash_integer(42)),    // 1
+ *        bloom_filter_may_contain(filter, bloom_filter_hash_string("Nope"))); // Most likely 0
+ *
+ * bloom_filter_free(filter);
+ * return 0;
+ * ```
+ */
+
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/** @brief Number of bits of a ::bloom_filter_t per key it was created for. */
+#define BLOOM_FILTER_BITS_PER_KEY 10
+
+/** @brief Number of bits set in a block of a ::bloom_filter_t for every key. */
+#define BLOOM_FILTER_HASHES 6
+
+/** @brief Blocked Bloom filter. */
+typedef struct bloom_filter bloom_filter_t;
+
+/**
+ * @struct bloom_filter_statistics_t
+ * @brief  How the lookups in a ::bloom_filter_t were answered.
+ *
+ * @var bloom_filter_statistics_t::rejected
+ *     @brief Lookups of keys answered as absent by the filter alone.
+ * @var bloom_filter_statistics_t::passed
+ *     @brief Lookups of keys the filter reported as possibly present.
+ * @var bloom_filter_statistics_t::false_positives
+ *     @brief   Lookups in ::bloom_filter_statistics_t::passed whose key turned out to be absent.
+ *     @details Reported by the filter's user, with ::bloom_filter_count_false_positive.
+ */
+typedef struct {
+    size_t rejected, passed, false_positives;
+} bloom_filter_statistics_t;
+
+/**
+ * @brief  Hashes a string, for it to be used as a key in a ::bloom_filter_t.
+ * @param  str String to be hashed.
+ * @return A 64-bit hash of @p str.
+ */
+uint64_t bloom_filter_hash_string(const char *str);
+
+/**
+ * @brief  Hashes an integer, for it to be used as a key in a ::bloom_filter_t.
+ * @param  value Integer to be hashed.
+ * @return A 64-bit hash of @p value.
+ */
+uint64_t bloom_filter_hash_integer(uint64_t value);
+
+/**
+ * @brief   Creates an empty Bloom filter.
+ * @details The returned value is owned by the caller, and should be freed with
+ *          ::bloom_filter_free.
+ *
+ * @param capacity Number of keys expected to be added. More keys can be added, at the cost of more
+ *                 false positives.
+ *
+ * @return A new filter, or `NULL` on allocation failure.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref bloom_filter_example).
+ */
+bloom_filter_t *bloom_filter_create(size_t capacity);
+
+/**
+ * @brief Adds a key to a Bloom filter.
+ *
+ * @param filter Filter to be modified.
+ * @param hash   Hash of the key (see ::bloom_filter_hash_string and ::bloom_filter_hash_integer).
+ *
+ * #### Example
+ * See [the header file's documentation](@ref bloom_filter_example).
+ */
+void bloom_filter_add(bloom_filter_t *filter, uint64_t hash);
+
+/**
+ * @brief   Checks if a key may have been added to a Bloom filter.
+ * @details Counts the lookup in the filter's statistics (::bloom_filter_get_statistics).
+ *
+ * @param filter Filter where to perform the lookup.
+ * @param hash   Hash of the key (see ::bloom_filter_hash_string and ::bloom_filter_hash_integer).
+ *
+ * @return `0` if the key definitely wasn't added to @p filter, `1` if it may have been.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref bloom_filter_example).
+ */
+int bloom_filter_may_contain(const bloom_filter_t *filter, uint64_t hash);
+
+/**
+ * @brief   Counts a false positive of a Bloom filter.
+ * @details To be called when a key ::bloom_filter_may_contain reported as possibly present turns
+ *          out not to exist.
+ *
+ * @param filter Filter that answered the lookup.
+ */
+void bloom_filter_count_false_positive(const bloom_filter_t *filter);
+
+/**
+ * @brief Gets how the lookups in a Bloom filter were answered.
+ *
+ * @param filter     Filter to get the statistics from.
+ * @param statistics Where to write the statistics to.
+ */
+void bloom_filter_get_statistics(const bloom_filter_t      *filter,
+                                 bloom_filter_statistics_t *statistics);
+
+/**
+ * @brief  Gets the number of bytes allocated for a Bloom filter.
+ * @param  filter Filter to get the size of.
+ * @return The number of bytes allocated for @p filter and its blocks.
+ */
+size_t bloom_filter_get_size(const bloom_filter_t *filter);
+
+/**
+ * @brief Frees memory used by a Bloom filter.
+ * @param filter Filter to be freed.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref bloom_filter_example).
+ */
+void bloom_filter_free(bloom_filter_t *filter);
+
+#endif
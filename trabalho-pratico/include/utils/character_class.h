@@ -0,0 +1,60 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  character_class.h
+ * @brief Table-driven classification of single characters.
+ * @details Classifying a character is a single lookup in a 256-entry table, instead of a chain of
+ *          comparisons. Classes are bit flags, so that a character can be tested against multiple
+ *          classes with a single `&`.
+ *
+ * @anchor character_class_examples
+ * ### Example
+ *
+ * ```c
+ * size_t letters = 0;
+ * for (const char *c = "ab.c"; *c; ++c)
+ *     if (character_class_get(*c) & CHARACTER_CLASS_LETTER)
+ *         letters++;
+ * ```
+ *
+ * `letters` will be `3`.
+ */
+
+#ifndef CHARACTER_CLASS_H
+#define CHARACTER_CLASS_H
+
+#include <stdint.h>
+
+/** @brief Classes a character can belong to (bit flags). */
+typedef enum {
+    CHARACTER_CLASS_OTHER  = 0, /**< @brief Any character not covered by another class. */
+    CHARACTER_CLASS_END    = 1, /**< @brief The null terminator, `'\0'`. */
+    CHARACTER_CLASS_LETTER = 2, /**< @brief An ASCII letter, lower or upper case. */
+    CHARACTER_CLASS_AT     = 4, /**< @brief An at sign, `'@'`. */
+    CHARACTER_CLASS_DOT    = 8  /**< @brief A dot, `'.'`. */
+} character_class_t;
+
+/** @brief Class of every possible character. Use ::character_class_get to index it. */
+extern const uint8_t character_class_table[256];
+
+/**
+ * @brief Gets the classes (::character_class_t flags) a character belongs to.
+ * @param c Character to be classified.
+ */
+#define character_class_get(c) (character_class_table[(unsigned char) (c)])
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    cpu_features.h
+ * @brief   Detection of the SIMD extensions of the CPU, for choosing between implementations of a
+ *          kernel at runtime.
+ * @details The program is built for a baseline CPU, so that it runs anywhere (including the course
+ *          evaluator). Kernels that benefit from wider SIMD extensions are compiled in several
+ *          versions (with `__attribute__((target(...)))`), next to a portable scalar version, and
+ *          the best one for the CPU running the program is chosen when the program starts.
+ *
+ *          Features are detected once. The ::CPU_FEATURES_ENVIRONMENT_VARIABLE environment variable
+ *          limits the features that are reported, so that other implementations of kernels can be
+ *          tested on the same machine (e.g.: `LI3_CPU_FEATURES=scalar` for the scalar versions).
+ *          Every implementation must give results identical to the scalar one.
+ *
+ * @anchor cpu_features_examples
+ * ### Examples
+ *
+ * ```c
+ * typedef int (*sum_kernel_t)(const int *values, size_t n);
+ *
+ * int sum_scalar(const int *values, size_t n) { ... }
+ * __attribute__((target("avx2"))) int sum_avx2(const int *values, size_t n) { ... }
+ *
+ * sum_kernel_t sum_kernel = sum_scalar;
+ *
+ * void __attribute__((constructor)) sum_kernel_select(void) {
+ *     const sum_kernel_t kernels[]      = {sum_avx2, sum_scalar};
+ *     const unsigned int requirements[] = {CPU_FEATURE_AVX2, 0};
+ *     sum_kernel = kernels[cpu_features_select(requirements, 2)];
+ * }
+ * ```
+ */
+
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#include <stddef.h>
+
+/**
+ * @brief Name of the environment variable that limits the detected CPU features.
+ * @details Its value is the best level of features to be used: `scalar`, `sse4.1`, `avx2` or
+ *          `avx512`. Unknown values are ignored.
+ */
+#define CPU_FEATURES_ENVIRONMENT_VARIABLE "LI3_CPU_FEATURES"
+
+/**
+ * @brief   SIMD extensions kernels can require.
+ * @details Each value is a bit, so that requirements can be combined. Each level implies the
+ *          previous ones.
+ */
+typedef enum {
+    CPU_FEATURE_SSE41  = 1 << 0, /**< SSE4.1. */
+    CPU_FEATURE_AVX2   = 1 << 1, /**< AVX2. */
+    CPU_FEATURE_AVX512 = 1 << 2  /**< AVX-512, with the foundation and byte / word instructions. */
+} cpu_feature_t;
+
+/**
+ * @brief   Gets the SIMD extensions supported by the CPU running the program.
+ * @details Detection is done once, and can be done from many threads at the same time. The result
+ *          is limited by ::CPU_FEATURES_ENVIRONMENT_VARIABLE, and is always `0` on CPUs other than
+ *          x86 ones.
+ *
+ * @return A bitwise OR of ::cpu_feature_t values.
+ */
+unsigned int cpu_features_get(void);
+
+/**
+ * @brief Chooses the best implementation of a kernel for the CPU running the program.
+ *
+ * @param requirements Features required by each implementation (bitwise ORs of ::cpu_feature_t
+ *                     values), from the best implementation to the worst. The last one should be
+ *                     `0` (a scalar implementation, that runs anywhere).
+ * @param n            Number of implementations in @p requirements.
+ *
+ * @return The index of the first implementation in @p requirements whose requirements are met, or
+ *         `n - 1` if none is.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref cpu_features_examples).
+ */
+size_t cpu_features_select(const unsigned int *requirements, size_t n);
+
+/**
+ * @brief  Gets the name of the best level of features in a set of features.
+ * @param  features Bitwise OR of ::cpu_feature_t values (see ::cpu_features_get).
+ * @return `"avx512"`, `"avx2"`, `"sse4.1"` or `"scalar"`.
+ */
+const char *cpu_features_get_name(unsigned int features);
+
+#endif
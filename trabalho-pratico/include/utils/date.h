@@ -78,16 +78,19 @@
 
 #include <stdint.h>
 
-/** @brief A date containing a year, a month a day. */
+/**
+ * @brief   A date containing a year, a month a day.
+ * @details Stored as a monotonic day ordinal (`(year * 12 + month - 1) * 31 + day - 1`), so that
+ *          dates can be compared and subtracted as plain integers. Use the getters to access its
+ *          fields.
+ */
 typedef uint32_t date_t;
 
-#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
-    /** @brief Current system date (`2023/10/01`). */
-    #define DATE_CURRENT 0x07e70a01
-#else
-    /** @brief Current system date (`2023/10/01`). */
-    #define DATE_CURRENT 0x010a07e7
-#endif
+/** @brief Current system date (`2023/10/01`). */
+#define DATE_CURRENT 752835
+
+/** @brief A value greater than any valid date. Not a valid date itself. */
+#define DATE_LATEST 0xFFFFFFFF
 
 /**
  * @brief Creates a date from a @p year, a @p month and a @p day.
@@ -170,6 +173,18 @@ void date_sprintf(char *output, date_t date);
  */
 int64_t date_diff(date_t a, date_t b);
 
+/**
+ * @brief   Converts a date to a number of days since an arbitrary epoch.
+ * @details Given the ordinal representation of ::date_t, this is a no-op kept for readability.
+ *          `date_diff(a, b) == date_to_day_number(a) - date_to_day_number(b)`. Useful for
+ *          comparing many dates with integer arithmetic.
+ *
+ * @param date Date to be converted.
+ *
+ * @return The number of days between the epoch and @p date.
+ */
+int32_t date_to_day_number(date_t date);
+
 /**
  * @brief  Gets the year from a date.
  * @param  date Date to get the year from.
@@ -226,7 +241,8 @@ int date_set_day(date_t *date, uint8_t day);
 
 /**
  * @brief   Generates an integer made of a date without its day.
- * @details Useful for referring to months in hash table keys.
+ * @details Useful for referring to months in hash table keys. The result is the first day of the
+ *          month of @p date.
  *
  * @param date Date to have its day removed.
  *
@@ -236,7 +252,8 @@ uint32_t date_generate_dayless(date_t date);
 
 /**
  * @brief   Generates an integer made of a date without its month and day.
- * @details Useful for referring to years in hash table keys.
+ * @details Useful for referring to years in hash table keys. The result is the first day of the
+ *          year of @p date.
  *
  * @param date Date to have its month and day removed.
  *
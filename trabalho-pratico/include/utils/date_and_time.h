@@ -55,9 +55,19 @@
 #include "utils/date.h"
 #include "utils/daytime.h"
 
-/** @brief A type containing a ::date_t and a ::daytime_t. */
+/**
+ * @brief   A type containing a ::date_t and a ::daytime_t.
+ * @details Stored as a number of seconds (`date * 86400 + time`), so that timed dates can be
+ *          compared and subtracted as plain integers.
+ */
 typedef uint64_t date_and_time_t;
 
+/**
+ * @brief A value greater than any valid timed date. Not a valid timed date itself, but its date
+ *        is ::DATE_LATEST.
+ */
+#define DATE_AND_TIME_LATEST ((date_and_time_t) DATE_LATEST * 86400 + 86399)
+
 /**
  * @brief Creates a ::date_and_time_t from its @p date and @p time values.
  *
@@ -67,7 +67,10 @@
 
 #include <stdint.h>
 
-/** @brief A time containing hours, minutes and seconds. */
+/**
+ * @brief   A time containing hours, minutes and seconds.
+ * @details Stored as the number of seconds since midnight. Use the getters to access its fields.
+ */
 typedef uint32_t daytime_t;
 
 /**
@@ -124,6 +124,7 @@
 #define FIXED_N_DELIMITER_PARSER_H
 
 #include <stddef.h>
+#include <string.h>
 
 /**
  * @brief Method that, in a ::fixed_n_delimiter_parser_grammar_t, is associated with an `n`-th
@@ -235,6 +236,29 @@ int fixed_n_delimiter_parser_parse_string(char
                                           const fixed_n_delimiter_parser_grammar_t *grammar,
                                           void                                     *user_data);
 
+/**
+ * @brief   Parses a **MODIFIABLE** string, whose length is known, using a parser defined by
+ *          @p grammar.
+ * @details Behaves like ::fixed_n_delimiter_parser_parse_string, but delimiters are found with
+ *          `memchr`, which examines many bytes at once, instead of looking for both delimiters and
+ *          the string's terminator. Useful when the length of @p input is already known, such as
+ *          for lines of a dataset.
+ *
+ * @param input     String to parse (`'\0'`-terminated), that will be modified during parsing, but
+ *                  then restored to its original form, assuming callbacks in @p grammar don't
+ *                  modify it.
+ * @param length    Length of @p input, not including the `'\0'` terminator.
+ * @param grammar   Grammar that defines the parser to be used.
+ * @param user_data Pointer passed to every callback in @p grammar, so that they can edit the
+ *                  program's state.
+ *
+ * @return The same values as ::fixed_n_delimiter_parser_parse_string.
+ */
+int fixed_n_delimiter_parser_parse_slice(char                                     *input,
+                                         size_t                                    length,
+                                         const fixed_n_delimiter_parser_grammar_t *grammar,
+                                         void                                     *user_data);
+
 /**
  * @brief   Parses a string using a parser defined by @p grammar.
  * @details The current implementation copies the provided string to a temporary buffer. Keep that
@@ -263,4 +287,92 @@ int fixed_n_delimiter_parser_parse_string_const(const char
                                                 const fixed_n_delimiter_parser_grammar_t *grammar,
                                                 void *user_data);
 
+/**
+ * @brief   Type of a parser generated by ::FIXED_N_DELIMITER_PARSER_DEFINE.
+ * @details Behaves like ::fixed_n_delimiter_parser_parse_slice with the grammar the parser was
+ *          generated from.
+ *
+ * @param input     String to parse (`'\0'`-terminated), that will be modified during parsing, but
+ *                  then restored to its original form.
+ * @param length    Length of @p input, not including the `'\0'` terminator.
+ * @param user_data Pointer passed to every callback in the parser's schema.
+ *
+ * @return The same values as ::fixed_n_delimiter_parser_parse_slice.
+ */
+typedef int (*fixed_n_delimiter_parser_specialized_t)(char *input, size_t length, void *user_data);
+
+/**
+ * @brief   Expands to a schema's callback, followed by a comma.
+ * @details Pass it to a schema (see ::FIXED_N_DELIMITER_PARSER_DEFINE) to get the initializer of
+ *          an array of callbacks for ::fixed_n_delimiter_parser_grammar_new.
+ */
+#define FIXED_N_DELIMITER_PARSER_CALLBACK(callback) callback,
+
+/**
+ * @brief   Expands to `+ 1`.
+ * @details Pass it to a schema (see ::FIXED_N_DELIMITER_PARSER_DEFINE), after a `0`, to get the
+ *          number of fields in that schema as a constant expression.
+ */
+#define FIXED_N_DELIMITER_PARSER_COUNT(callback) +1
+
+/** @cond FALSE */
+#define __FIXED_N_DELIMITER_PARSER_FIELD(callback)                                                 \
+    {                                                                                              \
+        char *const __next = memchr(__token, __delimiter, __end - __token);                        \
+        if (__next)                                                                                \
+            *__next = '\0';                                                                        \
+                                                                                                   \
+        const int __retval = callback(user_data, __token, __ntoken);                               \
+        if (__next)                                                                                \
+            *__next = __delimiter; /* Restore string */                                            \
+                                                                                                   \
+        if (__retval)                                                                              \
+            return __retval;                                                                       \
+        if (!__next)                                                                               \
+            return __ntoken + 1 < __n ? FIXED_N_DELIMITER_PARSER_PARSE_STRING_RET_NOT_ENOUGH_ITEMS \
+                                      : 0;                                                         \
+                                                                                                   \
+        __token = __next + 1;                                                                      \
+        __ntoken++;                                                                                \
+    }
+/** @endcond */
+
+/**
+ * @brief   Defines a parser specialized for a schema known at compile time.
+ * @details A schema is an X-macro that takes another macro (`FIELD`) and calls `FIELD(callback)`
+ *          for every field, in order, where `callback` is a
+ *          ::fixed_n_delimiter_parser_iter_callback_t. The generated function (a
+ *          ::fixed_n_delimiter_parser_specialized_t) calls each callback directly, with a constant
+ *          `ntoken`, so that callbacks can be inlined, instead of calling them through a
+ *          ::fixed_n_delimiter_parser_grammar_t. A generic grammar, with the same behavior, can
+ *          still be created from the same schema (see ::FIXED_N_DELIMITER_PARSER_CALLBACK and
+ *          ::FIXED_N_DELIMITER_PARSER_COUNT):
+ *
+ *          ```c
+ *          #define PERSON_SCHEMA(FIELD) FIELD(parse_name) FIELD(parse_int) FIELD(parse_int)
+ *
+ *          FIXED_N_DELIMITER_PARSER_DEFINE(parse_person, ',', PERSON_SCHEMA)
+ *
+ *          const fixed_n_delimiter_parser_iter_callback_t callbacks[] = {
+ *              PERSON_SCHEMA(FIXED_N_DELIMITER_PARSER_CALLBACK)};
+ *          fixed_n_delimiter_parser_grammar_t *grammar = fixed_n_delimiter_parser_grammar_new(
+ *              ',', 0 PERSON_SCHEMA(FIXED_N_DELIMITER_PARSER_COUNT), callbacks);
+ *          ```
+ *
+ * @param name      Name of the function to be defined.
+ * @param delimiter Separator between data points.
+ * @param SCHEMA    Schema of the strings to be parsed.
+ */
+#define FIXED_N_DELIMITER_PARSER_DEFINE(name, delimiter, SCHEMA)                                   \
+    int name(char *input, size_t length, void *user_data) {                                        \
+        const size_t __n         = 0 SCHEMA(FIXED_N_DELIMITER_PARSER_COUNT);                       \
+        const char   __delimiter = (delimiter);                                                    \
+        char *const  __end       = input + length;                                                 \
+        char        *__token     = input;                                                          \
+        size_t       __ntoken    = 0;                                                              \
+                                                                                                   \
+        SCHEMA(__FIXED_N_DELIMITER_PARSER_FIELD)                                                   \
+        return FIXED_N_DELIMITER_PARSER_PARSE_STRING_RET_TOO_MANY_ITEMS;                           \
+    }
+
 #endif
@@ -72,6 +72,17 @@ void g_const_ptr_array_add(GConstPtrArray *array, gconstpointer data);
  */
 gconstpointer g_const_ptr_array_index(const GConstPtrArray *array, guint index);
 
+/**
+ * @brief   Replaces the pointer at a given index of a pointer array.
+ * @details There is no equivalent to this method in `glib`, as a `GPtrArray`'s elements can be
+ *          directly assigned to.
+ *
+ * @param array The array where to replace a pointer.
+ * @param index The index of the pointer to be replaced. Must be lower than the length of @p array.
+ * @param data  New pointer.
+ */
+void g_const_ptr_array_set(GConstPtrArray *array, guint index, gconstpointer data);
+
 /**
  * @brief   Returns the length of an array of constant pointers.
  * @details There is no equivalent to this method in `glib`, as the field `len` is directly
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    hyperloglog.h
+ * @brief   Sketch for estimating the number of distinct elements in a set (HyperLogLog).
+ * @details Elements are added by their 64-bit hash, and only one byte is kept for each of the
+ *          `2 ^ precision` registers, so memory doesn't grow with the number of elements. Adding
+ *          the same element twice has no effect, and sketches can be merged, for their estimate
+ *          to be the number of distinct elements in the union of both sets. The standard error of
+ *          the estimate is ::hyperloglog_get_relative_error.
+ *
+ * @anchor hyperloglog_example
+ * ### Example
+ *
+ * ```c
+ * hyperloglog_t *sketch = hyperloglog_create(10);
+ * if (!sketch)
+ *     return 1;
+ *
+ * char id[16];
+ * for (int i = 0; i < 100000; ++i) {
+ *     sprintf(id, "User%d", i % 5000);
+ *     hyperloglog_add(sketch, hyperloglog_hash_string(id));
+ * }
+ *
+ * printf("~%" PRIu64 " (+- %.1f %%)\n",
+ *        hyperloglog_estimate(sketch),
+ *        hyperloglog_get_relative_error(sketch) * 100); // Close to 5000, +- 3.3 %
+ *
+ * hyperloglog_free(sketch);
+ * return 0;
+ * ```
+ */
+
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/** @brief Smallest precision (base-2 logarithm of the number of registers) of a sketch. */
+#define HYPERLOGLOG_MIN_PRECISION 4
+
+/** @brief Largest precision (base-2 logarithm of the number of registers) of a sketch. */
+#define HYPERLOGLOG_MAX_PRECISION 16
+
+/** @brief Sketch for estimating the number of distinct elements in a set. */
+typedef struct hyperloglog hyperloglog_t;
+
+/**
+ * @brief   Hashes a string, for it to be added to a ::hyperloglog_t.
+ * @details Every bit of the result depends on every character of @p str, as the sketch takes the
+ *          register and the rank from different bits.
+ *
+ * @param str String to be hashed.
+ *
+ * @return A 64-bit hash of @p str.
+ */
+uint64_t hyperloglog_hash_string(const char *str);
+
+/**
+ * @brief   Creates an empty sketch.
+ * @details The returned value is owned by the caller, and should be freed with
+ *          ::hyperloglog_free.
+ *
+ * @param precision Base-2 logarithm of the number of registers, between
+ *                  ::HYPERLOGLOG_MIN_PRECISION and ::HYPERLOGLOG_MAX_PRECISION.
+ *
+ * @return A new sketch, or `NULL` on allocation failure or invalid @p precision.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref hyperloglog_example).
+ */
+hyperloglog_t *hyperloglog_create(unsigned int precision);
+
+/**
+ * @brief Adds an element to a sketch.
+ *
+ * @param sketch Sketch to be modified.
+ * @param hash   64-bit hash of the element to be added (e.g.: ::hyperloglog_hash_string).
+ *
+ * #### Example
+ * See [the header file's documentation](@ref hyperloglog_example).
+ */
+void hyperloglog_add(hyperloglog_t *sketch, uint64_t hash);
+
+/**
+ * @brief Adds all elements of a sketch to another.
+ *
+ * @param sketch Sketch to be modified.
+ * @param other  Sketch whose elements are added to @p sketch.
+ *
+ * @retval 0 Success.
+ * @retval 1 The sketches have different precisions.
+ */
+int hyperloglog_merge(hyperloglog_t *sketch, const hyperloglog_t *other);
+
+/**
+ * @brief  Estimates the number of distinct elements added to a sketch.
+ * @param  sketch Sketch to get the estimate from.
+ * @return The estimated number of distinct elements in @p sketch.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref hyperloglog_example).
+ */
+uint64_t hyperloglog_estimate(const hyperloglog_t *sketch);
+
+/**
+ * @brief  Gets the standard error of the estimates of a sketch, relative to the exact count.
+ * @param  sketch Sketch to get the error from.
+ * @return `1.04 / sqrt(2 ^ precision)`.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref hyperloglog_example).
+ */
+double hyperloglog_get_relative_error(const hyperloglog_t *sketch);
+
+/**
+ * @brief  Gets the number of bytes allocated for a sketch.
+ * @param  sketch Sketch to get the size of.
+ * @return The number of bytes allocated by ::hyperloglog_create for @p sketch.
+ */
+size_t hyperloglog_get_size(const hyperloglog_t *sketch);
+
+/**
+ * @brief Frees memory used by a sketch.
+ * @param sketch Sketch to be freed.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref hyperloglog_example).
+ */
+void hyperloglog_free(hyperloglog_t *sketch);
+
+#endif
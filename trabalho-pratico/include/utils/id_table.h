@@ -0,0 +1,210 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ID_TABLE_H
+#define ID_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/memory_report.h"
+
+/**
+ * @file    id_table.h
+ * @brief   Hash table from 32-bit integer identifiers to 32-bit integer values.
+ * @details Unlike a `GHashTable`, entries are stored inline in a flat array (open addressing with
+ *          linear probing), so no allocation is made per entry and a lookup usually touches a
+ *          single cache line. It's meant for identifiers that are already packed integers, such as
+ *          ::flight_id_t and ::reservation_id_t, mapped to rows in a manager's columns.
+ *
+ *          Once all entries are inserted, a table whose keys are dense (most keys between the
+ *          smallest and the largest one are present) can be made direct-indexed with
+ *          ::id_table_compact: values are then stored in an array indexed by key, so that a lookup
+ *          is a single load, without any hashing or probing.
+ *
+ *          The value `UINT32_MAX` is reserved (it marks empty slots), and can't be stored.
+ *
+ *          A table that is no longer modified can be replicated on every NUMA node (see
+ *          ::id_table_replicate), so that lookups from any thread read local memory.
+ *
+ * @anchor id_table_examples
+ * ### Examples
+ *
+ * ```c
+ * #include <inttypes.h>
+ * #include <stdio.h>
+ * #include "utils/id_table.h"
+ *
+ * int main(void) {
+ *     id_table_t *table = id_table_create(100); // Room for 100 entries before growing
+ *
+ *     for (uint32_t i = 0; i < 1000; ++i)
+ *         id_table_insert(table, i * 7919, i);
+ *
+ *     uint32_t value;
+ *     if (!id_table_lookup(table, 7919 * 3, &value))
+ *         printf("%" PRIu32 "\n", value); // Prints 3
+ *
+ *     id_table_remove(table, 7919 * 3);
+ *     if (id_table_lookup(table, 7919 * 3, &value))
+ *         printf("Not found\n");
+ *
+ *     id_table_free(table);
+ *     return 0;
+ * }
+ * ```
+ */
+
+/**
+ * @brief How many keys ahead of the current one bulk operations should prefetch with
+ *        ::id_table_prefetch.
+ */
+#define ID_TABLE_PREFETCH_DISTANCE 8
+
+/** @brief Hash table from 32-bit integer identifiers to 32-bit integer values. */
+typedef struct id_table id_table_t;
+
+/**
+ * @brief   Creates a new empty ::id_table_t.
+ * @details The returned value is owned by the caller, and should be freed with ::id_table_free.
+ *
+ * @param capacity Number of entries that can be inserted before the table needs to grow. The table
+ *                 grows automatically, so this is only a hint.
+ *
+ * @return A new ::id_table_t, or `NULL` on allocation failure.
+ */
+id_table_t *id_table_create(size_t capacity);
+
+/**
+ * @brief Grows a table so that it can hold @p capacity entries without growing again.
+ *
+ * @param table    Table to be grown. Nothing is done if it's large enough already.
+ * @param capacity Total number of entries that must fit in @p table.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p table is left unchanged).
+ */
+int id_table_reserve(id_table_t *table, size_t capacity);
+
+/**
+ * @brief   Shrinks a table to the smallest number of slots that fits the entries in it.
+ * @details Meant for tables that were reserved for an overestimated number of entries, once no
+ *          more entries are going to be inserted. The table can still grow afterwards.
+ *
+ * @param table Table to be shrunk. Nothing is done if it can't be any smaller.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p table is left unchanged).
+ */
+int id_table_shrink_to_fit(id_table_t *table);
+
+/**
+ * @brief   Optimizes a table for lookups, once no more entries are going to be inserted.
+ * @details If the range of keys in @p table is at most twice as large as the number of entries,
+ *          values are moved to an array indexed by key (minus the smallest key), and the slots
+ *          are freed. Otherwise, @p table is shrunk (see ::id_table_shrink_to_fit).
+ *
+ *          A direct-indexed table can still be modified. Removing entries and inserting keys
+ *          within its range is as cheap as looking them up, but inserting a key outside of that
+ *          range (or reserving more entries) turns it back into a hashed table.
+ *
+ * @param table Table to be optimized.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p table is left unchanged, and lookups still work).
+ */
+int id_table_compact(id_table_t *table);
+
+/**
+ * @brief   Copies a table to every NUMA node, for lookups to read the copy of the calling thread's
+ *          node (see ::numa_topology_get_current_node).
+ * @details Meant for tables that are looked up from many threads and no longer modified. Modifying
+ *          @p table (including reserving and compacting it) frees its copies. On machines with a
+ *          single NUMA node, nothing is done.
+ *
+ * @param table Table to be replicated.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p table isn't replicated, and lookups still work).
+ */
+int id_table_replicate(id_table_t *table);
+
+/**
+ * @brief Associates a value to a key in a table, replacing any previous association.
+ *
+ * @param table Table to insert the association in.
+ * @param key   Key to be inserted.
+ * @param value Value associated to @p key. Can't be `UINT32_MAX`.
+ *
+ * @retval 0 Success (@p key wasn't in @p table before).
+ * @retval 1 Allocation failure (@p table is left unchanged).
+ * @retval 2 Success (@p key was already in @p table, and its value was replaced).
+ */
+int id_table_insert(id_table_t *table, uint32_t key, uint32_t value);
+
+/**
+ * @brief Gets the value associated to a key in a table.
+ *
+ * @param table Table to search in.
+ * @param key   Key to be searched for.
+ * @param value Where to write the value associated to @p key to. Not modified if @p key isn't
+ *              found.
+ *
+ * @retval 0 Success.
+ * @retval 1 @p key not in @p table.
+ */
+int id_table_lookup(const id_table_t *table, uint32_t key, uint32_t *value);
+
+/**
+ * @brief   Starts loading the slot where a key would be into the cache.
+ * @details Meant for bulk insertions and lookups, where the keys to come are known in advance: a
+ *          key can be prefetched a few operations before it's needed, so that cache misses overlap.
+ *          The slot is only a hint, and is invalidated if @p table grows before it's used.
+ *
+ * @param table Table that is going to be searched.
+ * @param key   Key that is going to be inserted or looked up.
+ */
+void id_table_prefetch(const id_table_t *table, uint32_t key);
+
+/**
+ * @brief Removes a key (and its associated value) from a table.
+ *
+ * @param table Table to remove @p key from.
+ * @param key   Key to be removed.
+ *
+ * @retval 0 Success.
+ * @retval 1 @p key not in @p table to begin with.
+ */
+int id_table_remove(id_table_t *table, uint32_t key);
+
+/**
+ * @brief   Gets the memory accounting counters of a table.
+ * @details The array of slots is the only block, along with its copies on every NUMA node, if
+ *          replicated (see ::id_table_replicate). Empty slots are reserved but not used.
+ *
+ * @param table Table to get the counters from.
+ * @param out   Where to write the counters to.
+ */
+void id_table_get_memory_usage(const id_table_t *table, memory_usage_t *out);
+
+/**
+ * @brief Frees memory used by an ::id_table_t.
+ * @param table Table to be freed.
+ */
+void id_table_free(id_table_t *table);
+
+#endif
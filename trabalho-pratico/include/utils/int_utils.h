@@ -38,6 +38,7 @@
 #define INT_UTILS_H
 
 #include <inttypes.h>
+#include <stddef.h>
 
 /**
  * @brief Determines the minimum of two numbers.
@@ -75,4 +76,63 @@
  */
 int int_utils_parse_positive(uint64_t *output, const char *input);
 
+/**
+ * @brief   Parses an integer in base `10`, with a known number of digits.
+ * @details Like ::int_utils_parse_positive, but exactly @p n characters of @p input are parsed
+ *          (which don't need to be followed by a null terminator), all of which must be decimal
+ *          digits. Useful for fixed-layout fields, such as the ones in dates.
+ *
+ * @param output Where to place the parsed integer. Nothing will be written on failure.
+ * @param input  String to be parsed.
+ * @param n      Number of digits to be parsed.
+ *
+ * @retval 0 Parsing success.
+ * @retval 1 Parsing failure (a character that isn't a digit, including a null terminator).
+ */
+int int_utils_parse_digits(uint64_t *output, const char *input, size_t n);
+
+/**
+ * @brief Value that can be used for a buffer size passed to ::int_utils_sprintf_unsigned and
+ *        ::int_utils_sprintf_signed, as it fits any 64-bit integer and a null terminator.
+ */
+#define INT_UTILS_SPRINTF_MIN_BUFFER_SIZE 21
+
+/**
+ * @brief   Prints an unsigned integer in base `10`, left-padded with zeroes to a minimum width.
+ * @details Equivalent to `sprintf(output, "%0*" PRIu64, width, value)`, but faster, as no format
+ *          string needs to be parsed.
+ *
+ * @param output Where to write the number to. Must have space for all digits in @p value (at
+ *               least @p width of them) and a null terminator.
+ * @param value  Number to be printed.
+ * @param width  Minimum number of digits to write. Use `0` or `1` for no padding.
+ *
+ * @return The number of characters written to @p output, not including the null terminator.
+ */
+size_t int_utils_sprintf_padded(char *output, uint64_t value, size_t width);
+
+/**
+ * @brief   Prints an unsigned integer in base `10`.
+ * @details Equivalent to `sprintf(output, "%" PRIu64, value)`, but faster.
+ *
+ * @param output Where to write the number to. Must be at least
+ *               ::INT_UTILS_SPRINTF_MIN_BUFFER_SIZE characters long.
+ * @param value  Number to be printed.
+ *
+ * @return The number of characters written to @p output, not including the null terminator.
+ */
+size_t int_utils_sprintf_unsigned(char *output, uint64_t value);
+
+/**
+ * @brief   Prints a signed integer in base `10`.
+ * @details Equivalent to `sprintf(output, "%" PRIi64, value)`, but faster.
+ *
+ * @param output Where to write the number to. Must be at least
+ *               ::INT_UTILS_SPRINTF_MIN_BUFFER_SIZE characters long.
+ * @param value  Number to be printed.
+ *
+ * @return The number of characters written to @p output, not including the null terminator.
+ */
+size_t int_utils_sprintf_signed(char *output, int64_t value);
+
 #endif
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    mapped_file.h
+ * @brief   Read-only memory mappings of files, shared by reference counting.
+ * @details Data structures can keep pointers into a mapped file (e.g.: strings in a string pool,
+ *          see ::string_pool_borrow) instead of copying its contents. Each one holds a reference to
+ *          the mapping, which is only unmapped once all of them are done with it.
+ *
+ *          Pages of a mapping are clean and backed by the file, so the kernel can drop them under
+ *          memory pressure and read them back when they're accessed again, unlike copies in
+ *          anonymous memory.
+ *
+ *          How the kernel reads pages ahead can be tuned to how a mapping is used (see
+ *          ::mapped_file_set_access). Whatever the usual access pattern, whole scans through the
+ *          data structures that point into a mapping can be announced with
+ *          ::mapped_file_begin_scan and ::mapped_file_end_scan, so that the mapping is read
+ *          sequentially meanwhile.
+ *
+ * @anchor mapped_file_examples
+ * ### Examples
+ *
+ * ```c
+ * mapped_file_t *file = mapped_file_open("file.txt");
+ * if (!file)
+ *     return 1;
+ *
+ * fwrite(mapped_file_get_data(file), 1, mapped_file_get_size(file), stdout);
+ *
+ * mapped_file_t *other_reference = mapped_file_ref(file);
+ * mapped_file_unref(file);
+ * puts(mapped_file_get_data(other_reference)); // Still mapped
+ * mapped_file_unref(other_reference);          // Unmapped
+ * ```
+ */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stddef.h>
+
+/** @brief A read-only memory mapping of a file, with a reference counter. */
+typedef struct mapped_file mapped_file_t;
+
+/** @brief How pages of a ::mapped_file_t are expected to be accessed. */
+typedef enum {
+    MAPPED_FILE_ACCESS_NORMAL,     /**< @brief No particular pattern (the kernel's default). */
+    MAPPED_FILE_ACCESS_RANDOM,     /**< @brief Pages are accessed on demand, without read-ahead. */
+    MAPPED_FILE_ACCESS_SEQUENTIAL, /**< @brief Pages are read in order, with more read-ahead. */
+} mapped_file_access_t;
+
+/**
+ * @brief   Maps a file into memory, for reading.
+ * @details The returned mapping has a single reference, that must be released with
+ *          ::mapped_file_unref.
+ *
+ * @param path Path to the file to be mapped.
+ *
+ * @return The new mapping, or `NULL` on IO failure, allocation failure or if the file is empty.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref mapped_file_examples).
+ */
+mapped_file_t *mapped_file_open(const char *path);
+
+/**
+ * @brief  Gets the contents of a mapped file.
+ * @param  file Mapped file.
+ * @return The first byte of the file, valid while any reference to @p file exists.
+ */
+const char *mapped_file_get_data(const mapped_file_t *file);
+
+/**
+ * @brief  Gets the size of a mapped file.
+ * @param  file Mapped file.
+ * @return The number of bytes in @p file.
+ */
+size_t mapped_file_get_size(const mapped_file_t *file);
+
+/**
+ * @brief  Checks if a pointer points into a mapped file.
+ * @param  file Mapped file.
+ * @param  ptr  Pointer to be checked.
+ * @return Whether @p ptr points to one of the bytes in @p file.
+ */
+int mapped_file_contains(const mapped_file_t *file, const char *ptr);
+
+/**
+ * @brief   Chooses how pages of a mapped file are usually accessed.
+ * @details The choice is only a hint to the kernel, so failures are ignored. It's applied whenever
+ *          no scan is running (see ::mapped_file_begin_scan). Can be called from any thread.
+ *
+ * @param file   Mapped file.
+ * @param access Usual access pattern of @p file.
+ */
+void mapped_file_set_access(mapped_file_t *file, mapped_file_access_t access);
+
+/**
+ * @brief   Gives back the pages of a mapped file read so far.
+ * @details The contents of the file are kept, and pages are read again (usually, from the page
+ *          cache) when next accessed. This only lowers the resident memory of the process.
+ *
+ * @param file Mapped file.
+ */
+void mapped_file_evict(mapped_file_t *file);
+
+/**
+ * @brief   Announces that the data in a mapped file is about to be scanned from start to end.
+ * @details Sequential access is used until every scan started ends (see ::mapped_file_end_scan),
+ *          and then the access pattern chosen with ::mapped_file_set_access is restored. Nothing
+ *          happens when that pattern is ::MAPPED_FILE_ACCESS_NORMAL. Can be called from any thread.
+ *
+ * @param file Mapped file. Can be `NULL`, in which case nothing happens.
+ */
+void mapped_file_begin_scan(mapped_file_t *file);
+
+/**
+ * @brief Announces that a scan started with ::mapped_file_begin_scan is over.
+ * @param file Mapped file. Can be `NULL`, in which case nothing happens.
+ */
+void mapped_file_end_scan(mapped_file_t *file);
+
+/**
+ * @brief   Adds a reference to a mapped file.
+ * @details Can be called from any thread.
+ *
+ * @param file Mapped file.
+ *
+ * @return @p file, whose new reference must be released with ::mapped_file_unref.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref mapped_file_examples).
+ */
+mapped_file_t *mapped_file_ref(mapped_file_t *file);
+
+/**
+ * @brief   Releases a reference to a mapped file, unmapping it if it was the last one.
+ * @details Can be called from any thread.
+ *
+ * @param file Mapped file. Can be `NULL`, in which case nothing happens.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref mapped_file_examples).
+ */
+void mapped_file_unref(mapped_file_t *file);
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    memory_budget.h
+ * @brief   Process-wide limit on the memory of [pools](@ref pool.h), with graceful degradation.
+ * @details Every block of every ::pool_t (and so every ::arena_t, including those of statistical
+ *          data) is accounted for in a single, process-wide counter. When a budget is chosen with
+ *          ::MEMORY_BUDGET_ENVIRONMENT_VARIABLE, blocks that would exceed it aren't allocated, and
+ *          the allocation fails like it would if the system ran out of memory.
+ *
+ *          Before that happens, once ::MEMORY_BUDGET_PRESSURE_PERCENT of the budget is used, the
+ *          program gives up on optional memory: each place that can do without it asks
+ *          ::memory_budget_should_degrade with the ::memory_budget_degradation_t it would apply.
+ *          The first time each degradation kicks in, it's reported to `stderr`.
+ *
+ *          Without a budget, memory is still counted (see ::memory_budget_get_used), but never
+ *          limited, and nothing is degraded.
+ *
+ * @anchor memory_budget_examples
+ * ### Examples
+ *
+ * ```c
+ * // Optional data is only built if there's room for it
+ * if (!memory_budget_should_degrade(MEMORY_BUDGET_DEGRADATION_INDEXES))
+ *     build_index(...);
+ *
+ * // Allocations that don't go through a pool can also be charged to the budget
+ * if (memory_budget_reserve(size))
+ *     return 1; // Over budget
+ * void *const data = malloc(size);
+ * ...
+ * free(data);
+ * memory_budget_release(size);
+ * ```
+ */
+
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <stddef.h>
+
+/**
+ * @brief Environment variable with the memory budget, in mebibytes. Memory isn't limited if it's
+ *        unset or `0`.
+ */
+#define MEMORY_BUDGET_ENVIRONMENT_VARIABLE "LI3_MEMORY_BUDGET"
+
+/** @brief Percentage of the memory budget above which optional memory is given up on. */
+#define MEMORY_BUDGET_PRESSURE_PERCENT 75
+
+/** @brief Ways of using less memory, applied when close to the memory budget. */
+typedef enum {
+    /** @brief Optional database indexes and identifier filters aren't built eagerly. */
+    MEMORY_BUDGET_DEGRADATION_INDEXES = 1 << 0,
+    /** @brief Caches of statistical data and query outputs are emptied. */
+    MEMORY_BUDGET_DEGRADATION_CACHES = 1 << 1,
+    /** @brief Statistical data is generated by scanning entities, instead of building indexes. */
+    MEMORY_BUDGET_DEGRADATION_SCAN_STATISTICS = 1 << 2,
+    /** @brief Statistical data is approximated, when allowed (see ::query_type_get_approximate). */
+    MEMORY_BUDGET_DEGRADATION_APPROXIMATE = 1 << 3,
+} memory_budget_degradation_t;
+
+/**
+ * @brief  Gets the memory budget.
+ * @return The value of ::MEMORY_BUDGET_ENVIRONMENT_VARIABLE in bytes, or `0` if memory isn't
+ *         limited. A message is printed to `stderr` the first time, if the value is invalid.
+ */
+size_t memory_budget_get_limit(void);
+
+/**
+ * @brief  Gets the memory accounted for in the budget.
+ * @return The number of bytes reserved and not yet released (see ::memory_budget_reserve).
+ */
+size_t memory_budget_get_used(void);
+
+/**
+ * @brief   Charges memory about to be allocated to the budget.
+ * @details Thread-safe.
+ *
+ * @param bytes Number of bytes to be allocated.
+ *
+ * @retval 0 Success. The memory must be released with ::memory_budget_release.
+ * @retval 1 The budget would be exceeded. Nothing was charged, and the memory mustn't be allocated.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref memory_budget_examples).
+ */
+int memory_budget_reserve(size_t bytes);
+
+/**
+ * @brief   Gives back memory charged with ::memory_budget_reserve, after it's freed.
+ * @details Thread-safe.
+ * @param   bytes Number of bytes freed.
+ */
+void memory_budget_release(size_t bytes);
+
+/**
+ * @brief  Checks if the memory used is close to the budget.
+ * @return Whether more than ::MEMORY_BUDGET_PRESSURE_PERCENT of the budget is used (always `0`
+ *         without a budget).
+ */
+int memory_budget_is_under_pressure(void);
+
+/**
+ * @brief   Checks if a degradation should be applied, because memory is close to the budget.
+ * @details If so, the degradation is recorded (see ::memory_budget_get_degradations), and reported
+ *          to `stderr` if it's the first time it kicks in. Thread-safe.
+ *
+ * @param degradation Degradation the caller would apply.
+ *
+ * @return Whether the caller must apply @p degradation (see ::memory_budget_is_under_pressure).
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref memory_budget_examples).
+ */
+int memory_budget_should_degrade(memory_budget_degradation_t degradation);
+
+/**
+ * @brief  Gets the degradations that have kicked in.
+ * @return The bitwise OR of every ::memory_budget_degradation_t that ::memory_budget_should_degrade
+ *         ordered to be applied.
+ */
+unsigned int memory_budget_get_degradations(void);
+
+#endif
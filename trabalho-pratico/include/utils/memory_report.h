@@ -0,0 +1,218 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef MEMORY_REPORT_H
+#define MEMORY_REPORT_H
+
+#include <glib.h>
+#include <stddef.h>
+
+/**
+ * @file    memory_report.h
+ * @brief   Named memory accounting counters of the data structures in a program.
+ * @details Process-wide measurements (such as ::performance_event_get_used_memory) can't tell which
+ *          data structure dominates memory usage. Instead, allocators (::pool_t, ::string_pool_t,
+ *          ...) keep counters of their own (::memory_usage_t), that can be collected under a name
+ *          in a ::memory_report_t.
+ *
+ * @anchor memory_report_examples
+ * ### Examples
+ *
+ * ```c
+ * #include <stdio.h>
+ * #include "utils/memory_report.h"
+ * #include "utils/pool.h"
+ *
+ * int main(void) {
+ *     pool_t          *pool   = pool_create(int, 1000);
+ *     memory_report_t *report = memory_report_create();
+ *
+ *     for (int i = 0; i < 5000; ++i)
+ *         pool_put_item(int, pool, &i);
+ *
+ *     memory_usage_t usage;
+ *     pool_get_memory_usage(pool, &usage);
+ *     memory_report_add(report, "Integers", &usage);
+ *
+ *     for (size_t i = 0; i < memory_report_get_count(report); ++i) {
+ *         const memory_usage_t *entry = memory_report_get_usage(report, i);
+ *         printf("%s: %zu blocks, %zu bytes used\n",
+ *                memory_report_get_name(report, i),
+ *                entry->blocks,
+ *                entry->used_bytes); // Integers: 5 blocks, 20000 bytes used
+ *     }
+ *
+ *     memory_report_free(report);
+ *     pool_free(pool);
+ *     return 0;
+ * }
+ * ```
+ */
+
+/**
+ * @struct memory_usage_t
+ * @brief  Memory accounting counters of a data structure.
+ *
+ * @var memory_usage_t::blocks
+ *     @brief Number of separate allocations (e.g.: blocks of a ::pool_t).
+ * @var memory_usage_t::reserved_bytes
+ *     @brief   Number of bytes requested from the system.
+ *     @details For pools of ::POOL_PAGES_HUGE, this is the length of the mappings of all blocks.
+ *              Pages given back to the system by ::pool_trim aren't counted.
+ * @var memory_usage_t::used_bytes
+ *     @brief Number of reserved bytes taken by stored data.
+ * @var memory_usage_t::wasted_bytes
+ *     @brief   Number of reserved bytes that will never be used.
+ *     @details In pools, this is the space left at the end of blocks that are no longer the top
+ *              block, when an array of items (::pool_alloc_items) didn't fit in it.
+ */
+typedef struct {
+    size_t blocks;
+    size_t reserved_bytes;
+    size_t used_bytes;
+    size_t wasted_bytes;
+} memory_usage_t;
+
+/** @brief A list of named ::memory_usage_t. */
+typedef struct memory_report memory_report_t;
+
+/**
+ * @brief   Adds the counters in @p usage to @p total.
+ *
+ * @param total Counters to be modified.
+ * @param usage Counters to be added to @p total.
+ */
+void memory_usage_add(memory_usage_t *total, const memory_usage_t *usage);
+
+/**
+ * @brief   Estimates how much memory a `GHashTable` is using.
+ * @details GLib doesn't expose the capacity of its hash tables, so it's estimated from the number
+ *          of entries, assuming a power of two of buckets, each with a key, a value and a hash.
+ *
+ * @param entries Number of entries in the hash table.
+ *
+ * @return The estimated number of bytes allocated by the hash table.
+ */
+size_t memory_report_estimate_hash_table(size_t entries);
+
+/**
+ * @brief   Creates an empty memory report.
+ * @details The returned value is owned by the caller, and should be freed with
+ *          ::memory_report_free.
+ *
+ * @return The new report, or `NULL` on allocation failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref memory_report_examples).
+ */
+memory_report_t *memory_report_create(void);
+
+/**
+ * @brief  Creates a deep copy of a memory report.
+ * @param  report Memory report to be cloned.
+ * @return The new report, or `NULL` on allocation failure.
+ */
+memory_report_t *memory_report_clone(const memory_report_t *report);
+
+/**
+ * @brief Adds an entry to a memory report.
+ *
+ * @param report Report to be modified.
+ * @param name   Name of the data structure whose counters are in @p usage. Is copied.
+ * @param usage  Memory accounting counters of the data structure.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref memory_report_examples).
+ */
+int memory_report_add(memory_report_t *report, const char *name, const memory_usage_t *usage);
+
+/**
+ * @brief   Adds an entry for a single allocation to a memory report.
+ * @details Helper for data structures without counters of their own (e.g.: arrays).
+ *
+ * @param report         Report to be modified.
+ * @param name           Name of the data structure. Is copied.
+ * @param reserved_bytes Number of bytes allocated for the data structure.
+ * @param used_bytes     Number of bytes taken by data in the data structure.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int memory_report_add_allocation(memory_report_t *report,
+                                 const char      *name,
+                                 size_t           reserved_bytes,
+                                 size_t           used_bytes);
+
+/**
+ * @brief   Adds the memory used by `GArray`s to an entry of a memory report.
+ * @details GLib doesn't expose the capacity of its arrays, so only their lengths are considered.
+ *          Each array counts as a block.
+ *
+ * @param usage  Counters to be modified.
+ * @param n      Number of arrays in @p arrays.
+ * @param arrays `GArray`s to be accounted for.
+ */
+void memory_usage_add_arrays(memory_usage_t *usage, size_t n, GArray *const arrays[n]);
+
+/**
+ * @brief  Gets the number of entries in a memory report.
+ * @param  report Memory report to get the entry count from.
+ * @return The number of entries in @p report.
+ */
+size_t memory_report_get_count(const memory_report_t *report);
+
+/**
+ * @brief Gets the name of an entry in a memory report.
+ *
+ * @param report Memory report to get the entry from.
+ * @param i      Index of the entry, in the order entries were added.
+ *
+ * @return The name of the entry, valid while @p report isn't modified.
+ */
+const char *memory_report_get_name(const memory_report_t *report, size_t i);
+
+/**
+ * @brief Gets the counters of an entry in a memory report.
+ *
+ * @param report Memory report to get the entry from.
+ * @param i      Index of the entry, in the order entries were added.
+ *
+ * @return The counters of the entry, valid while @p report isn't modified.
+ */
+const memory_usage_t *memory_report_get_usage(const memory_report_t *report, size_t i);
+
+/**
+ * @brief Sums the counters of all entries in a memory report.
+ *
+ * @param report Memory report to get the entries from.
+ * @param out    Where to write the sum of all counters to.
+ */
+void memory_report_get_total(const memory_report_t *report, memory_usage_t *out);
+
+/**
+ * @brief Frees memory used by a memory report.
+ * @param report Report to be freed.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref memory_report_examples).
+ */
+void memory_report_free(memory_report_t *report);
+
+#endif
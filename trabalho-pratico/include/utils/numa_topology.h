@@ -0,0 +1,173 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    numa_topology.h
+ * @brief   Placement of threads and memory on the NUMA nodes of the machine.
+ * @details On machines with more than one NUMA node (e.g.: dual-socket servers), memory is faster
+ *          to access from the CPUs of the node it was allocated on. A frozen database is read by
+ *          every worker of the [thread pool](@ref thread_pool.h), so:
+ *
+ *          - workers are pinned to the CPUs of a node each, round-robin (see
+ *            ::numa_topology_pin_thread);
+ *          - large columns that are scanned by all workers are interleaved among all nodes (see
+ *            ::numa_topology_interleave), so that no node's memory bandwidth is a bottleneck;
+ *          - small indexes used for lookups are replicated in every node (see
+ *            ::id_table_replicate and ::string_table_replicate), and each thread reads the replica
+ *            of its node (see ::numa_topology_get_current_node).
+ *
+ *          Threads can also be restricted to a set of CPUs (see ::numa_topology_set_cpus), and
+ *          pinned to a single CPU each (see ::numa_topology_pin_thread_to_cpu), for the program to
+ *          coexist with other services on the same machine.
+ *
+ *          The topology is read from `/sys/devices/system/node`, and placement is done with system
+ *          calls directly (no `libnuma` is needed). All placement is a hint: failures only mean
+ *          slower memory accesses, so they're ignored. On machines with a single node, or when
+ *          ::NUMA_TOPOLOGY_ENVIRONMENT_VARIABLE is `0`, nothing is done.
+ *
+ * @anchor numa_topology_examples
+ * ### Examples
+ *
+ * ```c
+ * // In a worker thread
+ * numa_topology_pin_thread(worker_index % numa_topology_get_node_count());
+ *
+ * // For a read-only table
+ * int *replicas[NUMA_TOPOLOGY_MAX_NODES];
+ * for (size_t i = 0; i < numa_topology_get_node_count(); ++i) {
+ *     replicas[i] = numa_topology_allocate(size, i);
+ *     memcpy(replicas[i], table, size);
+ * }
+ *
+ * const int *local = replicas[numa_topology_get_current_node()];
+ * ```
+ */
+
+#ifndef NUMA_TOPOLOGY_H
+#define NUMA_TOPOLOGY_H
+
+#include <stddef.h>
+
+/**
+ * @brief Name of the environment variable that, when set to `0`, makes the machine be treated as
+ *        having a single NUMA node.
+ */
+#define NUMA_TOPOLOGY_ENVIRONMENT_VARIABLE "LI3_NUMA"
+
+/**
+ * @brief Maximum number of NUMA nodes. Machines with more nodes are treated as having a single
+ *        node.
+ */
+#define NUMA_TOPOLOGY_MAX_NODES 16
+
+/**
+ * @brief   Gets the number of NUMA nodes in the machine.
+ * @details Nodes are numbered from `0`. Machines whose nodes aren't numbered contiguously, or that
+ *          have nodes without CPUs, are treated as having a single node.
+ * @return  The number of nodes, at least `1`.
+ */
+size_t numa_topology_get_node_count(void);
+
+/**
+ * @brief   Gets the NUMA node of the calling thread.
+ * @details Fast for threads pinned with ::numa_topology_pin_thread. Other threads may migrate
+ *          between nodes, so the returned node is only a guess.
+ * @return  A number lower than ::numa_topology_get_node_count.
+ */
+size_t numa_topology_get_current_node(void);
+
+/**
+ * @brief Restricts the calling thread to the CPUs of a NUMA node.
+ * @param node Node to run the calling thread on. Ignored if it's not lower than
+ *             ::numa_topology_get_node_count.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref numa_topology_examples).
+ */
+void numa_topology_pin_thread(size_t node);
+
+/**
+ * @brief   Gets the number of CPUs the process is allowed to run on.
+ * @details The affinity of the process is read once, and updated by ::numa_topology_set_cpus. If it
+ *          can't be read, all online processors are assumed to be allowed.
+ * @return  The number of CPUs, at least `1`.
+ */
+size_t numa_topology_get_cpu_count(void);
+
+/**
+ * @brief   Restricts the process to a set of CPUs.
+ * @details Only the calling thread and the threads it creates afterwards are restricted, so this
+ *          must be called before any other thread is started (e.g.: while parsing the command
+ *          line). Threads later pinned with ::numa_topology_pin_thread only run on the CPUs of
+ *          their node in this set.
+ *
+ * @param list List of CPU numbers and ranges, such as `0-3,8-11`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Invalid or empty @p list, or CPUs the process can't run on.
+ */
+int numa_topology_set_cpus(const char *list);
+
+/**
+ * @brief   Restricts the calling thread to a single CPU.
+ * @details The NUMA node of that CPU is remembered, like in ::numa_topology_pin_thread.
+ * @param   position Position of the CPU in the set of allowed CPUs (see
+ *                   ::numa_topology_get_cpu_count), wrapping around.
+ */
+void numa_topology_pin_thread_to_cpu(size_t position);
+
+/**
+ * @brief   Formats the set of CPUs the process is allowed to run on, such as `0-3,8-11`.
+ * @details The list is truncated if it doesn't fit in @p out.
+ *
+ * @param out  Where to write the null-terminated list to.
+ * @param size Number of bytes in @p out.
+ */
+void numa_topology_format_cpus(char *out, size_t size);
+
+/**
+ * @brief   Spreads the pages of some memory among all NUMA nodes.
+ * @details Pages already in memory are migrated. Only whole pages in the region are affected.
+ *
+ * @param data Beginning of the memory.
+ * @param size Size of the memory, in bytes.
+ */
+void numa_topology_interleave(const void *data, size_t size);
+
+/**
+ * @brief   Allocates memory on a NUMA node.
+ * @details Memory is mapped directly, so this is only worth it for large-ish allocations. If the
+ *          node runs out of memory, other nodes are used.
+ *
+ * @param size Number of bytes to allocate. Can't be `0`.
+ * @param node Node to allocate memory on.
+ *
+ * @return The allocated memory, that must be freed with ::numa_topology_free, or `NULL` on
+ *         allocation failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref numa_topology_examples).
+ */
+void *numa_topology_allocate(size_t size, size_t node);
+
+/**
+ * @brief Frees memory allocated by ::numa_topology_allocate.
+ * @param data Memory to be freed. Can be `NULL`, in which case nothing happens.
+ * @param size Number of bytes given to ::numa_topology_allocate.
+ */
+void numa_topology_free(void *data, size_t size);
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    output_sequencer.h
+ * @brief   Commits outputs produced concurrently, and out of order, in order.
+ * @details Many threads can produce outputs (for example, those of queries) that must be written to
+ *          a single stream in a given order (their sequence numbers, from `0`). Each output is
+ *          submitted, with its sequence number, as soon as it's ready, and it's committed (passed
+ *          to a callback) once all outputs before it have been committed.
+ *
+ *          Outputs waiting for their predecessors are parked in a reorder ring, indexed by sequence
+ *          number. Outputs too far ahead to fit in the ring are kept in a hash table instead, so
+ *          that submitting never blocks on missing outputs (which may only be produced after the
+ *          submitting thread returns). Commits happen outside the sequencer's lock, by whichever
+ *          thread submits the output the next commit was waiting for, while other threads keep
+ *          submitting outputs.
+ *
+ * @anchor output_sequencer_examples
+ * ### Examples
+ *
+ * ```c
+ * int commit(void *user_data, size_t sequence, void *item) {
+ *     printf("%zu: %s\n", sequence, (char *) item);
+ *     free(item);
+ *     return 0;
+ * }
+ *
+ * output_sequencer_t *sequencer = output_sequencer_create(64, commit, NULL);
+ * output_sequencer_submit(sequencer, 1, strdup("world")); // Error handling omitted
+ * output_sequencer_submit(sequencer, 0, strdup("hello")); // Commits both outputs
+ * if (output_sequencer_finish(sequencer))
+ *     fputs("Failed to write some outputs!\n", stderr);
+ * ```
+ */
+
+#ifndef OUTPUT_SEQUENCER_H
+#define OUTPUT_SEQUENCER_H
+
+#include <stddef.h>
+
+/** @brief Outputs being committed in order. */
+typedef struct output_sequencer output_sequencer_t;
+
+/**
+ * @brief   Method called to commit an output.
+ * @details Calls are never concurrent, and they happen in order of sequence number.
+ *
+ * @param user_data Argument passed to ::output_sequencer_create.
+ * @param sequence  Sequence number of the output.
+ * @param item      Output, as passed to ::output_sequencer_submit.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure, reported by ::output_sequencer_finish.
+ */
+typedef int (*output_sequencer_commit_callback_t)(void *user_data, size_t sequence, void *item);
+
+/**
+ * @brief Creates an output sequencer.
+ *
+ * @param capacity  Number of slots in the reorder ring. Outputs submitted more than this many
+ *                  sequence numbers ahead of the next commit are kept in a slower hash table.
+ * @param commit    Method called to commit each output.
+ * @param user_data Argument passed to @p commit.
+ *
+ * @return A pointer to a ::output_sequencer_t that must be deleted with ::output_sequencer_finish,
+ *         or `NULL` on allocation failure.
+ */
+output_sequencer_t *output_sequencer_create(size_t                             capacity,
+                                            output_sequencer_commit_callback_t commit,
+                                            void                              *user_data);
+
+/**
+ * @brief   Submits an output to be committed.
+ * @details Thread-safe. If @p sequence is the next output to be committed, this output and all
+ *          following ones that were already submitted are committed by the calling thread (unless
+ *          another thread is already committing, in which case it commits them instead).
+ *
+ * @param sequencer Sequencer to submit the output to.
+ * @param sequence  Sequence number of the output. Must be unique.
+ * @param item      Output. Can't be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or @p sequence was already submitted. @p item isn't committed.
+ */
+int output_sequencer_submit(output_sequencer_t *sequencer, size_t sequence, void *item);
+
+/**
+ * @brief   Commits all outputs left in a sequencer, and frees it.
+ * @details Outputs after missing sequence numbers (never submitted) are committed now, in order,
+ *          as if the missing ones were empty. Must not be called concurrently with
+ *          ::output_sequencer_submit.
+ *
+ * @param sequencer Value returned by ::output_sequencer_create. Always freed.
+ *
+ * @retval 0 Success.
+ * @retval 1 A commit failed.
+ */
+int output_sequencer_finish(output_sequencer_t *sequencer);
+
+#endif
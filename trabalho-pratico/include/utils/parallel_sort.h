@@ -0,0 +1,88 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    parallel_sort.h
+ * @brief   Stable sorting of large arrays, in parallel, with `qsort`'s comparison functions.
+ * @details The array is split into one run per thread, each sorted sequentially (insertion sort of
+ *          short runs, then bottom-up merge sort), and runs are then merged in pairs, also in
+ *          parallel, until a single one remains. Arrays with fewer than
+ *          ::PARALLEL_SORT_MIN_ITEMS_PER_THREAD items per thread are sorted in the calling thread.
+ *          Unlike `qsort`, the sort is stable, so results don't depend on the number of threads.
+ *
+ * @anchor parallel_sort_examples
+ * ### Examples
+ *
+ * ```c
+ * int compare_ints(const void *a, const void *b) {
+ *     const int x = *(const int *) a, y = *(const int *) b;
+ *     return (x > y) - (x < y);
+ * }
+ *
+ * int sort_ints(int *numbers, size_t n) {
+ *     return parallel_sort(numbers, n, sizeof(int), compare_ints, thread_pool_get_shared());
+ * }
+ * ```
+ */
+
+#ifndef PARALLEL_SORT_H
+#define PARALLEL_SORT_H
+
+#include <stddef.h>
+
+#include "utils/thread_pool.h"
+
+/**
+ * @brief Minimum number of items each thread must sort for ::parallel_sort to use more than one
+ *        thread.
+ */
+#define PARALLEL_SORT_MIN_ITEMS_PER_THREAD 16384
+
+/**
+ * @brief   Comparison function, with the same semantics as `qsort`'s.
+ *
+ * @param a Pointer to the first item.
+ * @param b Pointer to the second item.
+ *
+ * @return A negative value if @p a comes before @p b, a positive value if @p a comes after @p b,
+ *         and `0` if they're equivalent (their order is then kept).
+ */
+typedef int (*parallel_sort_compare_callback_t)(const void *a, const void *b);
+
+/**
+ * @brief   Sorts an array, stably, in parallel if it is large enough.
+ * @details Needs a temporary buffer as large as @p base.
+ *
+ * @param base    Array to be sorted.
+ * @param n       Number of items in @p base.
+ * @param size    Size of each item in @p base, in bytes.
+ * @param compare Comparison function.
+ * @param pool    Thread pool to sort in. `NULL` to sort in the calling thread.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p base is left unmodified).
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref parallel_sort_examples).
+ */
+int parallel_sort(void                            *base,
+                  size_t                           n,
+                  size_t                           size,
+                  parallel_sort_compare_callback_t compare,
+                  thread_pool_t                   *pool);
+
+#endif
@@ -20,6 +20,8 @@
 #include <inttypes.h>
 #include <stddef.h>
 
+#include "utils/memory_report.h"
+
 /**
  * @file    pool.h
  * @brief   A pool allocator for structures of the same size.
@@ -90,11 +92,42 @@
  * // In main.c
  * pool_iter(pool, callback, NULL);
  * ```
+ *
+ * Pools aren't thread-safe. To allocate items from many threads, each thread should have its own
+ * ::pool_cache_t, which allocates items from its own block, and only locks the pool to get a new
+ * block:
+ *
+ * ```c
+ * void *thread(void *pool) {
+ *     pool_cache_t *cache = pool_cache_create(pool);
+ *     for (int i = 0; i < TEST_NUM_ITEMS; ++i)
+ *         pool_cache_put_item(int, cache, &i);
+ *     pool_cache_free(cache);
+ *     return NULL;
+ * }
+ * ```
  */
 
 /** @brief A pool allocator for structures of the same size. */
 typedef struct pool pool_t;
 
+/** @brief A per-thread allocation front-end of a ::pool_t. */
+typedef struct pool_cache pool_cache_t;
+
+/** @brief Kind of memory pages that back the blocks of a ::pool_t. */
+typedef enum {
+    POOL_PAGES_NORMAL, /**< @brief Blocks are allocated with `malloc`. */
+
+    /**
+     * @brief   Blocks are mapped in 2 MiB huge pages, to reduce TLB misses when scanning pools.
+     * @details Explicit huge pages (`MAP_HUGETLB`) are tried first. When those aren't available,
+     *          blocks are 2 MiB-aligned and marked as eligible for transparent huge pages
+     *          (`MADV_HUGEPAGE`), which the kernel is free to ignore. Block capacities are rounded
+     *          up so that no part of a huge page is wasted.
+     */
+    POOL_PAGES_HUGE
+} pool_pages_t;
+
 /**
  * @brief   Callback type for pool iterations.
  * @details Method called by ::pool_iter for every item in a ::pool_t.
@@ -123,6 +156,39 @@ typedef int (*pool_iter_callback_t)(void *user_data, const void *item);
  */
 pool_t *pool_create_from_size(size_t item_size, size_t block_capacity);
 
+/**
+ * @brief   Creates a pool from the size of its elements, choosing what memory pages back it.
+ * @details Like ::pool_create_from_size, which is the same as calling this method with
+ *          ::POOL_PAGES_NORMAL. ::POOL_PAGES_HUGE only pays off for large pools that are scanned
+ *          often, as blocks are at least 2 MiB long. If huge pages were disabled with
+ *          ::pool_set_huge_pages_enabled, @p pages is ignored.
+ *
+ * @param item_size      The size (in bytes) of the type of item to be allocated in this pool.
+ * @param block_capacity The size (in items) of each block of the pool.
+ * @param pages          Kind of memory pages that back the blocks of the pool.
+ *
+ * @return The newly created pool, or `NULL` on allocation failure.
+ */
+pool_t *
+    pool_create_from_size_and_pages(size_t item_size, size_t block_capacity, pool_pages_t pages);
+
+/**
+ * @brief   Allows or forbids pools from being backed by huge pages.
+ * @details Only affects pools created after this call. Meant for comparing the performance of both
+ *          kinds of pages, and must be called before other threads start creating pools. Huge pages
+ *          are enabled by default.
+ *
+ * @param enabled Whether ::POOL_PAGES_HUGE is respected (otherwise, it's the same as
+ *                ::POOL_PAGES_NORMAL).
+ */
+void pool_set_huge_pages_enabled(int enabled);
+
+/**
+ * @brief  Checks whether pools can be backed by huge pages (see ::pool_set_huge_pages_enabled).
+ * @return Whether ::POOL_PAGES_HUGE is respected.
+ */
+int pool_get_huge_pages_enabled(void);
+
 /**
  * @brief   Creates a pool.
  * @details The returned value is owned by the caller, and should be freed with ::pool_free.
@@ -138,6 +204,19 @@ pool_t *pool_create_from_size(size_t item_size, size_t block_capacity);
  */
 #define pool_create(type, block_capacity) pool_create_from_size(sizeof(type), block_capacity)
 
+/**
+ * @brief   Creates a pool, choosing what memory pages back it.
+ * @details See ::pool_create_from_size_and_pages.
+ *
+ * @param type           The type of the item in the pool (for example, `int`).
+ * @param block_capacity A `size_t` with the number of items in each pool block.
+ * @param pages          A ::pool_pages_t with the kind of memory pages that back the pool.
+ *
+ * @return A pointer to a ::pool_t, or `NULL` on failure.
+ */
+#define pool_create_with_pages(type, block_capacity, pages)                                        \
+    pool_create_from_size_and_pages(sizeof(type), block_capacity, pages)
+
 /**
  * @brief   Allocates space for an item in a pool. **Use ::pool_alloc_item instead.**
  * @details That item does not need to be `free`'d, as that's done when @p pool itself is freed in
@@ -294,6 +373,149 @@ void *__pool_put_items(pool_t *pool, const void *items_location, size_t n);
  */
 int pool_iter(const pool_t *pool, pool_iter_callback_t callback, void *user_data);
 
+/**
+ * @brief   Prepares an empty pool for a number of items to be allocated in it.
+ * @details The first block of @p pool is replaced by a block that fits @p count items, so that they
+ *          all end up in the same block. Blocks allocated after it keep their usual capacity, so
+ *          underestimating @p count costs no more than a normal block. Nothing is done if @p pool
+ *          isn't empty, or if its blocks already fit @p count items.
+ *
+ * @param pool  Pool to be prepared.
+ * @param count Number of items expected to be allocated in @p pool.
+ *
+ * @retval 0 Success (or nothing done).
+ * @retval 1 Allocation failure (@p pool is left unchanged).
+ */
+int pool_reserve(pool_t *pool, size_t count);
+
+/**
+ * @brief   Gives the memory after the last item of every block of a pool back to the system.
+ * @details Meant for pools that are done growing, whose top block (and blocks left partially
+ *          filled by ::pool_cache_t) would otherwise keep unused memory forever. Items are never
+ *          moved. Memory is released in whole pages, so a few items' worth of space may remain
+ *          in each block. Items allocated afterwards go to a new block. Must not be called while
+ *          any ::pool_cache_t of @p pool exists.
+ *
+ * @param pool Pool to be trimmed.
+ */
+void pool_trim(pool_t *pool);
+
+/**
+ * @brief   Creates a cache, to allocate items in a pool from a thread.
+ * @details Each thread must have its own cache, and items can only be allocated in the pool through
+ *          caches while any of them exists. Items are allocated from a block owned by the cache
+ *          without any synchronization, and the pool is only locked to get a new block. Blocks are
+ *          added below the pool's top block, and partially filled blocks are kept track of, so
+ *          ::pool_iter still visits all items once every cache is freed.
+ *
+ * @param pool Pool to allocate items in.
+ *
+ * @return A new ::pool_cache_t, that must be freed with ::pool_cache_free, or `NULL` on allocation
+ *         failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref pool_examples).
+ */
+pool_cache_t *pool_cache_create(pool_t *pool);
+
+/**
+ * @brief   Allocates space for @p n contiguous items in a pool, through a cache. **Use
+ *          ::pool_cache_alloc_item or ::pool_cache_alloc_items instead.**
+ * @details Like ::__pool_alloc_items, including the fact that **pool iterations won't work** if
+ *          @p n isn't `1`.
+ *
+ * @param cache Cache of the pool in which the items will be allocated.
+ * @param n     Number of items to be allocated.
+ *
+ * @return The pointer to the array of allocated items, `NULL` on failure.
+ */
+void *__pool_cache_alloc_items(pool_cache_t *cache, size_t n);
+
+/**
+ * @brief   Adds an array of items to a pool through a cache, by allocating space for it and copying
+ *          it there. **Use ::pool_cache_put_item or ::pool_cache_put_items instead.**
+ * @details Like ::__pool_put_items, including the fact that **pool iterations won't work** if
+ *          @p n isn't `1`.
+ *
+ * @param cache          Cache of the pool to add the items to.
+ * @param items_location Location of the items to be allocated and copied.
+ * @param n              Number of items in @p items_location.
+ *
+ * @return The pointer to the allocated and copied items, `NULL` on failure.
+ */
+void *__pool_cache_put_items(pool_cache_t *cache, const void *items_location, size_t n);
+
+/**
+ * @brief  Allocates space for an item in a pool, through a cache (see ::pool_alloc_item).
+ * @param  type  Type of the items in the pool.
+ * @param  cache A `pool_cache_t *` of the pool to allocate the item in.
+ * @return The pointer to the allocated item, `NULL` on failure.
+ */
+#define pool_cache_alloc_item(type, cache) ((type *) __pool_cache_alloc_items(cache, 1))
+
+/**
+ * @brief  Allocates space for @p n contiguous items in a pool, through a cache (see
+ *         ::pool_alloc_items).
+ *
+ * @param  type  Type of the items in the pool.
+ * @param  cache A `pool_cache_t *` of the pool to allocate the items in.
+ * @param  n     Number of items to be allocated.
+ *
+ * @return The pointer to the array of allocated items, `NULL` on failure.
+ */
+#define pool_cache_alloc_items(type, cache, n) ((type *) __pool_cache_alloc_items(cache, n))
+
+/**
+ * @brief Adds an item to a pool through a cache, by allocating space for it and copying it there
+ *        (see ::pool_put_item).
+ *
+ * @param type          Type of the items in the pool.
+ * @param cache         A `pool_cache_t *` of the pool to add the item to.
+ * @param item_location Pointer to the item to be allocated and copied.
+ *
+ * @return The pointer to the allocated and copied item, `NULL` on failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref pool_examples).
+ */
+#define pool_cache_put_item(type, cache, item_location)                                            \
+    ((type *) __pool_cache_put_items(cache, item_location, 1))
+
+/**
+ * @brief Adds an array of items to a pool through a cache, by allocating space for it and copying
+ *        it there (see ::pool_put_items).
+ *
+ * @param type           Type of the items in the pool.
+ * @param cache          A `pool_cache_t *` of the pool to add the items to.
+ * @param items_location Location of the items to be allocated and copied.
+ * @param n              Number of items in @p items_location.
+ *
+ * @return The pointer to the allocated and copied items, `NULL` on failure.
+ */
+#define pool_cache_put_items(type, cache, items_location, n)                                       \
+    ((type *) __pool_cache_put_items(cache, items_location, n))
+
+/**
+ * @brief   Frees a cache of a pool, giving the rest of its block back to the pool.
+ * @details Items allocated through @p cache stay valid until the pool is freed. The space left in
+ *          the cache's block is never used again.
+ *
+ * @param cache Cache to be freed.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref pool_examples).
+ */
+void pool_cache_free(pool_cache_t *cache);
+
+/**
+ * @brief   Gets the memory accounting counters of a pool.
+ * @details Counters are kept up to date as items are allocated, so this is cheap to call.
+ *
+ * @param pool Pool to get the counters from.
+ * @param out  Where to write the counters to.
+ */
+void pool_get_memory_usage(const pool_t *pool, memory_usage_t *out);
+
 /**
  * @brief   Removes all elements from @p pool.
  * @details Keep in mind that all values allocated using @p pool will no longer be valid (this will
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    prefix_trie.h
+ * @brief   Path-compressed trie over a sorted array of strings, for finding all strings with a
+ *          prefix.
+ * @details The trie doesn't store any strings. It's built over an array of keys sorted byte by
+ *          byte (`strcmp`), where all keys starting with a prefix are contiguous, and each node
+ *          stores the range of keys in its subtree. Finding that range for a prefix takes time
+ *          proportional to the length of the prefix, and not to the number of keys. Keys are
+ *          accessed through a callback, so that the array they're in can be of any type.
+ *
+ *          Chains of nodes with a single child are merged into one node (path compression), so
+ *          there are fewer nodes than twice the number of keys. Nodes don't contain pointers, so a
+ *          trie can be stored in a file (::prefix_trie_get_data) and restored
+ *          (::prefix_trie_create_from_data) as long as the same keys are used.
+ *
+ * @anchor prefix_trie_example
+ * ### Example
+ *
+ * ```c
+ * const char *key_callback(void *user_data, size_t i) {
+ *     return ((const char *const *) user_data)[i];
+ * }
+ *
+ * int main(void) {
+ *     const char *keys[] = {"Ana", "Anabela", "André", "Bruno", "Bruno"};
+ *
+ *     prefix_trie_t *trie = prefix_trie_create(5, key_callback, keys);
+ *     if (!trie)
+ *         return 1;
+ *
+ *     size_t first, count;
+ *     prefix_trie_find(trie, "An", key_callback, keys, &first, &count); // 0, 3
+ *     prefix_trie_find(trie, "Bruno", key_callback, keys, &first, &count); // 3, 2
+ *     prefix_trie_find(trie, "Carla", key_callback, keys, &first, &count); // ?, 0
+ *
+ *     prefix_trie_free(trie);
+ *     return 0;
+ * }
+ * ```
+ */
+
+#ifndef PREFIX_TRIE_H
+#define PREFIX_TRIE_H
+
+#include <stddef.h>
+
+/** @brief Path-compressed trie over a sorted array of strings. */
+typedef struct prefix_trie prefix_trie_t;
+
+/**
+ * @brief   Callback for getting a key of a ::prefix_trie_t.
+ * @details Must always return the same string for the same @p i.
+ *
+ * @param user_data Argument passed to ::prefix_trie_create or ::prefix_trie_find.
+ * @param i         Index of the key in the sorted array.
+ *
+ * @return The key with index @p i.
+ */
+typedef const char *(*prefix_trie_key_callback_t)(void *user_data, size_t i);
+
+/**
+ * @brief   Builds a trie over a sorted array of strings.
+ * @details The returned value is owned by the caller, and should be freed with ::prefix_trie_free.
+ *
+ * @param n         Number of keys.
+ * @param key       Callback for getting each key. Keys must be sorted with `strcmp`.
+ * @param user_data Argument passed to @p key.
+ *
+ * @return A new trie, or `NULL` on allocation failure (or if @p n doesn't fit in 32 bits).
+ *
+ * #### Example
+ * See [the header file's documentation](@ref prefix_trie_example).
+ */
+prefix_trie_t *prefix_trie_create(size_t n, prefix_trie_key_callback_t key, void *user_data);
+
+/**
+ * @brief   Restores a trie from data returned by ::prefix_trie_get_data.
+ * @details The data is copied and validated against the keys, so that lookups never read out of
+ *          bounds, but the keys must be the same as when the trie was built for lookups to be
+ *          correct.
+ *
+ * @param data      Data of a trie (doesn't need to be aligned).
+ * @param length    Number of bytes in @p data.
+ * @param n         Number of keys.
+ * @param key       Callback for getting each key.
+ * @param user_data Argument passed to @p key.
+ *
+ * @return A new trie, that should be freed with ::prefix_trie_free, or `NULL` on allocation
+ *         failure or invalid data.
+ */
+prefix_trie_t *prefix_trie_create_from_data(const void                *data,
+                                            size_t                     length,
+                                            size_t                     n,
+                                            prefix_trie_key_callback_t key,
+                                            void                      *user_data);
+
+/**
+ * @brief Finds the range of keys in a trie that start with a prefix.
+ *
+ * @param trie      Trie where to perform the lookup.
+ * @param prefix    Byte-wise prefix of the keys to be found.
+ * @param key       Callback for getting each key, equivalent to the one @p trie was built with.
+ * @param user_data Argument passed to @p key.
+ * @param first     Where to write the index of the first key starting with @p prefix to.
+ * @param count     Where to write the number of keys starting with @p prefix to.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref prefix_trie_example).
+ */
+void prefix_trie_find(const prefix_trie_t       *trie,
+                      const char                *prefix,
+                      prefix_trie_key_callback_t key,
+                      void                      *user_data,
+                      size_t                    *first,
+                      size_t                    *count);
+
+/**
+ * @brief Gets the data of a trie, for it to be stored and restored with
+ *        ::prefix_trie_create_from_data.
+ *
+ * @param trie   Trie to get the data from.
+ * @param length Where to write the number of bytes of data to.
+ *
+ * @return The data of @p trie, valid while @p trie isn't freed.
+ */
+const void *prefix_trie_get_data(const prefix_trie_t *trie, size_t *length);
+
+/**
+ * @brief  Gets the number of bytes allocated for a trie.
+ * @param  trie Trie to get the size of.
+ * @return The number of bytes allocated for @p trie and its nodes.
+ */
+size_t prefix_trie_get_size(const prefix_trie_t *trie);
+
+/**
+ * @brief Frees memory used by a trie.
+ * @param trie Trie to be freed.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref prefix_trie_example).
+ */
+void prefix_trie_free(prefix_trie_t *trie);
+
+#endif
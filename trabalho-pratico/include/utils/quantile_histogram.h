@@ -0,0 +1,130 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    quantile_histogram.h
+ * @brief   Bounded log-bucketed histogram, for approximate order statistics (e.g.: medians).
+ * @details Like ::performance_histogram_t, values are grouped in buckets whose width grows with
+ *          their magnitude, so that every value is known with the same relative precision.
+ *          However, buckets are only allocated up to the largest value recorded, and values are
+ *          estimated as the middle of their bucket, for the error to be at most
+ *          ::QUANTILE_HISTOGRAM_RELATIVE_ERROR in either direction. Memory depends on the
+ *          magnitude of the values, not on how many of them are recorded.
+ *
+ * @anchor quantile_histogram_example
+ * ### Example
+ *
+ * ```c
+ * quantile_histogram_t *histogram = quantile_histogram_create();
+ * if (!histogram)
+ *     return 1;
+ *
+ * for (uint64_t i = 1; i <= 100001; ++i)
+ *     if (quantile_histogram_record(histogram, i))
+ *         break;
+ *
+ * const size_t middle = quantile_histogram_get_count(histogram) / 2;
+ * printf("%" PRIu64 "\n", quantile_histogram_get_rank(histogram, middle)); // 50000 +- 0.8 %
+ *
+ * quantile_histogram_free(histogram);
+ * return 0;
+ * ```
+ */
+
+#ifndef QUANTILE_HISTOGRAM_H
+#define QUANTILE_HISTOGRAM_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * @brief Number of significant bits kept for each value in a ::quantile_histogram_t. Values below
+ *        `2 ^ QUANTILE_HISTOGRAM_SUB_BUCKET_BITS` are recorded exactly.
+ */
+#define QUANTILE_HISTOGRAM_SUB_BUCKET_BITS 7
+
+/** @brief Largest error of ::quantile_histogram_get_rank, relative to the exact value. */
+#define QUANTILE_HISTOGRAM_RELATIVE_ERROR (1.0 / (1 << QUANTILE_HISTOGRAM_SUB_BUCKET_BITS))
+
+/** @brief Bounded log-bucketed histogram. */
+typedef struct quantile_histogram quantile_histogram_t;
+
+/**
+ * @brief   Creates an empty histogram.
+ * @details The returned value is owned by the caller, and should be freed with
+ *          ::quantile_histogram_free.
+ *
+ * @return A new histogram, or `NULL` on allocation failure.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref quantile_histogram_example).
+ */
+quantile_histogram_t *quantile_histogram_create(void);
+
+/**
+ * @brief Adds a value to a histogram.
+ *
+ * @param histogram Histogram to be modified.
+ * @param value     Value to be added.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p histogram is left unchanged).
+ *
+ * #### Example
+ * See [the header file's documentation](@ref quantile_histogram_example).
+ */
+int quantile_histogram_record(quantile_histogram_t *histogram, uint64_t value);
+
+/**
+ * @brief  Gets the number of values in a histogram.
+ * @param  histogram Histogram to get the number of values from.
+ * @return The number of successful calls to ::quantile_histogram_record for @p histogram.
+ */
+size_t quantile_histogram_get_count(const quantile_histogram_t *histogram);
+
+/**
+ * @brief   Estimates a value in a histogram from its position in sorted order.
+ * @details The estimate is the middle of the bucket containing the value, clamped to the smallest
+ *          and largest values recorded.
+ *
+ * @param histogram Histogram to get the value from.
+ * @param rank      Position (`0`-based) of the value in sorted order. Must be less than
+ *                  ::quantile_histogram_get_count.
+ *
+ * @return The value, with an error of at most ::QUANTILE_HISTOGRAM_RELATIVE_ERROR.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref quantile_histogram_example).
+ */
+uint64_t quantile_histogram_get_rank(const quantile_histogram_t *histogram, size_t rank);
+
+/**
+ * @brief  Gets the number of bytes allocated for a histogram.
+ * @param  histogram Histogram to get the size of.
+ * @return The number of bytes allocated for @p histogram and its buckets.
+ */
+size_t quantile_histogram_get_size(const quantile_histogram_t *histogram);
+
+/**
+ * @brief Frees memory used by a histogram.
+ * @param histogram Histogram to be freed.
+ *
+ * #### Example
+ * See [the header file's documentation](@ref quantile_histogram_example).
+ */
+void quantile_histogram_free(quantile_histogram_t *histogram);
+
+#endif
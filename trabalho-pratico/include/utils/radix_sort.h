@@ -0,0 +1,103 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    radix_sort.h
+ * @brief   Stable sorting of items by integer keys, without comparison callbacks.
+ * @details Many indexes are sorted by a date (::date_t or ::date_and_time_t, both plain integers)
+ *          and then by an identifier. Sorting them with `qsort` calls a comparison function through
+ *          a pointer `O(n log n)` times. Instead, a least-significant-digit radix sort goes over
+ *          the items once per byte of the keys, skipping bytes that are the same in every item
+ *          (e.g.: the upper bytes of dates). Short arrays are sorted with insertion sort.
+ *
+ * @anchor radix_sort_examples
+ * ### Examples
+ *
+ * The following example sorts reservations from the newest one, breaking ties by identifier.
+ *
+ * ```c
+ * int sort_reservations(const reservation_t **reservations, size_t n) {
+ *     radix_sort_entry_t *entries = malloc(n * sizeof(radix_sort_entry_t));
+ *     if (!entries)
+ *         return 1;
+ *
+ *     for (size_t i = 0; i < n; ++i)
+ *         entries[i] = (radix_sort_entry_t) {
+ *             .key      = radix_sort_descending(reservation_get_begin_date(reservations[i])),
+ *             .tiebreak = reservation_get_id(reservations[i]),
+ *             .value    = reservations[i]};
+ *
+ *     if (radix_sort(entries, n)) {
+ *         free(entries);
+ *         return 1;
+ *     }
+ *
+ *     for (size_t i = 0; i < n; ++i)
+ *         reservations[i] = entries[i].value;
+ *
+ *     free(entries);
+ *     return 0;
+ * }
+ * ```
+ */
+
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @struct radix_sort_entry_t
+ * @brief  An item to be sorted by ::radix_sort.
+ *
+ * @var radix_sort_entry_t::key
+ *     @brief Primary sorting key (ascending). See ::radix_sort_descending for descending orders.
+ * @var radix_sort_entry_t::tiebreak
+ *     @brief Secondary sorting key (ascending), for items with the same
+ *            ::radix_sort_entry_t::key.
+ * @var radix_sort_entry_t::value
+ *     @brief Data associated with the item, that isn't looked at while sorting.
+ */
+typedef struct {
+    uint64_t    key;
+    uint32_t    tiebreak;
+    const void *value;
+} radix_sort_entry_t;
+
+/**
+ * @brief Converts a key so that ::radix_sort sorts it in descending order.
+ * @param key Key to be sorted in descending order.
+ */
+#define radix_sort_descending(key) (UINT64_MAX - (uint64_t) (key))
+
+/**
+ * @brief   Sorts items by ::radix_sort_entry_t::key and then by ::radix_sort_entry_t::tiebreak.
+ * @details The sort is stable. Needs a temporary buffer as large as @p entries, unless @p length
+ *          is small.
+ *
+ * @param entries Items to be sorted.
+ * @param length  Number of items in @p entries.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p entries is left unmodified).
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref radix_sort_examples).
+ */
+int radix_sort(radix_sort_entry_t *entries, size_t length);
+
+#endif
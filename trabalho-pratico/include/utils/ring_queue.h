@@ -0,0 +1,174 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    ring_queue.h
+ * @brief   Bounded lock-free queues of pointers, for handing work between pipeline stages.
+ * @details A ring queue is an array of a power of two slots, written by producers at its tail and
+ *          read by consumers at its head. Pushing and popping never take a lock:
+ *
+ *          - In ::RING_QUEUE_SPSC mode (one producer and one consumer thread), each side only
+ *            writes its own index, and keeps a cached copy of the other side's, so that it only
+ *            reads the other side's cache line when the queue seems full (or empty).
+ *          - In ::RING_QUEUE_MPMC mode (any number of producers and consumers), each slot has a
+ *            sequence number, and threads claim slots with a compare-and-swap on the tail or head
+ *            index (Dmitry Vyukov's bounded queue).
+ *
+ *          The producer and consumer indices live in different cache lines, so that producers and
+ *          consumers don't invalidate each other's caches on every operation. Items can be pushed
+ *          and popped in batches, that only publish their indices (and wake waiting threads) once.
+ *
+ *          Threads with nothing to do can wait with ::ring_queue_push_wait and
+ *          ::ring_queue_pop_wait, that spin for a while and then sleep on a futex. Threads on the
+ *          other side only make a system call to wake them up when someone is actually sleeping.
+ *          Once a queue is closed (::ring_queue_close), waiting consumers drain it and then stop.
+ *
+ * @anchor ring_queue_examples
+ * ### Examples
+ *
+ * ```c
+ * void *producer(void *queue_data) {
+ *     ring_queue_t *queue = queue_data;
+ *     for (size_t i = 1; i <= 1000; ++i) {
+ *         void *item = (void *) i;
+ *         ring_queue_push_wait(queue, &item, 1);
+ *     }
+ *     ring_queue_close(queue);
+ *     return NULL;
+ * }
+ *
+ * int main(void) {
+ *     ring_queue_t *queue = ring_queue_create(256, RING_QUEUE_SPSC); // Error handling omitted
+ *     pthread_t     thread;
+ *     pthread_create(&thread, NULL, producer, queue);
+ *
+ *     void  *items[32];
+ *     size_t n, sum = 0;
+ *     while ((n = ring_queue_pop_wait(queue, items, 32)))
+ *         for (size_t i = 0; i < n; ++i)
+ *             sum += (size_t) items[i];
+ *     printf("%zu\n", sum); // 500500
+ *
+ *     pthread_join(thread, NULL);
+ *     ring_queue_free(queue);
+ *     return 0;
+ * }
+ * ```
+ */
+
+#ifndef RING_QUEUE_H
+#define RING_QUEUE_H
+
+#include <stddef.h>
+
+/** @brief Which threads may use a ::ring_queue_t. */
+typedef enum {
+    RING_QUEUE_SPSC, /**< @brief One producer thread and one consumer thread. */
+    RING_QUEUE_MPMC  /**< @brief Any number of producer and consumer threads. */
+} ring_queue_mode_t;
+
+/** @brief A bounded lock-free queue of pointers. */
+typedef struct ring_queue ring_queue_t;
+
+/**
+ * @brief Creates an empty ring queue.
+ *
+ * @param capacity Minimum number of items that fit in the queue (rounded up to a power of two).
+ * @param mode     Which threads may use the queue.
+ *
+ * @return A new queue, that must be freed with ::ring_queue_free, or `NULL` on failure.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref ring_queue_examples).
+ */
+ring_queue_t *ring_queue_create(size_t capacity, ring_queue_mode_t mode);
+
+/**
+ * @brief  Gets the number of items that fit in a ring queue.
+ * @param  queue Queue to get the capacity of.
+ * @return The capacity of @p queue (a power of two).
+ */
+size_t ring_queue_get_capacity(const ring_queue_t *queue);
+
+/**
+ * @brief   Pushes items to a ring queue, without waiting for space.
+ * @details Items are pushed in order, until the queue is full.
+ *
+ * @param queue Queue to push items to.
+ * @param items Items to be pushed.
+ * @param n     Number of items in @p items.
+ *
+ * @return The number of items pushed (the first ones in @p items).
+ */
+size_t ring_queue_push(ring_queue_t *queue, void *const *items, size_t n);
+
+/**
+ * @brief Pops items from a ring queue, without waiting for any.
+ *
+ * @param queue Queue to pop items from.
+ * @param items Where to write the popped items to, from the oldest one.
+ * @param n     Maximum number of items to pop.
+ *
+ * @return The number of items popped.
+ */
+size_t ring_queue_pop(ring_queue_t *queue, void **items, size_t n);
+
+/**
+ * @brief Pushes items to a ring queue, waiting for space when it's full.
+ *
+ * @param queue Queue to push items to.
+ * @param items Items to be pushed.
+ * @param n     Number of items in @p items.
+ *
+ * @retval 0 Success.
+ * @retval 1 The queue was closed before every item could be pushed.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref ring_queue_examples).
+ */
+int ring_queue_push_wait(ring_queue_t *queue, void *const *items, size_t n);
+
+/**
+ * @brief Pops items from a ring queue, waiting for at least one.
+ *
+ * @param queue Queue to pop items from.
+ * @param items Where to write the popped items to, from the oldest one.
+ * @param n     Maximum number of items to pop (at least `1`).
+ *
+ * @return The number of items popped, or `0` if the queue is closed and empty.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref ring_queue_examples).
+ */
+size_t ring_queue_pop_wait(ring_queue_t *queue, void **items, size_t n);
+
+/**
+ * @brief   Closes a ring queue, waking up every waiting thread.
+ * @details Items already in the queue can still be popped, but ::ring_queue_push_wait stops
+ *          waiting for space, and ::ring_queue_pop_wait returns `0` once the queue is empty.
+ *
+ * @param queue Queue to be closed.
+ */
+void ring_queue_close(ring_queue_t *queue);
+
+/**
+ * @brief Frees a ring queue.
+ * @param queue Queue to be freed, that no thread may still be using. Can be `NULL`.
+ */
+void ring_queue_free(ring_queue_t *queue);
+
+#endif
@@ -14,12 +14,19 @@
  * limitations under the License.
  */
 
+
 /**
  * @file    single_pool_id_linked_list.h
  * @brief   A linked lists that allows for multiple linked lists to allocate nodes in the same
- *          ::pool_t.
+ *          ::single_pool_id_linked_list_pool_t.
  * @details It's designed to store `uint32_t`s, i.e., flight and reservation IDs.
  *
+ *          All nodes of a pool live in a single growable array, and refer to each other by their
+ *          32-bit index in it, instead of by pointer. This halves the size of each node, and makes
+ *          lists survive the array being moved when it grows. Because of that, a list
+ *          (::single_pool_id_linked_list_t) is just the index of its first node, and can only be
+ *          traversed with access to its pool.
+ *
  * @anchor single_pool_id_linked_list_examples
  * ### Example
  *
@@ -30,31 +37,29 @@
  * #include "utils/single_pool_id_linked_list.h"
  *
  * int main(void) {
- *     // Block size should be higher in practice
- *     pool_t *ll_pool = single_pool_id_linked_list_create_pool(20);
+ *     // Initial capacity should be higher in practice
+ *     single_pool_id_linked_list_pool_t *ll_pool = single_pool_id_linked_list_create_pool(20);
  *     if (!ll_pool) {
  *         fputs("Allocation failure!\n", stderr);
  *         return 1;
  *     }
  *
- *     single_pool_id_linked_list_t *ll = single_pool_id_linked_list_create();
+ *     single_pool_id_linked_list_t ll = single_pool_id_linked_list_create();
  *
  *     for (int i = 10; i >= 1; --i) {
- *         ll = single_pool_id_linked_list_append_beginning(ll_pool, ll, i);
- *         if (!ll) {
+ *         if (single_pool_id_linked_list_append_beginning(ll_pool, &ll, i)) {
  *             fputs("Allocation failure!\n", stderr);
- *             pool_free(ll_pool);
+ *             single_pool_id_linked_list_free_pool(ll_pool);
  *             return 1;
  *         }
  *     }
  *
- *     const single_pool_id_linked_list_t *iter_ll = ll;
- *     while (iter_ll != NULL) {
- *         printf("%" PRIu32 "\n", single_pool_id_linked_list_get_value(iter_ll));
- *         iter_ll = single_pool_id_linked_list_get_next(iter_ll);
+ *     for (single_pool_id_linked_list_t iter = ll; iter;
+ *          iter = single_pool_id_linked_list_get_next(ll_pool, iter)) {
+ *         printf("%" PRIu32 "\n", single_pool_id_linked_list_get_value(ll_pool, iter));
  *     }
  *
- *     pool_free(ll_pool);
+ *     single_pool_id_linked_list_free_pool(ll_pool);
  *     return 0;
  * }
  * ```
@@ -66,91 +71,160 @@
 #include <inttypes.h>
 #include <stddef.h>
 
-#include "utils/pool.h"
+#include "utils/memory_report.h"
 
 /**
  * @brief   A linked lists that allows for multiple linked lists to allocate nodes in the same
- *          ::pool_t.
- * @details It's designed to store `uint32_t`s, i.e., flight and reservation IDs.
+ *          ::single_pool_id_linked_list_pool_t.
+ * @details This is a reference to the first node of the list in its pool. `0` is the empty list,
+ *          so lists can be tested for emptiness like pointers.
  */
-typedef struct single_pool_id_linked_list single_pool_id_linked_list_t;
+typedef uint32_t single_pool_id_linked_list_t;
+
+/** @brief Allocator for the nodes of many ::single_pool_id_linked_list_t. */
+typedef struct single_pool_id_linked_list_pool single_pool_id_linked_list_pool_t;
 
 /**
- * @brief   Creates a new ::single_pool_id_linked_list_t.
+ * @brief   Creates a new (empty) ::single_pool_id_linked_list_t.
  * @details There is no need to `free` it.
  *
  * ### Examples
  * See [the header file's documentation](@ref single_pool_id_linked_list_examples).
  */
-single_pool_id_linked_list_t *single_pool_id_linked_list_create(void);
+single_pool_id_linked_list_t single_pool_id_linked_list_create(void);
 
 /**
- * @brief Creates a deep copy of a linked list.
+ * @brief   Creates a pool for use with ::single_pool_id_linked_list_t.
+ * @details Do not forget to free the result using ::single_pool_id_linked_list_free_pool.
+ *
+ * @param initial_capacity Number of nodes to allocate space for upfront. The pool grows as needed.
  *
- * @param allocator Pool where to allocate the copied nodes. Must have been created using
- *                  ::single_pool_id_linked_list_create_pool.
- * @param list      List to be cloned.
+ * @return A pointer to a ::single_pool_id_linked_list_pool_t on success, or `NULL` on allocation
+ *         failure.
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref single_pool_id_linked_list_examples).
  */
-single_pool_id_linked_list_t *
-    single_pool_id_linked_list_clone(pool_t *allocator, const single_pool_id_linked_list_t *list);
+single_pool_id_linked_list_pool_t *single_pool_id_linked_list_create_pool(size_t initial_capacity);
 
 /**
- * @brief   Creates a pool for use with ::single_pool_id_linked_list_t.
- * @details Do not forget to free the result using ::pool_free.
+ * @brief   Creates a deep copy of a pool.
+ * @details All lists whose nodes are in @p pool are also valid lists in the copy.
  *
- * @param block_capacity Number of nodes in each pool block. See ::pool_create for more information.
+ * @param pool Pool to be cloned.
  *
- * @return A pointer to a ::pool_t on success, or `NULL` on allocation failure.
+ * @return A pointer to a ::single_pool_id_linked_list_pool_t on success, or `NULL` on allocation
+ *         failure.
+ */
+single_pool_id_linked_list_pool_t *
+    single_pool_id_linked_list_clone_pool(const single_pool_id_linked_list_pool_t *pool);
+
+/**
+ * @brief Makes sure a pool can store at least @p count more nodes without growing.
  *
- * ### Examples
- * See [the header file's documentation](@ref single_pool_id_linked_list_examples).
+ * @param pool  Pool to reserve space in.
+ * @param count Number of nodes to reserve space for.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or too many nodes for 32-bit references.
  */
-pool_t *single_pool_id_linked_list_create_pool(size_t block_capacity);
+int single_pool_id_linked_list_reserve(single_pool_id_linked_list_pool_t *pool, size_t count);
 
 /**
  * @brief Appends an element to the beginning of a linked list.
  *
- * @param allocator Where to allocate the new node. Must have been created using
- *                  ::single_pool_id_linked_list_create_pool.
- * @param list      List to add @p value to.
- * @param value     Value to be added to @p list.
+ * @param pool  Where to allocate the new node.
+ * @param list  List to add @p value to. Modified to point to its new beginning.
+ * @param value Value to be added to @p list.
  *
- * @return The new beginning of the linked list (or `NULL` on allocation failure).
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or too many nodes for 32-bit references (@p list is unchanged).
  *
  * ### Examples
  * See [the header file's documentation](@ref single_pool_id_linked_list_examples).
  */
-single_pool_id_linked_list_t *
-    single_pool_id_linked_list_append_beginning(pool_t                       *allocator,
-                                                single_pool_id_linked_list_t *list,
-                                                uint32_t                      value);
+int single_pool_id_linked_list_append_beginning(single_pool_id_linked_list_pool_t *pool,
+                                                single_pool_id_linked_list_t      *list,
+                                                uint32_t                           value);
+
+/**
+ * @brief   Allocates @p count contiguous nodes in a pool, to be filled later with
+ *          ::single_pool_id_linked_list_append_beginning_in_node.
+ * @details This allows lists in the same pool to be filled concurrently: once nodes are allocated,
+ *          different threads can fill different nodes and modify different lists, as the pool
+ *          won't grow nor be otherwise modified.
+ *
+ * @param pool  Pool to allocate the nodes in.
+ * @param count Number of nodes to allocate.
+ * @param first Where to write the reference to the first allocated node to. The others follow it.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or too many nodes for 32-bit references (@p pool is unchanged).
+ */
+int single_pool_id_linked_list_allocate_nodes(single_pool_id_linked_list_pool_t *pool,
+                                              size_t                             count,
+                                              single_pool_id_linked_list_t      *first);
+
+/**
+ * @brief Appends an element to the beginning of a linked list, using an already allocated node.
+ *
+ * @param pool  Pool where @p node was allocated (see ::single_pool_id_linked_list_allocate_nodes).
+ * @param list  List to add @p value to. Modified to point to its new beginning.
+ * @param node  Unused node of @p pool to store @p value in.
+ * @param value Value to be added to @p list.
+ */
+void single_pool_id_linked_list_append_beginning_in_node(single_pool_id_linked_list_pool_t *pool,
+                                                         single_pool_id_linked_list_t      *list,
+                                                         single_pool_id_linked_list_t       node,
+                                                         uint32_t                           value);
 
 /**
  * @brief  Gets the value of the first node in a ::single_pool_id_linked_list_t.
- * @param  list List to get the value of the first node from.
+ * @param  pool Pool where the nodes of @p list are.
+ * @param  list Non-empty list to get the value of the first node from.
  * @return The value of the first node in @p list.
  *
  * ### Examples
  * See [the header file's documentation](@ref single_pool_id_linked_list_examples).
  */
-uint32_t single_pool_id_linked_list_get_value(const single_pool_id_linked_list_t *list);
+uint32_t single_pool_id_linked_list_get_value(const single_pool_id_linked_list_pool_t *pool,
+                                              single_pool_id_linked_list_t             list);
 
 /**
  * @brief  Gets the next node from a ::single_pool_id_linked_list_t.
- * @param  list List to get the next list from.
- * @return The linked list succeding @p list. `NULL` means the end of the list has been found.
+ * @param  pool Pool where the nodes of @p list are.
+ * @param  list Non-empty list to get the next list from.
+ * @return The linked list succeding @p list. `0` means the end of the list has been found.
  *
  * ### Examples
  * See [the header file's documentation](@ref single_pool_id_linked_list_examples).
  */
-const single_pool_id_linked_list_t *
-    single_pool_id_linked_list_get_next(const single_pool_id_linked_list_t *list);
+single_pool_id_linked_list_t
+    single_pool_id_linked_list_get_next(const single_pool_id_linked_list_pool_t *pool,
+                                        single_pool_id_linked_list_t             list);
 
 /**
  * @brief  Calculates the length of a ::single_pool_id_linked_list_t.
+ * @param  pool Pool where the nodes of @p list are.
  * @param  list List to get length from.
  * @return The length of the @p list.
  */
-size_t single_pool_id_linked_list_length(const single_pool_id_linked_list_t *list);
+size_t single_pool_id_linked_list_length(const single_pool_id_linked_list_pool_t *pool,
+                                         single_pool_id_linked_list_t             list);
+
+/**
+ * @brief Gets the memory usage of a ::single_pool_id_linked_list_pool_t.
+ *
+ * @param pool Pool to get the memory usage of.
+ * @param out  Where to write the memory usage to.
+ */
+void single_pool_id_linked_list_get_memory_usage(const single_pool_id_linked_list_pool_t *pool,
+                                                 memory_usage_t                          *out);
+
+/**
+ * @brief Frees a ::single_pool_id_linked_list_pool_t, invalidating all lists in it.
+ * @param pool Pool to be freed.
+ */
+void single_pool_id_linked_list_free_pool(single_pool_id_linked_list_pool_t *pool);
 
 #endif
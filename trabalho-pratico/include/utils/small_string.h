@@ -0,0 +1,151 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    small_string.h
+ * @brief   A string stored in place when short, and in a string pool (or on the heap) otherwise.
+ * @details Strings of up to ::SMALL_STRING_INLINE_CAPACITY characters are kept inside the
+ *          ::small_string_t itself, padded with null bytes. That saves both a pool allocation and
+ *          a pointer dereference on every access, and lets two short strings be compared with two
+ *          8-byte integer comparisons (see ::small_string_equals).
+ *
+ *          Like in entity types (e.g.: ::user_t), small strings don't keep track of what they own:
+ *          a longer string set with a string pool is owned by that pool, while one set without a
+ *          pool is `malloc`-allocated and must be freed with ::small_string_free.
+ *
+ * @anchor small_string_examples
+ * ### Examples
+ *
+ * ```c
+ * #include <stdio.h>
+ * #include "utils/small_string.h"
+ *
+ * int main(void) {
+ *     small_string_t short_string, long_string;
+ *     small_string_init(&short_string);
+ *     small_string_init(&long_string);
+ *
+ *     if (small_string_set(NULL, &short_string, "U12345") ||
+ *         small_string_set(NULL, &long_string, "A string that doesn't fit in place")) {
+ *
+ *         fputs("Allocation failure!\n", stderr);
+ *         small_string_free(&short_string);
+ *         return 1;
+ *     }
+ *
+ *     printf("%s\n%s\n", small_string_get(&short_string), small_string_get(&long_string));
+ *
+ *     small_string_free(&short_string); // Nothing is done (stored in place)
+ *     small_string_free(&long_string);
+ *     return 0;
+ * }
+ * ```
+ */
+
+#ifndef SMALL_STRING_H
+#define SMALL_STRING_H
+
+#include <stdint.h>
+
+#include "utils/string_pool.h"
+
+/** @brief Maximum length of a string that can be stored inside a ::small_string_t. */
+#define SMALL_STRING_INLINE_CAPACITY 15
+
+/**
+ * @union   small_string_t
+ * @brief   A string stored in place when short, and in a string pool (or on the heap) otherwise.
+ * @details Don't access the members of this union directly. Use the methods in this module
+ *          instead.
+ *
+ * @var small_string_t::chars
+ *     @brief   Characters of a string stored in place, padded with null bytes.
+ *     @details The last character is the tag: `0` for a string stored in place, `1` otherwise.
+ * @var small_string_t::words
+ *     @brief Same as ::small_string_t::chars, for comparisons.
+ * @var small_string_t::pointer
+ *     @brief A string stored elsewhere (or `NULL`), when the tag is `1`.
+ */
+typedef union {
+    char     chars[SMALL_STRING_INLINE_CAPACITY + 1];
+    uint64_t words[2];
+    char    *pointer;
+} small_string_t;
+
+/**
+ * @brief   Initializes a ::small_string_t with no string (`NULL`).
+ * @details Nothing is freed, so this can be used on uninitialized memory.
+ *
+ * @param string String to be initialized.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref small_string_examples).
+ */
+void small_string_init(small_string_t *string);
+
+/**
+ * @brief Sets the value of a ::small_string_t.
+ *
+ * @param allocator Pool where to allocate @p value, if it doesn't fit in place. `NULL` can be
+ *                  provided so that `strdup` is used instead of a pool. In that case, a previous
+ *                  value of @p string is freed, so it must not have been set with a pool.
+ * @param string    String to be modified.
+ * @param value     New value of @p string.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p string is left unchanged).
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref small_string_examples).
+ */
+int small_string_set(string_pool_t *allocator, small_string_t *string, const char *value);
+
+/**
+ * @brief  Gets the value of a ::small_string_t.
+ * @param  string String to get the value of.
+ * @return The value of @p string, valid while @p string isn't modified or moved. `NULL` if
+ *         @p string has no value.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref small_string_examples).
+ */
+const char *small_string_get(const small_string_t *string);
+
+/**
+ * @brief   Checks if two ::small_string_t have the same value.
+ * @details If both strings are stored in place, only two integer comparisons are needed.
+ *
+ * @param a First string to compare. Must have a value.
+ * @param b Second string to compare. Must have a value.
+ *
+ * @retval 0 Different strings.
+ * @retval 1 Equal strings.
+ */
+int small_string_equals(const small_string_t *a, const small_string_t *b);
+
+/**
+ * @brief   Frees the value of a ::small_string_t, if it was set without a string pool.
+ * @details @p string is left with no value.
+ *
+ * @param string String whose value is going to be freed.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref small_string_examples).
+ */
+void small_string_free(small_string_t *string);
+
+#endif
@@ -43,6 +43,40 @@
  * - `callback("text file by", NULL)`;
  * - `callback("", NULL)`;
  * - `callback("the newline character", NULL)`.
+ *
+ * Large files (such as the dataset's) should be read with ::stream_tokenize_slices instead, which
+ * avoids `getdelim`'s copies by memory-mapping regular files, and falls back to reading big blocks
+ * with `read` for other types of files (e.g.: pipes). The way the callbacks are called is the same,
+ * except that the length of each token is also provided:
+ *
+ * ```c
+ * FILE *fs = fopen("testfile.txt", "r"); // Error handling omitted
+ * printf("Using mmap: %d\n", stream_tokenize_get_method(fs) == STREAM_TOKENIZE_METHOD_MMAP);
+ * stream_tokenize_slices(fs, '\n', slice_callback, NULL);
+ * fclose(fs);
+ * ```
+ *
+ * - `slice_callback(NULL, "Split this", 10)`;
+ * - `slice_callback(NULL, "text file by", 12)`;
+ * - `slice_callback(NULL, "", 0)`;
+ * - `slice_callback(NULL, "the newline character", 21)`.
+ *
+ * Big files can also be divided in chunks, tokenized in parallel by
+ * ::stream_tokenize_slices_chunked. Each chunk gets its own `user_data`, so that callbacks in
+ * different threads don't modify the same state:
+ *
+ * ```c
+ * void *states[2] = {&first_half, &second_half};
+ * stream_tokenize_slices_chunked(fs, '\n', 2, slice_callback, states);
+ * ```
+ *
+ * Considering a split after `"text file by"`, the following calls would be made (the ones in
+ * different chunks possibly at the same time):
+ *
+ * - `slice_callback(&first_half, "Split this", 10)`;
+ * - `slice_callback(&first_half, "text file by", 12)`;
+ * - `slice_callback(&second_half, "", 0)`;
+ * - `slice_callback(&second_half, "the newline character", 21)`.
  */
 
 #ifndef STREAM_UTILS_H
@@ -53,8 +87,28 @@
 /** @brief Value returned by ::stream_tokenize when allocations from `getdelim` fail. */
 #define STREAM_TOKENIZE_RET_ALLOCATION_FAILURE -1
 
+/** @brief Value returned by ::stream_tokenize_slices when reading from the file fails. */
+#define STREAM_TOKENIZE_RET_IO_FAILURE -2
+
+/** @brief How ::stream_tokenize_slices reads a file. */
+typedef enum {
+    STREAM_TOKENIZE_METHOD_MMAP, /**< @brief The file is memory-mapped (regular files). */
+    STREAM_TOKENIZE_METHOD_READ  /**< @brief The file is read in large blocks (e.g.: pipes). */
+} stream_tokenize_method_t;
+
 #include <stdio.h>
 
+/**
+ * @brief   Tells the kernel that a file will be read sequentially, and that it should start reading
+ *          it ahead.
+ * @details The file is read ahead in the background, so that it can be called on files that will
+ *          only be tokenized later (e.g.: while tokenizing others). Only a hint: nothing is done
+ *          for files that can't be read ahead, such as pipes.
+ *
+ * @param fd File descriptor of the file to be read.
+ */
+void stream_prefetch(int fd);
+
 /**
  * @brief Splits a file into tokens, separated by @p delimiter.
  *
@@ -73,4 +127,91 @@
  */
 int stream_tokenize(FILE *file, char delimiter, tokenize_iter_callback_t callback, void *user_data);
 
+/**
+ * @brief  Determines how ::stream_tokenize_slices will read a file.
+ * @param  file File to be tokenized.
+ * @return ::STREAM_TOKENIZE_METHOD_MMAP for non-empty regular files, ::STREAM_TOKENIZE_METHOD_READ
+ *         otherwise.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref stream_utils_examples).
+ */
+stream_tokenize_method_t stream_tokenize_get_method(FILE *file);
+
+/**
+ * @brief   Splits a file into tokens, separated by @p delimiter, without copying each token.
+ * @details Tokenization starts at the current position of @p file. Regular files are
+ *          memory-mapped (privately, so that delimiters can be replaced by `'\0'` without
+ *          modifying the file), and other files are read in large blocks. If mapping a file fails,
+ *          the latter method is used. Non-seekable files (e.g.: pipes) are read ahead by a
+ *          background thread, so that waiting for data overlaps with calls to @p callback.
+ *
+ *          The underlying file descriptor of @p file is used directly, skipping `stdio`'s buffers.
+ *          When tokenization is stopped by @p callback, the file is left positioned right after
+ *          the last token, as long as it's seekable.
+ *
+ * @param file      File to tokenize.
+ * @param delimiter Character to separate tokens. It won't be part of those tokens.
+ * @param callback  Function called for every token read.
+ * @param user_data Pointer passed to every call of @p callback, so that it can modify the program's
+ *                  state.
+ *
+ * @return `0` on success, otherwise, the return value from @p callback in case it ordered the
+ *         tokenization to stop. ::STREAM_TOKENIZE_RET_ALLOCATION_FAILURE and
+ *         ::STREAM_TOKENIZE_RET_IO_FAILURE may also be returned on allocation and input failures,
+ *         respectively.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref stream_utils_examples).
+ */
+int stream_tokenize_slices(FILE                          *file,
+                           char                           delimiter,
+                           tokenize_slice_iter_callback_t callback,
+                           void                          *user_data);
+
+/**
+ * @brief   Splits a file into tokens, separated by @p delimiter, tokenizing different parts of
+ *          it in parallel.
+ * @details The file (from its current position) is memory-mapped and divided into @p n chunks of
+ *          similar sizes, that always end right after a delimiter. Each chunk is tokenized in its
+ *          own thread, and the tokens in chunk `i` are passed to @p callback along with
+ *          `user_data[i]`. Therefore, all tokens given to the same `user_data[i]` are in file
+ *          order, and all tokens in chunk `i` come before the ones in chunk `i + 1`.
+ *
+ *          @p callback will be called concurrently, so it must only modify state reachable from its
+ *          `user_data`. When the file can't be memory-mapped, or when @p n is `1`, this behaves
+ *          like ::stream_tokenize_slices with `user_data[0]`, and no threads are created. Stopping
+ *          a chunk's tokenization (a non-zero value returned by @p callback) doesn't affect other
+ *          chunks. Unless the file wasn't mapped, it's left positioned at its end.
+ *
+ * @param file      File to tokenize.
+ * @param delimiter Character to separate tokens. It won't be part of those tokens.
+ * @param n         Number of chunks to divide @p file into. Musn't be `0`.
+ * @param callback  Function called for every token read.
+ * @param user_data Pointers passed to calls of @p callback, one for each chunk.
+ *
+ * @return `0` on success, otherwise, the value returned by the first chunk whose tokenization
+ *         failed (see ::stream_tokenize_slices).
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref stream_utils_examples).
+ */
+int stream_tokenize_slices_chunked(FILE                          *file,
+                                   char                           delimiter,
+                                   size_t                         n,
+                                   tokenize_slice_iter_callback_t callback,
+                                   void *const                    user_data[n]);
+
+/**
+ * @brief   Copies the contents of a file to another file.
+ * @details Both files are accessed with raw `read` and `write` calls, without `FILE` buffering.
+ *
+ * @param source      Path to the file to be copied.
+ * @param destination Path to the file to be created (or overwritten).
+ *
+ * @retval 0 Success.
+ * @retval 1 File IO failure.
+ */
+int stream_copy_file(const char *source, const char *destination);
+
 #endif
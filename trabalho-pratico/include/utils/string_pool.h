@@ -19,6 +19,9 @@
 
 #include <inttypes.h>
 
+#include "utils/mapped_file.h"
+#include "utils/pool.h"
+
 /**
  * @file    string_pool.h
  * @brief   An allocator for strings.
@@ -76,6 +79,9 @@
  *
  * Instead of using ::string_pool_put, you could first allocate space for a string with
  * ::string_pool_allocate, and then copy its contents to the returned pointer.
+ *
+ * A pool can also borrow strings from a ::mapped_file_t (see ::string_pool_borrow), returning
+ * strings that are already in that file instead of copying them.
  */
 
 /**
@@ -87,6 +93,9 @@
  */
 typedef struct string_pool string_pool_t;
 
+/** @brief A per-thread allocation front-end of a ::string_pool_t. See ::pool_cache_t. */
+typedef struct string_pool_cache string_pool_cache_t;
+
 /**
  * @brief   Creates a string pool.
  * @details The returned value is owned by the caller, that should be freed with ::string_pool_free.
@@ -101,6 +110,17 @@ typedef struct string_pool string_pool_t;
  */
 string_pool_t *string_pool_create(size_t block_capacity);
 
+/**
+ * @brief   Creates a string pool, choosing what memory pages back it.
+ * @details Like ::string_pool_create. See ::pool_create_from_size_and_pages.
+ *
+ * @param block_capacity The number of characters in each block in the pool.
+ * @param pages          Kind of memory pages that back the blocks of the pool.
+ *
+ * @return The newly created pool, or `NULL` on failure.
+ */
+string_pool_t *string_pool_create_with_pages(size_t block_capacity, pool_pages_t pages);
+
 /**
  * @brief   Allocates space for a string in the pool.
  * @details That string does not need to be `free`'d, as that's done when @p pool itself is freed in
@@ -133,6 +153,91 @@ char *string_pool_allocate(string_pool_t *pool, size_t length);
  */
 char *string_pool_put(string_pool_t *pool, const char *str);
 
+/**
+ * @brief   Makes a string pool return strings in a mapped file as they are, instead of copying
+ *          them.
+ * @details After this is called, ::string_pool_put and ::string_pool_cache_put return strings that
+ *          start in @p file without copying them. Those strings must end in @p file too, and must
+ *          not be modified through the returned pointers. @p pool keeps a reference to @p file
+ *          (see ::mapped_file_ref) until it's freed.
+ *
+ * @param pool Pool that will borrow strings from @p file.
+ * @param file File where strings may be borrowed from.
+ *
+ * @retval 0 Success.
+ * @retval 1 @p pool already borrows strings from a file.
+ */
+int string_pool_borrow(string_pool_t *pool, mapped_file_t *file);
+
+/**
+ * @brief  Checks if a string would be borrowed by a string pool, instead of being copied.
+ * @param  pool Pool that may borrow strings (see ::string_pool_borrow).
+ * @param  str  String to be checked.
+ * @return Whether @p str is in the file @p pool borrows strings from.
+ */
+int string_pool_is_borrowed(const string_pool_t *pool, const char *str);
+
+/**
+ * @brief  Gets the file a string pool borrows strings from.
+ * @param  pool Pool that may borrow strings (see ::string_pool_borrow).
+ * @return The file given to ::string_pool_borrow, or `NULL` if @p pool doesn't borrow strings.
+ */
+mapped_file_t *string_pool_get_borrowed(const string_pool_t *pool);
+
+/**
+ * @brief   Creates a cache, to allocate strings in a string pool from a thread.
+ * @details See ::pool_cache_create. While any cache of @p pool exists, strings can only be
+ *          allocated in @p pool through caches.
+ *
+ * @param pool String pool to allocate strings in.
+ *
+ * @return A new ::string_pool_cache_t, that must be freed with ::string_pool_cache_free, or `NULL`
+ *         on allocation failure.
+ */
+string_pool_cache_t *string_pool_cache_create(string_pool_t *pool);
+
+/**
+ * @brief Allocates space for a string in a string pool, through a cache.
+ *
+ * @param cache  Cache of the pool to allocate the string in.
+ * @param length Length of the string (not including null terminator).
+ *
+ * @return The pointer to the allocated string, `NULL` on failure.
+ */
+char *string_pool_cache_allocate(string_pool_cache_t *cache, size_t length);
+
+/**
+ * @brief Allocates space for a string and copies it to a string pool, through a cache.
+ *
+ * @param cache Cache of the pool to allocate the string in.
+ * @param str   String to be copied to the pool.
+ *
+ * @return The pointer to the allocated string, `NULL` on failure.
+ */
+char *string_pool_cache_put(string_pool_cache_t *cache, const char *str);
+
+/**
+ * @brief Frees a cache of a string pool. Strings allocated through it remain valid.
+ * @param cache Cache to be freed.
+ */
+void string_pool_cache_free(string_pool_cache_t *cache);
+
+/**
+ * @brief   Gets the memory accounting counters of a string pool.
+ * @details See ::pool_get_memory_usage. Items are characters, so byte counts are character counts.
+ *
+ * @param pool String pool to get the counters from.
+ * @param out  Where to write the counters to.
+ */
+void string_pool_get_memory_usage(const string_pool_t *pool, memory_usage_t *out);
+
+/**
+ * @brief   Gives the memory after the last string in each block of a pool back to the system.
+ * @details See ::pool_trim. Must not be called while any ::string_pool_cache_t of @p pool exists.
+ * @param   pool String pool that's done growing.
+ */
+void string_pool_trim(string_pool_t *pool);
+
 /**
  * @brief   Removes all strings from @p pool.
  * @details Keep in mind that all strings allocated using @p pool will no longer be valid (this will
@@ -145,8 +250,9 @@ char *string_pool_put(string_pool_t *pool, const char *str);
 void string_pool_empty(string_pool_t *pool);
 
 /**
- * @brief Frees memory allocated by a string pool.
- * @param pool String pool to be freed.
+ * @brief   Frees memory allocated by a string pool.
+ * @details The reference to the file @p pool borrows strings from (if any) is released.
+ * @param   pool String pool to be freed.
  *
  * #### Examples
  * See [the header file's documentation](@ref string_pool_examples).
@@ -17,6 +17,11 @@
 #ifndef STRING_POOL_NO_DUPLICATES
 #define STRING_POOL_NO_DUPLICATES
 
+#include <stddef.h>
+
+#include "utils/mapped_file.h"
+#include "utils/memory_report.h"
+
 /**
  * @file    string_pool_no_duplicates.h
  * @brief   An allocator for strings subject to repetition, of which only one copy will be
@@ -24,6 +29,11 @@
  * @details Allocations are slightly slower than on a string pool, but memroy usage should improve
  *          by a lot if a string is repeated many times over.
  *
+ *          Stored strings are found with an open addressing hash table, whose entries keep the
+ *          hash and the length of their strings. Lookups only compare characters when both of
+ *          those match, and strings don't need to be null-terminated to be looked up (see
+ *          ::string_pool_no_duplicates_put_length).
+ *
  * @anchor string_pool_no_duplicates_examples
  * ### Examples
  *
@@ -118,6 +128,62 @@ string_pool_no_duplicates_t *string_pool_no_duplicates_create(size_t block_capac
  */
 const char *string_pool_no_duplicates_put(string_pool_no_duplicates_t *pool, const char *str);
 
+/**
+ * @brief   Same as ::string_pool_no_duplicates_put, but for a string of known length.
+ * @details @p str doesn't need to be null-terminated (e.g.: it can be a slice of a line being
+ *          parsed), but the string stored in @p pool will be.
+ *
+ * @param pool   Pool to allocate the string in, if necessary.
+ * @param str    Characters of the string to be copied to the pool, if necessary.
+ * @param length Number of characters in @p str.
+ *
+ * @return The pointer to the string in @p pool, or `NULL` on allocation failure.
+ */
+const char *string_pool_no_duplicates_put_length(string_pool_no_duplicates_t *pool,
+                                                 const char                  *str,
+                                                 size_t                       length);
+
+/**
+ * @brief   Makes a string pool without duplicates keep strings in a mapped file where they are,
+ *          instead of copying them.
+ * @details See ::string_pool_borrow. Strings are still deduplicated: the first occurrence of a
+ *          string in @p file is the one returned for all equal strings. Strings given to
+ *          ::string_pool_no_duplicates_put_length are only borrowed when they're null-terminated.
+ *
+ * @param pool Pool that will borrow strings from @p file.
+ * @param file File where strings may be borrowed from.
+ *
+ * @retval 0 Success.
+ * @retval 1 @p pool already borrows strings from a file.
+ */
+int string_pool_no_duplicates_borrow(string_pool_no_duplicates_t *pool, mapped_file_t *file);
+
+/**
+ * @brief  Gets the file a string pool without duplicates borrows strings from.
+ * @param  pool Pool that may borrow strings (see ::string_pool_no_duplicates_borrow).
+ * @return The file given to ::string_pool_no_duplicates_borrow, or `NULL` if @p pool doesn't
+ *         borrow strings.
+ */
+mapped_file_t *string_pool_no_duplicates_get_borrowed(const string_pool_no_duplicates_t *pool);
+
+/**
+ * @brief   Gives the memory after the last string in each block of a pool back to the system.
+ * @details See ::string_pool_trim. The hash table used to find duplicates is kept as it is.
+ * @param   pool String pool without duplicates that's done growing.
+ */
+void string_pool_no_duplicates_trim(string_pool_no_duplicates_t *pool);
+
+/**
+ * @brief   Gets the memory accounting counters of a string pool without duplicates.
+ * @details See ::pool_get_memory_usage. The hash table used to find duplicates is accounted for as
+ *          an extra block, whose occupied entries are used memory.
+ *
+ * @param pool Pool to get the counters from.
+ * @param out  Where to write the counters to.
+ */
+void string_pool_no_duplicates_get_memory_usage(const string_pool_no_duplicates_t *pool,
+                                                memory_usage_t                    *out);
+
 /**
  * @brief Frees memory allocated by a string pool without duplicates.
  * @param pool Pool data to be freed.
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    string_table.h
+ * @brief   Hash table from strings to 32-bit integer values.
+ * @details Unlike a `GHashTable`, entries are stored inline in a flat array, and keys are hashed
+ *          with ::string_table_hash, that reads strings 8 bytes at a time (instead of byte by byte,
+ *          like `g_str_hash`). The whole 64-bit hash of each key is stored next to it, so keys are
+ *          only compared with `strcmp` when their hashes are equal, and the table can grow without
+ *          hashing keys again.
+ *
+ *          Slots are split in groups of 16, and each slot has a control byte, that is either empty
+ *          or 7 bits of the hash of its key. A lookup compares a whole group of control bytes at a
+ *          time (with a single SSE2 comparison, when available), so probing is usually limited to
+ *          the home group of a key, even at high load factors.
+ *
+ *          Keys aren't copied: they must stay valid (and unmodified) while they're in the table,
+ *          which is meant for strings in a pool (see ::string_pool_t). Entries can't be removed.
+ *
+ *          A table that is no longer modified can be replicated on every NUMA node (see
+ *          ::string_table_replicate), so that probing reads local memory from any thread. Keys
+ *          themselves aren't replicated.
+ *
+ * @anchor string_table_examples
+ * ### Examples
+ *
+ * ```c
+ * #include <inttypes.h>
+ * #include <stdio.h>
+ * #include "utils/string_table.h"
+ *
+ * int main(void) {
+ *     string_table_t *table = string_table_create(100); // Room for 100 entries before growing
+ *
+ *     const char *const keys[] = {"JoaoSilva", "PedroAlves", "GabrielaMonteiro"};
+ *     for (uint32_t i = 0; i < 3; ++i)
+ *         string_table_insert(table, keys[i], i);
+ *
+ *     uint32_t value;
+ *     if (!string_table_lookup(table, "PedroAlves", &value))
+ *         printf("%" PRIu32 "\n", value); // Prints 1
+ *
+ *     if (string_table_lookup(table, "Pedro", &value))
+ *         printf("Not found\n");
+ *
+ *     string_table_free(table);
+ *     return 0;
+ * }
+ * ```
+ */
+
+#ifndef STRING_TABLE_H
+#define STRING_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/memory_report.h"
+
+/** @brief Hash table from strings to 32-bit integer values. */
+typedef struct string_table string_table_t;
+
+/**
+ * @brief   Hashes a string.
+ * @details The hash is not cryptographic, and it's only stable during a single run of the program
+ *          (it depends on the byte order of the machine).
+ *
+ * @param key String to be hashed.
+ *
+ * @return The 64-bit hash of @p key.
+ */
+uint64_t string_table_hash(const char *key);
+
+/**
+ * @brief   Creates a new empty ::string_table_t.
+ * @details The returned value is owned by the caller, and should be freed with ::string_table_free.
+ *
+ * @param capacity Number of entries that can be inserted before the table needs to grow. The table
+ *                 grows automatically, so this is only a hint.
+ *
+ * @return A new ::string_table_t, or `NULL` on allocation failure.
+ */
+string_table_t *string_table_create(size_t capacity);
+
+/**
+ * @brief Grows a table so that it can hold @p capacity entries without growing again.
+ *
+ * @param table    Table to be grown. Nothing is done if it's large enough already.
+ * @param capacity Total number of entries that must fit in @p table.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p table is left unchanged).
+ */
+int string_table_reserve(string_table_t *table, size_t capacity);
+
+/**
+ * @brief   Shrinks a table to the smallest number of slots that fits the entries in it.
+ * @details Meant for tables that were reserved for an overestimated number of entries, once no
+ *          more entries are going to be inserted. The table can still grow afterwards.
+ *
+ * @param table Table to be shrunk. Nothing is done if it can't be any smaller.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p table is left unchanged).
+ */
+int string_table_shrink_to_fit(string_table_t *table);
+
+/**
+ * @brief   Copies a table to every NUMA node, for lookups to read the copy of the calling thread's
+ *          node (see ::numa_topology_get_current_node).
+ * @details See ::id_table_replicate. Modifying @p table (including reserving and shrinking it)
+ *          frees its copies. On machines with a single NUMA node, nothing is done.
+ *
+ * @param table Table to be replicated.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p table isn't replicated, and lookups still work).
+ */
+int string_table_replicate(string_table_t *table);
+
+/**
+ * @brief Associates a value to a key in a table, replacing any previous association.
+ *
+ * @param table Table to insert the association in.
+ * @param key   Key to be inserted. Not copied, so it must outlive its entry in @p table. If an
+ *              equal key is already in @p table, it's replaced by @p key.
+ * @param value Value associated to @p key.
+ *
+ * @retval 0 Success (@p key wasn't in @p table before).
+ * @retval 1 Allocation failure (@p table is left unchanged).
+ * @retval 2 Success (@p key was already in @p table, and its value was replaced).
+ */
+int string_table_insert(string_table_t *table, const char *key, uint32_t value);
+
+/**
+ * @brief   Gets the value associated to a key in a table.
+ * @details Lookups can be done from many threads at the same time, as long as no thread is
+ *          inserting into @p table.
+ *
+ * @param table Table to search in.
+ * @param key   Key to be searched for.
+ * @param value Where to write the value associated to @p key to. Not modified if @p key isn't
+ *              found.
+ *
+ * @retval 0 Success.
+ * @retval 1 @p key not in @p table.
+ */
+int string_table_lookup(const string_table_t *table, const char *key, uint32_t *value);
+
+/**
+ * @brief  Gets the number of entries in a table.
+ * @param  table Table to get the number of entries from.
+ * @return The number of entries in @p table.
+ */
+size_t string_table_get_count(const string_table_t *table);
+
+/**
+ * @brief   Gets the memory accounting counters of a table.
+ * @details The control bytes and the slots are the two blocks (along with their copies on every
+ *          NUMA node, if replicated). Empty slots are reserved but not used, and keys aren't
+ *          accounted for, as they're not owned by the table.
+ *
+ * @param table Table to get the counters from.
+ * @param out   Where to write the counters to.
+ */
+void string_table_get_memory_usage(const string_table_t *table, memory_usage_t *out);
+
+/**
+ * @brief Frees memory used by a ::string_table_t.
+ * @param table Table to be freed.
+ */
+void string_table_free(string_table_t *table);
+
+#endif
@@ -0,0 +1,392 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h>
+
+/**
+ * @file    thread_pool.h
+ * @brief   A work-stealing task scheduler, shared by all parallel parts of the program.
+ * @details Each worker thread has its own double-ended queue of tasks. Tasks submitted by a worker
+ *          go to the back of its own queue, and it takes tasks from there too (most recent first,
+ *          while their data is still in cache). Idle workers steal the oldest tasks from the
+ *          front of other queues. Tasks submitted by threads outside the pool go to a shared queue.
+ *
+ *          Tasks are organized in groups (::thread_pool_group_t), that can be waited for. A thread
+ *          waiting for a group runs queued tasks instead of blocking, so tasks can submit and wait
+ *          for nested groups. For the common case of splitting a loop among threads, see
+ *          ::thread_pool_parallel_for.
+ *
+ *          The number of threads is chosen by ::thread_pool_get_default_thread_count, which can be
+ *          configured with the `LI3_THREADS` environment variable or on the command line (see
+ *          ::thread_pool_set_default_thread_count). A single thread is a deterministic mode for
+ *          debugging: no threads are started and every task runs in the calling thread, in the
+ *          order it was submitted.
+ *
+ *          Each parallel stage of the program (::thread_pool_stage_t) can be limited to fewer
+ *          threads than the pool has (see ::thread_pool_get_stage_thread_count), and the whole
+ *          program to a set of CPUs (see ::thread_pool_set_cpus), so that it can coexist with other
+ *          services on the same machine. Workers can also be pinned to a CPU each (see
+ *          ::thread_pool_set_pinning). Otherwise, on NUMA machines, workers are pinned to the CPUs
+ *          of a node each, round-robin (see ::numa_topology_pin_thread). All of these can be
+ *          configured with environment variables, or on the command line, which takes precedence.
+ *
+ * @anchor thread_pool_examples
+ * ### Examples
+ *
+ * ```c
+ * #include <stdio.h>
+ * #include "utils/thread_pool.h"
+ *
+ * void square(void *user_data, size_t start, size_t end) {
+ *     int *numbers = user_data;
+ *     for (size_t i = start; i < end; ++i)
+ *         numbers[i] *= numbers[i];
+ * }
+ *
+ * int main(void) {
+ *     int numbers[1000];
+ *     for (int i = 0; i < 1000; ++i)
+ *         numbers[i] = i;
+ *
+ *     thread_pool_parallel_for(thread_pool_get_shared(), 1000, 100, square, numbers);
+ *     printf("%d\n", numbers[999]); // Prints 998001
+ *     return 0;
+ * }
+ * ```
+ */
+
+/** @brief Name of the environment variable that sets the default number of threads. */
+#define THREAD_POOL_ENVIRONMENT_VARIABLE "LI3_THREADS"
+
+/**
+ * @brief Name of the environment variable that limits the threads of each stage, such as
+ *        `load=4,queries=8,diff=2` (see ::thread_pool_set_stage_thread_counts).
+ */
+#define THREAD_POOL_STAGE_THREADS_ENVIRONMENT_VARIABLE "LI3_STAGE_THREADS"
+
+/**
+ * @brief Name of the environment variable with the CPUs the program can run on, such as `0-3,8-11`
+ *        (see ::thread_pool_set_cpus).
+ */
+#define THREAD_POOL_CPUS_ENVIRONMENT_VARIABLE "LI3_CPUS"
+
+/**
+ * @brief Name of the environment variable that, when set to `1`, pins workers to a CPU each (see
+ *        ::thread_pool_set_pinning).
+ */
+#define THREAD_POOL_PIN_ENVIRONMENT_VARIABLE "LI3_PIN"
+
+/** @brief Number of values in ::thread_pool_stage_t. */
+#define THREAD_POOL_STAGE_COUNT 3
+
+/** @brief Maximum number of threads (including the calling one) in a ::thread_pool_t. */
+#define THREAD_POOL_MAX_THREADS 64
+
+/** @brief A set of worker threads that run tasks. */
+typedef struct thread_pool thread_pool_t;
+
+/** @brief Parallel stages of the program, whose number of threads can be limited. */
+typedef enum {
+    /** @brief Parsing dataset files. */
+    THREAD_POOL_STAGE_LOAD,
+    /** @brief Parsing query files and running queries. */
+    THREAD_POOL_STAGE_QUERIES,
+    /** @brief Comparing query outputs with the expected ones, in `programa-testes`. */
+    THREAD_POOL_STAGE_DIFF,
+} thread_pool_stage_t;
+
+/** @brief A set of tasks in a ::thread_pool_t that can be waited for. */
+typedef struct thread_pool_group thread_pool_group_t;
+
+/**
+ * @brief Callback type for a task in a ::thread_pool_t.
+ * @param user_data Argument provided to ::thread_pool_group_submit.
+ */
+typedef void (*thread_pool_task_callback_t)(void *user_data);
+
+/**
+ * @brief Callback type for a part of a loop in ::thread_pool_parallel_for.
+ *
+ * @param user_data Argument provided to ::thread_pool_parallel_for.
+ * @param start     First index to be processed.
+ * @param end       Index after the last one to be processed.
+ */
+typedef void (*thread_pool_range_callback_t)(void *user_data, size_t start, size_t end);
+
+/**
+ * @brief  Callback type for creating an accumulator in ::thread_pool_parallel_reduce.
+ * @param  user_data Argument provided to ::thread_pool_parallel_reduce.
+ * @return A new accumulator, or `NULL` on allocation failure.
+ */
+typedef void *(*thread_pool_reduce_init_callback_t)(void *user_data);
+
+/**
+ * @brief Callback type for a part of a loop in ::thread_pool_parallel_reduce.
+ *
+ * @param user_data   Argument provided to ::thread_pool_parallel_reduce.
+ * @param accumulator Accumulator of this range, only accessed by the thread running it.
+ * @param start       First index to be processed.
+ * @param end         Index after the last one to be processed.
+ */
+typedef void (*thread_pool_reduce_range_callback_t)(void  *user_data,
+                                                    void  *accumulator,
+                                                    size_t start,
+                                                    size_t end);
+
+/**
+ * @brief Callback type for merging an accumulator in ::thread_pool_parallel_reduce.
+ *
+ * @param user_data   Argument provided to ::thread_pool_parallel_reduce.
+ * @param accumulator Accumulator to be merged. Owned by this callback, that must free it.
+ */
+typedef void (*thread_pool_reduce_merge_callback_t)(void *user_data, void *accumulator);
+
+/**
+ * @brief   Gets the number of threads parallel parts of the program should use.
+ * @details In order of priority: the value set with ::thread_pool_set_default_thread_count, the
+ *          value of the ::THREAD_POOL_ENVIRONMENT_VARIABLE environment variable, or the number of
+ *          processors the program can run on (see ::thread_pool_set_cpus). The result is clamped
+ *          to [`1`, ::THREAD_POOL_MAX_THREADS].
+ *
+ * @return The number of threads to use, including the calling one.
+ */
+size_t thread_pool_get_default_thread_count(void);
+
+/**
+ * @brief   Sets the number of threads parallel parts of the program should use.
+ * @details Only affects pools created afterwards (including the shared pool, if it doesn't exist
+ *          yet), and the number of threads loops in the shared pool use, which is never more than
+ *          the threads it was created with. Not thread-safe: meant to be called while parsing the
+ *          command line, or between runs of the program's phases.
+ *
+ * @param nthreads Number of threads, including the calling one. `0` to go back to the default.
+ */
+void thread_pool_set_default_thread_count(size_t nthreads);
+
+/**
+ * @brief  Gets the name of a stage, as used in ::THREAD_POOL_STAGE_THREADS_ENVIRONMENT_VARIABLE.
+ * @param  stage Stage to get the name of.
+ * @return `load`, `queries` or `diff`.
+ */
+const char *thread_pool_stage_get_name(thread_pool_stage_t stage);
+
+/**
+ * @brief   Limits the number of threads of some stages.
+ * @details Overrides ::THREAD_POOL_STAGE_THREADS_ENVIRONMENT_VARIABLE. Not thread-safe: meant to be
+ *          called while parsing the command line.
+ *
+ * @param list Comma-separated list of stage names (see ::thread_pool_stage_get_name) and positive
+ *             numbers of threads, such as `load=4,queries=8`. Stages not in the list aren't
+ *             limited.
+ *
+ * @retval 0 Success.
+ * @retval 1 Invalid @p list. Nothing was changed.
+ */
+int thread_pool_set_stage_thread_counts(const char *list);
+
+/**
+ * @brief   Gets the number of threads a parallel stage of the program should use.
+ * @details The limit set for the stage (see ::thread_pool_set_stage_thread_counts), if any, but
+ *          never more than ::thread_pool_get_default_thread_count.
+ *
+ * @param stage Stage to get the number of threads of.
+ *
+ * @return The number of threads to use, including the calling one.
+ */
+size_t thread_pool_get_stage_thread_count(thread_pool_stage_t stage);
+
+/**
+ * @brief   Restricts the program to a set of CPUs.
+ * @details Overrides ::THREAD_POOL_CPUS_ENVIRONMENT_VARIABLE. The default number of threads becomes
+ *          the number of CPUs in the set (see ::thread_pool_get_default_thread_count). Must be
+ *          called before any thread is started (e.g.: while parsing the command line).
+ *
+ * @param list List of CPU numbers and ranges, such as `0-3,8-11`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Invalid @p list, or CPUs the program can't run on.
+ */
+int thread_pool_set_cpus(const char *list);
+
+/**
+ * @brief   Chooses whether worker threads are pinned to a CPU each.
+ * @details Overrides ::THREAD_POOL_PIN_ENVIRONMENT_VARIABLE, and only affects pools created
+ *          afterwards. Worker `i` is pinned to the `i + 1`-th CPU the program can run on (see
+ *          ::numa_topology_pin_thread_to_cpu), wrapping around, leaving the first CPU for the
+ *          thread that created the pool, which isn't pinned. Pinning takes precedence over
+ *          spreading workers among NUMA nodes. Not thread-safe: meant to be called while parsing
+ *          the command line.
+ *
+ * @param pin Whether to pin workers.
+ */
+void thread_pool_set_pinning(int pin);
+
+/**
+ * @brief  Checks if worker threads are pinned to a CPU each.
+ * @return The value set with ::thread_pool_set_pinning, or whether
+ *         ::THREAD_POOL_PIN_ENVIRONMENT_VARIABLE is `1`.
+ */
+int thread_pool_get_pinning(void);
+
+/**
+ * @brief   Creates a new thread pool.
+ * @details The calling thread counts as one of the threads, as it runs tasks while waiting for
+ *          them. If some worker threads fail to start, the pool works with fewer of them.
+ *
+ * @param nthreads Number of threads, including the calling one. `0` for
+ *                 ::thread_pool_get_default_thread_count. `1` for the deterministic single-thread
+ *                 mode.
+ *
+ * @return A new ::thread_pool_t, that must be deleted with ::thread_pool_free, or `NULL` on
+ *         failure.
+ */
+thread_pool_t *thread_pool_create(size_t nthreads);
+
+/**
+ * @brief   Gets a thread pool shared by the whole program.
+ * @details Created the first time this method is called, with
+ *          ::thread_pool_get_default_thread_count threads, and never freed. Thread-safe.
+ *
+ * @return The shared ::thread_pool_t, or `NULL` if it couldn't be created.
+ */
+thread_pool_t *thread_pool_get_shared(void);
+
+/**
+ * @brief  Gets the number of threads in a thread pool.
+ * @param  pool Thread pool to get the number of threads from.
+ * @return The number of threads that run tasks, including the calling one.
+ */
+size_t thread_pool_get_thread_count(const thread_pool_t *pool);
+
+/**
+ * @brief   Creates a new empty group of tasks.
+ * @param   pool Thread pool where the group's tasks will be run.
+ * @return  A new ::thread_pool_group_t, that must be deleted with ::thread_pool_group_free, or
+ *          `NULL` on allocation failure.
+ */
+thread_pool_group_t *thread_pool_group_create(thread_pool_t *pool);
+
+/**
+ * @brief   Adds a task to a group, to be run by any thread in the group's pool.
+ * @details If the task can't be queued (allocation failure, or single-thread mode), it's run
+ *          immediately, in the calling thread.
+ *
+ * @param group     Group to add the task to.
+ * @param callback  Task to be run.
+ * @param user_data Argument passed to @p callback.
+ */
+void thread_pool_group_submit(thread_pool_group_t        *group,
+                              thread_pool_task_callback_t callback,
+                              void                       *user_data);
+
+/**
+ * @brief   Waits for all tasks in a group to finish running.
+ * @details The calling thread runs queued tasks (from any group) while waiting. The group can be
+ *          reused afterwards.
+ *
+ * @param group Group whose tasks are waited for.
+ */
+void thread_pool_group_wait(thread_pool_group_t *group);
+
+/**
+ * @brief Frees memory allocated by a group of tasks.
+ * @param group Group to be freed. Musn't have any unfinished tasks (see ::thread_pool_group_wait).
+ */
+void thread_pool_group_free(thread_pool_group_t *group);
+
+/**
+ * @brief   Runs a loop over `[0, n[` in parallel, splitting it into ranges of @p grain indices.
+ * @details Threads take the next range as soon as they're done with the previous one, so that
+ *          ranges of uneven cost are balanced among threads. Returns when the whole loop is done.
+ *
+ * @param pool      Thread pool to run the loop in. `NULL` to run the whole loop in the calling
+ *                  thread (e.g.: after failing to get a pool).
+ * @param n         Number of indices.
+ * @param grain     Number of indices in each range (except maybe the last). `0` to choose
+ *                  automatically, based on the number of threads.
+ * @param callback  Method called for each range.
+ * @param user_data Argument passed to @p callback.
+ *
+ * #### Examples
+ * See [the header file's documentation](@ref thread_pool_examples).
+ */
+void thread_pool_parallel_for(thread_pool_t               *pool,
+                              size_t                       n,
+                              size_t                       grain,
+                              thread_pool_range_callback_t callback,
+                              void                        *user_data);
+
+/**
+ * @brief   Runs a loop of a parallel stage, like ::thread_pool_parallel_for, but in at most
+ *          ::thread_pool_get_stage_thread_count threads.
+ *
+ * @param pool      Thread pool to run the loop in. `NULL` to run the whole loop in the calling
+ *                  thread.
+ * @param stage     Stage the loop is part of.
+ * @param n         Number of indices.
+ * @param grain     Number of indices in each range (except maybe the last). `0` to choose
+ *                  automatically, based on the number of threads of @p stage.
+ * @param callback  Method called for each range.
+ * @param user_data Argument passed to @p callback.
+ */
+void thread_pool_parallel_for_stage(thread_pool_t               *pool,
+                                    thread_pool_stage_t          stage,
+                                    size_t                       n,
+                                    size_t                       grain,
+                                    thread_pool_range_callback_t callback,
+                                    void                        *user_data);
+
+/**
+ * @brief   Runs a loop over `[0, n[` in parallel, with an accumulator for each range of indices.
+ * @details The loop is split into ranges of @p grain indices. Each range gets its own
+ *          accumulator, created by @p init, so that @p callback doesn't need any synchronization.
+ *          Once the whole loop is done, accumulators are merged by @p merge in the calling thread,
+ *          in the order of their ranges. Results are thus the same for any number of threads, as
+ *          long as @p grain is fixed.
+ *
+ * @param pool      Thread pool to run the loop in. `NULL` to run the whole loop in the calling
+ *                  thread.
+ * @param n         Number of indices.
+ * @param grain     Number of indices in each range (except maybe the last). `0` to have one range
+ *                  per thread.
+ * @param init      Method called to create the accumulator of each range.
+ * @param callback  Method called for each range.
+ * @param merge     Method called for every accumulator, after the loop.
+ * @param user_data Argument passed to @p init, @p callback and @p merge.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure. Ranges whose accumulator couldn't be created weren't processed,
+ *           but all other accumulators were still merged.
+ */
+int thread_pool_parallel_reduce(thread_pool_t                      *pool,
+                                size_t                              n,
+                                size_t                              grain,
+                                thread_pool_reduce_init_callback_t  init,
+                                thread_pool_reduce_range_callback_t callback,
+                                thread_pool_reduce_merge_callback_t merge,
+                                void                               *user_data);
+
+/**
+ * @brief   Frees a thread pool, stopping all its threads.
+ * @details Musn't be called while any group still has unfinished tasks, nor on the shared pool.
+ * @param   pool Thread pool to be freed.
+ */
+void thread_pool_free(thread_pool_t *pool);
+
+#endif
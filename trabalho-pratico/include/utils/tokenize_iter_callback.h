@@ -22,6 +22,8 @@
 #ifndef TOKENIZE_ITER_CALLBACK_H
 #define TOKENIZE_ITER_CALLBACK_H
 
+#include <stddef.h>
+
 /**
  * @brief Callback method for many tokenizers, called for every token read.
  *
@@ -36,4 +38,22 @@
  */
 typedef int (*tokenize_iter_callback_t)(void *user_data, char *token);
 
+/**
+ * @brief   Callback method for tokenizers that know the length of every token they read.
+ * @details Like ::tokenize_iter_callback_t, but @p token usually points directly into the input
+ *          buffer (e.g.: a memory-mapped file), so no copies are made.
+ *
+ * @param user_data Pointer, kept from call to call, so that this callback can modify the program's
+ *                  state.
+ * @param token     The token that was read (`'\0'`-terminated). Its lifetime is limited to the
+ *                  scope of this function, so make a copy of if if you pretend to store it
+ *                  @p user_data.
+ * @param length    Length of @p token, not including the `'\0'` terminator.
+ *
+ * @return `0` on success, other value for immediate termination of tokenization. It's recommended
+ *         that this value is positive, not to risk being confused with
+ *         ::STREAM_TOKENIZE_RET_ALLOCATION_FAILURE (or others).
+ */
+typedef int (*tokenize_slice_iter_callback_t)(void *user_data, char *token, size_t length);
+
 #endif
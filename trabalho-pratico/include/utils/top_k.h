@@ -0,0 +1,102 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TOP_K_H
+#define TOP_K_H
+
+#include <glib.h>
+#include <stddef.h>
+
+/**
+ * @file    top_k.h
+ * @brief   Bounded selection of the first `k` items of a sequence, in a given order.
+ * @details Items are kept in a binary heap whose root is the last of the kept items, so that adding
+ *          an item costs `O(log k)`, and only `k` items are ever stored. This is useful for queries
+ *          that only output the first few items of a large sorted list.
+ *
+ * @anchor top_k_examples
+ * ### Examples
+ *
+ * ```c
+ * #include <stdio.h>
+ * #include "utils/top_k.h"
+ *
+ * gint compare_int(gconstpointer a, gconstpointer b) {
+ *     return *(const int *) a - *(const int *) b;
+ * }
+ *
+ * int main(void) {
+ *     top_k_t *top_k = top_k_create(sizeof(int), 3, compare_int);
+ *
+ *     for (int i = 100; i > 0; --i)
+ *         top_k_add(top_k, &i);
+ *
+ *     GArray *smallest = top_k_free_to_array(top_k);
+ *     for (size_t i = 0; i < smallest->len; ++i)
+ *         printf("%d\n", g_array_index(smallest, int, i)); // Prints 1, 2, 3
+ *
+ *     g_array_unref(smallest);
+ *     return 0;
+ * }
+ * ```
+ */
+
+/** @brief Bounded selection of the first `k` items of a sequence. */
+typedef struct top_k top_k_t;
+
+/**
+ * @brief   Creates a new empty top-`k` selection.
+ * @details The returned value is owned by the caller, and should be freed with ::top_k_free or
+ *          ::top_k_free_to_array. Memory is only allocated as items are added, so @p k can be
+ *          larger than the number of items that will be added.
+ *
+ * @param item_size    Size (in bytes) of each item.
+ * @param k            Maximum number of items to keep.
+ * @param compare_func Comparison function between two items (pointers to items). Items that would
+ *                     come first in a sorted array are kept.
+ *
+ * @return A new ::top_k_t, or `NULL` on allocation failure.
+ */
+top_k_t *top_k_create(size_t item_size, size_t k, GCompareFunc compare_func);
+
+/**
+ * @brief   Adds an item to a top-`k` selection.
+ * @details The item is copied, and discarded if @p top_k is full and @p item comes after all items
+ *          in it.
+ *
+ * @param top_k Selection to add @p item to.
+ * @param item  Pointer to the item to be added.
+ */
+void top_k_add(top_k_t *top_k, const void *item);
+
+/**
+ * @brief Frees a top-`k` selection, returning its items.
+ *
+ * @param top_k Selection to be freed.
+ *
+ * @return A `GArray` with the kept items, sorted according to the selection's comparison function.
+ *         It's owned by the caller, and must be freed with `g_array_unref`.
+ */
+GArray *top_k_free_to_array(top_k_t *top_k);
+
+/**
+ * @brief Frees a top-`k` selection and all items in it.
+ * @param top_k Selection to be freed.
+ */
+void top_k_free(top_k_t *top_k);
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    utf8.h
+ * @brief   Validation of UTF-8 strings.
+ * @details Dataset strings are almost always pure ASCII, so both methods here check blocks of bytes
+ *          at a time for ASCII characters (16 with SSE2, 8 otherwise), and only decode multibyte
+ *          sequences one at a time when they're found.
+ *
+ *          Strings known to be ASCII can skip multibyte handling later on, such as locale-aware
+ *          collation and measuring the width of text on a terminal.
+ */
+
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stddef.h>
+
+/**
+ * @brief  Checks if a string is made only of ASCII characters.
+ * @param  str    String to be checked. Doesn't need to be `'\0'`-terminated.
+ * @param  length Number of bytes in @p str.
+ * @return `1` if no byte in @p str has its highest bit set, `0` otherwise.
+ */
+int utf8_is_ascii(const char *str, size_t length);
+
+/**
+ * @brief   Checks if a string is valid UTF-8.
+ * @details Overlong encodings, UTF-16 surrogates and code points above `U+10FFFF` are considered
+ *          invalid, as in RFC 3629.
+ *
+ * @param str    String to be validated. Doesn't need to be `'\0'`-terminated.
+ * @param length Number of bytes in @p str.
+ *
+ * @retval 0 @p str is valid UTF-8.
+ * @retval 1 @p str isn't valid UTF-8.
+ */
+int utf8_validate(const char *str, size_t length);
+
+#endif
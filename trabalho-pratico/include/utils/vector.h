@@ -0,0 +1,131 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file    vector.h
+ * @brief   Growable arrays of a type known at compile time, with inline storage for a few items.
+ * @details `GArray` and `GPtrArray` store any type, so every access goes through the size of
+ *          their elements or through a pointer, and even an empty array is a heap allocation. The
+ *          vectors defined by ::VECTOR_DEFINE store their type directly, and keep their first items
+ *          inside the vector itself. Only vectors that outgrow that inline storage allocate
+ *          memory, and ::VECTOR_DEFINE's `_reserve` method lets callers that know how many items
+ *          will be added allocate it only once.
+ *
+ *          Vectors don't point to themselves, so they can be moved around (e.g.: stored in a
+ *          growable array) like any other value.
+ *
+ * @anchor vector_examples
+ * ### Examples
+ *
+ * ```c
+ * VECTOR_DEFINE(int_vector, int, 4)
+ *
+ * int main(void) {
+ *     int_vector_t vector;
+ *     int_vector_init(&vector);
+ *
+ *     for (int i = 0; i < 10; ++i) // The first 4 items don't allocate memory
+ *         if (int_vector_push(&vector, i))
+ *             return 1;
+ *
+ *     const int *const items = int_vector_get_const_data(&vector);
+ *     for (size_t i = 0; i < vector.length; ++i)
+ *         printf("%d\n", items[i]);
+ *
+ *     int_vector_free(&vector);
+ *     return 0;
+ * }
+ * ```
+ */
+
+#ifndef VECTOR_H
+#define VECTOR_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief   Defines a vector type and its methods.
+ * @details The following are defined, where `name_t` is a structure with a public `length` field:
+ *
+ *          - `void name_init(name_t *vector)`: creates an empty vector;
+ *          - `int name_reserve(name_t *vector, size_t capacity)`: makes sure @p capacity items fit
+ *            in the vector without further allocations (`0` on success, `1` on allocation
+ *            failure);
+ *          - `int name_push(name_t *vector, type item)`: appends an item, doubling the vector's
+ *            capacity if needed (`0` on success, `1` on allocation failure);
+ *          - `type *name_get_data(name_t *vector)` and
+ *            `const type *name_get_const_data(const name_t *vector)`: get the items, valid until
+ *            the vector's capacity changes;
+ *          - `void name_free(name_t *vector)`: frees the vector's memory (the structure itself is
+ *            owned by the caller).
+ *
+ * @param name            Prefix of the names of the type and methods to be defined.
+ * @param type            Type of the items.
+ * @param inline_capacity Number of items kept inside the vector itself. Must be at least `1`.
+ */
+#define VECTOR_DEFINE(name, type, inline_capacity)                                                 \
+    typedef struct {                                                                               \
+        size_t length, capacity;                                                                   \
+        type  *heap;                                                                               \
+        type   inline_items[inline_capacity];                                                      \
+    } name##_t;                                                                                    \
+                                                                                                   \
+    void name##_init(name##_t *vector) {                                                           \
+        vector->length   = 0;                                                                      \
+        vector->capacity = (inline_capacity);                                                      \
+        vector->heap     = NULL;                                                                   \
+    }                                                                                              \
+                                                                                                   \
+    type *name##_get_data(name##_t *vector) {                                                      \
+        return vector->heap ? vector->heap : vector->inline_items;                                 \
+    }                                                                                              \
+                                                                                                   \
+    const type *name##_get_const_data(const name##_t *vector) {                                    \
+        return vector->heap ? vector->heap : vector->inline_items;                                 \
+    }                                                                                              \
+                                                                                                   \
+    int name##_reserve(name##_t *vector, size_t capacity) {                                        \
+        if (capacity <= vector->capacity)                                                          \
+            return 0;                                                                              \
+                                                                                                   \
+        type *const heap = realloc(vector->heap, capacity * sizeof(type));                         \
+        if (!heap)                                                                                 \
+            return 1;                                                                              \
+                                                                                                   \
+        if (!vector->heap)                                                                         \
+            memcpy(heap, vector->inline_items, vector->length * sizeof(type));                     \
+        vector->heap     = heap;                                                                   \
+        vector->capacity = capacity;                                                               \
+        return 0;                                                                                  \
+    }                                                                                              \
+                                                                                                   \
+    int name##_push(name##_t *vector, type item) {                                                 \
+        if (vector->length == vector->capacity &&                                                  \
+            name##_reserve(vector, vector->capacity * 2))                                          \
+            return 1;                                                                              \
+                                                                                                   \
+        name##_get_data(vector)[vector->length++] = item;                                          \
+        return 0;                                                                                  \
+    }                                                                                              \
+                                                                                                   \
+    void name##_free(name##_t *vector) {                                                           \
+        free(vector->heap);                                                                        \
+        name##_init(vector);                                                                       \
+    }
+
+#endif
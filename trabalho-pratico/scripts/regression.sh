@@ -0,0 +1,175 @@
+#!/bin/sh
+
+# This script runs the programs on small hand-written datasets that once
+# triggered bugs, and checks that the bugs are still fixed.
+
+# Copyright 2023 Humberto Gomes, José Lopes, José Matos
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+. "$(dirname "$0")/utils.sh"
+
+if [ $# -ne 0 ]; then
+	echo "Usage: $0" >&2
+	exit 1
+fi
+
+MAKEFILE_BUILDDIR="$REPO_DIR/$(get_makefile_const BUILDDIR)"
+MAIN_EXE="$MAKEFILE_BUILDDIR/$(get_makefile_const MAIN_EXENAME)"
+TEST_EXE="$MAKEFILE_BUILDDIR/$(get_makefile_const TEST_EXENAME)"
+for exe in "$MAIN_EXE" "$TEST_EXE"; do
+	if ! [ -x "$exe" ]; then
+		echo "$exe not yet built! Build it and try again. Leaving ..." >&2
+		exit 1
+	fi
+done
+
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIR"' EXIT
+FAILED=false
+
+# Writes a dataset with valid users (U0 to U4) and no reservations, to which
+# flights and passengers are then added.
+#
+# $1 - dataset directory
+write_base_dataset() {
+	mkdir -p "$1"
+	{
+		printf "id;name;email;phone_number;birth_date;sex;passport;"
+		printf "country_code;address;account_creation;pay_method;"
+		echo   "account_status"
+		for i in 0 1 2 3 4; do
+			printf "U%d;User %d;user%d@mail.pt;+351 91234567%d;" \
+				"$i" "$i" "$i" "$i"
+			printf "1990/01/01;F;PT00000%d;PT;Rua %d;" "$i" "$i"
+			echo   "2020/01/01 10:00:00;cash;active"
+		done
+	} > "$1/users.csv"
+
+	printf "id;user_id;hotel_id;hotel_name;hotel_stars;city_tax;address;" \
+		> "$1/reservations.csv"
+	printf "begin_date;end_date;price_per_night;includes_breakfast;" \
+		>> "$1/reservations.csv"
+	echo "room_details;rating;comment" >> "$1/reservations.csv"
+
+	printf "id;airline;plane_model;total_seats;origin;destination;" \
+		> "$1/flights.csv"
+	printf "schedule_departure_date;schedule_arrival_date;" >> "$1/flights.csv"
+	printf "real_departure_date;real_arrival_date;pilot;copilot;notes\n" \
+		>> "$1/flights.csv"
+
+	echo "flight_id;user_id" > "$1/passengers.csv"
+	: > "$1/input.txt"
+}
+
+# Adds a flight to a dataset.
+#
+# $1 - dataset directory
+# $2 - flight identifier
+# $3 - number of seats
+add_flight() {
+	printf "%s;TAP;A320;%d;LIS;OPO;2023/01/01 10:00:00;" "$2" "$3" \
+		>> "$1/flights.csv"
+	printf "2023/01/01 11:00:00;2023/01/01 10:00:00;2023/01/01 11:00:00;" \
+		>> "$1/flights.csv"
+	echo "Pilot A;Copilot B;" >> "$1/flights.csv"
+}
+
+# Runs the main program on a dataset, with the queries in its input.txt (none,
+# unless a check writes some).
+#
+# $1 - dataset directory
+# Return value - 0 on success, 1 on failure
+run_dataset() {
+	if ! (cd "$1" && "$MAIN_EXE" . input.txt > /dev/null); then
+		echo "Failed to run the main program on $1!" >&2
+		return 1
+	fi
+}
+
+# An overbooked flight whose passengers aren't contiguous must only be reported
+# once in flights_errors.csv.
+check_interleaved_passengers() {
+	DATASET="$WORK_DIR/interleaved-passengers"
+	write_base_dataset "$DATASET"
+	add_flight "$DATASET" 0000000001 1
+	add_flight "$DATASET" 0000000002 10
+	for line in 1:U0 2:U1 1:U2 2:U3 1:U4; do
+		echo "000000000${line%%:*};${line#*:}" >> "$DATASET/passengers.csv"
+	done
+
+	run_dataset "$DATASET" || return 1
+
+	COUNT="$(grep -c '^0000000001;' \
+		"$DATASET/Resultados/flights_errors.csv" 2> /dev/null)"
+	if [ "$COUNT" != 1 ]; then
+		printf "Overbooked flight reported %s times instead of once!\n" \
+			"${COUNT:-0}" >&2
+		return 1
+	fi
+}
+
+# Query 10 must count the months of a year outside the range of the database's
+# time cube.
+check_q10_old_year() {
+	DATASET="$WORK_DIR/q10-old-year"
+	write_base_dataset "$DATASET"
+	sed 's|^\(U0;.*;\)2020/01/01|\11999/05/01|' "$DATASET/users.csv" \
+		> "$DATASET/users.tmp"
+	mv "$DATASET/users.tmp" "$DATASET/users.csv"
+	echo "10 1999" > "$DATASET/input.txt"
+
+	run_dataset "$DATASET" || return 1
+
+	OUTPUT="$(cat "$DATASET/Resultados/command1_output.txt" 2> /dev/null)"
+	if [ "$OUTPUT" != "5;1;0;0;0;0" ]; then
+		printf "Wrong output of query 10 for 1999: %s\n" "$OUTPUT" >&2
+		return 1
+	fi
+}
+
+# Packed outputs must be verified along with the error files next to the pack.
+check_verify_packed() {
+	DATASET="$WORK_DIR/verify-packed"
+	write_base_dataset "$DATASET"
+	add_flight "$DATASET" 0000000001 1
+	echo "0000000001;U0" >> "$DATASET/passengers.csv"
+	echo "0000000001;U1" >> "$DATASET/passengers.csv"
+	printf "1 U0\n10\n" > "$DATASET/input.txt"
+
+	if ! "$TEST_EXE" --verify packed "$DATASET" "$DATASET/input.txt" \
+		"$WORK_DIR/verify" > "$WORK_DIR/verify.txt"; then
+		cat "$WORK_DIR/verify.txt" "$WORK_DIR/verify/packed/diff.txt" >&2
+		return 1
+	fi
+
+	if ! grep -q "^1 of 1 configurations gave the same outputs" \
+		"$WORK_DIR/verify.txt"; then
+		echo "Packed outputs weren't reported as the same!" >&2
+		return 1
+	fi
+}
+
+for check in check_interleaved_passengers check_q10_old_year \
+	check_verify_packed; do
+	echo "Running $check ..."
+	if ! "$check"; then
+		echo "$check failed!" >&2
+		FAILED=true
+	fi
+done
+
+if $FAILED; then
+	exit 1
+fi
+echo "All regression checks passed."
@@ -0,0 +1,157 @@
+#!/bin/sh
+
+# This script runs the program on synthetic datasets that stress the worst case
+# of each query and of the dataset loader, and records the slowest execution
+# and the highest memory usage of each query type, so that they can be tracked
+# over time.
+
+# Copyright 2023 Humberto Gomes, José Lopes, José Matos
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+. "$(dirname "$0")/utils.sh"
+
+usage() {
+	echo "Usage: $0 [-s scale] [-o history] [-c ceilings] [scenario ...]" >&2
+	echo "  -s scale     Dataset size (default: 1)" >&2
+	echo "  -o history   CSV file results are appended to" >&2
+	echo "               (default: stress-history.csv)" >&2
+	echo "  -c ceilings  CSV file with the maximum time and memory of each" >&2
+	echo "               scenario and query type, with the columns" >&2
+	echo "               scenario,query_type,max_time_us,max_memory_kib" >&2
+	echo "  scenario     Scenarios to run (default: all)" >&2
+	exit 1
+}
+
+SCALE=1
+HISTORY="$REPO_DIR/stress-history.csv"
+CEILINGS=""
+while getopts "s:o:c:" opt; do
+	case "$opt" in
+		s) SCALE="$OPTARG" ;;
+		o) HISTORY="$(realpath "$OPTARG")" ;;
+		c) CEILINGS="$(realpath "$OPTARG")" ;;
+		*) usage ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+SCENARIOS="$*"
+if [ -z "$SCENARIOS" ]; then
+	SCENARIOS="typical hot-hotel hot-airport heavy-users short-prefixes"
+	SCENARIOS="$SCENARIOS long-lines invalid-rows"
+fi
+
+if [ -n "$CEILINGS" ] && ! [ -f "$CEILINGS" ]; then
+	echo "Ceilings file ($CEILINGS) not found! Leaving ..." >&2
+	exit 1
+fi
+
+MAKEFILE_BUILDDIR="$REPO_DIR/$(get_makefile_const BUILDDIR)"
+MAIN_EXE="$MAKEFILE_BUILDDIR/$(get_makefile_const MAIN_EXENAME)"
+TEST_EXE="$MAKEFILE_BUILDDIR/$(get_makefile_const TEST_EXENAME)"
+GENERATOR_EXE="$MAKEFILE_BUILDDIR/$(get_makefile_const GENERATOR_EXENAME)"
+for exe in "$MAIN_EXE" "$TEST_EXE" "$GENERATOR_EXE"; do
+	if ! [ -x "$exe" ]; then
+		echo "$exe not yet built! Build it and try again. Leaving ..." >&2
+		exit 1
+	fi
+done
+
+if ! [ -f "$HISTORY" ]; then
+	printf "date,revision,scenario,scale,query_type,executions," > "$HISTORY"
+	echo "max_time_us,max_memory_kib" >> "$HISTORY"
+fi
+
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIR"' EXIT
+DATE="$(date -u +%Y-%m-%dT%H:%M:%SZ)"
+FAILED=false
+
+for scenario in $SCENARIOS; do
+	echo "Running scenario $scenario ..."
+	SCENARIO_DIR="$WORK_DIR/$scenario"
+	mkdir -p "$SCENARIO_DIR/dataset"
+
+	if ! "$GENERATOR_EXE" --scale "$SCALE" --scenario "$scenario" \
+		"$SCENARIO_DIR/dataset"; then
+
+		echo "Failed to generate scenario $scenario! Leaving ..." >&2
+		exit 1
+	fi
+
+	# The main program's outputs are the expected ones: only performance is
+	# being measured here, and both programs must agree
+	if ! (cd "$SCENARIO_DIR" &&
+		"$MAIN_EXE" dataset dataset/input.txt > /dev/null &&
+		mv Resultados expected); then
+
+		echo "Failed to run the main program on scenario $scenario!" >&2
+		FAILED=true
+		continue
+	fi
+
+	if ! (cd "$SCENARIO_DIR" && "$TEST_EXE" --csv results.csv dataset \
+		dataset/input.txt expected > /dev/null); then
+
+		echo "Failed to run the test program on scenario $scenario!" >&2
+		FAILED=true
+		continue
+	fi
+
+	# Slowest execution and highest memory usage of each query type, and the
+	# whole program's time and peak memory
+	< "$SCENARIO_DIR/results.csv" awk -F, \
+		-v date="$DATE" -v scenario="$scenario" -v scale="$SCALE" '
+		NR > 1 { revision = $2 }
+		$3 == "query_execution" {
+			count[$5]++
+			if ($9 > time[$5]) time[$5] = $9
+			if ($10 > memory[$5]) memory[$5] = $10
+		}
+		$3 == "program" && $4 == "total" { total_time = $9; total_memory = $10 }
+		END {
+			for (type in count)
+				printf "%s,%s,%s,%s,%s,%d,%d,%d\n", date, revision, scenario,
+					scale, type, count[type], time[type], memory[type]
+			printf "%s,%s,%s,%s,program,1,%d,%d\n", date, revision, scenario,
+				scale, total_time, total_memory
+		}' | sort -t, -k5,5n > "$SCENARIO_DIR/history.csv"
+
+	cat "$SCENARIO_DIR/history.csv" >> "$HISTORY"
+	cut -d, -f5-8 "$SCENARIO_DIR/history.csv" | column -t -s, \
+		-N "Query type,Executions,Max. time (us),Max. memory (KiB)"
+
+	if [ -n "$CEILINGS" ] && ! awk -F, -v scenario="$scenario" '
+		FNR == NR {
+			if ($1 == scenario) {
+				max_time[$2] = $3
+				max_memory[$2] = $4
+			}
+			next
+		}
+		($5 in max_time) && ($7 > max_time[$5] || $8 > max_memory[$5]) {
+			printf "Query type %s exceeded its ceiling (%d us, %d KiB)\n",
+				$5, $7, $8 > "/dev/stderr"
+			exceeded = 1
+		}
+		END { exit exceeded }' "$CEILINGS" "$SCENARIO_DIR/history.csv"; then
+
+		FAILED=true
+	fi
+done
+
+echo "Results appended to $HISTORY"
+if $FAILED; then
+	exit 1
+fi
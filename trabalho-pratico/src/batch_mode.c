@@ -22,12 +22,120 @@
  * See [the header file's documentation](@ref batch_mode_examples).
  */
 
+#include <errno.h>
+#include <glib.h>
 #include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
+#include "batch_mode.h"
+#include "dataset/dataset_input.h"
 #include "dataset/dataset_loader.h"
 #include "queries/query_dispatcher.h"
+#include "queries/query_explain.h"
+#include "queries/query_file_compiler.h"
 #include "queries/query_file_parser.h"
+#include "queries/query_output_compressor.h"
+#include "queries/query_output_pack.h"
+#include "queries/query_result_cache.h"
+#include "queries/query_slow_log.h"
+#include "testing/performance_trace.h"
+#include "utils/int_utils.h"
+#include "utils/output_sequencer.h"
+#include "utils/stream_utils.h"
+#include "utils/thread_pool.h"
+
+/** @brief Format of the path of the file where a query's output is written to. */
+#define BATCH_MODE_OUTPUT_PATH_FORMAT "Resultados/" QUERY_OUTPUT_PACK_ENTRY_NAME_FORMAT
+
+/**
+ * @brief Format of the path of the pack where a partition of a dataset writes the outputs of
+ *        queries sent to all partitions, to be merged.
+ */
+#define BATCH_MODE_PARTITION_PACK_PATH_FORMAT "Resultados/partition-%zu.pack"
+
+/**
+ * @brief   Maximum number of query output files being written at the same time.
+ * @details Only applies when outputs are written with `io_uring` (see ::async_file_writer_create).
+ */
+#define BATCH_MODE_MAX_FILES_IN_FLIGHT 64
+
+/**
+ * @brief   Number of slots in the reorder ring of outputs written to a pack.
+ * @details See ::output_sequencer_create. Outputs further ahead of the next one to be written are
+ *          kept in a hash table instead.
+ */
+#define BATCH_MODE_PACK_REORDER_CAPACITY 1024
+
+/**
+ * @brief   Gets the partition of a dataset a query is sent to.
+ * @details See ::query_type_partition_callback_t. Queries that can be sent to any partition are
+ *          spread among all of them by their line in the query file.
+ *
+ * @param instance    Query to be sent to a partition.
+ * @param npartitions Number of partitions the dataset is split into.
+ *
+ * @return The partition to send @p instance to, or ::QUERY_TYPE_PARTITION_ALL.
+ */
+size_t __batch_mode_get_partition(const query_instance_t *instance, size_t npartitions) {
+    const query_type_partition_callback_t partition =
+        query_type_get_partition_callback(query_instance_get_type(instance));
+    return partition ? partition(query_instance_get_argument_data(instance), npartitions)
+                     : query_instance_get_line_in_file(instance) % npartitions;
+}
+
+/**
+ * @brief   Checks if the output of a query is written to the pack of a partition of a dataset.
+ * @details Outputs of queries sent to all partitions are written to a pack, to be merged, while
+ *          queries sent to a single partition have their outputs written to their own files.
+ *
+ * @param instance    Query being run.
+ * @param npartitions Number of partitions the dataset is split into. `0` if it isn't.
+ *
+ * @return Whether @p instance is sent to all partitions.
+ */
+int __batch_mode_is_scattered(const query_instance_t *instance, size_t npartitions) {
+    return npartitions &&
+           __batch_mode_get_partition(instance, npartitions) == QUERY_TYPE_PARTITION_ALL;
+}
+
+/**
+ * @brief   Writes the path of the file where a query's output is written to.
+ * @details Compressed outputs (see ::query_output_compressor_set_shared) have the
+ *          ::QUERY_OUTPUT_COMPRESSOR_SUFFIX suffix.
+ *
+ * @param path Where to write the path to. Must be at least `PATH_MAX` characters long.
+ * @param line Line of the query in the query file.
+ */
+void __batch_mode_get_output_path(char *path, size_t line) {
+    const int length = sprintf(path, BATCH_MODE_OUTPUT_PATH_FORMAT, line);
+    if (query_output_compressor_get_shared())
+        strcpy(path + length, QUERY_OUTPUT_COMPRESSOR_SUFFIX);
+}
+
+/**
+ * @brief Creates the writer of the file of a query's output, compressed if there's a shared
+ *        compressor (see ::query_output_compressor_set_shared).
+ *
+ * @param line      Line of the query in the query file.
+ * @param formatted Whether the output of the query should be formatted (pretty printed).
+ *
+ * @return A new writer, or `NULL` on allocation failure.
+ */
+query_writer_t *__batch_mode_create_output(size_t line, int formatted) {
+    char path[PATH_MAX];
+    __batch_mode_get_output_path(path, line);
+
+    query_writer_t *const output = query_writer_create_deferred(path, formatted);
+    if (output)
+        query_writer_set_compressor(output, query_output_compressor_get_shared());
+    return output;
+}
 
 /**
  * @struct batch_mode_iter_data_t
@@ -37,10 +145,22 @@
  *     @brief Where to write opened query output writers to.
  * @var batch_mode_iter_data_t::i
  *     @brief Index of the query being currently dealt with.
+ * @var batch_mode_iter_data_t::pack
+ *     @brief Pack where to write query outputs to, or `NULL` for one file per query.
+ * @var batch_mode_iter_data_t::npartitions
+ *     @brief Number of partitions the dataset is split into (`0` if it isn't). When the dataset is
+ *            partitioned, only queries sent to all partitions are written to
+ *            ::batch_mode_iter_data_t::pack.
+ * @var batch_mode_iter_data_t::pack_lines
+ *     @brief Where to write the line (`size_t`) of every query whose output is written to
+ *            ::batch_mode_iter_data_t::pack to.
  */
 typedef struct {
-    query_writer_t **const outputs;
-    size_t                 i;
+    query_writer_t **const            outputs;
+    size_t                            i;
+    query_output_pack_writer_t *const pack;
+    const size_t                      npartitions;
+    GArray *const                     pack_lines;
 } batch_mode_iter_data_t;
 
 /**
@@ -51,13 +171,23 @@ typedef struct {
  */
 int __batch_mode_init_file_callback(void *user_data, const query_instance_t *instance) {
     batch_mode_iter_data_t *const iter_data = user_data;
+    const int scattered = __batch_mode_is_scattered(instance, iter_data->npartitions);
 
-    /* Parent directory creation is assured by error file output while loading the dataset */
-    char path[PATH_MAX];
-    sprintf(path, "Resultados/command%zu_output.txt", query_instance_get_line_in_file(instance));
+    if (iter_data->pack && (!iter_data->npartitions || scattered)) {
+        /* Outputs to be merged are partial (see query_type_get_partial), and never formatted */
+        const int merged =
+            scattered && query_type_get_merge_callback(query_instance_get_type(instance));
+        iter_data->outputs[iter_data->i] =
+            query_writer_create_buffered(query_instance_get_formatted(instance) && !merged);
 
-    iter_data->outputs[iter_data->i] =
-        query_writer_create(path, query_instance_get_formatted(instance));
+        const size_t line = query_instance_get_line_in_file(instance);
+        g_array_append_val(iter_data->pack_lines, line);
+    } else {
+        /* Parent directory creation is assured by error file output while loading the dataset */
+        iter_data->outputs[iter_data->i] =
+            __batch_mode_create_output(query_instance_get_line_in_file(instance),
+                                       query_instance_get_formatted(instance));
+    }
 
     if (!iter_data->outputs[iter_data->i]) {
         /* On failure, delete all writers already created */
@@ -70,9 +200,634 @@ int __batch_mode_init_file_callback(void *user_data, const query_instance_t *ins
     return 0;
 }
 
-int batch_mode_run(const char            *dataset_dir,
-                   const char            *query_file_path,
-                   performance_metrics_t *metrics) {
+/** @brief Comparison function for sorting and searching line numbers (`size_t`). */
+int __batch_mode_compare_lines(const void *a, const void *b) {
+    const size_t line_a = *(const size_t *) a, line_b = *(const size_t *) b;
+    return (line_a > line_b) - (line_a < line_b);
+}
+
+/**
+ * @struct batch_mode_pack_commit_data_t
+ * @brief  Data structure used in ::__batch_mode_commit_to_pack.
+ *
+ * @var batch_mode_pack_commit_data_t::pack
+ *     @brief Pack where to write query outputs to.
+ * @var batch_mode_pack_commit_data_t::lines
+ *     @brief Sorted lines (`size_t`) of the queries whose outputs are written to
+ *            ::batch_mode_pack_commit_data_t::pack. Sequence numbers are indices in this array.
+ */
+typedef struct {
+    query_output_pack_writer_t *const pack;
+    const GArray *const               lines;
+} batch_mode_pack_commit_data_t;
+
+/**
+ * @brief   Writes the output of a query to a pack, in the order of the query file.
+ * @details Called by an ::output_sequencer_t, so that outputs in packs are laid out in the same
+ *          order as their entries, and packs are read sequentially.
+ *
+ * @param user_data A pointer to a ::batch_mode_pack_commit_data_t.
+ * @param sequence  Index of the line of the query in ::batch_mode_pack_commit_data_t::lines.
+ * @param item      Writer with the output of the query (::query_writer_t), flushed afterwards.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation or IO failure.
+ */
+int __batch_mode_commit_to_pack(void *user_data, size_t sequence, void *item) {
+    const batch_mode_pack_commit_data_t *const commit_data = user_data;
+    query_writer_t *const                      output      = item;
+
+    size_t            length;
+    const char *const contents = query_writer_get_output(output, &length);
+    const size_t      line     = g_array_index(commit_data->lines, size_t, sequence);
+    const int retval = query_output_pack_writer_add(commit_data->pack, line, contents, length);
+    query_writer_flush(output);
+    return retval;
+}
+
+/**
+ * @struct batch_mode_flush_data_t
+ * @brief  Data structure used in ::__batch_mode_flush_callback.
+ *
+ * @var batch_mode_flush_data_t::sequencer
+ *     @brief Where to submit query outputs to be written to a pack in order, or `NULL` for one file
+ *            per query.
+ * @var batch_mode_flush_data_t::pack_lines
+ *     @brief Sorted lines (`size_t`) of the queries whose outputs are written to a pack.
+ * @var batch_mode_flush_data_t::files
+ *     @brief Where to write one file per query to, when ::batch_mode_flush_data_t::sequencer is
+ *            `NULL`.
+ * @var batch_mode_flush_data_t::failed
+ *     @brief Whether submitting any output to ::batch_mode_flush_data_t::sequencer failed.
+ * @var batch_mode_flush_data_t::npartitions
+ *     @brief Number of partitions the dataset is split into (`0` if it isn't). See
+ *            ::batch_mode_iter_data_t::npartitions.
+ */
+typedef struct {
+    output_sequencer_t *const  sequencer;
+    const GArray *const        pack_lines;
+    async_file_writer_t *const files;
+    int                        failed;
+    const size_t               npartitions;
+} batch_mode_flush_data_t;
+
+/**
+ * @brief   Called for queries that are done being executed, to write their outputs.
+ * @details Outputs are either submitted to be appended to a pack (once all previous lines are) or
+ *          to be written to their own files, and their buffers released, while other queries are
+ *          still being executed.
+ *
+ * @param user_data A pointer to a ::batch_mode_flush_data_t.
+ * @param n         Number of queries in @p instances.
+ * @param instances Queries whose outputs should be written.
+ * @param outputs   Writers with the output of each query in @p instances.
+ */
+void __batch_mode_flush_callback(void                         *user_data,
+                                 size_t                        n,
+                                 const query_instance_t *const instances[n],
+                                 query_writer_t *const         outputs[n]) {
+    batch_mode_flush_data_t *const flush_data = user_data;
+
+    for (size_t i = 0; i < n; ++i) {
+        const int to_pack =
+            flush_data->sequencer &&
+            (!flush_data->npartitions ||
+             __batch_mode_is_scattered(instances[i], flush_data->npartitions));
+        if (to_pack) {
+            const size_t  line     = query_instance_get_line_in_file(instances[i]);
+            const size_t *position = bsearch(&line,
+                                             flush_data->pack_lines->data,
+                                             flush_data->pack_lines->len,
+                                             sizeof(size_t),
+                                             __batch_mode_compare_lines);
+            if (!position ||
+                output_sequencer_submit(flush_data->sequencer,
+                                        position - (const size_t *) flush_data->pack_lines->data,
+                                        outputs[i]))
+                flush_data->failed = 1;
+        } else {
+            /* Failures are counted by the file writer */
+            query_writer_flush_async(outputs[i], flush_data->files);
+        }
+    }
+}
+
+/**
+ * @brief Creates the output files for a list of queries and runs those queries.
+ *
+ * @param database    Database to run queries on.
+ * @param list        List of queries to be run.
+ * @param metrics     Where to register program performance data to. Can be `NULL` for no
+ *                    profiling.
+ * @param pack        Pack where to write query outputs to. `NULL` for one file per query.
+ * @param npartitions Number of partitions the dataset in @p database is part of. `0` if it isn't
+ *                    partitioned. Otherwise, only the outputs of queries sent to all partitions
+ *                    are written to @p pack.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation or file IO failure. A message will also be printed to `stderr`.
+ */
+int __batch_mode_dispatch(const database_t           *database,
+                          query_instance_list_t      *list,
+                          performance_metrics_t      *metrics,
+                          query_output_pack_writer_t *pack,
+                          size_t                      npartitions) {
+    int retval = 0;
+
+    query_writer_t **const query_outputs =
+        malloc(sizeof(query_writer_t *) * query_instance_list_get_length(list));
+    if (!query_outputs) {
+        fputs("Failed to allocate list of query outputs!\n", stderr);
+        return 1;
+    }
+
+    GArray *const          pack_lines = g_array_new(FALSE, FALSE, sizeof(size_t));
+    batch_mode_iter_data_t iter_data  = {.outputs     = query_outputs,
+                                         .i           = 0,
+                                         .pack        = pack,
+                                         .npartitions = npartitions,
+                                         .pack_lines  = pack_lines};
+    if (query_instance_list_iter(list, __batch_mode_init_file_callback, &iter_data)) {
+        fputs("Failed to open one of the query outputs!\n", stderr);
+        g_array_free(pack_lines, TRUE);
+        free(query_outputs);
+        return 1;
+    }
+    g_array_sort(pack_lines, __batch_mode_compare_lines);
+
+    /* Queries run grouped by type, but their outputs are written to the pack in line order */
+    batch_mode_pack_commit_data_t commit_data = {.pack = pack, .lines = pack_lines};
+    output_sequencer_t           *sequencer   = NULL;
+    if (pack) {
+        sequencer = output_sequencer_create(BATCH_MODE_PACK_REORDER_CAPACITY,
+                                            __batch_mode_commit_to_pack,
+                                            &commit_data);
+        if (!sequencer) {
+            fputs("Failed to allocate sequencer of query outputs!\n", stderr);
+            for (size_t i = 0; i < query_instance_list_get_length(list); ++i)
+                query_writer_free(query_outputs[i]);
+            g_array_free(pack_lines, TRUE);
+            free(query_outputs);
+            return 1;
+        }
+    }
+
+    /* Without a pack, many output files are written at the same time, with io_uring if possible */
+    async_file_writer_t *files = NULL;
+    if (!pack || npartitions) {
+        files = async_file_writer_create(ASYNC_FILE_WRITER_METHOD_IO_URING,
+                                         BATCH_MODE_MAX_FILES_IN_FLIGHT);
+        if (!files) {
+            fputs("Failed to allocate writer of query outputs!\n", stderr);
+            if (sequencer)
+                output_sequencer_finish(sequencer); /* Nothing submitted, so nothing committed */
+            for (size_t i = 0; i < query_instance_list_get_length(list); ++i)
+                query_writer_free(query_outputs[i]);
+            g_array_free(pack_lines, TRUE);
+            free(query_outputs);
+            return 1;
+        }
+    }
+
+    /* Outputs are written (to the pack or to their files) as soon as their queries are done */
+    batch_mode_flush_data_t flush_data = {.sequencer   = sequencer,
+                                          .pack_lines  = pack_lines,
+                                          .files       = files,
+                                          .failed      = 0,
+                                          .npartitions = npartitions};
+    performance_trace_begin("Queries");
+    query_dispatcher_dispatch_list(database,
+                                   list,
+                                   query_outputs,
+                                   NULL,
+                                   metrics,
+                                   __batch_mode_flush_callback,
+                                   &flush_data);
+    performance_trace_end();
+
+    if (sequencer && output_sequencer_finish(sequencer))
+        flush_data.failed = 1;
+    if (flush_data.failed) {
+        fputs("Failed to write query outputs to the pack!\n", stderr);
+        retval = 1;
+    }
+
+    if (files) {
+        if (async_file_writer_finish(files)) {
+            fputs("Failed to write query output files!\n", stderr);
+            retval = 1;
+        }
+
+        performance_metrics_set_output_statistics(metrics, async_file_writer_get_statistics(files));
+        async_file_writer_free(files);
+    }
+
+    for (size_t i = 0; i < query_instance_list_get_length(list); ++i)
+        query_writer_free(query_outputs[i]);
+    g_array_free(pack_lines, TRUE);
+    free(query_outputs);
+    return retval;
+}
+
+/**
+ * @brief   Creates the output file of a duplicate query, from the output of the identical query.
+ * @details Callback for ::query_instance_list_iter_duplicates. The output file is a hard link to
+ *          the original one when possible, and a copy of it otherwise.
+ *
+ * @param user_data    Pack where query outputs are written to (::query_output_pack_writer_t), or
+ *                     `NULL` for one file per query. In a pack, the duplicate query's entry points
+ *                     to the original query's output.
+ * @param original     Executed query identical to the duplicate query.
+ * @param line_in_file Number of the line the duplicate query was on.
+ *
+ * @retval 0 Success.
+ * @retval 1 File IO failure. A message will also be printed to `stderr`.
+ */
+int __batch_mode_output_duplicate(void                   *user_data,
+                                  const query_instance_t *original,
+                                  size_t                  line_in_file) {
+    query_output_pack_writer_t *const pack          = user_data;
+    const size_t                      original_line = query_instance_get_line_in_file(original);
+
+    int failed;
+    if (pack) {
+        failed = query_output_pack_writer_add_duplicate(pack, original_line, line_in_file);
+    } else {
+        char original_path[PATH_MAX], path[PATH_MAX];
+        __batch_mode_get_output_path(original_path, original_line);
+        __batch_mode_get_output_path(path, line_in_file);
+
+        unlink(path); /* Output files from previous runs must be replaced */
+        failed = link(original_path, path) && stream_copy_file(original_path, path);
+    }
+
+    if (failed) {
+        fprintf(stderr, "Failed to write output of duplicate query (line %zu)!\n", line_in_file);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Runs a part of a list of queries in a child process.
+ * @details The child process never returns from this function. If `fork` fails, the queries are
+ *          run in the calling process instead.
+ *
+ * @param database Database to run queries on. Shared with the parent through copy-on-write pages.
+ * @param list     List of queries to be partially run.
+ * @param i        Index of the part of @p list to be run.
+ * @param n        Number of parts @p list is divided into.
+ *
+ * @return The identifier of the created process, `0` if the queries were run in the calling
+ *         process, or `-1` if they failed to run in the calling process.
+ */
+pid_t __batch_mode_fork_worker(const database_t      *database,
+                               query_instance_list_t *list,
+                               size_t                 i,
+                               size_t                 n) {
+    fflush(NULL); /* Don't let the child flush buffered IO from the parent */
+    const pid_t pid = fork();
+    if (pid > 0)
+        return pid;
+
+    int                          retval = 1;
+    query_instance_list_t *const part   = query_instance_list_clone_part(list, i, n);
+    if (part) {
+        retval = __batch_mode_dispatch(database, part, NULL, NULL, 0);
+        query_instance_list_free(part);
+    } else {
+        fputs("Failed to allocate list of queries!\n", stderr);
+    }
+
+    if (pid == 0) {
+        fflush(NULL);
+        _exit(retval); /* Don't free the database, as that would touch (and copy) all its pages */
+    }
+    return retval ? -1 : 0;
+}
+
+/**
+ * @brief Waits for a child process to exit.
+ * @param pid Identifier of the child process.
+ *
+ * @retval 0 The child process exited successfully.
+ * @retval 1 The child process failed, or couldn't be waited for.
+ */
+int __batch_mode_wait(pid_t pid) {
+    int status;
+    while (waitpid(pid, &status, 0) < 0)
+        if (errno != EINTR)
+            return 1;
+
+    return !WIFEXITED(status) || WEXITSTATUS(status);
+}
+
+/**
+ * @brief Runs a list of queries split among worker processes.
+ *
+ * @param database Database to run queries on.
+ * @param list     List of queries to be run.
+ * @param nworkers Number of worker processes.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure in at least one of the workers.
+ */
+int __batch_mode_dispatch_workers(const database_t      *database,
+                                  query_instance_list_t *list,
+                                  size_t                 nworkers) {
+    int retval = 0;
+
+    pid_t *const workers = malloc(sizeof(pid_t) * nworkers);
+    if (!workers) {
+        fputs("Failed to allocate list of workers!\n", stderr);
+        return 1;
+    }
+
+    for (size_t i = 0; i < nworkers; ++i) {
+        workers[i] = __batch_mode_fork_worker(database, list, i, nworkers);
+        if (workers[i] < 0)
+            retval = 1;
+    }
+
+    for (size_t i = 0; i < nworkers; ++i) {
+        if (workers[i] <= 0)
+            continue;
+
+        if (__batch_mode_wait(workers[i])) {
+            fprintf(stderr, "Query worker %zu failed!\n", i);
+            retval = 1;
+        }
+    }
+
+    free(workers);
+    return retval;
+}
+
+/**
+ * @struct batch_mode_cache_miss_t
+ * @brief  A query whose output wasn't in the result cache, to be stored after it's run.
+ *
+ * @var batch_mode_cache_miss_t::instance
+ *     @brief Query that will be run.
+ * @var batch_mode_cache_miss_t::key
+ *     @brief Canonical form of ::batch_mode_cache_miss_t::instance, owned by its list.
+ * @var batch_mode_cache_miss_t::key_length
+ *     @brief Number of bytes in ::batch_mode_cache_miss_t::key.
+ */
+typedef struct {
+    const query_instance_t *instance;
+    const char             *key;
+    size_t                  key_length;
+} batch_mode_cache_miss_t;
+
+/**
+ * @struct batch_mode_cache_data_t
+ * @brief  Data structure used in ::__batch_mode_fetch_cached and ::__batch_mode_is_not_cached.
+ *
+ * @var batch_mode_cache_data_t::cache
+ *     @brief Cache where to look queries up.
+ * @var batch_mode_cache_data_t::hits
+ *     @brief Set of the lines of the queries whose outputs were fetched from
+ *            ::batch_mode_cache_data_t::cache.
+ * @var batch_mode_cache_data_t::misses
+ *     @brief Array of ::batch_mode_cache_miss_t.
+ */
+typedef struct {
+    query_result_cache_t *const cache;
+    GHashTable *const           hits;
+    GArray *const               misses;
+} batch_mode_cache_data_t;
+
+/**
+ * @brief   Writes the output file of a query from the result cache, if it's there.
+ * @details Callback for ::query_instance_list_iter_keys. Explained queries (see
+ *          ::query_explain_is_explained) are never fetched.
+ *
+ * @param user_data  A pointer to a ::batch_mode_cache_data_t.
+ * @param instance   Query to be looked up.
+ * @param key        Canonical form of @p instance.
+ * @param key_length Number of bytes in @p key.
+ *
+ * @retval 0 Always, not to stop iteration.
+ */
+int __batch_mode_fetch_cached(void                   *user_data,
+                              const query_instance_t *instance,
+                              const char             *key,
+                              size_t                  key_length) {
+    batch_mode_cache_data_t *const cache_data = user_data;
+    const size_t                   line       = query_instance_get_line_in_file(instance);
+
+    char path[PATH_MAX];
+    sprintf(path, BATCH_MODE_OUTPUT_PATH_FORMAT, line);
+
+    /* Explained queries are always run, for how they were executed to be reported */
+    if (query_explain_is_explained(query_explain_get_shared(), instance) ||
+        query_result_cache_fetch(cache_data->cache, key, key_length, path)) {
+        const batch_mode_cache_miss_t miss = {.instance   = instance,
+                                              .key        = key,
+                                              .key_length = key_length};
+        g_array_append_val(cache_data->misses, miss);
+    } else {
+        g_hash_table_add(cache_data->hits, GSIZE_TO_POINTER(line));
+    }
+    return 0;
+}
+
+/**
+ * @brief   Checks if the output of a query wasn't fetched from the result cache.
+ * @details Callback for ::query_instance_list_clone_filtered.
+ *
+ * @param user_data A pointer to a ::batch_mode_cache_data_t.
+ * @param instance  Query to be checked.
+ *
+ * @return Whether @p instance must be run.
+ */
+int __batch_mode_is_not_cached(void *user_data, const query_instance_t *instance) {
+    const batch_mode_cache_data_t *const cache_data = user_data;
+    return !g_hash_table_contains(cache_data->hits,
+                                  GSIZE_TO_POINTER(query_instance_get_line_in_file(instance)));
+}
+
+/**
+ * @brief   Adds the outputs of the queries that were run to the result cache.
+ * @details Failing to add an output to the cache isn't fatal, as the output itself was written.
+ *
+ * @param cache_data Cache and the queries missing from it.
+ */
+void __batch_mode_store_cached(const batch_mode_cache_data_t *cache_data) {
+    for (size_t i = 0; i < cache_data->misses->len; ++i) {
+        const batch_mode_cache_miss_t *const miss =
+            &g_array_index(cache_data->misses, batch_mode_cache_miss_t, i);
+
+        char         path[PATH_MAX];
+        const size_t line = query_instance_get_line_in_file(miss->instance);
+        sprintf(path, BATCH_MODE_OUTPUT_PATH_FORMAT, line);
+        query_result_cache_store(cache_data->cache, miss->key, miss->key_length, path);
+    }
+}
+
+/**
+ * @brief   Runs a list of queries and creates the output files of its duplicate queries.
+ * @details With a result cache, the outputs of queries run before on the same dataset are copied
+ *          from the cache, and only the remaining queries are run (and then added to the cache).
+ *
+ * @param database Database to run queries on.
+ * @param list     List of queries to be run.
+ * @param metrics  Where to register program performance data to. Can be `NULL` for no profiling.
+ * @param nworkers Number of worker processes. `0` for running queries in this process.
+ * @param pack     Pack where to write query outputs to. `NULL` for one file per query. Not
+ *                 supported with worker processes.
+ * @param cache    Cache of query outputs. `NULL` for no cache. Not supported with @p pack.
+ *
+ * @retval 0 Success.
+ * @retval 1 Fatal failure. A message will also be printed to `stderr`.
+ */
+int __batch_mode_run_list(const database_t           *database,
+                          query_instance_list_t      *list,
+                          performance_metrics_t      *metrics,
+                          size_t                      nworkers,
+                          query_output_pack_writer_t *pack,
+                          query_result_cache_t       *cache) {
+    if (!cache || pack) {
+        const int retval = nworkers ? __batch_mode_dispatch_workers(database, list, nworkers)
+                                    : __batch_mode_dispatch(database, list, metrics, pack, 0);
+        if (retval)
+            return retval;
+
+        /* Only after all queries are done, so that the outputs of executed queries are complete */
+        return query_instance_list_iter_duplicates(list, __batch_mode_output_duplicate, pack) != 0;
+    }
+
+    batch_mode_cache_data_t cache_data = {
+        .cache  = cache,
+        .hits   = g_hash_table_new(g_direct_hash, g_direct_equal),
+        .misses = g_array_new(FALSE, FALSE, sizeof(batch_mode_cache_miss_t))};
+    query_instance_list_iter_keys(list, __batch_mode_fetch_cached, &cache_data);
+
+    int                    retval = 0;
+    query_instance_list_t *to_run = list;
+    if (g_hash_table_size(cache_data.hits)) {
+        to_run = query_instance_list_clone_filtered(list, __batch_mode_is_not_cached, &cache_data);
+        if (!to_run) {
+            fputs("Failed to allocate list of queries!\n", stderr);
+            retval = 1;
+            goto DEFER;
+        }
+    }
+
+    if (query_instance_list_get_length(to_run))
+        retval = nworkers ? __batch_mode_dispatch_workers(database, to_run, nworkers)
+                          : __batch_mode_dispatch(database, to_run, metrics, NULL, 0);
+    if (!retval)
+        retval = query_instance_list_iter_duplicates(list, __batch_mode_output_duplicate, NULL);
+    if (!retval)
+        __batch_mode_store_cached(&cache_data);
+
+    if (to_run != list)
+        query_instance_list_free(to_run);
+DEFER:
+    g_hash_table_unref(cache_data.hits);
+    g_array_unref(cache_data.misses);
+    return retval;
+}
+
+/**
+ * @brief   Adds the optional database data needed by a type of query to a set of flags.
+ * @details Callback for ::query_instance_list_iter_types. See ::database_set_data.
+ *
+ * @param user_data A pointer to a ::database_data_t, to be updated.
+ * @param n         Number of queries in @p instances. Unused.
+ * @param instances Queries of the same type.
+ *
+ * @retval 0 Always successful.
+ */
+int __batch_mode_add_required_data(void                         *user_data,
+                                   size_t                        n,
+                                   const query_instance_t *const instances[n]) {
+    database_data_t *const data = user_data;
+
+    switch (query_type_get_type_number(query_instance_get_type(instances[0]))) {
+        case 1:
+        case 2:
+            *data |= DATABASE_DATA_USER_FLIGHTS | DATABASE_DATA_USER_RESERVATIONS |
+                     DATABASE_DATA_ID_FILTERS;
+            break;
+        case 4:
+        case 8:
+            *data |= DATABASE_DATA_HOTEL_INDEXES;
+            break;
+        case 5:
+        case 6:
+        case 7:
+            *data |= DATABASE_DATA_FLIGHT_INDEXES;
+            break;
+        case 9:
+            *data |= DATABASE_DATA_USER_INDEXES;
+            break;
+        case 10:
+            *data |= DATABASE_DATA_USER_FLIGHTS;
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Writes the text of a query to the slow query log.
+ * @details Implementation of ::query_slow_log_text_callback_t. Query texts aren't kept in memory,
+ *          so the query's line is read from the query file again. Slow queries should be rare, so
+ *          that's cheaper than keeping every line.
+ *
+ * @param user_data Query file (`FILE *`), opened only for this method.
+ * @param query     Query whose text is to be written.
+ * @param out       Where to write the text of @p query to.
+ */
+void __batch_mode_write_query_text(void *user_data, const query_instance_t *query, FILE *out) {
+    FILE *const  query_file = user_data;
+    const size_t line       = query_instance_get_line_in_file(query);
+
+    char   *text     = NULL;
+    size_t  capacity = 0;
+    ssize_t length   = -1;
+
+    rewind(query_file);
+    for (size_t i = 0; i < line; ++i)
+        if ((length = getline(&text, &capacity, query_file)) < 0)
+            break;
+
+    if (length > 0) {
+        if (text[length - 1] == '\n')
+            text[length - 1] = '\0';
+        fputs(text, out);
+    }
+    free(text);
+}
+
+/**
+ * @brief   Loads a dataset and runs the queries in a query file.
+ * @details When the whole query file fits in a window, it's parsed before loading the dataset, so
+ *          that optional data not needed by any of its queries isn't loaded (see
+ *          ::database_set_data).
+ *
+ * @param dataset_dir     Path to the directory containing the dataset.
+ * @param query_file_path Path to the file containing the queries.
+ * @param metrics         Where to register program performance data to. Can be `NULL`.
+ * @param nworkers        Number of worker processes. `0` for running queries in this process.
+ * @param window          Maximum number of lines of the query file parsed and executed at once.
+ *                        `0` for the whole file.
+ * @param packed          Whether to write all query outputs to ::BATCH_MODE_PACK_PATH, instead of
+ *                        one file per query. Not supported with worker processes.
+ *
+ * @retval 0 Success.
+ * @retval 1 Fatal failure. A message will also be printed to `stderr`.
+ */
+int __batch_mode_run(const char            *dataset_dir,
+                     const char            *query_file_path,
+                     performance_metrics_t *metrics,
+                     size_t                 nworkers,
+                     size_t                 window,
+                     int                    packed) {
 
     int retval = 0;
 
@@ -82,8 +837,24 @@ int batch_mode_run(const char            *dataset_dir,
         fputs("Failed to read query file!\n", stderr);
         goto DEFER_1;
     }
+    stream_prefetch(fileno(query_file)); /* Later windows are read ahead while others run */
+
+    /* Slow queries are logged with their text, read from the query file again */
+    query_slow_log_t *const slow_log   = query_slow_log_get_shared();
+    FILE *const             query_text = slow_log ? fopen(query_file_path, "r") : NULL;
+    if (query_text)
+        query_slow_log_set_text_callback(slow_log, __batch_mode_write_query_text, query_text);
 
-    query_instance_list_t *const query_instance_list = query_file_parser_parse(query_file);
+    /*
+     * The first window of queries is parsed before loading the dataset. If it's the whole query
+     * file, only the data needed by its queries is loaded, and the file is read from its compiled
+     * form when it's cached and up to date.
+     */
+    const size_t           max_lines   = window ? window : SIZE_MAX;
+    size_t                 line_number = 1, window_start = 1, duplicates = 0;
+    query_instance_list_t *query_instance_list =
+        window ? query_file_parser_parse_window(query_file, max_lines, &line_number)
+               : query_file_compiler_parse(query_file_path, query_file);
     if (!query_instance_list) {
         retval = 1;
         fputs("Failed to allocate list of queries!\n", stderr);
@@ -97,42 +868,521 @@ int batch_mode_run(const char            *dataset_dir,
         goto DEFER_3;
     }
 
-    if (dataset_loader_load(database, dataset_dir, "Resultados", metrics)) {
+    if (line_number - window_start != max_lines) {
+        database_data_t data = 0;
+        query_instance_list_iter_types(query_instance_list, __batch_mode_add_required_data, &data);
+        database_set_data(database, data);
+    }
+
+    if (dataset_loader_load(database, dataset_dir, "Resultados", metrics, NULL)) {
         retval = 1;
         fputs("Failed to load dataset files!\n", stderr);
         goto DEFER_4;
     }
 
-    query_writer_t **const query_outputs =
-        malloc(sizeof(query_writer_t *) * query_instance_list_get_length(query_instance_list));
-    if (!query_outputs) {
-        retval = 1;
-        fputs("Failed to allocate list of query outputs!\n", stderr);
-        goto DEFER_4;
+    query_output_pack_writer_t *pack = NULL;
+    if (packed) {
+        /* Parent directory creation is assured by error file output while loading the dataset */
+        pack = query_output_pack_writer_create(BATCH_MODE_PACK_PATH);
+        if (!pack) {
+            retval = 1;
+            fputs("Failed to create pack of query outputs!\n", stderr);
+            goto DEFER_4;
+        }
     }
 
-    batch_mode_iter_data_t iter_data = {.outputs = query_outputs, .i = 0};
-    if (query_instance_list_iter(query_instance_list,
-                                 __batch_mode_init_file_callback,
-                                 &iter_data)) {
+    /* Outputs in a pack can't be copied from the cache, and cached outputs aren't compressed */
+    query_result_cache_t *const cache = packed || query_output_compressor_get_shared()
+                                            ? NULL
+                                            : query_result_cache_open(dataset_dir);
+
+    for (;;) {
+        duplicates += query_instance_list_get_duplicate_count(query_instance_list);
+        retval =
+            __batch_mode_run_list(database, query_instance_list, metrics, nworkers, pack, cache);
+        query_instance_list_free(query_instance_list);
+        query_instance_list = NULL;
+        if (retval || line_number - window_start != max_lines)
+            break;
+
+        window_start        = line_number;
+        query_instance_list = query_file_parser_parse_window(query_file, max_lines, &line_number);
+        if (!query_instance_list) {
+            retval = 1;
+            fputs("Failed to allocate list of queries!\n", stderr);
+            break;
+        }
+    }
+
+    performance_metrics_set_duplicate_query_count(metrics, duplicates);
+
+    if (cache) {
+        performance_metrics_set_result_cache_statistics(metrics,
+                                                        query_result_cache_get_statistics(cache));
+        query_result_cache_close(cache); /* Not fatal, as all outputs were written */
+    }
+
+    if (pack && query_output_pack_writer_finish(pack)) {
         retval = 1;
-        fputs("Failed to open one of the query outputs!\n", stderr);
-        goto DEFER_5;
+        fputs("Failed to write pack of query outputs!\n", stderr);
     }
 
-    query_dispatcher_dispatch_list(database, query_instance_list, query_outputs, metrics);
+    /* Measured after running queries, so that indexes built for them are accounted for */
+    if (metrics && !retval) {
+        memory_report_t *const report = database_get_memory_report(database);
+        if (!report)
+            fputs("Failed to measure memory usage of the database!\n", stderr);
+        performance_metrics_set_memory_report(metrics, report);
 
-    for (size_t i = 0; i < query_instance_list_get_length(query_instance_list); ++i)
-        query_writer_free(query_outputs[i]);
+        bloom_filter_statistics_t filter_statistics;
+        if (!database_get_id_filter_statistics(database, &filter_statistics))
+            performance_metrics_set_id_filter_statistics(metrics, &filter_statistics);
+
+        const database_catalog_t *const catalog = database_get_catalog(database);
+        if (catalog)
+            performance_metrics_set_catalog(metrics, catalog);
+    }
 
-DEFER_5:
-    free(query_outputs);
 DEFER_4:
     database_free(database);
 DEFER_3:
-    query_instance_list_free(query_instance_list);
+    if (query_instance_list)
+        query_instance_list_free(query_instance_list);
 DEFER_2:
+    if (query_text) {
+        query_slow_log_set_text_callback(slow_log, NULL, NULL);
+        fclose(query_text);
+    }
+    fclose(query_file);
+DEFER_1:
+    return retval;
+}
+
+/**
+ * @struct batch_mode_partition_t
+ * @brief  Data structure used in ::__batch_mode_is_sent_to_partition.
+ *
+ * @var batch_mode_partition_t::partition
+ *     @brief Partition of the dataset whose queries are chosen.
+ * @var batch_mode_partition_t::npartitions
+ *     @brief Number of partitions the dataset is split into.
+ */
+typedef struct {
+    size_t partition;
+    size_t npartitions;
+} batch_mode_partition_t;
+
+/**
+ * @brief   Checks if a query is sent to a partition of a dataset.
+ * @details Callback for ::query_instance_list_clone_filtered.
+ *
+ * @param user_data A pointer to a ::batch_mode_partition_t.
+ * @param instance  Query to be checked.
+ *
+ * @return Whether @p instance must be run in the partition.
+ */
+int __batch_mode_is_sent_to_partition(void *user_data, const query_instance_t *instance) {
+    const batch_mode_partition_t *const partition = user_data;
+    const size_t sent_to = __batch_mode_get_partition(instance, partition->npartitions);
+    return sent_to == partition->partition || sent_to == QUERY_TYPE_PARTITION_ALL;
+}
+
+/**
+ * @brief   Loads a partition of a dataset and runs the queries sent to it.
+ * @details Meant to be run in a child process, that only holds its partition of the dataset (see
+ *          ::database_set_partition). Outputs of queries sent only to this partition are written
+ *          to their files, and outputs of queries sent to all partitions are written to a pack, in
+ *          ::BATCH_MODE_PARTITION_PACK_PATH_FORMAT, to be merged. Error files are only written by
+ *          the first partition, as every partition validates the same entities.
+ *
+ * @param dataset_dir     Path to the directory containing the dataset.
+ * @param query_file_path Path to the file containing the queries.
+ * @param partition       Partition of the dataset to be loaded.
+ * @param npartitions     Number of partitions the dataset is split into.
+ *
+ * @retval 0 Success.
+ * @retval 1 Fatal failure. A message will also be printed to `stderr`.
+ */
+int __batch_mode_run_partition(const char *dataset_dir,
+                               const char *query_file_path,
+                               size_t      partition,
+                               size_t      npartitions) {
+    int retval = 1;
+
+    /* Threads are shared by all partitions, that run on the same machine */
+    thread_pool_set_default_thread_count(
+        max(thread_pool_get_default_thread_count() / npartitions, (size_t) 1));
+    query_type_set_partial(1);
+
+    FILE *const query_file = fopen(query_file_path, "r");
+    if (!query_file) {
+        fputs("Failed to read query file!\n", stderr);
+        goto DEFER_1;
+    }
+
+    query_instance_list_t *const all_queries = query_file_parser_parse(query_file);
     fclose(query_file);
+    if (!all_queries) {
+        fputs("Failed to allocate list of queries!\n", stderr);
+        goto DEFER_1;
+    }
+
+    batch_mode_partition_t filter = {.partition = partition, .npartitions = npartitions};
+    query_instance_list_t *const queries =
+        query_instance_list_clone_filtered(all_queries, __batch_mode_is_sent_to_partition, &filter);
+    if (!queries) {
+        fputs("Failed to allocate list of queries!\n", stderr);
+        goto DEFER_2;
+    }
+
+    database_t *const database = database_create();
+    if (!database) {
+        fputs("Failed to allocate database!\n", stderr);
+        goto DEFER_3;
+    }
+
+    database_data_t data = 0;
+    query_instance_list_iter_types(queries, __batch_mode_add_required_data, &data);
+    database_set_data(database, data);
+    database_set_partition(database, partition, npartitions);
+
+    if (dataset_loader_load(database, dataset_dir, partition ? NULL : "Resultados", NULL, NULL)) {
+        fputs("Failed to load dataset files!\n", stderr);
+        goto DEFER_4;
+    }
+
+    char path[PATH_MAX];
+    sprintf(path, BATCH_MODE_PARTITION_PACK_PATH_FORMAT, partition);
+    query_output_pack_writer_t *const pack = query_output_pack_writer_create(path);
+    if (!pack) {
+        fputs("Failed to create pack of query outputs!\n", stderr);
+        goto DEFER_4;
+    }
+
+    retval = __batch_mode_dispatch(database, queries, NULL, pack, npartitions);
+    if (query_output_pack_writer_finish(pack)) {
+        fputs("Failed to write pack of query outputs!\n", stderr);
+        retval = 1;
+    }
+
+DEFER_4:
+    database_free(database);
+DEFER_3:
+    query_instance_list_free(queries); /* Before all_queries, whose arguments it shares */
+DEFER_2:
+    query_instance_list_free(all_queries);
 DEFER_1:
     return retval;
 }
+
+/**
+ * @brief   Finds the output of a query in a pack.
+ * @details Entries in packs are sorted by line, so they're binary searched.
+ *
+ * @param reader     Pack to search.
+ * @param line       Line of the query in the query file.
+ * @param out_output Where to write the output of the query to.
+ * @param out_length Where to write the number of bytes in the output to.
+ *
+ * @retval 0 Success.
+ * @retval 1 The query isn't in @p reader.
+ */
+int __batch_mode_find_pack_entry(const query_output_pack_reader_t *reader,
+                                 size_t                            line,
+                                 const char                      **out_output,
+                                 size_t                           *out_length) {
+    size_t low = 0, high = query_output_pack_reader_get_count(reader);
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+
+        size_t            middle_line, length;
+        const char *const output =
+            query_output_pack_reader_get(reader, middle, &middle_line, &length);
+        if (middle_line == line) {
+            *out_output = output;
+            *out_length = length;
+            return 0;
+        } else if (middle_line < line) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @struct batch_mode_merge_data_t
+ * @brief  Data structure used in ::__batch_mode_merge_output.
+ *
+ * @var batch_mode_merge_data_t::packs
+ *     @brief Pack of outputs of every partition.
+ * @var batch_mode_merge_data_t::npartitions
+ *     @brief Number of partitions (and of packs in ::batch_mode_merge_data_t::packs).
+ * @var batch_mode_merge_data_t::partials
+ *     @brief Where to place the output of each partition for a query.
+ * @var batch_mode_merge_data_t::lengths
+ *     @brief Where to place the length of each output in ::batch_mode_merge_data_t::partials.
+ */
+typedef struct {
+    query_output_pack_reader_t *const *const packs;
+    const size_t                             npartitions;
+    const char                             **partials;
+    size_t                                  *lengths;
+} batch_mode_merge_data_t;
+
+/**
+ * @brief   Writes the output file of a query sent to all partitions of a dataset, from the output
+ *          of every partition.
+ * @details Callback for ::query_instance_list_iter. Queries sent to a single partition are skipped,
+ *          as that partition already wrote their outputs.
+ *
+ * @param user_data A pointer to a ::batch_mode_merge_data_t.
+ * @param instance  Query whose output is to be written.
+ *
+ * @retval 0 Success.
+ * @retval 1 Missing or malformed outputs, or allocation failure. A message will also be printed
+ *           to `stderr`.
+ */
+int __batch_mode_merge_output(void *user_data, const query_instance_t *instance) {
+    const batch_mode_merge_data_t *const merge_data = user_data;
+    if (!__batch_mode_is_scattered(instance, merge_data->npartitions))
+        return 0;
+
+    const size_t line = query_instance_get_line_in_file(instance);
+    for (size_t i = 0; i < merge_data->npartitions; ++i) {
+        if (__batch_mode_find_pack_entry(merge_data->packs[i],
+                                         line,
+                                         &merge_data->partials[i],
+                                         &merge_data->lengths[i])) {
+            fprintf(stderr, "Missing output of query (line %zu) in partition %zu!\n", line, i);
+            return 1;
+        }
+    }
+
+    query_writer_t *const output =
+        __batch_mode_create_output(line, query_instance_get_formatted(instance));
+    if (!output) {
+        fputs("Failed to allocate query output!\n", stderr);
+        return 1;
+    }
+
+    int                               failed = 0;
+    const query_type_merge_callback_t merge =
+        query_type_get_merge_callback(query_instance_get_type(instance));
+    if (merge) {
+        failed = merge(query_instance_get_argument_data(instance),
+                       merge_data->npartitions,
+                       merge_data->partials,
+                       merge_data->lengths,
+                       output);
+    } else {
+        /* Only one partition may have an output, written as is (see query_type_merge_callback_t) */
+        size_t i = 0;
+        while (i + 1 < merge_data->npartitions && !merge_data->lengths[i])
+            i++;
+        query_writer_write_rendered(output, merge_data->partials[i], merge_data->lengths[i], 0);
+    }
+
+    query_writer_free(output);
+    if (failed) {
+        fprintf(stderr, "Failed to merge outputs of query (line %zu)!\n", line);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes the output files of the queries sent to all partitions of a dataset.
+ *
+ * @param list        Queries run by the partitions.
+ * @param npartitions Number of partitions the dataset is split into.
+ *
+ * @retval 0 Success.
+ * @retval 1 Fatal failure. A message will also be printed to `stderr`.
+ */
+int __batch_mode_merge_partitions(query_instance_list_t *list, size_t npartitions) {
+    int retval = 1;
+
+    query_output_pack_reader_t **const packs = calloc(npartitions, sizeof(*packs));
+    const char **const                 partials = malloc(sizeof(const char *) * npartitions);
+    size_t *const                      lengths  = malloc(sizeof(size_t) * npartitions);
+    if (!packs || !partials || !lengths) {
+        fputs("Failed to allocate outputs of partitions!\n", stderr);
+        goto DEFER;
+    }
+
+    for (size_t i = 0; i < npartitions; ++i) {
+        char path[PATH_MAX];
+        sprintf(path, BATCH_MODE_PARTITION_PACK_PATH_FORMAT, i);
+        packs[i] = query_output_pack_reader_open(path);
+        if (!packs[i]) {
+            fprintf(stderr, "Failed to read outputs of partition %zu!\n", i);
+            goto DEFER;
+        }
+    }
+
+    batch_mode_merge_data_t merge_data = {.packs       = packs,
+                                          .npartitions = npartitions,
+                                          .partials    = partials,
+                                          .lengths     = lengths};
+    retval = query_instance_list_iter(list, __batch_mode_merge_output, &merge_data) != 0;
+
+DEFER:
+    for (size_t i = 0; packs && i < npartitions; ++i)
+        if (packs[i])
+            query_output_pack_reader_close(packs[i]);
+    free(packs);
+    free(partials);
+    free(lengths);
+    return retval;
+}
+
+/**
+ * @brief   Loads a partition of a dataset in a child process, and runs the queries sent to it.
+ * @details See ::__batch_mode_run_partition. The child process never returns from this function.
+ *
+ * @param dataset_dir     Path to the directory containing the dataset.
+ * @param query_file_path Path to the file containing the queries.
+ * @param partition       Partition of the dataset to be loaded.
+ * @param npartitions     Number of partitions the dataset is split into.
+ *
+ * @return The identifier of the created process, or `-1` if it couldn't be created.
+ */
+pid_t __batch_mode_fork_partition(const char *dataset_dir,
+                                  const char *query_file_path,
+                                  size_t      partition,
+                                  size_t      npartitions) {
+    fflush(NULL); /* Don't let the child flush buffered IO from the parent */
+    const pid_t pid = fork();
+    if (pid != 0)
+        return pid;
+
+    const int retval =
+        __batch_mode_run_partition(dataset_dir, query_file_path, partition, npartitions);
+    fflush(NULL);
+    _exit(retval);
+}
+
+int batch_mode_run(const char            *dataset_dir,
+                   const char            *query_file_path,
+                   performance_metrics_t *metrics) {
+    return __batch_mode_run(dataset_dir, query_file_path, metrics, 0, 0, 0);
+}
+
+int batch_mode_run_packed(const char            *dataset_dir,
+                          const char            *query_file_path,
+                          performance_metrics_t *metrics) {
+    return __batch_mode_run(dataset_dir, query_file_path, metrics, 0, 0, 1);
+}
+
+int batch_mode_run_workers(const char *dataset_dir, const char *query_file_path, size_t nworkers) {
+    return __batch_mode_run(dataset_dir, query_file_path, NULL, nworkers, 0, 0);
+}
+
+int batch_mode_run_windowed(const char            *dataset_dir,
+                            const char            *query_file_path,
+                            size_t                 window,
+                            performance_metrics_t *metrics) {
+    return __batch_mode_run(dataset_dir, query_file_path, metrics, 0, window, 0);
+}
+
+int batch_mode_run_loaded(const database_t      *database,
+                          const char            *query_file_path,
+                          performance_metrics_t *metrics) {
+    if (mkdir("Resultados", 0755) && errno != EEXIST) {
+        fputs("Failed to create output directory!\n", stderr);
+        return 1;
+    }
+
+    FILE *const query_file = fopen(query_file_path, "r");
+    if (!query_file) {
+        fputs("Failed to read query file!\n", stderr);
+        return 1;
+    }
+
+    query_instance_list_t *const list = query_file_parser_parse(query_file);
+    fclose(query_file);
+    if (!list) {
+        fputs("Failed to allocate list of queries!\n", stderr);
+        return 1;
+    }
+
+    performance_metrics_set_duplicate_query_count(metrics,
+                                                  query_instance_list_get_duplicate_count(list));
+    const int retval = __batch_mode_run_list(database, list, metrics, 0, NULL, NULL);
+    query_instance_list_free(list);
+    return retval;
+}
+
+int batch_mode_run_partitioned(const char *dataset_dir,
+                               const char *query_file_path,
+                               size_t      npartitions) {
+    if (strcmp(dataset_dir, DATASET_INPUT_MULTIPLEXED_PATH) == 0) {
+        fputs("Partitions can't load a dataset from stdin, as each one reads it!\n", stderr);
+        return 1;
+    }
+
+    /* Partitions may write outputs before the first one creates this directory for error files */
+    if (mkdir("Resultados", 0755) && errno != EEXIST) {
+        fputs("Failed to create output directory!\n", stderr);
+        return 1;
+    }
+
+    pid_t *const partitions = malloc(sizeof(pid_t) * npartitions);
+    if (!partitions) {
+        fputs("Failed to allocate list of partitions!\n", stderr);
+        return 1;
+    }
+
+    int retval = 0;
+    for (size_t i = 0; i < npartitions; ++i) {
+        partitions[i] = __batch_mode_fork_partition(dataset_dir, query_file_path, i, npartitions);
+        if (partitions[i] < 0) {
+            fprintf(stderr, "Failed to start partition %zu!\n", i);
+            retval = 1;
+        }
+    }
+
+    /* Parsed while partitions load the dataset, to know which outputs need to be merged */
+    query_instance_list_t *list       = NULL;
+    FILE *const            query_file = fopen(query_file_path, "r");
+    if (query_file) {
+        list = query_file_parser_parse(query_file);
+        fclose(query_file);
+        if (!list) {
+            fputs("Failed to allocate list of queries!\n", stderr);
+            retval = 1;
+        }
+    } else {
+        fputs("Failed to read query file!\n", stderr);
+        retval = 1;
+    }
+
+    for (size_t i = 0; i < npartitions; ++i) {
+        if (partitions[i] < 0)
+            continue;
+
+        if (__batch_mode_wait(partitions[i])) {
+            fprintf(stderr, "Partition %zu failed!\n", i);
+            retval = 1;
+        }
+    }
+
+    if (!retval)
+        retval = __batch_mode_merge_partitions(list, npartitions);
+    if (!retval)
+        retval =
+            query_instance_list_iter_duplicates(list, __batch_mode_output_duplicate, NULL) != 0;
+
+    for (size_t i = 0; i < npartitions; ++i) {
+        char path[PATH_MAX];
+        sprintf(path, BATCH_MODE_PARTITION_PACK_PATH_FORMAT, i);
+        unlink(path);
+    }
+
+    if (list)
+        query_instance_list_free(list);
+    free(partitions);
+    return retval;
+}
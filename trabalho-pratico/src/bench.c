@@ -0,0 +1,1036 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  bench.c
+ * @brief Contains the entry point to the microbenchmark program.
+ */
+
+#include <glib.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "queries/q08.h"
+#include "testing/benchmark.h"
+#include "utils/cpu_features.h"
+#include "utils/date_and_time.h"
+#include "utils/fixed_n_delimiter_parser.h"
+#include "utils/glib/GConstKeyHashTable.h"
+#include "utils/int_utils.h"
+#include "utils/output_sequencer.h"
+#include "utils/pool.h"
+#include "utils/ring_queue.h"
+#include "utils/single_pool_id_linked_list.h"
+#include "utils/string_pool.h"
+#include "utils/string_pool_no_duplicates.h"
+#include "utils/string_table.h"
+
+/** @brief Default number of timed repetitions of every benchmark. */
+#define BENCH_DEFAULT_REPETITIONS 15
+
+/**
+ * @struct bench_dataset_t
+ * @brief  Data from a dataset that benchmarks work on, so that they're run on realistic inputs.
+ *
+ * @var bench_dataset_t::user_lines
+ *     @brief Lines of `users.csv` (without the header or the line terminator).
+ * @var bench_dataset_t::user_line_lengths
+ *     @brief Length of every line in ::bench_dataset_t::user_lines (`size_t`).
+ * @var bench_dataset_t::user_ids
+ *     @brief Identifiers of all users.
+ * @var bench_dataset_t::user_names
+ *     @brief Names of all users.
+ * @var bench_dataset_t::hotel_names
+ *     @brief Hotel name of every reservation (with many duplicates).
+ * @var bench_dataset_t::dates
+ *     @brief Begin date of every reservation (`"YYYY/MM/DD"`).
+ * @var bench_dataset_t::daytimes
+ *     @brief Scheduled departure time of every flight (`"HH:MM:SS"`).
+ * @var bench_dataset_t::dates_and_times
+ *     @brief Scheduled departure date and time of every flight.
+ * @var bench_dataset_t::passenger_flights
+ *     @brief Flight identifier of every passenger (`uint32_t`).
+ * @var bench_dataset_t::flight_count
+ *     @brief One more than the largest value in ::bench_dataset_t::passenger_flights.
+ */
+typedef struct {
+    GPtrArray *user_lines;
+    GArray    *user_line_lengths;
+    GPtrArray *user_ids, *user_names;
+    GPtrArray *hotel_names;
+    GPtrArray *dates, *daytimes, *dates_and_times;
+    GArray    *passenger_flights;
+    size_t     flight_count;
+} bench_dataset_t;
+
+/**
+ * @brief Copies a column of a line of a dataset file.
+ *
+ * @param line   Line with `';'`-separated columns.
+ * @param column Index of the column to be copied.
+ *
+ * @return A copy of the column (to be `free`'d), or `NULL` if @p line doesn't have that many
+ *         columns (or on allocation failure).
+ */
+char *__bench_get_column(const char *line, size_t column) {
+    for (size_t i = 0; i < column; ++i) {
+        line = strchr(line, ';');
+        if (!line)
+            return NULL;
+        line++;
+    }
+    return strndup(line, strcspn(line, ";"));
+}
+
+/**
+ * @brief   Reads a file of a dataset, calling a callback for every line but the header.
+ * @details Line terminators are removed before the callback is called.
+ *
+ * @param dataset_path Path to the dataset's directory.
+ * @param file         Name of the file in the dataset.
+ * @param callback     Method called for every line, that returns `0` on success.
+ * @param dataset      Argument passed to @p callback.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure to open the file, or failure of @p callback.
+ */
+int __bench_read_file(const char      *dataset_path,
+                      const char      *file,
+                      int            (*callback)(bench_dataset_t *, char *, size_t),
+                      bench_dataset_t *dataset) {
+    char path[PATH_MAX];
+    snprintf(path, PATH_MAX, "%s/%s", dataset_path, file);
+    FILE *const stream = fopen(path, "r");
+    if (!stream)
+        return 1;
+
+    int     retval = 0;
+    char   *line   = NULL;
+    size_t  capacity;
+    ssize_t length;
+    for (size_t i = 0; (length = getline(&line, &capacity, stream)) != -1; ++i) {
+        while (length && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+            line[--length] = '\0';
+
+        if (i && (retval = callback(dataset, line, length)))
+            break;
+    }
+
+    free(line);
+    fclose(stream);
+    return retval;
+}
+
+/**
+ * @brief   Stores the data of a line of `users.csv`.
+ * @details Callback for ::__bench_read_file.
+ */
+int __bench_read_user(bench_dataset_t *dataset, char *line, size_t length) {
+    char *const id   = __bench_get_column(line, 0);
+    char *const name = __bench_get_column(line, 1);
+    if (!id || !name) {
+        free(id);
+        free(name);
+        return 0; /* Ignore malformed lines */
+    }
+
+    g_ptr_array_add(dataset->user_lines, strdup(line));
+    g_array_append_val(dataset->user_line_lengths, length);
+    g_ptr_array_add(dataset->user_ids, id);
+    g_ptr_array_add(dataset->user_names, name);
+    return 0;
+}
+
+/**
+ * @brief   Stores the data of a line of `reservations.csv`.
+ * @details Callback for ::__bench_read_file.
+ */
+int __bench_read_reservation(bench_dataset_t *dataset, char *line, size_t length) {
+    (void) length;
+
+    char *const hotel_name = __bench_get_column(line, 3);
+    char *const date       = __bench_get_column(line, 7);
+    if (!hotel_name || !date) {
+        free(hotel_name);
+        free(date);
+        return 0; /* Ignore malformed lines */
+    }
+
+    g_ptr_array_add(dataset->hotel_names, hotel_name);
+    g_ptr_array_add(dataset->dates, date);
+    return 0;
+}
+
+/**
+ * @brief   Stores the data of a line of `flights.csv`.
+ * @details Callback for ::__bench_read_file.
+ */
+int __bench_read_flight(bench_dataset_t *dataset, char *line, size_t length) {
+    (void) length;
+
+    char *const date_and_time = __bench_get_column(line, 6);
+    if (!date_and_time)
+        return 0; /* Ignore malformed lines */
+
+    const char *const daytime = strchr(date_and_time, ' ');
+    g_ptr_array_add(dataset->dates_and_times, date_and_time);
+    g_ptr_array_add(dataset->daytimes, strdup(daytime ? daytime + 1 : ""));
+    return 0;
+}
+
+/**
+ * @brief   Stores the data of a line of `passengers.csv`.
+ * @details Callback for ::__bench_read_file.
+ */
+int __bench_read_passenger(bench_dataset_t *dataset, char *line, size_t length) {
+    (void) length;
+
+    char *const flight_id = __bench_get_column(line, 0);
+    uint64_t    flight;
+    if (!flight_id || int_utils_parse_positive(&flight, flight_id) || flight >= UINT32_MAX) {
+        free(flight_id);
+        return 0; /* Ignore malformed lines */
+    }
+    free(flight_id);
+
+    const uint32_t flight32 = flight;
+    g_array_append_val(dataset->passenger_flights, flight32);
+    if (flight32 >= dataset->flight_count)
+        dataset->flight_count = flight32 + 1;
+    return 0;
+}
+
+/**
+ * @brief Frees data loaded by ::__bench_dataset_load.
+ * @param dataset Data to be freed.
+ */
+void __bench_dataset_free(bench_dataset_t *dataset) {
+    g_ptr_array_unref(dataset->user_lines);
+    g_array_unref(dataset->user_line_lengths);
+    g_ptr_array_unref(dataset->user_ids);
+    g_ptr_array_unref(dataset->user_names);
+    g_ptr_array_unref(dataset->hotel_names);
+    g_ptr_array_unref(dataset->dates);
+    g_ptr_array_unref(dataset->daytimes);
+    g_ptr_array_unref(dataset->dates_and_times);
+    g_array_unref(dataset->passenger_flights);
+}
+
+/**
+ * @brief Loads the data benchmarks work on from a dataset.
+ *
+ * @param dataset Where to load the data to. Must be freed with ::__bench_dataset_free, even on
+ *                failure.
+ * @param path    Path to the dataset's directory.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure to read a file of the dataset.
+ */
+int __bench_dataset_load(bench_dataset_t *dataset, const char *path) {
+    dataset->user_lines        = g_ptr_array_new_with_free_func(free);
+    dataset->user_line_lengths = g_array_new(FALSE, FALSE, sizeof(size_t));
+    dataset->user_ids          = g_ptr_array_new_with_free_func(free);
+    dataset->user_names        = g_ptr_array_new_with_free_func(free);
+    dataset->hotel_names       = g_ptr_array_new_with_free_func(free);
+    dataset->dates             = g_ptr_array_new_with_free_func(free);
+    dataset->daytimes          = g_ptr_array_new_with_free_func(free);
+    dataset->dates_and_times   = g_ptr_array_new_with_free_func(free);
+    dataset->passenger_flights = g_array_new(FALSE, FALSE, sizeof(uint32_t));
+    dataset->flight_count      = 0;
+
+    return __bench_read_file(path, "users.csv", __bench_read_user, dataset) ||
+           __bench_read_file(path, "reservations.csv", __bench_read_reservation, dataset) ||
+           __bench_read_file(path, "flights.csv", __bench_read_flight, dataset) ||
+           __bench_read_file(path, "passengers.csv", __bench_read_passenger, dataset);
+}
+
+/** @brief Number of items in every block of the pools created by benchmarks. */
+#define BENCH_POOL_BLOCK_CAPACITY 4096
+
+/**
+ * @brief   Item allocated by the benchmarks of ::pool_t, the size of a small entity.
+ * @details Its contents are never read.
+ */
+typedef struct {
+    uint64_t fields[8];
+} bench_pool_item_t;
+
+/**
+ * @struct bench_state_t
+ * @brief  State of a repetition of a benchmark whose data structure is created in its setup.
+ *
+ * @var bench_state_t::dataset
+ *     @brief Data the benchmark works on.
+ * @var bench_state_t::structure
+ *     @brief Data structure being benchmarked.
+ * @var bench_state_t::extra
+ *     @brief Data structure needed by some benchmarks, other than the one being benchmarked.
+ */
+typedef struct {
+    const bench_dataset_t *dataset;
+    void                  *structure;
+    void                  *extra;
+} bench_state_t;
+
+/**
+ * @brief   Allocates a ::bench_state_t.
+ * @details Auxiliary method for setups of benchmarks.
+ *
+ * @param data      The ::bench_dataset_t (::benchmark_t::data).
+ * @param structure Data structure being benchmarked, that is freed on failure with @p free_func.
+ * @param free_func Method to free @p structure with.
+ *
+ * @return The new state, or `NULL` on allocation failure.
+ */
+bench_state_t *__bench_state_create(void *data, void *structure, void (*free_func)(void *)) {
+    if (!structure)
+        return NULL;
+
+    bench_state_t *const state = malloc(sizeof(bench_state_t));
+    if (!state) {
+        free_func(structure);
+        return NULL;
+    }
+
+    state->dataset   = data;
+    state->structure = structure;
+    state->extra     = NULL;
+    return state;
+}
+
+/** @brief Frees a ::pool_t, as a `free` function. */
+void __bench_pool_free(void *pool) {
+    pool_free(pool);
+}
+
+/** @brief Setup of the ::pool_t benchmarks: creates an empty pool. */
+void *__bench_pool_setup(void *data) {
+    return __bench_state_create(
+        data,
+        pool_create(bench_pool_item_t, BENCH_POOL_BLOCK_CAPACITY),
+        __bench_pool_free);
+}
+
+/** @brief Teardown of the ::pool_t benchmarks. */
+void __bench_pool_teardown(void *state) {
+    bench_state_t *const bench_state = state;
+    pool_free(bench_state->structure);
+    free(bench_state);
+}
+
+/** @brief Allocates an item from a ::pool_t for every user in the dataset. */
+void __bench_pool_alloc_run(void *state) {
+    const bench_state_t *const bench_state = state;
+    for (size_t i = 0; i < bench_state->dataset->user_ids->len; ++i) {
+        bench_pool_item_t *const item = pool_alloc_item(bench_pool_item_t, bench_state->structure);
+        item->fields[0]               = i;
+    }
+}
+
+/** @brief Copies an item to a ::pool_t for every user in the dataset. */
+void __bench_pool_put_run(void *state) {
+    const bench_state_t *const bench_state = state;
+    bench_pool_item_t          item        = {0};
+    for (size_t i = 0; i < bench_state->dataset->user_ids->len; ++i) {
+        item.fields[0] = i;
+        pool_put_item(bench_pool_item_t, bench_state->structure, &item);
+    }
+}
+
+/** @brief Frees a ::string_pool_t, as a `free` function. */
+void __bench_string_pool_free(void *pool) {
+    string_pool_free(pool);
+}
+
+/** @brief Setup of the ::string_pool_t benchmark: creates an empty pool. */
+void *__bench_string_pool_setup(void *data) {
+    return __bench_state_create(data,
+                                string_pool_create(BENCH_POOL_BLOCK_CAPACITY * 16),
+                                __bench_string_pool_free);
+}
+
+/** @brief Teardown of the ::string_pool_t benchmark. */
+void __bench_string_pool_teardown(void *state) {
+    bench_state_t *const bench_state = state;
+    string_pool_free(bench_state->structure);
+    free(bench_state);
+}
+
+/** @brief Copies the name of every user to a ::string_pool_t. */
+void __bench_string_pool_put_run(void *state) {
+    const bench_state_t *const bench_state = state;
+    const GPtrArray *const     names       = bench_state->dataset->user_names;
+    for (size_t i = 0; i < names->len; ++i)
+        string_pool_put(bench_state->structure, g_ptr_array_index(names, i));
+}
+
+/** @brief Frees a ::string_pool_no_duplicates_t, as a `free` function. */
+void __bench_string_pool_no_duplicates_free(void *pool) {
+    string_pool_no_duplicates_free(pool);
+}
+
+/** @brief Setup of the ::string_pool_no_duplicates_t benchmark: creates an empty pool. */
+void *__bench_string_pool_no_duplicates_setup(void *data) {
+    return __bench_state_create(data,
+                                string_pool_no_duplicates_create(BENCH_POOL_BLOCK_CAPACITY * 16),
+                                __bench_string_pool_no_duplicates_free);
+}
+
+/** @brief Teardown of the ::string_pool_no_duplicates_t benchmark. */
+void __bench_string_pool_no_duplicates_teardown(void *state) {
+    bench_state_t *const bench_state = state;
+    string_pool_no_duplicates_free(bench_state->structure);
+    free(bench_state);
+}
+
+/** @brief Copies the hotel name of every reservation to a ::string_pool_no_duplicates_t. */
+void __bench_string_pool_no_duplicates_put_run(void *state) {
+    const bench_state_t *const bench_state = state;
+    const GPtrArray *const     names       = bench_state->dataset->hotel_names;
+    for (size_t i = 0; i < names->len; ++i)
+        string_pool_no_duplicates_put(bench_state->structure, g_ptr_array_index(names, i));
+}
+
+/** @brief Frees a ::single_pool_id_linked_list_pool_t, as a `free` function. */
+void __bench_linked_list_pool_free(void *pool) {
+    single_pool_id_linked_list_free_pool(pool);
+}
+
+/**
+ * @brief Setup of the ::single_pool_id_linked_list_t benchmarks: creates an empty pool and an
+ *        empty list for every flight.
+ */
+void *__bench_linked_list_setup(void *data) {
+    const bench_dataset_t *const dataset = data;
+    bench_state_t *const         state =
+        __bench_state_create(data,
+                             single_pool_id_linked_list_create_pool(BENCH_POOL_BLOCK_CAPACITY),
+                             __bench_linked_list_pool_free);
+    if (!state)
+        return NULL;
+
+    single_pool_id_linked_list_t *const lists =
+        malloc((dataset->flight_count + 1) * sizeof(single_pool_id_linked_list_t));
+    if (!lists) {
+        single_pool_id_linked_list_free_pool(state->structure);
+        free(state);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < dataset->flight_count; ++i)
+        lists[i] = single_pool_id_linked_list_create();
+    state->extra = lists;
+    return state;
+}
+
+/**
+ * @brief Adds every passenger to the list of its flight, like when a dataset is loaded.
+ * @param state State of the benchmark, from ::__bench_linked_list_setup.
+ */
+void __bench_linked_list_append_run(void *state) {
+    const bench_state_t *const          bench_state = state;
+    const GArray *const                 flights     = bench_state->dataset->passenger_flights;
+    single_pool_id_linked_list_t *const lists       = bench_state->extra;
+    for (size_t i = 0; i < flights->len; ++i)
+        single_pool_id_linked_list_append_beginning(bench_state->structure,
+                                                    &lists[g_array_index(flights, uint32_t, i)],
+                                                    i);
+}
+
+/** @brief Setup of the ::single_pool_id_linked_list_t traversal benchmark: fills all lists. */
+void *__bench_linked_list_traverse_setup(void *data) {
+    bench_state_t *const state = __bench_linked_list_setup(data);
+    if (state)
+        __bench_linked_list_append_run(state);
+    return state;
+}
+
+/** @brief Traverses the list of passengers of every flight. */
+void __bench_linked_list_traverse_run(void *state) {
+    const bench_state_t *const                    bench_state = state;
+    const single_pool_id_linked_list_pool_t *const pool       = bench_state->structure;
+    const single_pool_id_linked_list_t *const      lists      = bench_state->extra;
+
+    uint64_t sum = 0;
+    for (size_t i = 0; i < bench_state->dataset->flight_count; ++i)
+        for (single_pool_id_linked_list_t list = lists[i]; list;
+             list = single_pool_id_linked_list_get_next(pool, list))
+            sum += single_pool_id_linked_list_get_value(pool, list);
+    benchmark_consume(sum);
+}
+
+/** @brief Teardown of the ::single_pool_id_linked_list_t benchmarks. */
+void __bench_linked_list_teardown(void *state) {
+    bench_state_t *const bench_state = state;
+    single_pool_id_linked_list_free_pool(bench_state->structure);
+    free(bench_state->extra);
+    free(bench_state);
+}
+
+/**
+ * @brief   Callback for every column of a line of `users.csv`, that only counts its bytes.
+ * @details Parsing of the columns themselves is benchmarked separately.
+ */
+int __bench_parser_callback(void *user_data, char *token, size_t ntoken) {
+    (void) ntoken;
+    *(uint64_t *) user_data += strlen(token);
+    return 0;
+}
+
+/**
+ * @brief Schema of a line of `users.csv`, where every column is parsed by
+ *        ::__bench_parser_callback (see ::FIXED_N_DELIMITER_PARSER_DEFINE).
+ */
+#define BENCH_USER_SCHEMA(FIELD)                                                                   \
+    FIELD(__bench_parser_callback)                                                                 \
+    FIELD(__bench_parser_callback)                                                                 \
+    FIELD(__bench_parser_callback)                                                                 \
+    FIELD(__bench_parser_callback)                                                                 \
+    FIELD(__bench_parser_callback)                                                                 \
+    FIELD(__bench_parser_callback)                                                                 \
+    FIELD(__bench_parser_callback)                                                                 \
+    FIELD(__bench_parser_callback)                                                                 \
+    FIELD(__bench_parser_callback)                                                                 \
+    FIELD(__bench_parser_callback)                                                                 \
+    FIELD(__bench_parser_callback)                                                                 \
+    FIELD(__bench_parser_callback)
+
+/** @brief Parses a line of `users.csv`, calling the callbacks in ::BENCH_USER_SCHEMA directly. */
+FIXED_N_DELIMITER_PARSER_DEFINE(__bench_parse_user_line, ';', BENCH_USER_SCHEMA)
+
+/** @brief Parses every line of `users.csv` with a ::fixed_n_delimiter_parser_grammar_t. */
+void __bench_parser_run(void *state) {
+    const bench_state_t *const bench_state = state;
+    const bench_dataset_t     *dataset     = bench_state->dataset;
+
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < dataset->user_lines->len; ++i)
+        fixed_n_delimiter_parser_parse_slice(g_ptr_array_index(dataset->user_lines, i),
+                                             g_array_index(dataset->user_line_lengths, size_t, i),
+                                             bench_state->structure,
+                                             &bytes);
+    benchmark_consume(bytes);
+}
+
+/**
+ * @brief Parses every line of `users.csv` with a parser generated by
+ *        ::FIXED_N_DELIMITER_PARSER_DEFINE.
+ */
+void __bench_parser_specialized_run(void *data) {
+    const bench_dataset_t *const dataset = data;
+
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < dataset->user_lines->len; ++i)
+        __bench_parse_user_line(g_ptr_array_index(dataset->user_lines, i),
+                                g_array_index(dataset->user_line_lengths, size_t, i),
+                                &bytes);
+    benchmark_consume(bytes);
+}
+
+/** @brief Parses the begin date of every reservation. */
+void __bench_date_run(void *data) {
+    const GPtrArray *const dates = ((const bench_dataset_t *) data)->dates;
+
+    uint64_t sum = 0;
+    for (size_t i = 0; i < dates->len; ++i) {
+        date_t date = 0;
+        date_from_string(&date, g_ptr_array_index(dates, i));
+        sum += date;
+    }
+    benchmark_consume(sum);
+}
+
+/** @brief Parses the scheduled departure time of every flight. */
+void __bench_daytime_run(void *data) {
+    const GPtrArray *const daytimes = ((const bench_dataset_t *) data)->daytimes;
+
+    uint64_t sum = 0;
+    for (size_t i = 0; i < daytimes->len; ++i) {
+        daytime_t daytime = 0;
+        daytime_from_string(&daytime, g_ptr_array_index(daytimes, i));
+        sum += daytime;
+    }
+    benchmark_consume(sum);
+}
+
+/** @brief Parses the scheduled departure date and time of every flight. */
+void __bench_date_and_time_run(void *data) {
+    const GPtrArray *const dates_and_times = ((const bench_dataset_t *) data)->dates_and_times;
+
+    uint64_t sum = 0;
+    for (size_t i = 0; i < dates_and_times->len; ++i) {
+        date_and_time_t date_and_time = 0;
+        date_and_time_from_string(&date_and_time, g_ptr_array_index(dates_and_times, i));
+        sum += date_and_time;
+    }
+    benchmark_consume(sum);
+}
+
+/** @brief Frees a ::GConstKeyHashTable, as a `free` function. */
+void __bench_hash_table_free(void *table) {
+    g_const_key_hash_table_unref(table);
+}
+
+/** @brief Setup of the ::GConstKeyHashTable insertion benchmark: creates an empty table. */
+void *__bench_hash_table_setup(void *data) {
+    return __bench_state_create(data,
+                                g_const_key_hash_table_new(g_str_hash, g_str_equal),
+                                __bench_hash_table_free);
+}
+
+/** @brief Inserts the identifier of every user in a ::GConstKeyHashTable. */
+void __bench_hash_table_insert_run(void *state) {
+    const bench_state_t *const bench_state = state;
+    const GPtrArray *const     ids         = bench_state->dataset->user_ids;
+    for (size_t i = 0; i < ids->len; ++i)
+        g_const_key_hash_table_insert(bench_state->structure,
+                                      g_ptr_array_index(ids, i),
+                                      GSIZE_TO_POINTER(i + 1));
+}
+
+/**
+ * @brief Setup of the ::GConstKeyHashTable lookup benchmark: creates a table with all user
+ *        identifiers.
+ */
+void *__bench_hash_table_lookup_setup(void *data) {
+    bench_state_t *const state = __bench_hash_table_setup(data);
+    if (state)
+        __bench_hash_table_insert_run(state);
+    return state;
+}
+
+/** @brief Looks up the identifier of every user in a ::GConstKeyHashTable. */
+void __bench_hash_table_lookup_run(void *state) {
+    const bench_state_t *const bench_state = state;
+    const GPtrArray *const     ids         = bench_state->dataset->user_ids;
+
+    uint64_t sum = 0;
+    for (size_t i = 0; i < ids->len; ++i)
+        sum += GPOINTER_TO_SIZE(
+            g_const_key_hash_table_const_lookup(bench_state->structure, g_ptr_array_index(ids, i)));
+    benchmark_consume(sum);
+}
+
+/** @brief Teardown of the ::GConstKeyHashTable benchmarks. */
+void __bench_hash_table_teardown(void *state) {
+    bench_state_t *const bench_state = state;
+    g_const_key_hash_table_unref(bench_state->structure);
+    free(bench_state);
+}
+
+/** @brief Frees a ::string_table_t, as a `free` function. */
+void __bench_string_table_free(void *table) {
+    string_table_free(table);
+}
+
+/** @brief Setup of the ::string_table_t insertion benchmark: creates an empty table. */
+void *__bench_string_table_setup(void *data) {
+    return __bench_state_create(data, string_table_create(0), __bench_string_table_free);
+}
+
+/** @brief Inserts the identifier of every user in a ::string_table_t. */
+void __bench_string_table_insert_run(void *state) {
+    const bench_state_t *const bench_state = state;
+    const GPtrArray *const     ids         = bench_state->dataset->user_ids;
+    for (size_t i = 0; i < ids->len; ++i)
+        string_table_insert(bench_state->structure, g_ptr_array_index(ids, i), i);
+}
+
+/**
+ * @brief Setup of the ::string_table_t lookup benchmark: creates a table with all user
+ *        identifiers.
+ */
+void *__bench_string_table_lookup_setup(void *data) {
+    bench_state_t *const state = __bench_string_table_setup(data);
+    if (state)
+        __bench_string_table_insert_run(state);
+    return state;
+}
+
+/** @brief Looks up the identifier of every user in a ::string_table_t. */
+void __bench_string_table_lookup_run(void *state) {
+    const bench_state_t *const bench_state = state;
+    const GPtrArray *const     ids         = bench_state->dataset->user_ids;
+
+    uint64_t sum = 0;
+    for (size_t i = 0; i < ids->len; ++i) {
+        uint32_t value = 0;
+        string_table_lookup(bench_state->structure, g_ptr_array_index(ids, i), &value);
+        sum += value;
+    }
+    benchmark_consume(sum);
+}
+
+/** @brief Teardown of the ::string_table_t benchmarks. */
+void __bench_string_table_teardown(void *state) {
+    bench_state_t *const bench_state = state;
+    string_table_free(bench_state->structure);
+    free(bench_state);
+}
+
+/** @brief Number of slots in the reorder ring of the ::output_sequencer_t benchmark. */
+#define BENCH_SEQUENCER_CAPACITY 1024
+
+/**
+ * @brief Number of consecutive outputs submitted in reverse order by the ::output_sequencer_t
+ *        benchmark, as if they had been produced by different threads.
+ */
+#define BENCH_SEQUENCER_BLOCK 64
+
+/** @brief Commits an output of the ::output_sequencer_t benchmark, by consuming it. */
+int __bench_sequencer_commit(void *user_data, size_t sequence, void *item) {
+    (void) user_data;
+    benchmark_consume(sequence + GPOINTER_TO_SIZE(item));
+    return 0;
+}
+
+/** @brief Frees an ::output_sequencer_t, as a `free` function. */
+void __bench_sequencer_free(void *sequencer) {
+    output_sequencer_finish(sequencer);
+}
+
+/** @brief Setup of the ::output_sequencer_t benchmark: creates an empty sequencer. */
+void *__bench_sequencer_setup(void *data) {
+    return __bench_state_create(
+        data,
+        output_sequencer_create(BENCH_SEQUENCER_CAPACITY, __bench_sequencer_commit, NULL),
+        __bench_sequencer_free);
+}
+
+/**
+ * @brief Submits an output to an ::output_sequencer_t for every user in the dataset, in blocks of
+ *        ::BENCH_SEQUENCER_BLOCK outputs in reverse order.
+ */
+void __bench_sequencer_submit_run(void *state) {
+    const bench_state_t *const bench_state = state;
+    const size_t               n           = bench_state->dataset->user_ids->len;
+    for (size_t i = 0; i < n; ++i) {
+        const size_t block    = i - i % BENCH_SEQUENCER_BLOCK;
+        const size_t sequence = min(n, block + BENCH_SEQUENCER_BLOCK) - 1 - (i - block);
+        output_sequencer_submit(bench_state->structure, sequence, GSIZE_TO_POINTER(i + 1));
+    }
+}
+
+/** @brief Teardown of the ::output_sequencer_t benchmark. */
+void __bench_sequencer_teardown(void *state) {
+    bench_state_t *const bench_state = state;
+    output_sequencer_finish(bench_state->structure);
+    free(bench_state);
+}
+
+/** @brief Capacity of the queues in the ::ring_queue_t benchmarks. */
+#define BENCH_RING_QUEUE_CAPACITY 1024
+
+/** @brief Number of items pushed and popped at once in the ::ring_queue_t throughput benchmarks. */
+#define BENCH_RING_QUEUE_BATCH 32
+
+/** @brief Number of producer threads in the ::RING_QUEUE_MPMC benchmark. */
+#define BENCH_RING_QUEUE_PRODUCERS 4
+
+/**
+ * @struct bench_ring_queue_t
+ * @brief  Argument of a thread started by a ::ring_queue_t benchmark.
+ *
+ * @var bench_ring_queue_t::input
+ *     @brief Queue the thread pushes to (producers) or pops from (consumers).
+ * @var bench_ring_queue_t::output
+ *     @brief Queue the thread echoes popped items to (only in the handoff benchmark).
+ * @var bench_ring_queue_t::n
+ *     @brief Number of items a producer pushes.
+ */
+typedef struct {
+    ring_queue_t *input, *output;
+    size_t        n;
+} bench_ring_queue_t;
+
+/** @brief Pushes `1` to @p n to a ::ring_queue_t, in batches of ::BENCH_RING_QUEUE_BATCH items. */
+void __bench_ring_queue_push_all(ring_queue_t *queue, size_t n) {
+    void *items[BENCH_RING_QUEUE_BATCH];
+    for (size_t i = 0; i < n; i += BENCH_RING_QUEUE_BATCH) {
+        const size_t count = min(BENCH_RING_QUEUE_BATCH, n - i);
+        for (size_t j = 0; j < count; ++j)
+            items[j] = GSIZE_TO_POINTER(i + j + 1);
+
+        if (ring_queue_push_wait(queue, items, count))
+            return;
+    }
+}
+
+/** @brief Producer thread of the ::RING_QUEUE_MPMC benchmark. */
+void *__bench_ring_queue_producer(void *arg) {
+    const bench_ring_queue_t *const bench = arg;
+    __bench_ring_queue_push_all(bench->input, bench->n);
+    return NULL;
+}
+
+/** @brief Consumer thread of the ::RING_QUEUE_SPSC benchmark: pops until the queue is closed. */
+void *__bench_ring_queue_consumer(void *arg) {
+    const bench_ring_queue_t *const bench = arg;
+
+    void  *items[BENCH_RING_QUEUE_BATCH];
+    size_t count;
+    while ((count = ring_queue_pop_wait(bench->input, items, BENCH_RING_QUEUE_BATCH)))
+        for (size_t i = 0; i < count; ++i)
+            benchmark_consume(GPOINTER_TO_SIZE(items[i]));
+    return NULL;
+}
+
+/** @brief Thread of the handoff benchmark: echoes items back until the queue is closed. */
+void *__bench_ring_queue_echo(void *arg) {
+    const bench_ring_queue_t *const bench = arg;
+
+    void *item;
+    while (ring_queue_pop_wait(bench->input, &item, 1))
+        if (ring_queue_push_wait(bench->output, &item, 1))
+            break;
+    return NULL;
+}
+
+/**
+ * @brief Passes an item for every user in the dataset from a thread to another, through a
+ *        ::RING_QUEUE_SPSC ::ring_queue_t, in batches of ::BENCH_RING_QUEUE_BATCH items.
+ */
+void __bench_ring_queue_spsc_run(void *data) {
+    const bench_dataset_t *const dataset = data;
+
+    bench_ring_queue_t bench = {.input  = ring_queue_create(BENCH_RING_QUEUE_CAPACITY,
+                                                           RING_QUEUE_SPSC),
+                                .output = NULL,
+                                .n      = 0};
+    if (!bench.input)
+        return;
+
+    pthread_t consumer;
+    if (!pthread_create(&consumer, NULL, __bench_ring_queue_consumer, &bench)) {
+        __bench_ring_queue_push_all(bench.input, dataset->user_ids->len);
+        ring_queue_close(bench.input);
+        pthread_join(consumer, NULL);
+    }
+    ring_queue_free(bench.input);
+}
+
+/**
+ * @brief Passes an item for every user in the dataset from ::BENCH_RING_QUEUE_PRODUCERS threads to
+ *        another, through a ::RING_QUEUE_MPMC ::ring_queue_t, so that producers contend.
+ */
+void __bench_ring_queue_mpmc_run(void *data) {
+    const bench_dataset_t *const dataset = data;
+    const size_t                 n       = dataset->user_ids->len;
+
+    ring_queue_t *const queue = ring_queue_create(BENCH_RING_QUEUE_CAPACITY, RING_QUEUE_MPMC);
+    if (!queue)
+        return;
+
+    bench_ring_queue_t producers[BENCH_RING_QUEUE_PRODUCERS];
+    pthread_t          threads[BENCH_RING_QUEUE_PRODUCERS];
+    size_t             started = 0, expected = 0;
+    for (size_t i = 0; i < BENCH_RING_QUEUE_PRODUCERS; ++i) {
+        producers[started] = (bench_ring_queue_t) {
+            .input  = queue,
+            .output = NULL,
+            .n      = n / BENCH_RING_QUEUE_PRODUCERS + (i < n % BENCH_RING_QUEUE_PRODUCERS)};
+
+        if (!pthread_create(&threads[started], NULL, __bench_ring_queue_producer,
+                            &producers[started])) {
+            expected += producers[started].n;
+            started++;
+        }
+    }
+
+    void *items[BENCH_RING_QUEUE_BATCH];
+    for (size_t popped = 0; popped < expected;) {
+        const size_t count = ring_queue_pop_wait(queue, items, BENCH_RING_QUEUE_BATCH);
+        for (size_t i = 0; i < count; ++i)
+            benchmark_consume(GPOINTER_TO_SIZE(items[i]));
+        popped += count;
+    }
+
+    for (size_t i = 0; i < started; ++i)
+        pthread_join(threads[i], NULL);
+    ring_queue_free(queue);
+}
+
+/**
+ * @brief Sends an item to another thread and waits for it to come back, for every user in the
+ *        dataset, through two ::RING_QUEUE_SPSC ::ring_queue_t, to measure handoff latency.
+ */
+void __bench_ring_queue_handoff_run(void *data) {
+    const bench_dataset_t *const dataset = data;
+
+    bench_ring_queue_t bench = {.input  = ring_queue_create(1, RING_QUEUE_SPSC),
+                                .output = ring_queue_create(1, RING_QUEUE_SPSC),
+                                .n      = 0};
+    if (!bench.input || !bench.output)
+        goto DEFER_1;
+
+    pthread_t echo;
+    if (pthread_create(&echo, NULL, __bench_ring_queue_echo, &bench))
+        goto DEFER_1;
+
+    for (size_t i = 0; i < dataset->user_ids->len; ++i) {
+        void *item = GSIZE_TO_POINTER(i + 1);
+        if (ring_queue_push_wait(bench.input, &item, 1) ||
+            !ring_queue_pop_wait(bench.output, &item, 1))
+            break;
+        benchmark_consume(GPOINTER_TO_SIZE(item));
+    }
+
+    ring_queue_close(bench.input);
+    pthread_join(echo, NULL);
+
+DEFER_1:
+    ring_queue_free(bench.input);
+    ring_queue_free(bench.output);
+}
+
+/**
+ * @brief Runs all benchmarks and prints their results.
+ *
+ * @param dataset     Data the benchmarks work on.
+ * @param repetitions Number of timed repetitions of every benchmark.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __bench_run_all(bench_dataset_t *dataset, size_t repetitions) {
+    /* Timing kernels that give wrong results would be pointless */
+    printf("CPU features: %s\n\n", cpu_features_get_name(cpu_features_get()));
+    if (q08_verify_revenue_kernels()) {
+        fputs("SIMD kernels give different results than scalar ones!\n", stderr);
+        return 1;
+    }
+
+    const fixed_n_delimiter_parser_iter_callback_t callbacks[] = {
+        BENCH_USER_SCHEMA(FIXED_N_DELIMITER_PARSER_CALLBACK)};
+
+    fixed_n_delimiter_parser_grammar_t *const grammar =
+        fixed_n_delimiter_parser_grammar_new(';',
+                                             0 BENCH_USER_SCHEMA(FIXED_N_DELIMITER_PARSER_COUNT),
+                                             callbacks);
+    if (!grammar)
+        return 1;
+    bench_state_t parser_state = {.dataset = dataset, .structure = grammar, .extra = NULL};
+
+    const size_t users        = dataset->user_ids->len;
+    const size_t reservations = dataset->hotel_names->len;
+    const size_t flights      = dataset->dates_and_times->len;
+    const size_t passengers   = dataset->passenger_flights->len;
+
+    const benchmark_t benchmarks[] = {
+        {"pool_alloc_item", users, __bench_pool_setup, __bench_pool_alloc_run,
+         __bench_pool_teardown, dataset},
+        {"pool_put_item", users, __bench_pool_setup, __bench_pool_put_run, __bench_pool_teardown,
+         dataset},
+        {"string_pool_put (user names)", users, __bench_string_pool_setup,
+         __bench_string_pool_put_run, __bench_string_pool_teardown, dataset},
+        {"string_pool_no_duplicates_put (hotels)", reservations,
+         __bench_string_pool_no_duplicates_setup, __bench_string_pool_no_duplicates_put_run,
+         __bench_string_pool_no_duplicates_teardown, dataset},
+        {"linked_list_append (passengers)", passengers, __bench_linked_list_setup,
+         __bench_linked_list_append_run, __bench_linked_list_teardown, dataset},
+        {"linked_list_traverse (passengers)", passengers, __bench_linked_list_traverse_setup,
+         __bench_linked_list_traverse_run, __bench_linked_list_teardown, dataset},
+        {"parse_slice (users)", users, NULL, __bench_parser_run, NULL, &parser_state},
+        {"parse_specialized (users)", users, NULL, __bench_parser_specialized_run, NULL, dataset},
+        {"date_from_string", reservations, NULL, __bench_date_run, NULL, dataset},
+        {"daytime_from_string", flights, NULL, __bench_daytime_run, NULL, dataset},
+        {"date_and_time_from_string", flights, NULL, __bench_date_and_time_run, NULL, dataset},
+        {"hash_table_insert (user IDs)", users, __bench_hash_table_setup,
+         __bench_hash_table_insert_run, __bench_hash_table_teardown, dataset},
+        {"hash_table_lookup (user IDs)", users, __bench_hash_table_lookup_setup,
+         __bench_hash_table_lookup_run, __bench_hash_table_teardown, dataset},
+        {"string_table_insert (user IDs)", users, __bench_string_table_setup,
+         __bench_string_table_insert_run, __bench_string_table_teardown, dataset},
+        {"string_table_lookup (user IDs)", users, __bench_string_table_lookup_setup,
+         __bench_string_table_lookup_run, __bench_string_table_teardown, dataset},
+        {"output_sequencer_submit (reordered)", users, __bench_sequencer_setup,
+         __bench_sequencer_submit_run, __bench_sequencer_teardown, dataset},
+        {"ring_queue_spsc (batched)", users, NULL, __bench_ring_queue_spsc_run, NULL, dataset},
+        {"ring_queue_mpmc (4 producers, batched)", users, NULL, __bench_ring_queue_mpmc_run, NULL,
+         dataset},
+        {"ring_queue_handoff (round trips)", users, NULL, __bench_ring_queue_handoff_run, NULL,
+         dataset},
+    };
+
+    int retval = 0;
+    benchmark_print_header(stdout);
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(*benchmarks); ++i) {
+        if (!benchmarks[i].operations)
+            continue; /* No data in the dataset */
+
+        benchmark_result_t result;
+        if (benchmark_run(&benchmarks[i], repetitions, &result)) {
+            fprintf(stderr, "Failed to run benchmark \"%s\"!\n", benchmarks[i].name);
+            retval = 1;
+            break;
+        }
+        benchmark_print_result(stdout, &benchmarks[i], &result);
+        fflush(stdout);
+    }
+
+    fixed_n_delimiter_parser_grammar_free(grammar);
+    return retval;
+}
+
+/**
+ * @brief   The entry point to the microbenchmark program.
+ * @details Times the utilities the database is built on (pools, the line parser, date parsing and
+ *          hash tables) in isolation, on data from a dataset (see [benchmark](@ref benchmark.h)).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure.
+ */
+int main(int argc, char **argv) {
+    uint64_t repetitions = BENCH_DEFAULT_REPETITIONS;
+
+    while (argc > 1 && strncmp(argv[1], "--", 2) == 0) {
+        if (argc > 2 && strcmp(argv[1], "--repetitions") == 0) {
+            if (int_utils_parse_positive(&repetitions, argv[2]) || repetitions == 0) {
+                argc = 0; /* Invalid number: print usage */
+                break;
+            }
+        } else {
+            argc = 0; /* Unknown or invalid option: print usage */
+            break;
+        }
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc == 2) {
+        bench_dataset_t dataset;
+        if (__bench_dataset_load(&dataset, argv[1])) {
+            fprintf(stderr, "Failed to read dataset in \"%s\"!\n", argv[1]);
+            __bench_dataset_free(&dataset);
+            return 1;
+        }
+
+        const int retval = __bench_run_all(&dataset, repetitions);
+        __bench_dataset_free(&dataset);
+        return retval;
+    } else {
+        fputs("Invalid command-line arguments! Usage:\n", stderr);
+        fputs("./programa-bench [options] [dataset directory]\n\n", stderr);
+        fputs("Options:\n", stderr);
+        fputs("  --repetitions [n]  Timed repetitions of every benchmark (default: 15)\n", stderr);
+        return 1;
+    }
+}
@@ -25,10 +25,21 @@
 #include <stdlib.h>
 
 #include "database/database.h"
+#include "utils/int_utils.h"
+#include "utils/memory_budget.h"
+
+/**
+ * @brief Number of flights or reservations looked up (and prefetched) together when freezing a
+ *        database, few enough for all of them to stay in cache until read.
+ */
+#define DATABASE_LOOKUP_BATCH_SIZE 64
 
 /**
  * @struct database
  * @brief  A collection of managers of different entities.
+ * @details Managers are shared between a database and its clones (see ::database_clone), and only
+ *          copied by a database right before it modifies them. Each manager has a reference
+ *          counter (the number of databases using it), also shared between databases.
  *
  * @var database::users
  *     @brief All users and user relationships.
@@ -36,13 +47,242 @@
  *     @brief All reservations and reservations relationships.
  * @var database::flights
  *     @brief All flights and flight relationships.
+ * @var database::indexes
+ *     @brief   Secondary indexes over reservations and flights, built when first needed.
+ *     @details These point to entities in the other managers, so they're only shared while all
+ *              other managers are too.
+ * @var database::time_cube
+ *     @brief Event counts of every day, month and year, kept up to date as entities are added.
+ * @var database::users_references
+ *     @brief Number of databases using ::database::users.
+ * @var database::reservations_references
+ *     @brief Number of databases using ::database::reservations.
+ * @var database::flights_references
+ *     @brief Number of databases using ::database::flights.
+ * @var database::indexes_references
+ *     @brief Number of databases using ::database::indexes.
+ * @var database::time_cube_references
+ *     @brief Number of databases using ::database::time_cube.
+ * @var database::catalog
+ *     @brief Statistics about all entities, only valid when ::database::has_catalog is set.
+ * @var database::has_catalog
+ *     @brief Whether ::database::catalog describes the entities in the database.
+ * @var database::data
+ *     @brief Optional data kept in the database (see ::database_set_data).
+ * @var database::frozen
+ *     @brief Whether nothing was modified since the last call to ::database_freeze.
+ * @var database::partition
+ *     @brief Partition of the dataset kept in the database (see ::database_set_partition).
+ * @var database::partition_count
+ *     @brief Number of partitions the dataset is split into (`1` when it isn't partitioned).
  */
 struct database {
     user_manager_t        *users;
     reservation_manager_t *reservations;
     flight_manager_t      *flights;
+    index_manager_t       *indexes;
+    time_cube_t           *time_cube;
+
+    size_t *users_references;
+    size_t *reservations_references;
+    size_t *flights_references;
+    size_t *indexes_references;
+    size_t *time_cube_references;
+
+    database_catalog_t catalog;
+    int                has_catalog;
+
+    database_data_t data;
+    int             frozen;
+
+    size_t partition;
+    size_t partition_count;
 };
 
+/** @brief Flags for the managers of entities in a ::database_t. */
+typedef enum {
+    DATABASE_MANAGER_USERS        = 1 << 0, /**< @brief ::database::users */
+    DATABASE_MANAGER_RESERVATIONS = 1 << 1, /**< @brief ::database::reservations */
+    DATABASE_MANAGER_FLIGHTS      = 1 << 2, /**< @brief ::database::flights */
+    DATABASE_MANAGER_TIME_CUBE    = 1 << 3, /**< @brief ::database::time_cube */
+} database_manager_t;
+
+/**
+ * @brief  Callback for deep-copying a manager.
+ * @param  manager Manager to be copied.
+ * @return The copy of @p manager, or `NULL` on allocation failure.
+ */
+typedef void *(*database_clone_manager_callback_t)(const void *manager);
+
+/**
+ * @brief Callback for freeing a manager.
+ * @param manager Manager to be freed.
+ */
+typedef void (*database_free_manager_callback_t)(void *manager);
+
+/**
+ * @brief  Creates a reference counter for a manager used by a single database.
+ * @return The reference counter, or `NULL` on allocation failure.
+ */
+size_t *__database_create_references(void) {
+    size_t *const references = malloc(sizeof(size_t));
+    if (references)
+        *references = 1;
+    return references;
+}
+
+/**
+ * @brief Stops a database from using a manager, freeing it if no other database uses it.
+ *
+ * @param manager      Manager that's no longer used.
+ * @param references   Reference counter of @p manager. Freed alongside @p manager.
+ * @param free_manager Method to free @p manager.
+ */
+void __database_release(void                            *manager,
+                        size_t                          *references,
+                        database_free_manager_callback_t free_manager) {
+
+    if (__atomic_sub_fetch(references, 1, __ATOMIC_ACQ_REL) == 0) {
+        free_manager(manager);
+        free(references);
+    }
+}
+
+/**
+ * @brief Makes sure a manager of a database isn't shared with any other database.
+ *
+ * @param manager      Pointer to the manager, that may be replaced by a copy.
+ * @param references   Pointer to the reference counter of @p manager, that may be replaced by
+ *                     that of the copy.
+ * @param clone        Method to copy @p manager.
+ * @param free_manager Method to free @p manager.
+ *
+ * @return `NULL` on allocation failure (nothing is modified), the manager (new or not) otherwise.
+ */
+void *__database_unshare_manager(void                             *manager,
+                                 size_t                          **references,
+                                 database_clone_manager_callback_t clone,
+                                 database_free_manager_callback_t  free_manager) {
+
+    if (__atomic_load_n(*references, __ATOMIC_ACQUIRE) == 1)
+        return manager;
+
+    size_t *const new_references = __database_create_references();
+    if (!new_references)
+        return NULL;
+
+    void *const copy = clone(manager);
+    if (!copy) {
+        free(new_references);
+        return NULL;
+    }
+
+    __database_release(manager, *references, free_manager);
+    *references = new_references;
+    return copy;
+}
+
+/**
+ * @brief   Makes sure some managers of a database aren't shared with any other database, so that
+ *          they can be modified.
+ * @details The indexes are always made private, and invalidated when any of @p managers had to be
+ *          copied, as they'd point to entities in the managers that are no longer used. The
+ *          database is no longer frozen (see ::database_is_frozen), as it's going to be modified,
+ *          and its catalog is discarded if any entity manager is.
+ *
+ * @param database Database whose managers are going to be made private.
+ * @param managers Managers to be made private (::database_manager_t flags).
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (some managers may have been made private anyway).
+ */
+int __database_unshare(database_t *database, database_manager_t managers) {
+    database->frozen = 0; /* Every modification goes through here */
+    if (managers & (DATABASE_MANAGER_USERS | DATABASE_MANAGER_RESERVATIONS |
+                    DATABASE_MANAGER_FLIGHTS))
+        database->has_catalog = 0;
+
+    /* Indexes are rebuilt when needed, so there's no point in copying them */
+    const int indexes_shared =
+        __atomic_load_n(database->indexes_references, __ATOMIC_ACQUIRE) != 1;
+
+    size_t          *new_indexes_references = NULL;
+    index_manager_t *new_indexes            = NULL;
+    if (indexes_shared) {
+        new_indexes_references = __database_create_references();
+        new_indexes            = index_manager_create();
+        if (!new_indexes_references || !new_indexes) {
+            free(new_indexes_references);
+            if (new_indexes)
+                index_manager_free(new_indexes);
+            return 1;
+        }
+    }
+
+    const user_manager_t *const        old_users        = database->users;
+    const reservation_manager_t *const old_reservations = database->reservations;
+    const flight_manager_t *const      old_flights      = database->flights;
+
+    int failed = 0;
+    if (managers & DATABASE_MANAGER_USERS) {
+        user_manager_t *const users = __database_unshare_manager(
+            database->users,
+            &database->users_references,
+            (database_clone_manager_callback_t) user_manager_clone,
+            (database_free_manager_callback_t) user_manager_free);
+        failed |= !users;
+        if (users)
+            database->users = users;
+    }
+
+    if (!failed && (managers & DATABASE_MANAGER_RESERVATIONS)) {
+        reservation_manager_t *const reservations = __database_unshare_manager(
+            database->reservations,
+            &database->reservations_references,
+            (database_clone_manager_callback_t) reservation_manager_clone,
+            (database_free_manager_callback_t) reservation_manager_free);
+        failed |= !reservations;
+        if (reservations)
+            database->reservations = reservations;
+    }
+
+    if (!failed && (managers & DATABASE_MANAGER_FLIGHTS)) {
+        flight_manager_t *const flights = __database_unshare_manager(
+            database->flights,
+            &database->flights_references,
+            (database_clone_manager_callback_t) flight_manager_clone,
+            (database_free_manager_callback_t) flight_manager_free);
+        failed |= !flights;
+        if (flights)
+            database->flights = flights;
+    }
+
+    if (!failed && (managers & DATABASE_MANAGER_TIME_CUBE)) {
+        time_cube_t *const time_cube = __database_unshare_manager(
+            database->time_cube,
+            &database->time_cube_references,
+            (database_clone_manager_callback_t) time_cube_clone,
+            (database_free_manager_callback_t) time_cube_free);
+        failed |= !time_cube;
+        if (time_cube)
+            database->time_cube = time_cube;
+    }
+
+    /* Even on failure, indexes can't point to entities in managers that are no longer used */
+    if (indexes_shared) {
+        __database_release(database->indexes,
+                           database->indexes_references,
+                           (database_free_manager_callback_t) index_manager_free);
+        database->indexes            = new_indexes;
+        database->indexes_references = new_indexes_references;
+    } else if (database->users != old_users || database->reservations != old_reservations ||
+               database->flights != old_flights) {
+        index_manager_invalidate(database->indexes);
+    }
+
+    return failed;
+}
+
 database_t *database_create(void) {
     database_t *const database = malloc(sizeof(database_t));
     if (!database)
@@ -60,8 +300,42 @@ database_t *database_create(void) {
     if (!database->flights)
         goto DEFER_4;
 
+    database->indexes = index_manager_create();
+    if (!database->indexes)
+        goto DEFER_5;
+
+    database->time_cube = time_cube_create();
+    if (!database->time_cube)
+        goto DEFER_6;
+
+    database->users_references        = __database_create_references();
+    database->reservations_references = __database_create_references();
+    database->flights_references      = __database_create_references();
+    database->indexes_references      = __database_create_references();
+    database->time_cube_references    = __database_create_references();
+    if (!database->users_references || !database->reservations_references ||
+        !database->flights_references || !database->indexes_references ||
+        !database->time_cube_references)
+        goto DEFER_7;
+
+    database->has_catalog     = 0;
+    database->data            = DATABASE_DATA_ALL;
+    database->frozen          = 0;
+    database->partition       = 0;
+    database->partition_count = 1;
     return database;
 
+DEFER_7:
+    free(database->users_references);
+    free(database->reservations_references);
+    free(database->flights_references);
+    free(database->indexes_references);
+    free(database->time_cube_references);
+    time_cube_free(database->time_cube);
+DEFER_6:
+    index_manager_free(database->indexes);
+DEFER_5:
+    flight_manager_free(database->flights);
 DEFER_4:
     reservation_manager_free(database->reservations);
 DEFER_3:
@@ -73,32 +347,65 @@ DEFER_1:
 }
 
 database_t *database_clone(const database_t *database) {
+    if (!database->frozen)
+        return NULL;
+
     database_t *const clone = malloc(sizeof(database_t));
-    if (!database)
-        goto DEFER_1;
+    if (!clone)
+        return NULL;
 
-    clone->users = user_manager_clone(database->users);
-    if (!clone->users)
-        goto DEFER_2;
+    *clone = *database;
+    __atomic_add_fetch(clone->users_references, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(clone->reservations_references, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(clone->flights_references, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(clone->indexes_references, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(clone->time_cube_references, 1, __ATOMIC_RELAXED);
+    return clone;
+}
 
-    clone->reservations = reservation_manager_clone(database->reservations);
-    if (!clone->reservations)
-        goto DEFER_3;
+void database_set_data(database_t *database, database_data_t data) {
+    database->data = data;
+}
 
-    clone->flights = flight_manager_clone(database->flights);
-    if (!clone->flights)
-        goto DEFER_4;
+database_data_t database_get_data(const database_t *database) {
+    return database->data;
+}
 
-    return clone;
+void database_set_partition(database_t *database, size_t partition, size_t count) {
+    database->partition       = partition;
+    database->partition_count = count;
+}
 
-DEFER_4:
-    reservation_manager_free(clone->reservations);
-DEFER_3:
-    user_manager_free(clone->users);
-DEFER_2:
-    free(clone);
-DEFER_1:
-    return NULL;
+size_t database_get_partition_count(const database_t *database) {
+    return database->partition_count;
+}
+
+size_t database_get_user_partition(const char *user_id, size_t count) {
+    /* FNV-1a, so that the coordinator and every partition agree without sharing any state */
+    uint64_t hash = 0xcbf29ce484222325;
+    for (const char *c = user_id; *c; ++c)
+        hash = (hash ^ (uint8_t) *c) * 0x100000001b3;
+    return hash % count;
+}
+
+/**
+ * @brief   Checks if a user belongs to the partition of the dataset kept in a database.
+ * @details See ::database_set_partition.
+ *
+ * @param database   Database to check the partition of.
+ * @param user_index Index of the user in the database's user manager.
+ *
+ * @return Whether data associated with the user is to be kept in @p database.
+ */
+int __database_owns_user(const database_t *database, uint32_t user_index) {
+    if (database->partition_count == 1)
+        return 1;
+
+    const user_t *const user = user_manager_get_by_index(database->users, user_index);
+    if (!user)
+        return 0;
+    return database_get_user_partition(user_get_const_id(user), database->partition_count) ==
+           database->partition;
 }
 
 const user_manager_t *database_get_users(const database_t *database) {
@@ -113,47 +420,625 @@ const flight_manager_t *database_get_flights(const database_t *database) {
     return database->flights;
 }
 
+const GConstPtrArray *database_get_hotel_reservations(const database_t *database,
+                                                      hotel_id_t        hotel_id) {
+    return index_manager_get_hotel_reservations(database->indexes,
+                                                database->reservations,
+                                                hotel_id);
+}
+
+int database_has_hotel_reservations(const database_t *database) {
+    return index_manager_has_hotel_reservations(database->indexes);
+}
+
+const index_manager_hotel_nights_t *database_get_hotel_nights(const database_t *database,
+                                                              hotel_id_t        hotel_id) {
+    return index_manager_get_hotel_nights(database->indexes, database->reservations, hotel_id);
+}
+
+const GConstPtrArray *database_get_origin_flights(const database_t *database,
+                                                  airport_code_t    origin) {
+    return index_manager_get_origin_flights(database->indexes, database->flights, origin);
+}
+
+const GArray *database_get_origin_departures(const database_t *database, airport_code_t origin) {
+    return index_manager_get_origin_departures(database->indexes, database->flights, origin);
+}
+
+int database_iter_origin_flights(const database_t                            *database,
+                                 index_manager_iter_origin_flights_callback_t callback,
+                                 void                                        *user_data) {
+    return index_manager_iter_origin_flights(database->indexes,
+                                             database->flights,
+                                             callback,
+                                             user_data);
+}
+
+const GArray *database_get_year_airport_passengers(const database_t *database, uint16_t year) {
+    return index_manager_get_year_airport_passengers(database->indexes, database->flights, year);
+}
+
+const time_cube_t *database_get_time_cube(const database_t *database) {
+    return database->time_cube;
+}
+
+int database_restore_unique_passengers(database_t                          *database,
+                                       const time_cube_unique_passengers_t *entries,
+                                       size_t                               n) {
+    if (__database_unshare(database, DATABASE_MANAGER_TIME_CUBE))
+        return 1;
+
+    return time_cube_restore_unique_passengers(database->time_cube, entries, n);
+}
+
+const database_catalog_t *database_get_catalog(const database_t *database) {
+    return database->frozen && database->has_catalog ? &database->catalog : NULL;
+}
+
+void database_restore_catalog(database_t *database, const database_catalog_t *catalog) {
+    database->catalog     = *catalog;
+    database->has_catalog = 1;
+}
+
+const GArray *database_get_origin_delay_medians(const database_t *database) {
+    return index_manager_get_origin_delay_medians(database->indexes, database->flights);
+}
+
+int database_get_origin_delay_median_index(const database_t *database, const GArray **medians) {
+    return index_manager_get_built_origin_delay_medians(database->indexes, medians);
+}
+
+int database_restore_origin_delay_median_index(database_t *database, GArray *medians) {
+    /* Makes the indexes private, without copying any manager */
+    if (__database_unshare(database, 0)) {
+        g_array_unref(medians);
+        return 1;
+    }
+
+    index_manager_restore_origin_delay_medians(database->indexes, medians);
+    return 0;
+}
+
+int database_get_users_by_name_prefix(const database_t                 *database,
+                                      const char                       *prefix,
+                                      const index_manager_user_name_t **matches,
+                                      size_t                           *n) {
+    return index_manager_get_users_by_name_prefix(database->indexes,
+                                                  database->users,
+                                                  prefix,
+                                                  matches,
+                                                  n);
+}
+
+int database_get_user_name_index(const database_t     *database,
+                                 const GArray        **entries,
+                                 const prefix_trie_t **trie) {
+    return index_manager_get_user_names(database->indexes, entries, trie);
+}
+
+int database_restore_user_name_index(database_t *database,
+                                     GArray     *entries,
+                                     const void *trie_data,
+                                     size_t      length) {
+    /* Makes the indexes private, without copying any manager */
+    if (__database_unshare(database, 0)) {
+        g_array_unref(entries);
+        return 1;
+    }
+
+    return index_manager_restore_user_names(database->indexes, entries, trie_data, length);
+}
+
+/**
+ * @brief Counts a user in the time cube of a database, in the day its account was created.
+ *
+ * @param database Database whose time cube isn't shared.
+ * @param user     User to be counted.
+ */
+void __database_count_user(database_t *database, const user_t *user) {
+    time_cube_add(database->time_cube,
+                  TIME_CUBE_MEASURE_USERS,
+                  date_and_time_get_date(user_get_account_creation_date(user)),
+                  1);
+}
+
 int database_add_user(database_t *database, const user_t *user) {
-    return user_manager_add_user(database->users, user);
+    if (__database_unshare(database, DATABASE_MANAGER_USERS | DATABASE_MANAGER_TIME_CUBE))
+        return 1;
+
+    index_manager_invalidate(database->indexes);
+    if (user_manager_add_user(database->users, user))
+        return 1;
+
+    __database_count_user(database, user);
+    return 0;
+}
+
+int database_add_users(database_t *database, const user_t *const *users, size_t n) {
+    if (__database_unshare(database, DATABASE_MANAGER_USERS | DATABASE_MANAGER_TIME_CUBE))
+        return 1;
+
+    index_manager_invalidate(database->indexes);
+    if (user_manager_add_users(database->users, users, n))
+        return 1;
+
+    for (size_t i = 0; i < n; ++i)
+        __database_count_user(database, users[i]);
+    return 0;
 }
 
 int database_add_reservation(database_t *database, const reservation_t *reservation) {
+    if (!__database_owns_user(database, reservation_get_user_index(reservation)))
+        return 0;
+
+    if (__database_unshare(database,
+                           DATABASE_MANAGER_USERS | DATABASE_MANAGER_RESERVATIONS |
+                               DATABASE_MANAGER_TIME_CUBE))
+        return 1;
+
+    index_manager_invalidate(database->indexes);
     if (reservation_manager_add_reservation(database->reservations, reservation))
         return 1;
+    time_cube_add(database->time_cube,
+                  TIME_CUBE_MEASURE_RESERVATIONS,
+                  reservation_get_begin_date(reservation),
+                  1);
 
+    if (!(database->data & DATABASE_DATA_USER_RESERVATIONS))
+        return 0;
     return user_manager_add_user_reservation_association(database->users,
-                                                         reservation_get_const_user_id(reservation),
+                                                         reservation_get_user_index(reservation),
                                                          reservation_get_id(reservation));
 }
 
+int database_add_reservations(database_t                 *database,
+                              const reservation_t *const *reservations,
+                              size_t                      n) {
+    if (database->partition_count != 1) {
+        for (size_t i = 0; i < n; ++i)
+            if (database_add_reservation(database, reservations[i]))
+                return 1;
+        return 0;
+    }
+
+    if (__database_unshare(database,
+                           DATABASE_MANAGER_USERS | DATABASE_MANAGER_RESERVATIONS |
+                               DATABASE_MANAGER_TIME_CUBE))
+        return 1;
+
+    index_manager_invalidate(database->indexes);
+    if (reservation_manager_add_reservations(database->reservations, reservations, n))
+        return 1;
+    for (size_t i = 0; i < n; ++i)
+        time_cube_add(database->time_cube,
+                      TIME_CUBE_MEASURE_RESERVATIONS,
+                      reservation_get_begin_date(reservations[i]),
+                      1);
+
+    if (!(database->data & DATABASE_DATA_USER_RESERVATIONS))
+        return 0;
+    for (size_t i = 0; i < n; ++i)
+        if (user_manager_add_user_reservation_association(
+                database->users,
+                reservation_get_user_index(reservations[i]),
+                reservation_get_id(reservations[i])))
+            return 1;
+    return 0;
+}
+
+int database_reserve_users(database_t *database, size_t count) {
+    if (__database_unshare(database, DATABASE_MANAGER_USERS))
+        return 1;
+
+    return user_manager_reserve(database->users, count);
+}
+
+int database_reserve_reservations(database_t *database, size_t count) {
+    if (__database_unshare(database, DATABASE_MANAGER_USERS | DATABASE_MANAGER_RESERVATIONS))
+        return 1;
+
+    return reservation_manager_reserve(database->reservations, count) ||
+           ((database->data & DATABASE_DATA_USER_RESERVATIONS) &&
+            user_manager_reserve_reservation_associations(database->users, count));
+}
+
+/**
+ * @brief   Counts a flight and its passengers in the time cube of a database.
+ * @details Flights restored from [snapshots](@ref dataset_snapshot.h) already have passengers,
+ *          that aren't added with ::database_add_passengers, so they're counted here.
+ *
+ * @param database Database whose time cube isn't shared.
+ * @param flight   Flight to be counted.
+ * @param sign     `1` to count @p flight, or `-1` to stop counting it.
+ */
+void __database_count_flight(database_t *database, const flight_t *flight, int32_t sign) {
+    const date_t date = date_and_time_get_date(flight_get_schedule_departure_date(flight));
+    time_cube_add(database->time_cube, TIME_CUBE_MEASURE_FLIGHTS, date, sign);
+    time_cube_add(database->time_cube,
+                  TIME_CUBE_MEASURE_PASSENGERS,
+                  date,
+                  sign * flight_get_number_of_passengers(flight));
+}
+
 int database_add_flight(database_t *database, const flight_t *flight) {
-    return flight_manager_add_flight(database->flights, flight);
+    if (__database_unshare(database, DATABASE_MANAGER_FLIGHTS | DATABASE_MANAGER_TIME_CUBE))
+        return 1;
+
+    index_manager_invalidate(database->indexes);
+    if (flight_manager_add_flight(database->flights, flight))
+        return 1;
+
+    __database_count_flight(database, flight, 1);
+    return 0;
+}
+
+int database_add_flights(database_t *database, const flight_t *const *flights, size_t n) {
+    if (__database_unshare(database, DATABASE_MANAGER_FLIGHTS | DATABASE_MANAGER_TIME_CUBE))
+        return 1;
+
+    index_manager_invalidate(database->indexes);
+    if (flight_manager_add_flights(database->flights, flights, n))
+        return 1;
+
+    for (size_t i = 0; i < n; ++i)
+        __database_count_flight(database, flights[i], 1);
+    return 0;
+}
+
+int database_reserve_flights(database_t *database, size_t count) {
+    if (__database_unshare(database, DATABASE_MANAGER_FLIGHTS))
+        return 1;
+
+    return flight_manager_reserve(database->flights, count);
+}
+
+int database_reserve_passengers(database_t *database, size_t count) {
+    if (!(database->data & DATABASE_DATA_USER_FLIGHTS))
+        return 0;
+    if (__database_unshare(database, DATABASE_MANAGER_USERS))
+        return 1;
+
+    return user_manager_reserve_flight_associations(database->users, count);
+}
+
+int database_borrow_strings(database_t *database, mapped_file_t *file) {
+    if (__database_unshare(database,
+                           DATABASE_MANAGER_USERS | DATABASE_MANAGER_RESERVATIONS |
+                               DATABASE_MANAGER_FLIGHTS))
+        return 1;
+
+    return user_manager_borrow_strings(database->users, file) ||
+           flight_manager_borrow_strings(database->flights, file) ||
+           reservation_manager_borrow_strings(database->reservations, file);
 }
 
 int database_invalidate_flight(database_t *database, flight_id_t id) {
+    if (__database_unshare(database, DATABASE_MANAGER_FLIGHTS | DATABASE_MANAGER_TIME_CUBE))
+        return 1;
+
+    index_manager_invalidate(database->indexes);
+    const flight_t *const flight = flight_manager_get_by_id(database->flights, id);
+    if (!flight)
+        return 1;
+
+    /* The flight's passengers lose it from their timelines when users are frozen again */
+    __database_count_flight(database, flight, -1);
+    time_cube_invalidate_unique_passengers(database->time_cube);
     return flight_manager_invalidate_by_id(database->flights, id);
 }
 
-int database_add_passengers(database_t       *database,
-                            flight_id_t       flight_id,
-                            size_t            n,
-                            const char *const user_ids[n]) {
+int database_add_passengers(database_t    *database,
+                            flight_id_t    flight_id,
+                            size_t         n,
+                            const uint32_t user_indices[n]) {
+    if (__database_unshare(database,
+                           DATABASE_MANAGER_USERS | DATABASE_MANAGER_FLIGHTS |
+                               DATABASE_MANAGER_TIME_CUBE))
+        return 1;
+
+    index_manager_invalidate(database->indexes);
     if (flight_manager_add_passagers(database->flights, flight_id, n))
         return 1;
 
+    const flight_t *const flight = flight_manager_get_by_id(database->flights, flight_id);
+    const date_t date = date_and_time_get_date(flight_get_schedule_departure_date(flight));
+    time_cube_add(database->time_cube, TIME_CUBE_MEASURE_PASSENGERS, date, n);
+    time_cube_invalidate_unique_passengers(database->time_cube);
+
+    if (!(database->data & DATABASE_DATA_USER_FLIGHTS))
+        return 0;
     for (size_t i = 0; i < n; ++i) {
-        if (user_manager_add_user_flight_association(database->users, user_ids[i], flight_id)) {
+        if (!__database_owns_user(database, user_indices[i]))
+            continue;
+
+        if (user_manager_add_user_flight_association(database->users, user_indices[i], flight_id)) {
             /* Revert the n passengers added and fail. Additions to users are non-reversible. */
             flight_manager_add_passagers(database->flights, flight_id, -n);
+            time_cube_add(database->time_cube, TIME_CUBE_MEASURE_PASSENGERS, date, -(int32_t) n);
             return 1;
         }
     }
     return 0;
 }
 
+int database_add_user_flight_association(database_t *database,
+                                         uint32_t    user_index,
+                                         flight_id_t flight_id) {
+    if (!(database->data & DATABASE_DATA_USER_FLIGHTS))
+        return 0;
+    if (!__database_owns_user(database, user_index))
+        return 0;
+    if (__database_unshare(database, DATABASE_MANAGER_USERS | DATABASE_MANAGER_TIME_CUBE))
+        return 1;
+
+    time_cube_invalidate_unique_passengers(database->time_cube);
+    return user_manager_add_user_flight_association(database->users, user_index, flight_id);
+}
+
+/**
+ * @brief   Gets the dates of flights, for the timelines of users.
+ * @details Auxiliary method for ::database_freeze (see ::user_manager_date_callback_t). Flights
+ *          are looked up in batches of ::DATABASE_LOOKUP_BATCH_SIZE, prefetched before being read.
+ *
+ * @param database_data A ::database_t.
+ * @param n             Number of identifiers in @p ids.
+ * @param ids           Identifiers of the flights.
+ * @param dates         Where to write the scheduled departure date of each flight to (`0` for
+ *                      flights that don't exist).
+ */
+void __database_get_flight_dates(void           *database_data,
+                                 size_t          n,
+                                 const uint32_t  ids[n],
+                                 date_and_time_t dates[n]) {
+    const database_t *const database = database_data;
+    const flight_t         *flights[DATABASE_LOOKUP_BATCH_SIZE];
+
+    for (size_t start = 0; start < n; start += DATABASE_LOOKUP_BATCH_SIZE) {
+        const size_t length = min(n - start, DATABASE_LOOKUP_BATCH_SIZE);
+        flight_manager_get_many_by_id(database->flights, length, ids + start, flights);
+
+        for (size_t i = 0; i < length; ++i)
+            dates[start + i] = flights[i] ? flight_get_schedule_departure_date(flights[i]) : 0;
+    }
+}
+
+/**
+ * @brief   Gets the dates of reservations, for the timelines of users.
+ * @details Auxiliary method for ::database_freeze (see ::user_manager_date_callback_t).
+ *          Reservations are looked up in batches of ::DATABASE_LOOKUP_BATCH_SIZE, prefetched
+ *          before being read.
+ *
+ * @param database_data A ::database_t.
+ * @param n             Number of identifiers in @p ids.
+ * @param ids           Identifiers of the reservations.
+ * @param dates         Where to write the midnight of the begin date of each reservation to (`0`
+ *                      for reservations that don't exist).
+ */
+void __database_get_reservation_dates(void           *database_data,
+                                      size_t          n,
+                                      const uint32_t  ids[n],
+                                      date_and_time_t dates[n]) {
+    const database_t *const database = database_data;
+    const reservation_t    *reservations[DATABASE_LOOKUP_BATCH_SIZE];
+
+    for (size_t start = 0; start < n; start += DATABASE_LOOKUP_BATCH_SIZE) {
+        const size_t length = min(n - start, DATABASE_LOOKUP_BATCH_SIZE);
+        reservation_manager_get_many_by_id(database->reservations,
+                                           length,
+                                           ids + start,
+                                           reservations);
+
+        for (size_t i = 0; i < length; ++i) {
+            dates[start + i] = 0;
+            if (reservations[i])
+                date_and_time_from_values(&dates[start + i],
+                                          reservation_get_begin_date(reservations[i]),
+                                          0 /* 00:00:00 */);
+        }
+    }
+}
+
+/**
+ * @brief   Gets the prices users paid for reservations, for the aggregates of users.
+ * @details Auxiliary method for ::database_freeze (see ::user_manager_price_callback_t).
+ *          Reservations are looked up in batches of ::DATABASE_LOOKUP_BATCH_SIZE, prefetched
+ *          before being read.
+ *
+ * @param database_data A ::database_t.
+ * @param n             Number of identifiers in @p ids.
+ * @param ids           Identifiers of the reservations.
+ * @param prices        Where to write the price of each reservation to, in cents (`0` for
+ *                      reservations that don't exist).
+ */
+void __database_get_reservation_prices(void          *database_data,
+                                       size_t         n,
+                                       const uint32_t ids[n],
+                                       uint64_t       prices[n]) {
+    const database_t *const database = database_data;
+    const reservation_t    *reservations[DATABASE_LOOKUP_BATCH_SIZE];
+
+    for (size_t start = 0; start < n; start += DATABASE_LOOKUP_BATCH_SIZE) {
+        const size_t length = min(n - start, DATABASE_LOOKUP_BATCH_SIZE);
+        reservation_manager_get_many_by_id(database->reservations,
+                                           length,
+                                           ids + start,
+                                           reservations);
+
+        for (size_t i = 0; i < length; ++i)
+            prices[start + i] =
+                reservations[i] ? reservation_calculate_price_cents(reservations[i]) : 0;
+    }
+}
+
+int database_prepare_user_associations(database_t *database) {
+    if (__database_unshare(database, DATABASE_MANAGER_USERS))
+        return 1;
+
+    return user_manager_shrink_id_table(database->users) ||
+           user_manager_stage_associations(database->users);
+}
+
+int database_freeze(database_t *database) {
+    if (database->frozen)
+        return 0;
+
+    /* Freezing users doesn't change what they are, so a restored catalog is kept */
+    const int has_catalog           = database->has_catalog;
+    const int has_unique_passengers = time_cube_has_unique_passengers(database->time_cube);
+    if (__database_unshare(database,
+                           DATABASE_MANAGER_USERS |
+                               (has_unique_passengers ? 0 : DATABASE_MANAGER_TIME_CUBE)))
+        return 1;
+
+    /*
+     * Invalidated flights are only removed from columns when compacted, before anything scans them.
+     * Flights shared with clones are left alone: they were compacted when the database they were
+     * cloned from was frozen, and can't have been invalidated since without being unshared.
+     */
+    if (__atomic_load_n(database->flights_references, __ATOMIC_ACQUIRE) == 1 &&
+        flight_manager_compact(database->flights))
+        return 1;
+
+    if (user_manager_freeze(database->users,
+                            __database_get_flight_dates,
+                            __database_get_reservation_dates,
+                            __database_get_reservation_prices,
+                            database))
+        return 1;
+
+    /* Only needed after passengers were added or flights removed, as timelines stay the same */
+    if (!has_unique_passengers &&
+        time_cube_count_unique_passengers(database->time_cube, database->users))
+        return 1;
+
+    /* The catalog is optional: queries work without it, so allocation failures are ignored */
+    database->has_catalog = has_catalog || !database_catalog_compute(database->users,
+                                                                      database->flights,
+                                                                      database->reservations,
+                                                                      &database->catalog);
+
+    /*
+     * Release memory reserved while loading. Managers shared with clones are left alone: they were
+     * compacted when the database they were cloned from was frozen.
+     */
+    user_manager_compact(database->users);
+    if (__atomic_load_n(database->reservations_references, __ATOMIC_ACQUIRE) == 1 &&
+        reservation_manager_compact(database->reservations))
+        return 1;
+
+    /* Close to the memory budget, indexes are only built if needed, and filters never are */
+    const database_data_t optional = DATABASE_DATA_HOTEL_INDEXES | DATABASE_DATA_FLIGHT_INDEXES |
+                                     DATABASE_DATA_USER_INDEXES | DATABASE_DATA_ID_FILTERS;
+    database_data_t data = database->data;
+    if ((data & optional) && memory_budget_should_degrade(MEMORY_BUDGET_DEGRADATION_INDEXES))
+        data &= ~optional;
+
+    if (database_build_indexes(database, data))
+        return 1;
+
+    /* Filters are optional: lookups work without them, so allocation failures are ignored */
+    if (data & DATABASE_DATA_ID_FILTERS) {
+        user_manager_build_id_filter(database->users);
+        if (__atomic_load_n(database->reservations_references, __ATOMIC_ACQUIRE) == 1)
+            reservation_manager_build_id_filter(database->reservations);
+        if (__atomic_load_n(database->flights_references, __ATOMIC_ACQUIRE) == 1)
+            flight_manager_build_id_filter(database->flights);
+    }
+
+    database->frozen = 1;
+    return 0;
+}
+
+int database_build_indexes(const database_t *database, database_data_t data) {
+    if (data & DATABASE_DATA_HOTEL_INDEXES)
+        index_manager_build_hotel_indexes(database->indexes, database->reservations);
+    if (data & DATABASE_DATA_FLIGHT_INDEXES)
+        index_manager_build_flight_indexes(database->indexes, database->flights);
+    return (data & DATABASE_DATA_USER_INDEXES) &&
+           index_manager_build_user_indexes(database->indexes, database->users);
+}
+
+int database_is_frozen(const database_t *database) {
+    return database->frozen;
+}
+
+memory_report_t *database_get_memory_report(const database_t *database) {
+    memory_report_t *const report = memory_report_create();
+    if (!report)
+        return NULL;
+
+    if (user_manager_add_to_memory_report(database->users, report) ||
+        reservation_manager_add_to_memory_report(database->reservations, report) ||
+        flight_manager_add_to_memory_report(database->flights, report) ||
+        index_manager_add_to_memory_report(database->indexes, report) ||
+        time_cube_add_to_memory_report(database->time_cube, report)) {
+
+        memory_report_free(report);
+        return NULL;
+    }
+
+    return report;
+}
+
+/**
+ * @brief   Adds the statistics of the identifier filter of a manager to a total.
+ * @details Auxiliary method for ::database_get_id_filter_statistics.
+ *
+ * @param total      Statistics to be modified.
+ * @param retval     Value returned by the method that got @p statistics (`1` if there's no filter).
+ * @param statistics Statistics of the manager's filter.
+ *
+ * @return Whether the manager has a filter.
+ */
+int __database_add_id_filter_statistics(bloom_filter_statistics_t       *total,
+                                        int                              retval,
+                                        const bloom_filter_statistics_t *statistics) {
+    if (retval)
+        return 0;
+
+    total->rejected += statistics->rejected;
+    total->passed += statistics->passed;
+    total->false_positives += statistics->false_positives;
+    return 1;
+}
+
+int database_get_id_filter_statistics(const database_t          *database,
+                                      bloom_filter_statistics_t *statistics) {
+    *statistics = (bloom_filter_statistics_t) {0};
+
+    bloom_filter_statistics_t users, reservations, flights;
+    int                       found = 0;
+    found |= __database_add_id_filter_statistics(
+        statistics,
+        user_manager_get_id_filter_statistics(database->users, &users),
+        &users);
+    found |= __database_add_id_filter_statistics(
+        statistics,
+        reservation_manager_get_id_filter_statistics(database->reservations, &reservations),
+        &reservations);
+    found |= __database_add_id_filter_statistics(
+        statistics,
+        flight_manager_get_id_filter_statistics(database->flights, &flights),
+        &flights);
+
+    return !found;
+}
+
 void database_free(database_t *database) {
-    user_manager_free(database->users);
-    reservation_manager_free(database->reservations);
-    flight_manager_free(database->flights);
+    __database_release(database->users,
+                       database->users_references,
+                       (database_free_manager_callback_t) user_manager_free);
+    __database_release(database->reservations,
+                       database->reservations_references,
+                       (database_free_manager_callback_t) reservation_manager_free);
+    __database_release(database->flights,
+                       database->flights_references,
+                       (database_free_manager_callback_t) flight_manager_free);
+    __database_release(database->indexes,
+                       database->indexes_references,
+                       (database_free_manager_callback_t) index_manager_free);
+    __database_release(database->time_cube,
+                       database->time_cube_references,
+                       (database_free_manager_callback_t) time_cube_free);
     free(database);
 }
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  database_catalog.c
+ * @brief Implementation of methods in include/database/database_catalog.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref database_catalog.h).
+ */
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "database/database_catalog.h"
+#include "types/airport_code.h"
+#include "types/hotel_id.h"
+#include "utils/date_and_time.h"
+#include "utils/int_utils.h"
+
+/** @brief Number of distinct hotel identifiers (see ::hotel_id_t). */
+#define DATABASE_CATALOG_HOTEL_ID_COUNT (UINT16_MAX + 1)
+
+/**
+ * @struct database_catalog_counts_t
+ * @brief  Records of each hotel and airport, counted while a catalog is computed.
+ *
+ * @var database_catalog_counts_t::catalog
+ *     @brief Catalog being computed.
+ * @var database_catalog_counts_t::hotels
+ *     @brief Number of reservations of every hotel, indexed by ::hotel_id_t.
+ * @var database_catalog_counts_t::departures
+ *     @brief Number of departures from every airport, indexed by ::airport_code_to_index.
+ * @var database_catalog_counts_t::arrivals
+ *     @brief Number of arrivals at every airport, indexed by ::airport_code_to_index.
+ */
+typedef struct {
+    database_catalog_t *catalog;
+    uint32_t           *hotels;
+    uint32_t           *departures;
+    uint32_t           *arrivals;
+} database_catalog_counts_t;
+
+/**
+ * @brief Widens a date range to include a date.
+ *
+ * @param range Range to be modified.
+ * @param date  Date to be included in @p range.
+ * @param first Whether @p date is the first date to be added to @p range.
+ */
+void __database_catalog_add_date(database_catalog_date_range_t *range, date_t date, int first) {
+    if (first) {
+        range->first = date;
+        range->last  = date;
+    } else {
+        range->first = min(range->first, date);
+        range->last  = max(range->last, date);
+    }
+}
+
+/**
+ * @brief   Adds a key to a list of heavy hitters, if it has more records than any of them.
+ * @details Keys must be added in increasing order, so that ties are broken by the lowest key.
+ *
+ * @param hitters Heavy hitters, sorted by decreasing count.
+ * @param n       Number of elements in @p hitters, incremented when there's room for @p key.
+ * @param key     Key to be added.
+ * @param count   Number of records of @p key.
+ */
+void __database_catalog_add_hitter(database_catalog_heavy_hitter_t hitters[],
+                                   uint32_t                       *n,
+                                   uint32_t                        key,
+                                   uint32_t                        count) {
+    if (*n == DATABASE_CATALOG_HEAVY_HITTER_COUNT && count <= hitters[*n - 1].count)
+        return;
+    if (*n < DATABASE_CATALOG_HEAVY_HITTER_COUNT)
+        (*n)++;
+
+    size_t i = *n - 1;
+    for (; i > 0 && hitters[i - 1].count < count; --i)
+        hitters[i] = hitters[i - 1];
+    hitters[i] = (database_catalog_heavy_hitter_t) {.key = key, .count = count};
+}
+
+/**
+ * @brief   Describes a user in a catalog.
+ * @details Callback for ::user_manager_iter.
+ *
+ * @param user_data A ::database_catalog_t.
+ * @param user      User to be described.
+ *
+ * @retval 0 Always, not to stop iteration.
+ */
+int __database_catalog_add_user(void *user_data, const user_t *user) {
+    database_catalog_t *const catalog = user_data;
+
+    const date_t date = date_and_time_get_date(user_get_account_creation_date(user));
+    __database_catalog_add_date(&catalog->user_dates, date, catalog->users == 0);
+    catalog->users++;
+
+    if (user_get_account_status(user) == ACCOUNT_STATUS_ACTIVE) {
+        const size_t bucket = database_catalog_get_name_prefix_bucket(user_get_const_name(user));
+        catalog->active_users++;
+        catalog->name_prefixes[bucket]++;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Describes a span of flights in a catalog.
+ * @details Callback for ::flight_manager_iter_columns.
+ *
+ * @param user_data A ::database_catalog_counts_t.
+ * @param columns   Flights to be described.
+ *
+ * @retval 0 Always, not to stop iteration.
+ */
+int __database_catalog_add_flights(void *user_data, const flight_manager_columns_t *columns) {
+    database_catalog_counts_t *const counts  = user_data;
+    database_catalog_t *const        catalog = counts->catalog;
+
+    for (size_t i = 0; i < columns->length; ++i) {
+        const date_t date = date_and_time_get_date(columns->schedule_departure_dates[i]);
+        __database_catalog_add_date(&catalog->flight_dates, date, catalog->flights == 0);
+        catalog->flights++;
+        catalog->passengers += columns->passengers[i];
+
+        counts->departures[airport_code_to_index(columns->origins[i])]++;
+        counts->arrivals[airport_code_to_index(columns->destinations[i])]++;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Describes a span of reservations in a catalog.
+ * @details Callback for ::reservation_manager_iter_columns.
+ *
+ * @param user_data A ::database_catalog_counts_t.
+ * @param columns   Reservations to be described.
+ *
+ * @retval 0 Always, not to stop iteration.
+ */
+int __database_catalog_add_reservations(void                                *user_data,
+                                        const reservation_manager_columns_t *columns) {
+    database_catalog_counts_t *const counts  = user_data;
+    database_catalog_t *const        catalog = counts->catalog;
+
+    for (size_t i = 0; i < columns->length; ++i) {
+        __database_catalog_add_date(&catalog->reservation_dates,
+                                    columns->begin_dates[i],
+                                    catalog->reservations == 0);
+        catalog->reservations++;
+        counts->hotels[columns->hotel_ids[i]]++;
+    }
+    return 0;
+}
+
+int database_catalog_compute(const user_manager_t        *users,
+                             const flight_manager_t      *flights,
+                             const reservation_manager_t *reservations,
+                             database_catalog_t          *out_catalog) {
+
+    database_catalog_t        catalog;
+    database_catalog_counts_t counts = {
+        .catalog    = &catalog,
+        .hotels     = calloc(DATABASE_CATALOG_HOTEL_ID_COUNT, sizeof(uint32_t)),
+        .departures = calloc(AIRPORT_CODE_INDEX_COUNT, sizeof(uint32_t)),
+        .arrivals   = calloc(AIRPORT_CODE_INDEX_COUNT, sizeof(uint32_t)),
+    };
+
+    int retval = 1;
+    if (!counts.hotels || !counts.departures || !counts.arrivals)
+        goto DEFER_1;
+
+    memset(&catalog, 0, sizeof(database_catalog_t));
+    user_manager_iter(users, __database_catalog_add_user, &catalog);
+    flight_manager_iter_columns(flights, __database_catalog_add_flights, &counts);
+    reservation_manager_iter_columns(reservations, __database_catalog_add_reservations, &counts);
+
+    for (size_t i = 0; i < DATABASE_CATALOG_HOTEL_ID_COUNT; ++i) {
+        if (!counts.hotels[i])
+            continue;
+
+        catalog.hotels++;
+        __database_catalog_add_hitter(catalog.hotel_hitters,
+                                      &catalog.hotel_hitter_count,
+                                      i,
+                                      counts.hotels[i]);
+    }
+
+    for (size_t i = 0; i < AIRPORT_CODE_INDEX_COUNT; ++i) {
+        if (!counts.departures[i] && !counts.arrivals[i])
+            continue;
+
+        catalog.airports++;
+        if (counts.departures[i])
+            __database_catalog_add_hitter(catalog.airport_hitters,
+                                          &catalog.airport_hitter_count,
+                                          airport_code_from_index(i),
+                                          counts.departures[i]);
+    }
+
+    *out_catalog = catalog;
+    retval       = 0;
+DEFER_1:
+    free(counts.hotels);
+    free(counts.departures);
+    free(counts.arrivals);
+    return retval;
+}
+
+size_t database_catalog_get_name_prefix_bucket(const char *name) {
+    const unsigned char first = (unsigned char) *name;
+    if (first < 128 && isalpha(first))
+        return toupper(first) - 'A';
+    return DATABASE_CATALOG_NAME_PREFIX_COUNT - 1;
+}
+
+/**
+ * @brief Prints a date range of a catalog, preceded by a label.
+ *
+ * @param output Stream to print the range to.
+ * @param label  What the dates are of.
+ * @param range  Range to be printed.
+ */
+void __database_catalog_print_dates(FILE                                *output,
+                                    const char                          *label,
+                                    const database_catalog_date_range_t *range) {
+    char first[DATE_SPRINTF_MIN_BUFFER_SIZE], last[DATE_SPRINTF_MIN_BUFFER_SIZE];
+    if (range->first) {
+        date_sprintf(first, range->first);
+        date_sprintf(last, range->last);
+        fprintf(output, "%s: %s to %s\n", label, first, last);
+    } else {
+        fprintf(output, "%s: none\n", label);
+    }
+}
+
+void database_catalog_print(FILE *output, const database_catalog_t *catalog) {
+    fprintf(output,
+            "Users: %" PRIu64 " (%" PRIu64 " active)\n"
+            "Flights: %" PRIu64 " (%" PRIu64 " passengers)\n"
+            "Reservations: %" PRIu64 "\n"
+            "Distinct airports: %" PRIu64 "\n"
+            "Distinct hotels: %" PRIu64 "\n",
+            catalog->users,
+            catalog->active_users,
+            catalog->flights,
+            catalog->passengers,
+            catalog->reservations,
+            catalog->airports,
+            catalog->hotels);
+
+    __database_catalog_print_dates(output, "Account creation dates", &catalog->user_dates);
+    __database_catalog_print_dates(output, "Flight departure dates", &catalog->flight_dates);
+    __database_catalog_print_dates(output, "Reservation dates", &catalog->reservation_dates);
+
+    fputs("Busiest hotels:", output);
+    for (size_t i = 0; i < catalog->hotel_hitter_count; ++i) {
+        char hotel[HOTEL_ID_SPRINTF_MIN_BUFFER_SIZE];
+        hotel_id_sprintf(hotel, catalog->hotel_hitters[i].key);
+        fprintf(output, " %s (%" PRIu32 ")", hotel, catalog->hotel_hitters[i].count);
+    }
+
+    fputs("\nBusiest airports:", output);
+    for (size_t i = 0; i < catalog->airport_hitter_count; ++i) {
+        char airport[AIRPORT_CODE_SPRINTF_MIN_BUFFER_SIZE];
+        airport_code_sprintf(airport, catalog->airport_hitters[i].key);
+        fprintf(output, " %s (%" PRIu32 ")", airport, catalog->airport_hitters[i].count);
+    }
+
+    fputs("\nActive users by name:", output);
+    for (size_t i = 0; i < DATABASE_CATALOG_NAME_PREFIX_COUNT; ++i) {
+        if (!catalog->name_prefixes[i])
+            continue;
+
+        if (i == DATABASE_CATALOG_NAME_PREFIX_COUNT - 1)
+            fprintf(output, " other %" PRIu64, catalog->name_prefixes[i]);
+        else
+            fprintf(output, " %c %" PRIu64, (char) ('A' + i), catalog->name_prefixes[i]);
+    }
+    fputc('\n', output);
+}
@@ -25,8 +25,16 @@
 #include <glib.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "database/flight_manager.h"
+#include "testing/performance_access.h"
+#include "testing/performance_probes.h"
+#include "testing/performance_trace.h"
+#include "utils/id_table.h"
+#include "utils/int_utils.h"
+#include "utils/numa_topology.h"
+#include "utils/radix_sort.h"
 
 /**
  * @struct flight_manager
@@ -36,13 +44,58 @@
  *     @brief Allocator for flights in the manager.
  * @var flight_manager::strings
  *     @brief Allocator for strings in the manager.
- * @var flight_manager::id_flights_rel
- *     @brief Hash table for ::flight_id_t -> ::flight_t mapping.
+ * @var flight_manager::id_rows_rel
+ *     @brief Hash table for ::flight_id_t -> row (index in the columns) mapping.
+ * @var flight_manager::flights_column
+ *     @brief `GArray` of pointers to the ::flight_t in each row.
+ * @var flight_manager::origins_column
+ *     @brief `GArray` of the ::airport_code_t of the origin of the flight in each row.
+ * @var flight_manager::destinations_column
+ *     @brief `GArray` of the ::airport_code_t of the destination of the flight in each row.
+ * @var flight_manager::schedule_departure_dates_column
+ *     @brief `GArray` of the scheduled departure date (::date_and_time_t) of the flight in each
+ *            row.
+ * @var flight_manager::real_departure_dates_column
+ *     @brief `GArray` of the real departure date (::date_and_time_t) of the flight in each row.
+ * @var flight_manager::passengers_column
+ *     @brief `GArray` of the number of passengers (`uint16_t`) of the flight in each row.
+ * @var flight_manager::zones
+ *     @brief   `GArray` of the ::flight_manager_zone_t of every span of
+ *              ::FLIGHT_MANAGER_COLUMNS_SPAN_LENGTH rows.
+ *     @details Kept up to date as rows are added and removed, but these updates only widen zones.
+ *              ::flight_manager_compact rebuilds them from scratch.
+ * @var flight_manager::partitions
+ *     @brief `GArray` of ::flight_manager_partition_t. Built by ::flight_manager_compact, and
+ *            emptied when rows are added or removed.
+ * @var flight_manager::id_filter
+ *     @brief Bloom filter of the identifiers of all flights (see
+ *            ::flight_manager_build_id_filter), or `NULL` if it wasn't built.
+ * @var flight_manager::invalid_rows
+ *     @brief   `GArray` of `uint64_t` words, a bitmap of the rows of invalidated flights.
+ *     @details Rows stay in the columns until ::flight_manager_compact removes them all at once.
+ *              Words are only allocated up to the last invalidated row.
+ * @var flight_manager::invalid_count
+ *     @brief Number of bits set in ::flight_manager::invalid_rows.
  */
 struct flight_manager {
     pool_t                      *flights;
     string_pool_no_duplicates_t *strings;
-    GHashTable                  *id_flights_rel;
+    id_table_t                  *id_rows_rel;
+
+    GArray *flights_column;
+    GArray *origins_column;
+    GArray *destinations_column;
+    GArray *schedule_departure_dates_column;
+    GArray *real_departure_dates_column;
+    GArray *passengers_column;
+
+    GArray *zones;
+    GArray *partitions;
+
+    bloom_filter_t *id_filter;
+
+    GArray *invalid_rows;
+    size_t  invalid_count;
 };
 
 /** @brief Number of flights in each block of ::flight_manager::flights. */
@@ -51,13 +104,17 @@ struct flight_manager {
 /** @brief Number of characters in each block of ::flight_manager::strings. */
 #define FLIGHT_MANAGER_STRINGS_POOL_BLOCK_CAPACITY 100000
 
+/** @brief Initial capacity of ::flight_manager::id_rows_rel. */
+#define FLIGHT_MANAGER_ID_TABLE_INITIAL_CAPACITY 1024
+
 flight_manager_t *flight_manager_create(void) {
     flight_manager_t *const manager = malloc(sizeof(flight_manager_t));
     if (!manager)
         return NULL;
 
-    manager->flights =
-        pool_create_from_size(flight_sizeof(), FLIGHT_MANAGER_FLIGHTS_POOL_BLOCK_CAPACITY);
+    manager->flights = pool_create_from_size_and_pages(flight_sizeof(),
+                                                       FLIGHT_MANAGER_FLIGHTS_POOL_BLOCK_CAPACITY,
+                                                       POOL_PAGES_HUGE);
     if (!manager->flights) {
         free(manager);
         return NULL;
@@ -70,7 +127,26 @@ flight_manager_t *flight_manager_create(void) {
         return NULL;
     }
 
-    manager->id_flights_rel = g_hash_table_new(g_direct_hash, g_direct_equal);
+    manager->id_rows_rel = id_table_create(FLIGHT_MANAGER_ID_TABLE_INITIAL_CAPACITY);
+    if (!manager->id_rows_rel) {
+        string_pool_no_duplicates_free(manager->strings);
+        pool_free(manager->flights);
+        free(manager);
+        return NULL;
+    }
+
+    manager->flights_column      = g_array_new(FALSE, FALSE, sizeof(const flight_t *));
+    manager->origins_column      = g_array_new(FALSE, FALSE, sizeof(airport_code_t));
+    manager->destinations_column = g_array_new(FALSE, FALSE, sizeof(airport_code_t));
+    manager->schedule_departure_dates_column = g_array_new(FALSE, FALSE, sizeof(date_and_time_t));
+    manager->real_departure_dates_column     = g_array_new(FALSE, FALSE, sizeof(date_and_time_t));
+    manager->passengers_column               = g_array_new(FALSE, FALSE, sizeof(uint16_t));
+    manager->zones      = g_array_new(FALSE, FALSE, sizeof(flight_manager_zone_t));
+    manager->partitions = g_array_new(FALSE, FALSE, sizeof(flight_manager_partition_t));
+    manager->id_filter  = NULL;
+
+    manager->invalid_rows  = g_array_new(FALSE, TRUE, sizeof(uint64_t));
+    manager->invalid_count = 0;
     return manager;
 }
 
@@ -90,90 +166,875 @@ flight_manager_t *flight_manager_clone(const flight_manager_t *manager) {
     return clone;
 }
 
-int flight_manager_add_flight(flight_manager_t *manager, const flight_t *flight) {
+/**
+ * @brief Creates the zone map of a span of rows that only contains one row.
+ *
+ * @param manager Flight manager containing the row.
+ * @param row     Row to be summarized.
+ * @param zone    Where to write the zone map to.
+ */
+void __flight_manager_zone_from_row(const flight_manager_t *manager,
+                                    size_t                  row,
+                                    flight_manager_zone_t  *zone) {
+    const date_and_time_t date =
+        g_array_index(manager->schedule_departure_dates_column, date_and_time_t, row);
+    const airport_code_t origin = g_array_index(manager->origins_column, airport_code_t, row);
+    const airport_code_t destination =
+        g_array_index(manager->destinations_column, airport_code_t, row);
+
+    *zone = (flight_manager_zone_t) {.min_schedule_departure_date = date,
+                                     .max_schedule_departure_date = date,
+                                     .min_origin                  = origin,
+                                     .max_origin                  = origin,
+                                     .min_destination             = destination,
+                                     .max_destination             = destination};
+}
+
+/**
+ * @brief Widens the zone map of a span of rows so that it also contains another row.
+ *
+ * @param manager Flight manager containing the row.
+ * @param row     Row to be added to @p zone.
+ * @param zone    Zone map to be modified.
+ */
+void __flight_manager_zone_add_row(const flight_manager_t *manager,
+                                   size_t                  row,
+                                   flight_manager_zone_t  *zone) {
+    flight_manager_zone_t row_zone;
+    __flight_manager_zone_from_row(manager, row, &row_zone);
+
+    zone->min_schedule_departure_date =
+        min(zone->min_schedule_departure_date, row_zone.min_schedule_departure_date);
+    zone->max_schedule_departure_date =
+        max(zone->max_schedule_departure_date, row_zone.max_schedule_departure_date);
+    zone->min_origin      = min(zone->min_origin, row_zone.min_origin);
+    zone->max_origin      = max(zone->max_origin, row_zone.max_origin);
+    zone->min_destination = min(zone->min_destination, row_zone.min_destination);
+    zone->max_destination = max(zone->max_destination, row_zone.max_destination);
+}
+
+/**
+ * @brief   Updates the zone maps of a flight manager after a row is appended to its columns.
+ * @details A new zone is created when the row starts a new span.
+ *
+ * @param manager Flight manager whose zone maps are to be updated.
+ * @param row     Row that was appended.
+ */
+void __flight_manager_zones_append_row(flight_manager_t *manager, size_t row) {
+    const size_t span = row / FLIGHT_MANAGER_COLUMNS_SPAN_LENGTH;
+    if (span == manager->zones->len) {
+        flight_manager_zone_t zone;
+        __flight_manager_zone_from_row(manager, row, &zone);
+        g_array_append_val(manager->zones, zone);
+    } else {
+        __flight_manager_zone_add_row(manager,
+                                      row,
+                                      &g_array_index(manager->zones, flight_manager_zone_t, span));
+    }
+}
+
+/**
+ * @brief Rebuilds all zone maps of a flight manager from its columns.
+ * @param manager Flight manager whose zone maps are to be rebuilt.
+ */
+void __flight_manager_zones_rebuild(flight_manager_t *manager) {
+    g_array_set_size(manager->zones, 0);
+    for (size_t i = 0; i < manager->flights_column->len; ++i)
+        __flight_manager_zones_append_row(manager, i);
+}
+
+/**
+ * @brief Checks if two zone maps have at least one possible flight in common.
+ *
+ * @param a First zone map.
+ * @param b Second zone map.
+ *
+ * @return Whether all ranges in @p a and @p b overlap.
+ */
+int __flight_manager_zone_intersects(const flight_manager_zone_t *a,
+                                     const flight_manager_zone_t *b) {
+    return a->min_schedule_departure_date <= b->max_schedule_departure_date &&
+           b->min_schedule_departure_date <= a->max_schedule_departure_date &&
+           a->min_origin <= b->max_origin && b->min_origin <= a->max_origin &&
+           a->min_destination <= b->max_destination && b->min_destination <= a->max_destination;
+}
+
+/**
+ * @brief   Discards the identifier filter of a flight manager.
+ * @details Auxiliary method for methods that add or remove flights.
+ *
+ * @param manager Flight manager whose filter is to be discarded.
+ */
+void __flight_manager_free_id_filter(flight_manager_t *manager) {
+    bloom_filter_free(manager->id_filter);
+    manager->id_filter = NULL;
+}
+
+/**
+ * @brief   Adds a flight to the pool and to the columns of a flight manager.
+ * @details Auxiliary method for ::flight_manager_add_flight and ::flight_manager_add_flights, that
+ *          must discard partitions and the identifier filter afterwards.
+ *
+ * @param manager Flight manager to add @p flight to.
+ * @param flight  Flight to add to @p manager.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __flight_manager_add_row(flight_manager_t *manager, const flight_t *flight) {
     flight_t *const pool_flight = flight_clone(manager->flights, manager->strings, flight);
     if (!pool_flight)
         return 1;
 
-    flight_id_t flight_id = flight_get_id(flight);
-    if (!g_hash_table_insert(manager->id_flights_rel, GUINT_TO_POINTER(flight_id), pool_flight)) {
-
+    const size_t      row       = manager->flights_column->len;
+    const flight_id_t flight_id = flight_get_id(flight);
+    const int         retval    = id_table_insert(manager->id_rows_rel, flight_id, row);
+    if (retval == 1) {
+        return 1;
+    } else if (retval == 2) {
         /* Do not fatally fail (just print a warning). Show must go on. */
         char id_str[FLIGHT_ID_SPRINTF_MIN_BUFFER_SIZE];
         flight_id_sprintf(id_str, flight_id);
         fprintf(stderr, "REPEATED FLIGHT ID %s. This shouldn't happen! Replacing it.\n", id_str);
     }
 
+    /* Add a row to the columns */
+    const flight_t *const const_flight   = pool_flight;
+    const airport_code_t  origin         = flight_get_origin(flight);
+    const airport_code_t  destination    = flight_get_destination(flight);
+    const date_and_time_t schedule       = flight_get_schedule_departure_date(flight);
+    const date_and_time_t real_departure = flight_get_real_departure_date(flight);
+    const uint16_t        passengers     = flight_get_number_of_passengers(flight);
+    g_array_append_val(manager->flights_column, const_flight);
+    g_array_append_val(manager->origins_column, origin);
+    g_array_append_val(manager->destinations_column, destination);
+    g_array_append_val(manager->schedule_departure_dates_column, schedule);
+    g_array_append_val(manager->real_departure_dates_column, real_departure);
+    g_array_append_val(manager->passengers_column, passengers);
+
+    __flight_manager_zones_append_row(manager, row);
+    return 0;
+}
+
+int flight_manager_add_flight(flight_manager_t *manager, const flight_t *flight) {
+    performance_probe2(manager_insert, PERFORMANCE_ACCESS_MANAGER_FLIGHTS, 1);
+    if (__flight_manager_add_row(manager, flight))
+        return 1;
+
+    g_array_set_size(manager->partitions, 0);
+    __flight_manager_free_id_filter(manager);
+    return 0;
+}
+
+int flight_manager_reserve(flight_manager_t *manager, size_t count) {
+    return id_table_reserve(manager->id_rows_rel, count) || pool_reserve(manager->flights, count);
+}
+
+int flight_manager_borrow_strings(flight_manager_t *manager, mapped_file_t *file) {
+    return string_pool_no_duplicates_borrow(manager->strings, file);
+}
+
+int flight_manager_add_flights(flight_manager_t      *manager,
+                               const flight_t *const *flights,
+                               size_t                 n) {
+    if (flight_manager_reserve(manager, manager->flights_column->len + n))
+        return 1;
+
+    performance_probe2(manager_insert, PERFORMANCE_ACCESS_MANAGER_FLIGHTS, n);
+    int retval = 0;
+    for (size_t i = 0; !retval && i < n; ++i) {
+        if (i + ID_TABLE_PREFETCH_DISTANCE < n)
+            id_table_prefetch(manager->id_rows_rel,
+                              flight_get_id(flights[i + ID_TABLE_PREFETCH_DISTANCE]));
+        retval = __flight_manager_add_row(manager, flights[i]);
+    }
+
+    /* Some flights may have been added, even on failure */
+    g_array_set_size(manager->partitions, 0);
+    __flight_manager_free_id_filter(manager);
+    return retval;
+}
+
+/**
+ * @brief Checks if a row of a flight manager belongs to an invalidated flight.
+ *
+ * @param manager Flight manager containing the row.
+ * @param row     Row to be checked.
+ *
+ * @return Whether @p row was invalidated (see ::flight_manager_invalidate_by_id) and is yet to be
+ *         removed by ::flight_manager_compact.
+ */
+int __flight_manager_row_is_invalid(const flight_manager_t *manager, size_t row) {
+    const size_t word = row / 64;
+    return word < manager->invalid_rows->len &&
+           ((g_array_index(manager->invalid_rows, uint64_t, word) >> (row % 64)) & 1);
+}
+
+/**
+ * @brief   Gets the row of a flight in the columns of a flight manager.
+ * @details Invalidated flights are treated as missing.
+ *
+ * @param manager Flight manager to get the row from.
+ * @param id      Identifier of the flight.
+ * @param row     Where to write the row to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Flight not in @p manager.
+ */
+int __flight_manager_get_row(const flight_manager_t *manager, flight_id_t id, size_t *row) {
+    uint32_t value;
+    if (id_table_lookup(manager->id_rows_rel, id, &value) ||
+        (manager->invalid_count && __flight_manager_row_is_invalid(manager, value)))
+        return 1;
+
+    *row = value;
     return 0;
 }
 
 int flight_manager_add_passagers(flight_manager_t *manager, flight_id_t id, int count) {
-    flight_t *const flight = g_hash_table_lookup(manager->id_flights_rel, GUINT_TO_POINTER(id));
-    if (!flight)
+    size_t row;
+    if (__flight_manager_get_row(manager, id, &row))
+        return 1;
+
+    /* Const cast acceptable - the flight is in this manager's pool */
+    flight_t *const flight = (flight_t *) (size_t) g_array_index(manager->flights_column,
+                                                                 const flight_t *,
+                                                                 row);
+    if (flight_set_number_of_passengers(flight, flight_get_number_of_passengers(flight) + count))
         return 1;
 
-    return flight_set_number_of_passengers(flight, flight_get_number_of_passengers(flight) + count);
+    g_array_index(manager->passengers_column, uint16_t, row) =
+        flight_get_number_of_passengers(flight);
+    return 0;
 }
 
 const flight_t *flight_manager_get_by_id(const flight_manager_t *manager, flight_id_t id) {
-    return g_hash_table_lookup(manager->id_flights_rel, GUINT_TO_POINTER(id));
+    performance_access_count_probe(PERFORMANCE_ACCESS_MANAGER_FLIGHTS);
+
+    size_t row;
+    if (__flight_manager_get_row(manager, id, &row))
+        return NULL;
+
+    return g_array_index(manager->flights_column, const flight_t *, row);
+}
+
+void flight_manager_get_many_by_id(const flight_manager_t *manager,
+                                   size_t                  n,
+                                   const flight_id_t       ids[n],
+                                   const flight_t         *flights[n]) {
+    for (size_t i = 0; i < n; ++i) {
+        if (i + ID_TABLE_PREFETCH_DISTANCE < n)
+            id_table_prefetch(manager->id_rows_rel, ids[i + ID_TABLE_PREFETCH_DISTANCE]);
+
+        flights[i] = flight_manager_get_by_id(manager, ids[i]);
+        if (flights[i])
+            __builtin_prefetch(flights[i]);
+    }
+}
+
+int flight_manager_build_id_filter(flight_manager_t *manager) {
+    if (manager->id_filter)
+        return 0;
+
+    manager->id_filter = bloom_filter_create(manager->flights_column->len);
+    if (!manager->id_filter)
+        return 1;
+
+    for (size_t i = 0; i < manager->flights_column->len; ++i) {
+        const flight_t *const flight = g_array_index(manager->flights_column, const flight_t *, i);
+        bloom_filter_add(manager->id_filter, bloom_filter_hash_integer(flight_get_id(flight)));
+    }
+    return 0;
+}
+
+const flight_t *flight_manager_get_by_id_filtered(const flight_manager_t *manager, flight_id_t id) {
+    if (manager->id_filter &&
+        !bloom_filter_may_contain(manager->id_filter, bloom_filter_hash_integer(id)))
+        return NULL;
+
+    const flight_t *const flight = flight_manager_get_by_id(manager, id);
+    if (!flight && manager->id_filter)
+        bloom_filter_count_false_positive(manager->id_filter);
+    return flight;
+}
+
+int flight_manager_get_id_filter_statistics(const flight_manager_t    *manager,
+                                            bloom_filter_statistics_t *statistics) {
+    if (!manager->id_filter)
+        return 1;
+
+    bloom_filter_get_statistics(manager->id_filter, statistics);
+    return 0;
 }
 
 int flight_manager_invalidate_by_id(flight_manager_t *manager, flight_id_t id) {
-    flight_t *const flight = g_hash_table_lookup(manager->id_flights_rel, GUINT_TO_POINTER(id));
-    if (!flight)
+    size_t row;
+    if (__flight_manager_get_row(manager, id, &row))
         return 1;
 
+    /* Const cast acceptable - the flight is in this manager's pool */
+    flight_t *const flight = (flight_t *) (size_t) g_array_index(manager->flights_column,
+                                                                 const flight_t *,
+                                                                 row);
     flight_invalidate(flight);
-    g_hash_table_remove(manager->id_flights_rel, GUINT_TO_POINTER(id));
+
+    /* The row is only marked: rows are removed all at once when the manager is compacted */
+    const size_t word = row / 64;
+    if (word >= manager->invalid_rows->len)
+        g_array_set_size(manager->invalid_rows, word + 1); /* Cleared on growth */
+    g_array_index(manager->invalid_rows, uint64_t, word) |= (uint64_t) 1 << (row % 64);
+    manager->invalid_count++;
+
+    g_array_set_size(manager->partitions, 0);
+    __flight_manager_free_id_filter(manager);
     return 0;
 }
 
+int flight_manager_iter(const flight_manager_t        *manager,
+                        flight_manager_iter_callback_t callback,
+                        void                          *user_data) {
+
+    mapped_file_t *const borrowed = string_pool_no_duplicates_get_borrowed(manager->strings);
+    mapped_file_begin_scan(borrowed);
+    performance_access_count_scan(PERFORMANCE_ACCESS_MANAGER_FLIGHTS, manager->flights_column->len);
+    performance_trace_begin("Scan flights");
+    int retval = 0;
+    for (size_t i = 0; i < manager->flights_column->len; ++i) {
+        if (manager->invalid_count && __flight_manager_row_is_invalid(manager, i))
+            continue;
+
+        retval = callback(user_data, g_array_index(manager->flights_column, const flight_t *, i));
+        if (retval)
+            break;
+    }
+    performance_trace_end();
+    mapped_file_end_scan(borrowed);
+    return retval;
+}
+
 /**
- * @struct flight_manager_iter_flight_data_t
- * @brief  Internal data type for the `user_data` parameter in ::__flight_manager_iter_callback.
+ * @brief Gets a span of rows of the columns of a flight manager.
  *
- * @var flight_manager_iter_flight_data_t::callback
- *     @brief Callback to be called for every valid flight.
- * @var flight_manager_iter_flight_data_t::original_user_data.
- *     @brief `user_data` parameter for every ::flight_manager_iter_flight_data_t::callback.
+ * @param manager Flight manager to get the rows from.
+ * @param row     First row in the span.
+ * @param length  Number of rows in the span.
+ * @param columns Where to write the span to.
+ */
+void __flight_manager_get_columns(const flight_manager_t   *manager,
+                                  size_t                    row,
+                                  size_t                    length,
+                                  flight_manager_columns_t *columns) {
+    *columns = (flight_manager_columns_t) {
+        .length       = length,
+        .flights      = &g_array_index(manager->flights_column, const flight_t *, row),
+        .origins      = &g_array_index(manager->origins_column, airport_code_t, row),
+        .destinations = &g_array_index(manager->destinations_column, airport_code_t, row),
+        .schedule_departure_dates =
+            &g_array_index(manager->schedule_departure_dates_column, date_and_time_t, row),
+        .real_departure_dates =
+            &g_array_index(manager->real_departure_dates_column, date_and_time_t, row),
+        .passengers = &g_array_index(manager->passengers_column, uint16_t, row)};
+}
+
+/**
+ * @brief   Iterates through the columns of a flight manager, skipping spans outside of a zone.
+ * @details Auxiliary method for ::flight_manager_iter_columns and
+ *          ::flight_manager_iter_columns_filtered.
+ *
+ * @param manager   Flight manager to iterate over.
+ * @param zone      Ranges of values of the flights of interest. `NULL` visits every span.
+ * @param callback  Method called for every span of rows that may intersect @p zone.
+ * @param user_data Argument passed to @p callback.
+ *
+ * @return The return value of the last-called @p callback.
+ */
+int __flight_manager_iter_columns(const flight_manager_t                *manager,
+                                  const flight_manager_zone_t           *zone,
+                                  flight_manager_iter_columns_callback_t callback,
+                                  void                                  *user_data) {
+    performance_trace_begin(zone ? "Scan flight columns (filtered)" : "Scan flight columns");
+
+    int          retval = 0;
+    const size_t rows   = manager->flights_column->len;
+    for (size_t i = 0; i < rows; i += FLIGHT_MANAGER_COLUMNS_SPAN_LENGTH) {
+        const size_t length = min(rows - i, FLIGHT_MANAGER_COLUMNS_SPAN_LENGTH);
+
+        const flight_manager_zone_t *const span_zone =
+            &g_array_index(manager->zones,
+                           flight_manager_zone_t,
+                           i / FLIGHT_MANAGER_COLUMNS_SPAN_LENGTH);
+        if (zone && !__flight_manager_zone_intersects(zone, span_zone))
+            continue;
+
+        performance_access_count_scan(PERFORMANCE_ACCESS_MANAGER_FLIGHTS, length);
+        flight_manager_columns_t columns;
+        __flight_manager_get_columns(manager, i, length, &columns);
+
+        retval = callback(user_data, &columns);
+        if (retval)
+            break;
+    }
+
+    performance_trace_end();
+    return retval;
+}
+
+int flight_manager_iter_columns(const flight_manager_t                *manager,
+                                flight_manager_iter_columns_callback_t callback,
+                                void                                  *user_data) {
+    return __flight_manager_iter_columns(manager, NULL, callback, user_data);
+}
+
+int flight_manager_iter_columns_filtered(const flight_manager_t                *manager,
+                                         const flight_manager_zone_t           *zone,
+                                         flight_manager_iter_columns_callback_t callback,
+                                         void                                  *user_data) {
+    return __flight_manager_iter_columns(manager, zone, callback, user_data);
+}
+
+/**
+ * @struct flight_manager_parallel_iter_data_t
+ * @brief  Internal data type for the `user_data` parameter of the callbacks of
+ *         ::flight_manager_parallel_iter_columns.
+ *
+ * @var flight_manager_parallel_iter_data_t::manager
+ *     @brief Flight manager being iterated over.
+ * @var flight_manager_parallel_iter_data_t::init
+ *     @brief Method called to create the accumulator of each range.
+ * @var flight_manager_parallel_iter_data_t::callback
+ *     @brief Method called for every span of rows.
+ * @var flight_manager_parallel_iter_data_t::merge
+ *     @brief Method called for every accumulator.
+ * @var flight_manager_parallel_iter_data_t::original_user_data
+ *     @brief `user_data` parameter for ::flight_manager_parallel_iter_data_t::init and
+ *            ::flight_manager_parallel_iter_data_t::merge.
+ * @var flight_manager_parallel_iter_data_t::retval
+ *     @brief Return value of the first callback that stopped the iteration, or `0`.
  */
 typedef struct {
-    const flight_manager_iter_callback_t callback;
-    void *const                          original_user_data;
-} flight_manager_iter_flight_data_t;
+    const flight_manager_t                *manager;
+    thread_pool_reduce_init_callback_t     init;
+    flight_manager_iter_columns_callback_t callback;
+    thread_pool_reduce_merge_callback_t    merge;
+    void                                  *original_user_data;
+    int                                    retval;
+} flight_manager_parallel_iter_data_t;
+
+/**
+ * @brief Creates the accumulator of a range in ::flight_manager_parallel_iter_columns.
+ * @param user_data A pointer to a ::flight_manager_parallel_iter_data_t.
+ * @return The accumulator created by the target callback.
+ */
+void *__flight_manager_parallel_iter_init(void *user_data) {
+    const flight_manager_parallel_iter_data_t *const iter_data = user_data;
+    return iter_data->init(iter_data->original_user_data);
+}
+
+/**
+ * @brief Calls the target callback of ::flight_manager_parallel_iter_columns for a range of spans.
+ *
+ * @param user_data   A pointer to a ::flight_manager_parallel_iter_data_t.
+ * @param accumulator Accumulator of the range.
+ * @param start       First span in the range.
+ * @param end         Span after the last one in the range.
+ */
+void __flight_manager_parallel_iter_range(void  *user_data,
+                                          void  *accumulator,
+                                          size_t start,
+                                          size_t end) {
+    flight_manager_parallel_iter_data_t *const iter_data = user_data;
+    const size_t                               rows      = iter_data->manager->flights_column->len;
+
+    performance_trace_begin("Scan flight columns (parallel range)");
+    for (size_t span = start; span < end; ++span) {
+        if (__atomic_load_n(&iter_data->retval, __ATOMIC_RELAXED))
+            break;
+
+        const size_t             row = span * FLIGHT_MANAGER_COLUMNS_SPAN_LENGTH;
+        flight_manager_columns_t columns;
+        __flight_manager_get_columns(iter_data->manager,
+                                     row,
+                                     min(rows - row, FLIGHT_MANAGER_COLUMNS_SPAN_LENGTH),
+                                     &columns);
+
+        const int retval = iter_data->callback(accumulator, &columns);
+        if (retval) {
+            int expected = 0;
+            __atomic_compare_exchange_n(&iter_data->retval,
+                                        &expected,
+                                        retval,
+                                        0,
+                                        __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED);
+            break;
+        }
+    }
+    performance_trace_end();
+}
+
+/**
+ * @brief Merges the accumulator of a range in ::flight_manager_parallel_iter_columns.
+ *
+ * @param user_data   A pointer to a ::flight_manager_parallel_iter_data_t.
+ * @param accumulator Accumulator to be merged.
+ */
+void __flight_manager_parallel_iter_merge(void *user_data, void *accumulator) {
+    const flight_manager_parallel_iter_data_t *const iter_data = user_data;
+    iter_data->merge(iter_data->original_user_data, accumulator);
+}
+
+int flight_manager_parallel_iter_columns(const flight_manager_t                *manager,
+                                         thread_pool_t                         *pool,
+                                         thread_pool_reduce_init_callback_t     init,
+                                         flight_manager_iter_columns_callback_t callback,
+                                         thread_pool_reduce_merge_callback_t    merge,
+                                         void                                  *user_data) {
+
+    flight_manager_parallel_iter_data_t iter_data = {.manager            = manager,
+                                                     .init               = init,
+                                                     .callback           = callback,
+                                                     .merge              = merge,
+                                                     .original_user_data = user_data,
+                                                     .retval             = 0};
+
+    const size_t rows  = manager->flights_column->len;
+    const size_t spans = rows / FLIGHT_MANAGER_COLUMNS_SPAN_LENGTH +
+                         (rows % FLIGHT_MANAGER_COLUMNS_SPAN_LENGTH != 0);
+    performance_access_count_scan(PERFORMANCE_ACCESS_MANAGER_FLIGHTS, rows);
+    if (thread_pool_parallel_reduce(pool,
+                                    spans,
+                                    0,
+                                    __flight_manager_parallel_iter_init,
+                                    __flight_manager_parallel_iter_range,
+                                    __flight_manager_parallel_iter_merge,
+                                    &iter_data))
+        return 1;
+
+    return iter_data.retval;
+}
+
+const flight_manager_partition_t *flight_manager_get_partitions(const flight_manager_t *manager,
+                                                                size_t                 *count) {
+    *count = manager->partitions->len;
+    return *count ? &g_array_index(manager->partitions, flight_manager_partition_t, 0) : NULL;
+}
+
+int flight_manager_iter_partition_columns(const flight_manager_t                *manager,
+                                          const flight_manager_partition_t      *partition,
+                                          flight_manager_iter_columns_callback_t callback,
+                                          void                                  *user_data) {
+    performance_access_count_scan(PERFORMANCE_ACCESS_MANAGER_FLIGHTS, partition->length);
+    performance_trace_begin("Scan flight partition");
+
+    int          retval = 0;
+    const size_t end    = partition->first_row + partition->length;
+    for (size_t i = partition->first_row; i < end; i += FLIGHT_MANAGER_COLUMNS_SPAN_LENGTH) {
+        flight_manager_columns_t columns;
+        __flight_manager_get_columns(manager,
+                                     i,
+                                     min(end - i, FLIGHT_MANAGER_COLUMNS_SPAN_LENGTH),
+                                     &columns);
+
+        retval = callback(user_data, &columns);
+        if (retval)
+            break;
+    }
+
+    performance_trace_end();
+    return retval;
+}
+
+/**
+ * @brief   Moves a row of a column of a flight manager to another row, overwriting it.
+ * @details Auxiliary method for ::__flight_manager_remove_invalid_rows.
+ *
+ * @param column       Column to be modified.
+ * @param element_size Size of each element in @p column.
+ * @param from         Row to be moved.
+ * @param to           Row to be overwritten.
+ */
+void __flight_manager_column_move(GArray *column, size_t element_size, size_t from, size_t to) {
+    memcpy(column->data + to * element_size, column->data + from * element_size, element_size);
+}
+
+/**
+ * @brief   Removes the rows of all invalidated flights from the columns of a flight manager.
+ * @details Auxiliary method for ::flight_manager_compact. Valid rows keep their relative order,
+ *          and the ones that are moved have their identifiers updated in
+ *          ::flight_manager::id_rows_rel. Zone maps must be rebuilt afterwards.
+ *
+ * @param manager Flight manager whose invalidated rows are to be removed.
+ */
+void __flight_manager_remove_invalid_rows(flight_manager_t *manager) {
+    if (!manager->invalid_count)
+        return;
+
+    const size_t rows  = manager->flights_column->len;
+    size_t       valid = 0;
+    for (size_t i = 0; i < rows; ++i) {
+        const flight_t *const flight = g_array_index(manager->flights_column, const flight_t *, i);
+        const flight_id_t     id     = flight_get_id(flight);
+
+        /* Repeated identifiers point to one of their rows only, which other rows mustn't touch */
+        uint32_t  id_row;
+        const int owns_id = !id_table_lookup(manager->id_rows_rel, id, &id_row) && id_row == i;
+
+        if (__flight_manager_row_is_invalid(manager, i)) {
+            if (owns_id)
+                id_table_remove(manager->id_rows_rel, id);
+            continue;
+        }
+
+        if (valid != i) {
+            if (owns_id) /* Replacement, can't fail */
+                id_table_insert(manager->id_rows_rel, id, valid);
+
+            __flight_manager_column_move(manager->flights_column,
+                                         sizeof(const flight_t *),
+                                         i,
+                                         valid);
+            __flight_manager_column_move(manager->origins_column, sizeof(airport_code_t), i, valid);
+            __flight_manager_column_move(manager->destinations_column,
+                                         sizeof(airport_code_t),
+                                         i,
+                                         valid);
+            __flight_manager_column_move(manager->schedule_departure_dates_column,
+                                         sizeof(date_and_time_t),
+                                         i,
+                                         valid);
+            __flight_manager_column_move(manager->real_departure_dates_column,
+                                         sizeof(date_and_time_t),
+                                         i,
+                                         valid);
+            __flight_manager_column_move(manager->passengers_column, sizeof(uint16_t), i, valid);
+        }
+        valid++;
+    }
+
+    g_array_set_size(manager->flights_column, valid);
+    g_array_set_size(manager->origins_column, valid);
+    g_array_set_size(manager->destinations_column, valid);
+    g_array_set_size(manager->schedule_departure_dates_column, valid);
+    g_array_set_size(manager->real_departure_dates_column, valid);
+    g_array_set_size(manager->passengers_column, valid);
+
+    g_array_set_size(manager->invalid_rows, 0);
+    manager->invalid_count = 0;
+}
+
+/**
+ * @brief   Reorders the rows of a column of a flight manager.
+ * @details Auxiliary method for ::__flight_manager_cluster.
+ *
+ * @param column       Column to be reordered. Will be replaced by a new array.
+ * @param element_size Size of each element in @p column.
+ * @param order        Sorted entries, whose ::radix_sort_entry_t::tiebreak is the old row of each
+ *                     new row.
+ */
+void __flight_manager_column_permute(GArray                  **column,
+                                     size_t                    element_size,
+                                     const radix_sort_entry_t *order) {
+    const size_t  rows     = (*column)->len;
+    GArray *const permuted = g_array_sized_new(FALSE, FALSE, element_size, rows);
+    g_array_set_size(permuted, rows);
+
+    for (size_t i = 0; i < rows; ++i)
+        memcpy(permuted->data + i * element_size,
+               (*column)->data + order[i].tiebreak * element_size,
+               element_size);
+
+    g_array_unref(*column);
+    *column = permuted;
+}
 
 /**
- * @brief   Callback for every item in the flight manager's pool.
- * @details Auxiliary function for ::flight_manager_iter. Makes sure the target callback is only
- *          called for valid flights.
+ * @brief   Sorts the rows of a flight manager by scheduled departure date.
+ * @details Keeps flights that happened close in time in the same spans, so that their zone maps
+ *          are narrow. Auxiliary method for ::flight_manager_compact. Flights with the same date
+ *          keep their relative order.
  *
- * @param user_data A pointer to a ::flight_manager_iter_flight_data_t.
- * @param item      A pointer to a ::flight_t in a manager's pool.
+ * @param manager Flight manager whose rows are to be sorted.
  *
- * @return The return value of the target callback, or `0` for filtered-out items.
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (rows are left as they were).
  */
-int __flight_manager_iter_callback(void *user_data, const void *item) {
-    if (flight_is_valid((const flight_t *) item) == 0) {
-        const flight_manager_iter_flight_data_t *const helper_data = user_data;
-        return helper_data->callback(helper_data->original_user_data, (const flight_t *) item);
+int __flight_manager_cluster(flight_manager_t *manager) {
+    const size_t        rows    = manager->flights_column->len;
+    radix_sort_entry_t *entries = malloc(max(rows, 1) * sizeof(radix_sort_entry_t));
+    if (!entries)
+        return 1;
+
+    /* Repeated identifiers point to one of their rows only, so the others mustn't update them */
+    for (size_t i = 0; i < rows; ++i) {
+        const flight_t *const flight = g_array_index(manager->flights_column, const flight_t *, i);
+
+        size_t id_row;
+        const int owns_id =
+            !__flight_manager_get_row(manager, flight_get_id(flight), &id_row) && id_row == i;
+
+        entries[i].key =
+            g_array_index(manager->schedule_departure_dates_column, date_and_time_t, i);
+        entries[i].tiebreak = i;
+        entries[i].value    = owns_id ? flight : NULL;
+    }
+
+    if (radix_sort(entries, rows)) {
+        free(entries);
+        return 1;
     }
 
+    for (size_t i = 0; i < rows; ++i)
+        if (entries[i].value) /* Replacement, can't fail */
+            id_table_insert(manager->id_rows_rel, flight_get_id(entries[i].value), i);
+
+    __flight_manager_column_permute(&manager->flights_column, sizeof(const flight_t *), entries);
+    __flight_manager_column_permute(&manager->origins_column, sizeof(airport_code_t), entries);
+    __flight_manager_column_permute(&manager->destinations_column,
+                                    sizeof(airport_code_t),
+                                    entries);
+    __flight_manager_column_permute(&manager->schedule_departure_dates_column,
+                                    sizeof(date_and_time_t),
+                                    entries);
+    __flight_manager_column_permute(&manager->real_departure_dates_column,
+                                    sizeof(date_and_time_t),
+                                    entries);
+    __flight_manager_column_permute(&manager->passengers_column, sizeof(uint16_t), entries);
+
+    free(entries);
     return 0;
 }
 
-int flight_manager_iter(const flight_manager_t        *manager,
-                        flight_manager_iter_callback_t callback,
-                        void                          *user_data) {
+/**
+ * @brief   Splits the rows of a flight manager into partitions of flights of the same month.
+ * @details Auxiliary method for ::flight_manager_compact. Rows must already be sorted by
+ *          scheduled departure date (see ::__flight_manager_cluster).
+ *
+ * @param manager Flight manager whose rows are to be partitioned.
+ */
+void __flight_manager_partitions_rebuild(flight_manager_t *manager) {
+    g_array_set_size(manager->partitions, 0);
 
-    flight_manager_iter_flight_data_t helper_data = {.callback           = callback,
-                                                     .original_user_data = user_data};
-    return pool_iter(manager->flights, __flight_manager_iter_callback, &helper_data);
+    const size_t rows  = manager->flights_column->len;
+    size_t       first = 0;
+    date_t       month = 0;
+    for (size_t i = 0; i <= rows; ++i) {
+        const date_t row_month =
+            i == rows ? DATE_LATEST
+                      : date_generate_dayless(date_and_time_get_date(g_array_index(
+                            manager->schedule_departure_dates_column, date_and_time_t, i)));
+
+        if (i > first && row_month != month) {
+            const flight_manager_partition_t partition = {.month     = month,
+                                                          .length    = i - first,
+                                                          .first_row = first};
+            g_array_append_val(manager->partitions, partition);
+            first = i;
+        }
+        month = row_month;
+    }
+}
+
+/**
+ * @brief   Spreads the columns of a flight manager among all NUMA nodes.
+ * @details Auxiliary method for ::flight_manager_compact. Columns are scanned by all threads, so
+ *          they're interleaved (see ::numa_topology_interleave).
+ * @param   manager Flight manager whose columns are no longer going to grow.
+ */
+void __flight_manager_interleave_columns(const flight_manager_t *manager) {
+    GArray *const columns[] = {manager->flights_column,
+                               manager->origins_column,
+                               manager->destinations_column,
+                               manager->schedule_departure_dates_column,
+                               manager->real_departure_dates_column,
+                               manager->passengers_column};
+
+    for (size_t i = 0; i < sizeof(columns) / sizeof(*columns); ++i)
+        numa_topology_interleave(columns[i]->data,
+                                 columns[i]->len * g_array_get_element_size(columns[i]));
+}
+
+int flight_manager_compact(flight_manager_t *manager) {
+    pool_trim(manager->flights);
+    string_pool_no_duplicates_trim(manager->strings);
+    __flight_manager_remove_invalid_rows(manager);
+
+    /* Clustering is only an optimization, but partitions can't be built without it */
+    if (__flight_manager_cluster(manager))
+        g_array_set_size(manager->partitions, 0);
+    else
+        __flight_manager_partitions_rebuild(manager);
+
+    __flight_manager_zones_rebuild(manager);
+    if (id_table_compact(manager->id_rows_rel))
+        return 1;
+
+    /* Only optimizations for NUMA machines, so failures are ignored */
+    __flight_manager_interleave_columns(manager);
+    id_table_replicate(manager->id_rows_rel);
+    return 0;
+}
+
+int flight_manager_add_to_memory_report(const flight_manager_t *manager,
+                                        memory_report_t        *report) {
+    memory_usage_t usage;
+
+    pool_get_memory_usage(manager->flights, &usage);
+    if (memory_report_add(report, "flights.flights", &usage))
+        return 1;
+
+    string_pool_no_duplicates_get_memory_usage(manager->strings, &usage);
+    if (memory_report_add(report, "flights.strings", &usage))
+        return 1;
+
+    id_table_get_memory_usage(manager->id_rows_rel, &usage);
+    if (memory_report_add(report, "flights.id_rows_rel", &usage))
+        return 1;
+
+    GArray *const columns[] = {manager->flights_column,
+                               manager->origins_column,
+                               manager->destinations_column,
+                               manager->schedule_departure_dates_column,
+                               manager->real_departure_dates_column,
+                               manager->passengers_column,
+                               manager->invalid_rows};
+
+    usage = (memory_usage_t) {0};
+    memory_usage_add_arrays(&usage, sizeof(columns) / sizeof(*columns), columns);
+    if (memory_report_add(report, "flights.columns", &usage))
+        return 1;
+
+    usage = (memory_usage_t) {0};
+    memory_usage_add_arrays(&usage, 1, &manager->zones);
+    if (memory_report_add(report, "flights.zones", &usage))
+        return 1;
+
+    usage = (memory_usage_t) {0};
+    memory_usage_add_arrays(&usage, 1, &manager->partitions);
+    if (memory_report_add(report, "flights.partitions", &usage))
+        return 1;
+
+    if (manager->id_filter) {
+        const size_t filter_bytes = bloom_filter_get_size(manager->id_filter);
+        if (memory_report_add_allocation(report, "flights.id_filter", filter_bytes, filter_bytes))
+            return 1;
+    }
+    return 0;
 }
 
 void flight_manager_free(flight_manager_t *manager) {
     pool_free(manager->flights);
     string_pool_no_duplicates_free(manager->strings);
-    g_hash_table_unref(manager->id_flights_rel);
+    id_table_free(manager->id_rows_rel);
+
+    g_array_unref(manager->flights_column);
+    g_array_unref(manager->origins_column);
+    g_array_unref(manager->destinations_column);
+    g_array_unref(manager->schedule_departure_dates_column);
+    g_array_unref(manager->real_departure_dates_column);
+    g_array_unref(manager->passengers_column);
+    g_array_unref(manager->zones);
+    g_array_unref(manager->partitions);
+    bloom_filter_free(manager->id_filter);
+    g_array_unref(manager->invalid_rows);
     free(manager);
 }
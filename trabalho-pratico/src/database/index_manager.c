@@ -0,0 +1,1905 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  index_manager.c
+ * @brief Implementation of methods in include/database/index_manager.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref index_manager_examples).
+ */
+
+#include <locale.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "database/index_manager.h"
+#include "testing/performance_access.h"
+#include "utils/date.h"
+#include "utils/date_and_time.h"
+#include "utils/int_utils.h"
+#include "utils/parallel_sort.h"
+#include "utils/radix_sort.h"
+#include "utils/thread_pool.h"
+
+/**
+ * @struct index_manager
+ * @brief  Lazily built secondary indexes over the entities in a database.
+ *
+ * @var index_manager::mutex
+ *     @brief Protects indexes from being built by more than one thread at the same time.
+ * @var index_manager::hotel_reservations
+ *     @brief Hash table for ::hotel_id_t -> ::GConstPtrArray of ::reservation_t mapping, or `NULL`
+ *            if not yet built.
+ * @var index_manager::hotel_nights
+ *     @brief Hash table for ::hotel_id_t -> ::index_manager_hotel_nights_t mapping, or `NULL` if
+ *            not yet built.
+ * @var index_manager::origin_flights
+ *     @brief Hash table for ::airport_code_t -> ::GConstPtrArray of ::flight_t mapping, or `NULL`
+ *            if not yet built.
+ * @var index_manager::origin_departures
+ *     @brief Hash table for ::airport_code_t -> `GArray` of ::date_and_time_t mapping, with the
+ *            scheduled departure dates of the flights in ::index_manager::origin_flights. Built
+ *            alongside it.
+ * @var index_manager::year_airport_passengers
+ *     @brief Hash table for year -> `GArray` of ::index_manager_airport_passengers_t mapping, or
+ *            `NULL` if not yet built.
+ * @var index_manager::origin_delay_medians
+ *     @brief `GArray` of ::index_manager_airport_delay_t, sorted by median delay (from the largest
+ *            one) and then by airport code, or `NULL` if not yet built.
+ * @var index_manager::user_names
+ *     @brief `GArray` of ::index_manager_user_name_t, sorted by user name, or `NULL` if not yet
+ *            built.
+ * @var index_manager::user_name_trie
+ *     @brief Trie over the names in ::index_manager::user_names. Built alongside it.
+ */
+struct index_manager {
+    pthread_mutex_t mutex;
+    GHashTable     *hotel_reservations;
+    GHashTable     *hotel_nights;
+    GHashTable     *origin_flights;
+    GHashTable     *origin_departures;
+    GHashTable     *year_airport_passengers;
+    GArray         *origin_delay_medians;
+    GArray         *user_names;
+    prefix_trie_t  *user_name_trie;
+};
+
+index_manager_t *index_manager_create(void) {
+    index_manager_t *const manager = malloc(sizeof(index_manager_t));
+    if (!manager)
+        return NULL;
+
+    if (pthread_mutex_init(&manager->mutex, NULL)) {
+        free(manager);
+        return NULL;
+    }
+
+    manager->hotel_reservations      = NULL;
+    manager->hotel_nights            = NULL;
+    manager->origin_flights          = NULL;
+    manager->origin_departures       = NULL;
+    manager->year_airport_passengers = NULL;
+    manager->origin_delay_medians    = NULL;
+    manager->user_names              = NULL;
+    manager->user_name_trie          = NULL;
+    return manager;
+}
+
+void index_manager_invalidate(index_manager_t *manager) {
+    GHashTable **const indexes[5] = {&manager->hotel_reservations,
+                                     &manager->hotel_nights,
+                                     &manager->origin_flights,
+                                     &manager->origin_departures,
+                                     &manager->year_airport_passengers};
+
+    for (size_t i = 0; i < 5; ++i) {
+        if (*indexes[i]) {
+            g_hash_table_unref(*indexes[i]);
+            *indexes[i] = NULL;
+        }
+    }
+
+    GArray **const arrays[2] = {&manager->origin_delay_medians, &manager->user_names};
+    for (size_t i = 0; i < 2; ++i) {
+        if (*arrays[i]) {
+            g_array_unref(*arrays[i]);
+            *arrays[i] = NULL;
+        }
+    }
+    prefix_trie_free(manager->user_name_trie);
+    manager->user_name_trie = NULL;
+}
+
+/**
+ * @brief   Callback for every span of reservations, that adds them to the arrays of their hotels.
+ * @details Auxiliary method for ::__index_manager_build_hotel_reservations.
+ *
+ * @param user_data `GPtrArray` of ::GConstPtrArray of ::reservation_t, indexed by ::hotel_id_t
+ *                  (hotel identifiers are already dense integers).
+ * @param columns   Reservations to be added to the index.
+ *
+ * @retval 0 Always successful.
+ */
+int __index_manager_build_hotel_reservations_foreach(void                                *user_data,
+                                                     const reservation_manager_columns_t *columns) {
+    GPtrArray *const hotel_reservations = user_data;
+
+    for (size_t i = 0; i < columns->length; ++i) {
+        const hotel_id_t hotel_id = columns->hotel_ids[i];
+        if (hotel_id >= hotel_reservations->len)
+            g_ptr_array_set_size(hotel_reservations, (guint) hotel_id + 1);
+
+        GConstPtrArray **const reservations =
+            (GConstPtrArray **) &g_ptr_array_index(hotel_reservations, hotel_id);
+        if (!*reservations)
+            *reservations = g_const_ptr_array_new();
+
+        g_const_ptr_array_add(*reservations, columns->reservations[i]);
+    }
+    return 0;
+}
+
+/**
+ * @brief   A comparison function for sorting a ::GConstPtrArray of reservations.
+ * @details Newest reservations first, ties broken by identifier.
+ */
+gint __index_manager_reservations_compare_func(const void *const *a, const void *const *b) {
+    const reservation_t *const reservation_a = *((const reservation_t *const *) a);
+    const reservation_t *const reservation_b = *((const reservation_t *const *) b);
+
+    const int64_t crit1 = date_diff(reservation_get_begin_date(reservation_b),
+                                    reservation_get_begin_date(reservation_a));
+    if (crit1)
+        return crit1;
+
+    const int64_t crit2 = reservation_get_id(reservation_a) - reservation_get_id(reservation_b);
+    return crit2;
+}
+
+/**
+ * @brief   Callback type for filling the sorting keys of an item in a ::GConstPtrArray.
+ * @details Method called by ::__index_manager_radix_sort for every item.
+ *
+ * @param item  Item in the array being sorted.
+ * @param entry Entry whose ::radix_sort_entry_t::key and ::radix_sort_entry_t::tiebreak are to be
+ *              filled in.
+ */
+typedef void (*index_manager_radix_sort_key_callback_t)(const void         *item,
+                                                        radix_sort_entry_t *entry);
+
+/**
+ * @brief   Sorts an array of constant pointers by integer keys, with ::radix_sort.
+ * @details Used instead of `g_const_ptr_array_sort`, that calls a comparison function (that
+ *          dereferences both items) `O(n log n)` times.
+ *
+ * @param array    Array to be sorted.
+ * @param key_func Method that calculates the sorting keys of each item.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p array is left unmodified).
+ */
+int __index_manager_radix_sort(GConstPtrArray                         *array,
+                               index_manager_radix_sort_key_callback_t key_func) {
+    const size_t              length  = g_const_ptr_array_get_length(array);
+    radix_sort_entry_t *const entries = malloc(max(length, 1) * sizeof(radix_sort_entry_t));
+    if (!entries)
+        return 1;
+
+    for (size_t i = 0; i < length; ++i) {
+        entries[i].value = g_const_ptr_array_index(array, i);
+        key_func(entries[i].value, &entries[i]);
+    }
+
+    if (radix_sort(entries, length)) {
+        free(entries);
+        return 1;
+    }
+
+    for (size_t i = 0; i < length; ++i)
+        g_const_ptr_array_set(array, i, entries[i].value);
+
+    free(entries);
+    return 0;
+}
+
+/**
+ * @brief   Minimum number of items each sorting thread should have to sort.
+ * @details Avoids creating threads for small datasets, where that would be slower than sorting
+ *          everything in the calling thread.
+ */
+#define INDEX_MANAGER_MIN_ITEMS_PER_SORT_THREAD 65536
+
+/**
+ * @struct index_manager_sort_data_t
+ * @brief  Work shared by all threads sorting the groups of an index.
+ *
+ * @var index_manager_sort_data_t::arrays
+ *     @brief Groups (::GConstPtrArray) to be sorted, from the largest one.
+ * @var index_manager_sort_data_t::length
+ *     @brief Number of elements in ::index_manager_sort_data_t::arrays.
+ * @var index_manager_sort_data_t::key_func
+ *     @brief Method that calculates the sorting keys of each item.
+ * @var index_manager_sort_data_t::compare_func
+ *     @brief Comparison function equivalent to ::index_manager_sort_data_t::key_func, used if
+ *            radix sorting fails.
+ */
+typedef struct {
+    GConstPtrArray                        **arrays;
+    size_t                                  length;
+    index_manager_radix_sort_key_callback_t key_func;
+    GConstCompareFunc                       compare_func;
+} index_manager_sort_data_t;
+
+/**
+ * @brief   A comparison function for sorting arrays of ::GConstPtrArray by length.
+ * @details Longest arrays first, so that threads finish sorting at similar times.
+ */
+int __index_manager_array_length_compare_func(const void *a, const void *b) {
+    const size_t length_a = g_const_ptr_array_get_length(*((GConstPtrArray *const *) a));
+    const size_t length_b = g_const_ptr_array_get_length(*((GConstPtrArray *const *) b));
+    return (length_a < length_b) - (length_a > length_b);
+}
+
+/**
+ * @brief   Sorts a range of groups.
+ * @details Auxiliary method for ::__index_manager_sort_groups, run in parallel by
+ *          ::thread_pool_parallel_for. Threads that finish their groups early take the next
+ *          unsorted one, so no thread idles while others are stuck with large groups.
+ *
+ * @param sort_data_data A ::index_manager_sort_data_t.
+ * @param start          Index of the first group to sort.
+ * @param end            Index after the last group to sort.
+ */
+void __index_manager_sort_groups_range(void *sort_data_data, size_t start, size_t end) {
+    index_manager_sort_data_t *const sort_data = sort_data_data;
+
+    for (size_t i = start; i < end; ++i)
+        if (__index_manager_radix_sort(sort_data->arrays[i], sort_data->key_func))
+            g_const_ptr_array_sort(sort_data->arrays[i], sort_data->compare_func);
+}
+
+/**
+ * @brief   Sorts each group (array of items) in an index.
+ * @details Different groups are independent, so they're sorted in parallel, if there are enough
+ *          items for that to be worth it.
+ *
+ * @param groups       Hash table whose values are the groups (::GConstPtrArray) to be sorted.
+ * @param key_func     Method that calculates the sorting keys of each item.
+ * @param compare_func Comparison function equivalent to @p key_func, used if radix sorting fails.
+ */
+void __index_manager_sort_groups(GHashTable                             *groups,
+                                 index_manager_radix_sort_key_callback_t key_func,
+                                 GConstCompareFunc                       compare_func) {
+    index_manager_sort_data_t sort_data = {
+        .arrays       = malloc(sizeof(GConstPtrArray *) * g_hash_table_size(groups)),
+        .length       = 0,
+        .key_func     = key_func,
+        .compare_func = compare_func};
+
+    GHashTableIter iter;
+    gpointer       list;
+    g_hash_table_iter_init(&iter, groups);
+
+    if (!sort_data.arrays) { /* Allocation failure: sort in the calling thread */
+        while (g_hash_table_iter_next(&iter, NULL, &list))
+            g_const_ptr_array_sort(list, compare_func);
+        return;
+    }
+
+    size_t nitems = 0;
+    while (g_hash_table_iter_next(&iter, NULL, &list)) {
+        sort_data.arrays[sort_data.length++] = list;
+        nitems += g_const_ptr_array_get_length(list);
+    }
+    qsort(sort_data.arrays,
+          sort_data.length,
+          sizeof(GConstPtrArray *),
+          __index_manager_array_length_compare_func);
+
+    /* Only use the shared pool if there are enough items for threads to be worth it */
+    thread_pool_t *const pool =
+        nitems >= 2 * INDEX_MANAGER_MIN_ITEMS_PER_SORT_THREAD ? thread_pool_get_shared() : NULL;
+    thread_pool_parallel_for(pool,
+                             sort_data.length,
+                             1,
+                             __index_manager_sort_groups_range,
+                             &sort_data);
+
+    free(sort_data.arrays);
+}
+
+/**
+ * @brief   Fills in the sorting keys of a reservation.
+ * @details Auxiliary method for ::__index_manager_build_hotel_reservations. Sorts like
+ *          ::__index_manager_reservations_compare_func.
+ *
+ * @param item  A ::reservation_t.
+ * @param entry Where to write the reservation's sorting keys to.
+ */
+void __index_manager_reservation_radix_key(const void *item, radix_sort_entry_t *entry) {
+    entry->key      = radix_sort_descending(reservation_get_begin_date(item));
+    entry->tiebreak = reservation_get_id(item);
+}
+
+/**
+ * @brief Builds ::index_manager::hotel_reservations, if it doesn't exist yet.
+ *
+ * @param manager      Index manager to build the index in. Its mutex must be locked.
+ * @param reservations Reservations to build the index from.
+ */
+void __index_manager_build_hotel_reservations(index_manager_t             *manager,
+                                              const reservation_manager_t *reservations) {
+    if (manager->hotel_reservations)
+        return;
+
+    GHashTable *const hotel_reservations =
+        g_hash_table_new_full(g_direct_hash,
+                              g_direct_equal,
+                              NULL,
+                              (GDestroyNotify) g_const_ptr_array_unref);
+
+    /* Group by hotel in a plain array, and only hash the identifiers of existing hotels */
+    GPtrArray *const dense = g_ptr_array_new();
+    reservation_manager_iter_columns(reservations,
+                                     __index_manager_build_hotel_reservations_foreach,
+                                     dense);
+    for (size_t i = 0; i < dense->len; ++i)
+        if (g_ptr_array_index(dense, i))
+            g_hash_table_insert(hotel_reservations,
+                                GUINT_TO_POINTER(i),
+                                g_ptr_array_index(dense, i));
+    g_ptr_array_unref(dense);
+
+    __index_manager_sort_groups(hotel_reservations,
+                                __index_manager_reservation_radix_key,
+                                __index_manager_reservations_compare_func);
+
+    manager->hotel_reservations = hotel_reservations;
+}
+
+/**
+ * @brief   Maximum ratio between the number of days a hotel's reservations span and the number of
+ *          reservations in that hotel, for ::index_manager_hotel_nights_t::revenue_prefix to be
+ *          built.
+ * @details Keeps the size of the prefix sums proportional to the number of reservations.
+ */
+#define INDEX_MANAGER_REVENUE_PREFIX_MAX_DAYS_PER_RESERVATION 32
+
+/**
+ * @brief Calculates the range of nights a reservation makes money on.
+ *
+ * @param reservation Reservation to get the nights of.
+ * @param first_night Where to write the day number of the first night to.
+ * @param last_night  Where to write the day number of the last night to.
+ */
+void __index_manager_get_reservation_nights(const reservation_t *reservation,
+                                            int32_t             *first_night,
+                                            int32_t             *last_night) {
+    /* Reservations don't make money on their last day */
+    date_t end = reservation_get_end_date(reservation);
+    date_set_day(&end, date_get_day(end) - 1);
+
+    *first_night = date_to_day_number(reservation_get_begin_date(reservation));
+    *last_night  = date_to_day_number(end);
+}
+
+/**
+ * @brief   Creates the ::index_manager_hotel_nights_t of a hotel from its reservations.
+ * @details Auxiliary method for ::__index_manager_build_hotel_nights.
+ *
+ * @param hotel     Hotel identifier, as a pointer.
+ * @param list      Sorted array (::GConstPtrArray) of the hotel's reservations.
+ * @param user_data Hash table where to insert the new ::index_manager_hotel_nights_t.
+ */
+void __index_manager_build_hotel_nights_foreach(gpointer hotel, gpointer list, gpointer user_data) {
+    const GConstPtrArray *const reservations = list;
+    const size_t                length       = g_const_ptr_array_get_length(reservations);
+
+    /* Find the range of days covered by the hotel's reservations, to size the prefix sums */
+    int32_t first_day = INT32_MAX, last_day = INT32_MIN;
+    for (size_t i = 0; i < length; ++i) {
+        int32_t first_night, last_night;
+        __index_manager_get_reservation_nights(g_const_ptr_array_index(reservations, i),
+                                               &first_night,
+                                               &last_night);
+        first_day = min(first_day, first_night);
+        last_day  = max(last_day, last_night);
+    }
+
+    const size_t days = last_day >= first_day ? (size_t) (last_day - first_day) + 1 : 0;
+    const size_t prefix_length =
+        days && days <= INDEX_MANAGER_REVENUE_PREFIX_MAX_DAYS_PER_RESERVATION * length ? days + 1
+                                                                                       : 0;
+
+    /*
+     * Allocate the structure and its arrays in a single block, so that one free is enough. The
+     * 64-bit prefix sums come first, so that they're aligned.
+     */
+    index_manager_hotel_nights_t *const nights =
+        g_malloc(sizeof(index_manager_hotel_nights_t) + prefix_length * sizeof(int64_t) +
+                 3 * length * sizeof(int32_t));
+    int64_t *const revenue_prefix   = (int64_t *) (nights + 1);
+    int32_t *const first_nights     = (int32_t *) (revenue_prefix + prefix_length);
+    int32_t *const last_nights      = first_nights + length;
+    int32_t *const prices_per_night = last_nights + length;
+
+    if (prefix_length)
+        memset(revenue_prefix, 0, prefix_length * sizeof(int64_t));
+
+    for (size_t i = 0; i < length; ++i) {
+        const reservation_t *const reservation = g_const_ptr_array_index(reservations, i);
+        __index_manager_get_reservation_nights(reservation, &first_nights[i], &last_nights[i]);
+        prices_per_night[i] = reservation_get_price_per_night(reservation);
+
+        /* Difference array of the daily revenue: starts at the first night, stops after the last */
+        if (prefix_length && first_nights[i] <= last_nights[i]) {
+            revenue_prefix[first_nights[i] - first_day] += prices_per_night[i];
+            revenue_prefix[last_nights[i] - first_day + 1] -= prices_per_night[i];
+        }
+    }
+
+    /* Difference array -> daily revenue -> revenue before each day */
+    int64_t daily = 0, sum = 0;
+    for (size_t i = 0; i < prefix_length; ++i) {
+        daily += revenue_prefix[i];
+        revenue_prefix[i] = sum;
+        sum += daily;
+    }
+
+    nights->length           = length;
+    nights->first_nights     = first_nights;
+    nights->last_nights      = last_nights;
+    nights->prices_per_night = prices_per_night;
+    nights->first_day        = first_day;
+    nights->days             = days;
+    nights->revenue_prefix   = prefix_length ? revenue_prefix : NULL;
+    g_hash_table_insert(user_data, hotel, nights);
+}
+
+/**
+ * @brief Builds ::index_manager::hotel_nights (and its dependencies), if it doesn't exist yet.
+ *
+ * @param manager      Index manager to build the index in. Its mutex must be locked.
+ * @param reservations Reservations to build the index from.
+ */
+void __index_manager_build_hotel_nights(index_manager_t             *manager,
+                                        const reservation_manager_t *reservations) {
+    if (manager->hotel_nights)
+        return;
+
+    __index_manager_build_hotel_reservations(manager, reservations);
+
+    GHashTable *const hotel_nights =
+        g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    g_hash_table_foreach(manager->hotel_reservations,
+                         __index_manager_build_hotel_nights_foreach,
+                         hotel_nights);
+
+    manager->hotel_nights = hotel_nights;
+}
+
+/**
+ * @brief   Callback for every span of flights, that adds them to the arrays of their origins.
+ * @details Auxiliary method for ::__index_manager_build_origin_flights.
+ *
+ * @param user_data Array of ::AIRPORT_CODE_INDEX_COUNT ::GConstPtrArray of ::flight_t (or `NULL`),
+ *                  indexed by ::airport_code_to_index.
+ * @param columns   Flights to be added to the index.
+ *
+ * @retval 0 Always successful.
+ */
+int __index_manager_build_origin_flights_foreach(void                           *user_data,
+                                                 const flight_manager_columns_t *columns) {
+    GConstPtrArray **const origin_flights = user_data;
+
+    for (size_t i = 0; i < columns->length; ++i) {
+        GConstPtrArray **const flights =
+            &origin_flights[airport_code_to_index(columns->origins[i])];
+        if (!*flights)
+            *flights = g_const_ptr_array_new();
+
+        g_const_ptr_array_add(*flights, columns->flights[i]);
+    }
+    return 0;
+}
+
+/**
+ * @brief   A comparison function for sorting a ::GConstPtrArray of flights.
+ * @details Newest scheduled departures first, ties broken by identifier.
+ */
+gint __index_manager_flights_compare_func(const void *const *a, const void *const *b) {
+    const flight_t *const flight_a = *((const flight_t *const *) a);
+    const flight_t *const flight_b = *((const flight_t *const *) b);
+
+    const int64_t crit1 = date_and_time_diff(flight_get_schedule_departure_date(flight_b),
+                                             flight_get_schedule_departure_date(flight_a));
+    if (crit1)
+        return crit1;
+
+    const int32_t crit2 = flight_get_id(flight_a) - flight_get_id(flight_b);
+    return crit2;
+}
+
+/**
+ * @brief   Fills in the sorting keys of a flight.
+ * @details Auxiliary method for ::__index_manager_build_origin_flights. Sorts like
+ *          ::__index_manager_flights_compare_func.
+ *
+ * @param item  A ::flight_t.
+ * @param entry Where to write the flight's sorting keys to.
+ */
+void __index_manager_flight_radix_key(const void *item, radix_sort_entry_t *entry) {
+    entry->key      = radix_sort_descending(flight_get_schedule_departure_date(item));
+    entry->tiebreak = flight_get_id(item);
+}
+
+/**
+ * @brief   Creates the array of scheduled departure dates of the flights from an origin airport.
+ * @details Auxiliary method for ::__index_manager_build_origin_flights.
+ *
+ * @param origin    Airport code encoded as a pointer.
+ * @param list      Sorted array (::GConstPtrArray) of the flights from @p origin.
+ * @param user_data Hash table where to insert the new `GArray` of ::date_and_time_t.
+ */
+void __index_manager_build_origin_departures_foreach(gpointer origin,
+                                                     gpointer list,
+                                                     gpointer user_data) {
+    const GConstPtrArray *const flights = list;
+    const size_t                length  = g_const_ptr_array_get_length(flights);
+
+    GArray *const departures = g_array_sized_new(FALSE, FALSE, sizeof(date_and_time_t), length);
+    for (size_t i = 0; i < length; ++i) {
+        const date_and_time_t departure =
+            flight_get_schedule_departure_date(g_const_ptr_array_index(flights, i));
+        g_array_append_val(departures, departure);
+    }
+
+    g_hash_table_insert(user_data, origin, departures);
+}
+
+/**
+ * @struct index_manager_flight_visitor_t
+ * @brief  A consumer of flights in a pass over a flight manager shared by many indexes (see
+ *         ::__index_manager_visit_flights).
+ *
+ * @var index_manager_flight_visitor_t::callback
+ *     @brief Method called for every span of flights.
+ * @var index_manager_flight_visitor_t::user_data
+ *     @brief Argument of ::index_manager_flight_visitor_t::callback.
+ */
+typedef struct {
+    flight_manager_iter_columns_callback_t callback;
+    void                                  *user_data;
+} index_manager_flight_visitor_t;
+
+/**
+ * @struct index_manager_flight_visitors_t
+ * @brief  All consumers of flights in a pass over a flight manager.
+ *
+ * @var index_manager_flight_visitors_t::n
+ *     @brief Number of visitors in ::index_manager_flight_visitors_t::visitors.
+ * @var index_manager_flight_visitors_t::visitors
+ *     @brief Visitors fed by the pass.
+ */
+typedef struct {
+    size_t                         n;
+    index_manager_flight_visitor_t visitors[3];
+} index_manager_flight_visitors_t;
+
+/**
+ * @brief   Callback for every span of flights, that feeds it to many visitors.
+ * @details A span of flight columns is still in cache when the next visitor reads it, so building
+ *          many indexes in the same pass is much faster than making one pass per index.
+ *
+ * @param user_data A pointer to a ::index_manager_flight_visitors_t.
+ * @param columns   Flights to be visited.
+ *
+ * @return The first non-zero value returned by a visitor, or `0` on success.
+ */
+int __index_manager_visit_flights(void *user_data, const flight_manager_columns_t *columns) {
+    const index_manager_flight_visitors_t *const visitors = user_data;
+
+    for (size_t i = 0; i < visitors->n; ++i) {
+        const int retval = visitors->visitors[i].callback(visitors->visitors[i].user_data, columns);
+        if (retval)
+            return retval;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Creates the state used to group flights by origin.
+ * @details Flights are grouped by origin in a plain array, and only the codes of existing
+ *          airports are hashed, in ::__index_manager_finish_origin_flights.
+ *
+ * @return An array of ::AIRPORT_CODE_INDEX_COUNT ::GConstPtrArray of ::flight_t (or `NULL`),
+ *         indexed by ::airport_code_to_index. It must be passed to
+ *         ::__index_manager_build_origin_flights_foreach and then to
+ *         ::__index_manager_finish_origin_flights.
+ */
+GConstPtrArray **__index_manager_begin_origin_flights(void) {
+    return g_malloc0(sizeof(GConstPtrArray *) * AIRPORT_CODE_INDEX_COUNT);
+}
+
+/**
+ * @brief Builds ::index_manager::origin_flights and ::index_manager::origin_departures from flights
+ *        grouped by origin.
+ *
+ * @param manager Index manager to build the index in. Its mutex must be locked.
+ * @param dense   Flights grouped by ::__index_manager_build_origin_flights_foreach. Freed by this
+ *                method.
+ */
+void __index_manager_finish_origin_flights(index_manager_t *manager, GConstPtrArray **dense) {
+    GHashTable *const origin_flights =
+        g_hash_table_new_full(g_direct_hash,
+                              g_direct_equal,
+                              NULL,
+                              (GDestroyNotify) g_const_ptr_array_unref);
+
+    for (size_t i = 0; i < AIRPORT_CODE_INDEX_COUNT; ++i)
+        if (dense[i])
+            g_hash_table_insert(origin_flights,
+                                GUINT_TO_POINTER(airport_code_from_index(i)),
+                                dense[i]);
+    g_free(dense);
+
+    __index_manager_sort_groups(origin_flights,
+                                __index_manager_flight_radix_key,
+                                __index_manager_flights_compare_func);
+
+    /* Contiguous dates, so that binary searches don't need to go through flight pointers */
+    GHashTable *const origin_departures =
+        g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_array_unref);
+    g_hash_table_foreach(origin_flights,
+                         __index_manager_build_origin_departures_foreach,
+                         origin_departures);
+
+    manager->origin_flights    = origin_flights;
+    manager->origin_departures = origin_departures;
+}
+
+/**
+ * @brief Builds ::index_manager::origin_flights and ::index_manager::origin_departures, if they
+ *        don't exist yet.
+ *
+ * @param manager Index manager to build the index in. Its mutex must be locked.
+ * @param flights Flights to build the index from.
+ */
+void __index_manager_build_origin_flights(index_manager_t        *manager,
+                                          const flight_manager_t *flights) {
+    if (manager->origin_flights)
+        return;
+
+    GConstPtrArray **const dense = __index_manager_begin_origin_flights();
+    flight_manager_iter_columns(flights, __index_manager_build_origin_flights_foreach, dense);
+    __index_manager_finish_origin_flights(manager, dense);
+}
+
+/**
+ * @brief   Adds a number of passengers to an airport in a year's dense array of passenger counts.
+ * @details Auxiliary method for ::__index_manager_build_year_airport_passengers_foreach.
+ *
+ * @param airport_count  Array of ::AIRPORT_CODE_INDEX_COUNT ::index_manager_airport_passengers_t,
+ *                       indexed by ::airport_code_to_index. Airports without any flight have a
+ *                       null ::index_manager_airport_passengers_t::airport.
+ * @param airport        Airport to add passengers to.
+ * @param num_passengers Number of passengers to be added to @p airport in @p airport_count.
+ */
+void __index_manager_add_airport_passengers(index_manager_airport_passengers_t *airport_count,
+                                            airport_code_t                      airport,
+                                            uint16_t                            num_passengers) {
+    index_manager_airport_passengers_t *const item =
+        &airport_count[airport_code_to_index(airport)];
+    item->airport = airport;
+    item->passengers += num_passengers;
+}
+
+/**
+ * @brief   Callback for every span of flights, that adds their passengers to their airports in
+ *          their year.
+ * @details Auxiliary method for ::__index_manager_build_year_airport_passengers.
+ *
+ * @param user_data `GHashTable` that associates years with dense arrays of passenger counts (see
+ *                  ::__index_manager_add_airport_passengers).
+ * @param columns   Flights to be considered.
+ *
+ * @retval 0 Always successful.
+ */
+int __index_manager_build_year_airport_passengers_foreach(void                           *user_data,
+                                                          const flight_manager_columns_t *columns) {
+    GHashTable *const years = user_data;
+
+    for (size_t i = 0; i < columns->length; ++i) {
+        const uint16_t year =
+            date_get_year(date_and_time_get_date(columns->schedule_departure_dates[i]));
+
+        index_manager_airport_passengers_t *airport_count =
+            g_hash_table_lookup(years, GUINT_TO_POINTER(year));
+        if (!airport_count) {
+            airport_count =
+                g_malloc0(sizeof(index_manager_airport_passengers_t) * AIRPORT_CODE_INDEX_COUNT);
+            g_hash_table_insert(years, GUINT_TO_POINTER(year), airport_count);
+        }
+
+        const uint16_t num_passengers = columns->passengers[i];
+        __index_manager_add_airport_passengers(airport_count, columns->origins[i], num_passengers);
+        __index_manager_add_airport_passengers(airport_count,
+                                               columns->destinations[i],
+                                               num_passengers);
+    }
+    return 0;
+}
+
+/**
+ * @brief   Comparison function for ::index_manager_airport_passengers_t.
+ * @details Airports with the most passengers first, ties broken by airport code.
+ */
+gint __index_manager_airport_passengers_compare_func(gconstpointer a, gconstpointer b) {
+    const index_manager_airport_passengers_t *const item_a = a;
+    const index_manager_airport_passengers_t *const item_b = b;
+
+    const int64_t crit1 = (int64_t) item_b->passengers - (int64_t) item_a->passengers;
+    if (crit1)
+        return crit1;
+
+    /* Airport code indices are in alphabetical order */
+    const size_t index_a = airport_code_to_index(item_a->airport);
+    const size_t index_b = airport_code_to_index(item_b->airport);
+    return (index_a > index_b) - (index_a < index_b);
+}
+
+/**
+ * @brief   Converts the dense array of passenger counts of a year into a ranked array.
+ * @details Auxiliary method for ::__index_manager_build_year_airport_passengers.
+ *
+ * @param key_year            Year, as a pointer.
+ * @param value_airport_count Dense array of passenger counts of @p key_year (see
+ *                            ::__index_manager_add_airport_passengers).
+ * @param user_data           `GHashTable` (year -> `GArray`) where to insert the array.
+ */
+void __index_manager_build_year_airport_passengers_foreach_year(gpointer key_year,
+                                                                gpointer value_airport_count,
+                                                                gpointer user_data) {
+
+    const index_manager_airport_passengers_t *const airport_count = value_airport_count;
+    GArray *const                                   array =
+        g_array_new(FALSE, FALSE, sizeof(index_manager_airport_passengers_t));
+
+    for (size_t i = 0; i < AIRPORT_CODE_INDEX_COUNT; ++i)
+        if (airport_count[i].airport)
+            g_array_append_val(array, airport_count[i]);
+    g_array_sort(array, __index_manager_airport_passengers_compare_func);
+
+    g_hash_table_insert(user_data, key_year, array);
+}
+
+/**
+ * @brief  Creates the state used to count the passengers of every airport in every year.
+ * @return A `GHashTable` to be passed to ::__index_manager_build_year_airport_passengers_foreach,
+ *         and then to ::__index_manager_finish_year_airport_passengers.
+ */
+GHashTable *__index_manager_begin_year_airport_passengers(void) {
+    return g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+}
+
+/**
+ * @brief   Creates the passenger counts of a range of flights.
+ * @details Callback for ::flight_manager_parallel_iter_columns.
+ *
+ * @param user_data Passenger counts of all flights (not used).
+ *
+ * @return A `GHashTable` like the one returned by ::__index_manager_begin_year_airport_passengers.
+ */
+void *__index_manager_year_airport_passengers_init(void *user_data) {
+    (void) user_data;
+    return __index_manager_begin_year_airport_passengers();
+}
+
+/**
+ * @brief   Adds the passenger counts of a range of flights to the counts of all flights.
+ * @details Callback for ::flight_manager_parallel_iter_columns.
+ *
+ * @param user_data   Passenger counts of all flights (see
+ *                    ::__index_manager_begin_year_airport_passengers).
+ * @param accumulator Passenger counts of a range of flights, freed by this method.
+ */
+void __index_manager_year_airport_passengers_merge(void *user_data, void *accumulator) {
+    GHashTable *const years       = user_data;
+    GHashTable *const range_years = accumulator;
+
+    GHashTableIter iter;
+    gpointer       key_year, value_airport_count;
+    g_hash_table_iter_init(&iter, range_years);
+    while (g_hash_table_iter_next(&iter, &key_year, &value_airport_count)) {
+        index_manager_airport_passengers_t *const airport_count =
+            g_hash_table_lookup(years, key_year);
+        if (!airport_count) {
+            g_hash_table_iter_steal(&iter);
+            g_hash_table_insert(years, key_year, value_airport_count);
+            continue;
+        }
+
+        const index_manager_airport_passengers_t *const range_count = value_airport_count;
+        for (size_t i = 0; i < AIRPORT_CODE_INDEX_COUNT; ++i) {
+            if (range_count[i].airport) {
+                airport_count[i].airport = range_count[i].airport;
+                airport_count[i].passengers += range_count[i].passengers;
+            }
+        }
+    }
+
+    g_hash_table_unref(range_years);
+}
+
+/**
+ * @brief Builds ::index_manager::year_airport_passengers from the passenger counts of airports.
+ *
+ * @param manager Index manager to build the index in. Its mutex must be locked.
+ * @param years   Passenger counts from ::__index_manager_build_year_airport_passengers_foreach.
+ *                Freed by this method.
+ */
+void __index_manager_finish_year_airport_passengers(index_manager_t *manager, GHashTable *years) {
+    GHashTable *const year_airport_passengers =
+        g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_array_unref);
+    g_hash_table_foreach(years,
+                         __index_manager_build_year_airport_passengers_foreach_year,
+                         year_airport_passengers);
+    g_hash_table_unref(years);
+
+    manager->year_airport_passengers = year_airport_passengers;
+}
+
+/**
+ * @brief Builds ::index_manager::year_airport_passengers, if it doesn't exist yet.
+ *
+ * @param manager Index manager to build the index in. Its mutex must be locked.
+ * @param flights Flights to build the index from.
+ */
+void __index_manager_build_year_airport_passengers(index_manager_t        *manager,
+                                                   const flight_manager_t *flights) {
+    if (manager->year_airport_passengers)
+        return;
+
+    /* Counts are integers, so ranges of flights can be counted in parallel and then added up */
+    GHashTable *const years = __index_manager_begin_year_airport_passengers();
+    flight_manager_parallel_iter_columns(flights,
+                                         thread_pool_get_shared(),
+                                         __index_manager_year_airport_passengers_init,
+                                         __index_manager_build_year_airport_passengers_foreach,
+                                         __index_manager_year_airport_passengers_merge,
+                                         years);
+    __index_manager_finish_year_airport_passengers(manager, years);
+}
+
+/**
+ * @brief   A comparison function for sorting an array of `int64_t`s with `qsort`.
+ * @details Auxiliary method for ::__index_manager_select_int64.
+ */
+int __index_manager_int64_compare_func(const void *a, const void *b) {
+    const int64_t value_a = *(const int64_t *) a;
+    const int64_t value_b = *(const int64_t *) b;
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+/**
+ * @brief   Swaps two `int64_t`s.
+ * @details Auxiliary method for ::__index_manager_select_int64.
+ */
+void __index_manager_swap_int64(int64_t *a, int64_t *b) {
+    const int64_t tmp = *a;
+    *a                = *b;
+    *b                = tmp;
+}
+
+/**
+ * @brief   Selects the @p k-th smallest element of an array (introselect).
+ * @details Quickselect with median-of-three pivots, that falls back to sorting the remaining range
+ *          when partitioning doesn't converge fast enough, guaranteeing `O(n log n)` in the worst
+ *          case and `O(n)` on average. @p values is reordered so that every element before index
+ *          @p k is not greater than the returned value, and every element after it is not smaller.
+ *
+ * @param values Array of values to select from. Will be reordered.
+ * @param length Number of elements in @p values.
+ * @param k      Index (`0`-based) of the element to select, in sorted order. Must be less than
+ *               @p length.
+ *
+ * @return The @p k-th smallest element of @p values.
+ */
+int64_t __index_manager_select_int64(int64_t *values, size_t length, size_t k) {
+    const ptrdiff_t target = k;
+    ptrdiff_t       left = 0, right = length - 1;
+
+    size_t depth_limit = 0;
+    for (size_t i = length; i; i >>= 1)
+        depth_limit += 2;
+
+    while (left < right) {
+        if (!depth_limit--) {
+            qsort(values + left,
+                  right - left + 1,
+                  sizeof(int64_t),
+                  __index_manager_int64_compare_func);
+            break;
+        }
+
+        /* Median-of-three pivot, placed at the middle of the range */
+        const ptrdiff_t middle = left + (right - left) / 2;
+        if (values[middle] < values[left])
+            __index_manager_swap_int64(&values[middle], &values[left]);
+        if (values[right] < values[left])
+            __index_manager_swap_int64(&values[right], &values[left]);
+        if (values[right] < values[middle])
+            __index_manager_swap_int64(&values[right], &values[middle]);
+        const int64_t pivot = values[middle];
+
+        /* Hoare partition */
+        ptrdiff_t i = left, j = right;
+        while (i <= j) {
+            while (values[i] < pivot)
+                i++;
+            while (values[j] > pivot)
+                j--;
+
+            if (i <= j) {
+                __index_manager_swap_int64(&values[i], &values[j]);
+                i++;
+                j--;
+            }
+        }
+
+        /* [left, j] <= pivot, (j, i) == pivot, [i, right] >= pivot */
+        if (target <= j)
+            right = j;
+        else if (target >= i)
+            left = i;
+        else
+            break;
+    }
+
+    return values[k];
+}
+
+/**
+ * @brief  Creates the state used to collect the departure delays of every origin airport.
+ * @return An array of ::AIRPORT_CODE_INDEX_COUNT `GArray`s of `int64_t` (or `NULL`), indexed by
+ *         ::airport_code_to_index. It must be passed to
+ *         ::__index_manager_build_origin_delay_medians_foreach and then to
+ *         ::__index_manager_finish_origin_delay_medians.
+ */
+GArray **__index_manager_begin_origin_delay_medians(void) {
+    return g_malloc0(sizeof(GArray *) * AIRPORT_CODE_INDEX_COUNT);
+}
+
+/**
+ * @brief   Callback for every span of flights, that adds their departure delays to the arrays of
+ *          their origin airports.
+ * @details Auxiliary method for ::__index_manager_build_origin_delay_medians.
+ *
+ * @param user_data Delays being collected (see ::__index_manager_begin_origin_delay_medians).
+ * @param columns   Flights to be considered.
+ *
+ * @retval 0 Always successful.
+ */
+int __index_manager_build_origin_delay_medians_foreach(void                           *user_data,
+                                                       const flight_manager_columns_t *columns) {
+    GArray **const delays = user_data;
+
+    for (size_t i = 0; i < columns->length; ++i) {
+        GArray **const airport_delays = &delays[airport_code_to_index(columns->origins[i])];
+        if (!*airport_delays)
+            *airport_delays = g_array_new(FALSE, FALSE, sizeof(int64_t));
+
+        const int64_t delay = date_and_time_diff(columns->real_departure_dates[i],
+                                                 columns->schedule_departure_dates[i]);
+        g_array_append_val(*airport_delays, delay);
+    }
+    return 0;
+}
+
+/**
+ * @brief   Calculates the median of an array of delays.
+ * @details Auxiliary method for ::__index_manager_finish_origin_delay_medians. Only the middle
+ *          element(s) are needed, so they're selected instead of sorting all delays.
+ *
+ * @param delays Non-empty array of delays. Will be reordered.
+ * @param length Number of elements in @p delays.
+ *
+ * @return The median of @p delays, rounded to the nearest integer.
+ */
+int64_t __index_manager_delay_median(int64_t *delays, size_t length) {
+    const size_t  middle       = length / 2;
+    const int64_t upper_middle = __index_manager_select_int64(delays, length, middle);
+
+    double median;
+    if (length % 2 == 0) {
+        int64_t lower_middle = delays[0]; /* Largest element before the middle one */
+        for (size_t i = 1; i < middle; ++i)
+            lower_middle = max(lower_middle, delays[i]);
+
+        median = ((uint64_t) upper_middle + (uint64_t) lower_middle) * 0.5;
+    } else {
+        median = (uint64_t) upper_middle;
+    }
+    return round(median);
+}
+
+/**
+ * @brief   Comparison function for ::index_manager_airport_delay_t.
+ * @details Airports with the largest median delay first, ties broken by airport code.
+ */
+gint __index_manager_airport_delay_compare_func(gconstpointer a, gconstpointer b) {
+    const index_manager_airport_delay_t *const item_a = a;
+    const index_manager_airport_delay_t *const item_b = b;
+
+    if (item_a->median_delay != item_b->median_delay)
+        return item_a->median_delay < item_b->median_delay ? 1 : -1;
+
+    /* Airport code indices are in alphabetical order */
+    const size_t index_a = airport_code_to_index(item_a->airport);
+    const size_t index_b = airport_code_to_index(item_b->airport);
+    return (index_a > index_b) - (index_a < index_b);
+}
+
+/**
+ * @brief Builds ::index_manager::origin_delay_medians from the delays of every origin airport.
+ *
+ * @param manager Index manager to build the index in. Its mutex must be locked.
+ * @param delays  Delays collected by ::__index_manager_build_origin_delay_medians_foreach. Freed by
+ *                this method.
+ */
+void __index_manager_finish_origin_delay_medians(index_manager_t *manager, GArray **delays) {
+    GArray *const medians = g_array_new(FALSE, FALSE, sizeof(index_manager_airport_delay_t));
+
+    for (size_t i = 0; i < AIRPORT_CODE_INDEX_COUNT; ++i) {
+        if (!delays[i])
+            continue;
+
+        const index_manager_airport_delay_t median = {
+            .airport      = airport_code_from_index(i),
+            .median_delay = __index_manager_delay_median((int64_t *) delays[i]->data,
+                                                         delays[i]->len)};
+        g_array_append_val(medians, median);
+        g_array_unref(delays[i]);
+    }
+    g_free(delays);
+
+    g_array_sort(medians, __index_manager_airport_delay_compare_func);
+    manager->origin_delay_medians = medians;
+}
+
+/**
+ * @brief Builds ::index_manager::origin_delay_medians, if it doesn't exist yet.
+ *
+ * @param manager Index manager to build the index in. Its mutex must be locked.
+ * @param flights Flights to build the index from.
+ */
+void __index_manager_build_origin_delay_medians(index_manager_t        *manager,
+                                                const flight_manager_t *flights) {
+    if (manager->origin_delay_medians)
+        return;
+
+    GArray **const delays = __index_manager_begin_origin_delay_medians();
+    flight_manager_iter_columns(flights,
+                                __index_manager_build_origin_delay_medians_foreach,
+                                delays);
+    __index_manager_finish_origin_delay_medians(manager, delays);
+}
+
+/**
+ * @struct index_manager_collation_key_t
+ * @brief  Collation keys of a user, used to calculate ::index_manager_user_name_t::collation_rank.
+ *
+ * @var index_manager_collation_key_t::name
+ *     @brief Result of `strxfrm` on the user's name.
+ * @var index_manager_collation_key_t::id
+ *     @brief Result of `strxfrm` on the user's identifier.
+ * @var index_manager_collation_key_t::entry
+ *     @brief Index of the user's ::index_manager_user_name_t in the index being built.
+ */
+typedef struct {
+    char  *name;
+    char  *id;
+    size_t entry;
+} index_manager_collation_key_t;
+
+/** @brief Maximum number of collation levels supported by ::index_manager_ascii_collation_t. */
+#define INDEX_MANAGER_ASCII_MAX_LEVELS 4
+
+/** @brief Maximum length of the weight of a character in a level of collation. */
+#define INDEX_MANAGER_ASCII_MAX_WEIGHT 7
+
+/** @brief First character covered by ::index_manager_ascii_collation_t (space). */
+#define INDEX_MANAGER_ASCII_FIRST 0x20
+
+/** @brief Character after the last one covered by ::index_manager_ascii_collation_t (DEL). */
+#define INDEX_MANAGER_ASCII_END 0x7f
+
+/**
+ * @struct index_manager_ascii_collation_t
+ * @brief  Collation weights of every printable ASCII character, for transforming pure-ASCII
+ *         strings without `strxfrm`.
+ * @details `strxfrm` outputs the weights of every character in the first level, followed by the
+ *          weights of every character in the second level, and so on, with levels separated by a
+ *          `'\x01'` byte. As long as a locale doesn't treat sequences of printable ASCII characters
+ *          specially, the key of an ASCII string can then be assembled from the weights of its
+ *          characters. That's checked (::__index_manager_ascii_collation_create) against `strxfrm`
+ *          itself, as no locale is assumed.
+ *
+ * @var index_manager_ascii_collation_t::usable
+ *     @brief Whether keys assembled from these weights are the same as `strxfrm`'s.
+ * @var index_manager_ascii_collation_t::nlevels
+ *     @brief Number of levels in the output of `strxfrm`.
+ * @var index_manager_ascii_collation_t::weights
+ *     @brief `NUL`-terminated weights of each character (starting at ::INDEX_MANAGER_ASCII_FIRST)
+ *            in each level.
+ * @var index_manager_ascii_collation_t::lengths
+ *     @brief Total length of the weights of each character (in all levels).
+ */
+typedef struct {
+    int    usable;
+    size_t nlevels;
+    char   weights[INDEX_MANAGER_ASCII_END - INDEX_MANAGER_ASCII_FIRST]
+                [INDEX_MANAGER_ASCII_MAX_LEVELS][INDEX_MANAGER_ASCII_MAX_WEIGHT + 1];
+    size_t lengths[INDEX_MANAGER_ASCII_END - INDEX_MANAGER_ASCII_FIRST];
+} index_manager_ascii_collation_t;
+
+/**
+ * @brief   Callback for every active user, that adds it to the index of user names.
+ * @details Auxiliary method for ::__index_manager_build_user_names.
+ *
+ * @param user_data `GArray` of ::index_manager_user_name_t.
+ * @param user      User to be added to the index.
+ *
+ * @retval 0 Always successful.
+ */
+int __index_manager_build_user_names_foreach(void *user_data, const user_t *user) {
+    const index_manager_user_name_t entry = {.user = user, .collation_rank = 0};
+    g_array_append_val(user_data, entry);
+    return 0;
+}
+
+/**
+ * @brief   Transforms a string into a key that can be compared with `strcmp` like `strcoll` would.
+ * @details Auxiliary method for ::__index_manager_build_user_names.
+ *
+ * @param str    String to be transformed.
+ * @param locale Locale whose collation rules are to be used.
+ *
+ * @return A `malloc`-allocated key, or `NULL` on allocation failure.
+ */
+char *__index_manager_collation_key(const char *str, locale_t locale) {
+    const size_t length = strxfrm_l(NULL, str, 0, locale) + 1;
+    char *const  key    = malloc(length);
+    if (key)
+        strxfrm_l(key, str, length, locale);
+    return key;
+}
+
+/**
+ * @brief   Transforms a pure-ASCII string into a key, like ::__index_manager_collation_key would.
+ * @details Auxiliary method for ::__index_manager_build_user_names.
+ *
+ * @param collation Weights of ASCII characters. Must be ::index_manager_ascii_collation_t::usable.
+ * @param str       String to be transformed.
+ * @param key       Where to write the key to. Set to `NULL` on allocation failure.
+ *
+ * @retval 0 Success (or allocation failure, see @p key).
+ * @retval 1 @p str isn't made only of printable ASCII characters, and needs `strxfrm`.
+ */
+int __index_manager_ascii_collation_key(const index_manager_ascii_collation_t *collation,
+                                        const char                            *str,
+                                        char                                 **key) {
+    size_t length = collation->nlevels;
+    for (const char *c = str; *c; ++c) {
+        if (*c < INDEX_MANAGER_ASCII_FIRST || *c >= INDEX_MANAGER_ASCII_END)
+            return 1;
+        length += collation->lengths[*c - INDEX_MANAGER_ASCII_FIRST];
+    }
+
+    char *const result = malloc(length);
+    *key               = result;
+    if (!result)
+        return 0;
+
+    char *out = result;
+    for (size_t level = 0; level < collation->nlevels; ++level) {
+        if (level)
+            *(out++) = '\x01';
+
+        for (const char *c = str; *c; ++c)
+            for (const char *w = collation->weights[*c - INDEX_MANAGER_ASCII_FIRST][level]; *w;)
+                *(out++) = *(w++);
+    }
+    *out = '\0';
+    return 0;
+}
+
+/**
+ * @brief   Checks if the weights of ASCII characters produce the same key as `strxfrm`.
+ * @details Auxiliary method for ::__index_manager_ascii_collation_create.
+ *
+ * @param collation Weights of ASCII characters, assumed to be usable.
+ * @param str       String to be checked.
+ * @param locale    Locale the weights were taken from.
+ *
+ * @return Whether both keys for @p str are equal (`0` on allocation failure).
+ */
+int __index_manager_ascii_collation_check(const index_manager_ascii_collation_t *collation,
+                                          const char                            *str,
+                                          locale_t                               locale) {
+    char *ascii_key = NULL;
+    __index_manager_ascii_collation_key(collation, str, &ascii_key);
+    char *const strxfrm_key = __index_manager_collation_key(str, locale);
+
+    const int equal = ascii_key && strxfrm_key && strcmp(ascii_key, strxfrm_key) == 0;
+    free(ascii_key);
+    free(strxfrm_key);
+    return equal;
+}
+
+/**
+ * @brief   Gets the collation weights of every printable ASCII character in a locale.
+ * @details Auxiliary method for ::__index_manager_build_user_names. The fast path is only enabled
+ *          if assembling keys from weights agrees with `strxfrm` for every string of one and two
+ *          characters, so that locales where characters interact (contractions, ignored characters
+ *          whose position matters, ...) keep using `strxfrm`.
+ *
+ * @param collation Where to write the weights to.
+ * @param locale    Locale whose collation rules are to be used.
+ */
+void __index_manager_ascii_collation_create(index_manager_ascii_collation_t *collation,
+                                            locale_t                         locale) {
+    collation->usable  = 0;
+    collation->nlevels = 0;
+
+    for (int c = INDEX_MANAGER_ASCII_FIRST; c < INDEX_MANAGER_ASCII_END; ++c) {
+        const char str[2] = {c, '\0'};
+        char       key[64];
+        if (strxfrm_l(key, str, sizeof(key), locale) >= sizeof(key))
+            return;
+
+        const size_t i       = c - INDEX_MANAGER_ASCII_FIRST;
+        size_t       nlevels = 0;
+        collation->lengths[i] = 0;
+        for (const char *level = key;; ++nlevels) {
+            const char *const separator = strchr(level, '\x01');
+            const size_t      length = separator ? (size_t) (separator - level) : strlen(level);
+            if (nlevels >= INDEX_MANAGER_ASCII_MAX_LEVELS ||
+                length > INDEX_MANAGER_ASCII_MAX_WEIGHT)
+                return;
+
+            memcpy(collation->weights[i][nlevels], level, length);
+            collation->weights[i][nlevels][length] = '\0';
+            collation->lengths[i] += length;
+
+            if (!separator) {
+                ++nlevels;
+                break;
+            }
+            level = separator + 1;
+        }
+
+        if (collation->nlevels && nlevels != collation->nlevels)
+            return;
+        collation->nlevels = nlevels;
+    }
+
+    collation->usable = 1;
+    for (int a = INDEX_MANAGER_ASCII_FIRST; a < INDEX_MANAGER_ASCII_END; ++a) {
+        for (int b = INDEX_MANAGER_ASCII_FIRST; b < INDEX_MANAGER_ASCII_END; ++b) {
+            const char str[3] = {a, b, '\0'};
+            if (!__index_manager_ascii_collation_check(collation, str + 1, locale) ||
+                !__index_manager_ascii_collation_check(collation, str, locale)) {
+                collation->usable = 0;
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * @brief   Transforms a string into a key that can be compared with `strcmp` like `strcoll` would.
+ * @details Auxiliary method for ::__index_manager_build_user_names. Pure-ASCII strings are
+ *          transformed with @p collation, and all others with `strxfrm`. Both keys are the same, so
+ *          they can be compared with each other.
+ *
+ * @param collation   Weights of ASCII characters.
+ * @param str         String to be transformed.
+ * @param maybe_ascii `0` if @p str is known to have multibyte characters (see
+ *                    ::user_get_name_is_ascii), in which case it's not scanned for an ASCII key.
+ * @param locale      Locale whose collation rules are to be used.
+ *
+ * @return A `malloc`-allocated key, or `NULL` on allocation failure.
+ */
+char *__index_manager_user_collation_key(const index_manager_ascii_collation_t *collation,
+                                         const char                            *str,
+                                         int                                    maybe_ascii,
+                                         locale_t                               locale) {
+    char *key;
+    if (maybe_ascii && collation->usable &&
+        !__index_manager_ascii_collation_key(collation, str, &key))
+        return key;
+    return __index_manager_collation_key(str, locale);
+}
+
+/**
+ * @brief   Comparison function for ::index_manager_collation_key_t.
+ * @details Auxiliary method for ::__index_manager_build_user_names.
+ */
+int __index_manager_collation_key_compare_func(const void *a, const void *b) {
+    const index_manager_collation_key_t *const key_a = a;
+    const index_manager_collation_key_t *const key_b = b;
+
+    const int crit1 = strcmp(key_a->name, key_b->name);
+    if (crit1)
+        return crit1;
+
+    return strcmp(key_a->id, key_b->id);
+}
+
+/**
+ * @brief   Comparison function for ::index_manager_user_name_t.
+ * @details Auxiliary method for ::__index_manager_build_user_names.
+ */
+gint __index_manager_user_name_compare_func(gconstpointer a, gconstpointer b) {
+    const index_manager_user_name_t *const entry_a = a;
+    const index_manager_user_name_t *const entry_b = b;
+
+    const int crit1 =
+        strcmp(user_get_const_name(entry_a->user), user_get_const_name(entry_b->user));
+    if (crit1)
+        return crit1;
+
+    return (entry_a->collation_rank > entry_b->collation_rank) -
+           (entry_a->collation_rank < entry_b->collation_rank);
+}
+
+/**
+ * @struct index_manager_rank_data_t
+ * @brief  Work shared by all threads ranking user names.
+ *
+ * @var index_manager_rank_data_t::entries
+ *     @brief `GArray` of ::index_manager_user_name_t being ranked.
+ * @var index_manager_rank_data_t::keys
+ *     @brief Collation keys of every entry in ::index_manager_rank_data_t::entries.
+ * @var index_manager_rank_data_t::collation
+ *     @brief Weights of ASCII characters.
+ * @var index_manager_rank_data_t::locale
+ *     @brief Locale whose collation rules are to be used.
+ * @var index_manager_rank_data_t::failed
+ *     @brief Whether any key couldn't be allocated. Set atomically.
+ */
+typedef struct {
+    GArray                                *entries;
+    index_manager_collation_key_t         *keys;
+    const index_manager_ascii_collation_t *collation;
+    locale_t                               locale;
+    int                                    failed;
+} index_manager_rank_data_t;
+
+/**
+ * @brief   Calculates the collation keys of a range of users.
+ * @details Auxiliary method for ::__index_manager_rank_user_names, run in parallel by
+ *          ::thread_pool_parallel_for. Keys that couldn't be allocated are left `NULL`.
+ *
+ * @param rank_data_data An ::index_manager_rank_data_t.
+ * @param start          Index of the first user.
+ * @param end            Index after the last user.
+ */
+void __index_manager_rank_keys_range(void *rank_data_data, size_t start, size_t end) {
+    index_manager_rank_data_t *const rank_data = rank_data_data;
+
+    for (size_t i = start; i < end; ++i) {
+        const user_t *const user =
+            g_array_index(rank_data->entries, index_manager_user_name_t, i).user;
+        index_manager_collation_key_t *const key = &rank_data->keys[i];
+
+        key->name  = __index_manager_user_collation_key(rank_data->collation,
+                                                       user_get_const_name(user),
+                                                       user_get_name_is_ascii(user),
+                                                       rank_data->locale);
+        key->id    = __index_manager_user_collation_key(rank_data->collation,
+                                                     user_get_const_id(user),
+                                                     1,
+                                                     rank_data->locale);
+        key->entry = i;
+        if (!key->name || !key->id)
+            __atomic_store_n(&rank_data->failed, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief   Calculates ::index_manager_user_name_t::collation_rank for every user in an index.
+ * @details Auxiliary method for ::__index_manager_build_user_names. Only locale objects are used
+ *          (no `setlocale`), so that keys can be calculated and sorted in parallel.
+ *
+ * @param entries `GArray` of ::index_manager_user_name_t.
+ * @param locale  Locale whose collation rules are to be used.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __index_manager_rank_user_names(GArray *entries, locale_t locale) {
+    index_manager_ascii_collation_t collation;
+    __index_manager_ascii_collation_create(&collation, locale);
+
+    index_manager_rank_data_t rank_data = {
+        .entries   = entries,
+        .keys      = calloc(entries->len, sizeof(index_manager_collation_key_t)),
+        .collation = &collation,
+        .locale    = locale,
+        .failed    = 0};
+    index_manager_collation_key_t *const keys = rank_data.keys;
+
+    int retval = 1;
+    if (entries->len && !rank_data.keys)
+        goto DEFER_1;
+
+    /* Only use the shared pool if there are enough users for threads to be worth it */
+    thread_pool_t *const pool = entries->len >= 2 * INDEX_MANAGER_MIN_ITEMS_PER_SORT_THREAD
+                                    ? thread_pool_get_shared()
+                                    : NULL;
+    thread_pool_parallel_for(pool, entries->len, 0, __index_manager_rank_keys_range, &rank_data);
+    if (rank_data.failed)
+        goto DEFER_2;
+
+    if (parallel_sort(keys,
+                      entries->len,
+                      sizeof(index_manager_collation_key_t),
+                      __index_manager_collation_key_compare_func,
+                      pool))
+        goto DEFER_2;
+
+    for (size_t rank = 0; rank < entries->len; ++rank)
+        g_array_index(entries, index_manager_user_name_t, rank_data.keys[rank].entry)
+            .collation_rank = rank;
+    retval = 0;
+
+DEFER_2:
+    for (size_t i = 0; i < entries->len; ++i) {
+        free(keys[i].name);
+        free(keys[i].id);
+    }
+DEFER_1:
+    free(rank_data.keys);
+    return retval;
+}
+
+/**
+ * @brief   Gets the name of a user in an index of user names.
+ * @details Auxiliary method for ::__index_manager_build_user_names (see
+ *          ::prefix_trie_key_callback_t).
+ *
+ * @param user_data `GArray` of ::index_manager_user_name_t.
+ * @param i         Index of the entry in @p user_data.
+ *
+ * @return The name of the user in entry @p i.
+ */
+const char *__index_manager_user_name_key(void *user_data, size_t i) {
+    const GArray *const entries = user_data;
+    return user_get_const_name(g_array_index(entries, index_manager_user_name_t, i).user);
+}
+
+/**
+ * @brief Builds ::index_manager::user_names (and its trie), if it doesn't exist yet.
+ *
+ * @param manager Index manager to build the index in. Its mutex must be locked.
+ * @param users   Users to build the index from.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __index_manager_build_user_names(index_manager_t *manager, const user_manager_t *users) {
+    if (manager->user_names)
+        return 0;
+
+    /* Inactive users are skipped with the bitmap of active users, without being accessed */
+    GArray *const entries = g_array_sized_new(FALSE,
+                                              FALSE,
+                                              sizeof(index_manager_user_name_t),
+                                              user_manager_get_active_count(users));
+    user_manager_iter_active(users, __index_manager_build_user_names_foreach, entries);
+
+    /* Use the global locale's collation if en_US.UTF-8 isn't available */
+    locale_t locale = duplocale(LC_GLOBAL_LOCALE);
+    if (!locale) {
+        g_array_unref(entries);
+        return 1;
+    }
+
+    const locale_t collate_locale = newlocale(LC_COLLATE_MASK, "en_US.UTF-8", locale);
+    if (collate_locale) /* locale is reused by newlocale on success */
+        locale = collate_locale;
+
+    const int retval = __index_manager_rank_user_names(entries, locale);
+    freelocale(locale);
+    if (retval) {
+        g_array_unref(entries);
+        return 1;
+    }
+
+    g_array_sort(entries, __index_manager_user_name_compare_func);
+    manager->user_name_trie =
+        prefix_trie_create(entries->len, __index_manager_user_name_key, entries);
+    if (!manager->user_name_trie) {
+        g_array_unref(entries);
+        return 1;
+    }
+
+    manager->user_names = entries;
+    return 0;
+}
+
+const GConstPtrArray *
+    index_manager_get_hotel_reservations(index_manager_t             *manager,
+                                         const reservation_manager_t *reservations,
+                                         hotel_id_t                   hotel_id) {
+    pthread_mutex_lock(&manager->mutex);
+    __index_manager_build_hotel_reservations(manager, reservations);
+    const GConstPtrArray *const ret =
+        g_hash_table_lookup(manager->hotel_reservations, GUINT_TO_POINTER(hotel_id));
+    pthread_mutex_unlock(&manager->mutex);
+
+    return ret;
+}
+
+const index_manager_hotel_nights_t *
+    index_manager_get_hotel_nights(index_manager_t             *manager,
+                                   const reservation_manager_t *reservations,
+                                   hotel_id_t                   hotel_id) {
+    pthread_mutex_lock(&manager->mutex);
+    __index_manager_build_hotel_nights(manager, reservations);
+    const index_manager_hotel_nights_t *const ret =
+        g_hash_table_lookup(manager->hotel_nights, GUINT_TO_POINTER(hotel_id));
+    pthread_mutex_unlock(&manager->mutex);
+
+    return ret;
+}
+
+void index_manager_build_hotel_indexes(index_manager_t             *manager,
+                                       const reservation_manager_t *reservations) {
+    pthread_mutex_lock(&manager->mutex);
+    __index_manager_build_hotel_nights(manager, reservations);
+    pthread_mutex_unlock(&manager->mutex);
+}
+
+int index_manager_has_hotel_reservations(index_manager_t *manager) {
+    pthread_mutex_lock(&manager->mutex);
+    const int ret = manager->hotel_reservations != NULL;
+    pthread_mutex_unlock(&manager->mutex);
+    return ret;
+}
+
+void index_manager_build_flight_indexes(index_manager_t        *manager,
+                                        const flight_manager_t *flights) {
+    pthread_mutex_lock(&manager->mutex);
+
+    /* Feed every missing index from a single pass over all flights */
+    GConstPtrArray **const origin_flights =
+        manager->origin_flights ? NULL : __index_manager_begin_origin_flights();
+    GHashTable *const year_airport_passengers =
+        manager->year_airport_passengers ? NULL : __index_manager_begin_year_airport_passengers();
+    GArray **const origin_delays =
+        manager->origin_delay_medians ? NULL : __index_manager_begin_origin_delay_medians();
+
+    index_manager_flight_visitors_t visitors = {.n = 0};
+    if (origin_flights)
+        visitors.visitors[visitors.n++] = (index_manager_flight_visitor_t) {
+            .callback  = __index_manager_build_origin_flights_foreach,
+            .user_data = origin_flights};
+    if (year_airport_passengers)
+        visitors.visitors[visitors.n++] = (index_manager_flight_visitor_t) {
+            .callback  = __index_manager_build_year_airport_passengers_foreach,
+            .user_data = year_airport_passengers};
+    if (origin_delays)
+        visitors.visitors[visitors.n++] = (index_manager_flight_visitor_t) {
+            .callback  = __index_manager_build_origin_delay_medians_foreach,
+            .user_data = origin_delays};
+
+    if (visitors.n)
+        flight_manager_iter_columns(flights, __index_manager_visit_flights, &visitors);
+
+    if (origin_flights)
+        __index_manager_finish_origin_flights(manager, origin_flights);
+    if (year_airport_passengers)
+        __index_manager_finish_year_airport_passengers(manager, year_airport_passengers);
+    if (origin_delays)
+        __index_manager_finish_origin_delay_medians(manager, origin_delays);
+
+    pthread_mutex_unlock(&manager->mutex);
+}
+
+const GConstPtrArray *index_manager_get_origin_flights(index_manager_t        *manager,
+                                                       const flight_manager_t *flights,
+                                                       airport_code_t          origin) {
+    pthread_mutex_lock(&manager->mutex);
+    __index_manager_build_origin_flights(manager, flights);
+    const GConstPtrArray *const ret =
+        g_hash_table_lookup(manager->origin_flights, GUINT_TO_POINTER(origin));
+    pthread_mutex_unlock(&manager->mutex);
+
+    performance_access_count_probe(PERFORMANCE_ACCESS_MANAGER_INDEXES);
+    if (ret)
+        performance_access_count_scan(PERFORMANCE_ACCESS_MANAGER_INDEXES,
+                                      g_const_ptr_array_get_length(ret));
+
+    return ret;
+}
+
+const GArray *index_manager_get_origin_departures(index_manager_t        *manager,
+                                                  const flight_manager_t *flights,
+                                                  airport_code_t          origin) {
+    pthread_mutex_lock(&manager->mutex);
+    __index_manager_build_origin_flights(manager, flights);
+    const GArray *const ret =
+        g_hash_table_lookup(manager->origin_departures, GUINT_TO_POINTER(origin));
+    pthread_mutex_unlock(&manager->mutex);
+
+    performance_access_count_probe(PERFORMANCE_ACCESS_MANAGER_INDEXES);
+    if (ret)
+        performance_access_count_scan(PERFORMANCE_ACCESS_MANAGER_INDEXES, ret->len);
+
+    return ret;
+}
+
+int index_manager_iter_origin_flights(index_manager_t                             *manager,
+                                      const flight_manager_t                      *flights,
+                                      index_manager_iter_origin_flights_callback_t callback,
+                                      void                                        *user_data) {
+    pthread_mutex_lock(&manager->mutex);
+    __index_manager_build_origin_flights(manager, flights);
+    GHashTable *const origin_flights = manager->origin_flights;
+    pthread_mutex_unlock(&manager->mutex);
+
+    /* The index isn't modified after being built, so it can be read without the mutex */
+    performance_access_count_scan(PERFORMANCE_ACCESS_MANAGER_INDEXES,
+                                  g_hash_table_size(origin_flights));
+    GHashTableIter iter;
+    gpointer       key, value;
+    g_hash_table_iter_init(&iter, origin_flights);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        const int retval = callback(user_data, GPOINTER_TO_UINT(key), value);
+        if (retval)
+            return retval;
+    }
+
+    return 0;
+}
+
+const GArray *index_manager_get_year_airport_passengers(index_manager_t        *manager,
+                                                        const flight_manager_t *flights,
+                                                        uint16_t                year) {
+    pthread_mutex_lock(&manager->mutex);
+    __index_manager_build_year_airport_passengers(manager, flights);
+    const GArray *const ret =
+        g_hash_table_lookup(manager->year_airport_passengers, GUINT_TO_POINTER(year));
+    pthread_mutex_unlock(&manager->mutex);
+
+    performance_access_count_probe(PERFORMANCE_ACCESS_MANAGER_INDEXES);
+    if (ret)
+        performance_access_count_scan(PERFORMANCE_ACCESS_MANAGER_INDEXES, ret->len);
+
+    return ret;
+}
+
+const GArray *index_manager_get_origin_delay_medians(index_manager_t        *manager,
+                                                   const flight_manager_t *flights) {
+    pthread_mutex_lock(&manager->mutex);
+    __index_manager_build_origin_delay_medians(manager, flights);
+    const GArray *const ret = manager->origin_delay_medians;
+    pthread_mutex_unlock(&manager->mutex);
+
+    performance_access_count_probe(PERFORMANCE_ACCESS_MANAGER_INDEXES);
+
+    return ret;
+}
+
+int index_manager_get_built_origin_delay_medians(index_manager_t *manager,
+                                                 const GArray   **medians) {
+    pthread_mutex_lock(&manager->mutex);
+    *medians = manager->origin_delay_medians;
+    pthread_mutex_unlock(&manager->mutex);
+    return *medians == NULL;
+}
+
+void index_manager_restore_origin_delay_medians(index_manager_t *manager, GArray *medians) {
+    pthread_mutex_lock(&manager->mutex);
+    if (manager->origin_delay_medians)
+        g_array_unref(manager->origin_delay_medians);
+    manager->origin_delay_medians = medians;
+    pthread_mutex_unlock(&manager->mutex);
+}
+
+int index_manager_get_users_by_name_prefix(index_manager_t                  *manager,
+                                           const user_manager_t             *users,
+                                           const char                       *prefix,
+                                           const index_manager_user_name_t **matches,
+                                           size_t                           *n) {
+    pthread_mutex_lock(&manager->mutex);
+    const int                  retval  = __index_manager_build_user_names(manager, users);
+    GArray *const              entries = manager->user_names;
+    const prefix_trie_t *const trie    = manager->user_name_trie;
+    pthread_mutex_unlock(&manager->mutex);
+
+    if (retval)
+        return 1;
+
+    /* Names starting with prefix are contiguous, as the index is sorted with strcmp */
+    size_t first;
+    prefix_trie_find(trie, prefix, __index_manager_user_name_key, entries, &first, n);
+    *matches = &g_array_index(entries, index_manager_user_name_t, first);
+
+    performance_access_count_probe(PERFORMANCE_ACCESS_MANAGER_INDEXES);
+    performance_access_count_scan(PERFORMANCE_ACCESS_MANAGER_INDEXES, *n);
+    return 0;
+}
+
+int index_manager_build_user_indexes(index_manager_t *manager, const user_manager_t *users) {
+    pthread_mutex_lock(&manager->mutex);
+    const int retval = __index_manager_build_user_names(manager, users);
+    pthread_mutex_unlock(&manager->mutex);
+    return retval;
+}
+
+int index_manager_get_user_names(index_manager_t      *manager,
+                                 const GArray        **entries,
+                                 const prefix_trie_t **trie) {
+    pthread_mutex_lock(&manager->mutex);
+    *entries = manager->user_names;
+    *trie    = manager->user_name_trie;
+    pthread_mutex_unlock(&manager->mutex);
+    return *entries == NULL;
+}
+
+int index_manager_restore_user_names(index_manager_t *manager,
+                                     GArray          *entries,
+                                     const void      *trie_data,
+                                     size_t           length) {
+    prefix_trie_t *const trie = prefix_trie_create_from_data(trie_data,
+                                                             length,
+                                                             entries->len,
+                                                             __index_manager_user_name_key,
+                                                             entries);
+    if (!trie) {
+        g_array_unref(entries);
+        return 1;
+    }
+
+    pthread_mutex_lock(&manager->mutex);
+    if (manager->user_names)
+        g_array_unref(manager->user_names);
+    prefix_trie_free(manager->user_name_trie);
+    manager->user_names     = entries;
+    manager->user_name_trie = trie;
+    pthread_mutex_unlock(&manager->mutex);
+    return 0;
+}
+
+/** @brief Type of the values of a hash table in an ::index_manager_t. */
+typedef enum {
+    INDEX_MANAGER_VALUE_PTR_ARRAY, /**< @brief ::GConstPtrArray. */
+    INDEX_MANAGER_VALUE_NIGHTS,    /**< @brief ::index_manager_hotel_nights_t. */
+    INDEX_MANAGER_VALUE_ARRAY      /**< @brief `GArray`. */
+} index_manager_value_type_t;
+
+/**
+ * @brief   Adds the memory used by a hash table in an ::index_manager_t to a memory report.
+ * @details Auxiliary method for ::index_manager_add_to_memory_report.
+ *
+ * @param report Report to add an entry to.
+ * @param name   Name of the entry.
+ * @param table  Hash table to be accounted for (with its values). Can be `NULL` (not added).
+ * @param type   Type of the values in @p table.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __index_manager_add_table_to_memory_report(memory_report_t           *report,
+                                               const char                *name,
+                                               GHashTable                *table,
+                                               index_manager_value_type_t type) {
+    if (!table)
+        return 0;
+
+    const size_t   table_bytes = memory_report_estimate_hash_table(g_hash_table_size(table));
+    memory_usage_t usage       = {.blocks         = 1,
+                                  .reserved_bytes = table_bytes,
+                                  .used_bytes     = table_bytes,
+                                  .wasted_bytes   = 0};
+
+    GHashTableIter iter;
+    gpointer       value;
+    g_hash_table_iter_init(&iter, table);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        size_t bytes;
+        switch (type) {
+            case INDEX_MANAGER_VALUE_PTR_ARRAY:
+                bytes = g_const_ptr_array_get_length(value) * sizeof(gconstpointer);
+                break;
+            case INDEX_MANAGER_VALUE_NIGHTS: {
+                const index_manager_hotel_nights_t *const nights = value;
+                bytes = sizeof(index_manager_hotel_nights_t) + 3 * nights->length * sizeof(int32_t);
+                if (nights->revenue_prefix)
+                    bytes += (nights->days + 1) * sizeof(int64_t);
+            } break;
+            default:
+                bytes = ((GArray *) value)->len * g_array_get_element_size(value);
+                break;
+        }
+
+        usage.blocks++;
+        usage.reserved_bytes += bytes;
+        usage.used_bytes += bytes;
+    }
+
+    return memory_report_add(report, name, &usage);
+}
+
+int index_manager_add_to_memory_report(index_manager_t *manager, memory_report_t *report) {
+    pthread_mutex_lock(&manager->mutex);
+
+    int retval =
+        __index_manager_add_table_to_memory_report(report,
+                                                   "indexes.hotel_reservations",
+                                                   manager->hotel_reservations,
+                                                   INDEX_MANAGER_VALUE_PTR_ARRAY) ||
+        __index_manager_add_table_to_memory_report(report,
+                                                   "indexes.hotel_nights",
+                                                   manager->hotel_nights,
+                                                   INDEX_MANAGER_VALUE_NIGHTS) ||
+        __index_manager_add_table_to_memory_report(report,
+                                                   "indexes.origin_flights",
+                                                   manager->origin_flights,
+                                                   INDEX_MANAGER_VALUE_PTR_ARRAY) ||
+        __index_manager_add_table_to_memory_report(report,
+                                                   "indexes.origin_departures",
+                                                   manager->origin_departures,
+                                                   INDEX_MANAGER_VALUE_ARRAY) ||
+        __index_manager_add_table_to_memory_report(report,
+                                                   "indexes.year_airport_passengers",
+                                                   manager->year_airport_passengers,
+                                                   INDEX_MANAGER_VALUE_ARRAY);
+
+    if (!retval && manager->origin_delay_medians) {
+        memory_usage_t usage = {0};
+        memory_usage_add_arrays(&usage, 1, &manager->origin_delay_medians);
+        retval = memory_report_add(report, "indexes.origin_delay_medians", &usage);
+    }
+
+    if (!retval && manager->user_names) {
+        memory_usage_t usage = {0};
+        memory_usage_add_arrays(&usage, 1, &manager->user_names);
+        retval = memory_report_add(report, "indexes.user_names", &usage);
+    }
+
+    if (!retval && manager->user_name_trie) {
+        const size_t trie_bytes = prefix_trie_get_size(manager->user_name_trie);
+        retval =
+            memory_report_add_allocation(report, "indexes.user_name_trie", trie_bytes, trie_bytes);
+    }
+
+    pthread_mutex_unlock(&manager->mutex);
+    return retval;
+}
+
+void index_manager_free(index_manager_t *manager) {
+    index_manager_invalidate(manager);
+    pthread_mutex_destroy(&manager->mutex);
+    free(manager);
+}
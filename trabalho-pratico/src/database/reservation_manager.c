@@ -23,10 +23,19 @@
  */
 
 #include <glib.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "database/reservation_manager.h"
+#include "testing/performance_access.h"
+#include "testing/performance_probes.h"
+#include "testing/performance_trace.h"
+#include "utils/id_table.h"
+#include "utils/int_utils.h"
+#include "utils/numa_topology.h"
+#include "utils/radix_sort.h"
 
 /**
  * @struct reservation_manager
@@ -36,35 +45,89 @@
  *     @brief Allocator for reservations in the manager.
  * @var reservation_manager::hotel_name_pool
  *     @brief Allocator for hotel names in reservations.
- * @var reservation_manager::user_id_pool
- *     @brief Allocators for user identifiers in reservations.
- * @var reservation_manager::id_reservations_rel
- *     @brief Hash table for ::reservation_id_t -> ::reservation_t mapping.
+ * @var reservation_manager::id_rows_rel
+ *     @brief Hash table for ::reservation_id_t -> row (index in the columns) mapping.
+ * @var reservation_manager::reservations_column
+ *     @brief `GArray` of pointers to the ::reservation_t in each row.
+ * @var reservation_manager::hotel_ids_column
+ *     @brief `GArray` of the ::hotel_id_t of the reservation in each row.
+ * @var reservation_manager::begin_dates_column
+ *     @brief `GArray` of the begin date (::date_t) of the reservation in each row.
+ * @var reservation_manager::end_dates_column
+ *     @brief `GArray` of the end date (::date_t) of the reservation in each row.
+ * @var reservation_manager::prices_per_night_column
+ *     @brief `GArray` of the price per night (`uint16_t`) of the reservation in each row.
+ * @var reservation_manager::ratings_column
+ *     @brief `GArray` of the rating (`uint8_t`) of the reservation in each row.
+ * @var reservation_manager::city_taxes_column
+ *     @brief `GArray` of the city tax (`uint8_t`) of the reservation in each row.
+ * @var reservation_manager::zones
+ *     @brief   `GArray` of the ::reservation_manager_zone_t of every span of
+ *              ::RESERVATION_MANAGER_COLUMNS_SPAN_LENGTH rows.
+ *     @details Widened as rows are added, and rebuilt from scratch by
+ *              ::reservation_manager_compact.
+ * @var reservation_manager::partitions
+ *     @brief `GArray` of ::reservation_manager_partition_t. Built by ::reservation_manager_compact,
+ *            and emptied when rows are added.
+ * @var reservation_manager::hotel_ratings
+ *     @brief `GArray` of ::reservation_manager_hotel_rating_t, indexed by ::hotel_id_t. Only grows
+ *            up to the largest hotel identifier seen.
+ * @var reservation_manager::id_filter
+ *     @brief Bloom filter of the identifiers of all reservations (see
+ *            ::reservation_manager_build_id_filter), or `NULL` if it wasn't built.
  */
 struct reservation_manager {
     pool_t                      *reservations;
     string_pool_no_duplicates_t *hotel_name_pool;
-    string_pool_t               *user_id_pool;
-    GHashTable                  *id_reservations_rel;
+    id_table_t                  *id_rows_rel;
+
+    GArray *reservations_column;
+    GArray *hotel_ids_column;
+    GArray *begin_dates_column;
+    GArray *end_dates_column;
+    GArray *prices_per_night_column;
+    GArray *ratings_column;
+    GArray *city_taxes_column;
+
+    GArray *zones;
+    GArray *partitions;
+    GArray *hotel_ratings;
+
+    bloom_filter_t *id_filter;
 };
 
+/**
+ * @struct reservation_manager_hotel_rating_t
+ * @brief  Aggregated ratings of all reservations of a hotel.
+ *
+ * @var reservation_manager_hotel_rating_t::sum
+ *     @brief Sum of the ratings of all reservations of the hotel.
+ * @var reservation_manager_hotel_rating_t::count
+ *     @brief Number of reservations of the hotel.
+ */
+typedef struct {
+    uint32_t sum;
+    uint32_t count;
+} reservation_manager_hotel_rating_t;
+
 /** @brief Number of reservations in each block of ::reservation_manager::reservations. */
 #define RESERVATION_MANAGER_RESERVATIONS_POOL_BLOCK_CAPACITY 50000
 
-/**
- * @brief Number of characters in each block of ::reservation_manager::hotel_name_pool and in
- *        ::reservation_manager::user_id_pool.
- */
+/** @brief Number of characters in each block of ::reservation_manager::hotel_name_pool. */
 #define RESERVATION_MANAGER_STRING_POOLS_BLOCK_CAPACITY 100000
 
+/** @brief Initial capacity of ::reservation_manager::id_rows_rel. */
+#define RESERVATION_MANAGER_ID_TABLE_INITIAL_CAPACITY 1024
+
 reservation_manager_t *reservation_manager_create(void) {
     reservation_manager_t *const manager = malloc(sizeof(reservation_manager_t));
     if (!manager)
         goto DEFER_1;
 
     manager->reservations =
-        pool_create_from_size(reservation_sizeof(),
-                              RESERVATION_MANAGER_RESERVATIONS_POOL_BLOCK_CAPACITY);
+        pool_create_from_size_and_pages(reservation_sizeof(),
+                                        RESERVATION_MANAGER_RESERVATIONS_POOL_BLOCK_CAPACITY,
+                                        POOL_PAGES_HUGE);
     if (!manager->reservations)
         goto DEFER_2;
 
@@ -73,11 +136,23 @@ reservation_manager_t *reservation_manager_create(void) {
     if (!manager->hotel_name_pool)
         goto DEFER_3;
 
-    manager->user_id_pool = string_pool_create(RESERVATION_MANAGER_STRING_POOLS_BLOCK_CAPACITY);
-    if (!manager->user_id_pool)
+    manager->id_rows_rel = id_table_create(RESERVATION_MANAGER_ID_TABLE_INITIAL_CAPACITY);
+    if (!manager->id_rows_rel)
         goto DEFER_4;
 
-    manager->id_reservations_rel = g_hash_table_new(g_direct_hash, g_direct_equal);
+    manager->reservations_column     = g_array_new(FALSE, FALSE, sizeof(const reservation_t *));
+    manager->hotel_ids_column        = g_array_new(FALSE, FALSE, sizeof(hotel_id_t));
+    manager->begin_dates_column      = g_array_new(FALSE, FALSE, sizeof(date_t));
+    manager->end_dates_column        = g_array_new(FALSE, FALSE, sizeof(date_t));
+    manager->prices_per_night_column = g_array_new(FALSE, FALSE, sizeof(uint16_t));
+    manager->ratings_column          = g_array_new(FALSE, FALSE, sizeof(uint8_t));
+    manager->city_taxes_column       = g_array_new(FALSE, FALSE, sizeof(uint8_t));
+    manager->zones      = g_array_new(FALSE, FALSE, sizeof(reservation_manager_zone_t));
+    manager->partitions = g_array_new(FALSE, FALSE, sizeof(reservation_manager_partition_t));
+
+    /* Cleared, so that growing the array initializes hotels without reservations to zeroes */
+    manager->hotel_ratings = g_array_new(FALSE, TRUE, sizeof(reservation_manager_hotel_rating_t));
+    manager->id_filter     = NULL;
     return manager;
 
 DEFER_4:
@@ -107,21 +182,105 @@ reservation_manager_t *reservation_manager_clone(const reservation_manager_t *ma
     return clone;
 }
 
-int reservation_manager_add_reservation(reservation_manager_t *manager,
-                                        const reservation_t   *reservation) {
+/**
+ * @brief Widens the zone map of a span of rows so that it also contains another row.
+ *
+ * @param manager Reservation manager containing the row.
+ * @param row     Row to be added to @p zone.
+ * @param zone    Zone map to be modified.
+ */
+void __reservation_manager_zone_add_row(const reservation_manager_t *manager,
+                                        size_t                       row,
+                                        reservation_manager_zone_t  *zone) {
+    const date_t     begin_date = g_array_index(manager->begin_dates_column, date_t, row);
+    const date_t     end_date   = g_array_index(manager->end_dates_column, date_t, row);
+    const hotel_id_t hotel_id   = g_array_index(manager->hotel_ids_column, hotel_id_t, row);
+
+    zone->min_begin_date = min(zone->min_begin_date, begin_date);
+    zone->max_begin_date = max(zone->max_begin_date, begin_date);
+    zone->min_end_date   = min(zone->min_end_date, end_date);
+    zone->max_end_date   = max(zone->max_end_date, end_date);
+    zone->min_hotel_id   = min(zone->min_hotel_id, hotel_id);
+    zone->max_hotel_id   = max(zone->max_hotel_id, hotel_id);
+}
+
+/**
+ * @brief   Updates the zone maps of a reservation manager after a row is appended to its columns.
+ * @details A new zone is created when the row starts a new span.
+ *
+ * @param manager Reservation manager whose zone maps are to be updated.
+ * @param row     Row that was appended.
+ */
+void __reservation_manager_zones_append_row(reservation_manager_t *manager, size_t row) {
+    const size_t span = row / RESERVATION_MANAGER_COLUMNS_SPAN_LENGTH;
+    if (span == manager->zones->len) {
+        /* Empty zone, that any row widens */
+        const reservation_manager_zone_t zone = {.min_begin_date = DATE_LATEST,
+                                                 .max_begin_date = 0,
+                                                 .min_end_date   = DATE_LATEST,
+                                                 .max_end_date   = 0,
+                                                 .min_hotel_id   = UINT16_MAX,
+                                                 .max_hotel_id   = 0};
+        g_array_append_val(manager->zones, zone);
+    }
+
+    __reservation_manager_zone_add_row(
+        manager,
+        row,
+        &g_array_index(manager->zones, reservation_manager_zone_t, span));
+}
+
+/**
+ * @brief Rebuilds all zone maps of a reservation manager from its columns.
+ * @param manager Reservation manager whose zone maps are to be rebuilt.
+ */
+void __reservation_manager_zones_rebuild(reservation_manager_t *manager) {
+    g_array_set_size(manager->zones, 0);
+    for (size_t i = 0; i < manager->reservations_column->len; ++i)
+        __reservation_manager_zones_append_row(manager, i);
+}
 
-    reservation_t *const pool_reservation = reservation_clone(manager->reservations,
-                                                              manager->user_id_pool,
-                                                              manager->hotel_name_pool,
-                                                              reservation);
+/**
+ * @brief Checks if two zone maps have at least one possible reservation in common.
+ *
+ * @param a First zone map.
+ * @param b Second zone map.
+ *
+ * @return Whether all ranges in @p a and @p b overlap.
+ */
+int __reservation_manager_zone_intersects(const reservation_manager_zone_t *a,
+                                          const reservation_manager_zone_t *b) {
+    return a->min_begin_date <= b->max_begin_date && b->min_begin_date <= a->max_begin_date &&
+           a->min_end_date <= b->max_end_date && b->min_end_date <= a->max_end_date &&
+           a->min_hotel_id <= b->max_hotel_id && b->min_hotel_id <= a->max_hotel_id;
+}
+
+/**
+ * @brief   Adds a reservation to the pool and to the columns of a reservation manager.
+ * @details Auxiliary method for ::reservation_manager_add_reservation and
+ *          ::reservation_manager_add_reservations, that must discard partitions and the identifier
+ *          filter afterwards.
+ *
+ * @param manager     Reservation manager to add @p reservation to.
+ * @param reservation Reservation to add to @p manager.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __reservation_manager_add_row(reservation_manager_t *manager,
+                                  const reservation_t   *reservation) {
+
+    reservation_t *const pool_reservation =
+        reservation_clone(manager->reservations, manager->hotel_name_pool, reservation);
     if (!pool_reservation)
         return 1;
 
-    reservation_id_t res_id = reservation_get_id(reservation);
-    if (!g_hash_table_insert(manager->id_reservations_rel,
-                             GUINT_TO_POINTER(res_id),
-                             pool_reservation)) {
-
+    const size_t           row    = manager->reservations_column->len;
+    const reservation_id_t res_id = reservation_get_id(reservation);
+    const int              retval = id_table_insert(manager->id_rows_rel, res_id, row);
+    if (retval == 1) {
+        return 1;
+    } else if (retval == 2) {
         /* Do not fatally fail (just print a warning). Show must go on. */
         char id_str[RESERVATION_ID_SPRINTF_MIN_BUFFER_SIZE];
         reservation_id_sprintf(id_str, res_id);
@@ -130,24 +289,662 @@ int reservation_manager_add_reservation(reservation_manager_t *manager,
                 id_str);
     }
 
+    /* Add a row to the columns */
+    const reservation_t *const const_reservation = pool_reservation;
+    const hotel_id_t           hotel_id          = reservation_get_hotel_id(reservation);
+    const date_t               begin_date        = reservation_get_begin_date(reservation);
+    const date_t               end_date          = reservation_get_end_date(reservation);
+    const uint16_t             price_per_night   = reservation_get_price_per_night(reservation);
+    const uint8_t              rating            = reservation_get_rating(reservation);
+    const uint8_t              city_tax          = reservation_get_city_tax(reservation);
+    g_array_append_val(manager->reservations_column, const_reservation);
+    g_array_append_val(manager->hotel_ids_column, hotel_id);
+    g_array_append_val(manager->begin_dates_column, begin_date);
+    g_array_append_val(manager->end_dates_column, end_date);
+    g_array_append_val(manager->prices_per_night_column, price_per_night);
+    g_array_append_val(manager->ratings_column, rating);
+    g_array_append_val(manager->city_taxes_column, city_tax);
+    __reservation_manager_zones_append_row(manager, row);
+
+    if (hotel_id >= manager->hotel_ratings->len)
+        g_array_set_size(manager->hotel_ratings, (guint) hotel_id + 1);
+    reservation_manager_hotel_rating_t *const hotel_rating =
+        &g_array_index(manager->hotel_ratings, reservation_manager_hotel_rating_t, hotel_id);
+    hotel_rating->sum += rating;
+    hotel_rating->count++;
+
+    return 0;
+}
+
+/**
+ * @brief   Discards the partitions and the identifier filter of a reservation manager.
+ * @details Auxiliary method for methods that add reservations.
+ *
+ * @param manager Reservation manager whose indexes are to be discarded.
+ */
+void __reservation_manager_discard_indexes(reservation_manager_t *manager) {
+    g_array_set_size(manager->partitions, 0);
+    bloom_filter_free(manager->id_filter);
+    manager->id_filter = NULL;
+}
+
+int reservation_manager_add_reservation(reservation_manager_t *manager,
+                                        const reservation_t   *reservation) {
+    performance_probe2(manager_insert, PERFORMANCE_ACCESS_MANAGER_RESERVATIONS, 1);
+    if (__reservation_manager_add_row(manager, reservation))
+        return 1;
+
+    __reservation_manager_discard_indexes(manager);
     return 0;
 }
 
+int reservation_manager_reserve(reservation_manager_t *manager, size_t count) {
+    return id_table_reserve(manager->id_rows_rel, count) ||
+           pool_reserve(manager->reservations, count);
+}
+
+int reservation_manager_borrow_strings(reservation_manager_t *manager, mapped_file_t *file) {
+    return string_pool_no_duplicates_borrow(manager->hotel_name_pool, file);
+}
+
+int reservation_manager_add_reservations(reservation_manager_t      *manager,
+                                         const reservation_t *const *reservations,
+                                         size_t                      n) {
+    if (reservation_manager_reserve(manager, manager->reservations_column->len + n))
+        return 1;
+
+    performance_probe2(manager_insert, PERFORMANCE_ACCESS_MANAGER_RESERVATIONS, n);
+    int retval = 0;
+    for (size_t i = 0; !retval && i < n; ++i) {
+        if (i + ID_TABLE_PREFETCH_DISTANCE < n)
+            id_table_prefetch(manager->id_rows_rel,
+                              reservation_get_id(reservations[i + ID_TABLE_PREFETCH_DISTANCE]));
+        retval = __reservation_manager_add_row(manager, reservations[i]);
+    }
+
+    /* Some reservations may have been added, even on failure */
+    __reservation_manager_discard_indexes(manager);
+    return retval;
+}
+
 const reservation_t *reservation_manager_get_by_id(const reservation_manager_t *manager,
                                                    reservation_id_t             id) {
-    return g_hash_table_lookup(manager->id_reservations_rel, GUINT_TO_POINTER(id));
+    performance_access_count_probe(PERFORMANCE_ACCESS_MANAGER_RESERVATIONS);
+
+    uint32_t row;
+    if (id_table_lookup(manager->id_rows_rel, id, &row))
+        return NULL;
+
+    return g_array_index(manager->reservations_column, const reservation_t *, row);
+}
+
+void reservation_manager_get_many_by_id(const reservation_manager_t *manager,
+                                        size_t                       n,
+                                        const reservation_id_t       ids[n],
+                                        const reservation_t         *reservations[n]) {
+    for (size_t i = 0; i < n; ++i) {
+        if (i + ID_TABLE_PREFETCH_DISTANCE < n)
+            id_table_prefetch(manager->id_rows_rel, ids[i + ID_TABLE_PREFETCH_DISTANCE]);
+
+        reservations[i] = reservation_manager_get_by_id(manager, ids[i]);
+        if (reservations[i])
+            __builtin_prefetch(reservations[i]);
+    }
+}
+
+int reservation_manager_build_id_filter(reservation_manager_t *manager) {
+    if (manager->id_filter)
+        return 0;
+
+    manager->id_filter = bloom_filter_create(manager->reservations_column->len);
+    if (!manager->id_filter)
+        return 1;
+
+    for (size_t i = 0; i < manager->reservations_column->len; ++i) {
+        const reservation_t *const reservation =
+            g_array_index(manager->reservations_column, const reservation_t *, i);
+        bloom_filter_add(manager->id_filter,
+                         bloom_filter_hash_integer(reservation_get_id(reservation)));
+    }
+    return 0;
+}
+
+const reservation_t *reservation_manager_get_by_id_filtered(const reservation_manager_t *manager,
+                                                            reservation_id_t             id) {
+    if (manager->id_filter &&
+        !bloom_filter_may_contain(manager->id_filter, bloom_filter_hash_integer(id)))
+        return NULL;
+
+    const reservation_t *const reservation = reservation_manager_get_by_id(manager, id);
+    if (!reservation && manager->id_filter)
+        bloom_filter_count_false_positive(manager->id_filter);
+    return reservation;
+}
+
+int reservation_manager_get_id_filter_statistics(const reservation_manager_t *manager,
+                                                 bloom_filter_statistics_t   *statistics) {
+    if (!manager->id_filter)
+        return 1;
+
+    bloom_filter_get_statistics(manager->id_filter, statistics);
+    return 0;
+}
+
+double reservation_manager_get_hotel_average_rating(const reservation_manager_t *manager,
+                                                    hotel_id_t                   hotel_id) {
+    performance_access_count_probe(PERFORMANCE_ACCESS_MANAGER_RESERVATIONS);
+    if (hotel_id >= manager->hotel_ratings->len)
+        return -NAN;
+
+    const reservation_manager_hotel_rating_t *const hotel_rating =
+        &g_array_index(manager->hotel_ratings, reservation_manager_hotel_rating_t, hotel_id);
+    if (!hotel_rating->count)
+        return -NAN; /* Not left to 0.0 / 0.0, whose sign depends on the architecture */
+    return (double) hotel_rating->sum / (double) hotel_rating->count;
+}
+
+size_t reservation_manager_get_hotel_reservation_count(const reservation_manager_t *manager,
+                                                       hotel_id_t                   hotel_id) {
+    performance_access_count_probe(PERFORMANCE_ACCESS_MANAGER_RESERVATIONS);
+    if (hotel_id >= manager->hotel_ratings->len)
+        return 0;
+
+    const reservation_manager_hotel_rating_t *const hotel_rating =
+        &g_array_index(manager->hotel_ratings, reservation_manager_hotel_rating_t, hotel_id);
+    return hotel_rating->count;
+}
+
+int reservation_manager_get_hotel_rating_sum(const reservation_manager_t *manager,
+                                             hotel_id_t                   hotel_id,
+                                             uint64_t                    *out_sum) {
+    performance_access_count_probe(PERFORMANCE_ACCESS_MANAGER_RESERVATIONS);
+    if (hotel_id >= manager->hotel_ratings->len)
+        return 1;
+
+    const reservation_manager_hotel_rating_t *const hotel_rating =
+        &g_array_index(manager->hotel_ratings, reservation_manager_hotel_rating_t, hotel_id);
+    *out_sum = hotel_rating->sum;
+    return 0;
+}
+
+size_t reservation_manager_get_count(const reservation_manager_t *manager) {
+    return manager->reservations_column->len;
 }
 
 int reservation_manager_iter(const reservation_manager_t        *manager,
                              reservation_manager_iter_callback_t callback,
                              void                               *user_data) {
-    return pool_iter(manager->reservations, (pool_iter_callback_t) callback, user_data);
+    mapped_file_t *const borrowed =
+        string_pool_no_duplicates_get_borrowed(manager->hotel_name_pool);
+    mapped_file_begin_scan(borrowed);
+    performance_access_count_scan(PERFORMANCE_ACCESS_MANAGER_RESERVATIONS,
+                                  manager->reservations_column->len);
+    performance_trace_begin("Scan reservations");
+    const int retval =
+        pool_iter(manager->reservations, (pool_iter_callback_t) callback, user_data);
+    performance_trace_end();
+    mapped_file_end_scan(borrowed);
+    return retval;
+}
+
+/**
+ * @brief Gets a span of rows of the columns of a reservation manager.
+ *
+ * @param manager Reservation manager to get the rows from.
+ * @param row     First row in the span.
+ * @param length  Number of rows in the span.
+ * @param columns Where to write the span to.
+ */
+void __reservation_manager_get_columns(const reservation_manager_t   *manager,
+                                       size_t                         row,
+                                       size_t                         length,
+                                       reservation_manager_columns_t *columns) {
+    *columns = (reservation_manager_columns_t) {
+        .length = length,
+        .reservations =
+            &g_array_index(manager->reservations_column, const reservation_t *, row),
+        .hotel_ids        = &g_array_index(manager->hotel_ids_column, hotel_id_t, row),
+        .begin_dates      = &g_array_index(manager->begin_dates_column, date_t, row),
+        .end_dates        = &g_array_index(manager->end_dates_column, date_t, row),
+        .prices_per_night = &g_array_index(manager->prices_per_night_column, uint16_t, row),
+        .ratings          = &g_array_index(manager->ratings_column, uint8_t, row),
+        .city_taxes       = &g_array_index(manager->city_taxes_column, uint8_t, row)};
+}
+
+/**
+ * @brief   Iterates through the columns of a reservation manager, skipping spans outside of a zone.
+ * @details Auxiliary method for ::reservation_manager_iter_columns and
+ *          ::reservation_manager_iter_columns_filtered.
+ *
+ * @param manager   Reservation manager to iterate over.
+ * @param zone      Ranges of values of the reservations of interest. `NULL` visits every span.
+ * @param callback  Method called for every span of rows that may intersect @p zone.
+ * @param user_data Argument passed to @p callback.
+ *
+ * @return The return value of the last-called @p callback.
+ */
+int __reservation_manager_iter_columns(const reservation_manager_t                *manager,
+                                       const reservation_manager_zone_t           *zone,
+                                       reservation_manager_iter_columns_callback_t callback,
+                                       void                                       *user_data) {
+    performance_trace_begin(zone ? "Scan reservation columns (filtered)"
+                                 : "Scan reservation columns");
+
+    int          retval = 0;
+    const size_t rows   = manager->reservations_column->len;
+    for (size_t i = 0; i < rows; i += RESERVATION_MANAGER_COLUMNS_SPAN_LENGTH) {
+        const size_t length = min(rows - i, RESERVATION_MANAGER_COLUMNS_SPAN_LENGTH);
+
+        const reservation_manager_zone_t *const span_zone =
+            &g_array_index(manager->zones,
+                           reservation_manager_zone_t,
+                           i / RESERVATION_MANAGER_COLUMNS_SPAN_LENGTH);
+        if (zone && !__reservation_manager_zone_intersects(zone, span_zone))
+            continue;
+
+        performance_access_count_scan(PERFORMANCE_ACCESS_MANAGER_RESERVATIONS, length);
+        reservation_manager_columns_t columns;
+        __reservation_manager_get_columns(manager, i, length, &columns);
+
+        retval = callback(user_data, &columns);
+        if (retval)
+            break;
+    }
+
+    performance_trace_end();
+    return retval;
+}
+
+int reservation_manager_iter_columns(const reservation_manager_t                *manager,
+                                     reservation_manager_iter_columns_callback_t callback,
+                                     void                                       *user_data) {
+    return __reservation_manager_iter_columns(manager, NULL, callback, user_data);
+}
+
+int reservation_manager_iter_columns_filtered(
+    const reservation_manager_t                *manager,
+    const reservation_manager_zone_t           *zone,
+    reservation_manager_iter_columns_callback_t callback,
+    void                                       *user_data) {
+    return __reservation_manager_iter_columns(manager, zone, callback, user_data);
+}
+
+/**
+ * @struct reservation_manager_parallel_iter_data_t
+ * @brief  Internal data type for the `user_data` parameter of the callbacks of
+ *         ::reservation_manager_parallel_iter_columns.
+ *
+ * @var reservation_manager_parallel_iter_data_t::manager
+ *     @brief Reservation manager being iterated over.
+ * @var reservation_manager_parallel_iter_data_t::init
+ *     @brief Method called to create the accumulator of each range.
+ * @var reservation_manager_parallel_iter_data_t::callback
+ *     @brief Method called for every span of rows.
+ * @var reservation_manager_parallel_iter_data_t::merge
+ *     @brief Method called for every accumulator.
+ * @var reservation_manager_parallel_iter_data_t::original_user_data
+ *     @brief `user_data` parameter for ::reservation_manager_parallel_iter_data_t::init and
+ *            ::reservation_manager_parallel_iter_data_t::merge.
+ * @var reservation_manager_parallel_iter_data_t::retval
+ *     @brief Return value of the first callback that stopped the iteration, or `0`.
+ */
+typedef struct {
+    const reservation_manager_t                *manager;
+    thread_pool_reduce_init_callback_t          init;
+    reservation_manager_iter_columns_callback_t callback;
+    thread_pool_reduce_merge_callback_t         merge;
+    void                                       *original_user_data;
+    int                                         retval;
+} reservation_manager_parallel_iter_data_t;
+
+/**
+ * @brief Creates the accumulator of a range in ::reservation_manager_parallel_iter_columns.
+ * @param user_data A pointer to a ::reservation_manager_parallel_iter_data_t.
+ * @return The accumulator created by the target callback.
+ */
+void *__reservation_manager_parallel_iter_init(void *user_data) {
+    const reservation_manager_parallel_iter_data_t *const iter_data = user_data;
+    return iter_data->init(iter_data->original_user_data);
+}
+
+/**
+ * @brief Calls the target callback of ::reservation_manager_parallel_iter_columns for a range of
+ *        spans.
+ *
+ * @param user_data   A pointer to a ::reservation_manager_parallel_iter_data_t.
+ * @param accumulator Accumulator of the range.
+ * @param start       First span in the range.
+ * @param end         Span after the last one in the range.
+ */
+void __reservation_manager_parallel_iter_range(void  *user_data,
+                                               void  *accumulator,
+                                               size_t start,
+                                               size_t end) {
+    reservation_manager_parallel_iter_data_t *const iter_data = user_data;
+    const size_t rows = iter_data->manager->reservations_column->len;
+
+    performance_trace_begin("Scan reservation columns (parallel range)");
+    for (size_t span = start; span < end; ++span) {
+        if (__atomic_load_n(&iter_data->retval, __ATOMIC_RELAXED))
+            break;
+
+        const size_t                  row = span * RESERVATION_MANAGER_COLUMNS_SPAN_LENGTH;
+        reservation_manager_columns_t columns;
+        __reservation_manager_get_columns(iter_data->manager,
+                                          row,
+                                          min(rows - row, RESERVATION_MANAGER_COLUMNS_SPAN_LENGTH),
+                                          &columns);
+
+        const int retval = iter_data->callback(accumulator, &columns);
+        if (retval) {
+            int expected = 0;
+            __atomic_compare_exchange_n(&iter_data->retval,
+                                        &expected,
+                                        retval,
+                                        0,
+                                        __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED);
+            break;
+        }
+    }
+    performance_trace_end();
+}
+
+/**
+ * @brief Merges the accumulator of a range in ::reservation_manager_parallel_iter_columns.
+ *
+ * @param user_data   A pointer to a ::reservation_manager_parallel_iter_data_t.
+ * @param accumulator Accumulator to be merged.
+ */
+void __reservation_manager_parallel_iter_merge(void *user_data, void *accumulator) {
+    const reservation_manager_parallel_iter_data_t *const iter_data = user_data;
+    iter_data->merge(iter_data->original_user_data, accumulator);
+}
+
+int reservation_manager_parallel_iter_columns(
+    const reservation_manager_t                *manager,
+    thread_pool_t                              *pool,
+    thread_pool_reduce_init_callback_t          init,
+    reservation_manager_iter_columns_callback_t callback,
+    thread_pool_reduce_merge_callback_t         merge,
+    void                                       *user_data) {
+
+    reservation_manager_parallel_iter_data_t iter_data = {.manager            = manager,
+                                                          .init               = init,
+                                                          .callback           = callback,
+                                                          .merge              = merge,
+                                                          .original_user_data = user_data,
+                                                          .retval             = 0};
+
+    const size_t rows  = manager->reservations_column->len;
+    const size_t spans = rows / RESERVATION_MANAGER_COLUMNS_SPAN_LENGTH +
+                         (rows % RESERVATION_MANAGER_COLUMNS_SPAN_LENGTH != 0);
+    performance_access_count_scan(PERFORMANCE_ACCESS_MANAGER_RESERVATIONS, rows);
+    if (thread_pool_parallel_reduce(pool,
+                                    spans,
+                                    0,
+                                    __reservation_manager_parallel_iter_init,
+                                    __reservation_manager_parallel_iter_range,
+                                    __reservation_manager_parallel_iter_merge,
+                                    &iter_data))
+        return 1;
+
+    return iter_data.retval;
+}
+
+const reservation_manager_partition_t *
+    reservation_manager_get_partitions(const reservation_manager_t *manager, size_t *count) {
+    *count = manager->partitions->len;
+    return *count ? &g_array_index(manager->partitions, reservation_manager_partition_t, 0) : NULL;
+}
+
+int reservation_manager_iter_partition_columns(
+    const reservation_manager_t                *manager,
+    const reservation_manager_partition_t      *partition,
+    reservation_manager_iter_columns_callback_t callback,
+    void                                       *user_data) {
+
+    performance_access_count_scan(PERFORMANCE_ACCESS_MANAGER_RESERVATIONS, partition->length);
+    performance_trace_begin("Scan reservation partition");
+
+    int          retval = 0;
+    const size_t end    = partition->first_row + partition->length;
+    for (size_t i = partition->first_row; i < end; i += RESERVATION_MANAGER_COLUMNS_SPAN_LENGTH) {
+        reservation_manager_columns_t columns;
+        __reservation_manager_get_columns(manager,
+                                          i,
+                                          min(end - i, RESERVATION_MANAGER_COLUMNS_SPAN_LENGTH),
+                                          &columns);
+
+        retval = callback(user_data, &columns);
+        if (retval)
+            break;
+    }
+
+    performance_trace_end();
+    return retval;
+}
+
+/**
+ * @brief   Reorders the rows of a column of a reservation manager.
+ * @details Auxiliary method for ::__reservation_manager_cluster.
+ *
+ * @param column       Column to be reordered. Will be replaced by a new array.
+ * @param element_size Size of each element in @p column.
+ * @param order        Sorted entries, whose ::radix_sort_entry_t::tiebreak is the old row of each
+ *                     new row.
+ */
+void __reservation_manager_column_permute(GArray                  **column,
+                                          size_t                    element_size,
+                                          const radix_sort_entry_t *order) {
+    const size_t  rows     = (*column)->len;
+    GArray *const permuted = g_array_sized_new(FALSE, FALSE, element_size, rows);
+    g_array_set_size(permuted, rows);
+
+    for (size_t i = 0; i < rows; ++i)
+        memcpy(permuted->data + i * element_size,
+               (*column)->data + order[i].tiebreak * element_size,
+               element_size);
+
+    g_array_unref(*column);
+    *column = permuted;
+}
+
+/**
+ * @brief   Sorts the rows of a reservation manager by begin date.
+ * @details See ::__flight_manager_cluster, which this is analogous to.
+ *
+ * @param manager Reservation manager whose rows are to be sorted.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (rows are left as they were).
+ */
+int __reservation_manager_cluster(reservation_manager_t *manager) {
+    const size_t        rows    = manager->reservations_column->len;
+    radix_sort_entry_t *entries = malloc(max(rows, 1) * sizeof(radix_sort_entry_t));
+    if (!entries)
+        return 1;
+
+    /* Repeated identifiers point to one of their rows only, so the others mustn't update them */
+    for (size_t i = 0; i < rows; ++i) {
+        const reservation_t *const reservation =
+            g_array_index(manager->reservations_column, const reservation_t *, i);
+
+        uint32_t  id_row;
+        const int owns_id =
+            !id_table_lookup(manager->id_rows_rel, reservation_get_id(reservation), &id_row) &&
+            id_row == i;
+
+        entries[i].key      = g_array_index(manager->begin_dates_column, date_t, i);
+        entries[i].tiebreak = i;
+        entries[i].value    = owns_id ? reservation : NULL;
+    }
+
+    if (radix_sort(entries, rows)) {
+        free(entries);
+        return 1;
+    }
+
+    for (size_t i = 0; i < rows; ++i)
+        if (entries[i].value) /* Replacement, can't fail */
+            id_table_insert(manager->id_rows_rel, reservation_get_id(entries[i].value), i);
+
+    __reservation_manager_column_permute(&manager->reservations_column,
+                                         sizeof(const reservation_t *),
+                                         entries);
+    __reservation_manager_column_permute(&manager->hotel_ids_column, sizeof(hotel_id_t), entries);
+    __reservation_manager_column_permute(&manager->begin_dates_column, sizeof(date_t), entries);
+    __reservation_manager_column_permute(&manager->end_dates_column, sizeof(date_t), entries);
+    __reservation_manager_column_permute(&manager->prices_per_night_column,
+                                         sizeof(uint16_t),
+                                         entries);
+    __reservation_manager_column_permute(&manager->ratings_column, sizeof(uint8_t), entries);
+    __reservation_manager_column_permute(&manager->city_taxes_column, sizeof(uint8_t), entries);
+
+    free(entries);
+    return 0;
+}
+
+/**
+ * @brief   Splits the rows of a reservation manager into partitions of reservations that begin in
+ *          the same month.
+ * @details Auxiliary method for ::reservation_manager_compact. Rows must already be sorted by
+ *          begin date (see ::__reservation_manager_cluster).
+ *
+ * @param manager Reservation manager whose rows are to be partitioned.
+ */
+void __reservation_manager_partitions_rebuild(reservation_manager_t *manager) {
+    g_array_set_size(manager->partitions, 0);
+
+    const size_t rows  = manager->reservations_column->len;
+    size_t       first = 0;
+    date_t       month = 0;
+    for (size_t i = 0; i <= rows; ++i) {
+        const date_t row_month =
+            i == rows
+                ? DATE_LATEST
+                : date_generate_dayless(g_array_index(manager->begin_dates_column, date_t, i));
+
+        if (i > first && row_month != month) {
+            const reservation_manager_partition_t partition = {.month     = month,
+                                                               .length    = i - first,
+                                                               .first_row = first};
+            g_array_append_val(manager->partitions, partition);
+            first = i;
+        }
+        month = row_month;
+    }
+}
+
+/**
+ * @brief   Spreads the columns of a reservation manager among all NUMA nodes.
+ * @details Auxiliary method for ::reservation_manager_compact. Columns are scanned by all
+ *          threads, so they're interleaved (see ::numa_topology_interleave).
+ * @param   manager Reservation manager whose columns are no longer going to grow.
+ */
+void __reservation_manager_interleave_columns(const reservation_manager_t *manager) {
+    GArray *const columns[] = {manager->reservations_column,
+                               manager->hotel_ids_column,
+                               manager->begin_dates_column,
+                               manager->end_dates_column,
+                               manager->prices_per_night_column,
+                               manager->ratings_column,
+                               manager->city_taxes_column};
+
+    for (size_t i = 0; i < sizeof(columns) / sizeof(*columns); ++i)
+        numa_topology_interleave(columns[i]->data,
+                                 columns[i]->len * g_array_get_element_size(columns[i]));
+}
+
+int reservation_manager_compact(reservation_manager_t *manager) {
+    pool_trim(manager->reservations);
+    string_pool_no_duplicates_trim(manager->hotel_name_pool);
+
+    /* Clustering is only an optimization, but partitions can't be built without it */
+    if (__reservation_manager_cluster(manager))
+        g_array_set_size(manager->partitions, 0);
+    else
+        __reservation_manager_partitions_rebuild(manager);
+
+    __reservation_manager_zones_rebuild(manager);
+    if (id_table_compact(manager->id_rows_rel))
+        return 1;
+
+    /* Only optimizations for NUMA machines, so failures are ignored */
+    __reservation_manager_interleave_columns(manager);
+    id_table_replicate(manager->id_rows_rel);
+    return 0;
+}
+
+int reservation_manager_add_to_memory_report(const reservation_manager_t *manager,
+                                             memory_report_t             *report) {
+    memory_usage_t usage;
+
+    pool_get_memory_usage(manager->reservations, &usage);
+    if (memory_report_add(report, "reservations.reservations", &usage))
+        return 1;
+
+    string_pool_no_duplicates_get_memory_usage(manager->hotel_name_pool, &usage);
+    if (memory_report_add(report, "reservations.hotel_name_pool", &usage))
+        return 1;
+
+    id_table_get_memory_usage(manager->id_rows_rel, &usage);
+    if (memory_report_add(report, "reservations.id_rows_rel", &usage))
+        return 1;
+
+    GArray *const columns[] = {manager->reservations_column,
+                               manager->hotel_ids_column,
+                               manager->begin_dates_column,
+                               manager->end_dates_column,
+                               manager->prices_per_night_column,
+                               manager->ratings_column,
+                               manager->city_taxes_column};
+
+    usage = (memory_usage_t) {0};
+    memory_usage_add_arrays(&usage, sizeof(columns) / sizeof(*columns), columns);
+    if (memory_report_add(report, "reservations.columns", &usage))
+        return 1;
+
+    usage = (memory_usage_t) {0};
+    memory_usage_add_arrays(&usage, 1, &manager->zones);
+    if (memory_report_add(report, "reservations.zones", &usage))
+        return 1;
+
+    usage = (memory_usage_t) {0};
+    memory_usage_add_arrays(&usage, 1, &manager->partitions);
+    if (memory_report_add(report, "reservations.partitions", &usage))
+        return 1;
+
+    usage = (memory_usage_t) {0};
+    memory_usage_add_arrays(&usage, 1, &manager->hotel_ratings);
+    if (memory_report_add(report, "reservations.hotel_ratings", &usage))
+        return 1;
+
+    if (manager->id_filter) {
+        const size_t filter_bytes = bloom_filter_get_size(manager->id_filter);
+        return memory_report_add_allocation(report,
+                                            "reservations.id_filter",
+                                            filter_bytes,
+                                            filter_bytes);
+    }
+    return 0;
 }
 
 void reservation_manager_free(reservation_manager_t *manager) {
     pool_free(manager->reservations);
     string_pool_no_duplicates_free(manager->hotel_name_pool);
-    string_pool_free(manager->user_id_pool);
-    g_hash_table_unref(manager->id_reservations_rel);
+    id_table_free(manager->id_rows_rel);
+
+    g_array_unref(manager->reservations_column);
+    g_array_unref(manager->hotel_ids_column);
+    g_array_unref(manager->begin_dates_column);
+    g_array_unref(manager->end_dates_column);
+    g_array_unref(manager->prices_per_night_column);
+    g_array_unref(manager->ratings_column);
+    g_array_unref(manager->city_taxes_column);
+    g_array_unref(manager->zones);
+    g_array_unref(manager->partitions);
+    g_array_unref(manager->hotel_ratings);
+    bloom_filter_free(manager->id_filter);
     free(manager);
 }
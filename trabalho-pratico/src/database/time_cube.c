@@ -0,0 +1,278 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  time_cube.c
+ * @brief Implementation of methods in include/database/time_cube.h
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "database/time_cube.h"
+#include "utils/date_and_time.h"
+#include "utils/thread_pool.h"
+
+/** @brief The number of years counted by a ::time_cube_t. */
+#define TIME_CUBE_YEAR_COUNT (TIME_CUBE_YEAR_RANGE_END - TIME_CUBE_YEAR_RANGE_START)
+
+/**
+ * @struct time_cube
+ * @brief  Event counts of every day, month and year in a database.
+ *
+ * @var time_cube::cells
+ *     @brief   Counts of every instant, indexed by year (relative to ::TIME_CUBE_YEAR_RANGE_START),
+ *              month and day.
+ *     @details Month `0` is the whole year, and day `0` is the whole month, so that the counts of
+ *              any instant can be read without adding up the ones of its days.
+ * @var time_cube::has_unique_passengers
+ *     @brief Whether the unique passengers in ::time_cube::cells are up to date.
+ */
+struct time_cube {
+    time_cube_cell_t cells[TIME_CUBE_YEAR_COUNT][13][32];
+    int              has_unique_passengers;
+};
+
+/**
+ * @brief Unique passengers of every instant in a range of users, indexed like ::time_cube::cells.
+ */
+typedef uint32_t time_cube_unique_passengers_counts_t[TIME_CUBE_YEAR_COUNT][13][32];
+
+time_cube_t *time_cube_create(void) {
+    return calloc(1, sizeof(time_cube_t));
+}
+
+time_cube_t *time_cube_clone(const time_cube_t *cube) {
+    time_cube_t *const clone = malloc(sizeof(time_cube_t));
+    if (!clone)
+        return NULL;
+
+    memcpy(clone, cube, sizeof(time_cube_t));
+    return clone;
+}
+
+/**
+ * @brief Gets the counter of a type of events in the counts of an instant.
+ *
+ * @param cell    Counts of the instant.
+ * @param measure Type of the events.
+ *
+ * @return A pointer to the counter in @p cell.
+ */
+uint32_t *__time_cube_get_counter(time_cube_cell_t *cell, time_cube_measure_t measure) {
+    switch (measure) {
+        case TIME_CUBE_MEASURE_USERS:
+            return &cell->users;
+        case TIME_CUBE_MEASURE_FLIGHTS:
+            return &cell->flights;
+        case TIME_CUBE_MEASURE_PASSENGERS:
+            return &cell->passengers;
+        default:
+            return &cell->reservations;
+    }
+}
+
+void time_cube_add(time_cube_t *cube, time_cube_measure_t measure, date_t date, int32_t count) {
+    const uint16_t year = date_get_year(date);
+    if (year < TIME_CUBE_YEAR_RANGE_START || year >= TIME_CUBE_YEAR_RANGE_END)
+        return;
+
+    time_cube_cell_t(*const months)[32] = cube->cells[year - TIME_CUBE_YEAR_RANGE_START];
+    const uint8_t month = date_get_month(date), day = date_get_day(date);
+
+    /* Unsigned arithmetic wraps around, so negative counts are subtracted */
+    *__time_cube_get_counter(&months[0][0], measure) += count;
+    *__time_cube_get_counter(&months[month][0], measure) += count;
+    *__time_cube_get_counter(&months[month][day], measure) += count;
+}
+
+/**
+ * @brief   Creates the accumulator of a range of users.
+ * @details Callback for ::user_manager_parallel_iter_with_flights.
+ *
+ * @param user_data The ::time_cube_t being counted (not used).
+ *
+ * @return A pointer to a zeroed ::time_cube_unique_passengers_counts_t, or `NULL` on allocation
+ *         failure.
+ */
+void *__time_cube_count_unique_passengers_init(void *user_data) {
+    (void) user_data;
+    return calloc(1, sizeof(time_cube_unique_passengers_counts_t));
+}
+
+/**
+ * @brief   Counts a user as a unique passenger of every day, month and year they have flights in.
+ * @details Callback for ::user_manager_parallel_iter_with_flights. Flights are sorted from the
+ *          most recent to the oldest one, so the flights of each instant are contiguous, and a
+ *          user is new to an instant when it differs from the previous flight's.
+ *
+ * @param user_data A pointer to the ::time_cube_unique_passengers_counts_t of the user's range.
+ * @param user      User being processed (not used).
+ * @param flights   Flights of @p user, along with their scheduled departure dates.
+ *
+ * @retval 0 Always, not to stop iteration.
+ */
+int __time_cube_count_unique_passengers_foreach_user(void                  *user_data,
+                                                     const user_t          *user,
+                                                     user_manager_id_span_t flights) {
+    (void) user;
+    uint32_t(*const counts)[13][32] = user_data;
+
+    int previous_year = -1, previous_month = -1, previous_day = -1;
+    for (size_t i = 0; i < flights.length; ++i) {
+        const date_t   date = date_and_time_get_date(flights.dates[i]);
+        const uint16_t year = date_get_year(date);
+        if (year < TIME_CUBE_YEAR_RANGE_START || year >= TIME_CUBE_YEAR_RANGE_END)
+            continue;
+
+        const int y = year - TIME_CUBE_YEAR_RANGE_START, m = date_get_month(date),
+                  d = date_get_day(date);
+        if (y != previous_year) {
+            counts[y][0][0]++;
+            previous_year  = y;
+            previous_month = -1;
+        }
+        if (m != previous_month) {
+            counts[y][m][0]++;
+            previous_month = m;
+            previous_day   = -1;
+        }
+        if (d != previous_day) {
+            counts[y][m][d]++;
+            previous_day = d;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief   Adds the unique passengers of a range of users to a time cube.
+ * @details Callback for ::user_manager_parallel_iter_with_flights. Each user is in a single range,
+ *          so the counts of ranges can be added up.
+ *
+ * @param user_data   The ::time_cube_t being counted.
+ * @param accumulator Accumulator created by ::__time_cube_count_unique_passengers_init, freed by
+ *                    this method.
+ */
+void __time_cube_count_unique_passengers_merge(void *user_data, void *accumulator) {
+    time_cube_t *const cube = user_data;
+    const uint32_t(*const counts)[13][32] = accumulator;
+
+    for (size_t y = 0; y < TIME_CUBE_YEAR_COUNT; ++y)
+        for (size_t m = 0; m < 13; ++m)
+            for (size_t d = 0; d < 32; ++d)
+                cube->cells[y][m][d].unique_passengers += counts[y][m][d];
+
+    free(accumulator);
+}
+
+/**
+ * @brief Resets the unique passengers of every instant in a time cube to `0`.
+ * @param cube Time cube to be modified.
+ */
+void __time_cube_clear_unique_passengers(time_cube_t *cube) {
+    for (size_t y = 0; y < TIME_CUBE_YEAR_COUNT; ++y)
+        for (size_t m = 0; m < 13; ++m)
+            for (size_t d = 0; d < 32; ++d)
+                cube->cells[y][m][d].unique_passengers = 0;
+}
+
+int time_cube_count_unique_passengers(time_cube_t *cube, const user_manager_t *users) {
+    __time_cube_clear_unique_passengers(cube);
+    cube->has_unique_passengers =
+        !user_manager_parallel_iter_with_flights(users,
+                                                 thread_pool_get_shared(),
+                                                 __time_cube_count_unique_passengers_init,
+                                                 __time_cube_count_unique_passengers_foreach_user,
+                                                 __time_cube_count_unique_passengers_merge,
+                                                 cube);
+    return !cube->has_unique_passengers;
+}
+
+void time_cube_invalidate_unique_passengers(time_cube_t *cube) {
+    cube->has_unique_passengers = 0;
+}
+
+int time_cube_has_unique_passengers(const time_cube_t *cube) {
+    return cube->has_unique_passengers;
+}
+
+int time_cube_iter_unique_passengers(const time_cube_t                     *cube,
+                                     time_cube_unique_passengers_callback_t callback,
+                                     void                                  *user_data) {
+    if (!cube->has_unique_passengers)
+        return 1;
+
+    for (size_t y = 0; y < TIME_CUBE_YEAR_COUNT; ++y) {
+        for (size_t m = 0; m < 13; ++m) {
+            for (size_t d = 0; d < 32; ++d) {
+                const uint32_t count = cube->cells[y][m][d].unique_passengers;
+                if (!count)
+                    continue;
+
+                const time_cube_unique_passengers_t entry = {
+                    .year  = y + TIME_CUBE_YEAR_RANGE_START,
+                    .month = m,
+                    .day   = d,
+                    .count = count};
+                const int retval = callback(user_data, &entry);
+                if (retval)
+                    return retval;
+            }
+        }
+    }
+    return 0;
+}
+
+int time_cube_restore_unique_passengers(time_cube_t                         *cube,
+                                        const time_cube_unique_passengers_t *entries,
+                                        size_t                               n) {
+    for (size_t i = 0; i < n; ++i)
+        if (!time_cube_get(cube, entries[i].year, entries[i].month, entries[i].day))
+            return 1;
+
+    __time_cube_clear_unique_passengers(cube);
+    for (size_t i = 0; i < n; ++i)
+        cube->cells[entries[i].year - TIME_CUBE_YEAR_RANGE_START][entries[i].month][entries[i].day]
+            .unique_passengers = entries[i].count;
+
+    cube->has_unique_passengers = 1;
+    return 0;
+}
+
+const time_cube_cell_t *time_cube_get(const time_cube_t *cube,
+                                      uint16_t           year,
+                                      uint8_t            month,
+                                      uint8_t            day) {
+    if (year < TIME_CUBE_YEAR_RANGE_START || year >= TIME_CUBE_YEAR_RANGE_END || month > 12 ||
+        day > 31 || (month == 0 && day != 0))
+        return NULL;
+
+    return &cube->cells[year - TIME_CUBE_YEAR_RANGE_START][month][day];
+}
+
+int time_cube_add_to_memory_report(const time_cube_t *cube, memory_report_t *report) {
+    (void) cube;
+    return memory_report_add_allocation(report,
+                                        "time_cube",
+                                        sizeof(time_cube_t),
+                                        sizeof(time_cube_t));
+}
+
+void time_cube_free(time_cube_t *cube) {
+    free(cube);
+}
@@ -22,11 +22,38 @@
  * See [the header file's documentation](@ref user_manager_examples).
  */
 
+#include <glib.h>
 #include <stdio.h> /* For panic purporses */
 #include <stdlib.h>
+#include <string.h>
 
 #include "database/user_manager.h"
-#include "utils/glib/GConstKeyHashTable.h"
+#include "testing/performance_access.h"
+#include "testing/performance_probes.h"
+#include "testing/performance_trace.h"
+#include "utils/int_utils.h"
+#include "utils/numa_topology.h"
+#include "utils/radix_sort.h"
+#include "utils/single_pool_id_linked_list.h"
+#include "utils/string_table.h"
+#include "utils/thread_pool.h"
+
+/**
+ * @enum  user_manager_relation_t
+ * @brief Type of an association between users and other entities.
+ *
+ * @var USER_MANAGER_RELATION_FLIGHTS
+ *     @brief Associations between users and the flights they travelled in (passengers).
+ * @var USER_MANAGER_RELATION_RESERVATIONS
+ *     @brief Associations between users and the reservations they booked.
+ * @var USER_MANAGER_RELATION_COUNT
+ *     @brief Number of elements in this enumeration.
+ */
+typedef enum {
+    USER_MANAGER_RELATION_FLIGHTS,
+    USER_MANAGER_RELATION_RESERVATIONS,
+    USER_MANAGER_RELATION_COUNT
+} user_manager_relation_t;
 
 /**
  * @struct user_manager_user_and_data_t
@@ -34,80 +61,296 @@
  *
  * @var user_manager_user_and_data_t::user
  *     @brief User data.
- * @var user_manager_user_and_data_t::flights
- *     @brief Flight data for ::user_manager_user_and_data_t::user.
- * @var user_manager_user_and_data_t::reservations
- *     @brief Reservation data for ::user_manager_user_and_data_t::user.
+ * @var user_manager_user_and_data_t::relations
+ *     @brief   Flights and reservations (see ::user_manager_relation_t) of
+ *              ::user_manager_user_and_data_t::user, while the manager isn't frozen.
+ *     @details Always empty in frozen managers, where ::user_manager::frozen_relations is used
+ *              instead.
+ * @var user_manager_user_and_data_t::total_spent_cents
+ *     @brief   Sum of the prices of the reservations of ::user_manager_user_and_data_t::user, in
+ *              cents.
+ *     @details Only meaningful in frozen managers, as it's computed by ::user_manager_freeze.
  */
 typedef struct {
-    const user_t *const           user;
-    single_pool_id_linked_list_t *flights;
-    single_pool_id_linked_list_t *reservations;
+    const user_t                 *user;
+    single_pool_id_linked_list_t relations[USER_MANAGER_RELATION_COUNT];
+    uint64_t                     total_spent_cents;
 } user_manager_user_and_data_t;
 
+/**
+ * @struct user_manager_frozen_relation_t
+ * @brief  Associations of a given type (::user_manager_relation_t) of all users in a frozen
+ *         ::user_manager_t, in compressed sparse row format.
+ *
+ * @var user_manager_frozen_relation_t::offsets
+ *     @brief   Array of `number of users + 1` offsets into ::user_manager_frozen_relation_t::ids.
+ *     @details The identifiers associated to the user with index `i` are in the range
+ *              `[offsets[i], offsets[i + 1])`. This is `NULL` if the manager isn't frozen.
+ * @var user_manager_frozen_relation_t::ids
+ *     @brief Identifiers associated to all users, grouped by user, and sorted by date in each group
+ *            (see ::user_manager_id_span_t).
+ * @var user_manager_frozen_relation_t::dates
+ *     @brief Date of each identifier in ::user_manager_frozen_relation_t::ids.
+ */
+typedef struct {
+    uint32_t        *offsets;
+    uint32_t        *ids;
+    date_and_time_t *dates;
+} user_manager_frozen_relation_t;
+
+/**
+ * @struct user_manager_frozen_passengers_t
+ * @brief  Flight-user associations (passengers) of a frozen ::user_manager_t, grouped by flight
+ *         instead of by user.
+ *
+ * @var user_manager_frozen_passengers_t::flight_ids
+ *     @brief Identifiers of all flights with passengers, in ascending order.
+ * @var user_manager_frozen_passengers_t::offsets
+ *     @brief   Array of `length + 1` offsets into
+ *              ::user_manager_frozen_passengers_t::user_indices.
+ *     @details The passengers of `flight_ids[i]` are in the range `[offsets[i], offsets[i + 1])`.
+ * @var user_manager_frozen_passengers_t::user_indices
+ *     @brief Indices of the passengers of all flights, grouped by flight, and in ascending order in
+ *            each group.
+ * @var user_manager_frozen_passengers_t::length
+ *     @brief Number of elements in ::user_manager_frozen_passengers_t::flight_ids.
+ */
+typedef struct {
+    uint32_t *flight_ids;
+    uint32_t *offsets;
+    uint32_t *user_indices;
+    size_t    length;
+} user_manager_frozen_passengers_t;
+
+/**
+ * @struct user_manager_staged_association_t
+ * @brief  An association added while associations are staged (see
+ *         ::user_manager_stage_associations).
+ *
+ * @var user_manager_staged_association_t::user_index
+ *     @brief Index of the user in the association.
+ * @var user_manager_staged_association_t::id
+ *     @brief Identifier of the entity associated to the user.
+ */
+typedef struct {
+    uint32_t user_index;
+    uint32_t id;
+} user_manager_staged_association_t;
+
 /**
  * @struct user_manager
  * @brief  A data type that contains and manages all users in a database.
  *
  * @var user_manager::users
  *     @brief Allocator for users (::user_t) in the manager.
+ * @var user_manager::cold_users
+ *     @brief   Allocator for the rarely accessed fields of the users in the manager (see
+ *              ::user_create).
+ *     @details Kept apart from ::user_manager::users, so that scans of all users touch less
+ *              memory.
  * @var user_manager::user_data
- *     @brief Allocator for user data (::user_manager_user_and_data_t) in the manager.
- * @var user_manager::ll_nodes
- *     @brief Allocator for linked list nodes.
+ *     @brief   User data (::user_manager_user_and_data_t) in the manager, indexed by user index.
+ *     @details A user's index is the number of users added to the manager before it.
+ * @var user_manager::relation_nodes
+ *     @brief   Allocators for linked list nodes in ::user_manager_user_and_data_t::relations, or
+ *              `NULL` while the manager is frozen.
+ *     @details There's one for each relation, so that flight and reservation associations can be
+ *              added from different threads at the same time.
+ * @var user_manager::frozen_relations
+ *     @brief Associations of every user, once the manager is frozen (see ::user_manager_freeze).
+ * @var user_manager::frozen_passengers
+ *     @brief The transpose of the flight associations in ::user_manager::frozen_relations, once the
+ *            manager is frozen.
  * @var user_manager::strings
  *     @brief Allocator for strings stored in users.
+ * @var user_manager::active_users
+ *     @brief   Bitmap (`GArray` of `uint64_t` words) of the users with an active account, indexed
+ *              by user index.
+ *     @details Bit `i % 64` of word `i / 64` is set when the user with index `i` is active.
  * @var user_manager::id_users_rel
- *     @brief Hash table for user identifier (`const char *`) -> user_manager_user_and_data_t
+ *     @brief Hash table for user identifier (keys in ::user_manager::strings) -> user index
  *            mapping.
+ * @var user_manager::id_filter
+ *     @brief   Bloom filter of the identifiers of all users (see ::user_manager_build_id_filter),
+ *              or `NULL` if it wasn't built.
+ *     @details Adding users discards it.
+ * @var user_manager::staged_relations
+ *     @brief Associations (::user_manager_staged_association_t) added since
+ *            ::user_manager_stage_associations was called, or `NULL` if they aren't being staged.
  */
 struct user_manager {
-    pool_t             *users;
-    pool_t             *user_data;
-    pool_t             *ll_nodes;
-    string_pool_t      *strings;
-    GConstKeyHashTable *id_users_rel;
+    pool_t                            *users;
+    pool_t                            *cold_users;
+    GArray                            *user_data;
+    single_pool_id_linked_list_pool_t *relation_nodes[USER_MANAGER_RELATION_COUNT];
+    user_manager_frozen_relation_t     frozen_relations[USER_MANAGER_RELATION_COUNT];
+    user_manager_frozen_passengers_t   frozen_passengers;
+    string_pool_t                     *strings;
+    GArray                            *active_users;
+    string_table_t                    *id_users_rel;
+    bloom_filter_t                    *id_filter;
+    GArray                            *staged_relations[USER_MANAGER_RELATION_COUNT];
 };
 
-/** @brief Number of users in each block of ::user_manager::users and ::user_manager::user_data. */
+/** @brief Number of users in each block of ::user_manager::users. */
 #define USER_MANAGER_USERS_POOL_BLOCK_CAPACITY 20000
 
-/** @brief Number of flight / reservation associations in each block of ::user_manager::ll_nodes. */
-#define USER_MANAGER_USERS_LL_NODES_BLOCK_CAPACITY 100000
+/** @brief Initial number of associations in each pool in ::user_manager::relation_nodes. */
+#define USER_MANAGER_USERS_LL_NODES_INITIAL_CAPACITY 100000
 
 /** @brief Number of characters in each block of ::user_manager::strings. */
 #define USER_MANAGER_STRINGS_POOL_BLOCK_CAPACITY 100000
 
+/** @brief Initial capacity of ::user_manager::id_users_rel. */
+#define USER_MANAGER_ID_TABLE_INITIAL_CAPACITY 1024
+
+/**
+ * @brief Number of ranges of users whose staged associations are linked by different tasks (see
+ *        ::user_manager_commit_associations).
+ */
+#define USER_MANAGER_ASSOCIATION_SHARDS 64
+
+/** @brief Minimum number of staged associations for them to be linked by multiple threads. */
+#define USER_MANAGER_MIN_PARALLEL_ASSOCIATIONS 100000
+
+/**
+ * @brief Creates the pools in ::user_manager::relation_nodes.
+ *
+ * @param manager Manager whose pools are going to be created.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (no pools are created).
+ */
+int __user_manager_create_relation_pools(user_manager_t *manager) {
+    for (size_t r = 0; r < USER_MANAGER_RELATION_COUNT; ++r) {
+        manager->relation_nodes[r] =
+            single_pool_id_linked_list_create_pool(USER_MANAGER_USERS_LL_NODES_INITIAL_CAPACITY);
+
+        if (!manager->relation_nodes[r]) {
+            for (size_t s = 0; s < r; ++s) {
+                single_pool_id_linked_list_free_pool(manager->relation_nodes[s]);
+                manager->relation_nodes[s] = NULL;
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Frees the pools in ::user_manager::relation_nodes.
+ * @param manager Manager whose pools are going to be freed.
+ */
+void __user_manager_free_relation_pools(user_manager_t *manager) {
+    for (size_t r = 0; r < USER_MANAGER_RELATION_COUNT; ++r) {
+        if (manager->relation_nodes[r]) {
+            single_pool_id_linked_list_free_pool(manager->relation_nodes[r]);
+            manager->relation_nodes[r] = NULL;
+        }
+    }
+}
+
+/**
+ * @brief Frees the arrays in ::user_manager::frozen_relations and
+ *        ::user_manager::frozen_passengers.
+ * @param manager Manager whose frozen associations are going to be freed.
+ */
+void __user_manager_free_frozen_relations(user_manager_t *manager) {
+    for (size_t r = 0; r < USER_MANAGER_RELATION_COUNT; ++r) {
+        free(manager->frozen_relations[r].offsets);
+        free(manager->frozen_relations[r].ids);
+        free(manager->frozen_relations[r].dates);
+        manager->frozen_relations[r] = (user_manager_frozen_relation_t) {.offsets = NULL,
+                                                                         .ids     = NULL,
+                                                                         .dates   = NULL};
+    }
+
+    free(manager->frozen_passengers.flight_ids);
+    free(manager->frozen_passengers.offsets);
+    free(manager->frozen_passengers.user_indices);
+    manager->frozen_passengers = (user_manager_frozen_passengers_t) {.flight_ids   = NULL,
+                                                                     .offsets      = NULL,
+                                                                     .user_indices = NULL,
+                                                                     .length       = 0};
+}
+
+/**
+ * @brief Frees the arrays in ::user_manager::staged_relations, discarding staged associations.
+ * @param manager Manager whose staged associations are going to be freed.
+ */
+void __user_manager_free_staged_relations(user_manager_t *manager) {
+    for (size_t r = 0; r < USER_MANAGER_RELATION_COUNT; ++r) {
+        if (manager->staged_relations[r]) {
+            g_array_unref(manager->staged_relations[r]);
+            manager->staged_relations[r] = NULL;
+        }
+    }
+}
+
+/**
+ * @brief   Checks if a user manager is frozen.
+ * @details See ::user_manager_freeze.
+ *
+ * @param manager Manager to be checked.
+ *
+ * @return Whether @p manager is frozen.
+ */
+int __user_manager_is_frozen(const user_manager_t *manager) {
+    return manager->frozen_relations[USER_MANAGER_RELATION_FLIGHTS].offsets != NULL;
+}
+
 user_manager_t *user_manager_create(void) {
     user_manager_t *const manager = malloc(sizeof(user_manager_t));
     if (!manager)
         goto DEFER_1;
 
-    manager->users = pool_create_from_size(user_sizeof(), USER_MANAGER_USERS_POOL_BLOCK_CAPACITY);
+    manager->users = pool_create_from_size_and_pages(user_sizeof(),
+                                                     USER_MANAGER_USERS_POOL_BLOCK_CAPACITY,
+                                                     POOL_PAGES_HUGE);
     if (!manager->users)
         goto DEFER_2;
 
-    manager->user_data =
-        pool_create(user_manager_user_and_data_t, USER_MANAGER_USERS_POOL_BLOCK_CAPACITY);
-    if (!manager->user_data)
+    manager->cold_users = pool_create_from_size_and_pages(user_cold_sizeof(),
+                                                          USER_MANAGER_USERS_POOL_BLOCK_CAPACITY,
+                                                          POOL_PAGES_NORMAL);
+    if (!manager->cold_users)
         goto DEFER_3;
 
-    manager->ll_nodes =
-        single_pool_id_linked_list_create_pool(USER_MANAGER_USERS_LL_NODES_BLOCK_CAPACITY);
-    if (!manager->ll_nodes)
+    if (__user_manager_create_relation_pools(manager))
         goto DEFER_4;
 
-    manager->strings = string_pool_create(USER_MANAGER_STRINGS_POOL_BLOCK_CAPACITY);
+    manager->strings =
+        string_pool_create_with_pages(USER_MANAGER_STRINGS_POOL_BLOCK_CAPACITY, POOL_PAGES_HUGE);
     if (!manager->strings)
         goto DEFER_5;
 
-    manager->id_users_rel = g_const_key_hash_table_new(g_str_hash, g_str_equal);
+    manager->id_users_rel = string_table_create(USER_MANAGER_ID_TABLE_INITIAL_CAPACITY);
+    if (!manager->id_users_rel)
+        goto DEFER_6;
+
+    for (size_t r = 0; r < USER_MANAGER_RELATION_COUNT; ++r)
+        manager->frozen_relations[r] = (user_manager_frozen_relation_t) {.offsets = NULL,
+                                                                         .ids     = NULL,
+                                                                         .dates   = NULL};
+    manager->frozen_passengers = (user_manager_frozen_passengers_t) {.flight_ids   = NULL,
+                                                                     .offsets      = NULL,
+                                                                     .user_indices = NULL,
+                                                                     .length       = 0};
+
+    for (size_t r = 0; r < USER_MANAGER_RELATION_COUNT; ++r)
+        manager->staged_relations[r] = NULL;
+
+    manager->user_data    = g_array_new(FALSE, FALSE, sizeof(user_manager_user_and_data_t));
+    manager->active_users = g_array_new(FALSE, TRUE, sizeof(uint64_t));
+    manager->id_filter    = NULL;
     return manager;
 
+DEFER_6:
+    string_pool_free(manager->strings);
 DEFER_5:
-    pool_free(manager->ll_nodes);
+    __user_manager_free_relation_pools(manager);
 DEFER_4:
-    pool_free(manager->user_data);
+    pool_free(manager->cold_users);
 DEFER_3:
     pool_free(manager->users);
 DEFER_2:
@@ -117,211 +360,1157 @@ DEFER_1:
 }
 
 /**
- * @brief Method called for every ::user_manager_user_and_data_t.
+ * @brief   Adds a user and its related data to the end of a user manager.
+ * @details Auxiliary method for ::user_manager_add_user and ::user_manager_clone.
+ *
+ * @param manager       Manager to add @p user_and_data to.
+ * @param user_and_data User (already in @p manager's pool) and its related data.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p manager is left unchanged).
+ */
+int __user_manager_append(user_manager_t                     *manager,
+                          const user_manager_user_and_data_t *user_and_data) {
+    const uint32_t index  = manager->user_data->len;
+    const int      retval = string_table_insert(manager->id_users_rel,
+                                                user_get_const_id(user_and_data->user),
+                                                index);
+    if (retval == 1) {
+        return 1;
+    } else if (retval == 2) {
+        /* Do not fatally fail (just print a warning). Show must go on. */
+        fprintf(stderr,
+                "REPEATED USER ID \"%s\". This shouldn't happen! Replacing it.\n",
+                user_get_const_id(user_and_data->user));
+    }
+
+    g_array_append_vals(manager->user_data, user_and_data, 1);
+
+    const size_t word = index / 64;
+    if (word >= manager->active_users->len)
+        g_array_set_size(manager->active_users, word + 1); /* Cleared on growth */
+    if (user_get_account_status(user_and_data->user) == ACCOUNT_STATUS_ACTIVE)
+        g_array_index(manager->active_users, uint64_t, word) |= (uint64_t) 1 << (index % 64);
+    return 0;
+}
+
+/**
+ * @brief   Copies the frozen associations of a user manager to another one.
+ * @details Auxiliary method for ::user_manager_clone.
  *
- * @param clone_data     Pointer to the clone being generated.
- * @param user_data_data Pointer to the ::user_manager_user_and_data_t being copied.
+ * @param clone   Manager with the same users as @p manager, but no associations. Will be frozen.
+ * @param manager Frozen manager to copy associations from.
  *
  * @retval 0 Success.
  * @retval 1 Allocation failure.
  */
-int __user_manager_clone_foreach_user_data(void *clone_data, const void *user_data_data) {
-    const user_manager_t *const               clone     = clone_data;
-    const user_manager_user_and_data_t *const user_data = user_data_data;
+int __user_manager_clone_frozen_relations(user_manager_t *clone, const user_manager_t *manager) {
+    const size_t n = manager->user_data->len;
+    for (size_t r = 0; r < USER_MANAGER_RELATION_COUNT; ++r) {
+        const user_manager_frozen_relation_t *const original = &manager->frozen_relations[r];
+        user_manager_frozen_relation_t *const       copy     = &clone->frozen_relations[r];
 
-    user_t *const new_user = user_clone(clone->users, clone->strings, user_data->user);
-    if (!new_user)
-        goto DEFER_1;
+        const size_t offsets_size = (n + 1) * sizeof(uint32_t);
+        const size_t ids_size     = max(original->offsets[n], 1) * sizeof(uint32_t);
+        const size_t dates_size   = max(original->offsets[n], 1) * sizeof(date_and_time_t);
 
-    single_pool_id_linked_list_t *const new_flights =
-        single_pool_id_linked_list_clone(clone->ll_nodes, user_data->flights);
-    if (user_data->flights && !new_flights)
-        goto DEFER_2;
+        copy->offsets = malloc(offsets_size);
+        copy->ids     = malloc(ids_size);
+        copy->dates   = malloc(dates_size);
+        if (!copy->offsets || !copy->ids || !copy->dates) {
+            __user_manager_free_frozen_relations(clone);
+            return 1;
+        }
 
-    single_pool_id_linked_list_t *const new_reservations =
-        single_pool_id_linked_list_clone(clone->ll_nodes, user_data->reservations);
-    if (user_data->reservations && !new_reservations)
-        goto DEFER_2;
+        memcpy(copy->offsets, original->offsets, offsets_size);
+        memcpy(copy->ids, original->ids, original->offsets[n] * sizeof(uint32_t));
+        memcpy(copy->dates, original->dates, original->offsets[n] * sizeof(date_and_time_t));
+    }
 
-    const user_manager_user_and_data_t new_data = {.user         = new_user,
-                                                   .flights      = new_flights,
-                                                   .reservations = new_reservations};
+    const user_manager_frozen_passengers_t *const original = &manager->frozen_passengers;
+    user_manager_frozen_passengers_t *const       copy     = &clone->frozen_passengers;
 
-    user_manager_user_and_data_t *const pool_user_and_data =
-        pool_put_item(user_manager_user_and_data_t, clone->user_data, &new_data);
-    if (!pool_user_and_data)
-        goto DEFER_2;
+    const size_t total = original->offsets[original->length];
+    copy->flight_ids   = malloc(max(original->length, 1) * sizeof(uint32_t));
+    copy->offsets      = malloc((original->length + 1) * sizeof(uint32_t));
+    copy->user_indices = malloc(max(total, 1) * sizeof(uint32_t));
+    if (!copy->flight_ids || !copy->offsets || !copy->user_indices) {
+        __user_manager_free_frozen_relations(clone);
+        return 1;
+    }
 
-    g_const_key_hash_table_insert(clone->id_users_rel,
-                                  user_get_const_id(new_user),
-                                  pool_user_and_data);
-    return 0;
+    copy->length = original->length;
+    memcpy(copy->flight_ids, original->flight_ids, original->length * sizeof(uint32_t));
+    memcpy(copy->offsets, original->offsets, (original->length + 1) * sizeof(uint32_t));
+    memcpy(copy->user_indices, original->user_indices, total * sizeof(uint32_t));
 
-DEFER_2:
-    user_free(new_user);
-DEFER_1:
-    return 1;
+    __user_manager_free_relation_pools(clone);
+    return 0;
 }
 
 user_manager_t *user_manager_clone(const user_manager_t *manager) {
     user_manager_t *const clone = user_manager_create();
     if (!clone)
         return NULL;
+    if (string_table_reserve(clone->id_users_rel, manager->user_data->len))
+        goto DEFER_1;
 
-    if (pool_iter(manager->user_data, __user_manager_clone_foreach_user_data, clone)) {
-        user_manager_free(clone);
-        return NULL;
+    const int frozen = __user_manager_is_frozen(manager);
+    for (size_t i = 0; i < manager->user_data->len; ++i) {
+        const user_manager_user_and_data_t *const user_data =
+            &g_array_index(manager->user_data, user_manager_user_and_data_t, i);
+
+        user_manager_user_and_data_t new_data = {
+            .user        = user_clone(clone->users,
+                                      clone->cold_users,
+                                      clone->strings,
+                                      user_data->user),
+            .total_spent_cents = user_data->total_spent_cents};
+        if (!new_data.user)
+            goto DEFER_1;
+
+        /* Nodes keep their indices in the cloned pools, so lists can be copied as they are */
+        for (size_t r = 0; !frozen && r < USER_MANAGER_RELATION_COUNT; ++r)
+            new_data.relations[r] = user_data->relations[r];
+
+        if (__user_manager_append(clone, &new_data))
+            goto DEFER_1;
+    }
+
+    if (frozen) {
+        if (__user_manager_clone_frozen_relations(clone, manager))
+            goto DEFER_1;
+    } else {
+        for (size_t r = 0; r < USER_MANAGER_RELATION_COUNT; ++r) {
+            single_pool_id_linked_list_pool_t *const nodes =
+                single_pool_id_linked_list_clone_pool(manager->relation_nodes[r]);
+            if (!nodes)
+                goto DEFER_1;
+
+            single_pool_id_linked_list_free_pool(clone->relation_nodes[r]);
+            clone->relation_nodes[r] = nodes;
+
+            const GArray *const staged = manager->staged_relations[r];
+            if (staged) {
+                clone->staged_relations[r] =
+                    g_array_sized_new(FALSE, FALSE, sizeof(user_manager_staged_association_t),
+                                      staged->len);
+                g_array_append_vals(clone->staged_relations[r], staged->data, staged->len);
+            }
+        }
     }
     return clone;
+
+DEFER_1:
+    user_manager_free(clone);
+    return NULL;
 }
 
-int user_manager_add_user(user_manager_t *manager, const user_t *user) {
-    const user_t *const pool_user = user_clone(manager->users, manager->strings, user);
+/**
+ * @brief   Converts the frozen associations of a user manager back into linked lists.
+ * @details Auxiliary method for methods that modify a user manager. Nothing is done if @p manager
+ *          isn't frozen.
+ *
+ * @param manager Manager to be thawed.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p manager is left frozen).
+ */
+int __user_manager_thaw(user_manager_t *manager) {
+    if (!__user_manager_is_frozen(manager))
+        return 0;
+
+    if (__user_manager_create_relation_pools(manager))
+        return 1;
+
+    for (size_t i = 0; i < manager->user_data->len; ++i) {
+        user_manager_user_and_data_t *const data =
+            &g_array_index(manager->user_data, user_manager_user_and_data_t, i);
+
+        for (size_t r = 0; r < USER_MANAGER_RELATION_COUNT; ++r) {
+            const user_manager_frozen_relation_t *const frozen = &manager->frozen_relations[r];
+
+            /* Prepend in reverse order, so that the lists keep the order of the arrays */
+            single_pool_id_linked_list_t list = single_pool_id_linked_list_create();
+            for (uint32_t j = frozen->offsets[i + 1]; j > frozen->offsets[i]; --j) {
+                if (single_pool_id_linked_list_append_beginning(manager->relation_nodes[r],
+                                                                &list,
+                                                                frozen->ids[j - 1]))
+                    goto DEFER_1;
+            }
+            data->relations[r] = list;
+        }
+    }
+
+    __user_manager_free_frozen_relations(manager);
+    return 0;
+
+DEFER_1:
+    for (size_t i = 0; i < manager->user_data->len; ++i) {
+        user_manager_user_and_data_t *const data =
+            &g_array_index(manager->user_data, user_manager_user_and_data_t, i);
+        for (size_t r = 0; r < USER_MANAGER_RELATION_COUNT; ++r)
+            data->relations[r] = single_pool_id_linked_list_create();
+    }
+    __user_manager_free_relation_pools(manager);
+    return 1;
+}
+
+/**
+ * @brief   Adds a user to the pool of a user manager, and appends it to the manager's users.
+ * @details Auxiliary method for ::user_manager_add_user and ::user_manager_add_users, that must
+ *          thaw @p manager and discard its identifier indexes beforehand.
+ *
+ * @param manager User manager to add @p user to.
+ * @param user    User to be added to @p manager.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __user_manager_add_user_thawed(user_manager_t *manager, const user_t *user) {
+    const user_t *const pool_user =
+        user_clone(manager->users, manager->cold_users, manager->strings, user);
     if (!pool_user)
         return 1;
 
     const user_manager_user_and_data_t user_and_data = {
-        .user         = pool_user,
-        .flights      = single_pool_id_linked_list_create(),
-        .reservations = single_pool_id_linked_list_create(),
-    };
-
-    user_manager_user_and_data_t *const pool_user_and_data =
-        pool_put_item(user_manager_user_and_data_t, manager->user_data, &user_and_data);
-    if (!pool_user_and_data)
+        .user        = pool_user,
+        .relations   = {single_pool_id_linked_list_create(), single_pool_id_linked_list_create()},
+        .total_spent_cents = 0};
+    return __user_manager_append(manager, &user_and_data);
+}
+
+/**
+ * @brief   Discards the identifier filter of a user manager.
+ * @details Auxiliary method for methods that add users.
+ *
+ * @param manager User manager whose filter is to be discarded.
+ */
+void __user_manager_free_id_filter(user_manager_t *manager) {
+    bloom_filter_free(manager->id_filter);
+    manager->id_filter = NULL;
+}
+
+int user_manager_add_user(user_manager_t *manager, const user_t *user) {
+    if (__user_manager_thaw(manager))
         return 1;
 
-    if (!g_const_key_hash_table_insert(manager->id_users_rel,
-                                       user_get_const_id(pool_user),
-                                       pool_user_and_data)) {
+    __user_manager_free_id_filter(manager);
+    performance_probe2(manager_insert, PERFORMANCE_ACCESS_MANAGER_USERS, 1);
+    return __user_manager_add_user_thawed(manager, user);
+}
 
-        /* Do not fatally fail (just print a warning). Show must go on. */
-        fprintf(stderr,
-                "REPEATED USER ID \"%s\". This shouldn't happen! Replacing it.\n",
-                user_get_const_id(user));
-    }
+int user_manager_add_users(user_manager_t *manager, const user_t *const *users, size_t n) {
+    if (__user_manager_thaw(manager) || user_manager_reserve(manager, manager->user_data->len + n))
+        return 1;
 
+    __user_manager_free_id_filter(manager);
+    performance_probe2(manager_insert, PERFORMANCE_ACCESS_MANAGER_USERS, n);
+    for (size_t i = 0; i < n; ++i)
+        if (__user_manager_add_user_thawed(manager, users[i]))
+            return 1;
     return 0;
 }
 
+/**
+ * @brief Adds an association between a user and another entity to a user manager.
+ *
+ * @param manager    User manager to add the association to.
+ * @param relation   Type of the association.
+ * @param user_index Index of the user to add @p id to.
+ * @param id         Identifier of the entity to be associated with @p user_index.
+ *
+ * @retval 0 Success.
+ * @retval 1 User not found or allocation failure.
+ */
+int __user_manager_add_association(user_manager_t         *manager,
+                                   user_manager_relation_t relation,
+                                   uint32_t                user_index,
+                                   uint32_t                id) {
+
+    if (user_index >= manager->user_data->len || __user_manager_thaw(manager))
+        return 1;
+
+    GArray *const staged = manager->staged_relations[relation];
+    if (staged) {
+        const user_manager_staged_association_t association = {.user_index = user_index,
+                                                               .id         = id};
+        g_array_append_val(staged, association);
+        return 0;
+    }
+
+    user_manager_user_and_data_t *const data =
+        &g_array_index(manager->user_data, user_manager_user_and_data_t, user_index);
+
+    return single_pool_id_linked_list_append_beginning(manager->relation_nodes[relation],
+                                                       &data->relations[relation],
+                                                       id);
+}
+
+int user_manager_reserve(user_manager_t *manager, size_t count) {
+    return string_table_reserve(manager->id_users_rel, count) ||
+           pool_reserve(manager->users, count) || pool_reserve(manager->cold_users, count);
+}
+
+int user_manager_borrow_strings(user_manager_t *manager, mapped_file_t *file) {
+    return string_pool_borrow(manager->strings, file);
+}
+
 int user_manager_add_user_flight_association(user_manager_t *manager,
-                                             const char     *user_id,
+                                             uint32_t        user_index,
                                              flight_id_t     flight_id) {
 
-    user_manager_user_and_data_t *const data =
-        g_const_key_hash_table_lookup(manager->id_users_rel, user_id);
-    if (!data)
+    return __user_manager_add_association(manager,
+                                          USER_MANAGER_RELATION_FLIGHTS,
+                                          user_index,
+                                          flight_id);
+}
+
+int user_manager_add_user_reservation_association(user_manager_t  *manager,
+                                                  uint32_t         user_index,
+                                                  reservation_id_t reservation_id) {
+
+    return __user_manager_add_association(manager,
+                                          USER_MANAGER_RELATION_RESERVATIONS,
+                                          user_index,
+                                          reservation_id);
+}
+
+int user_manager_reserve_flight_associations(user_manager_t *manager, size_t count) {
+    /* Relation pools don't exist while frozen, and will be created when thawing */
+    single_pool_id_linked_list_pool_t *const pool =
+        manager->relation_nodes[USER_MANAGER_RELATION_FLIGHTS];
+    return pool && single_pool_id_linked_list_reserve(pool, count);
+}
+
+int user_manager_reserve_reservation_associations(user_manager_t *manager, size_t count) {
+    /* Relation pools don't exist while frozen, and will be created when thawing */
+    single_pool_id_linked_list_pool_t *const pool =
+        manager->relation_nodes[USER_MANAGER_RELATION_RESERVATIONS];
+    return pool && single_pool_id_linked_list_reserve(pool, count);
+}
+
+int user_manager_shrink_id_table(user_manager_t *manager) {
+    return string_table_shrink_to_fit(manager->id_users_rel);
+}
+
+int user_manager_stage_associations(user_manager_t *manager) {
+    if (__user_manager_thaw(manager))
         return 1;
 
-    single_pool_id_linked_list_t *const tmp =
-        single_pool_id_linked_list_append_beginning(manager->ll_nodes, data->flights, flight_id);
-    if (!tmp)
+    for (size_t r = 0; r < USER_MANAGER_RELATION_COUNT; ++r)
+        if (!manager->staged_relations[r])
+            manager->staged_relations[r] =
+                g_array_new(FALSE, FALSE, sizeof(user_manager_staged_association_t));
+    return 0;
+}
+
+/**
+ * @struct user_manager_commit_data_t
+ * @brief  Data shared by the tasks that link the staged associations of a relation.
+ *
+ * @var user_manager_commit_data_t::manager
+ *     @brief Manager whose associations are being linked.
+ * @var user_manager_commit_data_t::relation
+ *     @brief Type of the associations being linked.
+ * @var user_manager_commit_data_t::staged
+ *     @brief Staged associations, in the order they were added.
+ * @var user_manager_commit_data_t::order
+ *     @brief Positions in ::user_manager_commit_data_t::staged, grouped by shard, and in ascending
+ *            order in each shard.
+ * @var user_manager_commit_data_t::shard_offsets
+ *     @brief The positions of shard `s` are in the range `[shard_offsets[s], shard_offsets[s + 1])`
+ *            of ::user_manager_commit_data_t::order.
+ * @var user_manager_commit_data_t::first_node
+ *     @brief Node allocated for the first staged association. The others follow it.
+ */
+typedef struct {
+    user_manager_t                          *manager;
+    user_manager_relation_t                  relation;
+    const user_manager_staged_association_t *staged;
+    const uint32_t                          *order;
+    const size_t                            *shard_offsets;
+    single_pool_id_linked_list_t             first_node;
+} user_manager_commit_data_t;
+
+/**
+ * @brief Gets the shard of a user, when committing staged associations.
+ *
+ * @param user_index Index of the user.
+ * @param nusers     Number of users in the manager.
+ *
+ * @return The shard of the user (less than ::USER_MANAGER_ASSOCIATION_SHARDS).
+ */
+size_t __user_manager_get_shard(uint32_t user_index, size_t nusers) {
+    return (uint64_t) user_index * USER_MANAGER_ASSOCIATION_SHARDS / nusers;
+}
+
+/**
+ * @brief   Links the staged associations of some shards to the lists of their users.
+ * @details Callback for ::thread_pool_parallel_for. Each shard only modifies the lists of its own
+ *          users, and each association is stored in its own preallocated node, so shards can be
+ *          linked concurrently.
+ *
+ * @param commit_data A pointer to a ::user_manager_commit_data_t.
+ * @param start       First shard to be linked.
+ * @param end         Shard after the last one to be linked.
+ */
+void __user_manager_commit_shards(void *commit_data, size_t start, size_t end) {
+    const user_manager_commit_data_t *const data = commit_data;
+
+    for (size_t i = data->shard_offsets[start]; i < data->shard_offsets[end]; ++i) {
+        const uint32_t                                 k = data->order[i];
+        const user_manager_staged_association_t *const association = &data->staged[k];
+
+        user_manager_user_and_data_t *const user = &g_array_index(data->manager->user_data,
+                                                                  user_manager_user_and_data_t,
+                                                                  association->user_index);
+        single_pool_id_linked_list_append_beginning_in_node(
+            data->manager->relation_nodes[data->relation],
+            &user->relations[data->relation],
+            data->first_node + k,
+            association->id);
+    }
+}
+
+/**
+ * @brief   Links the staged associations of a relation to the lists of their users.
+ * @details The `k`-th staged association is stored in the `k`-th allocated node, and the
+ *          associations of each user are linked in the order they were staged, so the result is
+ *          the same as if they had been added one by one.
+ *
+ * @param manager  Manager whose staged associations are linked. Must not be frozen.
+ * @param relation Type of the associations to be linked.
+ *
+ * @retval 0 Success (the staged associations are discarded).
+ * @retval 1 Allocation failure (nothing is modified).
+ */
+int __user_manager_commit_relation(user_manager_t *manager, user_manager_relation_t relation) {
+    const GArray *const staged = manager->staged_relations[relation];
+    const size_t        n      = staged->len;
+    const size_t        nusers = manager->user_data->len;
+    if (n == 0)
+        return 0;
+
+    uint32_t *const order = malloc(n * sizeof(uint32_t));
+    if (!order)
+        return 1;
+
+    user_manager_commit_data_t data = {
+        .manager  = manager,
+        .relation = relation,
+        .staged   = (const user_manager_staged_association_t *) staged->data,
+        .order    = order};
+    if (single_pool_id_linked_list_allocate_nodes(manager->relation_nodes[relation],
+                                                  n,
+                                                  &data.first_node)) {
+        free(order);
         return 1;
+    }
+
+    /* Stable counting sort of the staged associations by shard */
+    size_t shard_offsets[USER_MANAGER_ASSOCIATION_SHARDS + 1] = {0};
+    for (size_t k = 0; k < n; ++k)
+        shard_offsets[__user_manager_get_shard(data.staged[k].user_index, nusers) + 1]++;
+    for (size_t s = 0; s < USER_MANAGER_ASSOCIATION_SHARDS; ++s)
+        shard_offsets[s + 1] += shard_offsets[s];
 
-    data->flights = tmp;
+    size_t positions[USER_MANAGER_ASSOCIATION_SHARDS];
+    memcpy(positions, shard_offsets, sizeof(positions));
+    for (size_t k = 0; k < n; ++k)
+        order[positions[__user_manager_get_shard(data.staged[k].user_index, nusers)]++] = k;
+
+    data.shard_offsets = shard_offsets;
+    thread_pool_t *const pool =
+        n >= USER_MANAGER_MIN_PARALLEL_ASSOCIATIONS ? thread_pool_get_shared() : NULL;
+    thread_pool_parallel_for(pool,
+                             USER_MANAGER_ASSOCIATION_SHARDS,
+                             1,
+                             __user_manager_commit_shards,
+                             &data);
+
+    free(order);
+    g_array_set_size(manager->staged_relations[relation], 0);
     return 0;
 }
 
-int user_manager_add_user_reservation_association(user_manager_t  *manager,
-                                                  const char      *user_id,
-                                                  reservation_id_t reservation_id) {
+int user_manager_commit_associations(user_manager_t *manager) {
+    for (size_t r = 0; r < USER_MANAGER_RELATION_COUNT; ++r) {
+        if (manager->staged_relations[r] && __user_manager_commit_relation(manager, r))
+            return 1;
+    }
 
-    user_manager_user_and_data_t *const data =
-        g_const_key_hash_table_lookup(manager->id_users_rel, user_id);
-    if (!data)
+    __user_manager_free_staged_relations(manager);
+    return 0;
+}
+
+/**
+ * @brief   Converts the associations of a relation into contiguous arrays, sorted by date.
+ * @details Auxiliary method for ::user_manager_freeze. Both associations in linked lists and staged
+ *          ones (see ::user_manager_stage_associations) are read, so that staged associations
+ *          don't need to be linked first. Neither are modified.
+ *
+ * @param manager       Manager whose associations are frozen.
+ * @param relation      Type of the associations to be frozen.
+ * @param date_callback Method that gets the date of an associated entity.
+ * @param user_data     Argument passed to @p date_callback.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure or too many associations. The arrays allocated so far are left in
+ *           ::user_manager::frozen_relations, to be freed by the caller.
+ */
+int __user_manager_freeze_relation(user_manager_t              *manager,
+                                   user_manager_relation_t      relation,
+                                   user_manager_date_callback_t date_callback,
+                                   void                        *user_data) {
+
+    user_manager_frozen_relation_t *const          frozen = &manager->frozen_relations[relation];
+    const single_pool_id_linked_list_pool_t *const nodes  = manager->relation_nodes[relation];
+    const GArray *const                            staged = manager->staged_relations[relation];
+    const size_t                                   n      = manager->user_data->len;
+
+    const size_t                                   nstaged = staged ? staged->len : 0;
+    const user_manager_staged_association_t *const staged_data =
+        staged ? (const user_manager_staged_association_t *) staged->data : NULL;
+
+    frozen->offsets = calloc(n + 1, sizeof(uint32_t));
+    if (!frozen->offsets)
+        return 1;
+
+    /* Count associations per user, then turn counts into offsets */
+    for (size_t k = 0; k < nstaged; ++k)
+        frozen->offsets[staged_data[k].user_index + 1]++;
+
+    size_t total = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const user_manager_user_and_data_t *const data =
+            &g_array_index(manager->user_data, user_manager_user_and_data_t, i);
+
+        total += frozen->offsets[i + 1] +
+                 single_pool_id_linked_list_length(nodes, data->relations[relation]);
+        if (total > UINT32_MAX)
+            return 1;
+        frozen->offsets[i + 1] = total;
+    }
+
+    frozen->ids   = malloc(max(total, 1) * sizeof(uint32_t));
+    frozen->dates = malloc(max(total, 1) * sizeof(date_and_time_t));
+    radix_sort_entry_t *const entries = malloc(max(total, 1) * sizeof(radix_sort_entry_t));
+    uint32_t *const           cursors = malloc(max(n, 1) * sizeof(uint32_t));
+    if (!frozen->ids || !frozen->dates || !entries || !cursors)
+        goto DEFER_1;
+
+    /* Scatter the associations of each user to its range, whether they're linked or staged */
+    memcpy(cursors, frozen->offsets, n * sizeof(uint32_t));
+    for (size_t i = 0; i < n; ++i) {
+        const user_manager_user_and_data_t *const data =
+            &g_array_index(manager->user_data, user_manager_user_and_data_t, i);
+
+        for (single_pool_id_linked_list_t iter = data->relations[relation]; iter;
+             iter = single_pool_id_linked_list_get_next(nodes, iter))
+            frozen->ids[cursors[i]++] = single_pool_id_linked_list_get_value(nodes, iter);
+    }
+
+    for (size_t k = 0; k < nstaged; ++k)
+        frozen->ids[cursors[staged_data[k].user_index]++] = staged_data[k].id;
+
+    /* Look up all dates at once, so that the lookups of the entities can overlap */
+    date_callback(user_data, total, frozen->ids, frozen->dates);
+    for (size_t k = 0; k < total; ++k)
+        entries[k] = (radix_sort_entry_t) {.key      = radix_sort_descending(frozen->dates[k]),
+                                           .tiebreak = frozen->ids[k],
+                                           .value    = NULL};
+
+    /*
+     * Sort each user's entities from the most recent to the oldest (breaking ties by ascending
+     * identifier), then split them into identifiers and dates
+     */
+    for (size_t i = 0; i < n; ++i)
+        if (radix_sort(entries + frozen->offsets[i], frozen->offsets[i + 1] - frozen->offsets[i]))
+            goto DEFER_1;
+
+    for (size_t i = 0; i < total; ++i) {
+        frozen->ids[i]   = entries[i].tiebreak;
+        frozen->dates[i] = radix_sort_descending(entries[i].key);
+    }
+
+    free(cursors);
+    free(entries);
+    return 0;
+
+DEFER_1:
+    free(cursors);
+    free(entries);
+    return 1;
+}
+
+/**
+ * @brief   Groups the frozen flight associations of a user manager by flight.
+ * @details Auxiliary method for ::user_manager_freeze, that fills ::user_manager::frozen_passengers
+ *          from the frozen ::USER_MANAGER_RELATION_FLIGHTS relation.
+ *
+ * @param manager Manager whose flight associations have already been frozen.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure. The arrays allocated so far are left in
+ *           ::user_manager::frozen_passengers, to be freed by the caller.
+ */
+int __user_manager_freeze_passengers(user_manager_t *manager) {
+    const user_manager_frozen_relation_t *const flights =
+        &manager->frozen_relations[USER_MANAGER_RELATION_FLIGHTS];
+    user_manager_frozen_passengers_t *const passengers = &manager->frozen_passengers;
+
+    const size_t n     = manager->user_data->len;
+    const size_t total = flights->offsets[n];
+
+    radix_sort_entry_t *const entries = malloc(max(total, 1) * sizeof(radix_sort_entry_t));
+    if (!entries)
+        return 1;
+
+    for (size_t i = 0; i < n; ++i)
+        for (uint32_t j = flights->offsets[i]; j < flights->offsets[i + 1]; ++j)
+            entries[j] =
+                (radix_sort_entry_t) {.key = flights->ids[j], .tiebreak = i, .value = NULL};
+
+    if (radix_sort(entries, total))
+        goto DEFER_1;
+
+    size_t nflights = 0;
+    for (size_t j = 0; j < total; ++j)
+        nflights += j == 0 || entries[j].key != entries[j - 1].key;
+
+    passengers->flight_ids   = malloc(max(nflights, 1) * sizeof(uint32_t));
+    passengers->offsets      = malloc((nflights + 1) * sizeof(uint32_t));
+    passengers->user_indices = malloc(max(total, 1) * sizeof(uint32_t));
+    if (!passengers->flight_ids || !passengers->offsets || !passengers->user_indices)
+        goto DEFER_1;
+
+    size_t f = 0;
+    for (size_t j = 0; j < total; ++j) {
+        if (j == 0 || entries[j].key != entries[j - 1].key) {
+            passengers->flight_ids[f] = entries[j].key;
+            passengers->offsets[f]    = j;
+            f++;
+        }
+        passengers->user_indices[j] = entries[j].tiebreak;
+    }
+    passengers->offsets[nflights] = total;
+    passengers->length            = nflights;
+
+    free(entries);
+    return 0;
+
+DEFER_1:
+    free(entries);
+    return 1;
+}
+
+int user_manager_freeze(user_manager_t               *manager,
+                        user_manager_date_callback_t  flight_date,
+                        user_manager_date_callback_t  reservation_date,
+                        user_manager_price_callback_t reservation_price,
+                        void                         *user_data) {
+    if (__user_manager_is_frozen(manager))
+        return 0;
+
+    const user_manager_date_callback_t date_callbacks[USER_MANAGER_RELATION_COUNT] = {
+        flight_date,
+        reservation_date};
+
+    for (size_t r = 0; r < USER_MANAGER_RELATION_COUNT; ++r)
+        if (__user_manager_freeze_relation(manager, r, date_callbacks[r], user_data))
+            goto DEFER_1;
+    if (__user_manager_freeze_passengers(manager))
+        goto DEFER_1;
+
+    /* Compute aggregates once, instead of on every query. The linked lists are no longer needed. */
+    const user_manager_frozen_relation_t *const reservations =
+        &manager->frozen_relations[USER_MANAGER_RELATION_RESERVATIONS];
+    const size_t    n      = manager->user_data->len;
+    uint64_t *const prices = malloc(max(reservations->offsets[n], 1) * sizeof(uint64_t));
+    if (!prices)
+        goto DEFER_1;
+
+    reservation_price(user_data, reservations->offsets[n], reservations->ids, prices);
+    for (size_t i = 0; i < n; ++i) {
+        user_manager_user_and_data_t *const data =
+            &g_array_index(manager->user_data, user_manager_user_and_data_t, i);
+
+        /* Integer sums are exact, whatever the order of reservations */
+        data->total_spent_cents = 0;
+        for (uint32_t j = reservations->offsets[i]; j < reservations->offsets[i + 1]; ++j)
+            data->total_spent_cents += prices[j];
+
+        for (size_t r = 0; r < USER_MANAGER_RELATION_COUNT; ++r)
+            data->relations[r] = single_pool_id_linked_list_create();
+    }
+    free(prices);
+    __user_manager_free_relation_pools(manager);
+    __user_manager_free_staged_relations(manager);
+    return 0;
+
+DEFER_1:
+    __user_manager_free_frozen_relations(manager);
+    return 1;
+}
+
+int user_manager_get_index_by_id(const user_manager_t *manager, const char *id, uint32_t *index) {
+    performance_access_count_probe(PERFORMANCE_ACCESS_MANAGER_USERS);
+    return string_table_lookup(manager->id_users_rel, id, index);
+}
+
+int user_manager_build_id_filter(user_manager_t *manager) {
+    if (manager->id_filter)
+        return 0;
+
+    manager->id_filter = bloom_filter_create(manager->user_data->len);
+    if (!manager->id_filter)
+        return 1;
+
+    for (size_t i = 0; i < manager->user_data->len; ++i) {
+        const user_t *const user =
+            g_array_index(manager->user_data, user_manager_user_and_data_t, i).user;
+        bloom_filter_add(manager->id_filter, bloom_filter_hash_string(user_get_const_id(user)));
+    }
+    return 0;
+}
+
+int user_manager_get_index_by_id_filtered(const user_manager_t *manager,
+                                          const char           *id,
+                                          uint32_t             *index) {
+    if (manager->id_filter &&
+        !bloom_filter_may_contain(manager->id_filter, bloom_filter_hash_string(id)))
         return 1;
 
-    single_pool_id_linked_list_t *const tmp =
-        single_pool_id_linked_list_append_beginning(manager->ll_nodes,
-                                                    data->reservations,
-                                                    reservation_id);
-    if (!tmp)
+    const int retval = user_manager_get_index_by_id(manager, id, index);
+    if (retval && manager->id_filter)
+        bloom_filter_count_false_positive(manager->id_filter);
+    return retval;
+}
+
+int user_manager_get_id_filter_statistics(const user_manager_t      *manager,
+                                          bloom_filter_statistics_t *statistics) {
+    if (!manager->id_filter)
         return 1;
 
-    data->reservations = tmp;
+    bloom_filter_get_statistics(manager->id_filter, statistics);
     return 0;
 }
 
 const user_t *user_manager_get_by_id(const user_manager_t *manager, const char *id) {
-    const user_manager_user_and_data_t *const data =
-        g_const_key_hash_table_lookup(manager->id_users_rel, id);
-    if (!data)
+    uint32_t index;
+    if (user_manager_get_index_by_id(manager, id, &index))
         return NULL;
-    return data->user;
+    return user_manager_get_by_index(manager, index);
 }
 
-const single_pool_id_linked_list_t *user_manager_get_flights_by_id(const user_manager_t *manager,
-                                                                   const char           *id) {
-
-    const user_manager_user_and_data_t *const data =
-        g_const_key_hash_table_lookup(manager->id_users_rel, id);
-    if (!data)
+const user_t *user_manager_get_by_index(const user_manager_t *manager, uint32_t index) {
+    if (index >= manager->user_data->len)
         return NULL;
-    return data->flights;
+    return g_array_index(manager->user_data, user_manager_user_and_data_t, index).user;
+}
+
+int user_manager_is_active_by_index(const user_manager_t *manager, uint32_t index) {
+    if (index >= manager->user_data->len)
+        return 0;
+    return (g_array_index(manager->active_users, uint64_t, index / 64) >> (index % 64)) & 1;
 }
 
-const single_pool_id_linked_list_t *
-    user_manager_get_reservations_by_id(const user_manager_t *manager, const char *id) {
+size_t user_manager_get_active_count(const user_manager_t *manager) {
+    size_t count = 0;
+    for (size_t i = 0; i < manager->active_users->len; ++i)
+        count += __builtin_popcountll(g_array_index(manager->active_users, uint64_t, i));
+    return count;
+}
 
-    const user_manager_user_and_data_t *const data =
-        g_const_key_hash_table_lookup(manager->id_users_rel, id);
-    if (!data)
-        return NULL;
-    return data->reservations;
+/**
+ * @brief Gets the identifiers associated to a user in a frozen user manager.
+ *
+ * @param manager  Manager where to perform the lookup.
+ * @param relation Type of the associations.
+ * @param index    Index of the user.
+ *
+ * @return The associations of the user, or an empty span if @p manager isn't frozen or @p index is
+ *         out of range.
+ */
+user_manager_id_span_t __user_manager_get_span(const user_manager_t   *manager,
+                                               user_manager_relation_t relation,
+                                               size_t                  index) {
+
+    const user_manager_frozen_relation_t *const frozen = &manager->frozen_relations[relation];
+    if (!frozen->offsets || index >= manager->user_data->len)
+        return (user_manager_id_span_t) {.ids = NULL, .dates = NULL, .length = 0};
+
+    const uint32_t begin = frozen->offsets[index];
+    return (user_manager_id_span_t) {.ids    = frozen->ids + begin,
+                                     .dates  = frozen->dates + begin,
+                                     .length = frozen->offsets[index + 1] - begin};
+}
+
+user_manager_id_span_t user_manager_get_flights_by_index(const user_manager_t *manager,
+                                                         uint32_t              index) {
+    return __user_manager_get_span(manager, USER_MANAGER_RELATION_FLIGHTS, index);
+}
+
+user_manager_id_span_t user_manager_get_reservations_by_index(const user_manager_t *manager,
+                                                              uint32_t              index) {
+    return __user_manager_get_span(manager, USER_MANAGER_RELATION_RESERVATIONS, index);
+}
+
+user_manager_index_span_t user_manager_get_passengers_by_flight(const user_manager_t *manager,
+                                                                flight_id_t           id) {
+    const user_manager_frozen_passengers_t *const passengers = &manager->frozen_passengers;
+
+    size_t low = 0, high = passengers->length;
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (passengers->flight_ids[middle] < id)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    if (low == passengers->length || passengers->flight_ids[low] != id)
+        return (user_manager_index_span_t) {.indices = NULL, .length = 0};
+
+    const uint32_t begin = passengers->offsets[low];
+    return (user_manager_index_span_t) {.indices = passengers->user_indices + begin,
+                                        .length  = passengers->offsets[low + 1] - begin};
+}
+
+user_manager_user_aggregates_t user_manager_get_aggregates_by_index(const user_manager_t *manager,
+                                                                    uint32_t              index) {
+    if (!__user_manager_is_frozen(manager) || index >= manager->user_data->len)
+        return (user_manager_user_aggregates_t) {0};
+
+    const user_manager_frozen_relation_t *const flights =
+        &manager->frozen_relations[USER_MANAGER_RELATION_FLIGHTS];
+    const user_manager_frozen_relation_t *const reservations =
+        &manager->frozen_relations[USER_MANAGER_RELATION_RESERVATIONS];
+
+    return (user_manager_user_aggregates_t) {
+        .number_of_flights      = flights->offsets[index + 1] - flights->offsets[index],
+        .number_of_reservations = reservations->offsets[index + 1] - reservations->offsets[index],
+        .total_spent_cents =
+            g_array_index(manager->user_data, user_manager_user_and_data_t, index)
+                .total_spent_cents};
 }
 
 int user_manager_iter(const user_manager_t        *manager,
                       user_manager_iter_callback_t callback,
                       void                        *user_data) {
 
-    return pool_iter(manager->users, (pool_iter_callback_t) callback, user_data);
+    mapped_file_t *const borrowed = string_pool_get_borrowed(manager->strings);
+    mapped_file_begin_scan(borrowed);
+    performance_access_count_scan(PERFORMANCE_ACCESS_MANAGER_USERS, manager->user_data->len);
+    performance_trace_begin("Scan users");
+    const int retval = pool_iter(manager->users, (pool_iter_callback_t) callback, user_data);
+    performance_trace_end();
+    mapped_file_end_scan(borrowed);
+    return retval;
+}
+
+int user_manager_iter_active(const user_manager_t        *manager,
+                             user_manager_iter_callback_t callback,
+                             void                        *user_data) {
+
+    performance_trace_begin("Scan active users");
+
+    int retval = 0;
+    for (size_t w = 0; w < manager->active_users->len && !retval; ++w) {
+        performance_access_count_scan(
+            PERFORMANCE_ACCESS_MANAGER_USERS,
+            (size_t) __builtin_popcountll(g_array_index(manager->active_users, uint64_t, w)));
+        for (uint64_t word = g_array_index(manager->active_users, uint64_t, w); word;
+             word &= word - 1) {
+            const size_t                              index = w * 64 + __builtin_ctzll(word);
+            const user_manager_user_and_data_t *const data =
+                &g_array_index(manager->user_data, user_manager_user_and_data_t, index);
+
+            retval = callback(user_data, data->user);
+            if (retval)
+                break;
+        }
+    }
+
+    performance_trace_end();
+    return retval;
+}
+
+int user_manager_iter_with_flights(const user_manager_t                     *manager,
+                                   user_manager_iter_with_flights_callback_t callback,
+                                   void                                     *user_data) {
+
+    performance_access_count_scan(PERFORMANCE_ACCESS_MANAGER_USERS, manager->user_data->len);
+    performance_trace_begin("Scan users with flights");
+
+    int retval = 0;
+    for (size_t i = 0; i < manager->user_data->len; ++i) {
+        const user_manager_user_and_data_t *const data =
+            &g_array_index(manager->user_data, user_manager_user_and_data_t, i);
+
+        retval = callback(user_data,
+                          data->user,
+                          __user_manager_get_span(manager, USER_MANAGER_RELATION_FLIGHTS, i));
+        if (retval)
+            break;
+    }
+
+    performance_trace_end();
+    return retval;
 }
 
 /**
- * @struct user_manager_iter_with_flights_data_t
- * @brief Auxiliary data for ::__user_manager_iter_with_flights_callback.
+ * @struct user_manager_parallel_iter_data_t
+ * @brief  Internal data type for the `user_data` parameter of the callbacks of
+ *         ::user_manager_parallel_iter and ::user_manager_parallel_iter_with_flights.
  *
- * @var user_manager_iter_with_flights_data_t::user_data
- *     @brief Original user data provided to ::user_manager_iter_with_flights.
- * @var user_manager_iter_with_flights_data_t::original_callback
- *     @brief Original callback provided to ::user_manager_iter_with_flights.
+ * @var user_manager_parallel_iter_data_t::manager
+ *     @brief User manager being iterated through.
+ * @var user_manager_parallel_iter_data_t::init
+ *     @brief Method called to create the accumulator of each range.
+ * @var user_manager_parallel_iter_data_t::callback
+ *     @brief Method called for every user (`NULL` when iterating with flights).
+ * @var user_manager_parallel_iter_data_t::callback_with_flights
+ *     @brief Method called for every user and their flights (`NULL` when iterating without
+ *            flights).
+ * @var user_manager_parallel_iter_data_t::merge
+ *     @brief Method called for every accumulator.
+ * @var user_manager_parallel_iter_data_t::original_user_data
+ *     @brief `user_data` parameter for ::user_manager_parallel_iter_data_t::init and
+ *            ::user_manager_parallel_iter_data_t::merge.
+ * @var user_manager_parallel_iter_data_t::retval
+ *     @brief Return value of the first callback that stopped the iteration, or `0`.
  */
 typedef struct {
-    void *const                                     user_data;
-    const user_manager_iter_with_flights_callback_t original_callback;
-} user_manager_iter_with_flights_data_t;
+    const user_manager_t                     *manager;
+    thread_pool_reduce_init_callback_t        init;
+    user_manager_iter_callback_t              callback;
+    user_manager_iter_with_flights_callback_t callback_with_flights;
+    thread_pool_reduce_merge_callback_t       merge;
+    void                                     *original_user_data;
+    int                                       retval;
+} user_manager_parallel_iter_data_t;
+
+/**
+ * @brief Creates the accumulator of a range of users in a parallel iteration.
+ * @param user_data A pointer to a ::user_manager_parallel_iter_data_t.
+ * @return The accumulator created by the target callback.
+ */
+void *__user_manager_parallel_iter_init(void *user_data) {
+    const user_manager_parallel_iter_data_t *const iter_data = user_data;
+    return iter_data->init(iter_data->original_user_data);
+}
+
+/**
+ * @brief Calls the target callback of a parallel iteration for a range of users.
+ *
+ * @param user_data   A pointer to a ::user_manager_parallel_iter_data_t.
+ * @param accumulator Accumulator of the range.
+ * @param start       Index of the first user in the range.
+ * @param end         Index after the last user in the range.
+ */
+void __user_manager_parallel_iter_range(void  *user_data,
+                                        void  *accumulator,
+                                        size_t start,
+                                        size_t end) {
+    user_manager_parallel_iter_data_t *const iter_data = user_data;
+    const user_manager_t *const              manager   = iter_data->manager;
+
+    performance_trace_begin("Scan users (parallel range)");
+    for (size_t i = start; i < end; ++i) {
+        if (__atomic_load_n(&iter_data->retval, __ATOMIC_RELAXED))
+            break;
+
+        const user_t *const user =
+            g_array_index(manager->user_data, user_manager_user_and_data_t, i).user;
+        const int retval =
+            iter_data->callback
+                ? iter_data->callback(accumulator, user)
+                : iter_data->callback_with_flights(
+                      accumulator,
+                      user,
+                      __user_manager_get_span(manager, USER_MANAGER_RELATION_FLIGHTS, i));
+
+        if (retval) {
+            int expected = 0;
+            __atomic_compare_exchange_n(&iter_data->retval,
+                                        &expected,
+                                        retval,
+                                        0,
+                                        __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED);
+            break;
+        }
+    }
+    performance_trace_end();
+}
+
+/**
+ * @brief Merges the accumulator of a range of users in a parallel iteration.
+ *
+ * @param user_data   A pointer to a ::user_manager_parallel_iter_data_t.
+ * @param accumulator Accumulator to be merged.
+ */
+void __user_manager_parallel_iter_merge(void *user_data, void *accumulator) {
+    const user_manager_parallel_iter_data_t *const iter_data = user_data;
+    iter_data->merge(iter_data->original_user_data, accumulator);
+}
 
 /**
- * @brief Intermediate callback for ::user_manager_iter_with_flights.
+ * @brief   Iterates through every user in a user manager, in parallel.
+ * @details Auxiliary method for ::user_manager_parallel_iter and
+ *          ::user_manager_parallel_iter_with_flights.
  *
- * @param iter_data Real callback and original user data (::user_manager_iter_with_flights_data_t).
- * @param user_data A pointer to a ::user_manager_user_and_data_t.
+ * @param pool      Thread pool to iterate in.
+ * @param iter_data Manager and callbacks of the iteration.
  *
- * @return The value of the original callback called.
+ * @return See ::user_manager_parallel_iter.
  */
-int __user_manager_iter_with_flights_callback(void *iter_data, const void *user_data) {
-    const user_manager_iter_with_flights_data_t *const iter_data_struct = iter_data;
-    const user_manager_user_and_data_t *const          user_data_struct = user_data;
+int __user_manager_parallel_iter(thread_pool_t                     *pool,
+                                 user_manager_parallel_iter_data_t *iter_data) {
+    performance_access_count_scan(PERFORMANCE_ACCESS_MANAGER_USERS,
+                                  iter_data->manager->user_data->len);
+    if (thread_pool_parallel_reduce(pool,
+                                    iter_data->manager->user_data->len,
+                                    0,
+                                    __user_manager_parallel_iter_init,
+                                    __user_manager_parallel_iter_range,
+                                    __user_manager_parallel_iter_merge,
+                                    iter_data))
+        return 1;
 
-    return iter_data_struct->original_callback(iter_data_struct->user_data,
-                                               user_data_struct->user,
-                                               user_data_struct->flights);
+    return iter_data->retval;
 }
 
-int user_manager_iter_with_flights(const user_manager_t                     *manager,
-                                   user_manager_iter_with_flights_callback_t callback,
-                                   void                                     *user_data) {
+int user_manager_parallel_iter(const user_manager_t               *manager,
+                               thread_pool_t                      *pool,
+                               thread_pool_reduce_init_callback_t  init,
+                               user_manager_iter_callback_t        callback,
+                               thread_pool_reduce_merge_callback_t merge,
+                               void                               *user_data) {
+
+    user_manager_parallel_iter_data_t iter_data = {.manager               = manager,
+                                                   .init                  = init,
+                                                   .callback              = callback,
+                                                   .callback_with_flights = NULL,
+                                                   .merge                 = merge,
+                                                   .original_user_data    = user_data,
+                                                   .retval                = 0};
+    return __user_manager_parallel_iter(pool, &iter_data);
+}
+
+int user_manager_parallel_iter_with_flights(const user_manager_t                     *manager,
+                                            thread_pool_t                            *pool,
+                                            thread_pool_reduce_init_callback_t        init,
+                                            user_manager_iter_with_flights_callback_t callback,
+                                            thread_pool_reduce_merge_callback_t       merge,
+                                            void                                     *user_data) {
+
+    user_manager_parallel_iter_data_t iter_data = {.manager               = manager,
+                                                   .init                  = init,
+                                                   .callback              = NULL,
+                                                   .callback_with_flights = callback,
+                                                   .merge                 = merge,
+                                                   .original_user_data    = user_data,
+                                                   .retval                = 0};
+    return __user_manager_parallel_iter(pool, &iter_data);
+}
+
+void user_manager_compact(user_manager_t *manager) {
+    pool_trim(manager->users);
+    pool_trim(manager->cold_users);
+    string_pool_trim(manager->strings);
+
+    /* Only optimizations for NUMA machines, so failures are ignored */
+    numa_topology_interleave(manager->user_data->data,
+                             manager->user_data->len * sizeof(user_manager_user_and_data_t));
+    string_table_replicate(manager->id_users_rel);
+}
+
+int user_manager_add_to_memory_report(const user_manager_t *manager,
+                                      memory_report_t      *report) {
+    memory_usage_t usage;
+
+    pool_get_memory_usage(manager->users, &usage);
+    if (memory_report_add(report, "users.users", &usage))
+        return 1;
+
+    pool_get_memory_usage(manager->cold_users, &usage);
+    if (memory_report_add(report, "users.cold_users", &usage))
+        return 1;
+
+    string_pool_get_memory_usage(manager->strings, &usage);
+    if (memory_report_add(report, "users.strings", &usage))
+        return 1;
+
+    usage = (memory_usage_t) {0};
+    memory_usage_add_arrays(&usage, 1, &manager->user_data);
+    if (memory_report_add(report, "users.user_data", &usage))
+        return 1;
+
+    usage = (memory_usage_t) {0};
+    memory_usage_add_arrays(&usage, 1, &manager->active_users);
+    if (memory_report_add(report, "users.active_users", &usage))
+        return 1;
 
-    user_manager_iter_with_flights_data_t iter_data = {.user_data         = user_data,
-                                                       .original_callback = callback};
-    return pool_iter(manager->user_data, __user_manager_iter_with_flights_callback, &iter_data);
+    string_table_get_memory_usage(manager->id_users_rel, &usage);
+    if (memory_report_add(report, "users.id_users_rel", &usage))
+        return 1;
+
+    if (manager->id_filter) {
+        const size_t filter_bytes = bloom_filter_get_size(manager->id_filter);
+        if (memory_report_add_allocation(report, "users.id_filter", filter_bytes, filter_bytes))
+            return 1;
+    }
+
+    /* Associations are either in linked lists (pools) or in frozen arrays */
+    const char *const relation_names[USER_MANAGER_RELATION_COUNT] = {"users.flights",
+                                                                     "users.reservations"};
+    for (size_t r = 0; r < USER_MANAGER_RELATION_COUNT; ++r) {
+        if (manager->relation_nodes[r]) {
+            single_pool_id_linked_list_get_memory_usage(manager->relation_nodes[r], &usage);
+        } else {
+            const user_manager_frozen_relation_t *const frozen = &manager->frozen_relations[r];
+            const size_t                                n      = manager->user_data->len;
+            const size_t ids_bytes =
+                frozen->offsets[n] * (sizeof(uint32_t) + sizeof(date_and_time_t));
+
+            usage = (memory_usage_t) {
+                .blocks         = 3,
+                .reserved_bytes = (n + 1) * sizeof(uint32_t) +
+                                  max(ids_bytes, sizeof(uint32_t) + sizeof(date_and_time_t)),
+                .used_bytes     = (n + 1) * sizeof(uint32_t) + ids_bytes,
+                .wasted_bytes   = 0};
+        }
+
+        if (memory_report_add(report, relation_names[r], &usage))
+            return 1;
+    }
+
+    if (__user_manager_is_frozen(manager)) {
+        const user_manager_frozen_passengers_t *const passengers = &manager->frozen_passengers;
+        const size_t total = passengers->offsets[passengers->length];
+        const size_t bytes =
+            (2 * passengers->length + 1) * sizeof(uint32_t) + total * sizeof(uint32_t);
+
+        if (memory_report_add_allocation(report, "users.passengers", bytes, bytes))
+            return 1;
+    }
+
+    return 0;
 }
 
 void user_manager_free(user_manager_t *manager) {
     pool_free(manager->users);
-    pool_free(manager->user_data);
-    pool_free(manager->ll_nodes);
+    pool_free(manager->cold_users);
+    g_array_unref(manager->user_data);
+    g_array_unref(manager->active_users);
+    __user_manager_free_relation_pools(manager);
+    __user_manager_free_frozen_relations(manager);
     string_pool_free(manager->strings);
-    g_const_key_hash_table_unref(manager->id_users_rel);
+    string_table_free(manager->id_users_rel);
+    bloom_filter_free(manager->id_filter);
+    __user_manager_free_staged_relations(manager);
     free(manager);
 }
@@ -0,0 +1,461 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  dataset_delta_log.c
+ * @brief Implementation of methods in include/dataset/dataset_delta_log.h
+ *
+ * ### Example
+ * See [the header file's documentation](@ref dataset_delta_log_examples).
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dataset/dataset_delta_log.h"
+#include "dataset/dataset_snapshot.h"
+
+/** @brief Value of ::dataset_delta_log_header_t::magic. */
+#define DATASET_DELTA_LOG_MAGIC "LI3DLTA"
+
+/** @brief Value of ::dataset_delta_log_header_t::version. Increment when the format changes. */
+#define DATASET_DELTA_LOG_VERSION 1
+
+/** @brief Value of ::dataset_delta_log_header_t::byte_order, as written by the current machine. */
+#define DATASET_DELTA_LOG_BYTE_ORDER 0x0102030405060708
+
+/** @brief Number of files in a delta. */
+#define DATASET_DELTA_LOG_FILE_COUNT 4
+
+/** @brief Number of replayed deltas after which a log is compacted. */
+#define DATASET_DELTA_LOG_COMPACTION_SEGMENTS 8
+
+/**
+ * @brief Fraction (`1 / n`) of the size of the snapshot that replayed deltas must reach for a log
+ *        to be compacted.
+ */
+#define DATASET_DELTA_LOG_COMPACTION_RATIO 4
+
+/** @brief Names of the files in a delta, in the order they're stored in a segment. */
+static const char *const dataset_delta_log_file_names[DATASET_DELTA_LOG_FILE_COUNT] = {
+    "users",
+    "flights",
+    "passengers",
+    "reservations"};
+
+/**
+ * @struct dataset_delta_log_header_t
+ * @brief  Header at the beginning of every segment of a delta log, followed by the contents of the
+ *         delta's files. All its fields are 8-byte aligned, so it has no padding.
+ *
+ * @var dataset_delta_log_header_t::magic
+ *     @brief Always ::DATASET_DELTA_LOG_MAGIC, to identify segments.
+ * @var dataset_delta_log_header_t::version
+ *     @brief Version of the log format (::DATASET_DELTA_LOG_VERSION).
+ * @var dataset_delta_log_header_t::byte_order
+ *     @brief ::DATASET_DELTA_LOG_BYTE_ORDER, to reject logs written in other machines.
+ * @var dataset_delta_log_header_t::base_identifier
+ *     @brief Identifier of the snapshot the segment applies to (see
+ *            ::dataset_snapshot_get_identity).
+ * @var dataset_delta_log_header_t::lengths
+ *     @brief Number of bytes in each of the delta's files.
+ * @var dataset_delta_log_header_t::checksum
+ *     @brief Checksum of the contents of all files (see ::dataset_snapshot_checksum).
+ */
+typedef struct {
+    char     magic[8];
+    uint64_t version;
+    uint64_t byte_order;
+    uint64_t base_identifier;
+    uint64_t lengths[DATASET_DELTA_LOG_FILE_COUNT];
+    uint64_t checksum;
+} dataset_delta_log_header_t;
+
+/**
+ * @brief   Opens the log of a dataset, and locks it.
+ * @details The lock is released when the returned file descriptor is closed.
+ *
+ * @param dataset_path Path to the directory containing the dataset.
+ * @param flags        Flags for `open` (`O_RDONLY` for a shared lock, `O_RDWR` for an exclusive
+ *                     one).
+ *
+ * @return A file descriptor, or `-1` on failure (`errno` is set).
+ */
+int __dataset_delta_log_open(const char *dataset_path, int flags) {
+    char log_path[PATH_MAX];
+    snprintf(log_path, PATH_MAX, "%s/%s", dataset_path, DATASET_DELTA_LOG_FILE_NAME);
+
+    const int fd = open(log_path, flags | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return -1;
+
+    struct flock lock;
+    memset(&lock, 0, sizeof(struct flock)); /* Whole file */
+    lock.l_type   = (flags & O_ACCMODE) == O_RDONLY ? F_RDLCK : F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    while (fcntl(fd, F_SETLKW, &lock)) {
+        if (errno != EINTR) {
+            const int error = errno;
+            close(fd);
+            errno = error;
+            return -1;
+        }
+    }
+    return fd;
+}
+
+/**
+ * @brief Reads bytes from a file, until all of them are read.
+ *
+ * @param fd     File to read from.
+ * @param out    Where to write the bytes to.
+ * @param length Number of bytes to read.
+ * @param offset Offset of the first byte in the file.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO failure, or the file ended before @p length bytes.
+ */
+int __dataset_delta_log_read(int fd, void *out, size_t length, off_t offset) {
+    size_t nread = 0;
+    while (nread < length) {
+        const ssize_t n = pread(fd, (char *) out + nread, length - nread, offset + nread);
+        if (n < 0 && errno == EINTR)
+            continue;
+        else if (n <= 0)
+            return 1;
+        nread += n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes bytes to a file, until all of them are written.
+ *
+ * @param fd     File to write to.
+ * @param data   Bytes to be written.
+ * @param length Number of bytes in @p data.
+ * @param offset Offset in the file where to write @p data.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO failure.
+ */
+int __dataset_delta_log_write(int fd, const void *data, size_t length, off_t offset) {
+    size_t nwritten = 0;
+    while (nwritten < length) {
+        const ssize_t n =
+            pwrite(fd, (const char *) data + nwritten, length - nwritten, offset + nwritten);
+        if (n < 0 && errno == EINTR)
+            continue;
+        else if (n <= 0)
+            return 1;
+        nwritten += n;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Reads the valid segments of a log.
+ * @details Reading stops at the first segment that's partially written, corrupted, or that applies
+ *          to another snapshot.
+ *
+ * @param fd              Locked log (see ::__dataset_delta_log_open).
+ * @param base_identifier Identifier of the snapshot segments must apply to.
+ * @param out_length      Where to write the number of bytes in the valid segments to.
+ * @param out_segments    Where to write the number of valid segments to.
+ *
+ * @return The contents of the log (at least @p out_length bytes), that must be `free`d, or `NULL`
+ *         on IO or allocation failure.
+ */
+char *__dataset_delta_log_read_segments(int       fd,
+                                        uint64_t  base_identifier,
+                                        uint64_t *out_length,
+                                        size_t   *out_segments) {
+    struct stat st;
+    if (fstat(fd, &st))
+        return NULL;
+
+    const size_t size = (size_t) st.st_size;
+    char *const  log  = malloc(size ? size : 1);
+    if (!log)
+        return NULL;
+    if (__dataset_delta_log_read(fd, log, size, 0)) {
+        free(log);
+        return NULL;
+    }
+
+    uint64_t offset   = 0;
+    size_t   segments = 0;
+    while (size - offset >= sizeof(dataset_delta_log_header_t)) {
+        dataset_delta_log_header_t header;
+        memcpy(&header, log + offset, sizeof(dataset_delta_log_header_t));
+        if (memcmp(header.magic, DATASET_DELTA_LOG_MAGIC, sizeof(DATASET_DELTA_LOG_MAGIC)) ||
+            header.version != DATASET_DELTA_LOG_VERSION ||
+            header.byte_order != DATASET_DELTA_LOG_BYTE_ORDER ||
+            header.base_identifier != base_identifier)
+            break;
+
+        uint64_t available = size - offset - sizeof(dataset_delta_log_header_t), length = 0;
+        for (size_t i = 0; i < DATASET_DELTA_LOG_FILE_COUNT; ++i) {
+            if (header.lengths[i] > available - length) {
+                length = UINT64_MAX;
+                break;
+            }
+            length += header.lengths[i];
+        }
+
+        const char *const contents = log + offset + sizeof(dataset_delta_log_header_t);
+        if (length == UINT64_MAX || dataset_snapshot_checksum(contents, length) != header.checksum)
+            break;
+
+        offset += sizeof(dataset_delta_log_header_t) + length;
+        segments++;
+    }
+
+    *out_length   = offset;
+    *out_segments = segments;
+    return log;
+}
+
+/**
+ * @brief Gets the identifier of the snapshot of a dataset (see ::dataset_snapshot_get_identity).
+ *
+ * @param dataset_path   Path to the directory containing the dataset.
+ * @param out_identifier Where to write the identifier to, on success.
+ * @param out_length     Where to write the length of the snapshot to, on success.
+ *
+ * @retval 0 Success.
+ * @retval 1 The dataset has no usable snapshot, or snapshots are off.
+ */
+int __dataset_delta_log_get_snapshot(const char *dataset_path,
+                                     uint64_t   *out_identifier,
+                                     uint64_t   *out_length) {
+    char snapshot_path[PATH_MAX];
+    return dataset_snapshot_get_path(dataset_path, snapshot_path) ||
+           dataset_snapshot_get_identity(snapshot_path, out_identifier, out_length);
+}
+
+/**
+ * @brief Reads the files of a delta into a segment.
+ *
+ * @param delta_path Path to the directory containing the delta.
+ * @param header     Header whose ::dataset_delta_log_header_t::lengths and
+ *                   ::dataset_delta_log_header_t::checksum are filled in.
+ *
+ * @return The contents of all files, that must be `free`d, or `NULL` on failure (IO, allocation,
+ *         or a file that isn't a regular one).
+ */
+char *__dataset_delta_log_read_delta(const char *delta_path, dataset_delta_log_header_t *header) {
+    FILE    *files[DATASET_DELTA_LOG_FILE_COUNT] = {0};
+    uint64_t length                              = 0;
+    char    *contents                            = NULL;
+
+    for (size_t i = 0; i < DATASET_DELTA_LOG_FILE_COUNT; ++i) {
+        char file_path[PATH_MAX];
+        snprintf(file_path, PATH_MAX, "%s/%s.csv", delta_path, dataset_delta_log_file_names[i]);
+
+        struct stat st;
+        files[i] = fopen(file_path, "rb");
+        if (!files[i] || fstat(fileno(files[i]), &st) || !S_ISREG(st.st_mode))
+            goto DEFER_1;
+
+        header->lengths[i] = (uint64_t) st.st_size;
+        length += header->lengths[i];
+    }
+
+    contents = malloc(length ? length : 1);
+    if (!contents)
+        goto DEFER_1;
+
+    char *next = contents;
+    for (size_t i = 0; i < DATASET_DELTA_LOG_FILE_COUNT; ++i) {
+        if (fread(next, 1, header->lengths[i], files[i]) != header->lengths[i]) {
+            free(contents);
+            contents = NULL;
+            goto DEFER_1;
+        }
+        next += header->lengths[i];
+    }
+    header->checksum = dataset_snapshot_checksum(contents, length);
+
+DEFER_1:
+    for (size_t i = 0; i < DATASET_DELTA_LOG_FILE_COUNT; ++i)
+        if (files[i])
+            fclose(files[i]);
+    return contents;
+}
+
+int dataset_delta_log_append(const char *dataset_path, const char *delta_path) {
+    dataset_delta_log_header_t header;
+    memset(&header, 0, sizeof(dataset_delta_log_header_t)); /* No uninitialized bytes in the file */
+    memcpy(header.magic, DATASET_DELTA_LOG_MAGIC, sizeof(DATASET_DELTA_LOG_MAGIC));
+    header.version    = DATASET_DELTA_LOG_VERSION;
+    header.byte_order = DATASET_DELTA_LOG_BYTE_ORDER;
+
+    char *const contents = __dataset_delta_log_read_delta(delta_path, &header);
+    if (!contents)
+        return 1;
+
+    int       retval = 1;
+    const int fd     = __dataset_delta_log_open(dataset_path, O_RDWR | O_CREAT);
+    if (fd < 0)
+        goto DEFER_1;
+
+    /* Only read while locked, as a compaction may be replacing the snapshot */
+    uint64_t snapshot_length;
+    if (__dataset_delta_log_get_snapshot(dataset_path, &header.base_identifier, &snapshot_length))
+        goto DEFER_2;
+
+    /* Stale segments (and a partially written one) are dropped, for the new one to be reachable */
+    uint64_t    end;
+    size_t      segments;
+    char *const log =
+        __dataset_delta_log_read_segments(fd, header.base_identifier, &end, &segments);
+    if (!log)
+        goto DEFER_2;
+    free(log);
+
+    uint64_t length = 0;
+    for (size_t i = 0; i < DATASET_DELTA_LOG_FILE_COUNT; ++i)
+        length += header.lengths[i];
+
+    retval = ftruncate(fd, (off_t) end) ||
+             __dataset_delta_log_write(fd, &header, sizeof(header), (off_t) end) ||
+             __dataset_delta_log_write(fd, contents, length, (off_t) (end + sizeof(header)));
+
+DEFER_2:
+    close(fd);
+DEFER_1:
+    free(contents);
+    return retval;
+}
+
+int dataset_delta_log_replay(const char                  *dataset_path,
+                             uint64_t                     base_identifier,
+                             dataset_delta_log_callback_t callback,
+                             void                        *user_data,
+                             dataset_delta_log_info_t    *out_info) {
+
+    *out_info = (dataset_delta_log_info_t) {.base_identifier = base_identifier,
+                                            .segments        = 0,
+                                            .length          = 0};
+
+    const int fd = __dataset_delta_log_open(dataset_path, O_RDONLY);
+    if (fd < 0)
+        return errno != ENOENT;
+
+    uint64_t    length;
+    size_t      segments;
+    char *const log = __dataset_delta_log_read_segments(fd, base_identifier, &length, &segments);
+    close(fd); /* Segments are never modified once written, so they can be replayed unlocked */
+    if (!log)
+        return 1;
+
+    int retval = 0;
+    for (size_t i = 0; i < segments; ++i) {
+        dataset_delta_log_header_t header;
+        memcpy(&header, log + out_info->length, sizeof(dataset_delta_log_header_t));
+
+        const char *contents[DATASET_DELTA_LOG_FILE_COUNT];
+        size_t      lengths[DATASET_DELTA_LOG_FILE_COUNT];
+        uint64_t    offset = out_info->length + sizeof(dataset_delta_log_header_t);
+        for (size_t j = 0; j < DATASET_DELTA_LOG_FILE_COUNT; ++j) {
+            contents[j] = log + offset;
+            lengths[j]  = header.lengths[j];
+            offset += header.lengths[j];
+        }
+
+        if (callback(user_data, contents, lengths)) {
+            retval = 1;
+            break;
+        }
+        out_info->segments++;
+        out_info->length = offset;
+    }
+
+    free(log);
+    return retval;
+}
+
+int dataset_delta_log_needs_compaction(const char                     *dataset_path,
+                                       const dataset_delta_log_info_t *info) {
+    if (info->segments == 0)
+        return 0;
+    if (info->segments >= DATASET_DELTA_LOG_COMPACTION_SEGMENTS)
+        return 1;
+
+    uint64_t identifier, snapshot_length;
+    return !__dataset_delta_log_get_snapshot(dataset_path, &identifier, &snapshot_length) &&
+           info->length * DATASET_DELTA_LOG_COMPACTION_RATIO >= snapshot_length;
+}
+
+int dataset_delta_log_compact(const database_t               *database,
+                              const char                     *dataset_path,
+                              const char                     *errors_path,
+                              const dataset_delta_log_info_t *info) {
+
+    /* Appends wait for the compaction, so that none is left out of both the snapshot and the log */
+    const int fd = __dataset_delta_log_open(dataset_path, O_RDWR);
+    if (fd < 0)
+        return 1;
+
+    int      retval = 1;
+    uint64_t identifier, snapshot_length;
+    if (__dataset_delta_log_get_snapshot(dataset_path, &identifier, &snapshot_length))
+        goto DEFER_1;
+    if (identifier != info->base_identifier) {
+        retval = 0; /* Replaced meanwhile (e.g.: compacted by another process) */
+        goto DEFER_1;
+    }
+
+    uint64_t    length;
+    size_t      segments;
+    char *const log = __dataset_delta_log_read_segments(fd, identifier, &length, &segments);
+    if (!log)
+        goto DEFER_1;
+
+    if (dataset_snapshot_save(database, dataset_path, errors_path) ||
+        __dataset_delta_log_get_snapshot(dataset_path, &identifier, &snapshot_length))
+        goto DEFER_2;
+
+    /* Segments appended after the replay now apply to the new snapshot */
+    const uint64_t kept = length > info->length ? length - info->length : 0;
+    for (uint64_t offset = info->length; offset < length;) {
+        dataset_delta_log_header_t header;
+        memcpy(&header, log + offset, sizeof(dataset_delta_log_header_t));
+        header.base_identifier = identifier;
+        memcpy(log + offset, &header, sizeof(dataset_delta_log_header_t));
+
+        offset += sizeof(dataset_delta_log_header_t);
+        for (size_t i = 0; i < DATASET_DELTA_LOG_FILE_COUNT; ++i)
+            offset += header.lengths[i];
+    }
+
+    retval = __dataset_delta_log_write(fd, log + info->length, kept, 0) ||
+             ftruncate(fd, (off_t) kept);
+
+DEFER_2:
+    free(log);
+DEFER_1:
+    close(fd);
+    return retval;
+}
@@ -26,39 +26,67 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 
 #include "dataset/dataset_error_output.h"
+#include "testing/performance_probes.h"
+
+/** @brief Number of bytes of errors kept in memory for each file, before they're written to it. */
+#define DATASET_ERROR_OUTPUT_BUFFER_SIZE (1 << 20)
+
+/**
+ * @struct dataset_error_output_file_t
+ * @brief  An error file, and the errors that haven't been written to it yet.
+ *
+ * @var dataset_error_output_file_t::file
+ *     @brief Unbuffered stream of the error file.
+ * @var dataset_error_output_file_t::buffer
+ *     @brief Errors not yet written to ::dataset_error_output_file_t::file (`NULL` if nothing has
+ *            been reported yet).
+ * @var dataset_error_output_file_t::length
+ *     @brief Number of bytes in ::dataset_error_output_file_t::buffer.
+ */
+typedef struct {
+    FILE  *file;
+    char  *buffer;
+    size_t length;
+} dataset_error_output_file_t;
 
 /**
  * @struct dataset_error_output
  * @brief  Collection of file handles for all dataset error files.
+ * @details Errors are reported from the threads that parse the dataset, so they're only written in
+ *          large blocks, to keep IO away from parsing as much as possible.
  *
- * @var dataset_error_output::users
- *     @brief File where invalid users will be stored.
- * @var dataset_error_output::flights
- *     @brief File where invalid flights will be stored.
- * @var dataset_error_output::passengers
- *     @brief File where invalid user-flight relations (passengers) will be stored.
- * @var dataset_error_output::reservations
- *     @brief File where invalid hotel reservations will be stored.
+ * @var dataset_error_output::files
+ *     @brief Error files, in the same order as dataset loading steps (users, flights, passengers
+ *            and reservations). Empty if there's no error output.
+ * @var dataset_error_output::has_files
+ *     @brief Whether ::dataset_error_output::files were opened.
+ * @var dataset_error_output::progress
+ *     @brief Where to count errors as rejected lines (can be `NULL`). Not owned by this `struct`.
  */
 struct dataset_error_output {
-    FILE *users;
-    FILE *flights;
-    FILE *passengers;
-    FILE *reservations;
+    dataset_error_output_file_t files[PERFORMANCE_METRICS_DATASET_STEP_DONE];
+    int                         has_files;
+    dataset_progress_t         *progress;
 };
 
-dataset_error_output_t *dataset_error_output_create(const char *path) {
+dataset_error_output_t *dataset_error_output_create(const char         *path,
+                                                    dataset_progress_t *progress) {
     dataset_error_output_t *const output = malloc(sizeof(dataset_error_output_t));
     if (!output)
         return NULL;
+    output->progress  = progress;
+    output->has_files = path != NULL;
+
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i)
+        output->files[i] =
+            (dataset_error_output_file_t) {.file = NULL, .buffer = NULL, .length = 0};
 
-    if (!path) {
-        output->users = output->flights = output->passengers = output->reservations = NULL;
+    if (!path)
         return output;
-    }
 
     /* Try to create the directory if it doesn't exist */
     const int mkdir_res = mkdir(path, 0755);
@@ -67,62 +95,109 @@ dataset_error_output_t *dataset_error_output_create(const char *path) {
         return NULL;
     }
 
-    const char *const types[4] = {"users", "flights", "passengers", "reservations"};
-    FILE **const      files[4] = {&output->users,
-                                  &output->flights,
-                                  &output->passengers,
-                                  &output->reservations};
-
-    for (int i = 0; i < 4; ++i) {
+    const char *const types[PERFORMANCE_METRICS_DATASET_STEP_DONE] = {"users",
+                                                                      "flights",
+                                                                      "passengers",
+                                                                      "reservations"};
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i) {
         char file_path[PATH_MAX];
         snprintf(file_path, PATH_MAX, "%s/%s_errors.csv", path, types[i]);
-        *files[i] = fopen(file_path, "w");
+        output->files[i].file = fopen(file_path, "w");
 
-        if (!*files[i]) {
-            for (int j = 0; j < i; ++i)
-                fclose(*files[i]);
+        if (!output->files[i].file) {
+            for (size_t j = 0; j < i; ++j)
+                fclose(output->files[j].file);
             free(output);
             return NULL;
         }
+
+        /* Errors are already written in large blocks */
+        setvbuf(output->files[i].file, NULL, _IONBF, 0);
     }
 
     return output;
 }
 
+/**
+ * @brief Writes the errors in the buffer of an error file to that file.
+ * @param file Error file to be flushed.
+ */
+void __dataset_error_output_flush(dataset_error_output_file_t *file) {
+    fwrite(file->buffer, 1, file->length, file->file); /* IO errors are ignored, as before */
+    file->length = 0;
+}
+
+/**
+ * @brief Reports an error in a file of the dataset.
+ *
+ * @param output     Where to report the error to.
+ * @param step       Step of dataset loading where the error was found.
+ * @param error_line Error to be reported (musn't include `'\n'`).
+ */
+void __dataset_error_output_report(dataset_error_output_t            *output,
+                                   performance_metrics_dataset_step_t step,
+                                   const char                        *error_line) {
+
+    performance_probe1(dataset_invalid_line, (int) step);
+    dataset_progress_add_rejected(output->progress, step);
+    if (!output->has_files)
+        return;
+
+    dataset_error_output_file_t *const file = &output->files[step];
+    if (!file->buffer) {
+        file->buffer = malloc(DATASET_ERROR_OUTPUT_BUFFER_SIZE);
+        if (!file->buffer) { /* Fall back to unbuffered writes */
+            fprintf(file->file, "%s\n", error_line);
+            return;
+        }
+    }
+
+    const size_t length = strlen(error_line);
+    if (file->length + length + 1 > DATASET_ERROR_OUTPUT_BUFFER_SIZE) {
+        __dataset_error_output_flush(file);
+
+        if (length + 1 > DATASET_ERROR_OUTPUT_BUFFER_SIZE) { /* Line larger than the buffer */
+            fprintf(file->file, "%s\n", error_line);
+            return;
+        }
+    }
+
+    memcpy(file->buffer + file->length, error_line, length);
+    file->buffer[file->length + length] = '\n';
+    file->length += length + 1;
+}
+
 void dataset_error_output_report_user_error(dataset_error_output_t *output,
                                             const char             *error_line) {
-    if (output->users)
-        fprintf(output->users, "%s\n", error_line);
+    __dataset_error_output_report(output, PERFORMANCE_METRICS_DATASET_STEP_USERS, error_line);
 }
 
 void dataset_error_output_report_flight_error(dataset_error_output_t *output,
                                               const char             *error_line) {
-    if (output->flights)
-        fprintf(output->flights, "%s\n", error_line);
+    __dataset_error_output_report(output, PERFORMANCE_METRICS_DATASET_STEP_FLIGHTS, error_line);
 }
 
 void dataset_error_output_report_passenger_error(dataset_error_output_t *output,
                                                  const char             *error_line) {
-    if (output->passengers)
-        fprintf(output->passengers, "%s\n", error_line);
+    __dataset_error_output_report(output, PERFORMANCE_METRICS_DATASET_STEP_PASSENGERS, error_line);
 }
 
 void dataset_error_output_report_reservation_error(dataset_error_output_t *output,
                                                    const char             *error_line) {
-    if (output->reservations)
-        fprintf(output->reservations, "%s\n", error_line);
+    __dataset_error_output_report(output,
+                                  PERFORMANCE_METRICS_DATASET_STEP_RESERVATIONS,
+                                  error_line);
 }
 
 void dataset_error_output_free(dataset_error_output_t *output) {
-    if (!output->users) { /* No output files case. All files will be NULL. */
-        free(output);
-        return;
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE && output->has_files; ++i) {
+        dataset_error_output_file_t *const file = &output->files[i];
+        if (file->buffer) {
+            __dataset_error_output_flush(file);
+            free(file->buffer);
+        }
+        fclose(file->file);
     }
 
-    fclose(output->users);
-    fclose(output->flights);
-    fclose(output->passengers);
-    fclose(output->reservations);
-
     free(output);
 }
@@ -22,16 +22,85 @@
  * See [the header file's documentation](@ref dataset_input_examples).
  */
 
+/** @cond FALSE */
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE /* For F_SETPIPE_SZ and memrchr */
+#endif
+/** @endcond */
+
+#include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
+#include "dataset/dataset_delta_log.h"
 #include "dataset/dataset_input.h"
+#include "dataset/dataset_parser.h"
+#include "dataset/dataset_snapshot.h"
 #include "dataset/flights_loader.h"
 #include "dataset/passengers_loader.h"
 #include "dataset/reservations_loader.h"
 #include "dataset/users_loader.h"
 
+/**
+ * @brief   Fraction (`1 / n`) added to the estimated number of lines of a file, when sizing the
+ *          database for it.
+ * @details Overestimating is cheap, as memory that is reserved but never written to isn't backed by
+ *          physical pages. Underestimating makes pools allocate an extra block.
+ */
+#define DATASET_INPUT_ESTIMATE_MARGIN 8
+
+/** @brief Size of the buffer files are read to when warming up the page cache. */
+#define DATASET_INPUT_WARM_BUFFER_SIZE (1 << 16)
+
+/** @brief Start of a line marking a section of a multiplexed dataset stream. */
+#define DATASET_INPUT_SECTION_PREFIX "==> "
+
+/** @brief End of a line marking a section of a multiplexed dataset stream. */
+#define DATASET_INPUT_SECTION_SUFFIX " <=="
+
+/** @brief Number of files in a dataset. */
+#define DATASET_INPUT_FILE_COUNT 4
+
+/** @brief Names of the files in a dataset, without extensions, in the order they're loaded. */
+static const char *const dataset_input_file_types[DATASET_INPUT_FILE_COUNT] = {"users",
+                                                                               "flights",
+                                                                               "passengers",
+                                                                               "reservations"};
+
+/**
+ * @struct dataset_input_demultiplexer_t
+ * @brief  Thread splitting a multiplexed dataset stream into a pipe for each file (see
+ *         ::DATASET_INPUT_MULTIPLEXED_PATH).
+ *
+ * @var dataset_input_demultiplexer_t::source
+ *     @brief Multiplexed stream (not owned).
+ * @var dataset_input_demultiplexer_t::sections
+ *     @brief Write end of the pipe of each file, or `NULL` after the file's section ended.
+ * @var dataset_input_demultiplexer_t::thread
+ *     @brief Thread running ::__dataset_input_demultiplex.
+ * @var dataset_input_demultiplexer_t::running
+ *     @brief Whether ::dataset_input_demultiplexer_t::thread is yet to be joined.
+ * @var dataset_input_demultiplexer_t::failed
+ *     @brief   Whether the stream was malformed, or couldn't be read or written to the pipes.
+ *     @details Only read after ::dataset_input_demultiplexer_t::thread is joined.
+ */
+typedef struct {
+    FILE     *source;
+    FILE     *sections[DATASET_INPUT_FILE_COUNT];
+    pthread_t thread;
+    int       running;
+    int       failed;
+} dataset_input_demultiplexer_t;
+
 /**
  * @struct dataset_input
  * @brief Collection of file handles to the dataset input files.
@@ -44,76 +113,685 @@
  *     @brief File containing the dataset's user-flight relationships (passengers).
  * @var dataset_input::reservations
  *     @brief File containing the dataset's hotel reservations.
+ * @var dataset_input::decompressors
+ *     @brief   Process decompressing each file (in the same order as the files above), or `0` for
+ *              files that aren't compressed.
+ *     @details Compressed files are read from a pipe that these processes write to.
+ * @var dataset_input::demultiplexer
+ *     @brief Thread writing the pipes all files are read from, or `NULL` if the dataset isn't
+ *            multiplexed.
+ * @var dataset_input::streamed
+ *     @brief Whether any file can only be read once (see ::dataset_input_is_streamed).
+ * @var dataset_input::estimated_lines
+ *     @brief   Estimated number of lines in each file (see ::dataset_parser_estimate_line_count).
+ *     @details Used to size the database before loading each file.
+ * @var dataset_input::flight_lines
+ *     @brief   Positions of the lines of valid flights in ::dataset_input::flights.
+ *     @details Filled in when loading flights, so that flights invalidated when loading passengers
+ *              can be reported without parsing ::dataset_input::flights again. Copies of the lines
+ *              are kept instead when ::dataset_input::flights can't be read again.
  */
 struct dataset_input {
-    FILE *users;
-    FILE *flights;
-    FILE *passengers;
-    FILE *reservations;
+    FILE                          *users;
+    FILE                          *flights;
+    FILE                          *passengers;
+    FILE                          *reservations;
+    pid_t                          decompressors[DATASET_INPUT_FILE_COUNT];
+    dataset_input_demultiplexer_t *demultiplexer;
+    int                            streamed;
+
+    size_t                estimated_lines[PERFORMANCE_METRICS_DATASET_STEP_DONE];
+    dataset_line_index_t *flight_lines;
 };
 
+/**
+ * @brief   Size requested for the pipes dataset files are read from, so that decompressors (and the
+ *          demultiplexer) can run further ahead of the parser.
+ * @details Only used on Linux. Elsewhere, the system's default pipe size is used.
+ */
+#define DATASET_INPUT_PIPE_SIZE (1 << 20)
+
+/** @cond FALSE */
+extern char **environ;
+/** @endcond */
+
+/**
+ * @brief   Creates a pipe, that a dataset file is read from.
+ * @details Neither end is inherited by child processes, or they'd keep the pipe open after its
+ *          writer closes it.
+ *
+ * @param fds Where to write the read (`fds[0]`) and write (`fds[1]`) ends of the pipe to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure.
+ */
+int __dataset_input_create_pipe(int fds[2]) {
+    if (pipe(fds))
+        return 1;
+
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#ifdef F_SETPIPE_SZ
+    fcntl(fds[1], F_SETPIPE_SZ, DATASET_INPUT_PIPE_SIZE); /* Failure only means a smaller buffer */
+#endif
+    return 0;
+}
+
+/**
+ * @brief   Starts a process that decompresses a file, and opens a stream with its output.
+ * @details The decompressor runs alongside the parser, with the pipe between them working as a
+ *          ring buffer. Use ::__dataset_input_close to close the returned stream.
+ *
+ * @param program   Decompressor to run (`gzip` or `zstd`), that must support the `-dc` options.
+ * @param file_path Path to the compressed file.
+ * @param pid       Where to write the identifier of the decompressor process to.
+ *
+ * @return The stream with the decompressed data, or `NULL` on failure.
+ */
+FILE *__dataset_input_spawn_decompressor(const char *program, const char *file_path, pid_t *pid) {
+    int fds[2];
+    if (__dataset_input_create_pipe(fds))
+        return NULL;
+
+    posix_spawn_file_actions_t actions;
+    if (posix_spawn_file_actions_init(&actions))
+        goto DEFER_1;
+    if (posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO))
+        goto DEFER_2;
+
+    /* SIGPIPE may be ignored by this program, but it's what stops decompressors early */
+    posix_spawnattr_t attributes;
+    sigset_t          default_signals;
+    if (posix_spawnattr_init(&attributes))
+        goto DEFER_2;
+    if (sigemptyset(&default_signals) || sigaddset(&default_signals, SIGPIPE) ||
+        posix_spawnattr_setsigdefault(&attributes, &default_signals) ||
+        posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGDEF))
+        goto DEFER_3;
+
+    char        decompress_flag[] = "-dc";
+    char        end_of_flags[]    = "--";
+    char *const argv[]            = {(char *) (size_t) program,
+                                     decompress_flag,
+                                     end_of_flags,
+                                     (char *) (size_t) file_path,
+                                     NULL};
+    if (posix_spawnp(pid, program, &actions, &attributes, argv, environ))
+        goto DEFER_3;
+
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+
+    FILE *const stream = fdopen(fds[0], "r");
+    if (!stream) {
+        close(fds[0]);
+        waitpid(*pid, NULL, 0); /* The decompressor gets SIGPIPE */
+        return NULL;
+    }
+    return stream;
+
+DEFER_3:
+    posix_spawnattr_destroy(&attributes);
+DEFER_2:
+    posix_spawn_file_actions_destroy(&actions);
+DEFER_1:
+    close(fds[0]);
+    close(fds[1]);
+    return NULL;
+}
+
+/**
+ * @brief   Opens a file of a dataset, that may be compressed.
+ * @details `<type>.csv` is preferred. When it doesn't exist, `<type>.csv.gz` and `<type>.csv.zst`
+ *          are tried, and decompressed while being read (see ::__dataset_input_spawn_decompressor).
+ *          The file starts being read ahead (see ::stream_prefetch), so that all files of a
+ *          dataset are fetched from storage while the first ones are being parsed.
+ *
+ * @param path Path to the directory containing the dataset.
+ * @param type Name of the file, without extensions (e.g.: `"users"`).
+ * @param pid  Where to write the identifier of the decompressor process to (`0` for no
+ *             decompressor).
+ *
+ * @return The stream with the contents of the file, or `NULL` on failure.
+ */
+FILE *__dataset_input_open(const char *path, const char *type, pid_t *pid) {
+    char file_path[PATH_MAX];
+    snprintf(file_path, PATH_MAX, "%s/%s.csv", path, type);
+
+    *pid               = 0;
+    FILE *const stream = fopen(file_path, "r");
+    if (stream)
+        stream_prefetch(fileno(stream));
+    if (stream || errno != ENOENT)
+        return stream;
+
+    const char *const extensions[2]    = {"gz", "zst"};
+    const char *const decompressors[2] = {"gzip", "zstd"};
+    for (size_t i = 0; i < 2; ++i) {
+        snprintf(file_path, PATH_MAX, "%s/%s.csv.%s", path, type, extensions[i]);
+        const int fd = open(file_path, O_RDONLY);
+        if (fd >= 0) {
+            stream_prefetch(fd); /* Read ahead for the decompressor, that opens the file again */
+            close(fd);
+            return __dataset_input_spawn_decompressor(decompressors[i], file_path, pid);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Closes a stream opened with ::__dataset_input_open.
+ *
+ * @param stream Stream to be closed.
+ * @param pid    Identifier of the decompressor process of @p stream (`0` for no decompressor).
+ */
+void __dataset_input_close(FILE *stream, pid_t pid) {
+    fclose(stream);
+
+    /* If the stream wasn't read until its end, the decompressor is stopped by SIGPIPE */
+    if (pid)
+        waitpid(pid, NULL, 0);
+}
+
+/**
+ * @brief   Closes a file of a dataset as soon as it's no longer needed.
+ * @details Releases its `stdio` buffer, along with the pipe and the process of its decompressor,
+ *          instead of keeping them alive while the rest of the dataset is loaded.
+ *
+ * @param stream Stream to be closed (see ::__dataset_input_close), replaced by `NULL`. Nothing is
+ *               done if it's already `NULL`.
+ * @param pid    Identifier of the decompressor process of @p stream, replaced by `0`.
+ */
+void __dataset_input_release(FILE **stream, pid_t *pid) {
+    if (*stream) {
+        __dataset_input_close(*stream, *pid);
+        *stream = NULL;
+        *pid    = 0;
+    }
+}
+
+/**
+ * @brief   Gets the section of a multiplexed dataset stream that a line starts.
+ * @details Sections start with a line `==> <file> <==`, where `<file>` is the name of a dataset
+ *          file, optionally preceded by directories (like the headers printed by `tail`).
+ *
+ * @param line   Line of the multiplexed stream.
+ * @param length Length of @p line, not including its delimiter.
+ *
+ * @return The index of the file in ::dataset_input_file_types, `-1` if @p line isn't a section
+ *         marker, or ::DATASET_INPUT_FILE_COUNT if it's the marker of an unknown file.
+ */
+int __dataset_input_get_section(const char *line, size_t length) {
+    const size_t prefix_length = strlen(DATASET_INPUT_SECTION_PREFIX);
+    const size_t suffix_length = strlen(DATASET_INPUT_SECTION_SUFFIX);
+    if (length < prefix_length + suffix_length ||
+        memcmp(line, DATASET_INPUT_SECTION_PREFIX, prefix_length) ||
+        memcmp(line + length - suffix_length, DATASET_INPUT_SECTION_SUFFIX, suffix_length))
+        return -1;
+
+    const char *name  = line + prefix_length;
+    const char *end   = line + length - suffix_length;
+    const char *slash = memrchr(name, '/', end - name);
+    if (slash)
+        name = slash + 1;
+
+    const size_t name_length = end - name;
+
+    for (int i = 0; i < DATASET_INPUT_FILE_COUNT; ++i) {
+        const size_t type_length = strlen(dataset_input_file_types[i]);
+        if (name_length == type_length + 4 &&
+            !memcmp(name, dataset_input_file_types[i], type_length) &&
+            !memcmp(name + type_length, ".csv", 4))
+            return i;
+    }
+    return DATASET_INPUT_FILE_COUNT;
+}
+
+/**
+ * @brief   Ends the section of a file in a multiplexed dataset stream, closing its pipe.
+ * @details The loader of the file then reaches its end.
+ *
+ * @param demultiplexer Demultiplexer whose ::dataset_input_demultiplexer_t::sections are modified.
+ * @param section       Index of the file. Nothing is done if its section already ended.
+ */
+void __dataset_input_end_section(dataset_input_demultiplexer_t *demultiplexer, int section) {
+    FILE *const stream = demultiplexer->sections[section];
+    if (!stream)
+        return;
+
+    const int failed = ferror(stream);
+    if (fclose(stream) || failed)
+        demultiplexer->failed = 1;
+    demultiplexer->sections[section] = NULL;
+}
+
+/**
+ * @brief   Splits a multiplexed dataset stream into the pipes of each file.
+ * @details Thread entry point. Sections must be in the order files are loaded, as
+ *          ::dataset_loader_load only starts reading passengers and reservations after users and
+ *          flights are done. A missing section is an empty file. An empty line right before a
+ *          section marker is discarded, as `tail` separates files with one.
+ *
+ *          When a loader stops early and closes its pipe, writing to it fails (`SIGPIPE` is
+ *          blocked in this thread), and the rest of the stream isn't read.
+ *
+ * @param demultiplexer_data Pointer to a ::dataset_input_demultiplexer_t, whose
+ *                           ::dataset_input_demultiplexer_t::failed is set on failure.
+ *
+ * @return Always `NULL`.
+ */
+void *__dataset_input_demultiplex(void *demultiplexer_data) {
+    dataset_input_demultiplexer_t *const demultiplexer = demultiplexer_data;
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    char   *line     = NULL;
+    size_t  capacity = 0;
+    ssize_t read;
+    int     current = -1, pending_empty_line = 0;
+    while (!demultiplexer->failed &&
+           (read = getline(&line, &capacity, demultiplexer->source)) > 0) {
+
+        const size_t length  = read - (line[read - 1] == '\n');
+        const int    section = __dataset_input_get_section(line, length);
+        if (section >= DATASET_INPUT_FILE_COUNT || (section >= 0 && section <= current)) {
+            fprintf(stderr,
+                    "Unexpected section in the multiplexed dataset: %.*s\n",
+                    (int) length,
+                    line);
+            demultiplexer->failed = 1;
+        } else if (section >= 0) {
+            for (int i = current < 0 ? 0 : current; i < section; ++i)
+                __dataset_input_end_section(demultiplexer, i);
+            current            = section;
+            pending_empty_line = 0;
+        } else if (current < 0) {
+            fputs("The multiplexed dataset must start with a section marker!\n", stderr);
+            demultiplexer->failed = 1;
+        } else {
+            FILE *const output = demultiplexer->sections[current];
+            if (pending_empty_line)
+                putc('\n', output);
+            pending_empty_line = length == 0;
+
+            if (!pending_empty_line && fwrite(line, 1, read, output) != (size_t) read)
+                demultiplexer->failed = 1;
+        }
+    }
+
+    if (ferror(demultiplexer->source))
+        demultiplexer->failed = 1;
+    if (pending_empty_line && !demultiplexer->failed)
+        putc('\n', demultiplexer->sections[current]);
+
+    free(line);
+    for (int i = 0; i < DATASET_INPUT_FILE_COUNT; ++i)
+        __dataset_input_end_section(demultiplexer, i);
+    return NULL;
+}
+
+/**
+ * @brief   Starts splitting a multiplexed dataset stream into a pipe for each file.
+ * @details Auxiliary method for ::dataset_input_create.
+ *
+ * @param input  Dataset input whose files are replaced by the read ends of the pipes.
+ * @param source Multiplexed stream.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or failure to create a pipe or a thread. Nothing is left open.
+ */
+int __dataset_input_start_demultiplexer(dataset_input_t *input, FILE *source) {
+    dataset_input_demultiplexer_t *const demultiplexer =
+        malloc(sizeof(dataset_input_demultiplexer_t));
+    if (!demultiplexer)
+        return 1;
+
+    demultiplexer->source  = source;
+    demultiplexer->running = 0;
+    demultiplexer->failed  = 0;
+
+    FILE **const files[DATASET_INPUT_FILE_COUNT] = {&input->users,
+                                                    &input->flights,
+                                                    &input->passengers,
+                                                    &input->reservations};
+    int          opened                          = 0;
+    for (; opened < DATASET_INPUT_FILE_COUNT; ++opened) {
+        int fds[2];
+        if (__dataset_input_create_pipe(fds))
+            goto DEFER_1;
+
+        *files[opened]                   = fdopen(fds[0], "r");
+        demultiplexer->sections[opened] = fdopen(fds[1], "w");
+        if (!*files[opened] || !demultiplexer->sections[opened]) {
+            if (*files[opened])
+                fclose(*files[opened]);
+            else
+                close(fds[0]);
+            if (demultiplexer->sections[opened])
+                fclose(demultiplexer->sections[opened]);
+            else
+                close(fds[1]);
+            goto DEFER_1;
+        }
+    }
+
+    if (pthread_create(&demultiplexer->thread, NULL, __dataset_input_demultiplex, demultiplexer))
+        goto DEFER_1;
+
+    demultiplexer->running = 1;
+    input->demultiplexer   = demultiplexer;
+    return 0;
+
+DEFER_1:
+    for (int i = 0; i < opened; ++i) {
+        fclose(*files[i]);
+        fclose(demultiplexer->sections[i]);
+    }
+    free(demultiplexer);
+    return 1;
+}
+
+/**
+ * @brief   Checks if a stream can't be read more than once (e.g.: a pipe).
+ * @param   stream Stream to be checked.
+ * @return  Whether @p stream isn't a regular file.
+ */
+int __dataset_input_is_stream(FILE *stream) {
+    struct stat st;
+    return fstat(fileno(stream), &st) || !S_ISREG(st.st_mode);
+}
+
 dataset_input_t *dataset_input_create(const char *path) {
     dataset_input_t *const input = malloc(sizeof(dataset_input_t));
     if (!input)
         return NULL;
 
-    const char *const types[4] = {"users", "flights", "passengers", "reservations"};
-    FILE **const      files[4] = {&input->users,
-                                  &input->flights,
-                                  &input->passengers,
-                                  &input->reservations};
+    FILE **const files[DATASET_INPUT_FILE_COUNT] = {&input->users,
+                                                    &input->flights,
+                                                    &input->passengers,
+                                                    &input->reservations};
+    input->demultiplexer                         = NULL;
+    input->streamed                              = 0;
+    for (int i = 0; i < DATASET_INPUT_FILE_COUNT; ++i)
+        input->decompressors[i] = 0;
 
-    for (int i = 0; i < 4; ++i) {
-        char file_path[PATH_MAX];
-        snprintf(file_path, PATH_MAX, "%s/%s.csv", path, types[i]);
-
-        *files[i] = fopen(file_path, "r");
-
-        if (!*files[i]) {
-            for (int j = 0; j < i; ++i)
-                fclose(*files[i]);
+    if (strcmp(path, DATASET_INPUT_MULTIPLEXED_PATH) == 0) {
+        if (__dataset_input_start_demultiplexer(input, stdin)) {
             free(input);
             return NULL;
         }
+    } else {
+        for (int i = 0; i < DATASET_INPUT_FILE_COUNT; ++i) {
+            /* FIFOs are opened in this order, blocking until each one has a writer */
+            *files[i] =
+                __dataset_input_open(path, dataset_input_file_types[i], &input->decompressors[i]);
+
+            if (!*files[i]) {
+                for (int j = 0; j < i; ++j)
+                    __dataset_input_close(*files[j], input->decompressors[j]);
+                free(input);
+                return NULL;
+            }
+        }
+    }
+
+    for (int i = 0; i < DATASET_INPUT_FILE_COUNT; ++i) {
+        /* Files are opened in the same order as dataset loading steps */
+        input->estimated_lines[i] = dataset_parser_estimate_line_count(*files[i]);
+        input->streamed |= __dataset_input_is_stream(*files[i]);
+    }
+
+    /* Lines of flights that can't be read again must be kept in memory */
+    input->flight_lines = __dataset_input_is_stream(input->flights)
+                              ? dataset_line_index_create_in_memory()
+                              : dataset_line_index_create();
+    if (!input->flight_lines) {
+        dataset_input_free(input);
+        return NULL;
+    }
+
+    return input;
+}
+
+dataset_input_t *dataset_input_create_from_buffers(const char *const contents[4],
+                                                   const size_t      lengths[4]) {
+    dataset_input_t *const input = malloc(sizeof(dataset_input_t));
+    if (!input)
+        return NULL;
+
+    FILE **const files[DATASET_INPUT_FILE_COUNT] = {&input->users,
+                                                    &input->flights,
+                                                    &input->passengers,
+                                                    &input->reservations};
+    input->demultiplexer                         = NULL;
+    input->streamed                              = 0;
+    input->flight_lines                          = NULL;
+    for (int i = 0; i < DATASET_INPUT_FILE_COUNT; ++i) {
+        input->decompressors[i] = 0;
+        *files[i]               = NULL;
+    }
+
+    /* Unlike in-memory streams, temporary files can be parsed like any other (and memory-mapped) */
+    for (int i = 0; i < DATASET_INPUT_FILE_COUNT; ++i) {
+        *files[i] = tmpfile();
+        if (!*files[i] || fwrite(contents[i], 1, lengths[i], *files[i]) != lengths[i] ||
+            fflush(*files[i]) || fseek(*files[i], 0, SEEK_SET))
+            goto DEFER_1;
+
+        input->estimated_lines[i] = dataset_parser_estimate_line_count(*files[i]);
     }
 
+    input->flight_lines = dataset_line_index_create();
+    if (!input->flight_lines)
+        goto DEFER_1;
+
     return input;
+
+DEFER_1:
+    dataset_input_free(input);
+    return NULL;
+}
+
+int dataset_input_is_streamed(const dataset_input_t *input) {
+    return input->streamed;
+}
+
+int dataset_input_wait(dataset_input_t *input) {
+    dataset_input_demultiplexer_t *const demultiplexer = input->demultiplexer;
+    if (!demultiplexer)
+        return 0;
+
+    if (demultiplexer->running) {
+        pthread_join(demultiplexer->thread, NULL);
+        demultiplexer->running = 0;
+    }
+    return demultiplexer->failed;
+}
+
+stream_tokenize_method_t dataset_input_get_method(const dataset_input_t             *input,
+                                                  performance_metrics_dataset_step_t step) {
+    switch (step) {
+        case PERFORMANCE_METRICS_DATASET_STEP_USERS:
+            return stream_tokenize_get_method(input->users);
+        case PERFORMANCE_METRICS_DATASET_STEP_FLIGHTS:
+            return stream_tokenize_get_method(input->flights);
+        case PERFORMANCE_METRICS_DATASET_STEP_PASSENGERS:
+            return stream_tokenize_get_method(input->passengers);
+        case PERFORMANCE_METRICS_DATASET_STEP_RESERVATIONS:
+            return stream_tokenize_get_method(input->reservations);
+        default:
+            return STREAM_TOKENIZE_METHOD_READ; /* Invalid argument */
+    }
+}
+
+size_t dataset_input_get_estimated_lines(const dataset_input_t             *input,
+                                         performance_metrics_dataset_step_t step) {
+    if (step >= PERFORMANCE_METRICS_DATASET_STEP_DONE)
+        return 0; /* Invalid argument */
+    return input->estimated_lines[step];
+}
+
+/**
+ * @brief  Calculates how many entities to reserve space for before loading a file.
+ * @param  input Collection of file handles for dataset input.
+ * @param  step  Step of dataset loading where the file is read.
+ * @return The estimated number of lines of the file, with a safety margin.
+ */
+size_t __dataset_input_get_reserve_count(const dataset_input_t             *input,
+                                         performance_metrics_dataset_step_t step) {
+    const size_t estimate = input->estimated_lines[step];
+    return estimate + estimate / DATASET_INPUT_ESTIMATE_MARGIN;
 }
 
 int dataset_input_load_users(dataset_input_t        *input,
                              dataset_error_output_t *output,
-                             database_t             *database) {
+                             database_t             *database,
+                             dataset_progress_t     *progress) {
     rewind(input->users);
-    return users_loader_load(input->users, database, output);
+    const size_t expected =
+        __dataset_input_get_reserve_count(input, PERFORMANCE_METRICS_DATASET_STEP_USERS);
+    const int retval = database_reserve_users(database, expected) ||
+                       users_loader_load(input->users, database, output, progress);
+
+    __dataset_input_release(&input->users, &input->decompressors[0]);
+    return retval;
 }
 
 int dataset_input_load_flights(dataset_input_t        *input,
                                dataset_error_output_t *output,
-                               database_t             *database) {
+                               database_t             *database,
+                               dataset_progress_t     *progress) {
     rewind(input->flights);
-    return flights_loader_load(input->flights, database, output);
+    const size_t expected =
+        __dataset_input_get_reserve_count(input, PERFORMANCE_METRICS_DATASET_STEP_FLIGHTS);
+    if (database_reserve_flights(database, expected) ||
+        dataset_line_index_reserve(input->flight_lines, expected))
+        return 1;
+
+    return flights_loader_load(input->flights, database, input->flight_lines, output, progress);
 }
 
 int dataset_input_load_passengers(dataset_input_t        *input,
                                   dataset_error_output_t *output,
-                                  database_t             *database) {
+                                  database_t             *database,
+                                  dataset_progress_t     *progress) {
     rewind(input->passengers);
-    rewind(input->flights);
-    return passengers_loader_load(input->passengers, input->flights, database, output);
+    const size_t expected =
+        __dataset_input_get_reserve_count(input, PERFORMANCE_METRICS_DATASET_STEP_PASSENGERS);
+    const int retval = database_reserve_passengers(database, expected) ||
+                       passengers_loader_load(input->passengers,
+                                              input->flights,
+                                              input->flight_lines,
+                                              database,
+                                              output,
+                                              progress);
+
+    /* Flights are only read again to report the ones invalidated by passengers */
+    __dataset_input_release(&input->passengers, &input->decompressors[2]);
+    __dataset_input_release(&input->flights, &input->decompressors[1]);
+    dataset_line_index_free(input->flight_lines);
+    input->flight_lines = NULL;
+    return retval;
 }
 
 int dataset_input_load_reservations(dataset_input_t        *input,
                                     dataset_error_output_t *output,
-                                    database_t             *database) {
+                                    database_t             *database,
+                                    dataset_progress_t     *progress) {
     rewind(input->reservations);
-    return reservations_loader_load(input->reservations, database, output);
+    const size_t expected =
+        __dataset_input_get_reserve_count(input, PERFORMANCE_METRICS_DATASET_STEP_RESERVATIONS);
+    const int retval = database_reserve_reservations(database, expected) ||
+                       reservations_loader_load(input->reservations, database, output, progress);
+
+    __dataset_input_release(&input->reservations, &input->decompressors[3]);
+    return retval;
+}
+
+/**
+ * @brief   Evicts a single file from the page cache, or loads it into it.
+ * @details Auxiliary method for ::dataset_input_set_page_cache.
+ *
+ * @param file_path Path to the file.
+ * @param action    What to do to the file.
+ *
+ * @retval 0 Success, or the file doesn't exist.
+ * @retval 1 Failure (`errno` is set).
+ */
+int __dataset_input_set_file_page_cache(const char *file_path, dataset_input_page_cache_t action) {
+    /* Don't wait for a writer when opening a FIFO, that has nothing to be cached */
+    const int fd = open(file_path, O_RDONLY | O_NONBLOCK);
+    if (fd < 0)
+        return errno != ENOENT;
+
+    struct stat st;
+    int         retval = 0;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+        /* Not a regular file: nothing to do */
+    } else if (action == DATASET_INPUT_PAGE_CACHE_EVICT) {
+        const int error = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        if (error) {
+            errno  = error;
+            retval = 1;
+        }
+    } else {
+        char    buffer[DATASET_INPUT_WARM_BUFFER_SIZE];
+        ssize_t bytes;
+        while ((bytes = read(fd, buffer, DATASET_INPUT_WARM_BUFFER_SIZE)) != 0) {
+            if (bytes < 0 && errno != EINTR) {
+                retval = 1;
+                break;
+            }
+        }
+    }
+
+    close(fd);
+    return retval;
+}
+
+int dataset_input_set_page_cache(const char *path, dataset_input_page_cache_t action) {
+    const char *const extensions[3] = {"csv", "csv.gz", "csv.zst"};
+
+    char file_path[PATH_MAX];
+    for (size_t i = 0; i < DATASET_INPUT_FILE_COUNT; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+            snprintf(file_path,
+                     PATH_MAX,
+                     "%s/%s.%s",
+                     path,
+                     dataset_input_file_types[i],
+                     extensions[j]);
+            if (__dataset_input_set_file_page_cache(file_path, action))
+                return 1;
+        }
+    }
+
+    if (!dataset_snapshot_get_path(path, file_path) &&
+        __dataset_input_set_file_page_cache(file_path, action))
+        return 1;
+
+    snprintf(file_path, PATH_MAX, "%s/%s", path, DATASET_DELTA_LOG_FILE_NAME);
+    return __dataset_input_set_file_page_cache(file_path, action);
 }
 
 void dataset_input_free(dataset_input_t *input) {
-    fclose(input->users);
-    fclose(input->flights);
-    fclose(input->passengers);
-    fclose(input->reservations);
+    __dataset_input_release(&input->users, &input->decompressors[0]);
+    __dataset_input_release(&input->flights, &input->decompressors[1]);
+    __dataset_input_release(&input->passengers, &input->decompressors[2]);
+    __dataset_input_release(&input->reservations, &input->decompressors[3]);
+
+    /* With all pipes closed, the demultiplexer stops after reading its next line */
+    if (input->demultiplexer) {
+        dataset_input_wait(input);
+        free(input->demultiplexer);
+    }
 
+    if (input->flight_lines)
+        dataset_line_index_free(input->flight_lines);
     free(input);
 }
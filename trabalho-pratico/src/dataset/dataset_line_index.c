@@ -0,0 +1,177 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  dataset_line_index.c
+ * @brief Implementation of methods in include/dataset/dataset_line_index.h
+ *
+ * ### Example
+ * See [the header file's documentation](@ref dataset_line_index_examples).
+ */
+
+#include <errno.h>
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dataset/dataset_line_index.h"
+#include "utils/id_table.h"
+#include "utils/string_pool.h"
+
+/** @brief Block capacity of ::dataset_line_index::texts. */
+#define DATASET_LINE_INDEX_TEXTS_BLOCK_CAPACITY (1 << 20)
+
+/**
+ * @struct dataset_line_index_slice_t
+ * @brief  Position of a line in a file.
+ *
+ * @var dataset_line_index_slice_t::offset
+ *     @brief Offset of the first character of the line in the file.
+ * @var dataset_line_index_slice_t::length
+ *     @brief Length of the line, not including its delimiter.
+ * @var dataset_line_index_slice_t::text
+ *     @brief Copy of the line, in ::dataset_line_index::texts, or `NULL` if it must be read from
+ *            the file.
+ */
+typedef struct {
+    uint64_t    offset;
+    size_t      length;
+    const char *text;
+} dataset_line_index_slice_t;
+
+/**
+ * @struct dataset_line_index
+ * @brief  Map from identifiers to the positions of lines in a file.
+ *
+ * @var dataset_line_index::slots
+ *     @brief Map from identifiers to indices in ::dataset_line_index::slices.
+ * @var dataset_line_index::slices
+ *     @brief Position of every line (::dataset_line_index_slice_t) added to the index.
+ * @var dataset_line_index::texts
+ *     @brief Where copies of lines are kept, or `NULL` if they're read from the file.
+ */
+struct dataset_line_index {
+    id_table_t    *slots;
+    GArray        *slices;
+    string_pool_t *texts;
+};
+
+dataset_line_index_t *dataset_line_index_create(void) {
+    dataset_line_index_t *const index = malloc(sizeof(dataset_line_index_t));
+    if (!index)
+        return NULL;
+
+    index->slots = id_table_create(0);
+    if (!index->slots) {
+        free(index);
+        return NULL;
+    }
+
+    index->slices = g_array_new(FALSE, FALSE, sizeof(dataset_line_index_slice_t));
+    index->texts  = NULL;
+    return index;
+}
+
+dataset_line_index_t *dataset_line_index_create_in_memory(void) {
+    dataset_line_index_t *const index = dataset_line_index_create();
+    if (!index)
+        return NULL;
+
+    index->texts = string_pool_create(DATASET_LINE_INDEX_TEXTS_BLOCK_CAPACITY);
+    if (!index->texts) {
+        dataset_line_index_free(index);
+        return NULL;
+    }
+    return index;
+}
+
+int dataset_line_index_reserve(dataset_line_index_t *index, size_t count) {
+    return id_table_reserve(index->slots, count);
+}
+
+int dataset_line_index_add(dataset_line_index_t *index,
+                           uint32_t              id,
+                           uint64_t              offset,
+                           const char           *line,
+                           size_t                length) {
+
+    dataset_line_index_slice_t slice = {.offset = offset, .length = length, .text = NULL};
+    if (index->texts) {
+        char *const text = string_pool_allocate(index->texts, length);
+        if (!text)
+            return 1;
+
+        memcpy(text, line, length);
+        text[length] = '\0';
+        slice.text   = text;
+    }
+
+    uint32_t slot;
+    if (!id_table_lookup(index->slots, id, &slot)) {
+        g_array_index(index->slices, dataset_line_index_slice_t, slot) = slice;
+        return 0;
+    }
+
+    if (id_table_insert(index->slots, id, index->slices->len) == 1)
+        return 1;
+    g_array_append_val(index->slices, slice);
+    return 0;
+}
+
+char *dataset_line_index_read_line(const dataset_line_index_t *index, FILE *file, uint32_t id) {
+    uint32_t slot;
+    if (id_table_lookup(index->slots, id, &slot))
+        return NULL;
+
+    const dataset_line_index_slice_t *const slice =
+        &g_array_index(index->slices, dataset_line_index_slice_t, slot);
+    char *const line = malloc(slice->length + 1);
+    if (!line)
+        return NULL;
+
+    if (slice->text) {
+        memcpy(line, slice->text, slice->length + 1);
+        return line;
+    }
+
+    /* pread doesn't move the file's position, nor does it interfere with the stream's buffer */
+    size_t read_bytes = 0;
+    while (read_bytes < slice->length) {
+        const ssize_t nread = pread(fileno(file),
+                                    line + read_bytes,
+                                    slice->length - read_bytes,
+                                    slice->offset + read_bytes);
+        if (nread < 0 && errno == EINTR) {
+            continue;
+        } else if (nread <= 0) {
+            free(line);
+            return NULL;
+        }
+        read_bytes += nread;
+    }
+
+    line[slice->length] = '\0';
+    return line;
+}
+
+void dataset_line_index_free(dataset_line_index_t *index) {
+    id_table_free(index->slots);
+    g_array_unref(index->slices);
+    if (index->texts)
+        string_pool_free(index->texts);
+    free(index);
+}
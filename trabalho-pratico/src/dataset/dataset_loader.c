@@ -22,57 +22,555 @@
  * See [the header file's documentation](@ref dataset_loader_examples).
  */
 
+#include <pthread.h>
 #include <stdio.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
 
+#include "dataset/dataset_delta_log.h"
 #include "dataset/dataset_input.h"
 #include "dataset/dataset_loader.h"
+#include "dataset/dataset_snapshot.h"
+#include "testing/performance_probes.h"
+#include "testing/performance_trace.h"
 
-int dataset_loader_load(database_t            *database,
-                        const char            *dataset_path,
-                        const char            *errors_path,
-                        performance_metrics_t *metrics) {
+/**
+ * @struct dataset_loader_worker_t
+ * @brief  Data needed to load a single file of a dataset, possibly in its own thread.
+ *
+ * @var dataset_loader_worker_t::input
+ *     @brief Dataset input files.
+ * @var dataset_loader_worker_t::output
+ *     @brief Dataset error files.
+ * @var dataset_loader_worker_t::database
+ *     @brief Database where to add the loaded entities to.
+ * @var dataset_loader_worker_t::metrics
+ *     @brief Where to register performance data to. Can be `NULL` for no profiling.
+ * @var dataset_loader_worker_t::progress
+ *     @brief Where to register loading progress to. Can be `NULL`.
+ * @var dataset_loader_worker_t::step
+ *     @brief File of the dataset to be loaded.
+ * @var dataset_loader_worker_t::retval
+ *     @brief Value returned by the loader of ::dataset_loader_worker_t::step (`0` on success).
+ */
+typedef struct {
+    dataset_input_t                   *input;
+    dataset_error_output_t            *output;
+    database_t                        *database;
+    performance_metrics_t             *metrics;
+    dataset_progress_t                *progress;
+    performance_metrics_dataset_step_t step;
+    int                                retval;
+} dataset_loader_worker_t;
+
+/** @brief Names of the steps of loading a dataset, in a trace (see ::performance_trace_begin). */
+const char *const dataset_loader_trace_names[PERFORMANCE_METRICS_DATASET_STEP_DONE] = {
+    "Load users",
+    "Load flights",
+    "Load passengers",
+    "Load reservations"};
+
+/**
+ * @brief   Loads a file of a dataset, measuring the performance of doing so.
+ * @details Thread entry point, that can also be called directly.
+ *
+ * @param worker_data Pointer to a ::dataset_loader_worker_t, whose
+ *                    ::dataset_loader_worker_t::retval will be set.
+ *
+ * @return Always `NULL`.
+ */
+void *__dataset_loader_worker_run(void *worker_data) {
+    dataset_loader_worker_t *const worker = worker_data;
+
+    performance_trace_begin(worker->step < PERFORMANCE_METRICS_DATASET_STEP_DONE
+                                ? dataset_loader_trace_names[worker->step]
+                                : "Load");
+    performance_metrics_start_measuring_dataset(worker->metrics, worker->step);
+    performance_probe1(dataset_file_begin, (int) worker->step);
+    switch (worker->step) {
+        case PERFORMANCE_METRICS_DATASET_STEP_USERS:
+            worker->retval = dataset_input_load_users(worker->input,
+                                                      worker->output,
+                                                      worker->database,
+                                                      worker->progress);
+            break;
+        case PERFORMANCE_METRICS_DATASET_STEP_FLIGHTS:
+            worker->retval = dataset_input_load_flights(worker->input,
+                                                        worker->output,
+                                                        worker->database,
+                                                        worker->progress);
+            break;
+        case PERFORMANCE_METRICS_DATASET_STEP_PASSENGERS:
+            worker->retval = dataset_input_load_passengers(worker->input,
+                                                           worker->output,
+                                                           worker->database,
+                                                           worker->progress);
+            break;
+        case PERFORMANCE_METRICS_DATASET_STEP_RESERVATIONS:
+            worker->retval = dataset_input_load_reservations(worker->input,
+                                                             worker->output,
+                                                             worker->database,
+                                                             worker->progress);
+            break;
+        default:
+            worker->retval = 1; /* Invalid argument */
+            break;
+    }
+    performance_probe2(dataset_file_end, (int) worker->step, worker->retval);
+    performance_metrics_stop_measuring_dataset(worker->metrics, worker->step);
+    performance_trace_end();
+
+    return NULL;
+}
+
+/**
+ * @brief   Loads two files of a dataset at the same time.
+ * @details @p background is loaded in a new thread, while @p foreground is loaded in the calling
+ *          one. If a new thread can't be created, both files are loaded sequentially. The two files
+ *          can't modify the same parts of the database, nor output to the same error file.
+ *
+ * @param background File loaded in a new thread.
+ * @param foreground File loaded in the calling thread.
+ *
+ * @retval 0 Success.
+ * @retval 1 Fatal failure in either of the loaders.
+ */
+int __dataset_loader_load_in_parallel(dataset_loader_worker_t *background,
+                                      dataset_loader_worker_t *foreground) {
+
+    pthread_t thread;
+    const int thread_failure =
+        pthread_create(&thread, NULL, __dataset_loader_worker_run, background);
+    if (thread_failure)
+        __dataset_loader_worker_run(background); /* Fall back to sequential loading */
+
+    __dataset_loader_worker_run(foreground);
+
+    if (!thread_failure)
+        pthread_join(thread, NULL);
+
+    return background->retval || foreground->retval;
+}
+
+/**
+ * @brief   Freezes a database, recording it in the trace (see ::performance_trace_begin).
+ * @details Auxiliary method for ::__dataset_loader_freeze.
+ *
+ * @param database Database to be frozen.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __dataset_loader_freeze_traced(database_t *database) {
+    performance_trace_begin("Freeze");
+    const int retval = database_freeze(database);
+    performance_trace_end();
+    return retval;
+}
+
+/**
+ * @brief   Freezes a database that was just loaded, measuring how much memory that releases.
+ * @details Auxiliary method for ::__dataset_loader_load. See ::database_freeze.
+ *
+ * @param database Database to be frozen.
+ * @param metrics  Where to register memory usage to. Can be `NULL` for no profiling.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __dataset_loader_freeze(database_t *database, performance_metrics_t *metrics) {
+    if (!metrics)
+        return __dataset_loader_freeze_traced(database);
+
+    memory_usage_t   usage[2];
+    memory_report_t *report = database_get_memory_report(database);
+    if (report) {
+        memory_report_get_total(report, &usage[0]);
+        memory_report_free(report);
+    }
+
+    if (__dataset_loader_freeze_traced(database))
+        return 1;
+
+    /* Measuring is optional, so allocation failures aren't reported */
+    if (report) {
+        report = database_get_memory_report(database);
+        if (report) {
+            memory_report_get_total(report, &usage[1]);
+            memory_report_free(report);
+            performance_metrics_set_freeze_memory(metrics, &usage[0], &usage[1]);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief   Parses the files of a dataset into a database.
+ * @details Auxiliary method for ::__dataset_loader_load and ::__dataset_loader_replay_delta.
+ *
+ * @param database    Database to load the dataset into.
+ * @param input_files Files of the dataset.
+ * @param error_files Where to output dataset errors to.
+ * @param metrics     Where to register performance data to. Can be `NULL` for no profiling.
+ * @param progress    Where to register loading progress to. Can only be `NULL` if @p metrics is.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure.
+ */
+int __dataset_loader_parse(database_t             *database,
+                           dataset_input_t        *input_files,
+                           dataset_error_output_t *error_files,
+                           performance_metrics_t  *metrics,
+                           dataset_progress_t     *progress) {
+    /* Register how each file is read, so that the different input methods can be compared */
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i)
+        performance_metrics_set_dataset_input_method(metrics,
+                                                     i,
+                                                     dataset_input_get_method(input_files, i));
+    if (metrics)
+        dataset_progress_set_measuring_phases(progress, 1);
+
+    dataset_loader_worker_t workers[PERFORMANCE_METRICS_DATASET_STEP_DONE];
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i)
+        workers[i] = (dataset_loader_worker_t) {.input    = input_files,
+                                                .output   = error_files,
+                                                .database = database,
+                                                .metrics  = metrics,
+                                                .progress = progress,
+                                                .step     = i,
+                                                .retval   = 0};
+
+    /*
+     * Copy managers shared with clones of the database (see ::database_clone) before loading, so
+     * that parallel loaders don't race to do it. Nothing is reserved.
+     */
+    int retval = database_reserve_users(database, 0) || database_reserve_flights(database, 0) ||
+                 database_reserve_reservations(database, 0);
+
+    /*
+     * Users and flights are independent. Passengers and reservations depend on users (and on
+     * flights), but not on each other, and only modify disjoint parts of the user manager. Their
+     * associations to users are staged, and only added to users, in parallel, when freezing.
+     */
+    if (!retval)
+        retval = __dataset_loader_load_in_parallel(
+            &workers[PERFORMANCE_METRICS_DATASET_STEP_FLIGHTS],
+            &workers[PERFORMANCE_METRICS_DATASET_STEP_USERS]);
+    if (!retval) {
+        performance_trace_begin("Prepare user associations");
+        retval = database_prepare_user_associations(database);
+        performance_trace_end();
+    }
+    if (!retval)
+        retval = __dataset_loader_load_in_parallel(
+            &workers[PERFORMANCE_METRICS_DATASET_STEP_PASSENGERS],
+            &workers[PERFORMANCE_METRICS_DATASET_STEP_RESERVATIONS]);
+
+    /* Compare the estimates used to size the database with the real sizes of files */
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE && metrics; ++i) {
+        const size_t estimated = dataset_input_get_estimated_lines(input_files, i);
+        const size_t actual    = dataset_progress_get_lines(progress, i);
+        performance_metrics_set_dataset_line_counts(metrics, i, estimated, actual);
+
+        performance_metrics_dataset_breakdown_t breakdown = {
+            .bytes         = dataset_progress_get_read_bytes(progress, i),
+            .lines         = actual,
+            .invalid_lines = dataset_progress_get_rejected(progress, i)};
+        for (size_t j = 0; j < PERFORMANCE_METRICS_DATASET_PHASE_COUNT; ++j)
+            breakdown.phase_times[j] = dataset_progress_get_phase_time(progress, i, j);
+        performance_metrics_set_dataset_breakdown(metrics, i, &breakdown);
+    }
+
+    /* A load cancelled between files may have skipped some of them. Pausing also applies here. */
+    if (dataset_progress_checkpoint(progress))
+        retval = 1;
+
+    /* A multiplexed stream is only known to be well-formed after it's fully read */
+    if (!retval)
+        retval = dataset_input_wait(input_files);
+    return retval;
+}
+
+/**
+ * @brief   Checks if a snapshot of a database would be usable by other loads.
+ * @details Databases missing optional data can't be used by other runs, that may need it. Indexes
+ *          of reservations and flights are the exception: snapshots only store the delay medians,
+ *          when they're built.
+ *
+ * @param  database Frozen database.
+ * @return Whether @p database can be stored in a snapshot.
+ */
+int __dataset_loader_is_storable(const database_t *database) {
+    const database_data_t stored =
+        database_get_data(database) | DATABASE_DATA_HOTEL_INDEXES | DATABASE_DATA_FLIGHT_INDEXES;
+    return stored == DATABASE_DATA_ALL;
+}
+
+/**
+ * @struct dataset_loader_replay_t
+ * @brief  Where to replay the deltas of a log (see ::__dataset_loader_replay_delta).
+ *
+ * @var dataset_loader_replay_t::database
+ *     @brief Database restored from the snapshot the log applies to.
+ * @var dataset_loader_replay_t::output
+ *     @brief Where to output the errors of the deltas to.
+ */
+typedef struct {
+    database_t             *database;
+    dataset_error_output_t *output;
+} dataset_loader_replay_t;
+
+/**
+ * @brief   Replays a delta from a log, as in ::dataset_loader_load_delta.
+ * @details Callback for ::dataset_delta_log_replay.
+ *
+ * @param replay_data Pointer to a ::dataset_loader_replay_t.
+ * @param contents    Contents of the delta's files.
+ * @param lengths     Number of bytes in each element of @p contents.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (IO or allocation).
+ */
+int __dataset_loader_replay_delta(void             *replay_data,
+                                  const char *const contents[4],
+                                  const size_t      lengths[4]) {
+    dataset_loader_replay_t *const replay = replay_data;
+
+    dataset_input_t *const input_files = dataset_input_create_from_buffers(contents, lengths);
+    if (!input_files)
+        return 1;
+
+    /* Users and flights of the next delta may refer to the ones in this one */
+    const int retval =
+        __dataset_loader_parse(replay->database, input_files, replay->output, NULL, NULL) ||
+        __dataset_loader_freeze_traced(replay->database);
+    dataset_input_free(input_files);
+    return retval;
+}
+
+/**
+ * @brief   Compacts the delta log of a dataset in a background process.
+ * @details The process is forked, so that it stores the database as it is now (copy-on-write)
+ *          while the caller goes on, and orphaned, so that it doesn't need to be waited for.
+ *
+ * @param database     Frozen database, restored from a snapshot with @p info replayed.
+ * @param dataset_path Path to the directory containing the dataset.
+ * @param errors_path  Path to the directory containing the (already closed) error files.
+ * @param info         What was replayed from the log.
+ */
+void __dataset_loader_compact_in_background(const database_t               *database,
+                                            const char                     *dataset_path,
+                                            const char                     *errors_path,
+                                            const dataset_delta_log_info_t *info) {
+    const pid_t child = fork();
+    if (child == 0) {
+        const pid_t compactor = fork();
+        if (compactor == 0)
+            _exit(dataset_delta_log_compact(database, dataset_path, errors_path, info));
+        _exit(compactor < 0);
+    } else if (child > 0) {
+        waitpid(child, NULL, 0);
+    }
+}
+
+/**
+ * @brief   Loads a dataset into a database.
+ * @details Auxiliary method for ::dataset_loader_load, that can't be called with a `NULL`
+ *          @p progress if @p metrics aren't `NULL`, as that's where the lines of each file are
+ *          counted.
+ *
+ * @param database     Database to load the dataset into.
+ * @param dataset_path Path to the directory containing the dataset files.
+ * @param errors_path  Path to the directory where to write error files to. Can be `NULL`.
+ * @param metrics      Where to register performance data to. Can be `NULL` for no profiling.
+ * @param progress     Where to register loading progress to.
+ * @param delta        Whether the dataset is a delta (see ::dataset_loader_load_delta), that isn't
+ *                     restored from nor stored in a snapshot.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure.
+ */
+int __dataset_loader_load(database_t            *database,
+                          const char            *dataset_path,
+                          const char            *errors_path,
+                          performance_metrics_t *metrics,
+                          dataset_progress_t    *progress,
+                          int                    delta) {
 
     dataset_input_t *const input_files = dataset_input_create(dataset_path);
     if (!input_files)
         return 1;
 
-    dataset_error_output_t *const error_files = dataset_error_output_create(errors_path);
+    dataset_error_output_t *const error_files = dataset_error_output_create(errors_path, progress);
     if (!error_files) {
         dataset_input_free(input_files);
         return 1;
     }
 
-    /* Load dataset */
-    int retval = 0;
+    /*
+     * Restoring a previously loaded database is much faster than parsing the dataset again. A
+     * delta is added to existing data, that a snapshot would replace. Snapshots always hold whole
+     * datasets, so they're not used by partitions of one, nor for streams, whose contents can't be
+     * fingerprinted.
+     */
+    const int snapshots = !delta && database_get_partition_count(database) == 1 &&
+                          !dataset_input_is_streamed(input_files);
+    uint64_t snapshot_identifier = 0;
+    performance_trace_begin("Load snapshot");
+    const int snapshot_retval =
+        !snapshots ? DATASET_SNAPSHOT_LOAD_RET_UNUSABLE
+                   : dataset_snapshot_load(database,
+                                           dataset_path,
+                                           error_files,
+                                           errors_path != NULL,
+                                           &snapshot_identifier);
+    performance_trace_end();
+    if (snapshot_retval != DATASET_SNAPSHOT_LOAD_RET_UNUSABLE) {
+        dataset_input_free(input_files);
+        int retval = snapshot_retval != 0 || __dataset_loader_freeze(database, metrics);
 
-    performance_metrics_measure_dataset(metrics, PERFORMANCE_METRICS_DATASET_STEP_USERS);
-    if (dataset_input_load_users(input_files, error_files, database)) {
-        retval = 1;
-        goto CLEANUP;
-    }
+        /* Deltas appended to the snapshot's log are replayed on top of it */
+        dataset_delta_log_info_t replayed = {0};
+        if (!retval) {
+            dataset_loader_replay_t replay = {.database = database, .output = error_files};
+            performance_trace_begin("Replay deltas");
+            retval = dataset_delta_log_replay(dataset_path,
+                                              snapshot_identifier,
+                                              __dataset_loader_replay_delta,
+                                              &replay,
+                                              &replayed);
+            performance_trace_end();
+        }
+        dataset_error_output_free(error_files); /* Error files must be closed before compacting */
 
-    performance_metrics_measure_dataset(metrics, PERFORMANCE_METRICS_DATASET_STEP_FLIGHTS);
-    if (dataset_input_load_flights(input_files, error_files, database)) {
-        retval = 1;
-        goto CLEANUP;
+        /* Like a snapshot, a compacted one must have the errors other loads may need */
+        if (!retval && errors_path && __dataset_loader_is_storable(database) &&
+            dataset_delta_log_needs_compaction(dataset_path, &replayed))
+            __dataset_loader_compact_in_background(database, dataset_path, errors_path, &replayed);
+        return retval;
     }
 
-    performance_metrics_measure_dataset(metrics, PERFORMANCE_METRICS_DATASET_STEP_PASSENGERS);
-    if (dataset_input_load_passengers(input_files, error_files, database)) {
-        retval = 1;
-        goto CLEANUP;
+    int retval = __dataset_loader_parse(database, input_files, error_files, metrics, progress);
+    dataset_input_free(input_files);
+    dataset_error_output_free(error_files); /* Error files must be closed before the snapshot */
+
+    if (!retval)
+        retval = __dataset_loader_freeze(database, metrics);
+
+    /*
+     * Failing to store a snapshot only makes the next load slower. Storing a new one makes the
+     * deltas in the log of the previous one stale.
+     */
+    if (!retval && snapshots && __dataset_loader_is_storable(database)) {
+        performance_trace_begin("Save snapshot");
+        dataset_snapshot_save(database, dataset_path, errors_path);
+        performance_trace_end();
     }
+    return retval;
+}
 
-    performance_metrics_measure_dataset(metrics, PERFORMANCE_METRICS_DATASET_STEP_RESERVATIONS);
-    if (dataset_input_load_reservations(input_files, error_files, database)) {
-        retval = 1;
-        goto CLEANUP;
+/**
+ * @brief  Gets the current wall-clock time, to measure how long loading a dataset takes.
+ * @return The value of `CLOCK_MONOTONIC`, in microseconds.
+ */
+uint64_t __dataset_loader_get_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * @brief   Loads a dataset into a database, counting lines for @p metrics.
+ * @details Auxiliary method for ::dataset_loader_load and ::dataset_loader_load_delta. See
+ *          ::__dataset_loader_load for the parameters.
+ */
+int __dataset_loader_load_with_progress(database_t            *database,
+                                        const char            *dataset_path,
+                                        const char            *errors_path,
+                                        performance_metrics_t *metrics,
+                                        dataset_progress_t    *progress,
+                                        int                    delta) {
+
+    const uint64_t start = __dataset_loader_get_time();
+    int            retval;
+    if (progress || !metrics) {
+        retval =
+            __dataset_loader_load(database, dataset_path, errors_path, metrics, progress, delta);
+    } else {
+        /* Lines need to be counted for the metrics, even if the caller isn't observing progress */
+        dataset_progress_t *const own_progress = dataset_progress_create();
+        if (!own_progress)
+            return 1;
+
+        retval = __dataset_loader_load(database,
+                                       dataset_path,
+                                       errors_path,
+                                       metrics,
+                                       own_progress,
+                                       delta);
+        dataset_progress_free(own_progress);
     }
 
-    performance_metrics_measure_dataset(metrics, PERFORMANCE_METRICS_DATASET_STEP_DONE);
+    performance_metrics_set_dataset_wall_time(metrics, __dataset_loader_get_time() - start);
+    return retval;
+}
 
-CLEANUP:
-    dataset_input_free(input_files);
+int dataset_loader_load(database_t            *database,
+                        const char            *dataset_path,
+                        const char            *errors_path,
+                        performance_metrics_t *metrics,
+                        dataset_progress_t    *progress) {
+
+    return __dataset_loader_load_with_progress(database,
+                                               dataset_path,
+                                               errors_path,
+                                               metrics,
+                                               progress,
+                                               0);
+}
+
+int dataset_loader_load_delta(database_t            *database,
+                              const char            *delta_path,
+                              const char            *errors_path,
+                              performance_metrics_t *metrics,
+                              dataset_progress_t    *progress) {
+
+    return __dataset_loader_load_with_progress(database,
+                                               delta_path,
+                                               errors_path,
+                                               metrics,
+                                               progress,
+                                               1);
+}
+
+int dataset_loader_append_delta(database_t            *database,
+                                const char            *dataset_path,
+                                const char            *delta_path,
+                                const char            *errors_path,
+                                performance_metrics_t *metrics,
+                                dataset_progress_t    *progress) {
+
+    if (dataset_loader_load_delta(database, delta_path, errors_path, metrics, progress))
+        return 1;
+
+    performance_trace_begin("Append delta");
+    const int retval = dataset_delta_log_append(dataset_path, delta_path);
+    performance_trace_end();
+    return retval ? DATASET_LOADER_APPEND_RET_NOT_LOGGED : 0;
+}
+
+int dataset_loader_load_shipped(database_t *database, const char *directory) {
+    dataset_error_output_t *const error_files = dataset_error_output_create(NULL, NULL);
+    if (!error_files)
+        return 1;
+
+    performance_trace_begin("Load snapshot");
+    const int retval = dataset_snapshot_load_shipped(database, directory, error_files);
+    performance_trace_end();
     dataset_error_output_free(error_files);
-    return retval;
+
+    if (retval == DATASET_SNAPSHOT_LOAD_RET_UNUSABLE)
+        fputs("The shipped snapshot is corrupted, or was written by another machine!\n", stderr);
+    return retval != 0 || __dataset_loader_freeze(database, NULL);
 }
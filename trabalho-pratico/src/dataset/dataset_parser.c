@@ -24,9 +24,28 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "dataset/dataset_parser.h"
 #include "utils/stream_utils.h"
+#include "utils/thread_pool.h"
+
+/** @brief Minimum size of a chunk of a file, so that small files aren't split into chunks. */
+#define DATASET_PARSER_MIN_CHUNK_SIZE (1 << 22)
+
+/** @brief Maximum number of chunks ::dataset_parser_get_chunk_count divides a file into. */
+#define DATASET_PARSER_MAX_CHUNKS 16
+
+/** @brief Size of the sample at the beginning of a file in ::dataset_parser_estimate_line_count. */
+#define DATASET_PARSER_ESTIMATE_SAMPLE_SIZE (1 << 16)
+
+/** @brief Number of lines between updates of a parser's progress. */
+#define DATASET_PARSER_PROGRESS_INTERVAL 4096
+
+/** @brief Initial size of the buffer where a batch parser copies the tokens of each batch. */
+#define DATASET_PARSER_BATCH_BUFFER_SIZE 8192
 
 /**
  * @struct dataset_parser_grammar
@@ -34,18 +53,42 @@
  *
  * @var dataset_parser_grammar::token_grammar
  *     @brief Grammar to use to parse single tokens with ::fixed_n_delimiter_parser_parse_string.
+ *            `NULL` for batch parsers.
+ * @var dataset_parser_grammar::token_parser
+ *     @brief Parser specialized for ::dataset_parser_grammar::token_grammar, used instead of it
+ *            when not `NULL`.
  * @var dataset_parser_grammar::before_parse_callback
- *     @brief Callback called before parsing each token.
+ *     @brief Callback called before parsing each token. `NULL` for batch parsers.
  * @var dataset_parser_grammar::token_callback
- *     @brief Callback called after processing each token.
+ *     @brief Callback called after processing each token. `NULL` for batch parsers.
+ * @var dataset_parser_grammar::column_callbacks
+ *     @brief Callback for each column of a batch of tokens. `NULL` for parsers that aren't batch
+ *            parsers.
+ * @var dataset_parser_grammar::ncolumns
+ *     @brief Number of elements in ::dataset_parser_grammar::column_callbacks.
+ * @var dataset_parser_grammar::batch_callback
+ *     @brief Callback called after all columns of a batch of tokens are parsed. `NULL` for parsers
+ *            that aren't batch parsers.
+ * @var dataset_parser_grammar::progress
+ *     @brief Where to register parsing progress to (can be `NULL`). Not owned by this `struct`.
+ * @var dataset_parser_grammar::step
+ *     @brief Step of dataset loading to register progress in.
  * @var dataset_parser_grammar::delimiter
  *     @brief Separator between first-order tokens (e.g.: ``'\n'`` for CSV files).
+ * @var dataset_parser_grammar::column_delimiter
+ *     @brief Separator between the columns of each first-order token, in batch parsers.
  */
 struct dataset_parser_grammar {
     fixed_n_delimiter_parser_grammar_t        *token_grammar;
+    fixed_n_delimiter_parser_specialized_t     token_parser;
     dataset_parser_token_before_parse_callback before_parse_callback;
     dataset_parser_token_callback              token_callback;
-    char                                       delimiter;
+    dataset_parser_column_callback            *column_callbacks;
+    size_t                                     ncolumns;
+    dataset_parser_batch_callback              batch_callback;
+    dataset_progress_t                        *progress;
+    performance_metrics_dataset_step_t         step;
+    char                                       delimiter, column_delimiter;
 };
 
 /**
@@ -57,10 +100,49 @@ struct dataset_parser_grammar {
  * @var dataset_parser_t::user_data
  *     @brief   Data to be passed to callbacks in ::dataset_parser_t::grammar
  *     @details Not owned by this `struct`.
+ * @var dataset_parser_t::pending_lines
+ *     @brief Number of lines parsed since progress was last registered.
+ * @var dataset_parser_t::pending_bytes
+ *     @brief Number of bytes parsed since progress was last registered.
+ * @var dataset_parser_t::measuring_phases
+ *     @brief Whether to measure the time of each sub-phase of parsing (see
+ *            ::dataset_progress_set_measuring_phases).
+ * @var dataset_parser_t::last_time
+ *     @brief When the last line was done being processed, if measuring sub-phases.
+ * @var dataset_parser_t::pending_phase_times
+ *     @brief Time spent in each sub-phase since progress was last registered.
+ * @var dataset_parser_t::batch_buffer
+ *     @brief   Copies of the tokens in the current batch, each followed by a `'\0'` terminator.
+ *     @details Tokens must be copied, as the tokenizer doesn't keep them after each callback.
+ *              Only allocated for batch parsers, when the first token is read.
+ * @var dataset_parser_t::batch_used
+ *     @brief Number of bytes used in ::dataset_parser_t::batch_buffer.
+ * @var dataset_parser_t::batch_capacity
+ *     @brief Number of bytes allocated for ::dataset_parser_t::batch_buffer.
+ * @var dataset_parser_t::batch_rows
+ *     @brief Number of tokens in the current batch.
+ * @var dataset_parser_t::batch_starts
+ *     @brief Offset of each token of the current batch in ::dataset_parser_t::batch_buffer.
+ * @var dataset_parser_t::batch_lengths
+ *     @brief Length of each token of the current batch.
+ * @var dataset_parser_t::batch_columns
+ *     @brief   Matrix of the columns of each token in the current batch.
+ *     @details Stored column by column: column `j` of token `i` is at index
+ *              `j * DATASET_PARSER_BATCH_SIZE + i`. Allocated along with
+ *              ::dataset_parser_t::batch_buffer.
  */
 typedef struct {
-    const dataset_parser_grammar_t *const grammar;
-    void *const                           user_data;
+    const dataset_parser_grammar_t *grammar;
+    void                           *user_data;
+    size_t                          pending_lines, pending_bytes;
+    int                             measuring_phases;
+    uint64_t                        last_time;
+    uint64_t pending_phase_times[PERFORMANCE_METRICS_DATASET_PHASE_COUNT];
+
+    char  *batch_buffer;
+    size_t batch_used, batch_capacity, batch_rows;
+    size_t batch_starts[DATASET_PARSER_BATCH_SIZE], batch_lengths[DATASET_PARSER_BATCH_SIZE];
+    char **batch_columns;
 } dataset_parser_t;
 
 dataset_parser_grammar_t *
@@ -80,9 +162,67 @@ dataset_parser_grammar_t *
         return NULL;
     }
 
+    grammar->token_parser          = NULL;
     grammar->delimiter             = first_order_delimiter;
+    grammar->column_delimiter      = '\0';
     grammar->before_parse_callback = before_parse_callback;
     grammar->token_callback        = token_callback;
+    grammar->column_callbacks      = NULL;
+    grammar->ncolumns              = 0;
+    grammar->batch_callback        = NULL;
+    grammar->progress              = NULL;
+    grammar->step                  = PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED;
+    return grammar;
+}
+
+dataset_parser_grammar_t *dataset_parser_grammar_new_specialized(
+    char                                       first_order_delimiter,
+    const fixed_n_delimiter_parser_grammar_t  *token_grammar,
+    fixed_n_delimiter_parser_specialized_t     token_parser,
+    dataset_parser_token_before_parse_callback before_parse_callback,
+    dataset_parser_token_callback              token_callback) {
+
+    dataset_parser_grammar_t *const grammar = dataset_parser_grammar_new(first_order_delimiter,
+                                                                         token_grammar,
+                                                                         before_parse_callback,
+                                                                         token_callback);
+    if (!grammar)
+        return NULL;
+
+    const char *const environment = getenv(DATASET_PARSER_GENERIC_ENVIRONMENT_VARIABLE);
+    if (!(environment && strcmp(environment, "1") == 0))
+        grammar->token_parser = token_parser;
+    return grammar;
+}
+
+dataset_parser_grammar_t *
+    dataset_parser_grammar_new_batch(char                                 first_order_delimiter,
+                                     char                                 column_delimiter,
+                                     size_t                               n,
+                                     const dataset_parser_column_callback column_callbacks[n],
+                                     dataset_parser_batch_callback        batch_callback) {
+
+    dataset_parser_grammar_t *const grammar = malloc(sizeof(dataset_parser_grammar_t));
+    if (!grammar)
+        return NULL;
+
+    grammar->column_callbacks = malloc(n * sizeof(dataset_parser_column_callback));
+    if (!grammar->column_callbacks) {
+        free(grammar);
+        return NULL;
+    }
+    memcpy(grammar->column_callbacks, column_callbacks, n * sizeof(dataset_parser_column_callback));
+
+    grammar->token_grammar         = NULL;
+    grammar->token_parser          = NULL;
+    grammar->delimiter             = first_order_delimiter;
+    grammar->column_delimiter      = column_delimiter;
+    grammar->before_parse_callback = NULL;
+    grammar->token_callback        = NULL;
+    grammar->ncolumns              = n;
+    grammar->batch_callback        = batch_callback;
+    grammar->progress              = NULL;
+    grammar->step                  = PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED;
     return grammar;
 }
 
@@ -92,47 +232,448 @@ dataset_parser_grammar_t *dataset_parser_grammar_clone(const dataset_parser_gram
         return NULL;
 
     memcpy(new_grammar, grammar, sizeof(dataset_parser_grammar_t));
-    new_grammar->token_grammar = fixed_n_delimiter_parser_grammar_clone(grammar->token_grammar);
-    if (!new_grammar->token_grammar) {
-        free(new_grammar);
-        return NULL;
+    if (grammar->batch_callback) {
+        const size_t size             = grammar->ncolumns * sizeof(dataset_parser_column_callback);
+        new_grammar->column_callbacks = malloc(size);
+        if (!new_grammar->column_callbacks) {
+            free(new_grammar);
+            return NULL;
+        }
+        memcpy(new_grammar->column_callbacks, grammar->column_callbacks, size);
+    } else {
+        new_grammar->token_grammar = fixed_n_delimiter_parser_grammar_clone(grammar->token_grammar);
+        if (!new_grammar->token_grammar) {
+            free(new_grammar);
+            return NULL;
+        }
     }
 
     return new_grammar;
 }
 
 void dataset_parser_grammar_free(dataset_parser_grammar_t *grammar) {
-    fixed_n_delimiter_parser_grammar_free(grammar->token_grammar);
+    if (grammar->token_grammar)
+        fixed_n_delimiter_parser_grammar_free(grammar->token_grammar);
+    free(grammar->column_callbacks);
     free(grammar);
 }
 
+void dataset_parser_grammar_set_progress(dataset_parser_grammar_t          *grammar,
+                                         dataset_progress_t                *progress,
+                                         performance_metrics_dataset_step_t step) {
+    grammar->progress = progress;
+    grammar->step     = step;
+}
+
+/**
+ * @brief  Gets the current time, for measuring sub-phases of parsing.
+ * @return The value of a monotonic clock, in nanoseconds.
+ */
+uint64_t __dataset_parser_get_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * @brief  Creates the state of a parser.
+ *
+ * @param grammar   Grammar that defines the parser.
+ * @param user_data Data to be passed to callbacks in @p grammar.
+ *
+ * @return The state of a parser that hasn't parsed anything yet.
+ */
+dataset_parser_t __dataset_parser_create(const dataset_parser_grammar_t *grammar,
+                                         void                           *user_data) {
+    dataset_parser_t parser = {.grammar             = grammar,
+                               .user_data           = user_data,
+                               .pending_lines       = 0,
+                               .pending_bytes       = 0,
+                               .measuring_phases    = 0,
+                               .last_time           = 0,
+                               .pending_phase_times = {0},
+                               .batch_buffer        = NULL,
+                               .batch_used          = 0,
+                               .batch_capacity      = 0,
+                               .batch_rows          = 0,
+                               .batch_columns       = NULL};
+
+    if (dataset_progress_is_measuring_phases(grammar->progress)) {
+        parser.measuring_phases = 1;
+        parser.last_time        = __dataset_parser_get_time();
+    }
+    return parser;
+}
+
+/**
+ * @brief Frees memory used by the state of a parser, created by ::__dataset_parser_create.
+ * @param parser Parser whose batch buffers are freed.
+ */
+void __dataset_parser_free(dataset_parser_t *parser) {
+    free(parser->batch_buffer);
+    free(parser->batch_columns);
+}
+
+/**
+ * @brief   Registers the lines parsed by @p parser since the last call in its grammar's progress.
+ * @details Also waits while loading is paused (see ::dataset_progress_checkpoint).
+ * @param   parser Parser whose progress is registered.
+ * @retval  0 Success.
+ * @retval  1 Parsing has been cancelled.
+ */
+int __dataset_parser_flush_progress(dataset_parser_t *parser) {
+    dataset_progress_add_lines(parser->grammar->progress,
+                               parser->grammar->step,
+                               parser->pending_lines,
+                               parser->pending_bytes);
+    parser->pending_lines = parser->pending_bytes = 0;
+
+    if (parser->measuring_phases) {
+        dataset_progress_add_phase_times(parser->grammar->progress,
+                                         parser->grammar->step,
+                                         parser->pending_phase_times);
+        for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_PHASE_COUNT; ++i)
+            parser->pending_phase_times[i] = 0;
+    }
+
+    return dataset_progress_checkpoint(parser->grammar->progress);
+}
+
+/**
+ * @brief   Adds the time since the last measurement to a sub-phase of parsing.
+ * @details Auxiliary function for ::__parse_stream_iter.
+ *
+ * @param parser Parser measuring sub-phases.
+ * @param phase  Sub-phase that just ended.
+ */
+void __dataset_parser_end_phase(dataset_parser_t                   *parser,
+                                performance_metrics_dataset_phase_t phase) {
+    const uint64_t now = __dataset_parser_get_time();
+    parser->pending_phase_times[phase] += now - parser->last_time;
+    parser->last_time = now;
+}
+
 /**
  * @brief   Callback for every token parsed.
  * @details Auxiliary function for ::dataset_parser_parse, responsible for calling
- *          ::fixed_n_delimiter_parser_parse_string with the correct data.
+ *          ::fixed_n_delimiter_parser_parse_string with the correct data. When measuring
+ *          sub-phases, the time since the previous line was processed is attributed to reading the
+ *          file.
  *
  * @param user_data A pointer to a ::dataset_parser_t.
  * @param token     The token to be parsed.
+ * @param length    Length of @p token.
  */
-int __parse_stream_iter(void *user_data, char *token) {
+int __parse_stream_iter(void *user_data, char *token, size_t length) {
     dataset_parser_t *const parser = user_data;
+    if (parser->measuring_phases)
+        __dataset_parser_end_phase(parser, PERFORMANCE_METRICS_DATASET_PHASE_INPUT);
 
-    const int before_parse_ret = parser->grammar->before_parse_callback(parser->user_data, token);
+    if (parser->grammar->progress) {
+        parser->pending_bytes += length + 1; /* Include delimiter */
+        if (++parser->pending_lines == DATASET_PARSER_PROGRESS_INTERVAL &&
+            __dataset_parser_flush_progress(parser))
+            return DATASET_PARSER_PARSE_RET_CANCELLED;
+    }
+
+    const int before_parse_ret =
+        parser->grammar->before_parse_callback(parser->user_data, token, length);
     if (before_parse_ret)
         return before_parse_ret;
 
-    const int parser_ret = fixed_n_delimiter_parser_parse_string(token,
-                                                                 parser->grammar->token_grammar,
-                                                                 parser->user_data);
-    return parser->grammar->token_callback(parser->user_data, parser_ret);
+    const int parser_ret =
+        parser->grammar->token_parser
+            ? parser->grammar->token_parser(token, length, parser->user_data)
+            : fixed_n_delimiter_parser_parse_slice(token,
+                                                   length,
+                                                   parser->grammar->token_grammar,
+                                                   parser->user_data);
+    if (!parser->measuring_phases)
+        return parser->grammar->token_callback(parser->user_data, parser_ret);
+
+    __dataset_parser_end_phase(parser, PERFORMANCE_METRICS_DATASET_PHASE_FIELDS);
+    const int retval = parser->grammar->token_callback(parser->user_data, parser_ret);
+    __dataset_parser_end_phase(parser,
+                               parser_ret ? PERFORMANCE_METRICS_DATASET_PHASE_ERRORS
+                                          : PERFORMANCE_METRICS_DATASET_PHASE_INSERTION);
+    return retval;
 }
 
-int dataset_parser_parse(FILE *file, const dataset_parser_grammar_t *grammar, void *user_data) {
-    dataset_parser_t parser = {.grammar = grammar, .user_data = user_data};
+/**
+ * @brief   Splits every token of the current batch of a parser into its columns.
+ * @details Auxiliary method for ::__dataset_parser_flush_batch. Column delimiters are replaced by
+ *          `'\0'`, and tokens with too few columns get empty strings for the missing ones. Tokens
+ *          with too many columns have the rest of the token in their last column.
+ *
+ * @param parser   Parser whose batch is split.
+ * @param lines    Where to write a pointer to each token in the batch to.
+ * @param ncolumns Where to write the number of columns found in each token to (at most the
+ *                 number of columns in the grammar).
+ *
+ * @return A mask of the tokens with the right number of columns (bit `i` for token `i`).
+ */
+uint64_t __dataset_parser_split_batch(dataset_parser_t *parser,
+                                      char             *lines[DATASET_PARSER_BATCH_SIZE],
+                                      size_t            ncolumns[DATASET_PARSER_BATCH_SIZE]) {
+    const size_t n         = parser->grammar->ncolumns;
+    const char   delimiter = parser->grammar->column_delimiter;
+    char **const columns   = parser->batch_columns;
+
+    uint64_t valid = 0;
+    for (size_t i = 0; i < parser->batch_rows; ++i) {
+        char *const line = parser->batch_buffer + parser->batch_starts[i];
+        char *const end  = line + parser->batch_lengths[i];
+        lines[i]         = line;
+
+        size_t j     = 0;
+        char  *token = line;
+        for (;;) {
+            columns[j++ * DATASET_PARSER_BATCH_SIZE + i] = token;
+
+            char *const next = memchr(token, delimiter, end - token);
+            if (!next) {
+                valid |= (uint64_t) (j == n) << i;
+                break;
+            } else if (j == n) {
+                break; /* Too many columns */
+            }
+
+            *next = '\0';
+            token = next + 1;
+        }
+
+        ncolumns[i] = j;
+        for (; j < n; ++j)
+            columns[j * DATASET_PARSER_BATCH_SIZE + i] = end; /* Empty string */
+    }
+
+    return valid;
+}
+
+/**
+ * @brief   Parses the current batch of a batch parser, column by column.
+ * @details Each column callback is called for all tokens in the batch, and the tokens with the
+ *          right number of columns and valid data in every column are the ones that pass the
+ *          bitwise AND of all masks. Column delimiters are then restored, and the batch callback is
+ *          called with the original tokens. When measuring sub-phases, the batch callback's time is
+ *          attributed to insertion, as it also reports errors.
+ *
+ * @param parser Batch parser whose batch is parsed and emptied.
+ *
+ * @return `0` on success, or the value returned by the batch callback.
+ */
+int __dataset_parser_flush_batch(dataset_parser_t *parser) {
+    const dataset_parser_grammar_t *const grammar = parser->grammar;
+    const size_t                          nrows   = parser->batch_rows;
+    if (!nrows)
+        return 0;
+
+    if (parser->measuring_phases)
+        __dataset_parser_end_phase(parser, PERFORMANCE_METRICS_DATASET_PHASE_INPUT);
 
-    const int retval = stream_tokenize(file, grammar->delimiter, __parse_stream_iter, &parser);
+    char    *lines[DATASET_PARSER_BATCH_SIZE];
+    size_t   ncolumns[DATASET_PARSER_BATCH_SIZE];
+    uint64_t valid = __dataset_parser_split_batch(parser, lines, ncolumns);
+
+    for (size_t j = 0; j < grammar->ncolumns; ++j)
+        valid &= grammar->column_callbacks[j](parser->user_data,
+                                              parser->batch_columns + j * DATASET_PARSER_BATCH_SIZE,
+                                              nrows,
+                                              j);
+
+    /* Restore tokens: every column but the first one comes after a replaced delimiter */
+    char **const columns = parser->batch_columns;
+    for (size_t i = 0; i < nrows; ++i)
+        for (size_t j = 1; j < ncolumns[i]; ++j)
+            columns[j * DATASET_PARSER_BATCH_SIZE + i][-1] = grammar->column_delimiter;
+
+    if (parser->measuring_phases)
+        __dataset_parser_end_phase(parser, PERFORMANCE_METRICS_DATASET_PHASE_FIELDS);
+
+    const int retval = grammar->batch_callback(parser->user_data,
+                                               lines,
+                                               parser->batch_lengths,
+                                               nrows,
+                                               valid);
+    parser->batch_rows = parser->batch_used = 0;
+
+    if (parser->measuring_phases)
+        __dataset_parser_end_phase(parser, PERFORMANCE_METRICS_DATASET_PHASE_INSERTION);
+    return retval;
+}
+
+/**
+ * @brief   Callback for every token read by a batch parser.
+ * @details Auxiliary function for ::dataset_parser_parse. The token is copied to the current
+ *          batch, that is parsed when full.
+ *
+ * @param user_data A pointer to a ::dataset_parser_t.
+ * @param token     The token to be parsed.
+ * @param length    Length of @p token.
+ *
+ * @return `0` on success, ::DATASET_PARSER_PARSE_RET_ALLOCATION_FAILURE, or the value returned by
+ *         the batch callback.
+ */
+int __parse_stream_batch_iter(void *user_data, char *token, size_t length) {
+    dataset_parser_t *const parser = user_data;
+
+    if (parser->grammar->progress) {
+        parser->pending_bytes += length + 1; /* Include delimiter */
+        if (++parser->pending_lines == DATASET_PARSER_PROGRESS_INTERVAL &&
+            __dataset_parser_flush_progress(parser))
+            return DATASET_PARSER_PARSE_RET_CANCELLED;
+    }
+
+    if (!parser->batch_columns) {
+        parser->batch_columns =
+            malloc(parser->grammar->ncolumns * DATASET_PARSER_BATCH_SIZE * sizeof(char *));
+        if (!parser->batch_columns)
+            return DATASET_PARSER_PARSE_RET_ALLOCATION_FAILURE;
+    }
+
+    if (parser->batch_used + length + 1 > parser->batch_capacity) {
+        size_t new_capacity = parser->batch_capacity ? parser->batch_capacity * 2
+                                                     : DATASET_PARSER_BATCH_BUFFER_SIZE;
+        while (parser->batch_used + length + 1 > new_capacity)
+            new_capacity *= 2;
+
+        char *const new_buffer = realloc(parser->batch_buffer, new_capacity);
+        if (!new_buffer)
+            return DATASET_PARSER_PARSE_RET_ALLOCATION_FAILURE;
+        parser->batch_buffer   = new_buffer;
+        parser->batch_capacity = new_capacity;
+    }
+
+    memcpy(parser->batch_buffer + parser->batch_used, token, length);
+    parser->batch_buffer[parser->batch_used + length] = '\0';
+
+    parser->batch_starts[parser->batch_rows]  = parser->batch_used;
+    parser->batch_lengths[parser->batch_rows] = length;
+    parser->batch_used += length + 1;
+
+    if (++parser->batch_rows == DATASET_PARSER_BATCH_SIZE)
+        return __dataset_parser_flush_batch(parser);
+    return 0;
+}
+
+/**
+ * @brief  Converts a value returned by a method in [stream_utils](@ref stream_utils.h) into one
+ *         returned by ::dataset_parser_parse.
+ * @param  retval Value returned by the tokenizer.
+ * @return The value to be returned by the dataset parser.
+ */
+int __dataset_parser_tokenizer_retval(int retval) {
     if (retval == STREAM_TOKENIZE_RET_ALLOCATION_FAILURE)
         return DATASET_PARSER_PARSE_RET_ALLOCATION_FAILURE;
+    else if (retval == STREAM_TOKENIZE_RET_IO_FAILURE)
+        return DATASET_PARSER_PARSE_RET_IO_FAILURE;
 
-    return 0;
+    return retval;
+}
+
+/**
+ * @brief Registers the size of a file about to be parsed in the progress of @p grammar.
+ *
+ * @param file    File to be parsed.
+ * @param grammar Grammar of the parser for @p file.
+ */
+void __dataset_parser_start_progress(FILE *file, const dataset_parser_grammar_t *grammar) {
+    struct stat st;
+    if (grammar->progress && !fstat(fileno(file), &st) && S_ISREG(st.st_mode))
+        dataset_progress_add_total_bytes(grammar->progress, grammar->step, st.st_size);
+}
+
+int dataset_parser_parse(FILE *file, const dataset_parser_grammar_t *grammar, void *user_data) {
+    dataset_parser_t parser = __dataset_parser_create(grammar, user_data);
+    __dataset_parser_start_progress(file, grammar);
+
+    int retval = stream_tokenize_slices(file,
+                                        grammar->delimiter,
+                                        grammar->batch_callback ? __parse_stream_batch_iter
+                                                                : __parse_stream_iter,
+                                        &parser);
+    if (parser.measuring_phases) /* Reading after the last line */
+        __dataset_parser_end_phase(&parser, PERFORMANCE_METRICS_DATASET_PHASE_INPUT);
+    if (!retval)
+        retval = __dataset_parser_flush_batch(&parser);
+    if (grammar->progress && __dataset_parser_flush_progress(&parser) && !retval)
+        retval = DATASET_PARSER_PARSE_RET_CANCELLED;
+
+    __dataset_parser_free(&parser);
+    return __dataset_parser_tokenizer_retval(retval);
+}
+
+size_t dataset_parser_get_chunk_count(FILE *file) {
+    struct stat st;
+    if (stream_tokenize_get_method(file) != STREAM_TOKENIZE_METHOD_MMAP || fstat(fileno(file), &st))
+        return 1;
+
+    const size_t threads = thread_pool_get_stage_thread_count(THREAD_POOL_STAGE_LOAD);
+    size_t       n       = st.st_size / DATASET_PARSER_MIN_CHUNK_SIZE;
+    if (n > threads)
+        n = threads;
+
+    if (n > DATASET_PARSER_MAX_CHUNKS)
+        n = DATASET_PARSER_MAX_CHUNKS;
+    else if (n == 0)
+        n = 1;
+
+    return n;
+}
+
+size_t dataset_parser_estimate_line_count(FILE *file) {
+    struct stat st;
+    if (fstat(fileno(file), &st) || !S_ISREG(st.st_mode) || st.st_size == 0)
+        return 0;
+
+    /* pread doesn't move the file's position, nor does it interfere with the stream's buffer */
+    char          sample[DATASET_PARSER_ESTIMATE_SAMPLE_SIZE];
+    const ssize_t sampled = pread(fileno(file), sample, sizeof(sample), 0);
+    if (sampled <= 0)
+        return 0;
+
+    size_t      lines = 0;
+    const char *end   = sample + sampled;
+    for (const char *c = sample; (c = memchr(c, '\n', end - c)); ++c)
+        lines++;
+
+    if (sampled == st.st_size) /* Whole file sampled: exact count */
+        return lines + (sample[sampled - 1] != '\n');
+    else if (lines == 0) /* Lines longer than the sample */
+        return 1;
+
+    return (size_t) ((double) st.st_size * lines / sampled);
+}
+
+int dataset_parser_parse_chunked(FILE                           *file,
+                                 const dataset_parser_grammar_t *grammar,
+                                 size_t                          n,
+                                 void *const                     user_data[n]) {
+
+    dataset_parser_t parsers[n];
+    void            *parsers_data[n];
+    for (size_t i = 0; i < n; ++i) {
+        parsers[i]      = __dataset_parser_create(grammar, user_data[i]);
+        parsers_data[i] = &parsers[i];
+    }
+    __dataset_parser_start_progress(file, grammar);
+
+    int retval = stream_tokenize_slices_chunked(file,
+                                                grammar->delimiter,
+                                                n,
+                                                grammar->batch_callback ? __parse_stream_batch_iter
+                                                                        : __parse_stream_iter,
+                                                parsers_data);
+
+    /* The last batch of each chunk is parsed in this thread, still with its chunk's user_data */
+    for (size_t i = 0; i < n && !retval; ++i)
+        retval = __dataset_parser_flush_batch(&parsers[i]);
+
+    for (size_t i = 0; i < n; ++i) {
+        if (grammar->progress && __dataset_parser_flush_progress(&parsers[i]) && !retval)
+            retval = DATASET_PARSER_PARSE_RET_CANCELLED;
+        __dataset_parser_free(&parsers[i]);
+    }
+
+    return __dataset_parser_tokenizer_retval(retval);
 }
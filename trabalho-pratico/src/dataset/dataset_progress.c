@@ -0,0 +1,244 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  dataset_progress.c
+ * @brief Implementation of methods in include/dataset/dataset_progress.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref dataset_progress_examples).
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "dataset/dataset_progress.h"
+
+/** @brief Size of a cache line, so that counters of different files aren't in the same line. */
+#define DATASET_PROGRESS_CACHE_LINE_SIZE 64
+
+/**
+ * @struct dataset_progress_file_t
+ * @brief  Progress of a single file being loaded.
+ *
+ * @var dataset_progress_file_t::total_bytes
+ *     @brief Number of bytes in the file.
+ * @var dataset_progress_file_t::read_bytes
+ *     @brief Number of bytes in lines that have already been processed.
+ * @var dataset_progress_file_t::lines
+ *     @brief Number of lines that have already been processed.
+ * @var dataset_progress_file_t::rejected
+ *     @brief Number of processed lines that were found to be invalid.
+ * @var dataset_progress_file_t::phase_times
+ *     @brief Time (in nanoseconds) spent in each sub-phase of loading the file, if measured (see
+ *            ::dataset_progress_set_measuring_phases).
+ * @var dataset_progress_file_t::padding
+ *     @brief   Unused.
+ *     @details Files are loaded by different threads, that shouldn't write to the same cache
+ *              line.
+ */
+typedef struct {
+    size_t   total_bytes, read_bytes, lines, rejected;
+    uint64_t phase_times[PERFORMANCE_METRICS_DATASET_PHASE_COUNT];
+    char     padding[2 * DATASET_PROGRESS_CACHE_LINE_SIZE - 4 * sizeof(size_t) -
+                 PERFORMANCE_METRICS_DATASET_PHASE_COUNT * sizeof(uint64_t)];
+} dataset_progress_file_t;
+
+/**
+ * @struct dataset_progress
+ * @brief  Progress of a dataset being loaded.
+ *
+ * @var dataset_progress::files
+ *     @brief Progress of each file in the dataset, indexed by ::performance_metrics_dataset_step_t.
+ * @var dataset_progress::cancelled
+ *     @brief Whether ::dataset_progress_cancel has been called.
+ * @var dataset_progress::finished
+ *     @brief Whether ::dataset_progress_finish has been called.
+ * @var dataset_progress::measuring_phases
+ *     @brief Whether parsers measure the time of each sub-phase of loading a file.
+ * @var dataset_progress::paused
+ *     @brief Whether ::dataset_progress_pause has been called (and not ::dataset_progress_resume).
+ *            Written with ::dataset_progress::mutex locked, but can be read without it.
+ * @var dataset_progress::mutex
+ *     @brief Protects ::dataset_progress::paused, for waiting on ::dataset_progress::resumed.
+ * @var dataset_progress::resumed
+ *     @brief Signalled when the load is resumed or cancelled.
+ */
+struct dataset_progress {
+    dataset_progress_file_t files[PERFORMANCE_METRICS_DATASET_STEP_DONE];
+    int                     cancelled, finished, paused, measuring_phases;
+    pthread_mutex_t         mutex;
+    pthread_cond_t          resumed;
+};
+
+dataset_progress_t *dataset_progress_create(void) {
+    dataset_progress_t *const progress = calloc(1, sizeof(dataset_progress_t));
+    if (!progress)
+        return NULL;
+
+    if (pthread_mutex_init(&progress->mutex, NULL))
+        goto DEFER_1;
+    if (pthread_cond_init(&progress->resumed, NULL))
+        goto DEFER_2;
+    return progress;
+
+DEFER_2:
+    pthread_mutex_destroy(&progress->mutex);
+DEFER_1:
+    free(progress);
+    return NULL;
+}
+
+void dataset_progress_add_total_bytes(dataset_progress_t                *progress,
+                                      performance_metrics_dataset_step_t step,
+                                      size_t                             bytes) {
+    if (progress)
+        __atomic_fetch_add(&progress->files[step].total_bytes, bytes, __ATOMIC_RELAXED);
+}
+
+void dataset_progress_add_lines(dataset_progress_t                *progress,
+                                performance_metrics_dataset_step_t step,
+                                size_t                             lines,
+                                size_t                             bytes) {
+    if (progress) {
+        __atomic_fetch_add(&progress->files[step].lines, lines, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&progress->files[step].read_bytes, bytes, __ATOMIC_RELAXED);
+    }
+}
+
+void dataset_progress_add_rejected(dataset_progress_t                *progress,
+                                   performance_metrics_dataset_step_t step) {
+    if (progress)
+        __atomic_fetch_add(&progress->files[step].rejected, 1, __ATOMIC_RELAXED);
+}
+
+void dataset_progress_set_measuring_phases(dataset_progress_t *progress, int measuring) {
+    progress->measuring_phases = measuring;
+}
+
+int dataset_progress_is_measuring_phases(const dataset_progress_t *progress) {
+    return progress && progress->measuring_phases;
+}
+
+void dataset_progress_add_phase_times(
+    dataset_progress_t                *progress,
+    performance_metrics_dataset_step_t step,
+    const uint64_t                     times[PERFORMANCE_METRICS_DATASET_PHASE_COUNT]) {
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_PHASE_COUNT; ++i)
+        __atomic_fetch_add(&progress->files[step].phase_times[i], times[i], __ATOMIC_RELAXED);
+}
+
+size_t dataset_progress_get_total_bytes(const dataset_progress_t          *progress,
+                                        performance_metrics_dataset_step_t step) {
+    return __atomic_load_n(&progress->files[step].total_bytes, __ATOMIC_RELAXED);
+}
+
+size_t dataset_progress_get_read_bytes(const dataset_progress_t          *progress,
+                                       performance_metrics_dataset_step_t step) {
+    return __atomic_load_n(&progress->files[step].read_bytes, __ATOMIC_RELAXED);
+}
+
+size_t dataset_progress_get_lines(const dataset_progress_t          *progress,
+                                  performance_metrics_dataset_step_t step) {
+    return __atomic_load_n(&progress->files[step].lines, __ATOMIC_RELAXED);
+}
+
+size_t dataset_progress_get_rejected(const dataset_progress_t          *progress,
+                                     performance_metrics_dataset_step_t step) {
+    return __atomic_load_n(&progress->files[step].rejected, __ATOMIC_RELAXED);
+}
+
+uint64_t dataset_progress_get_phase_time(const dataset_progress_t           *progress,
+                                         performance_metrics_dataset_step_t  step,
+                                         performance_metrics_dataset_phase_t phase) {
+    return __atomic_load_n(&progress->files[step].phase_times[phase], __ATOMIC_RELAXED);
+}
+
+double dataset_progress_get_fraction(const dataset_progress_t *progress) {
+    size_t total = 0, read = 0;
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i) {
+        total += dataset_progress_get_total_bytes(progress, i);
+        read += dataset_progress_get_read_bytes(progress, i);
+    }
+
+    if (total == 0)
+        return 0.0;
+    else if (read >= total)
+        return 1.0;
+    else
+        return (double) read / total;
+}
+
+void dataset_progress_cancel(dataset_progress_t *progress) {
+    if (!progress)
+        return;
+
+    /* Wake up a paused load, for it to fail */
+    pthread_mutex_lock(&progress->mutex);
+    __atomic_store_n(&progress->cancelled, 1, __ATOMIC_RELAXED);
+    pthread_cond_broadcast(&progress->resumed);
+    pthread_mutex_unlock(&progress->mutex);
+}
+
+int dataset_progress_is_cancelled(const dataset_progress_t *progress) {
+    return progress && __atomic_load_n(&progress->cancelled, __ATOMIC_RELAXED);
+}
+
+void dataset_progress_pause(dataset_progress_t *progress) {
+    pthread_mutex_lock(&progress->mutex);
+    __atomic_store_n(&progress->paused, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&progress->mutex);
+}
+
+void dataset_progress_resume(dataset_progress_t *progress) {
+    pthread_mutex_lock(&progress->mutex);
+    __atomic_store_n(&progress->paused, 0, __ATOMIC_RELAXED);
+    pthread_cond_broadcast(&progress->resumed);
+    pthread_mutex_unlock(&progress->mutex);
+}
+
+int dataset_progress_checkpoint(dataset_progress_t *progress) {
+    if (!progress)
+        return 0;
+
+    /* Loads that are never paused don't need to lock the mutex */
+    if (__atomic_load_n(&progress->paused, __ATOMIC_RELAXED)) {
+        pthread_mutex_lock(&progress->mutex);
+        while (progress->paused && !progress->cancelled)
+            pthread_cond_wait(&progress->resumed, &progress->mutex);
+        pthread_mutex_unlock(&progress->mutex);
+    }
+
+    return dataset_progress_is_cancelled(progress);
+}
+
+void dataset_progress_finish(dataset_progress_t *progress) {
+    __atomic_store_n(&progress->finished, 1, __ATOMIC_RELEASE);
+}
+
+int dataset_progress_is_finished(const dataset_progress_t *progress) {
+    return __atomic_load_n(&progress->finished, __ATOMIC_ACQUIRE);
+}
+
+void dataset_progress_free(dataset_progress_t *progress) {
+    if (!progress)
+        return;
+
+    pthread_cond_destroy(&progress->resumed);
+    pthread_mutex_destroy(&progress->mutex);
+    free(progress);
+}
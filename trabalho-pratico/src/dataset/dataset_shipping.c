@@ -0,0 +1,576 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  dataset_shipping.c
+ * @brief Implementation of methods in include/dataset/dataset_shipping.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref dataset_shipping_examples).
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "dataset/dataset_shipping.h"
+#include "dataset/dataset_snapshot.h"
+#include "utils/int_utils.h"
+
+/**
+ * @brief Number of times a download is restarted because the server's snapshot was replaced,
+ *        before giving up.
+ */
+#define DATASET_SHIPPING_MAX_ATTEMPTS 3
+
+/** @brief Maximum length of the headers of an HTTP response. */
+#define DATASET_SHIPPING_MAX_HEADER_LENGTH 4096
+
+/**
+ * @struct dataset_shipping_source
+ * @brief  The snapshot of a dataset, served to replicas.
+ *
+ * @var dataset_shipping_source::dataset_path
+ *     @brief Path to the directory containing the snapshot.
+ * @var dataset_shipping_source::identifier
+ *     @brief Identifier of the snapshot ::dataset_shipping_source::checksums were calculated for.
+ * @var dataset_shipping_source::length
+ *     @brief Length of the snapshot ::dataset_shipping_source::checksums were calculated for.
+ * @var dataset_shipping_source::checksums
+ *     @brief Checksum of every chunk of the snapshot (`NULL` before it's calculated).
+ * @var dataset_shipping_source::nchunks
+ *     @brief Number of chunks in ::dataset_shipping_source::checksums.
+ */
+struct dataset_shipping_source {
+    const char *dataset_path;
+    uint64_t    identifier, length;
+    uint64_t   *checksums;
+    size_t      nchunks;
+};
+
+dataset_shipping_source_t *dataset_shipping_source_create(const char *dataset_path) {
+    dataset_shipping_source_t *const source = malloc(sizeof(dataset_shipping_source_t));
+    if (!source)
+        return NULL;
+
+    source->dataset_path = dataset_path;
+    source->identifier   = 0;
+    source->length       = 0;
+    source->checksums    = NULL;
+    source->nchunks      = 0;
+    return source;
+}
+
+void dataset_shipping_source_free(dataset_shipping_source_t *source) {
+    free(source->checksums);
+    free(source);
+}
+
+/**
+ * @brief  Calculates the number of chunks in a snapshot.
+ * @param  length Length of the snapshot, in bytes.
+ * @return The number of chunks @p length bytes are split into.
+ */
+size_t __dataset_shipping_count_chunks(uint64_t length) {
+    return (length + DATASET_SHIPPING_CHUNK_SIZE - 1) / DATASET_SHIPPING_CHUNK_SIZE;
+}
+
+/**
+ * @brief  Calculates the length of a chunk of a snapshot.
+ *
+ * @param  length Length of the snapshot, in bytes.
+ * @param  chunk  Index of the chunk.
+ *
+ * @return The number of bytes in @p chunk.
+ */
+size_t __dataset_shipping_get_chunk_length(uint64_t length, size_t chunk) {
+    const uint64_t start = (uint64_t) chunk * DATASET_SHIPPING_CHUNK_SIZE;
+    return min(length - start, DATASET_SHIPPING_CHUNK_SIZE);
+}
+
+/**
+ * @brief Reads a whole chunk from a file.
+ *
+ * @param fd     File to read from.
+ * @param chunk  Index of the chunk.
+ * @param length Number of bytes in the chunk.
+ * @param out    Where to write the chunk to.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO failure, or the file ended before the chunk.
+ */
+int __dataset_shipping_read_chunk(int fd, size_t chunk, size_t length, char *out) {
+    const off_t offset = (off_t) chunk * DATASET_SHIPPING_CHUNK_SIZE;
+    size_t      nread  = 0;
+    while (nread < length) {
+        const ssize_t n = pread(fd, out + nread, length - nread, offset + nread);
+        if (n < 0 && errno == EINTR)
+            continue;
+        else if (n <= 0)
+            return 1;
+        nread += n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes a whole chunk to a file.
+ *
+ * @param fd     File to write to.
+ * @param chunk  Index of the chunk.
+ * @param data   Contents of the chunk.
+ * @param length Number of bytes in @p data.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO failure.
+ */
+int __dataset_shipping_write_chunk(int fd, size_t chunk, const char *data, size_t length) {
+    const off_t offset   = (off_t) chunk * DATASET_SHIPPING_CHUNK_SIZE;
+    size_t      nwritten = 0;
+    while (nwritten < length) {
+        const ssize_t n = pwrite(fd, data + nwritten, length - nwritten, offset + nwritten);
+        if (n < 0 && errno == EINTR)
+            continue;
+        else if (n <= 0)
+            return 1;
+        nwritten += n;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Calculates the manifest of the current snapshot, unless it's already known.
+ * @details Auxiliary method for ::dataset_shipping_respond.
+ *
+ * @param source        Source of the snapshot.
+ * @param snapshot_path Path to the snapshot file.
+ *
+ * @retval 0   Success.
+ * @retval 404 There's no usable snapshot.
+ * @retval 500 IO or allocation failure.
+ */
+int __dataset_shipping_update_manifest(dataset_shipping_source_t *source,
+                                       const char                *snapshot_path) {
+    uint64_t identifier, length;
+    if (dataset_snapshot_get_identity(snapshot_path, &identifier, &length))
+        return 404;
+    if (source->checksums && identifier == source->identifier && length == source->length)
+        return 0;
+
+    const size_t    nchunks   = __dataset_shipping_count_chunks(length);
+    uint64_t *const checksums = malloc(max(nchunks, 1) * sizeof(uint64_t));
+    char *const     buffer    = malloc(DATASET_SHIPPING_CHUNK_SIZE);
+    const int       fd        = open(snapshot_path, O_RDONLY);
+
+    int retval = 500;
+    if (!checksums || !buffer || fd < 0)
+        goto DEFER_1;
+
+    for (size_t i = 0; i < nchunks; ++i) {
+        const size_t chunk_length = __dataset_shipping_get_chunk_length(length, i);
+        if (__dataset_shipping_read_chunk(fd, i, chunk_length, buffer))
+            goto DEFER_1;
+        checksums[i] = dataset_snapshot_checksum(buffer, chunk_length);
+    }
+
+    free(source->checksums);
+    source->identifier = identifier;
+    source->length     = length;
+    source->checksums  = checksums;
+    source->nchunks    = nchunks;
+    retval             = 0;
+
+DEFER_1:
+    if (fd >= 0)
+        close(fd);
+    free(buffer);
+    if (retval)
+        free(checksums);
+    return retval;
+}
+
+/**
+ * @brief   Writes the manifest of the current snapshot to a response.
+ * @details Auxiliary method for ::dataset_shipping_respond.
+ *
+ * @param source Source of the snapshot, whose manifest is up to date.
+ * @param out    Where to write the response to.
+ */
+void __dataset_shipping_respond_manifest(const dataset_shipping_source_t *source,
+                                         dataset_shipping_response_t     *out) {
+    /* Each line has at most two 64-bit numbers in decimal, and one in hexadecimal */
+    const size_t capacity = (source->nchunks + 1) * 64;
+    out->body             = malloc(capacity);
+    if (!out->body) {
+        out->status = 500;
+        return;
+    }
+
+    size_t length = snprintf(out->body,
+                             capacity,
+                             "%016" PRIx64 " %" PRIu64 " %d\n",
+                             source->identifier,
+                             source->length,
+                             DATASET_SHIPPING_CHUNK_SIZE);
+    for (size_t i = 0; i < source->nchunks; ++i)
+        length += snprintf(out->body + length,
+                           capacity - length,
+                           "%016" PRIx64 "\n",
+                           source->checksums[i]);
+
+    out->status = 200;
+    out->length = length;
+}
+
+/**
+ * @brief   Writes a chunk of the current snapshot to a response.
+ * @details Auxiliary method for ::dataset_shipping_respond.
+ *
+ * @param source        Source of the snapshot, whose manifest is up to date.
+ * @param snapshot_path Path to the snapshot file.
+ * @param request       Path of the request, after `/snapshot/` (`<identifier>/<chunk>`).
+ * @param length        Number of characters in @p request.
+ * @param out           Where to write the response to.
+ */
+void __dataset_shipping_respond_chunk(const dataset_shipping_source_t *source,
+                                      const char                      *snapshot_path,
+                                      const char                      *request,
+                                      size_t                           length,
+                                      dataset_shipping_response_t     *out) {
+    char path[64];
+    if (length >= sizeof(path))
+        return;
+    memcpy(path, request, length);
+    path[length] = '\0';
+
+    char *end;
+    errno                     = 0;
+    const uint64_t identifier = strtoull(path, &end, 16);
+    if (errno || end == path || *end != '/' || identifier != source->identifier)
+        return;
+
+    uint64_t chunk;
+    const size_t chunk_digits = strlen(end + 1);
+    if (!chunk_digits || int_utils_parse_digits(&chunk, end + 1, chunk_digits) ||
+        chunk >= source->nchunks)
+        return;
+
+    const size_t chunk_length = __dataset_shipping_get_chunk_length(source->length, chunk);
+    const int    fd           = open(snapshot_path, O_RDONLY);
+    out->body                 = malloc(max(chunk_length, 1));
+    out->status               = 500;
+    if (fd >= 0 && out->body &&
+        !__dataset_shipping_read_chunk(fd, chunk, chunk_length, out->body)) {
+
+        out->status = 200;
+        out->length = chunk_length;
+        out->binary = 1;
+    } else {
+        free(out->body);
+        out->body = NULL;
+    }
+
+    if (fd >= 0)
+        close(fd);
+}
+
+int dataset_shipping_is_request(const char *path, size_t length) {
+    return (length == 9 && strncmp(path, "/snapshot", 9) == 0) ||
+           (length > 10 && strncmp(path, "/snapshot/", 10) == 0);
+}
+
+void dataset_shipping_respond(dataset_shipping_source_t   *source,
+                              const char                  *path,
+                              size_t                       length,
+                              dataset_shipping_response_t *out) {
+    *out = (dataset_shipping_response_t) {.status = 404, .body = NULL, .length = 0, .binary = 0};
+
+    char snapshot_path[PATH_MAX];
+    if (dataset_snapshot_get_path(source->dataset_path, snapshot_path))
+        return; /* Snapshots are off: there's nothing to ship */
+
+    const int manifest_status = __dataset_shipping_update_manifest(source, snapshot_path);
+    if (manifest_status) {
+        out->status = manifest_status;
+        return;
+    }
+
+    if (length == 9)
+        __dataset_shipping_respond_manifest(source, out);
+    else
+        __dataset_shipping_respond_chunk(source, snapshot_path, path + 10, length - 10, out);
+}
+
+/**
+ * @struct dataset_shipping_manifest_t
+ * @brief  Manifest of a snapshot, as received by a replica.
+ *
+ * @var dataset_shipping_manifest_t::identifier
+ *     @brief Identifier of the snapshot.
+ * @var dataset_shipping_manifest_t::length
+ *     @brief Number of bytes in the snapshot.
+ * @var dataset_shipping_manifest_t::checksums
+ *     @brief Checksum of every chunk of the snapshot.
+ * @var dataset_shipping_manifest_t::nchunks
+ *     @brief Number of chunks in the snapshot.
+ */
+typedef struct {
+    uint64_t  identifier, length;
+    uint64_t *checksums;
+    size_t    nchunks;
+} dataset_shipping_manifest_t;
+
+/**
+ * @brief   Sends an HTTP `GET` request to a server and receives its response.
+ * @details The server closes the connection after the response, so everything is read until then.
+ *
+ * @param socket_path Path of the Unix domain socket of the server.
+ * @param path        Path of the resource to request.
+ * @param max_length  Maximum number of bytes in the response's body.
+ * @param out_body    Where to write the body of the response to (to be freed with `free`), on
+ *                    success.
+ * @param out_length  Where to write the number of bytes in @p out_body to, on success.
+ *
+ * @return The status code of the response, or `-1` on connection, IO or allocation failure.
+ */
+int __dataset_shipping_get(const char *socket_path,
+                           const char *path,
+                           size_t      max_length,
+                           char      **out_body,
+                           size_t     *out_length) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(address.sun_path))
+        return -1;
+    strcpy(address.sun_path, socket_path);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    int    status   = -1;
+    size_t capacity = max_length + DATASET_SHIPPING_MAX_HEADER_LENGTH, length = 0;
+    char  *response = malloc(capacity + 1);
+    if (!response || connect(fd, (struct sockaddr *) &address, sizeof(address)))
+        goto DEFER_1;
+
+    char      request[PATH_MAX];
+    const int request_length = snprintf(request, PATH_MAX, "GET %s HTTP/1.0\r\n\r\n", path);
+    for (int nwritten = 0; nwritten < request_length;) {
+        const ssize_t n = write(fd, request + nwritten, request_length - nwritten);
+        if (n < 0 && errno == EINTR)
+            continue;
+        else if (n <= 0)
+            goto DEFER_1;
+        nwritten += n;
+    }
+
+    while (1) {
+        if (length == capacity)
+            goto DEFER_1; /* Response too long */
+
+        const ssize_t n = read(fd, response + length, capacity - length);
+        if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0)
+            goto DEFER_1;
+        else if (n == 0)
+            break;
+        length += n;
+    }
+    response[length] = '\0';
+
+    /* Status line (e.g.: HTTP/1.0 200 OK), followed by headers, that aren't needed */
+    const char *const body = strstr(response, "\r\n\r\n");
+    if (!body || sscanf(response, "HTTP/%*d.%*d %d", &status) != 1) {
+        status = -1;
+        goto DEFER_1;
+    }
+
+    *out_length = length - (body + 4 - response);
+    memmove(response, body + 4, *out_length + 1); /* Keep the null terminator, for text */
+    *out_body = response;
+    response  = NULL;
+
+DEFER_1:
+    free(response);
+    close(fd);
+    return status;
+}
+
+/**
+ * @brief   Downloads the manifest of the snapshot of a server.
+ * @details Auxiliary method for ::dataset_shipping_fetch.
+ *
+ * @param socket_path Path of the Unix domain socket of the server.
+ * @param out         Where to write the manifest to, on success. Its checksums must be freed with
+ *                    `free`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure.
+ */
+int __dataset_shipping_fetch_manifest(const char *socket_path, dataset_shipping_manifest_t *out) {
+    char  *body;
+    size_t length;
+    if (__dataset_shipping_get(socket_path, "/snapshot", 1 << 24, &body, &length) != 200) {
+        fputs("Failed to get the snapshot's manifest from the server!\n", stderr);
+        return 1;
+    }
+
+    int        retval = 1, chunk_size, consumed = 0;
+    const int  parsed = sscanf(body,
+                              "%" SCNx64 " %" SCNu64 " %d\n%n",
+                              &out->identifier,
+                              &out->length,
+                              &chunk_size,
+                              &consumed);
+    const char *line  = body + consumed;
+    if (parsed != 3 || chunk_size != DATASET_SHIPPING_CHUNK_SIZE)
+        goto DEFER_1;
+
+    out->nchunks   = __dataset_shipping_count_chunks(out->length);
+    out->checksums = malloc(max(out->nchunks, 1) * sizeof(uint64_t));
+    if (!out->checksums)
+        goto DEFER_1;
+
+    for (size_t i = 0; i < out->nchunks; ++i) {
+        if (sscanf(line, "%" SCNx64 "\n%n", &out->checksums[i], &consumed) != 1) {
+            free(out->checksums);
+            goto DEFER_1;
+        }
+        line += consumed;
+    }
+    retval = 0;
+
+DEFER_1:
+    if (retval)
+        fputs("Invalid snapshot manifest received from the server!\n", stderr);
+    free(body);
+    return retval;
+}
+
+/**
+ * @brief   Downloads the chunks of a snapshot that aren't yet in the partial file.
+ * @details Auxiliary method for ::dataset_shipping_fetch.
+ *
+ * @param socket_path Path of the Unix domain socket of the server.
+ * @param manifest    Manifest of the snapshot being downloaded.
+ * @param fd          Partial file, with the length of the snapshot.
+ *
+ * @retval 0  Success.
+ * @retval 1  Failure.
+ * @retval -1 The snapshot was replaced in the server, and the download must be restarted.
+ */
+int __dataset_shipping_fetch_chunks(const char                        *socket_path,
+                                    const dataset_shipping_manifest_t *manifest,
+                                    int                                fd) {
+    char *const buffer = malloc(DATASET_SHIPPING_CHUNK_SIZE);
+    if (!buffer)
+        return 1;
+
+    int retval = 0;
+    for (size_t i = 0; i < manifest->nchunks && !retval; ++i) {
+        const size_t chunk_length = __dataset_shipping_get_chunk_length(manifest->length, i);
+
+        /* Chunks from an interrupted download are kept, as long as they're intact */
+        if (!__dataset_shipping_read_chunk(fd, i, chunk_length, buffer) &&
+            dataset_snapshot_checksum(buffer, chunk_length) == manifest->checksums[i])
+            continue;
+
+        char path[64];
+        snprintf(path, sizeof(path), "/snapshot/%016" PRIx64 "/%zu", manifest->identifier, i);
+
+        char     *body;
+        size_t    length;
+        const int status = __dataset_shipping_get(socket_path, path, chunk_length, &body, &length);
+        if (status == 404) {
+            retval = -1;
+        } else if (status != 200) {
+            fputs("Failed to get a chunk of the snapshot from the server!\n", stderr);
+            retval = 1;
+        } else {
+            if (length != chunk_length ||
+                dataset_snapshot_checksum(body, length) != manifest->checksums[i]) {
+                /* Corrupted in transit. Restarting the download only fetches what's missing. */
+                retval = -1;
+            } else if (__dataset_shipping_write_chunk(fd, i, body, length)) {
+                fputs("Failed to write a chunk of the snapshot!\n", stderr);
+                retval = 1;
+            }
+            free(body);
+        }
+    }
+
+    free(buffer);
+    return retval;
+}
+
+int dataset_shipping_fetch(const char *socket_path, const char *directory) {
+    char snapshot_path[PATH_MAX], partial_path[PATH_MAX];
+    snprintf(snapshot_path, PATH_MAX, "%s/%s", directory, DATASET_SNAPSHOT_FILE_NAME);
+    snprintf(partial_path, PATH_MAX, "%s/%s", directory, DATASET_SHIPPING_PARTIAL_FILE_NAME);
+
+    for (int attempt = 0; attempt < DATASET_SHIPPING_MAX_ATTEMPTS; ++attempt) {
+        dataset_shipping_manifest_t manifest;
+        if (__dataset_shipping_fetch_manifest(socket_path, &manifest))
+            return 1;
+
+        uint64_t local_identifier, local_length;
+        if (!dataset_snapshot_get_identity(snapshot_path, &local_identifier, &local_length) &&
+            local_identifier == manifest.identifier && local_length == manifest.length) {
+
+            free(manifest.checksums);
+            return 0; /* Already up to date */
+        }
+
+        /* Not truncated, so that an interrupted download can be resumed */
+        const int fd = open(partial_path, O_RDWR | O_CREAT, 0644);
+        if (fd < 0 || ftruncate(fd, manifest.length)) {
+            fputs("Failed to create the snapshot file!\n", stderr);
+            if (fd >= 0)
+                close(fd);
+            free(manifest.checksums);
+            return 1;
+        }
+
+        int retval = __dataset_shipping_fetch_chunks(socket_path, &manifest, fd);
+        free(manifest.checksums);
+        if (!retval && fsync(fd))
+            retval = 1;
+        close(fd);
+
+        if (retval == 1) {
+            return 1;
+        } else if (retval == 0) {
+            if (rename(partial_path, snapshot_path)) {
+                fputs("Failed to replace the snapshot file!\n", stderr);
+                return 1;
+            }
+            return 0;
+        }
+    }
+
+    fputs("The server's snapshot kept changing while being downloaded!\n", stderr);
+    return 1;
+}
@@ -0,0 +1,1545 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  dataset_snapshot.c
+ * @brief Implementation of methods in include/dataset/dataset_snapshot.h
+ *
+ * ### Example
+ * See [the header file's documentation](@ref dataset_snapshot_examples).
+ */
+
+/** @cond FALSE */
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE /* For realpath */
+#endif
+/** @endcond */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "dataset/dataset_delta_log.h"
+#include "dataset/dataset_snapshot.h"
+#include "utils/int_utils.h"
+#include "utils/mapped_file.h"
+#include "utils/stream_utils.h"
+
+/** @brief Value of ::dataset_snapshot_header_t::magic. */
+#define DATASET_SNAPSHOT_MAGIC "LI3SNAP"
+
+/** @brief Value of ::dataset_snapshot_header_t::version. Increment when the format changes. */
+#define DATASET_SNAPSHOT_VERSION 7
+
+/** @brief Value of ::dataset_snapshot_header_t::byte_order, as written by the current machine. */
+#define DATASET_SNAPSHOT_BYTE_ORDER 0x0102030405060708
+
+/** @brief Bit in ::dataset_snapshot_header_t::flags set when the snapshot contains errors. */
+#define DATASET_SNAPSHOT_FLAG_HAS_ERRORS 1
+
+/**
+ * @brief Bit in ::dataset_snapshot_header_t::flags set when the snapshot contains the index of user
+ *        names (see ::index_manager_build_user_indexes).
+ */
+#define DATASET_SNAPSHOT_FLAG_HAS_USER_NAMES 2
+
+/**
+ * @brief Bit in ::dataset_snapshot_header_t::flags set when the snapshot contains the median
+ *        departure delay of every airport (see ::index_manager_get_origin_delay_medians).
+ */
+#define DATASET_SNAPSHOT_FLAG_HAS_DELAY_MEDIANS 4
+
+/**
+ * @brief Bit in ::dataset_snapshot_header_t::flags set when the snapshot contains the unique
+ *        passengers of every day, month and year (see ::time_cube_count_unique_passengers).
+ */
+#define DATASET_SNAPSHOT_FLAG_HAS_UNIQUE_PASSENGERS 8
+
+/**
+ * @brief Bit in ::dataset_snapshot_header_t::flags set when the snapshot contains the catalog of
+ *        the database (see ::database_get_catalog).
+ */
+#define DATASET_SNAPSHOT_FLAG_HAS_CATALOG 16
+
+/** @brief Size of the buffer of a ::dataset_snapshot_writer_t. Must be a multiple of `8`. */
+#define DATASET_SNAPSHOT_WRITER_BUFFER_SIZE (1 << 16)
+
+/** @brief Number of files in a dataset. */
+#define DATASET_SNAPSHOT_SOURCE_COUNT 4
+
+/** @brief Names of the files in a dataset, also used for the names of error files. */
+const char *const dataset_snapshot_source_names[DATASET_SNAPSHOT_SOURCE_COUNT] = {"users",
+                                                                                  "flights",
+                                                                                  "passengers",
+                                                                                  "reservations"};
+
+/**
+ * @struct dataset_snapshot_source_t
+ * @brief  Metadata about a dataset file, used to detect when a snapshot becomes outdated.
+ *
+ * @var dataset_snapshot_source_t::size
+ *     @brief Size of the file, in bytes.
+ * @var dataset_snapshot_source_t::modification_seconds
+ *     @brief Seconds of the file's last modification time.
+ * @var dataset_snapshot_source_t::modification_nanoseconds
+ *     @brief Nanoseconds of the file's last modification time.
+ */
+typedef struct {
+    uint64_t size;
+    int64_t  modification_seconds;
+    int64_t  modification_nanoseconds;
+} dataset_snapshot_source_t;
+
+/**
+ * @struct dataset_snapshot_header_t
+ * @brief  Header at the beginning of every snapshot file. All its fields are 8-byte aligned, so it
+ *         has no padding.
+ *
+ * @var dataset_snapshot_header_t::magic
+ *     @brief Always ::DATASET_SNAPSHOT_MAGIC, to identify snapshot files.
+ * @var dataset_snapshot_header_t::version
+ *     @brief Version of the snapshot format (::DATASET_SNAPSHOT_VERSION).
+ * @var dataset_snapshot_header_t::flags
+ *     @brief Bit set of options (e.g.: ::DATASET_SNAPSHOT_FLAG_HAS_ERRORS).
+ * @var dataset_snapshot_header_t::byte_order
+ *     @brief ::DATASET_SNAPSHOT_BYTE_ORDER, to reject snapshots written in other machines.
+ * @var dataset_snapshot_header_t::sources
+ *     @brief Metadata about the dataset's files when the snapshot was written.
+ * @var dataset_snapshot_header_t::body_length
+ *     @brief Number of bytes following the header.
+ * @var dataset_snapshot_header_t::body_checksum
+ *     @brief Checksum of the body (see ::__dataset_snapshot_checksum).
+ */
+typedef struct {
+    char                      magic[8];
+    uint32_t                  version;
+    uint32_t                  flags;
+    uint64_t                  byte_order;
+    dataset_snapshot_source_t sources[DATASET_SNAPSHOT_SOURCE_COUNT];
+    uint64_t                  body_length;
+    uint64_t                  body_checksum;
+} dataset_snapshot_header_t;
+
+/**
+ * @struct dataset_snapshot_writer_t
+ * @brief  Buffered output to a snapshot file, that keeps track of the body's checksum.
+ *
+ * @var dataset_snapshot_writer_t::file
+ *     @brief File where to write to.
+ * @var dataset_snapshot_writer_t::length
+ *     @brief Number of bytes written (including the ones still in the buffer).
+ * @var dataset_snapshot_writer_t::checksum
+ *     @brief Checksum of all bytes flushed to ::dataset_snapshot_writer_t::file.
+ * @var dataset_snapshot_writer_t::used
+ *     @brief Number of bytes in ::dataset_snapshot_writer_t::buffer.
+ * @var dataset_snapshot_writer_t::failed
+ *     @brief Whether writing to ::dataset_snapshot_writer_t::file ever failed.
+ * @var dataset_snapshot_writer_t::buffer
+ *     @brief Data yet to be written to ::dataset_snapshot_writer_t::file.
+ */
+typedef struct {
+    FILE    *file;
+    uint64_t length;
+    uint64_t checksum;
+    size_t   used;
+    int      failed;
+    uint8_t  buffer[DATASET_SNAPSHOT_WRITER_BUFFER_SIZE];
+} dataset_snapshot_writer_t;
+
+/**
+ * @struct dataset_snapshot_reader_t
+ * @brief  Sequential input from the memory-mapped body of a snapshot.
+ *
+ * @var dataset_snapshot_reader_t::data
+ *     @brief Beginning of the body.
+ * @var dataset_snapshot_reader_t::length
+ *     @brief Length of the body, in bytes.
+ * @var dataset_snapshot_reader_t::position
+ *     @brief Offset of the next byte to be read.
+ * @var dataset_snapshot_reader_t::failed
+ *     @brief Whether a read past the end of the body (or of an invalid string) was ever attempted.
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t         length;
+    size_t         position;
+    int            failed;
+} dataset_snapshot_reader_t;
+
+/**
+ * @struct  dataset_snapshot_borrowing_t
+ * @brief   Allocators for the entity being restored, when strings are borrowed from the snapshot.
+ * @details `malloc`-allocated entities own copies of their strings, so entities whose strings are
+ *          borrowed are allocated in these pools instead, before being added to the database. Only
+ *          one entity of each type is ever allocated, and strings are never copied.
+ *
+ * @var dataset_snapshot_borrowing_t::users
+ *     @brief Pool for the user being restored.
+ * @var dataset_snapshot_borrowing_t::cold_users
+ *     @brief Pool for the rarely accessed fields of the user being restored (see ::user_create).
+ * @var dataset_snapshot_borrowing_t::flights
+ *     @brief Pool for the flight being restored.
+ * @var dataset_snapshot_borrowing_t::reservations
+ *     @brief Pool for the reservation being restored.
+ * @var dataset_snapshot_borrowing_t::strings
+ *     @brief String pool that borrows strings of users from the snapshot.
+ * @var dataset_snapshot_borrowing_t::unique_strings
+ *     @brief String pool that borrows strings of flights and reservations from the snapshot.
+ */
+typedef struct {
+    pool_t                      *users;
+    pool_t                      *cold_users;
+    pool_t                      *flights;
+    pool_t                      *reservations;
+    string_pool_t               *strings;
+    string_pool_no_duplicates_t *unique_strings;
+} dataset_snapshot_borrowing_t;
+
+/** @brief Number of characters in each block of ::dataset_snapshot_borrowing_t string pools. */
+#define DATASET_SNAPSHOT_BORROWING_STRINGS_BLOCK_CAPACITY 64
+
+/**
+ * @brief   Updates a checksum with more data.
+ * @details FNV-1a, applied to 8-byte words (and then to the remaining bytes). Calling this method
+ *          over consecutive parts of some data is only equivalent to calling it over the whole data
+ *          if the length of every part (except the last one) is a multiple of `8`.
+ *
+ * @param checksum Checksum of the previous data (`0xcbf29ce484222325` for no previous data).
+ * @param data     Data to be added to the checksum.
+ * @param length   Number of bytes in @p data.
+ *
+ * @return The updated checksum.
+ */
+uint64_t __dataset_snapshot_checksum(uint64_t checksum, const uint8_t *data, size_t length) {
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(uint64_t));
+        checksum = (checksum ^ word) * 0x100000001b3;
+    }
+
+    for (; i < length; ++i)
+        checksum = (checksum ^ data[i]) * 0x100000001b3;
+
+    return checksum;
+}
+
+/**
+ * @brief Gets the metadata about every file in a dataset.
+ *
+ * @param output       Where to write the metadata to.
+ * @param dataset_path Path to the directory containing the dataset.
+ *
+ * @retval 0 Success.
+ * @retval 1 A file couldn't be accessed, or isn't a regular file (e.g.: a FIFO, whose contents
+ *           can't be identified by its metadata).
+ */
+int __dataset_snapshot_get_sources(dataset_snapshot_source_t output[DATASET_SNAPSHOT_SOURCE_COUNT],
+                                   const char               *dataset_path) {
+
+    for (size_t i = 0; i < DATASET_SNAPSHOT_SOURCE_COUNT; ++i) {
+        char file_path[PATH_MAX];
+        snprintf(file_path, PATH_MAX, "%s/%s.csv", dataset_path, dataset_snapshot_source_names[i]);
+
+        struct stat file_stat;
+        if (stat(file_path, &file_stat) || !S_ISREG(file_stat.st_mode))
+            return 1;
+
+        output[i] = (dataset_snapshot_source_t) {
+            .size                     = (uint64_t) file_stat.st_size,
+            .modification_seconds     = (int64_t) file_stat.st_mtim.tv_sec,
+            .modification_nanoseconds = (int64_t) file_stat.st_mtim.tv_nsec};
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Writes all buffered data in a ::dataset_snapshot_writer_t to its file.
+ * @param writer Writer to be flushed.
+ */
+void __dataset_snapshot_writer_flush(dataset_snapshot_writer_t *writer) {
+    writer->checksum = __dataset_snapshot_checksum(writer->checksum, writer->buffer, writer->used);
+    if (fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used)
+        writer->failed = 1;
+    writer->used = 0;
+}
+
+/**
+ * @brief Writes data to a ::dataset_snapshot_writer_t.
+ *
+ * @param writer Where to write @p data to.
+ * @param data   Data to be written.
+ * @param length Number of bytes in @p data.
+ */
+void __dataset_snapshot_write(dataset_snapshot_writer_t *writer, const void *data, size_t length) {
+    const uint8_t *bytes = data;
+    writer->length += length;
+
+    while (length) {
+        size_t to_copy = DATASET_SNAPSHOT_WRITER_BUFFER_SIZE - writer->used;
+        if (to_copy > length)
+            to_copy = length;
+
+        memcpy(writer->buffer + writer->used, bytes, to_copy);
+        writer->used += to_copy;
+        bytes += to_copy;
+        length -= to_copy;
+
+        if (writer->used == DATASET_SNAPSHOT_WRITER_BUFFER_SIZE)
+            __dataset_snapshot_writer_flush(writer);
+    }
+}
+
+/**
+ * @brief   Writes a string to a ::dataset_snapshot_writer_t.
+ * @details The string's length is written first (as a `uint32_t`), followed by its characters and
+ *          its `'\0'` terminator, so that it can be used in place when the snapshot is read.
+ *
+ * @param writer Where to write @p string to.
+ * @param string String to be written.
+ */
+void __dataset_snapshot_write_string(dataset_snapshot_writer_t *writer, const char *string) {
+    const uint32_t length = strlen(string);
+    __dataset_snapshot_write(writer, &length, sizeof(uint32_t));
+    __dataset_snapshot_write(writer, string, length + 1);
+}
+
+/**
+ * @brief Writes a record marker to a ::dataset_snapshot_writer_t.
+ *
+ * @param writer Where to write the marker to.
+ * @param marker `1` before every record, `0` after the last record of a section.
+ */
+void __dataset_snapshot_write_marker(dataset_snapshot_writer_t *writer, uint8_t marker) {
+    __dataset_snapshot_write(writer, &marker, sizeof(uint8_t));
+}
+
+/**
+ * @brief Reads data from a ::dataset_snapshot_reader_t.
+ *
+ * @param reader Where to read data from.
+ * @param output Where to write the data to. Zeroed if there's not enough data in @p reader.
+ * @param length Number of bytes to be read.
+ */
+void __dataset_snapshot_read(dataset_snapshot_reader_t *reader, void *output, size_t length) {
+    if (reader->length - reader->position < length) {
+        reader->failed = 1;
+        memset(output, 0, length);
+        return;
+    }
+
+    memcpy(output, reader->data + reader->position, length);
+    reader->position += length;
+}
+
+/**
+ * @brief Reads a string written by ::__dataset_snapshot_write_string, without copying it.
+ *
+ * @param reader Where to read the string from.
+ *
+ * @return The string, pointing into the snapshot's body, or an empty string on failure.
+ */
+const char *__dataset_snapshot_read_string(dataset_snapshot_reader_t *reader) {
+    uint32_t length;
+    __dataset_snapshot_read(reader, &length, sizeof(uint32_t));
+
+    if (reader->failed || reader->length - reader->position <= length ||
+        reader->data[reader->position + length] != '\0') {
+
+        reader->failed = 1;
+        return "";
+    }
+
+    const char *const ret = (const char *) reader->data + reader->position;
+    reader->position += length + 1;
+    return ret;
+}
+
+/**
+ * @brief Reads a record marker written by ::__dataset_snapshot_write_marker.
+ *
+ * @param reader Where to read the marker from.
+ *
+ * @retval 0 End of a section (or read failure).
+ * @retval 1 Another record follows.
+ */
+int __dataset_snapshot_read_marker(dataset_snapshot_reader_t *reader) {
+    uint8_t marker;
+    __dataset_snapshot_read(reader, &marker, sizeof(uint8_t));
+    return marker == 1 && !reader->failed;
+}
+
+/**
+ * @brief   Callback for every active user, that numbers it.
+ * @details Auxiliary method for ::__dataset_snapshot_save_user_names.
+ *
+ * @param user_data `GHashTable` of user (`const user_t *`) -> position among active users plus one.
+ * @param user      Active user to be numbered.
+ *
+ * @retval 0 Always successful.
+ */
+int __dataset_snapshot_number_active_user(void *user_data, const user_t *user) {
+    GHashTable *const positions = user_data;
+    g_hash_table_insert(positions,
+                        (gpointer) (size_t) user,
+                        GUINT_TO_POINTER(g_hash_table_size(positions) + 1));
+    return 0;
+}
+
+/**
+ * @brief   Writes the index of user names of a database to a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_save. Users are stored by their position among
+ *          active users (see ::user_manager_iter_active), which is the same when the snapshot is
+ *          restored, so that the index doesn't need to be sorted or collated again.
+ *
+ * @param writer  Where to write the index to (write failures are checked at the end).
+ * @param entries `GArray` of ::index_manager_user_name_t.
+ * @param trie    Trie over the names in @p entries.
+ * @param users   Users in @p entries.
+ */
+void __dataset_snapshot_save_user_names(dataset_snapshot_writer_t *writer,
+                                       const GArray              *entries,
+                                       const prefix_trie_t       *trie,
+                                       const user_manager_t      *users) {
+    GHashTable *const positions = g_hash_table_new(g_direct_hash, g_direct_equal);
+    user_manager_iter_active(users, __dataset_snapshot_number_active_user, positions);
+
+    const uint32_t count = entries->len;
+    __dataset_snapshot_write(writer, &count, sizeof(uint32_t));
+    for (size_t i = 0; i < entries->len; ++i) {
+        const index_manager_user_name_t *const entry =
+            &g_array_index(entries, index_manager_user_name_t, i);
+
+        const uint32_t position =
+            GPOINTER_TO_UINT(g_hash_table_lookup(positions, (gpointer) (size_t) entry->user)) - 1;
+        const uint32_t rank = entry->collation_rank;
+        __dataset_snapshot_write(writer, &position, sizeof(uint32_t));
+        __dataset_snapshot_write(writer, &rank, sizeof(uint32_t));
+    }
+    g_hash_table_unref(positions);
+
+    size_t            trie_length;
+    const void *const trie_data  = prefix_trie_get_data(trie, &trie_length);
+    const uint64_t    length_u64 = trie_length;
+    __dataset_snapshot_write(writer, &length_u64, sizeof(uint64_t));
+    __dataset_snapshot_write(writer, trie_data, trie_length);
+}
+
+/**
+ * @brief   Writes the median departure delays of all airports to a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_save. The ranking is stored as it is, so that
+ *          delays don't need to be collected and selected again when the snapshot is restored.
+ *
+ * @param writer  Where to write the medians to (write failures are checked at the end).
+ * @param medians `GArray` of ::index_manager_airport_delay_t.
+ */
+void __dataset_snapshot_save_delay_medians(dataset_snapshot_writer_t *writer,
+                                           const GArray              *medians) {
+    const uint32_t count = medians->len;
+    __dataset_snapshot_write(writer, &count, sizeof(uint32_t));
+    for (size_t i = 0; i < medians->len; ++i) {
+        const index_manager_airport_delay_t *const median =
+            &g_array_index(medians, index_manager_airport_delay_t, i);
+        __dataset_snapshot_write(writer, &median->airport, sizeof(airport_code_t));
+        __dataset_snapshot_write(writer, &median->median_delay, sizeof(int64_t));
+    }
+}
+
+/**
+ * @brief   Writes a list of heavy hitters of a catalog to a snapshot.
+ * @details Auxiliary method for ::__dataset_snapshot_save_catalog.
+ *
+ * @param writer  Where to write the heavy hitters to (write failures are checked at the end).
+ * @param n       Number of elements in @p hitters.
+ * @param hitters Heavy hitters to be written.
+ */
+void __dataset_snapshot_save_hitters(dataset_snapshot_writer_t             *writer,
+                                     uint32_t                               n,
+                                     const database_catalog_heavy_hitter_t *hitters) {
+    __dataset_snapshot_write(writer, &n, sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; ++i) {
+        __dataset_snapshot_write(writer, &hitters[i].key, sizeof(uint32_t));
+        __dataset_snapshot_write(writer, &hitters[i].count, sizeof(uint32_t));
+    }
+}
+
+/**
+ * @brief   Writes the catalog of a database to a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_save.
+ *
+ * @param writer  Where to write the catalog to (write failures are checked at the end).
+ * @param catalog Catalog to be written.
+ */
+void __dataset_snapshot_save_catalog(dataset_snapshot_writer_t *writer,
+                                     const database_catalog_t  *catalog) {
+    const uint64_t counts[] = {catalog->users,
+                               catalog->active_users,
+                               catalog->flights,
+                               catalog->passengers,
+                               catalog->reservations,
+                               catalog->airports,
+                               catalog->hotels};
+    __dataset_snapshot_write(writer, counts, sizeof(counts));
+
+    __dataset_snapshot_save_hitters(writer, catalog->hotel_hitter_count, catalog->hotel_hitters);
+    __dataset_snapshot_save_hitters(writer,
+                                    catalog->airport_hitter_count,
+                                    catalog->airport_hitters);
+
+    const database_catalog_date_range_t *const ranges[] = {&catalog->user_dates,
+                                                           &catalog->flight_dates,
+                                                           &catalog->reservation_dates};
+    for (size_t i = 0; i < sizeof(ranges) / sizeof(*ranges); ++i) {
+        __dataset_snapshot_write(writer, &ranges[i]->first, sizeof(date_t));
+        __dataset_snapshot_write(writer, &ranges[i]->last, sizeof(date_t));
+    }
+
+    __dataset_snapshot_write(writer, catalog->name_prefixes, sizeof(catalog->name_prefixes));
+}
+
+/**
+ * @brief   Counts an instant with unique passengers to be written to a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_save (see
+ *          ::time_cube_unique_passengers_callback_t).
+ *
+ * @param count_data A pointer to a `uint32_t` to be incremented.
+ * @param entry      Instant being counted (not used).
+ *
+ * @retval 0 Always, so that iteration continues.
+ */
+int __dataset_snapshot_count_unique_passengers(void                                *count_data,
+                                               const time_cube_unique_passengers_t *entry) {
+    (void) entry;
+    (*(uint32_t *) count_data)++;
+    return 0;
+}
+
+/**
+ * @brief   Callback for every instant whose unique passengers are written to a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_save. Only these counts are stored, as all other
+ *          counts of the time cube are restored as entities are added back to the database.
+ *
+ * @param writer_data A ::dataset_snapshot_writer_t.
+ * @param entry       Instant and its number of unique passengers.
+ *
+ * @return `0`, so that iteration continues (write failures are checked at the end).
+ */
+int __dataset_snapshot_save_unique_passengers(void                                *writer_data,
+                                              const time_cube_unique_passengers_t *entry) {
+    dataset_snapshot_writer_t *const writer = writer_data;
+    __dataset_snapshot_write(writer, &entry->year, sizeof(uint16_t));
+    __dataset_snapshot_write(writer, &entry->month, sizeof(uint8_t));
+    __dataset_snapshot_write(writer, &entry->day, sizeof(uint8_t));
+    __dataset_snapshot_write(writer, &entry->count, sizeof(uint32_t));
+    return 0;
+}
+
+/**
+ * @brief   Callback for every flight written to a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_save.
+ *
+ * @param writer_data A ::dataset_snapshot_writer_t.
+ * @param flight      Flight to be written.
+ *
+ * @return `0`, so that iteration continues (write failures are checked at the end).
+ */
+int __dataset_snapshot_save_flight(void *writer_data, const flight_t *flight) {
+    dataset_snapshot_writer_t *const writer = writer_data;
+
+    const flight_id_t     id                      = flight_get_id(flight);
+    const airport_code_t  origin                  = flight_get_origin(flight);
+    const airport_code_t  destination             = flight_get_destination(flight);
+    const date_and_time_t schedule_departure_date = flight_get_schedule_departure_date(flight);
+    const date_and_time_t schedule_arrival_date   = flight_get_schedule_arrival_date(flight);
+    const date_and_time_t real_departure_date     = flight_get_real_departure_date(flight);
+    const uint16_t        total_seats             = flight_get_total_seats(flight);
+    const uint16_t        number_of_passengers    = flight_get_number_of_passengers(flight);
+
+    __dataset_snapshot_write_marker(writer, 1);
+    __dataset_snapshot_write(writer, &id, sizeof(flight_id_t));
+    __dataset_snapshot_write_string(writer, flight_get_const_airline(flight));
+    __dataset_snapshot_write_string(writer, flight_get_const_plane_model(flight));
+    __dataset_snapshot_write(writer, &origin, sizeof(airport_code_t));
+    __dataset_snapshot_write(writer, &destination, sizeof(airport_code_t));
+    __dataset_snapshot_write(writer, &schedule_departure_date, sizeof(date_and_time_t));
+    __dataset_snapshot_write(writer, &schedule_arrival_date, sizeof(date_and_time_t));
+    __dataset_snapshot_write(writer, &real_departure_date, sizeof(date_and_time_t));
+    __dataset_snapshot_write(writer, &total_seats, sizeof(uint16_t));
+    __dataset_snapshot_write(writer, &number_of_passengers, sizeof(uint16_t));
+    return 0;
+}
+
+/**
+ * @brief   Callback for every user written to a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_save. The user's flights are written in the
+ *          same order as in @p flights.
+ *
+ * @param writer_data A ::dataset_snapshot_writer_t.
+ * @param user        User to be written.
+ * @param flights     Flights of @p user.
+ *
+ * @return `0`, so that iteration continues (write failures are checked at the end).
+ */
+int __dataset_snapshot_save_user(void                  *writer_data,
+                                 const user_t          *user,
+                                 user_manager_id_span_t flights) {
+    dataset_snapshot_writer_t *const writer = writer_data;
+
+    const country_code_t  country_code          = user_get_country_code(user);
+    const date_t          birth_date            = user_get_birth_date(user);
+    const uint8_t         sex                   = user_get_sex(user);
+    const uint8_t         account_status        = user_get_account_status(user);
+    const date_and_time_t account_creation_date = user_get_account_creation_date(user);
+    const uint32_t        flight_count          = flights.length;
+
+    __dataset_snapshot_write_marker(writer, 1);
+    __dataset_snapshot_write_string(writer, user_get_const_id(user));
+    __dataset_snapshot_write_string(writer, user_get_const_name(user));
+    __dataset_snapshot_write_string(writer, user_get_const_passport(user));
+    __dataset_snapshot_write(writer, &country_code, sizeof(country_code_t));
+    __dataset_snapshot_write(writer, &birth_date, sizeof(date_t));
+    __dataset_snapshot_write(writer, &sex, sizeof(uint8_t));
+    __dataset_snapshot_write(writer, &account_status, sizeof(uint8_t));
+    __dataset_snapshot_write(writer, &account_creation_date, sizeof(date_and_time_t));
+
+    __dataset_snapshot_write(writer, &flight_count, sizeof(uint32_t));
+    __dataset_snapshot_write(writer, flights.ids, flights.length * sizeof(flight_id_t));
+    return 0;
+}
+
+/**
+ * @brief   Callback for every reservation written to a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_save.
+ *
+ * @param writer_data A ::dataset_snapshot_writer_t.
+ * @param reservation Reservation to be written.
+ *
+ * @return `0`, so that iteration continues (write failures are checked at the end).
+ */
+int __dataset_snapshot_save_reservation(void *writer_data, const reservation_t *reservation) {
+    dataset_snapshot_writer_t *const writer = writer_data;
+
+    const reservation_id_t id                 = reservation_get_id(reservation);
+    const uint32_t         user_index         = reservation_get_user_index(reservation);
+    const hotel_id_t       hotel_id           = reservation_get_hotel_id(reservation);
+    const uint8_t          hotel_stars        = reservation_get_hotel_stars(reservation);
+    const uint8_t          city_tax           = reservation_get_city_tax(reservation);
+    const uint16_t         price_per_night    = reservation_get_price_per_night(reservation);
+    const uint8_t          includes_breakfast = reservation_get_includes_breakfast(reservation);
+    const date_t           begin_date         = reservation_get_begin_date(reservation);
+    const date_t           end_date           = reservation_get_end_date(reservation);
+    const uint8_t          rating             = reservation_get_rating(reservation);
+
+    __dataset_snapshot_write_marker(writer, 1);
+    __dataset_snapshot_write(writer, &id, sizeof(reservation_id_t));
+    __dataset_snapshot_write(writer, &user_index, sizeof(uint32_t));
+    __dataset_snapshot_write(writer, &hotel_id, sizeof(hotel_id_t));
+    __dataset_snapshot_write_string(writer, reservation_get_const_hotel_name(reservation));
+    __dataset_snapshot_write(writer, &hotel_stars, sizeof(uint8_t));
+    __dataset_snapshot_write(writer, &city_tax, sizeof(uint8_t));
+    __dataset_snapshot_write(writer, &price_per_night, sizeof(uint16_t));
+    __dataset_snapshot_write(writer, &includes_breakfast, sizeof(uint8_t));
+    __dataset_snapshot_write(writer, &begin_date, sizeof(date_t));
+    __dataset_snapshot_write(writer, &end_date, sizeof(date_t));
+    __dataset_snapshot_write(writer, &rating, sizeof(uint8_t));
+    return 0;
+}
+
+/**
+ * @brief   Callback for every line of an error file written to a snapshot.
+ * @details Auxiliary method for ::__dataset_snapshot_save_errors.
+ *
+ * @param writer_data A ::dataset_snapshot_writer_t.
+ * @param line        Line to be written.
+ * @param length      Length of @p line.
+ *
+ * @return Always `0`.
+ */
+int __dataset_snapshot_save_error_line(void *writer_data, char *line, size_t length) {
+    (void) length;
+    dataset_snapshot_writer_t *const writer = writer_data;
+
+    __dataset_snapshot_write_marker(writer, 1);
+    __dataset_snapshot_write_string(writer, line);
+    return 0;
+}
+
+/**
+ * @brief   Writes the contents of all error files to a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_save.
+ *
+ * @param writer      Where to write the errors to.
+ * @param errors_path Path to the directory containing the error files.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failed to read an error file.
+ */
+int __dataset_snapshot_save_errors(dataset_snapshot_writer_t *writer, const char *errors_path) {
+    for (size_t i = 0; i < DATASET_SNAPSHOT_SOURCE_COUNT; ++i) {
+        char file_path[PATH_MAX];
+        snprintf(file_path,
+                 PATH_MAX,
+                 "%s/%s_errors.csv",
+                 errors_path,
+                 dataset_snapshot_source_names[i]);
+
+        FILE *const file = fopen(file_path, "r");
+        if (!file)
+            return 1;
+
+        const int retval =
+            stream_tokenize_slices(file, '\n', __dataset_snapshot_save_error_line, writer);
+        fclose(file);
+        if (retval)
+            return 1;
+
+        __dataset_snapshot_write_marker(writer, 0);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Frees the allocators in a ::dataset_snapshot_borrowing_t.
+ * @param borrowing Allocators to be freed. Those that are `NULL` are skipped.
+ */
+void __dataset_snapshot_borrowing_free(dataset_snapshot_borrowing_t *borrowing) {
+    pool_t *const pools[] = {borrowing->users,
+                             borrowing->cold_users,
+                             borrowing->flights,
+                             borrowing->reservations};
+    for (size_t i = 0; i < sizeof(pools) / sizeof(*pools); ++i)
+        if (pools[i])
+            pool_free(pools[i]);
+
+    if (borrowing->strings)
+        string_pool_free(borrowing->strings);
+    if (borrowing->unique_strings)
+        string_pool_no_duplicates_free(borrowing->unique_strings);
+}
+
+/**
+ * @brief   Creates the allocators needed to restore entities whose strings are borrowed from a
+ *          snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_load.
+ *
+ * @param borrowing Where to write the allocators to. Must be freed with
+ *                  ::__dataset_snapshot_borrowing_free, even on failure.
+ * @param file      Mapped snapshot file.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __dataset_snapshot_borrowing_create(dataset_snapshot_borrowing_t *borrowing,
+                                        mapped_file_t                *file) {
+    const size_t item_sizes[] = {user_sizeof(),
+                                 user_cold_sizeof(),
+                                 flight_sizeof(),
+                                 reservation_sizeof()};
+    pool_t     **pools[]      = {&borrowing->users,
+                                 &borrowing->cold_users,
+                                 &borrowing->flights,
+                                 &borrowing->reservations};
+
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(pools) / sizeof(*pools); ++i) {
+        *pools[i] = pool_create_from_size_and_pages(item_sizes[i], 1, POOL_PAGES_NORMAL);
+        failed |= !*pools[i];
+    }
+
+    const size_t strings_capacity = DATASET_SNAPSHOT_BORROWING_STRINGS_BLOCK_CAPACITY;
+    borrowing->strings            = string_pool_create(strings_capacity);
+    borrowing->unique_strings     = string_pool_no_duplicates_create(strings_capacity);
+
+    return failed || !borrowing->strings || !borrowing->unique_strings ||
+           string_pool_borrow(borrowing->strings, file) ||
+           string_pool_no_duplicates_borrow(borrowing->unique_strings, file);
+}
+
+/**
+ * @brief   Restores all flights from a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_load.
+ *
+ * @param reader    Snapshot body, positioned at the beginning of the flights section.
+ * @param database  Where to add the flights to.
+ * @param borrowing Allocators for flights whose strings are borrowed from the snapshot, or `NULL`
+ *                  for flights to own copies of their strings.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation or reading failure.
+ */
+int __dataset_snapshot_load_flights(dataset_snapshot_reader_t    *reader,
+                                    database_t                   *database,
+                                    dataset_snapshot_borrowing_t *borrowing) {
+
+    pool_t *const                      pool    = borrowing ? borrowing->flights : NULL;
+    string_pool_no_duplicates_t *const strings = borrowing ? borrowing->unique_strings : NULL;
+    flight_t *const                    flight  = flight_create(pool);
+    if (!flight)
+        return 1;
+
+    int retval = 0;
+    while (!retval && __dataset_snapshot_read_marker(reader)) {
+        flight_id_t     id;
+        airport_code_t  origin, destination;
+        date_and_time_t schedule_departure_date, schedule_arrival_date, real_departure_date;
+        uint16_t        total_seats, number_of_passengers;
+
+        __dataset_snapshot_read(reader, &id, sizeof(flight_id_t));
+        const char *const airline     = __dataset_snapshot_read_string(reader);
+        const char *const plane_model = __dataset_snapshot_read_string(reader);
+        __dataset_snapshot_read(reader, &origin, sizeof(airport_code_t));
+        __dataset_snapshot_read(reader, &destination, sizeof(airport_code_t));
+        __dataset_snapshot_read(reader, &schedule_departure_date, sizeof(date_and_time_t));
+        __dataset_snapshot_read(reader, &schedule_arrival_date, sizeof(date_and_time_t));
+        __dataset_snapshot_read(reader, &real_departure_date, sizeof(date_and_time_t));
+        __dataset_snapshot_read(reader, &total_seats, sizeof(uint16_t));
+        __dataset_snapshot_read(reader, &number_of_passengers, sizeof(uint16_t));
+
+        flight_reset_schedule_dates(flight);
+        flight_reset_seats(flight);
+        flight_set_id(flight, id);
+        flight_set_origin(flight, origin);
+        flight_set_destination(flight, destination);
+        flight_set_real_departure_date(flight, real_departure_date);
+
+        retval = reader->failed || flight_set_airline(strings, flight, airline) ||
+                 flight_set_plane_model(strings, flight, plane_model) ||
+                 flight_set_schedule_departure_date(flight, schedule_departure_date) ||
+                 flight_set_schedule_arrival_date(flight, schedule_arrival_date) ||
+                 flight_set_number_of_passengers(flight, number_of_passengers) ||
+                 flight_set_total_seats(flight, total_seats) ||
+                 database_add_flight(database, flight);
+    }
+
+    if (!borrowing)
+        flight_free(flight);
+    return retval || reader->failed;
+}
+
+/**
+ * @brief   Restores all users (and their flights) from a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_load. Flights must already have been restored.
+ *
+ * @param reader    Snapshot body, positioned at the beginning of the users section.
+ * @param database  Where to add the users to.
+ * @param borrowing Allocators for users whose strings are borrowed from the snapshot, or `NULL` for
+ *                  users to own copies of their strings.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation or reading failure.
+ */
+int __dataset_snapshot_load_users(dataset_snapshot_reader_t    *reader,
+                                  database_t                   *database,
+                                  dataset_snapshot_borrowing_t *borrowing) {
+
+    string_pool_t *const strings = borrowing ? borrowing->strings : NULL;
+    user_t *const        user    = borrowing ? user_create(borrowing->users, borrowing->cold_users)
+                                             : user_create(NULL, NULL);
+    if (!user)
+        return 1;
+
+    int retval = 0;
+    while (!retval && __dataset_snapshot_read_marker(reader)) {
+        country_code_t  country_code;
+        date_t          birth_date;
+        uint8_t         sex, account_status;
+        date_and_time_t account_creation_date;
+        uint32_t        flight_count;
+
+        const char *const id       = __dataset_snapshot_read_string(reader);
+        const char *const name     = __dataset_snapshot_read_string(reader);
+        const char *const passport = __dataset_snapshot_read_string(reader);
+        __dataset_snapshot_read(reader, &country_code, sizeof(country_code_t));
+        __dataset_snapshot_read(reader, &birth_date, sizeof(date_t));
+        __dataset_snapshot_read(reader, &sex, sizeof(uint8_t));
+        __dataset_snapshot_read(reader, &account_status, sizeof(uint8_t));
+        __dataset_snapshot_read(reader, &account_creation_date, sizeof(date_and_time_t));
+        __dataset_snapshot_read(reader, &flight_count, sizeof(uint32_t));
+
+        const size_t flights_position = reader->position;
+        if (reader->failed ||
+            (reader->length - flights_position) / sizeof(flight_id_t) < flight_count) {
+            retval = 1;
+            break;
+        }
+        reader->position += (size_t) flight_count * sizeof(flight_id_t);
+
+        user_reset_dates(user);
+        user_set_country_code(user, country_code);
+        user_set_sex(user, sex);
+        user_set_account_status(user, account_status);
+
+        retval = user_set_id(strings, user, id) || user_set_name(strings, user, name) ||
+                 user_set_passport(strings, user, passport) ||
+                 user_set_birth_date(user, birth_date) ||
+                 user_set_account_creation_date(user, account_creation_date) ||
+                 database_add_user(database, user);
+
+        /* The user that was just added is the one the identifier refers to */
+        uint32_t index = 0;
+        if (!retval)
+            retval = user_manager_get_index_by_id(database_get_users(database), id, &index);
+
+        /* Associations are prepended to lists, so add them in reverse to keep the same order */
+        for (uint32_t i = flight_count; !retval && i > 0; --i) {
+            flight_id_t flight_id;
+            memcpy(&flight_id,
+                   reader->data + flights_position + (i - 1) * sizeof(flight_id_t),
+                   sizeof(flight_id_t));
+
+            retval = database_add_user_flight_association(database, index, flight_id);
+        }
+    }
+
+    if (!borrowing)
+        user_free(user);
+    return retval || reader->failed;
+}
+
+/**
+ * @brief   Callback for every active user, that appends it to an array.
+ * @details Auxiliary method for ::__dataset_snapshot_load_user_names.
+ *
+ * @param user_data `GPtrArray` of active users.
+ * @param user      Active user to be appended.
+ *
+ * @retval 0 Always successful.
+ */
+int __dataset_snapshot_collect_active_user(void *user_data, const user_t *user) {
+    g_ptr_array_add(user_data, (gpointer) (size_t) user);
+    return 0;
+}
+
+/**
+ * @brief   Restores the index of user names from a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_load. Users must already have been restored.
+ *          An invalid index is skipped (it's built again when needed).
+ *
+ * @param reader   Snapshot body, positioned at the beginning of the user names section.
+ * @param database Where to restore the index to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Reading failure.
+ */
+int __dataset_snapshot_load_user_names(dataset_snapshot_reader_t *reader, database_t *database) {
+    GPtrArray *const active = g_ptr_array_new();
+    user_manager_iter_active(database_get_users(database),
+                             __dataset_snapshot_collect_active_user,
+                             active);
+
+    uint32_t count;
+    __dataset_snapshot_read(reader, &count, sizeof(uint32_t));
+    int valid = !reader->failed && count == active->len;
+
+    GArray *const entries =
+        g_array_sized_new(FALSE, FALSE, sizeof(index_manager_user_name_t), valid ? count : 0);
+    for (uint32_t i = 0; valid && i < count; ++i) {
+        uint32_t position, rank;
+        __dataset_snapshot_read(reader, &position, sizeof(uint32_t));
+        __dataset_snapshot_read(reader, &rank, sizeof(uint32_t));
+        if (reader->failed || position >= active->len) {
+            valid = 0;
+            break;
+        }
+
+        const index_manager_user_name_t entry = {.user = g_ptr_array_index(active, position),
+                                                 .collation_rank = rank};
+        g_array_append_val(entries, entry);
+    }
+    g_ptr_array_unref(active);
+
+    uint64_t trie_length = 0;
+    if (valid)
+        __dataset_snapshot_read(reader, &trie_length, sizeof(uint64_t));
+    if (!valid || reader->failed || reader->length - reader->position < trie_length) {
+        g_array_unref(entries);
+        reader->failed = 1;
+        return 1;
+    }
+
+    const void *const trie_data = reader->data + reader->position;
+    reader->position += trie_length;
+    database_restore_user_name_index(database, entries, trie_data, trie_length);
+    return 0;
+}
+
+/**
+ * @brief   Restores the median departure delays of all airports from a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_load.
+ *
+ * @param reader   Snapshot body, positioned at the beginning of the delay medians section.
+ * @param database Where to restore the index to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Reading failure.
+ */
+int __dataset_snapshot_load_delay_medians(dataset_snapshot_reader_t *reader, database_t *database) {
+    uint32_t count;
+    __dataset_snapshot_read(reader, &count, sizeof(uint32_t));
+    if (reader->failed || count > AIRPORT_CODE_INDEX_COUNT) {
+        reader->failed = 1;
+        return 1;
+    }
+
+    GArray *const medians =
+        g_array_sized_new(FALSE, FALSE, sizeof(index_manager_airport_delay_t), count);
+    for (uint32_t i = 0; i < count; ++i) {
+        index_manager_airport_delay_t median;
+        __dataset_snapshot_read(reader, &median.airport, sizeof(airport_code_t));
+        __dataset_snapshot_read(reader, &median.median_delay, sizeof(int64_t));
+        g_array_append_val(medians, median);
+    }
+
+    if (reader->failed) {
+        g_array_unref(medians);
+        return 1;
+    }
+    return database_restore_origin_delay_median_index(database, medians);
+}
+
+/**
+ * @brief   Restores the unique passengers of every day, month and year from a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_load. Users and flights must already have been
+ *          restored, as adding them discards stored counts.
+ *
+ * @param reader   Snapshot body, positioned at the beginning of the unique passengers section.
+ * @param database Where to restore the counts to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation or reading failure.
+ */
+int __dataset_snapshot_load_unique_passengers(dataset_snapshot_reader_t *reader,
+                                              database_t                *database) {
+    uint32_t count;
+    __dataset_snapshot_read(reader, &count, sizeof(uint32_t));
+    if (reader->failed || count > (reader->length - reader->position) / 8) {
+        reader->failed = 1;
+        return 1;
+    }
+
+    time_cube_unique_passengers_t *const entries =
+        malloc(max(count, 1) * sizeof(time_cube_unique_passengers_t));
+    if (!entries)
+        return 1;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        __dataset_snapshot_read(reader, &entries[i].year, sizeof(uint16_t));
+        __dataset_snapshot_read(reader, &entries[i].month, sizeof(uint8_t));
+        __dataset_snapshot_read(reader, &entries[i].day, sizeof(uint8_t));
+        __dataset_snapshot_read(reader, &entries[i].count, sizeof(uint32_t));
+    }
+
+    const int retval =
+        reader->failed || database_restore_unique_passengers(database, entries, count);
+    free(entries);
+    return retval;
+}
+
+/**
+ * @brief   Reads a list of heavy hitters of a catalog from a snapshot.
+ * @details Auxiliary method for ::__dataset_snapshot_load_catalog.
+ *
+ * @param reader  Snapshot body, positioned at the beginning of the heavy hitters.
+ * @param n       Where to write the number of heavy hitters to.
+ * @param hitters Where to write the heavy hitters to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Reading failure.
+ */
+int __dataset_snapshot_load_hitters(dataset_snapshot_reader_t       *reader,
+                                    uint32_t                        *n,
+                                    database_catalog_heavy_hitter_t *hitters) {
+    __dataset_snapshot_read(reader, n, sizeof(uint32_t));
+    if (reader->failed || *n > DATABASE_CATALOG_HEAVY_HITTER_COUNT) {
+        reader->failed = 1;
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < *n; ++i) {
+        __dataset_snapshot_read(reader, &hitters[i].key, sizeof(uint32_t));
+        __dataset_snapshot_read(reader, &hitters[i].count, sizeof(uint32_t));
+    }
+    return reader->failed;
+}
+
+/**
+ * @brief   Restores the catalog of a database from a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_load. All entities must already have been
+ *          restored, as adding them discards the catalog.
+ *
+ * @param reader   Snapshot body, positioned at the beginning of the catalog section.
+ * @param database Where to restore the catalog to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Reading failure.
+ */
+int __dataset_snapshot_load_catalog(dataset_snapshot_reader_t *reader, database_t *database) {
+    database_catalog_t catalog;
+    uint64_t           counts[7];
+    __dataset_snapshot_read(reader, counts, sizeof(counts));
+    catalog.users        = counts[0];
+    catalog.active_users = counts[1];
+    catalog.flights      = counts[2];
+    catalog.passengers   = counts[3];
+    catalog.reservations = counts[4];
+    catalog.airports     = counts[5];
+    catalog.hotels       = counts[6];
+
+    if (__dataset_snapshot_load_hitters(reader,
+                                        &catalog.hotel_hitter_count,
+                                        catalog.hotel_hitters) ||
+        __dataset_snapshot_load_hitters(reader,
+                                        &catalog.airport_hitter_count,
+                                        catalog.airport_hitters))
+        return 1;
+
+    database_catalog_date_range_t *const ranges[] = {&catalog.user_dates,
+                                                     &catalog.flight_dates,
+                                                     &catalog.reservation_dates};
+    for (size_t i = 0; i < sizeof(ranges) / sizeof(*ranges); ++i) {
+        __dataset_snapshot_read(reader, &ranges[i]->first, sizeof(date_t));
+        __dataset_snapshot_read(reader, &ranges[i]->last, sizeof(date_t));
+    }
+
+    __dataset_snapshot_read(reader, catalog.name_prefixes, sizeof(catalog.name_prefixes));
+    if (reader->failed)
+        return 1;
+
+    database_restore_catalog(database, &catalog);
+    return 0;
+}
+
+/**
+ * @brief   Restores all reservations from a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_load. Users must already have been restored.
+ *
+ * @param reader    Snapshot body, positioned at the beginning of the reservations section.
+ * @param database  Where to add the reservations to.
+ * @param borrowing Allocators for reservations whose strings are borrowed from the snapshot, or
+ *                  `NULL` for reservations to own copies of their strings.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation or reading failure.
+ */
+int __dataset_snapshot_load_reservations(dataset_snapshot_reader_t    *reader,
+                                         database_t                   *database,
+                                         dataset_snapshot_borrowing_t *borrowing) {
+
+    pool_t *const                      pool        = borrowing ? borrowing->reservations : NULL;
+    string_pool_no_duplicates_t *const strings     = borrowing ? borrowing->unique_strings : NULL;
+    reservation_t *const               reservation = reservation_create(pool);
+    if (!reservation)
+        return 1;
+
+    int retval = 0;
+    while (!retval && __dataset_snapshot_read_marker(reader)) {
+        reservation_id_t id;
+        uint32_t         user_index;
+        hotel_id_t       hotel_id;
+        uint8_t          hotel_stars, city_tax, includes_breakfast, rating;
+        uint16_t         price_per_night;
+        date_t           begin_date, end_date;
+
+        __dataset_snapshot_read(reader, &id, sizeof(reservation_id_t));
+        __dataset_snapshot_read(reader, &user_index, sizeof(uint32_t));
+        __dataset_snapshot_read(reader, &hotel_id, sizeof(hotel_id_t));
+        const char *const hotel_name = __dataset_snapshot_read_string(reader);
+        __dataset_snapshot_read(reader, &hotel_stars, sizeof(uint8_t));
+        __dataset_snapshot_read(reader, &city_tax, sizeof(uint8_t));
+        __dataset_snapshot_read(reader, &price_per_night, sizeof(uint16_t));
+        __dataset_snapshot_read(reader, &includes_breakfast, sizeof(uint8_t));
+        __dataset_snapshot_read(reader, &begin_date, sizeof(date_t));
+        __dataset_snapshot_read(reader, &end_date, sizeof(date_t));
+        __dataset_snapshot_read(reader, &rating, sizeof(uint8_t));
+
+        reservation_reset_dates(reservation);
+        reservation_set_id(reservation, id);
+        reservation_set_user_index(reservation, user_index);
+        reservation_set_hotel_id(reservation, hotel_id);
+        reservation_set_city_tax(reservation, city_tax);
+        reservation_set_includes_breakfast(reservation, includes_breakfast);
+
+        retval = reader->failed ||
+                 !user_manager_get_by_index(database_get_users(database), user_index) ||
+                 reservation_set_hotel_name(strings, reservation, hotel_name) ||
+                 reservation_set_hotel_stars(reservation, hotel_stars) ||
+                 reservation_set_price_per_night(reservation, price_per_night) ||
+                 reservation_set_begin_date(reservation, begin_date) ||
+                 reservation_set_end_date(reservation, end_date) ||
+                 reservation_set_rating(reservation, rating) ||
+                 database_add_reservation(database, reservation);
+    }
+
+    if (!borrowing)
+        reservation_free(reservation);
+    return retval || reader->failed;
+}
+
+/**
+ * @brief   Reports all errors stored in a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_load.
+ *
+ * @param reader Snapshot body, positioned at the beginning of the errors sections.
+ * @param output Where to report the errors to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Reading failure.
+ */
+int __dataset_snapshot_load_errors(dataset_snapshot_reader_t *reader,
+                                   dataset_error_output_t    *output) {
+
+    void (*const reporters[DATASET_SNAPSHOT_SOURCE_COUNT])(dataset_error_output_t *, const char *) =
+        {dataset_error_output_report_user_error,
+         dataset_error_output_report_flight_error,
+         dataset_error_output_report_passenger_error,
+         dataset_error_output_report_reservation_error};
+
+    for (size_t i = 0; i < DATASET_SNAPSHOT_SOURCE_COUNT; ++i) {
+        while (__dataset_snapshot_read_marker(reader)) {
+            const char *const line = __dataset_snapshot_read_string(reader);
+            if (reader->failed)
+                return 1;
+
+            reporters[i](output, line);
+        }
+    }
+
+    return reader->failed;
+}
+
+/**
+ * @brief   Restores a database from a snapshot.
+ * @details Auxiliary method for ::dataset_snapshot_load and ::dataset_snapshot_load_shipped.
+ *
+ * @param database       Empty database where to store the dataset's data.
+ * @param snapshot_path  Path to the snapshot file.
+ * @param sources        Current metadata of the dataset's files, that must match the snapshot's,
+ *                       or `NULL` for a snapshot that isn't checked against any dataset files.
+ * @param output         Where to output dataset errors to.
+ * @param needs_errors   Whether dataset errors are needed.
+ * @param out_identifier Where to write the identifier of the snapshot to, on success. Can be
+ *                       `NULL`.
+ *
+ * @retval 0                                  Success.
+ * @retval DATASET_SNAPSHOT_LOAD_RET_UNUSABLE The snapshot can't be used.
+ * @retval DATASET_SNAPSHOT_LOAD_RET_FATAL    Allocation failure.
+ */
+int __dataset_snapshot_load(database_t                     *database,
+                            const char                     *snapshot_path,
+                            const dataset_snapshot_source_t sources[DATASET_SNAPSHOT_SOURCE_COUNT],
+                            dataset_error_output_t         *output,
+                            int                             needs_errors,
+                            uint64_t                       *out_identifier) {
+
+    mapped_file_t *const file = mapped_file_open(snapshot_path);
+    if (!file)
+        return DATASET_SNAPSHOT_LOAD_RET_UNUSABLE;
+
+    const char *const map  = mapped_file_get_data(file);
+    const size_t      size = mapped_file_get_size(file);
+
+    int                          retval = DATASET_SNAPSHOT_LOAD_RET_UNUSABLE;
+    dataset_snapshot_borrowing_t borrowing_allocators = {0};
+    dataset_snapshot_header_t    header;
+    if (size < sizeof(dataset_snapshot_header_t))
+        goto DEFER_1;
+    memcpy(&header, map, sizeof(dataset_snapshot_header_t));
+
+    if (memcmp(header.magic, DATASET_SNAPSHOT_MAGIC, sizeof(DATASET_SNAPSHOT_MAGIC)) ||
+        header.version != DATASET_SNAPSHOT_VERSION ||
+        header.byte_order != DATASET_SNAPSHOT_BYTE_ORDER ||
+        header.body_length != size - sizeof(dataset_snapshot_header_t) ||
+        (sources && memcmp(header.sources, sources, sizeof(header.sources))) ||
+        (needs_errors && !(header.flags & DATASET_SNAPSHOT_FLAG_HAS_ERRORS)))
+        goto DEFER_1;
+
+    dataset_snapshot_reader_t reader = {.data     = (const uint8_t *) map + sizeof(header),
+                                        .length   = header.body_length,
+                                        .position = 0,
+                                        .failed   = 0};
+
+    if (__dataset_snapshot_checksum(0xcbf29ce484222325, reader.data, reader.length) !=
+        header.body_checksum)
+        goto DEFER_1;
+
+    /* From now on, the database is modified, and failures can't be reverted */
+    retval = DATASET_SNAPSHOT_LOAD_RET_FATAL;
+
+    const char *const borrow_env = getenv(DATASET_SNAPSHOT_BORROW_ENVIRONMENT_VARIABLE);
+    const int         external   = borrow_env && strcmp(borrow_env, "external") == 0;
+    dataset_snapshot_borrowing_t *borrowing = NULL;
+    if (external || (borrow_env && strcmp(borrow_env, "1") == 0)) {
+        borrowing = &borrowing_allocators;
+        if (__dataset_snapshot_borrowing_create(borrowing, file) ||
+            database_borrow_strings(database, file))
+            goto DEFER_1;
+    }
+
+    if (__dataset_snapshot_load_flights(&reader, database, borrowing) ||
+        __dataset_snapshot_load_users(&reader, database, borrowing) ||
+        __dataset_snapshot_load_reservations(&reader, database, borrowing))
+        goto DEFER_1;
+
+    if ((header.flags & DATASET_SNAPSHOT_FLAG_HAS_USER_NAMES) &&
+        __dataset_snapshot_load_user_names(&reader, database))
+        goto DEFER_1;
+
+    if ((header.flags & DATASET_SNAPSHOT_FLAG_HAS_DELAY_MEDIANS) &&
+        __dataset_snapshot_load_delay_medians(&reader, database))
+        goto DEFER_1;
+
+    if ((header.flags & DATASET_SNAPSHOT_FLAG_HAS_UNIQUE_PASSENGERS) &&
+        __dataset_snapshot_load_unique_passengers(&reader, database))
+        goto DEFER_1;
+
+    if ((header.flags & DATASET_SNAPSHOT_FLAG_HAS_CATALOG) &&
+        __dataset_snapshot_load_catalog(&reader, database))
+        goto DEFER_1;
+
+    if ((header.flags & DATASET_SNAPSHOT_FLAG_HAS_ERRORS) &&
+        __dataset_snapshot_load_errors(&reader, output))
+        goto DEFER_1;
+
+    /* Only strings are left to be read, by scans or on demand */
+    if (external) {
+        mapped_file_set_access(file, MAPPED_FILE_ACCESS_RANDOM);
+        mapped_file_evict(file);
+    }
+
+    if (out_identifier)
+        *out_identifier = header.body_checksum;
+    retval = 0;
+DEFER_1:
+    __dataset_snapshot_borrowing_free(&borrowing_allocators);
+    mapped_file_unref(file); /* Still mapped if the database borrowed strings from it */
+    return retval;
+}
+
+int dataset_snapshot_load(database_t             *database,
+                          const char             *dataset_path,
+                          dataset_error_output_t *output,
+                          int                     needs_errors,
+                          uint64_t               *out_identifier) {
+
+    char                      snapshot_path[PATH_MAX];
+    dataset_snapshot_source_t sources[DATASET_SNAPSHOT_SOURCE_COUNT];
+    if (dataset_snapshot_get_path(dataset_path, snapshot_path) ||
+        __dataset_snapshot_get_sources(sources, dataset_path))
+        return DATASET_SNAPSHOT_LOAD_RET_UNUSABLE;
+
+    return __dataset_snapshot_load(database,
+                                   snapshot_path,
+                                   sources,
+                                   output,
+                                   needs_errors,
+                                   out_identifier);
+}
+
+int dataset_snapshot_load_shipped(database_t             *database,
+                                  const char             *directory,
+                                  dataset_error_output_t *output) {
+    char snapshot_path[PATH_MAX];
+    if (snprintf(snapshot_path, PATH_MAX, "%s/%s", directory, DATASET_SNAPSHOT_FILE_NAME) >=
+        PATH_MAX)
+        return DATASET_SNAPSHOT_LOAD_RET_UNUSABLE;
+
+    return __dataset_snapshot_load(database, snapshot_path, NULL, output, 0, NULL);
+}
+
+int dataset_snapshot_save(const database_t *database,
+                          const char       *dataset_path,
+                          const char       *errors_path) {
+
+    if (!database_is_frozen(database))
+        return 1;
+
+    dataset_snapshot_header_t header;
+    memset(&header, 0, sizeof(dataset_snapshot_header_t)); /* No uninitialized bytes in the file */
+    memcpy(header.magic, DATASET_SNAPSHOT_MAGIC, sizeof(DATASET_SNAPSHOT_MAGIC));
+    header.version    = DATASET_SNAPSHOT_VERSION;
+    header.flags      = errors_path ? DATASET_SNAPSHOT_FLAG_HAS_ERRORS : 0;
+    header.byte_order = DATASET_SNAPSHOT_BYTE_ORDER;
+    if (__dataset_snapshot_get_sources(header.sources, dataset_path))
+        return 1;
+
+    char snapshot_path[PATH_MAX], temporary_path[PATH_MAX];
+    if (dataset_snapshot_get_path(dataset_path, snapshot_path) ||
+        snprintf(temporary_path, PATH_MAX, "%s.tmp", snapshot_path) >= PATH_MAX)
+        return 1;
+
+    const char *const directory = getenv(DATASET_SNAPSHOT_DIRECTORY_ENVIRONMENT_VARIABLE);
+    if (mkdir(directory, 0755) && errno != EEXIST)
+        return 1;
+
+    dataset_snapshot_writer_t *const writer = malloc(sizeof(dataset_snapshot_writer_t));
+    if (!writer)
+        return 1;
+
+    writer->file = fopen(temporary_path, "wb");
+    if (!writer->file) {
+        free(writer);
+        return 1;
+    }
+    writer->length   = 0;
+    writer->checksum = 0xcbf29ce484222325;
+    writer->used     = 0;
+    writer->failed   = 0;
+
+    /* Placeholder header, rewritten when the body's length and checksum are known */
+    if (fwrite(&header, sizeof(dataset_snapshot_header_t), 1, writer->file) != 1)
+        writer->failed = 1;
+
+    flight_manager_iter(database_get_flights(database), __dataset_snapshot_save_flight, writer);
+    __dataset_snapshot_write_marker(writer, 0);
+    user_manager_iter_with_flights(database_get_users(database),
+                                   __dataset_snapshot_save_user,
+                                   writer);
+    __dataset_snapshot_write_marker(writer, 0);
+    reservation_manager_iter(database_get_reservations(database),
+                             __dataset_snapshot_save_reservation,
+                             writer);
+    __dataset_snapshot_write_marker(writer, 0);
+
+    const GArray        *user_names;
+    const prefix_trie_t *user_name_trie;
+    if (!database_get_user_name_index(database, &user_names, &user_name_trie)) {
+        header.flags |= DATASET_SNAPSHOT_FLAG_HAS_USER_NAMES;
+        __dataset_snapshot_save_user_names(writer,
+                                           user_names,
+                                           user_name_trie,
+                                           database_get_users(database));
+    }
+
+    const GArray *delay_medians;
+    if (!database_get_origin_delay_median_index(database, &delay_medians)) {
+        header.flags |= DATASET_SNAPSHOT_FLAG_HAS_DELAY_MEDIANS;
+        __dataset_snapshot_save_delay_medians(writer, delay_medians);
+    }
+
+    const time_cube_t *const time_cube              = database_get_time_cube(database);
+    uint32_t                 unique_passenger_count = 0;
+    if (!time_cube_iter_unique_passengers(time_cube,
+                                          __dataset_snapshot_count_unique_passengers,
+                                          &unique_passenger_count)) {
+        header.flags |= DATASET_SNAPSHOT_FLAG_HAS_UNIQUE_PASSENGERS;
+        __dataset_snapshot_write(writer, &unique_passenger_count, sizeof(uint32_t));
+        time_cube_iter_unique_passengers(time_cube,
+                                         __dataset_snapshot_save_unique_passengers,
+                                         writer);
+    }
+
+    const database_catalog_t *const catalog = database_get_catalog(database);
+    if (catalog) {
+        header.flags |= DATASET_SNAPSHOT_FLAG_HAS_CATALOG;
+        __dataset_snapshot_save_catalog(writer, catalog);
+    }
+
+    if (errors_path && __dataset_snapshot_save_errors(writer, errors_path))
+        writer->failed = 1;
+    __dataset_snapshot_writer_flush(writer);
+
+    header.body_length   = writer->length;
+    header.body_checksum = writer->checksum;
+    if (fseek(writer->file, 0, SEEK_SET) ||
+        fwrite(&header, sizeof(dataset_snapshot_header_t), 1, writer->file) != 1)
+        writer->failed = 1;
+
+    int retval = fclose(writer->file) || writer->failed;
+    free(writer);
+
+    if (!retval)
+        retval = rename(temporary_path, snapshot_path) != 0;
+    if (retval)
+        remove(temporary_path);
+    return retval;
+}
+
+int dataset_snapshot_get_fingerprint(const char *dataset_path, uint64_t *out_fingerprint) {
+    dataset_snapshot_source_t sources[DATASET_SNAPSHOT_SOURCE_COUNT];
+    if (__dataset_snapshot_get_sources(sources, dataset_path))
+        return 1;
+
+    /* Snapshots of a different version would be outdated too */
+    const uint64_t version     = DATASET_SNAPSHOT_VERSION;
+    const uint64_t fingerprint = __dataset_snapshot_checksum(0xcbf29ce484222325,
+                                                       (const uint8_t *) &version,
+                                                       sizeof(uint64_t));
+    *out_fingerprint =
+        __dataset_snapshot_checksum(fingerprint, (const uint8_t *) sources, sizeof(sources));
+
+    /* Deltas replayed from the log also change the dataset's contents */
+    char        log_path[PATH_MAX];
+    struct stat log_stat;
+    snprintf(log_path, PATH_MAX, "%s/%s", dataset_path, DATASET_DELTA_LOG_FILE_NAME);
+    if (!stat(log_path, &log_stat) && log_stat.st_size > 0) {
+        const dataset_snapshot_source_t log_source = {
+            .size                     = (uint64_t) log_stat.st_size,
+            .modification_seconds     = (int64_t) log_stat.st_mtim.tv_sec,
+            .modification_nanoseconds = (int64_t) log_stat.st_mtim.tv_nsec};
+        *out_fingerprint = __dataset_snapshot_checksum(*out_fingerprint,
+                                                       (const uint8_t *) &log_source,
+                                                       sizeof(log_source));
+    }
+    return 0;
+}
+
+int dataset_snapshot_get_path(const char *dataset_path, char *out_path) {
+    const char *const directory = getenv(DATASET_SNAPSHOT_DIRECTORY_ENVIRONMENT_VARIABLE);
+    if (!directory || !*directory)
+        return 1;
+
+    /* The same dataset must always have the same snapshot, however its path is written */
+    char *const absolute_path = realpath(dataset_path, NULL);
+    if (!absolute_path)
+        return 1;
+    const uint64_t checksum = dataset_snapshot_checksum(absolute_path, strlen(absolute_path));
+    free(absolute_path);
+
+    return snprintf(out_path, PATH_MAX, "%s/%016" PRIx64 ".snapshot", directory, checksum) >=
+           PATH_MAX;
+}
+
+uint64_t dataset_snapshot_checksum(const void *data, size_t length) {
+    return __dataset_snapshot_checksum(0xcbf29ce484222325, data, length);
+}
+
+int dataset_snapshot_get_identity(const char *snapshot_path,
+                                  uint64_t   *out_identifier,
+                                  uint64_t   *out_length) {
+    FILE *const file = fopen(snapshot_path, "rb");
+    if (!file)
+        return 1;
+
+    dataset_snapshot_header_t header;
+    const int                 read_header = fread(&header, sizeof(header), 1, file) == 1;
+    fclose(file);
+
+    if (!read_header ||
+        memcmp(header.magic, DATASET_SNAPSHOT_MAGIC, sizeof(DATASET_SNAPSHOT_MAGIC)) ||
+        header.version != DATASET_SNAPSHOT_VERSION ||
+        header.byte_order != DATASET_SNAPSHOT_BYTE_ORDER)
+        return 1;
+
+    *out_identifier = header.body_checksum;
+    *out_length     = sizeof(dataset_snapshot_header_t) + header.body_length;
+    return 0;
+}
@@ -19,7 +19,7 @@
  * @brief Implementation of methods in include/dataset/flights_loader.h
  *
  * @details Many internal methods in this module are lacking parameter documentation, as they all
- *          follow the same convention: all are ::fixed_n_delimiter_parser_iter_callback_t. The
+ *          follow the same convention: all are ::dataset_parser_column_callback. The
  *          `loader_data` is a pointer to a ::flights_loader_t.
  */
 
@@ -29,12 +29,6 @@
 #include "dataset/flights_loader.h"
 #include "utils/int_utils.h"
 
-/** @cond FALSE */
-#ifndef __GNUC__
-    #define __builtin_unreachable() return 0;
-#endif
-/** @endcond */
-
 /**
  * @struct flights_loader_t
  * @brief  Temporary data needed to load a set of flights.
@@ -43,241 +37,295 @@
  *     @brief Where to output dataset errors to.
  * @var flights_loader_t::database
  *     @brief Database to add new flights to.
- * @var flights_loader_t::error_line
- *     @brief Current line being processed, in case it needs to be put in the error file.
- * @var flights_loader_t::current_flight
- *     @brief Flight being currently parsed, whose fields are still being filled in.
+ * @var flights_loader_t::lines
+ *     @brief Where to register the position of every valid flight's line. Can be `NULL`.
+ * @var flights_loader_t::line_offset
+ *     @brief Offset in the file of the first line of the next batch.
+ * @var flights_loader_t::batch
+ *     @brief Flights in the batch being currently parsed, whose fields are filled in column by
+ *            column.
  * @var flights_loader_t::first_line
- *     @brief   Whether the line being parsed is the first line in the file.
+ *     @brief   Whether the batch being parsed starts with the first line in the file.
  *     @details Used to print an error on the CSV's table header.
  */
 typedef struct {
     dataset_error_output_t *const output;
     database_t *const             database;
+    dataset_line_index_t *const   lines;
 
-    const char     *error_line;
-    flight_t *const current_flight;
-    int             first_line;
+    uint64_t  line_offset;
+    flight_t *batch[DATASET_PARSER_BATCH_SIZE];
+    int       first_line;
 } flights_loader_t;
 
-/**
- * @brief Stores the beginning of the current line, in case it needs to be printed to the errors
- *        file.
- *
- * @param loader_data A pointer to a ::flights_loader_t.
- * @param line        Line that is going to be parsed.
- *
- * @retval 0 Always successful.
- */
-int __flights_loader_before_parse_line(void *loader_data, char *line) {
-    ((flights_loader_t *) loader_data)->error_line = line;
-    return 0;
-}
-
-/** @brief Parses a flight's identifier. */
-int __flight_loader_parse_id(void *loader_data, char *token, size_t ntoken) {
-    (void) ntoken;
+/** @brief Parses flights' identifiers. */
+uint64_t __flights_loader_parse_ids(void        *loader_data,
+                                    char *const *tokens,
+                                    size_t       nrows,
+                                    size_t       ncolumn) {
+    (void) ncolumn;
     flights_loader_t *const loader = loader_data;
 
-    flight_id_t id;
-    const int   retval = flight_id_from_string(&id, token);
-    if (retval == 0) {
-        flight_set_id(loader->current_flight, id);
-    } else if (retval == 2 && !(loader->first_line && strcmp(token, "id") == 0)) {
-        fprintf(stderr,
-                "Flight ID \"%s\" is not numerical. This isn't supported by our program!\n",
-                token);
+    uint64_t valid = 0;
+    for (size_t i = 0; i < nrows; ++i) {
+        flight_id_t id;
+        const int   retval = flight_id_from_string(&id, tokens[i]);
+        if (retval == 0) {
+            flight_set_id(loader->batch[i], id);
+            valid |= (uint64_t) 1 << i;
+        } else if (retval == 2 && !(loader->first_line && i == 0 && strcmp(tokens[i], "id") == 0)) {
+            fprintf(stderr,
+                    "Flight ID \"%s\" is not numerical. This isn't supported by our program!\n",
+                    tokens[i]);
+        }
     }
-    return retval;
+    return valid;
 }
 
-/** @brief Parses a flight's airline and plane model (simple strings). */
-int __flight_loader_parse_string(void *loader_data, char *token, size_t ntoken) {
-    switch (ntoken) {
-        case 1:
-            return flight_set_airline(NULL,
-                                      ((flights_loader_t *) loader_data)->current_flight,
-                                      token);
-        case 2:
-            return flight_set_plane_model(NULL,
-                                          ((flights_loader_t *) loader_data)->current_flight,
-                                          token);
-        default:
-            __builtin_unreachable();
+/** @brief Parses flights' airlines or plane models (simple strings). */
+uint64_t __flights_loader_parse_strings(void        *loader_data,
+                                        char *const *tokens,
+                                        size_t       nrows,
+                                        size_t       ncolumn) {
+    flights_loader_t *const loader = loader_data;
+
+    uint64_t valid = 0;
+    for (size_t i = 0; i < nrows; ++i) {
+        const int retval = ncolumn == 1
+                               ? flight_set_airline(NULL, loader->batch[i], tokens[i])
+                               : flight_set_plane_model(NULL, loader->batch[i], tokens[i]);
+        valid |= (uint64_t) !retval << i;
     }
+    return valid;
 }
 
-/** @brief Parses a flight's total number of seats. */
-int __flight_loader_parse_total_seats(void *loader_data, char *token, size_t ntoken) {
-    (void) ntoken;
-
-    uint64_t  parsed_total_seats;
-    const int retval = int_utils_parse_positive(&parsed_total_seats, token);
-    if (retval)
-        return retval;
+/** @brief Parses flights' total numbers of seats. */
+uint64_t __flights_loader_parse_total_seats(void        *loader_data,
+                                            char *const *tokens,
+                                            size_t       nrows,
+                                            size_t       ncolumn) {
+    (void) ncolumn;
+    flights_loader_t *const loader = loader_data;
 
-    return flight_set_total_seats(((flights_loader_t *) loader_data)->current_flight,
-                                  parsed_total_seats);
+    uint64_t valid = 0;
+    for (size_t i = 0; i < nrows; ++i) {
+        uint64_t parsed_total_seats;
+        int      retval = int_utils_parse_positive(&parsed_total_seats, tokens[i]);
+        if (!retval)
+            retval = flight_set_total_seats(loader->batch[i], parsed_total_seats);
+        valid |= (uint64_t) !retval << i;
+    }
+    return valid;
 }
 
-/** @brief Parses a flight's origin or destination airport. */
-int __flight_loader_parse_airport(void *loader_data, char *token, size_t ntoken) {
+/** @brief Parses flights' origin or destination airports. */
+uint64_t __flights_loader_parse_airports(void        *loader_data,
+                                         char *const *tokens,
+                                         size_t       nrows,
+                                         size_t       ncolumn) {
     flights_loader_t *const loader = loader_data;
-
-    airport_code_t airport_code;
-    const int      retval = airport_code_from_string(&airport_code, token);
-    if (retval)
-        return retval;
-
-    switch (ntoken) {
-        case 4:
-            flight_set_origin(loader->current_flight, airport_code);
-            break;
-        case 5:
-            flight_set_destination(loader->current_flight, airport_code);
-            break;
-        default:
-            __builtin_unreachable();
+    void (*const setter)(flight_t *, airport_code_t) =
+        ncolumn == 4 ? flight_set_origin : flight_set_destination;
+
+    uint64_t valid = 0;
+    for (size_t i = 0; i < nrows; ++i) {
+        airport_code_t airport_code;
+        const int      retval = airport_code_from_string(&airport_code, tokens[i]);
+        if (!retval)
+            setter(loader->batch[i], airport_code);
+        valid |= (uint64_t) !retval << i;
     }
-    return 0;
+    return valid;
 }
 
-/** @brief Parses a flight's scheduled departure and arrival date. */
-int __flight_loader_parser_schedule_dates(void *loader_data, char *token, size_t ntoken) {
+/** @brief Parses flights' scheduled departure or arrival dates. */
+uint64_t __flights_loader_parse_schedule_dates(void        *loader_data,
+                                               char *const *tokens,
+                                               size_t       nrows,
+                                               size_t       ncolumn) {
     flights_loader_t *const loader = loader_data;
-
-    date_and_time_t date_and_time;
-    const int       retval = date_and_time_from_string(&date_and_time, token);
-    if (retval)
-        return retval;
-
-    switch (ntoken) {
-        case 6:
-            return flight_set_schedule_departure_date(loader->current_flight, date_and_time);
-        case 7:
-            return flight_set_schedule_arrival_date(loader->current_flight, date_and_time);
-        default:
-            __builtin_unreachable();
+    int (*const setter)(flight_t *, date_and_time_t) =
+        ncolumn == 6 ? flight_set_schedule_departure_date : flight_set_schedule_arrival_date;
+
+    uint64_t valid = 0;
+    for (size_t i = 0; i < nrows; ++i) {
+        date_and_time_t date_and_time;
+        int             retval = date_and_time_from_string(&date_and_time, tokens[i]);
+        if (!retval)
+            retval = setter(loader->batch[i], date_and_time);
+        valid |= (uint64_t) !retval << i;
     }
+    return valid;
 }
 
-/** @brief Parses a flight's real departure date. */
-int __flight_loader_parse_real_departure_date(void *loader_data, char *token, size_t ntoken) {
-    (void) ntoken;
-
-    date_and_time_t date_and_time;
-    const int       retval = date_and_time_from_string(&date_and_time, token);
-    if (retval)
-        return retval;
+/** @brief Parses flights' real departure dates. */
+uint64_t __flights_loader_parse_real_departure_dates(void        *loader_data,
+                                                     char *const *tokens,
+                                                     size_t       nrows,
+                                                     size_t       ncolumn) {
+    (void) ncolumn;
+    flights_loader_t *const loader = loader_data;
 
-    flight_set_real_departure_date(((flights_loader_t *) loader_data)->current_flight,
-                                   date_and_time);
-    return 0;
+    uint64_t valid = 0;
+    for (size_t i = 0; i < nrows; ++i) {
+        date_and_time_t date_and_time;
+        const int       retval = date_and_time_from_string(&date_and_time, tokens[i]);
+        if (!retval)
+            flight_set_real_departure_date(loader->batch[i], date_and_time);
+        valid |= (uint64_t) !retval << i;
+    }
+    return valid;
 }
 
-/** @brief Parses a flight's real arrival date. */
-int __flight_loader_parse_real_arrival_date(void *loader_data, char *token, size_t ntoken) {
-    (void) ntoken;
-
-    date_and_time_t date_and_time;
-    const int       retval = date_and_time_from_string(&date_and_time, token);
-    if (retval)
-        return retval;
+/**
+ * @brief   Parses flights' real arrival dates.
+ * @details This check is performed in the parser, as flights don't store this field. Flights
+ *          whose real departure date is invalid may be compared with an older date, but they're
+ *          already invalid.
+ */
+uint64_t __flights_loader_parse_real_arrival_dates(void        *loader_data,
+                                                   char *const *tokens,
+                                                   size_t       nrows,
+                                                   size_t       ncolumn) {
+    (void) ncolumn;
+    flights_loader_t *const loader = loader_data;
 
-    /* This check is performed in the parser, as flights don't store this field. */
-    const date_and_time_t departure_date =
-        flight_get_real_departure_date(((flights_loader_t *) loader_data)->current_flight);
-    return date_and_time_diff(date_and_time, departure_date) < 0;
+    uint64_t valid = 0;
+    for (size_t i = 0; i < nrows; ++i) {
+        date_and_time_t date_and_time;
+        const int       retval = date_and_time_from_string(&date_and_time, tokens[i]);
+        if (!retval) {
+            const date_and_time_t departure_date = flight_get_real_departure_date(loader->batch[i]);
+            valid |= (uint64_t) (date_and_time_diff(date_and_time, departure_date) >= 0) << i;
+        }
+    }
+    return valid;
 }
 
-/** @brief Parses a flight's pilot and copilot name. */
-int __flight_loader_parse_pilot_copilot(void *loader_data, char *token, size_t ntoken) {
-    (void) ntoken;
+/** @brief Parses flights' pilot or copilot names. */
+uint64_t __flights_loader_parse_pilots_copilots(void        *loader_data,
+                                                char *const *tokens,
+                                                size_t       nrows,
+                                                size_t       ncolumn) {
     (void) loader_data;
-    return (*token == 0); /* Fail on empty pilot / copilot name */
+    (void) ncolumn;
+
+    uint64_t valid = 0;
+    for (size_t i = 0; i < nrows; ++i)
+        valid |= (uint64_t) (*tokens[i] != '\0') << i; /* Fail on empty pilot / copilot name */
+    return valid;
 }
 
-/** @brief Parses a flight's notes. */
-int __flight_loader_parse_notes(void *loader_data, char *token, size_t ntoken) {
-    (void) ntoken;
+/** @brief Parses flights' notes. */
+uint64_t __flights_loader_parse_notes(void        *loader_data,
+                                      char *const *tokens,
+                                      size_t       nrows,
+                                      size_t       ncolumn) {
     (void) loader_data;
-    (void) token;
-    return 0;
+    (void) tokens;
+    (void) nrows;
+    (void) ncolumn;
+    return UINT64_MAX;
 }
 
 /**
- * @brief Places a parsed flight in the database and handles parsing errors.
+ * @brief   Places the valid flights of a parsed batch in the database, and reports the invalid
+ *          ones as errors, in file order.
+ * @details The position of each line in the file is also registered in ::flights_loader_t::lines,
+ *          so that lines can be printed later, if their flights are invalidated after loading (see
+ *          ::flights_loader_load).
  *
  * @param loader_data A pointer to a ::flights_loader_t.
- * @param retval      Value returned by the last token callback (`0` for success, another value for
- *                    a parsing error).
+ * @param lines       Lines in the batch.
+ * @param lengths     Length of each line in @p lines.
+ * @param nrows       Number of lines in the batch.
+ * @param valid       Mask of the valid lines.
  *
  * @retval 0 Success.
  * @retval 1 Allocation failure.
  */
-int __flights_loader_after_parse_line(void *loader_data, int retval) {
+int __flights_loader_after_parse_batch(void         *loader_data,
+                                       char *const  *lines,
+                                       const size_t *lengths,
+                                       size_t        nrows,
+                                       uint64_t      valid) {
     flights_loader_t *const loader = loader_data;
     loader->first_line             = 0;
 
-    if (retval) {
-        dataset_error_output_report_flight_error(loader->output, loader->error_line);
-        retval = 0;
-    } else {
-        retval = database_add_flight(loader->database, loader->current_flight);
+    int retval = 0;
+    for (size_t i = 0; i < nrows; ++i) {
+        const uint64_t line_offset = loader->line_offset;
+        loader->line_offset += lengths[i] + 1; /* All lines are followed by a line delimiter */
+
+        if (!retval) {
+            if (!(valid & ((uint64_t) 1 << i))) {
+                dataset_error_output_report_flight_error(loader->output, lines[i]);
+            } else {
+                retval = database_add_flight(loader->database, loader->batch[i]);
+                if (!retval && loader->lines)
+                    retval = dataset_line_index_add(loader->lines,
+                                                    flight_get_id(loader->batch[i]),
+                                                    line_offset,
+                                                    lines[i],
+                                                    lengths[i]);
+            }
+        }
+
+        flight_reset_schedule_dates(loader->batch[i]);
     }
-
-    flight_reset_schedule_dates(loader->current_flight);
     return retval;
 }
 
-int flights_loader_load(FILE *stream, database_t *database, dataset_error_output_t *output) {
-    flights_loader_t data = {.output         = output,
-                             .database       = database,
-                             .current_flight = flight_create(NULL),
-                             .first_line     = 1};
-    if (!data.current_flight)
-        return 1;
-    flight_set_number_of_passengers(data.current_flight, 0);
-
-    const fixed_n_delimiter_parser_iter_callback_t token_callbacks[13] = {
-        __flight_loader_parse_id,
-        __flight_loader_parse_string,
-        __flight_loader_parse_string,
-        __flight_loader_parse_total_seats,
-        __flight_loader_parse_airport,
-        __flight_loader_parse_airport,
-        __flight_loader_parser_schedule_dates,
-        __flight_loader_parser_schedule_dates,
-        __flight_loader_parse_real_departure_date,
-        __flight_loader_parse_real_arrival_date,
-        __flight_loader_parse_pilot_copilot,
-        __flight_loader_parse_pilot_copilot,
-        __flight_loader_parse_notes,
+int flights_loader_load(FILE                   *stream,
+                        database_t             *database,
+                        dataset_line_index_t   *lines,
+                        dataset_error_output_t *output,
+                        dataset_progress_t     *progress) {
+    int              retval = 1;
+    flights_loader_t data   = {.output      = output,
+                               .database    = database,
+                               .lines       = lines,
+                               .line_offset = 0,
+                               .batch       = {NULL},
+                               .first_line  = 1};
+    for (size_t i = 0; i < DATASET_PARSER_BATCH_SIZE; ++i)
+        if (!(data.batch[i] = flight_create(NULL)))
+            goto DEFER_1;
+
+    const dataset_parser_column_callback column_callbacks[13] = {
+        __flights_loader_parse_ids,
+        __flights_loader_parse_strings,
+        __flights_loader_parse_strings,
+        __flights_loader_parse_total_seats,
+        __flights_loader_parse_airports,
+        __flights_loader_parse_airports,
+        __flights_loader_parse_schedule_dates,
+        __flights_loader_parse_schedule_dates,
+        __flights_loader_parse_real_departure_dates,
+        __flights_loader_parse_real_arrival_dates,
+        __flights_loader_parse_pilots_copilots,
+        __flights_loader_parse_pilots_copilots,
+        __flights_loader_parse_notes,
     };
 
-    fixed_n_delimiter_parser_grammar_t *const line_grammar =
-        fixed_n_delimiter_parser_grammar_new(';', 13, token_callbacks);
-    if (!line_grammar) {
-        flight_free(data.current_flight);
-        return 1;
-    }
-
     dataset_parser_grammar_t *const grammar =
-        dataset_parser_grammar_new('\n',
-                                   line_grammar,
-                                   __flights_loader_before_parse_line,
-                                   __flights_loader_after_parse_line);
-    if (!grammar) {
-        flight_free(data.current_flight);
-        fixed_n_delimiter_parser_grammar_free(line_grammar);
-        return 1;
-    }
-
-    const int retval = dataset_parser_parse(stream, grammar, &data);
+        dataset_parser_grammar_new_batch('\n',
+                                         ';',
+                                         13,
+                                         column_callbacks,
+                                         __flights_loader_after_parse_batch);
+    if (!grammar)
+        goto DEFER_1;
+    dataset_parser_grammar_set_progress(grammar,
+                                        progress,
+                                        PERFORMANCE_METRICS_DATASET_STEP_FLIGHTS);
+
+    retval = dataset_parser_parse(stream, grammar, &data) != 0;
 
     dataset_parser_grammar_free(grammar);
-    fixed_n_delimiter_parser_grammar_free(line_grammar);
-    flight_free(data.current_flight);
-
-    return retval != 0;
+DEFER_1:
+    for (size_t i = 0; i < DATASET_PARSER_BATCH_SIZE; ++i)
+        if (data.batch[i])
+            flight_free(data.batch[i]);
+    return retval;
 }
@@ -21,14 +21,35 @@
 
 #include <glib.h>
 #include <limits.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "dataset/dataset_parser.h"
 #include "dataset/passengers_loader.h"
-#include "utils/stream_utils.h"
 #include "utils/string_pool.h"
 
-/** @brief Block capacity of ::passengers_loader_t::commit_buffer_id_pool. */
-#define PASSENGERS_LOADER_ID_POOL_BLOCK_CAPACITY 8192
+/** @brief Block capacity of ::passengers_loader_t::staged_strings. */
+#define PASSENGERS_LOADER_STAGED_STRINGS_BLOCK_CAPACITY 100000
+
+/**
+ * @struct passengers_loader_staged_line_t
+ * @brief  Result of parsing a line in a chunk of `passengers.csv`.
+ *
+ * @var passengers_loader_staged_line_t::text
+ *     @brief The whole line if it's invalid, `NULL` otherwise.
+ * @var passengers_loader_staged_line_t::flight
+ *     @brief Identifier of the flight in the line. Only meaningful if the line is valid.
+ * @var passengers_loader_staged_line_t::user
+ *     @brief Index of the user in the line. Only meaningful if the line is valid.
+ * @var passengers_loader_staged_line_t::valid
+ *     @brief Whether the line was successfully parsed.
+ */
+typedef struct {
+    const char *text;
+    flight_id_t flight;
+    uint32_t    user;
+    int         valid;
+} passengers_loader_staged_line_t;
 
 /**
  * @struct passengers_loader_t
@@ -43,40 +64,48 @@
  * @var passengers_loader_t::flights
  *     @brief Flight manager to check for flight existence.
  * @var passengers_loader_t::commit_buffer
- *     @brief All passengers (user ID strings) in the flight being currently parsed.
+ *     @brief All passengers (`uint32_t` user indices) in the flight being currently parsed.
  * @var passengers_loader_t::commit_buffer_flight
  *     @brief Flight that ::passengers_loader_t::commit_buffer refers to.
- * @var passengers_loader_t::commit_buffer_id_pool
- *     @brief Pool where IDs in ::passengers_loader_t::commit_buffer are stored.
  * @var passengers_loader_t::current_user
- *     @brief User ID in the line currently being parsed.
+ *     @brief Index of the user in the line currently being parsed.
  * @var passengers_loader_t::current_flight
  *     @brief Flight ID in the line currently being parsed.
  * @var passengers_loader_t::invalid_flight_ids
  *     @brief   List of invalid flight IDs to be printed to the errors file.
- *     @details That is done only after fully loading the `passengers.csv` file.
+ *     @details That is done only after fully loading the `passengers.csv` file. A flight whose
+ *              passengers aren't contiguous in the file is listed once for each of its groups of
+ *              passengers that failed to be added.
  * @var passengers_loader_t::error_line
  *     @brief Current line being processed, in case it needs to be put in the error file.
+ * @var passengers_loader_t::staged_lines
+ *     @brief   Results of every line (::passengers_loader_staged_line_t) in the chunk of the file
+ *              parsed by this loader.
+ *     @details `NULL` when lines are immediately processed by this loader. Otherwise, they're only
+ *              processed by another loader, in ::__passengers_loader_merge.
+ * @var passengers_loader_t::staged_strings
+ *     @brief Pool where ::passengers_loader_staged_line_t::text strings are stored.
  * @var passengers_loader_t::first_line
  *     @brief   Whether the line being parsed is the first line in the file.
  *     @details Used to print an error on the CSV's table header.
  */
 typedef struct {
-    dataset_error_output_t *const output;
-    database_t *const             database;
-    const user_manager_t *const   users;
-    const flight_manager_t *const flights;
+    dataset_error_output_t *output;
+    database_t             *database;
+    const user_manager_t   *users;
+    const flight_manager_t *flights;
 
-    GPtrArray *const commit_buffer;
-    flight_id_t      commit_buffer_flight;
-    string_pool_t   *commit_buffer_id_pool;
+    GArray     *commit_buffer;
+    flight_id_t commit_buffer_flight;
 
-    const char *current_user;
+    uint32_t    current_user;
     flight_id_t current_flight;
 
-    GArray *const invalid_flight_ids;
-    const char   *error_line;
-    int           first_line;
+    GArray        *invalid_flight_ids;
+    const char    *error_line;
+    GArray        *staged_lines;
+    string_pool_t *staged_strings;
+    int            first_line;
 } passengers_loader_t;
 
 /**
@@ -85,10 +114,12 @@ typedef struct {
  *
  * @param loader_data A pointer to a ::flights_loader_t.
  * @param line        Line that is going to be parsed.
+ * @param length      Length of @p line. Not used.
  *
  * @retval 0 Always successful.
  */
-int __passengers_loader_before_parse_line(void *loader_data, char *line) {
+int __passengers_loader_before_parse_line(void *loader_data, char *line, size_t length) {
+    (void) length;
     ((passengers_loader_t *) loader_data)->error_line = line;
     return 0;
 }
@@ -135,10 +166,20 @@ int __passengers_loader_parse_user_id(void *loader_data, char *token, size_t nto
     passengers_loader_t *const loader = loader_data;
 
     /* Fail if the user isn't found (invalid user won't be found too). */
-    loader->current_user = token;
-    return user_manager_get_by_id(loader->users, token) == NULL;
+    return user_manager_get_index_by_id(loader->users, token, &loader->current_user);
 }
 
+/** @brief Schema of a line of `passengers.csv` (see ::FIXED_N_DELIMITER_PARSER_DEFINE). */
+#define PASSENGERS_LOADER_SCHEMA(FIELD)                                                            \
+    FIELD(__passengers_loader_parse_flight_id)                                                     \
+    FIELD(__passengers_loader_parse_user_id)
+
+/**
+ * @brief Parses a line of `passengers.csv`, calling the callbacks in ::PASSENGERS_LOADER_SCHEMA
+ *        directly.
+ */
+FIXED_N_DELIMITER_PARSER_DEFINE(__passengers_loader_parse_line, ';', PASSENGERS_LOADER_SCHEMA)
+
 /**
  * @brief Adds all passengers in the commit buffer to the database.
  * @param loader Current state of the loader of the passengers file.
@@ -150,7 +191,7 @@ void __passengers_loader_commit_flight_list(passengers_loader_t *loader) {
     if (database_add_passengers(loader->database,
                                 loader->commit_buffer_flight,
                                 loader->commit_buffer->len,
-                                (const char *const *) loader->commit_buffer->pdata)) {
+                                (const uint32_t *) loader->commit_buffer->data)) {
 
         /* Print passengers as invalid (ignore allocation failures) */
         char full_print_buffer[LINE_MAX];
@@ -160,15 +201,59 @@ void __passengers_loader_commit_flight_list(passengers_loader_t *loader) {
         char *const print_buffer = full_print_buffer + 11;
 
         for (size_t i = 0; i < loader->commit_buffer->len; ++i) {
-            strcpy(print_buffer, g_ptr_array_index(loader->commit_buffer, i));
+            const uint32_t      user_index = g_array_index(loader->commit_buffer, uint32_t, i);
+            const user_t *const user       = user_manager_get_by_index(loader->users, user_index);
+            strcpy(print_buffer, user_get_const_id(user));
             dataset_error_output_report_passenger_error(loader->output, full_print_buffer);
         }
 
         g_array_append_val(loader->invalid_flight_ids, loader->commit_buffer_flight);
     }
 
-    string_pool_empty(loader->commit_buffer_id_pool);
-    g_ptr_array_set_size(loader->commit_buffer, 0);
+    g_array_set_size(loader->commit_buffer, 0);
+}
+
+/**
+ * @brief Adds a valid passenger to the commit buffer, committing the previous flight if needed.
+ *
+ * @param loader Current state of the loader of the passengers file.
+ * @param flight Identifier of the flight of the passenger.
+ * @param user   Index of the user of the passenger.
+ */
+void __passengers_loader_add_passenger(passengers_loader_t *loader,
+                                       flight_id_t          flight,
+                                       uint32_t             user) {
+
+    /* Flush passengers if this a new flight */
+    if (flight != loader->commit_buffer_flight)
+        __passengers_loader_commit_flight_list(loader);
+
+    /* Add flight */
+    g_array_append_val(loader->commit_buffer, user);
+    loader->commit_buffer_flight = flight;
+}
+
+/**
+ * @brief Stores the result of parsing a line, to be processed later by ::__passengers_loader_merge.
+ *
+ * @param loader Loader of a chunk of the passengers file.
+ * @param valid  Whether the line was successfully parsed.
+ * @param text   The whole line, if it's invalid. Not used for valid lines.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __passengers_loader_stage_line(passengers_loader_t *loader, int valid, const char *text) {
+    const passengers_loader_staged_line_t line = {
+        .text   = valid ? NULL : string_pool_put(loader->staged_strings, text),
+        .flight = loader->current_flight,
+        .user   = loader->current_user,
+        .valid  = valid};
+    if (!valid && !line.text)
+        return 1;
+
+    g_array_append_val(loader->staged_lines, line);
+    return 0;
 }
 
 /**
@@ -178,136 +263,180 @@ void __passengers_loader_commit_flight_list(passengers_loader_t *loader) {
  * @param retval      Value returned by the last token callback (`0` for success, another value for
  *                    a parsing error).
  *
- * @retval 0 Always successful. A possible type of allocation error is ignored.
+ * @retval 0 Success. A possible type of allocation error is ignored.
+ * @retval 1 Allocation failure when staging the line (see ::passengers_loader_t::staged_lines).
  */
 int __passengers_loader_after_parse_line(void *loader_data, int retval) {
     passengers_loader_t *const loader = loader_data;
     loader->first_line                = 0;
 
+    if (loader->staged_lines)
+        return retval ? __passengers_loader_stage_line(loader, 0, loader->error_line)
+                      : __passengers_loader_stage_line(loader, 1, NULL);
+
     if (retval) {
         dataset_error_output_report_passenger_error(loader->output, loader->error_line);
         return 0;
     }
 
-    /* Flush passengers if this a new flight */
-    if (loader->current_flight != loader->commit_buffer_flight)
-        __passengers_loader_commit_flight_list(loader);
-
-    /* Add flight */
-    char *const pool_alloc_id =
-        string_pool_put(loader->commit_buffer_id_pool, loader->current_user);
-    g_ptr_array_add(loader->commit_buffer, pool_alloc_id);
-    loader->commit_buffer_flight = loader->current_flight;
-
+    __passengers_loader_add_passenger(loader, loader->current_flight, loader->current_user);
     return 0;
 }
 
 /**
- * @struct passengers_loader_erroneous_flight_callback_data_t
- * @brief  Type of `user_data` parameter in ::__passengers_loader_check_line_for_erroneous_flight.
+ * @brief   Processes the lines parsed in a chunk of the passengers file.
+ * @details Chunks must be merged in file order, so that passengers are grouped by flight and errors
+ *          are reported in the same way as if the whole file was parsed by @p loader.
  *
- * @var passengers_loader_erroneous_flight_callback_data_t::output
- *     @brief Where to output dataset errors to.
- * @var passengers_loader_erroneous_flight_callback_data_t::flight_id
- *     @brief Identifier of the flight currently being looked up in the dataset file.
+ * @param loader Loader that commits passengers and reports errors.
+ * @param chunk  Loader that parsed a chunk of the file, with ::passengers_loader_t::staged_lines.
  */
-typedef struct {
-    dataset_error_output_t *const output;
-    const char *const             flight_id;
-} passengers_loader_erroneous_flight_callback_data_t;
+void __passengers_loader_merge(passengers_loader_t *loader, const passengers_loader_t *chunk) {
+    for (size_t i = 0; i < chunk->staged_lines->len; ++i) {
+        const passengers_loader_staged_line_t *const line =
+            &g_array_index(chunk->staged_lines, passengers_loader_staged_line_t, i);
+
+        if (line->valid)
+            __passengers_loader_add_passenger(loader, line->flight, line->user);
+        else
+            dataset_error_output_report_passenger_error(loader->output, line->text);
+    }
+}
 
 /**
- * @brief   Checks if a given line of the dataset contains the desired flight to be reported.
- * @details It then reports it as an error if that's the case.
+ * @brief   Parses the passengers file, possibly in parallel chunks.
+ * @details Big files are divided into chunks (see ::dataset_parser_get_chunk_count). Each chunk is
+ *          parsed by its own loader in its own thread, and the parsed lines are then processed by
+ *          @p loader, in file order. Only user and flight lookups are done concurrently.
  *
- * @param user_data A pointer to a ::passengers_loader_erroneous_flight_callback_data_t.
- * @param line      Current line in the `flights.csv` dataset file.
+ * @param loader  Loader that commits passengers and reports errors.
+ * @param stream  File stream with passenger data to be loaded.
+ * @param grammar Grammar of the passengers file.
  *
- * @retval 0 Continue flight lookup.
- * @retval 1 Flight found. Stop lookup.
+ * @return The value returned by ::dataset_parser_parse_chunked, or `1` on allocation failure.
  */
-int __passengers_loader_check_line_for_erroneous_flight(void *user_data, char *line) {
-    const passengers_loader_erroneous_flight_callback_data_t *const data = user_data;
+int __passengers_loader_load_chunks(passengers_loader_t            *loader,
+                                    FILE                           *stream,
+                                    const dataset_parser_grammar_t *grammar) {
+
+    const size_t n = dataset_parser_get_chunk_count(stream);
+    if (n == 1)
+        return dataset_parser_parse(stream, grammar, loader);
+
+    passengers_loader_t chunks[n];
+    void               *chunks_data[n];
+    for (size_t i = 0; i < n; ++i) {
+        chunks[i] = (passengers_loader_t) {
+            .output         = loader->output,
+            .database       = loader->database,
+            .users          = loader->users,
+            .flights        = loader->flights,
+            .staged_lines   = g_array_new(FALSE, FALSE, sizeof(passengers_loader_staged_line_t)),
+            .staged_strings = string_pool_create(PASSENGERS_LOADER_STAGED_STRINGS_BLOCK_CAPACITY),
+            .first_line     = i == 0};
+        chunks_data[i] = &chunks[i];
+
+        if (!chunks[i].staged_strings) {
+            for (size_t j = 0; j <= i; ++j) {
+                g_array_unref(chunks[j].staged_lines);
+                if (chunks[j].staged_strings)
+                    string_pool_free(chunks[j].staged_strings);
+            }
+            return 1;
+        }
+    }
 
-    if (strncmp(data->flight_id, line, 10) == 0) { /* Flights always have 10-digit IDs */
-        dataset_error_output_report_flight_error(data->output, line);
-        return 1; /* Stop looking */
-    } else {
-        return 0;
+    int retval = dataset_parser_parse_chunked(stream, grammar, n, chunks_data);
+    for (size_t i = 0; i < n; ++i) {
+        if (!retval)
+            __passengers_loader_merge(loader, &chunks[i]);
+
+        g_array_unref(chunks[i].staged_lines);
+        string_pool_free(chunks[i].staged_strings);
     }
+
+    return retval;
 }
 
 /**
- * @brief Reports errors for all flights with more passengers than seats.
+ * @brief   Reports errors for all flights with more passengers than seats.
+ * @details The lines of those flights are read from the positions registered when loading flights,
+ *          and not by searching for them in the whole file. Each flight is only reported once, in
+ *          the order it was first found to be invalid.
  *
- * @param loader  Data about parsing results.
- * @param flights File stream of `flights.csv`, to print error lines exactly like they were in the
- *                original dataset file.
+ * @param loader       Data about parsing results.
+ * @param flights      File stream of `flights.csv`, to print error lines exactly like they were in
+ *                     the original dataset file.
+ * @param flight_lines Positions of the lines of all valid flights in @p flights.
  */
-void __passengers_loader_report_erroneous_flights(passengers_loader_t *loader, FILE *flights) {
+void __passengers_loader_report_erroneous_flights(passengers_loader_t        *loader,
+                                                  FILE                       *flights,
+                                                  const dataset_line_index_t *flight_lines) {
+    GHashTable *const reported = g_hash_table_new(g_direct_hash, g_direct_equal);
+
     for (size_t i = 0; i < loader->invalid_flight_ids->len; ++i) {
         const flight_id_t id = g_array_index(loader->invalid_flight_ids, flight_id_t, i);
-        char              id_str[FLIGHT_ID_SPRINTF_MIN_BUFFER_SIZE];
-        flight_id_sprintf(id_str, id);
+        if (!g_hash_table_add(reported, GUINT_TO_POINTER(id)))
+            continue; /* Already reported */
 
-        passengers_loader_erroneous_flight_callback_data_t user_data = {.output    = loader->output,
-                                                                        .flight_id = id_str};
-
-        stream_tokenize(flights,
-                        '\n',
-                        __passengers_loader_check_line_for_erroneous_flight,
-                        &user_data);
+        char *const line = dataset_line_index_read_line(flight_lines, flights, id);
+        if (line) /* Ignore allocation and IO failures */
+            dataset_error_output_report_flight_error(loader->output, line);
+        free(line);
     }
+
+    g_hash_table_destroy(reported);
 }
 
-int passengers_loader_load(FILE                   *passengers_stream,
-                           FILE                   *flights_stream,
-                           database_t             *database,
-                           dataset_error_output_t *output) {
+int passengers_loader_load(FILE                       *passengers_stream,
+                           FILE                       *flights_stream,
+                           const dataset_line_index_t *flight_lines,
+                           database_t                 *database,
+                           dataset_error_output_t     *output,
+                           dataset_progress_t         *progress) {
 
     passengers_loader_t data   = {.output        = output,
                                   .database      = database,
                                   .users         = database_get_users(database),
                                   .flights       = database_get_flights(database),
-                                  .commit_buffer = g_ptr_array_new(),
+                                  .commit_buffer = g_array_new(FALSE, FALSE, sizeof(uint32_t)),
                                   .invalid_flight_ids =
                                       g_array_new(FALSE, FALSE, sizeof(flight_id_t)),
                                   .first_line = 1};
     int                 retval = 1;
 
-    data.commit_buffer_id_pool = string_pool_create(PASSENGERS_LOADER_ID_POOL_BLOCK_CAPACITY);
-    if (!data.commit_buffer_id_pool)
-        goto DEFER_1;
+    const fixed_n_delimiter_parser_iter_callback_t token_callbacks[] = {
+        PASSENGERS_LOADER_SCHEMA(FIXED_N_DELIMITER_PARSER_CALLBACK)};
 
-    const fixed_n_delimiter_parser_iter_callback_t token_callbacks[2] = {
-        __passengers_loader_parse_flight_id,
-        __passengers_loader_parse_user_id};
-
-    fixed_n_delimiter_parser_grammar_t *const line_grammar =
-        fixed_n_delimiter_parser_grammar_new(';', 2, token_callbacks);
+    fixed_n_delimiter_parser_grammar_t *const line_grammar = fixed_n_delimiter_parser_grammar_new(
+        ';',
+        0 PASSENGERS_LOADER_SCHEMA(FIXED_N_DELIMITER_PARSER_COUNT),
+        token_callbacks);
     if (!line_grammar)
-        goto DEFER_2;
+        goto DEFER_1;
 
     dataset_parser_grammar_t *const grammar =
-        dataset_parser_grammar_new('\n',
-                                   line_grammar,
-                                   __passengers_loader_before_parse_line,
-                                   __passengers_loader_after_parse_line);
+        dataset_parser_grammar_new_specialized('\n',
+                                               line_grammar,
+                                               __passengers_loader_parse_line,
+                                               __passengers_loader_before_parse_line,
+                                               __passengers_loader_after_parse_line);
     if (!grammar)
-        goto DEFER_3;
+        goto DEFER_2;
+    dataset_parser_grammar_set_progress(grammar,
+                                        progress,
+                                        PERFORMANCE_METRICS_DATASET_STEP_PASSENGERS);
 
-    retval = dataset_parser_parse(passengers_stream, grammar, &data);
+    retval = __passengers_loader_load_chunks(&data, passengers_stream, grammar);
     __passengers_loader_commit_flight_list(&data);
-    __passengers_loader_report_erroneous_flights(&data, flights_stream);
+    __passengers_loader_report_erroneous_flights(&data, flights_stream, flight_lines);
 
     dataset_parser_grammar_free(grammar);
-DEFER_3:
-    fixed_n_delimiter_parser_grammar_free(line_grammar);
 DEFER_2:
-    string_pool_free(data.commit_buffer_id_pool);
+    fixed_n_delimiter_parser_grammar_free(line_grammar);
 DEFER_1:
     g_array_unref(data.invalid_flight_ids);
-    g_ptr_array_unref(data.commit_buffer);
+    g_array_unref(data.commit_buffer);
 
     return retval != 0;
 }
@@ -23,6 +23,8 @@
  *          `loader_data` is a pointer to a ::reservations_loader_t.
  */
 
+#include <glib.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "dataset/dataset_parser.h"
@@ -49,18 +51,30 @@
  *     @brief Current line being processed, in case it needs to be put in the errors file.
  * @var reservations_loader_t::current_reservation
  *     @brief Reservation being currently parsed, whose fields are still being filled in.
+ * @var reservations_loader_t::staged_reservations
+ *     @brief   Valid reservations in the chunk of the file parsed by this loader.
+ *     @details `NULL` when the whole file is parsed by this loader, and reservations are
+ *              immediately added to ::reservations_loader_t::database. Otherwise, reservations are
+ *              only added by ::__reservations_loader_merge.
+ * @var reservations_loader_t::staged_errors
+ *     @brief   Invalid lines in the chunk of the file parsed by this loader.
+ *     @details `NULL` when the whole file is parsed by this loader, and errors are immediately
+ *              reported to ::reservations_loader_t::output. Otherwise, errors are only reported by
+ *              ::__reservations_loader_merge.
  * @var reservations_loader_t::first_line
  *     @brief   Whether the line being parsed is the first line in the file.
  *     @details Used to print an error on the CSV's table header.
  */
 typedef struct {
-    dataset_error_output_t *const output;
-    database_t *const             database;
-    const user_manager_t *const   users;
-
-    const char          *error_line;
-    reservation_t *const current_reservation;
-    int                  first_line;
+    dataset_error_output_t *output;
+    database_t             *database;
+    const user_manager_t   *users;
+
+    const char            *error_line;
+    reservation_t         *current_reservation;
+    reservation_manager_t *staged_reservations;
+    GPtrArray             *staged_errors;
+    int                    first_line;
 } reservations_loader_t;
 
 /**
@@ -69,10 +83,12 @@ typedef struct {
  *
  * @param loader_data A pointer to a ::reservations_loader_t.
  * @param line        Line that is going to be parsed.
+ * @param length      Length of @p line. Not used.
  *
  * @retval 0 Always successful.
  */
-int __reservations_loader_before_parse_line(void *loader_data, char *line) {
+int __reservations_loader_before_parse_line(void *loader_data, char *line, size_t length) {
+    (void) length;
     ((reservations_loader_t *) loader_data)->error_line = line;
     return 0;
 }
@@ -100,10 +116,12 @@ int __reservation_loader_parse_user_id(void *loader_data, char *token, size_t nt
     (void) ntoken;
     reservations_loader_t *const loader = loader_data;
 
-    if (*token && user_manager_get_by_id(loader->users, token) != NULL)
-        return reservation_set_user_id(NULL, loader->current_reservation, token);
-    else
+    uint32_t index;
+    if (!*token || user_manager_get_index_by_id(loader->users, token, &index))
         return 1;
+
+    reservation_set_user_index(loader->current_reservation, index);
+    return 0;
 }
 
 /** @brief Parses the identifier of the hotel of a reservation. */
@@ -221,6 +239,29 @@ int __reservation_loader_parse_rating(void *loader_data, char *token, size_t nto
                                   rating);
 }
 
+/** @brief Schema of a line of `reservations.csv` (see ::FIXED_N_DELIMITER_PARSER_DEFINE). */
+#define RESERVATIONS_LOADER_SCHEMA(FIELD)                                                          \
+    FIELD(__reservation_loader_parse_id)                                                           \
+    FIELD(__reservation_loader_parse_user_id)                                                      \
+    FIELD(__reservation_loader_parse_hotel_id)                                                     \
+    FIELD(__reservation_loader_parse_hotel_name)                                                   \
+    FIELD(__reservation_loader_parse_mandatory_numeral)                                            \
+    FIELD(__reservation_loader_parse_mandatory_numeral)                                            \
+    FIELD(__reservation_loader_parse_address)                                                      \
+    FIELD(__reservation_loader_parse_date)                                                         \
+    FIELD(__reservation_loader_parse_date)                                                         \
+    FIELD(__reservation_loader_parse_mandatory_numeral)                                            \
+    FIELD(__reservation_loader_parse_includes_breakfast)                                           \
+    FIELD(__reservation_loader_parse_dont_verify)                                                  \
+    FIELD(__reservation_loader_parse_rating)                                                       \
+    FIELD(__reservation_loader_parse_dont_verify)
+
+/**
+ * @brief Parses a line of `reservations.csv`, calling the callbacks in
+ *        ::RESERVATIONS_LOADER_SCHEMA directly.
+ */
+FIXED_N_DELIMITER_PARSER_DEFINE(__reservations_loader_parse_line, ';', RESERVATIONS_LOADER_SCHEMA)
+
 /**
  * @brief Places a parsed reservation in the database and handles errors.
  *
@@ -236,8 +277,18 @@ int __reservations_loader_after_parse_line(void *loader_data, int retval) {
     loader->first_line                  = 0;
 
     if (retval) {
-        dataset_error_output_report_reservation_error(loader->output, loader->error_line);
+        if (loader->staged_errors) {
+            char *const line_copy = strdup(loader->error_line);
+            if (!line_copy)
+                return 1;
+            g_ptr_array_add(loader->staged_errors, line_copy);
+        } else {
+            dataset_error_output_report_reservation_error(loader->output, loader->error_line);
+        }
         retval = 0;
+    } else if (loader->staged_reservations) {
+        retval = reservation_manager_add_reservation(loader->staged_reservations,
+                                                     loader->current_reservation);
     } else {
         retval = database_add_reservation(loader->database, loader->current_reservation);
     }
@@ -246,54 +297,170 @@ int __reservations_loader_after_parse_line(void *loader_data, int retval) {
     return retval;
 }
 
-int reservations_loader_load(FILE *stream, database_t *database, dataset_error_output_t *output) {
-    reservations_loader_t data = {.output              = output,
-                                  .database            = database,
-                                  .users               = database_get_users(database),
-                                  .current_reservation = reservation_create(NULL),
-                                  .first_line          = 1};
-    if (!data.current_reservation)
+/**
+ * @brief Initializes the state of a reservations loader.
+ *
+ * @param loader     Loader to be initialized.
+ * @param database   Database to add new reservations to.
+ * @param output     Where to output dataset errors to.
+ * @param staged     Whether @p loader only parses a chunk of the file, and its results are to be
+ *                   merged later, with ::__reservations_loader_merge.
+ * @param first_line Whether the first line parsed by @p loader is the first line in the file.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __reservations_loader_init(reservations_loader_t  *loader,
+                               database_t             *database,
+                               dataset_error_output_t *output,
+                               int                     staged,
+                               int                     first_line) {
+
+    *loader = (reservations_loader_t) {.output              = output,
+                                       .database            = database,
+                                       .users               = database_get_users(database),
+                                       .error_line          = NULL,
+                                       .current_reservation = reservation_create(NULL),
+                                       .staged_reservations = NULL,
+                                       .staged_errors       = NULL,
+                                       .first_line          = first_line};
+    if (!loader->current_reservation)
         return 1;
 
-    const fixed_n_delimiter_parser_iter_callback_t token_callbacks[14] = {
-        __reservation_loader_parse_id,
-        __reservation_loader_parse_user_id,
-        __reservation_loader_parse_hotel_id,
-        __reservation_loader_parse_hotel_name,
-        __reservation_loader_parse_mandatory_numeral,
-        __reservation_loader_parse_mandatory_numeral,
-        __reservation_loader_parse_address,
-        __reservation_loader_parse_date,
-        __reservation_loader_parse_date,
-        __reservation_loader_parse_mandatory_numeral,
-        __reservation_loader_parse_includes_breakfast,
-        __reservation_loader_parse_dont_verify,
-        __reservation_loader_parse_rating,
-        __reservation_loader_parse_dont_verify};
-
-    fixed_n_delimiter_parser_grammar_t *const line_grammar =
-        fixed_n_delimiter_parser_grammar_new(';', 14, token_callbacks);
-    if (!line_grammar) {
-        reservation_free(data.current_reservation);
-        return 1;
+    if (staged) {
+        loader->staged_reservations = reservation_manager_create();
+        if (!loader->staged_reservations) {
+            reservation_free(loader->current_reservation);
+            return 1;
+        }
+
+        loader->staged_errors = g_ptr_array_new_with_free_func(free);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Frees memory used by a reservations loader initialized by ::__reservations_loader_init.
+ * @param loader Loader to have its contents `free`d.
+ */
+void __reservations_loader_free(reservations_loader_t *loader) {
+    reservation_free(loader->current_reservation);
+    if (loader->staged_reservations) {
+        reservation_manager_free(loader->staged_reservations);
+        g_ptr_array_unref(loader->staged_errors);
+    }
+}
+
+/**
+ * @brief Adds a reservation parsed in a chunk of the file to the database.
+ * @param database    A pointer to a ::database_t.
+ * @param reservation Reservation to be added to @p database.
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __reservations_loader_merge_reservation(void *database, const reservation_t *reservation) {
+    return database_add_reservation(database, reservation);
+}
+
+/**
+ * @brief   Adds the reservations and the errors in a chunk of the file to the database and to the
+ *          errors file, respectively.
+ * @details Chunks must be merged in file order, so that errors are output in the same order as if
+ *          the whole file was parsed by a single loader.
+ *
+ * @param loader Loader that parsed the chunk. Does nothing if it isn't staged (see
+ *               ::__reservations_loader_init).
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __reservations_loader_merge(reservations_loader_t *loader) {
+    if (!loader->staged_reservations)
+        return 0;
+
+    for (size_t i = 0; i < loader->staged_errors->len; ++i)
+        dataset_error_output_report_reservation_error(loader->output,
+                                                      g_ptr_array_index(loader->staged_errors, i));
+
+    return reservation_manager_iter(loader->staged_reservations,
+                                    __reservations_loader_merge_reservation,
+                                    loader->database);
+}
+
+/**
+ * @brief   Parses a `reservations.csv` dataset file, possibly in parallel chunks.
+ * @details Auxiliary method for ::reservations_loader_load. Big files are divided into chunks (see
+ *          ::dataset_parser_get_chunk_count), each parsed by its own loader, whose results are
+ *          then merged in file order.
+ *
+ * @param stream   File stream with reservation data to be loaded.
+ * @param grammar  Grammar of the reservations file.
+ * @param database Database to add reservations to.
+ * @param output   Where to output dataset errors to.
+ *
+ * @return The value returned by ::dataset_parser_parse_chunked, or `1` on allocation failure.
+ */
+int __reservations_loader_load_chunks(FILE                           *stream,
+                                      const dataset_parser_grammar_t *grammar,
+                                      database_t                     *database,
+                                      dataset_error_output_t         *output) {
+
+    const size_t          n = dataset_parser_get_chunk_count(stream);
+    reservations_loader_t loaders[n];
+    void                 *loaders_data[n];
+
+    for (size_t i = 0; i < n; ++i) {
+        if (__reservations_loader_init(&loaders[i], database, output, n > 1, i == 0)) {
+            for (size_t j = 0; j < i; ++j)
+                __reservations_loader_free(&loaders[j]);
+            return 1;
+        }
+        loaders_data[i] = &loaders[i];
     }
 
+    int retval = dataset_parser_parse_chunked(stream, grammar, n, loaders_data);
+    for (size_t i = 0; i < n; ++i) {
+        if (!retval)
+            retval = __reservations_loader_merge(&loaders[i]);
+        __reservations_loader_free(&loaders[i]);
+    }
+
+    return retval;
+}
+
+int reservations_loader_load(FILE                   *stream,
+                         database_t             *database,
+                         dataset_error_output_t *output,
+                         dataset_progress_t     *progress) {
+    const fixed_n_delimiter_parser_iter_callback_t token_callbacks[] = {
+        RESERVATIONS_LOADER_SCHEMA(FIXED_N_DELIMITER_PARSER_CALLBACK)};
+
+    fixed_n_delimiter_parser_grammar_t *const line_grammar = fixed_n_delimiter_parser_grammar_new(
+        ';',
+        0 RESERVATIONS_LOADER_SCHEMA(FIXED_N_DELIMITER_PARSER_COUNT),
+        token_callbacks);
+    if (!line_grammar)
+        return 1;
+
     dataset_parser_grammar_t *const grammar =
-        dataset_parser_grammar_new('\n',
-                                   line_grammar,
-                                   __reservations_loader_before_parse_line,
-                                   __reservations_loader_after_parse_line);
+        dataset_parser_grammar_new_specialized('\n',
+                                               line_grammar,
+                                               __reservations_loader_parse_line,
+                                               __reservations_loader_before_parse_line,
+                                               __reservations_loader_after_parse_line);
     if (!grammar) {
         fixed_n_delimiter_parser_grammar_free(line_grammar);
-        reservation_free(data.current_reservation);
         return 1;
     }
+    dataset_parser_grammar_set_progress(grammar,
+                                        progress,
+                                        PERFORMANCE_METRICS_DATASET_STEP_RESERVATIONS);
 
-    const int retval = dataset_parser_parse(stream, grammar, &data);
+    const int retval = __reservations_loader_load_chunks(stream, grammar, database, output);
 
     fixed_n_delimiter_parser_grammar_free(line_grammar);
     dataset_parser_grammar_free(grammar);
-    reservation_free(data.current_reservation);
 
     return retval != 0;
 }
@@ -23,10 +23,13 @@
  *          `loader_data` is a pointer to a ::users_loader_t.
  */
 
-#include "dataset/users_loader.h"
+#include <stdio.h>
+#include <string.h>
 
 #include "dataset/dataset_parser.h"
+#include "dataset/users_loader.h"
 #include "types/email.h"
+#include "utils/utf8.h"
 
 /** @cond FALSE */
 #ifndef __GNUC__
@@ -61,10 +64,12 @@ typedef struct {
  *
  * @param loader_data A pointer to a ::users_loader_t.
  * @param line        Line that is going to be parsed.
+ * @param length      Length of @p line. Not used.
  *
  * @retval 0 Always successful.
  */
-int __users_loader_before_parse_line(void *loader_data, char *line) {
+int __users_loader_before_parse_line(void *loader_data, char *line, size_t length) {
+    (void) length;
     ((users_loader_t *) loader_data)->error_line = line;
     return 0;
 }
@@ -75,10 +80,21 @@ int __user_loader_parse_id(void *loader_data, char *token, size_t ntoken) {
     return user_set_id(NULL, ((users_loader_t *) loader_data)->current_user, token);
 }
 
-/** @brief Parses a user's name. */
+/**
+ * @brief   Parses a user's name.
+ * @details Only names with multibyte characters need to be validated as UTF-8, as the user already
+ *          knows if its name is pure ASCII.
+ */
 int __user_loader_parse_name(void *loader_data, char *token, size_t ntoken) {
     (void) ntoken;
-    return user_set_name(NULL, ((users_loader_t *) loader_data)->current_user, token);
+    user_t *const user   = ((users_loader_t *) loader_data)->current_user;
+    const int     retval = user_set_name(NULL, user, token);
+
+    if (retval == 0 && !user_get_name_is_ascii(user) && utf8_validate(token, strlen(token)))
+        fprintf(stderr,
+                "User name \"%s\" isn't valid UTF-8. It may be shown incorrectly!\n",
+                token);
+    return retval;
 }
 
 /** @brief Parses a user's email address. */
@@ -167,6 +183,24 @@ int __user_loader_parse_account_status(void *loader_data, char *token, size_t nt
     return 0;
 }
 
+/** @brief Schema of a line of `users.csv` (see ::FIXED_N_DELIMITER_PARSER_DEFINE). */
+#define USERS_LOADER_SCHEMA(FIELD)                                                                 \
+    FIELD(__user_loader_parse_id)                                                                  \
+    FIELD(__user_loader_parse_name)                                                                \
+    FIELD(__user_loader_parse_email)                                                               \
+    FIELD(__user_loader_parse_non_empty)                                                           \
+    FIELD(__user_loader_parse_birth_date)                                                          \
+    FIELD(__user_loader_parse_sex)                                                                 \
+    FIELD(__user_loader_parse_passport)                                                            \
+    FIELD(__user_loader_parse_country_code)                                                        \
+    FIELD(__user_loader_parse_non_empty)                                                           \
+    FIELD(__user_loader_parse_account_creation_date)                                               \
+    FIELD(__user_loader_parse_non_empty)                                                           \
+    FIELD(__user_loader_parse_account_status)
+
+/** @brief Parses a line of `users.csv`, calling the callbacks in ::USERS_LOADER_SCHEMA directly. */
+FIXED_N_DELIMITER_PARSER_DEFINE(__users_loader_parse_line, ';', USERS_LOADER_SCHEMA)
+
 /**
  * @brief Places a parsed user in the database and handles errors.
  *
@@ -191,46 +225,43 @@ int __users_loader_after_parse_line(void *loader_data, int retval) {
     return retval;
 }
 
-int users_loader_load(FILE *stream, database_t *database, dataset_error_output_t *output) {
+int users_loader_load(FILE                   *stream,
+                  database_t             *database,
+                  dataset_error_output_t *output,
+                  dataset_progress_t     *progress) {
     users_loader_t data = {.output       = output,
                            .database     = database,
-                           .current_user = user_create(NULL)};
+                           .current_user = user_create(NULL, NULL)};
 
     if (!data.current_user)
         return 1; /* Allocation failure */
 
-    const fixed_n_delimiter_parser_iter_callback_t token_callbacks[12] = {
-        __user_loader_parse_id,
-        __user_loader_parse_name,
-        __user_loader_parse_email,
-        __user_loader_parse_non_empty,
-        __user_loader_parse_birth_date,
-        __user_loader_parse_sex,
-        __user_loader_parse_passport,
-        __user_loader_parse_country_code,
-        __user_loader_parse_non_empty,
-        __user_loader_parse_account_creation_date,
-        __user_loader_parse_non_empty,
-        __user_loader_parse_account_status,
-    };
+    const fixed_n_delimiter_parser_iter_callback_t token_callbacks[] = {
+        USERS_LOADER_SCHEMA(FIXED_N_DELIMITER_PARSER_CALLBACK)};
 
     fixed_n_delimiter_parser_grammar_t *const line_grammar =
-        fixed_n_delimiter_parser_grammar_new(';', 12, token_callbacks);
+        fixed_n_delimiter_parser_grammar_new(';',
+                                             0 USERS_LOADER_SCHEMA(FIXED_N_DELIMITER_PARSER_COUNT),
+                                             token_callbacks);
     if (!line_grammar) {
         user_free(data.current_user);
         return 1;
     }
 
     dataset_parser_grammar_t *const grammar =
-        dataset_parser_grammar_new('\n',
-                                   line_grammar,
-                                   __users_loader_before_parse_line,
-                                   __users_loader_after_parse_line);
+        dataset_parser_grammar_new_specialized('\n',
+                                               line_grammar,
+                                               __users_loader_parse_line,
+                                               __users_loader_before_parse_line,
+                                               __users_loader_after_parse_line);
     if (!grammar) {
         fixed_n_delimiter_parser_grammar_free(line_grammar);
         user_free(data.current_user);
         return 1;
     }
+    dataset_parser_grammar_set_progress(grammar,
+                                        progress,
+                                        PERFORMANCE_METRICS_DATASET_STEP_USERS);
 
     const int retval = dataset_parser_parse(stream, grammar, &data);
 
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  generator.c
+ * @brief Contains the entry point to the dataset generator program.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "testing/dataset_generator.h"
+#include "utils/int_utils.h"
+
+/** @brief Names of each ::dataset_generator_scenario_t, for the `--scenario` option. */
+const char *const generator_scenario_names[DATASET_GENERATOR_SCENARIO_COUNT] = {"typical",
+                                                                               "hot-hotel",
+                                                                               "hot-airport",
+                                                                               "heavy-users",
+                                                                               "short-prefixes",
+                                                                               "long-lines",
+                                                                               "invalid-rows"};
+
+/**
+ * @brief Parses the name of a scenario.
+ *
+ * @param output Where to place the parsed scenario. Nothing will be written on failure.
+ * @param input  String to be parsed (see ::generator_scenario_names).
+ *
+ * @retval 0 Success.
+ * @retval 1 Unknown scenario.
+ */
+int __generator_parse_scenario(dataset_generator_scenario_t *output, const char *input) {
+    for (size_t i = 0; i < DATASET_GENERATOR_SCENARIO_COUNT; ++i) {
+        if (strcmp(input, generator_scenario_names[i]) == 0) {
+            *output = i;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief   Parses a real number in `[0, max]`.
+ *
+ * @param output Where to place the parsed number. Nothing will be written on failure.
+ * @param input  String to be parsed.
+ * @param max    Maximum accepted value.
+ *
+ * @retval 0 Success.
+ * @retval 1 Invalid number.
+ */
+int __generator_parse_real(double *output, const char *input, double max) {
+    char        *end;
+    const double parsed = strtod(input, &end);
+    if (end == input || *end || !(parsed >= 0 && parsed <= max))
+        return 1;
+
+    *output = parsed;
+    return 0;
+}
+
+/**
+ * @brief   The entry point to the dataset generator program.
+ * @details Generates a synthetic dataset and a query file (see
+ *          [dataset_generator](@ref dataset_generator.h)), so that the main program can be
+ *          benchmarked with datasets much larger (or smaller) than the course's.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure.
+ */
+int main(int argc, char **argv) {
+    dataset_generator_options_t options = {.scale        = 1.0,
+                                           .invalid_rate = 0.05,
+                                           .seed         = 0,
+                                           .query_count  = 500,
+                                           .scenario     = DATASET_GENERATOR_SCENARIO_TYPICAL};
+
+    while (argc > 1 && strncmp(argv[1], "--", 2) == 0) {
+        uint64_t integer;
+        if (argc > 2 && strcmp(argv[1], "--scale") == 0) {
+            if (__generator_parse_real(&options.scale, argv[2], 1e6) || options.scale <= 0) {
+                argc = 0; /* Invalid number: print usage */
+                break;
+            }
+        } else if (argc > 2 && strcmp(argv[1], "--invalid-rate") == 0) {
+            if (__generator_parse_real(&options.invalid_rate, argv[2], 1.0)) {
+                argc = 0; /* Invalid number: print usage */
+                break;
+            }
+        } else if (argc > 2 && strcmp(argv[1], "--seed") == 0) {
+            if (int_utils_parse_positive(&options.seed, argv[2])) {
+                argc = 0; /* Invalid number: print usage */
+                break;
+            }
+        } else if (argc > 2 && strcmp(argv[1], "--queries") == 0) {
+            if (int_utils_parse_positive(&integer, argv[2])) {
+                argc = 0; /* Invalid number: print usage */
+                break;
+            }
+            options.query_count = integer;
+        } else if (argc > 2 && strcmp(argv[1], "--scenario") == 0) {
+            if (__generator_parse_scenario(&options.scenario, argv[2])) {
+                argc = 0; /* Unknown scenario: print usage */
+                break;
+            }
+        } else {
+            argc = 0; /* Unknown or invalid option: print usage */
+            break;
+        }
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc == 2) {
+        if (dataset_generator_generate(argv[1], &options)) {
+            fprintf(stderr, "Failed to generate dataset in \"%s\"!\n", argv[1]);
+            return 1;
+        }
+        return 0;
+    } else {
+        fputs("Invalid command-line arguments! Usage:\n", stderr);
+        fputs("./programa-gerador [options] [output directory]\n\n", stderr);
+        fputs("Options:\n", stderr);
+        fputs("  --scale [s]         Dataset size, relative to 10 000 users (default: 1)\n",
+              stderr);
+        fputs("  --invalid-rate [r]  Fraction of invalid lines, from 0 to 1 (default: 0.05)\n",
+              stderr);
+        fputs("  --seed [n]          Seed of the pseudo-random number generator (default: 0)\n",
+              stderr);
+        fputs("  --queries [n]       Number of queries to generate (default: 500)\n", stderr);
+        fputs("  --scenario [name]   Worst case to stress (default: typical). One of:\n", stderr);
+        fputs("    hot-hotel         Half of the reservations in one hotel\n", stderr);
+        fputs("    hot-airport       Half of the flights from one airport\n", stderr);
+        fputs("    heavy-users       Half of the flights and reservations of 8 users\n", stderr);
+        fputs("    short-prefixes    Only queries 9, with one-letter prefixes\n", stderr);
+        fputs("    long-lines        Some lines with 64 KiB free-text fields\n", stderr);
+        fputs("    invalid-rows      At least half of the lines invalid\n", stderr);
+        return 1;
+    }
+}
@@ -25,12 +25,19 @@
 #include <glib.h>
 #include <math.h>
 #include <ncurses.h>
+#include <string.h>
 
 #include "interactive_mode/activity.h"
 #include "interactive_mode/activity_paging.h"
 #include "interactive_mode/ncurses_utils.h"
 #include "utils/int_utils.h"
 
+/** @brief Number of lines requested when a paginator is created, to determine its block length. */
+#define ACTIVITY_PAGING_INITIAL_LINES 256
+
+/** @brief Number of pages of lines requested from a paginator's source at once. */
+#define ACTIVITY_PAGING_PREFETCH_PAGES 4
+
 /** @brief An action performed in the paginator. */
 typedef enum {
     ACTIVITY_PAGING_ACTION_NEXT_PAGE,     /**< @brief Move to the next page */
@@ -38,33 +45,208 @@ typedef enum {
     ACTIVITY_PAGING_ACTION_KEEP           /**< @brief Keep on the current page */
 } activity_paging_action_t;
 
+/**
+ * @struct activity_paging_line_t
+ * @brief  A line obtained from the source of a paginator, converted for rendering when it's first
+ *         shown.
+ *
+ * @var activity_paging_line_t::text
+ *     @brief Null-terminated UTF-32 line, or `NULL` if not yet converted.
+ * @var activity_paging_line_t::widths
+ *     @brief   Width of each prefix of ::activity_paging_line_t::text (`widths[i]` is the width of
+ *              the first `i` characters).
+ *     @details Lets ::__activity_paging_line_prefix truncate the line to any width without
+ *              measuring its characters again.
+ * @var activity_paging_line_t::length
+ *     @brief Number of characters in ::activity_paging_line_t::text.
+ */
+typedef struct {
+    unichar_t *text;
+    uint32_t  *widths;
+    size_t     length;
+} activity_paging_line_t;
+
 /**
  * @struct activity_paging_data_t
  * @brief  Data in a paging TUI activity.
  *
+ * @var activity_paging_data_t::source
+ *     @brief Callback that provides the lines to be shown.
+ * @var activity_paging_data_t::overlay
+ *     @brief Callback that provides the lines shown over the output (can be `NULL`).
+ * @var activity_paging_data_t::source_data
+ *     @brief Pointer passed to ::activity_paging_data_t::source and
+ *            ::activity_paging_data_t::overlay.
+ * @var activity_paging_data_t::source_lines
+ *     @brief The last lines obtained from ::activity_paging_data_t::source, in UTF-8.
  * @var activity_paging_data_t::lines
- *     @brief An array of null-terminated UTF-32 lines.
+ *     @brief Lines in ::activity_paging_data_t::source_lines, only converted once they're shown.
+ * @var activity_paging_data_t::lines_first
+ *     @brief Index of the first line in ::activity_paging_data_t::lines.
+ * @var activity_paging_data_t::lines_count
+ *     @brief Number of lines in ::activity_paging_data_t::lines.
  * @var activity_paging_data_t::lines_length
- *     @brief The number of lines in ::activity_paging_data_t::lines.
+ *     @brief The total number of lines that can be shown.
  * @var activity_paging_data_t::block_length
  *     @brief The number of lines in a block.
  * @var activity_paging_data_t::page_reference_index
  *     @brief The line where the current page being displayed starts.
  * @var activity_paging_data_t::change_page
  *     @brief An user action to change, or keep, the current page.
+ * @var activity_paging_data_t::show_overlay
+ *     @brief Whether the lines of ::activity_paging_data_t::overlay are shown (toggled with `p`).
+ * @var activity_paging_data_t::failed
+ *     @brief Whether ::activity_paging_data_t::source failed while the activity was running.
  * @var activity_paging_data_t::title
  *     @brief Title of the activity.
  */
 typedef struct {
-    unichar_t **lines;
-    size_t      lines_length, block_length;
+    activity_paging_source_callback_t  source;
+    activity_paging_overlay_callback_t overlay;
+    void                              *source_data;
+
+    const char *const      *source_lines;
+    activity_paging_line_t *lines;
+    size_t                  lines_first, lines_count;
+    size_t                  lines_length, block_length;
 
     size_t                   page_reference_index;
     activity_paging_action_t change_page;
 
+    int        show_overlay;
+    int        failed;
     unichar_t *title;
 } activity_paging_data_t;
 
+/**
+ * @brief Frees the lines obtained from the source of a paginator.
+ * @param paging Paginator whose ::activity_paging_data_t::lines are deleted.
+ */
+void __activity_paging_free_lines(activity_paging_data_t *paging) {
+    for (size_t i = 0; i < paging->lines_count; i++) {
+        g_free(paging->lines[i].text);
+        free(paging->lines[i].widths);
+    }
+    free(paging->lines);
+
+    paging->source_lines = NULL;
+    paging->lines        = NULL;
+    paging->lines_count  = 0;
+}
+
+/**
+ * @brief   Replaces the lines in a paginator with new ones, obtained from its source.
+ * @details Lines aren't converted to UTF-32 here, but only when they're shown, so that the cost of
+ *          fetching doesn't depend on the length of lines that may never be seen.
+ *
+ * @param paging Paginator to be modified.
+ * @param first  Index of the first line to be requested.
+ * @param count  Number of lines to be requested.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or failure of the source.
+ */
+int __activity_paging_fetch(activity_paging_data_t *paging, size_t first, size_t count) {
+    const char *const *lines;
+    size_t             n, total;
+    if (paging->source(paging->source_data, first, count, &lines, &n, &total))
+        return 1;
+
+    activity_paging_line_t *const new_lines = calloc(max(n, 1), sizeof(activity_paging_line_t));
+    if (!new_lines)
+        return 1;
+
+    __activity_paging_free_lines(paging);
+    paging->source_lines = lines;
+    paging->lines        = new_lines;
+    paging->lines_first  = first;
+    paging->lines_count  = n;
+    paging->lines_length = max(total, 1); /* Simplify edge case: show a single empty line */
+    return 0;
+}
+
+/**
+ * @brief   Converts a line to UTF-32 and measures all of its prefixes.
+ * @details Auxiliary method for ::__activity_paging_get_line.
+ *
+ * @param line   Line to be filled in.
+ * @param source UTF-8 line to be converted.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __activity_paging_convert_line(activity_paging_line_t *line, const char *source) {
+    glong            length;
+    unichar_t *const text = g_utf8_to_ucs4_fast(source, -1, &length);
+
+    uint32_t *const widths = malloc((length + 1) * sizeof(uint32_t));
+    if (!widths) {
+        g_free(text);
+        return 1;
+    }
+
+    widths[0] = 0;
+    for (glong i = 0; i < length; ++i)
+        widths[i + 1] = widths[i] + ncurses_measure_character(text[i]);
+
+    line->text   = text;
+    line->widths = widths;
+    line->length = length;
+    return 0;
+}
+
+/**
+ * @brief   Gets a line from a paginator.
+ * @details Lines that weren't obtained from the source (or that couldn't be converted) are
+ *          considered to be empty.
+ *
+ * @param paging Paginator to get the line from.
+ * @param i      Index of the line.
+ *
+ * @return The line at index @p i.
+ */
+const activity_paging_line_t *__activity_paging_get_line(activity_paging_data_t *paging, size_t i) {
+    static unichar_t                    empty_text[1]   = {0};
+    static uint32_t                     empty_widths[1] = {0};
+    static const activity_paging_line_t empty_line      = {.text   = empty_text,
+                                                           .widths = empty_widths,
+                                                           .length = 0};
+
+    if (i < paging->lines_first || i - paging->lines_first >= paging->lines_count)
+        return &empty_line;
+
+    activity_paging_line_t *const line = &paging->lines[i - paging->lines_first];
+    if (!line->text &&
+        __activity_paging_convert_line(line, paging->source_lines[i - paging->lines_first]))
+        return &empty_line;
+    return line;
+}
+
+/**
+ * @brief   Calculates the length of the longest prefix of a line that fits in a given width.
+ * @details Equivalent to ::ncurses_prefix_from_maximum_length, but with a binary search over the
+ *          widths of the line's prefixes, instead of measuring every character.
+ *
+ * @param line Line to be truncated.
+ * @param max  Maximum width.
+ *
+ * @return The number of characters of @p line to be printed.
+ */
+size_t __activity_paging_line_prefix(const activity_paging_line_t *line, size_t max) {
+    /* Widths never decrease, so find the longest prefix that fits */
+    size_t low = 0, high = line->length;
+    while (low < high) {
+        const size_t middle = low + (high - low + 1) / 2;
+        if (line->widths[middle] <= max)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+
+    /* Like ncurses_prefix_from_maximum_length, also count the character that doesn't fit */
+    return low < line->length ? low + 1 : low;
+}
+
 /**
  * @brief   Responds to user input in a paging activity.
  * @details Handles user input to navigate through the pages of outputs, if necessary.
@@ -83,6 +265,8 @@ int __activity_paging_keypress(void *activity_data, wint_t key, int is_key_code)
     if (!is_key_code && key == '\x1b') {
         /* Exit paging activity */
         return 1;
+    } else if (!is_key_code && (key == 'p' || key == 'P') && paging->overlay) {
+        paging->show_overlay = !paging->show_overlay;
     } else if (is_key_code) {
         /* Page changing is done during rendering, as there there's context about screen size. */
         switch (key) {
@@ -103,10 +287,50 @@ int __activity_paging_keypress(void *activity_data, wint_t key, int is_key_code)
     return 0;
 }
 
+/**
+ * @brief   Renders the lines of a paginator's overlay in a box over the bottom right corner of its
+ *          page.
+ * @details Auxiliary method for ::__activity_paging_render. Nothing is rendered if the box doesn't
+ *          fit in the page.
+ *
+ * @param paging      Paginator whose ::activity_paging_data_t::overlay is to be rendered.
+ * @param menu_x      Horizontal position of the page.
+ * @param menu_y      Vertical position of the page.
+ * @param menu_width  Horizontal size of the page.
+ * @param menu_height Vertical size of the page.
+ */
+void __activity_paging_render_overlay(activity_paging_data_t *paging,
+                                      int                     menu_x,
+                                      int                     menu_y,
+                                      int                     menu_width,
+                                      int                     menu_height) {
+    size_t                   n;
+    const char *const *const lines = paging->overlay(paging->source_data, &n);
+    if (!lines || !n)
+        return;
+
+    int line_width = 0;
+    for (size_t i = 0; i < n; ++i)
+        line_width = max(line_width, (int) strlen(lines[i]));
+
+    /* Leave the page's border, and the line with paging information, uncovered */
+    const int width  = line_width + 2;
+    const int height = n;
+    const int x      = menu_x + menu_width - width - 2;
+    const int y      = menu_y + menu_height - height - 2;
+    if (x - 1 <= menu_x || y - 1 < menu_y)
+        return;
+
+    ncurses_render_rectangle(x, y, width, height);
+    for (int i = 0; i < height; ++i)
+        mvprintw(y + i, x, " %-*s ", line_width, lines[i]);
+}
+
 /**
  * @brief  Renders a paging activity.
  * @param  activity_data Pointer to an ::activity_paging_data_t.
- * @retval 0 Always, to continue running this activity.
+ * @retval 0 Success, to continue running this activity.
+ * @retval 1 Failure to obtain the lines to be shown, to stop running this activity.
  */
 int __activity_paging_render(void *activity_data) {
     activity_paging_data_t *const paging = activity_data;
@@ -150,6 +374,19 @@ int __activity_paging_render(void *activity_data) {
     }
     paging->page_reference_index = page_number * max_on_screen_lines;
 
+    /* Request the lines of the current page (and of some of the following ones) when needed */
+    const size_t page_end =
+        min(paging->page_reference_index + max_on_screen_lines, paging->lines_length);
+    const size_t fetched_end = paging->lines_first + paging->lines_count;
+    const size_t fetch_count = max_on_screen_lines * ACTIVITY_PAGING_PREFETCH_PAGES;
+
+    if ((paging->page_reference_index < paging->lines_first ||
+         (page_end > fetched_end && fetched_end < paging->lines_length)) &&
+        __activity_paging_fetch(paging, paging->page_reference_index, fetch_count)) {
+        paging->failed = 1;
+        return 1;
+    }
+
     /* Prints paging information if there's more than one page. */
     if (max_page_number != 0) {
         move(menu_y + menu_height - 1, menu_x + 1);
@@ -177,15 +414,17 @@ int __activity_paging_render(void *activity_data) {
             text_y++;
 
             if (i + j >= paging->lines_length)
-                return 0; /* Reached end of text */
+                break; /* Reached end of text */
 
-            const size_t line_max_chars = ncurses_prefix_from_maximum_length(paging->lines[i + j],
-                                                                             max(menu_width - 3, 0),
-                                                                             NULL);
-            ncurses_put_wide_string(paging->lines[i + j], line_max_chars);
+            const activity_paging_line_t *const line = __activity_paging_get_line(paging, i + j);
+            const size_t line_max_chars =
+                __activity_paging_line_prefix(line, max(menu_width - 3, 0));
+            ncurses_put_wide_string(line->text, line_max_chars);
         }
     }
 
+    if (paging->show_overlay)
+        __activity_paging_render_overlay(paging, menu_x, menu_y, menu_width, menu_height);
     return 0;
 }
 
@@ -195,9 +434,7 @@ int __activity_paging_render(void *activity_data) {
  */
 void __activity_paging_free_data(void *activity_data) {
     activity_paging_data_t *const paging = activity_data;
-    for (size_t i = 0; i < paging->lines_length; i++)
-        g_free(paging->lines[i]);
-    free(paging->lines);
+    __activity_paging_free_lines(paging);
     g_free(paging->title);
     free(paging);
 }
@@ -205,38 +442,55 @@ void __activity_paging_free_data(void *activity_data) {
 /**
  * @brief Creates an ::activity_t for a paginator.
  *
- * @param n            The number of @p lines.
- * @param lines        The lines of output be shown on the screen.
- * @param block_length The number of lines in an unbreakable block (include empty line).
- * @param title        The title of the activity.
+ * @param source      Callback that provides the lines to be shown.
+ * @param overlay     Callback that provides the lines shown over the output (can be `NULL`).
+ * @param source_data Pointer passed to @p source and @p overlay.
+ * @param blocking    If text blocks should be considered in page separation.
+ * @param title       The title of the activity.
  *
  * @return  An ::activity_t for a paginator, that must be deleted using ::activity_free. `NULL` is
- *          also a possibility, when an allocation failure occurs.
+ *          also a possibility, when an allocation failure (or a failure of @p source) occurs.
  */
-activity_t *__activity_paging_create(size_t            n,
-                                     const char *const lines[n],
-                                     size_t            block_length,
-                                     const char       *title) {
+activity_t *__activity_paging_create(activity_paging_source_callback_t  source,
+                                     activity_paging_overlay_callback_t overlay,
+                                     void                              *source_data,
+                                     int                                blocking,
+                                     const char                        *title) {
 
     activity_paging_data_t *const activity_data = malloc(sizeof(activity_paging_data_t));
     if (!activity_data)
         return NULL;
 
-    activity_data->lines = malloc(n * sizeof(unichar_t *));
-    if (!activity_data->lines) {
-        free(activity_data);
-        return NULL;
-    }
-
-    for (size_t i = 0; i < n; i++)
-        activity_data->lines[i] = g_utf8_to_ucs4_fast(lines[i], -1, NULL);
-
-    activity_data->lines_length         = n;
-    activity_data->block_length         = block_length;
+    activity_data->source               = source;
+    activity_data->overlay              = overlay;
+    activity_data->source_data          = source_data;
+    activity_data->source_lines         = NULL;
+    activity_data->lines                = NULL;
+    activity_data->lines_first          = 0;
+    activity_data->lines_count          = 0;
     activity_data->page_reference_index = 0;
     activity_data->change_page          = ACTIVITY_PAGING_ACTION_KEEP;
+    activity_data->show_overlay         = 0;
+    activity_data->failed               = 0;
     activity_data->title                = g_utf8_to_ucs4_fast(title, -1, NULL);
 
+    if (__activity_paging_fetch(activity_data, 0, ACTIVITY_PAGING_INITIAL_LINES)) {
+        __activity_paging_free_data(activity_data);
+        return NULL;
+    }
+
+    /* Automatically determine block size */
+    activity_data->block_length = 1;
+    if (blocking) {
+        activity_data->block_length = activity_data->lines_length; /* All text is a single block */
+        for (size_t i = 0; i < activity_data->lines_count; ++i) {
+            if (!*activity_data->source_lines[i]) {
+                activity_data->block_length = i + 1;
+                break;
+            }
+        }
+    }
+
     activity_t *const ret = activity_create(__activity_paging_keypress,
                                             __activity_paging_render,
                                             __activity_paging_free_data,
@@ -248,34 +502,70 @@ activity_t *__activity_paging_create(size_t            n,
     return ret;
 }
 
-int activity_paging_run(size_t n, const char *const lines[n], int blocking, const char *title) {
-    const char *const single_empty_line[] = {""};
-    if (n == 0) { /* Simplify edge case */
-        lines = single_empty_line;
-        n     = 1;
-    }
-
-    /* Automatically determine block size */
-    size_t block_length = 0;
-    if (blocking) {
-        for (size_t i = 0; i < n; ++i) {
-            if (!*lines[i]) {
-                block_length = i + 1;
-                break;
-            }
-        }
+/**
+ * @struct activity_paging_array_t
+ * @brief  Lines in an array, to be shown by ::activity_paging_run.
+ *
+ * @var activity_paging_array_t::n
+ *     @brief Number of lines in ::activity_paging_array_t::lines.
+ * @var activity_paging_array_t::lines
+ *     @brief Lines to be shown.
+ */
+typedef struct {
+    size_t             n;
+    const char *const *lines;
+} activity_paging_array_t;
 
-        if (block_length == 0)
-            block_length = n; /* All text is a single block */
+/**
+ * @brief Provides lines from an array to a paginator.
+ * @details Implementation of ::activity_paging_source_callback_t for ::activity_paging_run.
+ *
+ * @param source_data Pointer to an ::activity_paging_array_t.
+ * @param first       Index of the first line requested.
+ * @param count       Number of lines requested.
+ * @param out_lines   Where to output the requested lines to.
+ * @param out_count   Where to output the number of lines in @p out_lines to.
+ * @param out_total   Where to output the total number of lines to.
+ *
+ * @retval 0 Always successful.
+ */
+int __activity_paging_array_source(void               *source_data,
+                                   size_t              first,
+                                   size_t              count,
+                                   const char *const **out_lines,
+                                   size_t             *out_count,
+                                   size_t             *out_total) {
+    const activity_paging_array_t *const array = source_data;
+
+    *out_total = array->n;
+    if (first >= array->n) {
+        *out_lines = NULL;
+        *out_count = 0;
     } else {
-        block_length = 1;
+        *out_lines = array->lines + first;
+        *out_count = min(count, array->n - first);
     }
+    return 0;
+}
+
+int activity_paging_run(size_t n, const char *const lines[n], int blocking, const char *title) {
+    activity_paging_array_t array = {.n = n, .lines = lines};
+    return activity_paging_run_lazy(__activity_paging_array_source, NULL, &array, blocking, title);
+}
+
+int activity_paging_run_lazy(activity_paging_source_callback_t  source,
+                             activity_paging_overlay_callback_t overlay,
+                             void                              *source_data,
+                             int                                blocking,
+                             const char                        *title) {
 
-    activity_t *const activity = __activity_paging_create(n, lines, block_length, title);
+    activity_t *const activity =
+        __activity_paging_create(source, overlay, source_data, blocking, title);
     if (!activity)
         return 1;
 
-    activity_run(activity);
+    const activity_paging_data_t *const paging = activity_run(activity);
+    const int                           failed = paging && paging->failed;
     activity_free(activity);
-    return 0;
+    return failed;
 }
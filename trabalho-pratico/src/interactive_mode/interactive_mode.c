@@ -22,9 +22,22 @@
  * See [the header file's documentation](@ref interactive_mode_examples).
  */
 
+/** @cond FALSE */
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE /* For syscall */
+#endif
+/** @endcond */
+
 #include <glib.h>
+#include <inttypes.h>
 #include <locale.h>
 #include <ncurses.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "dataset/dataset_loader.h"
@@ -38,6 +51,40 @@
 #include "interactive_mode/screen_loading_dataset.h"
 #include "queries/query_dispatcher.h"
 #include "queries/query_parser.h"
+#include "queries/query_slow_log.h"
+#include "testing/performance_event.h"
+#include "testing/performance_metrics.h"
+#include "utils/memory_budget.h"
+
+/** @brief Number of bytes in each block of the arena where interactive query arguments are put. */
+#define INTERACTIVE_MODE_ARGUMENTS_ARENA_SIZE 256
+
+/** @brief Milliseconds between updates of the screen while a dataset is being loaded. */
+#define INTERACTIVE_MODE_LOADING_REFRESH_MS 100
+
+/**
+ * @brief   Milliseconds between checks for a query running in the background having finished.
+ * @details Shorter than ::INTERACTIVE_MODE_LOADING_REFRESH_MS, as queries are run again for every
+ *          page shown, and most of them finish almost immediately.
+ */
+#define INTERACTIVE_MODE_QUERY_REFRESH_MS 10
+
+/**
+ * @brief   Indexes left out of ::database_freeze when a dataset is loaded, and built in the
+ *          background afterwards (see ::__interactive_mode_warm_up_start).
+ * @details The index of user names isn't deferred, as it's stored in snapshots, and restoring it
+ *          is cheap.
+ */
+#define INTERACTIVE_MODE_WARM_UP_DATA (DATABASE_DATA_HOTEL_INDEXES | DATABASE_DATA_FLIGHT_INDEXES)
+
+/** @brief Nice value of the thread building indexes in the background (the lowest priority). */
+#define INTERACTIVE_MODE_WARM_UP_NICE 19
+
+/** @brief Maximum number of lines in the performance overlay of a query's output. */
+#define INTERACTIVE_MODE_OVERLAY_LINES 16
+
+/** @brief Maximum length of each line in the performance overlay of a query's output. */
+#define INTERACTIVE_MODE_OVERLAY_LINE_LENGTH 48
 
 /**
  * @brief  Initializes `ncurses` for the interactive mode.
@@ -63,22 +110,219 @@ int __interactive_mode_init_ncurses(void) {
     return 0;
 }
 
+/**
+ * @struct interactive_mode_loader_t
+ * @brief  Data needed to load a dataset in a background thread.
+ *
+ * @var interactive_mode_loader_t::database
+ *     @brief Database where to load the dataset to.
+ * @var interactive_mode_loader_t::path
+ *     @brief Path to the directory containing the dataset.
+ * @var interactive_mode_loader_t::metrics
+ *     @brief Where the loader registers its performance (can be `NULL`).
+ * @var interactive_mode_loader_t::progress
+ *     @brief Where the loader registers its progress, marked as finished after loading.
+ * @var interactive_mode_loader_t::retval
+ *     @brief Value returned by ::dataset_loader_load.
+ */
+typedef struct {
+    database_t            *database;
+    const char            *path;
+    performance_metrics_t *metrics;
+    dataset_progress_t    *progress;
+    int                    retval;
+} interactive_mode_loader_t;
+
+/**
+ * @brief   Loads a dataset, marking its progress as finished afterwards.
+ * @details Thread entry point, that can also be called directly.
+ *
+ * @param loader_data Pointer to a ::interactive_mode_loader_t, whose
+ *                    ::interactive_mode_loader_t::retval will be set.
+ *
+ * @return Always `NULL`.
+ */
+void *__interactive_mode_loader_run(void *loader_data) {
+    interactive_mode_loader_t *const loader = loader_data;
+
+    loader->retval = dataset_loader_load(loader->database,
+                                         loader->path,
+                                         NULL,
+                                         loader->metrics,
+                                         loader->progress);
+    dataset_progress_finish(loader->progress);
+    return NULL;
+}
+
+/**
+ * @brief  Gets the time elapsed since @p start, in seconds.
+ * @param  start Time obtained with `clock_gettime(CLOCK_MONOTONIC, ...)`.
+ * @return The number of seconds since @p start.
+ */
+double __interactive_mode_seconds_since(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/**
+ * @brief   Loads a dataset in a background thread, while showing its progress on screen.
+ * @details The user can cancel the load by pressing ESC or `q`. If a thread can't be created, the
+ *          dataset is loaded in the calling thread, without showing any progress or allowing for
+ *          cancellation.
+ *
+ * @param database Database where to load the dataset to.
+ * @param path     Path to the directory containing the dataset.
+ * @param metrics  Where to register the performance of loading the dataset. Can be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (allocation or IO). @p database must be discarded.
+ * @retval 2 Cancelled by the user. @p database must be discarded.
+ */
+int __interactive_mode_load_in_background(database_t            *database,
+                                          const char            *path,
+                                          performance_metrics_t *metrics) {
+    interactive_mode_loader_t loader = {.database = database,
+                                        .path     = path,
+                                        .metrics  = metrics,
+                                        .progress = dataset_progress_create(),
+                                        .retval   = 1};
+    if (!loader.progress)
+        return 1;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    screen_loading_dataset_render(loader.progress, 0.0);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, __interactive_mode_loader_run, &loader)) {
+        __interactive_mode_loader_run(&loader); /* Fall back to loading in this thread */
+        dataset_progress_free(loader.progress);
+        return loader.retval;
+    }
+
+    /* Keep the screen responsive while loading: wait for input for a limited amount of time */
+    timeout(INTERACTIVE_MODE_LOADING_REFRESH_MS);
+    while (!dataset_progress_is_finished(loader.progress)) {
+        wint_t    input;
+        const int is_key_code = get_wch(&input);
+        if (is_key_code == OK && (input == '\x1b' || input == 'q'))
+            dataset_progress_cancel(loader.progress);
+
+        screen_loading_dataset_render(loader.progress, __interactive_mode_seconds_since(&start));
+    }
+    timeout(-1);
+
+    pthread_join(thread, NULL);
+    const int cancelled = dataset_progress_is_cancelled(loader.progress);
+    dataset_progress_free(loader.progress);
+    return cancelled ? 2 : loader.retval;
+}
+
+/**
+ * @struct interactive_mode_warm_up_t
+ * @brief  A background thread building the indexes of a database that was just loaded.
+ *
+ * @var interactive_mode_warm_up_t::database
+ *     @brief Database whose indexes are being built.
+ * @var interactive_mode_warm_up_t::thread
+ *     @brief Thread building the indexes.
+ * @var interactive_mode_warm_up_t::running
+ *     @brief Whether ::interactive_mode_warm_up_t::thread was started and not yet joined.
+ */
+typedef struct {
+    const database_t *database;
+    pthread_t         thread;
+    int               running;
+} interactive_mode_warm_up_t;
+
+/**
+ * @brief   Builds the indexes of a database with the lowest priority.
+ * @details Thread entry point. Threads created by this one (e.g.: to sort indexes in parallel)
+ *          inherit its priority. Failing to lower the priority, or to build the indexes, isn't
+ *          reported, as queries build missing indexes anyway.
+ *
+ * @param warm_up_data Pointer to a ::interactive_mode_warm_up_t.
+ *
+ * @return Always `NULL`.
+ */
+void *__interactive_mode_warm_up_run(void *warm_up_data) {
+    const interactive_mode_warm_up_t *const warm_up = warm_up_data;
+
+    /* In Linux, the nice value of a single thread can be set with its identifier */
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), INTERACTIVE_MODE_WARM_UP_NICE);
+    database_build_indexes(warm_up->database, INTERACTIVE_MODE_WARM_UP_DATA);
+    return NULL;
+}
+
+/**
+ * @brief   Starts building the indexes of a database that was just loaded, while the user chooses
+ *          the first query.
+ * @details Without this, the first query of each type would build the indexes it needs. Queries
+ *          that need an index while it's being built wait for it instead. Nothing is done close to
+ *          the [memory budget](@ref memory_budget.h), or if a thread can't be created.
+ *
+ * @param warm_up  Where to store the thread. Must not be running.
+ * @param database Frozen database whose indexes are to be built. Mustn't be freed before
+ *                 ::__interactive_mode_warm_up_join is called.
+ */
+void __interactive_mode_warm_up_start(interactive_mode_warm_up_t *warm_up,
+                                      const database_t           *database) {
+    warm_up->database = database;
+    warm_up->running  = 0;
+    if (memory_budget_should_degrade(MEMORY_BUDGET_DEGRADATION_INDEXES))
+        return;
+
+    warm_up->running =
+        pthread_create(&warm_up->thread, NULL, __interactive_mode_warm_up_run, warm_up) == 0;
+}
+
+/**
+ * @brief   Waits for indexes being built in the background to be finished.
+ * @details Must be called before the database is freed. Building indexes can't be interrupted.
+ * @param   warm_up Background thread, that may not be running.
+ */
+void __interactive_mode_warm_up_join(interactive_mode_warm_up_t *warm_up) {
+    if (warm_up->running)
+        pthread_join(warm_up->thread, NULL);
+    warm_up->running = 0;
+}
+
 /**
  * @brief Method called when the user chooses to load a dataset in the main menu.
- * @param database Databaset to be modifed.
+ * @param database         Databaset to be modifed.
+ * @param statistics_cache Cache of query statistics for @p database, to be recreated with it.
+ * @param materializer     Rendered query outputs for @p database, to be recreated with it.
+ * @param warm_up          Background thread building the indexes of @p database, restarted for
+ *                         the new database.
+ * @param load_metrics     Performance of loading @p database, to be recreated with it. Stays
+ *                         `NULL` if it can't be allocated, as it's only shown to the user.
  */
-void __interactive_mode_load_dataset(database_t **database) {
+void __interactive_mode_load_dataset(database_t                **database,
+                                     query_statistics_cache_t  **statistics_cache,
+                                     query_materializer_t      **materializer,
+                                     interactive_mode_warm_up_t *warm_up,
+                                     performance_metrics_t     **load_metrics) {
     /* Ask for dataset path */
     char *const path = activity_dataset_picker_run();
     if (!path)
         return;
 
-    /* Show that a new dataset is being loaded */
-    screen_loading_dataset_render();
-
-    /* Recreate database */
+    /* Recreate database (statistical data depends on it) */
+    if (*statistics_cache) {
+        query_statistics_cache_free(*statistics_cache);
+        *statistics_cache = NULL;
+    }
+    if (*materializer) {
+        query_materializer_free(*materializer);
+        *materializer = NULL;
+    }
+    __interactive_mode_warm_up_join(warm_up);
     if (*database)
         database_free(*database);
+    if (*load_metrics)
+        performance_metrics_free(*load_metrics);
+    *load_metrics = performance_metrics_create();
 
     *database = database_create();
     if (!*database) {
@@ -87,24 +331,379 @@ void __interactive_mode_load_dataset(database_t **database) {
         free(path);
         return;
     }
+    database_set_data(*database, DATABASE_DATA_ALL & ~INTERACTIVE_MODE_WARM_UP_DATA);
 
     /* Load new dataset */
-    if (dataset_loader_load(*database, path, NULL, NULL)) {
-        activity_messagebox_run("Failed to load dataset! Old data has been discarded.");
+    const int load_retval = __interactive_mode_load_in_background(*database, path, *load_metrics);
+    if (load_retval) {
+        activity_messagebox_run(load_retval == 2
+                                    ? "Dataset loading cancelled. Old data has been discarded."
+                                    : "Failed to load dataset! Old data has been discarded.");
         database_free(*database);
         *database = NULL;
     } else {
+        /* Without a cache, queries still run, but without reusing statistical data */
+        *statistics_cache = query_statistics_cache_create(*database);
+        *materializer     = query_materializer_create(*database);
+        __interactive_mode_warm_up_start(warm_up, *database);
         activity_messagebox_run("Dataset loaded successfully!");
     }
 
     free(path);
 }
 
+/**
+ * @struct interactive_mode_query_output_t
+ * @brief  A query whose output is generated on demand, to be shown by ::activity_paging_run_lazy.
+ *
+ * @var interactive_mode_query_output_t::database
+ *     @brief Database to be queried.
+ * @var interactive_mode_query_output_t::query
+ *     @brief Query to be run.
+ * @var interactive_mode_query_output_t::statistics_cache
+ *     @brief Cache of query statistics for ::interactive_mode_query_output_t::database (can be
+ *            `NULL`).
+ * @var interactive_mode_query_output_t::materializer
+ *     @brief Rendered query outputs for ::interactive_mode_query_output_t::database (can be
+ *            `NULL`).
+ * @var interactive_mode_query_output_t::writer
+ *     @brief Writer of the last lines generated (owns them), or `NULL` before any are generated.
+ * @var interactive_mode_query_output_t::cancellation
+ *     @brief Cancellation of ::interactive_mode_query_output_t::query, restarted every time it's
+ *            run.
+ * @var interactive_mode_query_output_t::stopped
+ *     @brief `0` if the query always ran to completion, `1` if it was cancelled by the user, or `2`
+ *            if it timed out.
+ * @var interactive_mode_query_output_t::load_metrics
+ *     @brief Performance of loading ::interactive_mode_query_output_t::database (can be `NULL`).
+ * @var interactive_mode_query_output_t::overlay
+ *     @brief Performance of the last run of ::interactive_mode_query_output_t::query, followed by
+ *            ::interactive_mode_query_output_t::load_metrics, to be shown over its output.
+ * @var interactive_mode_query_output_t::overlay_lines
+ *     @brief Pointers to the lines in ::interactive_mode_query_output_t::overlay.
+ * @var interactive_mode_query_output_t::overlay_count
+ *     @brief Number of lines in ::interactive_mode_query_output_t::overlay.
+ */
+typedef struct {
+    const database_t         *database;
+    const query_instance_t   *query;
+    query_statistics_cache_t *statistics_cache;
+    query_materializer_t     *materializer;
+    query_writer_t           *writer;
+    query_cancellation_t     *cancellation;
+    int                       stopped;
+
+    const performance_metrics_t *load_metrics;
+    char        overlay[INTERACTIVE_MODE_OVERLAY_LINES][INTERACTIVE_MODE_OVERLAY_LINE_LENGTH];
+    const char *overlay_lines[INTERACTIVE_MODE_OVERLAY_LINES];
+    size_t      overlay_count;
+} interactive_mode_query_output_t;
+
+/**
+ * @struct interactive_mode_query_runner_t
+ * @brief  Data needed to run a query in a background thread.
+ *
+ * @var interactive_mode_query_runner_t::output
+ *     @brief Query to be run, and where to write its output to.
+ * @var interactive_mode_query_runner_t::retval
+ *     @brief Value returned by ::query_dispatcher_dispatch_single.
+ * @var interactive_mode_query_runner_t::finished
+ *     @brief Whether the query has finished running. Accessed atomically.
+ */
+typedef struct {
+    interactive_mode_query_output_t *output;
+    int                              retval;
+    int                              finished;
+} interactive_mode_query_runner_t;
+
+/**
+ * @brief Adds a line to the performance overlay of a query's output.
+ *
+ * @param output Query whose ::interactive_mode_query_output_t::overlay is to be modified. Lines
+ *               beyond ::INTERACTIVE_MODE_OVERLAY_LINES are ignored.
+ * @param format Format string, followed by its arguments (see `printf(3)`).
+ */
+void __interactive_mode_overlay_add(interactive_mode_query_output_t *output,
+                                    const char                      *format,
+                                    ...) {
+    if (output->overlay_count >= INTERACTIVE_MODE_OVERLAY_LINES)
+        return;
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(output->overlay[output->overlay_count],
+              INTERACTIVE_MODE_OVERLAY_LINE_LENGTH,
+              format,
+              args);
+    va_end(args);
+
+    output->overlay_lines[output->overlay_count] = output->overlay[output->overlay_count];
+    output->overlay_count++;
+}
+
+/**
+ * @brief Adds a time to the performance overlay of a query's output.
+ *
+ * @param output Query whose ::interactive_mode_query_output_t::overlay is to be modified.
+ * @param name   Name of what was measured, padded to align times.
+ * @param time   Measured time, in microseconds, or `0` if it wasn't measured.
+ */
+void __interactive_mode_overlay_add_time(interactive_mode_query_output_t *output,
+                                         const char                      *name,
+                                         uint64_t                         time) {
+    if (time)
+        __interactive_mode_overlay_add(output, "%-18s %12.3f ms", name, time / 1000.0);
+    else
+        __interactive_mode_overlay_add(output, "%-18s %15s", name, "-");
+}
+
+/**
+ * @brief   Describes the performance of the last run of a query, and of loading its dataset.
+ * @details Auxiliary method for ::__interactive_mode_query_runner_run. Queries written by the
+ *          materializer have no statistics or execution times. The memory delta is of the whole
+ *          process, so it includes indexes being built in the background.
+ *
+ * @param output    Query that was run, whose ::interactive_mode_query_output_t::overlay is
+ *                  replaced.
+ * @param metrics   Performance of the query's statistics and execution. Can be `NULL`.
+ * @param event     Performance of the whole run of the query. Can be `NULL`.
+ * @param wall_time Time (in microseconds) of the whole run of the query.
+ */
+void __interactive_mode_describe_query(interactive_mode_query_output_t *output,
+                                       const performance_metrics_t     *metrics,
+                                       const performance_event_t       *event,
+                                       uint64_t                         wall_time) {
+    const size_t type = query_type_get_type_number(query_instance_get_type(output->query));
+
+    output->overlay_count = 0;
+    if (metrics) {
+        __interactive_mode_overlay_add_time(
+            output,
+            "Statistics",
+            performance_metrics_get_query_statistics_wall_time(metrics, type));
+        __interactive_mode_overlay_add_time(
+            output,
+            "Execution",
+            performance_metrics_get_query_execution_wall_time(metrics, type));
+    }
+    __interactive_mode_overlay_add_time(output,
+                                        "  of it formatting",
+                                        query_writer_get_formatting_time(output->writer) / 1000);
+    __interactive_mode_overlay_add_time(output, "Total", wall_time);
+    __interactive_mode_overlay_add(output,
+                                   "%-18s %15zu",
+                                   "Rows",
+                                   query_writer_get_object_count(output->writer));
+    __interactive_mode_overlay_add(output,
+                                   "%-18s %15zu",
+                                   "Bytes (this page)",
+                                   query_writer_get_output_size(output->writer));
+    if (event)
+        __interactive_mode_overlay_add(output,
+                                       "%-18s %11zu KiB",
+                                       "Memory delta",
+                                       performance_event_get_used_memory(event));
+
+    if (!output->load_metrics)
+        return;
+
+    const char *const file_names[PERFORMANCE_METRICS_DATASET_STEP_DONE] = {"  users.csv",
+                                                                           "  flights.csv",
+                                                                           "  passengers.csv",
+                                                                           "  reservations.csv"};
+
+    __interactive_mode_overlay_add(output, "%s", "");
+    __interactive_mode_overlay_add_time(
+        output,
+        "Dataset load",
+        performance_metrics_get_dataset_wall_time(output->load_metrics));
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i) {
+        const uint64_t time =
+            performance_metrics_get_dataset_step_wall_time(output->load_metrics, i);
+        if (time) /* Steps aren't measured when restoring snapshots */
+            __interactive_mode_overlay_add_time(output, file_names[i], time);
+    }
+}
+
+/**
+ * @brief   Runs a query, marking it as finished afterwards.
+ * @details Thread entry point, that can also be called directly. The query's performance is
+ *          measured for ::interactive_mode_query_output_t::overlay, when possible.
+ *
+ * @param runner_data Pointer to a ::interactive_mode_query_runner_t, whose
+ *                    ::interactive_mode_query_runner_t::retval will be set.
+ *
+ * @return Always `NULL`.
+ */
+void *__interactive_mode_query_runner_run(void *runner_data) {
+    interactive_mode_query_runner_t *const runner = runner_data;
+    interactive_mode_query_output_t *const output = runner->output;
+
+    performance_metrics_t *const metrics = performance_metrics_create();
+    performance_event_t         *event   = performance_event_start_measuring();
+    struct timespec              start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    runner->retval = query_dispatcher_dispatch_single(output->database,
+                                                      output->query,
+                                                      output->writer,
+                                                      output->statistics_cache,
+                                                      output->materializer,
+                                                      metrics);
+
+    const uint64_t wall_time = __interactive_mode_seconds_since(&start) * 1000000;
+    if (event && performance_event_stop_measuring(event)) {
+        performance_event_free(event);
+        event = NULL;
+    }
+    __interactive_mode_describe_query(output, metrics, event, wall_time);
+
+    if (event)
+        performance_event_free(event);
+    if (metrics)
+        performance_metrics_free(metrics);
+    __atomic_store_n(&runner->finished, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/**
+ * @brief   Provides the lines of a query's performance overlay to the paginator.
+ * @details Implementation of ::activity_paging_overlay_callback_t.
+ *
+ * @param source_data Pointer to an ::interactive_mode_query_output_t.
+ * @param out_count   Where to output the number of lines to.
+ *
+ * @return The lines in ::interactive_mode_query_output_t::overlay.
+ */
+const char *const *__interactive_mode_query_output_overlay(void *source_data, size_t *out_count) {
+    const interactive_mode_query_output_t *const output = source_data;
+    *out_count                                          = output->overlay_count;
+    return output->overlay_lines;
+}
+
+/**
+ * @brief   Runs a query in a background thread, so that the user can cancel it.
+ * @details The user can cancel the query by pressing ESC or `q`, and it's also cancelled once its
+ *          time budget (see ::query_cancellation_get_default_timeout) runs out. If a thread can't
+ *          be created, the query runs in the calling thread, where it can only time out.
+ *
+ * @param output Query to be run, and where to write its output to.
+ *
+ * @retval 0 Success (the query may have been cancelled, see ::query_writer_is_incomplete).
+ * @retval 1 Allocation failure.
+ */
+int __interactive_mode_run_query_in_background(interactive_mode_query_output_t *output) {
+    interactive_mode_query_runner_t runner = {.output = output, .retval = 1, .finished = 0};
+    query_cancellation_start(output->cancellation, query_cancellation_get_default_timeout());
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, __interactive_mode_query_runner_run, &runner)) {
+        __interactive_mode_query_runner_run(&runner); /* Fall back to running in this thread */
+        return runner.retval;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    timeout(INTERACTIVE_MODE_QUERY_REFRESH_MS);
+    int hint_shown = 0;
+    while (!__atomic_load_n(&runner.finished, __ATOMIC_ACQUIRE)) {
+        wint_t    input;
+        const int is_key_code = get_wch(&input);
+        if (is_key_code == OK && (input == '\x1b' || input == 'q'))
+            query_cancellation_cancel(output->cancellation);
+
+        /* Only slow queries get a hint, that the paging activity later draws over */
+        const double elapsed_ms = __interactive_mode_seconds_since(&start) * 1000;
+        if (!hint_shown && elapsed_ms >= INTERACTIVE_MODE_LOADING_REFRESH_MS) {
+            mvaddstr(LINES - 1, 0, "Running query... Press ESC to cancel.");
+            clrtoeol();
+            refresh();
+            hint_shown = 1;
+        }
+    }
+    timeout(-1);
+
+    pthread_join(thread, NULL);
+    return runner.retval;
+}
+
+/**
+ * @brief   Runs a query, only formatting the lines of its output that are requested.
+ * @details Implementation of ::activity_paging_source_callback_t. The query is run again for every
+ *          request (reusing cached statistics), so that formatting (the expensive part of showing
+ *          queries with many lines of output) only happens for the lines that are shown.
+ *
+ * @param source_data Pointer to an ::interactive_mode_query_output_t.
+ * @param first       Index of the first line requested.
+ * @param count       Number of lines requested.
+ * @param out_lines   Where to output the requested lines to.
+ * @param out_count   Where to output the number of lines in @p out_lines to.
+ * @param out_total   Where to output the total number of lines of output to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or the query was cancelled (see
+ *           ::interactive_mode_query_output_t::stopped).
+ */
+int __interactive_mode_query_output_source(void               *source_data,
+                                           size_t              first,
+                                           size_t              count,
+                                           const char *const **out_lines,
+                                           size_t             *out_count,
+                                           size_t             *out_total) {
+    interactive_mode_query_output_t *const output = source_data;
+
+    /* The writer of the previous page is reused, keeping the memory its lines were stored in */
+    const int formatted = query_instance_get_formatted(output->query);
+    if (output->writer) {
+        query_writer_reset(output->writer, formatted);
+        query_writer_set_window(output->writer, first, count);
+    } else {
+        output->writer = query_writer_create_window(formatted, first, count);
+        if (!output->writer)
+            return 1;
+        query_writer_set_measure_formatting(output->writer, 1);
+    }
+
+    if (__interactive_mode_run_query_in_background(output))
+        return 1;
+
+    if (query_writer_is_incomplete(output->writer)) {
+        output->stopped = query_cancellation_has_timed_out(output->cancellation) ? 2 : 1;
+        return 1;
+    }
+
+    *out_lines = query_writer_get_lines(output->writer, out_count);
+    *out_total = query_writer_get_line_count(output->writer);
+    return 0;
+}
+
+/**
+ * @brief   Writes the text of a query to the slow query log.
+ * @details Implementation of ::query_slow_log_text_callback_t.
+ *
+ * @param user_data Text of the query being run.
+ * @param query     Query whose text is to be written. Unused, as only one query is run at a time.
+ * @param out       Where to write the text of @p query to.
+ */
+void __interactive_mode_write_query_text(void                   *user_data,
+                                         const query_instance_t *query,
+                                         FILE                   *out) {
+    (void) query;
+    fputs(user_data, out);
+}
+
 /**
  * @brief Method called when the user chooses to run a query in the main menu.
- * @param database Database to be queried.
+ * @param database         Database to be queried.
+ * @param statistics_cache Cache of query statistics for @p database (can be `NULL`).
+ * @param materializer     Rendered query outputs for @p database (can be `NULL`).
+ * @param load_metrics     Performance of loading @p database (can be `NULL`).
  */
-void __interactive_mode_run_query(const database_t *database) {
+void __interactive_mode_run_query(const database_t            *database,
+                                  query_statistics_cache_t    *statistics_cache,
+                                  query_materializer_t        *materializer,
+                                  const performance_metrics_t *load_metrics) {
     if (!database) {
         activity_messagebox_run("Please load a dataset first!");
         return;
@@ -124,8 +723,16 @@ void __interactive_mode_run_query(const database_t *database) {
             return;
         }
 
-        query_instance_t *const query_parsed = query_instance_create();
-        if (!query_parsed) {
+        query_instance_t *const     query_parsed = query_instance_create();
+        arena_t *const              arguments = arena_create(INTERACTIVE_MODE_ARGUMENTS_ARENA_SIZE);
+        query_cancellation_t *const cancellation = query_cancellation_create();
+        if (!query_parsed || !arguments || !cancellation) {
+            if (query_parsed)
+                query_instance_free(query_parsed);
+            if (arguments)
+                arena_free(arguments);
+            if (cancellation)
+                query_cancellation_free(cancellation);
             free(query_old_str);
 
             /* This may also fail from being out of memory */
@@ -133,33 +740,53 @@ void __interactive_mode_run_query(const database_t *database) {
             return;
         }
 
-        if (query_parser_parse_string_const(query_parsed, query_str, NULL)) {
+        if (query_parser_parse_string_const(query_parsed, query_str, arguments)) {
             free(query_old_str);
             query_old_str = query_str;
 
             query_instance_free(query_parsed);
+            arena_free(arguments);
+            query_cancellation_free(cancellation);
             activity_messagebox_run("Failed to parse query.");
         } else {
-            query_writer_t *const writer =
-                query_writer_create(NULL, query_instance_get_formatted(query_parsed));
-            if (!writer) {
-                activity_messagebox_run("Failed to create writer for query output.");
-            } else {
-                if (query_dispatcher_dispatch_single(database, query_parsed, writer)) {
+            query_slow_log_t *const slow_log = query_slow_log_get_shared();
+            if (slow_log)
+                query_slow_log_set_text_callback(slow_log,
+                                                 __interactive_mode_write_query_text,
+                                                 query_str);
+
+            /* Only the lines in the pages being shown are generated */
+            query_instance_set_cancellation(query_parsed, cancellation);
+            interactive_mode_query_output_t output = {.database         = database,
+                                                      .query            = query_parsed,
+                                                      .statistics_cache = statistics_cache,
+                                                      .materializer     = materializer,
+                                                      .writer           = NULL,
+                                                      .cancellation     = cancellation,
+                                                      .stopped          = 0,
+                                                      .load_metrics     = load_metrics,
+                                                      .overlay_count    = 0};
+            if (activity_paging_run_lazy(__interactive_mode_query_output_source,
+                                         __interactive_mode_query_output_overlay,
+                                         &output,
+                                         query_instance_get_formatted(query_parsed),
+                                         "QUERY OUTPUT (p: performance)")) {
+                if (output.stopped)
+                    activity_messagebox_run(output.stopped == 2 ? "Query timed out."
+                                                                : "Query cancelled.");
+                else
                     activity_messagebox_run("Failed to run query: out of memory!");
-                } else {
-                    size_t                   nlines;
-                    const char *const *const lines = query_writer_get_lines(writer, &nlines);
-                    activity_paging_run(nlines,
-                                        lines,
-                                        query_instance_get_formatted(query_parsed),
-                                        "QUERY OUTPUT");
-                }
-
-                query_writer_free(writer);
             }
 
+            if (slow_log)
+                query_slow_log_set_text_callback(slow_log, NULL, NULL);
+
+            if (output.writer)
+                query_writer_free(output.writer);
+
             query_instance_free(query_parsed);
+            arena_free(arguments);
+            query_cancellation_free(cancellation);
             free(query_old_str);
             free(query_str);
             return;
@@ -173,23 +800,41 @@ int interactive_mode_run(void) {
         return 1;
     }
 
-    database_t *database = NULL;
+    database_t                *database         = NULL;
+    query_statistics_cache_t  *statistics_cache = NULL;
+    query_materializer_t      *materializer     = NULL;
+    performance_metrics_t     *load_metrics     = NULL;
+    interactive_mode_warm_up_t warm_up          = {.running = 0};
     while (1) {
         activity_main_menu_chosen_option_t option = activity_main_menu_run();
 
         switch (option) {
             case ACTIVITY_MAIN_MENU_LOAD_DATASET:
-                __interactive_mode_load_dataset(&database);
+                __interactive_mode_load_dataset(&database,
+                                                &statistics_cache,
+                                                &materializer,
+                                                &warm_up,
+                                                &load_metrics);
                 break;
             case ACTIVITY_MAIN_MENU_RUN_QUERY:
-                __interactive_mode_run_query(database);
+                __interactive_mode_run_query(database,
+                                             statistics_cache,
+                                             materializer,
+                                             load_metrics);
                 break;
             case ACTIVITY_MAIN_MENU_LICENSE:
                 activity_license_run();
                 break;
             case ACTIVITY_MAIN_MENU_LEAVE:
+                __interactive_mode_warm_up_join(&warm_up);
+                if (statistics_cache)
+                    query_statistics_cache_free(statistics_cache);
+                if (materializer)
+                    query_materializer_free(materializer);
                 if (database)
                     database_free(database);
+                if (load_metrics)
+                    performance_metrics_free(load_metrics);
                 return endwin() == ERR;
         }
     }
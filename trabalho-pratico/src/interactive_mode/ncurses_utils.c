@@ -85,7 +85,13 @@ size_t ncurses_measure_unicode_string(const unichar_t *str) {
 }
 
 size_t ncurses_measure_string(const char *str) {
+    /* Fast path for ASCII: printable characters have a width of 1, and control characters of 0 */
     size_t width = 0;
+    while (*str && !((unsigned char) *str & 0x80)) {
+        width += *str >= 0x20 && *str < 0x7F;
+        str++;
+    }
+
     while (*str) {
         width += ncurses_measure_character(g_utf8_get_char(str));
 
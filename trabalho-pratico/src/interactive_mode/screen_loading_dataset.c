@@ -14,46 +14,142 @@
  * limitations under the License.
  */
 
+
 /**
  * @file  screen_loading_dataset.c
  * @brief Implementation of methods in include/interactive_mode/screen_loading_dataset.h
  */
 
-#include <glib.h>
+#include <limits.h>
 #include <ncurses.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "interactive_mode/ncurses_utils.h"
+#include "interactive_mode/screen_loading_dataset.h"
 #include "utils/int_utils.h"
 
-void screen_loading_dataset_render(void) {
-    const char *const message_utf8 = "Loading dataset. The application will become unresponsive.";
-    unichar_t *const  message      = g_utf8_to_ucs4_fast(message_utf8, strlen(message_utf8), NULL);
-    const size_t      text_width   = ncurses_measure_unicode_string(message);
+/** @brief Maximum width of the box with the loading progress. */
+#define SCREEN_LOADING_DATASET_MAX_WIDTH 58
+
+/** @brief Minimum fraction of the dataset to be loaded before an ETA is shown. */
+#define SCREEN_LOADING_DATASET_MIN_ETA_FRACTION 0.01
+
+/**
+ * @brief Prints a line of text in the box of the loading screen, truncating it if needed.
+ *
+ * @param x     Horizontal position of the box's interior.
+ * @param y     Vertical position of the line.
+ * @param width Width of the box's interior.
+ * @param text  ASCII text to be printed.
+ */
+void __screen_loading_dataset_put_line(int x, int y, int width, const char *text) {
+    move(y, x + 1);
+    addnstr(text, max(width - 2, 0));
+}
+
+/**
+ * @brief Formats the text after the progress bar: percentage and estimated time left.
+ *
+ * @param out      Where to write the text to.
+ * @param n        Size of @p out.
+ * @param fraction Fraction of the dataset that has been loaded.
+ * @param elapsed  Time since the load started, in seconds.
+ */
+void __screen_loading_dataset_format_eta(char *out, size_t n, double fraction, double elapsed) {
+    const int percentage = fraction * 100.0;
+    if (fraction < SCREEN_LOADING_DATASET_MIN_ETA_FRACTION || !(fraction < 1.0)) {
+        snprintf(out, n, " %3d%%  ETA --   ", percentage);
+        return;
+    }
+
+    const double left    = elapsed * (1.0 - fraction) / fraction;
+    const int    seconds = left < INT_MAX ? (int) left + 1 : INT_MAX;
+    if (seconds < 60)
+        snprintf(out, n, " %3d%%  ETA %ds", percentage, seconds);
+    else
+        snprintf(out, n, " %3d%%  ETA %dm%02ds", percentage, seconds / 60, seconds % 60);
+}
 
+/**
+ * @brief Renders the progress bar of the loading screen.
+ *
+ * @param x        Horizontal position of the box's interior.
+ * @param y        Vertical position of the progress bar.
+ * @param width    Width of the box's interior.
+ * @param progress Progress of the dataset being loaded.
+ * @param elapsed  Time since the load started, in seconds.
+ */
+void __screen_loading_dataset_render_bar(int                       x,
+                                         int                       y,
+                                         int                       width,
+                                         const dataset_progress_t *progress,
+                                         double                    elapsed) {
+    const double fraction = dataset_progress_get_fraction(progress);
+
+    char eta[32];
+    __screen_loading_dataset_format_eta(eta, sizeof(eta), fraction, elapsed);
+
+    const int bar_width = width - 4 - (int) strlen(eta); /* Margins and brackets */
+    if (bar_width <= 0) {
+        __screen_loading_dataset_put_line(x, y, width, eta + 1);
+        return;
+    }
+
+    const int filled = fraction * bar_width;
+    move(y, x + 1);
+    addch('[');
+    for (int i = 0; i < bar_width; ++i)
+        addch(i < filled ? '#' : '-');
+    addch(']');
+    addnstr(eta, INT_MAX);
+}
+
+void screen_loading_dataset_render(const dataset_progress_t *progress, double elapsed) {
     clear();
 
     int window_width, window_height;
     getmaxyx(stdscr, window_height, window_width);
 
-    if (window_width < 5 || window_height < 7) { /* Don't attempt rendering on small windows */
-        g_free(message);
+    if (window_width < 5 || window_height < 14) { /* Don't attempt rendering on small windows */
+        refresh();
         return;
     }
 
     /* Reference diagram for positions and sizes: see header file */
 
-    const int box_width  = min((size_t) window_width - 4, text_width + 2);
-    const int box_height = 3;
+    const int box_width  = min(window_width - 4, SCREEN_LOADING_DATASET_MAX_WIDTH);
+    const int box_height = 10;
     const int box_x = (window_width - box_width) / 2, box_y = (window_height - box_height) / 2;
 
-    /* Render box and message */
     ncurses_render_rectangle(box_x, box_y, box_width, box_height);
 
-    const size_t max_chars =
-        ncurses_prefix_from_maximum_length(message, max(box_width - 3, 0), NULL);
-    move(box_y + 1, box_x + 1);
-    ncurses_put_wide_string(message, max_chars);
+    __screen_loading_dataset_put_line(box_x,
+                                      box_y + 1,
+                                      box_width,
+                                      dataset_progress_is_cancelled(progress)
+                                          ? "Cancelling. Please wait."
+                                          : "Loading dataset. Press ESC to cancel.");
+
+    __screen_loading_dataset_render_bar(box_x, box_y + 3, box_width, progress, elapsed);
+
+    const char *const files[PERFORMANCE_METRICS_DATASET_STEP_DONE] = {"users.csv",
+                                                                      "flights.csv",
+                                                                      "passengers.csv",
+                                                                      "reservations.csv"};
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i) {
+        const size_t lines    = dataset_progress_get_lines(progress, i);
+        const size_t rejected = dataset_progress_get_rejected(progress, i);
+
+        char line[128];
+        snprintf(line,
+                 sizeof(line),
+                 "%-16s %10zu accepted %9zu rejected",
+                 files[i],
+                 lines > rejected ? lines - rejected : 0,
+                 rejected);
+        __screen_loading_dataset_put_line(box_x, box_y + 5 + i, box_width, line);
+    }
 
     refresh();
-    g_free(message);
 }
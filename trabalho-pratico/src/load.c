@@ -0,0 +1,139 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  load.c
+ * @brief Contains the entry point to the load generator program.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "testing/load_generator.h"
+#include "utils/int_utils.h"
+
+/**
+ * @brief   Parses a positive real number.
+ *
+ * @param output Where to place the parsed number. Nothing will be written on failure.
+ * @param input  String to be parsed.
+ *
+ * @retval 0 Success.
+ * @retval 1 Invalid number.
+ */
+int __load_parse_real(double *output, const char *input) {
+    char        *end;
+    const double parsed = strtod(input, &end);
+    if (end == input || *end || !(parsed > 0 && parsed <= 1e9))
+        return 1;
+
+    *output = parsed;
+    return 0;
+}
+
+/**
+ * @brief   The entry point to the load generator program.
+ * @details Sends the queries in some files to a server, and reports its throughput and latency
+ *          (see [load_generator](@ref load_generator.h)).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure.
+ */
+int main(int argc, char **argv) {
+    load_generator_options_t options = {.socket_path = NULL,
+                                        .connections = 1,
+                                        .rate        = 0,
+                                        .replay      = 0,
+                                        .duration    = 0};
+
+    while (argc > 1 && strncmp(argv[1], "--", 2) == 0) {
+        uint64_t integer;
+        if (strcmp(argv[1], "--replay") == 0) {
+            options.replay = 1;
+            argc--;
+            argv++;
+            continue;
+        } else if (argc > 2 && strcmp(argv[1], "--connections") == 0) {
+            if (int_utils_parse_positive(&integer, argv[2]) || integer == 0 || integer > 4096) {
+                argc = 0; /* Invalid number: print usage */
+                break;
+            }
+            options.connections = integer;
+        } else if (argc > 2 && strcmp(argv[1], "--rate") == 0) {
+            if (__load_parse_real(&options.rate, argv[2])) {
+                argc = 0; /* Invalid number: print usage */
+                break;
+            }
+        } else if (argc > 2 && strcmp(argv[1], "--duration") == 0) {
+            if (__load_parse_real(&options.duration, argv[2])) {
+                argc = 0; /* Invalid number: print usage */
+                break;
+            }
+        } else {
+            argc = 0; /* Unknown or invalid option: print usage */
+            break;
+        }
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc < 3) {
+        fputs("Invalid command-line arguments! Usage:\n", stderr);
+        fputs("./programa-carga [options] [socket path] [query files or request logs]\n\n",
+              stderr);
+        fputs("Options:\n", stderr);
+        fputs("  --connections [n]  Concurrent connections to the server (default: 1)\n", stderr);
+        fputs("  --rate [r]         Requests per second, in an open loop (default: closed loop)\n",
+              stderr);
+        fputs("  --replay           Send requests at the times in the request logs\n", stderr);
+        fputs("  --duration [s]     Seconds to repeat the requests for (default: send once)\n",
+              stderr);
+        return 1;
+    }
+
+    options.socket_path = argv[1];
+
+    load_generator_workload_t *const workload = load_generator_workload_create();
+    if (!workload) {
+        fputs("Allocation failure!\n", stderr);
+        return 1;
+    }
+
+    int retval = 1;
+    for (int i = 2; i < argc; ++i) {
+        if (load_generator_workload_add_file(workload, argv[i])) {
+            fprintf(stderr, "Failed to read \"%s\"!\n", argv[i]);
+            goto DEFER_1;
+        }
+    }
+
+    if (load_generator_workload_get_length(workload) == 0) {
+        fputs("No requests to be sent!\n", stderr);
+        goto DEFER_1;
+    } else if (options.replay && !load_generator_workload_is_timed(workload)) {
+        fputs("Only request logs, where every request has a timestamp, can be replayed!\n",
+              stderr);
+        goto DEFER_1;
+    }
+
+    retval = load_generator_run(workload, &options, stdout);
+
+DEFER_1:
+    load_generator_workload_free(workload);
+    return retval;
+}
@@ -18,28 +18,349 @@
  * @file  main.c
  * @brief Contains the entry point to main the program.
  */
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "batch_mode.h"
 #include "interactive_mode/interactive_mode.h"
+#include "queries/query_explain.h"
+#include "queries/query_output_compressor.h"
+#include "queries/query_output_pack.h"
+#include "queries/query_parser.h"
+#include "queries/query_slow_log.h"
+#include "queries/query_type.h"
+#include "server_mode.h"
+#include "testing/performance_trace.h"
+#include "utils/thread_pool.h"
 
 /**
- * @brief  The entry point to the main program.
+ * @brief Writes all query outputs in a pack to a directory, one file per query.
+ *
+ * @param pack_path Path to the pack file.
+ * @param directory Existing directory where to create the output files.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure. A message will also be printed to `stderr`.
+ */
+int __main_extract(const char *pack_path, const char *directory) {
+    query_output_pack_reader_t *const pack = query_output_pack_reader_open(pack_path);
+    if (!pack) {
+        fputs("Failed to open pack of query outputs!\n", stderr);
+        return 1;
+    }
+
+    const int retval = query_output_pack_reader_extract(pack, directory);
+    if (retval)
+        fputs("Failed to extract query outputs!\n", stderr);
+
+    query_output_pack_reader_close(pack);
+    return retval;
+}
+
+/**
+ * @brief   Opens the slow query log used by all modes, for `--slow-log [path] [threshold ms]`.
+ * @details Replaces any log opened before.
+ *
+ * @param path      Path to the log file.
+ * @param threshold Minimum duration of the queries to be logged, in milliseconds, as a string.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure. A message will also be printed to `stderr`.
+ */
+int __main_open_slow_log(const char *path, const char *threshold) {
+    char      *end;
+    const long milliseconds = strtol(threshold, &end, 10);
+    if (*threshold == '\0' || *end != '\0' || milliseconds < 0) {
+        fputs("Invalid slow query threshold!\n", stderr);
+        return 1;
+    }
+
+    query_slow_log_t *const log = query_slow_log_create(path, (uint64_t) milliseconds * 1000);
+    if (!log) {
+        fputs("Failed to open slow query log!\n", stderr);
+        return 1;
+    }
+
+    query_slow_log_free(query_slow_log_get_shared());
+    query_slow_log_set_shared(log);
+    return 0;
+}
+
+/**
+ * @brief   Opens the report of how queries were executed used by all modes, for
+ *          `--explain [path]`.
+ * @details Replaces any report opened before. Every query is explained in it.
+ *
+ * @param path Path to the report file.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure. A message will also be printed to `stderr`.
+ */
+int __main_open_explain(const char *path) {
+    query_explain_t *const explain = query_explain_create(path, 1);
+    if (!explain) {
+        fputs("Failed to open query explanation report!\n", stderr);
+        return 1;
+    }
+
+    query_explain_free(query_explain_get_shared());
+    query_explain_set_shared(explain);
+    return 0;
+}
+
+/**
+ * @brief   Creates the compressor of the output files of batch mode, for `--compress` and
+ *          `--compress-dictionary [path]`.
+ * @details Replaces any compressor created before.
+ *
+ * @param dictionary_path Path to a zstd dictionary, or `NULL` to compress without one.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure. A message will also be printed to `stderr`.
+ */
+int __main_open_compressor(const char *dictionary_path) {
+    query_output_compressor_t *const compressor = query_output_compressor_create(dictionary_path);
+    if (!compressor) {
+        fputs("Failed to create output compressor (the program may have been built without "
+              "zstd)!\n",
+              stderr);
+        return 1;
+    }
+
+    query_output_compressor_free(query_output_compressor_get_shared());
+    query_output_compressor_set_shared(compressor);
+    return 0;
+}
+
+/**
+ * @brief Runs the mode chosen by the command-line arguments, after the options that can precede
+ *        any mode.
+ *
+ * @param argc Number of arguments, including the program's name.
+ * @param argv Arguments, including the program's name.
+ *
  * @retval 0 Success.
  * @retval 1 Insuccess.
  */
-int main(int argc, char **argv) {
+int __main_run_mode(int argc, char **argv) {
     if (argc == 1) {
         return interactive_mode_run();
     } else if (argc == 3) {
         return batch_mode_run(argv[1], argv[2], NULL);
+    } else if (argc == 4 && strcmp(argv[1], "--server") == 0) {
+        return server_mode_run(argv[2], argv[3], 0);
+    } else if (argc == 4 && strcmp(argv[1], "--packed") == 0) {
+        return batch_mode_run_packed(argv[2], argv[3], NULL);
+    } else if (argc == 4 && strcmp(argv[1], "--extract") == 0) {
+        return __main_extract(argv[2], argv[3]);
+    } else if (argc == 5 && strcmp(argv[1], "--workers") == 0) {
+        char      *end;
+        const long nworkers = strtol(argv[2], &end, 10);
+        if (*argv[2] == '\0' || *end != '\0' || nworkers < 1) {
+            fputs("Invalid number of workers!\n", stderr);
+            return 1;
+        }
+        return batch_mode_run_workers(argv[3], argv[4], (size_t) nworkers);
+    } else if (argc == 5 && strcmp(argv[1], "--partitions") == 0) {
+        char      *end;
+        const long npartitions = strtol(argv[2], &end, 10);
+        if (*argv[2] == '\0' || *end != '\0' || npartitions < 1) {
+            fputs("Invalid number of partitions!\n", stderr);
+            return 1;
+        }
+        return batch_mode_run_partitioned(argv[3], argv[4], (size_t) npartitions);
+    } else if (argc == 5 && strcmp(argv[1], "--server") == 0) {
+        char      *end;
+        const long window = strtol(argv[4], &end, 10);
+        if (*argv[4] == '\0' || *end != '\0' || window < 0 || window > INT_MAX) {
+            fputs("Invalid batching window!\n", stderr);
+            return 1;
+        }
+        return server_mode_run(argv[2], argv[3], (unsigned int) window);
+    } else if (argc == 5 && strcmp(argv[1], "--replica") == 0) {
+        return server_mode_run_replica(argv[2], argv[3], argv[4], 0);
+    } else if (argc == 5 && strcmp(argv[1], "--window") == 0) {
+        char      *end;
+        const long window = strtol(argv[2], &end, 10);
+        if (*argv[2] == '\0' || *end != '\0' || window < 1) {
+            fputs("Invalid window size!\n", stderr);
+            return 1;
+        }
+        return batch_mode_run_windowed(argv[3], argv[4], (size_t) window, NULL);
     } else {
         fputs("Invalid command-line arguments! Usage:\n\n", stderr);
         fputs("./programa-principal - Interactive mode\n", stderr);
         fputs("./programa-principal [dataset] [query file] - Batch mode\n", stderr);
+        fputs("./programa-principal --server [dataset] [socket path] [window ms] - Server mode, "
+              "optionally waiting for more queries before running each batch. [dataset] can be "
+              "a list of datasets, name=path,name=path\n",
+              stderr);
+        fputs("./programa-principal --replica [primary socket] [directory] [socket path] - "
+              "Server mode, answering queries with the snapshot of another server\n",
+              stderr);
+        fputs("./programa-principal --packed [dataset] [query file] - Batch mode, writing all "
+              "outputs to " BATCH_MODE_PACK_PATH "\n",
+              stderr);
+        fputs("./programa-principal --extract [pack] [directory] - Write the outputs in a pack to "
+              "one file per query\n",
+              stderr);
+        fputs("./programa-principal --workers [N] [dataset] [query file] - Batch mode with N "
+              "worker processes\n",
+              stderr);
+        fputs("./programa-principal --partitions [N] [dataset] [query file] - Batch mode with "
+              "the dataset split among N processes\n",
+              stderr);
+        fputs("./programa-principal --window [N] [dataset] [query file] - Batch mode, running N "
+              "queries at a time\n",
+              stderr);
+        fputs("\nAny mode can be preceded by --threads [N], to use N threads (default: "
+              THREAD_POOL_ENVIRONMENT_VARIABLE " or the number of processors)\n",
+              stderr);
+        fputs("Any mode can be preceded by --stage-threads [load=N,queries=N], to limit the "
+              "threads of each stage (default: " THREAD_POOL_STAGE_THREADS_ENVIRONMENT_VARIABLE
+              ")\n",
+              stderr);
+        fputs("Any mode can be preceded by --cpus [list], to only run on some CPUs, such as 0-3,8 "
+              "(default: " THREAD_POOL_CPUS_ENVIRONMENT_VARIABLE " or all CPUs)\n",
+              stderr);
+        fputs("Any mode can be preceded by --pin, to pin each thread to a CPU (default: unpinned, "
+              "unless " THREAD_POOL_PIN_ENVIRONMENT_VARIABLE "=1)\n",
+              stderr);
+        fputs("Any mode can be preceded by --approximate, for approximate results in queries 7 "
+              "and 10 (default: exact, unless " QUERY_TYPE_APPROXIMATE_ENVIRONMENT_VARIABLE "=1)\n",
+              stderr);
+        fputs("Any mode can be preceded by --slow-log [path] [threshold ms], to log the queries "
+              "slower than the threshold, with the time spent in each phase\n",
+              stderr);
+        fputs("Any mode can be preceded by --explain [path], to report the access path and the "
+              "records touched by every query (queries preceded by " QUERY_PARSER_EXPLAIN_PREFIX
+              " are reported to stderr otherwise)\n",
+              stderr);
+        fputs("Any mode can be preceded by --trace [path], to write a timeline of what each thread "
+              "did to a Chrome trace file when the program exits\n",
+              stderr);
+        fputs("Batch modes can be preceded by --compress or --compress-dictionary [path], to write "
+              "outputs compressed with zstd (with a trained dictionary, in the latter case)\n",
+              stderr);
         return 1;
     }
 
     return 0;
 }
+
+/**
+ * @brief   The entry point to the main program.
+ * @details `--threads [N]` can precede any other arguments, to choose how many threads parallel
+ *          parts of the program use (see ::thread_pool_set_default_thread_count), and so can
+ *          `--stage-threads [list]`, `--cpus [list]` and `--pin`, to limit the threads of each
+ *          stage (see ::thread_pool_set_stage_thread_counts), the CPUs the program runs on (see
+ *          ::thread_pool_set_cpus), and to pin threads to a CPU each (see
+ *          ::thread_pool_set_pinning). `--approximate`
+ *          can also precede them, for queries to generate approximate statistical data (see
+ *          ::query_type_set_approximate), and so can `--slow-log [path] [threshold ms]`, for
+ *          queries slower than the threshold to be logged (see ::query_slow_log_set_shared), and
+ *          `--explain [path]`, for how every query was executed to be reported (see
+ *          ::query_explain_set_shared). `--compress` and `--compress-dictionary [path]` make batch
+ *          modes compress their output files (see ::query_output_compressor_set_shared).
+ *          `--trace [path]` can also precede them, for a timeline to be written (see
+ *          ::performance_trace_start).
+ *
+ * @retval 0 Success.
+ * @retval 1 Insuccess.
+ */
+int main(int argc, char **argv) {
+    int         retval     = 1;
+    const char *trace_path = NULL;
+    while (argc > 1) {
+        if (argc > 2 && strcmp(argv[1], "--threads") == 0) {
+            char      *end;
+            const long nthreads = strtol(argv[2], &end, 10);
+            if (*argv[2] == '\0' || *end != '\0' || nthreads < 1) {
+                fputs("Invalid number of threads!\n", stderr);
+                goto DEFER_1;
+            }
+
+            thread_pool_set_default_thread_count((size_t) nthreads);
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--stage-threads") == 0) {
+            if (thread_pool_set_stage_thread_counts(argv[2])) {
+                fputs("Invalid number of threads per stage!\n", stderr);
+                goto DEFER_1;
+            }
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--cpus") == 0) {
+            if (thread_pool_set_cpus(argv[2])) {
+                fputs("Invalid set of CPUs!\n", stderr);
+                goto DEFER_1;
+            }
+            argc -= 2;
+            argv += 2;
+        } else if (strcmp(argv[1], "--pin") == 0) {
+            thread_pool_set_pinning(1);
+            argc--;
+            argv++;
+        } else if (strcmp(argv[1], "--approximate") == 0) {
+            query_type_set_approximate(1);
+            argc--;
+            argv++;
+        } else if (argc > 3 && strcmp(argv[1], "--slow-log") == 0) {
+            if (__main_open_slow_log(argv[2], argv[3]))
+                goto DEFER_1;
+            argc -= 3;
+            argv += 3;
+        } else if (argc > 2 && strcmp(argv[1], "--explain") == 0) {
+            if (__main_open_explain(argv[2]))
+                goto DEFER_1;
+            argc -= 2;
+            argv += 2;
+        } else if (strcmp(argv[1], "--compress") == 0) {
+            if (__main_open_compressor(NULL))
+                goto DEFER_1;
+            argc--;
+            argv++;
+        } else if (argc > 2 && strcmp(argv[1], "--compress-dictionary") == 0) {
+            if (__main_open_compressor(argv[2]))
+                goto DEFER_1;
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--trace") == 0) {
+            trace_path = argv[2];
+            performance_trace_start();
+            argc -= 2;
+            argv += 2;
+        } else {
+            break;
+        }
+    }
+
+    retval = __main_run_mode(argc, argv);
+
+    /* The dictionary is needed to read the outputs (see test_diff.c) */
+    query_output_compressor_t *const compressor = query_output_compressor_get_shared();
+    size_t                           compressed_files;
+    if (compressor) {
+        query_output_compressor_print_statistics(stderr, compressor);
+        query_output_compressor_get_statistics(compressor, &compressed_files, NULL, NULL, NULL);
+        if (compressed_files && query_output_compressor_save_dictionary(compressor, "Resultados")) {
+            fputs("Failed to save compression dictionary!\n", stderr);
+            retval = 1;
+        }
+    }
+
+DEFER_1:
+    if (trace_path && performance_trace_stop(trace_path)) {
+        fputs("Failed to write trace!\n", stderr);
+        retval = 1;
+    }
+    query_slow_log_free(query_slow_log_get_shared());
+    query_slow_log_set_shared(NULL);
+    query_explain_free(query_explain_get_shared());
+    query_explain_set_shared(NULL);
+    query_output_compressor_free(query_output_compressor_get_shared());
+    query_output_compressor_set_shared(NULL);
+    return retval;
+}
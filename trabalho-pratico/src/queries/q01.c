@@ -50,98 +50,35 @@ typedef struct {
  * @brief   Parses the arguments of a query of type 1.
  * @details Asserts there's only one argument, the identifier of a user, flight or reservation.
  *
- * @param argc Number of arguments.
- * @param argv Values of the arguments.
+ * @param argc      Number of arguments.
+ * @param argv      Values of the arguments.
+ * @param allocator Arena where to allocate the parsed arguments.
  *
  * @return `NULL` for invalid arguments (or allocation failure), a pointer to a valid
  *         ::q01_parsed_arguments_t on success.
  */
-void *__q01_parse_arguments(size_t argc, char *const argv[argc]) {
+void *__q01_parse_arguments(size_t argc, char *const argv[argc], arena_t *allocator) {
     if (argc != 1)
         return NULL;
 
-    flight_id_t                   parsed_flight_id;
-    reservation_id_t              parsed_reservation_id;
-    q01_parsed_arguments_t *const parsed_argument = malloc(sizeof(q01_parsed_arguments_t));
-    if (!parsed_argument)
-        return NULL;
+    flight_id_t            parsed_flight_id;
+    reservation_id_t       parsed_reservation_id;
+    q01_parsed_arguments_t parsed_argument;
 
     if (!flight_id_from_string(&parsed_flight_id, *argv)) {
-        parsed_argument->id_entity = ID_ENTITY_FLIGHT;
-        parsed_argument->parsed_id = (void *) (size_t) parsed_flight_id;
+        parsed_argument.id_entity = ID_ENTITY_FLIGHT;
+        parsed_argument.parsed_id = (void *) (size_t) parsed_flight_id;
     } else if (!reservation_id_from_string(&parsed_reservation_id, *argv)) {
-        parsed_argument->id_entity = ID_ENTITY_RESERVATION;
-        parsed_argument->parsed_id = (void *) (size_t) parsed_reservation_id;
+        parsed_argument.id_entity = ID_ENTITY_RESERVATION;
+        parsed_argument.parsed_id = (void *) (size_t) parsed_reservation_id;
     } else {
-        parsed_argument->parsed_id = strdup(*argv);
-        if (!parsed_argument->parsed_id) {
-            free(parsed_argument);
+        parsed_argument.parsed_id = arena_put_string(allocator, *argv);
+        if (!parsed_argument.parsed_id)
             return NULL;
-        }
-        parsed_argument->id_entity = ID_ENTITY_USER;
-    }
-
-    return parsed_argument;
-}
-
-/**
- * @brief  Creates a deep clone of the value returned by ::__q01_parse_arguments.
- * @param  args_data Non-`NULL` value returned by ::__q01_parse_arguments (a pointer to a
- *                   ::q01_parsed_arguments_t).
- * @return A deep copy of @p args_data.
- */
-void *__q01_clone_arguments(const void *args_data) {
-    const q01_parsed_arguments_t *const args  = args_data;
-    q01_parsed_arguments_t *const       clone = malloc(sizeof(q01_parsed_arguments_t));
-    if (!clone)
-        return NULL;
-
-    clone->id_entity = args->id_entity;
-    switch (args->id_entity) {
-        case ID_ENTITY_FLIGHT:
-        case ID_ENTITY_RESERVATION:
-            clone->parsed_id = args->parsed_id;
-            break;
-        case ID_ENTITY_USER:
-            clone->parsed_id = strdup(args->parsed_id);
-            if (!clone->parsed_id) {
-                free(clone);
-                return NULL;
-            }
-            break;
+        parsed_argument.id_entity = ID_ENTITY_USER;
     }
-    return clone;
-}
-
-/**
- * @brief Frees data generated by ::__q01_parse_arguments.
- * @param args_data Data generated by ::__q01_parse_arguments.
- */
-void __q01_free_arguments(void *args_data) {
-    q01_parsed_arguments_t *const args = args_data;
-    if (args->id_entity == ID_ENTITY_USER)
-        free(args->parsed_id);
-    free(args);
-}
 
-/**
- * @brief   Calculates the total money spent by a ::user_t.
- *
- * @param list    List to get the reservation identifiers from.
- * @param manager Manager to get the reservations from.
- *
- * @return The sum of the total price of all the reservations a user booked.
- */
-double __q01_calculate_user_total_spent(const single_pool_id_linked_list_t *list,
-                                        const reservation_manager_t        *manager) {
-    double total_spent = 0.0;
-    while (list) {
-        const reservation_t *const reservation =
-            reservation_manager_get_by_id(manager, single_pool_id_linked_list_get_value(list));
-        total_spent += reservation_calculate_price(reservation);
-        list = single_pool_id_linked_list_get_next(list);
-    }
-    return total_spent;
+    return arena_put(allocator, &parsed_argument, sizeof(q01_parsed_arguments_t));
 }
 
 /**
@@ -152,20 +89,18 @@ double __q01_calculate_user_total_spent(const single_pool_id_linked_list_t *list
  * @param output   Where to write the query's output to.
  */
 void __q01_execute_user_entity(const database_t *database, const char *id, query_writer_t *output) {
-    const user_manager_t *const        user_manager        = database_get_users(database);
-    const reservation_manager_t *const reservation_manager = database_get_reservations(database);
-    const user_t *const                user = user_manager_get_by_id(user_manager, id);
-    if (!user || user_get_account_status(user) == ACCOUNT_STATUS_INACTIVE)
+    const user_manager_t *const user_manager = database_get_users(database);
+
+    uint32_t user_index;
+    if (user_manager_get_index_by_id_filtered(user_manager, id, &user_index) ||
+        !user_manager_is_active_by_index(user_manager, user_index))
         return;
 
-    const size_t number_of_flights =
-        single_pool_id_linked_list_length(user_manager_get_flights_by_id(user_manager, id));
+    const user_t *const user = user_manager_get_by_index(user_manager, user_index);
 
-    const single_pool_id_linked_list_t *const reservation_list =
-        user_manager_get_reservations_by_id(user_manager, id);
-    const size_t number_of_reservations = single_pool_id_linked_list_length(reservation_list);
-    const double total_spent =
-        __q01_calculate_user_total_spent(reservation_list, reservation_manager);
+    /* Precomputed when the database was frozen */
+    const user_manager_user_aggregates_t aggregates =
+        user_manager_get_aggregates_by_index(user_manager, user_index);
 
     char sex[SEX_SPRINTF_MIN_BUFFER_SIZE];
     sex_sprintf(sex, user_get_sex(user));
@@ -181,9 +116,16 @@ void __q01_execute_user_entity(const database_t *database, const char *id, query
     query_writer_write_new_field(output, "age", "%" PRIi32, age);
     query_writer_write_new_field(output, "country_code", "%s", country_code);
     query_writer_write_new_field(output, "passport", "%s", user_get_const_passport(user));
-    query_writer_write_new_field(output, "number_of_flights", "%zu", number_of_flights);
-    query_writer_write_new_field(output, "number_of_reservations", "%zu", number_of_reservations);
-    query_writer_write_new_field(output, "total_spent", "%.3lf", total_spent);
+    query_writer_write_new_field(output, "number_of_flights", "%zu", aggregates.number_of_flights);
+    query_writer_write_new_field(output,
+                                 "number_of_reservations",
+                                 "%zu",
+                                 aggregates.number_of_reservations);
+    query_writer_write_new_field(output,
+                                 "total_spent",
+                                 RESERVATION_PRICE_FORMAT,
+                                 aggregates.total_spent_cents / 100,
+                                 aggregates.total_spent_cents % 100);
 }
 
 /**
@@ -197,7 +139,7 @@ void __q01_execute_reservation_entity(const database_t *database,
                                       reservation_id_t  id,
                                       query_writer_t   *output) {
     const reservation_t *const reservation =
-        reservation_manager_get_by_id(database_get_reservations(database), id);
+        reservation_manager_get_by_id_filtered(database_get_reservations(database), id);
     if (!reservation)
         return;
 
@@ -213,8 +155,8 @@ void __q01_execute_reservation_entity(const database_t *database,
     char                       includes_breakfast_str[INCLUDES_BREAKFAST_SPRINTF_MIN_BUFFER_SIZE];
     includes_breakfast_sprintf(includes_breakfast_str, includes_breakfast);
 
-    const int64_t nights      = date_diff(end_date, begin_date);
-    const double  total_price = reservation_calculate_price(reservation);
+    const int64_t  nights      = date_diff(end_date, begin_date);
+    const uint64_t total_price = reservation_calculate_price_cents(reservation);
 
     char hotel_id_str[HOTEL_ID_SPRINTF_MIN_BUFFER_SIZE];
     hotel_id_sprintf(hotel_id_str, reservation_get_hotel_id(reservation));
@@ -233,7 +175,11 @@ void __q01_execute_reservation_entity(const database_t *database,
     query_writer_write_new_field(output, "end_date", "%s", end_date_str);
     query_writer_write_new_field(output, "includes_breakfast", "%s", includes_breakfast_str);
     query_writer_write_new_field(output, "nights", "%" PRIi64, nights);
-    query_writer_write_new_field(output, "total_price", "%.3lf", total_price);
+    query_writer_write_new_field(output,
+                                 "total_price",
+                                 RESERVATION_PRICE_FORMAT,
+                                 total_price / 100,
+                                 total_price % 100);
 }
 
 /**
@@ -248,7 +194,7 @@ void __q01_execute_flight_entity(const database_t *database,
                                  query_writer_t   *output) {
 
     const flight_manager_t *const flight_manager = database_get_flights(database);
-    const flight_t *const         flight         = flight_manager_get_by_id(flight_manager, id);
+    const flight_t *const flight = flight_manager_get_by_id_filtered(flight_manager, id);
     if (!flight)
         return;
 
@@ -282,20 +228,10 @@ void __q01_execute_flight_entity(const database_t *database,
     query_writer_write_new_field(output, "delay", "%" PRIi64, delay);
 }
 
-/**
- * @brief Executes a query of type 1.
- *
- * @param database   Database where to get users / reservations / flights from
- * @param statistics `NULL`, as this query does not generate statistical data.
- * @param instance   Query instance to be executed.
- * @param output     Where to write the query's output to.
- *
- * @retval 0 Always successful.
- */
-int __q01_execute(const database_t       *database,
-                  const void             *statistics,
-                  const query_instance_t *instance,
-                  query_writer_t         *output) {
+int q01_execute(const database_t       *database,
+                const void             *statistics,
+                const query_instance_t *instance,
+                query_writer_t         *output) {
     (void) statistics;
 
     const q01_parsed_arguments_t *const arguments = query_instance_get_argument_data(instance);
@@ -315,12 +251,41 @@ int __q01_execute(const database_t       *database,
     return 0;
 }
 
+/**
+ * @brief   Gets the partition of a database a query of type 1 is sent to.
+ * @details Users are sent to their own partition. Flights are replicated in every partition, so
+ *          they're spread among all of them. The user of a reservation isn't known before looking
+ *          the reservation up, so the query is sent to all partitions, and only the partition that
+ *          has the reservation outputs anything.
+ *
+ * @param argument_data Arguments of the query (a ::q01_parsed_arguments_t).
+ * @param npartitions   Number of partitions.
+ *
+ * @return The partition to send the query to, or ::QUERY_TYPE_PARTITION_ALL.
+ */
+size_t __q01_partition(const void *argument_data, size_t npartitions) {
+    const q01_parsed_arguments_t *const arguments = argument_data;
+
+    switch (arguments->id_entity) {
+        case ID_ENTITY_USER:
+            return database_get_user_partition(arguments->parsed_id, npartitions);
+        case ID_ENTITY_FLIGHT:
+            return (size_t) arguments->parsed_id % npartitions;
+        default:
+            return QUERY_TYPE_PARTITION_ALL;
+    }
+}
+
 query_type_t *q01_create(void) {
     return query_type_create(1,
                              __q01_parse_arguments,
-                             __q01_clone_arguments,
-                             __q01_free_arguments,
                              NULL,
                              NULL,
-                             __q01_execute);
+                             NULL,
+                             q01_execute,
+                             NULL,
+                             NULL,
+                             NULL,
+                             __q01_partition,
+                             NULL);
 }
@@ -19,7 +19,7 @@
  * @brief Implementation of methods in include/queries/q02.h
  */
 
-#include <glib.h>
+#include <string.h>
 
 #include "queries/q02.h"
 #include "queries/query_instance.h"
@@ -50,225 +50,171 @@ typedef struct {
  * @details The first argument, a user identifier, is mandatory. A optional second argument, taking
  *          the value of either `"flights"` or `"reservations"`, is allowed.
  *
- * @param argc Number of arguments.
- * @param argv Values of the arguments.
+ * @param argc      Number of arguments.
+ * @param argv      Values of the arguments.
+ * @param allocator Arena where to allocate the parsed arguments.
  *
  * @return `NULL` on failure (parsing or allocation), a pointer to a `q02_argument_data_t`
  *         otherwise.
  */
-void *__q02_parse_arguments(size_t argc, char *const argv[argc]) {
+void *__q02_parse_arguments(size_t argc, char *const argv[argc], arena_t *allocator) {
+    q02_argument_data_t parsed;
     if (argc == 1) {
-        q02_argument_data_t *const ret = malloc(sizeof(q02_argument_data_t));
-        ret->user_id                   = strdup(argv[0]);
-        ret->filter                    = Q02_ARGUMENTS_NO_ARGUMENT;
-        return ret;
+        parsed.filter = Q02_ARGUMENTS_NO_ARGUMENT;
     } else if (argc == 2) {
-        q02_arguments_output_filter_t filter;
-
         if (strcmp(argv[1], "flights") == 0)
-            filter = Q02_ARGUMENTS_FLIGHTS;
+            parsed.filter = Q02_ARGUMENTS_FLIGHTS;
         else if (strcmp(argv[1], "reservations") == 0)
-            filter = Q02_ARGUMENTS_RESERVATIONS;
+            parsed.filter = Q02_ARGUMENTS_RESERVATIONS;
         else
             return NULL;
-
-        q02_argument_data_t *const ret = malloc(sizeof(q02_argument_data_t));
-        ret->user_id                   = strdup(argv[0]);
-        ret->filter                    = filter;
-        return ret;
-    }
-
-    return NULL;
-}
-
-/**
- * @brief  Creates a deep clone of the value returned by ::__q02_parse_arguments.
- * @param  args_data Non-`NULL` value returned by ::__q02_parse_arguments (a pointer to a
- *                   ::q02_argument_data_t).
- * @return A deep copy of @p args_data.
- */
-void *__q02_clone_arguments(const void *args_data) {
-    const q02_argument_data_t *const args  = args_data;
-    q02_argument_data_t *const       clone = malloc(sizeof(q02_argument_data_t));
-    if (!clone)
-        return NULL;
-
-    clone->user_id = strdup(args->user_id);
-    if (!clone->user_id) {
-        free(clone);
+    } else {
         return NULL;
     }
-    clone->filter = args->filter;
-    return clone;
-}
 
-/**
- * @brief Frees data generated by ::__q02_parse_arguments.
- * @param args_data Data generated by ::__q02_parse_arguments.
- */
-void __q02_free_arguments(void *args_data) {
-    free(((q02_argument_data_t *) args_data)->user_id);
-    free(args_data);
+    parsed.user_id = arena_put_string(allocator, argv[0]);
+    if (!parsed.user_id)
+        return NULL;
+    return arena_put(allocator, &parsed, sizeof(q02_argument_data_t));
 }
 
 /**
- * @struct q02_output_item_t
- * @brief  One item of this query's output (a flight or reservation).
+ * @brief Prints a flight or a reservation in the output of a query of type 2.
  *
- * @var q02_output_item_t::id
- *     @brief Identifier of the object in question (flight or reservation).
- * @var q02_output_item_t::date
- *     @brief Date and time the object in question happened in.
- * @var q02_output_item_t::type
- *     @brief Type of the object in question (flight or reservation).
+ * @param output    Where to output the query's results to.
+ * @param id        Identifier of the flight or reservation.
+ * @param date      Date of the flight or reservation.
+ * @param is_flight Whether @p id is a flight (or a reservation).
+ * @param filter    Whether the query requested flights, reservations or both.
  */
-typedef struct {
-    const uint32_t        id;
-    const date_and_time_t date;
+void __q02_print_item(query_writer_t               *output,
+                      uint32_t                      id,
+                      date_and_time_t               date,
+                      int                           is_flight,
+                      q02_arguments_output_filter_t filter) {
+
+    char date_string[DATE_SPRINTF_MIN_BUFFER_SIZE];
+    date_sprintf(date_string, date_and_time_get_date(date));
+
+    char id_string[RESERVATION_ID_SPRINTF_MIN_BUFFER_SIZE > FLIGHT_ID_SPRINTF_MIN_BUFFER_SIZE
+                       ? RESERVATION_ID_SPRINTF_MIN_BUFFER_SIZE
+                       : FLIGHT_ID_SPRINTF_MIN_BUFFER_SIZE];
+    if (is_flight)
+        flight_id_sprintf(id_string, id);
+    else
+        reservation_id_sprintf(id_string, id);
+
+    query_writer_write_new_object(output);
+    query_writer_write_new_field(output, "id", "%s", id_string);
+    query_writer_write_new_field(output, "date", "%s", date_string);
+
+    if (filter == Q02_ARGUMENTS_NO_ARGUMENT)
+        query_writer_write_new_field(output, "type", is_flight ? "flight" : "reservation");
+}
 
-    const enum {
-        Q02_OUTPUT_ITEM_FLIGHT,     /**< This output item is a flight. */
-        Q02_OUTPUT_ITEM_RESERVATION /**< This output item is a reservation. */
-    } type;
-} q02_output_item_t;
+int q02_execute(const database_t       *database,
+                const void             *statistics,
+                const query_instance_t *instance,
+                query_writer_t         *output) {
+    (void) statistics;
+    const q02_argument_data_t *const args  = query_instance_get_argument_data(instance);
+    const user_manager_t *const      users = database_get_users(database);
 
-/**
- * @brief   Comparison function for sorting the output of query 2.
- * @details Auxiliary function for ::__q02_execute.
- */
-gint __q02_execute_sort_compare(gconstpointer a_data, gconstpointer b_data) {
-    const q02_output_item_t *const a = a_data;
-    const q02_output_item_t *const b = b_data;
+    uint32_t user_index;
+    if (user_manager_get_index_by_id_filtered(users, args->user_id, &user_index) ||
+        !user_manager_is_active_by_index(users, user_index))
+        return 0;
 
-    const int64_t crit1 = date_and_time_diff(b->date, a->date);
-    if (crit1)
-        return crit1;
+    const user_manager_id_span_t empty   = {.ids = NULL, .dates = NULL, .length = 0};
+    const user_manager_id_span_t flights = args->filter == Q02_ARGUMENTS_RESERVATIONS
+                                               ? empty
+                                               : user_manager_get_flights_by_index(users,
+                                                                                   user_index);
+    const user_manager_id_span_t reservations =
+        args->filter == Q02_ARGUMENTS_FLIGHTS
+            ? empty
+            : user_manager_get_reservations_by_index(users, user_index);
+
+    /* Both spans are sorted by descending date and ascending identifier */
+    size_t f = 0, r = 0;
+    while (f < flights.length || r < reservations.length) {
+        if ((f + r + 1) % QUERY_CANCELLATION_CHECK_INTERVAL == 0 &&
+            query_instance_is_cancelled(instance))
+            return 0; /* Incomplete output, marked by the dispatcher */
+
+        int take_flight;
+        if (r == reservations.length)
+            take_flight = 1;
+        else if (f == flights.length)
+            take_flight = 0;
+        else if (flights.dates[f] != reservations.dates[r])
+            take_flight = flights.dates[f] > reservations.dates[r];
+        else
+            take_flight = flights.ids[f] < reservations.ids[r];
+
+        if (take_flight) {
+            __q02_print_item(output, flights.ids[f], flights.dates[f], 1, args->filter);
+            f++;
+        } else {
+            __q02_print_item(output, reservations.ids[r], reservations.dates[r], 0, args->filter);
+            r++;
+        }
+    }
 
-    const int64_t crit2 = (int32_t) a->id - (int32_t) b->id;
-    return crit2;
+    return 0;
 }
 
 /**
- * @brief Prints the output of a query of type 2 to an @p output writer.
+ * @brief   Gets the entity a query of type 2 is about.
+ * @details The entity is the user's index in the user manager, and the variant is the output
+ *          filter.
  *
- * @param output    Where to output the query's results to.
- * @param items     Array of ::q02_output_item_t, to be written as text.
- * @param filter    Whether the query requested flights, reservations or both.
+ * @param database      Database the query will be executed on.
+ * @param argument_data Arguments of the query (a ::q02_argument_data_t).
+ * @param out_key       Where to write the key of the query's output to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Unknown or inactive user (nothing is outputted).
  */
-void __q02_print_output(query_writer_t               *output,
-                        GArray                       *items,
-                        q02_arguments_output_filter_t filter) {
-
-    for (size_t i = 0; i < items->len; ++i) {
-        const q02_output_item_t *const item = &g_array_index(items, q02_output_item_t, i);
-
-        char date_string[DATE_SPRINTF_MIN_BUFFER_SIZE];
-        date_sprintf(date_string, date_and_time_get_date(item->date));
-
-        char flight_id_str[FLIGHT_ID_SPRINTF_MIN_BUFFER_SIZE];
-        char reservation_id_str[RESERVATION_ID_SPRINTF_MIN_BUFFER_SIZE];
-
-        query_writer_write_new_object(output);
-        switch (item->type) {
-            case Q02_OUTPUT_ITEM_FLIGHT:
-                flight_id_sprintf(flight_id_str, item->id);
-                query_writer_write_new_field(output, "id", "%s", flight_id_str);
-                break;
-            case Q02_OUTPUT_ITEM_RESERVATION:
-                reservation_id_sprintf(reservation_id_str, item->id);
-                query_writer_write_new_field(output, "id", "%s", reservation_id_str);
-                break;
-        }
-        query_writer_write_new_field(output, "date", "%s", date_string);
-
-        if (filter == Q02_ARGUMENTS_NO_ARGUMENT) {
-            query_writer_write_new_field(output,
-                                         "type",
-                                         item->type == Q02_OUTPUT_ITEM_FLIGHT ? "flight"
-                                                                              : "reservation");
-        }
-    }
+int __q02_entity_key(const database_t        *database,
+                     const void              *argument_data,
+                     query_type_entity_key_t *out_key) {
+    const q02_argument_data_t *const args  = argument_data;
+    const user_manager_t *const      users = database_get_users(database);
+
+    uint32_t user_index;
+    if (user_manager_get_index_by_id_filtered(users, args->user_id, &user_index) ||
+        !user_manager_is_active_by_index(users, user_index))
+        return 1;
+
+    out_key->entity  = user_index;
+    out_key->variant = args->filter;
+    return 0;
 }
 
 /**
- * @brief Executes a query of type 2.
+ * @brief   Gets the partition of a database a query of type 2 is sent to: its user's.
  *
- * @param database   Database to get information from.
- * @param statistics Always `NULL`, as this query does not use statistic data.
- * @param instance   Query instance to be executed.
- * @param output     Where to output query results to.
+ * @param argument_data Arguments of the query (a ::q02_argument_data_t).
+ * @param npartitions   Number of partitions.
  *
- * @retval 0 Always successful.
+ * @return The partition of the query's user.
  */
-int __q02_execute(const database_t       *database,
-                  const void             *statistics,
-                  const query_instance_t *instance,
-                  query_writer_t         *output) {
-    (void) statistics;
-    const q02_argument_data_t *const args = query_instance_get_argument_data(instance);
-
-    const user_manager_t *const        users        = database_get_users(database);
-    const reservation_manager_t *const reservations = database_get_reservations(database);
-    const flight_manager_t *const      flights      = database_get_flights(database);
-
-    const user_t *const user = user_manager_get_by_id(users, args->user_id);
-    if (!user || user_get_account_status(user) == ACCOUNT_STATUS_INACTIVE)
-        return 0;
-
-    GArray *const output_items = g_array_new(FALSE, FALSE, sizeof(q02_output_item_t));
-
-    if (args->filter != Q02_ARGUMENTS_FLIGHTS) { /* Add reservations */
-        const single_pool_id_linked_list_t *user_reservations =
-            user_manager_get_reservations_by_id(users, args->user_id);
-
-        while (user_reservations) {
-            const reservation_id_t id = single_pool_id_linked_list_get_value(user_reservations);
-
-            date_and_time_t output_time;
-            date_and_time_from_values(
-                &output_time,
-                reservation_get_begin_date(reservation_manager_get_by_id(reservations, id)),
-                0 /* 00:00:00 */);
-
-            const q02_output_item_t output_item = {.id   = id,
-                                                   .date = output_time,
-                                                   .type = Q02_OUTPUT_ITEM_RESERVATION};
-
-            g_array_append_val(output_items, output_item);
-            user_reservations = single_pool_id_linked_list_get_next(user_reservations);
-        }
-    }
-
-    if (args->filter != Q02_ARGUMENTS_RESERVATIONS) { /* Add flights */
-        const single_pool_id_linked_list_t *user_flights =
-            user_manager_get_flights_by_id(users, args->user_id);
-
-        while (user_flights) {
-            const flight_id_t id = single_pool_id_linked_list_get_value(user_flights);
-
-            const q02_output_item_t output_item = {
-                .id   = id,
-                .date = flight_get_schedule_departure_date(flight_manager_get_by_id(flights, id)),
-                .type = Q02_OUTPUT_ITEM_FLIGHT};
-
-            g_array_append_val(output_items, output_item);
-            user_flights = single_pool_id_linked_list_get_next(user_flights);
-        }
-    }
-
-    g_array_sort(output_items, __q02_execute_sort_compare);
-    __q02_print_output(output, output_items, args->filter);
-
-    g_array_unref(output_items);
-    return 0;
+size_t __q02_partition(const void *argument_data, size_t npartitions) {
+    const q02_argument_data_t *const args = argument_data;
+    return database_get_user_partition(args->user_id, npartitions);
 }
 
 query_type_t *q02_create(void) {
     return query_type_create(2,
                              __q02_parse_arguments,
-                             __q02_clone_arguments,
-                             __q02_free_arguments,
                              NULL,
                              NULL,
-                             __q02_execute);
+                             NULL,
+                             q02_execute,
+                             NULL,
+                             NULL,
+                             __q02_entity_key,
+                             __q02_partition,
+                             NULL);
 }
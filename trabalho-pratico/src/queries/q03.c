@@ -19,22 +19,29 @@
  * @brief Implementation of methods in include/queries/q03.h
  */
 
+#include <glib.h>
+#include <inttypes.h>
+#include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "queries/q03.h"
 #include "queries/query_instance.h"
-#include "utils/glib/GConstKeyHashTable.h"
+#include "utils/int_utils.h"
 
 /**
  * @brief   Parses arguments for a query of type 3.
  * @details Asserts that there's only one argument, a hotel identifier.
  *
- * @param argc Number of arguments.
- * @param argv Values of the arguments.
+ * @param argc      Number of arguments.
+ * @param argv      Values of the arguments.
+ * @param allocator Arena where to allocate the parsed arguments (not used, as the returned value is
+ *                  an integer).
  *
  * @return `NULL` on parsing failure, an hotel ID encoded as a pointer otherwise otherwise.
  */
-void *__q03_parse_arguments(size_t argc, char *const argv[argc]) {
+void *__q03_parse_arguments(size_t argc, char *const argv[argc], arena_t *allocator) {
+    (void) allocator;
     if (argc != 1)
         return NULL;
 
@@ -42,140 +49,167 @@ void *__q03_parse_arguments(size_t argc, char *const argv[argc]) {
     return hotel_id_from_string(&id, argv[0]) ? NULL : GUINT_TO_POINTER(id);
 }
 
-/**
- * @brief  Creates a deep clone of the value returned by ::__q03_parse_arguments.
- * @param  args_data Non-`NULL` value returned by ::__q03_parse_arguments (a hotel ID encoded as a
- *         pointer).
- * @return A deep copy of @p args_data.
- */
-void *__q03_clone_arguments(const void *args_data) {
-    return (void *) (size_t) args_data; /* Const cast acceptable - it's an just an integer */
-}
-
-/**
- * @brief   Frees data generated by ::__q03_parse_arguments.
- * @details Does nothing, as @p args_data is just an integer encoded as a pointer.
- * @param   args_data Data generated by ::__q03_parse_arguments.
- */
-void __q03_free_arguments(void *args_data) {
-    (void) args_data;
-}
+/** @brief Number of queries whose results ::__q03_execute_batch looks up before writing them. */
+#define Q03_BATCH_CHUNK_SIZE 64
 
 /**
- * @struct q03_average_t
- * @brief  Data structure containing the for calculating a flying average.
+ * @brief   Writes the partial output of queries of type 3, for a partition of a dataset.
+ * @details The average rating of a hotel can't be merged from the averages of each partition, so
+ *          the sum of its ratings and its number of reservations are written instead (nothing is
+ *          written for hotels that partition knows nothing about). See ::__q03_merge.
  *
- * @var q03_average_t::sum
- *     @brief Sum of all ratings checked until now.
- * @var q03_average_t::count
- *     @brief Number of reservations checked until now.
+ * @param reservations Reservations in the partition.
+ * @param n            Number of queries in @p instances.
+ * @param instances    Query instances to be executed.
+ * @param outputs      Where to write the partial result of each query to.
  */
-typedef struct {
-    uint64_t sum;
-    size_t   count;
-} q03_average_t;
+void __q03_execute_partial(const reservation_manager_t  *reservations,
+                           size_t                        n,
+                           const query_instance_t *const instances[n],
+                           query_writer_t *const         outputs[n]) {
+    for (size_t i = 0; i < n; ++i) {
+        const hotel_id_t hotel_id =
+            GPOINTER_TO_UINT(query_instance_get_argument_data(instances[i]));
+
+        uint64_t sum;
+        if (reservation_manager_get_hotel_rating_sum(reservations, hotel_id, &sum))
+            continue;
+
+        query_writer_write_new_object(outputs[i]);
+        query_writer_write_new_field(outputs[i], "rating_sum", "%" PRIu64, sum);
+        query_writer_write_new_field(
+            outputs[i],
+            "reservations",
+            "%zu",
+            reservation_manager_get_hotel_reservation_count(reservations, hotel_id));
+    }
+}
 
 /**
- * @brief   A method called for each reservation, to consider it in averages being calculated.
- * @details An auxiliary method for ::__q03_generate_statistics.
+ * @brief   Method called to execute many queries of type 3 at once.
+ * @details The ratings of a chunk of queries are all looked up before any of them is written, so
+ *          that lookups aren't interleaved with formatting.
  *
- * @param user_data   ::GConstKeyHashTable between hotel identifiers (as pointers) and pointers to
- *                    ::q03_average_t.
- * @param reservation Reservation being processed.
+ * @param database   Database to get the hotels' average ratings from.
+ * @param statistics Statistical data (not used, as ratings are aggregated per hotel in
+ *                   @p database).
+ * @param n          Number of queries in @p instances.
+ * @param instances  Query instances to be executed.
+ * @param outputs    Where to write the result of each query to.
  *
  * @retval 0 Always successful.
  */
-int __q03_generate_statistics_foreach_reservation(void                *user_data,
-                                                  const reservation_t *reservation) {
-    GConstKeyHashTable *const ratings_averages = user_data;
-
-    const hotel_id_t     hotel_id = reservation_get_hotel_id(reservation);
-    q03_average_t *const avg =
-        g_const_key_hash_table_lookup(ratings_averages, GUINT_TO_POINTER(hotel_id));
-    if (!avg)
+int __q03_execute_batch(const database_t             *database,
+                        const void                   *statistics,
+                        size_t                        n,
+                        const query_instance_t *const instances[n],
+                        query_writer_t *const         outputs[n]) {
+    (void) statistics;
+    const reservation_manager_t *const reservations = database_get_reservations(database);
+    if (query_type_get_partial()) {
+        __q03_execute_partial(reservations, n, instances, outputs);
         return 0;
+    }
+
+    for (size_t start = 0; start < n; start += Q03_BATCH_CHUNK_SIZE) {
+        const size_t chunk = min(n - start, Q03_BATCH_CHUNK_SIZE);
+
+        double ratings[Q03_BATCH_CHUNK_SIZE];
+        for (size_t i = 0; i < chunk; ++i) {
+            const hotel_id_t hotel_id =
+                GPOINTER_TO_UINT(query_instance_get_argument_data(instances[start + i]));
+            ratings[i] = reservation_manager_get_hotel_average_rating(reservations, hotel_id);
+        }
+
+        for (size_t i = 0; i < chunk; ++i) {
+            query_writer_write_new_object(outputs[start + i]);
+            query_writer_write_new_field(outputs[start + i], "rating", "%.3f", ratings[i]);
+        }
+    }
 
-    avg->sum += reservation_get_rating(reservation);
-    avg->count++;
     return 0;
 }
 
+int q03_execute(const database_t       *database,
+                const void             *statistics,
+                const query_instance_t *instance,
+                query_writer_t         *output) {
+    return __q03_execute_batch(database, statistics, 1, &instance, &output);
+}
+
 /**
- * @brief Generates statistical data for queries of type 3.
+ * @brief   Gets the partition of a database a query of type 3 is sent to.
+ * @details Reservations of a hotel may be in any partition, so the query is sent to all of them.
  *
- * @param database  Database, to iterate through reservations.
- * @param n         Number of query instances that need to be executed.
- * @param instances Query instances that need to be executed.
+ * @param argument_data Arguments of the query (not used).
+ * @param npartitions   Number of partitions (not used).
  *
- * @return A ::GConstKeyHashTable that associates hotel identifiers with ::q03_average_t for those
- *         hotels, or `NULL` on allocation failure.
+ * @return ::QUERY_TYPE_PARTITION_ALL.
  */
-void *__q03_generate_statistics(const database_t             *database,
-                                size_t                        n,
-                                const query_instance_t *const instances[n]) {
-
-    GConstKeyHashTable *const ratings_averages =
-        g_const_key_hash_table_new_full(g_direct_hash, g_direct_equal, free);
-
-    for (size_t i = 0; i < n; ++i) {
-        q03_average_t *const average = malloc(sizeof(q03_average_t));
-        if (!average) {
-            g_const_key_hash_table_unref(ratings_averages);
-            return NULL;
-        }
-
-        average->sum   = 0;
-        average->count = 0;
-        g_const_key_hash_table_insert(ratings_averages,
-                                      query_instance_get_argument_data(instances[i]),
-                                      average);
-    }
-
-    reservation_manager_iter(database_get_reservations(database),
-                             __q03_generate_statistics_foreach_reservation,
-                             ratings_averages);
-    return ratings_averages;
+size_t __q03_partition(const void *argument_data, size_t npartitions) {
+    (void) argument_data;
+    (void) npartitions;
+    return QUERY_TYPE_PARTITION_ALL;
 }
 
 /**
- * @brief Method called to execute a query of type 3.
+ * @brief   Merges the partial outputs of a query of type 3, from many partitions of a dataset.
+ * @details See ::__q03_execute_partial. Like in a single database, the average of a hotel no
+ *          partition knows about is `-NaN`.
  *
- * @param database   Database to get data from (not used, as all data is collected in
- *                   ::__q03_generate_statistics).
- * @param statistics Statistical data generated by ::__q03_generate_statistics.
- * @param instance   Query instance to be executed.
- * @param output     Where to write the query's result to.
+ * @param argument_data Arguments of the query (not used).
+ * @param n             Number of partitions.
+ * @param partials      Partial output of each partition.
+ * @param lengths       Number of characters in each of @p partials.
+ * @param output        Where to write the query's result to.
  *
  * @retval 0 Success.
- * @retval 1 Fatal failure (should, in principle, be unreachable).
+ * @retval 1 Malformed partial output.
  */
-int __q03_execute(const database_t       *database,
-                  const void             *statistics,
-                  const query_instance_t *instance,
-                  query_writer_t         *output) {
-    (void) database;
-
-    const GConstKeyHashTable *const ratings_averages = statistics;
-    const hotel_id_t hotel_id = GPOINTER_TO_UINT(query_instance_get_argument_data(instance));
-
-    const q03_average_t *const avg =
-        g_const_key_hash_table_const_lookup(ratings_averages, GUINT_TO_POINTER(hotel_id));
-    if (!avg) {
-        fprintf(stderr, "Bad statistical data in query 3! This should not happen!\n");
-        return 1;
+int __q03_merge(const void       *argument_data,
+                size_t            n,
+                const char *const partials[n],
+                const size_t      lengths[n],
+                query_writer_t   *output) {
+    (void) argument_data;
+
+    int      known = 0;
+    uint64_t sum = 0, count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (!lengths[i])
+            continue;
+
+        char partial[64];
+        if (lengths[i] >= sizeof(partial))
+            return 1;
+        memcpy(partial, partials[i], lengths[i]);
+        partial[lengths[i]] = '\0';
+
+        uint64_t partial_sum, partial_count;
+        if (sscanf(partial, "%" SCNu64 ";%" SCNu64, &partial_sum, &partial_count) != 2)
+            return 1;
+
+        known = 1;
+        sum += partial_sum;
+        count += partial_count;
     }
 
+    const double rating = known ? (double) sum / (double) count : -NAN;
     query_writer_write_new_object(output);
-    query_writer_write_new_field(output, "rating", "%.3f", (double) avg->sum / (double) avg->count);
+    query_writer_write_new_field(output, "rating", "%.3f", rating);
     return 0;
 }
 
 query_type_t *q03_create(void) {
     return query_type_create(3,
                              __q03_parse_arguments,
-                             __q03_clone_arguments,
-                             __q03_free_arguments,
-                             __q03_generate_statistics,
-                             (query_type_free_statistics_callback_t) g_const_key_hash_table_unref,
-                             __q03_execute);
+                             NULL,
+                             NULL,
+                             NULL,
+                             q03_execute,
+                             __q03_execute_batch,
+                             NULL,
+                             NULL,
+                             __q03_partition,
+                             __q03_merge);
 }
@@ -19,23 +19,43 @@
  * @brief Implementation of methods in include/queries/q04.h
  */
 
-#include <stdio.h>
+#include <glib.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "queries/q04.h"
 #include "queries/query_instance.h"
-#include "utils/glib/GConstKeyHashTable.h"
 #include "utils/glib/GConstPtrArray.h"
+#include "utils/int_utils.h"
+#include "utils/radix_sort.h"
+#include "utils/vector.h"
+
+/** @brief Estimated time (in nanoseconds) to filter a reservation by hotel, in a full scan. */
+#define Q04_COST_SCAN_NS_PER_RESERVATION 3
+
+/** @brief Estimated time (in nanoseconds) to group a reservation by hotel, in the hotel index. */
+#define Q04_COST_INDEX_NS_PER_RESERVATION 8
+
+/** @brief Estimated time (in nanoseconds) of each comparison when sorting reservations. */
+#define Q04_COST_SORT_NS_PER_COMPARISON 6
+
+/** @brief Estimated time (in nanoseconds) to find the reservations of a hotel, once grouped. */
+#define Q04_COST_LOOKUP_NS 50
 
 /**
  * @brief   Parses the arguments of a query of type 4.
  * @details Asserts that there's only one argument, a hotel identifier.
  *
- * @param argc Number of arguments.
- * @param argv Values of the arguments.
+ * @param argc      Number of arguments.
+ * @param argv      Values of the arguments.
+ * @param allocator Arena where to allocate the parsed arguments (not used, as the returned value is
+ *                  an integer).
  *
  * @return `NULL` on parsing failure, a ::hotel_id_t encoded as a pointer otherwise.
  */
-void *__q04_parse_arguments(size_t argc, char *const argv[argc]) {
+void *__q04_parse_arguments(size_t argc, char *const argv[argc], arena_t *allocator) {
+    (void) allocator;
     if (argc != 1)
         return NULL;
 
@@ -44,146 +64,257 @@ void *__q04_parse_arguments(size_t argc, char *const argv[argc]) {
 }
 
 /**
- * @brief  Creates a deep clone of the value returned by ::__q04_parse_arguments.
- * @param  args_data Non-`NULL` value returned by ::__q04_parse_arguments (a hotel's identifier
- *         encoded as a pointer).
- * @return A deep copy of @p args_data.
+ * @brief   Reservations of a hotel requested by queries of type 4.
+ * @details Each item is a reservation (::radix_sort_entry_t::value) along with its sort keys (begin
+ *          date and identifier), so that they're sorted without looking at the reservations.
  */
-void *__q04_clone_arguments(const void *args_data) {
-    return (void *) (size_t) args_data; /* Const cast acceptable - it's an just an integer */
-}
+VECTOR_DEFINE(q04_reservation_vector, radix_sort_entry_t, 4)
 
 /**
- * @brief   Frees data generated by ::__q04_parse_arguments.
- * @details Does nothing, as @p args_data is just an integer encoded as a pointer.
- * @param   args_data Data generated by ::__q04_parse_arguments.
+ * @struct q04_statistical_data_t
+ * @brief  Reservations of the hotels requested by queries of type 4.
+ *
+ * @var q04_statistical_data_t::slots
+ *     @brief Position of every hotel in ::q04_statistical_data_t::hotels, indexed by ::hotel_id_t
+ *            (`UINT32_MAX` for hotels that weren't requested).
+ * @var q04_statistical_data_t::nslots
+ *     @brief Number of elements in ::q04_statistical_data_t::slots (the largest requested hotel
+ *            identifier, plus one).
+ * @var q04_statistical_data_t::hotels
+ *     @brief Reservations of every requested hotel, sorted like in
+ *            ::database_get_hotel_reservations.
+ * @var q04_statistical_data_t::nhotels
+ *     @brief Number of requested hotels (elements in ::q04_statistical_data_t::hotels).
+ * @var q04_statistical_data_t::cancellation
+ *     @brief Cancellation shared by the queries the data is generated for (can be `NULL`).
  */
-void __q04_free_arguments(void *args_data) {
-    (void) args_data;
-}
+typedef struct {
+    uint32_t                   *slots;
+    size_t                      nslots;
+    q04_reservation_vector_t   *hotels;
+    size_t                      nhotels;
+    const query_cancellation_t *cancellation;
+} q04_statistical_data_t;
 
 /**
- * @brief   Callback for every reservation in the database, that adds it to its corresponding hotel
- *          in @p user_data.
+ * @brief   Callback for every span of reservations, that adds them to the vectors of their hotels.
  * @details Auxiliary method for ::__q04_generate_statistics.
  *
- * @param user_data   A ::GConstKeyHashTable that associates hotel identifiers (integers) to arrays
- *                    (::GConstPtrArray) of pointers to reservations (::reservation_t).
- * @param reservation A ::reservation_t in the database.
+ * @param user_data A pointer to a ::q04_statistical_data_t.
+ * @param columns   Reservations to be filtered.
  *
- * @retval 0 Always successful.
+ * @retval 0 Success.
+ * @retval 1 Allocation failure or cancellation.
  */
-int __q04_generate_statistics_foreach_reservation(void                *user_data,
-                                                  const reservation_t *reservation) {
+int __q04_generate_statistics_foreach(void                                *user_data,
+                                      const reservation_manager_columns_t *columns) {
+    q04_statistical_data_t *const stats = user_data;
+    if (query_cancellation_is_cancelled(stats->cancellation))
+        return 1; /* Checked once per span of QUERY_CANCELLATION_CHECK_INTERVAL rows */
 
-    const hotel_id_t      hotel_id     = reservation_get_hotel_id(reservation);
-    GConstPtrArray *const reservations = g_hash_table_lookup(user_data, GUINT_TO_POINTER(hotel_id));
-    if (!reservations)
-        return 0;
+    for (size_t i = 0; i < columns->length; ++i) {
+        const hotel_id_t hotel_id = columns->hotel_ids[i];
+        if (hotel_id >= stats->nslots || stats->slots[hotel_id] == UINT32_MAX)
+            continue;
 
-    g_const_ptr_array_add(reservations, reservation);
-    return 0;
-}
-
-/**
- * @brief   A comparison function for sorting a ::GConstPtrArray of reservations.
- * @details Auxiliary method for ::__q04_generate_statistics_sort_each_array, itself an
- *          auxiliary method for ::__q04_generate_statistics.
- */
-gint __q04_sort_reservations_by_date(const void *const *a, const void *const *b) {
-    const reservation_t *const reservation_a = *((const reservation_t *const *) a);
-    const reservation_t *const reservation_b = *((const reservation_t *const *) b);
+        const reservation_t *const reservation = columns->reservations[i];
 
-    const int64_t crit1 = date_diff(reservation_get_begin_date(reservation_b),
-                                    reservation_get_begin_date(reservation_a));
-    if (crit1)
-        return crit1;
-
-    const int64_t crit2 = reservation_get_id(reservation_a) - reservation_get_id(reservation_b);
-    return crit2;
+        radix_sort_entry_t entry;
+        entry.key      = radix_sort_descending(columns->begin_dates[i]);
+        entry.tiebreak = reservation_get_id(reservation);
+        entry.value    = reservation;
+        if (q04_reservation_vector_push(&stats->hotels[stats->slots[hotel_id]], entry))
+            return 1;
+    }
+    return 0;
 }
 
 /**
- * @brief Sorts each array of reservations in the statistical's data hash table.
+ * @brief   Frees the vectors of reservations in statistical data generated by
+ *          ::__q04_generate_statistics.
+ * @details Everything else is in the statistics' arena, freed by the caller.
  *
- * @param hotel Hotel identifier encoded as a pointer.
- * @param list  Array of reservations to be sorted (::GConstPtrArray).
- * @param data  External data (not used).
+ * @param statistics Value returned by ::__q04_generate_statistics.
  */
-void __q04_generate_statistics_sort_each_array(gconstpointer hotel, gpointer list, gpointer data) {
-    (void) hotel;
-    (void) data;
-    g_const_ptr_array_sort(list, __q04_sort_reservations_by_date);
+void __q04_free_statistics(void *statistics) {
+    q04_statistical_data_t *const stats = statistics;
+    for (size_t i = 0; i < stats->nhotels; ++i)
+        q04_reservation_vector_free(&stats->hotels[i]);
 }
 
 /**
- * @brief Generates statistical data for queries of type 4.
+ * @brief   Groups the reservations of the hotels requested by queries of type 4.
+ * @details Only used when it's predicted to be cheaper than building the index of reservations by
+ *          hotel (see ::__q04_cost_model). The number of reservations of every hotel is known
+ *          beforehand, so each vector is allocated once (if at all, as vectors of small hotels fit
+ *          in their inline storage). A single pass over all reservations keeps those of the
+ *          requested hotels, that are then sorted like in ::database_get_hotel_reservations.
  *
- * @param database   Database, to iterate through reservations.
- * @param n          Number of query instances that need to be executed.
- * @param instances  Query instances that need to be executed.
+ * @param database  Database, to get reservations from.
+ * @param n         Number of queries to process.
+ * @param instances Queries to process.
+ * @param allocator Arena where to allocate the statistical data (except the vectors' items).
  *
- * @return A ::GConstKeyHashTable associating hotel identifiers (integers) to arrays
- *         (::GConstPtrArray) of reservations (::reservation_t).
+ * @return A pointer to a ::q04_statistical_data_t, or `NULL` on allocation failure or if the
+ *         queries were cancelled.
  */
 void *__q04_generate_statistics(const database_t             *database,
                                 size_t                        n,
-                                const query_instance_t *const instances[n]) {
-
-    GConstKeyHashTable *const hotel_reservations =
-        g_const_key_hash_table_new_full(g_direct_hash,
-                                        g_direct_equal,
-                                        (GDestroyNotify) g_const_ptr_array_unref);
-    for (size_t i = 0; i < n; ++i)
-        g_const_key_hash_table_insert(hotel_reservations,
-                                      query_instance_get_argument_data(instances[i]), /* hotel id */
-                                      g_const_ptr_array_new());
-
-    reservation_manager_iter(database_get_reservations(database),
-                             __q04_generate_statistics_foreach_reservation,
-                             hotel_reservations);
-
-    g_const_key_hash_table_foreach(hotel_reservations,
-                                   __q04_generate_statistics_sort_each_array,
-                                   NULL);
-    return hotel_reservations;
+                                const query_instance_t *const instances[n],
+                                arena_t                      *allocator) {
+
+    q04_statistical_data_t *const stats = arena_allocate(allocator, sizeof(q04_statistical_data_t));
+    if (!stats)
+        return NULL;
+
+    stats->nslots       = 0;
+    stats->nhotels      = 0;
+    stats->cancellation = query_instance_get_cancellation(instances[0]);
+
+    for (size_t i = 0; i < n; ++i) {
+        const hotel_id_t hotel_id =
+            GPOINTER_TO_UINT(query_instance_get_argument_data(instances[i]));
+        stats->nslots = max(stats->nslots, (size_t) hotel_id + 1);
+    }
+
+    stats->slots  = arena_allocate(allocator, stats->nslots * sizeof(uint32_t));
+    stats->hotels = arena_allocate(allocator, n * sizeof(q04_reservation_vector_t));
+    if (!stats->slots || !stats->hotels)
+        return NULL;
+    memset(stats->slots, 0xff, stats->nslots * sizeof(uint32_t));
+
+    const reservation_manager_t *const reservations = database_get_reservations(database);
+    for (size_t i = 0; i < n; ++i) {
+        const hotel_id_t hotel_id =
+            GPOINTER_TO_UINT(query_instance_get_argument_data(instances[i]));
+        if (stats->slots[hotel_id] != UINT32_MAX)
+            continue;
+
+        q04_reservation_vector_t *const hotel = &stats->hotels[stats->nhotels];
+        q04_reservation_vector_init(hotel);
+        stats->slots[hotel_id] = stats->nhotels++;
+
+        if (q04_reservation_vector_reserve(
+                hotel,
+                reservation_manager_get_hotel_reservation_count(reservations, hotel_id)))
+            goto DEFER_1;
+    }
+
+    if (reservation_manager_iter_columns(reservations, __q04_generate_statistics_foreach, stats))
+        goto DEFER_1;
+
+    for (size_t i = 0; i < stats->nhotels; ++i)
+        if (radix_sort(q04_reservation_vector_get_data(&stats->hotels[i]), stats->hotels[i].length))
+            goto DEFER_1;
+
+    return stats;
+
+DEFER_1:
+    __q04_free_statistics(stats);
+    return NULL;
 }
 
 /**
- * @brief Method called to execute a query of type 4.
- *
- * @param database   Database to get data from (not used, as all data is collected in
- *                   ::__q04_generate_statistics).
- * @param statistics Statistical data generated by ::__q04_generate_statistics (a
- *                   ::GConstKeyHashTable that associates identifiers of hotels (integers) to
- *                   arrays (::GConstPtrArray) of reservations (::reservation_t)).
- * @param instance   Query instance to be executed.
- * @param output     Where to write the query's result to.
+ * @brief   Predicts the cost of executing queries of type 4 with and without statistical data.
+ * @details Once the index of reservations by hotel is built, each query is a lookup, and nothing
+ *          beats that. Otherwise, the first query builds that index, grouping and sorting the
+ *          reservations of every hotel, while ::__q04_generate_statistics only sorts those of the
+ *          requested hotels. Sorting the reservations of every hotel is estimated from the average
+ *          number of reservations per hotel in the database's catalog (see
+ *          ::database_get_catalog), or, without one, from that of the requested hotels. Writing the
+ *          output costs the same with both strategies, and isn't considered.
  *
- * @retval 0 Success.
- * @retval 1 Fatal failure (should, in principle, be unreachable).
+ * @param database  Database the queries will be executed on.
+ * @param n         Number of queries to be executed.
+ * @param instances Queries to be executed.
+ * @param out_cost  Where to write the predicted costs to.
  */
-int __q04_execute(const database_t       *database,
-                  const void             *statistics,
-                  const query_instance_t *instance,
-                  query_writer_t         *output) {
-    (void) database;
+void __q04_cost_model(const database_t             *database,
+                      size_t                        n,
+                      const query_instance_t *const instances[n],
+                      query_type_cost_t            *out_cost) {
+
+    const double lookups = (double) n * Q04_COST_LOOKUP_NS;
+    if (database_has_hotel_reservations(database)) {
+        out_cost->index_cost = lookups;
+        out_cost->scan_cost  = UINT64_MAX;
+        return;
+    }
+
+    /* Count the reservations of each requested hotel only once */
+    const reservation_manager_t *const reservations = database_get_reservations(database);
+    GHashTable *const seen = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    size_t hotels = 0, requested = 0;
+    double requested_sort = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const hotel_id_t hotel = GPOINTER_TO_UINT(query_instance_get_argument_data(instances[i]));
+        if (!g_hash_table_add(seen, GUINT_TO_POINTER(hotel)))
+            continue;
+
+        const size_t count = reservation_manager_get_hotel_reservation_count(reservations, hotel);
+        hotels++;
+        requested += count;
+        if (count > 1)
+            requested_sort += (double) count * log2((double) count);
+    }
+    g_hash_table_unref(seen);
+
+    const database_catalog_t *const catalog = database_get_catalog(database);
+
+    const double total   = (double) reservation_manager_get_count(reservations);
+    double       average = requested ? (double) requested / (double) hotels : 1;
+    if (catalog && catalog->hotels)
+        average = total / (double) catalog->hotels;
+    const double sort = average > 1 ? total * log2(average) : 0;
+
+    out_cost->index_cost = lookups + total * Q04_COST_INDEX_NS_PER_RESERVATION +
+                           sort * Q04_COST_SORT_NS_PER_COMPARISON;
+    out_cost->scan_cost  = lookups + total * Q04_COST_SCAN_NS_PER_RESERVATION +
+                          requested_sort * Q04_COST_SORT_NS_PER_COMPARISON;
+}
+
+int q04_execute(const database_t       *database,
+                const void             *statistics,
+                const query_instance_t *instance,
+                query_writer_t         *output) {
 
     const hotel_id_t hotel_id = GPOINTER_TO_UINT(query_instance_get_argument_data(instance));
-    const GConstPtrArray *const reservations =
-        g_const_key_hash_table_const_lookup(statistics, GUINT_TO_POINTER(hotel_id));
-    if (!reservations) {
-        fprintf(stderr, "Bad statistical data in query 4! This should not happen!\n");
-        return 1; /* Only happens on bad statistics, which itself shouldn't happen. */
+
+    const user_manager_t *const users = database_get_users(database);
+
+    const GConstPtrArray     *reservations = NULL;
+    const radix_sort_entry_t *entries      = NULL;
+    size_t                    reservations_len;
+    if (statistics) {
+        const q04_statistical_data_t *const stats = statistics;
+        if (hotel_id >= stats->nslots || stats->slots[hotel_id] == UINT32_MAX)
+            return 0; /* Not possible, as all hotels in queries are requested */
+
+        const q04_reservation_vector_t *const hotel = &stats->hotels[stats->slots[hotel_id]];
+        entries                                     = q04_reservation_vector_get_const_data(hotel);
+        reservations_len                            = hotel->length;
+    } else {
+        reservations = database_get_hotel_reservations(database, hotel_id);
+        if (!reservations)
+            return 0; /* No reservations in this hotel */
+        reservations_len = g_const_ptr_array_get_length(reservations);
     }
 
-    const size_t reservations_len = g_const_ptr_array_get_length(reservations);
     for (size_t i = 0; i < reservations_len; i++) {
-        const reservation_t *const reservation = g_const_ptr_array_index(reservations, i);
+        if ((i + 1) % QUERY_CANCELLATION_CHECK_INTERVAL == 0 &&
+            query_instance_is_cancelled(instance))
+            return 0; /* Incomplete output, marked by the dispatcher */
+
+        const reservation_t *const reservation =
+            entries ? entries[i].value : g_const_ptr_array_index(reservations, i);
+
+        const user_t *const user =
+            user_manager_get_by_index(users, reservation_get_user_index(reservation));
 
-        const char *const user_id     = reservation_get_const_user_id(reservation);
+        const char *const user_id     = user_get_const_id(user);
         const uint8_t     rating      = reservation_get_rating(reservation);
-        const double      total_price = reservation_calculate_price(reservation);
+        const uint64_t    total_price = reservation_calculate_price_cents(reservation);
 
         char begin_date_str[DATE_SPRINTF_MIN_BUFFER_SIZE];
         char end_date_str[DATE_SPRINTF_MIN_BUFFER_SIZE];
@@ -198,18 +329,194 @@ int __q04_execute(const database_t       *database,
         query_writer_write_new_field(output, "end_date", "%s", end_date_str);
         query_writer_write_new_field(output, "user_id", "%s", user_id);
         query_writer_write_new_field(output, "rating", "%" PRIu8, rating);
-        query_writer_write_new_field(output, "total_price", "%.3lf", total_price);
+        query_writer_write_new_field(output,
+                                     "total_price",
+                                     RESERVATION_PRICE_FORMAT,
+                                     total_price / 100,
+                                     total_price % 100);
     }
 
     return 0;
 }
 
+/**
+ * @brief Gets the entity a query of type 4 is about: its hotel.
+ *
+ * @param database      Database the query will be executed on.
+ * @param argument_data Arguments of the query (a ::hotel_id_t encoded as a pointer).
+ * @param out_key       Where to write the key of the query's output to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Hotel without reservations (nothing is outputted).
+ */
+int __q04_entity_key(const database_t        *database,
+                     const void              *argument_data,
+                     query_type_entity_key_t *out_key) {
+    const hotel_id_t hotel_id = GPOINTER_TO_UINT(argument_data);
+    if (!database_get_hotel_reservations(database, hotel_id))
+        return 1;
+
+    out_key->entity  = hotel_id;
+    out_key->variant = 0;
+    return 0;
+}
+
+/**
+ * @brief   Gets the partition of a database a query of type 4 is sent to.
+ * @details Reservations of a hotel may be in any partition, so the query is sent to all of them.
+ *
+ * @param argument_data Arguments of the query (not used).
+ * @param npartitions   Number of partitions (not used).
+ *
+ * @return ::QUERY_TYPE_PARTITION_ALL.
+ */
+size_t __q04_partition(const void *argument_data, size_t npartitions) {
+    (void) argument_data;
+    (void) npartitions;
+    return QUERY_TYPE_PARTITION_ALL;
+}
+
+/** @brief Number of fields in each line of the output of a query of type 4. */
+#define Q04_FIELD_COUNT 6
+
+/** @brief Names of the fields in each line of the output of a query of type 4. */
+const char *const q04_field_names[Q04_FIELD_COUNT] =
+    {"id", "begin_date", "end_date", "user_id", "rating", "total_price"};
+
+/**
+ * @struct q04_partial_run_t
+ * @brief  Sorted output of a query of type 4 in a partition of a dataset, being merged.
+ *
+ * @var q04_partial_run_t::cursor
+ *     @brief Beginning of the line after ::q04_partial_run_t::fields.
+ * @var q04_partial_run_t::end
+ *     @brief End of the partition's output.
+ * @var q04_partial_run_t::fields
+ *     @brief Beginning of each field of the current line (`NULL` when the run is over).
+ * @var q04_partial_run_t::lengths
+ *     @brief Number of characters in each of ::q04_partial_run_t::fields.
+ */
+typedef struct {
+    const char *cursor, *end;
+    const char *fields[Q04_FIELD_COUNT];
+    int         lengths[Q04_FIELD_COUNT];
+} q04_partial_run_t;
+
+/**
+ * @brief Moves to the next line of a partition's output.
+ * @param run Partition's output being merged.
+ *
+ * @retval 0 Success (::q04_partial_run_t::fields is `NULL` when there are no more lines).
+ * @retval 1 Malformed line.
+ */
+int __q04_partial_run_next(q04_partial_run_t *run) {
+    if (run->cursor >= run->end) {
+        run->fields[0] = NULL;
+        return 0;
+    }
+
+    const char *const line_end = memchr(run->cursor, '\n', run->end - run->cursor);
+    const char *const end      = line_end ? line_end : run->end;
+
+    const char *field = run->cursor;
+    for (size_t i = 0; i < Q04_FIELD_COUNT; ++i) {
+        const char *field_end = i + 1 == Q04_FIELD_COUNT ? end : memchr(field, ';', end - field);
+        if (!field_end)
+            return 1;
+
+        run->fields[i]  = field;
+        run->lengths[i] = field_end - field;
+        field           = field_end + 1;
+    }
+
+    run->cursor = end + 1;
+    return 0;
+}
+
+/**
+ * @brief   Compares the current lines of two partitions' outputs.
+ * @details Lines are sorted like reservations in ::database_get_hotel_reservations: by begin date,
+ *          from the most recent, and then by identifier. Both are fixed-width, so they're compared
+ *          as strings.
+ *
+ * @param a Output of a partition.
+ * @param b Output of another partition.
+ *
+ * @return A negative number if the line of @p a comes first, a positive number otherwise.
+ */
+int __q04_partial_run_compare(const q04_partial_run_t *a, const q04_partial_run_t *b) {
+    const int dates = memcmp(b->fields[1], a->fields[1], min(a->lengths[1], b->lengths[1]));
+    if (dates)
+        return dates;
+    if (a->lengths[0] != b->lengths[0])
+        return a->lengths[0] - b->lengths[0];
+    return memcmp(a->fields[0], b->fields[0], a->lengths[0]);
+}
+
+/**
+ * @brief   Merges the outputs of a query of type 4, from many partitions of a dataset.
+ * @details Each partition outputs its own reservations of the hotel, already sorted, so those
+ *          outputs are merged like sorted runs.
+ *
+ * @param argument_data Arguments of the query (not used).
+ * @param n             Number of partitions.
+ * @param partials      Output of each partition.
+ * @param lengths       Number of characters in each of @p partials.
+ * @param output        Where to write the query's result to.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure or malformed partial output.
+ */
+int __q04_merge(const void       *argument_data,
+                size_t            n,
+                const char *const partials[n],
+                const size_t      lengths[n],
+                query_writer_t   *output) {
+    (void) argument_data;
+
+    q04_partial_run_t *const runs = malloc(sizeof(q04_partial_run_t) * n);
+    if (!runs)
+        return 1;
+
+    int retval = 0;
+    for (size_t i = 0; i < n; ++i) {
+        runs[i].cursor = partials[i];
+        runs[i].end    = partials[i] + lengths[i];
+        retval |= __q04_partial_run_next(&runs[i]);
+    }
+
+    while (!retval) {
+        q04_partial_run_t *first = NULL;
+        for (size_t i = 0; i < n; ++i)
+            if (runs[i].fields[0] && (!first || __q04_partial_run_compare(&runs[i], first) < 0))
+                first = &runs[i];
+        if (!first)
+            break;
+
+        query_writer_write_new_object(output);
+        for (size_t i = 0; i < Q04_FIELD_COUNT; ++i)
+            query_writer_write_new_field(output,
+                                         q04_field_names[i],
+                                         "%.*s",
+                                         first->lengths[i],
+                                         first->fields[i]);
+        retval = __q04_partial_run_next(first);
+    }
+
+    free(runs);
+    return retval;
+}
+
 query_type_t *q04_create(void) {
     return query_type_create(4,
                              __q04_parse_arguments,
-                             __q04_clone_arguments,
-                             __q04_free_arguments,
                              __q04_generate_statistics,
-                             (query_type_free_statistics_callback_t) g_hash_table_unref,
-                             __q04_execute);
+                             __q04_free_statistics,
+                             NULL,
+                             q04_execute,
+                             NULL,
+                             __q04_cost_model,
+                             __q04_entity_key,
+                             __q04_partition,
+                             __q04_merge);
 }
@@ -19,11 +19,9 @@
  * @brief Implementation of methods in include/queries/q05.h
  */
 
-#include <stdio.h>
-
+#include <glib.h>
 #include "queries/q05.h"
 #include "queries/query_instance.h"
-#include "utils/glib/GConstKeyHashTable.h"
 #include "utils/glib/GConstPtrArray.h"
 
 /**
@@ -47,212 +45,88 @@ typedef struct {
  * @brief   Parses the arguments of a query of type 5.
  * @details Asserts that there's three arguments, an airport code, and two dates with times.
  *
- * @param argc Number of arguments.
- * @param argv Values of the arguments.
+ * @param argc      Number of arguments.
+ * @param argv      Values of the arguments.
+ * @param allocator Arena where to allocate the parsed arguments.
  *
  * @return `NULL` on parsing or allocation failure, a pointer to a ::q05_parsed_arguments_t
  *         otherwise.
  */
-void *__q05_parse_arguments(size_t argc, char *const argv[argc]) {
+void *__q05_parse_arguments(size_t argc, char *const argv[argc], arena_t *allocator) {
     if (argc != 3)
         return NULL;
 
-    q05_parsed_arguments_t *const parsed_arguments = malloc(sizeof(q05_parsed_arguments_t));
-    if (!parsed_arguments)
-        return NULL;
-
-    const int airport_retval = airport_code_from_string(&parsed_arguments->airport_code, argv[0]);
-    const int begin_date_retval = date_and_time_from_string(&parsed_arguments->begin_date, argv[1]);
-    const int end_date_retval   = date_and_time_from_string(&parsed_arguments->end_date, argv[2]);
+    q05_parsed_arguments_t parsed_arguments;
 
-    if (airport_retval || begin_date_retval || end_date_retval) {
-        free(parsed_arguments);
-        return NULL;
-    }
-
-    return parsed_arguments;
-}
+    const int airport_retval    = airport_code_from_string(&parsed_arguments.airport_code, argv[0]);
+    const int begin_date_retval = date_and_time_from_string(&parsed_arguments.begin_date, argv[1]);
+    const int end_date_retval   = date_and_time_from_string(&parsed_arguments.end_date, argv[2]);
 
-/**
- * @brief  Creates a deep clone of the value returned by ::__q05_parse_arguments.
- * @param  args_data Non-`NULL` value returned by ::__q05_parse_arguments (a pointer to a
- *                   ::q05_parsed_arguments_t).
- * @return A deep copy of @p args_data.
- */
-void *__q05_clone_arguments(const void *args_data) {
-    const q05_parsed_arguments_t *const args  = args_data;
-    q05_parsed_arguments_t *const       clone = malloc(sizeof(q05_parsed_arguments_t));
-    if (!clone)
+    if (airport_retval || begin_date_retval || end_date_retval)
         return NULL;
 
-    memcpy(clone, args, sizeof(q05_parsed_arguments_t));
-    return clone;
+    return arena_put(allocator, &parsed_arguments, sizeof(q05_parsed_arguments_t));
 }
 
 /**
- * @struct q05_foreach_airport_data_t
- * @brief  Data needed while iterating over flights.
- *
- * @var q05_foreach_airport_data_t::nfilters
- *     @brief Number of elements in ::q05_foreach_airport_data_t::filters.
- * @var q05_foreach_airport_data_t::filters
- *     @brief Array of pointers to ::q05_parsed_arguments_t. Information about which flights and
- *            date ranges to keep.
- * @var q05_foreach_airport_data_t::origin_flights
- *     @brief Associations between ::q05_parsed_arguments_t and arrays (::GConstPtrArray) of
- *            pointers to flights (::flight_t).
- */
-typedef struct {
-    size_t                                     nfilters;
-    const q05_parsed_arguments_t *const *const filters;
-    GConstKeyHashTable *const                  origin_flights;
-} q05_foreach_airport_data_t;
-
-/**
- * @brief   A method called for each flight, to consider it in the list of flights with an origin
- *          on a given airport, depending on range of times.
- * @details An auxiliary method for ::__q05_generate_statistics.
+ * @brief   Finds the first flight scheduled before (or at) a date.
+ * @details Auxiliary method for ::q05_execute.
  *
- * @param user_data A pointer to a ::q05_foreach_airport_data_t.
- * @param flight    Flight being processed.
+ * @param departures Scheduled departure dates (::date_and_time_t), from the newest one.
+ * @param date       Date to compare departure dates with.
+ * @param inclusive  Whether flights scheduled exactly at @p date are also considered.
  *
- * @retval 0 Always successful.
+ * @return The index of the first date in @p departures before @p date (or equal to it, if
+ *         @p inclusive), or the length of @p departures if there's no such date.
  */
-int __q05_generate_statistics_foreach_flight(void *user_data, const flight_t *flight) {
-    q05_foreach_airport_data_t *const foreach_data = user_data;
-
-    airport_code_t  airport                 = flight_get_origin(flight);
-    date_and_time_t schedule_departure_date = flight_get_schedule_departure_date(flight);
-
-    /* Add flight to all query answers whose filter matches */
-    for (size_t i = 0; i < foreach_data->nfilters; i++) {
-        const q05_parsed_arguments_t *const args = foreach_data->filters[i];
-
-        /* Check if the flight meets the filters in the arguments */
-        if (airport == args->airport_code &&
-            date_and_time_diff(args->begin_date, schedule_departure_date) <= 0 &&
-            date_and_time_diff(args->end_date, schedule_departure_date) >= 0) {
-
-            /* Add flight to answer */
-            GConstPtrArray *const flights =
-                g_const_key_hash_table_lookup(foreach_data->origin_flights, args);
-            g_const_ptr_array_add(flights, flight);
-        }
+size_t __q05_find_first_departure(const GArray *departures, date_and_time_t date, int inclusive) {
+    const date_and_time_t *const dates = (const date_and_time_t *) departures->data;
+
+    size_t low = 0, high = departures->len;
+    while (low < high) {
+        const size_t  middle = low + (high - low) / 2;
+        const int64_t diff   = date_and_time_diff(date, dates[middle]);
+
+        if (diff < 0 || (diff == 0 && !inclusive))
+            low = middle + 1;
+        else
+            high = middle;
     }
 
-    return 0;
-}
-
-/**
- * @brief   A comparison function for sorting a ::GConstPtrArray of flights.
- * @details Auxiliary method for ::__q05_generate_statistics_sort_each_array, itself an
- *          auxiliary method for ::__q05_generate_statistics.
- */
-gint __q05_flights_date_compare_func(const void *const *a, const void *const *b) {
-    const flight_t *const flight_a = *((const flight_t *const *) a);
-    const flight_t *const flight_b = *((const flight_t *const *) b);
-
-    const int64_t crit1 = date_and_time_diff(flight_get_schedule_departure_date(flight_b),
-                                             flight_get_schedule_departure_date(flight_a));
-    if (crit1)
-        return crit1;
-
-    const int32_t crit2 = flight_get_id(flight_a) - flight_get_id(flight_b);
-    return crit2;
-}
-
-/**
- * @brief Sorts each array of flights in the statistical's data hash table.
- *
- * @param query Pointer to a ::q05_foreach_airport_data_t.
- * @param list  Array of reservations to be sorted (::GConstPtrArray).
- * @param data  External data (not used).
- */
-void __q05_generate_statistics_sort_each_array(gconstpointer query, gpointer list, gpointer data) {
-    (void) query;
-    (void) data;
-    g_const_ptr_array_sort(list, __q05_flights_date_compare_func);
+    return low;
 }
 
-/**
- * @brief Generates statistical data for queries of type 5.
- *
- * @param database  Database, to iterate through flights.
- * @param n         Number of query instances that need to be executed.
- * @param instances Query instances that need to be executed.
- *
- * @return A ::GConstKeyHashTable associating a ::q05_foreach_airport_data_t for each query to a
- *         ::GConstPtrArray of pointers to flights (::flight_t). `NULL` may be returned on
- *         allocation failure.
- */
-void *__q05_generate_statistics(const database_t             *database,
-                                size_t                        n,
-                                const query_instance_t *const instances[n]) {
-    const q05_parsed_arguments_t **const filters = malloc(n * sizeof(q05_parsed_arguments_t *));
-    if (!filters)
-        return NULL;
-
-    GConstKeyHashTable *const origin_flights =
-        g_const_key_hash_table_new_full(g_direct_hash,
-                                        g_direct_equal,
-                                        (GDestroyNotify) g_ptr_array_unref);
-
-    for (size_t i = 0; i < n; ++i) {
-        const q05_parsed_arguments_t *const argument_data =
-            query_instance_get_argument_data(instances[i]);
-
-        g_const_key_hash_table_insert(origin_flights, argument_data, g_const_ptr_array_new());
-        filters[i] = argument_data;
-    }
+int q05_execute(const database_t       *database,
+                const void             *statistics,
+                const query_instance_t *instance,
+                query_writer_t         *output) {
+    (void) statistics;
 
-    q05_foreach_airport_data_t callback_data = {.nfilters       = n,
-                                                .filters        = filters,
-                                                .origin_flights = origin_flights};
-    flight_manager_iter(database_get_flights(database),
-                        __q05_generate_statistics_foreach_flight,
-                        &callback_data);
+    const q05_parsed_arguments_t *const arguments = query_instance_get_argument_data(instance);
+    const GConstPtrArray *const         flights =
+        database_get_origin_flights(database, arguments->airport_code);
+    if (!flights)
+        return 0; /* No flights departing from this airport */
 
-    g_const_key_hash_table_foreach(origin_flights, __q05_generate_statistics_sort_each_array, NULL);
-    free(filters);
-    return origin_flights;
-}
-
-/**
- * @brief Method called to execute a query of type 5.
- *
- * @param database   Database to get data from (not used, as all data is collected in
- *                   ::__q05_generate_statistics).
- * @param statistics Statistical data generated by ::__q05_generate_statistics (a
- *                   ::GConstKeyHashTable that associates query arguments (::q05_parsed_arguments_t)
- *                   to arrays (::GConstPtrArray) of flights (::flight_id_t)).
- * @param instance   Query instance to be executed.
- * @param output     Where to write the query's result to.
- *
- * @retval 0 Success.
- * @retval 1 Fatal failure (should, in principle, be unreachable).
- */
-int __q05_execute(const database_t       *database,
-                  const void             *statistics,
-                  const query_instance_t *instance,
-                  query_writer_t         *output) {
-    (void) database;
+    const GArray *const departures =
+        database_get_origin_departures(database, arguments->airport_code);
 
-    const GConstKeyHashTable *const     origin_flights = statistics;
-    const q05_parsed_arguments_t *const arguments      = query_instance_get_argument_data(instance);
+    /* Flights are sorted from the newest one, so the date range is a contiguous slice */
+    const size_t first = __q05_find_first_departure(departures, arguments->end_date, 1);
+    const size_t last  = __q05_find_first_departure(departures, arguments->begin_date, 0);
 
-    const GConstPtrArray *const flights =
-        g_const_key_hash_table_const_lookup(origin_flights, arguments);
-    if (!flights) {
-        fprintf(stderr, "Bad statistical data in query 5! This should not happen!\n");
-        return 1; /* Only happens on bad statistics, which itself shouldn't happen. */
-    }
+    for (size_t i = first; i < last; i++) {
+        if ((i - first + 1) % QUERY_CANCELLATION_CHECK_INTERVAL == 0 &&
+            query_instance_is_cancelled(instance))
+            return 0; /* Incomplete output, marked by the dispatcher */
 
-    const size_t flights_len = g_const_ptr_array_get_length(flights);
-    for (size_t i = 0; i < flights_len; i++) {
         const flight_t *const flight = g_const_ptr_array_index(flights, i);
 
+        const date_and_time_t schedule_departure_date =
+            g_array_index(departures, date_and_time_t, i);
+
         char scheduled_departure_str[DATE_AND_TIME_SPRINTF_MIN_BUFFER_SIZE];
-        date_and_time_sprintf(scheduled_departure_str, flight_get_schedule_departure_date(flight));
+        date_and_time_sprintf(scheduled_departure_str, schedule_departure_date);
 
         char destination_airport[AIRPORT_CODE_SPRINTF_MIN_BUFFER_SIZE];
         airport_code_sprintf(destination_airport, flight_get_destination(flight));
@@ -277,12 +151,47 @@ int __q05_execute(const database_t       *database,
     return 0;
 }
 
+/**
+ * @brief   Gets the entity a query of type 5 is about: its origin airport.
+ * @details The variant is the slice of the airport's flights in the query's date range, so that
+ *          queries whose date ranges contain the same flights share their output.
+ *
+ * @param database      Database the query will be executed on.
+ * @param argument_data Arguments of the query (a ::q05_parsed_arguments_t).
+ * @param out_key       Where to write the key of the query's output to.
+ *
+ * @retval 0 Success.
+ * @retval 1 No flights in the query's date range (nothing is outputted).
+ */
+int __q05_entity_key(const database_t        *database,
+                     const void              *argument_data,
+                     query_type_entity_key_t *out_key) {
+    const q05_parsed_arguments_t *const arguments = argument_data;
+    const GArray *const                 departures =
+        database_get_origin_departures(database, arguments->airport_code);
+    if (!departures)
+        return 1;
+
+    const uint64_t first = __q05_find_first_departure(departures, arguments->end_date, 1);
+    const uint64_t last  = __q05_find_first_departure(departures, arguments->begin_date, 0);
+    if (first >= last)
+        return 1;
+
+    out_key->entity  = arguments->airport_code;
+    out_key->variant = first << 32 | last;
+    return 0;
+}
+
 query_type_t *q05_create(void) {
     return query_type_create(5,
                              __q05_parse_arguments,
-                             __q05_clone_arguments,
-                             free,
-                             __q05_generate_statistics,
-                             (query_type_free_statistics_callback_t) g_hash_table_unref,
-                             __q05_execute);
+                             NULL,
+                             NULL,
+                             NULL,
+                             q05_execute,
+                             NULL,
+                             NULL,
+                             __q05_entity_key,
+                             NULL,
+                             NULL);
 }
@@ -21,21 +21,29 @@
 
 #include <glib.h>
 #include <math.h>
+#include <stddef.h>
+#include <stdio.h>
 
 #include "queries/q07.h"
 #include "queries/query_instance.h"
 #include "utils/int_utils.h"
+#include "utils/memory_report.h"
+#include "utils/quantile_histogram.h"
+#include "utils/top_k.h"
 
 /**
  * @brief   Parses the arguments of a query of type 7.
  * @details Asserts there's only one integer argument..
  *
- * @param argc Number of arguments.
- * @param argv Values of the arguments.
+ * @param argc      Number of arguments.
+ * @param argv      Values of the arguments.
+ * @param allocator Arena where to allocate the parsed arguments (not used, as the returned value is
+ *                  an integer).
  *
  * @return `NULL` for invalid arguments, an integer encoded as a pointer otherwise.
  */
-void *__q07_parse_arguments(size_t argc, char *const argv[argc]) {
+void *__q07_parse_arguments(size_t argc, char *const argv[argc], arena_t *allocator) {
+    (void) allocator;
     if (argc != 1)
         return NULL;
 
@@ -49,191 +57,258 @@ void *__q07_parse_arguments(size_t argc, char *const argv[argc]) {
 }
 
 /**
- * @brief  Creates a deep clone of the value returned by ::__q07_parse_arguments.
- * @param  args_data Non-`NULL` value returned by ::__q07_parse_arguments (an integer encoded as a
- *                   pointer).
- * @return A deep copy of @p args_data.
+ * @struct q07_approximate_data_t
+ * @brief  Data used while iterating through flights, to approximate the medians of their delays.
+ *
+ * @var q07_approximate_data_t::histograms
+ *     @brief Histogram (::quantile_histogram_t) of the departure delays of every origin airport
+ *            (::airport_code_t encoded as a pointer).
+ * @var q07_approximate_data_t::flights
+ *     @brief Number of flights iterated through.
+ * @var q07_approximate_data_t::cancellation
+ *     @brief Cancellation shared by the queries the medians are approximated for (can be `NULL`).
  */
-void *__q07_clone_arguments(const void *args_data) {
-    return (void *) (size_t) args_data; /* Const cast acceptable - it's an just an integer */
-}
+typedef struct {
+    GHashTable                 *histograms;
+    size_t                      flights;
+    const query_cancellation_t *cancellation;
+} q07_approximate_data_t;
 
 /**
- * @brief   Frees data generated by ::__q07_parse_arguments.
- * @details Does nothing, as @p args_data is just an integer encoded as a pointer.
- * @param   args_data Data generated by ::__q07_parse_arguments.
+ * @brief   Method called for every span of flights, to record their delays.
+ * @details Auxiliary method for ::__q07_generate_statistics_approximate.
+ *
+ * @param user_data A pointer to a ::q07_approximate_data_t.
+ * @param columns   Flights being processed.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure or cancellation.
  */
-void __q07_free_arguments(void *args_data) {
-    (void) args_data;
-}
+int __q07_generate_statistics_approximate_foreach_flight(void                           *user_data,
+                                                         const flight_manager_columns_t *columns) {
+    q07_approximate_data_t *const data = user_data;
+    if (query_cancellation_is_cancelled(data->cancellation))
+        return 1; /* Checked once per span of QUERY_CANCELLATION_CHECK_INTERVAL rows */
+
+    for (size_t i = 0; i < columns->length; ++i) {
+        const gpointer        key = GUINT_TO_POINTER(columns->origins[i]);
+        quantile_histogram_t *histogram = g_hash_table_lookup(data->histograms, key);
+        if (!histogram) {
+            histogram = quantile_histogram_create();
+            if (!histogram)
+                return 1;
+            g_hash_table_insert(data->histograms, key, histogram);
+        }
+
+        /* Flights never depart before they're scheduled to */
+        const int64_t delay = date_and_time_diff(columns->real_departure_dates[i],
+                                                 columns->schedule_departure_dates[i]);
+        if (quantile_histogram_record(histogram, max(delay, 0)))
+            return 1;
+    }
 
-/**
- * @brief   A comparison function for sorting an `GArray` of `int64_t`s.
- * @details Auxiliary method for ::__q07_generate_statistics.
- */
-gint __q07_generate_statistics_int64_compare_func(gconstpointer a, gconstpointer b) {
-    return *(const int64_t *) a - *(const int64_t *) b;
+    data->flights += columns->length;
+    return 0;
 }
 
 /**
- * @brief Function called for every flight, that adds it to an array of flights associated with an
- *        airport.
+ * @brief   Approximates the departure delay median of every origin airport.
+ * @details Instead of keeping every delay of an airport (see ::database_get_origin_delay_medians),
+ *          delays are counted in a ::quantile_histogram_t per airport, in a single pass through the
+ *          columns of flights. Medians are off by at most ::QUANTILE_HISTOGRAM_RELATIVE_ERROR. The
+ *          error bound and the memory used by both methods are reported to `stderr`.
  *
- * @param user_data A `GHashTable` that associates ::airport_code_t's to `GArray`s of delays
- *                  (`int64_t`),
- * @param flight    Flight to be processed.
+ * @param database     Database, to iterate through flights.
+ * @param cancellation Cancellation of the queries the medians are approximated for (can be `NULL`).
+ * @param to_add       A ::top_k_t of ::index_manager_airport_delay_t to which the medians will be
+ *                     added.
  *
- * @retval 0 Always. Don't stop iteration.
+ * @retval 0 Success.
+ * @retval 1 Allocation failure or cancellation.
  */
-int __q07_generate_statistics_foreach_flight(void *user_data, const flight_t *flight) {
-    GHashTable *const airport_delays = user_data;
+int __q07_generate_statistics_approximate(const database_t           *database,
+                                          const query_cancellation_t *cancellation,
+                                          top_k_t                    *to_add) {
+    GHashTable *const histograms =
+        g_hash_table_new_full(g_direct_hash,
+                              g_direct_equal,
+                              NULL,
+                              (GDestroyNotify) quantile_histogram_free);
+    q07_approximate_data_t data = {.histograms   = histograms,
+                                   .flights      = 0,
+                                   .cancellation = cancellation};
+
+    if (flight_manager_iter_columns(database_get_flights(database),
+                                    __q07_generate_statistics_approximate_foreach_flight,
+                                    &data)) {
+        g_hash_table_unref(histograms);
+        return 1;
+    }
 
-    const airport_code_t airport_code = flight_get_origin(flight);
-    const int64_t        delay        = date_and_time_diff(flight_get_real_departure_date(flight),
-                                             flight_get_schedule_departure_date(flight));
+    size_t approximate_bytes = memory_report_estimate_hash_table(g_hash_table_size(histograms));
 
-    GArray *delays = g_hash_table_lookup(airport_delays, GUINT_TO_POINTER(airport_code));
-    if (!delays) {
-        delays = g_array_new(FALSE, FALSE, sizeof(int64_t));
-        g_hash_table_insert(airport_delays, GUINT_TO_POINTER(airport_code), delays);
-    }
+    GHashTableIter iter;
+    gpointer       key, value;
+    g_hash_table_iter_init(&iter, histograms);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        const quantile_histogram_t *const histogram   = value;
+        const size_t                      flights_len = quantile_histogram_get_count(histogram);
 
-    g_array_append_val(delays, delay);
-    return 0;
-}
+        const size_t middle = flights_len / 2;
+        double       median = quantile_histogram_get_rank(histogram, middle);
+        if (flights_len % 2 == 0)
+            median = (median + quantile_histogram_get_rank(histogram, middle - 1)) * 0.5;
 
-/**
- * @struct q07_airport_median
- * @brief  Pair composed of an airport and its departure delay median.
- *
- * @var q07_airport_median::airport_code
- *     @brief Airport to whom ::q07_airport_median::median applies.
- * @var q07_airport_median::median
- *     @brief Departure delay median of q07_airport_median::airport_code.
- */
-typedef struct {
-    airport_code_t airport_code;
-    int64_t        median;
-} q07_airport_median;
+        const index_manager_airport_delay_t airport_median = {.airport = GPOINTER_TO_UINT(key),
+                                                              .median_delay = round(median)};
+        top_k_add(to_add, &airport_median);
 
-/**
- * @brief Function called for every airport, to generate an array of ::q07_airport_median.
- *
- * @param key       An `airport_code_t` as a pointer.
- * @param value     A pointer to a `GArray` of `int64_t`, the delays of all flights in seconds.
- * @param user_data A `GArray` of ::q07_airport_median to which a new value will be added.
- */
-void __q07_generate_statistics_foreach_airport(gpointer key, gpointer value, gpointer user_data) {
-    const airport_code_t airport = GPOINTER_TO_UINT(key);
-    GArray *const        delays  = value;
-    GArray *const        to_add  = user_data;
-
-    g_array_sort(delays, __q07_generate_statistics_int64_compare_func);
-
-    double median;
-    if (delays->len % 2 == 0) {
-        const size_t middle = delays->len / 2;
-        median              = (g_array_index(delays, uint64_t, middle) +
-                  g_array_index(delays, uint64_t, middle - 1)) *
-                 0.5;
-    } else {
-        median = g_array_index(delays, uint64_t, delays->len / 2);
+        approximate_bytes += quantile_histogram_get_size(histogram);
     }
 
-    const q07_airport_median airport_median = {.airport_code = airport, .median = round(median)};
-    g_array_append_val(to_add, airport_median);
+    /* Exact medians need the delays of all flights, while their index is being built */
+    const size_t exact_bytes = data.flights * sizeof(int64_t);
+    fprintf(stderr,
+            "Query 7: approximate medians of %u airports (error up to %.2f %%) in %zu bytes, "
+            "instead of %zu bytes\n",
+            g_hash_table_size(histograms),
+            QUANTILE_HISTOGRAM_RELATIVE_ERROR * 100,
+            approximate_bytes,
+            exact_bytes);
+
+    g_hash_table_unref(histograms);
+    return 0;
 }
 
 /**
- * @brief   Comparsion criteria for sorting arrays of ::q07_airport_median.
- * @details Auxiliary method for ::__q07_generate_statistics.
+ * @brief   Comparsion criteria for sorting arrays of ::index_manager_airport_delay_t.
+ * @details Auxiliary method for ::__q07_generate_statistics. Same order as in
+ *          ::database_get_origin_delay_medians.
  *
- * @param a Pointer to a `const` ::q07_airport_median.
- * @param b Pointer to a `const` ::q07_airport_median.
+ * @param a Pointer to a `const` ::index_manager_airport_delay_t.
+ * @param b Pointer to a `const` ::index_manager_airport_delay_t.
  *
  * @return Comparison value between @p a and @p b.
  */
 gint __q07_generate_statistics_airport_median_compare_func(gconstpointer a, gconstpointer b) {
-    const q07_airport_median *const airport_median_a = a;
-    const q07_airport_median *const airport_median_b = b;
+    const index_manager_airport_delay_t *const airport_median_a = a;
+    const index_manager_airport_delay_t *const airport_median_b = b;
 
-    const uint64_t crit1 = airport_median_b->median - airport_median_a->median;
+    const uint64_t crit1 = airport_median_b->median_delay - airport_median_a->median_delay;
     if (crit1)
         return crit1;
 
     char airport_code_a_str[AIRPORT_CODE_SPRINTF_MIN_BUFFER_SIZE];
     char airport_code_b_str[AIRPORT_CODE_SPRINTF_MIN_BUFFER_SIZE];
-    airport_code_sprintf(airport_code_a_str, airport_median_a->airport_code);
-    airport_code_sprintf(airport_code_b_str, airport_median_b->airport_code);
+    airport_code_sprintf(airport_code_a_str, airport_median_a->airport);
+    airport_code_sprintf(airport_code_b_str, airport_median_b->airport);
 
     return strcmp(airport_code_a_str, airport_code_b_str);
 }
 
+/**
+ * @struct q07_statistical_data_t
+ * @brief  Airports with the largest departure delay medians, for queries of type 7.
+ *
+ * @var q07_statistical_data_t::length
+ *     @brief Number of airports in ::q07_statistical_data_t::airport_medians.
+ * @var q07_statistical_data_t::airport_medians
+ *     @brief Airports and their medians, sorted like in ::database_get_origin_delay_medians.
+ */
+typedef struct {
+    size_t                               length;
+    const index_manager_airport_delay_t *airport_medians;
+} q07_statistical_data_t;
+
 /**
  * @brief Generates statistical data for queries of type 7.
  *
  * @param database  Database, to iterate through flights.
  * @param n         Number of query instances that will need to be executed.
  * @param instances Query instances that will need to be executed.
+ * @param allocator Arena where to allocate the statistical data.
  *
- * @return A sorted `GArray` of ::q07_airport_median.
+ * @return A pointer to a ::q07_statistical_data_t, containing only as many airports as the largest
+ *         N requested in @p instances, or `NULL` on allocation failure or if the queries were
+ *         cancelled. Medians are approximate when ::query_type_get_approximate is enabled.
  */
 void *__q07_generate_statistics(const database_t             *database,
                                 size_t                        n,
-                                const query_instance_t *const instances[n]) {
-    (void) instances;
-    (void) n;
-
-    /* Associate each airport with list of delays */
-    GHashTable *const airport_delays =
-        g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_array_unref);
-    flight_manager_iter(database_get_flights(database),
-                        __q07_generate_statistics_foreach_flight,
-                        airport_delays);
-
-    /* Calulate sorted array of airports with delays */
-    GArray *const airport_medians = g_array_new(FALSE, FALSE, sizeof(q07_airport_median));
-    g_hash_table_foreach(airport_delays,
-                         __q07_generate_statistics_foreach_airport,
-                         airport_medians);
-    g_array_sort(airport_medians, __q07_generate_statistics_airport_median_compare_func);
-
-    g_hash_table_unref(airport_delays);
-    return airport_medians;
+                                const query_instance_t *const instances[n],
+                                arena_t                      *allocator) {
+    /* Only the airports that will be output need to be kept */
+    size_t max_n = 0;
+    for (size_t i = 0; i < n; ++i)
+        max_n = max(max_n, GPOINTER_TO_UINT(query_instance_get_argument_data(instances[i])));
+
+    q07_statistical_data_t *const ret = arena_allocate(allocator, sizeof(q07_statistical_data_t));
+    if (!ret)
+        return NULL;
+
+    if (!query_type_get_approximate()) {
+        /* Exact medians are ranked once, when flights are indexed */
+        const GArray *const ranked = database_get_origin_delay_medians(database);
+        ret->length                = min(max_n, ranked->len);
+        ret->airport_medians =
+            arena_put(allocator, ranked->data, ret->length * sizeof(index_manager_airport_delay_t));
+        return ret->airport_medians ? ret : NULL;
+    }
+
+    top_k_t *const airport_medians =
+        top_k_create(sizeof(index_manager_airport_delay_t),
+                     max_n,
+                     __q07_generate_statistics_airport_median_compare_func);
+    if (!airport_medians)
+        return NULL;
+
+    if (__q07_generate_statistics_approximate(database,
+                                              query_instance_get_cancellation(instances[0]),
+                                              airport_medians)) {
+        top_k_free(airport_medians);
+        return NULL;
+    }
+
+    GArray *const sorted = top_k_free_to_array(airport_medians);
+    ret->length          = sorted->len;
+    ret->airport_medians =
+        arena_put(allocator, sorted->data, sorted->len * sizeof(index_manager_airport_delay_t));
+    g_array_unref(sorted);
+    return ret->airport_medians ? ret : NULL;
 }
 
 /**
- * @brief Executes a query of type 7.
+ * @brief   Gets the key of the statistical data needed by a query of type 7.
+ * @details Statistics generated for a single query only contain as many airports as that query
+ *          displays.
  *
- * @param database   Database to get data from (not used, as all data is collected in
- *                   ::__q07_generate_statistics).
- * @param statistics Value returned by ::__q07_generate_statistics (a sorted `GArray` of
- *                   ::q07_airport_median.)
- * @param instance   Query instance to be executed.
- * @param output     Where to write the query's output to.
+ * @param argument_data Value returned by ::__q07_parse_arguments (an integer encoded as a
+ *                      pointer).
  *
- * @retval 0 Always successful.
+ * @return The number of airports to be displayed.
  */
-int __q07_execute(const database_t       *database,
-                  const void             *statistics,
-                  const query_instance_t *instance,
-                  query_writer_t         *output) {
+uint64_t __q07_statistics_key(const void *argument_data) {
+    return GPOINTER_TO_UINT(argument_data);
+}
+
+int q07_execute(const database_t       *database,
+                const void             *statistics,
+                const query_instance_t *instance,
+                query_writer_t         *output) {
     (void) database;
 
-    const uint64_t      n = GPOINTER_TO_UINT(query_instance_get_argument_data(instance));
-    const GArray *const airport_medians = statistics;
+    const uint64_t n = GPOINTER_TO_UINT(query_instance_get_argument_data(instance));
+    const q07_statistical_data_t *const stats = statistics;
 
-    const size_t i_max = min(n, airport_medians->len);
+    const size_t i_max = min(n, stats->length);
     for (size_t i = 0; i < i_max; i++) {
-        const q07_airport_median *const airport_median =
-            &g_array_index(airport_medians, q07_airport_median, i);
+        const index_manager_airport_delay_t *const airport_median = &stats->airport_medians[i];
 
         char airport_code_str[AIRPORT_CODE_SPRINTF_MIN_BUFFER_SIZE];
-        airport_code_sprintf(airport_code_str, airport_median->airport_code);
+        airport_code_sprintf(airport_code_str, airport_median->airport);
 
         query_writer_write_new_object(output);
         query_writer_write_new_field(output, "name", "%s", airport_code_str);
-        query_writer_write_new_field(output, "median", "%" PRIu64, airport_median->median);
+        query_writer_write_new_field(output, "median", "%" PRIu64, airport_median->median_delay);
     }
     return 0;
 }
@@ -241,9 +316,13 @@ int __q07_execute(const database_t       *database,
 query_type_t *q07_create(void) {
     return query_type_create(7,
                              __q07_parse_arguments,
-                             __q07_clone_arguments,
-                             __q07_free_arguments,
                              __q07_generate_statistics,
-                             (query_type_free_statistics_callback_t) g_array_unref,
-                             __q07_execute);
+                             NULL,
+                             __q07_statistics_key,
+                             q07_execute,
+                             NULL,
+                             NULL,
+                             NULL,
+                             NULL,
+                             NULL);
 }
@@ -19,11 +19,22 @@
  * @brief Implementation of methods in include/queries/q08.h
  */
 
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #include <immintrin.h>
+
+    /** @brief Defined when SIMD implementations of ::q08_revenue_kernel_t are available. */
+    #define Q08_X86_KERNELS
+#endif
 
 #include "queries/q08.h"
 #include "queries/query_instance.h"
+#include "utils/cpu_features.h"
+#include "utils/int_utils.h"
 
 /**
  * @struct q08_parsed_arguments_t
@@ -46,205 +57,388 @@ typedef struct {
  * @brief   Parses arguments for query 8.
  * @details Asserts that there's three arguments, an hotel identifier and two dates.
  *
- * @param argc Number of arguments.
- * @param argv Values of the arguments.
+ * @param argc      Number of arguments.
+ * @param argv      Values of the arguments.
+ * @param allocator Arena where to allocate the parsed arguments.
  *
  * @return `NULL` on parsing or allocation failure, a pointer to a ::q08_parsed_arguments_t
  *         otherwise.
  */
-void *__q08_parse_arguments(size_t argc, char *const argv[argc]) {
+void *__q08_parse_arguments(size_t argc, char *const argv[argc], arena_t *allocator) {
     if (argc != 3)
         return NULL;
 
-    q08_parsed_arguments_t *const parsed_arguments = malloc(sizeof(q08_parsed_arguments_t));
-    if (!parsed_arguments)
-        return NULL;
+    q08_parsed_arguments_t parsed_arguments;
 
-    const int hotel_retval      = hotel_id_from_string(&parsed_arguments->hotel_id, argv[0]);
-    const int begin_date_retval = date_from_string(&parsed_arguments->begin_date, argv[1]);
-    const int end_date_retval   = date_from_string(&parsed_arguments->end_date, argv[2]);
+    const int hotel_retval      = hotel_id_from_string(&parsed_arguments.hotel_id, argv[0]);
+    const int begin_date_retval = date_from_string(&parsed_arguments.begin_date, argv[1]);
+    const int end_date_retval   = date_from_string(&parsed_arguments.end_date, argv[2]);
 
-    if (hotel_retval || begin_date_retval || end_date_retval) {
-        free(parsed_arguments);
+    if (hotel_retval || begin_date_retval || end_date_retval)
         return NULL;
-    }
-    return parsed_arguments;
+    return arena_put(allocator, &parsed_arguments, sizeof(q08_parsed_arguments_t));
 }
 
 /**
- * @brief  Creates a deep clone of the value returned by ::__q08_parse_arguments.
- * @param  args_data Non-`NULL` value returned by ::__q08_parse_arguments (a pointer to a
- *                   ::q08_parsed_arguments_t).
- * @return A deep copy of @p args_data.
+ * @brief Type of a method that calculates the revenue of a hotel in a date range.
+ *
+ * @param n                Number of reservations.
+ * @param first_nights     Day numbers of the first night of every reservation.
+ * @param last_nights      Day numbers of the last night of every reservation.
+ * @param prices_per_night Price per night of every reservation.
+ * @param begin            Day number of the beginning of the date range (inclusive).
+ * @param end              Day number of the end of the date range (inclusive).
+ *
+ * @return The sum of the revenues of all reservations in the date range.
  */
-void *__q08_clone_arguments(const void *args_data) {
-    const q08_parsed_arguments_t *const args  = args_data;
-    q08_parsed_arguments_t *const       clone = malloc(sizeof(q08_parsed_arguments_t));
-    if (!clone)
-        return NULL;
-
-    memcpy(clone, args, sizeof(q08_parsed_arguments_t));
-    return clone;
-}
+typedef int64_t (*q08_revenue_kernel_t)(size_t         n,
+                                        const int32_t *first_nights,
+                                        const int32_t *last_nights,
+                                        const int32_t *prices_per_night,
+                                        int32_t        begin,
+                                        int32_t        end);
 
 /**
- * @struct q08_statistical_data_t
- * @brief  Association between query instances and hotel revenue prices.
- *
- * @var q08_statistical_data_t::n
- *     @brief Number of query instances (same as ::q08_statistical_data_t::filters and
- *            ::q08_statistical_data_t::revenues).
- * @var q08_statistical_data_t::filters
- *     @brief Query instances that need to be answered.
- * @var q08_statistical_data_t::revenues
- *     @brief Revenues of hotels (associated to ::q08_statistical_data_t::filters).
+ * @brief Scalar implementation of ::q08_revenue_kernel_t, for when no SIMD extensions are
+ *        available (and for the elements left after a SIMD implementation's last full block).
  */
-typedef struct {
-    size_t                  n;
-    q08_parsed_arguments_t *filters;
-    uint64_t               *revenues;
-} q08_statistical_data_t;
+int64_t __q08_revenue_scalar(size_t         n,
+                             const int32_t *first_nights,
+                             const int32_t *last_nights,
+                             const int32_t *prices_per_night,
+                             int32_t        begin,
+                             int32_t        end) {
+    int64_t revenue = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (begin > last_nights[i] || first_nights[i] > end)
+            continue;
 
-/**
- * @brief   A method called for each reservation, to calculate the revenue of a hotel.
- * @details An auxiliary method for ::__q08_generate_statistics.
- *
- * @param user_data   A pointer to a ::q08_statistical_data_t.
- * @param reservation Reservation being processed.
- *
- * @retval 0 Always successful.
- */
-int __q08_generate_statistics_foreach_reservation(void                *user_data,
-                                                  const reservation_t *reservation) {
-    q08_statistical_data_t *const stats    = user_data;
-    const hotel_id_t              hotel_id = reservation_get_hotel_id(reservation);
-
-    for (size_t i = 0; i < stats->n; i++) {
-        const q08_parsed_arguments_t *const args = &stats->filters[i];
-
-        if (hotel_id == args->hotel_id) {
-            const uint16_t price_per_night   = reservation_get_price_per_night(reservation);
-            const date_t   reservation_begin = reservation_get_begin_date(reservation);
-            date_t         reservation_end   = reservation_get_end_date(reservation);
-
-            /* Reservations don't make money on their last day */
-            date_set_day(&reservation_end, date_get_day(reservation_end) - 1);
-            if (date_diff(args->begin_date, reservation_end) > 0 ||
-                date_diff(reservation_begin, args->end_date) > 0)
-                continue;
-
-            const date_t range_begin = date_diff(reservation_begin, args->begin_date) < 0
-                                           ? args->begin_date
-                                           : reservation_begin;
-            const date_t range_end =
-                date_diff(reservation_end, args->end_date) < 0 ? reservation_end : args->end_date;
-
-            stats->revenues[i] += price_per_night * (date_diff(range_end, range_begin) + 1);
-        }
+        const int32_t range_begin = first_nights[i] < begin ? begin : first_nights[i];
+        const int32_t range_end   = last_nights[i] < end ? last_nights[i] : end;
+        revenue += (int64_t) prices_per_night[i] * (range_end - range_begin + 1);
     }
+    return revenue;
+}
+
+#ifdef Q08_X86_KERNELS
+/** @brief SSE4.1 implementation of ::q08_revenue_kernel_t, processing 4 reservations at a time. */
+__attribute__((target("sse4.1"))) int64_t __q08_revenue_sse41(size_t         n,
+                                                              const int32_t *first_nights,
+                                                              const int32_t *last_nights,
+                                                              const int32_t *prices_per_night,
+                                                              int32_t        begin,
+                                                              int32_t        end) {
+    const __m128i begin_vec = _mm_set1_epi32(begin);
+    const __m128i end_vec   = _mm_set1_epi32(end);
+    const __m128i one_vec   = _mm_set1_epi32(1);
+    __m128i       revenue   = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i first = _mm_loadu_si128((const __m128i *) (first_nights + i));
+        const __m128i last  = _mm_loadu_si128((const __m128i *) (last_nights + i));
+        const __m128i price = _mm_loadu_si128((const __m128i *) (prices_per_night + i));
+
+        /* Reservations outside the date range are given a price of 0 */
+        const __m128i outside =
+            _mm_or_si128(_mm_cmpgt_epi32(begin_vec, last), _mm_cmpgt_epi32(first, end_vec));
+        const __m128i inside_price = _mm_andnot_si128(outside, price);
+        const __m128i nights       = _mm_add_epi32(
+            _mm_sub_epi32(_mm_min_epi32(last, end_vec), _mm_max_epi32(first, begin_vec)),
+            one_vec);
+
+        /* 64-bit products, for even and odd lanes separately */
+        const __m128i even = _mm_mul_epi32(inside_price, nights);
+        const __m128i odd =
+            _mm_mul_epi32(_mm_srli_epi64(inside_price, 32), _mm_srli_epi64(nights, 32));
+        revenue = _mm_add_epi64(revenue, _mm_add_epi64(even, odd));
+    }
+
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i *) lanes, revenue);
+    return lanes[0] + lanes[1] +
+           __q08_revenue_scalar(n - i,
+                                first_nights + i,
+                                last_nights + i,
+                                prices_per_night + i,
+                                begin,
+                                end);
+}
+
+/** @brief AVX2 implementation of ::q08_revenue_kernel_t, processing 8 reservations at a time. */
+__attribute__((target("avx2"))) int64_t __q08_revenue_avx2(size_t         n,
+                                                           const int32_t *first_nights,
+                                                           const int32_t *last_nights,
+                                                           const int32_t *prices_per_night,
+                                                           int32_t        begin,
+                                                           int32_t        end) {
+    const __m256i begin_vec = _mm256_set1_epi32(begin);
+    const __m256i end_vec   = _mm256_set1_epi32(end);
+    const __m256i one_vec   = _mm256_set1_epi32(1);
+    __m256i       revenue   = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i first = _mm256_loadu_si256((const __m256i *) (first_nights + i));
+        const __m256i last  = _mm256_loadu_si256((const __m256i *) (last_nights + i));
+        const __m256i price = _mm256_loadu_si256((const __m256i *) (prices_per_night + i));
+
+        /* Reservations outside the date range are given a price of 0 */
+        const __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(begin_vec, last),
+                                                _mm256_cmpgt_epi32(first, end_vec));
+        const __m256i inside_price = _mm256_andnot_si256(outside, price);
+        const __m256i nights       = _mm256_add_epi32(
+            _mm256_sub_epi32(_mm256_min_epi32(last, end_vec), _mm256_max_epi32(first, begin_vec)),
+            one_vec);
+
+        /* 64-bit products, for even and odd lanes separately */
+        const __m256i even = _mm256_mul_epi32(inside_price, nights);
+        const __m256i odd =
+            _mm256_mul_epi32(_mm256_srli_epi64(inside_price, 32), _mm256_srli_epi64(nights, 32));
+        revenue = _mm256_add_epi64(revenue, _mm256_add_epi64(even, odd));
+    }
+
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i *) lanes, revenue);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+           __q08_revenue_scalar(n - i,
+                                first_nights + i,
+                                last_nights + i,
+                                prices_per_night + i,
+                                begin,
+                                end);
+}
+#endif
+
+/** @brief Implementations of ::q08_revenue_kernel_t, from the best to the worst. */
+const q08_revenue_kernel_t q08_revenue_kernels[] = {
+#ifdef Q08_X86_KERNELS
+    __q08_revenue_avx2,
+    __q08_revenue_sse41,
+#endif
+    __q08_revenue_scalar};
+
+/** @brief CPU features required by each implementation in ::q08_revenue_kernels. */
+const unsigned int q08_revenue_kernel_requirements[] = {
+#ifdef Q08_X86_KERNELS
+    CPU_FEATURE_AVX2,
+    CPU_FEATURE_SSE41,
+#endif
+    0};
+
+/** @brief Number of implementations in ::q08_revenue_kernels. */
+#define Q08_REVENUE_KERNEL_COUNT (sizeof(q08_revenue_kernels) / sizeof(*q08_revenue_kernels))
+
+/** @brief Best implementation of ::q08_revenue_kernel_t for the CPU running the program. */
+q08_revenue_kernel_t __q08_revenue_kernel = __q08_revenue_scalar;
+
+/** @brief Automatically chooses ::__q08_revenue_kernel when the program starts. */
+void __attribute__((constructor)) __q08_revenue_kernel_select(void) {
+    __q08_revenue_kernel = q08_revenue_kernels[cpu_features_select(q08_revenue_kernel_requirements,
+                                                                   Q08_REVENUE_KERNEL_COUNT)];
+}
 
+/** @brief Largest number of reservations ::q08_verify_revenue_kernels generates. */
+#define Q08_VERIFY_MAX_RESERVATIONS 67
+
+int q08_verify_revenue_kernels(void) {
+    int32_t first_nights[Q08_VERIFY_MAX_RESERVATIONS], last_nights[Q08_VERIFY_MAX_RESERVATIONS],
+        prices_per_night[Q08_VERIFY_MAX_RESERVATIONS];
+
+    /* Linear congruential generator, so that verification is reproducible */
+    uint32_t state = 1;
+    for (size_t n = 0; n <= Q08_VERIFY_MAX_RESERVATIONS; ++n) {
+        for (size_t i = 0; i < n; ++i) {
+            state               = state * 1103515245 + 12345;
+            first_nights[i]     = (state >> 8) % 400;
+            last_nights[i]      = first_nights[i] + (state >> 20) % 30;
+            prices_per_night[i] = (state >> 4) % 1000 + 1;
+        }
+
+        for (int32_t begin = -10; begin < 450; begin += 37) {
+            for (int32_t end = begin - 40; end < 450; end += 29) { /* Including reversed ranges */
+                const int64_t expected = __q08_revenue_scalar(n,
+                                                              first_nights,
+                                                              last_nights,
+                                                              prices_per_night,
+                                                              begin,
+                                                              end);
+
+                for (size_t k = 0; k < Q08_REVENUE_KERNEL_COUNT; ++k) {
+                    const unsigned int requirements = q08_revenue_kernel_requirements[k];
+                    if ((cpu_features_get() & requirements) != requirements)
+                        continue;
+
+                    if (q08_revenue_kernels[k](n,
+                                               first_nights,
+                                               last_nights,
+                                               prices_per_night,
+                                               begin,
+                                               end) != expected)
+                        return 1;
+                }
+            }
+        }
+    }
     return 0;
 }
 
 /**
- * @brief Generates statistical data for queries of type 8.
+ * @brief   Calculates the revenue of a hotel in a date range.
+ * @details Uses the hotel's revenue prefix sums when available (two lookups), and
+ *          ::__q08_revenue_kernel otherwise, so that latency doesn't depend on the number of
+ *          reservations in the hotel.
  *
- * @param database   Database, to iterate through reservations.
- * @param n          Number of query instances.
- * @param instances  Instances of the query 8.
+ * @param nights Nights of the reservations in the hotel.
+ * @param begin  Day number of the beginning of the date range (inclusive).
+ * @param end    Day number of the end of the date range (inclusive).
  *
- * @return A pointer to a ::q08_statistical_data_t on success, or `NULL` on allocation failure.
+ * @return The revenue of the hotel in the date range.
  */
-void *__q08_generate_statistics(const database_t             *database,
-                                size_t                        n,
-                                const query_instance_t *const instances[n]) {
+int64_t __q08_calculate_revenue(const index_manager_hotel_nights_t *nights,
+                                int32_t                             begin,
+                                int32_t                             end) {
+    /* Reversed date ranges are left to the kernel, whose results prefix sums can't reproduce */
+    if (!nights->revenue_prefix || begin > end)
+        return __q08_revenue_kernel(nights->length,
+                                    nights->first_nights,
+                                    nights->last_nights,
+                                    nights->prices_per_night,
+                                    begin,
+                                    end);
+
+    /* Clamp the date range to the days covered by the prefix sums */
+    const int64_t first = max((int64_t) begin - nights->first_day, 0);
+    const int64_t last  = min((int64_t) end - nights->first_day, (int64_t) nights->days - 1);
+    if (first > last)
+        return 0;
+    return nights->revenue_prefix[last + 1] - nights->revenue_prefix[first];
+}
 
-    q08_statistical_data_t *const stats = malloc(sizeof(q08_statistical_data_t));
-    if (!stats)
-        return NULL;
-    stats->n = n;
+/** @brief Number of queries whose results ::__q08_execute_batch calculates before writing them. */
+#define Q08_BATCH_CHUNK_SIZE 64
 
-    stats->filters = malloc(n * sizeof(q08_parsed_arguments_t));
-    if (!stats->filters) {
-        free(stats);
-        return NULL;
-    }
+/**
+ * @brief   Method called to execute many queries of type 8 at once.
+ * @details The revenues of a chunk of queries are all calculated before any of them is written, so
+ *          that lookups and calculations aren't interleaved with formatting.
+ *
+ * @param database   Database to get the hotels' reservations from.
+ * @param statistics Statistical data (not used, as the hotels' reservations are indexed in
+ *                   @p database).
+ * @param n          Number of queries in @p instances.
+ * @param instances  Query instances to be executed.
+ * @param outputs    Where to write the result of each query to.
+ *
+ * @retval 0 Always successful.
+ */
+int __q08_execute_batch(const database_t             *database,
+                        const void                   *statistics,
+                        size_t                        n,
+                        const query_instance_t *const instances[n],
+                        query_writer_t *const         outputs[n]) {
+    (void) statistics;
+
+    for (size_t start = 0; start < n; start += Q08_BATCH_CHUNK_SIZE) {
+        const size_t chunk = min(n - start, Q08_BATCH_CHUNK_SIZE);
+
+        int64_t revenues[Q08_BATCH_CHUNK_SIZE];
+        for (size_t i = 0; i < chunk; ++i) {
+            const q08_parsed_arguments_t *const args =
+                query_instance_get_argument_data(instances[start + i]);
+            const index_manager_hotel_nights_t *const nights =
+                database_get_hotel_nights(database, args->hotel_id);
+
+            revenues[i] = 0;
+            if (nights)
+                revenues[i] = __q08_calculate_revenue(nights,
+                                                      date_to_day_number(args->begin_date),
+                                                      date_to_day_number(args->end_date));
+        }
 
-    stats->revenues = malloc(n * sizeof(uint64_t));
-    if (!stats->revenues) {
-        free(stats->filters);
-        free(stats);
-        return NULL;
+        for (size_t i = 0; i < chunk; ++i) {
+            query_writer_write_new_object(outputs[start + i]);
+            query_writer_write_new_field(outputs[start + i],
+                                         "revenue",
+                                         "%" PRIu64,
+                                         (uint64_t) revenues[i]);
+        }
     }
 
-    for (size_t i = 0; i < n; ++i) {
-        const q08_parsed_arguments_t *const argument_data =
-            query_instance_get_argument_data(instances[i]);
-
-        stats->filters[i]  = *argument_data;
-        stats->revenues[i] = 0;
-    }
+    return 0;
+}
 
-    reservation_manager_iter(database_get_reservations(database),
-                             __q08_generate_statistics_foreach_reservation,
-                             stats);
-    return stats;
+int q08_execute(const database_t       *database,
+                const void             *statistics,
+                const query_instance_t *instance,
+                query_writer_t         *output) {
+    return __q08_execute_batch(database, statistics, 1, &instance, &output);
 }
 
 /**
- * @brief Frees statistical data generated by ::__q08_generate_statistics.
- * @param statistical_data Non-`NULL` value returned by ::__q08_generate_statistics.
+ * @brief   Gets the partition of a database a query of type 8 is sent to.
+ * @details Reservations of a hotel may be in any partition, so the query is sent to all of them.
+ *
+ * @param argument_data Arguments of the query (not used).
+ * @param npartitions   Number of partitions (not used).
+ *
+ * @return ::QUERY_TYPE_PARTITION_ALL.
  */
-void __q08_free_statistics(void *statistical_data) {
-    q08_statistical_data_t *const stats = statistical_data;
-    free(stats->revenues);
-    free(stats->filters);
-    free(stats);
+size_t __q08_partition(const void *argument_data, size_t npartitions) {
+    (void) argument_data;
+    (void) npartitions;
+    return QUERY_TYPE_PARTITION_ALL;
 }
 
 /**
- * @brief Method called to execute a query of type 8.
+ * @brief   Merges the outputs of a query of type 8, from many partitions of a dataset.
+ * @details Each partition's revenue only comes from its own reservations, so revenues are added.
  *
- * @param database   Database to get data from (not used, as all data is collected in
- *                   ::__q08_generate_statistics).
- * @param statistics Statistical data generated by ::__q08_generate_statistics (a pointer to a
- *                   ::q08_statistical_data_t).
- * @param instance   Query instance to be executed.
- * @param output     Where to write the query's result to.
+ * @param argument_data Arguments of the query (not used).
+ * @param n             Number of partitions.
+ * @param partials      Output of each partition.
+ * @param lengths       Number of characters in each of @p partials.
+ * @param output        Where to write the query's result to.
  *
  * @retval 0 Success.
- * @retval 1 Fatal failure (should, in principle, be unreachable).
+ * @retval 1 Malformed partial output.
  */
-int __q08_execute(const database_t       *database,
-                  const void             *statistics,
-                  const query_instance_t *instance,
-                  query_writer_t         *output) {
-    (void) database;
-
-    const q08_statistical_data_t *const stats     = statistics;
-    const q08_parsed_arguments_t *const arguments = query_instance_get_argument_data(instance);
-
-    for (size_t i = 0; i < stats->n; ++i) {
-        if (stats->filters[i].hotel_id == arguments->hotel_id &&
-            stats->filters[i].begin_date == arguments->begin_date &&
-            stats->filters[i].end_date == arguments->end_date) {
-
-            query_writer_write_new_object(output);
-            query_writer_write_new_field(output, "revenue", "%" PRIu64, stats->revenues[i]);
-            return 0;
-        }
+int __q08_merge(const void       *argument_data,
+                size_t            n,
+                const char *const partials[n],
+                const size_t      lengths[n],
+                query_writer_t   *output) {
+    (void) argument_data;
+
+    uint64_t revenue = 0;
+    for (size_t i = 0; i < n; ++i) {
+        char partial[32];
+        if (lengths[i] >= sizeof(partial))
+            return 1;
+        memcpy(partial, partials[i], lengths[i]);
+        partial[lengths[i]] = '\0';
+
+        uint64_t partial_revenue;
+        if (sscanf(partial, "%" SCNu64, &partial_revenue) != 1)
+            return 1;
+        revenue += partial_revenue; /* Wraps around like the casts of negative revenues */
     }
 
-    fprintf(stderr, "Bad statistical data in query 8! This should not happen!\n");
-    return 1;
+    query_writer_write_new_object(output);
+    query_writer_write_new_field(output, "revenue", "%" PRIu64, revenue);
+    return 0;
 }
 
 query_type_t *q08_create(void) {
     return query_type_create(8,
                              __q08_parse_arguments,
-                             __q08_clone_arguments,
-                             free,
-                             __q08_generate_statistics,
-                             __q08_free_statistics,
-                             __q08_execute);
+                             NULL,
+                             NULL,
+                             NULL,
+                             q08_execute,
+                             __q08_execute_batch,
+                             NULL,
+                             NULL,
+                             __q08_partition,
+                             __q08_merge);
 }
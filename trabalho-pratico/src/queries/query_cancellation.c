@@ -0,0 +1,103 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  query_cancellation.c
+ * @brief Implementation of methods in include/queries/query_cancellation.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref query_cancellation_examples).
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "queries/query_cancellation.h"
+
+/**
+ * @struct query_cancellation
+ * @brief  A way to stop queries that are taking too long.
+ *
+ * @var query_cancellation::cancelled
+ *     @brief Whether ::query_cancellation_cancel was called. Accessed atomically.
+ * @var query_cancellation::deadline
+ *     @brief Time (`CLOCK_MONOTONIC`, in nanoseconds) after which queries are cancelled, or `0`
+ *            for no deadline.
+ */
+struct query_cancellation {
+    int      cancelled;
+    uint64_t deadline;
+};
+
+query_cancellation_t *query_cancellation_create(void) {
+    query_cancellation_t *const cancellation = malloc(sizeof(query_cancellation_t));
+    if (!cancellation)
+        return NULL;
+
+    cancellation->cancelled = 0;
+    cancellation->deadline  = 0;
+    return cancellation;
+}
+
+uint64_t query_cancellation_get_default_timeout(void) {
+    const char *const timeout_env = getenv(QUERY_CANCELLATION_TIMEOUT_ENVIRONMENT_VARIABLE);
+    if (!timeout_env)
+        return 0;
+
+    char *end;
+    errno                        = 0;
+    const unsigned long long ret = strtoull(timeout_env, &end, 10);
+    if (errno || *end || end == timeout_env)
+        return 0;
+    return ret;
+}
+
+/**
+ * @brief   Gets the current time, to be compared with ::query_cancellation::deadline.
+ * @details Auxiliary method for ::query_cancellation_start and ::query_cancellation_has_timed_out.
+ * @return  Nanoseconds since an arbitrary instant (`CLOCK_MONOTONIC`).
+ */
+uint64_t __query_cancellation_get_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + (uint64_t) now.tv_nsec;
+}
+
+void query_cancellation_start(query_cancellation_t *cancellation, uint64_t timeout) {
+    __atomic_store_n(&cancellation->cancelled, 0, __ATOMIC_RELAXED);
+    cancellation->deadline = timeout ? __query_cancellation_get_time() + timeout * 1000000 : 0;
+}
+
+void query_cancellation_cancel(query_cancellation_t *cancellation) {
+    __atomic_store_n(&cancellation->cancelled, 1, __ATOMIC_RELAXED);
+}
+
+int query_cancellation_is_cancelled(const query_cancellation_t *cancellation) {
+    if (!cancellation)
+        return 0;
+
+    return __atomic_load_n(&cancellation->cancelled, __ATOMIC_RELAXED) ||
+           query_cancellation_has_timed_out(cancellation);
+}
+
+int query_cancellation_has_timed_out(const query_cancellation_t *cancellation) {
+    return cancellation->deadline && __query_cancellation_get_time() >= cancellation->deadline;
+}
+
+void query_cancellation_free(query_cancellation_t *cancellation) {
+    free(cancellation);
+}
@@ -22,13 +22,253 @@
  * See [the header file's documentation](@ref query_dispatcher_examples).
  */
 
+#include <glib.h>
+#include <pthread.h>
 #include <stddef.h>
+#include <time.h>
 
 #include "queries/query_dispatcher.h"
+#include "queries/query_explain.h"
+#include "queries/query_slow_log.h"
+#include "queries/query_type_list.h"
+#include "testing/performance_probes.h"
+#include "testing/performance_trace.h"
+#include "utils/memory_budget.h"
+#include "utils/thread_pool.h"
 
-int query_dispatcher_dispatch_single(const database_t       *database,
-                                     const query_instance_t *query_instance,
-                                     query_writer_t         *output) {
+/** @brief Names of the generation of statistical data for each query type, in a trace. */
+const char *const query_dispatcher_trace_statistics_names[QUERY_TYPE_LIST_COUNT + 1] = {
+    "Statistics",
+    "Q1 statistics",
+    "Q2 statistics",
+    "Q3 statistics",
+    "Q4 statistics",
+    "Q5 statistics",
+    "Q6 statistics",
+    "Q7 statistics",
+    "Q8 statistics",
+    "Q9 statistics",
+    "Q10 statistics"};
+
+/** @brief Names of the execution of queries of each type, in a trace. */
+const char *const query_dispatcher_trace_execute_names[QUERY_TYPE_LIST_COUNT + 1] = {
+    "Execute",
+    "Q1 execute",
+    "Q2 execute",
+    "Q3 execute",
+    "Q4 execute",
+    "Q5 execute",
+    "Q6 execute",
+    "Q7 execute",
+    "Q8 execute",
+    "Q9 execute",
+    "Q10 execute"};
+
+/**
+ * @brief  Gets the name of a phase of a query type, in a trace (see ::performance_trace_begin).
+ *
+ * @param names    ::query_dispatcher_trace_statistics_names or
+ *                 ::query_dispatcher_trace_execute_names.
+ * @param type_num Number of the query type.
+ *
+ * @return The name of the phase of query type @p type_num.
+ */
+const char *__query_dispatcher_get_trace_name(const char *const *names, size_t type_num) {
+    return type_num <= QUERY_TYPE_LIST_COUNT ? names[type_num] : names[0];
+}
+
+/**
+ * @brief  Reads a monotonic clock, to measure the phases of queries for the slow query log.
+ * @return The current time, in nanoseconds.
+ */
+uint64_t __query_dispatcher_get_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * @brief   Checks if a query was cancelled, marking its output as incomplete if so.
+ * @details Called before executing a query, so that cancelled queries aren't started, and after,
+ *          as cancelled queries stop early.
+ *
+ * @param instance Query to be checked.
+ * @param output   Where @p instance's result is written to.
+ *
+ * @return Whether @p instance was cancelled (see ::query_instance_is_cancelled).
+ */
+int __query_dispatcher_mark_cancelled(const query_instance_t *instance, query_writer_t *output) {
+    if (!query_instance_is_cancelled(instance))
+        return 0;
+
+    query_writer_set_incomplete(output);
+    return 1;
+}
+
+/**
+ * @brief   Executes a query, and writes it to the slow query log if it took too long.
+ * @details The time spent formatting the output is measured by @p output.
+ *
+ * @param log               Log of slow queries.
+ * @param database          Database, so that the query can get information.
+ * @param statistics        Statistical data for the query (can be `NULL`).
+ * @param statistics_time   Nanoseconds spent generating (or looking up) @p statistics.
+ * @param statistics_shared Number of queries @p statistics was generated for.
+ * @param instance          Query to be executed.
+ * @param output            Where the query's result should be written to.
+ */
+void __query_dispatcher_execute_logged(query_slow_log_t       *log,
+                                       const database_t       *database,
+                                       const void             *statistics,
+                                       uint64_t                statistics_time,
+                                       size_t                  statistics_shared,
+                                       const query_instance_t *instance,
+                                       query_writer_t         *output) {
+
+    query_writer_set_measure_formatting(output, 1);
+    const uint64_t start = __query_dispatcher_get_time();
+    query_type_list_execute(database, statistics, instance, output); /* Ignore returned result */
+    const uint64_t execution_time = __query_dispatcher_get_time() - start;
+    query_writer_set_measure_formatting(output, 0);
+
+    const uint64_t total_time = statistics_time / statistics_shared + execution_time;
+    if (!query_slow_log_is_slow(log, total_time / 1000))
+        return;
+
+    const query_slow_log_entry_t entry = {
+        .query             = instance,
+        .statistics        = statistics_time / 1000,
+        .statistics_shared = statistics_shared,
+        .execution         = execution_time / 1000,
+        .formatting        = query_writer_get_formatting_time(output) / 1000,
+        .records           = query_writer_get_object_count(output),
+        .output_size       = query_writer_get_output_size(output)};
+    query_slow_log_write(log, &entry);
+}
+
+/**
+ * @brief   Finishes measuring an explained query, and writes it to a report.
+ * @details The execution of the query is measured from @p start and @p access_mark.
+ *
+ * @param explain     Report to write to.
+ * @param entry       How the query was executed, except for its execution measurements, which are
+ *                    filled in.
+ * @param start       Time when the query started executing (see ::__query_dispatcher_get_time).
+ * @param access_mark Records read by the thread when the query started executing (see
+ *                    ::performance_access_start).
+ * @param output      Where the query's result was written to.
+ */
+void __query_dispatcher_write_explained(query_explain_t            *explain,
+                                        query_explain_entry_t      *entry,
+                                        uint64_t                    start,
+                                        const performance_access_t *access_mark,
+                                        query_writer_t             *output) {
+    entry->execution_time = __query_dispatcher_get_time() - start;
+    performance_access_stop(access_mark, &entry->execution_access);
+    entry->rows        = query_writer_get_object_count(output);
+    entry->output_size = query_writer_get_output_size(output);
+    query_explain_write(explain, entry);
+}
+
+int query_dispatcher_dispatch_single(const database_t         *database,
+                                     const query_instance_t   *query_instance,
+                                     query_writer_t           *output,
+                                     query_statistics_cache_t *statistics_cache,
+                                     query_materializer_t     *materializer,
+                                     performance_metrics_t    *metrics) {
+
+    if (__query_dispatcher_mark_cancelled(query_instance, output))
+        return 0;
+
+    query_explain_t *const explain   = query_explain_get_shared();
+    const int              explained = query_explain_is_explained(explain, query_instance);
+    query_explain_entry_t  entry     = {.query            = query_instance,
+                                        .path             = QUERY_EXPLAIN_PATH_MATERIALIZED,
+                                        .statistics_cache = QUERY_EXPLAIN_CACHE_NONE,
+                                        .estimated        = 0,
+                                        .shared           = 1};
+    performance_access_t   access_mark   = {{0}, {0}};
+    uint64_t               explain_start = 0;
+    if (explained) {
+        explain_start = __query_dispatcher_get_time();
+        performance_access_start(&access_mark);
+    }
+
+    if (materializer && !query_materializer_write(materializer, query_instance, output)) {
+        if (explained)
+            __query_dispatcher_write_explained(explain,
+                                               &entry,
+                                               explain_start,
+                                               &access_mark,
+                                               output);
+        return 0;
+    }
+
+    const query_type_t *const type = query_instance_get_type(query_instance);
+    if (statistics_cache && query_statistics_cache_supports_type(type)) {
+        query_slow_log_t *const slow_log = query_slow_log_get_shared();
+        const uint64_t start = slow_log || explained ? __query_dispatcher_get_time() : 0;
+
+        const size_t type_num = query_type_get_type_number(type);
+        performance_trace_begin(
+            __query_dispatcher_get_trace_name(query_dispatcher_trace_statistics_names, type_num));
+        performance_metrics_start_measuring_query_statistics(metrics, type_num);
+        performance_probe1(query_statistics_begin, type_num);
+        const void *statistics;
+        const int   failed =
+            query_statistics_cache_get(statistics_cache, query_instance, &statistics);
+        performance_probe1(query_statistics_end, type_num);
+        performance_metrics_stop_measuring_query_statistics(metrics, type_num);
+        performance_trace_end();
+        if (__query_dispatcher_mark_cancelled(query_instance, output))
+            return 0;
+        if (failed)
+            return 1;
+
+        if (explained) {
+            entry.path             = QUERY_EXPLAIN_PATH_STATISTICS;
+            entry.statistics_cache = query_statistics_cache_was_hit(statistics_cache)
+                                         ? QUERY_EXPLAIN_CACHE_HIT
+                                         : QUERY_EXPLAIN_CACHE_MISS;
+            entry.statistics_time  = __query_dispatcher_get_time() - start;
+            performance_access_stop(&access_mark, &entry.statistics_access);
+
+            explain_start = __query_dispatcher_get_time();
+            performance_access_start(&access_mark);
+        }
+
+        const size_t line = query_instance_get_line_in_file(query_instance);
+        performance_trace_begin(
+            __query_dispatcher_get_trace_name(query_dispatcher_trace_execute_names, type_num));
+        performance_metrics_start_measuring_query_execution(metrics, type_num, line);
+        performance_probe2(query_execute_begin, type_num, line);
+        if (slow_log) {
+            __query_dispatcher_execute_logged(slow_log,
+                                              database,
+                                              statistics,
+                                              __query_dispatcher_get_time() - start,
+                                              1,
+                                              query_instance,
+                                              output);
+        } else {
+            query_type_list_execute(database,
+                                    statistics,
+                                    query_instance,
+                                    output); /* Ignore returned result */
+        }
+        performance_probe2(query_execute_end, type_num, line);
+        performance_trace_end();
+        __query_dispatcher_mark_cancelled(query_instance, output);
+        performance_metrics_stop_measuring_query_execution(metrics, type_num, line);
+
+        if (explained)
+            __query_dispatcher_write_explained(explain,
+                                               &entry,
+                                               explain_start,
+                                               &access_mark,
+                                               output);
+        return 0;
+    }
 
     query_instance_list_t *const list = query_instance_list_create();
     if (!list)
@@ -39,95 +279,736 @@ int query_dispatcher_dispatch_single(const database_t       *database,
         return 1;
     }
 
-    query_dispatcher_dispatch_list(database, list, &output, NULL);
+    query_dispatcher_dispatch_list(database, list, &output, NULL, metrics, NULL, NULL);
     query_instance_list_free(list);
     return 0;
 }
 
+/**
+ * @brief Maximum number of threads used by ::query_dispatcher_dispatch_list.
+ */
+#define QUERY_DISPATCHER_MAX_THREADS 16
+
+/**
+ * @brief   Maximum number of queries a worker executes before choosing its next task.
+ * @details Small batches balance work better between threads (query execution times vary a lot),
+ *          but require more synchronization.
+ */
+#define QUERY_DISPATCHER_EXECUTION_BATCH_SIZE 8
+
+/**
+ * @brief   Maximum number of queries a worker executes before choosing its next task, for query
+ *          types that execute many queries at once (see ::query_type_execute_batch_callback_t).
+ * @details Larger than ::QUERY_DISPATCHER_EXECUTION_BATCH_SIZE, as those queries are usually fast
+ *          and only get faster in larger batches.
+ */
+#define QUERY_DISPATCHER_VECTOR_BATCH_SIZE 64
+
+/**
+ * @brief   Maximum number of executed tasks whose outputs are waiting to be flushed.
+ * @details Workers stop executing queries when the flushing thread is this far behind.
+ */
+#define QUERY_DISPATCHER_FLUSH_QUEUE_CAPACITY 64
+
+/**
+ * @struct query_dispatcher_set_t
+ * @brief  A set of queries of the same type, that share the same statistical data.
+ *
+ * @var query_dispatcher_set_t::type
+ *     @brief Type of all queries in this set.
+ * @var query_dispatcher_set_t::n
+ *     @brief Number of queries in this set.
+ * @var query_dispatcher_set_t::instances
+ *     @brief Queries in this set.
+ * @var query_dispatcher_set_t::outputs
+ *     @brief Where to output the result of each query in ::query_dispatcher_set_t::instances to.
+ * @var query_dispatcher_set_t::statistics
+ *     @brief Statistical data shared by all queries in this set (can be `NULL`).
+ * @var query_dispatcher_set_t::statistics_allocator
+ *     @brief   Arena where ::query_dispatcher_set_t::statistics is allocated (`NULL` when there
+ *              isn't statistical data).
+ *     @details Freed at once when the last query of this set finishes executing.
+ * @var query_dispatcher_set_t::statistics_time
+ *     @brief Nanoseconds spent generating ::query_dispatcher_set_t::statistics. Only measured
+ *            for the slow query log, or when ::query_dispatcher_set_t::explained.
+ * @var query_dispatcher_set_t::explained
+ *     @brief Whether any query in this set is to be explained (see ::query_explain_is_explained).
+ * @var query_dispatcher_set_t::path
+ *     @brief Access path chosen for this set (see ::__query_dispatcher_choose_strategy).
+ * @var query_dispatcher_set_t::cost
+ *     @brief Costs predicted by the cost model of this set's type, if
+ *            ::query_dispatcher_set_t::path is ::QUERY_EXPLAIN_PATH_SCAN or
+ *            ::QUERY_EXPLAIN_PATH_INDEX.
+ * @var query_dispatcher_set_t::statistics_access
+ *     @brief Records read while generating ::query_dispatcher_set_t::statistics. Only measured
+ *            when ::query_dispatcher_set_t::explained.
+ * @var query_dispatcher_set_t::ready
+ *     @brief Whether ::query_dispatcher_set_t::statistics have already been generated.
+ * @var query_dispatcher_set_t::next
+ *     @brief Index of the first query that hasn't yet been assigned to a worker.
+ * @var query_dispatcher_set_t::remaining
+ *     @brief Number of queries whose execution hasn't yet finished.
+ */
+typedef struct {
+    const query_type_t            *type;
+    size_t                         n;
+    const query_instance_t *const *instances;
+    query_writer_t *const         *outputs;
+
+    void    *statistics;
+    arena_t *statistics_allocator;
+    uint64_t statistics_time;
+    int      ready;
+    size_t next, remaining;
+
+    int                  explained;
+    query_explain_path_t path;
+    query_type_cost_t    cost;
+    performance_access_t statistics_access;
+} query_dispatcher_set_t;
+
+/**
+ * @struct query_dispatcher_task_t
+ * @brief  Work assigned to a worker by ::__query_dispatcher_get_task.
+ *
+ * @var query_dispatcher_task_t::set
+ *     @brief Set of queries to work on.
+ * @var query_dispatcher_task_t::start
+ *     @brief Index of the first query in ::query_dispatcher_task_t::set to be executed.
+ * @var query_dispatcher_task_t::count
+ *     @brief Number of queries to be executed, or `0` to generate the set's statistics.
+ */
+typedef struct {
+    query_dispatcher_set_t *set;
+    size_t                  start, count;
+} query_dispatcher_task_t;
+
 /**
  * @struct query_dispatcher_data_t
- * @brief  Data needed while dispatching a list of queries.
+ * @brief  Data needed while dispatching a list of queries, shared by all workers.
  *
  * @var query_dispatcher_data_t::database
  *     @brief Database, so that queries can access data.
+ * @var query_dispatcher_data_t::slow_log
+ *     @brief Log of slow queries (can be `NULL`), so that queries are measured separately.
+ * @var query_dispatcher_data_t::explain
+ *     @brief Report of how queries were executed (see ::query_explain_get_shared).
+ * @var query_dispatcher_data_t::materializer
+ *     @brief Rendered outputs of queries about hot entities (can be `NULL`).
  * @var query_dispatcher_data_t::outputs
  *     @brief Where to output query results to.
  * @var query_dispatcher_data_t::i
- *     @brief Number of queries processed until now.
- * @var query_dispatcher_data_t::metrics
- *     @brief Performance metrics where to write profiling information to.
+ *     @brief Number of queries in ::query_dispatcher_data_t::sets.
+ * @var query_dispatcher_data_t::sets
+ *     @brief Array of ::query_dispatcher_set_t, for every type of query to be executed.
+ * @var query_dispatcher_data_t::next_statistics
+ *     @brief Index of the first set whose statistics haven't yet started being generated.
+ * @var query_dispatcher_data_t::pending_statistics
+ *     @brief Number of sets whose statistics are being generated.
+ * @var query_dispatcher_data_t::first_executable
+ *     @brief Index of the first set that may still have queries yet to be assigned to a worker.
+ * @var query_dispatcher_data_t::flush
+ *     @brief Method called with the outputs of executed queries (can be `NULL`).
+ * @var query_dispatcher_data_t::flush_data
+ *     @brief Argument passed to ::query_dispatcher_data_t::flush.
+ * @var query_dispatcher_data_t::flush_queue
+ *     @brief   Ring buffer of executed tasks, whose outputs are yet to be flushed.
+ *     @details Bounded, so that workers wait for the flushing thread when it falls behind, instead
+ *              of buffering the output of every query in memory.
+ * @var query_dispatcher_data_t::flush_first
+ *     @brief Index of the first task in ::query_dispatcher_data_t::flush_queue.
+ * @var query_dispatcher_data_t::flush_length
+ *     @brief Number of tasks in ::query_dispatcher_data_t::flush_queue.
+ * @var query_dispatcher_data_t::flush_closed
+ *     @brief Whether no more tasks will be added to ::query_dispatcher_data_t::flush_queue.
+ * @var query_dispatcher_data_t::mutex
+ *     @brief Mutex to protect all the fields above from concurrent access.
+ * @var query_dispatcher_data_t::statistics_done
+ *     @brief Signaled whenever the statistics of a set are done being generated.
+ * @var query_dispatcher_data_t::flush_not_empty
+ *     @brief Signaled whenever a task is added to ::query_dispatcher_data_t::flush_queue, or when
+ *            it's closed.
+ * @var query_dispatcher_data_t::flush_not_full
+ *     @brief Signaled whenever a task is removed from ::query_dispatcher_data_t::flush_queue.
  */
 typedef struct {
     const database_t *const      database;
+    query_slow_log_t *const      slow_log;
+    query_explain_t *const       explain;
+    query_materializer_t *const  materializer;
     query_writer_t *const *const outputs;
     size_t                       i;
-    performance_metrics_t *const metrics;
+    GArray                      *sets;
+
+    size_t next_statistics, pending_statistics, first_executable;
+
+    query_dispatcher_flush_callback_t flush;
+    void                             *flush_data;
+    query_dispatcher_task_t           flush_queue[QUERY_DISPATCHER_FLUSH_QUEUE_CAPACITY];
+    size_t                            flush_first, flush_length;
+    int                               flush_closed;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  statistics_done, flush_not_empty, flush_not_full;
 } query_dispatcher_data_t;
 
 /**
- * @brief Gets called for each set of queries of the same type, to execute them.
+ * @struct query_dispatcher_worker_t
+ * @brief  Data specific to one thread executing queries.
+ *
+ * @var query_dispatcher_worker_t::dispatcher_data
+ *     @brief Data shared by all workers.
+ * @var query_dispatcher_worker_t::metrics
+ *     @brief   Where to write profiling information to (can be `NULL`).
+ *     @details Not shared with any other worker, as ::performance_metrics_t isn't thread-safe.
+ * @var query_dispatcher_worker_t::thread
+ *     @brief Thread running this worker (not valid for the first worker, the calling thread).
+ */
+typedef struct {
+    query_dispatcher_data_t *dispatcher_data;
+    performance_metrics_t   *metrics;
+    pthread_t                thread;
+} query_dispatcher_worker_t;
+
+/**
+ * @brief Gets called for each set of queries of the same type, to add it to the sets to execute.
  *
  * @param user_data A pointer to a ::query_dispatcher_data_t.
- * @param n         Number of queries to be processed.
+ * @param n         Number of queries in the set.
  * @param instances Queries of the same type to be processed.
  *
- * @return Always `0`, even on failure. No query execution failures shall halt the program.
+ * @return Always `0`.
  */
 int __query_dispatcher_query_set_callback(void                         *user_data,
                                           size_t                        n,
                                           const query_instance_t *const instances[n]) {
     query_dispatcher_data_t *const dispatcher_data = user_data;
 
-    const query_type_t *const type     = query_instance_get_type(instances[0]);
-    const size_t              type_num = query_type_get_type_number(type);
+    int explained = 0;
+    for (size_t i = 0; i < n && !explained; ++i)
+        explained = query_explain_is_explained(dispatcher_data->explain, instances[i]);
+
+    const query_type_t *const    type = query_instance_get_type(instances[0]);
+    const query_dispatcher_set_t set  = {
+        .type                 = type,
+        .n                    = n,
+        .instances            = instances,
+        .outputs              = dispatcher_data->outputs + dispatcher_data->i,
+        .statistics           = NULL,
+        .statistics_allocator = NULL,
+        .statistics_time      = 0,
+        .ready                = 0,
+        .next                 = 0,
+        .remaining            = n,
+        .explained            = explained,
+        .path                 = query_type_get_generate_statistics_callback(type)
+                                    ? QUERY_EXPLAIN_PATH_STATISTICS
+                                    : QUERY_EXPLAIN_PATH_DIRECT,
+        .cost                 = {.index_cost = 0, .scan_cost = 0},
+        .statistics_access    = {{0}, {0}}};
+    g_array_append_val(dispatcher_data->sets, set);
+
+    dispatcher_data->i += n;
+    return 0;
+}
+
+/**
+ * @brief   Chooses the next task for a worker, waiting for one to be available if needed.
+ * @details Executing queries is preferred over generating statistics, so that statistical data can
+ *          be freed as soon as possible. With a single worker, sets of queries are processed one at
+ *          a time, like when dispatching sequentially.
+ *
+ * @param dispatcher_data Data shared between all workers.
+ * @param out_task        Where to write the chosen task to.
+ *
+ * @retval 0 A task was written to @p out_task.
+ * @retval 1 There's no work left.
+ */
+int __query_dispatcher_get_task(query_dispatcher_data_t *dispatcher_data,
+                                query_dispatcher_task_t *out_task) {
+    pthread_mutex_lock(&dispatcher_data->mutex);
+
+    int retval = 1;
+    while (1) {
+        /* Execute queries from sets whose statistics are ready */
+        for (size_t i = dispatcher_data->first_executable; i < dispatcher_data->next_statistics;
+             ++i) {
+            query_dispatcher_set_t *const set =
+                &g_array_index(dispatcher_data->sets, query_dispatcher_set_t, i);
+
+            if (set->ready && set->next < set->n) {
+                const size_t batch_size = query_type_get_execute_batch_callback(set->type)
+                                              ? QUERY_DISPATCHER_VECTOR_BATCH_SIZE
+                                              : QUERY_DISPATCHER_EXECUTION_BATCH_SIZE;
+                const size_t count =
+                    set->n - set->next < batch_size ? set->n - set->next : batch_size;
+
+                *out_task =
+                    (query_dispatcher_task_t) {.set = set, .start = set->next, .count = count};
+                set->next += count;
+                retval = 0;
+                goto DEFER_1;
+            } else if (set->ready && i == dispatcher_data->first_executable) {
+                dispatcher_data->first_executable++; /* Fully assigned set. Don't look again */
+            }
+        }
+
+        /* Start generating statistics for another set */
+        if (dispatcher_data->next_statistics < dispatcher_data->sets->len) {
+            *out_task = (query_dispatcher_task_t) {
+                .set   = &g_array_index(dispatcher_data->sets,
+                                      query_dispatcher_set_t,
+                                      dispatcher_data->next_statistics),
+                .start = 0,
+                .count = 0};
+            dispatcher_data->next_statistics++;
+            dispatcher_data->pending_statistics++;
+            retval = 0;
+            goto DEFER_1;
+        }
+
+        if (!dispatcher_data->pending_statistics)
+            goto DEFER_1; /* No work left */
+
+        /* Wait for other workers' statistics, so that their queries can be executed */
+        performance_trace_begin("Wait for statistics");
+        pthread_cond_wait(&dispatcher_data->statistics_done, &dispatcher_data->mutex);
+        performance_trace_end();
+    }
+
+DEFER_1:
+    pthread_mutex_unlock(&dispatcher_data->mutex);
+    return retval;
+}
+
+/**
+ * @brief   Chooses whether statistical data is worth generating for a set of queries.
+ * @details Query types without a cost model (see ::query_type_cost_model_callback_t) always
+ *          generate it. Otherwise, the cheapest predicted strategy is chosen (or scanning, when
+ *          possible and close to the [memory budget](@ref memory_budget.h)), and registered in the
+ *          worker's performance metrics alongside its predicted cost, and in the set, for its
+ *          queries to be explained.
+ *
+ * @param worker Worker generating the statistics.
+ * @param set    Set of queries to generate the statistics for.
+ *
+ * @retval 0 Queries are to be executed without statistical data.
+ * @retval 1 Statistical data is to be generated.
+ */
+int __query_dispatcher_choose_strategy(query_dispatcher_worker_t *worker,
+                                       query_dispatcher_set_t    *set) {
+
+    const query_type_cost_model_callback_t cost_model =
+        query_type_get_cost_model_callback(set->type);
+    if (!cost_model)
+        return 1;
+
+    query_type_cost_t cost;
+    cost_model(worker->dispatcher_data->database, set->n, set->instances, &cost);
+
+    /* Close to the memory budget, statistics for a few entities beat an index of all of them */
+    int scan = cost.scan_cost < cost.index_cost;
+    if (!scan && cost.scan_cost != UINT64_MAX &&
+        memory_budget_should_degrade(MEMORY_BUDGET_DEGRADATION_SCAN_STATISTICS))
+        scan = 1;
+
+    set->path = scan ? QUERY_EXPLAIN_PATH_SCAN : QUERY_EXPLAIN_PATH_INDEX;
+    set->cost = cost;
+
+    performance_metrics_set_query_strategy(worker->metrics,
+                                           query_type_get_type_number(set->type),
+                                           scan ? PERFORMANCE_METRICS_QUERY_STRATEGY_SCAN
+                                                : PERFORMANCE_METRICS_QUERY_STRATEGY_INDEX,
+                                           cost.index_cost,
+                                           cost.scan_cost);
+    return scan;
+}
+
+/**
+ * @brief   Generates the statistical data for a set of queries.
+ * @details Generation is skipped if the query type's cost model predicts it isn't worth it (see
+ *          ::__query_dispatcher_choose_strategy). Statistical data is allocated in an arena of its
+ *          own, whose memory usage is registered in the worker's performance metrics.
+ *
+ * @param worker Worker generating the statistics.
+ * @param set    Set of queries to generate the statistics for.
+ */
+void __query_dispatcher_generate_statistics(query_dispatcher_worker_t *worker,
+                                            query_dispatcher_set_t    *set) {
+
+    query_dispatcher_data_t *const dispatcher_data = worker->dispatcher_data;
+    const size_t                   type_num        = query_type_get_type_number(set->type);
 
     const query_type_generate_statistics_callback_t generate_stats =
-        query_type_get_generate_statistics_callback(type);
+        query_type_get_generate_statistics_callback(set->type);
+
+    void                *statistics      = NULL;
+    arena_t             *allocator       = NULL;
+    int                  failed          = 0;
+    uint64_t             statistics_time = 0;
+    performance_access_t access          = {{0}, {0}};
+    if (generate_stats && !query_instance_is_cancelled(set->instances[0]) &&
+        __query_dispatcher_choose_strategy(worker, set)) {
+        const int      measure = dispatcher_data->slow_log || set->explained;
+        const uint64_t start   = measure ? __query_dispatcher_get_time() : 0;
+        performance_access_t access_mark;
+        performance_access_start(&access_mark);
+
+        performance_trace_begin(
+            __query_dispatcher_get_trace_name(query_dispatcher_trace_statistics_names, type_num));
+        performance_metrics_start_measuring_query_statistics(worker->metrics, type_num);
+        performance_probe1(query_statistics_begin, type_num);
+        allocator = arena_create(QUERY_TYPE_STATISTICS_ARENA_BLOCK_SIZE);
+        if (allocator)
+            statistics =
+                generate_stats(dispatcher_data->database, set->n, set->instances, allocator);
+        performance_probe1(query_statistics_end, type_num);
+        performance_metrics_stop_measuring_query_statistics(worker->metrics, type_num);
+        performance_trace_end();
+
+        performance_access_stop(&access_mark, &access);
+        if (measure)
+            statistics_time = __query_dispatcher_get_time() - start;
+
+        if (statistics) {
+            memory_usage_t usage;
+            arena_get_memory_usage(allocator, &usage);
+            performance_metrics_set_query_statistics_memory(worker->metrics, type_num, &usage);
+        } else if (allocator) {
+            arena_free(allocator);
+            allocator = NULL;
+        }
+
+        /* Cancelled generation: execution will find every query cancelled */
+        failed = !statistics && !query_instance_is_cancelled(set->instances[0]);
+    }
+
+    pthread_mutex_lock(&dispatcher_data->mutex);
+    set->statistics           = statistics;
+    set->statistics_allocator = allocator;
+    set->statistics_time      = statistics_time;
+    set->statistics_access    = access;
+    set->ready                = 1;
+    if (failed) /* Skip all queries */
+        set->next = set->n;
+
+    dispatcher_data->pending_statistics--;
+    pthread_cond_broadcast(&dispatcher_data->statistics_done);
+    pthread_mutex_unlock(&dispatcher_data->mutex);
+}
+
+/**
+ * @brief   Executes some queries in a set.
+ * @details The set's statistical data (if any) is freed after its last query finishes executing,
+ *          along with the arena it was allocated in.
+ *          Queries are executed all at once if their type supports it, unless the worker is
+ *          profiling them, slow queries are logged or queries are explained, as the execution of
+ *          every query is measured separately, or unless their outputs may be materialized.
+ *          Executed queries are then queued to have their outputs flushed, if there's a flush
+ *          callback.
+ *
+ * @param worker Worker executing the queries.
+ * @param task   Queries to be executed.
+ */
+void __query_dispatcher_execute(query_dispatcher_worker_t     *worker,
+                                const query_dispatcher_task_t *task) {
+
+    query_dispatcher_data_t *const dispatcher_data = worker->dispatcher_data;
+    query_dispatcher_set_t *const  set             = task->set;
+    const size_t                   type_num        = query_type_get_type_number(set->type);
+
+    const query_type_execute_batch_callback_t execute_batch =
+        query_type_get_execute_batch_callback(set->type);
+
+    performance_trace_begin(
+        __query_dispatcher_get_trace_name(query_dispatcher_trace_execute_names, type_num));
+    performance_probe2(query_batch_begin, type_num, task->count);
+    const int materialized =
+        dispatcher_data->materializer && query_type_get_entity_key_callback(set->type);
+    if (execute_batch && !worker->metrics && !dispatcher_data->slow_log && !set->explained &&
+        !materialized) {
+        /* Queries in a set share their cancellation, so the batch is checked as a whole */
+        if (!query_instance_is_cancelled(set->instances[task->start]))
+            execute_batch(dispatcher_data->database,
+                          set->statistics,
+                          task->count,
+                          set->instances + task->start,
+                          set->outputs + task->start); /* Ignore returned result */
+
+        for (size_t j = task->start; j < task->start + task->count; ++j)
+            __query_dispatcher_mark_cancelled(set->instances[j], set->outputs[j]);
+    } else {
+        for (size_t j = task->start; j < task->start + task->count; ++j) {
+            const size_t line = query_instance_get_line_in_file(set->instances[j]);
+            const int    explained =
+                set->explained &&
+                query_explain_is_explained(dispatcher_data->explain, set->instances[j]);
+
+            performance_access_t access_mark   = {{0}, {0}};
+            uint64_t             explain_start = 0;
+            int                  from_memory   = 0;
+            if (explained) {
+                explain_start = __query_dispatcher_get_time();
+                performance_access_start(&access_mark);
+            }
+
+            performance_metrics_start_measuring_query_execution(worker->metrics, type_num, line);
+            performance_probe2(query_execute_begin, type_num, line);
+            if (__query_dispatcher_mark_cancelled(set->instances[j], set->outputs[j])) {
+                /* Not executed */
+            } else if (materialized &&
+                !query_materializer_write(dispatcher_data->materializer,
+                                          set->instances[j],
+                                          set->outputs[j])) {
+                /* Written from memory, without executing the query */
+                from_memory = 1;
+            } else if (dispatcher_data->slow_log) {
+                __query_dispatcher_execute_logged(dispatcher_data->slow_log,
+                                                  dispatcher_data->database,
+                                                  set->statistics,
+                                                  set->statistics_time,
+                                                  set->n,
+                                                  set->instances[j],
+                                                  set->outputs[j]);
+            } else {
+                query_type_list_execute(dispatcher_data->database,
+                                        set->statistics,
+                                        set->instances[j],
+                                        set->outputs[j]); /* Ignore returned result */
+            }
+            __query_dispatcher_mark_cancelled(set->instances[j], set->outputs[j]);
+            performance_probe2(query_execute_end, type_num, line);
+            performance_metrics_stop_measuring_query_execution(worker->metrics, type_num, line);
+
+            if (explained) {
+                query_explain_entry_t entry = {
+                    .query             = set->instances[j],
+                    .path              = from_memory ? QUERY_EXPLAIN_PATH_MATERIALIZED : set->path,
+                    .statistics_cache  = QUERY_EXPLAIN_CACHE_NONE,
+                    .estimated         = set->path == QUERY_EXPLAIN_PATH_SCAN ||
+                                 set->path == QUERY_EXPLAIN_PATH_INDEX,
+                    .index_cost        = set->cost.index_cost,
+                    .scan_cost         = set->cost.scan_cost,
+                    .shared            = set->n,
+                    .statistics_time   = set->statistics_time,
+                    .statistics_access = set->statistics_access};
+                __query_dispatcher_write_explained(dispatcher_data->explain,
+                                                   &entry,
+                                                   explain_start,
+                                                   &access_mark,
+                                                   set->outputs[j]);
+            }
+        }
+    }
+    performance_probe2(query_batch_end, type_num, task->count);
+    performance_trace_end();
+
+    pthread_mutex_lock(&dispatcher_data->mutex);
+    set->remaining -= task->count;
+    const int last = set->remaining == 0;
+
+    if (dispatcher_data->flush) {
+        if (dispatcher_data->flush_length == QUERY_DISPATCHER_FLUSH_QUEUE_CAPACITY) {
+            performance_trace_begin("Wait for flush queue");
+            while (dispatcher_data->flush_length == QUERY_DISPATCHER_FLUSH_QUEUE_CAPACITY)
+                pthread_cond_wait(&dispatcher_data->flush_not_full, &dispatcher_data->mutex);
+            performance_trace_end();
+        }
+
+        const size_t tail = (dispatcher_data->flush_first + dispatcher_data->flush_length) %
+                            QUERY_DISPATCHER_FLUSH_QUEUE_CAPACITY;
+        dispatcher_data->flush_queue[tail] = *task;
+        dispatcher_data->flush_length++;
+        pthread_cond_signal(&dispatcher_data->flush_not_empty);
+    }
+    pthread_mutex_unlock(&dispatcher_data->mutex);
+
     const query_type_free_statistics_callback_t free_stats =
-        query_type_get_free_statistics_callback(type);
-    const query_type_execute_callback_t execute = query_type_get_execute_callback(type);
+        query_type_get_free_statistics_callback(set->type);
+    if (last && set->statistics) {
+        if (free_stats)
+            free_stats(set->statistics);
+        arena_free(set->statistics_allocator);
+    }
+}
 
-    void *statistics = NULL;
-    if (generate_stats) {
-        performance_metrics_start_measuring_query_statistics(dispatcher_data->metrics, type_num);
-        statistics = generate_stats(dispatcher_data->database, n, instances);
-        performance_metrics_stop_measuring_query_statistics(dispatcher_data->metrics, type_num);
+/**
+ * @brief   Executes tasks until there's no work left.
+ * @details Thread entry point, that can also be called directly.
+ *
+ * @param worker_data Pointer to a ::query_dispatcher_worker_t.
+ *
+ * @return Always `NULL`.
+ */
+void *__query_dispatcher_worker_run(void *worker_data) {
+    query_dispatcher_worker_t *const worker = worker_data;
 
-        if (!statistics)
-            return 0; /* Query statistical failure */
+    query_dispatcher_task_t task;
+    while (!__query_dispatcher_get_task(worker->dispatcher_data, &task)) {
+        if (task.count)
+            __query_dispatcher_execute(worker, &task);
+        else
+            __query_dispatcher_generate_statistics(worker, task.set);
     }
 
-    for (size_t j = 0; j < n; ++j) {
-        const size_t line = query_instance_get_line_in_file(instances[j]);
-
-        performance_metrics_start_measuring_query_execution(dispatcher_data->metrics,
-                                                            type_num,
-                                                            line);
-        execute(dispatcher_data->database,
-                statistics,
-                instances[j],
-                dispatcher_data->outputs[dispatcher_data->i + j]); /* Ignore returned result */
-        performance_metrics_stop_measuring_query_execution(dispatcher_data->metrics,
-                                                           type_num,
-                                                           line);
+    return NULL;
+}
+
+/**
+ * @brief   Flushes the outputs of executed queries until all queries have been executed.
+ * @details Thread entry point, so that writing outputs overlaps with generating statistics and
+ *          executing other queries.
+ *
+ * @param data Pointer to a ::query_dispatcher_data_t.
+ *
+ * @return Always `NULL`.
+ */
+void *__query_dispatcher_flusher_run(void *data) {
+    query_dispatcher_data_t *const dispatcher_data = data;
+
+    pthread_mutex_lock(&dispatcher_data->mutex);
+    while (1) {
+        while (!dispatcher_data->flush_length && !dispatcher_data->flush_closed)
+            pthread_cond_wait(&dispatcher_data->flush_not_empty, &dispatcher_data->mutex);
+        if (!dispatcher_data->flush_length)
+            break; /* Closed and empty */
+
+        const query_dispatcher_task_t task =
+            dispatcher_data->flush_queue[dispatcher_data->flush_first];
+        dispatcher_data->flush_first =
+            (dispatcher_data->flush_first + 1) % QUERY_DISPATCHER_FLUSH_QUEUE_CAPACITY;
+        dispatcher_data->flush_length--;
+        pthread_cond_signal(&dispatcher_data->flush_not_full);
+        pthread_mutex_unlock(&dispatcher_data->mutex);
+
+        performance_trace_begin("Flush");
+        dispatcher_data->flush(dispatcher_data->flush_data,
+                               task.count,
+                               task.set->instances + task.start,
+                               task.set->outputs + task.start);
+        performance_trace_end();
+
+        pthread_mutex_lock(&dispatcher_data->mutex);
     }
-    dispatcher_data->i += n;
+    pthread_mutex_unlock(&dispatcher_data->mutex);
 
-    if (free_stats)
-        free_stats(statistics);
-    return 0;
+    return NULL;
+}
+
+/**
+ * @brief Calculates how many threads should be used to dispatch a list of queries.
+ * @param n Number of queries to be dispatched.
+ * @return The number of threads (including the calling one) to be used.
+ */
+size_t __query_dispatcher_get_thread_count(size_t n) {
+    size_t threads = thread_pool_get_stage_thread_count(THREAD_POOL_STAGE_QUERIES);
+    if (threads > QUERY_DISPATCHER_MAX_THREADS)
+        threads = QUERY_DISPATCHER_MAX_THREADS;
+    if (threads > n)
+        threads = n;
+    return threads ? threads : 1;
 }
 
-void query_dispatcher_dispatch_list(const database_t      *database,
-                                    query_instance_list_t *query_instance_list,
-                                    query_writer_t *const *outputs,
-                                    performance_metrics_t *metrics) {
+void query_dispatcher_dispatch_list(const database_t                 *database,
+                                    query_instance_list_t            *query_instance_list,
+                                    query_writer_t *const            *outputs,
+                                    query_materializer_t             *materializer,
+                                    performance_metrics_t            *metrics,
+                                    query_dispatcher_flush_callback_t flush,
+                                    void                             *flush_data) {
+
+    query_dispatcher_data_t dispatcher_data = {
+        .database           = database,
+        .slow_log           = query_slow_log_get_shared(),
+        .explain            = query_explain_get_shared(),
+        .materializer       = materializer,
+        .outputs            = outputs,
+        .i                  = 0,
+        .sets               = g_array_new(FALSE, FALSE, sizeof(query_dispatcher_set_t)),
+        .next_statistics    = 0,
+        .pending_statistics = 0,
+        .first_executable   = 0,
+        .flush              = flush,
+        .flush_data         = flush_data,
+        .flush_first        = 0,
+        .flush_length       = 0,
+        .flush_closed       = 0};
 
-    query_dispatcher_data_t dispatcher_data = {.database = database,
-                                               .outputs  = outputs,
-                                               .i        = 0,
-                                               .metrics  = metrics};
     query_instance_list_iter_types(query_instance_list,
                                    __query_dispatcher_query_set_callback,
                                    &dispatcher_data);
+
+    pthread_mutex_init(&dispatcher_data.mutex, NULL);
+    pthread_cond_init(&dispatcher_data.statistics_done, NULL);
+    pthread_cond_init(&dispatcher_data.flush_not_empty, NULL);
+    pthread_cond_init(&dispatcher_data.flush_not_full, NULL);
+
+    /* Outputs are flushed by their own thread, or by the calling thread once all queries run */
+    pthread_t flusher;
+    const int flusher_started =
+        flush && !pthread_create(&flusher, NULL, __query_dispatcher_flusher_run, &dispatcher_data);
+    if (flush && !flusher_started)
+        dispatcher_data.flush = NULL;
+
+    /*
+     * The first worker is the calling thread. Others only start if everything they need exists, and
+     * if the database can be read concurrently.
+     */
+    const size_t max_workers = database_is_frozen(database)
+                                   ? __query_dispatcher_get_thread_count(dispatcher_data.i)
+                                   : 1;
+
+    query_dispatcher_worker_t workers[QUERY_DISPATCHER_MAX_THREADS];
+    size_t                    nworkers = 1;
+    workers[0] = (query_dispatcher_worker_t) {.dispatcher_data = &dispatcher_data,
+                                              .metrics         = metrics};
+
+    for (; nworkers < max_workers; ++nworkers) {
+        query_dispatcher_worker_t *const worker = &workers[nworkers];
+        worker->dispatcher_data                 = &dispatcher_data;
+        worker->metrics                         = NULL;
+
+        if (metrics) {
+            worker->metrics = performance_metrics_create();
+            if (!worker->metrics)
+                break;
+            performance_metrics_copy_query_sampling(worker->metrics, metrics);
+        }
+
+        if (pthread_create(&worker->thread, NULL, __query_dispatcher_worker_run, worker)) {
+            if (worker->metrics)
+                performance_metrics_free(worker->metrics);
+            break;
+        }
+    }
+
+    __query_dispatcher_worker_run(&workers[0]);
+
+    for (size_t i = 1; i < nworkers; ++i) {
+        pthread_join(workers[i].thread, NULL);
+        if (workers[i].metrics) {
+            performance_metrics_merge_query_measurements(metrics, workers[i].metrics);
+            performance_metrics_free(workers[i].metrics);
+        }
+    }
+
+    if (flusher_started) {
+        pthread_mutex_lock(&dispatcher_data.mutex);
+        dispatcher_data.flush_closed = 1;
+        pthread_cond_signal(&dispatcher_data.flush_not_empty);
+        pthread_mutex_unlock(&dispatcher_data.mutex);
+        pthread_join(flusher, NULL);
+    } else if (flush) {
+        for (size_t i = 0; i < dispatcher_data.sets->len; ++i) {
+            const query_dispatcher_set_t *const set =
+                &g_array_index(dispatcher_data.sets, query_dispatcher_set_t, i);
+            flush(flush_data, set->n, set->instances, set->outputs);
+        }
+    }
+
+    pthread_cond_destroy(&dispatcher_data.flush_not_full);
+    pthread_cond_destroy(&dispatcher_data.flush_not_empty);
+    pthread_cond_destroy(&dispatcher_data.statistics_done);
+    pthread_mutex_destroy(&dispatcher_data.mutex);
+    g_array_unref(dispatcher_data.sets);
 }
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  query_explain.c
+ * @brief Implementation of methods in include/queries/query_explain.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref query_explain_examples).
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "queries/query_explain.h"
+#include "queries/query_type.h"
+
+/**
+ * @struct query_explain
+ * @brief  Report of how queries were executed.
+ *
+ * @var query_explain::file
+ *     @brief Report file, or `NULL` for `stderr`.
+ * @var query_explain::all
+ *     @brief Whether every query is explained, and not only those preceded by
+ *            ::QUERY_PARSER_EXPLAIN_PREFIX.
+ * @var query_explain::mutex
+ *     @brief Mutex that protects ::query_explain::file from concurrent writes.
+ */
+struct query_explain {
+    FILE           *file;
+    int             all;
+    pthread_mutex_t mutex;
+};
+
+/** @brief Names of each ::query_explain_path_t, as written to reports. */
+const char *const query_explain_path_names[] = {"direct",
+                                                "statistics",
+                                                "scan",
+                                                "index",
+                                                "materialized"};
+
+/** @brief Names of each ::query_explain_cache_t, as written to reports. */
+const char *const query_explain_cache_names[] = {"none", "hit", "miss"};
+
+/** @brief Report of prefixed queries to `stderr`, used when there's no shared report. */
+query_explain_t query_explain_default = {.file  = NULL,
+                                         .all   = 0,
+                                         .mutex = PTHREAD_MUTEX_INITIALIZER};
+
+/** @brief Report returned by ::query_explain_get_shared. */
+query_explain_t *query_explain_shared = NULL;
+
+query_explain_t *query_explain_create(const char *path, int all) {
+    query_explain_t *const explain = malloc(sizeof(query_explain_t));
+    if (!explain)
+        return NULL;
+
+    explain->file = fopen(path, "a");
+    if (!explain->file) {
+        free(explain);
+        return NULL;
+    }
+
+    explain->all = all;
+    pthread_mutex_init(&explain->mutex, NULL);
+    return explain;
+}
+
+int query_explain_is_explained(const query_explain_t *explain, const query_instance_t *query) {
+    return explain->all || query_instance_get_explain(query);
+}
+
+/**
+ * @brief Writes a predicted cost, in microseconds, or `-` if there's no prediction.
+ *
+ * @param output    Where to write to.
+ * @param estimated Whether @p cost was predicted.
+ * @param cost      Predicted cost, in nanoseconds.
+ * @param shared    Number of queries @p cost is shared by.
+ */
+void __query_explain_print_cost(FILE *output, int estimated, uint64_t cost, size_t shared) {
+    if (estimated && cost != UINT64_MAX)
+        fprintf(output, "%" PRIu64, cost / shared / 1000);
+    else
+        fputc('-', output);
+}
+
+void query_explain_write(query_explain_t *explain, const query_explain_entry_t *entry) {
+    const query_type_t *const type   = query_instance_get_type(entry->query);
+    const size_t              shared = entry->shared ? entry->shared : 1;
+    const uint64_t            actual = entry->statistics_time / shared + entry->execution_time;
+    const uint64_t            chosen =
+        entry->path == QUERY_EXPLAIN_PATH_INDEX ? entry->index_cost : entry->scan_cost;
+
+    pthread_mutex_lock(&explain->mutex);
+    FILE *const output = explain->file ? explain->file : stderr;
+
+    fprintf(output,
+            "line=%zu type=%zu path=%s statistics_cache=%s estimated_us=",
+            query_instance_get_line_in_file(entry->query),
+            query_type_get_type_number(type),
+            query_explain_path_names[entry->path],
+            query_explain_cache_names[entry->statistics_cache]);
+    __query_explain_print_cost(output,
+                               entry->estimated && entry->path != QUERY_EXPLAIN_PATH_MATERIALIZED,
+                               chosen,
+                               shared);
+    fprintf(output, " actual_us=%" PRIu64 " index_cost_us=", actual / 1000);
+    __query_explain_print_cost(output, entry->estimated, entry->index_cost, 1);
+    fputs(" scan_cost_us=", output);
+    __query_explain_print_cost(output, entry->estimated, entry->scan_cost, 1);
+
+    fprintf(output,
+            " statistics_us=%" PRIu64 " shared=%zu execution_us=%" PRIu64
+            " rows=%zu output_bytes=%zu statistics_scanned=",
+            entry->statistics_time / 1000,
+            shared,
+            entry->execution_time / 1000,
+            entry->rows,
+            entry->output_size);
+    performance_access_print_counts(output, entry->statistics_access.scanned);
+    fputs(" statistics_probes=", output);
+    performance_access_print_counts(output, entry->statistics_access.probes);
+    fputs(" scanned=", output);
+    performance_access_print_counts(output, entry->execution_access.scanned);
+    fputs(" probes=", output);
+    performance_access_print_counts(output, entry->execution_access.probes);
+    fputc('\n', output);
+
+    /* Written right away, so that nothing is lost if the program crashes or is killed */
+    fflush(output);
+    pthread_mutex_unlock(&explain->mutex);
+}
+
+void query_explain_set_shared(query_explain_t *explain) {
+    query_explain_shared = explain;
+}
+
+query_explain_t *query_explain_get_shared(void) {
+    return query_explain_shared ? query_explain_shared : &query_explain_default;
+}
+
+void query_explain_free(query_explain_t *explain) {
+    if (!explain || explain == &query_explain_default)
+        return;
+
+    fclose(explain->file);
+    pthread_mutex_destroy(&explain->mutex);
+    free(explain);
+}
@@ -0,0 +1,518 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  query_file_compiler.c
+ * @brief Implementation of methods in include/queries/query_file_compiler.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref query_file_compiler_examples).
+ */
+
+/** @cond FALSE */
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE /* For realpath */
+#endif
+/** @endcond */
+
+#include <errno.h>
+#include <glib.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "queries/query_file_compiler.h"
+#include "queries/query_file_parser.h"
+#include "queries/query_parser.h"
+#include "queries/query_type_list.h"
+#include "utils/mapped_file.h"
+
+/** @brief Value of ::query_file_compiler_header_t::magic. */
+#define QUERY_FILE_COMPILER_MAGIC "LI3QRYC"
+
+/**
+ * @brief Value of ::query_file_compiler_header_t::version. Increment when the format (or the
+ *        canonical form of queries) changes.
+ */
+#define QUERY_FILE_COMPILER_VERSION 1
+
+/** @brief Value of ::query_file_compiler_header_t::byte_order, as written by this machine. */
+#define QUERY_FILE_COMPILER_BYTE_ORDER 0x0102030405060708
+
+/** @brief Bit in ::query_file_compiler_record_t::flags set when the query's output is formatted. */
+#define QUERY_FILE_COMPILER_FLAG_FORMATTED 1
+
+/** @brief Bit in ::query_file_compiler_record_t::flags set when the query is explained. */
+#define QUERY_FILE_COMPILER_FLAG_EXPLAIN 2
+
+/**
+ * @struct query_file_compiler_header_t
+ * @brief  Header at the beginning of every compiled query file. All its fields are 8-byte aligned,
+ *         so it has no padding.
+ *
+ * @var query_file_compiler_header_t::magic
+ *     @brief Always ::QUERY_FILE_COMPILER_MAGIC, to identify compiled query files.
+ * @var query_file_compiler_header_t::version
+ *     @brief Version of the format (::QUERY_FILE_COMPILER_VERSION).
+ * @var query_file_compiler_header_t::byte_order
+ *     @brief ::QUERY_FILE_COMPILER_BYTE_ORDER, to reject files written in other machines.
+ * @var query_file_compiler_header_t::source_size
+ *     @brief Size of the text file when it was compiled, in bytes.
+ * @var query_file_compiler_header_t::source_modification_seconds
+ *     @brief Seconds of the text file's modification time when it was compiled.
+ * @var query_file_compiler_header_t::source_modification_nanoseconds
+ *     @brief Nanoseconds of the text file's modification time when it was compiled.
+ * @var query_file_compiler_header_t::record_count
+ *     @brief Number of ::query_file_compiler_record_t following the header.
+ */
+typedef struct {
+    char     magic[8];
+    uint64_t version;
+    uint64_t byte_order;
+    uint64_t source_size;
+    int64_t  source_modification_seconds;
+    int64_t  source_modification_nanoseconds;
+    uint64_t record_count;
+} query_file_compiler_header_t;
+
+/**
+ * @struct query_file_compiler_record_t
+ * @brief  A query in a compiled query file, followed by its canonical form (padded to a multiple
+ *         of `8` bytes).
+ *
+ * @var query_file_compiler_record_t::line
+ *     @brief Number of the line of the query in the text file.
+ * @var query_file_compiler_record_t::type
+ *     @brief Type number of the query (see ::query_type_get_type_number).
+ * @var query_file_compiler_record_t::flags
+ *     @brief Bit set of ::QUERY_FILE_COMPILER_FLAG_FORMATTED and
+ *            ::QUERY_FILE_COMPILER_FLAG_EXPLAIN.
+ * @var query_file_compiler_record_t::argc
+ *     @brief Number of arguments of the query.
+ * @var query_file_compiler_record_t::key_length
+ *     @brief Number of bytes in the canonical form of the query: a null-terminated header with its
+ *            type and flags, followed by every argument, each null-terminated.
+ */
+typedef struct {
+    uint64_t line;
+    uint32_t type;
+    uint32_t flags;
+    uint32_t argc;
+    uint32_t key_length;
+} query_file_compiler_record_t;
+
+/**
+ * @struct query_file_compiler_entry_t
+ * @brief  A query (or a duplicate of one) in a parsed query file, to be compiled.
+ *
+ * @var query_file_compiler_entry_t::instance
+ *     @brief Query in the list (the original one, for duplicates).
+ * @var query_file_compiler_entry_t::key
+ *     @brief Canonical form of ::query_file_compiler_entry_t::instance.
+ * @var query_file_compiler_entry_t::key_length
+ *     @brief Number of bytes in ::query_file_compiler_entry_t::key.
+ * @var query_file_compiler_entry_t::line
+ *     @brief Number of the line of the query (different from the original's, for duplicates).
+ */
+typedef struct {
+    const query_instance_t *instance;
+    const char             *key;
+    size_t                  key_length;
+    size_t                  line;
+} query_file_compiler_entry_t;
+
+/**
+ * @brief   Gets the path of the compiled form of a query file.
+ * @details Auxiliary method for ::query_file_compiler_parse. The cache directory is created if
+ *          needed.
+ *
+ * @param path     Path to the query file.
+ * @param out_path Where to write the path of the compiled form to (::PATH_MAX characters).
+ *
+ * @retval 0 Success.
+ * @retval 1 There's no cache directory, or it (or @p path) can't be accessed.
+ */
+int __query_file_compiler_get_path(const char *path, char *out_path) {
+    const char *const directory = getenv(QUERY_FILE_COMPILER_CACHE_ENVIRONMENT_VARIABLE);
+    if (!directory || !*directory)
+        return 1;
+
+    /* The same query file must always have the same compiled form, however its path is written */
+    char *const absolute_path = realpath(path, NULL);
+    if (!absolute_path)
+        return 1;
+
+    uint64_t hash = 0xcbf29ce484222325; /* FNV-1a */
+    for (const char *c = absolute_path; *c; ++c)
+        hash = (hash ^ (unsigned char) *c) * 0x100000001b3;
+    free(absolute_path);
+
+    if (mkdir(directory, 0755) && errno != EEXIST)
+        return 1;
+    return snprintf(out_path,
+                    PATH_MAX,
+                    "%s/%016" PRIx64 "%s",
+                    directory,
+                    hash,
+                    QUERY_FILE_COMPILER_EXTENSION) >= PATH_MAX;
+}
+
+/**
+ * @brief Fills in the header of the compiled form of a query file.
+ *
+ * @param header Header to be filled in (::query_file_compiler_header_t::record_count is `0`).
+ * @param source Metadata of the text file.
+ */
+void __query_file_compiler_fill_header(query_file_compiler_header_t *header,
+                                       const struct stat            *source) {
+    memset(header, 0, sizeof(query_file_compiler_header_t)); /* No uninitialized bytes in files */
+    memcpy(header->magic, QUERY_FILE_COMPILER_MAGIC, sizeof(QUERY_FILE_COMPILER_MAGIC));
+    header->version                         = QUERY_FILE_COMPILER_VERSION;
+    header->byte_order                      = QUERY_FILE_COMPILER_BYTE_ORDER;
+    header->source_size                     = (uint64_t) source->st_size;
+    header->source_modification_seconds     = (int64_t) source->st_mtim.tv_sec;
+    header->source_modification_nanoseconds = (int64_t) source->st_mtim.tv_nsec;
+}
+
+/**
+ * @brief   Splits the arguments of a query out of its canonical form.
+ * @details Auxiliary method for ::__query_file_compiler_load.
+ *
+ * @param key        Copy of the canonical form of the query, that the arguments will point into.
+ * @param key_length Number of bytes in @p key.
+ * @param argc       Number of arguments (at most ::QUERY_PARSER_MAX_ARGUMENTS).
+ * @param argv       Where to write the start of every argument to.
+ * @param lengths    Where to write the length of every argument to.
+ *
+ * @retval 0 Success.
+ * @retval 1 @p key doesn't contain @p argc arguments.
+ */
+int __query_file_compiler_split_arguments(char  *key,
+                                          size_t key_length,
+                                          size_t argc,
+                                          char  *argv[QUERY_PARSER_MAX_ARGUMENTS],
+                                          size_t lengths[QUERY_PARSER_MAX_ARGUMENTS]) {
+    char *const end      = key + key_length;
+    char       *argument = memchr(key, '\0', key_length); /* Skip the header */
+    if (!argument)
+        return 1;
+
+    for (size_t i = 0; i < argc; ++i) {
+        if (++argument >= end)
+            return 1;
+
+        char *const terminator = memchr(argument, '\0', end - argument);
+        if (!terminator)
+            return 1;
+
+        argv[i]    = argument;
+        lengths[i] = terminator - argument;
+        argument   = terminator;
+    }
+    return argument + 1 != end;
+}
+
+/**
+ * @brief   Loads a query file from its compiled form.
+ * @details Auxiliary method for ::query_file_compiler_parse.
+ *
+ * @param compiled_path Path to the compiled form.
+ * @param expected      Header the compiled form must have (besides its
+ *                      ::query_file_compiler_header_t::record_count).
+ *
+ * @return The list of queries, or `NULL` if the compiled form is outdated, corrupted, or on
+ *         allocation failure.
+ */
+query_instance_list_t *__query_file_compiler_load(const char                         *compiled_path,
+                                                  const query_file_compiler_header_t *expected) {
+    mapped_file_t *const file = mapped_file_open(compiled_path);
+    if (!file)
+        return NULL;
+
+    const char *const data = mapped_file_get_data(file);
+    const size_t      size = mapped_file_get_size(file);
+
+    query_file_compiler_header_t header;
+    if (size < sizeof(query_file_compiler_header_t))
+        goto DEFER_1;
+    memcpy(&header, data, sizeof(query_file_compiler_header_t));
+    if (memcmp(&header, expected, offsetof(query_file_compiler_header_t, record_count)))
+        goto DEFER_1;
+
+    query_instance_list_t *list = query_instance_list_create();
+    if (!list)
+        goto DEFER_1;
+
+    query_instance_t *const aux_query = query_instance_create();
+    if (!aux_query)
+        goto DEFER_2;
+
+    /* Argument callbacks may modify arguments, so they're parsed from a copy of each record */
+    GArray *const key = g_array_new(FALSE, FALSE, sizeof(char));
+    arena_t      *allocator = query_instance_list_get_argument_allocator(list);
+    size_t        offset    = sizeof(query_file_compiler_header_t);
+    for (uint64_t i = 0; i < header.record_count; ++i) {
+        query_file_compiler_record_t record;
+        if (size - offset < sizeof(query_file_compiler_record_t))
+            goto DEFER_3;
+        memcpy(&record, data + offset, sizeof(query_file_compiler_record_t));
+        offset += sizeof(query_file_compiler_record_t);
+
+        const size_t padded_length = ((size_t) record.key_length + 7) & ~(size_t) 7;
+        const query_type_t *const type = query_type_list_get_by_index(record.type);
+        if (size - offset < padded_length || !type || record.argc > QUERY_PARSER_MAX_ARGUMENTS)
+            goto DEFER_3;
+
+        g_array_set_size(key, 0);
+        g_array_append_vals(key, data + offset, record.key_length);
+
+        char  *argv[QUERY_PARSER_MAX_ARGUMENTS];
+        size_t lengths[QUERY_PARSER_MAX_ARGUMENTS];
+        if (__query_file_compiler_split_arguments(key->data,
+                                                  record.key_length,
+                                                  record.argc,
+                                                  argv,
+                                                  lengths))
+            goto DEFER_3;
+
+        /* Like in the text file, queries whose arguments are no longer valid are ignored */
+        if (!query_parser_parse_arguments(aux_query,
+                                          type,
+                                          record.flags & QUERY_FILE_COMPILER_FLAG_FORMATTED,
+                                          record.argc,
+                                          argv,
+                                          lengths,
+                                          allocator)) {
+            query_instance_set_explain(aux_query,
+                                       (record.flags & QUERY_FILE_COMPILER_FLAG_EXPLAIN) != 0);
+            query_instance_set_line_in_file(aux_query, record.line);
+            if (query_instance_list_add_unique(list, aux_query, data + offset, record.key_length))
+                goto DEFER_3;
+        }
+        offset += padded_length;
+    }
+
+    g_array_free(key, TRUE);
+    query_instance_free(aux_query);
+    mapped_file_unref(file);
+    return list;
+
+DEFER_3:
+    g_array_free(key, TRUE);
+    query_instance_free(aux_query);
+DEFER_2:
+    query_instance_list_free(list);
+DEFER_1:
+    mapped_file_unref(file);
+    return NULL;
+}
+
+/**
+ * @brief   Collects a query (added by ::query_instance_list_add_unique) to be compiled.
+ * @details Auxiliary method for ::__query_file_compiler_store.
+ *
+ * @param entries_data A `GArray` of ::query_file_compiler_entry_t.
+ * @param instance     Query instance.
+ * @param key          Canonical form of @p instance.
+ * @param key_length   Number of bytes in @p key.
+ *
+ * @retval 0 Always, to continue iteration.
+ */
+int __query_file_compiler_collect_key(void                   *entries_data,
+                                      const query_instance_t *instance,
+                                      const char             *key,
+                                      size_t                  key_length) {
+    const query_file_compiler_entry_t entry = {.instance   = instance,
+                                               .key        = key,
+                                               .key_length = key_length,
+                                               .line = query_instance_get_line_in_file(instance)};
+    g_array_append_val((GArray *) entries_data, entry);
+    return 0;
+}
+
+/**
+ * @struct query_file_compiler_duplicates_t
+ * @brief  State of the collection of duplicate queries (see
+ *         ::__query_file_compiler_collect_duplicate).
+ *
+ * @var query_file_compiler_duplicates_t::entries
+ *     @brief `GArray` of ::query_file_compiler_entry_t, where duplicates are added.
+ * @var query_file_compiler_duplicates_t::originals
+ *     @brief Maps original queries to the index of their entries in
+ *            ::query_file_compiler_duplicates_t::entries.
+ */
+typedef struct {
+    GArray     *entries;
+    GHashTable *originals;
+} query_file_compiler_duplicates_t;
+
+/**
+ * @brief   Collects a duplicate query to be compiled.
+ * @details Auxiliary method for ::__query_file_compiler_store.
+ *
+ * @param duplicates_data A pointer to a ::query_file_compiler_duplicates_t.
+ * @param original        Query in the list identical to the duplicate query.
+ * @param line_in_file    Number of the line the duplicate query was on.
+ *
+ * @retval 0 Success.
+ * @retval 1 @p original has no canonical form.
+ */
+int __query_file_compiler_collect_duplicate(void                   *duplicates_data,
+                                            const query_instance_t *original,
+                                            size_t                  line_in_file) {
+    query_file_compiler_duplicates_t *const duplicates = duplicates_data;
+
+    gpointer index;
+    if (!g_hash_table_lookup_extended(duplicates->originals, original, NULL, &index))
+        return 1;
+
+    query_file_compiler_entry_t entry =
+        g_array_index(duplicates->entries, query_file_compiler_entry_t, GPOINTER_TO_SIZE(index));
+    entry.line = line_in_file;
+    g_array_append_val(duplicates->entries, entry);
+    return 0;
+}
+
+/**
+ * @brief   Compares queries to be compiled by their type and line number.
+ * @details Auxiliary method for ::__query_file_compiler_store, so that records are grouped by type.
+ *
+ * @param a Pointer to a ::query_file_compiler_entry_t.
+ * @param b Pointer to a ::query_file_compiler_entry_t.
+ *
+ * @return A negative value if @p a comes before @p b, a positive one if it comes after, or `0`.
+ */
+gint __query_file_compiler_compare_entries(gconstpointer a, gconstpointer b) {
+    const query_file_compiler_entry_t *const entry_a = a;
+    const query_file_compiler_entry_t *const entry_b = b;
+
+    const size_t type_a = query_type_get_type_number(query_instance_get_type(entry_a->instance));
+    const size_t type_b = query_type_get_type_number(query_instance_get_type(entry_b->instance));
+    if (type_a != type_b)
+        return type_a < type_b ? -1 : 1;
+    return (entry_a->line > entry_b->line) - (entry_a->line < entry_b->line);
+}
+
+/**
+ * @brief   Stores the compiled form of a query file.
+ * @details Auxiliary method for ::query_file_compiler_parse. The compiled form is first written to
+ *          a temporary file, that then replaces the previous one, so that readers never find a
+ *          partially written file.
+ *
+ * @param compiled_path Path to the compiled form.
+ * @param header        Header of the compiled form (without its
+ *                      ::query_file_compiler_header_t::record_count).
+ * @param list          Queries parsed from the text file.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO or allocation failure.
+ */
+int __query_file_compiler_store(const char                   *compiled_path,
+                                query_file_compiler_header_t *header,
+                                const query_instance_list_t  *list) {
+    GArray *const entries = g_array_new(FALSE, FALSE, sizeof(query_file_compiler_entry_t));
+    query_instance_list_iter_keys(list, __query_file_compiler_collect_key, entries);
+
+    query_file_compiler_duplicates_t duplicates = {
+        .entries   = entries,
+        .originals = g_hash_table_new(g_direct_hash, g_direct_equal)};
+    for (size_t i = 0; i < entries->len; ++i)
+        g_hash_table_insert(
+            duplicates.originals,
+            (gpointer) (size_t) g_array_index(entries, query_file_compiler_entry_t, i).instance,
+            GSIZE_TO_POINTER(i));
+    int retval = query_instance_list_iter_duplicates(list,
+                                                     __query_file_compiler_collect_duplicate,
+                                                     &duplicates);
+    g_hash_table_destroy(duplicates.originals);
+    if (retval) {
+        g_array_free(entries, TRUE);
+        return 1;
+    }
+    g_array_sort(entries, __query_file_compiler_compare_entries);
+
+    char        temporary_path[PATH_MAX];
+    FILE *const file = snprintf(temporary_path, PATH_MAX, "%s.tmp", compiled_path) < PATH_MAX
+                           ? fopen(temporary_path, "wb")
+                           : NULL;
+    if (!file) {
+        g_array_free(entries, TRUE);
+        return 1;
+    }
+
+    header->record_count = entries->len;
+    retval               = fwrite(header, sizeof(query_file_compiler_header_t), 1, file) != 1;
+    for (size_t i = 0; i < entries->len && !retval; ++i) {
+        const query_file_compiler_entry_t *const entry =
+            &g_array_index(entries, query_file_compiler_entry_t, i);
+        const query_instance_t *const instance = entry->instance;
+
+        /* Arguments are the null-terminated tokens after the header */
+        uint32_t argc = 0;
+        for (size_t j = strlen(entry->key) + 1; j < entry->key_length; ++j)
+            argc += entry->key[j] == '\0';
+
+        const query_file_compiler_record_t record = {
+            .line  = entry->line,
+            .type  = query_type_get_type_number(query_instance_get_type(instance)),
+            .flags = (query_instance_get_formatted(instance) ? QUERY_FILE_COMPILER_FLAG_FORMATTED
+                                                             : 0) |
+                     (query_instance_get_explain(instance) ? QUERY_FILE_COMPILER_FLAG_EXPLAIN : 0),
+            .argc  = argc,
+            .key_length = entry->key_length};
+
+        const char   padding[8]     = {0};
+        const size_t padding_length = (8 - entry->key_length % 8) % 8;
+        retval = fwrite(&record, sizeof(query_file_compiler_record_t), 1, file) != 1 ||
+                 fwrite(entry->key, 1, entry->key_length, file) != entry->key_length ||
+                 fwrite(padding, 1, padding_length, file) != padding_length;
+    }
+    g_array_free(entries, TRUE);
+
+    retval = fclose(file) || retval;
+    if (!retval)
+        retval = rename(temporary_path, compiled_path) != 0;
+    if (retval)
+        remove(temporary_path);
+    return retval;
+}
+
+query_instance_list_t *query_file_compiler_parse(const char *path, FILE *input) {
+    /* Only regular files can be recognized by their size and modification time */
+    struct stat source;
+    char        compiled_path[PATH_MAX];
+    if (fstat(fileno(input), &source) || !S_ISREG(source.st_mode) ||
+        __query_file_compiler_get_path(path, compiled_path))
+        return query_file_parser_parse(input);
+
+    query_file_compiler_header_t header;
+    __query_file_compiler_fill_header(&header, &source);
+
+    query_instance_list_t *list = __query_file_compiler_load(compiled_path, &header);
+    if (list)
+        return list;
+
+    list = query_file_parser_parse(input);
+    if (list)
+        __query_file_compiler_store(compiled_path, &header, list); /* Only a cache */
+    return list;
+}
@@ -23,79 +23,435 @@
  */
 
 #include <glib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
 
 #include "queries/query_file_parser.h"
 #include "queries/query_parser.h"
+#include "queries/query_tokenizer.h"
 #include "utils/stream_utils.h"
+#include "utils/thread_pool.h"
+
+/**
+ * @brief Value returned by ::__query_file_parser_parse_query_callback to stop reading the file
+ *        once a window is full.
+ */
+#define QUERY_FILE_PARSER_WINDOW_FULL 2
+
+/** @brief Minimum number of bytes of a query file that justify parsing it in one more thread. */
+#define QUERY_FILE_PARSER_MIN_CHUNK_SIZE 65536
+
+/** @brief Maximum number of threads used to parse a query file. */
+#define QUERY_FILE_PARSER_MAX_CHUNKS 64
+
+/** @brief Number of query instances in each block of a chunk's pool. */
+#define QUERY_FILE_PARSER_CHUNK_POOL_BLOCK_SIZE 1024
+
+/** @brief Number of bytes in each block of a chunk's argument arena. */
+#define QUERY_FILE_PARSER_CHUNK_ARENA_BLOCK_SIZE 16384
 
 /**
  * @struct query_file_parser_data_t
  * @brief  State of a parser of a file of queries.
  *
- * @var query_file_parser_data_t::aux_buffer
- *     @brief Auxiliary array passed to ::query_parser_parse_string, to reduce the number of
- *            allocations.
+ * @var query_file_parser_data_t::aux_key
+ *     @brief Auxiliary array of characters where the canonical form of each query is built.
+ * @var query_file_parser_data_t::aux_query
+ *     @brief Query instance every line is parsed into, before being copied to
+ *            ::query_file_parser_data_t::query_instance_list.
  * @var query_file_parser_data_t::line_number
  *     @brief Number of the current line of the file.
+ * @var query_file_parser_data_t::end_line_number
+ *     @brief Number of the first line of the file after the current window.
  * @var query_file_parser_data_t::query_instance_list
  *     @brief List to add parsed queries to.
  */
 typedef struct {
-    GPtrArray *const             aux_buffer;
+    GArray *const                aux_key;
+    query_instance_t *const      aux_query;
     size_t                       line_number;
+    size_t                       end_line_number;
     query_instance_list_t *const query_instance_list;
 } query_file_parser_data_t;
 
+/**
+ * @struct query_file_parser_key_data_t
+ * @brief  State of the construction of a query's canonical form.
+ *
+ * @var query_file_parser_key_data_t::key
+ *     @brief Where the canonical form of the query is being written to.
+ * @var query_file_parser_key_data_t::tokens_to_skip
+ *     @brief Number of leading tokens (::QUERY_PARSER_EXPLAIN_PREFIX, query type and formatting)
+ *            yet to be skipped.
+ */
+typedef struct {
+    GArray *const key;
+    size_t        tokens_to_skip;
+} query_file_parser_key_data_t;
+
+/**
+ * @brief   Appends a query's argument to its canonical form.
+ * @details Auxiliary method for ::__query_file_parser_build_key. Every argument is followed by a
+ *          null terminator, so that the boundaries between arguments are kept.
+ *
+ * @param user_data A pointer to a ::query_file_parser_key_data_t.
+ * @param token     Token of the query.
+ * @param length    Length of @p token.
+ *
+ * @retval 0 Always, to continue tokenization.
+ */
+int __query_file_parser_build_key_callback(void *user_data, const char *token, size_t length) {
+    query_file_parser_key_data_t *const key_data = user_data;
+
+    if (key_data->tokens_to_skip) {
+        key_data->tokens_to_skip--;
+    } else {
+        const char terminator = '\0';
+        g_array_append_vals(key_data->key, token, length);
+        g_array_append_val(key_data->key, terminator);
+    }
+    return 0;
+}
+
+/**
+ * @brief   Builds the canonical form of a successfully parsed query.
+ * @details Auxiliary method for ::__query_file_parser_parse_query_callback. Queries with the same
+ *          canonical form have the same type, formatting, explain flag and arguments, regardless
+ *          of how many spaces or quotes separate those arguments.
+ *
+ * @param key   Array of characters where to write the canonical form of the query to.
+ * @param query Parsed query.
+ * @param line  Line @p query was parsed from.
+ */
+void __query_file_parser_build_key(GArray *key, const query_instance_t *query, const char *line) {
+    char      header[32];
+    const int header_length =
+        snprintf(header,
+                 32,
+                 "%zu%c%c",
+                 query_type_get_type_number(query_instance_get_type(query)),
+                 query_instance_get_formatted(query) ? 'F' : ' ',
+                 query_instance_get_explain(query) ? 'E' : ' ');
+
+    g_array_set_size(key, 0);
+    g_array_append_vals(key, header, header_length + 1);
+
+    query_file_parser_key_data_t key_data = {
+        .key            = key,
+        .tokens_to_skip = query_instance_get_explain(query) ? 2 : 1};
+    query_tokenizer_tokenize_slices(line, __query_file_parser_build_key_callback, &key_data);
+}
+
 /**
  * @brief   Parses a line (containing a query) in a query file.
- * @details Auxiliary method for ::query_file_parser_parse.
+ * @details Auxiliary method for ::query_file_parser_parse_window.
  *
  * @param user_data A pointer to a ::query_file_parser_data_t.
  * @param line      Query to be parsed.
  *
- * @retval 0 Success (parsing failures may occur).
- * @retval 1 Allocation failure.
+ * @retval 0                             Success (parsing failures may occur).
+ * @retval 1                             Allocation failure.
+ * @retval QUERY_FILE_PARSER_WINDOW_FULL Success, and no more lines fit in the current window.
  */
 int __query_file_parser_parse_query_callback(void *user_data, char *line) {
     query_file_parser_data_t *const parser_data = user_data;
 
-    query_instance_t *const aux_query = query_instance_create();
-    if (!aux_query)
-        return 1;
+    query_instance_t *const aux_query = parser_data->aux_query;
 
-    const int retval = query_parser_parse_string(aux_query, line, parser_data->aux_buffer);
+    const int retval = query_parser_parse_string(
+        aux_query,
+        line,
+        query_instance_list_get_argument_allocator(parser_data->query_instance_list));
     if (retval) {
-        query_instance_free(aux_query);
-        parser_data->line_number++;
-        return 0; /* Ignore parsing failures */
+        /* Ignore parsing failures */
+        return ++parser_data->line_number == parser_data->end_line_number
+                   ? QUERY_FILE_PARSER_WINDOW_FULL
+                   : 0;
     }
 
     query_instance_set_line_in_file(aux_query, parser_data->line_number);
-    if (query_instance_list_add(parser_data->query_instance_list, aux_query)) {
-        query_instance_free(aux_query);
+    __query_file_parser_build_key(parser_data->aux_key, aux_query, line);
+    if (query_instance_list_add_unique(parser_data->query_instance_list,
+                                       aux_query,
+                                       parser_data->aux_key->data,
+                                       parser_data->aux_key->len))
         return 1; /* Allocation failure */
+
+    return ++parser_data->line_number == parser_data->end_line_number
+               ? QUERY_FILE_PARSER_WINDOW_FULL
+               : 0;
+}
+
+/**
+ * @struct query_file_parser_record_t
+ * @brief  A query parsed by a thread, before being added to the resulting list.
+ *
+ * @var query_file_parser_record_t::instance
+ *     @brief Parsed query, allocated in ::query_file_parser_chunk_t::instances.
+ * @var query_file_parser_record_t::line
+ *     @brief Number of the line of the query, counting from the beginning of its chunk (from `0`).
+ * @var query_file_parser_record_t::key_offset
+ *     @brief Index of the canonical form of the query in ::query_file_parser_chunk_t::keys.
+ * @var query_file_parser_record_t::key_length
+ *     @brief Number of bytes in the canonical form of the query.
+ */
+typedef struct {
+    query_instance_t *instance;
+    size_t            line;
+    size_t            key_offset;
+    size_t            key_length;
+} query_file_parser_record_t;
+
+/**
+ * @struct query_file_parser_chunk_t
+ * @brief  State of the thread parsing a chunk of a query file.
+ *
+ * @var query_file_parser_chunk_t::aux_key
+ *     @brief Auxiliary array of characters where the canonical form of each query is built.
+ * @var query_file_parser_chunk_t::aux_query
+ *     @brief Query instance every line is parsed into, before being copied to
+ *            ::query_file_parser_chunk_t::instances.
+ * @var query_file_parser_chunk_t::arguments
+ *     @brief Where the arguments of the queries in this chunk are allocated. `NULL` once owned by
+ *            the resulting list.
+ * @var query_file_parser_chunk_t::instances
+ *     @brief Pool where the queries in this chunk are allocated.
+ * @var query_file_parser_chunk_t::records
+ *     @brief Array of ::query_file_parser_record_t, for every query parsed, in file order.
+ * @var query_file_parser_chunk_t::keys
+ *     @brief Array of characters with the canonical forms of all queries parsed.
+ * @var query_file_parser_chunk_t::lines
+ *     @brief Number of lines read in this chunk.
+ */
+typedef struct {
+    GArray           *aux_key;
+    query_instance_t *aux_query;
+    arena_t          *arguments;
+    pool_t           *instances;
+    GArray           *records;
+    GArray           *keys;
+    size_t            lines;
+} query_file_parser_chunk_t;
+
+/**
+ * @brief Frees memory in the state of the thread parsing a chunk of a query file.
+ * @param chunk Chunk state to be freed. Fields may be `NULL`.
+ */
+void __query_file_parser_chunk_free(query_file_parser_chunk_t *chunk) {
+    if (chunk->aux_key)
+        g_array_unref(chunk->aux_key);
+    if (chunk->aux_query)
+        query_instance_free(chunk->aux_query);
+    if (chunk->arguments)
+        arena_free(chunk->arguments);
+    if (chunk->instances)
+        pool_free(chunk->instances);
+    if (chunk->records)
+        g_array_unref(chunk->records);
+    if (chunk->keys)
+        g_array_unref(chunk->keys);
+}
+
+/**
+ * @brief Initializes the state of the thread parsing a chunk of a query file.
+ * @param chunk Chunk state to be initialized.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p chunk mustn't be freed).
+ */
+int __query_file_parser_chunk_init(query_file_parser_chunk_t *chunk) {
+    chunk->aux_key   = g_array_new(FALSE, FALSE, sizeof(char));
+    chunk->aux_query = query_instance_create();
+    chunk->arguments = arena_create(QUERY_FILE_PARSER_CHUNK_ARENA_BLOCK_SIZE);
+    chunk->instances =
+        pool_create_from_size(query_instance_sizeof(), QUERY_FILE_PARSER_CHUNK_POOL_BLOCK_SIZE);
+    chunk->records = g_array_new(FALSE, FALSE, sizeof(query_file_parser_record_t));
+    chunk->keys    = g_array_new(FALSE, FALSE, sizeof(char));
+    chunk->lines   = 0;
+
+    if (!chunk->aux_query || !chunk->arguments || !chunk->instances) {
+        __query_file_parser_chunk_free(chunk);
+        return 1;
     }
-    query_instance_free(aux_query);
+    return 0;
+}
+
+/**
+ * @brief   Parses a line (containing a query) in a chunk of a query file.
+ * @details Auxiliary method for ::__query_file_parser_parse_parallel. Called concurrently for
+ *          different chunks.
+ *
+ * @param user_data A pointer to a ::query_file_parser_chunk_t.
+ * @param line      Query to be parsed.
+ * @param length    Length of @p line.
+ *
+ * @retval 0 Success (parsing failures may occur).
+ * @retval 1 Allocation failure.
+ */
+int __query_file_parser_parse_chunk_callback(void *user_data, char *line, size_t length) {
+    (void) length;
+    query_file_parser_chunk_t *const chunk = user_data;
+
+    if (query_parser_parse_string(chunk->aux_query, line, chunk->arguments)) {
+        chunk->lines++;
+        return 0; /* Ignore parsing failures */
+    }
+
+    query_instance_t *const instance = query_instance_clone(chunk->instances, chunk->aux_query);
+    if (!instance)
+        return 1;
 
-    parser_data->line_number++;
+    __query_file_parser_build_key(chunk->aux_key, chunk->aux_query, line);
+    const query_file_parser_record_t record = {.instance   = instance,
+                                               .line       = chunk->lines,
+                                               .key_offset = chunk->keys->len,
+                                               .key_length = chunk->aux_key->len};
+    g_array_append_vals(chunk->keys, chunk->aux_key->data, chunk->aux_key->len);
+    g_array_append_val(chunk->records, record);
+
+    chunk->lines++;
     return 0;
 }
 
+/**
+ * @brief  Calculates in how many chunks (parsed by different threads) a query file should be split.
+ * @param  input Query file, that will be parsed from its current position.
+ * @return The number of chunks. `1` means the file shouldn't be parsed in parallel.
+ */
+size_t __query_file_parser_get_chunk_count(FILE *input) {
+    struct stat st;
+    const long  position = ftell(input);
+    if (position < 0 || stream_tokenize_get_method(input) != STREAM_TOKENIZE_METHOD_MMAP ||
+        fstat(fileno(input), &st) || st.st_size <= position)
+        return 1;
+
+    const size_t threads = thread_pool_get_stage_thread_count(THREAD_POOL_STAGE_QUERIES);
+    size_t       n       = (size_t) (st.st_size - position) / QUERY_FILE_PARSER_MIN_CHUNK_SIZE;
+    if (n > threads)
+        n = threads;
+
+    if (n > QUERY_FILE_PARSER_MAX_CHUNKS)
+        n = QUERY_FILE_PARSER_MAX_CHUNKS;
+    else if (n == 0)
+        n = 1;
+
+    return n;
+}
+
+/**
+ * @brief   Parses the rest of a query file, splitting it into chunks parsed by different threads.
+ * @details Auxiliary method for ::query_file_parser_parse_window. Each thread parses into its own
+ *          arena and pool, so that no synchronization is needed. Afterwards, the queries in each
+ *          chunk are added to the resulting list in file order, after being given their line
+ *          numbers (that weren't known while parsing chunks other than the first one).
+ *
+ * @param input       Input file stream to be read.
+ * @param n           Number of chunks (and threads).
+ * @param line_number Number of the first line to be read (input), and of the line after the last
+ *                    one read (output).
+ *
+ * @return A pointer to a ::query_instance_list_t, or `NULL` on allocation failure.
+ */
+query_instance_list_t *
+    __query_file_parser_parse_parallel(FILE *input, size_t n, size_t *line_number) {
+    query_file_parser_chunk_t chunks[n];
+    void                     *chunks_data[n];
+    for (size_t i = 0; i < n; ++i) {
+        if (__query_file_parser_chunk_init(&chunks[i])) {
+            for (size_t j = 0; j < i; ++j)
+                __query_file_parser_chunk_free(&chunks[j]);
+            return NULL;
+        }
+        chunks_data[i] = &chunks[i];
+    }
+
+    query_instance_list_t *list = NULL;
+
+    fflush(input); /* Position the file descriptor where stdio's stream is */
+    if (stream_tokenize_slices_chunked(input,
+                                       '\n',
+                                       n,
+                                       __query_file_parser_parse_chunk_callback,
+                                       chunks_data))
+        goto DEFER;
+
+    list = query_instance_list_create();
+    if (!list)
+        goto DEFER;
+
+    size_t chunk_start = *line_number;
+    for (size_t i = 0; i < n; ++i) {
+        if (query_instance_list_adopt_arena(list, chunks[i].arguments))
+            goto FAILURE;
+        chunks[i].arguments = NULL;
+
+        for (size_t j = 0; j < chunks[i].records->len; ++j) {
+            const query_file_parser_record_t *const record =
+                &g_array_index(chunks[i].records, query_file_parser_record_t, j);
+
+            query_instance_set_line_in_file(record->instance, chunk_start + record->line);
+            if (query_instance_list_add_unique(list,
+                                               record->instance,
+                                               chunks[i].keys->data + record->key_offset,
+                                               record->key_length))
+                goto FAILURE;
+        }
+        chunk_start += chunks[i].lines;
+    }
+    *line_number = chunk_start;
+    goto DEFER;
+
+FAILURE:
+    query_instance_list_free(list);
+    list = NULL;
+DEFER:
+    for (size_t i = 0; i < n; ++i)
+        __query_file_parser_chunk_free(&chunks[i]);
+    return list;
+}
+
 query_instance_list_t *query_file_parser_parse(FILE *input) {
+    size_t line_number = 1;
+    return query_file_parser_parse_window(input, SIZE_MAX, &line_number);
+}
+
+query_instance_list_t *
+    query_file_parser_parse_window(FILE *input, size_t max_lines, size_t *line_number) {
+    if (max_lines == SIZE_MAX) {
+        const size_t n = __query_file_parser_get_chunk_count(input);
+        if (n > 1)
+            return __query_file_parser_parse_parallel(input, n, line_number);
+    }
+
     query_instance_list_t *const list = query_instance_list_create();
     if (!list)
         return NULL;
 
-    query_file_parser_data_t parser_data = {.aux_buffer          = g_ptr_array_new(),
-                                            .line_number         = 1,
-                                            .query_instance_list = list};
+    query_instance_t *const aux_query = query_instance_create();
+    if (!aux_query) {
+        query_instance_list_free(list);
+        return NULL;
+    }
 
-    if (stream_tokenize(input, '\n', __query_file_parser_parse_query_callback, &parser_data)) {
-        g_ptr_array_unref(parser_data.aux_buffer);
+    query_file_parser_data_t parser_data = {
+        .aux_key             = g_array_new(FALSE, FALSE, sizeof(char)),
+        .aux_query           = aux_query,
+        .line_number         = *line_number,
+        .end_line_number     = max_lines > SIZE_MAX - *line_number ? 0 : *line_number + max_lines,
+        .query_instance_list = list};
+
+    const int retval =
+        stream_tokenize(input, '\n', __query_file_parser_parse_query_callback, &parser_data);
+    if (retval && retval != QUERY_FILE_PARSER_WINDOW_FULL) {
+        g_array_unref(parser_data.aux_key);
+        query_instance_free(aux_query);
         query_instance_list_free(list);
         return NULL;
     }
 
-    g_ptr_array_unref(parser_data.aux_buffer);
+    g_array_unref(parser_data.aux_key);
+    query_instance_free(aux_query);
+    *line_number = parser_data.line_number;
     return list;
 }
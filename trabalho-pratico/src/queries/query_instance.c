@@ -35,16 +35,24 @@
  *            line.
  * @var query_instance::formatted
  *     @brief If the query's output should be formatted (pretty printed).
+ * @var query_instance::explain
+ *     @brief If the access paths and records touched by the query should be reported.
  * @var query_instance::line_in_file
  *     @brief The number of the line this query is in the input file (`1` for interactive mode).
  * @var query_instance::argument_data
- *     @brief The arguments of this query, after being parsed by the specific query type.
+ *     @brief The arguments of this query, after being parsed by the specific query type. Not owned
+ *            by the query instance.
+ * @var query_instance::cancellation
+ *     @brief What to check to know if this query should stop (`NULL` if it can't be cancelled). Not
+ *            owned by the query instance.
  */
 struct query_instance {
-    const query_type_t *type;
-    int                 formatted;
-    size_t              line_in_file;
-    void               *argument_data;
+    const query_type_t         *type;
+    int                         formatted;
+    int                         explain;
+    size_t                      line_in_file;
+    const void                 *argument_data;
+    const query_cancellation_t *cancellation;
 };
 
 query_instance_t *query_instance_create(void) {
@@ -54,25 +62,19 @@ query_instance_t *query_instance_create(void) {
 
     /* Invalid data so that deallocations and clones don't deal with uninitialized data. */
     ret->type          = NULL;
+    ret->explain       = 0;
     ret->argument_data = NULL;
+    ret->cancellation  = NULL;
     return ret;
 }
 
-query_instance_t *query_instance_clone(const query_instance_t *query) {
-    query_instance_t *const clone = malloc(sizeof(query_instance_t));
+query_instance_t *query_instance_clone(pool_t *allocator, const query_instance_t *query) {
+    query_instance_t *const clone = allocator ? pool_alloc_item(query_instance_t, allocator)
+                                              : malloc(sizeof(query_instance_t));
     if (!clone)
         return NULL;
-    memcpy(clone, query, sizeof(query_instance_t));
 
-    if (query->type && query->argument_data) {
-        const query_type_clone_arguments_callback_t clone_cb =
-            query_type_get_clone_arguments_callback(query->type);
-        clone->argument_data = clone_cb(query->argument_data);
-        if (!clone->argument_data) {
-            free(clone);
-            return NULL;
-        }
-    }
+    memcpy(clone, query, sizeof(query_instance_t));
     return clone;
 }
 
@@ -84,6 +86,10 @@ void query_instance_set_formatted(query_instance_t *query, int formatted) {
     query->formatted = formatted;
 }
 
+void query_instance_set_explain(query_instance_t *query, int explain) {
+    query->explain = explain;
+}
+
 void query_instance_set_line_in_file(query_instance_t *query, size_t line_in_file) {
     query->line_in_file = line_in_file;
 }
@@ -92,20 +98,15 @@ int query_instance_set_argument_data(query_instance_t *query, const void *argume
     if (!query->type)
         return 1;
 
-    if (query->argument_data) {
-        const query_type_free_arguments_callback_t free_cb =
-            query_type_get_free_arguments_callback(query->type);
-        free_cb(query->argument_data);
-    }
-
-    query_type_clone_arguments_callback_t clone_cb =
-        query_type_get_clone_arguments_callback(query->type);
-    query->argument_data = clone_cb(argument_data);
-    if (!query->argument_data)
-        return 1;
+    query->argument_data = argument_data;
     return 0;
 }
 
+void query_instance_set_cancellation(query_instance_t           *query,
+                                     const query_cancellation_t *cancellation) {
+    query->cancellation = cancellation;
+}
+
 const query_type_t *query_instance_get_type(const query_instance_t *query) {
     return query->type;
 }
@@ -114,6 +115,10 @@ int query_instance_get_formatted(const query_instance_t *query) {
     return query->formatted;
 }
 
+int query_instance_get_explain(const query_instance_t *query) {
+    return query->explain;
+}
+
 size_t query_instance_get_line_in_file(const query_instance_t *query) {
     return query->line_in_file;
 }
@@ -122,11 +127,18 @@ const void *query_instance_get_argument_data(const query_instance_t *query) {
     return query->argument_data;
 }
 
+const query_cancellation_t *query_instance_get_cancellation(const query_instance_t *query) {
+    return query->cancellation;
+}
+
+int query_instance_is_cancelled(const query_instance_t *query) {
+    return query_cancellation_is_cancelled(query->cancellation);
+}
+
+size_t query_instance_sizeof(void) {
+    return sizeof(query_instance_t);
+}
+
 void query_instance_free(query_instance_t *query) {
-    if (query->type && query->argument_data) {
-        const query_type_free_arguments_callback_t free_cb =
-            query_type_get_free_arguments_callback(query->type);
-        free_cb(query->argument_data);
-    }
     free(query);
 }
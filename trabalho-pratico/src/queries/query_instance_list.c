@@ -24,22 +24,102 @@
 
 #include <glib.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "queries/query_instance_list.h"
+#include "queries/query_type_list.h"
+#include "utils/pool.h"
+
+/** @brief Number of query instances in each block of a ::query_instance_list_t's pool. */
+#define QUERY_INSTANCE_LIST_POOL_BLOCK_SIZE 1024
+
+/** @brief Number of bytes in each block of a ::query_instance_list_t's argument arena. */
+#define QUERY_INSTANCE_LIST_ARENA_BLOCK_SIZE 16384
+
+/**
+ * @struct query_instance_list_arguments_t
+ * @brief  Arena with query arguments, shared between a list and its clones.
+ *
+ * @var query_instance_list_arguments_t::arena
+ *     @brief Where query arguments are allocated.
+ * @var query_instance_list_arguments_t::adopted
+ *     @brief Other arenas with query arguments, given by ::query_instance_list_adopt_arena.
+ *            `NULL` if there are none.
+ * @var query_instance_list_arguments_t::references
+ *     @brief Number of lists referring to this arena.
+ */
+typedef struct {
+    arena_t   *arena;
+    GPtrArray *adopted;
+    size_t     references;
+} query_instance_list_arguments_t;
+
+/**
+ * @struct query_instance_list_key_t
+ * @brief  Canonical form of a query, used to find duplicate queries in a list.
+ *
+ * @var query_instance_list_key_t::instance
+ *     @brief First query instance in the list with this key.
+ * @var query_instance_list_key_t::length
+ *     @brief Number of bytes in ::query_instance_list_key_t::data.
+ * @var query_instance_list_key_t::data
+ *     @brief Canonical form of the query (not null-terminated).
+ */
+typedef struct {
+    const query_instance_t *instance;
+    size_t                  length;
+    const char             *data;
+} query_instance_list_key_t;
+
+/**
+ * @struct query_instance_list_duplicate_t
+ * @brief  A query that wasn't added to a list, because an identical query had already been added.
+ *
+ * @var query_instance_list_duplicate_t::original
+ *     @brief Query in the list identical to this one.
+ * @var query_instance_list_duplicate_t::line_in_file
+ *     @brief Line the duplicate query was on.
+ */
+typedef struct {
+    const query_instance_t *original;
+    size_t                  line_in_file;
+} query_instance_list_duplicate_t;
 
 /**
  * @struct query_instance_list
- * @brief  A container for a sorted list of ::query_instance_t.
+ * @brief  A container for a list of ::query_instance_t, grouped by type.
  *
- * @var query_instance_list::list
- *     @brief Actual sorted list of ::query_instance_t.
+ * @var query_instance_list::buckets
+ *     @brief   Queries of each type (pointers to items in ::query_instance_list::instances),
+ *              indexed by type number minus one.
+ *     @details Queries are added to the bucket of their type, so grouping them by type never
+ *              requires sorting.
+ * @var query_instance_list::length
+ *     @brief Number of queries in all ::query_instance_list::buckets.
+ * @var query_instance_list::instances
+ *     @brief Pool where the query instances in this list are allocated.
+ * @var query_instance_list::arguments
+ *     @brief Arena where the arguments of the queries in this list are allocated.
+ * @var query_instance_list::keys
+ *     @brief Set of ::query_instance_list_key_t (allocated in ::query_instance_list::arguments) of
+ *            the queries added with ::query_instance_list_add_unique. `NULL` before the first of
+ *            those queries is added.
+ * @var query_instance_list::duplicates
+ *     @brief Array of ::query_instance_list_duplicate_t, for queries not added with
+ *            ::query_instance_list_add_unique. `NULL` if there are none.
  * @var query_instance_list::sorted
- *     @brief If the list is sorted. When performing an iteration, the array will be sorted so that
- *            this becomes `1`.
+ *     @brief   If the queries in every bucket are in line order.
+ *     @details Queries are usually added in line order, so this only becomes `0` when they aren't.
+ *              When performing an iteration, buckets are then sorted so that this becomes `1`.
  */
 struct query_instance_list {
-    GPtrArray *list;
-    int        sorted;
+    GPtrArray                       *buckets[QUERY_TYPE_LIST_COUNT];
+    size_t                           length;
+    pool_t                          *instances;
+    query_instance_list_arguments_t *arguments;
+    GHashTable                      *keys;
+    GArray                          *duplicates;
+    int                              sorted;
 };
 
 query_instance_list_t *query_instance_list_create(void) {
@@ -47,109 +127,335 @@ query_instance_list_t *query_instance_list_create(void) {
     if (!list)
         return NULL;
 
-    list->list   = g_ptr_array_new_with_free_func((GDestroyNotify) query_instance_free);
-    list->sorted = 1;
+    list->instances =
+        pool_create_from_size(query_instance_sizeof(), QUERY_INSTANCE_LIST_POOL_BLOCK_SIZE);
+    if (!list->instances)
+        goto DEFER_1;
+
+    list->arguments = malloc(sizeof(query_instance_list_arguments_t));
+    if (!list->arguments)
+        goto DEFER_2;
+
+    list->arguments->arena = arena_create(QUERY_INSTANCE_LIST_ARENA_BLOCK_SIZE);
+    if (!list->arguments->arena)
+        goto DEFER_3;
+    list->arguments->adopted    = NULL;
+    list->arguments->references = 1;
+
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i)
+        list->buckets[i] = g_ptr_array_new();
+    list->length     = 0;
+    list->keys       = NULL;
+    list->duplicates = NULL;
+    list->sorted     = 1;
     return list;
+
+DEFER_3:
+    free(list->arguments);
+DEFER_2:
+    pool_free(list->instances);
+DEFER_1:
+    free(list);
+    return NULL;
 }
 
-/** @brief `GCopyFunc` to copy a ::query_instance_t. */
-gpointer __query_instance_list_copy_query_instance(gconstpointer instance, gpointer user_data) {
-    (void) user_data;
-    return query_instance_clone(instance);
+/**
+ * @brief   Adds a query instance to the bucket of its type.
+ * @details Auxiliary method for ::query_instance_list_add and ::__query_instance_list_clone_range.
+ *
+ * @param list     List to add @p instance to.
+ * @param instance Query instance allocated in ::query_instance_list::instances.
+ */
+void __query_instance_list_add_to_bucket(query_instance_list_t *list, query_instance_t *instance) {
+    const size_t     type   = query_type_get_type_number(query_instance_get_type(instance));
+    GPtrArray *const bucket = list->buckets[type - 1];
+
+    if (bucket->len) {
+        const query_instance_t *const last = g_ptr_array_index(bucket, bucket->len - 1);
+        if (query_instance_get_line_in_file(instance) < query_instance_get_line_in_file(last))
+            list->sorted = 0;
+    }
+
+    g_ptr_array_add(bucket, instance);
+    list->length++;
 }
 
-query_instance_list_t *query_instance_list_clone(const query_instance_list_t *list) {
+/**
+ * @brief   Gets the query instance in a position of a list.
+ * @details Queries are ordered by type, and then by the order of their buckets (line order, after
+ *          sorting).
+ *
+ * @param list   List to get the query from.
+ * @param bucket Where to start searching from, and where to write the bucket of the query to.
+ * @param index  Where to start searching from (in @p bucket), and where to write the index of the
+ *               query in its bucket to.
+ */
+void __query_instance_list_seek(const query_instance_list_t *list, size_t *bucket, size_t *index) {
+    while (*bucket < QUERY_TYPE_LIST_COUNT && *index >= list->buckets[*bucket]->len) {
+        *index -= list->buckets[*bucket]->len;
+        ++*bucket;
+    }
+}
+
+/**
+ * @brief   Creates a copy of consecutive query instances in a list.
+ * @details Auxiliary method for ::query_instance_list_clone, ::query_instance_list_clone_part and
+ *          ::query_instance_list_clone_filtered.
+ *
+ * @param list      List to be partially cloned.
+ * @param start     Index of the first query to be cloned.
+ * @param end       Index after the last query to be cloned.
+ * @param filter    Method that chooses which queries in the range are cloned. `NULL` to clone all
+ *                  of them.
+ * @param user_data Value passed to @p filter.
+ *
+ * @return A pointer to a new ::query_instance_list_t, or `NULL` on allocation failure.
+ */
+query_instance_list_t *
+    __query_instance_list_clone_range(const query_instance_list_t        *list,
+                                      size_t                              start,
+                                      size_t                              end,
+                                      query_instance_list_filter_callback filter,
+                                      void                               *user_data) {
     query_instance_list_t *const clone = malloc(sizeof(query_instance_list_t));
     if (!clone)
         return NULL;
 
+    clone->instances =
+        pool_create_from_size(query_instance_sizeof(), QUERY_INSTANCE_LIST_POOL_BLOCK_SIZE);
+    if (!clone->instances) {
+        free(clone);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i)
+        clone->buckets[i] = g_ptr_array_new();
+    clone->length = 0;
     clone->sorted = list->sorted;
-    clone->list   = g_ptr_array_copy(list->list, __query_instance_list_copy_query_instance, NULL);
+
+    size_t bucket = 0, index = start;
+    for (size_t i = start; i < end; ++i, ++index) {
+        __query_instance_list_seek(list, &bucket, &index);
+        const query_instance_t *const original = g_ptr_array_index(list->buckets[bucket], index);
+        if (filter && !filter(user_data, original))
+            continue;
+
+        query_instance_t *const instance = query_instance_clone(clone->instances, original);
+        if (!instance) {
+            for (size_t j = 0; j < QUERY_TYPE_LIST_COUNT; ++j)
+                g_ptr_array_unref(clone->buckets[j]);
+            pool_free(clone->instances);
+            free(clone);
+            return NULL;
+        }
+        __query_instance_list_add_to_bucket(clone, instance);
+    }
+
+    /* Arguments are immutable, so they can be shared */
+    clone->arguments = list->arguments;
+    clone->arguments->references++;
+
+    clone->keys       = NULL; /* Duplicates aren't kept track of in clones */
+    clone->duplicates = NULL;
     return clone;
 }
 
-int query_instance_list_add(query_instance_list_t *list, const query_instance_t *query) {
-    query_instance_t *const clone = query_instance_clone(query);
-    if (!clone)
-        return 1;
+query_instance_list_t *query_instance_list_clone(const query_instance_list_t *list) {
+    return __query_instance_list_clone_range(list, 0, list->length, NULL, NULL);
+}
+
+query_instance_list_t *
+    query_instance_list_clone_filtered(const query_instance_list_t        *list,
+                                       query_instance_list_filter_callback callback,
+                                       void                               *user_data) {
+    return __query_instance_list_clone_range(list, 0, list->length, callback, user_data);
+}
+
+arena_t *query_instance_list_get_argument_allocator(query_instance_list_t *list) {
+    return list->arguments->arena;
+}
 
-    g_ptr_array_add(list->list, clone);
-    list->sorted = 0;
+int query_instance_list_adopt_arena(query_instance_list_t *list, arena_t *arena) {
+    if (!list->arguments->adopted) {
+        list->arguments->adopted = g_ptr_array_new_with_free_func((GDestroyNotify) arena_free);
+        if (!list->arguments->adopted)
+            return 1;
+    }
+
+    g_ptr_array_add(list->arguments->adopted, arena);
     return 0;
 }
 
-/** @brief Compares two query instances to order them by type. */
-gint __query_instance_list_compare(gconstpointer a, gconstpointer b) {
-    const ssize_t crit1 = (ssize_t) query_instance_get_type(*(const query_instance_t *const *) a) -
-                          (ssize_t) query_instance_get_type(*(const query_instance_t *const *) b);
-    if (crit1)
-        return crit1;
+/**
+ * @brief   Adds a copy of a query instance to a list.
+ * @details Auxiliary method for ::query_instance_list_add and ::query_instance_list_add_unique.
+ *
+ * @param list  List to add @p query to.
+ * @param query Query instance to be copied.
+ *
+ * @return The copy of @p query in @p list, or `NULL` on allocation failure.
+ */
+query_instance_t *__query_instance_list_add(query_instance_list_t  *list,
+                                            const query_instance_t *query) {
+    query_instance_t *const clone = query_instance_clone(list->instances, query);
+    if (clone)
+        __query_instance_list_add_to_bucket(list, clone);
+    return clone;
+}
 
-    const ssize_t crit2 =
-        (ssize_t) query_instance_get_line_in_file(*(const query_instance_t *const *) a) -
-        (ssize_t) query_instance_get_line_in_file(*(const query_instance_t *const *) b);
-    return crit2;
+int query_instance_list_add(query_instance_list_t *list, const query_instance_t *query) {
+    return __query_instance_list_add(list, query) == NULL;
 }
 
-int query_instance_list_iter_types(query_instance_list_t                  *list,
-                                   query_instance_list_iter_types_callback callback,
-                                   void                                   *user_data) {
-    if (!list->sorted) {
-        g_ptr_array_sort(list->list, __query_instance_list_compare);
-        list->sorted = 1;
+/** @brief Hashes a ::query_instance_list_key_t. */
+guint __query_instance_list_key_hash(gconstpointer key) {
+    const query_instance_list_key_t *const k = key;
+
+    guint hash = 5381;
+    for (size_t i = 0; i < k->length; ++i)
+        hash = (hash << 5) + hash + (unsigned char) k->data[i];
+    return hash;
+}
+
+/** @brief Checks if two ::query_instance_list_key_t are equal. */
+gboolean __query_instance_list_key_equal(gconstpointer a, gconstpointer b) {
+    const query_instance_list_key_t *const ka = a;
+    const query_instance_list_key_t *const kb = b;
+    return ka->length == kb->length && memcmp(ka->data, kb->data, ka->length) == 0;
+}
+
+int query_instance_list_add_unique(query_instance_list_t  *list,
+                                   const query_instance_t *query,
+                                   const char             *key,
+                                   size_t                  key_length) {
+    if (!list->keys) {
+        list->keys =
+            g_hash_table_new(__query_instance_list_key_hash, __query_instance_list_key_equal);
     }
 
-    if (list->list->len == 0) /* Don't fail on edge case */
+    const query_instance_list_key_t        lookup   = {.length = key_length, .data = key};
+    const query_instance_list_key_t *const existing = g_hash_table_lookup(list->keys, &lookup);
+    if (existing) {
+        if (!list->duplicates)
+            list->duplicates = g_array_new(FALSE, FALSE, sizeof(query_instance_list_duplicate_t));
+
+        const query_instance_list_duplicate_t duplicate = {
+            .original     = existing->instance,
+            .line_in_file = query_instance_get_line_in_file(query)};
+        g_array_append_val(list->duplicates, duplicate);
         return 0;
+    }
 
-    query_instance_t *instance = g_ptr_array_index(list->list, 0);
+    query_instance_list_key_t *const new_key =
+        arena_allocate(list->arguments->arena, sizeof(query_instance_list_key_t));
+    if (!new_key)
+        return 1;
+    new_key->length = key_length;
+    new_key->data   = arena_put(list->arguments->arena, key, key_length ? key_length : 1);
+    if (!new_key->data)
+        return 1;
 
-    size_t              current_set_start = 0;
-    const query_type_t *current_set_type  = query_instance_get_type(instance); /* First instance */
-    size_t              current_set_count = 1;
+    new_key->instance = __query_instance_list_add(list, query);
+    if (!new_key->instance)
+        return 1;
 
-    for (size_t i = 1; i < list->list->len; ++i) {
-        instance                 = g_ptr_array_index(list->list, i);
-        const query_type_t *type = query_instance_get_type(instance);
+    g_hash_table_add(list->keys, new_key);
+    return 0;
+}
 
-        if (type == current_set_type) {
-            current_set_count++;
-        } else {
-            if (current_set_count > 0) {
-                const query_instance_t *const *current_set =
-                    (const query_instance_t *const *) &g_ptr_array_index(list->list,
-                                                                         current_set_start);
+/** @brief Compares two query instances of the same type to order them by line. */
+gint __query_instance_list_compare(gconstpointer a, gconstpointer b) {
+    const size_t line_a = query_instance_get_line_in_file(*(const query_instance_t *const *) a);
+    const size_t line_b = query_instance_get_line_in_file(*(const query_instance_t *const *) b);
+    return (line_a > line_b) - (line_a < line_b);
+}
 
-                const int cb_ret = callback(user_data, current_set_count, current_set);
-                if (cb_ret)
-                    return cb_ret;
-            }
+/**
+ * @brief Sorts every bucket of a list by line, if any isn't sorted yet.
+ * @param list List to be sorted.
+ */
+void __query_instance_list_sort(query_instance_list_t *list) {
+    if (list->sorted)
+        return;
 
-            current_set_count = 1;
-            current_set_start = i;
-            current_set_type  = type;
-        }
-    }
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i)
+        g_ptr_array_sort(list->buckets[i], __query_instance_list_compare);
+    list->sorted = 1;
+}
 
-    const query_instance_t *const *current_set =
-        (const query_instance_t *const *) &g_ptr_array_index(list->list, current_set_start);
-    const int cb_ret = callback(user_data, current_set_count, current_set);
-    if (cb_ret)
-        return cb_ret;
+query_instance_list_t *
+    query_instance_list_clone_part(query_instance_list_t *list, size_t i, size_t n) {
+    __query_instance_list_sort(list);
+    return __query_instance_list_clone_range(list,
+                                             list->length * i / n,
+                                             list->length * (i + 1) / n,
+                                             NULL,
+                                             NULL);
+}
+
+int query_instance_list_iter_types(query_instance_list_t                  *list,
+                                   query_instance_list_iter_types_callback callback,
+                                   void                                   *user_data) {
+    __query_instance_list_sort(list);
+
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        GPtrArray *const bucket = list->buckets[i];
+        if (bucket->len == 0)
+            continue;
 
+        const int retval =
+            callback(user_data, bucket->len, (const query_instance_t *const *) bucket->pdata);
+        if (retval)
+            return retval;
+    }
     return 0;
 }
 
 int query_instance_list_iter(query_instance_list_t            *list,
                              query_instance_list_iter_callback callback,
                              void                             *user_data) {
-    if (!list->sorted) {
-        g_ptr_array_sort(list->list, __query_instance_list_compare);
-        list->sorted = 1;
+    __query_instance_list_sort(list);
+
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        for (size_t j = 0; j < list->buckets[i]->len; ++j) {
+            const int retval = callback(user_data, g_ptr_array_index(list->buckets[i], j));
+            if (retval)
+                return retval;
+        }
     }
+    return 0;
+}
+
+int query_instance_list_iter_duplicates(const query_instance_list_t                *list,
+                                        query_instance_list_iter_duplicates_callback callback,
+                                        void                                        *user_data) {
+    if (!list->duplicates)
+        return 0;
 
-    for (size_t i = 0; i < list->list->len; ++i) {
-        const int retval = callback(user_data, g_ptr_array_index(list->list, i));
+    for (size_t i = 0; i < list->duplicates->len; ++i) {
+        const query_instance_list_duplicate_t *const duplicate =
+            &g_array_index(list->duplicates, query_instance_list_duplicate_t, i);
+
+        const int retval = callback(user_data, duplicate->original, duplicate->line_in_file);
+        if (retval)
+            return retval;
+    }
+    return 0;
+}
+
+int query_instance_list_iter_keys(const query_instance_list_t           *list,
+                                  query_instance_list_iter_keys_callback callback,
+                                  void                                  *user_data) {
+    if (!list->keys)
+        return 0;
+
+    GHashTableIter iter;
+    gpointer       key_pointer;
+    g_hash_table_iter_init(&iter, list->keys);
+    while (g_hash_table_iter_next(&iter, &key_pointer, NULL)) {
+        const query_instance_list_key_t *const key = key_pointer;
+
+        const int retval = callback(user_data, key->instance, key->data, key->length);
         if (retval)
             return retval;
     }
@@ -157,10 +463,27 @@ int query_instance_list_iter(query_instance_list_t            *list,
 }
 
 size_t query_instance_list_get_length(const query_instance_list_t *list) {
-    return list->list->len;
+    return list->length;
+}
+
+size_t query_instance_list_get_duplicate_count(const query_instance_list_t *list) {
+    return list->duplicates ? list->duplicates->len : 0;
 }
 
 void query_instance_list_free(query_instance_list_t *list) {
-    g_ptr_array_unref(list->list);
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i)
+        g_ptr_array_unref(list->buckets[i]);
+    pool_free(list->instances);
+    if (list->keys)
+        g_hash_table_unref(list->keys);
+    if (list->duplicates)
+        g_array_unref(list->duplicates);
+
+    if (--list->arguments->references == 0) {
+        arena_free(list->arguments->arena);
+        if (list->arguments->adopted)
+            g_ptr_array_unref(list->arguments->adopted);
+        free(list->arguments);
+    }
     free(list);
 }
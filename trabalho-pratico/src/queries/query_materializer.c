@@ -0,0 +1,412 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  query_materializer.c
+ * @brief Implementation of methods in include/queries/query_materializer.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref query_materializer_examples).
+ */
+
+#include <errno.h>
+#include <glib.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "queries/query_materializer.h"
+#include "queries/query_type.h"
+#include "queries/query_type_list.h"
+#include "utils/memory_budget.h"
+
+/** @brief Number of counted entities after which request counts are halved. */
+#define QUERY_MATERIALIZER_MAX_COUNTED_ENTITIES (1 << 16)
+
+/**
+ * @struct query_materializer_requests_t
+ * @brief  Number of requests of an entity.
+ *
+ * @var query_materializer_requests_t::entity
+ *     @brief Number of the query type (upper 32 bits) and ::query_type_entity_key_t::entity (lower
+ *            32 bits). Must be the first field, as it's the key of
+ *            ::query_materializer::requests.
+ * @var query_materializer_requests_t::count
+ *     @brief Number of requests of the entity.
+ */
+typedef struct {
+    uint64_t entity;
+    size_t   count;
+} query_materializer_requests_t;
+
+/**
+ * @struct query_materializer_entry_t
+ * @brief  Rendered output of a query.
+ *
+ * @var query_materializer_entry_t::type
+ *     @brief Number of the type of the query.
+ * @var query_materializer_entry_t::key
+ *     @brief Key of the query's output (see ::query_type_entity_key_callback_t).
+ * @var query_materializer_entry_t::objects
+ *     @brief Number of objects in the output.
+ * @var query_materializer_entry_t::lengths
+ *     @brief Number of characters in each element of ::query_materializer_entry_t::outputs.
+ * @var query_materializer_entry_t::outputs
+ *     @brief Output not formatted (index `0`) and formatted (index `1`).
+ */
+typedef struct {
+    size_t                  type;
+    query_type_entity_key_t key;
+    size_t                  objects;
+    size_t                  lengths[2];
+    char                   *outputs[2];
+} query_materializer_entry_t;
+
+/**
+ * @struct query_materializer
+ * @brief  Already formatted outputs of queries about frequently requested entities.
+ *
+ * @var query_materializer::database
+ *     @brief Database queries are executed on.
+ * @var query_materializer::mutex
+ *     @brief Lock protecting all other fields.
+ * @var query_materializer::requests
+ *     @brief Set of ::query_materializer_requests_t, keyed by their entity.
+ * @var query_materializer::entries
+ *     @brief Set of ::query_materializer_entry_t, keyed by their type and output key.
+ * @var query_materializer::size
+ *     @brief Number of bytes used by ::query_materializer::entries.
+ * @var query_materializer::max_size
+ *     @brief Maximum value of ::query_materializer::size.
+ */
+struct query_materializer {
+    const database_t *database;
+    pthread_mutex_t   mutex;
+
+    GHashTable *requests;
+    GHashTable *entries;
+    size_t      size, max_size;
+};
+
+/**
+ * @brief   Hashes a ::query_materializer_entry_t by its type and output key.
+ * @details Auxiliary method for ::query_materializer_create.
+ */
+guint __query_materializer_entry_hash(gconstpointer entry_pointer) {
+    const query_materializer_entry_t *const entry = entry_pointer;
+    const uint64_t hash = ((uint64_t) entry->type << 32 | entry->key.entity) * 0x9e3779b97f4a7c15 ^
+                          entry->key.variant * 0xff51afd7ed558ccd;
+    return (guint) (hash ^ hash >> 32);
+}
+
+/**
+ * @brief   Checks if two ::query_materializer_entry_t have the same type and output key.
+ * @details Auxiliary method for ::query_materializer_create.
+ */
+gboolean __query_materializer_entry_equal(gconstpointer a_pointer, gconstpointer b_pointer) {
+    const query_materializer_entry_t *const a = a_pointer;
+    const query_materializer_entry_t *const b = b_pointer;
+    return a->type == b->type && a->key.entity == b->key.entity &&
+           a->key.variant == b->key.variant;
+}
+
+/**
+ * @brief   Frees a ::query_materializer_entry_t.
+ * @details Auxiliary method for ::query_materializer_create.
+ */
+void __query_materializer_entry_free(gpointer entry_pointer) {
+    query_materializer_entry_t *const entry = entry_pointer;
+    free(entry->outputs[0]);
+    free(entry->outputs[1]);
+    free(entry);
+}
+
+query_materializer_t *query_materializer_create(const database_t *database) {
+    size_t            max_size = QUERY_MATERIALIZER_DEFAULT_SIZE;
+    const char *const size_env = getenv(QUERY_MATERIALIZER_SIZE_ENVIRONMENT_VARIABLE);
+    if (size_env) {
+        char *end;
+        errno    = 0;
+        max_size = strtoull(size_env, &end, 10);
+        if (errno || *end || end == size_env || max_size > SIZE_MAX >> 20) {
+            fputs("Invalid size of materialized query outputs!\n", stderr);
+            return NULL;
+        }
+    }
+
+    if (!max_size)
+        return NULL;
+
+    query_materializer_t *const materializer = malloc(sizeof(query_materializer_t));
+    if (!materializer)
+        return NULL;
+
+    if (pthread_mutex_init(&materializer->mutex, NULL)) {
+        free(materializer);
+        return NULL;
+    }
+
+    materializer->database = database;
+    materializer->requests = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, free);
+    materializer->entries  = g_hash_table_new_full(__query_materializer_entry_hash,
+                                                  __query_materializer_entry_equal,
+                                                  __query_materializer_entry_free,
+                                                  NULL);
+    materializer->size     = 0;
+    materializer->max_size = max_size << 20;
+    return materializer;
+}
+
+/**
+ * @brief   Halves the request count of an entity.
+ * @details Auxiliary method for ::__query_materializer_count_request, called by
+ *          `g_hash_table_foreach_remove`.
+ *
+ * @return Whether the entity stopped being counted.
+ */
+gboolean __query_materializer_halve_requests(gpointer key, gpointer value, gpointer user_data) {
+    (void) key;
+    (void) user_data;
+
+    query_materializer_requests_t *const requests = value;
+    requests->count /= 2;
+    return requests->count == 0;
+}
+
+/**
+ * @brief   Counts a request of an entity.
+ * @details Auxiliary method for ::query_materializer_write. Must be called with the
+ *          materializer's lock held.
+ *
+ * @param materializer Materializer to count the request in.
+ * @param entity       Entity requested (see ::query_materializer_requests_t::entity).
+ *
+ * @return The number of requests of @p entity, or `0` on allocation failure.
+ */
+size_t __query_materializer_count_request(query_materializer_t *materializer, uint64_t entity) {
+    query_materializer_requests_t *requests = g_hash_table_lookup(materializer->requests, &entity);
+    if (!requests) {
+        if (g_hash_table_size(materializer->requests) >= QUERY_MATERIALIZER_MAX_COUNTED_ENTITIES)
+            g_hash_table_foreach_remove(materializer->requests,
+                                        __query_materializer_halve_requests,
+                                        NULL);
+
+        requests = malloc(sizeof(query_materializer_requests_t));
+        if (!requests)
+            return 0;
+
+        requests->entity = entity;
+        requests->count  = 0;
+        g_hash_table_add(materializer->requests, requests);
+    }
+
+    return ++requests->count;
+}
+
+/**
+ * @brief   Gets the number of requests of the entity of a rendered output.
+ * @details Auxiliary method for ::__query_materializer_make_room. Must be called with the
+ *          materializer's lock held.
+ */
+size_t __query_materializer_get_requests(const query_materializer_t       *materializer,
+                                         const query_materializer_entry_t *entry) {
+    const uint64_t entity = (uint64_t) entry->type << 32 | entry->key.entity;
+    const query_materializer_requests_t *const requests =
+        g_hash_table_lookup(materializer->requests, &entity);
+    return requests ? requests->count : 0;
+}
+
+/**
+ * @brief   Discards the rendered outputs of the least requested entities, until a new output fits.
+ * @details Auxiliary method for ::query_materializer_write. Must be called with the
+ *          materializer's lock held.
+ *
+ * @param materializer Materializer to discard outputs from.
+ * @param size         Size of the new output.
+ * @param requests     Number of requests of the entity of the new output. Only outputs of entities
+ *                     requested fewer times are discarded.
+ *
+ * @retval 0 The new output fits.
+ * @retval 1 The new output doesn't fit (some outputs may still have been discarded).
+ */
+int __query_materializer_make_room(query_materializer_t *materializer,
+                                   size_t                size,
+                                   size_t                requests) {
+    if (size > materializer->max_size)
+        return 1;
+
+    while (materializer->size + size > materializer->max_size) {
+        query_materializer_entry_t *coldest          = NULL;
+        size_t                      coldest_requests = requests;
+
+        GHashTableIter iter;
+        gpointer       entry_pointer;
+        g_hash_table_iter_init(&iter, materializer->entries);
+        while (g_hash_table_iter_next(&iter, &entry_pointer, NULL)) {
+            query_materializer_entry_t *const entry = entry_pointer;
+            const size_t entry_requests = __query_materializer_get_requests(materializer, entry);
+
+            if (entry_requests < coldest_requests) {
+                coldest          = entry;
+                coldest_requests = entry_requests;
+            }
+        }
+
+        if (!coldest)
+            return 1;
+
+        materializer->size -=
+            sizeof(query_materializer_entry_t) + coldest->lengths[0] + coldest->lengths[1];
+        g_hash_table_remove(materializer->entries, coldest);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief   Executes a query, keeping its output both formatted and not formatted.
+ * @details Auxiliary method for ::query_materializer_write.
+ *
+ * @param materializer Materializer whose database the query is executed on.
+ * @param instance     Query to be executed.
+ * @param entry        Entry whose ::query_materializer_entry_t::objects,
+ *                     ::query_materializer_entry_t::lengths and
+ *                     ::query_materializer_entry_t::outputs are to be set.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or cancelled query (see ::query_instance_is_cancelled). Nothing is
+ *           left allocated in @p entry.
+ */
+int __query_materializer_render(const query_materializer_t *materializer,
+                                const query_instance_t     *instance,
+                                query_materializer_entry_t *entry) {
+
+    entry->outputs[0] = NULL;
+    entry->outputs[1] = NULL;
+    for (int formatted = 0; formatted < 2; ++formatted) {
+        query_writer_t *const writer = query_writer_create_buffered(formatted);
+        if (!writer)
+            goto DEFER_1;
+
+        query_type_list_execute(materializer->database, NULL, instance, writer); /* Ignore result */
+        if (query_instance_is_cancelled(instance)) {
+            query_writer_free(writer);
+            goto DEFER_1;
+        }
+
+        size_t            length;
+        const char *const output = query_writer_get_output(writer, &length);
+        entry->objects           = query_writer_get_object_count(writer);
+        entry->lengths[formatted] = length;
+        entry->outputs[formatted] = malloc(length + 1);
+        if (entry->outputs[formatted])
+            memcpy(entry->outputs[formatted], output, length);
+
+        query_writer_free(writer);
+        if (!entry->outputs[formatted])
+            goto DEFER_1;
+    }
+
+    return 0;
+
+DEFER_1:
+    free(entry->outputs[0]);
+    free(entry->outputs[1]);
+    return 1;
+}
+
+int query_materializer_write(query_materializer_t   *materializer,
+                             const query_instance_t *instance,
+                             query_writer_t         *output) {
+
+    const query_type_t *const                    type = query_instance_get_type(instance);
+    const query_type_entity_key_callback_t entity_key = query_type_get_entity_key_callback(type);
+    if (!entity_key || query_writer_is_binary(output)) /* Rendered outputs are text */
+        return 1;
+
+    query_materializer_entry_t probe = {.type = query_type_get_type_number(type)};
+    if (entity_key(materializer->database, query_instance_get_argument_data(instance), &probe.key))
+        return 1;
+
+    const int      formatted = query_instance_get_formatted(instance);
+    const uint64_t entity    = (uint64_t) probe.type << 32 | probe.key.entity;
+
+    pthread_mutex_lock(&materializer->mutex);
+    const size_t requests = __query_materializer_count_request(materializer, entity);
+
+    const query_materializer_entry_t *const found =
+        g_hash_table_lookup(materializer->entries, &probe);
+    if (found) {
+        query_writer_write_rendered(output,
+                                    found->outputs[formatted],
+                                    found->lengths[formatted],
+                                    found->objects);
+        pthread_mutex_unlock(&materializer->mutex);
+        return 0;
+    }
+    pthread_mutex_unlock(&materializer->mutex);
+
+    if (requests < QUERY_MATERIALIZER_HOT_REQUESTS)
+        return 1;
+
+    /* Close to the memory budget, rendered outputs are dropped instead of adding another one */
+    if (memory_budget_should_degrade(MEMORY_BUDGET_DEGRADATION_CACHES)) {
+        pthread_mutex_lock(&materializer->mutex);
+        g_hash_table_remove_all(materializer->entries);
+        materializer->size = 0;
+        pthread_mutex_unlock(&materializer->mutex);
+        return 1;
+    }
+
+    /* The entity just became hot: render the query's output outside of the lock */
+    query_materializer_entry_t *const entry = malloc(sizeof(query_materializer_entry_t));
+    if (!entry)
+        return 1;
+
+    *entry = probe;
+    if (__query_materializer_render(materializer, instance, entry)) {
+        free(entry);
+        return 1;
+    }
+
+    query_writer_write_rendered(output,
+                                entry->outputs[formatted],
+                                entry->lengths[formatted],
+                                entry->objects);
+
+    /* Another thread may have rendered the same output in the meantime */
+    const size_t size = sizeof(query_materializer_entry_t) + entry->lengths[0] + entry->lengths[1];
+    pthread_mutex_lock(&materializer->mutex);
+    if (!g_hash_table_contains(materializer->entries, entry) &&
+        !__query_materializer_make_room(materializer, size, requests)) {
+
+        g_hash_table_add(materializer->entries, entry);
+        materializer->size += size;
+    } else {
+        __query_materializer_entry_free(entry);
+    }
+    pthread_mutex_unlock(&materializer->mutex);
+    return 0;
+}
+
+void query_materializer_free(query_materializer_t *materializer) {
+    g_hash_table_unref(materializer->requests);
+    g_hash_table_unref(materializer->entries);
+    pthread_mutex_destroy(&materializer->mutex);
+    free(materializer);
+}
@@ -0,0 +1,383 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  query_output_compressor.c
+ * @brief Implementation of methods in include/queries/query_output_compressor.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref query_output_compressor_examples).
+ */
+
+#include <glib.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef QUERY_OUTPUT_COMPRESSOR_ZSTD
+    #include <zstd.h>
+#endif
+
+#include "queries/query_output_compressor.h"
+#include "utils/path_utils.h"
+
+/** @brief First bytes of a zstd frame (its magic number, in little-endian order). */
+#define QUERY_OUTPUT_COMPRESSOR_MAGIC "\x28\xB5\x2F\xFD"
+
+/**
+ * @struct query_output_compressor
+ * @brief  Compressor of query outputs, with an optional dictionary.
+ *
+ * @var query_output_compressor::dictionary
+ *     @brief Contents of the dictionary file, or `NULL` for compression without a dictionary.
+ * @var query_output_compressor::dictionary_size
+ *     @brief Number of bytes in ::query_output_compressor::dictionary.
+ * @var query_output_compressor::cdict
+ *     @brief ::query_output_compressor::dictionary, digested for compression.
+ * @var query_output_compressor::ddict
+ *     @brief ::query_output_compressor::dictionary, digested for decompression.
+ * @var query_output_compressor::contexts
+ *     @brief Compression contexts not in use by any thread (`ZSTD_CCtx *`), as creating one for
+ *            every (usually small) output would take longer than compressing it.
+ * @var query_output_compressor::mutex
+ *     @brief Mutex that protects ::query_output_compressor::contexts.
+ * @var query_output_compressor::files
+ *     @brief Number of outputs compressed.
+ * @var query_output_compressor::raw_bytes
+ *     @brief Size of the outputs compressed, before compression.
+ * @var query_output_compressor::compressed_bytes
+ *     @brief Size of the outputs compressed, after compression.
+ * @var query_output_compressor::time
+ *     @brief Nanoseconds spent compressing, summed over all threads.
+ */
+struct query_output_compressor {
+    char  *dictionary;
+    size_t dictionary_size;
+
+#ifdef QUERY_OUTPUT_COMPRESSOR_ZSTD
+    ZSTD_CDict *cdict;
+    ZSTD_DDict *ddict;
+#endif
+
+    GPtrArray      *contexts;
+    pthread_mutex_t mutex;
+
+    size_t   files;
+    uint64_t raw_bytes, compressed_bytes, time;
+};
+
+/** @brief Compressor returned by ::query_output_compressor_get_shared. */
+query_output_compressor_t *query_output_compressor_shared = NULL;
+
+#ifdef QUERY_OUTPUT_COMPRESSOR_ZSTD
+
+query_output_compressor_t *query_output_compressor_create(const char *dictionary_path) {
+    query_output_compressor_t *const compressor = malloc(sizeof(query_output_compressor_t));
+    if (!compressor)
+        return NULL;
+
+    compressor->dictionary       = NULL;
+    compressor->dictionary_size  = 0;
+    compressor->cdict            = NULL;
+    compressor->ddict            = NULL;
+    compressor->files            = 0;
+    compressor->raw_bytes        = 0;
+    compressor->compressed_bytes = 0;
+    compressor->time             = 0;
+
+    if (pthread_mutex_init(&compressor->mutex, NULL))
+        goto DEFER_1;
+    compressor->contexts = g_ptr_array_new();
+
+    if (dictionary_path) {
+        gsize size;
+        if (!g_file_get_contents(dictionary_path, &compressor->dictionary, &size, NULL))
+            goto DEFER_2;
+        compressor->dictionary_size = size;
+
+        compressor->cdict = ZSTD_createCDict(compressor->dictionary,
+                                             compressor->dictionary_size,
+                                             QUERY_OUTPUT_COMPRESSOR_LEVEL);
+        compressor->ddict = ZSTD_createDDict(compressor->dictionary, compressor->dictionary_size);
+        if (!compressor->cdict || !compressor->ddict)
+            goto DEFER_2;
+    }
+
+    return compressor;
+
+DEFER_2:
+    query_output_compressor_free(compressor);
+    return NULL;
+DEFER_1:
+    free(compressor);
+    return NULL;
+}
+
+/**
+ * @brief   Takes a compression context out of ::query_output_compressor::contexts.
+ * @details A new one is created if there are none left.
+ *
+ * @param compressor Compressor of outputs.
+ *
+ * @return A compression context, to be returned with ::__query_output_compressor_put_context, or
+ *         `NULL` on allocation failure.
+ */
+ZSTD_CCtx *__query_output_compressor_take_context(query_output_compressor_t *compressor) {
+    ZSTD_CCtx *context = NULL;
+    pthread_mutex_lock(&compressor->mutex);
+    if (compressor->contexts->len)
+        context = g_ptr_array_steal_index_fast(compressor->contexts, compressor->contexts->len - 1);
+    pthread_mutex_unlock(&compressor->mutex);
+
+    if (!context) {
+        context = ZSTD_createCCtx();
+        if (context)
+            ZSTD_CCtx_setParameter(context,
+                                   ZSTD_c_compressionLevel,
+                                   QUERY_OUTPUT_COMPRESSOR_LEVEL);
+    }
+    return context;
+}
+
+/**
+ * @brief Returns a compression context to ::query_output_compressor::contexts.
+ *
+ * @param compressor Compressor of outputs.
+ * @param context    Context obtained with ::__query_output_compressor_take_context.
+ */
+void __query_output_compressor_put_context(query_output_compressor_t *compressor,
+                                           ZSTD_CCtx                 *context) {
+    pthread_mutex_lock(&compressor->mutex);
+    g_ptr_array_add(compressor->contexts, context);
+    pthread_mutex_unlock(&compressor->mutex);
+}
+
+int query_output_compressor_compress(query_output_compressor_t *compressor,
+                                     const char                *data,
+                                     size_t                     length,
+                                     char                     **output,
+                                     size_t                    *out_length) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    ZSTD_CCtx *const context = __query_output_compressor_take_context(compressor);
+    if (!context)
+        return 1;
+
+    const size_t bound      = ZSTD_compressBound(length);
+    char *const  compressed = malloc(bound);
+    if (!compressed)
+        goto DEFER_1;
+
+    /* The dictionary is only referenced, so this is cheap */
+    size_t result = ZSTD_CCtx_refCDict(context, compressor->cdict);
+    if (!ZSTD_isError(result))
+        result = ZSTD_compress2(context, compressed, bound, data, length);
+    if (ZSTD_isError(result)) {
+        free(compressed);
+        goto DEFER_1;
+    }
+
+    __query_output_compressor_put_context(compressor, context);
+    *output     = compressed;
+    *out_length = result;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const uint64_t time = (uint64_t) (end.tv_sec - start.tv_sec) * 1000000000 +
+                          (uint64_t) end.tv_nsec - (uint64_t) start.tv_nsec;
+
+    __atomic_fetch_add(&compressor->files, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&compressor->raw_bytes, length, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&compressor->compressed_bytes, result, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&compressor->time, time, __ATOMIC_RELAXED);
+    return 0;
+
+DEFER_1:
+    __query_output_compressor_put_context(compressor, context);
+    return 1;
+}
+
+int query_output_compressor_decompress(const query_output_compressor_t *compressor,
+                                       const char                      *data,
+                                       size_t                           length,
+                                       char                           **output,
+                                       size_t                          *out_length) {
+    ZSTD_DCtx *const context = ZSTD_createDCtx();
+    if (!context)
+        return 1;
+    if (compressor && compressor->ddict &&
+        ZSTD_isError(ZSTD_DCtx_refDDict(context, compressor->ddict)))
+        goto DEFER_1;
+
+    /* Outputs are compressed in a single call, so their size is in the frame's header */
+    const unsigned long long content_size = ZSTD_getFrameContentSize(data, length);
+    size_t                   capacity     = ZSTD_DStreamOutSize();
+    if (content_size != ZSTD_CONTENTSIZE_UNKNOWN && content_size != ZSTD_CONTENTSIZE_ERROR &&
+        content_size < SIZE_MAX)
+        capacity = (size_t) content_size + 1; /* + 1, not to allocate 0 bytes */
+
+    char *decompressed = malloc(capacity);
+    if (!decompressed)
+        goto DEFER_1;
+
+    ZSTD_inBuffer  in  = {.src = data, .size = length, .pos = 0};
+    ZSTD_outBuffer out = {.dst = decompressed, .size = capacity, .pos = 0};
+    while (in.pos < in.size) {
+        if (out.pos == out.size) {
+            char *const new_decompressed = realloc(decompressed, out.size * 2);
+            if (!new_decompressed)
+                goto DEFER_2;
+
+            decompressed = new_decompressed;
+            out.dst      = decompressed;
+            out.size    *= 2;
+        }
+
+        if (ZSTD_isError(ZSTD_decompressStream(context, &out, &in)))
+            goto DEFER_2;
+    }
+
+    ZSTD_freeDCtx(context);
+    *output     = decompressed;
+    *out_length = out.pos;
+    return 0;
+
+DEFER_2:
+    free(decompressed);
+DEFER_1:
+    ZSTD_freeDCtx(context);
+    return 1;
+}
+
+#else
+
+query_output_compressor_t *query_output_compressor_create(const char *dictionary_path) {
+    (void) dictionary_path;
+    return NULL; /* Built without libzstd */
+}
+
+int query_output_compressor_compress(query_output_compressor_t *compressor,
+                                     const char                *data,
+                                     size_t                     length,
+                                     char                     **output,
+                                     size_t                    *out_length) {
+    (void) compressor;
+    (void) data;
+    (void) length;
+    (void) output;
+    (void) out_length;
+    return 1;
+}
+
+int query_output_compressor_decompress(const query_output_compressor_t *compressor,
+                                       const char                      *data,
+                                       size_t                           length,
+                                       char                           **output,
+                                       size_t                          *out_length) {
+    (void) compressor;
+    (void) data;
+    (void) length;
+    (void) output;
+    (void) out_length;
+    return 1;
+}
+
+#endif
+
+int query_output_compressor_is_compressed(const char *data, size_t length) {
+    const size_t magic_length = sizeof(QUERY_OUTPUT_COMPRESSOR_MAGIC) - 1;
+    return length >= magic_length && memcmp(data, QUERY_OUTPUT_COMPRESSOR_MAGIC, magic_length) == 0;
+}
+
+int query_output_compressor_save_dictionary(const query_output_compressor_t *compressor,
+                                            const char                      *directory) {
+    if (!compressor->dictionary)
+        return 0;
+
+    char path[PATH_MAX];
+    snprintf(path, PATH_MAX, "%s", directory);
+    path_concat(path, QUERY_OUTPUT_COMPRESSOR_DICTIONARY_NAME);
+
+    return !g_file_set_contents(path,
+                                compressor->dictionary,
+                                (gssize) compressor->dictionary_size,
+                                NULL);
+}
+
+void query_output_compressor_get_statistics(const query_output_compressor_t *compressor,
+                                            size_t                          *files,
+                                            uint64_t                        *raw_bytes,
+                                            uint64_t                        *compressed_bytes,
+                                            uint64_t                        *time) {
+    if (files)
+        *files = __atomic_load_n(&compressor->files, __ATOMIC_RELAXED);
+    if (raw_bytes)
+        *raw_bytes = __atomic_load_n(&compressor->raw_bytes, __ATOMIC_RELAXED);
+    if (compressed_bytes)
+        *compressed_bytes = __atomic_load_n(&compressor->compressed_bytes, __ATOMIC_RELAXED);
+    if (time)
+        *time = __atomic_load_n(&compressor->time, __ATOMIC_RELAXED);
+}
+
+void query_output_compressor_print_statistics(FILE                            *output,
+                                              const query_output_compressor_t *compressor) {
+    size_t   files;
+    uint64_t raw_bytes, compressed_bytes, time;
+    query_output_compressor_get_statistics(compressor,
+                                           &files,
+                                           &raw_bytes,
+                                           &compressed_bytes,
+                                           &time);
+
+    fprintf(output,
+            "Compressed %zu outputs: %" PRIu64 " bytes to %" PRIu64 " bytes (%.2fx, %.1f%% saved) "
+            "in %.3f ms\n",
+            files,
+            raw_bytes,
+            compressed_bytes,
+            compressed_bytes ? (double) raw_bytes / (double) compressed_bytes : 0.0,
+            raw_bytes ? 100.0 * (1.0 - (double) compressed_bytes / (double) raw_bytes) : 0.0,
+            (double) time / 1e6);
+}
+
+void query_output_compressor_set_shared(query_output_compressor_t *compressor) {
+    query_output_compressor_shared = compressor;
+}
+
+query_output_compressor_t *query_output_compressor_get_shared(void) {
+    return query_output_compressor_shared;
+}
+
+void query_output_compressor_free(query_output_compressor_t *compressor) {
+    if (!compressor)
+        return;
+
+#ifdef QUERY_OUTPUT_COMPRESSOR_ZSTD
+    for (size_t i = 0; i < compressor->contexts->len; ++i)
+        ZSTD_freeCCtx(g_ptr_array_index(compressor->contexts, i));
+    ZSTD_freeCDict(compressor->cdict);
+    ZSTD_freeDDict(compressor->ddict);
+#endif
+
+    g_ptr_array_unref(compressor->contexts);
+    pthread_mutex_destroy(&compressor->mutex);
+    g_free(compressor->dictionary);
+    free(compressor);
+}
@@ -0,0 +1,401 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  query_output_pack.c
+ * @brief Implementation of methods in include/queries/query_output_pack.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref query_output_pack_examples).
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "queries/query_output_pack.h"
+
+/**
+ * @struct query_output_pack_entry_t
+ * @brief  Entry in the table of a pack, with information about the output of a query.
+ *
+ * @var query_output_pack_entry_t::line
+ *     @brief Line of the query in the query file.
+ * @var query_output_pack_entry_t::offset
+ *     @brief Where the output of the query starts, in bytes from the beginning of the pack.
+ * @var query_output_pack_entry_t::length
+ *     @brief Number of bytes in the output of the query.
+ */
+typedef struct {
+    uint64_t line, offset, length;
+} query_output_pack_entry_t;
+
+/**
+ * @struct query_output_pack_trailer_t
+ * @brief  Last bytes of a pack file, that tell where its table of entries is.
+ *
+ * @var query_output_pack_trailer_t::count
+ *     @brief Number of entries in the table.
+ * @var query_output_pack_trailer_t::table_offset
+ *     @brief Where the table starts, in bytes from the beginning of the pack. Aligned to 8 bytes.
+ * @var query_output_pack_trailer_t::magic
+ *     @brief Always ::QUERY_OUTPUT_PACK_MAGIC, to identify pack files.
+ */
+typedef struct {
+    uint64_t count, table_offset;
+    char     magic[8];
+} query_output_pack_trailer_t;
+
+/**
+ * @struct query_output_pack_writer
+ * @brief  A pack file being written.
+ *
+ * @var query_output_pack_writer::file
+ *     @brief Stream of the pack file.
+ * @var query_output_pack_writer::offset
+ *     @brief Number of bytes written to ::query_output_pack_writer::file so far.
+ * @var query_output_pack_writer::entries
+ *     @brief Entries of the table of the pack, in the order they were added.
+ * @var query_output_pack_writer::length
+ *     @brief Number of entries in ::query_output_pack_writer::entries.
+ * @var query_output_pack_writer::capacity
+ *     @brief Number of entries allocated for ::query_output_pack_writer::entries.
+ * @var query_output_pack_writer::lines
+ *     @brief Maps the line number of each query to its index in ::query_output_pack_writer::entries
+ *            (plus one), for ::query_output_pack_writer_add_duplicate.
+ * @var query_output_pack_writer::failed
+ *     @brief Whether any write or allocation has failed, in which case the pack is invalid.
+ */
+struct query_output_pack_writer {
+    FILE                      *file;
+    uint64_t                   offset;
+    query_output_pack_entry_t *entries;
+    size_t                     length, capacity;
+    GHashTable                *lines;
+    int                        failed;
+};
+
+/**
+ * @struct query_output_pack_reader
+ * @brief  A pack file opened for reading.
+ *
+ * @var query_output_pack_reader::map
+ *     @brief Contents of the pack file.
+ * @var query_output_pack_reader::size
+ *     @brief Number of bytes in ::query_output_pack_reader::map.
+ * @var query_output_pack_reader::entries
+ *     @brief Table of entries of the pack, inside ::query_output_pack_reader::map.
+ * @var query_output_pack_reader::count
+ *     @brief Number of entries in ::query_output_pack_reader::entries.
+ */
+struct query_output_pack_reader {
+    void                            *map;
+    size_t                           size;
+    const query_output_pack_entry_t *entries;
+    size_t                           count;
+};
+
+/** @brief Initial number of entries allocated for ::query_output_pack_writer::entries. */
+#define QUERY_OUTPUT_PACK_WRITER_INITIAL_CAPACITY 1024
+
+/** @brief Size of the buffer of ::query_output_pack_writer::file. */
+#define QUERY_OUTPUT_PACK_WRITER_BUFFER_SIZE (1 << 20)
+
+query_output_pack_writer_t *query_output_pack_writer_create(const char *path) {
+    query_output_pack_writer_t *const writer = malloc(sizeof(query_output_pack_writer_t));
+    if (!writer)
+        return NULL;
+
+    writer->entries = malloc(sizeof(query_output_pack_entry_t) *
+                             QUERY_OUTPUT_PACK_WRITER_INITIAL_CAPACITY);
+    if (!writer->entries)
+        goto DEFER_1;
+
+    writer->file = fopen(path, "w");
+    if (!writer->file)
+        goto DEFER_2;
+
+    /* Outputs are usually small. Write them in large blocks */
+    setvbuf(writer->file, NULL, _IOFBF, QUERY_OUTPUT_PACK_WRITER_BUFFER_SIZE);
+
+    char magic[8] = QUERY_OUTPUT_PACK_MAGIC;
+    if (fwrite(magic, sizeof(magic), 1, writer->file) != 1)
+        goto DEFER_3;
+
+    writer->offset   = sizeof(magic);
+    writer->length   = 0;
+    writer->capacity = QUERY_OUTPUT_PACK_WRITER_INITIAL_CAPACITY;
+    writer->lines    = g_hash_table_new(g_direct_hash, g_direct_equal);
+    writer->failed   = 0;
+    return writer;
+
+DEFER_3:
+    fclose(writer->file);
+DEFER_2:
+    free(writer->entries);
+DEFER_1:
+    free(writer);
+    return NULL;
+}
+
+/**
+ * @brief Adds an entry to the table of a pack.
+ *
+ * @param writer Pack to add the entry to.
+ * @param line   Line of the query in the query file.
+ * @param offset Where the output of the query starts.
+ * @param length Number of bytes in the output of the query.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __query_output_pack_writer_add_entry(query_output_pack_writer_t *writer,
+                                         size_t                      line,
+                                         uint64_t                    offset,
+                                         uint64_t                    length) {
+    if (writer->length == writer->capacity) {
+        query_output_pack_entry_t *const new_entries =
+            realloc(writer->entries, sizeof(query_output_pack_entry_t) * writer->capacity * 2);
+        if (!new_entries)
+            return 1;
+
+        writer->entries = new_entries;
+        writer->capacity *= 2;
+    }
+
+    writer->entries[writer->length++] =
+        (query_output_pack_entry_t) {.line = line, .offset = offset, .length = length};
+    g_hash_table_insert(writer->lines, GSIZE_TO_POINTER(line), GSIZE_TO_POINTER(writer->length));
+    return 0;
+}
+
+int query_output_pack_writer_add(query_output_pack_writer_t *writer,
+                                 size_t                      line,
+                                 const char                 *output,
+                                 size_t                      length) {
+    if (__query_output_pack_writer_add_entry(writer, line, writer->offset, length) ||
+        fwrite(output, 1, length, writer->file) != length) {
+
+        writer->failed = 1;
+        return 1;
+    }
+
+    writer->offset += length;
+    return 0;
+}
+
+int query_output_pack_writer_add_duplicate(query_output_pack_writer_t *writer,
+                                           size_t                      original_line,
+                                           size_t                      line) {
+    const size_t index =
+        GPOINTER_TO_SIZE(g_hash_table_lookup(writer->lines, GSIZE_TO_POINTER(original_line)));
+    if (!index) {
+        writer->failed = 1;
+        return 1;
+    }
+
+    const query_output_pack_entry_t original = writer->entries[index - 1];
+    if (__query_output_pack_writer_add_entry(writer, line, original.offset, original.length)) {
+        writer->failed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+/** @brief Comparison function for sorting ::query_output_pack_entry_t by line number. */
+int __query_output_pack_entry_compare(const void *a, const void *b) {
+    const uint64_t line_a = ((const query_output_pack_entry_t *) a)->line;
+    const uint64_t line_b = ((const query_output_pack_entry_t *) b)->line;
+    return (line_a > line_b) - (line_a < line_b);
+}
+
+int query_output_pack_writer_finish(query_output_pack_writer_t *writer) {
+    int retval = writer->failed;
+
+    /* Align the table, so that it can be read in place */
+    const char     padding[8]   = {0};
+    const uint64_t table_offset = (writer->offset + 7) & ~(uint64_t) 7;
+    if (fwrite(padding, 1, table_offset - writer->offset, writer->file) !=
+        table_offset - writer->offset)
+        retval = 1;
+
+    qsort(writer->entries,
+          writer->length,
+          sizeof(query_output_pack_entry_t),
+          __query_output_pack_entry_compare);
+    if (fwrite(writer->entries, sizeof(query_output_pack_entry_t), writer->length, writer->file) !=
+        writer->length)
+        retval = 1;
+
+    query_output_pack_trailer_t trailer = {.count        = writer->length,
+                                           .table_offset = table_offset,
+                                           .magic        = QUERY_OUTPUT_PACK_MAGIC};
+    if (fwrite(&trailer, sizeof(query_output_pack_trailer_t), 1, writer->file) != 1)
+        retval = 1;
+
+    if (fclose(writer->file))
+        retval = 1;
+    g_hash_table_unref(writer->lines);
+    free(writer->entries);
+    free(writer);
+    return retval;
+}
+
+/**
+ * @brief  Checks if the contents of a memory-mapped file are a valid pack.
+ * @param  reader Reader whose ::query_output_pack_reader::map and
+ *                ::query_output_pack_reader::size are set.
+ * @retval 0 Valid pack. ::query_output_pack_reader::entries and ::query_output_pack_reader::count
+ *           are set.
+ * @retval 1 Invalid pack.
+ */
+int __query_output_pack_reader_validate(query_output_pack_reader_t *reader) {
+    const char *const map = reader->map;
+    if (reader->size < 8 + sizeof(query_output_pack_trailer_t) ||
+        memcmp(map, QUERY_OUTPUT_PACK_MAGIC, sizeof(QUERY_OUTPUT_PACK_MAGIC)))
+        return 1;
+
+    query_output_pack_trailer_t trailer;
+    memcpy(&trailer,
+           map + reader->size - sizeof(query_output_pack_trailer_t),
+           sizeof(query_output_pack_trailer_t));
+
+    const size_t table_size = reader->size - sizeof(query_output_pack_trailer_t);
+    if (memcmp(trailer.magic, QUERY_OUTPUT_PACK_MAGIC, sizeof(QUERY_OUTPUT_PACK_MAGIC)) ||
+        trailer.table_offset < 8 || trailer.table_offset % 8 || trailer.table_offset > table_size ||
+        (table_size - trailer.table_offset) / sizeof(query_output_pack_entry_t) != trailer.count ||
+        (table_size - trailer.table_offset) % sizeof(query_output_pack_entry_t))
+        return 1;
+
+    reader->entries = (const query_output_pack_entry_t *) (map + trailer.table_offset);
+    reader->count   = trailer.count;
+
+    /* Outputs must not overlap the table, so that they can be read without further checks */
+    for (size_t i = 0; i < reader->count; ++i)
+        if (reader->entries[i].offset > trailer.table_offset ||
+            reader->entries[i].length > trailer.table_offset - reader->entries[i].offset)
+            return 1;
+
+    return 0;
+}
+
+query_output_pack_reader_t *query_output_pack_reader_open(const char *path) {
+    query_output_pack_reader_t *const reader = malloc(sizeof(query_output_pack_reader_t));
+    if (!reader)
+        return NULL;
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        goto DEFER_1;
+
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) || !S_ISREG(statbuf.st_mode) || statbuf.st_size == 0)
+        goto DEFER_2;
+
+    reader->size = (size_t) statbuf.st_size;
+    reader->map  = mmap(NULL, reader->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (reader->map == MAP_FAILED)
+        goto DEFER_2;
+
+    if (__query_output_pack_reader_validate(reader))
+        goto DEFER_3;
+
+    close(fd);
+    return reader;
+
+DEFER_3:
+    munmap(reader->map, reader->size);
+DEFER_2:
+    close(fd);
+DEFER_1:
+    free(reader);
+    return NULL;
+}
+
+size_t query_output_pack_reader_get_count(const query_output_pack_reader_t *reader) {
+    return reader->count;
+}
+
+const char *query_output_pack_reader_get(const query_output_pack_reader_t *reader,
+                                         size_t                            i,
+                                         size_t                           *line,
+                                         size_t                           *length) {
+    const query_output_pack_entry_t *const entry = &reader->entries[i];
+    if (line)
+        *line = entry->line;
+    *length = entry->length;
+    return (const char *) reader->map + entry->offset;
+}
+
+/**
+ * @brief Writes a whole buffer to a file descriptor, retrying on partial writes.
+ *
+ * @param fd     File descriptor to write to.
+ * @param buffer Bytes to be written.
+ * @param length Number of bytes in @p buffer.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO failure.
+ */
+int __query_output_pack_write_all(int fd, const char *buffer, size_t length) {
+    size_t written = 0;
+    while (written < length) {
+        const ssize_t retval = write(fd, buffer + written, length - written);
+        if (retval < 0) {
+            if (errno == EINTR)
+                continue;
+            return 1;
+        }
+        written += (size_t) retval;
+    }
+    return 0;
+}
+
+int query_output_pack_reader_extract(const query_output_pack_reader_t *reader,
+                                     const char                       *directory) {
+    for (size_t i = 0; i < reader->count; ++i) {
+        size_t            line, length;
+        const char *const output = query_output_pack_reader_get(reader, i, &line, &length);
+
+        /* Names are short, but paths in long directories may not fit */
+        char name[64], path[PATH_MAX];
+        snprintf(name, sizeof(name), QUERY_OUTPUT_PACK_ENTRY_NAME_FORMAT, line);
+        if (snprintf(path, PATH_MAX, "%s/%s", directory, name) >= PATH_MAX)
+            return 1;
+
+        const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0)
+            return 1;
+
+        const int failed = __query_output_pack_write_all(fd, output, length);
+        if (close(fd) || failed)
+            return 1;
+    }
+    return 0;
+}
+
+void query_output_pack_reader_close(query_output_pack_reader_t *reader) {
+    munmap(reader->map, reader->size);
+    free(reader);
+}
@@ -22,7 +22,8 @@
  * See [the header file's documentation](@ref query_parser_examples).
  */
 
-#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "queries/query_parser.h"
 #include "queries/query_tokenizer.h"
@@ -35,132 +36,155 @@
  *
  * @var query_parser_data_t::output
  *     @brief Query being currently parsed.
- * @var query_parser_data_t::args
- *     @brief Array to store pointers to query arguments (`char *`) to.
+ * @var query_parser_data_t::input
+ *     @brief String being parsed.
+ * @var query_parser_data_t::argc
+ *     @brief Number of arguments found so far.
+ * @var query_parser_data_t::argv
+ *     @brief Start of every argument, in ::query_parser_data_t::input.
+ * @var query_parser_data_t::lengths
+ *     @brief Length of every argument in ::query_parser_data_t::argv.
+ * @var query_parser_data_t::explain
+ *     @brief Whether the query was preceded by ::QUERY_PARSER_EXPLAIN_PREFIX.
  * @var query_parser_data_t::first_token_parsed
  *     @brief Whether the first token (containg the query type) has already been parsed.
- * @var query_parser_data_t::last_terminator
- *     @brief Where a null terminator (``'\0'``) should be placed, so that the previous token ends;
- *            `NULL` if no token has yet been parsed.
  */
 typedef struct {
     query_instance_t *const output;
-    GPtrArray              *args;
-    int                     first_token_parsed;
-    char                   *last_terminator;
+    char *const             input;
+
+    size_t argc;
+    char  *argv[QUERY_PARSER_MAX_ARGUMENTS];
+    size_t lengths[QUERY_PARSER_MAX_ARGUMENTS];
+
+    int explain;
+    int first_token_parsed;
 } query_parser_data_t;
 
 /**
  * @brief   Callback for every token in the query.
- * @details Parses the first token and adds the remaining ones to an array.
+ * @details Parses the first token (after ::QUERY_PARSER_EXPLAIN_PREFIX, if present) and stores
+ *          the position of the remaining ones.
  *
  * @param user_data A pointer to a ::query_parser_data_t.
  * @param token     Current query token being parsed.
+ * @param length    Length of @p token.
  *
  * @retval 0 Parsing success.
  * @retval 1 Parsing failure.
  */
-int __query_parser_tokenize_callback(void *user_data, char *token) {
+int __query_parser_tokenize_callback(void *user_data, const char *token, size_t length) {
     query_parser_data_t *const parser = user_data;
 
-    if (!parser->first_token_parsed) { /* First argument: query number */
-
-        /* Check if query is formatted */
-        const size_t token_len = strlen(token);
-        if (token_len == 0)
+    if (!parser->first_token_parsed && !parser->explain &&
+        length == strlen(QUERY_PARSER_EXPLAIN_PREFIX) &&
+        memcmp(token, QUERY_PARSER_EXPLAIN_PREFIX, length) == 0) {
+        parser->explain = 1;
+    } else if (!parser->first_token_parsed) { /* First argument: query number */
+        const query_type_t *type;
+        int                 formatted;
+        if (query_parser_parse_type(token, length, &type, &formatted))
             return 1;
 
-        if (token[token_len - 1] == 'F') {
-            query_instance_set_formatted(parser->output, 1);
-            token[token_len - 1] = '\0';
-        } else {
-            query_instance_set_formatted(parser->output, 0);
-        }
-
-        /* Parse number of query */
-        uint64_t                  query_type;
-        const int                 retval = int_utils_parse_positive(&query_type, token);
-        const query_type_t *const type =
-            retval ? NULL : query_type_list_get_by_index((size_t) query_type);
-        if (retval || !type) {
-            if (token[token_len - 1] == '\0') /* Restore previous string form */
-                token[token_len - 1] = 'F';
-            return 1;
-        }
         query_instance_set_type(parser->output, type);
-
-        if (token[token_len - 1] == '\0') /* Restore previous string form */
-            token[token_len - 1] = 'F';
+        query_instance_set_formatted(parser->output, formatted);
         parser->first_token_parsed = 1;
     } else {
-        if (parser->last_terminator)
-            *parser->last_terminator = '\0';
-        parser->last_terminator = token + strlen(token);
-        g_ptr_array_add(parser->args, token);
+        if (parser->argc == QUERY_PARSER_MAX_ARGUMENTS)
+            return 1;
+
+        parser->argv[parser->argc]    = parser->input + (token - parser->input);
+        parser->lengths[parser->argc] = length;
+        parser->argc++;
     }
     return 0;
 }
 
-int query_parser_parse_string(query_instance_t *output, char *input, GPtrArray *aux) {
+int query_parser_parse_type(const char          *token,
+                            size_t               length,
+                            const query_type_t **type,
+                            int                 *formatted) {
+    /* Check if query is formatted */
+    if (length == 0)
+        return 1;
+    *formatted = token[length - 1] == 'F';
+
+    /* Parse number of query */
+    const size_t digits = length - *formatted;
+    uint64_t     query_type;
+    if (!digits || int_utils_parse_digits(&query_type, token, digits))
+        return 1;
+
+    *type = query_type_list_get_by_index((size_t) query_type);
+    return *type == NULL;
+}
+
+int query_parser_parse_string(query_instance_t *output, char *input, arena_t *allocator) {
     query_parser_data_t parser_data = {.output             = output,
-                                       .first_token_parsed = 0,
-                                       .last_terminator    = NULL};
-    if (aux) {
-        g_ptr_array_set_size(aux, 0);
-        parser_data.args = aux;
-    } else {
-        parser_data.args = g_ptr_array_new();
-    }
+                                       .input              = input,
+                                       .argc               = 0,
+                                       .explain            = 0,
+                                       .first_token_parsed = 0};
 
     /* Query type parsing */
     const int retval =
-        query_tokenizer_tokenize(input, __query_parser_tokenize_callback, &parser_data);
-    if (retval || !parser_data.first_token_parsed) {
-        if (!aux)
-            g_ptr_array_free(parser_data.args, TRUE);
+        query_tokenizer_tokenize_slices(input, __query_parser_tokenize_callback, &parser_data);
+    if (retval || !parser_data.first_token_parsed)
         return 1;
-    }
 
-    if (parser_data.last_terminator)
-        *parser_data.last_terminator = '\0';
-
-    /* Argument parsing */
-    const query_type_t *const                   query_type = query_instance_get_type(output);
-    const query_type_parse_arguments_callback_t parse_cb =
-        query_type_get_parse_arguments_callback(query_type);
-    void *const argument_data =
-        parse_cb(parser_data.args->len, (char *const *) parser_data.args->pdata);
+    const int parse_retval = query_parser_parse_arguments(output,
+                                                          query_instance_get_type(output),
+                                                          query_instance_get_formatted(output),
+                                                          parser_data.argc,
+                                                          parser_data.argv,
+                                                          parser_data.lengths,
+                                                          allocator);
+    query_instance_set_explain(output, parser_data.explain);
+    return parse_retval;
+}
 
-    if (argument_data) {
-        query_instance_set_argument_data(output, argument_data);
+int query_parser_parse_arguments(query_instance_t   *output,
+                                 const query_type_t *type,
+                                 int                 formatted,
+                                 size_t              argc,
+                                 char *const         argv[argc],
+                                 const size_t        lengths[argc],
+                                 arena_t            *allocator) {
+    query_instance_set_type(output, type);
+    query_instance_set_formatted(output, formatted);
+    query_instance_set_explain(output, 0);
+
+    if (argc > QUERY_PARSER_MAX_ARGUMENTS)
+        return 1;
 
-        const query_type_free_arguments_callback_t free_cb =
-            query_type_get_free_arguments_callback(query_type);
-        free_cb(argument_data);
+    /* Terminate arguments (followed by a space, a quote, or the end of the string, when parsing) */
+    char terminators[QUERY_PARSER_MAX_ARGUMENTS];
+    for (size_t i = 0; i < argc; ++i) {
+        terminators[i]      = argv[i][lengths[i]];
+        argv[i][lengths[i]] = '\0';
     }
 
+    /* Argument parsing */
+    const query_type_parse_arguments_callback_t parse_cb =
+        query_type_get_parse_arguments_callback(type);
+    void *const argument_data = parse_cb(argc, argv, allocator);
+    query_instance_set_argument_data(output, argument_data);
+
     /* Restore string */
-    for (ssize_t i = 0; i < parser_data.args->len; ++i) {
-        char *const str = g_ptr_array_index(parser_data.args, i);
-        char *const end = str + strlen(str);
-
-        if (*(str - 1) == '"')
-            *end = '"';
-        else if (i != parser_data.args->len - 1)
-            *end = ' ';
-    }
+    for (size_t i = 0; i < argc; ++i)
+        argv[i][lengths[i]] = terminators[i];
 
-    if (!aux)
-        g_ptr_array_unref(parser_data.args);
     return (argument_data == NULL);
 }
 
-int query_parser_parse_string_const(query_instance_t *output, const char *input, GPtrArray *aux) {
+int query_parser_parse_string_const(query_instance_t *output,
+                                    const char       *input,
+                                    arena_t          *allocator) {
     char *const buffer = strdup(input);
     if (!buffer)
         return QUERY_PARSER_PARSE_CONST_RET_FAILED_MALLOC;
 
-    const int retval = query_parser_parse_string(output, buffer, aux);
+    const int retval = query_parser_parse_string(output, buffer, allocator);
     free(buffer);
     return retval != 0;
 }
@@ -0,0 +1,510 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  query_result_cache.c
+ * @brief Implementation of methods in include/queries/query_result_cache.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref query_result_cache_examples).
+ */
+
+#include <errno.h>
+#include <glib.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dataset/dataset_snapshot.h"
+#include "queries/query_result_cache.h"
+#include "queries/query_type.h"
+#include "utils/stream_utils.h"
+
+/** @cond FALSE */
+#define __QUERY_RESULT_CACHE_STRINGIFY(x) #x
+#define __QUERY_RESULT_CACHE_EXPAND(x)    __QUERY_RESULT_CACHE_STRINGIFY(x)
+/** @endcond */
+
+#ifdef GIT_REVISION
+    /** @brief Output of `git describe` when the program was built, defined by the Makefile. */
+    #define QUERY_RESULT_CACHE_REVISION __QUERY_RESULT_CACHE_EXPAND(GIT_REVISION)
+#else
+    /** @brief Output of `git describe` when the program was built, defined by the Makefile. */
+    #define QUERY_RESULT_CACHE_REVISION "unknown"
+#endif
+
+/** @brief First bytes of the index file of a cache (`LI3RCACH`, as a little-endian integer). */
+#define QUERY_RESULT_CACHE_INDEX_MAGIC 0x4843414352334c49
+
+/** @brief Maximum number of bytes in the part of cache keys identifying the dataset and program. */
+#define QUERY_RESULT_CACHE_MAX_PREFIX 128
+
+/**
+ * @struct query_result_cache_entry_t
+ * @brief  An output in a cache.
+ *
+ * @var query_result_cache_entry_t::hash
+ *     @brief Hash of ::query_result_cache_entry_t::key, that names the file with the output.
+ * @var query_result_cache_entry_t::last_used
+ *     @brief Value of ::query_result_cache::clock when the output was last stored or fetched.
+ * @var query_result_cache_entry_t::size
+ *     @brief Number of bytes in the output.
+ * @var query_result_cache_entry_t::key_length
+ *     @brief Number of bytes in ::query_result_cache_entry_t::key.
+ * @var query_result_cache_entry_t::key
+ *     @brief Identification of the dataset and of the program, followed by the canonical form of
+ *            the query (not null-terminated).
+ */
+typedef struct {
+    uint64_t hash, last_used, size, key_length;
+    char     key[];
+} query_result_cache_entry_t;
+
+/**
+ * @struct query_result_cache
+ * @brief  Outputs of queries run before on the same dataset, kept on disk between runs.
+ *
+ * @var query_result_cache::directory
+ *     @brief Path to the directory with the cache's files.
+ * @var query_result_cache::entries
+ *     @brief Set of all ::query_result_cache_entry_t in the cache, compared by key.
+ * @var query_result_cache::clock
+ *     @brief   Number of uses of outputs in the cache, ever.
+ *     @details Stored in the index, so that least recently used outputs can be told apart across
+ *              runs.
+ * @var query_result_cache::size
+ *     @brief Number of bytes in all outputs in the cache.
+ * @var query_result_cache::max_size
+ *     @brief Number of bytes the outputs in the cache are limited to when it's closed.
+ * @var query_result_cache::prefix
+ *     @brief Identification of the dataset and of the program, the first part of every key.
+ * @var query_result_cache::prefix_length
+ *     @brief Number of bytes in ::query_result_cache::prefix.
+ * @var query_result_cache::lookup
+ *     @brief   Entry with the key of the last query looked up, reused between lookups.
+ *     @details Its fields other than ::query_result_cache_entry_t::key_length and
+ *              ::query_result_cache_entry_t::key aren't used.
+ * @var query_result_cache::lookup_capacity
+ *     @brief Number of bytes allocated for the key of ::query_result_cache::lookup.
+ * @var query_result_cache::statistics
+ *     @brief How lookups in the cache were answered.
+ */
+struct query_result_cache {
+    char                           *directory;
+    GHashTable                     *entries;
+    uint64_t                        clock, size, max_size;
+    char                            prefix[QUERY_RESULT_CACHE_MAX_PREFIX];
+    size_t                          prefix_length;
+    query_result_cache_entry_t     *lookup;
+    size_t                          lookup_capacity;
+    query_result_cache_statistics_t statistics;
+};
+
+/**
+ * @brief Hashes the key of an output in a cache.
+ *
+ * @param key    Key to be hashed.
+ * @param length Number of bytes in @p key.
+ *
+ * @return The FNV-1a hash of @p key.
+ */
+uint64_t __query_result_cache_hash(const char *key, size_t length) {
+    uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ (unsigned char) key[i]) * 0x100000001b3;
+    return hash;
+}
+
+/** @brief Hashes a ::query_result_cache_entry_t for ::query_result_cache::entries. */
+guint __query_result_cache_entry_hash(gconstpointer entry) {
+    return (guint) ((const query_result_cache_entry_t *) entry)->hash;
+}
+
+/** @brief Checks if two ::query_result_cache_entry_t have the same key. */
+gboolean __query_result_cache_entry_equal(gconstpointer a, gconstpointer b) {
+    const query_result_cache_entry_t *const ea = a;
+    const query_result_cache_entry_t *const eb = b;
+    return ea->key_length == eb->key_length && memcmp(ea->key, eb->key, ea->key_length) == 0;
+}
+
+/**
+ * @brief Allocates an entry with an uninitialized key.
+ *
+ * @param key_length Number of bytes in the key of the entry.
+ *
+ * @return The new entry, to be `free`d, or `NULL` on allocation failure.
+ */
+query_result_cache_entry_t *__query_result_cache_entry_create(size_t key_length) {
+    query_result_cache_entry_t *const entry =
+        malloc(sizeof(query_result_cache_entry_t) + key_length);
+    if (entry)
+        entry->key_length = key_length;
+    return entry;
+}
+
+/**
+ * @brief Gets the path to the file with an output in a cache.
+ *
+ * @param cache  Cache the output is in.
+ * @param hash   Hash of the key of the output.
+ * @param suffix Extension of the file (`out`, or `tmp` while the file is being written).
+ * @param out    Where to write the path to.
+ */
+void __query_result_cache_get_path(const query_result_cache_t *cache,
+                                   uint64_t                    hash,
+                                   const char                 *suffix,
+                                   char                        out[PATH_MAX]) {
+    snprintf(out, PATH_MAX, "%s/%016" PRIx64 ".%s", cache->directory, hash, suffix);
+}
+
+/**
+ * @brief   Prepares ::query_result_cache::lookup for the key of a query.
+ * @details The key of the query is appended to the cache's prefix.
+ *
+ * @param cache  Cache to be looked up.
+ * @param key    Canonical form of the query.
+ * @param length Number of bytes in @p key.
+ *
+ * @return ::query_result_cache::lookup, or `NULL` on allocation failure.
+ */
+query_result_cache_entry_t *__query_result_cache_prepare_lookup(query_result_cache_t *cache,
+                                                                const char           *key,
+                                                                size_t                length) {
+    const size_t full_length = cache->prefix_length + length;
+    if (full_length > cache->lookup_capacity) {
+        query_result_cache_entry_t *const lookup =
+            realloc(cache->lookup, sizeof(query_result_cache_entry_t) + full_length);
+        if (!lookup)
+            return NULL;
+
+        cache->lookup          = lookup;
+        cache->lookup_capacity = full_length;
+    }
+
+    memcpy(cache->lookup->key, cache->prefix, cache->prefix_length);
+    memcpy(cache->lookup->key + cache->prefix_length, key, length);
+    cache->lookup->key_length = full_length;
+    cache->lookup->hash       = __query_result_cache_hash(cache->lookup->key, full_length);
+    return cache->lookup;
+}
+
+/**
+ * @brief   Reads the index of a cache into ::query_result_cache::entries.
+ * @details A missing index is an empty cache. A corrupt index is also considered empty, leaving
+ *          its outputs behind, to be replaced when the same queries are stored again.
+ *
+ * @param cache Cache whose index is to be read.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __query_result_cache_read_index(query_result_cache_t *cache) {
+    char path[PATH_MAX];
+    snprintf(path, PATH_MAX, "%s/index", cache->directory);
+
+    FILE *const index = fopen(path, "rb");
+    if (!index)
+        return 0;
+
+    int      retval = 0;
+    uint64_t header[3]; /* Magic, clock and number of entries */
+    if (fread(header, sizeof(uint64_t), 3, index) != 3 ||
+        header[0] != QUERY_RESULT_CACHE_INDEX_MAGIC)
+        goto DEFER;
+
+    for (uint64_t i = 0; i < header[2]; ++i) {
+        uint64_t fields[4]; /* Hash, last use, size and key length */
+        if (fread(fields, sizeof(uint64_t), 4, index) != 4 || fields[3] > SIZE_MAX / 2)
+            goto CORRUPT;
+
+        query_result_cache_entry_t *const entry = __query_result_cache_entry_create(fields[3]);
+        if (!entry) {
+            retval = 1;
+            goto CORRUPT;
+        }
+        entry->hash      = fields[0];
+        entry->last_used = fields[1];
+        entry->size      = fields[2];
+
+        if (fread(entry->key, 1, entry->key_length, index) != entry->key_length) {
+            free(entry);
+            goto CORRUPT;
+        }
+
+        g_hash_table_add(cache->entries, entry);
+        cache->size += entry->size;
+    }
+
+    cache->clock = header[1];
+    goto DEFER;
+
+CORRUPT:
+    g_hash_table_remove_all(cache->entries);
+    cache->size = 0;
+DEFER:
+    fclose(index);
+    return retval;
+}
+
+query_result_cache_t *query_result_cache_open(const char *dataset_path) {
+    const char *const directory = getenv(QUERY_RESULT_CACHE_ENVIRONMENT_VARIABLE);
+    if (!directory || !*directory)
+        return NULL;
+
+    uint64_t          max_size = QUERY_RESULT_CACHE_DEFAULT_SIZE;
+    const char *const size_env = getenv(QUERY_RESULT_CACHE_SIZE_ENVIRONMENT_VARIABLE);
+    if (size_env) {
+        char *end;
+        errno    = 0;
+        max_size = strtoull(size_env, &end, 10);
+        if (errno || *end || end == size_env) {
+            fputs("Invalid size of the query result cache!\n", stderr);
+            return NULL;
+        }
+    }
+
+    uint64_t fingerprint;
+    if (dataset_snapshot_get_fingerprint(dataset_path, &fingerprint)) {
+        fputs("Failed to identify the dataset for the query result cache!\n", stderr);
+        return NULL;
+    }
+
+    if (mkdir(directory, 0755) && errno != EEXIST) {
+        fputs("Failed to create the query result cache directory!\n", stderr);
+        return NULL;
+    }
+
+    query_result_cache_t *const cache = malloc(sizeof(query_result_cache_t));
+    if (!cache)
+        goto DEFER_1;
+
+    cache->directory = strdup(directory);
+    if (!cache->directory)
+        goto DEFER_2;
+
+    cache->entries = g_hash_table_new_full(__query_result_cache_entry_hash,
+                                           __query_result_cache_entry_equal,
+                                           free,
+                                           NULL);
+    cache->clock   = 0;
+    cache->size    = 0;
+    cache->max_size =
+        max_size > UINT64_MAX / (1024 * 1024) ? UINT64_MAX : max_size * 1024 * 1024;
+    cache->lookup          = NULL;
+    cache->lookup_capacity = 0;
+    cache->statistics      = (query_result_cache_statistics_t) {0};
+
+    /* Textual, so that the separating spaces keep the fields of the prefix unambiguous */
+    cache->prefix_length = (size_t) snprintf(cache->prefix,
+                                             QUERY_RESULT_CACHE_MAX_PREFIX,
+                                             "%016" PRIx64 " %d %s ",
+                                             fingerprint,
+                                             query_type_get_approximate(),
+                                             QUERY_RESULT_CACHE_REVISION);
+    if (cache->prefix_length >= QUERY_RESULT_CACHE_MAX_PREFIX)
+        cache->prefix_length = QUERY_RESULT_CACHE_MAX_PREFIX - 1;
+
+    if (__query_result_cache_read_index(cache))
+        goto DEFER_3;
+    return cache;
+
+DEFER_3:
+    g_hash_table_unref(cache->entries);
+    free(cache->directory);
+DEFER_2:
+    free(cache);
+DEFER_1:
+    fputs("Failed to allocate the query result cache!\n", stderr);
+    return NULL;
+}
+
+int query_result_cache_fetch(query_result_cache_t *cache,
+                             const char           *key,
+                             size_t                key_length,
+                             const char           *output_path) {
+    const query_result_cache_entry_t *const lookup =
+        __query_result_cache_prepare_lookup(cache, key, key_length);
+    query_result_cache_entry_t *const entry =
+        lookup ? g_hash_table_lookup(cache->entries, lookup) : NULL;
+    if (!entry) {
+        cache->statistics.misses++;
+        return 1;
+    }
+
+    char path[PATH_MAX];
+    __query_result_cache_get_path(cache, entry->hash, "out", path);
+
+    /* Output files from previous runs may be hard links to others (see batch_mode.c) */
+    unlink(output_path);
+    if (stream_copy_file(path, output_path)) {
+        /* The output was removed from the cache directory, so it's forgotten */
+        cache->size -= entry->size;
+        g_hash_table_remove(cache->entries, entry);
+        cache->statistics.misses++;
+        return 1;
+    }
+
+    entry->last_used = ++cache->clock;
+    cache->statistics.hits++;
+    return 0;
+}
+
+int query_result_cache_store(query_result_cache_t *cache,
+                             const char           *key,
+                             size_t                key_length,
+                             const char           *output_path) {
+    struct stat output_stat;
+    if (stat(output_path, &output_stat) || (uint64_t) output_stat.st_size > cache->max_size)
+        return 1;
+
+    const query_result_cache_entry_t *const lookup =
+        __query_result_cache_prepare_lookup(cache, key, key_length);
+    if (!lookup)
+        return 1;
+
+    query_result_cache_entry_t *const entry = __query_result_cache_entry_create(lookup->key_length);
+    if (!entry)
+        return 1;
+    memcpy(entry->key, lookup->key, lookup->key_length);
+    entry->hash      = lookup->hash;
+    entry->last_used = ++cache->clock;
+    entry->size      = (uint64_t) output_stat.st_size;
+
+    /* Written to a temporary file first, not to leave a partial output behind on failure */
+    char temporary_path[PATH_MAX], path[PATH_MAX];
+    __query_result_cache_get_path(cache, entry->hash, "tmp", temporary_path);
+    __query_result_cache_get_path(cache, entry->hash, "out", path);
+    if (stream_copy_file(output_path, temporary_path) || rename(temporary_path, path)) {
+        remove(temporary_path);
+        free(entry);
+        return 1;
+    }
+
+    const query_result_cache_entry_t *const previous = g_hash_table_lookup(cache->entries, entry);
+    if (previous) {
+        cache->size -= previous->size;
+        g_hash_table_remove(cache->entries, previous);
+    }
+    g_hash_table_add(cache->entries, entry);
+
+    cache->size += entry->size;
+    cache->statistics.stores++;
+    return 0;
+}
+
+const query_result_cache_statistics_t *
+    query_result_cache_get_statistics(const query_result_cache_t *cache) {
+    return &cache->statistics;
+}
+
+/** @brief Compares two ::query_result_cache_entry_t to sort them from least recently used. */
+gint __query_result_cache_compare_last_used(gconstpointer a, gconstpointer b) {
+    const uint64_t last_a = (*(const query_result_cache_entry_t *const *) a)->last_used;
+    const uint64_t last_b = (*(const query_result_cache_entry_t *const *) b)->last_used;
+    return (last_a > last_b) - (last_a < last_b);
+}
+
+/**
+ * @brief Removes the least recently used outputs from a cache, until it fits in its size limit.
+ * @param cache Cache to remove outputs from.
+ */
+void __query_result_cache_evict(query_result_cache_t *cache) {
+    if (cache->size <= cache->max_size)
+        return;
+
+    GPtrArray *const entries = g_ptr_array_sized_new(g_hash_table_size(cache->entries));
+    GHashTableIter   iter;
+    gpointer         entry_pointer;
+    g_hash_table_iter_init(&iter, cache->entries);
+    while (g_hash_table_iter_next(&iter, &entry_pointer, NULL))
+        g_ptr_array_add(entries, entry_pointer);
+    g_ptr_array_sort(entries, __query_result_cache_compare_last_used);
+
+    for (size_t i = 0; i < entries->len && cache->size > cache->max_size; ++i) {
+        query_result_cache_entry_t *const entry = g_ptr_array_index(entries, i);
+
+        char path[PATH_MAX];
+        __query_result_cache_get_path(cache, entry->hash, "out", path);
+        unlink(path);
+
+        cache->size -= entry->size;
+        cache->statistics.evictions++;
+        g_hash_table_remove(cache->entries, entry);
+    }
+
+    g_ptr_array_unref(entries);
+}
+
+/**
+ * @brief   Writes the index of a cache.
+ * @details The index is written to a temporary file first, so that a failure doesn't corrupt the
+ *          previous index.
+ *
+ * @param cache Cache whose index is to be written.
+ *
+ * @retval 0 Success.
+ * @retval 1 File IO failure.
+ */
+int __query_result_cache_write_index(const query_result_cache_t *cache) {
+    char temporary_path[PATH_MAX], path[PATH_MAX];
+    snprintf(temporary_path, PATH_MAX, "%s/index.tmp", cache->directory);
+    snprintf(path, PATH_MAX, "%s/index", cache->directory);
+
+    FILE *const index = fopen(temporary_path, "wb");
+    if (!index)
+        return 1;
+
+    const uint64_t header[3] = {QUERY_RESULT_CACHE_INDEX_MAGIC,
+                                cache->clock,
+                                g_hash_table_size(cache->entries)};
+    int            failed    = fwrite(header, sizeof(uint64_t), 3, index) != 3;
+
+    GHashTableIter iter;
+    gpointer       entry_pointer;
+    g_hash_table_iter_init(&iter, cache->entries);
+    while (!failed && g_hash_table_iter_next(&iter, &entry_pointer, NULL)) {
+        const query_result_cache_entry_t *const entry = entry_pointer;
+
+        /* The fields of an entry are the same as in the index, and have no padding */
+        failed = fwrite(entry, sizeof(query_result_cache_entry_t), 1, index) != 1 ||
+                 fwrite(entry->key, 1, entry->key_length, index) != entry->key_length;
+    }
+
+    failed = fclose(index) || failed;
+    if (!failed)
+        failed = rename(temporary_path, path) != 0;
+    if (failed)
+        remove(temporary_path);
+    return failed;
+}
+
+int query_result_cache_close(query_result_cache_t *cache) {
+    __query_result_cache_evict(cache);
+    const int retval = __query_result_cache_write_index(cache);
+    if (retval)
+        fputs("Failed to write the index of the query result cache!\n", stderr);
+
+    g_hash_table_unref(cache->entries);
+    free(cache->lookup);
+    free(cache->directory);
+    free(cache);
+    return retval;
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  query_slow_log.c
+ * @brief Implementation of methods in include/queries/query_slow_log.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref query_slow_log_examples).
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "queries/query_slow_log.h"
+#include "queries/query_type.h"
+
+/**
+ * @struct query_slow_log
+ * @brief  Log of queries that took longer than a threshold.
+ *
+ * @var query_slow_log::path
+ *     @brief Path to the log file.
+ * @var query_slow_log::rotated_path
+ *     @brief Path the log file is renamed to when it's rotated.
+ * @var query_slow_log::file
+ *     @brief Log file, or `NULL` if it couldn't be reopened after being rotated.
+ * @var query_slow_log::threshold
+ *     @brief Minimum duration of the queries to be logged, in microseconds.
+ * @var query_slow_log::text_callback
+ *     @brief Method that writes the text of a query (can be `NULL`).
+ * @var query_slow_log::text_data
+ *     @brief Argument passed to ::query_slow_log::text_callback.
+ * @var query_slow_log::mutex
+ *     @brief Mutex that protects ::query_slow_log::file from concurrent writes.
+ */
+struct query_slow_log {
+    char                          *path, *rotated_path;
+    FILE                          *file;
+    uint64_t                       threshold;
+    query_slow_log_text_callback_t text_callback;
+    void                          *text_data;
+    pthread_mutex_t                mutex;
+};
+
+/** @brief Log returned by ::query_slow_log_get_shared. */
+query_slow_log_t *query_slow_log_shared = NULL;
+
+query_slow_log_t *query_slow_log_create(const char *path, uint64_t threshold) {
+    query_slow_log_t *const log = malloc(sizeof(query_slow_log_t));
+    if (!log)
+        goto DEFER_1;
+
+    const size_t path_length = strlen(path);
+    log->path                = strdup(path);
+    log->rotated_path        = malloc(path_length + 3);
+    if (!log->path || !log->rotated_path)
+        goto DEFER_2;
+    memcpy(log->rotated_path, path, path_length);
+    memcpy(log->rotated_path + path_length, ".1", 3);
+
+    log->file = fopen(path, "a");
+    if (!log->file)
+        goto DEFER_2;
+
+    log->threshold     = threshold;
+    log->text_callback = NULL;
+    log->text_data     = NULL;
+    pthread_mutex_init(&log->mutex, NULL);
+    return log;
+
+DEFER_2:
+    free(log->path);
+    free(log->rotated_path);
+    free(log);
+DEFER_1:
+    return NULL;
+}
+
+void query_slow_log_set_text_callback(query_slow_log_t              *log,
+                                      query_slow_log_text_callback_t callback,
+                                      void                          *user_data) {
+    log->text_callback = callback;
+    log->text_data     = user_data;
+}
+
+int query_slow_log_is_slow(const query_slow_log_t *log, uint64_t duration) {
+    return duration >= log->threshold;
+}
+
+/**
+ * @brief   Starts a new log file, if the current one grew too large.
+ * @details Auxiliary method for ::query_slow_log_write. The log must be locked.
+ * @param   log Log whose file may be rotated.
+ */
+void __query_slow_log_rotate(query_slow_log_t *log) {
+    const long size = ftell(log->file);
+    if (size < QUERY_SLOW_LOG_MAX_FILE_SIZE)
+        return;
+
+    fclose(log->file);
+    rename(log->path, log->rotated_path); /* On failure, the same file keeps being appended to */
+    log->file = fopen(log->path, "a");
+}
+
+void query_slow_log_write(query_slow_log_t *log, const query_slow_log_entry_t *entry) {
+    const query_type_t *const type   = query_instance_get_type(entry->query);
+    const size_t              shared = entry->statistics_shared ? entry->statistics_shared : 1;
+    const uint64_t            total  = entry->statistics / shared + entry->execution;
+
+    char         timestamp[32];
+    const time_t now = time(NULL);
+    struct tm    now_tm;
+
+    if (!localtime_r(&now, &now_tm) ||
+        !strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", &now_tm))
+        strcpy(timestamp, "?");
+
+    pthread_mutex_lock(&log->mutex);
+    if (!log->file)
+        goto DEFER_1;
+
+    fprintf(log->file,
+            "%s type=%zu total_us=%" PRIu64 " statistics_us=%" PRIu64
+            " statistics_shared=%zu execution_us=%" PRIu64 " formatting_us=%" PRIu64
+            " records=%zu output_bytes=%zu ",
+            timestamp,
+            query_type_get_type_number(type),
+            total,
+            entry->statistics,
+            shared,
+            entry->execution,
+            entry->formatting,
+            entry->records,
+            entry->output_size);
+
+    if (log->text_callback) {
+        fputs("query=", log->file);
+        log->text_callback(log->text_data, entry->query, log->file);
+    } else {
+        fprintf(log->file, "line=%zu", query_instance_get_line_in_file(entry->query));
+    }
+    fputc('\n', log->file);
+
+    /* Written right away, so that nothing is lost if the program crashes or is killed */
+    fflush(log->file);
+    __query_slow_log_rotate(log);
+
+DEFER_1:
+    pthread_mutex_unlock(&log->mutex);
+}
+
+void query_slow_log_set_shared(query_slow_log_t *log) {
+    query_slow_log_shared = log;
+}
+
+query_slow_log_t *query_slow_log_get_shared(void) {
+    return query_slow_log_shared;
+}
+
+void query_slow_log_free(query_slow_log_t *log) {
+    if (!log)
+        return;
+
+    if (log->file)
+        fclose(log->file);
+    pthread_mutex_destroy(&log->mutex);
+    free(log->path);
+    free(log->rotated_path);
+    free(log);
+}
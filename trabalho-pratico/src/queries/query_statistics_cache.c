@@ -0,0 +1,175 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  query_statistics_cache.c
+ * @brief Implementation of methods in include/queries/query_statistics_cache.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref query_statistics_cache_examples).
+ */
+
+#include <glib.h>
+#include <stdlib.h>
+
+#include "queries/query_statistics_cache.h"
+#include "utils/memory_budget.h"
+
+/** @brief Maximum number of entries in a ::query_statistics_cache_t. */
+#define QUERY_STATISTICS_CACHE_CAPACITY 32
+
+/**
+ * @struct query_statistics_cache_entry_t
+ * @brief  Statistical data in a ::query_statistics_cache_t.
+ *
+ * @var query_statistics_cache_entry_t::type
+ *     @brief Type of the query the data was generated for.
+ * @var query_statistics_cache_entry_t::key
+ *     @brief Value returned by the ::query_type_statistics_key_callback_t of
+ *            ::query_statistics_cache_entry_t::type.
+ * @var query_statistics_cache_entry_t::statistics
+ *     @brief Statistical data.
+ * @var query_statistics_cache_entry_t::allocator
+ *     @brief Arena where ::query_statistics_cache_entry_t::statistics is allocated.
+ */
+typedef struct {
+    const query_type_t *type;
+    uint64_t            key;
+    void               *statistics;
+    arena_t            *allocator;
+} query_statistics_cache_entry_t;
+
+/**
+ * @struct query_statistics_cache
+ * @brief  A cache of statistical data generated for single queries.
+ *
+ * @var query_statistics_cache::database
+ *     @brief Database statistical data is generated from.
+ * @var query_statistics_cache::entries
+ *     @brief Array of ::query_statistics_cache_entry_t, from least to most recently used.
+ * @var query_statistics_cache::last_hit
+ *     @brief Whether the last call to ::query_statistics_cache_get found data in the cache.
+ */
+struct query_statistics_cache {
+    const database_t *database;
+    GArray           *entries;
+    int               last_hit;
+};
+
+query_statistics_cache_t *query_statistics_cache_create(const database_t *database) {
+    query_statistics_cache_t *const cache = malloc(sizeof(query_statistics_cache_t));
+    if (!cache)
+        return NULL;
+
+    cache->database = database;
+    cache->entries  = g_array_sized_new(FALSE,
+                                       FALSE,
+                                       sizeof(query_statistics_cache_entry_t),
+                                       QUERY_STATISTICS_CACHE_CAPACITY);
+    cache->last_hit = 0;
+    return cache;
+}
+
+int query_statistics_cache_supports_type(const query_type_t *type) {
+    return query_type_get_generate_statistics_callback(type) &&
+           query_type_get_statistics_key_callback(type);
+}
+
+/**
+ * @brief   Frees the statistical data in a cache entry.
+ * @details Auxiliary method for ::query_statistics_cache_get and ::query_statistics_cache_free.
+ * @param   entry Entry whose data is to be freed.
+ */
+void __query_statistics_cache_free_entry(query_statistics_cache_entry_t *entry) {
+    const query_type_free_statistics_callback_t free_stats =
+        query_type_get_free_statistics_callback(entry->type);
+    if (free_stats)
+        free_stats(entry->statistics);
+    arena_free(entry->allocator);
+}
+
+int query_statistics_cache_get(query_statistics_cache_t *cache,
+                               const query_instance_t   *instance,
+                               const void              **out_statistics) {
+
+    const query_type_t *const type = query_instance_get_type(instance);
+    cache->last_hit                = 0;
+    if (!query_statistics_cache_supports_type(type))
+        return 1;
+
+    const uint64_t key =
+        query_type_get_statistics_key_callback(type)(query_instance_get_argument_data(instance));
+
+    /* Look for the data, moving it to the end of the array (most recently used) */
+    for (size_t i = 0; i < cache->entries->len; ++i) {
+        const query_statistics_cache_entry_t entry =
+            g_array_index(cache->entries, query_statistics_cache_entry_t, i);
+
+        if (entry.type == type && entry.key == key) {
+            g_array_remove_index(cache->entries, i);
+            g_array_append_val(cache->entries, entry);
+
+            *out_statistics = entry.statistics;
+            cache->last_hit = 1;
+            return 0;
+        }
+    }
+
+    /* Cache miss */
+    arena_t *const allocator = arena_create(QUERY_TYPE_STATISTICS_ARENA_BLOCK_SIZE);
+    if (!allocator)
+        return 1;
+
+    void *const statistics =
+        query_type_get_generate_statistics_callback(type)(cache->database, 1, &instance, allocator);
+    if (!statistics) {
+        arena_free(allocator);
+        return 1;
+    }
+
+    /* Close to the memory budget, only the data just generated is kept */
+    const int degrade = cache->entries->len &&
+                        memory_budget_should_degrade(MEMORY_BUDGET_DEGRADATION_CACHES);
+    while (cache->entries->len == QUERY_STATISTICS_CACHE_CAPACITY ||
+           (degrade && cache->entries->len)) {
+        __query_statistics_cache_free_entry(
+            &g_array_index(cache->entries, query_statistics_cache_entry_t, 0));
+        g_array_remove_index(cache->entries, 0);
+    }
+
+    const query_statistics_cache_entry_t entry = {.type       = type,
+                                                  .key        = key,
+                                                  .statistics = statistics,
+                                                  .allocator  = allocator};
+    g_array_append_val(cache->entries, entry);
+
+    *out_statistics = statistics;
+    return 0;
+}
+
+int query_statistics_cache_was_hit(const query_statistics_cache_t *cache) {
+    return cache->last_hit;
+}
+
+void query_statistics_cache_free(query_statistics_cache_t *cache) {
+    for (size_t i = 0; i < cache->entries->len; ++i)
+        __query_statistics_cache_free_entry(
+            &g_array_index(cache->entries, query_statistics_cache_entry_t, i));
+
+    g_array_unref(cache->entries);
+    free(cache);
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  query_template.c
+ * @brief Implementation of methods in include/queries/query_template.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref query_template_examples).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "queries/query_parser.h"
+#include "queries/query_template.h"
+#include "queries/query_tokenizer.h"
+
+/**
+ * @struct query_template
+ * @brief  A query with some of its arguments left as parameters.
+ *
+ * @var query_template::type
+ *     @brief Type of the query.
+ * @var query_template::formatted
+ *     @brief Whether the query's output must be formatted.
+ * @var query_template::buffer
+ *     @brief Copy of the template's string, where constant arguments are `'\0'`-terminated.
+ * @var query_template::argc
+ *     @brief Number of arguments of the query (constants and parameters).
+ * @var query_template::argv
+ *     @brief Start of every constant argument in ::query_template::buffer, or `NULL` for
+ *            parameters.
+ * @var query_template::lengths
+ *     @brief Length of every argument in ::query_template::argv (`0` for parameters).
+ * @var query_template::nparameters
+ *     @brief Number of `NULL` elements in ::query_template::argv.
+ */
+struct query_template {
+    const query_type_t *type;
+    int                 formatted;
+
+    char  *buffer;
+    size_t argc;
+    char  *argv[QUERY_PARSER_MAX_ARGUMENTS];
+    size_t lengths[QUERY_PARSER_MAX_ARGUMENTS];
+    size_t nparameters;
+};
+
+/**
+ * @brief   Callback for every token in a template.
+ * @details Auxiliary method for ::query_template_create.
+ *
+ * @param user_data A pointer to the ::query_template_t being created.
+ * @param token     Token in ::query_template::buffer.
+ * @param length    Length of @p token.
+ *
+ * @retval 0 Success.
+ * @retval 1 Parsing failure.
+ */
+int __query_template_create_callback(void *user_data, const char *token, size_t length) {
+    query_template_t *const template = user_data;
+
+    if (!template->type)
+        return query_parser_parse_type(token, length, &template->type, &template->formatted);
+
+    if (template->argc == QUERY_PARSER_MAX_ARGUMENTS)
+        return 1;
+
+    /* The first token is the query type, so token - 1 is in the buffer */
+    if (length == 1 && *token == '?' && *(token - 1) != '"') {
+        template->argv[template->argc]    = NULL;
+        template->lengths[template->argc] = 0;
+        template->nparameters++;
+    } else {
+        template->argv[template->argc]    = template->buffer + (token - template->buffer);
+        template->lengths[template->argc] = length;
+    }
+    template->argc++;
+    return 0;
+}
+
+query_template_t *query_template_create(const char *input) {
+    query_template_t *const template = malloc(sizeof(query_template_t));
+    if (!template)
+        goto DEFER_1;
+
+    template->buffer = strdup(input);
+    if (!template->buffer)
+        goto DEFER_2;
+
+    template->type        = NULL;
+    template->formatted   = 0;
+    template->argc        = 0;
+    template->nparameters = 0;
+    if (query_tokenizer_tokenize_slices(template->buffer,
+                                        __query_template_create_callback,
+                                        template) ||
+        !template->type)
+        goto DEFER_3;
+
+    /* Constant arguments are terminated once, instead of on every bind */
+    for (size_t i = 0; i < template->argc; ++i)
+        if (template->argv[i])
+            template->argv[i][template->lengths[i]] = '\0';
+
+    return template;
+
+DEFER_3:
+    free(template->buffer);
+DEFER_2:
+    free(template);
+DEFER_1:
+    return NULL;
+}
+
+size_t query_template_get_parameter_count(const query_template_t *template) {
+    return template->nparameters;
+}
+
+/**
+ * @struct query_template_bind_data_t
+ * @brief  State of ::query_template_bind, while it's splitting parameters.
+ *
+ * @var query_template_bind_data_t::template
+ *     @brief Template whose parameters are being bound.
+ * @var query_template_bind_data_t::parameters
+ *     @brief `parameters` argument in ::query_template_bind.
+ * @var query_template_bind_data_t::argv
+ *     @brief Arguments of the query being created.
+ * @var query_template_bind_data_t::lengths
+ *     @brief Length of every argument in ::query_template_bind_data_t::argv.
+ * @var query_template_bind_data_t::next
+ *     @brief Index in ::query_template_bind_data_t::argv after the last parameter bound.
+ */
+typedef struct {
+    const query_template_t *const template;
+    char *const                   parameters;
+    char                         *argv[QUERY_PARSER_MAX_ARGUMENTS];
+    size_t                        lengths[QUERY_PARSER_MAX_ARGUMENTS];
+    size_t                        next;
+} query_template_bind_data_t;
+
+/**
+ * @brief   Binds a value to the next parameter of a template.
+ * @details Auxiliary method for ::query_template_bind.
+ *
+ * @param user_data A pointer to a ::query_template_bind_data_t.
+ * @param token     Value of the parameter.
+ * @param length    Length of @p token.
+ *
+ * @retval 0 Success.
+ * @retval 1 There are more values than parameters.
+ */
+int __query_template_bind_callback(void *user_data, const char *token, size_t length) {
+    query_template_bind_data_t *const bind     = user_data;
+    const query_template_t *const     template = bind->template;
+
+    while (bind->next < template->argc && template->argv[bind->next])
+        bind->next++;
+    if (bind->next == template->argc)
+        return 1;
+
+    bind->argv[bind->next]    = bind->parameters + (token - bind->parameters);
+    bind->lengths[bind->next] = length;
+    bind->next++;
+    return 0;
+}
+
+int query_template_bind(const query_template_t *template,
+                        query_instance_t       *output,
+                        char                   *parameters,
+                        arena_t                *allocator) {
+    query_template_bind_data_t bind = {.template = template, .parameters = parameters, .next = 0};
+    memcpy(bind.argv, template->argv, template->argc * sizeof(char *));
+    memcpy(bind.lengths, template->lengths, template->argc * sizeof(size_t));
+
+    if (query_tokenizer_tokenize_slices(parameters, __query_template_bind_callback, &bind))
+        return 1;
+
+    /* Check if any parameter was left unbound */
+    for (size_t i = bind.next; i < template->argc; ++i)
+        if (!template->argv[i])
+            return 1;
+
+    return query_parser_parse_arguments(output,
+                                        template->type,
+                                        template->formatted,
+                                        template->argc,
+                                        bind.argv,
+                                        bind.lengths,
+                                        allocator);
+}
+
+void query_template_free(query_template_t *template) {
+    if (!template)
+        return;
+
+    free(template->buffer);
+    free(template);
+}
@@ -26,75 +26,94 @@
 #include <string.h>
 
 #include "queries/query_tokenizer.h"
-#include "utils/string_utils.h"
+
+int query_tokenizer_tokenize_slices(const char                      *input,
+                                    query_tokenizer_slice_callback_t callback,
+                                    void                            *user_data) {
+    const char *quote_start = NULL; /* After the opening quote of the current token, if any */
+    const char *token       = input;
+
+    for (;;) {
+        const char *end = token;
+        while (*end && *end != ' ')
+            end++;
+
+        const size_t length = (size_t) (end - token);
+        if (length) { /* Skip empty tokens */
+            if (*token == '"')
+                quote_start = token + 1;
+
+            if (!quote_start) {
+                const int cb_result = callback(user_data, token, length);
+                if (cb_result)
+                    return cb_result;
+            } else if (token[length - 1] == '"') {
+                /* A lone quote (`"`) both opens and closes an empty token */
+                const char *const quote_end = end - 1;
+                const size_t      quoted =
+                    quote_end > quote_start ? (size_t) (quote_end - quote_start) : 0;
+                quote_start = NULL;
+
+                const int cb_result = callback(user_data, quote_end - quoted, quoted);
+                if (cb_result)
+                    return cb_result;
+            }
+        }
+
+        if (!*end)
+            return 0;
+        token = end + 1;
+    }
+}
 
 /**
  * @struct query_tokenizer_data_t
- * @brief  Contains the tokenizer's state.
+ * @brief  State of ::query_tokenizer_tokenize, while it's tokenizing a modifiable string.
  *
+ * @var query_tokenizer_data_t::input
+ *     @brief `input` parameter in ::query_tokenizer_tokenize.
  * @var query_tokenizer_data_t::user_data
  *     @brief `user_data` parameter in ::query_tokenizer_tokenize.
  * @var query_tokenizer_data_t::callback
  *     @brief `callback` parameter in ::query_tokenizer_tokenize.
- * @var query_tokenizer_data_t::quote_token
- *     @brief The pointer to the beginning of the current token if is starts with ``'\"'``, `NULL`
- *            otherwise.
  */
 typedef struct {
+    char                    *input;
     void                    *user_data;
     tokenize_iter_callback_t callback;
-
-    char *quote_token;
 } query_tokenizer_data_t;
 
 /**
- * @brief   Handles space-separated tokens from a string.
+ * @brief   Terminates a token with `'\0'` and passes it to the callback of
+ *          ::query_tokenizer_tokenize.
  * @details Auxiliary method for ::query_tokenizer_tokenize.
  *
  * @param tokenizer_data A pointer to a ::query_tokenizer_data_t.
- * @param token          Space-separated token to process (take quotes into account).
+ * @param token          Start of the token, in ::query_tokenizer_data_t::input.
+ * @param length         Length of the token.
+ *
+ * @return The value returned by ::query_tokenizer_data_t::callback.
  */
-int __query_tokenizer_handle_space_split(void *tokenizer_data, char *token) {
+int __query_tokenizer_terminate_slice(void *tokenizer_data, const char *token, size_t length) {
     query_tokenizer_data_t *const tokenizer = tokenizer_data;
 
-    if (*token == '\0') /* Skip empty tokens */
-        return 0;
+    char *const mutable_token = tokenizer->input + (token - tokenizer->input);
+    const char  terminator    = mutable_token[length];
 
-    if (*token == '"')
-        tokenizer->quote_token = token + 1;
-
-    if (tokenizer->quote_token) {
-        const size_t token_length = strlen(token);
-        if (token[token_length - 1] == '"') {
-
-            token[token_length - 1] = '\0';
-            const int cb_result = tokenizer->callback(tokenizer->user_data, tokenizer->quote_token);
-
-            token[token_length - 1] = '"'; /* Restore string */
-            tokenizer->quote_token  = NULL;
-
-            if (cb_result)
-                return cb_result;
-        }
-    } else {
-        const int cb_result = tokenizer->callback(tokenizer->user_data, token);
-        if (cb_result)
-            return cb_result;
-    }
+    mutable_token[length] = '\0';
+    const int cb_result   = tokenizer->callback(tokenizer->user_data, mutable_token);
+    mutable_token[length] = terminator; /* Restore string */
 
-    return 0;
+    return cb_result;
 }
 
 int query_tokenizer_tokenize(char *input, tokenize_iter_callback_t callback, void *user_data) {
-    query_tokenizer_data_t tokenizer_data = {.user_data   = user_data,
-                                             .callback    = callback,
-                                             .quote_token = NULL};
-    const int              retval =
-        string_tokenize(input, ' ', __query_tokenizer_handle_space_split, &tokenizer_data);
-    if (retval)
-        return retval;
-
-    return 0;
+    query_tokenizer_data_t tokenizer_data = {.input     = input,
+                                             .user_data = user_data,
+                                             .callback  = callback};
+    return query_tokenizer_tokenize_slices(input,
+                                           __query_tokenizer_terminate_slice,
+                                           &tokenizer_data);
 }
 
 int query_tokenizer_tokenize_const(const char              *input,
@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include "queries/query_type.h"
+#include "utils/memory_budget.h"
 
 /**
  * @struct query_type
@@ -35,37 +36,62 @@
  *     @brief A number that identifies this query type.
  * @var query_type::parse_arguments
  *     @brief Method that parses query arguments and generates ::query_instance::argument_data.
- * @var query_type::clone_arguments
- *     @brief Method that clones query arguments, generated by ::query_type::parse_arguments.
- * @var query_type::free_arguments
- *     @brief Method that frees data returned by ::query_type::parse_arguments.
  * @var query_type::generate_statistics
  *     @brief Method that generates statistical data for all queries of the same type.
  * @var query_type::free_statistics
  *     @brief Method that frees data generated by ::query_type::generate_statistics.
+ * @var query_type::statistics_key
+ *     @brief Method that tells which queries can share data generated by
+ *            ::query_type::generate_statistics.
  * @var query_type::execute
  *     @brief Method that executes a single query.
+ * @var query_type::execute_batch
+ *     @brief Method that executes many queries of the same type at once (optional).
+ * @var query_type::cost_model
+ *     @brief Method that predicts if ::query_type::generate_statistics is worth calling (optional).
+ * @var query_type::entity_key
+ *     @brief Method that tells which entity a query is about, for its output to be materialized
+ *            (optional).
+ * @var query_type::partition
+ *     @brief Method that tells which partition of a database a query is sent to (optional).
+ * @var query_type::merge
+ *     @brief Method that merges the partial outputs of a query sent to all partitions (optional).
  */
 struct query_type {
     size_t type_number;
 
     query_type_parse_arguments_callback_t parse_arguments;
-    query_type_clone_arguments_callback_t clone_arguments;
-    query_type_free_arguments_callback_t  free_arguments;
 
     query_type_generate_statistics_callback_t generate_statistics;
     query_type_free_statistics_callback_t     free_statistics;
+    query_type_statistics_key_callback_t      statistics_key;
 
-    query_type_execute_callback_t execute;
+    query_type_execute_callback_t       execute;
+    query_type_execute_batch_callback_t execute_batch;
+    query_type_cost_model_callback_t    cost_model;
+    query_type_entity_key_callback_t    entity_key;
+
+    query_type_partition_callback_t partition;
+    query_type_merge_callback_t     merge;
 };
 
+/** @brief Whether approximate mode was enabled with ::query_type_set_approximate. */
+int query_type_approximate = 0;
+
+/** @brief Whether partial mode was enabled with ::query_type_set_partial. */
+int query_type_partial = 0;
+
 query_type_t *query_type_create(size_t                                    type_number,
                                 query_type_parse_arguments_callback_t     parse_arguments,
-                                query_type_clone_arguments_callback_t     clone_arguments,
-                                query_type_free_arguments_callback_t      free_arguments,
                                 query_type_generate_statistics_callback_t generate_statistics,
                                 query_type_free_statistics_callback_t     free_statistics,
-                                query_type_execute_callback_t             execute) {
+                                query_type_statistics_key_callback_t      statistics_key,
+                                query_type_execute_callback_t             execute,
+                                query_type_execute_batch_callback_t       execute_batch,
+                                query_type_cost_model_callback_t          cost_model,
+                                query_type_entity_key_callback_t          entity_key,
+                                query_type_partition_callback_t           partition,
+                                query_type_merge_callback_t               merge) {
 
     query_type_t *const query = malloc(sizeof(query_type_t));
     if (!query)
@@ -73,11 +99,15 @@ query_type_t *query_type_create(size_t                                    type_n
 
     query->type_number         = type_number;
     query->parse_arguments     = parse_arguments;
-    query->clone_arguments     = clone_arguments;
-    query->free_arguments      = free_arguments;
     query->generate_statistics = generate_statistics;
     query->free_statistics     = free_statistics;
+    query->statistics_key      = statistics_key;
     query->execute             = execute;
+    query->execute_batch       = execute_batch;
+    query->cost_model          = cost_model;
+    query->entity_key          = entity_key;
+    query->partition           = partition;
+    query->merge               = merge;
 
     return query;
 }
@@ -101,18 +131,6 @@ query_type_parse_arguments_callback_t
     return type->parse_arguments;
 }
 
-query_type_clone_arguments_callback_t
-    query_type_get_clone_arguments_callback(const query_type_t *type) {
-
-    return type->clone_arguments;
-}
-
-query_type_free_arguments_callback_t
-    query_type_get_free_arguments_callback(const query_type_t *type) {
-
-    return type->free_arguments;
-}
-
 query_type_generate_statistics_callback_t
     query_type_get_generate_statistics_callback(const query_type_t *type) {
 
@@ -125,10 +143,62 @@ query_type_free_statistics_callback_t
     return type->free_statistics;
 }
 
+query_type_statistics_key_callback_t
+    query_type_get_statistics_key_callback(const query_type_t *type) {
+
+    return type->statistics_key;
+}
+
 query_type_execute_callback_t query_type_get_execute_callback(const query_type_t *type) {
     return type->execute;
 }
 
+query_type_execute_batch_callback_t
+    query_type_get_execute_batch_callback(const query_type_t *type) {
+
+    return type->execute_batch;
+}
+
+query_type_cost_model_callback_t query_type_get_cost_model_callback(const query_type_t *type) {
+    return type->cost_model;
+}
+
+query_type_entity_key_callback_t query_type_get_entity_key_callback(const query_type_t *type) {
+    return type->entity_key;
+}
+
+query_type_partition_callback_t query_type_get_partition_callback(const query_type_t *type) {
+    return type->partition;
+}
+
+query_type_merge_callback_t query_type_get_merge_callback(const query_type_t *type) {
+    return type->merge;
+}
+
+int query_type_get_approximate(void) {
+    if (query_type_approximate)
+        return 1;
+
+    const char *const environment = getenv(QUERY_TYPE_APPROXIMATE_ENVIRONMENT_VARIABLE);
+    if (!environment)
+        return 0;
+    else if (strcmp(environment, "auto") == 0)
+        return memory_budget_should_degrade(MEMORY_BUDGET_DEGRADATION_APPROXIMATE);
+    return strcmp(environment, "1") == 0;
+}
+
+void query_type_set_approximate(int approximate) {
+    query_type_approximate = approximate;
+}
+
+int query_type_get_partial(void) {
+    return query_type_partial;
+}
+
+void query_type_set_partial(int partial) {
+    query_type_partial = partial;
+}
+
 void query_type_free(query_type_t *query) {
     free(query);
 }
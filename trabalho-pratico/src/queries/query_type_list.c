@@ -23,6 +23,7 @@
  */
 
 #include "queries/query_type_list.h"
+#include "queries/query_instance.h"
 
 #include "queries/q01.h"
 #include "queries/q02.h"
@@ -51,18 +52,9 @@ query_type_t *__query_type_list[QUERY_TYPE_LIST_COUNT];
 
 /** @brief Automatically initializes ::__query_type_list when the program starts. */
 void __attribute__((constructor)) __query_type_list_create(void) {
-    query_type_t *(*const constructors[QUERY_TYPE_LIST_COUNT])(void) = {q01_create,
-                                                                        q02_create,
-                                                                        q03_create,
-                                                                        q04_create,
-                                                                        q05_create,
-                                                                        q06_create,
-                                                                        q07_create,
-                                                                        q08_create,
-                                                                        q09_create,
-                                                                        q10_create};
-    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i)
-        __query_type_list[i] = constructors[i]();
+#define QUERY_TYPE_LIST_CREATE(number, prefix) __query_type_list[number - 1] = prefix##_create();
+    QUERY_TYPE_LIST_FOREACH(QUERY_TYPE_LIST_CREATE)
+#undef QUERY_TYPE_LIST_CREATE
 }
 
 /** @brief Automatically `free`s ::__query_type_list when the program terminates. */
@@ -76,3 +68,25 @@ const query_type_t *query_type_list_get_by_index(size_t index) {
         return __query_type_list[index - 1];
     return NULL;
 }
+
+int query_type_list_execute(const database_t       *database,
+                            const void             *statistics,
+                            const query_instance_t *instance,
+                            query_writer_t         *output) {
+    const query_type_t *const type   = query_instance_get_type(instance);
+    const size_t              number = query_type_get_type_number(type);
+
+    /* Types with the number of a built-in one, but created elsewhere, go through their vtable */
+    if (query_type_list_get_by_index(number) == type) {
+        switch (number) {
+#define QUERY_TYPE_LIST_EXECUTE(number, prefix)                                                    \
+    case number:                                                                                   \
+        return prefix##_execute(database, statistics, instance, output);
+            QUERY_TYPE_LIST_FOREACH(QUERY_TYPE_LIST_EXECUTE)
+#undef QUERY_TYPE_LIST_EXECUTE
+            default:
+                break;
+        }
+    }
+    return query_type_get_execute_callback(type)(database, statistics, instance, output);
+}
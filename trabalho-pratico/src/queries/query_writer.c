@@ -22,150 +22,689 @@
  * See [the header file's documentation](@ref query_writer_examples).
  */
 
+#include <errno.h>
+#include <fcntl.h>
 #include <glib.h>
 #include <limits.h>
+#include <math.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "queries/query_writer.h"
+#include "testing/performance_probes.h"
+#include "utils/int_utils.h"
 #include "utils/string_pool.h"
 
 /**
  * @struct query_writer
  * @brief  Information about where to output query results to.
  *
- * @var query_writer::stream
- *     @brief Where to write query outputs to. May be `NULL` (see ::query_writer::lines in that
- *            case).
+ * @var query_writer::path
+ *     @brief Path of the file to be created when the writer is flushed, for writers whose file
+ *            creation is deferred. `NULL` otherwise (including for buffered writers, that don't
+ *            output to any file).
+ * @var query_writer::fd
+ *     @brief File descriptor of the output file, or `-1` if it hasn't been opened (or if query
+ *            results are outputted to ::query_writer::lines).
+ * @var query_writer::buffer
+ *     @brief Everything written to an output file, only written to it when the writer is flushed
+ *            or freed. Only used when outputting to a file.
+ * @var query_writer::buffer_length
+ *     @brief Number of characters in ::query_writer::buffer.
+ * @var query_writer::buffer_capacity
+ *     @brief Number of characters allocated for ::query_writer::buffer.
+ * @var query_writer::finished
+ *     @brief Whether the last line of ::query_writer::buffer has already been terminated.
  * @var query_writer::formatted
  *     @brief Whether the output of the query should be formatted (pretty printed).
+ * @var query_writer::binary
+ *     @brief Whether the output of the query is encoded in binary, to ::query_writer::buffer (see
+ *            ::query_writer_create_binary).
  * @var query_writer::is_first_field
  *     @brief Whether the next field to be printed is the first field of the current object.
  * @var query_writer::current_object
  *    @brief Number of the object currently being written (starts counting up from `1`).
  * @var query_writer::strings
- *     @brief In case ::query_writer::stream is `NULL`, this is where strings in
+ *     @brief In case the writer doesn't output to a file, this is where strings in
  *            ::query_writer::lines are allocated.
  * @var query_writer::lines
- *     @brief Lines of output of a query, only initialized if ::query_writer::stream is `NULL`.
+ *     @brief Lines of output of a query, only initialized if the writer doesn't output to a file.
+ * @var query_writer::window_first
+ *     @brief Index of the first line to be kept in ::query_writer::lines.
+ * @var query_writer::window_end
+ *     @brief Index of the line after the last line to be kept in ::query_writer::lines.
+ * @var query_writer::line_count
+ *     @brief Number of lines outputted when outputting to ::query_writer::lines, including the ones
+ *            outside of the window that ::query_writer::lines keeps.
  * @var query_writer::current_line
  *    @brief Current line being printed. Used for outputting non-formatted query results to strings.
  * @var query_writer::current_line_cursor
  *    @brief Position (in characters) where to start writing to ::query_writer::current_line.
+ * @var query_writer::measure_formatting
+ *    @brief Whether the time spent formatting objects and fields is measured.
+ * @var query_writer::formatting_time
+ *    @brief Nanoseconds spent formatting objects and fields, while
+ *           ::query_writer::measure_formatting is set.
+ * @var query_writer::incomplete
+ *    @brief Whether the query writing to this writer was stopped before it finished.
+ * @var query_writer::sink
+ *    @brief Callback that receives chunks of ::query_writer::buffer, for streaming writers (see
+ *           ::query_writer_create_streaming). `NULL` for other writers, and after the sink fails.
+ * @var query_writer::sink_data
+ *    @brief Argument passed to ::query_writer::sink.
+ * @var query_writer::discarding
+ *    @brief Whether output is being thrown away, because ::query_writer::sink failed.
+ * @var query_writer::compressor
+ *    @brief Compressor of ::query_writer::buffer before it's written, or `NULL` for no compression.
  */
 struct query_writer {
-    FILE *stream;
+    char *path;
+    int   fd;
 
-    int formatted;
+    char  *buffer;
+    size_t buffer_length, buffer_capacity;
+    int    finished;
+
+    int formatted, binary;
 
     int    is_first_field;
     size_t current_object;
 
     string_pool_t *strings;
     GPtrArray     *lines;
+    size_t         window_first, window_end, line_count;
 
     size_t current_line_cursor;
     char   current_line[LINE_MAX];
+
+    int      measure_formatting;
+    uint64_t formatting_time;
+
+    int incomplete;
+
+    query_writer_sink_t sink;
+    void               *sink_data;
+    int                 discarding;
+
+    query_output_compressor_t *compressor;
 };
 
 /** @brief Size of each pool block in ::query_writer::strings. */
 #define QUERY_WRITER_STRING_POOL_BLOCK_SIZE (1 << 17)
 
-query_writer_t *query_writer_create(const char *out_file_path, int formatted) {
+/** @brief Initial capacity of ::query_writer::buffer. */
+#define QUERY_WRITER_BUFFER_INITIAL_CAPACITY 4096
+
+/** @brief Space reserved in ::query_writer::buffer before trying to format a field's value. */
+#define QUERY_WRITER_FIELD_RESERVED_SPACE 64
+
+/**
+ * @brief Absolute value above which ::__query_writer_sprintf_fixed_3 gives up on formatting a
+ *        number. The rounding error analysis in that method assumes doubles up to this value.
+ */
+#define QUERY_WRITER_FIXED_3_MAX_VALUE 1e12
+
+/**
+ * @brief   Allocates and initializes a query writer, without setting up where it outputs to.
+ * @details Auxiliary method for ::query_writer_create and ::query_writer_create_deferred.
+ * @param   formatted Whether the output of the query should be formatted (pretty printed).
+ * @return  A new writer, or `NULL` on allocation failure.
+ */
+query_writer_t *__query_writer_create_empty(int formatted) {
     query_writer_t *const ret = malloc(sizeof(query_writer_t));
     if (!ret)
         return NULL;
 
+    ret->path            = NULL;
+    ret->fd              = -1;
+    ret->buffer          = NULL;
+    ret->buffer_length   = 0;
+    ret->buffer_capacity = 0;
+    ret->finished        = 0;
+
     ret->formatted           = formatted;
+    ret->binary              = 0;
     ret->is_first_field      = 1;
     ret->current_object      = 1;
+    ret->strings             = NULL;
+    ret->lines               = NULL;
+    ret->window_first        = 0;
+    ret->window_end          = SIZE_MAX;
+    ret->line_count          = 0;
     ret->current_line_cursor = 0;
+    ret->measure_formatting  = 0;
+    ret->formatting_time     = 0;
+    ret->incomplete          = 0;
+    ret->sink                = NULL;
+    ret->sink_data           = NULL;
+    ret->discarding          = 0;
+    ret->compressor          = NULL;
+    return ret;
+}
+
+/**
+ * @brief   Starts outputting a query writer's results to a list of strings.
+ * @details Auxiliary method for ::query_writer_create and ::query_writer_create_window.
+ * @param   writer Writer that doesn't output anywhere yet.
+ * @retval  0 Success.
+ * @retval  1 Allocation failure.
+ */
+int __query_writer_init_lines(query_writer_t *writer) {
+    writer->strings = string_pool_create(QUERY_WRITER_STRING_POOL_BLOCK_SIZE);
+    if (!writer->strings)
+        return 1;
+
+    writer->lines = g_ptr_array_new();
+    return 0;
+}
+
+query_writer_t *query_writer_create(const char *out_file_path, int formatted) {
+    query_writer_t *const ret = __query_writer_create_empty(formatted);
+    if (!ret)
+        return NULL;
 
     if (out_file_path) {
-        ret->stream = fopen(out_file_path, "w");
-        if (!ret->stream) {
+        ret->fd = open(out_file_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (ret->fd < 0) {
             free(ret);
             return NULL;
         }
+    } else if (__query_writer_init_lines(ret)) {
+        free(ret);
+        return NULL;
+    }
+
+    return ret;
+}
+
+query_writer_t *query_writer_create_window(int formatted, size_t first, size_t count) {
+    query_writer_t *const ret = __query_writer_create_empty(formatted);
+    if (!ret)
+        return NULL;
+
+    if (__query_writer_init_lines(ret)) {
+        free(ret);
+        return NULL;
+    }
+
+    query_writer_set_window(ret, first, count);
+    return ret;
+}
+
+query_writer_t *query_writer_create_deferred(const char *out_file_path, int formatted) {
+    query_writer_t *const ret = __query_writer_create_empty(formatted);
+    if (!ret)
+        return NULL;
+
+    ret->path = strdup(out_file_path);
+    if (!ret->path) {
+        free(ret);
+        return NULL;
+    }
+    return ret;
+}
+
+query_writer_t *query_writer_create_buffered(int formatted) {
+    return __query_writer_create_empty(formatted);
+}
+
+query_writer_t *query_writer_create_streaming(int                 formatted,
+                                              query_writer_sink_t sink,
+                                              void               *user_data) {
+    query_writer_t *const ret = __query_writer_create_empty(formatted);
+    if (ret) {
+        ret->sink      = sink;
+        ret->sink_data = user_data;
+    }
+    return ret;
+}
+
+query_writer_t *query_writer_create_binary(void) {
+    query_writer_t *const ret = __query_writer_create_empty(0);
+    if (ret)
+        ret->binary = 1;
+    return ret;
+}
+
+int query_writer_is_binary(const query_writer_t *writer) {
+    return writer->binary;
+}
+
+/**
+ * @brief   Tells whether a query writer outputs to a file.
+ * @details Auxiliary method for other query writer methods.
+ */
+int __query_writer_is_file(const query_writer_t *writer) {
+    return writer->lines == NULL;
+}
+
+/**
+ * @brief   Tells whether the next line outputted to ::query_writer::lines is going to be kept.
+ * @details Lines outside of the writer's window don't need to be formatted.
+ */
+int __query_writer_is_line_in_window(const query_writer_t *writer) {
+    return writer->line_count >= writer->window_first && writer->line_count < writer->window_end;
+}
+
+/**
+ * @brief Outputs a line to ::query_writer::lines, if it's in the writer's window.
+ *
+ * @param writer Writer that outputs to a list of strings.
+ * @param line   Line to be outputted. Ignored (and can be `NULL`) if outside of the window.
+ */
+void __query_writer_add_line(query_writer_t *writer, const char *line) {
+    if (__query_writer_is_line_in_window(writer))
+        g_ptr_array_add(writer->lines, string_pool_put(writer->strings, line));
+    writer->line_count++;
+}
+
+/**
+ * @brief Outputs ::query_writer::current_line to ::query_writer::lines, for non-formatted output.
+ * @param writer Writer that outputs to a list of strings.
+ */
+void __query_writer_flush_current_line(query_writer_t *writer) {
+    if (writer->current_line_cursor < LINE_MAX)
+        writer->current_line[writer->current_line_cursor] = '\0';
+
+    __query_writer_add_line(writer, writer->current_line);
+    writer->current_line_cursor = 0;
+}
 
-        ret->strings = NULL;
-        ret->lines   = NULL;
+/**
+ * @brief Makes sure there's space for some more characters in ::query_writer::buffer.
+ *
+ * @param writer Writer to output to a file.
+ * @param n      Number of characters that will be written (a null terminator is also accounted
+ *               for).
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __query_writer_reserve(query_writer_t *writer, size_t n) {
+    if (writer->buffer_length + n + 1 <= writer->buffer_capacity)
+        return 0;
+
+    size_t new_capacity =
+        writer->buffer_capacity ? writer->buffer_capacity : QUERY_WRITER_BUFFER_INITIAL_CAPACITY;
+    while (new_capacity < writer->buffer_length + n + 1)
+        new_capacity *= 2;
+
+    char *const new_buffer = realloc(writer->buffer, new_capacity);
+    if (!new_buffer)
+        return 1;
+
+    writer->buffer          = new_buffer;
+    writer->buffer_capacity = new_capacity;
+    return 0;
+}
+
+/**
+ * @brief Appends characters to ::query_writer::buffer. Nothing is appended on allocation failure.
+ *
+ * @param writer Writer to output to a file.
+ * @param str    Characters to be appended.
+ * @param length Number of characters in @p str.
+ */
+void __query_writer_append(query_writer_t *writer, const char *str, size_t length) {
+    if (__query_writer_reserve(writer, length))
+        return;
+
+    memcpy(writer->buffer + writer->buffer_length, str, length);
+    writer->buffer_length += length;
+}
+
+/**
+ * @brief   Prints a number with three decimal places, like `sprintf(output, "%.3f", value)`.
+ * @details Rounding is done on the exact (binary) value of @p value, to the nearest number with
+ *          three decimal places, with ties to even, so that the output is the same as `printf`'s.
+ *          The error in multiplying @p value by `1000` is recovered with `fma`.
+ *
+ * @param output Where to write the number to. Must be at least
+ *               `INT_UTILS_SPRINTF_MIN_BUFFER_SIZE + 2` characters long.
+ * @param value  Number to be printed.
+ * @param length Where to write the number of characters written to @p output to.
+ *
+ * @retval 0 Success.
+ * @retval 1 @p value is not supported (infinite, NaN or too large), and nothing was written.
+ */
+int __query_writer_sprintf_fixed_3(char *output, double value, size_t *length) {
+    const double absolute = fabs(value);
+    if (!(absolute < QUERY_WRITER_FIXED_3_MAX_VALUE))
+        return 1;
+
+    const double product = absolute * 1000.0;
+    const double error   = fma(absolute, 1000.0, -product); /* Exact: product + error */
+    const double floored = floor(product);
+
+    /*
+     * Sign of (exact fractional part - 0.5). When the fractional part is at least 0.25,
+     * (product - floored - 0.5) is exact, so the sign of the sum is exact. Otherwise, the error is
+     * small enough not to make the sum positive.
+     */
+    const double distance = (product - floored - 0.5) + error;
+    uint64_t     rounded  = (uint64_t) floored;
+    if (distance > 0 || (!(distance < 0) && (rounded & 1))) /* Ties to even */
+        rounded++;
+
+    char *const start = output;
+    if (signbit(value))
+        *(output++) = '-';
+
+    output += int_utils_sprintf_unsigned(output, rounded / 1000);
+    *(output++) = '.';
+    output += int_utils_sprintf_padded(output, rounded % 1000, 3);
+
+    *length = (size_t) (output - start);
+    return 0;
+}
+
+/**
+ * @brief   Formats a field's value, like `vsnprintf`.
+ * @details The most common format strings (a single string, integer or number with three decimal
+ *          places) are formatted without `vsnprintf`, which is much faster.
+ *
+ * @param output Where to write the formatted value to.
+ * @param size   Number of characters that can be written to @p output (including the null
+ *               terminator).
+ * @param format `printf` format string.
+ * @param args   Arguments to be formatted.
+ *
+ * @return The number of characters that would've been written if @p size was large enough (not
+ *         including the null terminator).
+ */
+size_t __query_writer_vformat(char *output, size_t size, const char *format, va_list args) {
+    char   number[INT_UTILS_SPRINTF_MIN_BUFFER_SIZE + 2];
+    size_t length;
+
+    if (strcmp(format, "%s") == 0) {
+        const char *const str = va_arg(args, const char *);
+        length                = strlen(str);
+        if (length < size) {
+            memcpy(output, str, length + 1);
+        } else if (size) {
+            memcpy(output, str, size - 1);
+            output[size - 1] = '\0';
+        }
+        return length;
+    } else if (strcmp(format, "%d") == 0 || strcmp(format, "%i") == 0) {
+        length = int_utils_sprintf_signed(number, va_arg(args, int));
+    } else if (strcmp(format, "%u") == 0) {
+        length = int_utils_sprintf_unsigned(number, va_arg(args, unsigned int));
+    } else if (strcmp(format, "%ld") == 0 || strcmp(format, "%li") == 0) {
+        length = int_utils_sprintf_signed(number, va_arg(args, long));
+    } else if (strcmp(format, "%lu") == 0) {
+        length = int_utils_sprintf_unsigned(number, va_arg(args, unsigned long));
+    } else if (strcmp(format, "%zu") == 0) {
+        length = int_utils_sprintf_unsigned(number, va_arg(args, size_t));
+    } else if (strcmp(format, "%.3f") == 0 || strcmp(format, "%.3lf") == 0) {
+        const double value = va_arg(args, double);
+        if (__query_writer_sprintf_fixed_3(number, value, &length))
+            return snprintf(output, size, "%.3f", value);
     } else {
-        ret->stream  = NULL;
-        ret->strings = string_pool_create(QUERY_WRITER_STRING_POOL_BLOCK_SIZE);
-        if (!ret->strings) {
-            free(ret);
-            return NULL;
+        return vsnprintf(output, size, format, args);
+    }
+
+    if (length < size) {
+        memcpy(output, number, length + 1);
+    } else if (size) {
+        memcpy(output, number, size - 1);
+        output[size - 1] = '\0';
+    }
+    return length;
+}
+
+/**
+ * @brief Formats a field's value and appends it to ::query_writer::buffer.
+ *
+ * @param writer Writer to output to a file.
+ * @param format `printf` format string.
+ * @param args   Arguments to be formatted.
+ */
+void __query_writer_append_formatted(query_writer_t *writer, const char *format, va_list args) {
+    if (__query_writer_reserve(writer, QUERY_WRITER_FIELD_RESERVED_SPACE))
+        return;
+
+    va_list args_copy;
+    va_copy(args_copy, args);
+
+    const size_t available = writer->buffer_capacity - writer->buffer_length;
+    const size_t length =
+        __query_writer_vformat(writer->buffer + writer->buffer_length, available, format, args);
+
+    if (length >= available) { /* Didn't fit. Try again with enough space */
+        if (__query_writer_reserve(writer, length)) {
+            va_end(args_copy);
+            return;
         }
-        ret->lines = g_ptr_array_new();
+
+        __query_writer_vformat(writer->buffer + writer->buffer_length,
+                               writer->buffer_capacity - writer->buffer_length,
+                               format,
+                               args_copy);
     }
 
-    return ret;
+    writer->buffer_length += length;
+    va_end(args_copy);
+}
+
+/**
+ * @brief Appends a tag and an integer value (in little-endian) to ::query_writer::buffer.
+ *
+ * @param writer Binary writer.
+ * @param tag    Tag to be appended.
+ * @param value  Value of the tag.
+ * @param size   Number of bytes of @p value to be appended.
+ */
+void __query_writer_append_tagged(query_writer_t           *writer,
+                                  query_writer_binary_tag_t tag,
+                                  uint64_t                  value,
+                                  size_t                    size) {
+    if (__query_writer_reserve(writer, 1 + size))
+        return;
+
+    uint8_t *const out = (uint8_t *) writer->buffer + writer->buffer_length;
+    out[0]             = tag;
+    for (size_t i = 0; i < size; ++i)
+        out[1 + i] = (uint8_t) (value >> (8 * i));
+    writer->buffer_length += 1 + size;
+}
+
+/**
+ * @brief Appends a string to ::query_writer::buffer, as a ::QUERY_WRITER_BINARY_STRING.
+ *
+ * @param writer Binary writer.
+ * @param str    String to be appended.
+ * @param length Number of characters in @p str.
+ */
+void __query_writer_append_binary_string(query_writer_t *writer, const char *str, size_t length) {
+    __query_writer_append_tagged(writer, QUERY_WRITER_BINARY_STRING, length, sizeof(uint32_t));
+    __query_writer_append(writer, str, length);
+}
+
+/**
+ * @brief   Encodes a field's value and appends it to ::query_writer::buffer.
+ * @details The value's type is inferred from @p format (see ::query_writer_create_binary).
+ *
+ * @param writer Binary writer.
+ * @param format `printf` format string.
+ * @param args   Arguments to be encoded.
+ */
+void __query_writer_append_binary(query_writer_t *writer, const char *format, va_list args) {
+    if (strcmp(format, "%s") == 0) {
+        const char *const str = va_arg(args, const char *);
+        __query_writer_append_binary_string(writer, str, strlen(str));
+        return;
+    }
+
+    query_writer_binary_tag_t tag = QUERY_WRITER_BINARY_SIGNED;
+    uint64_t                  value;
+    if (strcmp(format, "%d") == 0 || strcmp(format, "%i") == 0) {
+        value = (uint64_t) (int64_t) va_arg(args, int);
+    } else if (strcmp(format, "%ld") == 0 || strcmp(format, "%li") == 0) {
+        value = (uint64_t) (int64_t) va_arg(args, long);
+    } else if (strcmp(format, "%lld") == 0 || strcmp(format, "%lli") == 0) {
+        value = (uint64_t) (int64_t) va_arg(args, long long);
+    } else if (strcmp(format, "%u") == 0) {
+        tag   = QUERY_WRITER_BINARY_UNSIGNED;
+        value = va_arg(args, unsigned int);
+    } else if (strcmp(format, "%lu") == 0) {
+        tag   = QUERY_WRITER_BINARY_UNSIGNED;
+        value = va_arg(args, unsigned long);
+    } else if (strcmp(format, "%llu") == 0) {
+        tag   = QUERY_WRITER_BINARY_UNSIGNED;
+        value = va_arg(args, unsigned long long);
+    } else if (strcmp(format, "%zu") == 0) {
+        tag   = QUERY_WRITER_BINARY_UNSIGNED;
+        value = va_arg(args, size_t);
+    } else if (strcmp(format, "%.3f") == 0 || strcmp(format, "%.3lf") == 0) {
+        const double number = va_arg(args, double);
+        tag                 = QUERY_WRITER_BINARY_NUMBER;
+        memcpy(&value, &number, sizeof(double));
+    } else {
+        char         text[LINE_MAX];
+        const size_t length = vsnprintf(text, LINE_MAX, format, args);
+        __query_writer_append_binary_string(writer, text, min(length, (size_t) LINE_MAX - 1));
+        return;
+    }
+
+    __query_writer_append_tagged(writer, tag, value, sizeof(uint64_t));
+}
+
+/**
+ * @brief   Starts measuring the time spent formatting an object or a field.
+ * @details Auxiliary method for ::query_writer_write_new_object and ::query_writer_write_new_field.
+ *
+ * @param writer Writer whose formatting may be measured.
+ * @param start  Where to write the current time to, if @p writer measures formatting.
+ */
+void __query_writer_start_measuring(const query_writer_t *writer, struct timespec *start) {
+    if (writer->measure_formatting)
+        clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+/**
+ * @brief   Stops measuring the time spent formatting an object or a field.
+ * @details Auxiliary method for ::query_writer_write_new_object and ::query_writer_write_new_field.
+ *
+ * @param writer Writer whose formatting may be measured.
+ * @param start  Value set by ::__query_writer_start_measuring.
+ */
+void __query_writer_stop_measuring(query_writer_t *writer, const struct timespec *start) {
+    if (!writer->measure_formatting)
+        return;
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    writer->formatting_time +=
+        (uint64_t) (end.tv_sec - start->tv_sec) * 1000000000 + (end.tv_nsec - start->tv_nsec);
+}
+
+/**
+ * @brief   Hands the buffered output of a streaming writer to its sink, if there's enough of it.
+ * @details Auxiliary method for ::query_writer_write_new_object, called between objects.
+ * @param   writer Streaming writer.
+ */
+void __query_writer_stream(query_writer_t *writer) {
+    if (writer->discarding) {
+        writer->buffer_length = 0;
+    } else if (writer->buffer_length >= QUERY_WRITER_STREAM_CHUNK_SIZE) {
+        if (writer->sink(writer->sink_data, writer->buffer, writer->buffer_length)) {
+            writer->discarding = 1;
+            writer->incomplete = 1;
+        }
+        writer->buffer_length = 0;
+    }
 }
 
 void query_writer_write_new_object(query_writer_t *writer) {
-    if (writer->stream) {
+    struct timespec start;
+    __query_writer_start_measuring(writer, &start);
+
+    if (writer->sink)
+        __query_writer_stream(writer);
+
+    if (writer->binary) {
+        __query_writer_append_tagged(writer, QUERY_WRITER_BINARY_OBJECT, 0, 0);
+    } else if (__query_writer_is_file(writer)) {
         /* Spacing after last item (don't add spacing to the beginning of the file) */
         if (writer->current_object != 1)
-            fputc('\n', writer->stream);
+            __query_writer_append(writer, "\n", 1);
 
         /* Print object number for formatted output */
-        if (writer->formatted)
-            fprintf(writer->stream, "--- %zu ---\n", writer->current_object);
+        if (writer->formatted) {
+            char         line[INT_UTILS_SPRINTF_MIN_BUFFER_SIZE + 9];
+            const size_t number_length =
+                int_utils_sprintf_unsigned(line + 4, writer->current_object);
+            memcpy(line, "--- ", 4);
+            memcpy(line + 4 + number_length, " ---\n", 5);
+            __query_writer_append(writer, line, number_length + 9);
+        }
     } else {
         if (writer->current_object != 1) {
             if (writer->formatted) {
                 /* Spacing after last item (don't add spacing to the beginning of the file) */
-                g_ptr_array_add(writer->lines, string_pool_put(writer->strings, ""));
+                __query_writer_add_line(writer, "");
             } else {
                 /* Flush last time (it's invalid for the first object) */
-                g_ptr_array_add(writer->lines,
-                                string_pool_put(writer->strings, writer->current_line));
-                writer->current_line_cursor = 0;
+                __query_writer_flush_current_line(writer);
             }
         }
 
         /* Print object number for formatted output */
         if (writer->formatted) {
             char line[LINE_MAX];
-            snprintf(line, LINE_MAX, "--- %zu ---", writer->current_object);
-            g_ptr_array_add(writer->lines, string_pool_put(writer->strings, line));
+            if (__query_writer_is_line_in_window(writer))
+                snprintf(line, LINE_MAX, "--- %zu ---", writer->current_object);
+            __query_writer_add_line(writer, line);
         }
     }
 
     writer->current_object++;
     writer->is_first_field = 1;
+    __query_writer_stop_measuring(writer, &start);
 }
 
 void query_writer_write_new_field(query_writer_t *writer,
                                   const char     *key,
                                   const char     *format,
                                   ...) {
+    struct timespec start;
+    __query_writer_start_measuring(writer, &start);
+
     va_list printf_args;
     va_start(printf_args, format);
 
-    if (writer->stream) {
-
+    if (writer->binary) {
+        __query_writer_append_binary(writer, format, printf_args);
+    } else if (__query_writer_is_file(writer)) {
         if (writer->formatted) {
             /* Print line "key: value" */
-            fprintf(writer->stream, "%s: ", key);
-            vfprintf(writer->stream, format, printf_args);
-            fputc('\n', writer->stream);
+            __query_writer_append(writer, key, strlen(key));
+            __query_writer_append(writer, ": ", 2);
+            __query_writer_append_formatted(writer, format, printf_args);
+            __query_writer_append(writer, "\n", 1);
         } else {
             /* Print only values, adding semicolons between them */
-            if (!writer->is_first_field) {
-                fputc(';', writer->stream);
-            }
-            vfprintf(writer->stream, format, printf_args);
+            if (!writer->is_first_field)
+                __query_writer_append(writer, ";", 1);
+            __query_writer_append_formatted(writer, format, printf_args);
             writer->is_first_field = 0;
         }
     } else {
         if (writer->formatted) {
             /* Print line "key: value" */
-            char         line[LINE_MAX];
-            const size_t len = snprintf(line, LINE_MAX, "%s: ", key);
-            vsnprintf(line + len, LINE_MAX - len, format, printf_args);
-            g_ptr_array_add(writer->lines, string_pool_put(writer->strings, line));
+            char line[LINE_MAX];
+            if (__query_writer_is_line_in_window(writer)) {
+                const size_t len = snprintf(line, LINE_MAX, "%s: ", key);
+                __query_writer_vformat(line + len, LINE_MAX - len, format, printf_args);
+            }
+            __query_writer_add_line(writer, line);
+        } else if (!__query_writer_is_line_in_window(writer)) {
+            writer->is_first_field = 0; /* Don't format lines that won't be kept */
         } else {
             /*
              * Print only values, adding semicolons between them. This is done to
@@ -176,39 +715,270 @@ void query_writer_write_new_field(query_writer_t *writer,
                 writer->current_line[writer->current_line_cursor++] = ';';
 
             writer->current_line_cursor +=
-                vsnprintf(writer->current_line + writer->current_line_cursor,
-                          LINE_MAX - writer->current_line_cursor,
-                          format,
-                          printf_args);
+                __query_writer_vformat(writer->current_line + writer->current_line_cursor,
+                                       LINE_MAX - writer->current_line_cursor,
+                                       format,
+                                       printf_args);
             writer->is_first_field = 0;
         }
     }
 
     va_end(printf_args);
+    __query_writer_stop_measuring(writer, &start);
+}
+
+void query_writer_write_rendered(query_writer_t *writer,
+                                 const char     *output,
+                                 size_t          length,
+                                 size_t          objects) {
+    struct timespec start;
+    __query_writer_start_measuring(writer, &start);
+
+    if (__query_writer_is_file(writer)) {
+        __query_writer_append(writer, output, length);
+    } else {
+        /* Every line of output, including the last one, is terminated */
+        const char *const end = output + length;
+        while (output < end) {
+            const char *const line_end = memchr(output, '\n', end - output);
+            const size_t      line_length =
+                min((size_t) ((line_end ? line_end : end) - output), (size_t) LINE_MAX - 1);
+
+            if (__query_writer_is_line_in_window(writer)) {
+                memcpy(writer->current_line, output, line_length);
+                writer->current_line[line_length] = '\0';
+            }
+            __query_writer_add_line(writer, writer->current_line);
+            output = line_end ? line_end + 1 : end;
+        }
+    }
+
+    writer->finished       = 1;
+    writer->current_object = objects + 1;
+    writer->is_first_field = 1;
+    __query_writer_stop_measuring(writer, &start);
 }
 
 const char *const *query_writer_get_lines(query_writer_t *writer, size_t *out_n) {
-    if (writer->stream)
+    if (__query_writer_is_file(writer))
         return NULL;
 
     /* Flush last line when printing to a set of strings */
-    if (writer->current_line_cursor != 0) {
-        writer->current_line_cursor = 0;
-        g_ptr_array_add(writer->lines, string_pool_put(writer->strings, writer->current_line));
+    if (!writer->formatted && !writer->is_first_field) {
+        __query_writer_flush_current_line(writer);
+        writer->is_first_field = 1;
     }
 
     *out_n = writer->lines->len;
     return (const char *const *) writer->lines->pdata;
 }
 
-void query_writer_free(query_writer_t *writer) {
-    /* Flush missing last line before closing file */
-    if (!writer->formatted && writer->stream &&
+size_t query_writer_get_line_count(query_writer_t *writer) {
+    if (__query_writer_is_file(writer))
+        return 0;
+
+    size_t nlines;
+    query_writer_get_lines(writer, &nlines); /* Flush last line */
+    return writer->line_count;
+}
+
+size_t query_writer_get_object_count(const query_writer_t *writer) {
+    return writer->current_object - 1;
+}
+
+void query_writer_set_incomplete(query_writer_t *writer) {
+    writer->incomplete = 1;
+}
+
+int query_writer_is_incomplete(const query_writer_t *writer) {
+    return writer->incomplete;
+}
+
+size_t query_writer_get_output_size(query_writer_t *writer) {
+    if (__query_writer_is_file(writer))
+        return writer->buffer_length;
+
+    size_t             nlines, size = 0;
+    const char *const *lines = query_writer_get_lines(writer, &nlines);
+    for (size_t i = 0; i < nlines; ++i)
+        size += strlen(lines[i]) + 1;
+    return size;
+}
+
+void query_writer_set_measure_formatting(query_writer_t *writer, int measure) {
+    writer->measure_formatting = measure;
+}
+
+uint64_t query_writer_get_formatting_time(const query_writer_t *writer) {
+    return writer->formatting_time;
+}
+
+/**
+ * @brief   Terminates the last line of ::query_writer::buffer, if that hasn't been done yet.
+ * @details Auxiliary method for ::query_writer_get_output and ::query_writer_free.
+ * @param   writer Writer to output to a file (or buffered writer).
+ */
+void __query_writer_finish(query_writer_t *writer) {
+    if (writer->finished)
+        return;
+
+    /* Flush missing last line */
+    if (!writer->formatted && !writer->binary &&
         !(writer->is_first_field && writer->current_object == 1))
-        fputc('\n', writer->stream);
+        __query_writer_append(writer, "\n", 1);
+    writer->finished = 1;
+}
+
+const char *query_writer_get_output(query_writer_t *writer, size_t *length) {
+    if (!__query_writer_is_file(writer))
+        return NULL;
+
+    __query_writer_finish(writer);
+    *length = writer->buffer_length;
+    return writer->buffer ? writer->buffer : "";
+}
+
+void query_writer_reset(query_writer_t *writer, int formatted) {
+    if (__query_writer_is_file(writer)) {
+        if (writer->buffer_capacity > QUERY_WRITER_RESET_MAX_CAPACITY) {
+            free(writer->buffer);
+            writer->buffer          = NULL;
+            writer->buffer_capacity = 0;
+        }
+        writer->buffer_length = 0;
+        writer->finished      = 0;
+    } else {
+        string_pool_empty(writer->strings);
+        g_ptr_array_set_size(writer->lines, 0);
+    }
+
+    writer->formatted           = formatted;
+    writer->is_first_field      = 1;
+    writer->current_object      = 1;
+    writer->line_count          = 0;
+    writer->current_line_cursor = 0;
+    writer->formatting_time     = 0;
+    writer->incomplete          = 0;
+    writer->discarding          = 0;
+}
+
+void query_writer_set_window(query_writer_t *writer, size_t first, size_t count) {
+    writer->window_first = first;
+    writer->window_end   = count > SIZE_MAX - first ? SIZE_MAX : first + count;
+}
+
+void query_writer_set_compressor(query_writer_t *writer, query_output_compressor_t *compressor) {
+    writer->compressor = compressor;
+}
+
+/**
+ * @brief   Replaces ::query_writer::buffer with its compressed contents, if the writer has a
+ *          compressor (see ::query_writer_set_compressor).
+ * @details Auxiliary method for ::__query_writer_flush and ::query_writer_flush_async. The buffer
+ *          is kept as it is if compression fails.
+ * @param   writer Writer to output to a file, whose output is finished.
+ */
+void __query_writer_compress(query_writer_t *writer) {
+    if (!writer->compressor)
+        return;
+
+    char  *compressed;
+    size_t compressed_length;
+    if (query_output_compressor_compress(writer->compressor,
+                                         writer->buffer ? writer->buffer : "",
+                                         writer->buffer_length,
+                                         &compressed,
+                                         &compressed_length))
+        return;
+
+    free(writer->buffer);
+    writer->buffer          = compressed;
+    writer->buffer_length   = compressed_length;
+    writer->buffer_capacity = compressed_length;
+    writer->compressor      = NULL; /* Not to compress it twice */
+}
+
+/**
+ * @brief   Writes the contents of ::query_writer::buffer to the output file.
+ * @details The file is created first, if its creation was deferred. Auxiliary method for
+ *          ::query_writer_flush and ::query_writer_free.
+ * @param   writer Writer to output to a file.
+ */
+void __query_writer_flush(query_writer_t *writer) {
+    if (writer->fd < 0) {
+        if (!writer->path) /* Buffered writer */
+            return;
+
+        writer->fd = open(writer->path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (writer->fd < 0)
+            return;
+    }
+
+    __query_writer_compress(writer);
+    size_t written = 0;
+    while (written < writer->buffer_length) {
+        const ssize_t retval =
+            write(writer->fd, writer->buffer + written, writer->buffer_length - written);
+
+        if (retval < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        written += (size_t) retval;
+    }
+    performance_probe1(writer_flush, writer->buffer_length);
+}
+
+void query_writer_flush(query_writer_t *writer) {
+    if (!__query_writer_is_file(writer))
+        return;
+
+    __query_writer_finish(writer);
+    __query_writer_flush(writer);
+    if (writer->fd >= 0)
+        close(writer->fd);
+
+    /* Leave an empty writer behind, that writes nothing when freed */
+    free(writer->path);
+    free(writer->buffer);
+    writer->path            = NULL;
+    writer->fd              = -1;
+    writer->buffer          = NULL;
+    writer->buffer_length   = 0;
+    writer->buffer_capacity = 0;
+}
+
+int query_writer_flush_async(query_writer_t *writer, async_file_writer_t *files) {
+    if (!__query_writer_is_file(writer) || !writer->path || writer->fd >= 0) {
+        query_writer_flush(writer);
+        return 0;
+    }
+
+    __query_writer_finish(writer);
+    __query_writer_compress(writer);
+    performance_probe1(writer_flush, writer->buffer_length);
+    const int retval =
+        async_file_writer_write(files, writer->path, writer->buffer, writer->buffer_length);
+
+    /* Leave an empty writer behind, that writes nothing when freed */
+    free(writer->path);
+    writer->path            = NULL;
+    writer->buffer          = NULL; /* Now owned by files */
+    writer->buffer_length   = 0;
+    writer->buffer_capacity = 0;
+    return retval;
+}
+
+void query_writer_free(query_writer_t *writer) {
+    if (__query_writer_is_file(writer)) {
+        __query_writer_finish(writer); /* Before closing the file */
+        __query_writer_flush(writer);
+        if (writer->fd >= 0)
+            close(writer->fd);
 
-    if (writer->stream) {
-        fclose(writer->stream);
+        free(writer->path);
+        free(writer->buffer);
     } else {
         string_pool_free(writer->strings);
         g_ptr_array_unref(writer->lines);
@@ -0,0 +1,344 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  server_metrics.c
+ * @brief Implementation of methods in include/server_metrics.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref server_metrics_examples).
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "queries/query_type_list.h"
+#include "server_metrics.h"
+
+/** @brief Number of finite buckets in a histogram of ::server_metrics_t. */
+#define SERVER_METRICS_BUCKET_COUNT 16
+
+/** @brief Upper bounds of the buckets of all histograms of ::server_metrics_t, in microseconds. */
+const uint64_t server_metrics_bucket_bounds[SERVER_METRICS_BUCKET_COUNT] = {
+    100,    250,    500,    1000,    2500,    5000,    10000,   25000,
+    50000,  100000, 250000, 500000,  1000000, 2500000, 5000000, 10000000};
+
+/**
+ * @struct server_metrics_histogram_t
+ * @brief  Distribution of durations.
+ *
+ * @var server_metrics_histogram_t::count
+ *     @brief Number of measurements.
+ * @var server_metrics_histogram_t::sum
+ *     @brief Sum of all measurements, in microseconds.
+ * @var server_metrics_histogram_t::buckets
+ *     @brief Number of measurements in each bucket (not cumulative). The last bucket contains the
+ *            measurements above all bounds in ::server_metrics_bucket_bounds.
+ */
+typedef struct {
+    uint64_t count, sum;
+    uint64_t buckets[SERVER_METRICS_BUCKET_COUNT + 1];
+} server_metrics_histogram_t;
+
+/**
+ * @struct server_metrics
+ * @brief  Live metrics of the query server. All fields are accessed atomically.
+ *
+ * @var server_metrics::requests
+ *     @brief Durations of the queries run, for each query type (from `1`).
+ * @var server_metrics::other_requests
+ *     @brief Number of requests of each ::server_metrics_request_t.
+ * @var server_metrics::batches
+ *     @brief Number of batches of queries run.
+ * @var server_metrics::batched_queries
+ *     @brief Number of queries in all batches run.
+ * @var server_metrics::load_duration
+ *     @brief Duration of the first load of the dataset, in microseconds.
+ * @var server_metrics::reloads
+ *     @brief Number of failed (index `0`) and successful (index `1`) reloads of the dataset.
+ * @var server_metrics::last_reload_duration
+ *     @brief Duration of the last reload of the dataset, in microseconds.
+ * @var server_metrics::activations
+ *     @brief Number of failed (index `0`) and successful (index `1`) restores of evicted datasets.
+ * @var server_metrics::evictions
+ *     @brief Number of datasets evicted from memory.
+ * @var server_metrics::resident_datasets
+ *     @brief Number of datasets in memory.
+ */
+struct server_metrics {
+    server_metrics_histogram_t requests[QUERY_TYPE_LIST_COUNT];
+    uint64_t                   other_requests[SERVER_METRICS_REQUEST_COUNT];
+    uint64_t                   batches, batched_queries;
+    uint64_t                   load_duration;
+    uint64_t                   reloads[2];
+    uint64_t                   last_reload_duration;
+    uint64_t                   activations[2];
+    uint64_t                   evictions;
+    uint64_t                   resident_datasets;
+};
+
+server_metrics_t *server_metrics_create(void) {
+    return calloc(1, sizeof(server_metrics_t));
+}
+
+void server_metrics_count_request(server_metrics_t *metrics, size_t type, uint64_t duration) {
+    if (type < 1 || type > QUERY_TYPE_LIST_COUNT)
+        return;
+
+    size_t bucket = 0;
+    while (bucket < SERVER_METRICS_BUCKET_COUNT && duration > server_metrics_bucket_bounds[bucket])
+        bucket++;
+
+    server_metrics_histogram_t *const histogram = &metrics->requests[type - 1];
+    __atomic_fetch_add(&histogram->buckets[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->sum, duration, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->count, 1, __ATOMIC_RELAXED);
+}
+
+void server_metrics_count_other_request(server_metrics_t        *metrics,
+                                        server_metrics_request_t request) {
+    __atomic_fetch_add(&metrics->other_requests[request], 1, __ATOMIC_RELAXED);
+}
+
+void server_metrics_count_batch(server_metrics_t *metrics, size_t nqueries) {
+    __atomic_fetch_add(&metrics->batches, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&metrics->batched_queries, nqueries, __ATOMIC_RELAXED);
+}
+
+void server_metrics_set_load_duration(server_metrics_t *metrics, uint64_t duration) {
+    __atomic_store_n(&metrics->load_duration, duration, __ATOMIC_RELAXED);
+}
+
+void server_metrics_count_reload(server_metrics_t *metrics, int success, uint64_t duration) {
+    __atomic_fetch_add(&metrics->reloads[success != 0], 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&metrics->last_reload_duration, duration, __ATOMIC_RELAXED);
+}
+
+void server_metrics_count_activation(server_metrics_t *metrics, int success) {
+    __atomic_fetch_add(&metrics->activations[success != 0], 1, __ATOMIC_RELAXED);
+}
+
+void server_metrics_count_eviction(server_metrics_t *metrics) {
+    __atomic_fetch_add(&metrics->evictions, 1, __ATOMIC_RELAXED);
+}
+
+void server_metrics_set_resident_datasets(server_metrics_t *metrics, size_t resident) {
+    __atomic_store_n(&metrics->resident_datasets, resident, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Writes a duration in seconds, with microsecond precision.
+ *
+ * @param out      Where to write the duration to.
+ * @param duration Duration in microseconds.
+ */
+void __server_metrics_print_seconds(FILE *out, uint64_t duration) {
+    fprintf(out, "%" PRIu64 ".%06" PRIu64, duration / 1000000, duration % 1000000);
+}
+
+/**
+ * @brief Writes a label value, escaping quotes, backslashes and new lines.
+ *
+ * @param out   Where to write the label value to.
+ * @param value Value of the label.
+ */
+void __server_metrics_print_label(FILE *out, const char *value) {
+    for (; *value; ++value) {
+        if (*value == '"' || *value == '\\')
+            fputc('\\', out);
+
+        if (*value == '\n')
+            fputs("\\n", out);
+        else
+            fputc(*value, out);
+    }
+}
+
+/**
+ * @brief Writes the histograms of request durations of all query types.
+ *
+ * @param out     Where to write the histograms to.
+ * @param metrics Metrics containing the histograms.
+ */
+void __server_metrics_print_requests(FILE *out, const server_metrics_t *metrics) {
+    const char *const other_names[SERVER_METRICS_REQUEST_COUNT] = {"prepare",
+                                                                   "protocol",
+                                                                   "invalid",
+                                                                   "rejected",
+                                                                   "timed_out"};
+
+    fputs("# HELP li3_requests_total Requests received, by query type.\n"
+          "# TYPE li3_requests_total counter\n",
+          out);
+    for (size_t type = 1; type <= QUERY_TYPE_LIST_COUNT; ++type)
+        fprintf(out,
+                "li3_requests_total{type=\"%zu\"} %" PRIu64 "\n",
+                type,
+                __atomic_load_n(&metrics->requests[type - 1].count, __ATOMIC_RELAXED));
+    for (size_t i = 0; i < SERVER_METRICS_REQUEST_COUNT; ++i)
+        fprintf(out,
+                "li3_requests_total{type=\"%s\"} %" PRIu64 "\n",
+                other_names[i],
+                __atomic_load_n(&metrics->other_requests[i], __ATOMIC_RELAXED));
+
+    fputs("# HELP li3_request_duration_seconds Time between receiving a query and queuing its "
+          "response.\n"
+          "# TYPE li3_request_duration_seconds histogram\n",
+          out);
+    for (size_t type = 1; type <= QUERY_TYPE_LIST_COUNT; ++type) {
+        const server_metrics_histogram_t *const histogram = &metrics->requests[type - 1];
+
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i <= SERVER_METRICS_BUCKET_COUNT; ++i) {
+            cumulative += __atomic_load_n(&histogram->buckets[i], __ATOMIC_RELAXED);
+
+            fprintf(out, "li3_request_duration_seconds_bucket{type=\"%zu\",le=\"", type);
+            if (i < SERVER_METRICS_BUCKET_COUNT)
+                __server_metrics_print_seconds(out, server_metrics_bucket_bounds[i]);
+            else
+                fputs("+Inf", out);
+            fprintf(out, "\"} %" PRIu64 "\n", cumulative);
+        }
+
+        fprintf(out, "li3_request_duration_seconds_sum{type=\"%zu\"} ", type);
+        __server_metrics_print_seconds(out, __atomic_load_n(&histogram->sum, __ATOMIC_RELAXED));
+        fprintf(out,
+                "\nli3_request_duration_seconds_count{type=\"%zu\"} %" PRIu64 "\n",
+                type,
+                cumulative);
+    }
+}
+
+/**
+ * @brief Writes the memory used by the process and by a database.
+ *
+ * @param out      Where to write the metrics to.
+ * @param database Database whose memory is measured. Can be `NULL`.
+ */
+void __server_metrics_print_memory(FILE *out, const database_t *database) {
+    unsigned long size, resident;
+    FILE *const   statm = fopen("/proc/self/statm", "r");
+    if (statm) {
+        if (fscanf(statm, "%lu %lu", &size, &resident) == 2)
+            fprintf(out,
+                    "# HELP li3_resident_memory_bytes Resident memory of the process.\n"
+                    "# TYPE li3_resident_memory_bytes gauge\n"
+                    "li3_resident_memory_bytes %lu\n",
+                    resident * (unsigned long) sysconf(_SC_PAGESIZE));
+        fclose(statm);
+    }
+
+    memory_report_t *const report = database ? database_get_memory_report(database) : NULL;
+    if (!report)
+        return;
+
+    fputs("# HELP li3_database_memory_bytes Memory of every data structure in the database.\n"
+          "# TYPE li3_database_memory_bytes gauge\n",
+          out);
+    for (size_t i = 0; i < memory_report_get_count(report); ++i) {
+        const memory_usage_t *const usage = memory_report_get_usage(report, i);
+
+        const char *const kinds[2]  = {"reserved", "used"};
+        const size_t      values[2] = {usage->reserved_bytes, usage->used_bytes};
+        for (size_t k = 0; k < 2; ++k) {
+            fputs("li3_database_memory_bytes{structure=\"", out);
+            __server_metrics_print_label(out, memory_report_get_name(report, i));
+            fprintf(out, "\",kind=\"%s\"} %zu\n", kinds[k], values[k]);
+        }
+    }
+    memory_report_free(report);
+}
+
+char *server_metrics_format(const server_metrics_t *metrics, const database_t *database) {
+    char  *text;
+    size_t length;
+    FILE  *out = open_memstream(&text, &length);
+    if (!out)
+        return NULL;
+
+    __server_metrics_print_requests(out, metrics);
+
+    fprintf(out,
+            "# HELP li3_batches_total Batches of queries run.\n"
+            "# TYPE li3_batches_total counter\n"
+            "li3_batches_total %" PRIu64 "\n"
+            "# HELP li3_batched_queries_total Queries run in all batches.\n"
+            "# TYPE li3_batched_queries_total counter\n"
+            "li3_batched_queries_total %" PRIu64 "\n",
+            __atomic_load_n(&metrics->batches, __ATOMIC_RELAXED),
+            __atomic_load_n(&metrics->batched_queries, __ATOMIC_RELAXED));
+
+    bloom_filter_statistics_t filters;
+    if (database && !database_get_id_filter_statistics(database, &filters))
+        fprintf(out,
+                "# HELP li3_id_filter_lookups_total Lookups in the database's identifier filters.\n"
+                "# TYPE li3_id_filter_lookups_total counter\n"
+                "li3_id_filter_lookups_total{result=\"rejected\"} %zu\n"
+                "li3_id_filter_lookups_total{result=\"passed\"} %zu\n"
+                "li3_id_filter_lookups_total{result=\"false_positive\"} %zu\n",
+                filters.rejected,
+                filters.passed,
+                filters.false_positives);
+
+    __server_metrics_print_memory(out, database);
+
+    fputs("# HELP li3_dataset_load_duration_seconds Duration of the first load of the dataset.\n"
+          "# TYPE li3_dataset_load_duration_seconds gauge\n"
+          "li3_dataset_load_duration_seconds ",
+          out);
+    __server_metrics_print_seconds(out, __atomic_load_n(&metrics->load_duration, __ATOMIC_RELAXED));
+    fprintf(out,
+            "\n# HELP li3_dataset_reloads_total Reloads of the dataset.\n"
+            "# TYPE li3_dataset_reloads_total counter\n"
+            "li3_dataset_reloads_total{result=\"failure\"} %" PRIu64 "\n"
+            "li3_dataset_reloads_total{result=\"success\"} %" PRIu64 "\n"
+            "# HELP li3_dataset_last_reload_duration_seconds Duration of the last reload.\n"
+            "# TYPE li3_dataset_last_reload_duration_seconds gauge\n"
+            "li3_dataset_last_reload_duration_seconds ",
+            __atomic_load_n(&metrics->reloads[0], __ATOMIC_RELAXED),
+            __atomic_load_n(&metrics->reloads[1], __ATOMIC_RELAXED));
+    __server_metrics_print_seconds(out,
+                                   __atomic_load_n(&metrics->last_reload_duration,
+                                                   __ATOMIC_RELAXED));
+    fprintf(out,
+            "\n# HELP li3_resident_datasets Datasets kept in memory.\n"
+            "# TYPE li3_resident_datasets gauge\n"
+            "li3_resident_datasets %" PRIu64 "\n"
+            "# HELP li3_dataset_activations_total Restores of evicted datasets.\n"
+            "# TYPE li3_dataset_activations_total counter\n"
+            "li3_dataset_activations_total{result=\"failure\"} %" PRIu64 "\n"
+            "li3_dataset_activations_total{result=\"success\"} %" PRIu64 "\n"
+            "# HELP li3_dataset_evictions_total Datasets evicted from memory.\n"
+            "# TYPE li3_dataset_evictions_total counter\n"
+            "li3_dataset_evictions_total %" PRIu64 "\n",
+            __atomic_load_n(&metrics->resident_datasets, __ATOMIC_RELAXED),
+            __atomic_load_n(&metrics->activations[0], __ATOMIC_RELAXED),
+            __atomic_load_n(&metrics->activations[1], __ATOMIC_RELAXED),
+            __atomic_load_n(&metrics->evictions, __ATOMIC_RELAXED));
+
+    const int failed = ferror(out);
+    if (fclose(out) || failed) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+void server_metrics_free(server_metrics_t *metrics) {
+    free(metrics);
+}
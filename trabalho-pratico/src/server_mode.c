@@ -0,0 +1,2424 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  server_mode.c
+ * @brief Implementation of methods in include/server_mode.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref server_mode_examples).
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dataset/dataset_loader.h"
+#include "dataset/dataset_progress.h"
+#include "dataset/dataset_shipping.h"
+#include "queries/query_dispatcher.h"
+#include "queries/query_parser.h"
+#include "queries/query_slow_log.h"
+#include "queries/query_template.h"
+#include "server_metrics.h"
+#include "server_mode.h"
+#include "testing/performance_trace.h"
+#include "utils/int_utils.h"
+#include "utils/memory_report.h"
+
+/** @brief Name of the only dataset of a server started with the path of a dataset. */
+#define SERVER_MODE_DEFAULT_DATASET_NAME "default"
+
+/** @brief Maximum number of pending connections to the server's socket. */
+#define SERVER_MODE_LISTEN_BACKLOG 64
+
+/** @brief Maximum number of queries each client can prepare. */
+#define SERVER_MODE_MAX_STATEMENTS 1024
+
+/** @brief Maximum number of socket events handled per call to `epoll_wait`. */
+#define SERVER_MODE_MAX_EVENTS 256
+
+/** @brief Number of bytes read from a client's socket at once. */
+#define SERVER_MODE_READ_SIZE 4096
+
+/** @brief Maximum length of a query. Clients sending longer lines are disconnected. */
+#define SERVER_MODE_MAX_LINE_LENGTH (1 << 16)
+
+/**
+ * @brief   Maximum number of requests from a single client in a batch.
+ * @details Further requests wait for the following batches, so that a client sending many queries
+ *          at once can't delay all other clients.
+ */
+#define SERVER_MODE_MAX_CLIENT_REQUESTS 256
+
+/**
+ * @brief   Maximum number of bytes of responses waiting to be sent, over all clients.
+ * @details Requests received while this is exceeded are rejected, instead of growing the output
+ *          buffers of clients that aren't reading their responses.
+ */
+#define SERVER_MODE_MAX_PENDING_OUTPUT (64 << 20)
+
+/**
+ * @brief Number of milliseconds a query streaming its output waits for the client to read it,
+ *        before the client is disconnected.
+ */
+#define SERVER_MODE_STREAM_TIMEOUT 30000
+
+/**
+ * @brief Maximum number of writers of each ::server_mode_protocol_t kept between batches, to be
+ *        reused by the following ones.
+ */
+#define SERVER_MODE_MAX_SPARE_WRITERS 64
+
+/**
+ * @enum  server_mode_protocol_t
+ * @brief Encoding of responses, negotiated by a client with a `PROTOCOL` request.
+ *
+ * @var server_mode_protocol_t::SERVER_MODE_PROTOCOL_TEXT
+ *     @brief The number of lines, followed by the lines themselves (default).
+ * @var server_mode_protocol_t::SERVER_MODE_PROTOCOL_BINARY
+ *     @brief Status, length and binary output (see ::__server_mode_respond_binary).
+ * @var server_mode_protocol_t::SERVER_MODE_PROTOCOL_CHUNKED
+ *     @brief Text outputs of queries split into chunks, sent while queries run (see
+ *            ::__server_mode_respond_chunked).
+ * @var server_mode_protocol_t::SERVER_MODE_PROTOCOL_COUNT
+ *     @brief Number of protocols.
+ */
+typedef enum {
+    SERVER_MODE_PROTOCOL_TEXT,
+    SERVER_MODE_PROTOCOL_BINARY,
+    SERVER_MODE_PROTOCOL_CHUNKED,
+    SERVER_MODE_PROTOCOL_COUNT
+} server_mode_protocol_t;
+
+/**
+ * @struct server_mode_buffer_t
+ * @brief  A growable buffer of bytes.
+ *
+ * @var server_mode_buffer_t::data
+ *     @brief Bytes in the buffer (`NULL` while nothing has been allocated).
+ * @var server_mode_buffer_t::length
+ *     @brief Number of bytes in ::server_mode_buffer_t::data.
+ * @var server_mode_buffer_t::capacity
+ *     @brief Number of bytes allocated for ::server_mode_buffer_t::data.
+ */
+typedef struct {
+    char  *data;
+    size_t length, capacity;
+} server_mode_buffer_t;
+
+/**
+ * @struct server_mode_client_t
+ * @brief  A client connected to the server.
+ *
+ * @var server_mode_client_t::fd
+ *     @brief Socket connected to the client (non-blocking).
+ * @var server_mode_client_t::input
+ *     @brief Data received from the client that hasn't been parsed yet (an incomplete line).
+ * @var server_mode_client_t::output
+ *     @brief Responses that haven't been sent to the client yet.
+ * @var server_mode_client_t::output_sent
+ *     @brief Number of bytes in ::server_mode_client_t::output that have already been sent.
+ * @var server_mode_client_t::statements
+ *     @brief Array of ::query_template_t, for the queries prepared by the client. The identifier
+ *            of each statement is its index.
+ * @var server_mode_client_t::batch_requests
+ *     @brief Number of requests from the client in the batch being built.
+ * @var server_mode_client_t::backlogged
+ *     @brief Whether ::server_mode_client_t::input contains complete lines that didn't fit in the
+ *            batch being built (see ::SERVER_MODE_MAX_CLIENT_REQUESTS). No more data is read from
+ *            the client until they're parsed.
+ * @var server_mode_client_t::finished
+ *     @brief Whether the client won't send any more queries. It's disconnected once all
+ *            responses are sent.
+ * @var server_mode_client_t::http
+ *     @brief Whether the client sent an HTTP request. The rest of its input is discarded, and it's
+ *            disconnected once the HTTP response is sent.
+ * @var server_mode_client_t::protocol
+ *     @brief Encoding of responses negotiated by the client.
+ * @var server_mode_client_t::dataset
+ *     @brief Index in ::server_mode_t::datasets of the dataset the client's queries are run on,
+ *            selected with a `DATASET` request.
+ * @var server_mode_client_t::events
+ *     @brief Events the client's socket is registered for, in ::server_mode_t::epoll_fd.
+ * @var server_mode_client_t::revents
+ *     @brief Events that happened on the client's socket, in the current iteration of
+ *            ::__server_mode_loop.
+ * @var server_mode_client_t::failed
+ *     @brief Whether communication with the client failed, and it must be disconnected.
+ */
+typedef struct {
+    int                    fd;
+    server_mode_buffer_t   input, output;
+    size_t                 output_sent;
+    GPtrArray             *statements;
+    size_t                 batch_requests;
+    int                    backlogged, finished, http, failed;
+    server_mode_protocol_t protocol;
+    size_t                 dataset;
+    uint32_t               events, revents;
+} server_mode_client_t;
+
+/**
+ * @struct server_mode_stream_t
+ * @brief  Chunks of a query's output already sent to a client, while the query was running.
+ *
+ * @var server_mode_stream_t::fd
+ *     @brief Socket connected to the client.
+ * @var server_mode_stream_t::enabled
+ *     @brief Whether the request's writer streams its output (see ::__server_mode_can_stream).
+ * @var server_mode_stream_t::started
+ *     @brief Whether the start of the response (`*`) was already sent.
+ * @var server_mode_stream_t::lines
+ *     @brief Number of lines in the chunks already sent.
+ * @var server_mode_stream_t::failed
+ *     @brief Whether sending a chunk failed (possibly after part of it was sent).
+ */
+typedef struct {
+    int    fd;
+    int    enabled;
+    int    started;
+    size_t lines;
+    int    failed;
+} server_mode_stream_t;
+
+/**
+ * @struct server_mode_request_t
+ * @brief  A query sent by a client, waiting for a response.
+ *
+ * @var server_mode_request_t::client
+ *     @brief Index of the client that sent the query.
+ * @var server_mode_request_t::dataset
+ *     @brief Index in ::server_mode_t::datasets of the dataset the query is run on.
+ * @var server_mode_request_t::output
+ *     @brief Where the query's output is written to. `NULL` when the query couldn't be parsed.
+ * @var server_mode_request_t::prepared
+ *     @brief Identifier of the statement prepared by this request, or `-1` if it isn't a
+ *            successful `PREPARE`.
+ * @var server_mode_request_t::http
+ *     @brief Status code of the response to an HTTP request, or `0` if it isn't one.
+ * @var server_mode_request_t::shipping
+ *     @brief Path of an HTTP request for the snapshot (see ::dataset_shipping_respond), or `NULL`
+ *            if it isn't one.
+ * @var server_mode_request_t::type
+ *     @brief Type number of the query, or `0` if the request isn't a query.
+ * @var server_mode_request_t::received
+ *     @brief When the request was received, to measure its latency.
+ * @var server_mode_request_t::text
+ *     @brief Copy of the request, for the slow query log. `NULL` if there's no such log.
+ * @var server_mode_request_t::protocol
+ *     @brief Encoding of the response, as negotiated by the client when the request was sent.
+ * @var server_mode_request_t::stream
+ *     @brief Chunks of the response sent while the query ran (only with
+ *            ::SERVER_MODE_PROTOCOL_CHUNKED).
+ * @var server_mode_request_t::negotiated
+ *     @brief Whether the request is a successful `PROTOCOL` or `DATASET` request.
+ * @var server_mode_request_t::pending
+ *     @brief Whether the request is a query that hasn't been run yet.
+ * @var server_mode_request_t::rejected
+ *     @brief Whether the request was rejected, as ::SERVER_MODE_MAX_PENDING_OUTPUT was exceeded
+ *            or its dataset couldn't be restored.
+ * @var server_mode_request_t::responded
+ *     @brief Whether the response to the request was already appended to the client's output.
+ */
+typedef struct {
+    size_t                 client;
+    size_t                 dataset;
+    query_writer_t        *output;
+    ssize_t                prepared;
+    int                    http;
+    const char            *shipping;
+    size_t                 type;
+    struct timespec        received;
+    const char            *text;
+    server_mode_protocol_t protocol;
+    server_mode_stream_t   stream;
+    int                    negotiated;
+    int                    pending, rejected, responded;
+} server_mode_request_t;
+
+/**
+ * @enum  server_mode_priority_t
+ * @brief Priority class of a query. Classes are run in order, as separate batches.
+ *
+ * @var server_mode_priority_t::SERVER_MODE_PRIORITY_HIGH
+ *     @brief Queries answered with lookups in the database's indexes.
+ * @var server_mode_priority_t::SERVER_MODE_PRIORITY_LOW
+ *     @brief Queries whose type generates statistical data (that may go over the whole dataset),
+ *            so that they don't delay cheaper queries sent at the same time.
+ * @var server_mode_priority_t::SERVER_MODE_PRIORITY_COUNT
+ *     @brief Number of priority classes.
+ */
+typedef enum {
+    SERVER_MODE_PRIORITY_HIGH,
+    SERVER_MODE_PRIORITY_LOW,
+    SERVER_MODE_PRIORITY_COUNT
+} server_mode_priority_t;
+
+/**
+ * @struct server_mode_dataset_t
+ * @brief  A named dataset served by the server.
+ *
+ * @var server_mode_dataset_t::name
+ *     @brief Name clients select the dataset with, in `DATASET` requests.
+ * @var server_mode_dataset_t::dataset_dir
+ *     @brief Path to the directory containing the dataset.
+ * @var server_mode_dataset_t::database
+ *     @brief Database queries sent to the dataset are run on, or `NULL` while it's evicted.
+ *            Replaced when the dataset is reloaded.
+ * @var server_mode_dataset_t::materializer
+ *     @brief Rendered outputs of queries on ::server_mode_dataset_t::database (can be `NULL`).
+ *            Recreated when the dataset is reloaded or restored.
+ * @var server_mode_dataset_t::queries
+ *     @brief Queries sent to the dataset in the batch being built, for each
+ *            ::server_mode_priority_t. The line of each query is the index of its request in
+ *            ::server_mode_t::requests.
+ * @var server_mode_dataset_t::memory
+ *     @brief Bytes reserved by ::server_mode_dataset_t::database, including its indexes and
+ *            caches of statistical data, measured after every batch it's used in.
+ * @var server_mode_dataset_t::last_used
+ *     @brief Value of ::server_mode_t::batches when the dataset last had queries, to evict the
+ *            least recently used datasets first.
+ */
+typedef struct {
+    char                  *name;
+    char                  *dataset_dir;
+    database_t            *database;
+    query_materializer_t  *materializer;
+    query_instance_list_t *queries[SERVER_MODE_PRIORITY_COUNT];
+    size_t                 memory;
+    uint64_t               last_used;
+} server_mode_dataset_t;
+
+/** @brief State of the background thread that reloads the dataset. */
+typedef enum {
+    SERVER_MODE_RELOAD_IDLE,    /**< @brief No background thread is running. */
+    SERVER_MODE_RELOAD_LOADING, /**< @brief A new database is being loaded. */
+    SERVER_MODE_RELOAD_FREEING, /**< @brief The database replaced by a reload is being freed. */
+} server_mode_reload_state_t;
+
+/**
+ * @struct server_mode_reload_t
+ * @brief  Reload of the dataset, happening in the background while queries are answered.
+ *
+ * @var server_mode_reload_t::state
+ *     @brief What the background thread is doing.
+ * @var server_mode_reload_t::thread
+ *     @brief Background thread, when ::server_mode_reload_t::state isn't
+ *            ::SERVER_MODE_RELOAD_IDLE.
+ * @var server_mode_reload_t::done
+ *     @brief Whether the background thread has finished, and can be joined. Set atomically.
+ * @var server_mode_reload_t::dataset
+ *     @brief Index in ::server_mode_t::datasets of the dataset being reloaded.
+ * @var server_mode_reload_t::next
+ *     @brief Index of the first dataset yet to be reloaded after a reload was requested. Equal to
+ *            (or greater than) the number of datasets when all of them were reloaded.
+ * @var server_mode_reload_t::dataset_dir
+ *     @brief Path to the directory containing the dataset being reloaded.
+ * @var server_mode_reload_t::primary_socket
+ *     @brief Socket of the server whose snapshot is downloaded (see ::dataset_shipping_fetch)
+ *            instead of loading the dataset, or `NULL` if this server isn't a replica.
+ * @var server_mode_reload_t::database
+ *     @brief Database being loaded (or freed). While loading, set to `NULL` by the background
+ *            thread if loading fails.
+ * @var server_mode_reload_t::progress
+ *     @brief Progress of the database being loaded, used to pause loading while queries are run.
+ * @var server_mode_reload_t::duration
+ *     @brief Microseconds the background thread took to load the database.
+ */
+typedef struct {
+    server_mode_reload_state_t state;
+    pthread_t                  thread;
+    int                        done;
+    size_t                     dataset, next;
+    const char                *dataset_dir;
+    const char                *primary_socket;
+    database_t                *database;
+    dataset_progress_t        *progress;
+    uint64_t                   duration;
+} server_mode_reload_t;
+
+/**
+ * @struct server_mode_t
+ * @brief  State of the server.
+ *
+ * @var server_mode_t::datasets
+ *     @brief Array of the ::server_mode_dataset_t served. The first one is the default dataset of
+ *            clients, whose snapshot is served to replicas.
+ * @var server_mode_t::ndatasets
+ *     @brief Number of datasets in ::server_mode_t::datasets.
+ * @var server_mode_t::resident_budget
+ *     @brief Bytes of memory datasets can reserve before the least recently used ones are evicted
+ *            (see ::SERVER_MODE_RESIDENT_BUDGET_ENVIRONMENT_VARIABLE), or `0` for no limit.
+ * @var server_mode_t::batches
+ *     @brief Number of batches run, used as the clock of ::server_mode_dataset_t::last_used.
+ * @var server_mode_t::reload
+ *     @brief Reload of the datasets in the background.
+ * @var server_mode_t::wakeup_fd
+ *     @brief Read end of a pipe written to when a reload is requested or finishes, so that
+ *            `epoll_wait` returns.
+ * @var server_mode_t::listen_fd
+ *     @brief Socket where new clients connect to.
+ * @var server_mode_t::epoll_fd
+ *     @brief   `epoll` instance with all sockets (and ::server_mode_t::wakeup_fd).
+ *     @details Sockets stay registered while their clients are connected, so that waiting for
+ *              events only costs as much as the number of sockets with events, and not the number
+ *              of (mostly idle) clients.
+ * @var server_mode_t::clients
+ *     @brief Array of ::server_mode_client_t.
+ * @var server_mode_t::client_indices
+ *     @brief Array of `size_t`, with the index in ::server_mode_t::clients of the client of each
+ *            socket, indexed by file descriptor.
+ * @var server_mode_t::requests
+ *     @brief Array of ::server_mode_request_t, for the queries in the batch being built, in the
+ *            order they were received.
+ * @var server_mode_t::window
+ *     @brief Milliseconds to wait for more requests after the first one in a batch.
+ * @var server_mode_t::batch_start
+ *     @brief When the first request in the batch being built was received.
+ * @var server_mode_t::pending_output
+ *     @brief Bytes of responses waiting to be sent, over all clients.
+ * @var server_mode_t::outputs
+ *     @brief Array of ::query_writer_t, for the queries in the batch being run. Kept between
+ *            batches, so that it's only reallocated when it needs to grow.
+ * @var server_mode_t::spare_writers
+ *     @brief Writers of previous batches, for each ::server_mode_protocol_t, emptied and reused by
+ *            the following ones (see ::query_writer_reset), instead of being allocated again.
+ * @var server_mode_t::request_log
+ *     @brief File where requests are captured to (see
+ *            ::SERVER_MODE_REQUEST_LOG_ENVIRONMENT_VARIABLE), or `NULL` if they aren't.
+ * @var server_mode_t::metrics
+ *     @brief Metrics exposed to HTTP clients.
+ * @var server_mode_t::shipping
+ *     @brief Snapshot of the dataset, served to replicas.
+ * @var server_mode_t::aux_query
+ *     @brief Query instance every line is parsed into, before being added to
+ *            ::server_mode_t::queries.
+ * @var server_mode_t::cancellation
+ *     @brief Cancellation shared by all queries (set in ::server_mode_t::aux_query), restarted
+ *            with the time budget of queries before every batch is run.
+ */
+typedef struct {
+    server_mode_dataset_t     *datasets;
+    size_t                     ndatasets;
+    size_t                     resident_budget;
+    uint64_t                   batches;
+    server_mode_reload_t       reload;
+    int                        wakeup_fd;
+    int                        listen_fd;
+    int                        epoll_fd;
+    GArray                    *clients, *client_indices, *requests;
+    unsigned int               window;
+    struct timespec            batch_start;
+    size_t                     pending_output;
+    GPtrArray                 *outputs, *spare_writers[SERVER_MODE_PROTOCOL_COUNT];
+    FILE                      *request_log;
+    server_metrics_t          *metrics;
+    dataset_shipping_source_t *shipping;
+    query_instance_t          *aux_query;
+    query_cancellation_t      *cancellation;
+} server_mode_t;
+
+/** @brief Set by signal handlers, to stop the server. */
+static volatile sig_atomic_t server_mode_stop = 0;
+
+/** @brief Set by the signal handler of `SIGHUP`, to reload the dataset. */
+static volatile sig_atomic_t server_mode_reload_requested = 0;
+
+/** @brief Write end of the pipe in ::server_mode_t::wakeup_fd (non-blocking). */
+static int server_mode_wakeup_write_fd = -1;
+
+/**
+ * @brief  Calculates how much time has passed since an instant.
+ * @param  start Instant measured with `CLOCK_MONOTONIC`.
+ * @return The number of microseconds since @p start.
+ */
+uint64_t __server_mode_get_elapsed(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) (now.tv_sec - start->tv_sec) * 1000000 +
+           (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+/**
+ * @brief Signal handler for `SIGINT` and `SIGTERM`, that stops the server.
+ * @param signum Signal received. Not used.
+ */
+void __server_mode_signal_handler(int signum) {
+    (void) signum;
+    server_mode_stop = 1;
+}
+
+/**
+ * @brief   Wakes up the thread running ::__server_mode_loop, if it's waiting in `epoll_wait`.
+ * @details Async-signal-safe. A full pipe already has a pending wake-up, so failing to write to it
+ *          is ignored.
+ */
+void __server_mode_wakeup(void) {
+    const int     saved_errno = errno;
+    const ssize_t nwritten    = write(server_mode_wakeup_write_fd, "", 1);
+    (void) nwritten;
+    errno = saved_errno;
+}
+
+/**
+ * @brief Signal handler for `SIGHUP`, that requests the dataset to be reloaded.
+ * @param signum Signal received. Not used.
+ */
+void __server_mode_hangup_handler(int signum) {
+    (void) signum;
+    server_mode_reload_requested = 1;
+    __server_mode_wakeup();
+}
+
+/**
+ * @brief  Installs the signal handlers needed by the server.
+ * @retval 0 Success.
+ * @retval 1 Failure.
+ */
+int __server_mode_install_signal_handlers(void) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    sigemptyset(&action.sa_mask);
+
+    /* No SA_RESTART, so that epoll_wait is interrupted */
+    action.sa_handler = __server_mode_signal_handler;
+    if (sigaction(SIGINT, &action, NULL) || sigaction(SIGTERM, &action, NULL))
+        return 1;
+
+    action.sa_handler = __server_mode_hangup_handler;
+    if (sigaction(SIGHUP, &action, NULL))
+        return 1;
+
+    /* Clients disconnecting are handled when sending data fails */
+    action.sa_handler = SIG_IGN;
+    return sigaction(SIGPIPE, &action, NULL) != 0;
+}
+
+/**
+ * @brief Appends bytes to a buffer.
+ *
+ * @param buffer Buffer to be appended to.
+ * @param data   Bytes to append.
+ * @param n      Number of bytes in @p data.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __server_mode_buffer_append(server_mode_buffer_t *buffer, const char *data, size_t n) {
+    if (buffer->length + n > buffer->capacity) {
+        const size_t new_capacity = max(buffer->capacity * 2, buffer->length + n);
+        char *const  new_data     = realloc(buffer->data, new_capacity);
+        if (!new_data)
+            return 1;
+
+        buffer->data     = new_data;
+        buffer->capacity = new_capacity;
+    }
+
+    memcpy(buffer->data + buffer->length, data, n);
+    buffer->length += n;
+    return 0;
+}
+
+/**
+ * @brief  Creates the socket clients connect to.
+ * @param  socket_path Path of the socket.
+ * @return A listening, non-blocking socket, or `-1` on failure.
+ */
+int __server_mode_listen(const char *socket_path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (strlen(socket_path) >= sizeof(address.sun_path))
+        return -1;
+    strcpy(address.sun_path, socket_path);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    unlink(socket_path); /* Replace sockets left by previous runs */
+    if (bind(fd, (struct sockaddr *) &address, sizeof(address)) ||
+        listen(fd, SERVER_MODE_LISTEN_BACKLOG) || fcntl(fd, F_SETFL, O_NONBLOCK)) {
+
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * @brief  Accepts all pending connections to the server.
+ * @param  server State of the server.
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __server_mode_accept(server_mode_t *server) {
+    while (1) {
+        const int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0)
+            return 0; /* No more pending connections (or a client gave up on connecting) */
+
+        if (fcntl(fd, F_SETFL, O_NONBLOCK)) {
+            close(fd);
+            continue;
+        }
+
+        const server_mode_client_t client = {
+            .fd             = fd,
+            .input          = {NULL, 0, 0},
+            .output         = {NULL, 0, 0},
+            .output_sent    = 0,
+            .statements     = g_ptr_array_new_with_free_func((GDestroyNotify) query_template_free),
+            .batch_requests = 0,
+            .backlogged     = 0,
+            .finished       = 0,
+            .http           = 0,
+            .failed         = 0,
+            .protocol       = SERVER_MODE_PROTOCOL_TEXT,
+            .dataset        = 0,
+            .events         = EPOLLIN,
+            .revents        = 0};
+
+        struct epoll_event event = {.events = EPOLLIN, .data.fd = fd};
+        if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
+            close(fd);
+            g_ptr_array_unref(client.statements);
+            continue;
+        }
+
+        if ((size_t) fd >= server->client_indices->len)
+            g_array_set_size(server->client_indices, fd + 1);
+        g_array_index(server->client_indices, size_t, fd) = server->clients->len;
+        g_array_append_val(server->clients, client);
+    }
+}
+
+/**
+ * @brief Reads everything available from a client's socket.
+ * @param client Client to read data from.
+ */
+void __server_mode_receive(server_mode_client_t *client) {
+    while (1) {
+        char          buffer[SERVER_MODE_READ_SIZE];
+        const ssize_t nread = read(client->fd, buffer, SERVER_MODE_READ_SIZE);
+
+        if (nread == 0) {
+            /* A last query may not end with a new line */
+            client->finished = 1;
+            if (client->input.length && __server_mode_buffer_append(&client->input, "\n", 1))
+                client->failed = 1;
+            return;
+        } else if (nread < 0) {
+            if (errno == EINTR)
+                continue;
+            else if (errno != EAGAIN && errno != EWOULDBLOCK)
+                client->failed = 1;
+            return;
+        }
+
+        if (__server_mode_buffer_append(&client->input, buffer, nread) ||
+            client->input.length > SERVER_MODE_MAX_LINE_LENGTH + SERVER_MODE_READ_SIZE) {
+
+            client->failed = 1;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief   Handles a `PREPARE` request, by creating a template for the client.
+ * @details Auxiliary method for ::__server_mode_add_request.
+ *
+ * @param client   Client that sent the request.
+ * @param template Query template, after `PREPARE`.
+ *
+ * @return The identifier of the new statement, or `-1` if it couldn't be prepared.
+ */
+ssize_t __server_mode_prepare(server_mode_client_t *client, const char *template) {
+    if (client->statements->len == SERVER_MODE_MAX_STATEMENTS)
+        return -1;
+
+    query_template_t *const statement = query_template_create(template);
+    if (!statement)
+        return -1;
+
+    g_ptr_array_add(client->statements, statement);
+    return client->statements->len - 1;
+}
+
+/**
+ * @brief   Gets the allocator of the arguments of all queries in the batch being built.
+ * @details The priority and dataset of a query are only known after it's parsed, so the arguments
+ *          of all queries are allocated in the arena of the first list of the first dataset. All
+ *          lists are replaced together (see ::__server_mode_replace_queries).
+ *
+ * @param server State of the server.
+ *
+ * @return The arena where arguments of queries are allocated.
+ */
+arena_t *__server_mode_get_arguments(const server_mode_t *server) {
+    return query_instance_list_get_argument_allocator(server->datasets[0].queries[0]);
+}
+
+/**
+ * @brief   Handles a `DATASET` request, by selecting the dataset the client's queries are run on.
+ * @details Auxiliary method for ::__server_mode_add_request.
+ *
+ * @param server State of the server.
+ * @param client Client that sent the request.
+ * @param name   Name of the dataset, after `DATASET`.
+ *
+ * @retval 0 Success.
+ * @retval 1 No dataset with that name.
+ */
+int __server_mode_select_dataset(const server_mode_t  *server,
+                                 server_mode_client_t *client,
+                                 const char           *name) {
+    for (size_t i = 0; i < server->ndatasets; ++i) {
+        if (strcmp(server->datasets[i].name, name) == 0) {
+            client->dataset = i;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief   Handles an `EXECUTE` request, by binding parameters to a prepared statement.
+ * @details Auxiliary method for ::__server_mode_add_request.
+ *
+ * @param server State of the server.
+ * @param client Client that sent the request.
+ * @param line   Identifier of the statement, followed by the values of its parameters. Will be
+ *               modified.
+ *
+ * @retval 0 Success (::server_mode_t::aux_query contains the query).
+ * @retval 1 Parsing failure.
+ */
+int __server_mode_execute(server_mode_t *server, server_mode_client_t *client, char *line) {
+    const char *const space  = strchr(line, ' ');
+    const size_t      length = space ? (size_t) (space - line) : strlen(line);
+
+    uint64_t id;
+    if (!length || int_utils_parse_digits(&id, line, length) || id >= client->statements->len)
+        return 1;
+
+    const query_template_t *const statement = g_ptr_array_index(client->statements, id);
+    return query_template_bind(statement,
+                               server->aux_query,
+                               line + length,
+                               __server_mode_get_arguments(server));
+}
+
+/**
+ * @brief  Gets the priority class of a query.
+ * @param  query Parsed query.
+ * @return The ::server_mode_priority_t of @p query.
+ */
+server_mode_priority_t __server_mode_get_priority(const query_instance_t *query) {
+    const query_type_t *const type = query_instance_get_type(query);
+    return query_type_get_generate_statistics_callback(type) ? SERVER_MODE_PRIORITY_LOW
+                                                              : SERVER_MODE_PRIORITY_HIGH;
+}
+
+/**
+ * @brief   Writes the text of a query to the slow query log.
+ * @details Implementation of ::query_slow_log_text_callback_t. Queries are only logged while
+ *          their batch is being run, so their requests still exist.
+ *
+ * @param user_data State of the server (::server_mode_t).
+ * @param query     Query whose text is to be written.
+ * @param out       Where to write the text of @p query to.
+ */
+void __server_mode_write_query_text(void *user_data, const query_instance_t *query, FILE *out) {
+    const server_mode_t *const         server  = user_data;
+    const size_t                       index   = query_instance_get_line_in_file(query);
+    const server_mode_request_t *const request =
+        &g_array_index(server->requests, server_mode_request_t, index);
+    if (request->text)
+        fputs(request->text, out);
+}
+
+/**
+ * @brief   Parses a request sent by a client and adds it to the batch being built.
+ * @details A request is either a query, `PREPARE <template>`, `EXECUTE <id> <parameters>`,
+ *          `PROTOCOL <TEXT|BINARY|CHUNKED>`, `DATASET <name>` or the first line of an HTTP `GET`
+ *          request. Other
+ *          requests are rejected without being parsed while ::SERVER_MODE_MAX_PENDING_OUTPUT is
+ *          exceeded.
+ *
+ * @param server State of the server.
+ * @param client Index of the client that sent the request.
+ * @param line   Request to be parsed. Will be modified.
+ *
+ * @retval 0 Success (parsing failures may occur).
+ * @retval 1 Allocation failure.
+ */
+int __server_mode_add_request(server_mode_t *server, size_t client, char *line) {
+    server_mode_client_t *const sender =
+        &g_array_index(server->clients, server_mode_client_t, client);
+    server_mode_request_t request = {.client     = client,
+                                     .dataset    = 0,
+                                     .output     = NULL,
+                                     .prepared   = -1,
+                                     .http       = 0,
+                                     .shipping   = NULL,
+                                     .type       = 0,
+                                     .text       = NULL,
+                                     .protocol   = SERVER_MODE_PROTOCOL_TEXT,
+                                     .stream     = {-1, 0, 0, 0, 0},
+                                     .negotiated = 0,
+                                     .pending    = 0,
+                                     .rejected   = 0,
+                                     .responded  = 0};
+
+    clock_gettime(CLOCK_MONOTONIC, &request.received);
+    if (server->requests->len == 0)
+        server->batch_start = request.received;
+    sender->batch_requests++;
+
+    if (server->request_log && strncmp(line, "GET ", 4) != 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        fprintf(server->request_log,
+                "%" PRIu64 "\t%s\n",
+                (uint64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000,
+                line);
+    }
+
+    /* Parsing modifies the line, so it's copied first, alongside the arguments of the batch */
+    if (query_slow_log_get_shared()) {
+        request.text = arena_put_string(__server_mode_get_arguments(server), line);
+    }
+
+    int parse_retval = 1;
+    if (strncmp(line, "GET ", 4) == 0) {
+        /* Metrics and the snapshot are served on the same socket (e.g.: curl --unix-socket) */
+        char *const  path        = line + 4;
+        const size_t path_length = strcspn(path, " ");
+        request.http = path_length == 8 && strncmp(path, "/metrics", 8) == 0 ? 200 : 404;
+        sender->http = 1;
+
+        if (dataset_shipping_is_request(path, path_length)) {
+            path[path_length] = '\0';
+            request.shipping  = arena_put_string(__server_mode_get_arguments(server), path);
+            if (!request.shipping)
+                return 1;
+            request.http = 200;
+        }
+    } else if (server->pending_output > SERVER_MODE_MAX_PENDING_OUTPUT) {
+        request.rejected = 1;
+    } else if (strncmp(line, "PREPARE ", 8) == 0) {
+        request.prepared = __server_mode_prepare(sender, line + 8); /* Nothing to run */
+    } else if (strcmp(line, "PROTOCOL TEXT") == 0) {
+        sender->protocol   = SERVER_MODE_PROTOCOL_TEXT; /* Answered already in the new protocol */
+        request.negotiated = 1;
+    } else if (strcmp(line, "PROTOCOL BINARY") == 0) {
+        sender->protocol   = SERVER_MODE_PROTOCOL_BINARY;
+        request.negotiated = 1;
+    } else if (strcmp(line, "PROTOCOL CHUNKED") == 0) {
+        sender->protocol   = SERVER_MODE_PROTOCOL_CHUNKED;
+        request.negotiated = 1;
+    } else if (strncmp(line, "DATASET ", 8) == 0) {
+        request.negotiated = !__server_mode_select_dataset(server, sender, line + 8);
+    } else if (strncmp(line, "EXECUTE ", 8) == 0) {
+        parse_retval = __server_mode_execute(server, sender, line + 8);
+    } else {
+        parse_retval = query_parser_parse_string(server->aux_query,
+                                                 line,
+                                                 __server_mode_get_arguments(server));
+    }
+
+    request.dataset   = sender->dataset;
+    request.protocol  = sender->protocol;
+    request.stream.fd = sender->fd;
+    if (!parse_retval) {
+        const server_mode_priority_t priority = __server_mode_get_priority(server->aux_query);
+        server_mode_dataset_t *const dataset  = &server->datasets[request.dataset];
+
+        query_instance_set_line_in_file(server->aux_query, server->requests->len);
+        if (query_instance_list_add(dataset->queries[priority], server->aux_query))
+            return 1;
+        request.pending = 1;
+        request.type    = query_type_get_type_number(query_instance_get_type(server->aux_query));
+    }
+
+    g_array_append_val(server->requests, request);
+    return 0;
+}
+
+/**
+ * @brief   Adds complete lines sent by a client to the batch of queries being built.
+ * @details At most ::SERVER_MODE_MAX_CLIENT_REQUESTS requests from the client are added to a
+ *          batch. The remaining lines are kept for the following ones. Everything after the first
+ *          line of an HTTP request (its headers) is discarded.
+ *
+ * @param server       State of the server.
+ * @param client_index Index of the client whose input is processed.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __server_mode_parse_client_input(server_mode_t *server, size_t client_index) {
+    server_mode_client_t *const client =
+        &g_array_index(server->clients, server_mode_client_t, client_index);
+
+    size_t line_start = 0;
+    client->backlogged = 0;
+    if (client->http) {
+        client->input.length = 0;
+        return 0;
+    }
+
+    for (size_t i = 0; i < client->input.length; ++i) {
+        if (client->input.data[i] != '\n')
+            continue;
+
+        if (client->batch_requests == SERVER_MODE_MAX_CLIENT_REQUESTS) {
+            client->backlogged = 1;
+            break;
+        }
+
+        client->input.data[i] = '\0';
+        if (i > line_start && client->input.data[i - 1] == '\r')
+            client->input.data[i - 1] = '\0';
+
+        if (__server_mode_add_request(server, client_index, client->input.data + line_start))
+            return 1;
+        if (client->http) {
+            client->input.length = 0;
+            return 0;
+        }
+        line_start = i + 1;
+    }
+
+    /* Keep the incomplete last line (and lines that didn't fit in the batch) for later */
+    if (line_start) {
+        client->input.length -= line_start;
+        memmove(client->input.data, client->input.data + line_start, client->input.length);
+    }
+    if (!client->backlogged && client->input.length > SERVER_MODE_MAX_LINE_LENGTH)
+        client->failed = 1;
+
+    return 0;
+}
+
+/**
+ * @brief   Sends data to a client, waiting for its socket to be writable when needed.
+ * @details Auxiliary method for ::__server_mode_stream_chunk, that runs on the thread of a query,
+ *          and not on the server's loop. Waiting for the client is what stops a query from
+ *          producing output faster than it's read.
+ *
+ * @param fd     Socket connected to the client (non-blocking).
+ * @param data   Data to be sent.
+ * @param length Number of bytes in @p data.
+ *
+ * @retval 0 Success.
+ * @retval 1 The client disconnected, or didn't read for ::SERVER_MODE_STREAM_TIMEOUT milliseconds.
+ */
+int __server_mode_send_blocking(int fd, const char *data, size_t length) {
+    size_t sent = 0;
+    while (sent < length) {
+        const ssize_t written = send(fd, data + sent, length - sent, MSG_NOSIGNAL);
+        if (written >= 0) {
+            sent += written;
+            continue;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return 1;
+        }
+
+        struct pollfd pfd = {.fd = fd, .events = POLLOUT, .revents = 0};
+        int           ready;
+        do {
+            ready = poll(&pfd, 1, SERVER_MODE_STREAM_TIMEOUT);
+        } while (ready < 0 && errno == EINTR);
+        if (ready <= 0 || (pfd.revents & (POLLERR | POLLHUP)))
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Counts the lines in part of the text output of a query.
+ *
+ * @param data   Output of the query.
+ * @param length Number of bytes in @p data.
+ *
+ * @return The number of newline characters in @p data.
+ */
+size_t __server_mode_count_lines(const char *data, size_t length) {
+    size_t      lines = 0;
+    const char *end   = data + length;
+    for (const char *i = data; (i = memchr(i, '\n', end - i)); ++i)
+        lines++;
+    return lines;
+}
+
+/**
+ * @brief   Sends a chunk of a query's output to the client that sent the query, while it runs.
+ * @details Callback of type ::query_writer_sink_t, for writers of requests with
+ *          ::SERVER_MODE_PROTOCOL_CHUNKED (see ::__server_mode_respond_chunked for the framing).
+ *
+ * @param user_data Pointer to the ::server_mode_stream_t of the request.
+ * @param data      Chunk of output.
+ * @param length    Number of bytes in @p data.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure to send the chunk. The client will be disconnected.
+ */
+int __server_mode_stream_chunk(void *user_data, const char *data, size_t length) {
+    server_mode_stream_t *const stream = user_data;
+    if (stream->failed)
+        return 1;
+
+    char   header[INT_UTILS_SPRINTF_MIN_BUFFER_SIZE + 3];
+    size_t header_length = 0;
+    if (!stream->started) {
+        header[header_length++] = '*';
+        header[header_length++] = '\n';
+    }
+    header_length += int_utils_sprintf_unsigned(header + header_length, length);
+    header[header_length++] = '\n';
+
+    if (__server_mode_send_blocking(stream->fd, header, header_length) ||
+        __server_mode_send_blocking(stream->fd, data, length)) {
+        stream->failed = 1;
+        return 1;
+    }
+
+    stream->started = 1;
+    stream->lines += __server_mode_count_lines(data, length);
+    return 0;
+}
+
+/**
+ * @brief   Checks if a query's output can be sent to its client while the query runs.
+ * @details That's only possible while nothing else is waiting to be sent to that client: earlier
+ *          responses, already in its output buffer, or to be answered later in the batch.
+ *
+ * @param server State of the server.
+ * @param index  Index of the request in ::server_mode_t::requests.
+ *
+ * @return Whether the output of the request can be streamed.
+ */
+int __server_mode_can_stream(const server_mode_t *server, size_t index) {
+    const server_mode_request_t *const request =
+        &g_array_index(server->requests, server_mode_request_t, index);
+    const server_mode_client_t *const client =
+        &g_array_index(server->clients, server_mode_client_t, request->client);
+    if (client->output.length)
+        return 0;
+
+    for (size_t i = 0; i < index; ++i) {
+        const server_mode_request_t *const previous =
+            &g_array_index(server->requests, server_mode_request_t, i);
+        if (previous->client == request->client && !previous->responded)
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * @struct server_mode_writers_t
+ * @brief  Type of `user_data` parameter in ::__server_mode_create_writer.
+ *
+ * @var server_mode_writers_t::server
+ *     @brief State of the server.
+ * @var server_mode_writers_t::outputs
+ *     @brief Where to store writers, in the same order as the queries in the batch.
+ * @var server_mode_writers_t::i
+ *     @brief Index of the query being currently dealt with.
+ */
+typedef struct {
+    server_mode_t   *server;
+    query_writer_t **outputs;
+    size_t           i;
+} server_mode_writers_t;
+
+/**
+ * @brief   Creates the writer of a query in the batch being run.
+ * @details Callback for ::query_instance_list_iter.
+ *
+ * @param user_data Pointer to a ::server_mode_writers_t.
+ * @param instance  Query in the batch.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __server_mode_create_writer(void *user_data, const query_instance_t *instance) {
+    server_mode_writers_t *const writers = user_data;
+    const size_t                 index   = query_instance_get_line_in_file(instance);
+    server_mode_request_t *const request =
+        &g_array_index(writers->server->requests, server_mode_request_t, index);
+
+    const int        formatted = query_instance_get_formatted(instance);
+    GPtrArray *const spare     = writers->server->spare_writers[request->protocol];
+    if (request->protocol == SERVER_MODE_PROTOCOL_CHUNKED &&
+        __server_mode_can_stream(writers->server, index)) {
+        /* Not reused, as its sink points to this request */
+        request->stream.enabled = 1;
+        request->output =
+            query_writer_create_streaming(formatted, __server_mode_stream_chunk, &request->stream);
+    } else if (spare->len) {
+        request->output = g_ptr_array_steal_index_fast(spare, spare->len - 1);
+        query_writer_reset(request->output, formatted);
+    } else if (request->protocol == SERVER_MODE_PROTOCOL_BINARY) {
+        request->output = query_writer_create_binary();
+    } else if (request->protocol == SERVER_MODE_PROTOCOL_CHUNKED) {
+        /* The whole output is sent in chunks once the query is answered */
+        request->output = query_writer_create_buffered(formatted);
+    } else {
+        request->output = query_writer_create(NULL, formatted);
+    }
+    if (!request->output)
+        return 1;
+    request->pending = 0; /* Run right after its writer is created */
+
+    writers->outputs[writers->i++] = request->output;
+    return 0;
+}
+
+/**
+ * @brief   Appends the response to an HTTP request to the output of the client that sent it.
+ * @details Auxiliary method for ::__server_mode_respond. The response's body is the server's
+ *          metrics, in Prometheus' text format, part of the dataset's snapshot (see
+ *          ::dataset_shipping_respond), or an error message.
+ *
+ * @param server  State of the server.
+ * @param client  Client that sent the request.
+ * @param request HTTP request, whose status code is `200` or `404`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __server_mode_respond_http(const server_mode_t         *server,
+                               server_mode_client_t        *client,
+                               const server_mode_request_t *request) {
+    dataset_shipping_response_t response = {.status = request->http,
+                                            .body   = NULL,
+                                            .length = 0,
+                                            .binary = 0};
+    if (request->shipping) {
+        dataset_shipping_respond(server->shipping,
+                                 request->shipping,
+                                 strlen(request->shipping),
+                                 &response);
+    } else if (response.status == 200) {
+        response.body = server_metrics_format(server->metrics, server->datasets[0].database);
+        if (response.body)
+            response.length = strlen(response.body);
+        else
+            response.status = 500;
+    }
+
+    const int         status = response.status;
+    const char *const reason = status == 200 ? "OK" : status == 404 ? "Not Found" : "Error";
+    const char *const body   = response.body ? response.body : reason;
+    const size_t      length = response.body ? response.length : strlen(reason);
+
+    char      header[256];
+    const int header_length =
+        snprintf(header,
+                 sizeof(header),
+                 "HTTP/1.0 %d %s\r\n"
+                 "Content-Type: %s\r\n"
+                 "Content-Length: %zu\r\n"
+                 "Connection: close\r\n\r\n",
+                 status,
+                 reason,
+                 response.binary ? "application/octet-stream" : "text/plain; version=0.0.4",
+                 length);
+
+    const int retval = __server_mode_buffer_append(&client->output, header, header_length) ||
+                       __server_mode_buffer_append(&client->output, body, length);
+    free(response.body);
+    return retval;
+}
+
+/**
+ * @brief   Appends the response to a request of a client that negotiated binary responses.
+ * @details Auxiliary method for ::__server_mode_respond. The response starts with an `int64_t`
+ *          status (the number of objects, or the same negative codes as text responses), followed
+ *          by the `uint64_t` length of the query's binary output (see
+ *          ::query_writer_create_binary) and that output. Both numbers are little-endian.
+ *
+ * @param client  Client that sent the request.
+ * @param request Request that was answered.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __server_mode_respond_binary(server_mode_client_t        *client,
+                                 const server_mode_request_t *request) {
+    int64_t     status;
+    const char *payload = NULL;
+    size_t      length  = 0;
+    char        prepared[2 + sizeof(uint64_t)];
+
+    if (request->rejected) {
+        status = -2;
+    } else if (request->negotiated) {
+        status = 0;
+    } else if (request->prepared >= 0) {
+        /* One object, with the statement's identifier */
+        prepared[0] = QUERY_WRITER_BINARY_OBJECT;
+        prepared[1] = QUERY_WRITER_BINARY_UNSIGNED;
+        for (size_t i = 0; i < sizeof(uint64_t); ++i)
+            prepared[2 + i] = (char) ((uint64_t) request->prepared >> (8 * i));
+
+        status  = 1;
+        payload = prepared;
+        length  = sizeof(prepared);
+    } else if (!request->output) {
+        status = -1;
+    } else if (query_writer_is_incomplete(request->output)) {
+        status = -3;
+    } else {
+        status  = query_writer_get_object_count(request->output);
+        payload = query_writer_get_output(request->output, &length);
+    }
+
+    char header[2 * sizeof(uint64_t)];
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        header[i]                    = (char) ((uint64_t) status >> (8 * i));
+        header[sizeof(uint64_t) + i] = (char) ((uint64_t) length >> (8 * i));
+    }
+
+    return __server_mode_buffer_append(&client->output, header, sizeof(header)) ||
+           __server_mode_buffer_append(&client->output, payload, length);
+}
+
+/**
+ * @brief   Appends the (rest of the) response to a query of a client that negotiated chunked
+ *          responses.
+ * @details Auxiliary method for ::__server_mode_respond. The response starts with a line with `*`,
+ *          followed by chunks of the query's output, each preceded by a line with its length in
+ *          bytes. A chunk of length `0` ends the output, and is followed by a line with the number
+ *          of lines in the output, or `-3` if the query was stopped. Chunks sent while the query
+ *          ran (see ::__server_mode_stream_chunk) aren't repeated.
+ *
+ * @param client  Client that sent the query.
+ * @param request Query that was run.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or a chunk failed to be sent while the query ran.
+ */
+int __server_mode_respond_chunked(server_mode_client_t        *client,
+                                  const server_mode_request_t *request) {
+    if (request->stream.failed)
+        return 1; /* Part of a chunk may have been sent, and the client can't recover from that */
+
+    size_t            length;
+    const char *const output     = query_writer_get_output(request->output, &length);
+    const int         incomplete = query_writer_is_incomplete(request->output);
+
+    char   line[INT_UTILS_SPRINTF_MIN_BUFFER_SIZE + 2];
+    size_t line_length = 0;
+    if (!request->stream.started && __server_mode_buffer_append(&client->output, "*\n", 2))
+        return 1;
+
+    if (length && !incomplete) {
+        line_length       = int_utils_sprintf_unsigned(line, length);
+        line[line_length] = '\n';
+        if (__server_mode_buffer_append(&client->output, line, line_length + 1) ||
+            __server_mode_buffer_append(&client->output, output, length))
+            return 1;
+    }
+
+    if (incomplete) {
+        return __server_mode_buffer_append(&client->output, "0\n-3\n", 5);
+    } else {
+        const size_t lines = request->stream.lines + __server_mode_count_lines(output, length);
+        line_length        = int_utils_sprintf_unsigned(line, lines);
+        line[line_length]  = '\n';
+        return __server_mode_buffer_append(&client->output, "0\n", 2) ||
+               __server_mode_buffer_append(&client->output, line, line_length + 1);
+    }
+}
+
+/**
+ * @brief Appends the response to a query to the output of the client that sent it.
+ *
+ * @param server  State of the server.
+ * @param client  Client that sent the query.
+ * @param request Query that was run.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __server_mode_respond(const server_mode_t         *server,
+                          server_mode_client_t        *client,
+                          const server_mode_request_t *request) {
+    char   line[INT_UTILS_SPRINTF_MIN_BUFFER_SIZE + 1];
+    size_t line_length;
+
+    if (request->http) {
+        return __server_mode_respond_http(server, client, request);
+    } else if (request->protocol == SERVER_MODE_PROTOCOL_BINARY) {
+        return __server_mode_respond_binary(client, request);
+    } else if (request->rejected) {
+        return __server_mode_buffer_append(&client->output, "-2\n", 3);
+    } else if (request->negotiated) {
+        return __server_mode_buffer_append(&client->output, "0\n", 2);
+    } else if (request->prepared >= 0) {
+        /* One line of output, with the statement's identifier */
+        line_length       = int_utils_sprintf_unsigned(line, request->prepared);
+        line[line_length] = '\n';
+        return __server_mode_buffer_append(&client->output, "1\n", 2) ||
+               __server_mode_buffer_append(&client->output, line, line_length + 1);
+    } else if (!request->output) {
+        return __server_mode_buffer_append(&client->output, "-1\n", 3);
+    } else if (request->protocol == SERVER_MODE_PROTOCOL_CHUNKED) {
+        return __server_mode_respond_chunked(client, request);
+    } else if (query_writer_is_incomplete(request->output)) {
+        return __server_mode_buffer_append(&client->output, "-3\n", 3);
+    }
+
+    size_t                   nlines;
+    const char *const *const lines = query_writer_get_lines(request->output, &nlines);
+
+    line_length       = int_utils_sprintf_unsigned(line, nlines);
+    line[line_length] = '\n';
+    if (__server_mode_buffer_append(&client->output, line, line_length + 1))
+        return 1;
+
+    for (size_t i = 0; i < nlines; ++i)
+        if (__server_mode_buffer_append(&client->output, lines[i], strlen(lines[i])) ||
+            __server_mode_buffer_append(&client->output, "\n", 1))
+            return 1;
+
+    return 0;
+}
+
+/**
+ * @brief   Counts a request in the server's metrics, after it's answered.
+ * @details Auxiliary method for ::__server_mode_respond_ready.
+ *
+ * @param server  State of the server.
+ * @param request Request that was answered.
+ */
+void __server_mode_count_request(server_mode_t *server, const server_mode_request_t *request) {
+    if (request->http)
+        return;
+    else if (request->rejected)
+        server_metrics_count_other_request(server->metrics, SERVER_METRICS_REQUEST_REJECTED);
+    else if (request->prepared >= 0)
+        server_metrics_count_other_request(server->metrics, SERVER_METRICS_REQUEST_PREPARE);
+    else if (request->negotiated)
+        server_metrics_count_other_request(server->metrics, SERVER_METRICS_REQUEST_PROTOCOL);
+    else if (!request->output)
+        server_metrics_count_other_request(server->metrics, SERVER_METRICS_REQUEST_INVALID);
+    else if (query_writer_is_incomplete(request->output))
+        server_metrics_count_other_request(server->metrics, SERVER_METRICS_REQUEST_TIMED_OUT);
+    else
+        server_metrics_count_request(server->metrics,
+                                     request->type,
+                                     __server_mode_get_elapsed(&request->received));
+}
+
+/**
+ * @brief   Appends the responses to all requests that can be answered to the outputs of their
+ *          clients.
+ * @details Responses are sent in the order requests were received, so a request can only be
+ *          answered after all previous requests from the same client.
+ *
+ * @param server State of the server.
+ */
+void __server_mode_respond_ready(server_mode_t *server) {
+    const size_t nclients = server->clients->len;
+    char         blocked[nclients + 1];
+    memset(blocked, 0, nclients + 1);
+
+    for (size_t i = 0; i < server->requests->len; ++i) {
+        server_mode_request_t *const request =
+            &g_array_index(server->requests, server_mode_request_t, i);
+        if (request->responded || blocked[request->client])
+            continue;
+
+        if (request->pending) {
+            blocked[request->client] = 1;
+            continue;
+        }
+
+        server_mode_client_t *const client =
+            &g_array_index(server->clients, server_mode_client_t, request->client);
+        if (__server_mode_respond(server, client, request))
+            client->failed = 1; /* Responses can't be skipped, as they're sent in order */
+        request->responded = 1;
+        __server_mode_count_request(server, request);
+    }
+}
+
+/**
+ * @brief   Loads the dataset into a database, or, in a replica, restores it from the snapshot of
+ *          the primary server.
+ *
+ * @param dataset_dir    Path to the directory containing the dataset (or the replica's snapshot).
+ * @param primary_socket Socket of the primary server, or `NULL` if this server isn't a replica.
+ * @param database       Empty database where to store the dataset's data.
+ * @param progress       Where to register loading progress to. Can be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure. @p database may be partially filled.
+ */
+int __server_mode_load(const char         *dataset_dir,
+                       const char         *primary_socket,
+                       database_t         *database,
+                       dataset_progress_t *progress) {
+    if (!primary_socket)
+        return dataset_loader_load(database, dataset_dir, NULL, NULL, progress);
+
+    return dataset_shipping_fetch(primary_socket, dataset_dir) ||
+           dataset_loader_load_shipped(database, dataset_dir);
+}
+
+/**
+ * @brief   Measures the memory reserved by the database of a dataset.
+ * @details The previous measurement is kept if the memory report can't be allocated.
+ *
+ * @param dataset Dataset in memory, whose ::server_mode_dataset_t::memory is updated.
+ */
+void __server_mode_measure_dataset(server_mode_dataset_t *dataset) {
+    memory_report_t *const report = database_get_memory_report(dataset->database);
+    if (!report)
+        return;
+
+    memory_usage_t usage;
+    memory_report_get_total(report, &usage);
+    dataset->memory = usage.reserved_bytes;
+    memory_report_free(report);
+}
+
+/**
+ * @brief   Loads a dataset into memory.
+ * @details When snapshots are on, datasets are only parsed the first time: afterwards, they're
+ *          restored from the snapshot stored then (see ::dataset_loader_load), unless their files
+ *          changed.
+ *
+ * @param dataset        Dataset not in memory, whose database is to be created.
+ * @param primary_socket Socket of the primary server, or `NULL` if this server isn't a replica.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure. @p dataset is left without a database.
+ */
+int __server_mode_open_dataset(server_mode_dataset_t *dataset, const char *primary_socket) {
+    dataset->database = database_create();
+    if (!dataset->database)
+        return 1;
+
+    if (__server_mode_load(dataset->dataset_dir, primary_socket, dataset->database, NULL)) {
+        database_free(dataset->database);
+        dataset->database = NULL;
+        return 1;
+    }
+
+    dataset->materializer = query_materializer_create(dataset->database);
+    __server_mode_measure_dataset(dataset);
+    return 0;
+}
+
+/**
+ * @brief Frees the database of a dataset, that is loaded again (see ::__server_mode_open_dataset)
+ *        when needed.
+ * @param dataset Dataset in memory, to be evicted.
+ */
+void __server_mode_close_dataset(server_mode_dataset_t *dataset) {
+    if (dataset->materializer)
+        query_materializer_free(dataset->materializer);
+    database_free(dataset->database);
+
+    dataset->materializer = NULL;
+    dataset->database     = NULL;
+    dataset->memory       = 0;
+}
+
+/**
+ * @brief Updates the number of datasets in memory in the server's metrics.
+ * @param server State of the server.
+ */
+void __server_mode_count_resident(server_mode_t *server) {
+    size_t resident = 0;
+    for (size_t i = 0; i < server->ndatasets; ++i)
+        resident += server->datasets[i].database != NULL;
+    server_metrics_set_resident_datasets(server->metrics, resident);
+}
+
+/**
+ * @brief   Restores an evicted dataset, before its queries are run.
+ * @details Queries of all clients wait while the dataset is restored.
+ *
+ * @param server  State of the server.
+ * @param dataset Evicted dataset.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (reported to `stderr`).
+ */
+int __server_mode_activate_dataset(server_mode_t *server, server_mode_dataset_t *dataset) {
+    performance_trace_begin("Restore dataset");
+    const int retval = __server_mode_open_dataset(dataset, server->reload.primary_socket);
+    performance_trace_end();
+
+    server_metrics_count_activation(server->metrics, !retval);
+    if (retval) {
+        fprintf(stderr, "Failed to restore dataset \"%s\"!\n", dataset->name);
+        return 1;
+    }
+
+    __server_mode_count_resident(server);
+    return 0;
+}
+
+/**
+ * @brief   Evicts the least recently used datasets, while those in memory exceed the server's
+ *          budget.
+ * @details The most recently used dataset is never evicted, and neither is one being reloaded in
+ *          the background.
+ *
+ * @param server State of the server.
+ */
+void __server_mode_enforce_budget(server_mode_t *server) {
+    if (!server->resident_budget)
+        return;
+
+    while (1) {
+        size_t                 resident = 0;
+        server_mode_dataset_t *newest   = NULL;
+        for (size_t i = 0; i < server->ndatasets; ++i) {
+            server_mode_dataset_t *const dataset = &server->datasets[i];
+            if (!dataset->database)
+                continue;
+
+            resident += dataset->memory;
+            if (!newest || dataset->last_used > newest->last_used)
+                newest = dataset;
+        }
+        if (resident <= server->resident_budget)
+            return;
+
+        server_mode_dataset_t *oldest = NULL;
+        for (size_t i = 0; i < server->ndatasets; ++i) {
+            server_mode_dataset_t *const dataset = &server->datasets[i];
+            const int reloading = server->reload.state == SERVER_MODE_RELOAD_LOADING &&
+                                  server->reload.dataset == i;
+            if (dataset->database && dataset != newest && !reloading &&
+                (!oldest || dataset->last_used < oldest->last_used))
+                oldest = dataset;
+        }
+        if (!oldest)
+            return;
+
+        __server_mode_close_dataset(oldest);
+        server_metrics_count_eviction(server->metrics);
+        __server_mode_count_resident(server);
+    }
+}
+
+/**
+ * @brief   Loads a new database, in the background.
+ * @details Thread for ::SERVER_MODE_RELOAD_LOADING. Dataset errors aren't written anywhere, as
+ *          they were already reported when the server started.
+ *
+ * @param reload_data A ::server_mode_reload_t.
+ *
+ * @return Always `NULL`.
+ */
+void *__server_mode_reload_load_thread(void *reload_data) {
+    server_mode_reload_t *const reload = reload_data;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (__server_mode_load(reload->dataset_dir,
+                           reload->primary_socket,
+                           reload->database,
+                           reload->progress)) {
+        database_free(reload->database);
+        reload->database = NULL;
+    }
+    reload->duration = __server_mode_get_elapsed(&start);
+
+    __atomic_store_n(&reload->done, 1, __ATOMIC_RELEASE);
+    __server_mode_wakeup();
+    return NULL;
+}
+
+/**
+ * @brief   Frees the database replaced by a reload, in the background.
+ * @details Thread for ::SERVER_MODE_RELOAD_FREEING. Freeing a large database takes a while, and
+ *          that shouldn't delay answering queries.
+ *
+ * @param reload_data A ::server_mode_reload_t.
+ *
+ * @return Always `NULL`.
+ */
+void *__server_mode_reload_free_thread(void *reload_data) {
+    server_mode_reload_t *const reload = reload_data;
+    database_free(reload->database);
+    reload->database = NULL;
+
+    __atomic_store_n(&reload->done, 1, __ATOMIC_RELEASE);
+    __server_mode_wakeup();
+    return NULL;
+}
+
+/**
+ * @brief   Starts reloading the next dataset in the background, after a reload was requested.
+ * @details Evicted datasets are skipped, as they're restored from their current files anyway.
+ *
+ * @param server State of the server.
+ */
+void __server_mode_reload_start(server_mode_t *server) {
+    server_mode_reload_t *const reload = &server->reload;
+
+    size_t next = reload->next;
+    while (next < server->ndatasets && !server->datasets[next].database)
+        next++;
+    if (next >= server->ndatasets) {
+        reload->next = server->ndatasets;
+        return;
+    }
+    reload->dataset     = next;
+    reload->next        = next + 1;
+    reload->dataset_dir = server->datasets[next].dataset_dir;
+
+    reload->done     = 0;
+    reload->database = database_create();
+    reload->progress = dataset_progress_create();
+    if (!reload->database || !reload->progress)
+        goto DEFER_1;
+
+    if (pthread_create(&reload->thread, NULL, __server_mode_reload_load_thread, reload))
+        goto DEFER_1;
+
+    reload->state = SERVER_MODE_RELOAD_LOADING;
+    return;
+
+DEFER_1:
+    fprintf(stderr,
+            "Failed to start reloading dataset \"%s\"!\n",
+            server->datasets[reload->dataset].name);
+    if (reload->database)
+        database_free(reload->database);
+    dataset_progress_free(reload->progress);
+    reload->database = NULL;
+    reload->progress = NULL;
+}
+
+/**
+ * @brief   Replaces the database of a dataset with a newly loaded one.
+ * @details Queries are run by the thread calling this method, between calls to it, so no query
+ *          can be using the old database anymore. The swap itself is just the replacement of a
+ *          pointer, and the old database is freed in the background.
+ *
+ * @param server State of the server, whose reload has just finished loading.
+ */
+void __server_mode_reload_swap(server_mode_t *server) {
+    server_mode_reload_t *const reload = &server->reload;
+    dataset_progress_free(reload->progress);
+    reload->progress = NULL;
+    reload->state    = SERVER_MODE_RELOAD_IDLE;
+
+    server_mode_dataset_t *const dataset = &server->datasets[reload->dataset];
+    server_metrics_count_reload(server->metrics, reload->database != NULL, reload->duration);
+    if (!reload->database) {
+        fprintf(stderr,
+                "Failed to reload the files of dataset \"%s\"! Answering queries with the old "
+                "dataset.\n",
+                dataset->name);
+        return;
+    }
+
+    database_t *const old_database = dataset->database;
+    dataset->database              = reload->database;
+    reload->database               = old_database;
+
+    /* Rendered outputs depend on the old database */
+    if (dataset->materializer)
+        query_materializer_free(dataset->materializer);
+    dataset->materializer = query_materializer_create(dataset->database);
+    __server_mode_measure_dataset(dataset);
+
+    reload->done = 0;
+    if (!old_database) {
+        __server_mode_count_resident(server); /* Nothing to free */
+    } else if (pthread_create(&reload->thread, NULL, __server_mode_reload_free_thread, reload)) {
+        database_free(old_database); /* Slower, but still correct */
+        reload->database = NULL;
+    } else {
+        reload->state = SERVER_MODE_RELOAD_FREEING;
+    }
+}
+
+/**
+ * @brief   Advances the reload of the datasets, if its background thread has finished or a new one
+ *          was requested.
+ * @details Datasets are reloaded one at a time, in order. A reload requested while another one is
+ *          still running restarts from the first dataset after the current one finishes.
+ *
+ * @param server State of the server.
+ */
+void __server_mode_reload_update(server_mode_t *server) {
+    server_mode_reload_t *const reload = &server->reload;
+
+    if (reload->state != SERVER_MODE_RELOAD_IDLE &&
+        __atomic_load_n(&reload->done, __ATOMIC_ACQUIRE)) {
+
+        pthread_join(reload->thread, NULL);
+        if (reload->state == SERVER_MODE_RELOAD_LOADING)
+            __server_mode_reload_swap(server);
+        else
+            reload->state = SERVER_MODE_RELOAD_IDLE;
+    }
+
+    if (server_mode_reload_requested) {
+        server_mode_reload_requested = 0;
+        reload->next                 = 0;
+    }
+    if (reload->state == SERVER_MODE_RELOAD_IDLE && reload->next < server->ndatasets)
+        __server_mode_reload_start(server);
+}
+
+/**
+ * @brief   Waits for the reload of the dataset to finish, when the server is stopped.
+ * @details Loading is cancelled, and the database being loaded is discarded.
+ *
+ * @param server State of the server.
+ */
+void __server_mode_reload_stop(server_mode_t *server) {
+    server_mode_reload_t *const reload = &server->reload;
+    if (reload->state == SERVER_MODE_RELOAD_IDLE)
+        return;
+
+    dataset_progress_cancel(reload->progress);
+    pthread_join(reload->thread, NULL);
+    if (reload->database)
+        database_free(reload->database);
+    dataset_progress_free(reload->progress);
+
+    reload->database = NULL;
+    reload->progress = NULL;
+    reload->state    = SERVER_MODE_RELOAD_IDLE;
+}
+
+/**
+ * @brief Sends as many pending responses as possible to a client.
+ * @param client Client to send data to.
+ */
+void __server_mode_send(server_mode_client_t *client) {
+    while (client->output_sent < client->output.length) {
+        const ssize_t nsent = send(client->fd,
+                                   client->output.data + client->output_sent,
+                                   client->output.length - client->output_sent,
+                                   MSG_NOSIGNAL);
+
+        if (nsent < 0) {
+            if (errno == EINTR)
+                continue;
+            else if (errno != EAGAIN && errno != EWOULDBLOCK)
+                client->failed = 1;
+            return;
+        }
+        client->output_sent += nsent;
+    }
+
+    client->output.length = client->output_sent = 0;
+}
+
+/**
+ * @brief   Keeps the writers of the batch that was run, to be reused by the following batches.
+ * @details Auxiliary method for ::__server_mode_run_batch. Writers past
+ *          ::SERVER_MODE_MAX_SPARE_WRITERS, and those that streamed their output, are freed.
+ *
+ * @param server State of the server.
+ */
+void __server_mode_recycle_writers(server_mode_t *server) {
+    for (size_t i = 0; i < server->requests->len; ++i) {
+        server_mode_request_t *const request =
+            &g_array_index(server->requests, server_mode_request_t, i);
+        if (!request->output)
+            continue;
+
+        GPtrArray *const spare = server->spare_writers[request->protocol];
+        if (!request->stream.enabled && spare->len < SERVER_MODE_MAX_SPARE_WRITERS)
+            g_ptr_array_add(spare, request->output);
+        else
+            query_writer_free(request->output);
+        request->output = NULL;
+    }
+    g_ptr_array_set_size(server->outputs, 0);
+}
+
+/**
+ * @brief   Rejects a query whose dataset couldn't be restored.
+ * @details Callback for ::query_instance_list_iter. The query is answered like when the server is
+ *          overloaded.
+ *
+ * @param user_data State of the server (::server_mode_t).
+ * @param instance  Query to be rejected.
+ *
+ * @return Always `0`.
+ */
+int __server_mode_reject_query(void *user_data, const query_instance_t *instance) {
+    server_mode_t *const         server  = user_data;
+    const size_t                 index   = query_instance_get_line_in_file(instance);
+    server_mode_request_t *const request =
+        &g_array_index(server->requests, server_mode_request_t, index);
+    request->pending  = 0;
+    request->rejected = 1;
+    return 0;
+}
+
+/**
+ * @brief   Makes sure the datasets queries were sent to in the batch being built are in memory.
+ * @details Auxiliary method for ::__server_mode_run_batch. Evicted datasets are restored, and the
+ *          queries of those that can't be are rejected.
+ *
+ * @param server State of the server.
+ *
+ * @return The number of queries that can be run.
+ */
+size_t __server_mode_prepare_datasets(server_mode_t *server) {
+    size_t nqueries = 0;
+    for (size_t i = 0; i < server->ndatasets; ++i) {
+        server_mode_dataset_t *const dataset = &server->datasets[i];
+
+        size_t dataset_queries = 0;
+        for (size_t p = 0; p < SERVER_MODE_PRIORITY_COUNT; ++p)
+            dataset_queries += query_instance_list_get_length(dataset->queries[p]);
+        if (!dataset_queries)
+            continue;
+
+        dataset->last_used = server->batches;
+        if (!dataset->database && __server_mode_activate_dataset(server, dataset)) {
+            for (size_t p = 0; p < SERVER_MODE_PRIORITY_COUNT; ++p)
+                query_instance_list_iter(dataset->queries[p], __server_mode_reject_query, server);
+            continue;
+        }
+        nqueries += dataset_queries;
+    }
+    return nqueries;
+}
+
+/**
+ * @brief   Replaces the lists of queries of all datasets with empty ones, for a new batch.
+ * @details All lists are replaced together (see ::__server_mode_get_arguments).
+ *
+ * @param server State of the server.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (the old lists are kept).
+ */
+int __server_mode_replace_queries(server_mode_t *server) {
+    const size_t           nlists = server->ndatasets * SERVER_MODE_PRIORITY_COUNT;
+    query_instance_list_t *new_queries[nlists];
+    for (size_t i = 0; i < nlists; ++i) {
+        new_queries[i] = query_instance_list_create();
+        if (!new_queries[i]) {
+            for (size_t j = 0; j < i; ++j)
+                query_instance_list_free(new_queries[j]);
+            return 1;
+        }
+    }
+
+    for (size_t i = 0; i < nlists; ++i) {
+        server_mode_dataset_t *const dataset = &server->datasets[i / SERVER_MODE_PRIORITY_COUNT];
+        query_instance_list_free(dataset->queries[i % SERVER_MODE_PRIORITY_COUNT]);
+        dataset->queries[i % SERVER_MODE_PRIORITY_COUNT] = new_queries[i];
+    }
+    return 0;
+}
+
+/**
+ * @brief   Runs all queries received since the last batch, and queues their responses.
+ * @details Queries sent by different clients to the same dataset are run together, so that
+ *          statistical data is shared between them (see ::query_dispatcher_dispatch_list). Each
+ *          ::server_mode_priority_t is run separately, in order, for all datasets, and the
+ *          responses that are ready are sent in between. Afterwards, datasets over the server's
+ *          budget are evicted, and a new empty batch is started.
+ *
+ * @param server State of the server.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __server_mode_run_batch(server_mode_t *server) {
+    if (server->requests->len == 0)
+        return 0;
+
+    int retval = 1;
+    server->batches++;
+    const size_t nqueries = __server_mode_prepare_datasets(server);
+
+    g_ptr_array_set_size(server->outputs, nqueries);
+    query_writer_t **const outputs = (query_writer_t **) server->outputs->pdata;
+    if (nqueries)
+        server_metrics_count_batch(server->metrics, nqueries);
+
+    server_mode_writers_t writers = {.server = server, .outputs = outputs, .i = 0};
+    for (size_t p = 0; p < SERVER_MODE_PRIORITY_COUNT; ++p) {
+        for (size_t d = 0; d < server->ndatasets; ++d) {
+            server_mode_dataset_t *const dataset = &server->datasets[d];
+            query_instance_list_t *const queries = dataset->queries[p];
+            if (!dataset->database || query_instance_list_get_length(queries) == 0)
+                continue;
+
+            query_writer_t **const class_outputs = outputs + writers.i;
+            if (query_instance_list_iter(queries, __server_mode_create_writer, &writers))
+                goto DEFER_1;
+            performance_trace_begin("Batch");
+            query_cancellation_start(server->cancellation,
+                                     query_cancellation_get_default_timeout());
+            query_dispatcher_dispatch_list(dataset->database,
+                                           queries,
+                                           class_outputs,
+                                           dataset->materializer,
+                                           NULL,
+                                           NULL,
+                                           NULL);
+            performance_trace_end();
+
+            /* Clients waiting only for this class are answered before the next one is run */
+            __server_mode_respond_ready(server);
+            for (size_t i = 0; i < server->clients->len; ++i) {
+                server_mode_client_t *const client =
+                    &g_array_index(server->clients, server_mode_client_t, i);
+                if (!client->failed)
+                    __server_mode_send(client);
+            }
+        }
+    }
+
+    __server_mode_respond_ready(server); /* Requests that aren't queries, if there were none */
+    retval = 0;
+
+DEFER_1:
+    __server_mode_recycle_writers(server);
+    g_array_set_size(server->requests, 0);
+    for (size_t i = 0; i < server->clients->len; ++i)
+        g_array_index(server->clients, server_mode_client_t, i).batch_requests = 0;
+
+    /* Statistical data cached while running queries counts towards the budget */
+    for (size_t i = 0; i < server->ndatasets; ++i)
+        if (server->datasets[i].database && server->datasets[i].last_used == server->batches)
+            __server_mode_measure_dataset(&server->datasets[i]);
+    __server_mode_enforce_budget(server);
+
+    return __server_mode_replace_queries(server) || retval;
+}
+
+/**
+ * @brief Disconnects clients that failed, or that finished (or sent an HTTP request) and have
+ *        received all responses.
+ * @param server State of the server.
+ */
+void __server_mode_remove_clients(server_mode_t *server) {
+    const size_t nclients = server->clients->len;
+    for (size_t i = server->clients->len; i > 0; --i) {
+        server_mode_client_t *const client =
+            &g_array_index(server->clients, server_mode_client_t, i - 1);
+
+        const int done = !client->backlogged && client->batch_requests == 0 &&
+                         client->output.length == 0;
+        if (client->failed || ((client->finished || client->http) && done)) {
+            close(client->fd);
+            free(client->input.data);
+            free(client->output.data);
+            g_ptr_array_unref(client->statements);
+            g_array_remove_index(server->clients, i - 1);
+        }
+    }
+
+    /* Closed sockets leave the epoll instance on their own, but other clients may have moved */
+    if (server->clients->len != nclients)
+        for (size_t i = 0; i < server->clients->len; ++i)
+            g_array_index(server->client_indices,
+                          size_t,
+                          g_array_index(server->clients, server_mode_client_t, i).fd) = i;
+}
+
+/**
+ * @brief   Registers the events a client is waiting for in ::server_mode_t::epoll_fd.
+ * @details Auxiliary method for ::__server_mode_loop. Registrations only change (with a system
+ *          call) when a client starts or stops having responses to send, or when it stops being
+ *          read from.
+ *
+ * @param server State of the server.
+ * @param client Client whose events are updated.
+ */
+void __server_mode_update_events(server_mode_t *server, server_mode_client_t *client) {
+    /* Backlogged clients aren't read from, to bound the size of their input */
+    const int readable = !client->finished && !client->backlogged;
+    uint32_t  events   = readable ? EPOLLIN : 0;
+    if (client->output.length)
+        events |= EPOLLOUT;
+
+    if (events != client->events) {
+        struct epoll_event event = {.events = events, .data.fd = client->fd};
+        if (epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, client->fd, &event))
+            client->failed = 1;
+        client->events = events;
+    }
+}
+
+/**
+ * @brief   Calculates how long the server can wait for events before running the current batch.
+ * @details Auxiliary method for ::__server_mode_loop.
+ *
+ * @param server State of the server.
+ *
+ * @return The timeout for `epoll_wait`, in milliseconds (`-1` to wait indefinitely).
+ */
+int __server_mode_get_timeout(const server_mode_t *server) {
+    if (server->requests->len) {
+        const uint64_t elapsed = __server_mode_get_elapsed(&server->batch_start) / 1000;
+        return elapsed >= server->window ? 0 : (int) (server->window - elapsed);
+    }
+
+    /* Lines that didn't fit in the last batch can be parsed right away */
+    for (size_t i = 0; i < server->clients->len; ++i)
+        if (g_array_index(server->clients, server_mode_client_t, i).backlogged)
+            return 0;
+    return -1;
+}
+
+/**
+ * @brief  Waits for events on all sockets and handles them, until the server is stopped.
+ * @param  server State of the server.
+ * @retval 0 The server was stopped by a signal.
+ * @retval 1 Fatal failure.
+ */
+int __server_mode_loop(server_mode_t *server) {
+    while (!server_mode_stop) {
+        __server_mode_reload_update(server);
+
+        const size_t nclients = server->clients->len;
+        server->pending_output = 0;
+        for (size_t i = 0; i < nclients; ++i) {
+            server_mode_client_t *const client =
+                &g_array_index(server->clients, server_mode_client_t, i);
+
+            __server_mode_update_events(server, client);
+            client->revents = 0;
+            server->pending_output += client->output.length - client->output_sent;
+        }
+
+        struct epoll_event events[SERVER_MODE_MAX_EVENTS];
+        const int          timeout = __server_mode_get_timeout(server);
+        const int nevents = epoll_wait(server->epoll_fd, events, SERVER_MODE_MAX_EVENTS, timeout);
+        if (nevents < 0) {
+            if (errno == EINTR)
+                continue;
+            return 1;
+        }
+
+        int accepting = 0, woken_up = 0;
+        for (int i = 0; i < nevents; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == server->listen_fd) {
+                accepting = 1;
+            } else if (fd == server->wakeup_fd) {
+                woken_up = 1;
+            } else {
+                const size_t index = g_array_index(server->client_indices, size_t, fd);
+                g_array_index(server->clients, server_mode_client_t, index).revents =
+                    events[i].events;
+            }
+        }
+
+        if (woken_up) {
+            char buffer[SERVER_MODE_READ_SIZE];
+            while (read(server->wakeup_fd, buffer, SERVER_MODE_READ_SIZE) > 0)
+                ;
+            __server_mode_reload_update(server); /* Before the batch, to use a new database */
+        }
+
+        /* All queries that arrived in the same window are run as a single batch */
+        for (size_t i = 0; i < nclients; ++i) {
+            server_mode_client_t *const client =
+                &g_array_index(server->clients, server_mode_client_t, i);
+
+            if ((client->revents & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !client->finished &&
+                !client->backlogged)
+                __server_mode_receive(client);
+            if (!client->failed && __server_mode_parse_client_input(server, i))
+                return 1;
+        }
+
+        /* A reload in the background mustn't compete for the processor with queries */
+        if (server->requests->len && __server_mode_get_timeout(server) == 0) {
+            const int pause = server->reload.state == SERVER_MODE_RELOAD_LOADING;
+            if (pause)
+                dataset_progress_pause(server->reload.progress);
+            const int batch_retval = __server_mode_run_batch(server);
+            if (pause)
+                dataset_progress_resume(server->reload.progress);
+            if (batch_retval)
+                return 1;
+        }
+
+        for (size_t i = 0; i < nclients; ++i) {
+            server_mode_client_t *const client =
+                &g_array_index(server->clients, server_mode_client_t, i);
+            if (!client->failed)
+                __server_mode_send(client);
+        }
+
+        __server_mode_remove_clients(server);
+
+        if (accepting)
+            __server_mode_accept(server);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief  Creates the pipe used to wake up ::__server_mode_loop.
+ * @param  fds Where to write the read and write ends of the pipe to.
+ * @retval 0 Success.
+ * @retval 1 Failure.
+ */
+int __server_mode_create_wakeup_pipe(int fds[2]) {
+    if (pipe(fds))
+        return 1;
+
+    if (fcntl(fds[0], F_SETFL, O_NONBLOCK) || fcntl(fds[1], F_SETFL, O_NONBLOCK)) {
+        close(fds[0]);
+        close(fds[1]);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Frees the datasets of the server, including their databases and lists of queries.
+ *
+ * @param datasets  Array of datasets to be freed.
+ * @param ndatasets Number of datasets in @p datasets.
+ */
+void __server_mode_free_datasets(server_mode_dataset_t *datasets, size_t ndatasets) {
+    for (size_t i = 0; i < ndatasets; ++i) {
+        server_mode_dataset_t *const dataset = &datasets[i];
+        if (dataset->database)
+            __server_mode_close_dataset(dataset);
+        for (size_t p = 0; p < SERVER_MODE_PRIORITY_COUNT; ++p)
+            if (dataset->queries[p])
+                query_instance_list_free(dataset->queries[p]);
+        free(dataset->name);
+        free(dataset->dataset_dir);
+    }
+    free(datasets);
+}
+
+/**
+ * @brief   Parses the datasets a server is started with.
+ * @details @p spec is either the path of a single dataset, named
+ *          ::SERVER_MODE_DEFAULT_DATASET_NAME, or a comma-separated list of `name=path` entries,
+ *          with unique and non-empty names. Errors are reported to `stderr`.
+ *
+ * @param spec       Datasets given in the command line.
+ * @param allow_list Whether @p spec can be a list (replicas only have one dataset).
+ * @param ndatasets  Where to write the number of datasets to.
+ *
+ * @return An array of datasets without databases, to be freed with ::__server_mode_free_datasets,
+ *         or `NULL` on failure.
+ */
+server_mode_dataset_t *__server_mode_parse_datasets(const char *spec,
+                                                    int         allow_list,
+                                                    size_t     *ndatasets) {
+    const int list = allow_list && strchr(spec, '=');
+    size_t    n    = 1;
+    for (const char *c = spec; list && *c; ++c)
+        n += *c == ',';
+
+    server_mode_dataset_t *const datasets = calloc(n, sizeof(server_mode_dataset_t));
+    if (!datasets) {
+        fputs("Failed to allocate datasets!\n", stderr);
+        return NULL;
+    }
+
+    const char *entry = spec;
+    for (size_t i = 0; i < n; ++i) {
+        const size_t      length = list ? strcspn(entry, ",") : strlen(entry);
+        const char *const equals = list ? memchr(entry, '=', length) : NULL;
+        if (list && (!equals || equals == entry || equals == entry + length - 1)) {
+            fprintf(stderr, "Invalid dataset \"%.*s\"! Use name=path.\n", (int) length, entry);
+            goto DEFER_1;
+        }
+
+        datasets[i].name        = list ? strndup(entry, equals - entry)
+                                       : strdup(SERVER_MODE_DEFAULT_DATASET_NAME);
+        datasets[i].dataset_dir = list ? strndup(equals + 1, entry + length - equals - 1)
+                                       : strdup(entry);
+        if (!datasets[i].name || !datasets[i].dataset_dir) {
+            fputs("Failed to allocate datasets!\n", stderr);
+            goto DEFER_1;
+        }
+
+        for (size_t j = 0; j < i; ++j) {
+            if (strcmp(datasets[j].name, datasets[i].name) == 0) {
+                fprintf(stderr, "Repeated dataset name \"%s\"!\n", datasets[i].name);
+                goto DEFER_1;
+            }
+        }
+        entry += length + 1;
+    }
+
+    *ndatasets = n;
+    return datasets;
+
+DEFER_1:
+    __server_mode_free_datasets(datasets, n);
+    return NULL;
+}
+
+/**
+ * @brief  Reads the budget of memory of datasets from the environment.
+ * @return The value of ::SERVER_MODE_RESIDENT_BUDGET_ENVIRONMENT_VARIABLE in bytes, or `0` if
+ *         datasets aren't evicted. A message is printed to `stderr` if the value is invalid.
+ */
+size_t __server_mode_get_resident_budget(void) {
+    const char *const budget_env = getenv(SERVER_MODE_RESIDENT_BUDGET_ENVIRONMENT_VARIABLE);
+    if (!budget_env)
+        return 0;
+
+    char *end;
+    errno                           = 0;
+    const unsigned long long budget = strtoull(budget_env, &end, 10);
+    if (errno || *end || end == budget_env || budget > SIZE_MAX >> 20) {
+        fputs("Invalid budget of resident datasets! Datasets won't be evicted.\n", stderr);
+        return 0;
+    }
+    return (size_t) budget << 20;
+}
+
+/**
+ * @brief Starts server mode, as a primary server or as a replica.
+ *
+ * @param datasets_spec  Datasets to be served (see ::__server_mode_parse_datasets), or the
+ *                       replica's directory with the snapshot.
+ * @param primary_socket Socket of the primary server, or `NULL` if this server isn't a replica.
+ * @param socket_path    Path of the Unix domain socket to be created.
+ * @param window         Milliseconds to wait for more queries after the first one in a batch.
+ *
+ * @retval 0 Success (the server was stopped by a signal).
+ * @retval 1 Fatal failure (allocation / IO errors).
+ */
+int __server_mode_run(const char  *datasets_spec,
+                      const char  *primary_socket,
+                      const char  *socket_path,
+                      unsigned int window) {
+    int retval = 1;
+
+    size_t                       ndatasets;
+    server_mode_dataset_t *const datasets =
+        __server_mode_parse_datasets(datasets_spec, primary_socket == NULL, &ndatasets);
+    if (!datasets)
+        goto DEFER_1;
+
+    const size_t    resident_budget = __server_mode_get_resident_budget();
+    size_t          resident        = 0;
+    struct timespec load_start;
+    clock_gettime(CLOCK_MONOTONIC, &load_start);
+    for (size_t i = 0; i < ndatasets; ++i) {
+        if (__server_mode_open_dataset(&datasets[i], primary_socket)) {
+            if (primary_socket)
+                fputs("Failed to restore the primary's snapshot!\n", stderr);
+            else
+                fprintf(stderr, "Failed to load the files of dataset \"%s\"!\n", datasets[i].name);
+            __server_mode_free_datasets(datasets, ndatasets);
+            goto DEFER_1;
+        }
+
+        /* Loading a dataset once stores its snapshot (if on), to restore it from when needed */
+        if (i && resident_budget && resident + datasets[i].memory > resident_budget)
+            __server_mode_close_dataset(&datasets[i]);
+        else
+            resident += datasets[i].memory;
+    }
+    const uint64_t load_duration = __server_mode_get_elapsed(&load_start);
+
+    int wakeup_fds[2];
+    if (__server_mode_create_wakeup_pipe(wakeup_fds)) {
+        fputs("Failed to create pipe!\n", stderr);
+        __server_mode_free_datasets(datasets, ndatasets);
+        goto DEFER_1;
+    }
+    server_mode_wakeup_write_fd = wakeup_fds[1];
+
+    /* The start of the batch and the pending output are initialized to 0 */
+    server_mode_t server = {
+        .datasets        = datasets,
+        .ndatasets       = ndatasets,
+        .resident_budget = resident_budget,
+        .batches         = 0,
+        .reload          = {.state          = SERVER_MODE_RELOAD_IDLE,
+                            .done           = 0,
+                            .dataset        = 0,
+                            .next           = ndatasets,
+                            .dataset_dir    = NULL,
+                            .primary_socket = primary_socket,
+                            .database       = NULL,
+                            .progress       = NULL},
+        .wakeup_fd      = wakeup_fds[0],
+        .listen_fd      = __server_mode_listen(socket_path),
+        .epoll_fd       = epoll_create1(0),
+        .clients        = g_array_new(FALSE, FALSE, sizeof(server_mode_client_t)),
+        .client_indices = g_array_new(FALSE, TRUE, sizeof(size_t)),
+        .requests       = g_array_new(FALSE, FALSE, sizeof(server_mode_request_t)),
+        .window         = window,
+        .outputs        = g_ptr_array_new(),
+        .spare_writers  = {NULL},
+        .request_log    = NULL,
+        .metrics        = server_metrics_create(),
+        .shipping       = dataset_shipping_source_create(datasets[0].dataset_dir),
+        .aux_query      = query_instance_create(),
+        .cancellation   = query_cancellation_create()};
+
+    for (size_t p = 0; p < SERVER_MODE_PROTOCOL_COUNT; ++p)
+        server.spare_writers[p] =
+            g_ptr_array_new_with_free_func((GDestroyNotify) query_writer_free);
+
+    int queries_allocated = 1;
+    for (size_t i = 0; i < ndatasets; ++i) {
+        for (size_t p = 0; p < SERVER_MODE_PRIORITY_COUNT; ++p) {
+            datasets[i].queries[p] = query_instance_list_create();
+            queries_allocated &= datasets[i].queries[p] != NULL;
+        }
+    }
+
+    if (server.listen_fd < 0) {
+        fputs("Failed to create server socket!\n", stderr);
+        goto DEFER_2;
+    }
+
+    struct epoll_event listen_event = {.events = EPOLLIN, .data.fd = server.listen_fd};
+    struct epoll_event wakeup_event = {.events = EPOLLIN, .data.fd = server.wakeup_fd};
+    if (server.epoll_fd < 0 ||
+        epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, server.listen_fd, &listen_event) ||
+        epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, server.wakeup_fd, &wakeup_event)) {
+
+        fputs("Failed to create epoll instance!\n", stderr);
+        goto DEFER_3;
+    }
+
+    if (!queries_allocated || !server.aux_query || !server.cancellation) {
+        fputs("Failed to allocate list of queries!\n", stderr);
+        goto DEFER_3;
+    }
+    query_instance_set_cancellation(server.aux_query, server.cancellation);
+
+    if (!server.metrics) {
+        fputs("Failed to allocate server metrics!\n", stderr);
+        goto DEFER_3;
+    }
+    if (!server.shipping) {
+        fputs("Failed to allocate snapshot source!\n", stderr);
+        goto DEFER_3;
+    }
+    server_metrics_set_load_duration(server.metrics, load_duration);
+    __server_mode_count_resident(&server);
+
+    const char *const request_log_path = getenv(SERVER_MODE_REQUEST_LOG_ENVIRONMENT_VARIABLE);
+    if (request_log_path) {
+        server.request_log = fopen(request_log_path, "a");
+        if (!server.request_log) {
+            fprintf(stderr, "Failed to open request log \"%s\"!\n", request_log_path);
+            goto DEFER_3;
+        }
+    }
+
+    if (__server_mode_install_signal_handlers()) {
+        fputs("Failed to install signal handlers!\n", stderr);
+        goto DEFER_3;
+    }
+
+    query_slow_log_t *const slow_log = query_slow_log_get_shared();
+    if (slow_log)
+        query_slow_log_set_text_callback(slow_log, __server_mode_write_query_text, &server);
+
+    retval = __server_mode_loop(&server);
+    if (retval)
+        fputs("Server failure!\n", stderr);
+
+    if (slow_log)
+        query_slow_log_set_text_callback(slow_log, NULL, NULL);
+
+    server_mode_stop = server_mode_reload_requested = 0;
+    for (size_t i = 0; i < server.clients->len; ++i)
+        g_array_index(server.clients, server_mode_client_t, i).failed = 1;
+    __server_mode_remove_clients(&server);
+    __server_mode_reload_stop(&server);
+
+DEFER_3:
+    close(server.listen_fd);
+    unlink(socket_path);
+DEFER_2:
+    if (server.request_log)
+        fclose(server.request_log);
+    server_metrics_free(server.metrics);
+    if (server.shipping)
+        dataset_shipping_source_free(server.shipping);
+    if (server.aux_query)
+        query_instance_free(server.aux_query);
+    if (server.cancellation)
+        query_cancellation_free(server.cancellation);
+    for (size_t p = 0; p < SERVER_MODE_PROTOCOL_COUNT; ++p)
+        g_ptr_array_unref(server.spare_writers[p]);
+    g_ptr_array_unref(server.outputs);
+    g_array_unref(server.requests);
+    g_array_unref(server.client_indices);
+    g_array_unref(server.clients);
+    if (server.epoll_fd >= 0)
+        close(server.epoll_fd);
+
+    /* Signal handlers can still run, and mustn't write to a reused file descriptor */
+    server_mode_wakeup_write_fd = -1;
+    close(wakeup_fds[1]);
+    close(server.wakeup_fd);
+    __server_mode_free_datasets(server.datasets, server.ndatasets);
+DEFER_1:
+    return retval;
+}
+
+int server_mode_run(const char *dataset_dir, const char *socket_path, unsigned int window) {
+    return __server_mode_run(dataset_dir, NULL, socket_path, window);
+}
+
+int server_mode_run_replica(const char  *primary_socket,
+                            const char  *directory,
+                            const char  *socket_path,
+                            unsigned int window) {
+    return __server_mode_run(directory, primary_socket, socket_path, window);
+}
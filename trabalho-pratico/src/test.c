@@ -20,34 +20,788 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "batch_mode.h"
+#include "queries/query_output_compressor.h"
+#include "queries/query_type_list.h"
+#include "testing/page_cache_benchmark.h"
+#include "testing/performance_comparison_output.h"
+#include "testing/performance_memory_sampler.h"
+#include "testing/performance_metrics_export.h"
 #include "testing/performance_metrics_output.h"
+#include "testing/performance_profiler.h"
+#include "testing/performance_scaling.h"
+#include "testing/query_benchmark.h"
+#include "testing/test_equivalence.h"
+#include "testing/test_runner.h"
+#include "utils/int_utils.h"
+#include "utils/pool.h"
+#include "utils/thread_pool.h"
 #include "testing/test_diff_output.h"
 
 /**
- * @brief The entry point to the test program.
- * @retval 0 Success
- * @retval 1 Failure
+ * @brief Exports performance metrics and test results to a file, in a machine-readable format.
+ *
+ * @param path        Path to the file to be created.
+ * @param metrics     Performance metrics to be exported.
+ * @param diff        Differences between generated and expected output.
+ * @param export_func ::performance_metrics_export_json or ::performance_metrics_export_csv.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (reported to `stderr`).
  */
-int main(int argc, char **argv) {
-    if (argc == 4) {
+int __test_export(const char                  *path,
+                  const performance_metrics_t *metrics,
+                  const test_diff_t           *diff,
+                  int (*export_func)(FILE *, const performance_metrics_t *, const test_diff_t *)) {
+    FILE *const file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open \"%s\" for writing!\n", path);
+        return 1;
+    }
+
+    int retval = export_func(file, metrics, diff);
+    if (fclose(file))
+        retval = 1;
+
+    if (retval)
+        fprintf(stderr, "Failed to export performance metrics to \"%s\"!\n", path);
+    return retval;
+}
+
+/**
+ * @brief Exports a thread scaling study to a file, in a machine-readable format.
+ *
+ * @param path        Path to the file to be created.
+ * @param scaling     Scaling study to be exported.
+ * @param export_func ::performance_scaling_export_json or ::performance_scaling_export_csv.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (reported to `stderr`).
+ */
+int __test_export_scaling(const char                  *path,
+                          const performance_scaling_t *scaling,
+                          int (*export_func)(FILE *, const performance_scaling_t *)) {
+    FILE *const file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open \"%s\" for writing!\n", path);
+        return 1;
+    }
+
+    int retval = export_func(file, scaling);
+    if (fclose(file))
+        retval = 1;
+
+    if (retval)
+        fprintf(stderr, "Failed to export scaling study to \"%s\"!\n", path);
+    return retval;
+}
+
+/**
+ * @brief Exports the results of many test scenarios to a file, in a machine-readable format.
+ *
+ * @param path        Path to the file to be created.
+ * @param runner      Test runner whose results are to be exported.
+ * @param export_func ::test_runner_export_json or ::test_runner_export_csv.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (reported to `stderr`).
+ */
+int __test_export_runner(const char          *path,
+                         const test_runner_t *runner,
+                         int (*export_func)(FILE *, const test_runner_t *)) {
+    FILE *const file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open \"%s\" for writing!\n", path);
+        return 1;
+    }
+
+    int retval = export_func(file, runner);
+    if (fclose(file))
+        retval = 1;
+
+    if (retval)
+        fprintf(stderr, "Failed to export test results to \"%s\"!\n", path);
+    return retval;
+}
+
+/**
+ * @brief Runs batch mode multiple times, adding each run to a comparison with a baseline and to a
+ *        page cache benchmark.
+ *
+ * @param dataset_dir     Path to the directory containing the dataset.
+ * @param query_file_path Path to the file containing the queries.
+ * @param repetitions     Number of times to run batch mode (at least `1`).
+ * @param comparison      Comparison to add each run to. Can be `NULL`.
+ * @param page_cache      Page cache benchmark to prepare and add each run to. Can be `NULL`.
+ * @param packed          Whether to write all query outputs to a single file (see
+ *                        ::batch_mode_run_packed).
+ * @param query_mode      How to measure query executions.
+ * @param sampling        Sampling interval of query executions (see
+ *                        ::performance_metrics_set_query_sampling).
+ *
+ * @return The performance metrics of the last run, or `NULL` on failure (reported to `stderr`).
+ */
+performance_metrics_t *__test_run(const char                      *dataset_dir,
+                                  const char                      *query_file_path,
+                                  size_t                           repetitions,
+                                  performance_comparison_t        *comparison,
+                                  page_cache_benchmark_t          *page_cache,
+                                  int                              packed,
+                                  performance_metrics_query_mode_t query_mode,
+                                  size_t                           sampling) {
+    for (size_t i = 0; i < repetitions; ++i) {
         performance_metrics_t *const metrics = performance_metrics_create();
         if (!metrics) {
             fputs("Failed to allocate performance metrics!\n", stderr);
-            return 1;
+            return NULL;
         }
+        performance_metrics_set_query_sampling(metrics, query_mode, sampling);
+        performance_metrics_measure_query_overhead(metrics);
 
-        const int retval = batch_mode_run(argv[1], argv[2], metrics);
-        if (retval) {
+        if (page_cache && page_cache_benchmark_prepare_run(page_cache)) {
+            fputs("Failed to prepare the page cache for a run!\n", stderr);
             performance_metrics_free(metrics);
-            return retval;
+            return NULL;
         }
 
+        const int retval = packed ? batch_mode_run_packed(dataset_dir, query_file_path, metrics)
+                                  : batch_mode_run(dataset_dir, query_file_path, metrics);
+        if (retval) {
+            performance_metrics_free(metrics);
+            return NULL;
+        }
         performance_metrics_measure_whole_program(metrics);
-        performance_metrics_output_print(stdout, metrics);
+        if (page_cache)
+            page_cache_benchmark_add_run(page_cache, metrics);
+
+        if (comparison && performance_comparison_add_run(comparison, metrics)) {
+            fputs("Failed to compare performance with the baseline!\n", stderr);
+            performance_metrics_free(metrics);
+            return NULL;
+        }
+
+        if (i == repetitions - 1)
+            return metrics;
+        performance_metrics_free(metrics);
+    }
+
+    return NULL; /* Unreachable */
+}
+
+/**
+ * @brief  Gets the current value of the system's monotonic clock.
+ * @return The value of the clock in microseconds.
+ */
+uint64_t __test_get_time(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000 + time.tv_nsec / 1000;
+}
+
+/**
+ * @brief   Runs batch mode with 1, 2, 4, ... threads, and reports how each phase scales.
+ * @details See [performance_scaling](@ref performance_scaling.h). The outputs of every run are
+ *          compared with the expected ones, as a number of threads with wrong results must not be
+ *          mistaken for a fast one.
+ *
+ * @param dataset_dir     Path to the directory containing the dataset.
+ * @param query_file_path Path to the file containing the queries.
+ * @param expected_dir    Path to the directory containing the expected outputs.
+ * @param max_threads     Largest number of threads to run batch mode with.
+ * @param repetitions     Number of runs with each number of threads (at least `1`).
+ * @param packed          Whether to write all query outputs to a single file (see
+ *                        ::batch_mode_run_packed).
+ * @param query_mode      How to measure query executions.
+ * @param sampling        Sampling interval of query executions (see
+ *                        ::performance_metrics_set_query_sampling).
+ * @param json_path       Path of the JSON file to export the study to. Can be `NULL`.
+ * @param csv_path        Path of the CSV file to export the study to. Can be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure, or wrong results with any number of threads (reported to `stderr`).
+ */
+int __test_scaling(const char                      *dataset_dir,
+                   const char                      *query_file_path,
+                   const char                      *expected_dir,
+                   size_t                           max_threads,
+                   size_t                           repetitions,
+                   int                              packed,
+                   performance_metrics_query_mode_t query_mode,
+                   size_t                           sampling,
+                   const char                      *json_path,
+                   const char                      *csv_path) {
+    performance_scaling_t *const scaling = performance_scaling_create(max_threads);
+    if (!scaling) {
+        fputs("Failed to allocate scaling study!\n", stderr);
+        return 1;
+    }
+
+    /* The shared pool is created with all threads, and its loops then use fewer of them */
+    thread_pool_set_default_thread_count(max_threads);
+    thread_pool_get_shared();
+
+    int retval = 0;
+    for (size_t i = 0; i < performance_scaling_get_step_count(scaling); ++i) {
+        const size_t nthreads = performance_scaling_get_threads(scaling, i);
+        thread_pool_set_default_thread_count(nthreads);
+
+        for (size_t j = 0; j < repetitions; ++j) {
+            const uint64_t               start   = __test_get_time();
+            performance_metrics_t *const metrics = __test_run(dataset_dir,
+                                                              query_file_path,
+                                                              1,
+                                                              NULL,
+                                                              NULL,
+                                                              packed,
+                                                              query_mode,
+                                                              sampling);
+            if (!metrics) {
+                performance_scaling_free(scaling);
+                return 1;
+            }
+
+            const uint64_t     diff_start = __test_get_time();
+            test_diff_t *const diff =
+                test_diff_create(packed ? BATCH_MODE_PACK_PATH : "Resultados", expected_dir);
+            const uint64_t diff_end = __test_get_time();
+            if (!diff) {
+                fputs("Failed to compare generated and expected results!\n", stderr);
+                performance_metrics_free(metrics);
+                performance_scaling_free(scaling);
+                return 1;
+            }
+
+            if (test_diff_has_differences(diff)) {
+                fprintf(stderr, "Wrong results with %zu thread(s)!\n", nthreads);
+                retval = 1;
+            }
+
+            performance_scaling_add_run(scaling,
+                                        i,
+                                        metrics,
+                                        diff_start - start,
+                                        diff_end - diff_start);
+            performance_metrics_free(metrics);
+            test_diff_free(diff);
+        }
+    }
+
+    performance_scaling_print(stdout, scaling);
+
+    if (json_path && __test_export_scaling(json_path, scaling, performance_scaling_export_json))
+        retval = 1;
+    if (csv_path && __test_export_scaling(csv_path, scaling, performance_scaling_export_csv))
+        retval = 1;
+
+    performance_scaling_free(scaling);
+    return retval;
+}
+
+/**
+ * @brief   Runs all test scenarios in a manifest, and reports their results together.
+ * @details See [test_runner](@ref test_runner.h).
+ *
+ * @param manifest_path Path to the manifest of test scenarios.
+ * @param work_dir      Directory where each scenario's directory is created.
+ * @param jobs          Maximum number of scenarios running at the same time (at least `1`).
+ * @param query_mode    How to measure query executions.
+ * @param sampling      Sampling interval of query executions (see
+ *                      ::performance_metrics_set_query_sampling).
+ * @param json_path     Path of the JSON file to export all results to. Can be `NULL`.
+ * @param csv_path      Path of the CSV file to export all results to. Can be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure, or wrong results in any scenario.
+ */
+int __test_manifest(const char                      *manifest_path,
+                    const char                      *work_dir,
+                    size_t                           jobs,
+                    performance_metrics_query_mode_t query_mode,
+                    size_t                           sampling,
+                    const char                      *json_path,
+                    const char                      *csv_path) {
+    test_runner_t *const runner = test_runner_create(manifest_path);
+    if (!runner)
+        return 1;
+
+    int retval = test_runner_run(runner, work_dir, jobs, query_mode, sampling);
+    test_runner_print(stdout, runner);
+    if (!test_runner_passed(runner))
+        retval = 1;
+
+    if (json_path && __test_export_runner(json_path, runner, test_runner_export_json))
+        retval = 1;
+    if (csv_path && __test_export_runner(csv_path, runner, test_runner_export_csv))
+        retval = 1;
+
+    test_runner_free(runner);
+    return retval;
+}
+
+/**
+ * @brief   Runs batch mode in a serial reference configuration and in optimized ones, and compares
+ *          their outputs and times.
+ * @details See [test_equivalence](@ref test_equivalence.h).
+ *
+ * @param configurations  Comma-separated list of optimized configurations.
+ * @param dataset_dir     Path to the directory containing the dataset.
+ * @param query_file_path Path to the file containing the queries.
+ * @param work_dir        Directory where each configuration's directory is created.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure, or different outputs in any configuration.
+ */
+int __test_verify(const char *configurations,
+                  const char *dataset_dir,
+                  const char *query_file_path,
+                  const char *work_dir) {
+    test_equivalence_t *const equivalence = test_equivalence_create(configurations);
+    if (!equivalence) {
+        fprintf(stderr,
+                "Invalid list of configurations \"%s\" (or out of memory)!\n",
+                configurations);
+        return 1;
+    }
+
+    int retval = test_equivalence_run(equivalence, dataset_dir, query_file_path, work_dir);
+    test_equivalence_print(stdout, equivalence);
+    if (!test_equivalence_passed(equivalence))
+        retval = 1;
+
+    test_equivalence_free(equivalence);
+    return retval;
+}
+
+/**
+ * @brief   The entry point to the test program.
+ * @details `--small-pages` keeps the database from being backed by huge pages, so that the
+ *          performance of both kinds of pages can be compared. `--json [file]` and `--csv [file]`
+ *          also export the results in a machine-readable format (see
+ *          [performance_metrics_export](@ref performance_metrics_export.h)). `--packed` writes
+ *          all query outputs to a single file (see ::batch_mode_run_packed), which is then
+ *          compared with the expected output directory. `--compress` and
+ *          `--compress-dictionary [file]` compress every output file (see
+ *          [query_output_compressor](@ref query_output_compressor.h)), and report how much was
+ *          saved and how long compressing took.
+ *
+ *          Measuring memory and hardware counters around every query has a noticeable overhead.
+ *          `--light-metrics` only measures each query's CPU time, and `--sample [n]` only measures
+ *          one in every `n` executions of each query type. The overhead of each measurement mode
+ *          is reported with the results. `--threads [n]` chooses how many threads parallel parts
+ *          of the program use, `--stage-threads [list]` limits the threads of each stage (such as
+ *          `load=4,queries=8,diff=2`), `--cpus [list]` the CPUs the program runs on (such as
+ *          `0-3,8`), and `--pin` pins threads to a CPU each (see
+ *          [thread_pool](@ref thread_pool.h)). The chosen topology is printed with the results.
+ *          `--profile [directory]` samples the backtraces of the program, printing the hottest
+ *          function of each phase and writing folded stacks of each phase to the directory (see
+ *          [performance_profiler](@ref performance_profiler.h)). `--memory-timeline [file]`
+ *          samples the memory usage of the process every millisecond, printing the peak of each
+ *          phase and writing the timeline to a CSV file (see
+ *          [performance_memory_sampler](@ref performance_memory_sampler.h)).
+ *
+ *          `--compare [file]` compares performance with a baseline exported with `--csv`, running
+ *          the program `--repetitions` times (default: 5), and failing if any phase is slower
+ *          than in the baseline by more than `--threshold` percent (default: 10). See
+ *          [performance_comparison](@ref performance_comparison.h).
+ *
+ *          `--page-cache [cold|warm|both]` evicts the dataset's files from the page cache, or reads
+ *          them into it, before each of `--repetitions` runs (alternating both kinds of runs), and
+ *          reports the dataset loading times of each kind, to separate the time spent reading
+ *          from storage from the time spent parsing (see
+ *          [page_cache_benchmark](@ref page_cache_benchmark.h)).
+ *
+ *          `--isolate [type]` loads the dataset once and runs only the queries of a type in the
+ *          query file, `--repetitions` times, reporting statistics generation and query execution
+ *          separately (see [query_benchmark](@ref query_benchmark.h)). `--isolate-line [n]` does
+ *          the same for the query in a single line, and `--cold` also measures executions right
+ *          after statistical data is generated again. No expected output directory is needed.
+ *
+ *          `--scaling [n]` runs the program with 1, 2, 4, ... and `n` threads, `--repetitions`
+ *          times each (default: 1), and reports the wall-clock time, speedup and parallel
+ *          efficiency of each phase (see [performance_scaling](@ref performance_scaling.h)).
+ *          `--json` and `--csv` then export the scaling study instead of the metrics of a run.
+ *          It can't be combined with `--compare`, `--page-cache`, `--profile` or
+ *          `--memory-timeline`.
+ *
+ *          `--manifest [file]` runs every test scenario (dataset, query file and expected output
+ *          directory) in a manifest, loading each dataset only once for all scenarios that use it,
+ *          and running up to `--jobs` scenarios at the same time (default: the number of threads).
+ *          Each scenario's outputs and results are placed in its own directory, inside the
+ *          directory given instead of the usual arguments, and `--json` and `--csv` export the
+ *          results of all scenarios (see [test_runner](@ref test_runner.h)). It can only be
+ *          combined with `--light-metrics`, `--sample`, `--threads`, `--stage-threads`, `--cpus`,
+ *          `--pin` and `--small-pages`.
+ *
+ *          `--verify [list]` runs the program in a serial reference configuration and in each
+ *          optimized configuration in a list (such as `parallel,simd` or `all`), and fails if any
+ *          of them doesn't give the same outputs as the reference (see
+ *          [test_equivalence](@ref test_equivalence.h)). Each configuration's outputs and
+ *          differences are placed in its own directory, inside the directory given instead of the
+ *          expected output directory, and the time of each configuration is reported next to the
+ *          reference's. `--threads` chooses the threads of parallel configurations, and other
+ *          options can't be used. Each configuration is run by executing the program again, with
+ *          ::TEST_EQUIVALENCE_CONFIGURATION_OPTION.
+ *
+ * @retval 0 Success
+ * @retval 1 Failure, or performance regression found.
+ */
+int main(int argc, char **argv) {
+    const char *json_path = NULL, *csv_path = NULL, *baseline_path = NULL, *profile_path = NULL;
+    const char *memory_path = NULL, *dictionary_path = NULL;
+    int         compress    = 0;
+    uint64_t    repetitions = 5;
+    double      threshold   = 10.0;
+    int         packed      = 0;
+    uint64_t    sampling    = 1;
+    int         page_cache  = 0;
+    uint64_t    scaling     = 0;
+    int         repeated    = 0;
+    uint64_t    jobs        = 0;
+
+    const char *manifest_path = NULL, *verify_list = NULL;
 
-        test_diff_t *const diff = test_diff_create("Resultados", argv[3]);
+    page_cache_benchmark_mode_t page_cache_mode = PAGE_CACHE_BENCHMARK_MODE_BOTH;
+
+    query_benchmark_options_t isolate = {.type = 0, .line = 0, .repetitions = 0, .cold = 0};
+
+    performance_metrics_query_mode_t query_mode = PERFORMANCE_METRICS_QUERY_MODE_FULL;
+
+    if (argc == 5 && strcmp(argv[1], TEST_EQUIVALENCE_CONFIGURATION_OPTION) == 0)
+        return test_equivalence_run_configuration(argv[2], argv[3], argv[4]);
+
+    int other_options = 0; /* Options other than --threads and --verify, incompatible with them */
+    while (argc > 1 && strncmp(argv[1], "--", 2) == 0) {
+        if (strcmp(argv[1], "--threads") && strcmp(argv[1], "--verify"))
+            other_options = 1;
+
+        if (strcmp(argv[1], "--small-pages") == 0) {
+            pool_set_huge_pages_enabled(0);
+            argc--;
+            argv++;
+        } else if (strcmp(argv[1], "--packed") == 0) {
+            packed = 1;
+            argc--;
+            argv++;
+        } else if (strcmp(argv[1], "--compress") == 0) {
+            compress = 1;
+            argc--;
+            argv++;
+        } else if (argc > 2 && strcmp(argv[1], "--compress-dictionary") == 0) {
+            compress        = 1;
+            dictionary_path = argv[2];
+            argc -= 2;
+            argv += 2;
+        } else if (strcmp(argv[1], "--cold") == 0) {
+            isolate.cold = 1;
+            argc--;
+            argv++;
+        } else if (strcmp(argv[1], "--light-metrics") == 0) {
+            query_mode = PERFORMANCE_METRICS_QUERY_MODE_LIGHT;
+            argc--;
+            argv++;
+        } else if (argc > 2 && strcmp(argv[1], "--sample") == 0) {
+            if (int_utils_parse_positive(&sampling, argv[2]) || sampling == 0) {
+                argc = 0; /* Invalid number: print usage */
+                break;
+            }
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--threads") == 0) {
+            uint64_t nthreads;
+            if (int_utils_parse_positive(&nthreads, argv[2]) || nthreads == 0) {
+                argc = 0; /* Invalid number: print usage */
+                break;
+            }
+            thread_pool_set_default_thread_count(nthreads);
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--stage-threads") == 0) {
+            if (thread_pool_set_stage_thread_counts(argv[2])) {
+                argc = 0; /* Invalid list: print usage */
+                break;
+            }
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--cpus") == 0) {
+            if (thread_pool_set_cpus(argv[2])) {
+                argc = 0; /* Invalid list: print usage */
+                break;
+            }
+            argc -= 2;
+            argv += 2;
+        } else if (strcmp(argv[1], "--pin") == 0) {
+            thread_pool_set_pinning(1);
+            argc--;
+            argv++;
+        } else if (argc > 2 && strcmp(argv[1], "--json") == 0) {
+            json_path = argv[2];
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--csv") == 0) {
+            csv_path = argv[2];
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--profile") == 0) {
+            profile_path = argv[2];
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--memory-timeline") == 0) {
+            memory_path = argv[2];
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--page-cache") == 0) {
+            if (strcmp(argv[2], "cold") == 0) {
+                page_cache_mode = PAGE_CACHE_BENCHMARK_MODE_COLD;
+            } else if (strcmp(argv[2], "warm") == 0) {
+                page_cache_mode = PAGE_CACHE_BENCHMARK_MODE_WARM;
+            } else if (strcmp(argv[2], "both") == 0) {
+                page_cache_mode = PAGE_CACHE_BENCHMARK_MODE_BOTH;
+            } else {
+                argc = 0; /* Invalid mode: print usage */
+                break;
+            }
+            page_cache = 1;
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--compare") == 0) {
+            baseline_path = argv[2];
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--repetitions") == 0) {
+            if (int_utils_parse_positive(&repetitions, argv[2]) || repetitions == 0) {
+                argc = 0; /* Invalid number: print usage */
+                break;
+            }
+            repeated = 1;
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--scaling") == 0) {
+            if (int_utils_parse_positive(&scaling, argv[2]) || scaling == 0) {
+                argc = 0; /* Invalid number: print usage */
+                break;
+            }
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--manifest") == 0) {
+            manifest_path = argv[2];
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--jobs") == 0) {
+            if (int_utils_parse_positive(&jobs, argv[2]) || jobs == 0) {
+                argc = 0; /* Invalid number: print usage */
+                break;
+            }
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--isolate") == 0) {
+            uint64_t type;
+            if (int_utils_parse_positive(&type, argv[2]) || type == 0 ||
+                type > QUERY_TYPE_LIST_COUNT) {
+                argc = 0; /* Invalid number: print usage */
+                break;
+            }
+            isolate.type = type;
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--isolate-line") == 0) {
+            uint64_t line;
+            if (int_utils_parse_positive(&line, argv[2]) || line == 0) {
+                argc = 0; /* Invalid number: print usage */
+                break;
+            }
+            isolate.line = line;
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--verify") == 0) {
+            verify_list = argv[2];
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 2 && strcmp(argv[1], "--threshold") == 0) {
+            char *end;
+            threshold = strtod(argv[2], &end);
+            if (end == argv[2] || *end) {
+                argc = 0; /* Invalid number: print usage */
+                break;
+            }
+            argc -= 2;
+            argv += 2;
+        } else {
+            argc = 0; /* Unknown or invalid option: print usage */
+            break;
+        }
+    }
+
+    if (scaling && (baseline_path || page_cache || profile_path || memory_path))
+        argc = 0; /* Incompatible options: print usage */
+    if (compress && (scaling || manifest_path || isolate.type || isolate.line))
+        argc = 0; /* Incompatible options: print usage */
+    if (manifest_path && (scaling || baseline_path || page_cache || profile_path || memory_path ||
+                          packed || isolate.type || isolate.line))
+        argc = 0; /* Incompatible options: print usage */
+
+    if (verify_list && other_options)
+        argc = 0; /* Incompatible options: print usage */
+
+    if (argc == 4 && verify_list) {
+        return __test_verify(verify_list, argv[1], argv[2], argv[3]);
+    } else if (argc == 2 && manifest_path) {
+        return __test_manifest(manifest_path,
+                               argv[1],
+                               jobs ? jobs : thread_pool_get_default_thread_count(),
+                               query_mode,
+                               sampling,
+                               json_path,
+                               csv_path);
+    } else if (argc == 3 && (isolate.type || isolate.line)) {
+        isolate.repetitions = repetitions;
+        return query_benchmark_run(stdout, argv[1], argv[2], &isolate);
+    } else if (argc == 4 && scaling) {
+        return __test_scaling(argv[1],
+                              argv[2],
+                              argv[3],
+                              scaling,
+                              repeated ? repetitions : 1,
+                              packed,
+                              query_mode,
+                              sampling,
+                              json_path,
+                              csv_path);
+    } else if (argc == 4) {
+        performance_comparison_t *comparison = NULL;
+        if (baseline_path) {
+            comparison = performance_comparison_create(baseline_path, threshold);
+            if (!comparison) {
+                fprintf(stderr, "Failed to load baseline from \"%s\"!\n", baseline_path);
+                return 1;
+            }
+        } else if (!page_cache) {
+            repetitions = 1;
+        }
+
+        page_cache_benchmark_t *page_cache_benchmark = NULL;
+        if (page_cache) {
+            page_cache_benchmark =
+                page_cache_benchmark_create(argv[1], page_cache_mode, repetitions);
+            if (!page_cache_benchmark) {
+                fputs("Failed to allocate page cache benchmark!\n", stderr);
+                if (comparison)
+                    performance_comparison_free(comparison);
+                return 1;
+            }
+        }
+
+        performance_profiler_t *profiler = NULL;
+        if (profile_path) {
+            profiler = performance_profiler_start();
+            if (!profiler) {
+                fputs("Failed to start the sampling profiler!\n", stderr);
+                if (comparison)
+                    performance_comparison_free(comparison);
+                page_cache_benchmark_free(page_cache_benchmark);
+                return 1;
+            }
+        }
+
+        performance_memory_sampler_t *memory_sampler = NULL;
+        if (memory_path) {
+            memory_sampler = performance_memory_sampler_start(PERFORMANCE_MEMORY_SAMPLER_INTERVAL);
+            if (!memory_sampler) {
+                fputs("Failed to start sampling memory usage!\n", stderr);
+                if (comparison)
+                    performance_comparison_free(comparison);
+                page_cache_benchmark_free(page_cache_benchmark);
+                performance_profiler_free(profiler);
+                return 1;
+            }
+        }
+
+        query_output_compressor_t *compressor = NULL;
+        if (compress) {
+            compressor = query_output_compressor_create(dictionary_path);
+            if (!compressor) {
+                fputs("Failed to create output compressor!\n", stderr);
+                if (comparison)
+                    performance_comparison_free(comparison);
+                page_cache_benchmark_free(page_cache_benchmark);
+                performance_profiler_free(profiler);
+                performance_memory_sampler_free(memory_sampler);
+                return 1;
+            }
+            query_output_compressor_set_shared(compressor);
+        }
+
+        performance_metrics_t *const metrics =
+            __test_run(argv[1],
+                       argv[2],
+                       repetitions,
+                       comparison,
+                       page_cache_benchmark,
+                       packed,
+                       query_mode,
+                       sampling);
+        query_output_compressor_set_shared(NULL);
+        if (profiler)
+            performance_profiler_stop(profiler);
+        if (memory_sampler)
+            performance_memory_sampler_stop(memory_sampler);
+        if (!metrics) {
+            if (comparison)
+                performance_comparison_free(comparison);
+            page_cache_benchmark_free(page_cache_benchmark);
+            performance_profiler_free(profiler);
+            performance_memory_sampler_free(memory_sampler);
+            query_output_compressor_free(compressor);
+            return 1;
+        }
+
+        int retval = 0;
+        if (comparison) {
+            performance_comparison_output_print(stdout, comparison);
+            retval = performance_comparison_has_regressions(comparison);
+            performance_comparison_free(comparison);
+        } else {
+            performance_metrics_output_print(stdout, metrics);
+        }
+
+        if (page_cache_benchmark) {
+            page_cache_benchmark_print(stdout, page_cache_benchmark);
+            page_cache_benchmark_free(page_cache_benchmark);
+        }
+
+        if (profiler) {
+            performance_profiler_print(stdout, profiler);
+            if (performance_profiler_write(profiler, profile_path)) {
+                fprintf(stderr, "Failed to write profile to \"%s\"!\n", profile_path);
+                retval = 1;
+            }
+            performance_profiler_free(profiler);
+        }
+
+        if (memory_sampler) {
+            performance_memory_sampler_print(stdout, memory_sampler);
+            if (performance_memory_sampler_write(memory_sampler, memory_path)) {
+                fprintf(stderr, "Failed to write memory timeline to \"%s\"!\n", memory_path);
+                retval = 1;
+            }
+            performance_memory_sampler_free(memory_sampler);
+        }
+
+        /* The dictionary is needed to compare the outputs */
+        if (compressor) {
+            query_output_compressor_print_statistics(stdout, compressor);
+            if (query_output_compressor_save_dictionary(compressor, "Resultados")) {
+                fputs("Failed to save compression dictionary!\n", stderr);
+                retval = 1;
+            }
+            query_output_compressor_free(compressor);
+        }
+
+        test_diff_t *const diff =
+            test_diff_create(packed ? BATCH_MODE_PACK_PATH : "Resultados", argv[3]);
         if (!diff) {
             fputs("Failed to compare generated and expected results!\n", stderr);
             performance_metrics_free(metrics);
@@ -55,12 +809,76 @@ int main(int argc, char **argv) {
         }
         test_diff_output_print(stdout, diff);
 
+        if (json_path && __test_export(json_path, metrics, diff, performance_metrics_export_json))
+            retval = 1;
+        if (csv_path && __test_export(csv_path, metrics, diff, performance_metrics_export_csv))
+            retval = 1;
+
         performance_metrics_free(metrics);
         test_diff_free(diff);
-        return 0;
+        return retval;
     } else {
         fputs("Invalid command-line arguments! Usage:\n", stderr);
-        fputs("./programa-testes [dataset] [query file] [expected output directory]\n", stderr);
+        fputs("./programa-testes [options] [dataset] [query file] [expected output directory]\n",
+              stderr);
+        fputs("./programa-testes [--isolate [type] | --isolate-line [n]] [options] [dataset] "
+              "[query file]\n",
+              stderr);
+        fputs("./programa-testes --manifest [file] [options] [work directory]\n", stderr);
+        fputs("./programa-testes --verify [list] [--threads [n]] [dataset] [query file] "
+              "[work directory]\n\n",
+              stderr);
+        fputs("Options:\n", stderr);
+        fputs("  --small-pages      Don't back the database with huge pages\n", stderr);
+        fputs("  --packed           Write all query outputs to " BATCH_MODE_PACK_PATH "\n",
+              stderr);
+        fputs("  --compress         Compress every output file with zstd\n", stderr);
+        fputs("  --compress-dictionary [file]\n"
+              "                     Compress every output file with zstd and a dictionary\n",
+              stderr);
+        fputs("  --light-metrics    Only measure the CPU time of each query execution\n", stderr);
+        fputs("  --sample [n]       Only measure 1 in every n executions of each query type\n",
+              stderr);
+        fputs("  --threads [n]      Number of threads (1 for deterministic, sequential runs)\n",
+              stderr);
+        fputs("  --stage-threads [load=n,queries=n,diff=n]\n"
+              "                     Limit the number of threads of each stage\n",
+              stderr);
+        fputs("  --cpus [list]      Only run on some CPUs, such as 0-3,8\n", stderr);
+        fputs("  --pin              Pin each thread to a CPU\n", stderr);
+        fputs("  --json [file]      Export results to a JSON file\n", stderr);
+        fputs("  --csv [file]       Export results to a CSV file\n", stderr);
+        fputs("  --profile [dir]    Write folded stacks of sampled backtraces per phase to dir\n",
+              stderr);
+        fputs("  --memory-timeline [file]\n"
+              "                     Write a CSV timeline of memory usage, sampled every ms\n",
+              stderr);
+        fputs("  --compare [file]   Compare performance with a baseline exported with --csv\n",
+              stderr);
+        fputs("  --page-cache [cold|warm|both]\n"
+              "                     Evict or read dataset files before each of --repetitions\n"
+              "                     runs, and compare their loading times\n",
+              stderr);
+        fputs("  --repetitions [n]  Number of runs with --compare or --page-cache (default: 5)\n",
+              stderr);
+        fputs("  --scaling [n]      Run with 1, 2, 4, ... n threads, and report each phase's\n"
+              "                     speedup (--repetitions runs each, default: 1)\n",
+              stderr);
+        fputs("  --manifest [file]  Run every scenario in a manifest, sharing loaded datasets\n",
+              stderr);
+        fputs("  --jobs [n]         Scenarios running at once with --manifest (default: threads)\n",
+              stderr);
+        fputs("  --verify [list]    Compare the outputs of optimized configurations (parallel,\n"
+              "                     simd, specialized, packed, combined or all) with a serial\n"
+              "                     reference, and report their times\n",
+              stderr);
+        fputs("  --threshold [%]    Maximum slowdown compared to the baseline (default: 10)\n",
+              stderr);
+        fputs("  --isolate [type]   Only run the queries of a type, --repetitions times\n",
+              stderr);
+        fputs("  --isolate-line [n] Only run the query in line n, --repetitions times\n", stderr);
+        fputs("  --cold             With --isolate, also regenerate statistics before every run\n",
+              stderr);
         return 1;
     }
 }
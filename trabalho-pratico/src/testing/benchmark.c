@@ -0,0 +1,176 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  benchmark.c
+ * @brief Implementation of methods in include/testing/benchmark.h
+ *
+ * ### Example
+ * See [the header file's documentation](@ref benchmark_example).
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "testing/benchmark.h"
+#include "testing/performance_event.h"
+
+/**
+ * @brief   Where ::benchmark_consume writes values to.
+ * @details `volatile`, so that writes can't be removed.
+ */
+volatile uint64_t benchmark_sink = 0;
+
+void benchmark_consume(uint64_t value) {
+    benchmark_sink += value;
+}
+
+/**
+ * @brief   Comparison function, for `qsort` of an array of `double`.
+ * @details Auxiliary method for ::__benchmark_median.
+ */
+int __benchmark_double_compare(const void *a, const void *b) {
+    const double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief   Calculates the median of an array.
+ * @details Auxiliary method for ::benchmark_run.
+ *
+ * @param values Array whose median is to be calculated. Will be sorted.
+ * @param n      Number of elements in @p values (at least `1`).
+ *
+ * @return The median of @p values.
+ */
+double __benchmark_median(double *values, size_t n) {
+    qsort(values, n, sizeof(double), __benchmark_double_compare);
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+/**
+ * @brief   Runs a repetition of a benchmark.
+ * @details Auxiliary method for ::benchmark_run.
+ *
+ * @param benchmark Benchmark to be run.
+ * @param time      Where to write the number of nanoseconds the repetition took to.
+ * @param cycles    Where to write the number of CPU cycles the repetition took to, or a negative
+ *                  value if they couldn't be counted. Can be `NULL`.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure in ::benchmark_t::setup.
+ */
+int __benchmark_run_once(const benchmark_t *benchmark, double *time, double *cycles) {
+    void *const state = benchmark->setup ? benchmark->setup(benchmark->data) : benchmark->data;
+    if (benchmark->setup && !state)
+        return 1;
+
+    /* The clock is read inside the performance event, so that the event's overhead isn't timed */
+    performance_event_t *const perf = cycles ? performance_event_start_measuring() : NULL;
+    struct timespec            start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    benchmark->run(state);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    *time = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    if (cycles) {
+        uint64_t counted;
+        *cycles = -1;
+        if (perf && !performance_event_stop_measuring(perf) &&
+            !performance_event_get_counter(perf, PERFORMANCE_EVENT_COUNTER_CYCLES, &counted))
+            *cycles = counted;
+        performance_event_free(perf);
+    }
+
+    if (benchmark->teardown)
+        benchmark->teardown(state);
+    return 0;
+}
+
+int benchmark_run(const benchmark_t *benchmark, size_t repetitions, benchmark_result_t *result) {
+    double time;
+    for (size_t i = 0; i < BENCHMARK_WARMUP_RUNS; ++i)
+        if (__benchmark_run_once(benchmark, &time, NULL))
+            return 1;
+
+    double *const times = malloc(repetitions * sizeof(double));
+    if (!times)
+        goto DEFER_1;
+    double *const cycles = malloc(repetitions * sizeof(double));
+    if (!cycles)
+        goto DEFER_2;
+
+    int has_cycles = 1;
+    for (size_t i = 0; i < repetitions; ++i) {
+        if (__benchmark_run_once(benchmark, &times[i], &cycles[i]))
+            goto DEFER_3;
+
+        times[i] /= benchmark->operations;
+        cycles[i] /= benchmark->operations;
+        has_cycles &= cycles[i] >= 0;
+    }
+
+    result->median = __benchmark_median(times, repetitions);
+    result->min    = times[0];
+    result->cycles = has_cycles ? __benchmark_median(cycles, repetitions) : -1;
+    result->operations_per_second = result->median > 0 ? 1e9 / result->median : 0;
+
+    /* Reuse the sorted times for the absolute deviations */
+    for (size_t i = 0; i < repetitions; ++i)
+        times[i] = fabs(times[i] - result->median);
+    result->mad = __benchmark_median(times, repetitions);
+
+    free(cycles);
+    free(times);
+    return 0;
+
+DEFER_3:
+    free(cycles);
+DEFER_2:
+    free(times);
+DEFER_1:
+    return 1;
+}
+
+void benchmark_print_header(FILE *output) {
+    fprintf(output,
+            "%-40s %12s %12s %12s %14s %10s\n",
+            "Benchmark",
+            "min (ns/op)",
+            "median",
+            "MAD",
+            "ops/s",
+            "cycles/op");
+}
+
+void benchmark_print_result(FILE                     *output,
+                            const benchmark_t        *benchmark,
+                            const benchmark_result_t *result) {
+    fprintf(output,
+            "%-40s %12.2f %12.2f %12.2f %14.0f ",
+            benchmark->name,
+            result->min,
+            result->median,
+            result->mad,
+            result->operations_per_second);
+
+    if (result->cycles >= 0)
+        fprintf(output, "%10.1f\n", result->cycles);
+    else
+        fprintf(output, "%10s\n", "N/A");
+}
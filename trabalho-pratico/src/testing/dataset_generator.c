@@ -0,0 +1,848 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  dataset_generator.c
+ * @brief Implementation of methods in include/testing/dataset_generator.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref dataset_generator_example).
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "testing/dataset_generator.h"
+
+/** @brief Number of users generated at scale `1`. */
+#define DATASET_GENERATOR_USERS 10000
+
+/** @brief Number of flights generated at scale `1`. */
+#define DATASET_GENERATOR_FLIGHTS 1000
+
+/** @brief Number of reservations generated at scale `1`. */
+#define DATASET_GENERATOR_RESERVATIONS 20000
+
+/** @brief Number of hotels generated at scale `1`. */
+#define DATASET_GENERATOR_HOTELS 100
+
+/** @brief Maximum length of a field in a generated line (including the null terminator). */
+#define DATASET_GENERATOR_FIELD_LENGTH 128
+
+/** @brief Maximum number of fields in a generated line. */
+#define DATASET_GENERATOR_MAX_FIELDS 14
+
+/** @brief Number of users with half of the passengers and reservations, in heavy-user datasets. */
+#define DATASET_GENERATOR_HEAVY_USERS 8
+
+/** @brief Number of characters added to a free-text field to make a line very long. */
+#define DATASET_GENERATOR_LONG_FIELD_LENGTH 65536
+
+/** @brief Number of seconds since the epoch at `2010/01/01 00:00:00`. */
+#define DATASET_GENERATOR_2010 1262304000
+
+/** @brief Number of seconds between `2010/01/01 00:00:00` and `2024/01/01 00:00:00`. */
+#define DATASET_GENERATOR_PERIOD (14 * 365 * 86400)
+
+/** @brief Fields of a line in a dataset file, before being written. */
+typedef char
+    dataset_generator_fields_t[DATASET_GENERATOR_MAX_FIELDS][DATASET_GENERATOR_FIELD_LENGTH];
+
+/**
+ * @struct dataset_generator_t
+ * @brief  State of the generation of a dataset.
+ *
+ * @var dataset_generator_t::options
+ *     @brief Parameters of the dataset being generated.
+ * @var dataset_generator_t::rng
+ *     @brief State of the pseudo-random number generator.
+ * @var dataset_generator_t::users
+ *     @brief Number of users to generate.
+ * @var dataset_generator_t::flights
+ *     @brief Number of flights to generate.
+ * @var dataset_generator_t::reservations
+ *     @brief Number of reservations to generate.
+ * @var dataset_generator_t::hotels
+ *     @brief Number of hotels reservations can refer to.
+ * @var dataset_generator_t::invalid_rate
+ *     @brief Fraction of the lines to be made invalid (see
+ *            ::dataset_generator_options_t::invalid_rate), raised in
+ *            ::DATASET_GENERATOR_SCENARIO_INVALID_ROWS.
+ * @var dataset_generator_t::hot_rate
+ *     @brief Probability of choosing the hot entity (hotel, airport or user) of the scenario,
+ *            instead of a random one. Raised to `1` when generating queries.
+ * @var dataset_generator_t::flight_seats
+ *     @brief Number of seats in each flight.
+ * @var dataset_generator_t::flight_overbooked
+ *     @brief Whether each flight will have more passengers than seats (making it invalid).
+ * @var dataset_generator_t::airport_cdf
+ *     @brief Cumulative distribution of airport popularity.
+ * @var dataset_generator_t::hotel_cdf
+ *     @brief Cumulative distribution of hotel popularity.
+ */
+typedef struct {
+    const dataset_generator_options_t *options;
+    uint64_t                           rng;
+
+    size_t users, flights, reservations, hotels;
+    double invalid_rate, hot_rate;
+
+    uint16_t *flight_seats;
+    uint8_t  *flight_overbooked;
+    double   *airport_cdf, *hotel_cdf;
+} dataset_generator_t;
+
+/** @brief Airports flights can depart from and arrive to, from the most to the least popular. */
+const char *const dataset_generator_airports[] = {
+    "LIS", "MAD", "CDG", "LHR", "FRA", "AMS", "BCN", "FCO", "OPO", "MUC", "JFK", "DXB",
+    "IST", "ZRH", "VIE", "BRU", "DUB", "CPH", "ARN", "OSL", "HEL", "WAW", "PRG", "BUD",
+    "ATH", "LAX", "ORD", "ATL", "SFO", "MIA", "BOS", "YYZ", "GRU", "GIG", "EZE", "MEX",
+    "NRT", "ICN", "PEK", "HKG", "SIN", "BKK", "DOH", "SYD", "JNB", "CAI", "FAO", "FNC"};
+
+/** @brief Number of airports in ::dataset_generator_airports. */
+#define DATASET_GENERATOR_AIRPORT_COUNT                                                            \
+    (sizeof(dataset_generator_airports) / sizeof(*dataset_generator_airports))
+
+/** @brief First names of generated people. */
+const char *const dataset_generator_first_names[] = {
+    "Maria", "Joao",   "Ana",    "Jose",    "Francisca", "Pedro",   "Beatriz", "Tiago",
+    "Ines",  "Miguel", "Sofia",  "Rui",     "Carolina",  "Diogo",   "Marta",   "Andre",
+    "Rita",  "Bruno",  "Helena", "Goncalo", "Leonor",    "Ricardo", "Matilde", "Nuno"};
+
+/** @brief Last names of generated people. */
+const char *const dataset_generator_last_names[] = {
+    "Silva",    "Santos", "Ferreira", "Pereira", "Oliveira", "Costa",    "Rodrigues", "Martins",
+    "Jesus",    "Sousa",  "Fernandes", "Goncalves", "Gomes", "Lopes",   "Marques",   "Alves",
+    "Almeida",  "Ribeiro", "Pinto",   "Carvalho", "Teixeira", "Moreira", "Correia",  "Mendes"};
+
+/** @brief Number of first names in ::dataset_generator_first_names. */
+#define DATASET_GENERATOR_FIRST_NAME_COUNT                                                         \
+    (sizeof(dataset_generator_first_names) / sizeof(*dataset_generator_first_names))
+
+/** @brief Number of last names in ::dataset_generator_last_names. */
+#define DATASET_GENERATOR_LAST_NAME_COUNT                                                          \
+    (sizeof(dataset_generator_last_names) / sizeof(*dataset_generator_last_names))
+
+/**
+ * @brief   Mixes the bits of a 64-bit integer (`splitmix64`'s finalizer).
+ * @details Used to derive properties of entities (e.g.: a user's name) from their index, so that
+ *          they don't need to be stored between files.
+ *
+ * @param x Value to be hashed.
+ *
+ * @return A hash of @p x.
+ */
+uint64_t __dataset_generator_hash(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief  Generates a pseudo-random 64-bit integer (`splitmix64`).
+ * @param  generator Generator whose pseudo-random number generator state is modified.
+ * @return A pseudo-random number.
+ */
+uint64_t __dataset_generator_random(dataset_generator_t *generator) {
+    generator->rng += 0x9e3779b97f4a7c15ULL;
+    return __dataset_generator_hash(generator->rng);
+}
+
+/**
+ * @brief  Generates a pseudo-random integer in `[0, n[`.
+ * @param  generator Generator whose pseudo-random number generator state is modified.
+ * @param  n         Number of possible values. Mustn't be `0`.
+ * @return A pseudo-random number in `[0, n[`.
+ */
+uint64_t __dataset_generator_uniform(dataset_generator_t *generator, uint64_t n) {
+    return __dataset_generator_random(generator) % n;
+}
+
+/**
+ * @brief  Generates a pseudo-random real number in `[0, 1[`.
+ * @param  generator Generator whose pseudo-random number generator state is modified.
+ * @return A pseudo-random number in `[0, 1[`.
+ */
+double __dataset_generator_real(dataset_generator_t *generator) {
+    return (__dataset_generator_random(generator) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief   Checks if the hot entity of a scenario should be chosen instead of a random one.
+ * @details The pseudo-random number generator is only used in @p scenario, so that other
+ *          scenarios generate the same values as before.
+ *
+ * @param generator Generator whose pseudo-random number generator state is modified.
+ * @param scenario  Scenario where there is a hot entity.
+ *
+ * @return Whether the dataset is being generated in @p scenario and the hot entity was chosen, with
+ *         probability ::dataset_generator_t::hot_rate.
+ */
+int __dataset_generator_is_hot(dataset_generator_t         *generator,
+                               dataset_generator_scenario_t scenario) {
+    return generator->options->scenario == scenario &&
+           __dataset_generator_real(generator) < generator->hot_rate;
+}
+
+/**
+ * @brief   Chooses a pseudo-random user, with some users being chosen much more often than others.
+ * @details Users with lower indices are more active, with a quadratic distribution. In
+ *          ::DATASET_GENERATOR_SCENARIO_HEAVY_USERS, a heavy user is often chosen instead.
+ *
+ * @param generator Generator whose pseudo-random number generator state is modified.
+ *
+ * @return The index of the chosen user.
+ */
+size_t __dataset_generator_skewed_user(dataset_generator_t *generator) {
+    if (__dataset_generator_is_hot(generator, DATASET_GENERATOR_SCENARIO_HEAVY_USERS))
+        return __dataset_generator_uniform(generator, DATASET_GENERATOR_HEAVY_USERS);
+
+    const double x = __dataset_generator_real(generator);
+    return (size_t) (x * x * generator->users);
+}
+
+/**
+ * @brief Creates the cumulative distribution function of a Zipf distribution.
+ *
+ * @param n        Number of elements in the distribution.
+ * @param exponent Exponent of the distribution (higher values make the first elements more
+ *                 popular).
+ *
+ * @return A `malloc`-allocated array of @p n cumulative probabilities, or `NULL` on failure.
+ */
+double *__dataset_generator_zipf_create(size_t n, double exponent) {
+    double *const cdf = malloc(n * sizeof(double));
+    if (!cdf)
+        return NULL;
+
+    double sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += 1.0 / pow(i + 1, exponent);
+        cdf[i] = sum;
+    }
+    for (size_t i = 0; i < n; ++i)
+        cdf[i] /= sum;
+
+    return cdf;
+}
+
+/**
+ * @brief Chooses a pseudo-random element from a Zipf distribution.
+ *
+ * @param generator Generator whose pseudo-random number generator state is modified.
+ * @param cdf       Distribution created by ::__dataset_generator_zipf_create.
+ * @param n         Number of elements in @p cdf.
+ *
+ * @return The index of the chosen element.
+ */
+size_t __dataset_generator_zipf_sample(dataset_generator_t *generator,
+                                       const double        *cdf,
+                                       size_t               n) {
+    const double x = __dataset_generator_real(generator);
+
+    size_t low = 0, high = n - 1;
+    while (low < high) {
+        const size_t middle = (low + high) / 2;
+        if (cdf[middle] < x)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+/**
+ * @brief   Chooses a pseudo-random airport, following a Zipf distribution.
+ * @details In ::DATASET_GENERATOR_SCENARIO_HOT_AIRPORT, the first airport is often chosen instead.
+ *
+ * @param generator Generator whose pseudo-random number generator state is modified.
+ *
+ * @return The index of the chosen airport in ::dataset_generator_airports.
+ */
+size_t __dataset_generator_random_airport(dataset_generator_t *generator) {
+    if (__dataset_generator_is_hot(generator, DATASET_GENERATOR_SCENARIO_HOT_AIRPORT))
+        return 0;
+
+    return __dataset_generator_zipf_sample(generator,
+                                           generator->airport_cdf,
+                                           DATASET_GENERATOR_AIRPORT_COUNT);
+}
+
+/**
+ * @brief   Chooses a pseudo-random hotel, following a Zipf distribution.
+ * @details In ::DATASET_GENERATOR_SCENARIO_HOT_HOTEL, the first hotel is often chosen instead.
+ *
+ * @param generator Generator whose pseudo-random number generator state is modified.
+ *
+ * @return The index of the chosen hotel.
+ */
+size_t __dataset_generator_random_hotel(dataset_generator_t *generator) {
+    if (__dataset_generator_is_hot(generator, DATASET_GENERATOR_SCENARIO_HOT_HOTEL))
+        return 0;
+
+    return __dataset_generator_zipf_sample(generator, generator->hotel_cdf, generator->hotels);
+}
+
+/**
+ * @brief  Chooses a pseudo-random last name.
+ * @param  generator Generator whose pseudo-random number generator state is modified.
+ * @return A last name from ::dataset_generator_last_names.
+ */
+const char *__dataset_generator_random_last_name(dataset_generator_t *generator) {
+    return dataset_generator_last_names[__dataset_generator_uniform(
+        generator,
+        DATASET_GENERATOR_LAST_NAME_COUNT)];
+}
+
+/**
+ * @brief Formats a date, in the `YYYY/MM/DD` format.
+ *
+ * @param output    Where to write the date to.
+ * @param timestamp Seconds since the epoch.
+ */
+void __dataset_generator_sprintf_date(char *output, int64_t timestamp) {
+    /* Howard Hinnant's civil_from_days algorithm */
+    const int64_t  days = timestamp / 86400 + 719468;
+    const int64_t  era  = days / 146097;
+    const uint32_t doe  = days - era * 146097;
+    const uint32_t yoe  = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const uint32_t doy  = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const uint32_t mp   = (5 * doy + 2) / 153;
+    const uint32_t day  = doy - (153 * mp + 2) / 5 + 1;
+    const uint32_t mon  = mp < 10 ? mp + 3 : mp - 9;
+    const int64_t  year = yoe + era * 400 + (mon <= 2);
+
+    sprintf(output, "%04" PRId64 "/%02" PRIu32 "/%02" PRIu32, year, mon, day);
+}
+
+/**
+ * @brief Formats a date and a time, in the `YYYY/MM/DD hh:mm:ss` format.
+ *
+ * @param output    Where to write the date and time to.
+ * @param timestamp Seconds since the epoch.
+ */
+void __dataset_generator_sprintf_date_and_time(char *output, int64_t timestamp) {
+    __dataset_generator_sprintf_date(output, timestamp);
+
+    const int64_t seconds = timestamp % 86400;
+    sprintf(output + 10,
+            " %02d:%02d:%02d",
+            (int) (seconds / 3600),
+            (int) (seconds / 60 % 60),
+            (int) (seconds % 60));
+}
+
+/**
+ * @brief Generates a pseudo-random timestamp between `2010/01/01` and `2023/12/31`.
+ * @param generator Generator whose pseudo-random number generator state is modified.
+ * @return Seconds since the epoch.
+ */
+int64_t __dataset_generator_random_timestamp(dataset_generator_t *generator) {
+    return DATASET_GENERATOR_2010 +
+           (int64_t) __dataset_generator_uniform(generator, DATASET_GENERATOR_PERIOD);
+}
+
+/**
+ * @brief Formats the identifier of a user.
+ *
+ * @param output Where to write the identifier to.
+ * @param user   Index of the user.
+ */
+void __dataset_generator_sprintf_user_id(char *output, size_t user) {
+    const uint64_t hash = __dataset_generator_hash(user);
+    sprintf(output,
+            "%s%s%zu",
+            dataset_generator_first_names[hash % DATASET_GENERATOR_FIRST_NAME_COUNT],
+            dataset_generator_last_names[(hash >> 32) % DATASET_GENERATOR_LAST_NAME_COUNT],
+            user);
+}
+
+/**
+ * @brief   Writes a line of a dataset file.
+ * @details In ::DATASET_GENERATOR_SCENARIO_LONG_LINES, one in a hundred lines has
+ *          ::DATASET_GENERATOR_LONG_FIELD_LENGTH characters appended to its free-text field.
+ *
+ * @param generator Generator whose pseudo-random number generator state is modified.
+ * @param output    Stream to write the line to.
+ * @param n         Number of fields in the line.
+ * @param fields    Fields in the line.
+ * @param free_text Index of the field that can be made longer, or @p n if there is none.
+ */
+void __dataset_generator_write_line(dataset_generator_t       *generator,
+                                    FILE                      *output,
+                                    size_t                     n,
+                                    dataset_generator_fields_t fields,
+                                    size_t                     free_text) {
+    const int long_line = free_text < n &&
+                          generator->options->scenario == DATASET_GENERATOR_SCENARIO_LONG_LINES &&
+                          __dataset_generator_uniform(generator, 100) == 0;
+
+    for (size_t i = 0; i < n; ++i) {
+        fputs(fields[i], output);
+        if (long_line && i == free_text)
+            for (size_t j = 0; j < DATASET_GENERATOR_LONG_FIELD_LENGTH; ++j)
+                fputc('a' + j % 26, output);
+        fputc(i == n - 1 ? '\n' : ';', output);
+    }
+}
+
+/**
+ * @brief   Makes a line invalid, with probability ::dataset_generator_t::invalid_rate.
+ * @details One of @p corruptions is chosen, and the field it refers to is overwritten.
+ *
+ * @param generator   Generator whose pseudo-random number generator state is modified.
+ * @param fields      Fields in the line.
+ * @param n           Number of possible corruptions.
+ * @param indices     Index of the field each corruption overwrites.
+ * @param corruptions Invalid values for the field in @p indices.
+ */
+void __dataset_generator_maybe_corrupt(dataset_generator_t *generator,
+                                       dataset_generator_fields_t fields,
+                                       size_t                     n,
+                                       const size_t               indices[n],
+                                       const char *const          corruptions[n]) {
+    if (__dataset_generator_real(generator) >= generator->invalid_rate)
+        return;
+
+    const size_t i = __dataset_generator_uniform(generator, n);
+    strcpy(fields[indices[i]], corruptions[i]);
+}
+
+/**
+ * @brief Generates `users.csv`.
+ *
+ * @param generator Generator of the dataset.
+ * @param output    Stream to write the file to.
+ */
+void __dataset_generator_write_users(dataset_generator_t *generator, FILE *output) {
+    fputs("id;name;email;phone_number;birth_date;sex;passport;country_code;address;"
+          "account_creation;pay_method;account_status\n",
+          output);
+
+    const char *const countries[]   = {"PT", "ES", "FR", "DE", "GB", "US", "BR", "IT", "NL", "BE"};
+    const char *const pay_methods[] = {"debit_card", "credit_card", "cash"};
+    const char *const statuses[]    = {"active", "inactive", "Active", "INACTIVE"};
+
+    const size_t      corrupt_indices[] = {1, 2, 2, 4, 5, 7, 9, 11};
+    const char *const corruptions[]     = {"",
+                                           "name.domain.com",
+                                           "name@domain.",
+                                           "1990/13/01",
+                                           "X",
+                                           "PRT",
+                                           "1930/01/01 00:00:00",
+                                           "activ"};
+
+    dataset_generator_fields_t fields;
+    for (size_t i = 0; i < generator->users; ++i) {
+        const uint64_t    hash  = __dataset_generator_hash(i);
+        const char *const first =
+            dataset_generator_first_names[hash % DATASET_GENERATOR_FIRST_NAME_COUNT];
+        const char *const last =
+            dataset_generator_last_names[(hash >> 32) % DATASET_GENERATOR_LAST_NAME_COUNT];
+        const char *const country = countries[__dataset_generator_uniform(generator, 10)];
+
+        /* Born between 1940 and 2005 */
+        const int64_t birth =
+            -946771200 + (int64_t) __dataset_generator_uniform(generator, 66 * 365) * 86400;
+
+        __dataset_generator_sprintf_user_id(fields[0], i);
+        sprintf(fields[1], "%s %s", first, last);
+        sprintf(fields[2], "%s.%s%zu@mail.%s", first, last, i, country);
+        sprintf(fields[3], "+351 9%08" PRIu64, __dataset_generator_uniform(generator, 100000000));
+        __dataset_generator_sprintf_date(fields[4], birth);
+        strcpy(fields[5], __dataset_generator_uniform(generator, 2) ? "M" : "F");
+        sprintf(fields[6],
+                "%s%06" PRIu64,
+                country,
+                __dataset_generator_uniform(generator, 1000000));
+        strcpy(fields[7], country);
+        sprintf(fields[8],
+                "Rua %s, %" PRIu64,
+                last,
+                __dataset_generator_uniform(generator, 200) + 1);
+        __dataset_generator_sprintf_date_and_time(fields[9],
+                                                  __dataset_generator_random_timestamp(generator));
+        strcpy(fields[10], pay_methods[__dataset_generator_uniform(generator, 3)]);
+        strcpy(fields[11], statuses[__dataset_generator_uniform(generator, 4)]);
+
+        __dataset_generator_maybe_corrupt(generator, fields, 8, corrupt_indices, corruptions);
+        __dataset_generator_write_line(generator, output, 12, fields, 8);
+    }
+}
+
+/**
+ * @brief   Generates `flights.csv`.
+ * @details The number of seats of each flight, and whether it'll be overbooked, are stored in
+ *          @p generator, for ::__dataset_generator_write_passengers.
+ *
+ * @param generator Generator of the dataset.
+ * @param output    Stream to write the file to.
+ */
+void __dataset_generator_write_flights(dataset_generator_t *generator, FILE *output) {
+    fputs("id;airline;plane_model;total_seats;origin;destination;schedule_departure_date;"
+          "schedule_arrival_date;real_departure_date;real_arrival_date;pilot;copilot;notes\n",
+          output);
+
+    const char *const airlines[] = {"TAP", "Iberia", "Air France", "Lufthansa", "Ryanair", "KLM"};
+    const char *const models[]   = {"A320", "A321neo", "A330", "Boeing 737", "Boeing 787"};
+
+    const size_t      corrupt_indices[] = {3, 4, 5, 6, 9, 10};
+    const char *const corruptions[]     = {"many",
+                                           "LISB",
+                                           "",
+                                           "2023/13/01 10:00:00",
+                                           "2000/01/01 00:00:00",
+                                           ""};
+
+    dataset_generator_fields_t fields;
+    for (size_t i = 0; i < generator->flights; ++i) {
+        const uint16_t seats = 100 + __dataset_generator_uniform(generator, 301);
+        generator->flight_seats[i] = seats;
+        generator->flight_overbooked[i] =
+            __dataset_generator_real(generator) < generator->invalid_rate / 4;
+
+        const size_t origin = __dataset_generator_random_airport(generator);
+        size_t       destination;
+        do {
+            destination = __dataset_generator_random_airport(generator);
+        } while (destination == origin);
+
+        /* Scheduled to the minute, lasting 1 to 12 hours, and 30 % delayed by up to 3 hours */
+        const int64_t departure = __dataset_generator_random_timestamp(generator) / 60 * 60;
+        const int64_t duration  = (60 + __dataset_generator_uniform(generator, 660)) * 60;
+        const int64_t delay     = __dataset_generator_real(generator) < 0.3
+                                      ? (int64_t) __dataset_generator_uniform(generator, 10800)
+                                      : 0;
+
+        sprintf(fields[0], "%010zu", i + 1);
+        strcpy(fields[1], airlines[__dataset_generator_uniform(generator, 6)]);
+        strcpy(fields[2], models[__dataset_generator_uniform(generator, 5)]);
+        sprintf(fields[3], "%" PRIu16, seats);
+        strcpy(fields[4], dataset_generator_airports[origin]);
+        strcpy(fields[5], dataset_generator_airports[destination]);
+        __dataset_generator_sprintf_date_and_time(fields[6], departure);
+        __dataset_generator_sprintf_date_and_time(fields[7], departure + duration);
+        __dataset_generator_sprintf_date_and_time(fields[8], departure + delay);
+        __dataset_generator_sprintf_date_and_time(fields[9], departure + delay + duration);
+        sprintf(fields[10], "Pilot %s", __dataset_generator_random_last_name(generator));
+        sprintf(fields[11], "Copilot %s", __dataset_generator_random_last_name(generator));
+        strcpy(fields[12], __dataset_generator_uniform(generator, 4) ? "" : "Nothing to report");
+
+        __dataset_generator_maybe_corrupt(generator, fields, 6, corrupt_indices, corruptions);
+        __dataset_generator_write_line(generator, output, 13, fields, 12);
+    }
+}
+
+/**
+ * @brief   Generates `passengers.csv`.
+ * @details Flights are filled to between 50 % and 100 % of their capacity, unless they are to be
+ *          overbooked (see ::__dataset_generator_write_flights).
+ *
+ * @param generator Generator of the dataset.
+ * @param output    Stream to write the file to.
+ */
+void __dataset_generator_write_passengers(dataset_generator_t *generator, FILE *output) {
+    fputs("flight_id;user_id\n", output);
+
+    const size_t      corrupt_indices[] = {0, 1, 1};
+    const char *const corruptions[]     = {"", "", "NoSuchUser"};
+
+    dataset_generator_fields_t fields;
+    for (size_t i = 0; i < generator->flights; ++i) {
+        const size_t seats = generator->flight_seats[i];
+        const size_t passengers =
+            generator->flight_overbooked[i]
+                ? seats + 1 + __dataset_generator_uniform(generator, 5)
+                : seats / 2 + __dataset_generator_uniform(generator, seats / 2 + 1);
+
+        for (size_t j = 0; j < passengers; ++j) {
+            sprintf(fields[0], "%010zu", i + 1);
+            __dataset_generator_sprintf_user_id(fields[1],
+                                                __dataset_generator_skewed_user(generator));
+
+            __dataset_generator_maybe_corrupt(generator, fields, 3, corrupt_indices, corruptions);
+            __dataset_generator_write_line(generator, output, 2, fields, 2);
+        }
+    }
+}
+
+/**
+ * @brief Generates `reservations.csv`.
+ *
+ * @param generator Generator of the dataset.
+ * @param output    Stream to write the file to.
+ */
+void __dataset_generator_write_reservations(dataset_generator_t *generator, FILE *output) {
+    fputs("id;user_id;hotel_id;hotel_name;hotel_stars;city_tax;address;begin_date;end_date;"
+          "price_per_night;includes_breakfast;room_details;rating;comment\n",
+          output);
+
+    const char *const breakfasts[] = {"", "True", "False", "1", "0", "t", "f"};
+    const char *const rooms[]      = {"Basic room", "Room with a view", "Suite", ""};
+
+    const size_t      corrupt_indices[] = {1, 2, 4, 5, 8, 9, 10, 12};
+    const char *const corruptions[]     = {"NoSuchUser",
+                                           "XXX",
+                                           "6",
+                                           "-1",
+                                           "2000/01/01",
+                                           "cheap",
+                                           "yes",
+                                           "6"};
+
+    dataset_generator_fields_t fields;
+    for (size_t i = 0; i < generator->reservations; ++i) {
+        /* Hotel properties only depend on the hotel */
+        const size_t   hotel = __dataset_generator_random_hotel(generator);
+        const uint64_t hash = __dataset_generator_hash(hotel ^ 0x5bd1e995);
+
+        /* Stays of 1 to 14 nights */
+        const int64_t begin = __dataset_generator_random_timestamp(generator) / 86400 * 86400;
+        const int64_t end   = begin + (1 + __dataset_generator_uniform(generator, 14)) * 86400;
+        const uint64_t rating = __dataset_generator_uniform(generator, 6); /* 0 for no rating */
+
+        sprintf(fields[0], "Book%010zu", i + 1);
+        __dataset_generator_sprintf_user_id(fields[1], __dataset_generator_skewed_user(generator));
+        sprintf(fields[2], "HTL%zu", 1001 + hotel);
+        sprintf(fields[3],
+                "Hotel %s",
+                dataset_generator_last_names[hash % DATASET_GENERATOR_LAST_NAME_COUNT]);
+        sprintf(fields[4], "%" PRIu64, 1 + (hash >> 8) % 5);
+        sprintf(fields[5], "%" PRIu64, (hash >> 16) % 20);
+        sprintf(fields[6],
+                "Avenida %s, %" PRIu64,
+                dataset_generator_last_names[(hash >> 24) % DATASET_GENERATOR_LAST_NAME_COUNT],
+                1 + (hash >> 32) % 300);
+        __dataset_generator_sprintf_date(fields[7], begin);
+        __dataset_generator_sprintf_date(fields[8], end);
+        sprintf(fields[9], "%" PRIu64, 20 + __dataset_generator_uniform(generator, 481));
+        strcpy(fields[10], breakfasts[__dataset_generator_uniform(generator, 7)]);
+        strcpy(fields[11], rooms[__dataset_generator_uniform(generator, 4)]);
+        if (rating)
+            sprintf(fields[12], "%" PRIu64, rating);
+        else
+            *fields[12] = '\0';
+        *fields[13] = '\0';
+
+        __dataset_generator_maybe_corrupt(generator, fields, 8, corrupt_indices, corruptions);
+        __dataset_generator_write_line(generator, output, 14, fields, 13);
+    }
+}
+
+/**
+ * @brief   Generates the query file, with arguments referring to entities in the dataset.
+ * @details Queries that can refer to the hot entity of the scenario always do so.
+ *
+ * @param generator Generator of the dataset.
+ * @param output    Stream to write the file to.
+ */
+void __dataset_generator_write_queries(dataset_generator_t *generator, FILE *output) {
+    /* Cumulative weights of each query type (out of 100) */
+    const unsigned int typical_weights[10] = {15, 25, 35, 45, 55, 65, 70, 80, 90, 100};
+    const unsigned int prefix_weights[10]  = {0, 0, 0, 0, 0, 0, 0, 0, 100, 100};
+    const int          short_prefixes =
+        generator->options->scenario == DATASET_GENERATOR_SCENARIO_SHORT_PREFIXES;
+    const unsigned int *const weights = short_prefixes ? prefix_weights : typical_weights;
+
+    generator->hot_rate = 1.0;
+
+    char id[DATASET_GENERATOR_FIELD_LENGTH], begin[32], end[32];
+    for (size_t i = 0; i < generator->options->query_count; ++i) {
+        const uint64_t roll = __dataset_generator_uniform(generator, 100);
+        size_t         type = 0;
+        while (roll >= weights[type])
+            type++;
+
+        fprintf(output, "%zu%s", type + 1, __dataset_generator_uniform(generator, 5) ? "" : "F");
+
+        const int64_t timestamp = __dataset_generator_random_timestamp(generator) / 86400 * 86400;
+        const int64_t window    = (30 + __dataset_generator_uniform(generator, 336)) * 86400;
+        const size_t  hotel     = 1001 + __dataset_generator_random_hotel(generator);
+
+        switch (type + 1) {
+            case 1:
+                switch (__dataset_generator_uniform(generator, 3)) {
+                    case 0:
+                        __dataset_generator_sprintf_user_id(
+                            id,
+                            __dataset_generator_skewed_user(generator));
+                        break;
+                    case 1:
+                        sprintf(id,
+                                "%010" PRIu64,
+                                1 + __dataset_generator_uniform(generator, generator->flights));
+                        break;
+                    default:
+                        sprintf(id,
+                                "Book%010" PRIu64,
+                                1 + __dataset_generator_uniform(generator,
+                                                                generator->reservations));
+                        break;
+                }
+                fprintf(output, " %s\n", id);
+                break;
+            case 2: {
+                const char *const filters[] = {"", " flights", " reservations"};
+                __dataset_generator_sprintf_user_id(id, __dataset_generator_skewed_user(generator));
+                fprintf(output, " %s%s\n", id, filters[__dataset_generator_uniform(generator, 3)]);
+            } break;
+            case 3:
+            case 4:
+                fprintf(output, " HTL%zu\n", hotel);
+                break;
+            case 5:
+                __dataset_generator_sprintf_date_and_time(begin, timestamp);
+                __dataset_generator_sprintf_date_and_time(end, timestamp + window);
+                fprintf(output,
+                        " %s \"%s\" \"%s\"\n",
+                        dataset_generator_airports[__dataset_generator_random_airport(generator)],
+                        begin,
+                        end);
+                break;
+            case 6:
+                fprintf(output,
+                        " %" PRIu64 " %" PRIu64 "\n",
+                        2010 + __dataset_generator_uniform(generator, 14),
+                        1 + __dataset_generator_uniform(generator, 20));
+                break;
+            case 7:
+                fprintf(output, " %" PRIu64 "\n", 1 + __dataset_generator_uniform(generator, 20));
+                break;
+            case 8:
+                __dataset_generator_sprintf_date(begin, timestamp);
+                __dataset_generator_sprintf_date(end, timestamp + window);
+                fprintf(output, " HTL%zu %s %s\n", hotel, begin, end);
+                break;
+            case 9: {
+                const char *const name = dataset_generator_first_names[__dataset_generator_uniform(
+                    generator,
+                    DATASET_GENERATOR_FIRST_NAME_COUNT)];
+                const int length =
+                    short_prefixes ? 1 : 1 + (int) __dataset_generator_uniform(generator, 4);
+                fprintf(output, " %.*s\n", length, name);
+            } break;
+            default:
+                switch (__dataset_generator_uniform(generator, 3)) {
+                    case 0:
+                        fputc('\n', output);
+                        break;
+                    case 1:
+                        fprintf(output,
+                                " %" PRIu64 "\n",
+                                2010 + __dataset_generator_uniform(generator, 14));
+                        break;
+                    default:
+                        fprintf(output,
+                                " %" PRIu64 " %" PRIu64 "\n",
+                                2010 + __dataset_generator_uniform(generator, 14),
+                                1 + __dataset_generator_uniform(generator, 12));
+                        break;
+                }
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Creates a file in the output directory and generates its contents.
+ *
+ * @param generator  Generator of the dataset.
+ * @param output_dir Directory where to create the file.
+ * @param name       Name of the file.
+ * @param write      Method that generates the contents of the file.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO failure.
+ */
+int __dataset_generator_write_file(dataset_generator_t *generator,
+                                   const char          *output_dir,
+                                   const char          *name,
+                                   void (*write)(dataset_generator_t *, FILE *)) {
+    const size_t path_length = strlen(output_dir) + strlen(name) + 2;
+    char        *path        = malloc(path_length);
+    if (!path)
+        return 1;
+    snprintf(path, path_length, "%s/%s", output_dir, name);
+
+    FILE *const file = fopen(path, "w");
+    free(path);
+    if (!file)
+        return 1;
+
+    write(generator, file);
+    const int error = ferror(file);
+    return fclose(file) || error;
+}
+
+int dataset_generator_generate(const char *output_dir, const dataset_generator_options_t *options) {
+    dataset_generator_t generator = {
+        .options      = options,
+        .rng          = options->seed,
+        .users        = fmax(1, round(DATASET_GENERATOR_USERS * options->scale)),
+        .flights      = fmax(1, round(DATASET_GENERATOR_FLIGHTS * options->scale)),
+        .reservations = fmax(1, round(DATASET_GENERATOR_RESERVATIONS * options->scale)),
+        .hotels       = fmax(10, round(DATASET_GENERATOR_HOTELS * options->scale)),
+        .invalid_rate = options->scenario == DATASET_GENERATOR_SCENARIO_INVALID_ROWS
+                            ? fmax(0.5, options->invalid_rate)
+                            : options->invalid_rate,
+        .hot_rate     = 0.5};
+
+    int retval                  = 1;
+    generator.flight_seats      = malloc(generator.flights * sizeof(uint16_t));
+    generator.flight_overbooked = malloc(generator.flights * sizeof(uint8_t));
+    generator.airport_cdf = __dataset_generator_zipf_create(DATASET_GENERATOR_AIRPORT_COUNT, 1.0);
+    generator.hotel_cdf   = __dataset_generator_zipf_create(generator.hotels, 1.1);
+    if (!generator.flight_seats || !generator.flight_overbooked || !generator.airport_cdf ||
+        !generator.hotel_cdf)
+        goto DEFER_1;
+
+    /* Flights must be generated before passengers */
+    if (__dataset_generator_write_file(&generator,
+                                       output_dir,
+                                       "users.csv",
+                                       __dataset_generator_write_users) ||
+        __dataset_generator_write_file(&generator,
+                                       output_dir,
+                                       "flights.csv",
+                                       __dataset_generator_write_flights) ||
+        __dataset_generator_write_file(&generator,
+                                       output_dir,
+                                       "passengers.csv",
+                                       __dataset_generator_write_passengers) ||
+        __dataset_generator_write_file(&generator,
+                                       output_dir,
+                                       "reservations.csv",
+                                       __dataset_generator_write_reservations) ||
+        __dataset_generator_write_file(&generator,
+                                       output_dir,
+                                       "input.txt",
+                                       __dataset_generator_write_queries))
+        goto DEFER_1;
+
+    retval = 0;
+
+DEFER_1:
+    free(generator.flight_seats);
+    free(generator.flight_overbooked);
+    free(generator.airport_cdf);
+    free(generator.hotel_cdf);
+    return retval;
+}
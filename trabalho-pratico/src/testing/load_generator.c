@@ -0,0 +1,638 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  load_generator.c
+ * @brief Implementation of methods in include/testing/load_generator.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref load_generator_example).
+ */
+
+#include <errno.h>
+#include <glib.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "queries/query_type_list.h"
+#include "testing/load_generator.h"
+#include "testing/performance_histogram.h"
+#include "utils/int_utils.h"
+
+/** @brief Number of bytes read from the server's socket at once. */
+#define LOAD_GENERATOR_READ_SIZE 4096
+
+/**
+ * @struct load_generator_workload
+ * @brief  List of requests to be sent to a server.
+ *
+ * @var load_generator_workload::requests
+ *     @brief Array of requests (`char *`), each terminated by a newline, as they're sent.
+ * @var load_generator_workload::timestamps
+ *     @brief Array of `uint64_t`, with the timestamp of each request in milliseconds (`0` for
+ *            requests without one).
+ * @var load_generator_workload::timed
+ *     @brief Whether all requests in ::load_generator_workload::requests have timestamps.
+ */
+struct load_generator_workload {
+    GPtrArray *requests;
+    GArray    *timestamps;
+    int        timed;
+};
+
+/**
+ * @struct load_generator_results_t
+ * @brief  Measurements of the responses of a server, shared by all connections.
+ *
+ * @var load_generator_results_t::lock
+ *     @brief Lock held while any other field is modified.
+ * @var load_generator_results_t::latencies
+ *     @brief Latencies (in microseconds) of the queries of each type that were answered. Index `0`
+ *            is used for requests that aren't queries (e.g.: `PREPARE`).
+ * @var load_generator_results_t::invalid
+ *     @brief Number of requests answered with `-1` (invalid queries).
+ * @var load_generator_results_t::rejected
+ *     @brief Number of requests answered with `-2` (server overloaded).
+ * @var load_generator_results_t::timed_out
+ *     @brief Number of requests answered with `-3` (time budget exceeded).
+ * @var load_generator_results_t::lost
+ *     @brief Number of requests that weren't answered, as their connection failed.
+ */
+typedef struct {
+    pthread_mutex_t          lock;
+    performance_histogram_t *latencies[QUERY_TYPE_LIST_COUNT + 1];
+    size_t                   invalid, rejected, timed_out, lost;
+} load_generator_results_t;
+
+/**
+ * @struct load_generator_run_t
+ * @brief  State shared by all connections while a workload is sent.
+ *
+ * @var load_generator_run_t::workload
+ *     @brief Requests being sent.
+ * @var load_generator_run_t::options
+ *     @brief How requests are sent.
+ * @var load_generator_run_t::results
+ *     @brief Where responses are measured.
+ * @var load_generator_run_t::start
+ *     @brief When the first request was due (`CLOCK_MONOTONIC`).
+ * @var load_generator_run_t::total
+ *     @brief Number of requests to be sent in an open loop, or in a closed loop without a duration.
+ * @var load_generator_run_t::first_timestamp
+ *     @brief Earliest timestamp in the workload, when replaying it.
+ */
+typedef struct {
+    const load_generator_workload_t *workload;
+    const load_generator_options_t  *options;
+    load_generator_results_t        *results;
+    struct timespec                  start;
+    size_t                           total;
+    uint64_t                         first_timestamp;
+} load_generator_run_t;
+
+/**
+ * @struct load_generator_connection_t
+ * @brief  A connection to the server, that sends every `connections`-th request in the workload.
+ *
+ * @var load_generator_connection_t::run
+ *     @brief State shared by all connections.
+ * @var load_generator_connection_t::index
+ *     @brief Index of the first request sent by this connection.
+ * @var load_generator_connection_t::fd
+ *     @brief Socket connected to the server (blocking).
+ * @var load_generator_connection_t::data
+ *     @brief Data received from the server that hasn't been parsed yet.
+ * @var load_generator_connection_t::data_start
+ *     @brief Index of the first byte in ::load_generator_connection_t::data not yet parsed.
+ * @var load_generator_connection_t::data_end
+ *     @brief Number of bytes in ::load_generator_connection_t::data.
+ */
+typedef struct {
+    load_generator_run_t *run;
+    size_t                index;
+    int                   fd;
+    char                  data[LOAD_GENERATOR_READ_SIZE];
+    size_t                data_start, data_end;
+} load_generator_connection_t;
+
+load_generator_workload_t *load_generator_workload_create(void) {
+    load_generator_workload_t *const workload = malloc(sizeof(load_generator_workload_t));
+    if (!workload)
+        return NULL;
+
+    workload->requests   = g_ptr_array_new_with_free_func(free);
+    workload->timestamps = g_array_new(FALSE, FALSE, sizeof(uint64_t));
+    workload->timed      = 1;
+    return workload;
+}
+
+int load_generator_workload_add_file(load_generator_workload_t *workload, const char *path) {
+    FILE *const file = fopen(path, "r");
+    if (!file)
+        return 1;
+
+    int     retval = 0;
+    char   *line   = NULL;
+    size_t  capacity;
+    ssize_t length;
+    while ((length = getline(&line, &capacity, file)) > 0) {
+        while (length && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+            line[--length] = '\0';
+        if (!length)
+            continue;
+
+        /* Lines of a captured request log start with a timestamp and a tab */
+        uint64_t    timestamp = 0;
+        const char *request   = line;
+        char *const tab       = strchr(line, '\t');
+        if (tab) {
+            *tab = '\0';
+            if (int_utils_parse_positive(&timestamp, line) == 0)
+                request = tab + 1;
+            else
+                *tab = '\t';
+        }
+        if (request == line)
+            workload->timed = 0;
+
+        const size_t request_length = length - (request - line);
+        char *const  copy           = malloc(request_length + 2);
+        if (!copy) {
+            retval = 1;
+            break;
+        }
+        memcpy(copy, request, request_length);
+        copy[request_length]     = '\n';
+        copy[request_length + 1] = '\0';
+
+        g_ptr_array_add(workload->requests, copy);
+        g_array_append_val(workload->timestamps, timestamp);
+    }
+
+    if (ferror(file))
+        retval = 1;
+    free(line);
+    fclose(file);
+    return retval;
+}
+
+size_t load_generator_workload_get_length(const load_generator_workload_t *workload) {
+    return workload->requests->len;
+}
+
+int load_generator_workload_is_timed(const load_generator_workload_t *workload) {
+    return workload->timed && workload->requests->len;
+}
+
+void load_generator_workload_free(load_generator_workload_t *workload) {
+    g_ptr_array_unref(workload->requests);
+    g_array_unref(workload->timestamps);
+    free(workload);
+}
+
+/**
+ * @brief  Gets the time elapsed since the start of a run.
+ * @param  run State of the run.
+ * @return The number of microseconds since ::load_generator_run_t::start.
+ */
+uint64_t __load_generator_get_elapsed(const load_generator_run_t *run) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) ((now.tv_sec - run->start.tv_sec) * 1000000 +
+                       (now.tv_nsec - run->start.tv_nsec) / 1000);
+}
+
+/**
+ * @brief  Gets when a request is due, in an open loop.
+ * @param  run   State of the run.
+ * @param  index Index of the request (may be larger than the workload, when it's repeated).
+ * @return The number of microseconds after ::load_generator_run_t::start the request is due.
+ */
+uint64_t __load_generator_get_schedule(const load_generator_run_t *run, size_t index) {
+    if (run->options->replay) {
+        const uint64_t timestamp = g_array_index(run->workload->timestamps,
+                                                 uint64_t,
+                                                 index % run->workload->requests->len);
+        return timestamp > run->first_timestamp ? (timestamp - run->first_timestamp) * 1000 : 0;
+    } else {
+        return (uint64_t) ((double) index * 1e6 / run->options->rate);
+    }
+}
+
+/**
+ * @brief  Gets the type of a query, for its latency to be reported.
+ * @param  request Text of the request.
+ * @return The type of the query, or `0` if @p request isn't a query (e.g.: `PREPARE`).
+ */
+size_t __load_generator_get_type(const char *request) {
+    size_t type = 0;
+    for (const char *i = request; *i >= '0' && *i <= '9' && type <= QUERY_TYPE_LIST_COUNT; ++i)
+        type = type * 10 + (*i - '0');
+    return type <= QUERY_TYPE_LIST_COUNT ? type : 0;
+}
+
+/**
+ * @brief Connects to the server's socket.
+ * @param path Path of the server's socket.
+ * @return A connected socket, or `-1` on failure.
+ */
+int __load_generator_connect(const char *path) {
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(address.sun_path))
+        return -1;
+    strcpy(address.sun_path, path);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (struct sockaddr *) &address, sizeof(address))) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Sends a request to the server.
+ *
+ * @param connection Connection to the server.
+ * @param request    Request to be sent, terminated by a newline.
+ *
+ * @retval 0 Success.
+ * @retval 1 The connection failed.
+ */
+int __load_generator_send(load_generator_connection_t *connection, const char *request) {
+    const size_t length = strlen(request);
+    size_t       sent   = 0;
+    while (sent < length) {
+        const ssize_t written = send(connection->fd, request + sent, length - sent, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return 1;
+        }
+        sent += written;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Reads a line from the server.
+ * @details Only the first `size - 1` characters of the line are kept.
+ *
+ * @param connection Connection to the server.
+ * @param out        Where to write the null-terminated line to (`NULL` to discard it).
+ * @param size       Number of characters that fit in @p out.
+ *
+ * @retval 0 Success.
+ * @retval 1 The connection failed or was closed.
+ */
+int __load_generator_read_line(load_generator_connection_t *connection, char *out, size_t size) {
+    size_t kept = 0;
+    while (1) {
+        if (connection->data_start == connection->data_end) {
+            const ssize_t received =
+                recv(connection->fd, connection->data, LOAD_GENERATOR_READ_SIZE, 0);
+            if (received < 0 && errno == EINTR)
+                continue;
+            else if (received <= 0)
+                return 1;
+
+            connection->data_start = 0;
+            connection->data_end   = received;
+        }
+
+        const char *const start     = connection->data + connection->data_start;
+        const size_t      available = connection->data_end - connection->data_start;
+        const char *const newline   = memchr(start, '\n', available);
+        const size_t      length    = newline ? (size_t) (newline - start) : available;
+
+        if (out && kept + 1 < size) {
+            const size_t copied = min(length, size - 1 - kept);
+            memcpy(out + kept, start, copied);
+            kept += copied;
+        }
+
+        connection->data_start += length + (newline != NULL);
+        if (newline)
+            break;
+    }
+
+    if (out)
+        out[kept] = '\0';
+    return 0;
+}
+
+/**
+ * @brief   Reads the response to a request, and measures it.
+ * @details A response is a line with the number of lines of output (or a negative error code),
+ *          followed by those lines, that are discarded.
+ *
+ * @param connection Connection to the server.
+ * @param index      Index of the request in the workload.
+ * @param sent       When the request was sent (or was due), in microseconds since the start of
+ *                   the run.
+ *
+ * @retval 0 Success.
+ * @retval 1 The connection failed or was closed.
+ */
+int __load_generator_receive(load_generator_connection_t *connection,
+                             size_t                       index,
+                             uint64_t                     sent) {
+    char status[INT_UTILS_SPRINTF_MIN_BUFFER_SIZE + 1];
+    if (__load_generator_read_line(connection, status, sizeof(status)))
+        return 1;
+
+    const long long lines = strtoll(status, NULL, 10);
+    for (long long i = 0; i < lines; ++i)
+        if (__load_generator_read_line(connection, NULL, 0))
+            return 1;
+
+    load_generator_run_t *const     run     = connection->run;
+    load_generator_results_t *const results = run->results;
+    const uint64_t                  latency = __load_generator_get_elapsed(run) - sent;
+    const char *const               request =
+        g_ptr_array_index(run->workload->requests, index % run->workload->requests->len);
+
+    pthread_mutex_lock(&results->lock);
+    if (lines == -1)
+        results->invalid++;
+    else if (lines == -2)
+        results->rejected++;
+    else if (lines == -3)
+        results->timed_out++;
+    else
+        performance_histogram_record(results->latencies[__load_generator_get_type(request)],
+                                     latency);
+    pthread_mutex_unlock(&results->lock);
+    return 0;
+}
+
+/**
+ * @brief Counts requests of a connection that will never be answered, after it failed.
+ *
+ * @param connection Connection that failed.
+ * @param next       Index of the first request of @p connection that wasn't answered.
+ */
+void __load_generator_count_lost(load_generator_connection_t *connection, size_t next) {
+    load_generator_run_t *const run   = connection->run;
+    const size_t                step  = run->options->connections;
+    size_t                      count = 1; /* In a closed loop with a duration, only one is lost */
+    if (run->total)
+        count = next < run->total ? (run->total - next + step - 1) / step : 0;
+
+    pthread_mutex_lock(&run->results->lock);
+    run->results->lost += count;
+    pthread_mutex_unlock(&run->results->lock);
+}
+
+/**
+ * @brief   Sends requests of a connection in a closed loop.
+ * @details Thread routine. The connection stops once all its requests are answered, or once the
+ *          run's duration is over.
+ *
+ * @param arg Pointer to a ::load_generator_connection_t.
+ *
+ * @return `NULL`.
+ */
+void *__load_generator_closed_loop(void *arg) {
+    load_generator_connection_t *const connection = arg;
+    load_generator_run_t *const        run        = connection->run;
+    const uint64_t                     duration   = (uint64_t) (run->options->duration * 1e6);
+
+    for (size_t i = connection->index;; i += run->options->connections) {
+        const uint64_t sent = __load_generator_get_elapsed(run);
+        if (duration ? sent >= duration : i >= run->total)
+            break;
+
+        const char *const request =
+            g_ptr_array_index(run->workload->requests, i % run->workload->requests->len);
+        if (__load_generator_send(connection, request) ||
+            __load_generator_receive(connection, i, sent)) {
+
+            __load_generator_count_lost(connection, i);
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief   Reads the responses to the requests of a connection in an open loop.
+ * @details Thread routine, that runs alongside the one sending the requests
+ *          (::__load_generator_open_loop). Latency is measured from when each request was due.
+ *
+ * @param arg Pointer to a ::load_generator_connection_t.
+ *
+ * @return `NULL`.
+ */
+void *__load_generator_open_loop_receive(void *arg) {
+    load_generator_connection_t *const connection = arg;
+    load_generator_run_t *const        run        = connection->run;
+
+    for (size_t i = connection->index; i < run->total; i += run->options->connections) {
+        if (__load_generator_receive(connection, i, __load_generator_get_schedule(run, i))) {
+            __load_generator_count_lost(connection, i);
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief   Sends requests of a connection in an open loop, each when it's due.
+ * @details Thread routine. Responses are read by another thread, so that requests are sent on
+ *          time even while previous ones aren't answered.
+ *
+ * @param arg Pointer to a ::load_generator_connection_t.
+ *
+ * @return `NULL`.
+ */
+void *__load_generator_open_loop(void *arg) {
+    load_generator_connection_t *const connection = arg;
+    load_generator_run_t *const        run        = connection->run;
+
+    pthread_t receiver;
+    if (pthread_create(&receiver, NULL, __load_generator_open_loop_receive, connection)) {
+        __load_generator_count_lost(connection, connection->index);
+        return NULL;
+    }
+
+    for (size_t i = connection->index; i < run->total; i += run->options->connections) {
+        const uint64_t  due  = __load_generator_get_schedule(run, i);
+        struct timespec when = {.tv_sec  = run->start.tv_sec + due / 1000000,
+                                .tv_nsec = run->start.tv_nsec + (due % 1000000) * 1000};
+        if (when.tv_nsec >= 1000000000) {
+            when.tv_sec++;
+            when.tv_nsec -= 1000000000;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &when, NULL) == EINTR)
+            ;
+
+        const char *const request =
+            g_ptr_array_index(run->workload->requests, i % run->workload->requests->len);
+        if (__load_generator_send(connection, request)) {
+            shutdown(connection->fd, SHUT_RDWR); /* Unblocks the receiver, that counts losses */
+            break;
+        }
+    }
+
+    pthread_join(receiver, NULL);
+    return NULL;
+}
+
+/**
+ * @brief Writes the report of a run.
+ *
+ * @param run     State of the run, after all connections finished.
+ * @param elapsed Microseconds the run took.
+ * @param report  Where to write the report to.
+ */
+void __load_generator_report(const load_generator_run_t *run, uint64_t elapsed, FILE *report) {
+    const load_generator_results_t *const results = run->results;
+
+    size_t answered = results->invalid + results->rejected + results->timed_out;
+    for (size_t t = 0; t <= QUERY_TYPE_LIST_COUNT; ++t)
+        answered += performance_histogram_get_count(results->latencies[t]);
+
+    const double seconds = (double) elapsed / 1e6;
+    fprintf(report,
+            "%zu requests answered in %.3f s (%.1f per second)\n",
+            answered,
+            seconds,
+            seconds > 0 ? (double) answered / seconds : 0.0);
+    fprintf(report,
+            "%zu invalid, %zu rejected, %zu timed out, %zu lost\n\n",
+            results->invalid,
+            results->rejected,
+            results->timed_out,
+            results->lost);
+
+    fprintf(report,
+            "%-6s %10s %12s %12s %12s %12s\n",
+            "Type",
+            "Count",
+            "p50 (us)",
+            "p90 (us)",
+            "p99 (us)",
+            "Max (us)");
+    for (size_t t = 0; t <= QUERY_TYPE_LIST_COUNT; ++t) {
+        const performance_histogram_t *const latencies = results->latencies[t];
+        if (!performance_histogram_get_count(latencies))
+            continue;
+
+        char type[INT_UTILS_SPRINTF_MIN_BUFFER_SIZE];
+        if (t)
+            type[int_utils_sprintf_unsigned(type, t)] = '\0';
+        else
+            strcpy(type, "Other");
+
+        fprintf(report,
+                "%-6s %10zu %12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64 "\n",
+                type,
+                performance_histogram_get_count(latencies),
+                performance_histogram_get_percentile(latencies, 50),
+                performance_histogram_get_percentile(latencies, 90),
+                performance_histogram_get_percentile(latencies, 99),
+                performance_histogram_get_max(latencies));
+    }
+}
+
+int load_generator_run(const load_generator_workload_t *workload,
+                       const load_generator_options_t  *options,
+                       FILE                            *report) {
+    int                      retval  = 1;
+    const size_t             nconns  = options->connections;
+    load_generator_results_t results = {.invalid = 0, .rejected = 0, .timed_out = 0, .lost = 0};
+    load_generator_run_t     run     = {.workload        = workload,
+                                        .options         = options,
+                                        .results         = &results,
+                                        .total           = workload->requests->len,
+                                        .first_timestamp = UINT64_MAX};
+
+    const int open_loop = options->replay || options->rate > 0;
+    if (options->replay) {
+        for (size_t i = 0; i < workload->timestamps->len; ++i)
+            run.first_timestamp =
+                min(run.first_timestamp, g_array_index(workload->timestamps, uint64_t, i));
+    } else if (options->duration > 0) {
+        run.total = open_loop ? (size_t) (options->rate * options->duration) : 0;
+    }
+
+    int histograms_allocated = 1;
+    for (size_t t = 0; t <= QUERY_TYPE_LIST_COUNT; ++t) {
+        results.latencies[t] = performance_histogram_create();
+        histograms_allocated &= results.latencies[t] != NULL;
+    }
+
+    load_generator_connection_t *const connections =
+        malloc(nconns * sizeof(load_generator_connection_t));
+    pthread_t *const threads = malloc(nconns * sizeof(pthread_t));
+    if (!histograms_allocated || !connections || !threads)
+        goto DEFER_1;
+
+    size_t connected = 0;
+    for (; connected < nconns; ++connected) {
+        load_generator_connection_t *const connection = &connections[connected];
+        connection->run        = &run;
+        connection->index      = connected;
+        connection->data_start = connection->data_end = 0;
+        connection->fd         = __load_generator_connect(options->socket_path);
+        if (connection->fd < 0) {
+            fprintf(stderr, "Failed to connect to \"%s\"!\n", options->socket_path);
+            goto DEFER_2;
+        }
+    }
+
+    pthread_mutex_init(&results.lock, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &run.start);
+
+    size_t started = 0;
+    for (; started < nconns; ++started)
+        if (pthread_create(&threads[started],
+                           NULL,
+                           open_loop ? __load_generator_open_loop : __load_generator_closed_loop,
+                           &connections[started]))
+            break;
+    for (size_t i = 0; i < started; ++i)
+        pthread_join(threads[i], NULL);
+    const uint64_t elapsed = __load_generator_get_elapsed(&run);
+    pthread_mutex_destroy(&results.lock);
+
+    if (started == nconns) {
+        __load_generator_report(&run, elapsed, report);
+        retval = 0;
+    } else {
+        fputs("Failed to create threads!\n", stderr);
+    }
+
+DEFER_2:
+    for (size_t i = 0; i < connected; ++i)
+        close(connections[i].fd);
+DEFER_1:
+    free(threads);
+    free(connections);
+    for (size_t t = 0; t <= QUERY_TYPE_LIST_COUNT; ++t)
+        if (results.latencies[t])
+            performance_histogram_free(results.latencies[t]);
+    return retval;
+}
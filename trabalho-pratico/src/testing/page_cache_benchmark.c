@@ -0,0 +1,237 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  page_cache_benchmark.c
+ * @brief Implementation of methods in include/testing/page_cache_benchmark.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref page_cache_benchmark_example).
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "dataset/dataset_input.h"
+#include "testing/page_cache_benchmark.h"
+#include "utils/table.h"
+
+/**
+ * @brief   Number of kinds of runs in a ::page_cache_benchmark_t.
+ * @details Cold and warm runs, each parsing the dataset or restoring a snapshot. The kind of a run
+ *          is `2 * warm + snapshot`.
+ */
+#define PAGE_CACHE_BENCHMARK_KINDS 4
+
+/**
+ * @struct page_cache_benchmark
+ * @brief  Dataset loading times of runs with cold and warm page caches.
+ *
+ * @var page_cache_benchmark::dataset_dir
+ *     @brief Path to the directory containing the dataset.
+ * @var page_cache_benchmark::mode
+ *     @brief State of the page cache before each run.
+ * @var page_cache_benchmark::capacity
+ *     @brief Maximum number of runs of each kind.
+ * @var page_cache_benchmark::run
+ *     @brief Number of runs prepared with ::page_cache_benchmark_prepare_run.
+ * @var page_cache_benchmark::warm
+ *     @brief Whether the last prepared run has a warm page cache.
+ * @var page_cache_benchmark::counts
+ *     @brief Number of runs of each kind.
+ * @var page_cache_benchmark::wall_times
+ *     @brief Wall-clock time (in microseconds) of dataset loading, in every run of each kind.
+ * @var page_cache_benchmark::cpu_times
+ *     @brief CPU time (in microseconds) of all dataset loading steps, in every run of each kind.
+ */
+struct page_cache_benchmark {
+    const char                 *dataset_dir;
+    page_cache_benchmark_mode_t mode;
+    size_t                      capacity, run;
+    int                         warm;
+    size_t                      counts[PAGE_CACHE_BENCHMARK_KINDS];
+    uint64_t                   *wall_times[PAGE_CACHE_BENCHMARK_KINDS];
+    uint64_t                   *cpu_times[PAGE_CACHE_BENCHMARK_KINDS];
+};
+
+page_cache_benchmark_t *page_cache_benchmark_create(const char                 *dataset_dir,
+                                                    page_cache_benchmark_mode_t mode,
+                                                    size_t                      runs) {
+    page_cache_benchmark_t *const benchmark = malloc(sizeof(page_cache_benchmark_t));
+    if (!benchmark)
+        return NULL;
+
+    /* All runs may be of the same kind, as whether a snapshot is restored isn't known */
+    uint64_t *const times = malloc(2 * PAGE_CACHE_BENCHMARK_KINDS * runs * sizeof(uint64_t));
+    if (!times) {
+        free(benchmark);
+        return NULL;
+    }
+
+    benchmark->dataset_dir = dataset_dir;
+    benchmark->mode        = mode;
+    benchmark->capacity    = runs;
+    benchmark->run         = 0;
+    benchmark->warm        = 0;
+    for (size_t i = 0; i < PAGE_CACHE_BENCHMARK_KINDS; ++i) {
+        benchmark->counts[i]     = 0;
+        benchmark->wall_times[i] = times + 2 * i * runs;
+        benchmark->cpu_times[i]  = times + (2 * i + 1) * runs;
+    }
+    return benchmark;
+}
+
+int page_cache_benchmark_prepare_run(page_cache_benchmark_t *benchmark) {
+    switch (benchmark->mode) {
+        case PAGE_CACHE_BENCHMARK_MODE_COLD:
+            benchmark->warm = 0;
+            break;
+        case PAGE_CACHE_BENCHMARK_MODE_WARM:
+            benchmark->warm = 1;
+            break;
+        default:
+            benchmark->warm = benchmark->run % 2;
+            break;
+    }
+    benchmark->run++;
+
+    /* Pages written by the previous run may be dirty, and dirty pages can't be evicted */
+    if (!benchmark->warm)
+        sync();
+    return dataset_input_set_page_cache(benchmark->dataset_dir,
+                                        benchmark->warm ? DATASET_INPUT_PAGE_CACHE_WARM
+                                                        : DATASET_INPUT_PAGE_CACHE_EVICT);
+}
+
+void page_cache_benchmark_add_run(page_cache_benchmark_t      *benchmark,
+                                  const performance_metrics_t *metrics) {
+    /* Breakdowns are only registered when the dataset is parsed */
+    performance_metrics_dataset_breakdown_t breakdown;
+    const int                               snapshot =
+        performance_metrics_get_dataset_breakdown(metrics,
+                                                  PERFORMANCE_METRICS_DATASET_STEP_USERS,
+                                                  &breakdown);
+
+    uint64_t cpu_time = 0;
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i) {
+        const performance_event_t *const event = performance_metrics_get_dataset_measurement(
+            metrics,
+            (performance_metrics_dataset_step_t) i);
+        if (event)
+            cpu_time += performance_event_get_elapsed_time(event);
+    }
+
+    const size_t kind = 2 * benchmark->warm + snapshot;
+    const size_t i    = benchmark->counts[kind]++;
+    benchmark->wall_times[kind][i] = performance_metrics_get_dataset_wall_time(metrics);
+    benchmark->cpu_times[kind][i]  = cpu_time;
+}
+
+/**
+ * @brief   Comparison function for sorting `uint64_t`s in ascending order.
+ * @details Auxiliary method for ::__page_cache_benchmark_median.
+ */
+int __page_cache_benchmark_uint64_compare(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief   Calculates the median of a set of times.
+ * @details Auxiliary method for ::page_cache_benchmark_print.
+ *
+ * @param times Times to calculate the median of. Gets sorted.
+ * @param n     Number of elements in @p times (at least `1`).
+ *
+ * @return The median of @p times.
+ */
+uint64_t __page_cache_benchmark_median(uint64_t *times, size_t n) {
+    qsort(times, n, sizeof(uint64_t), __page_cache_benchmark_uint64_compare);
+    return n % 2 ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2;
+}
+
+void page_cache_benchmark_print(FILE *output, const page_cache_benchmark_t *benchmark) {
+    /* To know if ANSI escape codes for bold and underline can be used. */
+    const int tty = isatty(fileno(output));
+
+    if (tty)
+        fprintf(output, "\n\x1b[1;4mPAGE CACHE\x1b[22;24m\n\n");
+    else
+        fprintf(output, "\nPAGE CACHE\n\n");
+
+    uint64_t wall[PAGE_CACHE_BENCHMARK_KINDS], cpu[PAGE_CACHE_BENCHMARK_KINDS];
+    size_t   rows = 0;
+    for (size_t i = 0; i < PAGE_CACHE_BENCHMARK_KINDS; ++i) {
+        const size_t n = benchmark->counts[i];
+        if (n) {
+            wall[i] = __page_cache_benchmark_median(benchmark->wall_times[i], n);
+            cpu[i]  = __page_cache_benchmark_median(benchmark->cpu_times[i], n);
+            rows++;
+        }
+    }
+
+    table_t *const table = table_create(5, rows + 1);
+    if (!table) {
+        fputs("Failed to allocate table!\n", output);
+        return;
+    }
+
+    table_insert_format(table, 1, 0, "Source");
+    table_insert_format(table, 2, 0, "Runs");
+    table_insert_format(table, 3, 0, "Wall time (ms)");
+    table_insert_format(table, 4, 0, "CPU time (ms)");
+
+    size_t row = 1;
+    for (size_t i = 0; i < PAGE_CACHE_BENCHMARK_KINDS; ++i) {
+        if (!benchmark->counts[i])
+            continue;
+
+        table_insert_format(table, 0, row, "%s", i / 2 ? "Warm" : "Cold");
+        table_insert_format(table, 1, row, "%s", i % 2 ? "Snapshot" : "Dataset");
+        table_insert_format(table, 2, row, "%zu", benchmark->counts[i]);
+        table_insert_format(table, 3, row, "%.2lf", wall[i] / 1000.0);
+        if (i % 2)
+            table_insert_format(table, 4, row, "-"); /* Steps aren't measured */
+        else
+            table_insert_format(table, 4, row, "%.2lf", cpu[i] / 1000.0);
+        ++row;
+    }
+
+    table_draw(output, table);
+    table_free(table);
+
+    /* Parsing steps run in parallel, so the CPU time of cold runs doesn't tell how long I/O took */
+    for (size_t source = 0; source < 2; ++source) {
+        if (benchmark->counts[source] && benchmark->counts[2 + source]) {
+            const double io = ((double) wall[source] - wall[2 + source]) / 1000.0;
+            fprintf(output,
+                    "\n%s: %.2lf ms waiting for storage (cold - warm wall time)",
+                    source ? "Snapshot" : "Dataset",
+                    io);
+        }
+    }
+    fputc('\n', output);
+}
+
+void page_cache_benchmark_free(page_cache_benchmark_t *benchmark) {
+    if (!benchmark)
+        return;
+
+    free(benchmark->wall_times[0]);
+    free(benchmark);
+}
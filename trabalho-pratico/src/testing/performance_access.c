@@ -0,0 +1,75 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  performance_access.c
+ * @brief Implementation of methods in include/testing/performance_access.h
+ *
+ * ### Example
+ * See [the header file's documentation](@ref performance_access_example).
+ */
+
+#include "testing/performance_access.h"
+
+const char *const performance_access_manager_names[PERFORMANCE_ACCESS_MANAGER_COUNT] = {
+    "users",
+    "flights",
+    "reservations",
+    "indexes"};
+
+/** @brief Counters of the calling thread. */
+__thread performance_access_t performance_access_thread_counters = {{0}, {0}};
+
+void performance_access_count_scan(performance_access_manager_t manager, size_t records) {
+    performance_access_thread_counters.scanned[manager] += records;
+}
+
+void performance_access_count_probe(performance_access_manager_t manager) {
+    performance_access_thread_counters.probes[manager]++;
+}
+
+void performance_access_start(performance_access_t *mark) {
+    *mark = performance_access_thread_counters;
+}
+
+void performance_access_stop(const performance_access_t *mark, performance_access_t *out) {
+    const performance_access_t *const now = &performance_access_thread_counters;
+
+    for (size_t i = 0; i < PERFORMANCE_ACCESS_MANAGER_COUNT; ++i) {
+        out->scanned[i] = now->scanned[i] - mark->scanned[i];
+        out->probes[i]  = now->probes[i] - mark->probes[i];
+    }
+}
+
+void performance_access_print_counts(FILE        *output,
+                                     const size_t counts[PERFORMANCE_ACCESS_MANAGER_COUNT]) {
+    int first = 1;
+    for (size_t i = 0; i < PERFORMANCE_ACCESS_MANAGER_COUNT; ++i) {
+        if (!counts[i])
+            continue;
+
+        fprintf(output,
+                "%s%s:%zu",
+                first ? "" : ",",
+                performance_access_manager_names[i],
+                counts[i]);
+        first = 0;
+    }
+
+    if (first)
+        fputc('0', output);
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  performance_allocations.c
+ * @brief Implementation of methods in include/testing/performance_allocations.h
+ *
+ * ### Example
+ * See [the header file's documentation](@ref performance_allocations_example).
+ */
+
+#include "testing/performance_allocations.h"
+
+/** @brief Whether any allocation was counted (see ::performance_allocations_is_tracking). */
+int performance_allocations_tracking = 0;
+
+/** @brief Counters of the calling thread (::performance_allocations_t::peak is unused). */
+__thread performance_allocations_t performance_allocations_thread_counters = {0};
+
+/** @brief Bytes allocated minus bytes freed by the calling thread. */
+__thread int64_t performance_allocations_thread_live = 0;
+
+/** @brief Maximum of ::performance_allocations_thread_live since the last measurement started. */
+__thread int64_t performance_allocations_thread_peak = 0;
+
+int performance_allocations_is_tracking(void) {
+    return __atomic_load_n(&performance_allocations_tracking, __ATOMIC_RELAXED);
+}
+
+void performance_allocations_count_allocation(size_t bytes) {
+    /* Only write once, not to share a modified cache line between all threads */
+    if (!__atomic_load_n(&performance_allocations_tracking, __ATOMIC_RELAXED))
+        __atomic_store_n(&performance_allocations_tracking, 1, __ATOMIC_RELAXED);
+
+    performance_allocations_thread_counters.allocations++;
+    performance_allocations_thread_counters.allocated += bytes;
+    performance_allocations_thread_live += (int64_t) bytes;
+    if (performance_allocations_thread_live > performance_allocations_thread_peak)
+        performance_allocations_thread_peak = performance_allocations_thread_live;
+}
+
+void performance_allocations_count_free(size_t bytes) {
+    performance_allocations_thread_counters.freed += bytes;
+    performance_allocations_thread_live -= (int64_t) bytes;
+}
+
+void performance_allocations_count_pool(size_t bytes) {
+    performance_allocations_thread_counters.pool_allocated += bytes;
+}
+
+void performance_allocations_start(performance_allocations_mark_t *mark) {
+    mark->counters                      = performance_allocations_thread_counters;
+    mark->live                          = performance_allocations_thread_live;
+    performance_allocations_thread_peak = performance_allocations_thread_live;
+}
+
+void performance_allocations_stop(const performance_allocations_mark_t *mark,
+                                  performance_allocations_t            *out) {
+    const performance_allocations_t *const now = &performance_allocations_thread_counters;
+
+    out->allocations    = now->allocations - mark->counters.allocations;
+    out->allocated      = now->allocated - mark->counters.allocated;
+    out->freed          = now->freed - mark->counters.freed;
+    out->pool_allocated = now->pool_allocated - mark->counters.pool_allocated;
+    out->peak           = performance_allocations_thread_peak > mark->live
+                              ? (size_t) (performance_allocations_thread_peak - mark->live)
+                              : 0;
+}
+
+void performance_allocations_add(performance_allocations_t       *allocations,
+                                 const performance_allocations_t *other) {
+    allocations->allocations += other->allocations;
+    allocations->allocated += other->allocated;
+    allocations->freed += other->freed;
+    allocations->pool_allocated += other->pool_allocated;
+    if (other->peak > allocations->peak)
+        allocations->peak = other->peak;
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file    performance_allocations_hooks.c
+ * @brief   Replacements of `malloc`, `free` and related functions, that report to
+ *          [allocation counters](@ref performance_allocations.h).
+ * @details Only linked into `programa-testes` (see the Makefile). Functions defined in the
+ *          executable take precedence over the ones in the C library, including for calls made by
+ *          the C library itself and by GLib. The real allocator is glibc's, through the
+ *          `__libc_*` functions it exports for this purpose, and the size of a block is its usable
+ *          size (`malloc_usable_size`), so that the same size is counted when it's freed.
+ *
+ *          Nothing is replaced when not using glibc, or when building with sanitizers, that
+ *          replace the allocator themselves.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "testing/performance_allocations.h"
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+    #include <malloc.h>
+
+/** @cond FALSE */
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void  __libc_free(void *ptr);
+/** @endcond */
+
+/**
+ * @brief  Counts a newly allocated block.
+ * @param  ptr Block returned by the allocator. Can be `NULL`.
+ * @return @p ptr.
+ */
+void *__performance_allocations_hooks_count(void *ptr) {
+    if (ptr)
+        performance_allocations_count_allocation(malloc_usable_size(ptr));
+    return ptr;
+}
+
+void *malloc(size_t size) {
+    return __performance_allocations_hooks_count(__libc_malloc(size));
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    return __performance_allocations_hooks_count(__libc_calloc(nmemb, size));
+}
+
+void *realloc(void *ptr, size_t size) {
+    const size_t old_size = ptr ? malloc_usable_size(ptr) : 0;
+    void *const  new_ptr  = __libc_realloc(ptr, size);
+    if (new_ptr || !size) { /* The old block was freed (or resized) */
+        if (ptr)
+            performance_allocations_count_free(old_size);
+        __performance_allocations_hooks_count(new_ptr);
+    }
+    return new_ptr;
+}
+
+void *reallocarray(void *ptr, size_t nmemb, size_t size) {
+    if (size && nmemb > SIZE_MAX / size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return realloc(ptr, nmemb * size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+    return __performance_allocations_hooks_count(__libc_memalign(alignment, size));
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size) {
+    if (alignment % sizeof(void *) || (alignment & (alignment - 1)))
+        return EINVAL;
+
+    void *const ptr = memalign(alignment, size);
+    if (!ptr && size)
+        return ENOMEM;
+
+    *memptr = ptr;
+    return 0;
+}
+
+void *valloc(size_t size) {
+    return memalign((size_t) sysconf(_SC_PAGESIZE), size);
+}
+
+void *pvalloc(size_t size) {
+    const size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    return memalign(page_size, (size + page_size - 1) / page_size * page_size);
+}
+
+void free(void *ptr) {
+    if (ptr)
+        performance_allocations_count_free(malloc_usable_size(ptr));
+    __libc_free(ptr);
+}
+
+#endif
@@ -0,0 +1,320 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  performance_comparison.c
+ * @brief Implementation of methods in include/testing/performance_comparison.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref performance_comparison_example).
+ */
+
+#include <glib.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "testing/performance_comparison.h"
+#include "utils/int_utils.h"
+#include "utils/stream_utils.h"
+#include "utils/string_utils.h"
+
+/** @brief Index of the first query statistical data generation phase. */
+#define PERFORMANCE_COMPARISON_STATISTICS_PHASE PERFORMANCE_METRICS_DATASET_STEP_DONE
+
+/** @brief Index of the first query execution phase. */
+#define PERFORMANCE_COMPARISON_EXECUTION_PHASE                                                     \
+    (PERFORMANCE_COMPARISON_STATISTICS_PHASE + QUERY_TYPE_LIST_COUNT)
+
+/** @brief Index of the whole program phase. */
+#define PERFORMANCE_COMPARISON_PROGRAM_PHASE                                                       \
+    (PERFORMANCE_COMPARISON_EXECUTION_PHASE + QUERY_TYPE_LIST_COUNT)
+
+/**
+ * @struct performance_comparison
+ * @brief  Comparison of a set of program runs with a baseline.
+ *
+ * @var performance_comparison::threshold
+ *     @brief Maximum slowdown (in percent) of any phase, not to be considered a regression.
+ * @var performance_comparison::baseline_build_type
+ *     @brief Build type in the baseline.
+ * @var performance_comparison::baseline_revision
+ *     @brief Git revision in the baseline.
+ * @var performance_comparison::baseline
+ *     @brief Time (in microseconds) of each phase in the baseline.
+ * @var performance_comparison::has_baseline
+ *     @brief Whether each phase was present in the baseline.
+ * @var performance_comparison::runs
+ *     @brief Times (`uint64_t`, in microseconds) of each phase in every run.
+ * @var performance_comparison::run_count
+ *     @brief Number of runs added to the comparison.
+ * @var performance_comparison::program_time
+ *     @brief Whole program time (in microseconds) of the last run added to the comparison.
+ * @var performance_comparison::phase_names
+ *     @brief Names of the phases.
+ */
+struct performance_comparison {
+    double threshold;
+
+    char    *baseline_build_type, *baseline_revision;
+    uint64_t baseline[PERFORMANCE_COMPARISON_PHASE_COUNT];
+    int      has_baseline[PERFORMANCE_COMPARISON_PHASE_COUNT];
+
+    GArray  *runs[PERFORMANCE_COMPARISON_PHASE_COUNT];
+    size_t   run_count;
+    uint64_t program_time;
+
+    char phase_names[PERFORMANCE_COMPARISON_PHASE_COUNT][32];
+};
+
+/**
+ * @brief   Parses a line of a baseline CSV file.
+ * @details Auxiliary method for ::performance_comparison_create. Only the columns up to
+ *          `time_us` are needed, and rows about test results (whose names may be quoted and
+ *          contain commas) are ignored.
+ *
+ * @param user_data A ::performance_comparison_t being loaded.
+ * @param line      Line of the CSV file.
+ *
+ * @retval 0 Success.
+ * @retval 1 Parsing failure.
+ */
+int __performance_comparison_parse_line(void *user_data, char *line) {
+    performance_comparison_t *const comparison = user_data;
+    if (!*line)
+        return 0; /* Empty line at the end of the file */
+
+    char *columns[9];
+    for (size_t i = 0; i < 9; ++i) {
+        columns[i] = string_single_delimiter_strsep(&line, ',');
+        if (!columns[i])
+            return 1;
+    }
+
+    if (strcmp(columns[2], "section") == 0)
+        return 0; /* Header */
+
+    if (!comparison->baseline_build_type) {
+        comparison->baseline_build_type = strdup(columns[0]);
+        comparison->baseline_revision   = strdup(columns[1]);
+        if (!comparison->baseline_build_type || !comparison->baseline_revision)
+            return 1;
+    }
+
+    const char *const section = columns[2];
+    const char *const name    = columns[3];
+    uint64_t          query_type;
+    size_t            phase;
+
+    if (strcmp(section, "dataset") == 0) {
+        const char *const steps[] = {"users", "flights", "passengers", "reservations"};
+        for (phase = 0; phase < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++phase)
+            if (strcmp(name, steps[phase]) == 0)
+                break;
+        if (phase == PERFORMANCE_METRICS_DATASET_STEP_DONE)
+            return 1;
+    } else if (strcmp(section, "query_statistics") == 0 ||
+               strcmp(section, "query_execution") == 0) {
+
+        if (int_utils_parse_positive(&query_type, columns[4]) || query_type == 0 ||
+            query_type > QUERY_TYPE_LIST_COUNT)
+            return 1;
+
+        if (strcmp(section, "query_statistics") == 0)
+            phase = PERFORMANCE_COMPARISON_STATISTICS_PHASE + query_type - 1;
+        else
+            phase = PERFORMANCE_COMPARISON_EXECUTION_PHASE + query_type - 1;
+    } else if (strcmp(section, "program") == 0 && strcmp(name, "total") == 0) {
+        phase = PERFORMANCE_COMPARISON_PROGRAM_PHASE;
+    } else {
+        return 0; /* Not a phase */
+    }
+
+    uint64_t time;
+    if (int_utils_parse_positive(&time, columns[8]))
+        return 1;
+
+    /* Query executions are summed, as there's one line for each query */
+    comparison->baseline[phase] += time;
+    comparison->has_baseline[phase] = 1;
+    return 0;
+}
+
+performance_comparison_t *performance_comparison_create(const char *baseline_path,
+                                                        double      threshold) {
+    performance_comparison_t *const comparison = calloc(1, sizeof(performance_comparison_t));
+    if (!comparison)
+        return NULL;
+    comparison->threshold = threshold;
+
+    for (size_t i = 0; i < PERFORMANCE_COMPARISON_PHASE_COUNT; ++i)
+        comparison->runs[i] = g_array_new(FALSE, FALSE, sizeof(uint64_t));
+
+    const char *const step_names[] = {"Users", "Flights", "Passengers", "Reservations"};
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i)
+        snprintf(comparison->phase_names[i], 32, "Dataset (%s)", step_names[i]);
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        snprintf(comparison->phase_names[PERFORMANCE_COMPARISON_STATISTICS_PHASE + i],
+                 32,
+                 "Statistics (Query %zu)",
+                 i + 1);
+        snprintf(comparison->phase_names[PERFORMANCE_COMPARISON_EXECUTION_PHASE + i],
+                 32,
+                 "Execution (Query %zu)",
+                 i + 1);
+    }
+    strcpy(comparison->phase_names[PERFORMANCE_COMPARISON_PROGRAM_PHASE], "Total");
+
+    FILE *const baseline = fopen(baseline_path, "r");
+    if (!baseline)
+        goto DEFER_1;
+
+    if (stream_tokenize(baseline, '\n', __performance_comparison_parse_line, comparison)) {
+        fclose(baseline);
+        goto DEFER_1;
+    }
+    fclose(baseline);
+
+    if (!comparison->baseline_build_type)
+        goto DEFER_1; /* Empty baseline */
+
+    return comparison;
+
+DEFER_1:
+    performance_comparison_free(comparison);
+    return NULL;
+}
+
+int performance_comparison_add_run(performance_comparison_t    *comparison,
+                                   const performance_metrics_t *metrics) {
+    uint64_t times[PERFORMANCE_COMPARISON_PHASE_COUNT] = {0};
+
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i) {
+        const performance_event_t *const perf = performance_metrics_get_dataset_measurement(metrics,
+                                                                                           i);
+        if (perf)
+            times[i] = performance_event_get_elapsed_time(perf);
+    }
+
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        const performance_event_t *const perf =
+            performance_metrics_get_query_statistics_measurement(metrics, i + 1);
+        if (perf)
+            times[PERFORMANCE_COMPARISON_STATISTICS_PHASE + i] =
+                performance_event_get_elapsed_time(perf);
+
+        performance_event_t *const total =
+            performance_metrics_get_query_execution_total(metrics, i + 1);
+        if (total) {
+            times[PERFORMANCE_COMPARISON_EXECUTION_PHASE + i] =
+                performance_event_get_elapsed_time(total);
+            performance_event_free(total);
+        }
+    }
+
+    /* Whole program time is measured since the process started, and runs happen in sequence */
+    const uint64_t program_time = performance_metrics_get_program_total_time(metrics);
+    times[PERFORMANCE_COMPARISON_PROGRAM_PHASE] = program_time - comparison->program_time;
+    comparison->program_time                    = program_time;
+
+    for (size_t i = 0; i < PERFORMANCE_COMPARISON_PHASE_COUNT; ++i)
+        g_array_append_val(comparison->runs[i], times[i]);
+    comparison->run_count++;
+    return 0;
+}
+
+size_t performance_comparison_get_run_count(const performance_comparison_t *comparison) {
+    return comparison->run_count;
+}
+
+const char *
+    performance_comparison_get_baseline_build_type(const performance_comparison_t *comparison) {
+    return comparison->baseline_build_type;
+}
+
+const char *
+    performance_comparison_get_baseline_revision(const performance_comparison_t *comparison) {
+    return comparison->baseline_revision;
+}
+
+const char *performance_comparison_get_phase_name(const performance_comparison_t *comparison,
+                                                  size_t                          phase) {
+    return comparison->phase_names[phase];
+}
+
+/**
+ * @brief   Comparison function for sorting `uint64_t`s in ascending order.
+ * @details Auxiliary method for ::performance_comparison_get_phase.
+ */
+int __performance_comparison_uint64_compare(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+int performance_comparison_get_phase(const performance_comparison_t *comparison,
+                                     size_t                          phase,
+                                     performance_comparison_phase_t *out) {
+    const GArray *const runs = comparison->runs[phase];
+    const size_t        n    = runs->len;
+    if (!comparison->has_baseline[phase] || n == 0)
+        return 1;
+
+    uint64_t *const sorted = malloc(n * sizeof(uint64_t));
+    if (!sorted)
+        return 1;
+    memcpy(sorted, runs->data, n * sizeof(uint64_t));
+    qsort(sorted, n, sizeof(uint64_t), __performance_comparison_uint64_compare);
+
+    const uint64_t median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+
+    double mean = 0, variance = 0;
+    for (size_t i = 0; i < n; ++i)
+        mean += sorted[i];
+    mean /= n;
+    for (size_t i = 0; i < n; ++i)
+        variance += (sorted[i] - mean) * (sorted[i] - mean);
+    variance /= n;
+    free(sorted);
+
+    out->baseline = comparison->baseline[phase];
+    out->median   = median;
+    out->noise    = mean > 0 ? sqrt(variance) * 100.0 / mean : 0.0;
+    out->delta    = out->baseline ? ((double) median - out->baseline) * 100.0 / out->baseline : 0.0;
+    out->regression = out->delta > comparison->threshold && out->delta > 2 * out->noise &&
+                      median >= out->baseline + PERFORMANCE_COMPARISON_MIN_REGRESSION;
+    return 0;
+}
+
+int performance_comparison_has_regressions(const performance_comparison_t *comparison) {
+    for (size_t i = 0; i < PERFORMANCE_COMPARISON_PHASE_COUNT; ++i) {
+        performance_comparison_phase_t phase;
+        if (!performance_comparison_get_phase(comparison, i, &phase) && phase.regression)
+            return 1;
+    }
+    return 0;
+}
+
+void performance_comparison_free(performance_comparison_t *comparison) {
+    for (size_t i = 0; i < PERFORMANCE_COMPARISON_PHASE_COUNT; ++i)
+        if (comparison->runs[i])
+            g_array_unref(comparison->runs[i]);
+
+    free(comparison->baseline_build_type);
+    free(comparison->baseline_revision);
+    free(comparison);
+}
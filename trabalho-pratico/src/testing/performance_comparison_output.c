@@ -0,0 +1,99 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  performance_comparison_output.c
+ * @brief Implementation of methods in include/testing/performance_comparison_output.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref performance_comparison_output_example).
+ */
+
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "testing/performance_comparison_output.h"
+#include "testing/performance_metrics_export.h"
+#include "utils/table.h"
+
+void performance_comparison_output_print(FILE *output, const performance_comparison_t *comparison) {
+    /* To know if ANSI escape codes for bold and underline can be used. */
+    const int tty = isatty(fileno(output));
+
+    if (tty)
+        fprintf(output, "\n\x1b[1;4mBASELINE COMPARISON\x1b[22;24m\n\n");
+    else
+        fprintf(output, "\nBASELINE COMPARISON\n\n");
+
+    const char *const baseline_type = performance_comparison_get_baseline_build_type(comparison);
+    const char *const current_type  = performance_metrics_export_get_build_type();
+    fprintf(output,
+            "Baseline: %s (%s)\nCurrent:  %s (%s), %zu runs\n\n",
+            performance_comparison_get_baseline_revision(comparison),
+            baseline_type,
+            performance_metrics_export_get_revision(),
+            current_type,
+            performance_comparison_get_run_count(comparison));
+    if (strcmp(baseline_type, current_type) != 0)
+        fputs("Warning: comparing different build types!\n\n", output);
+
+    performance_comparison_phase_t phases[PERFORMANCE_COMPARISON_PHASE_COUNT];
+    int                            present[PERFORMANCE_COMPARISON_PHASE_COUNT];
+    size_t                         rows = 0;
+    for (size_t i = 0; i < PERFORMANCE_COMPARISON_PHASE_COUNT; ++i) {
+        present[i] = !performance_comparison_get_phase(comparison, i, &phases[i]);
+        rows += present[i];
+    }
+
+    table_t *const table = table_create(6, rows + 1);
+    if (!table)
+        return;
+
+    table_insert_format(table, 1, 0, "Baseline (ms)");
+    table_insert_format(table, 2, 0, "Median (ms)");
+    table_insert_format(table, 3, 0, "Delta (%%)");
+    table_insert_format(table, 4, 0, "Noise (%%)");
+    table_insert_format(table, 5, 0, "Status");
+
+    size_t row = 1;
+    for (size_t i = 0; i < PERFORMANCE_COMPARISON_PHASE_COUNT; ++i) {
+        if (!present[i])
+            continue;
+
+        const performance_comparison_phase_t *const phase = &phases[i];
+        table_insert_format(table,
+                            0,
+                            row,
+                            "%s",
+                            performance_comparison_get_phase_name(comparison, i));
+        table_insert_format(table, 1, row, "%.2lf", phase->baseline / 1000.0);
+        table_insert_format(table, 2, row, "%.2lf", phase->median / 1000.0);
+        table_insert_format(table, 3, row, "%+.1lf", phase->delta);
+        table_insert_format(table, 4, row, "%.1lf", phase->noise);
+        table_insert_format(table, 5, row, "%s", phase->regression ? "REGRESSION" : "OK");
+        ++row;
+    }
+
+    table_draw(output, table);
+    table_free(table);
+
+    if (performance_comparison_has_regressions(comparison))
+        fputs("\nPerformance regressions found!\n", output);
+    else
+        fputs("\nNo performance regressions found.\n", output);
+}
@@ -22,12 +22,23 @@
  * See [the header file's documentation](@ref performance_event_example).
  */
 
+/** @cond FALSE */
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE /* For syscall */
+#endif
+/** @endcond */
+
 #include <ctype.h>
+#include <linux/perf_event.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/resource.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
 
+#include "testing/performance_allocations.h"
 #include "testing/performance_event.h"
 #include "utils/int_utils.h"
 #include "utils/stream_utils.h"
@@ -39,29 +50,150 @@
  * @var performance_event::elapsed_time
  *     @brief   Time spent in microseconds. Includes both system and user time.
  *     @details If ::performance_event_stop_measuring has been called, this is the time spent
- *              running the task. Otherwise, it's the time running the program until the task
+ *              running the task. Otherwise, it's the time the measuring thread ran until the task
  *              (timestamp).
  * @var performance_event::used_memory
  *     @brief   Memory spent (in KiB).
  *     @details If ::performance_event_stop_measuring has been called, this is the difference
  *              between memory in the beginning and in the end of the task, clamped to zero.
  *              Otherwise, it's the memory used before starting to run the task.
+ * @var performance_event::counter_fds
+ *     @brief   File descriptors of the hardware counters being measured (`-1` if unavailable).
+ *     @details The first available counter is the group leader. All file descriptors are closed
+ *              (and set to `-1`) by ::performance_event_stop_measuring.
+ * @var performance_event::counters
+ *     @brief Values of the hardware counters, after ::performance_event_stop_measuring.
+ * @var performance_event::available_counters
+ *     @brief Bitmask of the counters in ::performance_event::counters that could be measured.
+ * @var performance_event::allocation_mark
+ *     @brief State of the allocation counters of the measuring thread when the task started.
+ * @var performance_event::allocations
+ *     @brief Memory allocated during the task, after ::performance_event_stop_measuring.
+ * @var performance_event::has_allocations
+ *     @brief Whether ::performance_event::allocations was measured (see
+ *            ::performance_allocations_is_tracking).
  */
 struct performance_event {
     uint64_t elapsed_time;
     size_t   used_memory;
+
+    performance_allocations_mark_t allocation_mark;
+    performance_allocations_t      allocations;
+    int                            has_allocations;
+
+    int          counter_fds[PERFORMANCE_EVENT_COUNTER_COUNT];
+    uint64_t     counters[PERFORMANCE_EVENT_COUNTER_COUNT];
+    unsigned int available_counters;
 };
 
 /**
- * @brief Adds time spent by the program (@p user) and the kernel (@p system).
+ * @brief   Opens all hardware counters of a performance event, as a single group, and starts them.
+ * @details Counters that can't be opened are left unavailable. Only user-space activity of the
+ *          calling thread is counted.
+ *
+ * @param perf Performance event whose counters are to be opened.
+ */
+void __performance_event_open_counters(performance_event_t *perf) {
+    const uint32_t types[PERFORMANCE_EVENT_COUNTER_COUNT] = {PERF_TYPE_HARDWARE,
+                                                             PERF_TYPE_HARDWARE,
+                                                             PERF_TYPE_HARDWARE,
+                                                             PERF_TYPE_HARDWARE,
+                                                             PERF_TYPE_HW_CACHE};
+    const uint64_t configs[PERFORMANCE_EVENT_COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+
+    int leader = -1;
+    for (size_t i = 0; i < PERFORMANCE_EVENT_COUNTER_COUNT; ++i) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(struct perf_event_attr));
+        attr.size           = sizeof(struct perf_event_attr);
+        attr.type           = types[i];
+        attr.config         = configs[i];
+        attr.disabled       = leader == -1; /* Members follow the leader */
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format =
+            PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        /* No glibc wrapper exists for perf_event_open */
+        perf->counter_fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+        if (perf->counter_fds[i] >= 0 && leader == -1)
+            leader = perf->counter_fds[i];
+    }
+
+    if (leader != -1) {
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+/**
+ * @brief   Stops, reads and closes all hardware counters of a performance event.
+ * @details When there are more counters in the system than hardware registers, the group may only
+ *          be scheduled on the CPU for part of the task. Its values are then extrapolated to the
+ *          whole task. Counters are only marked as available if the group was ever scheduled.
+ *
+ * @param perf Performance event whose counters are to be read.
+ */
+void __performance_event_close_counters(performance_event_t *perf) {
+    perf->available_counters = 0;
+
+    int leader = -1;
+    for (size_t i = 0; i < PERFORMANCE_EVENT_COUNTER_COUNT && leader == -1; ++i)
+        leader = perf->counter_fds[i];
+
+    if (leader != -1) {
+        ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        /* Group read format: number of counters, time enabled, time running, values */
+        uint64_t      values[3 + PERFORMANCE_EVENT_COUNTER_COUNT];
+        const ssize_t bytes = read(leader, values, sizeof(values));
+
+        if (bytes >= (ssize_t) (3 * sizeof(uint64_t)) &&
+            bytes == (ssize_t) ((3 + values[0]) * sizeof(uint64_t)) && values[2] != 0) {
+
+            const double scale       = (double) values[1] / values[2];
+            size_t       value_index = 3;
+            for (size_t i = 0; i < PERFORMANCE_EVENT_COUNTER_COUNT; ++i) {
+                if (perf->counter_fds[i] < 0)
+                    continue;
+
+                perf->counters[i] = values[value_index++] * scale;
+                perf->available_counters |= 1U << i;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < PERFORMANCE_EVENT_COUNTER_COUNT; ++i) {
+        if (perf->counter_fds[i] >= 0)
+            close(perf->counter_fds[i]);
+        perf->counter_fds[i] = -1;
+    }
+}
+
+/**
+ * @brief   Gets the CPU time (user and system) spent by the calling thread.
+ * @details Per-thread time is measured (instead of `getrusage(RUSAGE_SELF, ...)`), so that tasks
+ *          running concurrently in different threads (e.g.: when loading a dataset) can be told
+ *          apart.
  *
- * @param user   User time, this is, time spent running program instructions.
- * @param system System time, this is, time spent in kernel code.
+ * @param output Where to output the elapsed time (in microseconds), only on success.
  *
- * @return The sum of @p user and @p system, in microseconds.
+ * @retval 0 Success.
+ * @retval 1 Failure.
  */
-uint64_t __performance_event_add_user_system_time(struct timeval user, struct timeval system) {
-    return (uint64_t) (user.tv_sec + system.tv_sec) * 1000000 + user.tv_usec + system.tv_usec;
+int __performance_event_get_thread_time(uint64_t *output) {
+    struct timespec time;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time))
+        return 1;
+
+    *output = (uint64_t) time.tv_sec * 1000000 + time.tv_nsec / 1000;
+    return 0;
 }
 
 /**
@@ -129,14 +261,40 @@ performance_event_t *performance_event_start_measuring(void) {
         return NULL;
     }
 
-    struct rusage usage;
-    const int     insuccess = getrusage(RUSAGE_SELF, &usage);
-    if (insuccess) {
+    if (__performance_event_get_thread_time(&perf->elapsed_time)) {
         free(perf);
         return NULL;
     }
-    perf->elapsed_time = __performance_event_add_user_system_time(usage.ru_utime, usage.ru_stime);
 
+    /* Open counters last, not to count the work of measuring time and memory */
+    perf->has_allocations    = 0;
+    perf->available_counters = 0;
+    performance_allocations_start(&perf->allocation_mark);
+    __performance_event_open_counters(perf);
+    return perf;
+}
+
+int performance_event_start_measuring_light(performance_event_timestamp_t *slot) {
+    return __performance_event_get_thread_time(slot);
+}
+
+performance_event_t *performance_event_stop_measuring_light(performance_event_timestamp_t start) {
+    uint64_t now;
+    if (__performance_event_get_thread_time(&now))
+        return NULL;
+
+    performance_event_t *const perf = malloc(sizeof(performance_event_t));
+    if (!perf)
+        return NULL;
+
+    perf->elapsed_time       = now - start;
+    perf->used_memory        = 0;
+    perf->has_allocations    = 0;
+    perf->available_counters = 0;
+    for (size_t i = 0; i < PERFORMANCE_EVENT_COUNTER_COUNT; ++i) {
+        perf->counter_fds[i] = -1;
+        perf->counters[i]    = 0;
+    }
     return perf;
 }
 
@@ -146,20 +304,22 @@ performance_event_t *performance_event_clone(const performance_event_t *perf) {
         return NULL;
 
     memcpy(ret, perf, sizeof(performance_event_t));
+    for (size_t i = 0; i < PERFORMANCE_EVENT_COUNTER_COUNT; ++i)
+        ret->counter_fds[i] = -1; /* Owned by perf */
     return ret;
 }
 
 int performance_event_stop_measuring(performance_event_t *perf) {
-    struct rusage usage;
-    const int     insuccess = getrusage(RUSAGE_SELF, &usage);
-    if (insuccess) {
+    __performance_event_close_counters(perf);
+    performance_allocations_stop(&perf->allocation_mark, &perf->allocations);
+    perf->has_allocations = performance_allocations_is_tracking();
+
+    uint64_t elapsed;
+    if (__performance_event_get_thread_time(&elapsed)) {
         perf->elapsed_time = 0;
         perf->used_memory  = 0;
         return 1;
     }
-
-    const uint64_t elapsed =
-        __performance_event_add_user_system_time(usage.ru_utime, usage.ru_stime);
     perf->elapsed_time = elapsed - perf->elapsed_time;
 
     size_t new_memory;
@@ -185,6 +345,40 @@ size_t performance_event_get_used_memory(const performance_event_t *perf) {
     return perf->used_memory;
 }
 
+int performance_event_get_allocations(const performance_event_t *perf,
+                                      performance_allocations_t *output) {
+    if (!perf->has_allocations)
+        return 1;
+
+    *output = perf->allocations;
+    return 0;
+}
+
+int performance_event_get_counter(const performance_event_t  *perf,
+                                  performance_event_counter_t counter,
+                                  uint64_t                   *output) {
+    if (!(perf->available_counters & (1U << counter)))
+        return 1;
+
+    *output = perf->counters[counter];
+    return 0;
+}
+
+void performance_event_add(performance_event_t *perf, const performance_event_t *other) {
+    perf->elapsed_time += other->elapsed_time;
+    perf->used_memory += other->used_memory;
+
+    perf->has_allocations &= other->has_allocations;
+    performance_allocations_add(&perf->allocations, &other->allocations);
+
+    perf->available_counters &= other->available_counters;
+    for (size_t i = 0; i < PERFORMANCE_EVENT_COUNTER_COUNT; ++i)
+        perf->counters[i] += other->counters[i];
+}
+
 void performance_event_free(performance_event_t *perf) {
+    for (size_t i = 0; i < PERFORMANCE_EVENT_COUNTER_COUNT; ++i)
+        if (perf->counter_fds[i] >= 0)
+            close(perf->counter_fds[i]);
     free(perf);
 }
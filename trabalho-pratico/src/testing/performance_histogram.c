@@ -0,0 +1,132 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  performance_histogram.c
+ * @brief Implementation of methods in include/testing/performance_histogram.h
+ *
+ * ### Example
+ * See [the header file's documentation](@ref performance_histogram_example).
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "testing/performance_histogram.h"
+
+/** @brief Number of values recorded exactly, before values start being grouped in buckets. */
+#define PERFORMANCE_HISTOGRAM_SUB_BUCKETS (1 << PERFORMANCE_HISTOGRAM_SUB_BUCKET_BITS)
+
+/**
+ * @brief Total number of buckets in a ::performance_histogram_t: the exact values below
+ *        ::PERFORMANCE_HISTOGRAM_SUB_BUCKETS, and then half as many buckets for every larger power
+ *        of two (the most significant bit is always set).
+ */
+#define PERFORMANCE_HISTOGRAM_BUCKETS                                                              \
+    ((64 - PERFORMANCE_HISTOGRAM_SUB_BUCKET_BITS + 2) * (PERFORMANCE_HISTOGRAM_SUB_BUCKETS / 2))
+
+/**
+ * @struct performance_histogram
+ * @brief  Log-bucketed histogram of performance measurements.
+ *
+ * @var performance_histogram::buckets
+ *     @brief Number of measurements in each bucket (see ::__performance_histogram_get_bucket).
+ * @var performance_histogram::count
+ *     @brief Total number of measurements.
+ * @var performance_histogram::max
+ *     @brief Largest measurement.
+ */
+struct performance_histogram {
+    size_t   buckets[PERFORMANCE_HISTOGRAM_BUCKETS];
+    size_t   count;
+    uint64_t max;
+};
+
+/**
+ * @brief Calculates the index of the bucket a value belongs to.
+ * @param value Value to be recorded.
+ * @return The index of the bucket in ::performance_histogram::buckets.
+ */
+size_t __performance_histogram_get_bucket(uint64_t value) {
+    if (value < PERFORMANCE_HISTOGRAM_SUB_BUCKETS)
+        return value;
+
+    /* Keep the PERFORMANCE_HISTOGRAM_SUB_BUCKET_BITS most significant bits */
+    const int      shift = 63 - __builtin_clzll(value) - PERFORMANCE_HISTOGRAM_SUB_BUCKET_BITS + 1;
+    const uint64_t sub   = (value >> shift) - PERFORMANCE_HISTOGRAM_SUB_BUCKETS / 2;
+    return (size_t) shift * PERFORMANCE_HISTOGRAM_SUB_BUCKETS / 2 +
+           PERFORMANCE_HISTOGRAM_SUB_BUCKETS / 2 + sub;
+}
+
+/**
+ * @brief Calculates the largest value that belongs to a bucket.
+ * @param bucket Index of the bucket in ::performance_histogram::buckets.
+ * @return The largest value that ::__performance_histogram_get_bucket maps to @p bucket.
+ */
+uint64_t __performance_histogram_get_bucket_upper_bound(size_t bucket) {
+    if (bucket < PERFORMANCE_HISTOGRAM_SUB_BUCKETS)
+        return bucket;
+
+    const size_t   half  = PERFORMANCE_HISTOGRAM_SUB_BUCKETS / 2;
+    const size_t   shift = (bucket - half) / half;
+    const uint64_t sub   = (bucket - half) % half + half;
+    return ((sub + 1) << shift) - 1;
+}
+
+performance_histogram_t *performance_histogram_create(void) {
+    return calloc(1, sizeof(performance_histogram_t));
+}
+
+void performance_histogram_record(performance_histogram_t *histogram, uint64_t value) {
+    histogram->buckets[__performance_histogram_get_bucket(value)]++;
+    histogram->count++;
+    if (value > histogram->max)
+        histogram->max = value;
+}
+
+size_t performance_histogram_get_count(const performance_histogram_t *histogram) {
+    return histogram->count;
+}
+
+uint64_t performance_histogram_get_max(const performance_histogram_t *histogram) {
+    return histogram->max;
+}
+
+uint64_t performance_histogram_get_percentile(const performance_histogram_t *histogram,
+                                              double                         percentile) {
+    if (!histogram->count)
+        return 0;
+
+    /* Rank (starting at 1) of the measurement at the percentile */
+    size_t rank = ceil(percentile / 100.0 * histogram->count);
+    if (rank < 1)
+        rank = 1;
+
+    size_t seen = 0;
+    for (size_t i = 0; i < PERFORMANCE_HISTOGRAM_BUCKETS; ++i) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            const uint64_t bound = __performance_histogram_get_bucket_upper_bound(i);
+            return bound < histogram->max ? bound : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+void performance_histogram_free(performance_histogram_t *histogram) {
+    free(histogram);
+}
@@ -0,0 +1,436 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  performance_memory_sampler.c
+ * @brief Implementation of methods in include/testing/performance_memory_sampler.h
+ *
+ * ### Example
+ * See [the header file's documentation](@ref performance_memory_sampler_example).
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "testing/performance_memory_sampler.h"
+#include "testing/performance_profiler.h"
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    #include <malloc.h>
+
+    /** @brief Defined when `mallinfo2` is available to count bytes allocated with `malloc`. */
+    #define PERFORMANCE_MEMORY_SAMPLER_HAS_MALLINFO2
+#endif
+
+/**
+ * @struct performance_memory_sampler_sample_t
+ * @brief  Memory usage of the process at some point in time.
+ *
+ * @var performance_memory_sampler_sample_t::time
+ *     @brief Microseconds since the sampler started.
+ * @var performance_memory_sampler_sample_t::rss
+ *     @brief Resident set size, in bytes.
+ * @var performance_memory_sampler_sample_t::heap
+ *     @brief Bytes allocated with `malloc` and not yet freed (`0` if unavailable).
+ * @var performance_memory_sampler_sample_t::phases
+ *     @brief Bit mask of the phases the sample is attributed to (::PERFORMANCE_PROFILER_PHASE_COUNT
+ *            fits in 32 bits).
+ */
+typedef struct {
+    uint64_t time;
+    size_t   rss, heap;
+    uint32_t phases;
+} performance_memory_sampler_sample_t;
+
+/**
+ * @struct performance_memory_sampler_peak_t
+ * @brief  Peak memory usage of the samples attributed to a phase.
+ *
+ * @var performance_memory_sampler_peak_t::samples
+ *     @brief Number of samples attributed to the phase.
+ * @var performance_memory_sampler_peak_t::rss
+ *     @brief Maximum resident set size, in bytes.
+ * @var performance_memory_sampler_peak_t::heap
+ *     @brief Maximum number of bytes allocated with `malloc`.
+ */
+typedef struct {
+    size_t samples, rss, heap;
+} performance_memory_sampler_peak_t;
+
+/**
+ * @struct performance_memory_sampler
+ * @brief  Timeline of the memory usage of the process, with the peak of each phase.
+ *
+ * @var performance_memory_sampler::samples
+ *     @brief Timeline, with space for ::PERFORMANCE_MEMORY_SAMPLER_MAX_SAMPLES samples.
+ * @var performance_memory_sampler::nsamples
+ *     @brief Number of samples in ::performance_memory_sampler::samples.
+ * @var performance_memory_sampler::stride
+ *     @brief Only one in every `stride` samples taken is kept in the timeline.
+ * @var performance_memory_sampler::taken
+ *     @brief Number of samples taken.
+ * @var performance_memory_sampler::peaks
+ *     @brief Peak memory usage of each phase (see ::performance_profiler_get_phase_name).
+ * @var performance_memory_sampler::overall
+ *     @brief Peak memory usage of all samples.
+ * @var performance_memory_sampler::interval
+ *     @brief Microseconds between samples.
+ * @var performance_memory_sampler::start_time
+ *     @brief Value of `CLOCK_MONOTONIC`, in microseconds, when the sampler started.
+ * @var performance_memory_sampler::statm
+ *     @brief File descriptor of `/proc/self/statm`.
+ * @var performance_memory_sampler::thread
+ *     @brief Background thread taking samples.
+ * @var performance_memory_sampler::running
+ *     @brief Whether ::performance_memory_sampler::thread still needs to be joined.
+ * @var performance_memory_sampler::stopping
+ *     @brief Set to stop ::performance_memory_sampler::thread.
+ */
+struct performance_memory_sampler {
+    performance_memory_sampler_sample_t *samples;
+    size_t                               nsamples, stride, taken;
+    performance_memory_sampler_peak_t    peaks[PERFORMANCE_PROFILER_PHASE_COUNT];
+    performance_memory_sampler_peak_t    overall;
+
+    uint64_t  interval, start_time;
+    int       statm;
+    pthread_t thread;
+    int       running, stopping;
+};
+
+/** @brief Sampler whose thread is running, that threads entering phases register to. */
+performance_memory_sampler_t *performance_memory_sampler_running = NULL;
+
+/** @brief Number of threads in each phase, while a sampler is running. */
+size_t performance_memory_sampler_active[PERFORMANCE_PROFILER_PHASE_COUNT] = {0};
+
+/** @brief Phase the calling thread entered while a sampler was running, or `0` if none. */
+__thread size_t performance_memory_sampler_thread_phase = 0;
+
+/**
+ * @brief  Gets the current time, in microseconds.
+ * @return The value of `CLOCK_MONOTONIC`, in microseconds.
+ */
+uint64_t __performance_memory_sampler_get_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * @brief Reads the resident set size of the process.
+ *
+ * @param statm File descriptor of `/proc/self/statm`.
+ * @param rss   Where to write the resident set size to, in bytes, only on success.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure.
+ */
+int __performance_memory_sampler_read_rss(int statm, size_t *rss) {
+    char          buffer[128];
+    const ssize_t length = pread(statm, buffer, sizeof(buffer) - 1, 0);
+    if (length <= 0)
+        return 1;
+    buffer[length] = '\0';
+
+    size_t pages;
+    if (sscanf(buffer, "%*s %zu", &pages) != 1)
+        return 1;
+
+    *rss = pages * (size_t) sysconf(_SC_PAGESIZE);
+    return 0;
+}
+
+/**
+ * @brief  Gets the number of bytes allocated with `malloc` and not yet freed.
+ * @return The number of bytes in use, or `0` if `mallinfo2` isn't available.
+ */
+size_t __performance_memory_sampler_read_heap(void) {
+#ifdef PERFORMANCE_MEMORY_SAMPLER_HAS_MALLINFO2
+    const struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Adds a sample to the peak memory usage of a phase.
+ *
+ * @param peak   Peak to be updated.
+ * @param sample Sample attributed to the phase of @p peak.
+ */
+void __performance_memory_sampler_add_peak(performance_memory_sampler_peak_t         *peak,
+                                           const performance_memory_sampler_sample_t *sample) {
+    peak->samples++;
+    if (sample->rss > peak->rss)
+        peak->rss = sample->rss;
+    if (sample->heap > peak->heap)
+        peak->heap = sample->heap;
+}
+
+/**
+ * @brief   Takes a sample of the memory usage of the process.
+ * @details Auxiliary method for ::__performance_memory_sampler_run. When the timeline is full,
+ *          every other sample in it is dropped.
+ *
+ * @param sampler Sampler to add the sample to.
+ */
+void __performance_memory_sampler_take(performance_memory_sampler_t *sampler) {
+    performance_memory_sampler_sample_t sample = {
+        .time   = __performance_memory_sampler_get_time() - sampler->start_time,
+        .rss    = 0,
+        .heap   = __performance_memory_sampler_read_heap(),
+        .phases = 0};
+    if (__performance_memory_sampler_read_rss(sampler->statm, &sample.rss))
+        return;
+
+    for (size_t i = 1; i < PERFORMANCE_PROFILER_PHASE_COUNT; ++i)
+        if (__atomic_load_n(&performance_memory_sampler_active[i], __ATOMIC_RELAXED))
+            sample.phases |= (uint32_t) 1 << i;
+    if (!sample.phases)
+        sample.phases = 1; /* Phase 0: everything else */
+
+    __performance_memory_sampler_add_peak(&sampler->overall, &sample);
+    for (size_t i = 0; i < PERFORMANCE_PROFILER_PHASE_COUNT; ++i)
+        if (sample.phases & ((uint32_t) 1 << i))
+            __performance_memory_sampler_add_peak(&sampler->peaks[i], &sample);
+
+    if (sampler->taken++ % sampler->stride)
+        return;
+    if (sampler->nsamples == PERFORMANCE_MEMORY_SAMPLER_MAX_SAMPLES) {
+        for (size_t i = 0; i < sampler->nsamples / 2; ++i)
+            sampler->samples[i] = sampler->samples[2 * i];
+        sampler->nsamples /= 2;
+        sampler->stride *= 2;
+        if ((sampler->taken - 1) % sampler->stride)
+            return;
+    }
+    sampler->samples[sampler->nsamples++] = sample;
+}
+
+/**
+ * @brief   Takes samples until the sampler is stopped.
+ * @details Start routine of ::performance_memory_sampler::thread.
+ *
+ * @param  sampler_data Sampler to add samples to.
+ * @return Always `NULL`.
+ */
+void *__performance_memory_sampler_run(void *sampler_data) {
+    performance_memory_sampler_t *const sampler = sampler_data;
+    const struct timespec               interval = {
+                      .tv_sec  = (time_t) (sampler->interval / 1000000),
+                      .tv_nsec = (long) (sampler->interval % 1000000) * 1000};
+
+    while (!__atomic_load_n(&sampler->stopping, __ATOMIC_ACQUIRE)) {
+        __performance_memory_sampler_take(sampler);
+        nanosleep(&interval, NULL);
+    }
+    __performance_memory_sampler_take(sampler); /* Memory usage when stopped */
+    return NULL;
+}
+
+performance_memory_sampler_t *performance_memory_sampler_start(uint64_t interval) {
+    performance_memory_sampler_t *const sampler = calloc(1, sizeof(performance_memory_sampler_t));
+    if (!sampler)
+        goto DEFER_1;
+
+    sampler->samples = malloc(PERFORMANCE_MEMORY_SAMPLER_MAX_SAMPLES *
+                              sizeof(performance_memory_sampler_sample_t));
+    if (!sampler->samples)
+        goto DEFER_2;
+    sampler->stride     = 1;
+    sampler->interval   = interval;
+    sampler->start_time = __performance_memory_sampler_get_time();
+
+    sampler->statm = open("/proc/self/statm", O_RDONLY);
+    size_t rss;
+    if (sampler->statm < 0)
+        goto DEFER_3;
+    if (__performance_memory_sampler_read_rss(sampler->statm, &rss))
+        goto DEFER_4;
+
+    performance_memory_sampler_t *expected = NULL;
+    if (!__atomic_compare_exchange_n(&performance_memory_sampler_running,
+                                     &expected,
+                                     sampler,
+                                     0,
+                                     __ATOMIC_RELEASE,
+                                     __ATOMIC_RELAXED))
+        goto DEFER_4; /* Another sampler is running */
+
+    for (size_t i = 0; i < PERFORMANCE_PROFILER_PHASE_COUNT; ++i)
+        __atomic_store_n(&performance_memory_sampler_active[i], 0, __ATOMIC_RELAXED);
+
+    if (pthread_create(&sampler->thread, NULL, __performance_memory_sampler_run, sampler))
+        goto DEFER_5;
+    sampler->running = 1;
+    return sampler;
+
+DEFER_5:
+    __atomic_store_n(&performance_memory_sampler_running, NULL, __ATOMIC_RELEASE);
+DEFER_4:
+    close(sampler->statm);
+DEFER_3:
+    free(sampler->samples);
+DEFER_2:
+    free(sampler);
+DEFER_1:
+    return NULL;
+}
+
+/**
+ * @brief Makes the calling thread enter a phase, if a sampler is running.
+ * @param phase Index of the phase (see ::performance_profiler_get_phase_name).
+ */
+void __performance_memory_sampler_enter(size_t phase) {
+    if (!__atomic_load_n(&performance_memory_sampler_running, __ATOMIC_RELAXED))
+        return;
+
+    performance_memory_sampler_leave();
+    performance_memory_sampler_thread_phase = phase;
+    __atomic_fetch_add(&performance_memory_sampler_active[phase], 1, __ATOMIC_RELAXED);
+}
+
+void performance_memory_sampler_enter_dataset(performance_metrics_dataset_step_t step) {
+    __performance_memory_sampler_enter(1 + (size_t) step);
+}
+
+void performance_memory_sampler_enter_query_statistics(size_t query_type) {
+    __performance_memory_sampler_enter(PERFORMANCE_METRICS_DATASET_STEP_DONE + query_type);
+}
+
+void performance_memory_sampler_enter_query_execution(size_t query_type) {
+    __performance_memory_sampler_enter(PERFORMANCE_METRICS_DATASET_STEP_DONE +
+                                       QUERY_TYPE_LIST_COUNT + query_type);
+}
+
+void performance_memory_sampler_leave(void) {
+    if (!performance_memory_sampler_thread_phase)
+        return;
+
+    __atomic_fetch_sub(&performance_memory_sampler_active[performance_memory_sampler_thread_phase],
+                       1,
+                       __ATOMIC_RELAXED);
+    performance_memory_sampler_thread_phase = 0;
+}
+
+void performance_memory_sampler_stop(performance_memory_sampler_t *sampler) {
+    if (!sampler->running)
+        return;
+
+    __atomic_store_n(&sampler->stopping, 1, __ATOMIC_RELEASE);
+    pthread_join(sampler->thread, NULL);
+    sampler->running = 0;
+    __atomic_store_n(&performance_memory_sampler_running, NULL, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief   Checks if a sampler counted the bytes allocated with `malloc`.
+ * @details `mallinfo2` isn't always available, and always reports `0` when `malloc` is replaced
+ *          (e.g.: by sanitizers).
+ *
+ * @param  sampler Sampler to be checked.
+ * @return Whether any sample has a number of bytes allocated with `malloc`.
+ */
+int __performance_memory_sampler_has_heap(const performance_memory_sampler_t *sampler) {
+    return sampler->overall.heap != 0;
+}
+
+/**
+ * @brief Prints a row of the table of peaks.
+ *
+ * @param output   Where to print the row to.
+ * @param name     Name of the phase.
+ * @param peak     Peak memory usage of the phase.
+ * @param has_heap Whether to print the peak number of bytes allocated with `malloc`.
+ */
+void __performance_memory_sampler_print_peak(FILE                                    *output,
+                                             const char                              *name,
+                                             const performance_memory_sampler_peak_t *peak,
+                                             int                                      has_heap) {
+    fprintf(output, "%-22s %8zu %15.2f ", name, peak->samples, peak->rss / (1024.0 * 1024.0));
+    if (has_heap)
+        fprintf(output, "%15.2f\n", peak->heap / (1024.0 * 1024.0));
+    else
+        fprintf(output, "%15s\n", "N/A");
+}
+
+void performance_memory_sampler_print(FILE *output, const performance_memory_sampler_t *sampler) {
+    fprintf(output,
+            "Memory: %zu samples, one every %" PRIu64 " us (%zu kept in the timeline)\n",
+            sampler->taken,
+            sampler->interval,
+            sampler->nsamples);
+
+    fprintf(output,
+            "%-22s %8s %15s %15s\n",
+            "Phase",
+            "Samples",
+            "Peak RSS (MiB)",
+            "Peak heap (MiB)");
+    const int has_heap = __performance_memory_sampler_has_heap(sampler);
+    __performance_memory_sampler_print_peak(output, "all", &sampler->overall, has_heap);
+    for (size_t i = 0; i < PERFORMANCE_PROFILER_PHASE_COUNT; ++i)
+        if (sampler->peaks[i].samples)
+            __performance_memory_sampler_print_peak(output,
+                                                    performance_profiler_get_phase_name(i),
+                                                    &sampler->peaks[i],
+                                                    has_heap);
+    fputc('\n', output);
+}
+
+int performance_memory_sampler_write(const performance_memory_sampler_t *sampler,
+                                     const char                         *path) {
+    FILE *const file = fopen(path, "w");
+    if (!file)
+        return 1;
+
+    const int has_heap = __performance_memory_sampler_has_heap(sampler);
+    fputs("time_us,rss_kib,heap_kib,phases\n", file);
+    for (size_t i = 0; i < sampler->nsamples; ++i) {
+        const performance_memory_sampler_sample_t *const sample = &sampler->samples[i];
+        fprintf(file, "%" PRIu64 ",%zu,", sample->time, sample->rss / 1024);
+        if (has_heap)
+            fprintf(file, "%zu", sample->heap / 1024);
+
+        const char *separator = ",";
+        for (size_t phase = 0; phase < PERFORMANCE_PROFILER_PHASE_COUNT; ++phase) {
+            if (!(sample->phases & ((uint32_t) 1 << phase)))
+                continue;
+            fprintf(file, "%s%s", separator, performance_profiler_get_phase_name(phase));
+            separator = " ";
+        }
+        fputc('\n', file);
+    }
+
+    const int failed = ferror(file) != 0;
+    return fclose(file) || failed;
+}
+
+void performance_memory_sampler_free(performance_memory_sampler_t *sampler) {
+    if (!sampler)
+        return;
+
+    performance_memory_sampler_stop(sampler);
+    close(sampler->statm);
+    free(sampler->samples);
+    free(sampler);
+}
@@ -25,35 +25,151 @@
 #include <glib.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/resource.h>
+#include <time.h>
 
 #include "queries/query_type_list.h"
+#include "testing/performance_memory_sampler.h"
 #include "testing/performance_metrics.h"
+#include "testing/performance_profiler.h"
+#include "utils/top_k.h"
+
+/** @brief Number of empty tasks measured by ::performance_metrics_measure_query_overhead. */
+#define PERFORMANCE_METRICS_OVERHEAD_SAMPLES 256
 
 /**
  * @struct performance_metrics
  * @brief  Information about performance about different parts of the application.
  *
- * @var performance_metrics::current_dataset_step
- *     @brief Current part of the dataset being loaded.
  * @var performance_metrics::dataset_events
  *     @brief Performance information about dataset loading.
+ * @var performance_metrics::dataset_input_methods
+ *     @brief How each dataset file was read (see ::performance_metrics_set_dataset_input_method).
+ * @var performance_metrics::dataset_estimated_lines
+ *     @brief Estimated number of lines of each dataset file (see
+ *            ::performance_metrics_set_dataset_line_counts).
+ * @var performance_metrics::dataset_lines
+ *     @brief Number of lines loaded from each dataset file.
+ * @var performance_metrics::dataset_peak_rss
+ *     @brief Peak resident memory (in KiB) of the program when each dataset loading step ended.
  * @var performance_metrics::statistical_events
  *     @brief Performance information about query statistical data collection.
+ * @var performance_metrics::statistics_peak_rss
+ *     @brief Peak resident memory (in KiB) of the program when query statistical data generation
+ *            last ended.
+ * @var performance_metrics::statistics_memory
+ *     @brief   Peak memory usage of the arenas of each query type's statistical data.
+ *     @details Entries with no blocks haven't been registered.
  * @var performance_metrics::query_events
  *     @brief   Performance information about individual query execution.
  *     @details Hash tables that associate a query's line number in a file (integer) to a
  *              ::performance_event_t.
+ * @var performance_metrics::has_file_breakdowns
+ *     @brief Whether each of ::performance_metrics::file_breakdowns has been registered.
+ * @var performance_metrics::file_breakdowns
+ *     @brief Where the time of loading each dataset file went (see
+ *            ::performance_metrics_set_dataset_breakdown).
+ * @var performance_metrics::dataset_wall_time
+ *     @brief Wall-clock time (in microseconds) of loading the whole dataset.
+ * @var performance_metrics::dataset_spans
+ *     @brief   Start and end (monotonic clock, in nanoseconds) of each dataset loading step.
+ *     @details `{0, 0}` for steps that weren't measured.
+ * @var performance_metrics::statistics_spans
+ *     @brief Start and end (monotonic clock, in nanoseconds) of each query type's statistical data
+ *            generation, over all threads.
+ * @var performance_metrics::execution_spans
+ *     @brief Start of the first and end of the last execution (monotonic clock, in nanoseconds) of
+ *            each query type, over all threads.
+ * @var performance_metrics::query_mode
+ *     @brief How query executions are measured.
+ * @var performance_metrics::query_sampling_interval
+ *     @brief One in every ::performance_metrics::query_sampling_interval executions is measured.
+ * @var performance_metrics::query_sampling_counters
+ *     @brief Number of executions of each query type seen, to choose which ones to sample.
+ * @var performance_metrics::query_sampled
+ *     @brief Whether the query execution currently being measured was sampled.
+ * @var performance_metrics::query_light_start
+ *     @brief   Measurement slot for the query execution currently being measured.
+ *     @details Only used in ::PERFORMANCE_METRICS_QUERY_MODE_LIGHT, so that nothing is allocated
+ *              before the execution is done.
+ * @var performance_metrics::query_overheads
+ *     @brief Overhead (in nanoseconds) of measuring a query execution in each mode.
+ * @var performance_metrics::query_strategies
+ *     @brief How each query type was chosen to be executed.
+ * @var performance_metrics::query_predicted_costs
+ *     @brief   Predicted costs (in nanoseconds) of each query type's strategies.
+ *     @details Indexed by query type and then by ::performance_metrics_query_strategy_t (minus
+ *              one).
+ * @var performance_metrics::duplicate_query_count
+ *     @brief Number of queries not executed for being duplicates of other queries.
+ * @var performance_metrics::memory_report
+ *     @brief Memory usage of each data structure in the database, or `NULL` if not measured.
+ * @var performance_metrics::has_freeze_memory
+ *     @brief Whether ::performance_metrics::freeze_memory has been registered.
+ * @var performance_metrics::freeze_memory
+ *     @brief Total memory usage of the database before and after it was frozen.
+ * @var performance_metrics::has_output_statistics
+ *     @brief Whether ::performance_metrics::output_statistics has been registered.
+ * @var performance_metrics::output_statistics
+ *     @brief Information about how query output files were written.
+ * @var performance_metrics::has_id_filter_statistics
+ *     @brief Whether ::performance_metrics::id_filter_statistics has been registered.
+ * @var performance_metrics::id_filter_statistics
+ *     @brief How lookups in the identifier filters of the database were answered.
+ * @var performance_metrics::has_catalog
+ *     @brief Whether ::performance_metrics::catalog has been registered.
+ * @var performance_metrics::catalog
+ *     @brief Statistics about the data in the database.
+ * @var performance_metrics::has_result_cache_statistics
+ *     @brief Whether ::performance_metrics::result_cache_statistics has been registered.
+ * @var performance_metrics::result_cache_statistics
+ *     @brief How lookups in the query result cache were answered.
  * @var performance_metrics::program_total_time
  *     @brief Time (in microseconds) that the whole program took to be executed.
  * @var performance_metrics::program_total_mem
  *     @brief Peak memory usage (in KiB) of the program.
  */
 struct performance_metrics {
-    performance_metrics_dataset_step_t current_dataset_step;
-    performance_event_t               *dataset_events[PERFORMANCE_METRICS_DATASET_STEP_DONE];
-    performance_event_t               *statistical_events[QUERY_TYPE_LIST_COUNT];
-    GHashTable                        *query_events[QUERY_TYPE_LIST_COUNT];
+    performance_event_t     *dataset_events[PERFORMANCE_METRICS_DATASET_STEP_DONE];
+    stream_tokenize_method_t dataset_input_methods[PERFORMANCE_METRICS_DATASET_STEP_DONE];
+    size_t                   dataset_estimated_lines[PERFORMANCE_METRICS_DATASET_STEP_DONE];
+    size_t                   dataset_lines[PERFORMANCE_METRICS_DATASET_STEP_DONE];
+    size_t                   dataset_peak_rss[PERFORMANCE_METRICS_DATASET_STEP_DONE];
+    performance_event_t     *statistical_events[QUERY_TYPE_LIST_COUNT];
+    size_t                   statistics_peak_rss;
+    memory_usage_t           statistics_memory[QUERY_TYPE_LIST_COUNT];
+    GHashTable              *query_events[QUERY_TYPE_LIST_COUNT];
+
+    int has_file_breakdowns[PERFORMANCE_METRICS_DATASET_STEP_DONE];
+    performance_metrics_dataset_breakdown_t file_breakdowns[PERFORMANCE_METRICS_DATASET_STEP_DONE];
+    uint64_t                                dataset_wall_time;
+    uint64_t                                dataset_spans[PERFORMANCE_METRICS_DATASET_STEP_DONE][2];
+    uint64_t                                statistics_spans[QUERY_TYPE_LIST_COUNT][2];
+    uint64_t                                execution_spans[QUERY_TYPE_LIST_COUNT][2];
+
+    performance_metrics_query_mode_t query_mode;
+    size_t                           query_sampling_interval;
+    size_t                           query_sampling_counters[QUERY_TYPE_LIST_COUNT];
+    int                              query_sampled;
+    performance_event_timestamp_t    query_light_start;
+    uint64_t                         query_overheads[PERFORMANCE_METRICS_QUERY_MODE_COUNT];
+
+    performance_metrics_query_strategy_t query_strategies[QUERY_TYPE_LIST_COUNT];
+    uint64_t                             query_predicted_costs[QUERY_TYPE_LIST_COUNT][2];
+
+    size_t                          duplicate_query_count;
+    memory_report_t                *memory_report;
+    int                             has_freeze_memory;
+    memory_usage_t                  freeze_memory[2];
+    int                             has_output_statistics;
+    async_file_writer_statistics_t  output_statistics;
+    int                             has_id_filter_statistics;
+    bloom_filter_statistics_t       id_filter_statistics;
+    int                             has_catalog;
+    database_catalog_t              catalog;
+    int                             has_result_cache_statistics;
+    query_result_cache_statistics_t result_cache_statistics;
 
     uint64_t program_total_time;
     size_t   program_total_mem;
@@ -64,20 +180,50 @@ performance_metrics_t *performance_metrics_create(void) {
     if (!ret)
         return NULL;
 
-    ret->current_dataset_step = PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED;
-    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i)
-        ret->dataset_events[i] = NULL;
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i) {
+        ret->dataset_events[i]          = NULL;
+        ret->dataset_input_methods[i]   = STREAM_TOKENIZE_METHOD_MMAP;
+        ret->dataset_estimated_lines[i] = 0;
+        ret->dataset_lines[i]           = 0;
+        ret->dataset_peak_rss[i]        = 0;
+        ret->has_file_breakdowns[i]     = 0;
+    }
 
     for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
-        ret->statistical_events[i] = NULL;
+        ret->statistical_events[i]       = NULL;
+        ret->statistics_memory[i]        = (memory_usage_t) {0};
+        ret->query_sampling_counters[i]  = 0;
+        ret->query_strategies[i]         = PERFORMANCE_METRICS_QUERY_STRATEGY_NONE;
+        ret->query_predicted_costs[i][0] = 0;
+        ret->query_predicted_costs[i][1] = 0;
         ret->query_events[i]       = g_hash_table_new_full(g_direct_hash,
                                                      g_direct_equal,
                                                      NULL,
                                                      (GDestroyNotify) performance_event_free);
     }
 
-    ret->program_total_time = 0;
-    ret->program_total_mem  = 0;
+    ret->dataset_wall_time       = 0;
+    memset(ret->dataset_spans, 0, sizeof(ret->dataset_spans));
+    memset(ret->statistics_spans, 0, sizeof(ret->statistics_spans));
+    memset(ret->execution_spans, 0, sizeof(ret->execution_spans));
+    ret->statistics_peak_rss     = 0;
+    ret->query_mode              = PERFORMANCE_METRICS_QUERY_MODE_FULL;
+    ret->query_sampling_interval = 1;
+    ret->query_sampled           = 0;
+    ret->query_light_start       = 0;
+    for (size_t i = 0; i < PERFORMANCE_METRICS_QUERY_MODE_COUNT; ++i)
+        ret->query_overheads[i] = 0;
+
+    ret->duplicate_query_count = 0;
+    ret->memory_report         = NULL;
+    ret->has_freeze_memory     = 0;
+    ret->has_output_statistics = 0;
+    ret->program_total_time    = 0;
+    ret->program_total_mem     = 0;
+
+    ret->has_id_filter_statistics    = 0;
+    ret->has_catalog                 = 0;
+    ret->has_result_cache_statistics = 0;
 
     return ret;
 }
@@ -88,8 +234,13 @@ performance_metrics_t *performance_metrics_clone(const performance_metrics_t *me
         return NULL;
     memset(ret, 0, sizeof(performance_metrics_t)); /* To ease cleanup on allocation failure */
 
-    ret->current_dataset_step = metrics->current_dataset_step;
     for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i) {
+        ret->dataset_input_methods[i]   = metrics->dataset_input_methods[i];
+        ret->dataset_estimated_lines[i] = metrics->dataset_estimated_lines[i];
+        ret->dataset_lines[i]           = metrics->dataset_lines[i];
+        ret->dataset_peak_rss[i]        = metrics->dataset_peak_rss[i];
+        ret->has_file_breakdowns[i]     = metrics->has_file_breakdowns[i];
+        ret->file_breakdowns[i]         = metrics->file_breakdowns[i];
         if (metrics->dataset_events[i]) {
 
             ret->dataset_events[i] = performance_event_clone(metrics->dataset_events[i]);
@@ -129,8 +280,45 @@ performance_metrics_t *performance_metrics_clone(const performance_metrics_t *me
         }
     }
 
-    ret->program_total_time = metrics->program_total_time;
-    ret->program_total_mem  = metrics->program_total_mem;
+    if (metrics->memory_report) {
+        ret->memory_report = memory_report_clone(metrics->memory_report);
+        if (!ret->memory_report) {
+            performance_metrics_free(ret);
+            return NULL;
+        }
+    }
+
+    ret->dataset_wall_time       = metrics->dataset_wall_time;
+    memcpy(ret->dataset_spans, metrics->dataset_spans, sizeof(metrics->dataset_spans));
+    memcpy(ret->statistics_spans, metrics->statistics_spans, sizeof(metrics->statistics_spans));
+    memcpy(ret->execution_spans, metrics->execution_spans, sizeof(metrics->execution_spans));
+    ret->statistics_peak_rss     = metrics->statistics_peak_rss;
+    memcpy(ret->statistics_memory, metrics->statistics_memory, sizeof(metrics->statistics_memory));
+    ret->query_mode              = metrics->query_mode;
+    ret->query_sampling_interval = metrics->query_sampling_interval;
+    memcpy(ret->query_sampling_counters,
+           metrics->query_sampling_counters,
+           sizeof(metrics->query_sampling_counters));
+    memcpy(ret->query_overheads, metrics->query_overheads, sizeof(metrics->query_overheads));
+    memcpy(ret->query_strategies, metrics->query_strategies, sizeof(metrics->query_strategies));
+    memcpy(ret->query_predicted_costs,
+           metrics->query_predicted_costs,
+           sizeof(metrics->query_predicted_costs));
+
+    ret->duplicate_query_count = metrics->duplicate_query_count;
+    ret->has_freeze_memory     = metrics->has_freeze_memory;
+    memcpy(ret->freeze_memory, metrics->freeze_memory, sizeof(metrics->freeze_memory));
+    ret->has_output_statistics = metrics->has_output_statistics;
+    ret->output_statistics     = metrics->output_statistics;
+    ret->program_total_time    = metrics->program_total_time;
+    ret->program_total_mem     = metrics->program_total_mem;
+
+    ret->has_id_filter_statistics    = metrics->has_id_filter_statistics;
+    ret->id_filter_statistics        = metrics->id_filter_statistics;
+    ret->has_catalog                 = metrics->has_catalog;
+    ret->catalog                     = metrics->catalog;
+    ret->has_result_cache_statistics = metrics->has_result_cache_statistics;
+    ret->result_cache_statistics     = metrics->result_cache_statistics;
 
     return ret;
 }
@@ -163,36 +351,130 @@ void __performance_metrics_print_dataset_measurement_error(
     fprintf(stderr, "Failed to perform resource usage measurement in dataset! (%s)\n", where);
 }
 
-void performance_metrics_measure_dataset(performance_metrics_t             *metrics,
-                                         performance_metrics_dataset_step_t step) {
-    if (!metrics)
+/**
+ * @brief  Gets the peak resident memory of the program so far.
+ * @return The peak resident set size (in KiB), or `0` if it couldn't be measured.
+ */
+size_t __performance_metrics_get_peak_rss(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage))
+        return 0;
+    return usage.ru_maxrss;
+}
+
+/**
+ * @brief  Gets the current value of the system's monotonic clock.
+ * @return The value of the clock in nanoseconds, or `0` on failure.
+ */
+uint64_t __performance_metrics_get_monotonic_time(void) {
+    struct timespec time;
+    if (clock_gettime(CLOCK_MONOTONIC, &time))
+        return 0;
+    return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+/**
+ * @brief Extends a wall-clock span to include another one.
+ *
+ * @param span  Start and end of the span to be modified (`{0, 0}` if empty).
+ * @param other Start and end of the span to be included (`{0, 0}` if empty).
+ */
+void __performance_metrics_widen_span(uint64_t span[2], const uint64_t other[2]) {
+    if (!other[1])
         return;
 
-    /* Finish previous measurement (don't act on non-existant measurements) */
-    if (metrics->current_dataset_step != PERFORMANCE_METRICS_DATASET_STEP_NOT_STARTED &&
-        metrics->dataset_events[metrics->current_dataset_step]) {
+    if (!span[1] || other[0] < span[0])
+        span[0] = other[0];
+    if (other[1] > span[1])
+        span[1] = other[1];
+}
 
-        if (performance_event_stop_measuring(
-                metrics->dataset_events[metrics->current_dataset_step]))
-            __performance_metrics_print_dataset_measurement_error(metrics->current_dataset_step);
-    }
+/**
+ * @brief  Gets the duration of a wall-clock span.
+ * @param  span Start and end of the span (monotonic clock, in nanoseconds).
+ * @return The duration of @p span in microseconds, or `0` if it's empty.
+ */
+uint64_t __performance_metrics_get_span_time(const uint64_t span[2]) {
+    return span[1] > span[0] ? (span[1] - span[0]) / 1000 : 0;
+}
 
-    /* Start current measurement */
-    if (step == PERFORMANCE_METRICS_DATASET_STEP_DONE)
+void performance_metrics_start_measuring_dataset(performance_metrics_t             *metrics,
+                                                 performance_metrics_dataset_step_t step) {
+    if (!metrics)
         return;
+    performance_profiler_enter_dataset(step);
+    performance_memory_sampler_enter_dataset(step);
+
+    if (metrics->dataset_events[step])
+        performance_event_free(metrics->dataset_events[step]);
 
     performance_event_t *const perf = performance_event_start_measuring();
     if (!perf)
         __performance_metrics_print_dataset_measurement_error(step);
 
-    metrics->current_dataset_step = step;
-    metrics->dataset_events[step] = perf;
+    metrics->dataset_events[step]   = perf;
+    metrics->dataset_spans[step][0] = __performance_metrics_get_monotonic_time();
+    metrics->dataset_spans[step][1] = 0;
+}
+
+void performance_metrics_stop_measuring_dataset(performance_metrics_t             *metrics,
+                                                performance_metrics_dataset_step_t step) {
+    if (!metrics)
+        return;
+    performance_profiler_leave();
+    performance_memory_sampler_leave();
+    metrics->dataset_spans[step][1] = __performance_metrics_get_monotonic_time();
+    metrics->dataset_peak_rss[step] = __performance_metrics_get_peak_rss();
+
+    if (!metrics->dataset_events[step] ||
+        performance_event_stop_measuring(metrics->dataset_events[step]))
+        __performance_metrics_print_dataset_measurement_error(step);
+}
+
+void performance_metrics_set_dataset_input_method(performance_metrics_t             *metrics,
+                                                  performance_metrics_dataset_step_t step,
+                                                  stream_tokenize_method_t           method) {
+    if (!metrics)
+        return;
+
+    metrics->dataset_input_methods[step] = method;
+}
+
+void performance_metrics_set_dataset_line_counts(performance_metrics_t             *metrics,
+                                                 performance_metrics_dataset_step_t step,
+                                                 size_t                             estimated,
+                                                 size_t                             actual) {
+    if (!metrics)
+        return;
+
+    metrics->dataset_estimated_lines[step] = estimated;
+    metrics->dataset_lines[step]           = actual;
+}
+
+void performance_metrics_set_dataset_breakdown(
+    performance_metrics_t                         *metrics,
+    performance_metrics_dataset_step_t             step,
+    const performance_metrics_dataset_breakdown_t *breakdown) {
+    if (!metrics)
+        return;
+
+    metrics->has_file_breakdowns[step] = 1;
+    metrics->file_breakdowns[step]     = *breakdown;
+}
+
+void performance_metrics_set_dataset_wall_time(performance_metrics_t *metrics, uint64_t time) {
+    if (!metrics)
+        return;
+
+    metrics->dataset_wall_time = time;
 }
 
 void performance_metrics_start_measuring_query_statistics(performance_metrics_t *metrics,
                                                           size_t                 query_type) {
     if (!metrics)
         return;
+    performance_profiler_enter_query_statistics(query_type);
+    performance_memory_sampler_enter_query_statistics(query_type);
 
     if (metrics->statistical_events[query_type - 1])
         performance_event_free(metrics->statistical_events[query_type - 1]);
@@ -203,13 +485,19 @@ void performance_metrics_start_measuring_query_statistics(performance_metrics_t
                 "Failed to measure resource usage in query %zu's statistical data generation!\n",
                 query_type);
 
-    metrics->statistical_events[query_type - 1] = perf;
+    metrics->statistical_events[query_type - 1]  = perf;
+    metrics->statistics_spans[query_type - 1][0] = __performance_metrics_get_monotonic_time();
+    metrics->statistics_spans[query_type - 1][1] = 0;
 }
 
 void performance_metrics_stop_measuring_query_statistics(performance_metrics_t *metrics,
                                                          size_t                 query_type) {
     if (!metrics)
         return;
+    performance_profiler_leave();
+    performance_memory_sampler_leave();
+    metrics->statistics_spans[query_type - 1][1] = __performance_metrics_get_monotonic_time();
+    metrics->statistics_peak_rss                 = __performance_metrics_get_peak_rss();
 
     if (!metrics->statistical_events[query_type - 1] ||
         performance_event_stop_measuring(metrics->statistical_events[query_type - 1])) {
@@ -220,18 +508,45 @@ void performance_metrics_stop_measuring_query_statistics(performance_metrics_t *
     }
 }
 
+/**
+ * @brief Prints a query execution measurement error to `stderr`.
+ *
+ * @param query_type   Query type whose execution failed to be measured.
+ * @param line_in_file Line of the query in the batch mode's input file.
+ */
+void __performance_metrics_print_query_execution_error(size_t query_type, size_t line_in_file) {
+    fprintf(stderr,
+            "Failed to measure resource usage in query %zu's (line %zu) execution!\n",
+            query_type,
+            line_in_file);
+}
+
 void performance_metrics_start_measuring_query_execution(performance_metrics_t *metrics,
                                                          size_t                 query_type,
                                                          size_t                 line_in_file) {
     if (!metrics)
         return;
+    performance_profiler_enter_query_execution(query_type);
+    performance_memory_sampler_enter_query_execution(query_type);
+    if (!metrics->execution_spans[query_type - 1][0])
+        metrics->execution_spans[query_type - 1][0] = __performance_metrics_get_monotonic_time();
+
+    metrics->query_sampled =
+        metrics->query_sampling_counters[query_type - 1]++ % metrics->query_sampling_interval == 0;
+    if (!metrics->query_sampled)
+        return;
+
+    if (metrics->query_mode == PERFORMANCE_METRICS_QUERY_MODE_LIGHT) {
+        if (performance_event_start_measuring_light(&metrics->query_light_start)) {
+            __performance_metrics_print_query_execution_error(query_type, line_in_file);
+            metrics->query_sampled = 0;
+        }
+        return;
+    }
 
     performance_event_t *const perf = performance_event_start_measuring();
     if (!perf)
-        fprintf(stderr,
-                "Failed to measure resource usage in query %zu's (line %zu) execution!\n",
-                query_type,
-                line_in_file);
+        __performance_metrics_print_query_execution_error(query_type, line_in_file);
 
     g_hash_table_insert(metrics->query_events[query_type - 1],
                         GUINT_TO_POINTER(line_in_file),
@@ -243,15 +558,208 @@ void performance_metrics_stop_measuring_query_execution(performance_metrics_t *m
                                                         size_t                 line_in_file) {
     if (!metrics)
         return;
+    performance_profiler_leave();
+    performance_memory_sampler_leave();
+    metrics->execution_spans[query_type - 1][1] = __performance_metrics_get_monotonic_time();
+
+    if (!metrics->query_sampled)
+        return;
+    metrics->query_sampled = 0;
+
+    if (metrics->query_mode == PERFORMANCE_METRICS_QUERY_MODE_LIGHT) {
+        performance_event_t *const perf =
+            performance_event_stop_measuring_light(metrics->query_light_start);
+        if (!perf) {
+            __performance_metrics_print_query_execution_error(query_type, line_in_file);
+            return;
+        }
+
+        g_hash_table_insert(metrics->query_events[query_type - 1],
+                            GUINT_TO_POINTER(line_in_file),
+                            perf);
+        return;
+    }
 
     performance_event_t *const perf =
         g_hash_table_lookup(metrics->query_events[query_type - 1], GUINT_TO_POINTER(line_in_file));
 
     if (!perf || performance_event_stop_measuring(perf))
-        fprintf(stderr,
-                "Failed to measure resource usage in query %zu's (line %zu) execution!\n",
-                query_type,
-                line_in_file);
+        __performance_metrics_print_query_execution_error(query_type, line_in_file);
+}
+
+void performance_metrics_set_query_sampling(performance_metrics_t           *metrics,
+                                            performance_metrics_query_mode_t mode,
+                                            size_t                           interval) {
+    if (!metrics)
+        return;
+
+    metrics->query_mode              = mode;
+    metrics->query_sampling_interval = interval ? interval : 1;
+}
+
+void performance_metrics_copy_query_sampling(performance_metrics_t       *metrics,
+                                             const performance_metrics_t *source) {
+    if (!metrics)
+        return;
+
+    metrics->query_mode              = source->query_mode;
+    metrics->query_sampling_interval = source->query_sampling_interval;
+}
+
+void performance_metrics_measure_query_overhead(performance_metrics_t *metrics) {
+    if (!metrics)
+        return;
+
+    for (size_t i = 0; i < PERFORMANCE_METRICS_QUERY_MODE_COUNT; ++i) {
+        metrics->query_overheads[i] = 0;
+
+        /* Measured in a scratch instance, not to pollute the real measurements */
+        performance_metrics_t *const scratch = performance_metrics_create();
+        if (!scratch)
+            continue;
+        performance_metrics_set_query_sampling(scratch, i, 1);
+
+        const uint64_t start = __performance_metrics_get_monotonic_time();
+        for (size_t j = 0; j < PERFORMANCE_METRICS_OVERHEAD_SAMPLES; ++j) {
+            performance_metrics_start_measuring_query_execution(scratch, 1, j + 1);
+            performance_metrics_stop_measuring_query_execution(scratch, 1, j + 1);
+        }
+        const uint64_t end = __performance_metrics_get_monotonic_time();
+
+        if (start && end > start)
+            metrics->query_overheads[i] = (end - start) / PERFORMANCE_METRICS_OVERHEAD_SAMPLES;
+        performance_metrics_free(scratch);
+    }
+}
+
+void performance_metrics_merge_query_measurements(performance_metrics_t *metrics,
+                                                  performance_metrics_t *source) {
+    if (!metrics)
+        return;
+
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        if (source->statistical_events[i]) {
+            if (metrics->statistical_events[i])
+                performance_event_free(metrics->statistical_events[i]);
+
+            metrics->statistical_events[i] = source->statistical_events[i];
+            source->statistical_events[i]  = NULL;
+        }
+
+        __performance_metrics_widen_span(metrics->statistics_spans[i], source->statistics_spans[i]);
+        __performance_metrics_widen_span(metrics->execution_spans[i], source->execution_spans[i]);
+
+        if (source->statistics_memory[i].reserved_bytes >
+            metrics->statistics_memory[i].reserved_bytes)
+            metrics->statistics_memory[i] = source->statistics_memory[i];
+
+        if (source->query_strategies[i] != PERFORMANCE_METRICS_QUERY_STRATEGY_NONE) {
+            metrics->query_strategies[i] = source->query_strategies[i];
+            memcpy(metrics->query_predicted_costs[i],
+                   source->query_predicted_costs[i],
+                   sizeof(source->query_predicted_costs[i]));
+        }
+
+        GHashTableIter iter;
+        gpointer       key, value;
+        g_hash_table_iter_init(&iter, source->query_events[i]);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            g_hash_table_iter_steal(&iter);
+            g_hash_table_insert(metrics->query_events[i], key, value);
+        }
+    }
+}
+
+void performance_metrics_set_query_statistics_memory(performance_metrics_t *metrics,
+                                                     size_t                 query_type,
+                                                     const memory_usage_t  *usage) {
+    if (!metrics)
+        return;
+
+    memory_usage_t *const peak = &metrics->statistics_memory[query_type - 1];
+    if (usage->reserved_bytes > peak->reserved_bytes)
+        *peak = *usage;
+}
+
+void performance_metrics_set_query_strategy(performance_metrics_t               *metrics,
+                                            size_t                               query_type,
+                                            performance_metrics_query_strategy_t strategy,
+                                            uint64_t                             index_cost,
+                                            uint64_t                             scan_cost) {
+    if (!metrics)
+        return;
+
+    metrics->query_strategies[query_type - 1]         = strategy;
+    metrics->query_predicted_costs[query_type - 1][0] = index_cost;
+    metrics->query_predicted_costs[query_type - 1][1] = scan_cost;
+}
+
+void performance_metrics_set_duplicate_query_count(performance_metrics_t *metrics, size_t count) {
+    if (!metrics)
+        return;
+
+    metrics->duplicate_query_count = count;
+}
+
+void performance_metrics_set_memory_report(performance_metrics_t *metrics,
+                                           memory_report_t       *report) {
+    if (!metrics) {
+        if (report)
+            memory_report_free(report);
+        return;
+    }
+
+    if (metrics->memory_report)
+        memory_report_free(metrics->memory_report);
+    metrics->memory_report = report;
+}
+
+void performance_metrics_set_freeze_memory(performance_metrics_t *metrics,
+                                           const memory_usage_t  *before,
+                                           const memory_usage_t  *after) {
+    if (!metrics)
+        return;
+
+    metrics->has_freeze_memory = 1;
+    metrics->freeze_memory[0]  = *before;
+    metrics->freeze_memory[1]  = *after;
+}
+
+void performance_metrics_set_output_statistics(performance_metrics_t                *metrics,
+                                               const async_file_writer_statistics_t *statistics) {
+    if (!metrics)
+        return;
+
+    metrics->has_output_statistics = 1;
+    metrics->output_statistics     = *statistics;
+}
+
+void performance_metrics_set_id_filter_statistics(performance_metrics_t           *metrics,
+                                                  const bloom_filter_statistics_t *statistics) {
+    if (!metrics)
+        return;
+
+    metrics->has_id_filter_statistics = 1;
+    metrics->id_filter_statistics     = *statistics;
+}
+
+void performance_metrics_set_catalog(performance_metrics_t     *metrics,
+                                     const database_catalog_t *catalog) {
+    if (!metrics)
+        return;
+
+    metrics->has_catalog = 1;
+    metrics->catalog     = *catalog;
+}
+
+void performance_metrics_set_result_cache_statistics(
+    performance_metrics_t                 *metrics,
+    const query_result_cache_statistics_t *statistics) {
+    if (!metrics)
+        return;
+
+    metrics->has_result_cache_statistics = 1;
+    metrics->result_cache_statistics     = *statistics;
 }
 
 void performance_metrics_measure_whole_program(performance_metrics_t *metrics) {
@@ -277,12 +785,139 @@ const performance_event_t *
     return metrics->dataset_events[step];
 }
 
+stream_tokenize_method_t
+    performance_metrics_get_dataset_input_method(const performance_metrics_t       *metrics,
+                                                 performance_metrics_dataset_step_t step) {
+    return metrics->dataset_input_methods[step];
+}
+
+size_t performance_metrics_get_dataset_estimated_lines(const performance_metrics_t       *metrics,
+                                                       performance_metrics_dataset_step_t step) {
+    return metrics->dataset_estimated_lines[step];
+}
+
+size_t performance_metrics_get_dataset_lines(const performance_metrics_t       *metrics,
+                                             performance_metrics_dataset_step_t step) {
+    return metrics->dataset_lines[step];
+}
+
+int performance_metrics_get_dataset_breakdown(const performance_metrics_t             *metrics,
+                                              performance_metrics_dataset_step_t       step,
+                                              performance_metrics_dataset_breakdown_t *breakdown) {
+    if (!metrics->has_file_breakdowns[step])
+        return 1;
+
+    *breakdown = metrics->file_breakdowns[step];
+    return 0;
+}
+
+uint64_t performance_metrics_get_dataset_wall_time(const performance_metrics_t *metrics) {
+    return metrics->dataset_wall_time;
+}
+
+uint64_t performance_metrics_get_dataset_step_wall_time(const performance_metrics_t       *metrics,
+                                                        performance_metrics_dataset_step_t step) {
+    return __performance_metrics_get_span_time(metrics->dataset_spans[step]);
+}
+
+uint64_t performance_metrics_get_query_statistics_wall_time(const performance_metrics_t *metrics,
+                                                            size_t query_type) {
+    return __performance_metrics_get_span_time(metrics->statistics_spans[query_type - 1]);
+}
+
+uint64_t performance_metrics_get_query_execution_wall_time(const performance_metrics_t *metrics,
+                                                           size_t query_type) {
+    return __performance_metrics_get_span_time(metrics->execution_spans[query_type - 1]);
+}
+
+size_t performance_metrics_get_dataset_peak_rss(const performance_metrics_t       *metrics,
+                                                performance_metrics_dataset_step_t step) {
+    return metrics->dataset_peak_rss[step];
+}
+
+size_t performance_metrics_get_query_statistics_peak_rss(const performance_metrics_t *metrics) {
+    return metrics->statistics_peak_rss;
+}
+
+const memory_usage_t *
+    performance_metrics_get_query_statistics_memory(const performance_metrics_t *metrics,
+                                                    size_t                       query_type) {
+    const memory_usage_t *const usage = &metrics->statistics_memory[query_type - 1];
+    return usage->blocks ? usage : NULL;
+}
+
 const performance_event_t *
     performance_metrics_get_query_statistics_measurement(const performance_metrics_t *metrics,
                                                          size_t                       query_type) {
     return metrics->statistical_events[query_type - 1];
 }
 
+performance_metrics_query_mode_t
+    performance_metrics_get_query_mode(const performance_metrics_t *metrics) {
+    return metrics->query_mode;
+}
+
+size_t performance_metrics_get_query_sampling_interval(const performance_metrics_t *metrics) {
+    return metrics->query_sampling_interval;
+}
+
+uint64_t performance_metrics_get_query_overhead(const performance_metrics_t     *metrics,
+                                                performance_metrics_query_mode_t mode) {
+    return metrics->query_overheads[mode];
+}
+
+performance_metrics_query_strategy_t
+    performance_metrics_get_query_strategy(const performance_metrics_t *metrics,
+                                           size_t                       query_type,
+                                           uint64_t                    *out_index_cost,
+                                           uint64_t                    *out_scan_cost) {
+
+    const performance_metrics_query_strategy_t strategy = metrics->query_strategies[query_type - 1];
+    if (strategy != PERFORMANCE_METRICS_QUERY_STRATEGY_NONE) {
+        *out_index_cost = metrics->query_predicted_costs[query_type - 1][0];
+        *out_scan_cost  = metrics->query_predicted_costs[query_type - 1][1];
+    }
+    return strategy;
+}
+
+size_t performance_metrics_get_duplicate_query_count(const performance_metrics_t *metrics) {
+    return metrics->duplicate_query_count;
+}
+
+const memory_report_t *performance_metrics_get_memory_report(const performance_metrics_t *metrics) {
+    return metrics->memory_report;
+}
+
+int performance_metrics_get_freeze_memory(const performance_metrics_t *metrics,
+                                          memory_usage_t              *out_before,
+                                          memory_usage_t              *out_after) {
+    if (!metrics->has_freeze_memory)
+        return 1;
+
+    *out_before = metrics->freeze_memory[0];
+    *out_after  = metrics->freeze_memory[1];
+    return 0;
+}
+
+const async_file_writer_statistics_t *
+    performance_metrics_get_output_statistics(const performance_metrics_t *metrics) {
+    return metrics->has_output_statistics ? &metrics->output_statistics : NULL;
+}
+
+const bloom_filter_statistics_t *
+    performance_metrics_get_id_filter_statistics(const performance_metrics_t *metrics) {
+    return metrics->has_id_filter_statistics ? &metrics->id_filter_statistics : NULL;
+}
+
+const database_catalog_t *performance_metrics_get_catalog(const performance_metrics_t *metrics) {
+    return metrics->has_catalog ? &metrics->catalog : NULL;
+}
+
+const query_result_cache_statistics_t *
+    performance_metrics_get_result_cache_statistics(const performance_metrics_t *metrics) {
+    return metrics->has_result_cache_statistics ? &metrics->result_cache_statistics : NULL;
+}
+
 uint64_t performance_metrics_get_program_total_time(const performance_metrics_t *metrics) {
     return metrics->program_total_time;
 }
@@ -328,6 +963,117 @@ size_t performance_metrics_get_query_execution_measurements(const performance_me
     return length;
 }
 
+const performance_event_t *
+    performance_metrics_get_query_execution_measurement(const performance_metrics_t *metrics,
+                                                        size_t                       query_type,
+                                                        size_t                       line_in_file) {
+    return g_hash_table_lookup(metrics->query_events[query_type - 1],
+                               GUINT_TO_POINTER(line_in_file));
+}
+
+performance_event_t *
+    performance_metrics_get_query_execution_total(const performance_metrics_t *metrics,
+                                                  size_t                       query_type) {
+    performance_event_t *ret = NULL;
+
+    GHashTableIter iter;
+    gpointer       value;
+    g_hash_table_iter_init(&iter, metrics->query_events[query_type - 1]);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        if (ret) {
+            performance_event_add(ret, value);
+        } else {
+            ret = performance_event_clone(value);
+            if (!ret)
+                return NULL;
+        }
+    }
+
+    return ret;
+}
+
+int performance_metrics_get_query_execution_histograms(const performance_metrics_t *metrics,
+                                                       size_t                       query_type,
+                                                       performance_histogram_t    **out_times,
+                                                       performance_histogram_t    **out_memory) {
+    performance_histogram_t *const times  = performance_histogram_create();
+    performance_histogram_t *const memory = performance_histogram_create();
+    if (!times || !memory) {
+        if (times)
+            performance_histogram_free(times);
+        if (memory)
+            performance_histogram_free(memory);
+        return 1;
+    }
+
+    GHashTableIter iter;
+    gpointer       value;
+    g_hash_table_iter_init(&iter, metrics->query_events[query_type - 1]);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        performance_histogram_record(times, performance_event_get_elapsed_time(value));
+        performance_histogram_record(memory, performance_event_get_used_memory(value));
+    }
+
+    *out_times  = times;
+    *out_memory = memory;
+    return 0;
+}
+
+/**
+ * @brief   Comparison function for sorting query executions from the slowest to the fastest.
+ * @details Auxiliary method for ::performance_metrics_get_slowest_query_executions.
+ */
+gint __performance_metrics_query_execution_compare_func(gconstpointer a, gconstpointer b) {
+    const performance_metrics_query_execution_t *const execution_a = a;
+    const performance_metrics_query_execution_t *const execution_b = b;
+
+    if (execution_a->time != execution_b->time)
+        return execution_a->time < execution_b->time ? 1 : -1;
+    if (execution_a->query_type != execution_b->query_type)
+        return execution_a->query_type < execution_b->query_type ? -1 : 1;
+    if (execution_a->line_in_file != execution_b->line_in_file)
+        return execution_a->line_in_file < execution_b->line_in_file ? -1 : 1;
+    return 0;
+}
+
+size_t
+    performance_metrics_get_slowest_query_executions(const performance_metrics_t *metrics,
+                                                     size_t                       n,
+                                                     performance_metrics_query_execution_t **out) {
+    top_k_t *const top_k = top_k_create(sizeof(performance_metrics_query_execution_t),
+                                        n,
+                                        __performance_metrics_query_execution_compare_func);
+    if (!top_k)
+        return 0;
+
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        GHashTableIter iter;
+        gpointer       key, value;
+        g_hash_table_iter_init(&iter, metrics->query_events[i]);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            const performance_metrics_query_execution_t execution = {
+                .query_type   = i + 1,
+                .line_in_file = GPOINTER_TO_UINT(key),
+                .time         = performance_event_get_elapsed_time(value)};
+            top_k_add(top_k, &execution);
+        }
+    }
+
+    GArray *const slowest = top_k_free_to_array(top_k);
+    const size_t  length  = slowest->len;
+    if (length) {
+        *out = malloc(length * sizeof(performance_metrics_query_execution_t));
+        if (!*out) {
+            g_array_unref(slowest);
+            return 0;
+        }
+        memcpy(*out, slowest->data, length * sizeof(performance_metrics_query_execution_t));
+    }
+
+    g_array_unref(slowest);
+    return length;
+}
+
 void performance_metrics_free(performance_metrics_t *metrics) {
     for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i)
         if (metrics->dataset_events[i])
@@ -341,5 +1087,7 @@ void performance_metrics_free(performance_metrics_t *metrics) {
         if (metrics->query_events[i]) /* If statement to ease cleanup after allocation failure */
             g_hash_table_unref(metrics->query_events[i]);
 
+    if (metrics->memory_report)
+        memory_report_free(metrics->memory_report);
     free(metrics);
 }
@@ -0,0 +1,715 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  performance_metrics_export.c
+ * @brief Implementation of methods in include/testing/performance_metrics_export.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref performance_metrics_export_example).
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "queries/query_type_list.h"
+#include "testing/performance_metrics_export.h"
+
+/** @cond FALSE */
+#define __PERFORMANCE_METRICS_EXPORT_STRINGIFY(x) #x
+#define __PERFORMANCE_METRICS_EXPORT_EXPAND(x)    __PERFORMANCE_METRICS_EXPORT_STRINGIFY(x)
+/** @endcond */
+
+#ifdef BUILD_TYPE
+    /** @brief Build type (`RELEASE`, `DEBUG` or `PROFILE`), defined by the Makefile. */
+    #define PERFORMANCE_METRICS_EXPORT_BUILD_TYPE __PERFORMANCE_METRICS_EXPORT_EXPAND(BUILD_TYPE)
+#else
+    /** @brief Build type (`RELEASE`, `DEBUG` or `PROFILE`), defined by the Makefile. */
+    #define PERFORMANCE_METRICS_EXPORT_BUILD_TYPE "UNKNOWN"
+#endif
+
+#ifdef GIT_REVISION
+    /** @brief Output of `git describe` when the program was built, defined by the Makefile. */
+    #define PERFORMANCE_METRICS_EXPORT_REVISION __PERFORMANCE_METRICS_EXPORT_EXPAND(GIT_REVISION)
+#else
+    /** @brief Output of `git describe` when the program was built, defined by the Makefile. */
+    #define PERFORMANCE_METRICS_EXPORT_REVISION "unknown"
+#endif
+
+/** @brief Names of the dataset loading steps, indexed by ::performance_metrics_dataset_step_t. */
+const char *const performance_metrics_export_dataset_step_names[] = {"users",
+                                                                     "flights",
+                                                                     "passengers",
+                                                                     "reservations"};
+
+/** @brief Names of the query measurement modes, indexed by ::performance_metrics_query_mode_t. */
+const char *const performance_metrics_export_query_mode_names[] = {"full", "light"};
+
+/** @brief Names of query execution strategies (see ::performance_metrics_query_strategy_t). */
+const char *const performance_metrics_export_query_strategy_names[] = {"none", "index", "scan"};
+
+/** @brief Names of the hardware counters, indexed by ::performance_event_counter_t. */
+const char *const performance_metrics_export_counter_names[PERFORMANCE_EVENT_COUNTER_COUNT] = {
+    "cycles",
+    "instructions",
+    "cache_misses",
+    "branch_misses",
+    "dtlb_misses"};
+
+const char *performance_metrics_export_get_build_type(void) {
+    return PERFORMANCE_METRICS_EXPORT_BUILD_TYPE;
+}
+
+const char *performance_metrics_export_get_revision(void) {
+    return PERFORMANCE_METRICS_EXPORT_REVISION;
+}
+
+/**
+ * @brief Outputs a string as a JSON string literal.
+ *
+ * @param output Stream where to output the string to.
+ * @param str    String to be output.
+ */
+void __performance_metrics_export_json_string(FILE *output, const char *str) {
+    fputc('"', output);
+    for (; *str; ++str) {
+        if (*str == '"' || *str == '\\')
+            fprintf(output, "\\%c", *str);
+        else if ((unsigned char) *str < 0x20)
+            fprintf(output, "\\u%04x", (unsigned char) *str);
+        else
+            fputc(*str, output);
+    }
+    fputc('"', output);
+}
+
+/**
+ * @brief   Outputs the keys of a JSON object containing the data in a ::performance_event_t.
+ * @details The opening and closing braces of the object aren't output, so that more keys can be
+ *          added to it.
+ *
+ * @param output Stream where to output the keys to.
+ * @param perf   Performance event to be exported.
+ */
+void __performance_metrics_export_json_event(FILE *output, const performance_event_t *perf) {
+    fprintf(output,
+            "\"time_us\": %" PRIu64 ", \"memory_kib\": %zu, \"counters\": {",
+            performance_event_get_elapsed_time(perf),
+            performance_event_get_used_memory(perf));
+
+    int first = 1;
+    for (size_t i = 0; i < PERFORMANCE_EVENT_COUNTER_COUNT; ++i) {
+        uint64_t value;
+        if (performance_event_get_counter(perf, i, &value))
+            continue;
+
+        fprintf(output,
+                "%s\"%s\": %" PRIu64,
+                first ? "" : ", ",
+                performance_metrics_export_counter_names[i],
+                value);
+        first = 0;
+    }
+    fputc('}', output);
+}
+
+/**
+ * @brief Outputs a list of file names as a JSON array.
+ *
+ * @param output Stream where to output the array to.
+ * @param n      Number of file names in @p files.
+ * @param files  File names to be exported.
+ */
+void __performance_metrics_export_json_files(FILE *output, size_t n, const char *const files[n]) {
+    fputc('[', output);
+    for (size_t i = 0; i < n; ++i) {
+        if (i)
+            fputs(", ", output);
+        __performance_metrics_export_json_string(output, files[i]);
+    }
+    fputc(']', output);
+}
+
+/**
+ * @brief Exports the differences between generated and expected output as a JSON object.
+ *
+ * @param output Stream where to output the object to.
+ * @param diff   Differences between generated and expected output.
+ */
+void __performance_metrics_export_json_test_diff(FILE *output, const test_diff_t *diff) {
+    size_t                   extra_count, missing_count;
+    const char *const *const extra   = test_diff_get_extra_files(diff, &extra_count);
+    const char *const *const missing = test_diff_get_missing_files(diff, &missing_count);
+
+    fputs("{\n    \"extra_files\": ", output);
+    __performance_metrics_export_json_files(output, extra_count, extra);
+    fputs(",\n    \"missing_files\": ", output);
+    __performance_metrics_export_json_files(output, missing_count, missing);
+
+    const char *const *common_files;
+    const ssize_t     *errors;
+    const size_t       common_count =
+        test_diff_get_common_file_errors(diff, &common_files, &errors);
+
+    /* Errors are exported as the first wrong line, -1 for IO errors, or 0 for correct files */
+    fputs(",\n    \"files\": [", output);
+    for (size_t i = 0; i < common_count; ++i) {
+        fputs(i ? ",\n        {\"name\": " : "\n        {\"name\": ", output);
+        __performance_metrics_export_json_string(output, common_files[i]);
+        fprintf(output, ", \"first_error_line\": %zd}", errors[i]);
+    }
+    fputs(common_count ? "\n    ]\n  }" : "]\n  }", output);
+}
+
+int performance_metrics_export_json(FILE                        *output,
+                                    const performance_metrics_t *metrics,
+                                    const test_diff_t           *diff) {
+    fprintf(output,
+            "{\n  \"schema_version\": %d,\n"
+            "  \"build\": {\"type\": \"%s\", \"revision\": \"%s\"},\n",
+            PERFORMANCE_METRICS_EXPORT_SCHEMA_VERSION,
+            PERFORMANCE_METRICS_EXPORT_BUILD_TYPE,
+            PERFORMANCE_METRICS_EXPORT_REVISION);
+
+    /* Dataset */
+    fputs("  \"dataset\": [", output);
+    int first = 1;
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i) {
+        const performance_event_t *const perf = performance_metrics_get_dataset_measurement(metrics,
+                                                                                           i);
+        if (!perf)
+            continue;
+
+        fprintf(output,
+                "%s\n    {\"step\": \"%s\", \"input_method\": \"%s\", \"lines\": %zu, "
+                "\"estimated_lines\": %zu, ",
+                first ? "" : ",",
+                performance_metrics_export_dataset_step_names[i],
+                performance_metrics_get_dataset_input_method(metrics, i) ==
+                        STREAM_TOKENIZE_METHOD_MMAP
+                    ? "mmap"
+                    : "read",
+                performance_metrics_get_dataset_lines(metrics, i),
+                performance_metrics_get_dataset_estimated_lines(metrics, i));
+        __performance_metrics_export_json_event(output, perf);
+        fputc('}', output);
+        first = 0;
+    }
+    fputs(first ? "],\n" : "\n  ],\n", output);
+
+    /* Query statistics */
+    fputs("  \"query_statistics\": [", output);
+    first = 1;
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        const performance_event_t *const perf =
+            performance_metrics_get_query_statistics_measurement(metrics, i + 1);
+        if (!perf)
+            continue;
+
+        const memory_usage_t *const usage =
+            performance_metrics_get_query_statistics_memory(metrics, i + 1);
+        fprintf(output,
+                "%s\n    {\"query_type\": %zu, \"arena_used_bytes\": %zu, "
+                "\"arena_reserved_bytes\": %zu, ",
+                first ? "" : ",",
+                i + 1,
+                usage ? usage->used_bytes : 0,
+                usage ? usage->reserved_bytes : 0);
+        __performance_metrics_export_json_event(output, perf);
+        fputc('}', output);
+        first = 0;
+    }
+    fputs(first ? "],\n" : "\n  ],\n", output);
+
+    /* Query executions */
+    fputs("  \"query_executions\": [", output);
+    first = 1;
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        size_t   *line_numbers;
+        uint64_t *times;
+        const size_t n = performance_metrics_get_query_execution_measurements(metrics,
+                                                                              i + 1,
+                                                                              &line_numbers,
+                                                                              &times);
+        free(times);
+
+        for (size_t j = 0; j < n; ++j) {
+            const performance_event_t *const perf =
+                performance_metrics_get_query_execution_measurement(metrics,
+                                                                    i + 1,
+                                                                    line_numbers[j]);
+
+            fprintf(output,
+                    "%s\n    {\"query_type\": %zu, \"line\": %zu, ",
+                    first ? "" : ",",
+                    i + 1,
+                    line_numbers[j]);
+            __performance_metrics_export_json_event(output, perf);
+            fputc('}', output);
+            first = 0;
+        }
+        free(line_numbers);
+    }
+    fputs(first ? "],\n" : "\n  ],\n", output);
+
+    /* Query strategies */
+    fputs("  \"query_strategies\": [", output);
+    first = 1;
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        uint64_t                                   index_cost, scan_cost;
+        const performance_metrics_query_strategy_t strategy =
+            performance_metrics_get_query_strategy(metrics, i + 1, &index_cost, &scan_cost);
+        if (strategy == PERFORMANCE_METRICS_QUERY_STRATEGY_NONE)
+            continue;
+
+        fprintf(output,
+                "%s\n    {\"query_type\": %zu, \"strategy\": \"%s\", "
+                "\"predicted_index_ns\": %" PRIu64 ", \"predicted_scan_ns\": %" PRIu64 "}",
+                first ? "" : ",",
+                i + 1,
+                performance_metrics_export_query_strategy_names[strategy],
+                index_cost,
+                scan_cost);
+        first = 0;
+    }
+    fputs(first ? "],\n" : "\n  ],\n", output);
+
+    /* Query instrumentation */
+    const performance_metrics_query_mode_t mode = performance_metrics_get_query_mode(metrics);
+    fprintf(output,
+            "  \"query_instrumentation\": {\"mode\": \"%s\", \"sampling_interval\": %zu, "
+            "\"overhead_ns\": {",
+            performance_metrics_export_query_mode_names[mode],
+            performance_metrics_get_query_sampling_interval(metrics));
+    for (size_t i = 0; i < PERFORMANCE_METRICS_QUERY_MODE_COUNT; ++i)
+        fprintf(output,
+                "%s\"%s\": %" PRIu64,
+                i ? ", " : "",
+                performance_metrics_export_query_mode_names[i],
+                performance_metrics_get_query_overhead(metrics, i));
+    fputs("}},\n", output);
+
+    /* Database memory */
+    const memory_report_t *const report = performance_metrics_get_memory_report(metrics);
+    if (report) {
+        fputs("  \"memory_report\": [", output);
+        const size_t n = memory_report_get_count(report);
+        for (size_t i = 0; i < n; ++i) {
+            const memory_usage_t *const usage = memory_report_get_usage(report, i);
+
+            fputs(i ? ",\n    {\"name\": " : "\n    {\"name\": ", output);
+            __performance_metrics_export_json_string(output, memory_report_get_name(report, i));
+            fprintf(output,
+                    ", \"blocks\": %zu, \"reserved_bytes\": %zu, \"used_bytes\": %zu, "
+                    "\"wasted_bytes\": %zu}",
+                    usage->blocks,
+                    usage->reserved_bytes,
+                    usage->used_bytes,
+                    usage->wasted_bytes);
+        }
+        fputs(n ? "\n  ],\n" : "],\n", output);
+    } else {
+        fputs("  \"memory_report\": null,\n", output);
+    }
+
+    /* Database memory before and after freezing */
+    memory_usage_t freeze_before, freeze_after;
+    if (!performance_metrics_get_freeze_memory(metrics, &freeze_before, &freeze_after)) {
+        fprintf(output,
+                "  \"database_freeze\": {\"reserved_bytes_before\": %zu, "
+                "\"wasted_bytes_before\": %zu, \"reserved_bytes_after\": %zu, "
+                "\"wasted_bytes_after\": %zu},\n",
+                freeze_before.reserved_bytes,
+                freeze_before.wasted_bytes,
+                freeze_after.reserved_bytes,
+                freeze_after.wasted_bytes);
+    } else {
+        fputs("  \"database_freeze\": null,\n", output);
+    }
+
+    /* Query output files */
+    const async_file_writer_statistics_t *const files =
+        performance_metrics_get_output_statistics(metrics);
+    if (files) {
+        fprintf(output,
+                "  \"output_files\": {\"method\": \"%s\", \"files\": %zu, \"failures\": %zu, "
+                "\"bytes\": %zu, \"syscalls\": %zu, \"blocked_ns\": %" PRIu64 "},\n",
+                files->method == ASYNC_FILE_WRITER_METHOD_IO_URING ? "io_uring" : "sync",
+                files->files,
+                files->failures,
+                files->bytes,
+                files->syscalls,
+                files->blocked_time);
+    } else {
+        fputs("  \"output_files\": null,\n", output);
+    }
+
+    /* Identifier filters */
+    const bloom_filter_statistics_t *const filters =
+        performance_metrics_get_id_filter_statistics(metrics);
+    if (filters) {
+        fprintf(output,
+                "  \"id_filters\": {\"rejected\": %zu, \"passed\": %zu, "
+                "\"false_positives\": %zu},\n",
+                filters->rejected,
+                filters->passed,
+                filters->false_positives);
+    } else {
+        fputs("  \"id_filters\": null,\n", output);
+    }
+
+    /* Dataset catalog */
+    const database_catalog_t *const catalog = performance_metrics_get_catalog(metrics);
+    if (catalog) {
+        fprintf(output,
+                "  \"catalog\": {\"users\": %" PRIu64 ", \"active_users\": %" PRIu64
+                ", \"flights\": %" PRIu64 ", \"passengers\": %" PRIu64
+                ", \"reservations\": %" PRIu64 ", \"airports\": %" PRIu64
+                ", \"hotels\": %" PRIu64 "},\n",
+                catalog->users,
+                catalog->active_users,
+                catalog->flights,
+                catalog->passengers,
+                catalog->reservations,
+                catalog->airports,
+                catalog->hotels);
+    } else {
+        fputs("  \"catalog\": null,\n", output);
+    }
+
+    /* Query result cache */
+    const query_result_cache_statistics_t *const cache =
+        performance_metrics_get_result_cache_statistics(metrics);
+    if (cache) {
+        fprintf(output,
+                "  \"result_cache\": {\"hits\": %zu, \"misses\": %zu, \"stores\": %zu, "
+                "\"evictions\": %zu},\n",
+                cache->hits,
+                cache->misses,
+                cache->stores,
+                cache->evictions);
+    } else {
+        fputs("  \"result_cache\": null,\n", output);
+    }
+
+    /* Whole program */
+    fprintf(output,
+            "  \"program\": {\"time_us\": %" PRIu64 ", \"peak_memory_kib\": %zu, "
+            "\"duplicate_queries\": %zu},\n",
+            performance_metrics_get_program_total_time(metrics),
+            performance_metrics_get_program_total_mem(metrics),
+            performance_metrics_get_duplicate_query_count(metrics));
+
+    fputs("  \"test_diff\": ", output);
+    if (diff)
+        __performance_metrics_export_json_test_diff(output, diff);
+    else
+        fputs("null", output);
+    fputs("\n}\n", output);
+
+    return ferror(output) ? 1 : 0;
+}
+
+/**
+ * @brief Outputs a string as a CSV cell, quoting it if needed.
+ *
+ * @param output Stream where to output the cell to.
+ * @param str    Contents of the cell.
+ */
+void __performance_metrics_export_csv_string(FILE *output, const char *str) {
+    if (!strpbrk(str, ",\"\n\r")) {
+        fputs(str, output);
+        return;
+    }
+
+    fputc('"', output);
+    for (; *str; ++str) {
+        if (*str == '"')
+            fputc('"', output); /* Escape quotes by doubling them */
+        fputc(*str, output);
+    }
+    fputc('"', output);
+}
+
+/**
+ * @brief Outputs a row of the exported CSV table.
+ *
+ * @param output     Stream where to output the row to.
+ * @param section    Value of the `section` column.
+ * @param name       Value of the `name` column. Can be `NULL`, for an empty cell.
+ * @param query_type Value of the `query_type` column. `0` for an empty cell.
+ * @param line       Value of the `line` column. `0` for an empty cell.
+ * @param lines      Value of the `lines` column. `0` for an empty cell.
+ * @param estimated  Value of the `estimated_lines` column. `0` for an empty cell.
+ * @param perf       Performance event, for the `time_us`, `memory_kib` and hardware counter
+ *                   columns. Can be `NULL`, for empty cells.
+ */
+void __performance_metrics_export_csv_row(FILE                      *output,
+                                          const char                *section,
+                                          const char                *name,
+                                          size_t                     query_type,
+                                          ssize_t                    line,
+                                          size_t                     lines,
+                                          size_t                     estimated,
+                                          const performance_event_t *perf) {
+    fprintf(output,
+            "%s,%s,%s,",
+            PERFORMANCE_METRICS_EXPORT_BUILD_TYPE,
+            PERFORMANCE_METRICS_EXPORT_REVISION,
+            section);
+    if (name)
+        __performance_metrics_export_csv_string(output, name);
+    fputc(',', output);
+
+    if (query_type)
+        fprintf(output, "%zu", query_type);
+    fputc(',', output);
+    if (line)
+        fprintf(output, "%zd", line);
+    fputc(',', output);
+    if (lines)
+        fprintf(output, "%zu", lines);
+    fputc(',', output);
+    if (estimated)
+        fprintf(output, "%zu", estimated);
+
+    if (perf) {
+        fprintf(output,
+                ",%" PRIu64 ",%zu",
+                performance_event_get_elapsed_time(perf),
+                performance_event_get_used_memory(perf));
+    } else {
+        fputs(",,", output);
+    }
+
+    for (size_t i = 0; i < PERFORMANCE_EVENT_COUNTER_COUNT; ++i) {
+        uint64_t value;
+        fputc(',', output);
+        if (perf && !performance_event_get_counter(perf, i, &value))
+            fprintf(output, "%" PRIu64, value);
+    }
+    fputc('\n', output);
+}
+
+int performance_metrics_export_csv(FILE                        *output,
+                                   const performance_metrics_t *metrics,
+                                   const test_diff_t           *diff) {
+    fputs("build_type,revision,section,name,query_type,line,lines,estimated_lines,time_us,"
+          "memory_kib",
+          output);
+    for (size_t i = 0; i < PERFORMANCE_EVENT_COUNTER_COUNT; ++i)
+        fprintf(output, ",%s", performance_metrics_export_counter_names[i]);
+    fputc('\n', output);
+
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i) {
+        const performance_event_t *const perf = performance_metrics_get_dataset_measurement(metrics,
+                                                                                           i);
+        if (perf)
+            __performance_metrics_export_csv_row(
+                output,
+                "dataset",
+                performance_metrics_export_dataset_step_names[i],
+                0,
+                0,
+                performance_metrics_get_dataset_lines(metrics, i),
+                performance_metrics_get_dataset_estimated_lines(metrics, i),
+                perf);
+    }
+
+    /* Query statistics: arena usage (bytes) in the lines and estimated_lines columns */
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        const performance_event_t *const perf =
+            performance_metrics_get_query_statistics_measurement(metrics, i + 1);
+        const memory_usage_t *const usage =
+            performance_metrics_get_query_statistics_memory(metrics, i + 1);
+        if (perf)
+            __performance_metrics_export_csv_row(output,
+                                                 "query_statistics",
+                                                 NULL,
+                                                 i + 1,
+                                                 0,
+                                                 usage ? usage->used_bytes : 0,
+                                                 usage ? usage->reserved_bytes : 0,
+                                                 perf);
+    }
+
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        size_t   *line_numbers;
+        uint64_t *times;
+        const size_t n = performance_metrics_get_query_execution_measurements(metrics,
+                                                                              i + 1,
+                                                                              &line_numbers,
+                                                                              &times);
+        free(times);
+
+        for (size_t j = 0; j < n; ++j)
+            __performance_metrics_export_csv_row(
+                output,
+                "query_execution",
+                NULL,
+                i + 1,
+                line_numbers[j],
+                0,
+                0,
+                performance_metrics_get_query_execution_measurement(metrics,
+                                                                    i + 1,
+                                                                    line_numbers[j]));
+        free(line_numbers);
+    }
+
+    /* Query strategies: predicted costs (ns) in the lines and estimated_lines columns */
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        uint64_t                                   index_cost, scan_cost;
+        const performance_metrics_query_strategy_t strategy =
+            performance_metrics_get_query_strategy(metrics, i + 1, &index_cost, &scan_cost);
+        if (strategy != PERFORMANCE_METRICS_QUERY_STRATEGY_NONE)
+            __performance_metrics_export_csv_row(
+                output,
+                "query_strategy",
+                performance_metrics_export_query_strategy_names[strategy],
+                i + 1,
+                0,
+                index_cost,
+                scan_cost,
+                NULL);
+    }
+
+    /* Whole program: total time and peak memory, and duplicate queries in the lines column */
+    fprintf(output,
+            "%s,%s,program,total,,,,,%" PRIu64 ",%zu",
+            PERFORMANCE_METRICS_EXPORT_BUILD_TYPE,
+            PERFORMANCE_METRICS_EXPORT_REVISION,
+            performance_metrics_get_program_total_time(metrics),
+            performance_metrics_get_program_total_mem(metrics));
+    for (size_t i = 0; i < PERFORMANCE_EVENT_COUNTER_COUNT; ++i)
+        fputc(',', output);
+    fputc('\n', output);
+
+    const size_t duplicates = performance_metrics_get_duplicate_query_count(metrics);
+    if (duplicates)
+        __performance_metrics_export_csv_row(output,
+                                             "program",
+                                             "duplicate_queries",
+                                             0,
+                                             0,
+                                             duplicates,
+                                             0,
+                                             NULL);
+
+    /* Identifier filters: how lookups were answered, in the lines column */
+    const bloom_filter_statistics_t *const filters =
+        performance_metrics_get_id_filter_statistics(metrics);
+    if (filters) {
+        const char *const names[3]  = {"rejected", "passed", "false_positives"};
+        const size_t      values[3] = {filters->rejected,
+                                       filters->passed,
+                                       filters->false_positives};
+        for (size_t i = 0; i < 3; ++i)
+            __performance_metrics_export_csv_row(output,
+                                                 "id_filters",
+                                                 names[i],
+                                                 0,
+                                                 0,
+                                                 values[i],
+                                                 0,
+                                                 NULL);
+    }
+
+    /* Query result cache: how lookups were answered, in the lines column */
+    const query_result_cache_statistics_t *const cache =
+        performance_metrics_get_result_cache_statistics(metrics);
+    if (cache) {
+        const char *const names[4]  = {"hits", "misses", "stores", "evictions"};
+        const size_t      values[4] = {cache->hits, cache->misses, cache->stores, cache->evictions};
+        for (size_t i = 0; i < 4; ++i)
+            __performance_metrics_export_csv_row(output,
+                                                 "result_cache",
+                                                 names[i],
+                                                 0,
+                                                 0,
+                                                 values[i],
+                                                 0,
+                                                 NULL);
+    }
+
+    /* Query instrumentation: sampling interval and overheads (ns) in the lines column */
+    const performance_metrics_query_mode_t mode = performance_metrics_get_query_mode(metrics);
+    __performance_metrics_export_csv_row(output,
+                                         "query_instrumentation",
+                                         performance_metrics_export_query_mode_names[mode],
+                                         0,
+                                         0,
+                                         performance_metrics_get_query_sampling_interval(metrics),
+                                         0,
+                                         NULL);
+    for (size_t i = 0; i < PERFORMANCE_METRICS_QUERY_MODE_COUNT; ++i) {
+        char name[32];
+        snprintf(name, 32, "%s_overhead_ns", performance_metrics_export_query_mode_names[i]);
+        __performance_metrics_export_csv_row(output,
+                                             "query_instrumentation",
+                                             name,
+                                             0,
+                                             0,
+                                             performance_metrics_get_query_overhead(metrics, i),
+                                             0,
+                                             NULL);
+    }
+
+    if (diff) {
+        size_t                   n;
+        const char *const *const extra = test_diff_get_extra_files(diff, &n);
+        for (size_t i = 0; i < n; ++i)
+            __performance_metrics_export_csv_row(output,
+                                                 "test_diff_extra",
+                                                 extra[i],
+                                                 0,
+                                                 0,
+                                                 0,
+                                                 0,
+                                                 NULL);
+
+        const char *const *const missing = test_diff_get_missing_files(diff, &n);
+        for (size_t i = 0; i < n; ++i)
+            __performance_metrics_export_csv_row(output,
+                                                 "test_diff_missing",
+                                                 missing[i],
+                                                 0,
+                                                 0,
+                                                 0,
+                                                 0,
+                                                 NULL);
+
+        /* Only files with errors: line is the first wrong line, or -1 for IO errors */
+        const char *const *common_files;
+        const ssize_t     *errors;
+        n = test_diff_get_common_file_errors(diff, &common_files, &errors);
+        for (size_t i = 0; i < n; ++i)
+            if (errors[i])
+                __performance_metrics_export_csv_row(output,
+                                                     "test_diff_error",
+                                                     common_files[i],
+                                                     0,
+                                                     errors[i],
+                                                     0,
+                                                     0,
+                                                     NULL);
+    }
+
+    return ferror(output) ? 1 : 0;
+}
@@ -28,7 +28,19 @@
 
 #include "queries/query_type_list.h"
 #include "testing/performance_metrics_output.h"
+#include "utils/numa_topology.h"
 #include "utils/table.h"
+#include "utils/thread_pool.h"
+
+/** @brief Number of slowest query executions listed in the performance report. */
+#define PERFORMANCE_METRICS_OUTPUT_SLOWEST_QUERIES 10
+
+/**
+ * @brief Number of phases whose allocations are listed in the performance report: each step of
+ *        loading the dataset, and the statistics and executions of each query type.
+ */
+#define PERFORMANCE_METRICS_OUTPUT_ALLOCATION_PHASES \
+    (PERFORMANCE_METRICS_DATASET_STEP_DONE + 2 * QUERY_TYPE_LIST_COUNT)
 
 /**
  * @brief Calulates which unit should be used to display a set of data points.
@@ -118,7 +130,33 @@ void __performance_metrics_output_choose_units_from_performance_events(
 }
 
 /**
- * @brief Prints a table with performance events.
+ * @brief   Calculates how many times a hardware counter was incremented per 1000 instructions.
+ * @details Auxiliary method for ::__performance_metrics_output_print_table.
+ *
+ * @param perf    Performance event to get counters from.
+ * @param counter Counter to be compared to the number of instructions.
+ * @param output  Where to write the number of events per 1000 instructions to, only on success.
+ *
+ * @retval 0 Success.
+ * @retval 1 Counters not available, or no instructions executed.
+ */
+int __performance_metrics_output_per_kilo_instruction(const performance_event_t  *perf,
+                                                      performance_event_counter_t counter,
+                                                      double                     *output) {
+    uint64_t instructions, count;
+    if (performance_event_get_counter(perf, PERFORMANCE_EVENT_COUNTER_INSTRUCTIONS, &instructions))
+        return 1;
+    if (performance_event_get_counter(perf, counter, &count) || instructions == 0)
+        return 1;
+
+    *output = count * 1000.0 / instructions;
+    return 0;
+}
+
+/**
+ * @brief   Prints a table with performance events.
+ * @details Hardware counter columns (instructions per cycle, and misses per 1000 instructions) are
+ *          only added if at least one of the events has hardware counters.
  *
  * @param output      Where to print the table to.
  * @param n           Number of @p events and @p event_names.
@@ -138,11 +176,27 @@ void __performance_metrics_output_print_table(FILE                            *o
                                                                       &mem_unit_multiplier,
                                                                       &time_unit_name,
                                                                       &mem_unit_name);
-    table_t *const table = table_create(3, n + 1);
+    int has_counters = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t instructions;
+        if (events[i] &&
+            !performance_event_get_counter(events[i],
+                                           PERFORMANCE_EVENT_COUNTER_INSTRUCTIONS,
+                                           &instructions))
+            has_counters = 1;
+    }
+
+    table_t *const table = table_create(has_counters ? 7 : 3, n + 1);
     if (!table)
         return;
     table_insert_format(table, 1, 0, "Time (%s)", time_unit_name);
     table_insert_format(table, 2, 0, "Memory (%s)", mem_unit_name);
+    if (has_counters) {
+        table_insert_format(table, 3, 0, "IPC");
+        table_insert_format(table, 4, 0, "LLC MPKI");
+        table_insert_format(table, 5, 0, "Branch MPKI");
+        table_insert_format(table, 6, 0, "dTLB MPKI");
+    }
 
     for (size_t i = 0; i < n; i++) {
         table_insert_format(table, 0, i + 1, "%s", event_names[i]);
@@ -151,6 +205,25 @@ void __performance_metrics_output_print_table(FILE                            *o
         if (!perf)
             continue;
 
+        if (has_counters) {
+            uint64_t cycles, instructions;
+            if (!performance_event_get_counter(perf, PERFORMANCE_EVENT_COUNTER_CYCLES, &cycles) &&
+                !performance_event_get_counter(perf,
+                                               PERFORMANCE_EVENT_COUNTER_INSTRUCTIONS,
+                                               &instructions) &&
+                cycles != 0)
+                table_insert_format(table, 3, i + 1, "%.2lf", (double) instructions / cycles);
+
+            const performance_event_counter_t misses[3] = {PERFORMANCE_EVENT_COUNTER_CACHE_MISSES,
+                                                           PERFORMANCE_EVENT_COUNTER_BRANCH_MISSES,
+                                                           PERFORMANCE_EVENT_COUNTER_DTLB_MISSES};
+            for (size_t j = 0; j < 3; ++j) {
+                double mpki;
+                if (!__performance_metrics_output_per_kilo_instruction(perf, misses[j], &mpki))
+                    table_insert_format(table, 4 + j, i + 1, "%.2lf", mpki);
+            }
+        }
+
         table_insert_format(table,
                             1,
                             i + 1,
@@ -169,6 +242,53 @@ void __performance_metrics_output_print_table(FILE                            *o
     table_free(table);
 }
 
+/**
+ * @brief   Prints how the time loading each dataset file was spent, in @p metrics.
+ * @details Auxiliary method for ::__performance_metrics_output_print_dataset. Sub-phases are
+ *          measured from inside the parsing threads, so they add up to the time spent parsing, and
+ *          not to wall time.
+ *
+ * @param output     Stream where to output formatted performance data to.
+ * @param metrics    Performance metrics to extract dataset loading information from.
+ * @param events     Measurements of loading each file. Elements can be `NULL`.
+ * @param file_names Names of the dataset files.
+ */
+void __performance_metrics_output_print_dataset_breakdown(FILE                        *output,
+                                                          const performance_metrics_t *metrics,
+                                                          const performance_event_t *const *events,
+                                                          const char *const *file_names) {
+    const char *const phase_names[PERFORMANCE_METRICS_DATASET_PHASE_COUNT] = {
+        "Reading and splitting lines",
+        "Parsing and validating fields",
+        "Adding to the database",
+        "Reporting invalid lines"};
+
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i) {
+        performance_metrics_dataset_breakdown_t breakdown;
+        if (performance_metrics_get_dataset_breakdown(metrics, i, &breakdown) || !breakdown.lines)
+            continue;
+
+        const uint64_t elapsed = events[i] ? performance_event_get_elapsed_time(events[i]) : 0;
+        fprintf(output,
+                "\n%s: %.2f MiB, %zu lines (%.0f lines/s), %zu invalid\n",
+                file_names[i],
+                breakdown.bytes / (1024.0 * 1024.0),
+                breakdown.lines,
+                elapsed ? breakdown.lines * 1000000.0 / elapsed : 0.0,
+                breakdown.invalid_lines);
+
+        uint64_t total = 0;
+        for (size_t j = 0; j < PERFORMANCE_METRICS_DATASET_PHASE_COUNT; ++j)
+            total += breakdown.phase_times[j];
+        for (size_t j = 0; j < PERFORMANCE_METRICS_DATASET_PHASE_COUNT && total; ++j)
+            fprintf(output,
+                    "    %-30s %10.3f ms (%5.1f %%)\n",
+                    phase_names[j],
+                    breakdown.phase_times[j] / 1000000.0,
+                    breakdown.phase_times[j] * 100.0 / total);
+    }
+}
+
 /**
  * @brief Prints the performance information about dataset loading in @p metrics.
  *
@@ -188,8 +308,62 @@ uint64_t __performance_metrics_output_print_dataset(FILE
             ret += performance_event_get_elapsed_time(dataset_events[i]);
     }
 
-    const char *const event_names[] = {"Users", "Flights", "Passengers", "Reservations"};
-    __performance_metrics_output_print_table(output, 4, dataset_events, event_names);
+    /* Show the input method of each file, so that different methods can be compared */
+    const char *const file_names[] = {"Users", "Flights", "Passengers", "Reservations"};
+    char              event_names_buffers[PERFORMANCE_METRICS_DATASET_STEP_DONE][32];
+    const char       *event_names[PERFORMANCE_METRICS_DATASET_STEP_DONE];
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i) {
+        const char *const method =
+            performance_metrics_get_dataset_input_method(metrics, i) == STREAM_TOKENIZE_METHOD_MMAP
+                ? "mmap"
+                : "read";
+
+        snprintf(event_names_buffers[i], 32, "%s (%s)", file_names[i], method);
+        event_names[i] = event_names_buffers[i];
+    }
+
+    __performance_metrics_output_print_table(output,
+                                             PERFORMANCE_METRICS_DATASET_STEP_DONE,
+                                             dataset_events,
+                                             event_names);
+
+    /* Show how good the estimates used to size the database were */
+    int printed_line_counts = 0;
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i) {
+        const size_t estimated = performance_metrics_get_dataset_estimated_lines(metrics, i);
+        const size_t actual    = performance_metrics_get_dataset_lines(metrics, i);
+        if (!actual)
+            continue; /* Not loaded (e.g.: restored from a snapshot) */
+
+        if (!printed_line_counts++)
+            fputc('\n', output);
+        fprintf(output,
+                "%-13s %9zu lines, %9zu estimated (%+5.1f %%)\n",
+                file_names[i],
+                actual,
+                estimated,
+                ((double) estimated - actual) * 100.0 / actual);
+    }
+
+    /* Peaks are cumulative: a step raised the peak if it grew when that step was done */
+    int printed_peaks = 0;
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i) {
+        const size_t peak = performance_metrics_get_dataset_peak_rss(metrics, i);
+        if (!peak)
+            continue;
+
+        if (!printed_peaks++)
+            fputc('\n', output);
+        fprintf(output,
+                "%-13s %9.2lf MiB peak resident memory, when done\n",
+                file_names[i],
+                peak / 1024.0);
+    }
+
+    __performance_metrics_output_print_dataset_breakdown(output,
+                                                         metrics,
+                                                         dataset_events,
+                                                         file_names);
     return ret;
 }
 
@@ -228,6 +402,20 @@ uint64_t __performance_metrics_output_print_query_statistics(FILE
     for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i)
         free(event_names[i]);
 
+    const size_t peak = performance_metrics_get_query_statistics_peak_rss(metrics);
+    if (peak)
+        fprintf(output, "\n%.2lf MiB peak resident memory, when done\n", peak / 1024.0);
+
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        const memory_usage_t *const usage =
+            performance_metrics_get_query_statistics_memory(metrics, i + 1);
+        if (usage)
+            fprintf(output,
+                    "Query %zu statistics arena: %.2lf KiB used, %.2lf KiB reserved\n",
+                    i + 1,
+                    usage->used_bytes / 1024.0,
+                    usage->reserved_bytes / 1024.0);
+    }
     return ret;
 }
 
@@ -336,9 +524,227 @@ uint64_t __performance_metrics_output_print_all_queries(FILE
         free(line_numbers);
         free(times);
     }
+
+    /* Sum of all executions of each query type, mainly to show hardware counters */
+    performance_event_t *totals[QUERY_TYPE_LIST_COUNT];
+    char                 event_names_buffers[QUERY_TYPE_LIST_COUNT][32];
+    const char          *event_names[QUERY_TYPE_LIST_COUNT];
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        totals[i] = performance_metrics_get_query_execution_total(metrics, i + 1);
+        snprintf(event_names_buffers[i], 32, "Query %zu", i + 1);
+        event_names[i] = event_names_buffers[i];
+    }
+
+    fprintf(output, "\nAll executions\n\n");
+    __performance_metrics_output_print_table(output,
+                                             QUERY_TYPE_LIST_COUNT,
+                                             (const performance_event_t *const *) totals,
+                                             event_names);
+
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i)
+        if (totals[i])
+            performance_event_free(totals[i]);
     return ret;
 }
 
+/**
+ * @brief Prints a table with latency and memory percentiles for each query type.
+ *
+ * @param output  Stream where to output formatted performance data to.
+ * @param metrics Performance metrics to extract query execution information from.
+ */
+void __performance_metrics_output_print_percentiles(FILE                        *output,
+                                                    const performance_metrics_t *metrics) {
+    performance_histogram_t *times[QUERY_TYPE_LIST_COUNT]  = {0};
+    performance_histogram_t *memory[QUERY_TYPE_LIST_COUNT] = {0};
+    uint64_t                 medians_time[QUERY_TYPE_LIST_COUNT];
+    uint64_t                 medians_memory[QUERY_TYPE_LIST_COUNT];
+
+    size_t rows = 0;
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        if (performance_metrics_get_query_execution_histograms(metrics,
+                                                                i + 1,
+                                                                &times[i],
+                                                                &memory[i]))
+            goto DEFER_1;
+
+        if (performance_histogram_get_count(times[i])) {
+            medians_time[rows]   = performance_histogram_get_percentile(times[i], 50);
+            medians_memory[rows] = performance_histogram_get_percentile(memory[i], 50);
+            ++rows;
+        }
+    }
+
+    /* Choose a single unit per column group, so that query types can be compared */
+    const char *const time_unit_names[3] = {"us", "ms", "s"};
+    const char *const mem_unit_names[3]  = {"KiB", "MiB", "GiB"};
+    const char       *time_unit_name, *mem_unit_name;
+    const int         time_multiplier =
+        __performance_metrics_choose_unit(rows, medians_time, time_unit_names, &time_unit_name);
+    const int mem_multiplier =
+        __performance_metrics_choose_unit(rows, medians_memory, mem_unit_names, &mem_unit_name);
+
+    table_t *const table = table_create(9, rows + 1);
+    if (!table)
+        goto DEFER_1;
+
+    table_insert_format(table, 1, 0, "Count");
+    table_insert_format(table, 2, 0, "p50 (%s)", time_unit_name);
+    table_insert_format(table, 3, 0, "p90 (%s)", time_unit_name);
+    table_insert_format(table, 4, 0, "p99 (%s)", time_unit_name);
+    table_insert_format(table, 5, 0, "Max (%s)", time_unit_name);
+    table_insert_format(table, 6, 0, "Mem. p50 (%s)", mem_unit_name);
+    table_insert_format(table, 7, 0, "Mem. p99 (%s)", mem_unit_name);
+    table_insert_format(table, 8, 0, "Mem. max (%s)", mem_unit_name);
+
+    size_t row = 1;
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        if (!performance_histogram_get_count(times[i]))
+            continue;
+
+        const double t = time_multiplier, m = mem_multiplier;
+        table_insert_format(table, 0, row, "Query %zu", i + 1);
+        table_insert_format(table, 1, row, "%zu", performance_histogram_get_count(times[i]));
+        table_insert_format(table,
+                            2,
+                            row,
+                            "%.2lf",
+                            performance_histogram_get_percentile(times[i], 50) / t);
+        table_insert_format(table,
+                            3,
+                            row,
+                            "%.2lf",
+                            performance_histogram_get_percentile(times[i], 90) / t);
+        table_insert_format(table,
+                            4,
+                            row,
+                            "%.2lf",
+                            performance_histogram_get_percentile(times[i], 99) / t);
+        table_insert_format(table, 5, row, "%.2lf", performance_histogram_get_max(times[i]) / t);
+        table_insert_format(table,
+                            6,
+                            row,
+                            "%.2lf",
+                            performance_histogram_get_percentile(memory[i], 50) / m);
+        table_insert_format(table,
+                            7,
+                            row,
+                            "%.2lf",
+                            performance_histogram_get_percentile(memory[i], 99) / m);
+        table_insert_format(table, 8, row, "%.2lf", performance_histogram_get_max(memory[i]) / m);
+        ++row;
+    }
+
+    table_draw(output, table);
+    table_free(table);
+
+DEFER_1:
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        if (times[i])
+            performance_histogram_free(times[i]);
+        if (memory[i])
+            performance_histogram_free(memory[i]);
+    }
+}
+
+/**
+ * @brief Prints a table with the slowest query executions, identified by their line in the input.
+ *
+ * @param output  Stream where to output formatted performance data to.
+ * @param metrics Performance metrics to extract query execution information from.
+ */
+void __performance_metrics_output_print_slowest_queries(FILE                        *output,
+                                                        const performance_metrics_t *metrics) {
+    performance_metrics_query_execution_t *slowest;
+    const size_t                           n =
+        performance_metrics_get_slowest_query_executions(metrics,
+                                                         PERFORMANCE_METRICS_OUTPUT_SLOWEST_QUERIES,
+                                                         &slowest);
+    if (!n)
+        return;
+
+    uint64_t *const times = malloc(n * sizeof(uint64_t));
+    if (!times) {
+        free(slowest);
+        return;
+    }
+    for (size_t i = 0; i < n; ++i)
+        times[i] = slowest[i].time;
+
+    const char *const time_unit_names[3] = {"us", "ms", "s"};
+    const char       *unit_name;
+    const int multiplier = __performance_metrics_choose_unit(n, times, time_unit_names, &unit_name);
+    free(times);
+
+    table_t *const table = table_create(3, n + 1);
+    if (!table) {
+        free(slowest);
+        return;
+    }
+
+    table_insert_format(table, 1, 0, "Line");
+    table_insert_format(table, 2, 0, "Time (%s)", unit_name);
+    for (size_t i = 0; i < n; ++i) {
+        table_insert_format(table, 0, i + 1, "Query %zu", slowest[i].query_type);
+        table_insert_format(table, 1, i + 1, "%zu", slowest[i].line_in_file);
+        table_insert_format(table, 2, i + 1, "%.2lf", (double) slowest[i].time / multiplier);
+    }
+
+    table_draw(output, table);
+    table_free(table);
+    free(slowest);
+}
+
+/**
+ * @brief Prints a table with how much memory each data structure in the database was using.
+ *
+ * @param output Stream where to output formatted memory data to.
+ * @param report Memory usage of each data structure in the database.
+ */
+void __performance_metrics_output_print_memory_report(FILE                  *output,
+                                                      const memory_report_t *report) {
+    const size_t n = memory_report_get_count(report);
+
+    memory_usage_t total;
+    memory_report_get_total(report, &total);
+
+    /* Choose a single unit for all columns, so that they can be compared */
+    uint64_t *const reserved = malloc((n + 1) * sizeof(uint64_t));
+    if (!reserved)
+        return;
+    for (size_t i = 0; i < n; ++i)
+        reserved[i] = memory_report_get_usage(report, i)->reserved_bytes / 1024;
+    reserved[n] = total.reserved_bytes / 1024;
+
+    const char *const mem_unit_names[3] = {"KiB", "MiB", "GiB"};
+    const char       *unit_name;
+    const int         multiplier =
+        __performance_metrics_choose_unit(n + 1, reserved, mem_unit_names, &unit_name) * 1024;
+    free(reserved);
+
+    table_t *const table = table_create(5, n + 2);
+    if (!table)
+        return;
+    table_insert_format(table, 1, 0, "Blocks");
+    table_insert_format(table, 2, 0, "Reserved (%s)", unit_name);
+    table_insert_format(table, 3, 0, "Used (%s)", unit_name);
+    table_insert_format(table, 4, 0, "Wasted (%s)", unit_name);
+
+    for (size_t i = 0; i <= n; i++) {
+        const memory_usage_t *const usage = i == n ? &total : memory_report_get_usage(report, i);
+        const char *const           name  = i == n ? "Total" : memory_report_get_name(report, i);
+
+        table_insert_format(table, 0, i + 1, "%s", name);
+        table_insert_format(table, 1, i + 1, "%zu", usage->blocks);
+        table_insert_format(table, 2, i + 1, "%.2lf", (double) usage->reserved_bytes / multiplier);
+        table_insert_format(table, 3, i + 1, "%.2lf", (double) usage->used_bytes / multiplier);
+        table_insert_format(table, 4, i + 1, "%.2lf", (double) usage->wasted_bytes / multiplier);
+    }
+
+    table_draw(output, table);
+    table_free(table);
+}
+
 /**
  * @brief Prints a summary of the performance data collected.
  *
@@ -381,15 +787,299 @@ void __performance_metrics_output_summary(FILE                        *output,
     fprintf(output, "\nPeak memory: %.2lf %s\n", (double) total_mem / multiplier, unit_name);
 }
 
+/**
+ * @brief Prints how query executions were measured, and how much measuring each one costs.
+ *
+ * @param output  Stream where to output formatted performance data to.
+ * @param metrics Performance metrics to extract query instrumentation information from.
+ */
+void __performance_metrics_output_print_instrumentation(FILE                        *output,
+                                                        const performance_metrics_t *metrics) {
+    const char *const mode_names[PERFORMANCE_METRICS_QUERY_MODE_COUNT] = {"full", "light"};
+
+    const size_t interval = performance_metrics_get_query_sampling_interval(metrics);
+    fprintf(output,
+            "\nQuery instrumentation: %s",
+            mode_names[performance_metrics_get_query_mode(metrics)]);
+    if (interval > 1)
+        fprintf(output, ", 1 in every %zu executions sampled (underestimated totals)", interval);
+    fputc('\n', output);
+
+    for (size_t i = 0; i < PERFORMANCE_METRICS_QUERY_MODE_COUNT; ++i) {
+        const uint64_t overhead = performance_metrics_get_query_overhead(metrics, i);
+        if (overhead)
+            fprintf(output,
+                    "Overhead per measurement (%s): %.2lf us\n",
+                    mode_names[i],
+                    (double) overhead / 1000);
+    }
+}
+
+/**
+ * @brief   Prints how each query type with a cost model was executed.
+ * @details The predicted cost of each strategy is compared to the actual cost of the chosen one:
+ *          the time of generating statistical data plus the time of executing every query (scaled
+ *          by the sampling interval, when not every execution was measured).
+ *
+ * @param output  Stream where to output formatted performance data to.
+ * @param metrics Performance metrics to extract query strategy information from.
+ */
+void __performance_metrics_output_print_strategies(FILE                        *output,
+                                                   const performance_metrics_t *metrics) {
+    const size_t interval = performance_metrics_get_query_sampling_interval(metrics);
+
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        uint64_t                                   index_cost, scan_cost;
+        const performance_metrics_query_strategy_t strategy =
+            performance_metrics_get_query_strategy(metrics, i + 1, &index_cost, &scan_cost);
+        if (strategy == PERFORMANCE_METRICS_QUERY_STRATEGY_NONE)
+            continue;
+
+        size_t   *line_numbers;
+        uint64_t *times;
+        const size_t n = performance_metrics_get_query_execution_measurements(metrics,
+                                                                              i + 1,
+                                                                              &line_numbers,
+                                                                              &times);
+        uint64_t actual = 0;
+        for (size_t j = 0; j < n; ++j)
+            actual += times[j];
+        actual *= interval;
+        free(line_numbers);
+        free(times);
+
+        const performance_event_t *const statistics_event =
+            performance_metrics_get_query_statistics_measurement(metrics, i + 1);
+        if (statistics_event)
+            actual += performance_event_get_elapsed_time(statistics_event);
+
+        fprintf(output,
+                "Query %zu strategy: %s (predicted: index %.2lf ms, scan %.2lf ms; actual: "
+                "%.2lf ms)\n",
+                i + 1,
+                strategy == PERFORMANCE_METRICS_QUERY_STRATEGY_SCAN ? "scan" : "index",
+                (double) index_cost / 1000000,
+                (double) scan_cost / 1000000,
+                (double) actual / 1000);
+    }
+}
+
+/**
+ * @brief   Prints how query output files were written.
+ * @details Nothing is printed if outputs weren't written to their own files (e.g.: to a pack).
+ *          Throughput only accounts for the time the program spent waiting for files to be written.
+ *
+ * @param output  Stream where to output formatted performance data to.
+ * @param metrics Performance metrics to extract output information from.
+ */
+void __performance_metrics_output_print_output_files(FILE                        *output,
+                                                     const performance_metrics_t *metrics) {
+    const async_file_writer_statistics_t *const statistics =
+        performance_metrics_get_output_statistics(metrics);
+    if (!statistics)
+        return;
+
+    const double mib = (double) statistics->bytes / (1024 * 1024);
+    const double ms  = (double) statistics->blocked_time / 1000000;
+    fprintf(output,
+            "\nOutput files (%s): %zu files (%zu failed), %.2lf MiB, %zu system calls, %.2lf ms "
+            "blocked",
+            statistics->method == ASYNC_FILE_WRITER_METHOD_IO_URING ? "io_uring" : "sync",
+            statistics->files,
+            statistics->failures,
+            mib,
+            statistics->syscalls,
+            ms);
+    if (statistics->blocked_time)
+        fprintf(output, " (%.2lf MiB/s)", mib / (ms / 1000));
+    fputc('\n', output);
+}
+
+/**
+ * @brief   Prints statistics about the data in the database.
+ * @details Nothing is printed if no catalog was registered.
+ *
+ * @param output  Stream where to output formatted performance data to.
+ * @param metrics Performance metrics to extract the catalog from.
+ */
+void __performance_metrics_output_print_catalog(FILE                        *output,
+                                                const performance_metrics_t *metrics) {
+    const database_catalog_t *const catalog = performance_metrics_get_catalog(metrics);
+    if (!catalog)
+        return;
+
+    fputs("\nDataset catalog:\n", output);
+    database_catalog_print(output, catalog);
+}
+
+/**
+ * @brief   Prints how lookups in the identifier filters of the database were answered.
+ * @details Nothing is printed if no filter was built or looked up.
+ *
+ * @param output  Stream where to output formatted performance data to.
+ * @param metrics Performance metrics to extract filter information from.
+ */
+void __performance_metrics_output_print_id_filters(FILE                        *output,
+                                                   const performance_metrics_t *metrics) {
+    const bloom_filter_statistics_t *const statistics =
+        performance_metrics_get_id_filter_statistics(metrics);
+    if (!statistics || !(statistics->rejected + statistics->passed))
+        return;
+
+    const size_t lookups = statistics->rejected + statistics->passed;
+    fprintf(output,
+            "\nIdentifier filters: %zu lookups, %zu rejected (%.2lf %%), %zu passed, "
+            "%zu false positives\n",
+            lookups,
+            statistics->rejected,
+            100.0 * (double) statistics->rejected / (double) lookups,
+            statistics->passed,
+            statistics->false_positives);
+}
+
+/**
+ * @brief   Prints how lookups in the query result cache were answered.
+ * @details Nothing is printed if the cache was disabled.
+ *
+ * @param output  Stream where to output formatted performance data to.
+ * @param metrics Performance metrics to extract cache information from.
+ */
+void __performance_metrics_output_print_result_cache(FILE                        *output,
+                                                     const performance_metrics_t *metrics) {
+    const query_result_cache_statistics_t *const statistics =
+        performance_metrics_get_result_cache_statistics(metrics);
+    if (!statistics)
+        return;
+
+    const size_t lookups = statistics->hits + statistics->misses;
+    fprintf(output,
+            "\nQuery result cache: %zu lookups, %zu hits (%.2lf %%), %zu misses, %zu stored, "
+            "%zu evicted\n",
+            lookups,
+            statistics->hits,
+            lookups ? 100.0 * (double) statistics->hits / (double) lookups : 0.0,
+            statistics->misses,
+            statistics->stores,
+            statistics->evictions);
+}
+
+/**
+ * @brief   Prints the memory allocated by each phase, when `malloc` is tracked.
+ * @details See [performance_allocations](@ref performance_allocations.h). Nothing is printed if no
+ *          allocations were measured. Query executions are summed for each query type, and their
+ *          peak is the largest peak of a single execution.
+ *
+ * @param output  Stream where to output formatted performance data to.
+ * @param metrics Performance metrics to extract allocations from.
+ * @param tty     Whether @p output is a terminal, for the section's heading to be formatted.
+ */
+void __performance_metrics_output_print_allocations(FILE                        *output,
+                                                    const performance_metrics_t *metrics,
+                                                    int                          tty) {
+    const char *const file_names[] = {"Users", "Flights", "Passengers", "Reservations"};
+
+    performance_event_t       *totals[QUERY_TYPE_LIST_COUNT];
+    const performance_event_t *events[PERFORMANCE_METRICS_OUTPUT_ALLOCATION_PHASES];
+    char                       names[PERFORMANCE_METRICS_OUTPUT_ALLOCATION_PHASES][32];
+
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i) {
+        events[i] = performance_metrics_get_dataset_measurement(metrics, i);
+        snprintf(names[i], 32, "%s", file_names[i]);
+    }
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        const size_t statistics = PERFORMANCE_METRICS_DATASET_STEP_DONE + i;
+        events[statistics] = performance_metrics_get_query_statistics_measurement(metrics, i + 1);
+        snprintf(names[statistics], 32, "Query %zu statistics", i + 1);
+
+        const size_t execution = PERFORMANCE_METRICS_DATASET_STEP_DONE + QUERY_TYPE_LIST_COUNT + i;
+        totals[i]         = performance_metrics_get_query_execution_total(metrics, i + 1);
+        events[execution] = totals[i];
+        snprintf(names[execution], 32, "Query %zu executions", i + 1);
+    }
+
+    int printed_heading = 0;
+    for (size_t i = 0; i < PERFORMANCE_METRICS_OUTPUT_ALLOCATION_PHASES; ++i) {
+        performance_allocations_t allocations;
+        if (!events[i] || performance_event_get_allocations(events[i], &allocations))
+            continue;
+
+        if (!printed_heading++) {
+            if (tty)
+                fprintf(output, "\n\x1b[1;4mMEMORY ALLOCATIONS\x1b[22;24m\n\n");
+            else
+                fprintf(output, "\nMEMORY ALLOCATIONS\n\n");
+            fprintf(output,
+                    "%-22s %10s %15s %15s %15s %15s\n",
+                    "Phase",
+                    "Blocks",
+                    "Allocated (KiB)",
+                    "Freed (KiB)",
+                    "Peak (KiB)",
+                    "Pools (KiB)");
+        }
+
+        fprintf(output,
+                "%-22s %10zu %15.1f %15.1f %15.1f %15.1f\n",
+                names[i],
+                allocations.allocations,
+                allocations.allocated / 1024.0,
+                allocations.freed / 1024.0,
+                allocations.peak / 1024.0,
+                allocations.pool_allocated / 1024.0);
+    }
+
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i)
+        if (totals[i])
+            performance_event_free(totals[i]);
+}
+
+/**
+ * @brief   Prints the CPUs and threads the program ran with.
+ * @details Auxiliary method for ::performance_metrics_output_print.
+ *
+ * @param output Where to print the topology to.
+ */
+void __performance_metrics_output_print_topology(FILE *output) {
+    char cpus[256];
+    numa_topology_format_cpus(cpus, sizeof(cpus));
+
+    const size_t cpu_count  = numa_topology_get_cpu_count();
+    const size_t node_count = numa_topology_get_node_count();
+    fprintf(output,
+            "CPUs: %s (%zu CPU%s, %zu NUMA node%s), %s\n",
+            cpus,
+            cpu_count,
+            cpu_count == 1 ? "" : "s",
+            node_count,
+            node_count == 1 ? "" : "s",
+            thread_pool_get_pinning() ? "threads pinned to a CPU each" : "threads not pinned");
+
+    fprintf(output, "Threads:");
+    for (size_t i = 0; i < THREAD_POOL_STAGE_COUNT; ++i)
+        fprintf(output,
+                "%s %s %zu",
+                i ? "," : "",
+                thread_pool_stage_get_name(i),
+                thread_pool_get_stage_thread_count(i));
+    fputc('\n', output);
+}
+
 void performance_metrics_output_print(FILE *output, const performance_metrics_t *metrics) {
     /* To know if ANSI escape codes for bold and underline can be used. */
     const int tty = isatty(fileno(output));
 
+    if (tty)
+        fprintf(output, "\n\x1b[1;4mTHREAD TOPOLOGY\x1b[22;24m\n\n");
+    else
+        fprintf(output, "\nTHREAD TOPOLOGY\n\n");
+    __performance_metrics_output_print_topology(output);
+
     if (tty)
         fprintf(output, "\n\x1b[1;4mDATASET LOADING\x1b[22;24m\n\n");
     else
         fprintf(output, "\nDATASET LOADING\n\n");
     const uint64_t dataset_time = __performance_metrics_output_print_dataset(output, metrics);
+    __performance_metrics_output_print_catalog(output, metrics);
 
     if (tty)
         fprintf(output, "\n\x1b[1;4mQUERY STATISTICAL DATA GENERATION\x1b[22;24m\n\n");
@@ -403,6 +1093,47 @@ void performance_metrics_output_print(FILE *output, const performance_metrics_t
         fprintf(output, "\nQUERY EXECUTION\n\n");
     query_time += __performance_metrics_output_print_all_queries(output, metrics);
 
+    const size_t duplicates = performance_metrics_get_duplicate_query_count(metrics);
+    if (duplicates)
+        fprintf(output, "\n%zu duplicate queries (output copied, not executed)\n", duplicates);
+    __performance_metrics_output_print_instrumentation(output, metrics);
+    __performance_metrics_output_print_strategies(output, metrics);
+    __performance_metrics_output_print_output_files(output, metrics);
+    __performance_metrics_output_print_id_filters(output, metrics);
+    __performance_metrics_output_print_result_cache(output, metrics);
+
+    if (tty)
+        fprintf(output, "\n\x1b[1;4mQUERY LATENCY PERCENTILES\x1b[22;24m\n\n");
+    else
+        fprintf(output, "\nQUERY LATENCY PERCENTILES\n\n");
+    __performance_metrics_output_print_percentiles(output, metrics);
+
+    if (tty)
+        fprintf(output, "\n\x1b[1;4mSLOWEST QUERIES\x1b[22;24m\n\n");
+    else
+        fprintf(output, "\nSLOWEST QUERIES\n\n");
+    __performance_metrics_output_print_slowest_queries(output, metrics);
+    __performance_metrics_output_print_allocations(output, metrics, tty);
+
+    const memory_report_t *const memory_report = performance_metrics_get_memory_report(metrics);
+    if (memory_report) {
+        if (tty)
+            fprintf(output, "\n\x1b[1;4mDATABASE MEMORY USAGE\x1b[22;24m\n\n");
+        else
+            fprintf(output, "\nDATABASE MEMORY USAGE\n\n");
+        __performance_metrics_output_print_memory_report(output, memory_report);
+    }
+
+    memory_usage_t freeze_before, freeze_after;
+    if (!performance_metrics_get_freeze_memory(metrics, &freeze_before, &freeze_after))
+        fprintf(output,
+                "\nDatabase freeze: %.2lf MiB reserved (%.2lf MiB wasted) before, %.2lf MiB "
+                "(%.2lf MiB wasted) after, including indexes\n",
+                (double) freeze_before.reserved_bytes / (1024 * 1024),
+                (double) freeze_before.wasted_bytes / (1024 * 1024),
+                (double) freeze_after.reserved_bytes / (1024 * 1024),
+                (double) freeze_after.wasted_bytes / (1024 * 1024));
+
     if (tty)
         fprintf(output, "\n\x1b[1;4mPERFORMANCE SUMMARY\x1b[22;24m\n\n");
     else
@@ -0,0 +1,526 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  performance_profiler.c
+ * @brief Implementation of methods in include/testing/performance_profiler.h
+ *
+ * ### Example
+ * See [the header file's documentation](@ref performance_profiler_example).
+ */
+
+#include <errno.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "testing/performance_profiler.h"
+#include "utils/int_utils.h"
+
+/**
+ * @brief Number of frames of a backtrace taken in the signal handler that belong to the handler
+ *        itself (the handler and the signal trampoline). Sanitizers that wrap signal handlers add
+ *        one more frame, that shows up as the innermost of every sample.
+ */
+#define PERFORMANCE_PROFILER_HANDLER_FRAMES 2
+
+/**
+ * @struct performance_profiler_sample_t
+ * @brief  Backtrace of a thread when it was interrupted by the profiler.
+ *
+ * @var performance_profiler_sample_t::frames
+ *     @brief Return addresses of the backtrace, innermost first.
+ * @var performance_profiler_sample_t::depth
+ *     @brief Number of addresses in ::performance_profiler_sample_t::frames.
+ * @var performance_profiler_sample_t::phase
+ *     @brief Phase the thread was in (index in ::performance_profiler_phase_names).
+ * @var performance_profiler_sample_t::ready
+ *     @brief Whether the signal handler finished writing the sample.
+ */
+typedef struct {
+    void  *frames[PERFORMANCE_PROFILER_MAX_DEPTH];
+    size_t depth;
+    size_t phase;
+    int    ready;
+} performance_profiler_sample_t;
+
+/**
+ * @struct performance_profiler
+ * @brief  Sampling profiler, that attributes CPU time to the phases of the program.
+ *
+ * @var performance_profiler::samples
+ *     @brief Buffer of ::PERFORMANCE_PROFILER_MAX_SAMPLES samples.
+ * @var performance_profiler::nsamples
+ *     @brief Number of samples taken, that may exceed the size of ::performance_profiler::samples.
+ * @var performance_profiler::timer
+ *     @brief Timer that sends `SIGPROF` to the process.
+ * @var performance_profiler::running
+ *     @brief Whether ::performance_profiler::timer still exists.
+ */
+struct performance_profiler {
+    performance_profiler_sample_t *samples;
+    size_t                         nsamples;
+    timer_t                        timer;
+    int                            running;
+};
+
+/** @brief Names of the phases samples are attributed to, also used to name their files. */
+const char *const performance_profiler_phase_names[PERFORMANCE_PROFILER_PHASE_COUNT] = {
+    "other",
+    "dataset_users",
+    "dataset_flights",
+    "dataset_passengers",
+    "dataset_reservations",
+    "q1_statistics",
+    "q2_statistics",
+    "q3_statistics",
+    "q4_statistics",
+    "q5_statistics",
+    "q6_statistics",
+    "q7_statistics",
+    "q8_statistics",
+    "q9_statistics",
+    "q10_statistics",
+    "q1_execution",
+    "q2_execution",
+    "q3_execution",
+    "q4_execution",
+    "q5_execution",
+    "q6_execution",
+    "q7_execution",
+    "q8_execution",
+    "q9_execution",
+    "q10_execution"};
+
+/** @brief Profiler whose timer is running, that the signal handler writes samples to. */
+performance_profiler_t *performance_profiler_running = NULL;
+
+/** @brief Phase of the calling thread (index in ::performance_profiler_phase_names). */
+__thread size_t performance_profiler_thread_phase = 0;
+
+/**
+ * @brief   Stores a sample of the interrupted thread.
+ * @details `SIGPROF` handler. `backtrace` must have been called once before, so that it doesn't
+ *          need to load any library (which isn't async-signal-safe) in the handler.
+ *
+ * @param signum Always `SIGPROF`.
+ */
+void __performance_profiler_handler(int signum) {
+    (void) signum;
+    const int saved_errno = errno;
+
+    performance_profiler_t *const profiler =
+        __atomic_load_n(&performance_profiler_running, __ATOMIC_ACQUIRE);
+    if (!profiler)
+        goto DEFER_1;
+
+    const size_t i = __atomic_fetch_add(&profiler->nsamples, 1, __ATOMIC_RELAXED);
+    if (i >= PERFORMANCE_PROFILER_MAX_SAMPLES)
+        goto DEFER_1;
+
+    void     *frames[PERFORMANCE_PROFILER_MAX_DEPTH + PERFORMANCE_PROFILER_HANDLER_FRAMES];
+    const int depth =
+        backtrace(frames, PERFORMANCE_PROFILER_MAX_DEPTH + PERFORMANCE_PROFILER_HANDLER_FRAMES);
+
+    performance_profiler_sample_t *const sample = &profiler->samples[i];
+    sample->depth = depth > PERFORMANCE_PROFILER_HANDLER_FRAMES
+                        ? (size_t) depth - PERFORMANCE_PROFILER_HANDLER_FRAMES
+                        : 0;
+    memcpy(sample->frames,
+           frames + PERFORMANCE_PROFILER_HANDLER_FRAMES,
+           sample->depth * sizeof(void *));
+    sample->phase = performance_profiler_thread_phase;
+    __atomic_store_n(&sample->ready, 1, __ATOMIC_RELEASE);
+
+DEFER_1:
+    errno = saved_errno;
+}
+
+performance_profiler_t *performance_profiler_start(void) {
+    performance_profiler_t *const profiler = malloc(sizeof(performance_profiler_t));
+    if (!profiler)
+        goto DEFER_1;
+
+    profiler->samples =
+        calloc(PERFORMANCE_PROFILER_MAX_SAMPLES, sizeof(performance_profiler_sample_t));
+    if (!profiler->samples)
+        goto DEFER_2;
+    profiler->nsamples = 0;
+    profiler->running  = 0;
+
+    performance_profiler_t *expected = NULL;
+    if (!__atomic_compare_exchange_n(&performance_profiler_running,
+                                     &expected,
+                                     profiler,
+                                     0,
+                                     __ATOMIC_RELEASE,
+                                     __ATOMIC_RELAXED))
+        goto DEFER_3; /* Another profiler is running */
+
+    void *warm_up[1];
+    backtrace(warm_up, 1);
+
+    struct sigaction action = {0};
+    action.sa_handler       = __performance_profiler_handler;
+    action.sa_flags         = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, NULL))
+        goto DEFER_4;
+
+    struct sigevent event = {0};
+    event.sigev_notify    = SIGEV_SIGNAL;
+    event.sigev_signo     = SIGPROF;
+    if (timer_create(CLOCK_PROCESS_CPUTIME_ID, &event, &profiler->timer))
+        goto DEFER_4;
+    profiler->running = 1;
+
+    const struct itimerspec interval = {
+        .it_interval = {.tv_sec = 0, .tv_nsec = PERFORMANCE_PROFILER_INTERVAL * 1000},
+        .it_value    = {.tv_sec = 0, .tv_nsec = PERFORMANCE_PROFILER_INTERVAL * 1000}};
+    if (timer_settime(profiler->timer, 0, &interval, NULL))
+        goto DEFER_5;
+
+    return profiler;
+
+DEFER_5:
+    timer_delete(profiler->timer);
+DEFER_4:
+    __atomic_store_n(&performance_profiler_running, NULL, __ATOMIC_RELEASE);
+DEFER_3:
+    free(profiler->samples);
+DEFER_2:
+    free(profiler);
+DEFER_1:
+    return NULL;
+}
+
+void performance_profiler_enter_dataset(performance_metrics_dataset_step_t step) {
+    performance_profiler_thread_phase = 1 + (size_t) step;
+}
+
+void performance_profiler_enter_query_statistics(size_t query_type) {
+    performance_profiler_thread_phase = PERFORMANCE_METRICS_DATASET_STEP_DONE + query_type;
+}
+
+void performance_profiler_enter_query_execution(size_t query_type) {
+    performance_profiler_thread_phase =
+        PERFORMANCE_METRICS_DATASET_STEP_DONE + QUERY_TYPE_LIST_COUNT + query_type;
+}
+
+void performance_profiler_leave(void) {
+    performance_profiler_thread_phase = 0;
+}
+
+const char *performance_profiler_get_phase_name(size_t phase) {
+    return performance_profiler_phase_names[phase];
+}
+
+void performance_profiler_stop(performance_profiler_t *profiler) {
+    if (!profiler->running)
+        return;
+
+    timer_delete(profiler->timer);
+    profiler->running = 0;
+    __atomic_store_n(&performance_profiler_running, NULL, __ATOMIC_RELEASE);
+
+    /* A signal may still be pending, and SIGPROF terminates the process by default */
+    struct sigaction action = {0};
+    action.sa_handler       = SIG_IGN;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, NULL);
+}
+
+size_t performance_profiler_get_sample_count(const performance_profiler_t *profiler) {
+    return __atomic_load_n(&profiler->nsamples, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief  Gets the number of samples stored by a profiler.
+ * @param  profiler Profiler to get the number of samples from.
+ * @return The number of samples in ::performance_profiler::samples, that may not all be ready.
+ */
+size_t __performance_profiler_get_stored_count(const performance_profiler_t *profiler) {
+    return min(performance_profiler_get_sample_count(profiler),
+               (size_t) PERFORMANCE_PROFILER_MAX_SAMPLES);
+}
+
+/**
+ * @brief   Writes the name of a frame of a backtrace, in a format fit for folded stacks.
+ * @details Auxiliary method for ::__performance_profiler_fold. Spaces and semicolons, that
+ *          separate fields in folded stacks, are replaced by underscores.
+ *
+ * @param stream Where to write the name to.
+ * @param symbol Symbol of the frame, from `backtrace_symbols` (`path(function+0x1f) [0x...]`,
+ *               `path(+0x1f) [0x...]`, or `[0x...]`).
+ */
+void __performance_profiler_write_frame(FILE *stream, const char *symbol) {
+    const char *const open  = strchr(symbol, '(');
+    const char *const plus  = open ? strchr(open, '+') : NULL;
+    const char *const close = open ? strchr(open, ')') : NULL;
+
+    const char *start, *end;
+    if (open && plus && plus > open + 1) {
+        start = open + 1; /* Function name */
+        end   = plus;
+    } else if (open && close) {
+        start = open; /* Name of the object, followed by the offset in it */
+        while (start > symbol && start[-1] != '/')
+            start--;
+        end = close;
+    } else {
+        start = symbol;
+        end   = symbol + strlen(symbol);
+    }
+
+    for (const char *c = start; c < end; ++c)
+        fputc(*c == ' ' || *c == ';' || *c == '(' ? '_' : *c, stream);
+}
+
+/**
+ * @brief   Turns the backtrace of a sample into a folded stack.
+ * @details Auxiliary method for ::__performance_profiler_fold_all.
+ *
+ * @param sample Sample to be symbolized.
+ *
+ * @return A string with the frames of @p sample from the outermost to the innermost, separated by
+ *         semicolons, that must be `free`d, or `NULL` on allocation failure.
+ */
+char *__performance_profiler_fold(const performance_profiler_sample_t *sample) {
+    char **const symbols = backtrace_symbols(sample->frames, (int) sample->depth);
+    if (!symbols)
+        return NULL;
+
+    char  *folded;
+    size_t length;
+    FILE  *const stream = open_memstream(&folded, &length);
+    if (!stream) {
+        free(symbols);
+        return NULL;
+    }
+
+    for (size_t i = sample->depth; i > 0; --i) {
+        __performance_profiler_write_frame(stream, symbols[i - 1]);
+        if (i > 1)
+            fputc(';', stream);
+    }
+
+    free(symbols);
+    if (fclose(stream))
+        return NULL;
+    return folded;
+}
+
+/**
+ * @brief  Turns the backtraces of all samples of a profiler into folded stacks.
+ * @param  profiler Stopped profiler whose samples are symbolized.
+ * @return An array with a folded stack (see ::__performance_profiler_fold) per stored sample,
+ *         `NULL` for samples without one, or `NULL` on allocation failure. The array and its
+ *         strings must be `free`d.
+ */
+char **__performance_profiler_fold_all(const performance_profiler_t *profiler) {
+    const size_t n      = __performance_profiler_get_stored_count(profiler);
+    char **const folded = calloc(n ? n : 1, sizeof(char *));
+    if (!folded)
+        return NULL;
+
+    for (size_t i = 0; i < n; ++i) {
+        const performance_profiler_sample_t *const sample = &profiler->samples[i];
+        if (__atomic_load_n(&sample->ready, __ATOMIC_ACQUIRE) && sample->depth)
+            folded[i] = __performance_profiler_fold(sample);
+    }
+    return folded;
+}
+
+/**
+ * @brief   Compares two strings, for `qsort`.
+ * @details Auxiliary method for ::__performance_profiler_get_phase_stacks.
+ *
+ * @param a Pointer to the first string.
+ * @param b Pointer to the second string.
+ *
+ * @return The same as `strcmp`.
+ */
+int __performance_profiler_compare_strings(const void *a, const void *b) {
+    return strcmp(*(const char *const *) a, *(const char *const *) b);
+}
+
+/**
+ * @brief   Gets the folded stacks of a phase, sorted, so that equal ones are adjacent.
+ * @details Auxiliary method for ::performance_profiler_print and ::performance_profiler_write.
+ *
+ * @param profiler Stopped profiler whose samples are searched.
+ * @param folded   Folded stacks returned by ::__performance_profiler_fold_all.
+ * @param phase    Phase of the samples to be returned.
+ * @param leaves   Whether to only return the innermost frame of each stack.
+ * @param out      Where to write the stacks to, with space for all stored samples.
+ *
+ * @return The number of stacks written to @p out.
+ */
+size_t __performance_profiler_get_phase_stacks(const performance_profiler_t *profiler,
+                                               char *const                  *folded,
+                                               size_t                        phase,
+                                               int                           leaves,
+                                               const char                  **out) {
+    size_t count = 0;
+    for (size_t i = 0; i < __performance_profiler_get_stored_count(profiler); ++i) {
+        if (!folded[i] || profiler->samples[i].phase != phase)
+            continue;
+
+        const char *const leaf = strrchr(folded[i], ';');
+        out[count++]           = leaves && leaf ? leaf + 1 : folded[i];
+    }
+
+    qsort(out, count, sizeof(const char *), __performance_profiler_compare_strings);
+    return count;
+}
+
+/**
+ * @brief Frees the folded stacks returned by ::__performance_profiler_fold_all.
+ *
+ * @param profiler Profiler the stacks belong to.
+ * @param folded   Stacks to be freed.
+ */
+void __performance_profiler_free_folded(const performance_profiler_t *profiler, char **folded) {
+    for (size_t i = 0; i < __performance_profiler_get_stored_count(profiler); ++i)
+        free(folded[i]);
+    free(folded);
+}
+
+void performance_profiler_print(FILE *output, const performance_profiler_t *profiler) {
+    const size_t total  = performance_profiler_get_sample_count(profiler);
+    const size_t stored = __performance_profiler_get_stored_count(profiler);
+    fprintf(output,
+            "Profile: %zu samples (%zu dropped), one every %d us of CPU time\n",
+            total,
+            total - stored,
+            PERFORMANCE_PROFILER_INTERVAL);
+
+    char **const       folded = __performance_profiler_fold_all(profiler);
+    const char **const stacks = malloc((stored ? stored : 1) * sizeof(const char *));
+    if (!folded || !stacks) {
+        fputs("Failed to symbolize samples!\n\n", output);
+        goto DEFER_1;
+    }
+
+    fprintf(output, "%-22s %8s  %s\n", "Phase", "Samples", "Hottest function");
+    for (size_t phase = 0; phase < PERFORMANCE_PROFILER_PHASE_COUNT; ++phase) {
+        const size_t n =
+            __performance_profiler_get_phase_stacks(profiler, folded, phase, 1, stacks);
+        if (!n)
+            continue;
+
+        /* Longest run of equal innermost frames */
+        size_t hottest = 0, hottest_count = 0;
+        for (size_t i = 0, j; i < n; i = j) {
+            for (j = i + 1; j < n && strcmp(stacks[i], stacks[j]) == 0; ++j)
+                ;
+            if (j - i > hottest_count) {
+                hottest       = i;
+                hottest_count = j - i;
+            }
+        }
+
+        fprintf(output,
+                "%-22s %8zu  %s (%.1f %%)\n",
+                performance_profiler_phase_names[phase],
+                n,
+                stacks[hottest],
+                hottest_count * 100.0 / n);
+    }
+    fputc('\n', output);
+
+DEFER_1:
+    free(stacks);
+    if (folded)
+        __performance_profiler_free_folded(profiler, folded);
+}
+
+/**
+ * @brief   Writes the folded stacks of a phase to a file.
+ * @details Auxiliary method for ::performance_profiler_write.
+ *
+ * @param directory Directory where to create the file.
+ * @param phase     Phase whose stacks are written.
+ * @param stacks    Sorted stacks of @p phase (see ::__performance_profiler_get_phase_stacks).
+ * @param n         Number of @p stacks.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure.
+ */
+int __performance_profiler_write_phase(const char        *directory,
+                                       size_t             phase,
+                                       const char *const *stacks,
+                                       size_t             n) {
+    const char *const name   = performance_profiler_phase_names[phase];
+    const size_t      length = strlen(directory) + strlen(name) + sizeof("/.folded");
+    char *const       path   = malloc(length);
+    if (!path)
+        return 1;
+    snprintf(path, length, "%s/%s.folded", directory, name);
+
+    FILE *const file = fopen(path, "w");
+    free(path);
+    if (!file)
+        return 1;
+
+    for (size_t i = 0, j; i < n; i = j) {
+        for (j = i + 1; j < n && strcmp(stacks[i], stacks[j]) == 0; ++j)
+            ;
+        fprintf(file, "%s %zu\n", stacks[i], j - i);
+    }
+
+    const int failed = ferror(file) != 0;
+    return fclose(file) || failed;
+}
+
+int performance_profiler_write(const performance_profiler_t *profiler, const char *directory) {
+    if (mkdir(directory, 0755) && errno != EEXIST)
+        return 1;
+
+    int                retval = 1;
+    const size_t       stored = __performance_profiler_get_stored_count(profiler);
+    char **const       folded = __performance_profiler_fold_all(profiler);
+    const char **const stacks = malloc((stored ? stored : 1) * sizeof(const char *));
+    if (!folded || !stacks)
+        goto DEFER_1;
+
+    retval = 0;
+    for (size_t phase = 0; phase < PERFORMANCE_PROFILER_PHASE_COUNT; ++phase) {
+        const size_t n =
+            __performance_profiler_get_phase_stacks(profiler, folded, phase, 0, stacks);
+        if (n && __performance_profiler_write_phase(directory, phase, stacks, n))
+            retval = 1;
+    }
+
+DEFER_1:
+    free(stacks);
+    if (folded)
+        __performance_profiler_free_folded(profiler, folded);
+    return retval;
+}
+
+void performance_profiler_free(performance_profiler_t *profiler) {
+    if (!profiler)
+        return;
+
+    performance_profiler_stop(profiler);
+    free(profiler->samples);
+    free(profiler);
+}
@@ -0,0 +1,305 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  performance_scaling.c
+ * @brief Implementation of methods in include/testing/performance_scaling.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref performance_scaling_example).
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "testing/performance_metrics_export.h"
+#include "testing/performance_scaling.h"
+#include "utils/table.h"
+
+/** @brief Index of the whole dataset phase. */
+#define PERFORMANCE_SCALING_DATASET_PHASE PERFORMANCE_METRICS_DATASET_STEP_DONE
+
+/** @brief Index of the first query statistical data generation phase. */
+#define PERFORMANCE_SCALING_STATISTICS_PHASE (PERFORMANCE_SCALING_DATASET_PHASE + 1)
+
+/** @brief Index of the first query execution phase. */
+#define PERFORMANCE_SCALING_EXECUTION_PHASE                                                        \
+    (PERFORMANCE_SCALING_STATISTICS_PHASE + QUERY_TYPE_LIST_COUNT)
+
+/** @brief Index of the output writing phase. */
+#define PERFORMANCE_SCALING_OUTPUT_PHASE                                                           \
+    (PERFORMANCE_SCALING_EXECUTION_PHASE + QUERY_TYPE_LIST_COUNT)
+
+/** @brief Index of the output comparison phase. */
+#define PERFORMANCE_SCALING_DIFF_PHASE (PERFORMANCE_SCALING_OUTPUT_PHASE + 1)
+
+/** @brief Index of the whole run phase. */
+#define PERFORMANCE_SCALING_TOTAL_PHASE (PERFORMANCE_SCALING_DIFF_PHASE + 1)
+
+/**
+ * @struct performance_scaling
+ * @brief  Times of each phase of the program, for a range of numbers of threads.
+ *
+ * @var performance_scaling::nsteps
+ *     @brief Number of different numbers of threads studied.
+ * @var performance_scaling::threads
+ *     @brief Number of threads of each step.
+ * @var performance_scaling::runs
+ *     @brief Number of runs added to each step.
+ * @var performance_scaling::times
+ *     @brief   Fastest time (in microseconds) of each phase, in every step.
+ *     @details `0` for phases that didn't happen.
+ * @var performance_scaling::phase_names
+ *     @brief Name of each phase.
+ */
+struct performance_scaling {
+    size_t    nsteps;
+    size_t   *threads;
+    size_t   *runs;
+    uint64_t (*times)[PERFORMANCE_SCALING_PHASE_COUNT];
+    char      phase_names[PERFORMANCE_SCALING_PHASE_COUNT][32];
+};
+
+performance_scaling_t *performance_scaling_create(size_t max_threads) {
+    performance_scaling_t *const scaling = malloc(sizeof(performance_scaling_t));
+    if (!scaling)
+        return NULL;
+
+    /* Powers of two below max_threads, and max_threads itself */
+    scaling->nsteps = 1;
+    for (size_t n = 1; n < max_threads; n *= 2)
+        scaling->nsteps++;
+
+    scaling->threads = malloc(scaling->nsteps * sizeof(size_t));
+    scaling->runs    = calloc(scaling->nsteps, sizeof(size_t));
+    scaling->times   = calloc(scaling->nsteps, sizeof(*scaling->times));
+    if (!scaling->threads || !scaling->runs || !scaling->times) {
+        performance_scaling_free(scaling);
+        return NULL;
+    }
+
+    for (size_t i = 0, n = 1; i < scaling->nsteps; ++i, n *= 2)
+        scaling->threads[i] = n < max_threads ? n : max_threads;
+
+    const char *const step_names[] = {"Users", "Flights", "Passengers", "Reservations"};
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i)
+        snprintf(scaling->phase_names[i], 32, "Dataset (%s)", step_names[i]);
+    strcpy(scaling->phase_names[PERFORMANCE_SCALING_DATASET_PHASE], "Dataset");
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        snprintf(scaling->phase_names[PERFORMANCE_SCALING_STATISTICS_PHASE + i],
+                 32,
+                 "Statistics (Query %zu)",
+                 i + 1);
+        snprintf(scaling->phase_names[PERFORMANCE_SCALING_EXECUTION_PHASE + i],
+                 32,
+                 "Execution (Query %zu)",
+                 i + 1);
+    }
+    strcpy(scaling->phase_names[PERFORMANCE_SCALING_OUTPUT_PHASE], "Output");
+    strcpy(scaling->phase_names[PERFORMANCE_SCALING_DIFF_PHASE], "Test diff");
+    strcpy(scaling->phase_names[PERFORMANCE_SCALING_TOTAL_PHASE], "Total");
+
+    return scaling;
+}
+
+size_t performance_scaling_get_step_count(const performance_scaling_t *scaling) {
+    return scaling->nsteps;
+}
+
+size_t performance_scaling_get_threads(const performance_scaling_t *scaling, size_t step) {
+    return scaling->threads[step];
+}
+
+void performance_scaling_add_run(performance_scaling_t       *scaling,
+                                 size_t                       step,
+                                 const performance_metrics_t *metrics,
+                                 uint64_t                     run_time,
+                                 uint64_t                     diff_time) {
+    uint64_t times[PERFORMANCE_SCALING_PHASE_COUNT] = {0};
+
+    for (size_t i = 0; i < PERFORMANCE_METRICS_DATASET_STEP_DONE; ++i)
+        times[i] = performance_metrics_get_dataset_step_wall_time(metrics, i);
+    times[PERFORMANCE_SCALING_DATASET_PHASE] = performance_metrics_get_dataset_wall_time(metrics);
+
+    for (size_t i = 0; i < QUERY_TYPE_LIST_COUNT; ++i) {
+        times[PERFORMANCE_SCALING_STATISTICS_PHASE + i] =
+            performance_metrics_get_query_statistics_wall_time(metrics, i + 1);
+        times[PERFORMANCE_SCALING_EXECUTION_PHASE + i] =
+            performance_metrics_get_query_execution_wall_time(metrics, i + 1);
+    }
+
+    const async_file_writer_statistics_t *const output =
+        performance_metrics_get_output_statistics(metrics);
+    if (output)
+        times[PERFORMANCE_SCALING_OUTPUT_PHASE] = output->blocked_time / 1000;
+    times[PERFORMANCE_SCALING_DIFF_PHASE]  = diff_time;
+    times[PERFORMANCE_SCALING_TOTAL_PHASE] = run_time;
+
+    /* Keep the fastest run, the one least disturbed by the rest of the system */
+    uint64_t *const kept = scaling->times[step];
+    for (size_t i = 0; i < PERFORMANCE_SCALING_PHASE_COUNT; ++i)
+        if (!scaling->runs[step] || (times[i] && (!kept[i] || times[i] < kept[i])))
+            kept[i] = times[i];
+    scaling->runs[step]++;
+}
+
+/**
+ * @brief   Calculates the speedup and parallel efficiency of a phase in a step.
+ * @details Auxiliary method for ::performance_scaling_print and the export methods.
+ *
+ * @param scaling    Scaling study the phase belongs to.
+ * @param step       Index of the number of threads.
+ * @param phase      Index of the phase.
+ * @param speedup    Where to write the speedup of the phase to.
+ * @param efficiency Where to write the parallel efficiency (between `0` and `1`, ideally) to.
+ *
+ * @retval 0 Success.
+ * @retval 1 The phase didn't happen in @p step or with a single thread. Nothing was written.
+ */
+int __performance_scaling_get_speedup(const performance_scaling_t *scaling,
+                                      size_t                       step,
+                                      size_t                       phase,
+                                      double                      *speedup,
+                                      double                      *efficiency) {
+    const uint64_t base = scaling->times[0][phase], time = scaling->times[step][phase];
+    if (!base || !time)
+        return 1;
+
+    *speedup    = (double) base / time;
+    *efficiency = *speedup / scaling->threads[step];
+    return 0;
+}
+
+void performance_scaling_print(FILE *output, const performance_scaling_t *scaling) {
+    /* To know if ANSI escape codes for bold and underline can be used. */
+    const int tty = isatty(fileno(output));
+
+    if (tty)
+        fprintf(output, "\n\x1b[1;4mTHREAD SCALING\x1b[22;24m\n\n");
+    else
+        fprintf(output, "\nTHREAD SCALING\n\n");
+
+    size_t rows = 0;
+    for (size_t i = 0; i < PERFORMANCE_SCALING_PHASE_COUNT; ++i)
+        if (scaling->times[0][i])
+            rows++;
+
+    table_t *const table = table_create(scaling->nsteps + 1, rows + 1);
+    if (!table) {
+        fputs("Failed to allocate table!\n", output);
+        return;
+    }
+
+    table_insert_format(table, 0, 0, "Phase");
+    for (size_t j = 0; j < scaling->nsteps; ++j)
+        table_insert_format(table, j + 1, 0, "%zu thread(s)", scaling->threads[j]);
+
+    size_t row = 1;
+    for (size_t i = 0; i < PERFORMANCE_SCALING_PHASE_COUNT; ++i) {
+        if (!scaling->times[0][i])
+            continue;
+
+        table_insert_format(table, 0, row, "%s", scaling->phase_names[i]);
+        for (size_t j = 0; j < scaling->nsteps; ++j) {
+            double speedup, efficiency;
+            if (__performance_scaling_get_speedup(scaling, j, i, &speedup, &efficiency))
+                table_insert_format(table, j + 1, row, "-");
+            else
+                table_insert_format(table,
+                                    j + 1,
+                                    row,
+                                    "%.2lf ms (%.2lfx, %.0lf%%)",
+                                    scaling->times[j][i] / 1000.0,
+                                    speedup,
+                                    efficiency * 100);
+        }
+        ++row;
+    }
+
+    table_draw(output, table);
+    table_free(table);
+    fputs("\nTimes are wall-clock (fastest run), followed by speedup and parallel efficiency.\n",
+          output);
+}
+
+int performance_scaling_export_json(FILE *output, const performance_scaling_t *scaling) {
+    fprintf(output,
+            "{\n  \"schema_version\": %d,\n"
+            "  \"build\": {\"type\": \"%s\", \"revision\": \"%s\"},\n"
+            "  \"scaling\": [",
+            PERFORMANCE_METRICS_EXPORT_SCHEMA_VERSION,
+            performance_metrics_export_get_build_type(),
+            performance_metrics_export_get_revision());
+
+    int first = 1;
+    for (size_t i = 0; i < PERFORMANCE_SCALING_PHASE_COUNT; ++i) {
+        for (size_t j = 0; j < scaling->nsteps; ++j) {
+            double speedup, efficiency;
+            if (__performance_scaling_get_speedup(scaling, j, i, &speedup, &efficiency))
+                continue;
+
+            fprintf(output,
+                    "%s\n    {\"phase\": \"%s\", \"threads\": %zu, \"time_us\": %" PRIu64
+                    ", \"speedup\": %.4lf, \"efficiency\": %.4lf}",
+                    first ? "" : ",",
+                    scaling->phase_names[i],
+                    scaling->threads[j],
+                    scaling->times[j][i],
+                    speedup,
+                    efficiency);
+            first = 0;
+        }
+    }
+    fputs("\n  ]\n}\n", output);
+
+    return ferror(output) ? 1 : 0;
+}
+
+int performance_scaling_export_csv(FILE *output, const performance_scaling_t *scaling) {
+    fputs("build_type,revision,phase,threads,time_us,speedup,efficiency\n", output);
+
+    for (size_t i = 0; i < PERFORMANCE_SCALING_PHASE_COUNT; ++i) {
+        for (size_t j = 0; j < scaling->nsteps; ++j) {
+            double speedup, efficiency;
+            if (__performance_scaling_get_speedup(scaling, j, i, &speedup, &efficiency))
+                continue;
+
+            fprintf(output,
+                    "%s,%s,%s,%zu,%" PRIu64 ",%.4lf,%.4lf\n",
+                    performance_metrics_export_get_build_type(),
+                    performance_metrics_export_get_revision(),
+                    scaling->phase_names[i],
+                    scaling->threads[j],
+                    scaling->times[j][i],
+                    speedup,
+                    efficiency);
+        }
+    }
+
+    return ferror(output) ? 1 : 0;
+}
+
+void performance_scaling_free(performance_scaling_t *scaling) {
+    if (!scaling)
+        return;
+
+    free(scaling->threads);
+    free(scaling->runs);
+    free(scaling->times);
+    free(scaling);
+}
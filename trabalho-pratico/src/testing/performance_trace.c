@@ -0,0 +1,237 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  performance_trace.c
+ * @brief Implementation of methods in include/testing/performance_trace.h
+ *
+ * ### Example
+ * See [the header file's documentation](@ref performance_trace_example).
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "testing/performance_trace.h"
+
+/**
+ * @struct performance_trace_event_t
+ * @brief  Beginning or end of a step in a thread.
+ *
+ * @var performance_trace_event_t::name
+ *     @brief Name of the step that began, or `NULL` for an end.
+ * @var performance_trace_event_t::time
+ *     @brief Monotonic time of the event, in nanoseconds.
+ */
+typedef struct {
+    const char *name;
+    uint64_t    time;
+} performance_trace_event_t;
+
+/**
+ * @struct performance_trace_buffer_t
+ * @brief  Ring buffer of the events of a thread.
+ *
+ * @var performance_trace_buffer_t::next
+ *     @brief Buffer of the thread that started recording before this one (or `NULL`).
+ * @var performance_trace_buffer_t::thread
+ *     @brief Number of the thread, in the order threads started recording.
+ * @var performance_trace_buffer_t::written
+ *     @brief Number of events ever recorded by the thread. Only the last
+ *            ::PERFORMANCE_TRACE_THREAD_CAPACITY are kept.
+ * @var performance_trace_buffer_t::events
+ *     @brief Events of the thread, with the event number `i` in index
+ *            `i % PERFORMANCE_TRACE_THREAD_CAPACITY`.
+ */
+typedef struct performance_trace_buffer {
+    struct performance_trace_buffer *next;
+    size_t                           thread;
+    size_t                           written;
+    performance_trace_event_t        events[PERFORMANCE_TRACE_THREAD_CAPACITY];
+} performance_trace_buffer_t;
+
+/** @brief Whether events are being recorded (see ::performance_trace_is_enabled). */
+int performance_trace_enabled = 0;
+
+/** @brief Whether ::performance_trace_stop was called, after which tracing can't restart. */
+int performance_trace_stopped = 0;
+
+/** @brief Time when tracing started, in nanoseconds, that events are relative to. */
+uint64_t performance_trace_start_time = 0;
+
+/** @brief Buffers of all threads that recorded events, most recent first. */
+performance_trace_buffer_t *performance_trace_buffers = NULL;
+
+/** @brief Number of buffers in ::performance_trace_buffers. */
+size_t performance_trace_thread_count = 0;
+
+/** @brief Mutex that protects ::performance_trace_buffers from concurrent registrations. */
+pthread_mutex_t performance_trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Buffer of the calling thread, or `NULL` before the thread's first event. */
+__thread performance_trace_buffer_t *performance_trace_thread_buffer = NULL;
+
+/**
+ * @brief  Gets the current monotonic time.
+ * @return The current time, in nanoseconds.
+ */
+uint64_t __performance_trace_get_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+void performance_trace_start(void) {
+    pthread_mutex_lock(&performance_trace_mutex);
+    if (!performance_trace_stopped) {
+        performance_trace_start_time = __performance_trace_get_time();
+        __atomic_store_n(&performance_trace_enabled, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&performance_trace_mutex);
+}
+
+int performance_trace_is_enabled(void) {
+    return __atomic_load_n(&performance_trace_enabled, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief   Records an event in the calling thread's buffer.
+ * @details Auxiliary method for ::performance_trace_begin and ::performance_trace_end. The
+ *          thread's buffer is created with its first event.
+ *
+ * @param name Name of the step that began, or `NULL` for an end.
+ */
+void __performance_trace_record(const char *name) {
+    performance_trace_buffer_t *buffer = performance_trace_thread_buffer;
+    if (!buffer) {
+        buffer = malloc(sizeof(performance_trace_buffer_t));
+        if (!buffer)
+            return;
+
+        pthread_mutex_lock(&performance_trace_mutex);
+        buffer->next              = performance_trace_buffers;
+        buffer->thread            = performance_trace_thread_count++;
+        buffer->written           = 0;
+        performance_trace_buffers = buffer;
+        pthread_mutex_unlock(&performance_trace_mutex);
+
+        performance_trace_thread_buffer = buffer;
+    }
+
+    performance_trace_event_t *const event =
+        &buffer->events[buffer->written % PERFORMANCE_TRACE_THREAD_CAPACITY];
+    event->name = name;
+    event->time = __performance_trace_get_time();
+    buffer->written++;
+}
+
+void performance_trace_begin(const char *name) {
+    if (__builtin_expect(__atomic_load_n(&performance_trace_enabled, __ATOMIC_RELAXED), 0))
+        __performance_trace_record(name);
+}
+
+void performance_trace_end(void) {
+    if (__builtin_expect(__atomic_load_n(&performance_trace_enabled, __ATOMIC_RELAXED), 0))
+        __performance_trace_record(NULL);
+}
+
+/**
+ * @brief   Writes the events of a thread in the Chrome trace event format.
+ * @details Auxiliary method for ::performance_trace_stop.
+ *
+ * @param file   File to write the events to.
+ * @param buffer Events of the thread.
+ * @param pid    Identifier of the process.
+ * @param first  Whether no event was written to @p file yet. Will be updated.
+ */
+void __performance_trace_write_buffer(FILE                             *file,
+                                      const performance_trace_buffer_t *buffer,
+                                      long                              pid,
+                                      int                              *first) {
+
+    const size_t start = buffer->written > PERFORMANCE_TRACE_THREAD_CAPACITY
+                             ? buffer->written - PERFORMANCE_TRACE_THREAD_CAPACITY
+                             : 0;
+
+    size_t depth = 0;
+    for (size_t i = start; i < buffer->written; ++i) {
+        const performance_trace_event_t *const event =
+            &buffer->events[i % PERFORMANCE_TRACE_THREAD_CAPACITY];
+
+        if (event->name) {
+            depth++;
+        } else if (depth) {
+            depth--;
+        } else {
+            continue; /* Its beginning was overwritten */
+        }
+
+        const uint64_t time =
+            event->time > performance_trace_start_time ? event->time - performance_trace_start_time
+                                                       : 0;
+        fprintf(file,
+                "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%" PRIu64 ".%03" PRIu64
+                ",\"pid\":%ld,\"tid\":%zu}",
+                *first ? "" : ",",
+                event->name ? event->name : "",
+                event->name ? 'B' : 'E',
+                time / 1000,
+                time % 1000,
+                pid,
+                buffer->thread);
+        *first = 0;
+    }
+}
+
+int performance_trace_stop(const char *path) {
+    pthread_mutex_lock(&performance_trace_mutex);
+    __atomic_store_n(&performance_trace_enabled, 0, __ATOMIC_RELEASE);
+    performance_trace_stopped = 1;
+
+    performance_trace_buffer_t *const buffers = performance_trace_buffers;
+    performance_trace_buffers                 = NULL;
+    pthread_mutex_unlock(&performance_trace_mutex);
+
+    int retval = 0;
+    if (path) {
+        FILE *const file = fopen(path, "w");
+        if (file) {
+            int first = 1;
+            fputs("{\"traceEvents\":[", file);
+            for (const performance_trace_buffer_t *b = buffers; b; b = b->next)
+                __performance_trace_write_buffer(file, b, (long) getpid(), &first);
+            fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+
+            retval = ferror(file) != 0;
+            retval = fclose(file) || retval;
+        } else {
+            retval = 1;
+        }
+    }
+
+    performance_trace_buffer_t *buffer = buffers;
+    while (buffer) {
+        performance_trace_buffer_t *const next = buffer->next;
+        free(buffer);
+        buffer = next;
+    }
+    return retval;
+}
@@ -0,0 +1,413 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  query_benchmark.c
+ * @brief Implementation of methods in include/testing/query_benchmark.h
+ *
+ * ### Example
+ * See [the header file's documentation](@ref query_benchmark_example).
+ */
+
+#include <time.h>
+
+#include "dataset/dataset_loader.h"
+#include "queries/query_file_parser.h"
+#include "queries/query_type_list.h"
+#include "queries/query_writer.h"
+#include "testing/benchmark.h"
+#include "testing/performance_histogram.h"
+#include "testing/query_benchmark.h"
+
+/**
+ * @struct query_benchmark_state_t
+ * @brief  State shared by the benchmarks of the selected queries.
+ *
+ * @var query_benchmark_state_t::database
+ *     @brief Database the queries are run on.
+ * @var query_benchmark_state_t::type
+ *     @brief Type of all selected queries.
+ * @var query_benchmark_state_t::n
+ *     @brief Number of selected queries.
+ * @var query_benchmark_state_t::instances
+ *     @brief Selected queries.
+ * @var query_benchmark_state_t::statistics
+ *     @brief Statistical data of the selected queries, for the repetition being run.
+ * @var query_benchmark_state_t::statistics_allocator
+ *     @brief Arena where ::query_benchmark_state_t::statistics is allocated.
+ * @var query_benchmark_state_t::histogram
+ *     @brief Execution times of single queries (in nanoseconds), in timed repetitions.
+ * @var query_benchmark_state_t::runs
+ *     @brief Number of runs of the execution benchmark so far, so that warmup runs (see
+ *            ::BENCHMARK_WARMUP_RUNS) aren't recorded in ::query_benchmark_state_t::histogram.
+ */
+typedef struct {
+    const database_t              *database;
+    const query_type_t            *type;
+    size_t                         n;
+    const query_instance_t *const *instances;
+    void                          *statistics;
+    arena_t                       *statistics_allocator;
+    performance_histogram_t       *histogram;
+    size_t                         runs;
+} query_benchmark_state_t;
+
+/**
+ * @brief   Generates the statistical data of the selected queries.
+ * @details Auxiliary method for benchmarks.
+ *
+ * @param state State of the benchmark, where to store the statistical data to.
+ *
+ * @retval 0 Success (or no statistical data needed by the query type).
+ * @retval 1 Failure to generate statistical data.
+ */
+int __query_benchmark_generate_statistics(query_benchmark_state_t *state) {
+    const query_type_generate_statistics_callback_t generate =
+        query_type_get_generate_statistics_callback(state->type);
+    state->statistics           = NULL;
+    state->statistics_allocator = NULL;
+    if (!generate)
+        return 0;
+
+    arena_t *const allocator = arena_create(QUERY_TYPE_STATISTICS_ARENA_BLOCK_SIZE);
+    if (!allocator)
+        return 1;
+
+    state->statistics = generate(state->database, state->n, state->instances, allocator);
+    if (!state->statistics) {
+        arena_free(allocator);
+        return 1;
+    }
+
+    state->statistics_allocator = allocator;
+    return 0;
+}
+
+/**
+ * @brief   Frees the statistical data of the selected queries.
+ * @details Auxiliary method for benchmarks.
+ *
+ * @param state State of the benchmark, with statistical data to be freed.
+ */
+void __query_benchmark_free_statistics(query_benchmark_state_t *state) {
+    const query_type_free_statistics_callback_t free_stats =
+        query_type_get_free_statistics_callback(state->type);
+
+    if (state->statistics) {
+        if (free_stats)
+            free_stats(state->statistics);
+        arena_free(state->statistics_allocator);
+    }
+    state->statistics           = NULL;
+    state->statistics_allocator = NULL;
+}
+
+/**
+ * @brief   Generates and frees the statistical data of the selected queries.
+ * @details Run method of the statistics benchmark. Failures can't be reported, so they're just
+ *          timed.
+ */
+void __query_benchmark_statistics_run(void *state) {
+    __query_benchmark_generate_statistics(state);
+    __query_benchmark_free_statistics(state);
+}
+
+/**
+ * @brief   Executes all selected queries, discarding their outputs.
+ * @details Run method of the execution benchmarks. Reading the clock around every query makes
+ *          repetitions slightly slower than the queries themselves.
+ */
+void __query_benchmark_execution_run(void *state) {
+    query_benchmark_state_t *const bench_state = state;
+    const int                      record      = bench_state->runs++ >= BENCHMARK_WARMUP_RUNS;
+
+    for (size_t i = 0; i < bench_state->n; ++i) {
+        const query_instance_t *const instance = bench_state->instances[i];
+        query_writer_t *const output =
+            query_writer_create_buffered(query_instance_get_formatted(instance));
+        if (!output)
+            continue;
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        query_type_list_execute(bench_state->database, bench_state->statistics, instance, output);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        query_writer_free(output);
+        if (record)
+            performance_histogram_record(bench_state->histogram,
+                                         (end.tv_sec - start.tv_sec) * 1000000000 +
+                                             (end.tv_nsec - start.tv_nsec));
+    }
+}
+
+/**
+ * @brief   Generates statistical data before a repetition.
+ * @details Setup method of the cold execution benchmark.
+ */
+void *__query_benchmark_cold_setup(void *data) {
+    query_benchmark_state_t *const state = data;
+    return __query_benchmark_generate_statistics(state) ? NULL : state;
+}
+
+/**
+ * @brief   Frees statistical data after a repetition.
+ * @details Teardown method of the cold execution benchmark.
+ */
+void __query_benchmark_cold_teardown(void *state) {
+    __query_benchmark_free_statistics(state);
+}
+
+/**
+ * @brief   Prints the distribution of the execution times of single queries.
+ * @details Auxiliary method for ::__query_benchmark_run_instances.
+ *
+ * @param output Where to print the distribution to.
+ * @param name   Name of the execution benchmark.
+ * @param state  State of the benchmark, with the execution times.
+ */
+void __query_benchmark_print_distribution(FILE                          *output,
+                                          const char                    *name,
+                                          const query_benchmark_state_t *state) {
+    fprintf(output,
+            "%s, single query (ns): p50 %" PRIu64 ", p90 %" PRIu64 ", p99 %" PRIu64
+            ", max %" PRIu64 "\n",
+            name,
+            performance_histogram_get_percentile(state->histogram, 50),
+            performance_histogram_get_percentile(state->histogram, 90),
+            performance_histogram_get_percentile(state->histogram, 99),
+            performance_histogram_get_max(state->histogram));
+}
+
+/**
+ * @brief   Runs an execution benchmark, and prints its results.
+ * @details Auxiliary method for ::__query_benchmark_run_instances.
+ *
+ * @param output      Where to print the results to.
+ * @param benchmark   Execution benchmark to be run.
+ * @param repetitions Number of timed repetitions.
+ * @param state       State of the benchmark (::benchmark_t::data).
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (reported to `stderr`).
+ */
+int __query_benchmark_run_execution(FILE                    *output,
+                                    const benchmark_t       *benchmark,
+                                    size_t                   repetitions,
+                                    query_benchmark_state_t *state) {
+    state->runs      = 0;
+    state->histogram = performance_histogram_create();
+    if (!state->histogram) {
+        fputs("Failed to allocate histogram of query execution times!\n", stderr);
+        return 1;
+    }
+
+    benchmark_result_t result;
+    const int          retval = benchmark_run(benchmark, repetitions, &result);
+    if (retval) {
+        fprintf(stderr, "Failed to run benchmark \"%s\"!\n", benchmark->name);
+    } else {
+        benchmark_print_result(output, benchmark, &result);
+        __query_benchmark_print_distribution(output, benchmark->name, state);
+    }
+
+    performance_histogram_free(state->histogram);
+    state->histogram = NULL;
+    return retval;
+}
+
+/**
+ * @brief   Benchmarks the generation of statistical data and the execution of a set of queries.
+ * @details Auxiliary method for ::query_benchmark_run.
+ *
+ * @param output    Where to print the results to.
+ * @param database  Database to run the queries on.
+ * @param n         Number of queries in @p instances.
+ * @param instances Queries to be run, all of the same type.
+ * @param options   Options of the benchmarks.
+ *
+ * @retval 0 Success.
+ * @retval 1 Failure (reported to `stderr`).
+ */
+int __query_benchmark_run_instances(FILE                            *output,
+                                    const database_t                *database,
+                                    size_t                           n,
+                                    const query_instance_t *const   *instances,
+                                    const query_benchmark_options_t *options) {
+    query_benchmark_state_t state = {.database             = database,
+                                     .type                 = query_instance_get_type(instances[0]),
+                                     .n                    = n,
+                                     .instances            = instances,
+                                     .statistics           = NULL,
+                                     .statistics_allocator = NULL,
+                                     .histogram            = NULL,
+                                     .runs                 = 0};
+
+    const size_t type_number = query_type_get_type_number(state.type);
+    char         statistics_name[32], warm_name[32], cold_name[32];
+    snprintf(statistics_name, sizeof(statistics_name), "Q%zu statistics", type_number);
+    snprintf(warm_name, sizeof(warm_name), "Q%zu execution (warm)", type_number);
+    snprintf(cold_name, sizeof(cold_name), "Q%zu execution (cold)", type_number);
+
+    const benchmark_t statistics = {.name       = statistics_name,
+                                    .operations = 1,
+                                    .setup      = NULL,
+                                    .run        = __query_benchmark_statistics_run,
+                                    .teardown   = NULL,
+                                    .data       = &state};
+    const benchmark_t warm       = {.name       = warm_name,
+                                    .operations = n,
+                                    .setup      = NULL,
+                                    .run        = __query_benchmark_execution_run,
+                                    .teardown   = NULL,
+                                    .data       = &state};
+    const benchmark_t cold       = {.name       = cold_name,
+                                    .operations = n,
+                                    .setup      = __query_benchmark_cold_setup,
+                                    .run        = __query_benchmark_execution_run,
+                                    .teardown   = __query_benchmark_cold_teardown,
+                                    .data       = &state};
+
+    fprintf(output, "Benchmarking %zu Q%zu queries\n\n", n, type_number);
+    benchmark_print_header(output);
+
+    if (query_type_get_generate_statistics_callback(state.type)) {
+        benchmark_result_t result;
+        if (benchmark_run(&statistics, options->repetitions, &result)) {
+            fprintf(stderr, "Failed to run benchmark \"%s\"!\n", statistics.name);
+            return 1;
+        }
+        benchmark_print_result(output, &statistics, &result);
+    }
+
+    if (__query_benchmark_generate_statistics(&state)) {
+        fputs("Failed to generate statistical data!\n", stderr);
+        return 1;
+    }
+    const int retval = __query_benchmark_run_execution(output, &warm, options->repetitions, &state);
+    __query_benchmark_free_statistics(&state);
+    if (retval)
+        return 1;
+
+    if (options->cold)
+        return __query_benchmark_run_execution(output, &cold, options->repetitions, &state);
+    return 0;
+}
+
+/**
+ * @struct query_benchmark_selection_t
+ * @brief  Data passed to ::__query_benchmark_iter_types, to benchmark the selected queries.
+ *
+ * @var query_benchmark_selection_t::output
+ *     @brief Where to print the results to.
+ * @var query_benchmark_selection_t::database
+ *     @brief Database to run the queries on.
+ * @var query_benchmark_selection_t::options
+ *     @brief Which queries to benchmark, and how.
+ * @var query_benchmark_selection_t::found
+ *     @brief Whether any query was selected.
+ */
+typedef struct {
+    FILE                            *output;
+    const database_t                *database;
+    const query_benchmark_options_t *options;
+    int                              found;
+} query_benchmark_selection_t;
+
+/**
+ * @brief   Benchmarks the selected queries of a type, if any.
+ * @details Callback for ::query_instance_list_iter_types.
+ */
+int __query_benchmark_iter_types(void                         *user_data,
+                                 size_t                        n,
+                                 const query_instance_t *const instances[n]) {
+    query_benchmark_selection_t *const selection = user_data;
+    const query_benchmark_options_t   *options   = selection->options;
+
+    if (options->type) {
+        if (query_type_get_type_number(query_instance_get_type(instances[0])) != options->type)
+            return 0;
+
+        selection->found = 1;
+        return __query_benchmark_run_instances(selection->output,
+                                               selection->database,
+                                               n,
+                                               instances,
+                                               options);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        if (query_instance_get_line_in_file(instances[i]) == options->line) {
+            selection->found = 1;
+            return __query_benchmark_run_instances(selection->output,
+                                                   selection->database,
+                                                   1,
+                                                   &instances[i],
+                                                   options);
+        }
+    }
+    return 0;
+}
+
+int query_benchmark_run(FILE                            *output,
+                        const char                      *dataset_dir,
+                        const char                      *query_file_path,
+                        const query_benchmark_options_t *options) {
+    int retval = 1;
+
+    FILE *const query_file = fopen(query_file_path, "r");
+    if (!query_file) {
+        fputs("Failed to read query file!\n", stderr);
+        goto DEFER_1;
+    }
+
+    query_instance_list_t *const list = query_file_parser_parse(query_file);
+    if (!list) {
+        fputs("Failed to allocate list of queries!\n", stderr);
+        goto DEFER_2;
+    }
+
+    database_t *const database = database_create();
+    if (!database) {
+        fputs("Failed to allocate database!\n", stderr);
+        goto DEFER_3;
+    }
+
+    if (dataset_loader_load(database, dataset_dir, "Resultados", NULL, NULL)) {
+        fputs("Failed to load dataset files!\n", stderr);
+        goto DEFER_4;
+    }
+
+    query_benchmark_selection_t selection = {.output   = output,
+                                             .database = database,
+                                             .options  = options,
+                                             .found    = 0};
+    retval = query_instance_list_iter_types(list, __query_benchmark_iter_types, &selection);
+    if (!retval && !selection.found) {
+        fputs("No queries selected from the query file!\n", stderr);
+        retval = 1;
+    }
+
+DEFER_4:
+    database_free(database);
+DEFER_3:
+    query_instance_list_free(list);
+DEFER_2:
+    fclose(query_file);
+DEFER_1:
+    return retval;
+}
@@ -23,15 +23,23 @@
  */
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <glib.h>
+#include <inttypes.h>
 #include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
+#include "queries/query_output_compressor.h"
+#include "queries/query_output_pack.h"
 #include "testing/test_diff.h"
 #include "utils/int_utils.h"
+#include "utils/thread_pool.h"
 
 /**
  * @struct test_diff
@@ -62,13 +70,17 @@ gint __test_diff_read_dir_sort_compare(gconstpointer a, gconstpointer b) {
 }
 
 /**
- * @brief  Creates a lexicographically sorted array of all regular files (this excludes directories)
- *         in a directory.
- * @param  path Path to the directory to be listed.
+ * @brief Creates a lexicographically sorted array of all regular files (this excludes directories
+ *        and manifests, see ::TEST_DIFF_MANIFEST_FILE_NAME) in a directory.
+ *
+ * @param path       Path to the directory to be listed.
+ * @param compressed Whether the directory may contain compressed outputs, whose names are listed
+ *                   without ::QUERY_OUTPUT_COMPRESSOR_SUFFIX (and whose dictionary isn't listed).
+ *
  * @return A lexicographically sorted array of `char *`, that should be deleted with
  *         `g_ptr_array_unref`.
  */
-GPtrArray *__test_diff_read_dir(const char *path) {
+GPtrArray *__test_diff_read_dir(const char *path, int compressed) {
     GPtrArray *const ret = g_ptr_array_new_with_free_func((GDestroyNotify) free);
 
     DIR *const dir = opendir(path);
@@ -79,12 +91,26 @@ GPtrArray *__test_diff_read_dir(const char *path) {
 
     struct dirent *ent;
     while ((ent = readdir(dir)) != NULL) {
+        if (strcmp(ent->d_name, TEST_DIFF_MANIFEST_FILE_NAME) == 0 ||
+            (compressed && strcmp(ent->d_name, QUERY_OUTPUT_COMPRESSOR_DICTIONARY_NAME) == 0))
+            continue;
+
         char full_path[PATH_MAX];
         snprintf(full_path, PATH_MAX, "%s/%s", path, ent->d_name);
 
         struct stat statbuf; /* Only show regular files */
         if (!stat(full_path, &statbuf) && S_ISREG(statbuf.st_mode)) {
-            g_ptr_array_add(ret, strdup(ent->d_name));
+            char *const name = strdup(ent->d_name);
+            if (!name)
+                continue;
+
+            const size_t length = strlen(name);
+            const size_t suffix = strlen(QUERY_OUTPUT_COMPRESSOR_SUFFIX);
+            if (compressed && length > suffix &&
+                strcmp(name + length - suffix, QUERY_OUTPUT_COMPRESSOR_SUFFIX) == 0)
+                name[length - suffix] = '\0';
+
+            g_ptr_array_add(ret, name);
         }
     }
     closedir(dir);
@@ -94,32 +120,75 @@ GPtrArray *__test_diff_read_dir(const char *path) {
 }
 
 /**
- * @brief   Fills three arrays with information about files common between two directories.
- * @details The filled arrays are guaranteed to be lexicographically sorted.
+ * @brief   Creates a lexicographically sorted array of the names of the files in a pack, and of the
+ *          other files next to it.
+ * @details Outputs in the pack are named like in the default (one file per query) layout. Other
+ *          regular files in the pack's directory (such as the dataset's error files) are listed
+ *          like in ::__test_diff_read_dir, unless the pack has an output with the same name.
  *
- * @param results  Directory where the program's output was placed into.
- * @param expected Directory containing expected program results.
- * @param common   Files present in both @p results and @p expected.
- * @param extra    Files in @p results but not it @p expected.
- * @param missing  Files in @p expected but not in @p results.
+ * @param pack      Pack of query outputs.
+ * @param directory Directory containing the pack.
+ * @param pack_name Name of the pack's file in @p directory, that isn't listed.
+ * @param entries   Where to map the name of each output in @p pack (borrowed from the returned
+ *                  array) to the index of its entry, plus one.
  *
- * @retval 0 Success.
- * @retval 1 IO error.
+ * @return A lexicographically sorted array of `char *`, that should be deleted with
+ *         `g_ptr_array_unref`, or `NULL` if @p directory can't be listed.
  */
-int __test_diff_common_files(const char *results,
-                             const char *expected,
-                             GPtrArray  *common,
-                             GPtrArray  *extra,
-                             GPtrArray  *missing) {
-
-    GPtrArray *const results_files = __test_diff_read_dir(results);
-    if (!results_files)
-        return 1;
-    GPtrArray *const expected_files = __test_diff_read_dir(expected);
-    if (!expected_files) {
-        g_ptr_array_unref(results_files);
-        return 1;
+GPtrArray *__test_diff_read_pack(const query_output_pack_reader_t *pack,
+                                 const char                       *directory,
+                                 const char                       *pack_name,
+                                 GHashTable                       *entries) {
+    const size_t     count = query_output_pack_reader_get_count(pack);
+    GPtrArray *const ret   = g_ptr_array_new_full(count, (GDestroyNotify) free);
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t line, length;
+        query_output_pack_reader_get(pack, i, &line, &length);
+
+        char name[PATH_MAX];
+        snprintf(name, PATH_MAX, QUERY_OUTPUT_PACK_ENTRY_NAME_FORMAT, line);
+
+        char *const name_copy = strdup(name);
+        g_ptr_array_add(ret, name_copy);
+        g_hash_table_insert(entries, name_copy, GSIZE_TO_POINTER(i + 1));
+    }
+
+    GPtrArray *const files = __test_diff_read_dir(directory, 0);
+    if (!files) {
+        g_ptr_array_unref(ret);
+        return NULL;
+    }
+    for (guint i = 0; i < files->len; ++i) {
+        const char *const name = g_ptr_array_index(files, i);
+        if (strcmp(name, pack_name) == 0 || g_hash_table_contains(entries, name))
+            continue;
+
+        char *const name_copy = strdup(name);
+        if (name_copy)
+            g_ptr_array_add(ret, name_copy);
     }
+    g_ptr_array_unref(files);
+
+    g_ptr_array_sort(ret, __test_diff_read_dir_sort_compare);
+    return ret;
+}
+
+/**
+ * @brief   Fills three arrays with information about files common between two lists of files.
+ * @details The filled arrays are guaranteed to be lexicographically sorted.
+ *
+ * @param results_files  Lexicographically sorted files in the program's output.
+ * @param expected_files Lexicographically sorted files in the expected program results.
+ * @param common         Files present in both @p results_files and @p expected_files.
+ * @param extra          Files in @p results_files but not it @p expected_files.
+ * @param missing        Files in @p expected_files but not in @p results_files.
+ */
+void __test_diff_common_files(const GPtrArray *results_files,
+                              const GPtrArray *expected_files,
+                              GPtrArray       *common,
+                              GPtrArray       *extra,
+                              GPtrArray       *missing) {
 
     /* Algorithm similar to a merge, but for set partitioning */
     guint ri = 0, ei = 0;
@@ -150,95 +219,492 @@ int __test_diff_common_files(const char *results,
             }
         }
     }
-
-    g_ptr_array_unref(results_files);
-    g_ptr_array_unref(expected_files);
-    return 0;
 }
 
 /**
- * @brief Loads the contents of a file to memory.
+ * @brief Maps the contents of a file to memory.
  *
  * @param path Path to the file.
- * @param n    Where to write the number of bytes read to.
+ * @param n    Where to write the length of the file to.
  *
- * @return On success, the array of read bytes, which must be deleted with `free`. On failure,
- *         `NULL` will be returned.
+ * @return On success, the file's contents, which must be unmapped with ::__test_diff_unmap_file.
+ *         Empty files are represented by a non-`NULL` pointer that must not be dereferenced. On
+ *         failure, `NULL` will be returned.
  */
-char *__test_diff_read_file(const char *path, size_t *n) {
-    FILE *const f = fopen(path, "r");
-    if (!f)
+const char *__test_diff_map_file(const char *path, size_t *n) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
         return NULL;
 
-    long  len;
-    char *ret = NULL;
+    const char *ret = NULL;
 
-    /* Determine lenght of file */
-    if (fseek(f, 0, SEEK_END))
-        goto END;
-    if ((len = ftell(f)) == -1)
-        goto END;
-    if (fseek(f, 0, 0))
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) || !S_ISREG(statbuf.st_mode))
         goto END;
 
-    /* Read file contents */
-    ret = malloc(sizeof(char) * len);
-    if (!ret)
+    *n = (size_t) statbuf.st_size;
+    if (*n == 0) { /* mmap refuses zero-length mappings */
+        ret = "";
         goto END;
+    }
 
-    const size_t read = fread(ret, 1, len, f);
-    if (read != (size_t) len || ferror(f)) {
-        ret = NULL;
-        free(ret);
+    void *const map = mmap(NULL, *n, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
         goto END;
-    }
+    ret = map;
 
-    *n = (size_t) len;
+    /* Files are read once, from start to end */
+    posix_madvise(map, *n, POSIX_MADV_SEQUENTIAL);
 END:
-    fclose(f);
+    close(fd);
     return ret;
 }
 
 /**
- * @brief Compares two files to determine if they differ in any line.
+ * @brief Unmaps a file mapped by ::__test_diff_map_file.
  *
- * @param result   Path to a file generated by the program.
- * @param expected Path to a file that the program is expected to output.
+ * @param contents Value returned by ::__test_diff_map_file.
+ * @param n        Length of the file, as written by ::__test_diff_map_file.
+ */
+void __test_diff_unmap_file(const char *contents, size_t n) {
+    if (n)
+        munmap((char *) (size_t) contents, n);
+}
+
+/**
+ * @struct test_diff_manifest_entry_t
+ * @brief  An expected file in the manifest of its directory (see ::TEST_DIFF_MANIFEST_FILE_NAME).
  *
- * @return `0` if the files are the same, `-1` if an IO error occurs while reading either file, the
- *         line where the files differ otherwise.
+ * @var test_diff_manifest_entry_t::size
+ *     @brief Size of the file, in bytes.
+ * @var test_diff_manifest_entry_t::modification_seconds
+ *     @brief Seconds of the modification time of the file.
+ * @var test_diff_manifest_entry_t::modification_nanoseconds
+ *     @brief Nanoseconds of the modification time of the file.
+ * @var test_diff_manifest_entry_t::hash
+ *     @brief Hash of the contents of the file (see ::__test_diff_hash).
+ * @var test_diff_manifest_entry_t::fresh
+ *     @brief Whether the entry was computed while comparing, and the manifest must be stored again.
  */
-ssize_t __test_diff_compare_files(const char *result, const char *expected) {
-    size_t      result_len, expected_len;
-    char *const result_contents = __test_diff_read_file(result, &result_len);
-    if (!result_contents)
-        return -1;
-    char *const expected_contents = __test_diff_read_file(expected, &expected_len);
-    if (!expected_contents) {
-        free(result_contents);
-        return -1;
+typedef struct {
+    uint64_t size;
+    int64_t  modification_seconds, modification_nanoseconds;
+    uint64_t hash[2];
+    int      fresh;
+} test_diff_manifest_entry_t;
+
+/** @brief Header line of manifests. Increment the version when their format changes. */
+#define TEST_DIFF_MANIFEST_HEADER "LI3 test_diff manifest 1\n"
+
+/**
+ * @brief   Mixes the bits of a value.
+ * @details Auxiliary method for ::__test_diff_hash (the finalizer of MurmurHash3).
+ *
+ * @param  x Value whose bits are to be mixed.
+ * @return Value with mixed bits.
+ */
+uint64_t __test_diff_mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccd;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53;
+    x ^= x >> 33;
+    return x;
+}
+
+/**
+ * @brief   Computes a 128-bit hash of the contents of a file.
+ * @details Two independent FNV-1a-like lanes, applied to 8-byte words, followed by a finalizer. Not
+ *          cryptographic, but fast enough for hashing outputs to be cheaper than reading the
+ *          expected ones.
+ *
+ * @param contents Contents of the file.
+ * @param length   Number of bytes in @p contents.
+ * @param hash     Where to write the hash to.
+ */
+void __test_diff_hash(const char *contents, size_t length, uint64_t hash[2]) {
+    uint64_t a = 0xcbf29ce484222325 ^ length, b = 0x84222325cbf29ce4;
+
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, contents + i, sizeof(uint64_t));
+        a = (a ^ word) * 0x100000001b3;
+        a ^= a >> 32;
+        b = (b ^ ((word << 32) | (word >> 32))) * 0x9e3779b97f4a7c15;
+        b ^= b >> 29;
     }
 
-    const size_t min_len = min(result_len, expected_len);
-    size_t       line = 1, ret = 0;
-    for (size_t i = 0; i < min_len; ++i) {
-        if (result_contents[i] == '\n' && expected_contents[i] == '\n')
-            line++;
+    uint64_t word = 0;
+    memcpy(&word, contents + i, length - i);
+    a = (a ^ word) * 0x100000001b3;
+    b = (b ^ ((word << 32) | (word >> 32))) * 0x9e3779b97f4a7c15;
 
-        if (result_contents[i] != expected_contents[i]) {
-            ret = line;
+    hash[0] = __test_diff_mix(a ^ (b >> 31));
+    hash[1] = __test_diff_mix(b ^ (a >> 27));
+}
+
+/**
+ * @brief Checks if a manifest entry still describes a file.
+ *
+ * @param entry   Entry in the manifest.
+ * @param statbuf Current metadata of the file.
+ *
+ * @return Whether the file keeps the size and modification time in @p entry.
+ */
+int __test_diff_manifest_entry_matches(const test_diff_manifest_entry_t *entry,
+                                       const struct stat                *statbuf) {
+    return entry->size == (uint64_t) statbuf->st_size &&
+           entry->modification_seconds == (int64_t) statbuf->st_mtim.tv_sec &&
+           entry->modification_nanoseconds == (int64_t) statbuf->st_mtim.tv_nsec;
+}
+
+/**
+ * @brief   Reads the manifest of an expected directory.
+ * @details Malformed lines are ignored, as entries can always be computed again.
+ *
+ * @param expected Directory containing expected program results.
+ *
+ * @return A table mapping file names (`char *`) to ::test_diff_manifest_entry_t (empty if there's
+ *         no valid manifest), that must be deleted with `g_hash_table_unref`.
+ */
+GHashTable *__test_diff_manifest_read(const char *expected) {
+    GHashTable *const manifest = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
+
+    char path[PATH_MAX];
+    snprintf(path, PATH_MAX, "%s/%s", expected, TEST_DIFF_MANIFEST_FILE_NAME);
+    FILE *const file = fopen(path, "r");
+    if (!file)
+        return manifest;
+
+    char  *line     = NULL;
+    size_t capacity = 0;
+    if (getline(&line, &capacity, file) < 0 || strcmp(line, TEST_DIFF_MANIFEST_HEADER))
+        goto DEFER_1;
+
+    while (getline(&line, &capacity, file) > 0) {
+        char *const tab = strchr(line, '\t');
+        if (!tab)
+            continue;
+        *tab = '\0';
+
+        test_diff_manifest_entry_t entry = {.fresh = 0};
+        if (sscanf(tab + 1,
+                   "%" SCNu64 "\t%" SCNd64 "\t%" SCNd64 "\t%16" SCNx64 "%16" SCNx64,
+                   &entry.size,
+                   &entry.modification_seconds,
+                   &entry.modification_nanoseconds,
+                   &entry.hash[0],
+                   &entry.hash[1]) != 5)
+            continue;
+
+        test_diff_manifest_entry_t *const entry_copy = malloc(sizeof(test_diff_manifest_entry_t));
+        char *const                       name       = strdup(line);
+        if (!entry_copy || !name) {
+            free(entry_copy);
+            free(name);
             break;
         }
+        *entry_copy = entry;
+        g_hash_table_replace(manifest, name, entry_copy);
     }
 
-    if (ret == 0 && result_len != expected_len)
-        ret = line;
+DEFER_1:
+    free(line);
+    fclose(file);
+    return manifest;
+}
 
-    free(result_contents);
-    free(expected_contents);
+/**
+ * @brief   Stores the manifest of an expected directory.
+ * @details The manifest is first written to a temporary file, that then replaces the previous one,
+ *          so that concurrent comparisons never read a partially written manifest.
+ *
+ * @param expected       Directory containing expected program results.
+ * @param expected_files Files in @p expected. Entries of other files are dropped.
+ * @param manifest       Table mapping file names to ::test_diff_manifest_entry_t.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO failure.
+ */
+int __test_diff_manifest_write(const char      *expected,
+                               const GPtrArray *expected_files,
+                               GHashTable      *manifest) {
+    char path[PATH_MAX], temporary_path[PATH_MAX];
+    if (snprintf(path, PATH_MAX, "%s/%s", expected, TEST_DIFF_MANIFEST_FILE_NAME) >= PATH_MAX ||
+        snprintf(temporary_path, PATH_MAX, "%s.%ld", path, (long) getpid()) >= PATH_MAX)
+        return 1; /* Path too long */
+
+    FILE *const file = fopen(temporary_path, "w");
+    if (!file)
+        return 1;
+
+    int retval = fputs(TEST_DIFF_MANIFEST_HEADER, file) < 0;
+    for (size_t i = 0; i < expected_files->len && !retval; ++i) {
+        const char *const                       name  = g_ptr_array_index(expected_files, i);
+        const test_diff_manifest_entry_t *const entry = g_hash_table_lookup(manifest, name);
+        if (!entry || strpbrk(name, "\t\n")) /* Names that can't be read back aren't stored */
+            continue;
+
+        retval = fprintf(file,
+                         "%s\t%" PRIu64 "\t%" PRId64 "\t%" PRId64 "\t%016" PRIx64 "%016" PRIx64
+                         "\n",
+                         name,
+                         entry->size,
+                         entry->modification_seconds,
+                         entry->modification_nanoseconds,
+                         entry->hash[0],
+                         entry->hash[1]) < 0;
+    }
+
+    retval = fclose(file) || retval;
+    if (!retval)
+        retval = rename(temporary_path, path) != 0;
+    if (retval)
+        remove(temporary_path);
+    return retval;
+}
+
+/**
+ * @brief   Number of bytes compared at once with `memcmp` by ::__test_diff_compare_files.
+ * @details Lines are only counted after a block with differences is found.
+ */
+#define TEST_DIFF_COMPARISON_BLOCK_SIZE 65536
+
+/**
+ * @brief Compares a program's output to the expected one to determine if they differ in any line.
+ *
+ * @param result_contents   Output of the program.
+ * @param result_len        Number of bytes in @p result_contents.
+ * @param expected_contents Output the program is expected to generate.
+ * @param expected_len      Number of bytes in @p expected_contents.
+ *
+ * @return `0` if the outputs are the same, the line where they differ otherwise.
+ */
+ssize_t __test_diff_compare_contents(const char *result_contents,
+                                     size_t      result_len,
+                                     const char *expected_contents,
+                                     size_t      expected_len) {
+    /* Find the offset of the first difference between files */
+    const size_t min_len = min(result_len, expected_len);
+    size_t       diff    = min_len;
+    for (size_t i = 0; i < min_len; i += TEST_DIFF_COMPARISON_BLOCK_SIZE) {
+        const size_t block_len = min(min_len - i, TEST_DIFF_COMPARISON_BLOCK_SIZE);
+        if (memcmp(result_contents + i, expected_contents + i, block_len)) {
+            diff = i;
+            while (result_contents[diff] == expected_contents[diff])
+                diff++;
+            break;
+        }
+    }
+
+    ssize_t ret = 0;
+    if (diff != min_len || result_len != expected_len) {
+        /* Only count lines when the files differ */
+        size_t      line = 1;
+        const char *cur  = result_contents;
+        const char *end  = result_contents + diff;
+        while (cur < end && (cur = memchr(cur, '\n', (size_t) (end - cur)))) {
+            line++;
+            cur++;
+        }
+        ret = (ssize_t) line;
+    }
+    return ret;
+}
+
+/**
+ * @brief   Compares a program's output to a file to determine if they differ in any line.
+ * @details When @p known still describes @p expected, the output is only hashed, and @p expected is
+ *          only read if the hashes differ (to find the line of the first difference).
+ *
+ * @param result_contents Output of the program.
+ * @param result_len      Number of bytes in @p result_contents.
+ * @param expected        Path to a file that the program is expected to output.
+ * @param known           Entry of @p expected in the manifest of its directory. Can be `NULL`.
+ * @param computed        Where to write a new manifest entry for @p expected to, when @p known is
+ *                        outdated (::test_diff_manifest_entry_t::fresh is only set in that case).
+ *
+ * @return `0` if the outputs are the same, `-1` if an IO error occurs while reading @p expected,
+ *         the line where the outputs differ otherwise.
+ */
+ssize_t __test_diff_compare_with_file(const char                       *result_contents,
+                                      size_t                            result_len,
+                                      const char                       *expected,
+                                      const test_diff_manifest_entry_t *known,
+                                      test_diff_manifest_entry_t       *computed) {
+    struct stat statbuf;
+    if (stat(expected, &statbuf) || !S_ISREG(statbuf.st_mode))
+        return -1;
+
+    const int up_to_date = known && __test_diff_manifest_entry_matches(known, &statbuf);
+    if (up_to_date && known->size == result_len) {
+        uint64_t hash[2];
+        __test_diff_hash(result_contents, result_len, hash);
+        if (hash[0] == known->hash[0] && hash[1] == known->hash[1])
+            return 0;
+    }
+
+    size_t            expected_len;
+    const char *const expected_contents = __test_diff_map_file(expected, &expected_len);
+    if (!expected_contents)
+        return -1;
+
+    const ssize_t ret =
+        __test_diff_compare_contents(result_contents, result_len, expected_contents, expected_len);
+
+    if (!up_to_date) {
+        computed->size                     = (uint64_t) statbuf.st_size;
+        computed->modification_seconds     = (int64_t) statbuf.st_mtim.tv_sec;
+        computed->modification_nanoseconds = (int64_t) statbuf.st_mtim.tv_nsec;
+        computed->fresh                    = 1;
+        __test_diff_hash(expected_contents, expected_len, computed->hash);
+    }
+
+    __test_diff_unmap_file(expected_contents, expected_len);
+    return ret;
+}
+
+/**
+ * @brief   Compares two files to determine if they differ in any line.
+ * @details If @p result doesn't exist, its compressed version (with
+ *          ::QUERY_OUTPUT_COMPRESSOR_SUFFIX) is decompressed and compared instead.
+ *
+ * @param result     Path to a file generated by the program.
+ * @param expected   Path to a file that the program is expected to output.
+ * @param compressor Compressor with the dictionary of compressed outputs. Can be `NULL`.
+ * @param known      Entry of @p expected in the manifest of its directory. Can be `NULL`.
+ * @param computed   Where to write a new manifest entry for @p expected to (see
+ *                   ::__test_diff_compare_with_file).
+ *
+ * @return `0` if the files are the same, `-1` if an IO error occurs while reading either file (or
+ *         while decompressing @p result), the line where the files differ otherwise.
+ */
+ssize_t __test_diff_compare_files(const char                       *result,
+                                  const char                       *expected,
+                                  const query_output_compressor_t  *compressor,
+                                  const test_diff_manifest_entry_t *known,
+                                  test_diff_manifest_entry_t       *computed) {
+    size_t      result_len;
+    const char *result_contents = __test_diff_map_file(result, &result_len);
+    if (!result_contents) {
+        char compressed_path[PATH_MAX];
+        snprintf(compressed_path, PATH_MAX, "%s%s", result, QUERY_OUTPUT_COMPRESSOR_SUFFIX);
+        result_contents = __test_diff_map_file(compressed_path, &result_len);
+        if (!result_contents)
+            return -1;
+    }
+
+    /* Outputs whose compression failed are written as they are */
+    char  *decompressed = NULL;
+    size_t decompressed_len;
+    if (query_output_compressor_is_compressed(result_contents, result_len) &&
+        query_output_compressor_decompress(compressor,
+                                           result_contents,
+                                           result_len,
+                                           &decompressed,
+                                           &decompressed_len)) {
+        __test_diff_unmap_file(result_contents, result_len);
+        return -1;
+    }
+
+    const ssize_t ret = decompressed ? __test_diff_compare_with_file(decompressed,
+                                                                     decompressed_len,
+                                                                     expected,
+                                                                     known,
+                                                                     computed)
+                                     : __test_diff_compare_with_file(result_contents,
+                                                                     result_len,
+                                                                     expected,
+                                                                     known,
+                                                                     computed);
+    free(decompressed);
+    __test_diff_unmap_file(result_contents, result_len);
     return ret;
 }
 
+/**
+ * @struct test_diff_compare_data_t
+ * @brief  Work shared by all threads comparing files.
+ *
+ * @var test_diff_compare_data_t::diff
+ *     @brief Where to get the list of files to compare from and where to write results to.
+ * @var test_diff_compare_data_t::results
+ *     @brief Directory where the program's output was placed into (the directory containing
+ *            ::test_diff_compare_data_t::pack, if there's one).
+ * @var test_diff_compare_data_t::expected
+ *     @brief Directory containing expected program results.
+ * @var test_diff_compare_data_t::pack
+ *     @brief Pack the program's output was placed into, or `NULL` for one file per query.
+ * @var test_diff_compare_data_t::pack_entries
+ *     @brief Maps the names of outputs to the index of their entry in
+ *            ::test_diff_compare_data_t::pack (plus one). Other files aren't in the pack.
+ * @var test_diff_compare_data_t::compressor
+ *     @brief Compressor with the dictionary of compressed outputs in
+ *            ::test_diff_compare_data_t::results, or `NULL` if there's no dictionary.
+ * @var test_diff_compare_data_t::manifest
+ *     @brief Manifest of ::test_diff_compare_data_t::expected (see ::__test_diff_manifest_read).
+ *            Only read while comparing.
+ * @var test_diff_compare_data_t::computed
+ *     @brief New manifest entries of each file in ::test_diff::common_files, valid when
+ *            ::test_diff_manifest_entry_t::fresh is set.
+ */
+typedef struct {
+    test_diff_t                      *diff;
+    const char                       *results, *expected;
+    query_output_pack_reader_t       *pack;
+    GHashTable                       *pack_entries;
+    query_output_compressor_t        *compressor;
+    GHashTable                       *manifest;
+    test_diff_manifest_entry_t       *computed;
+} test_diff_compare_data_t;
+
+/**
+ * @brief   Compares a range of the common files.
+ * @details Auxiliary method for ::test_diff_create, run in parallel by ::thread_pool_parallel_for.
+ *
+ * @param compare_data_data A ::test_diff_compare_data_t.
+ * @param start             Index of the first file to compare.
+ * @param end               Index after the last file to compare.
+ */
+void __test_diff_compare_range(void *compare_data_data, size_t start, size_t end) {
+    test_diff_compare_data_t *const compare_data = compare_data_data;
+    test_diff_t *const              diff         = compare_data->diff;
+
+    for (size_t i = start; i < end; ++i) {
+
+        const char *const file_name = g_ptr_array_index(diff->common_files, i);
+
+        char expected_path[PATH_MAX];
+        snprintf(expected_path, PATH_MAX, "%s/%s", compare_data->expected, file_name);
+
+        const test_diff_manifest_entry_t *const known =
+            g_hash_table_lookup(compare_data->manifest, file_name);
+        test_diff_manifest_entry_t *const computed = &compare_data->computed[i];
+
+        const size_t entry =
+            compare_data->pack
+                ? GPOINTER_TO_SIZE(g_hash_table_lookup(compare_data->pack_entries, file_name))
+                : 0;
+        if (entry) {
+            size_t            length;
+            const char *const output =
+                query_output_pack_reader_get(compare_data->pack, entry - 1, NULL, &length);
+            diff->common_file_errors[i] =
+                __test_diff_compare_with_file(output, length, expected_path, known, computed);
+        } else {
+            char result_path[PATH_MAX];
+            snprintf(result_path, PATH_MAX, "%s/%s", compare_data->results, file_name);
+            diff->common_file_errors[i] =
+                __test_diff_compare_files(result_path,
+                                          expected_path,
+                                          compare_data->compressor,
+                                          known,
+                                          computed);
+        }
+    }
+}
+
 test_diff_t *test_diff_create(const char *results, const char *expected) {
     test_diff_t *const diff = malloc(sizeof(test_diff_t));
     if (!diff)
@@ -249,30 +715,129 @@ test_diff_t *test_diff_create(const char *results, const char *expected) {
     diff->common_files       = g_ptr_array_new_with_free_func((GDestroyNotify) free);
     diff->common_file_errors = NULL;
 
-    if (__test_diff_common_files(results,
-                                 expected,
-                                 diff->common_files,
-                                 diff->extra_files,
-                                 diff->missing_files)) {
-        test_diff_free(diff);
-        return NULL;
+    test_diff_compare_data_t compare_data = {.diff         = diff,
+                                             .results      = results,
+                                             .expected     = expected,
+                                             .pack         = NULL,
+                                             .pack_entries = NULL,
+                                             .compressor   = NULL,
+                                             .manifest     = NULL,
+                                             .computed     = NULL};
+
+    /* Results are either a directory or a pack */
+    GPtrArray  *results_files = NULL, *expected_files = NULL;
+    char        results_directory[PATH_MAX];
+    struct stat statbuf;
+    if (!stat(results, &statbuf) && S_ISREG(statbuf.st_mode)) {
+        compare_data.pack = query_output_pack_reader_open(results);
+        if (!compare_data.pack)
+            goto DEFER_1;
+
+        /* Files other than query outputs, such as dataset errors, are written next to the pack */
+        const char *const slash = strrchr(results, '/');
+        if (slash)
+            snprintf(results_directory,
+                     PATH_MAX,
+                     "%.*s",
+                     slash == results ? 1 : (int) (slash - results),
+                     results);
+        else
+            strcpy(results_directory, ".");
+        compare_data.results = results_directory;
+
+        compare_data.pack_entries = g_hash_table_new(g_str_hash, g_str_equal);
+        results_files             = __test_diff_read_pack(compare_data.pack,
+                                                          results_directory,
+                                                          slash ? slash + 1 : results,
+                                                          compare_data.pack_entries);
+        if (!results_files)
+            goto DEFER_1;
+    } else {
+        results_files = __test_diff_read_dir(results, 1);
+        if (!results_files)
+            goto DEFER_1;
+
+        /* Without a dictionary, compressed outputs can still be decompressed */
+        char dictionary_path[PATH_MAX];
+        snprintf(dictionary_path,
+                 PATH_MAX,
+                 "%s/%s",
+                 results,
+                 QUERY_OUTPUT_COMPRESSOR_DICTIONARY_NAME);
+        if (!access(dictionary_path, F_OK)) {
+            compare_data.compressor = query_output_compressor_create(dictionary_path);
+            if (!compare_data.compressor)
+                goto DEFER_1;
+        }
     }
 
+    expected_files = __test_diff_read_dir(expected, 0);
+    if (!expected_files)
+        goto DEFER_1;
+
+    __test_diff_common_files(results_files,
+                             expected_files,
+                             diff->common_files,
+                             diff->extra_files,
+                             diff->missing_files);
+
+    compare_data.computed =
+        calloc(diff->common_files->len + 1, sizeof(test_diff_manifest_entry_t)); /* Never 0 */
+    if (!compare_data.computed)
+        goto DEFER_1;
+    compare_data.manifest = __test_diff_manifest_read(expected);
+
     diff->common_file_errors = malloc(sizeof(ssize_t) * diff->common_files->len);
+    if (!diff->common_file_errors)
+        goto DEFER_1;
+
+    /* One file at a time, as their sizes can be very different */
+    thread_pool_parallel_for_stage(thread_pool_get_shared(),
+                                   THREAD_POOL_STAGE_DIFF,
+                                   diff->common_files->len,
+                                   1,
+                                   __test_diff_compare_range,
+                                   &compare_data);
+
+    /* The manifest is only a cache, so failing to update it isn't an error */
+    int manifest_outdated = g_hash_table_size(compare_data.manifest) != expected_files->len;
+    for (size_t i = 0; i < diff->common_files->len; ++i) {
+        if (!compare_data.computed[i].fresh)
+            continue;
+
+        test_diff_manifest_entry_t *const copy = malloc(sizeof(test_diff_manifest_entry_t));
+        char *const name = strdup(g_ptr_array_index(diff->common_files, i));
+        if (!copy || !name) {
+            free(copy);
+            free(name);
+            break;
+        }
+
+        *copy = compare_data.computed[i];
+        g_hash_table_replace(compare_data.manifest, name, copy);
+        manifest_outdated = 1;
+    }
+    if (manifest_outdated)
+        __test_diff_manifest_write(expected, expected_files, compare_data.manifest);
+
+DEFER_1:
+    if (compare_data.manifest)
+        g_hash_table_unref(compare_data.manifest);
+    free(compare_data.computed);
+    query_output_compressor_free(compare_data.compressor);
+    if (compare_data.pack) {
+        g_hash_table_unref(compare_data.pack_entries);
+        query_output_pack_reader_close(compare_data.pack);
+    }
+    if (results_files)
+        g_ptr_array_unref(results_files);
+    if (expected_files)
+        g_ptr_array_unref(expected_files);
+
     if (!diff->common_file_errors) {
         test_diff_free(diff);
         return NULL;
     }
-
-    for (guint i = 0; i < diff->common_files->len; ++i) {
-        const char *const file_name = g_ptr_array_index(diff->common_files, i);
-
-        char result_path[PATH_MAX], expected_path[PATH_MAX];
-        snprintf(result_path, PATH_MAX, "%s/%s", results, file_name);
-        snprintf(expected_path, PATH_MAX, "%s/%s", expected, file_name);
-
-        diff->common_file_errors[i] = __test_diff_compare_files(result_path, expected_path);
-    }
     return diff;
 }
 
@@ -321,6 +886,16 @@ size_t test_diff_get_common_file_errors(const test_diff_t  *diff,
     return diff->common_files->len;
 }
 
+int test_diff_has_differences(const test_diff_t *diff) {
+    if (diff->extra_files->len || diff->missing_files->len)
+        return 1;
+
+    for (size_t i = 0; i < diff->common_files->len; ++i)
+        if (diff->common_file_errors[i])
+            return 1;
+    return 0;
+}
+
 void test_diff_free(test_diff_t *diff) {
     g_ptr_array_unref(diff->extra_files);
     g_ptr_array_unref(diff->common_files);
@@ -0,0 +1,485 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  test_equivalence.c
+ * @brief Implementation of methods in include/testing/test_equivalence.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref test_equivalence_example).
+ */
+
+/** @cond FALSE */
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE /* For realpath */
+#endif
+/** @endcond */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "batch_mode.h"
+#include "dataset/dataset_parser.h"
+#include "queries/query_result_cache.h"
+#include "queries/query_type.h"
+#include "testing/test_diff_output.h"
+#include "testing/test_equivalence.h"
+#include "utils/cpu_features.h"
+#include "utils/table.h"
+#include "utils/thread_pool.h"
+
+/** @brief Optimizations a configuration can enable. */
+typedef enum {
+    TEST_EQUIVALENCE_PARALLEL    = 1 << 0, /**< The default number of threads. */
+    TEST_EQUIVALENCE_SIMD        = 1 << 1, /**< The best kernels for the CPU. */
+    TEST_EQUIVALENCE_SPECIALIZED = 1 << 2, /**< Dataset parsers specialized for each file. */
+    TEST_EQUIVALENCE_PACKED      = 1 << 3  /**< All query outputs in a single file. */
+} test_equivalence_optimization_t;
+
+/**
+ * @struct test_equivalence_configuration_t
+ * @brief  A configuration of the program that can be verified.
+ *
+ * @var test_equivalence_configuration_t::name
+ *     @brief Name of the configuration, also the name of its directory.
+ * @var test_equivalence_configuration_t::optimizations
+ *     @brief Enabled optimizations (::test_equivalence_optimization_t).
+ */
+typedef struct {
+    const char  *name;
+    unsigned int optimizations;
+} test_equivalence_configuration_t;
+
+/** @brief All configurations, starting with the reference. */
+const test_equivalence_configuration_t test_equivalence_configurations[] = {
+    {"reference", 0},
+    {"parallel", TEST_EQUIVALENCE_PARALLEL},
+    {"simd", TEST_EQUIVALENCE_SIMD},
+    {"specialized", TEST_EQUIVALENCE_SPECIALIZED},
+    {"packed", TEST_EQUIVALENCE_PACKED},
+    {"combined",
+     TEST_EQUIVALENCE_PARALLEL | TEST_EQUIVALENCE_SIMD | TEST_EQUIVALENCE_SPECIALIZED |
+         TEST_EQUIVALENCE_PACKED},
+};
+
+/** @brief Number of elements in ::test_equivalence_configurations. */
+#define TEST_EQUIVALENCE_CONFIGURATION_COUNT                                                       \
+    (sizeof(test_equivalence_configurations) / sizeof(*test_equivalence_configurations))
+
+/** @brief Outcome of running a configuration. */
+typedef enum {
+    TEST_EQUIVALENCE_RESULT_NOT_RUN,   /**< The configuration hasn't been run yet. */
+    TEST_EQUIVALENCE_RESULT_IDENTICAL, /**< All outputs are the same as the reference's. */
+    TEST_EQUIVALENCE_RESULT_DIFFERENT, /**< Some outputs are extra, missing or different. */
+    TEST_EQUIVALENCE_RESULT_FAILED     /**< The configuration failed to run. */
+} test_equivalence_result_t;
+
+/**
+ * @struct test_equivalence_entry_t
+ * @brief  A configuration to be verified, and its result.
+ *
+ * @var test_equivalence_entry_t::configuration
+ *     @brief Configuration in ::test_equivalence_configurations.
+ * @var test_equivalence_entry_t::result
+ *     @brief Outcome of running the configuration.
+ * @var test_equivalence_entry_t::time
+ *     @brief Wall-clock time (in microseconds) of the configuration's process.
+ */
+typedef struct {
+    const test_equivalence_configuration_t *configuration;
+    test_equivalence_result_t               result;
+    uint64_t                                time;
+} test_equivalence_entry_t;
+
+/**
+ * @struct test_equivalence
+ * @brief  Configurations to be verified, and their results after being run.
+ *
+ * @var test_equivalence::entries
+ *     @brief Configurations to be verified, the first being the reference.
+ * @var test_equivalence::nentries
+ *     @brief Number of elements in ::test_equivalence::entries.
+ * @var test_equivalence::work_dir
+ *     @brief Absolute path to the directory of the configurations' directories, after being run.
+ */
+struct test_equivalence {
+    test_equivalence_entry_t entries[TEST_EQUIVALENCE_CONFIGURATION_COUNT];
+    size_t                   nentries;
+    char                    *work_dir;
+};
+
+/**
+ * @brief  Gets the current value of the system's monotonic clock.
+ * @return The value of the clock in microseconds.
+ */
+uint64_t __test_equivalence_get_time(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000 + time.tv_nsec / 1000;
+}
+
+/**
+ * @brief Adds a configuration to a verification, if it isn't part of it yet.
+ *
+ * @param equivalence   Verification to add the configuration to.
+ * @param configuration Index of the configuration in ::test_equivalence_configurations.
+ *
+ * @retval 0 Success.
+ * @retval 1 The configuration was already part of the verification.
+ */
+int __test_equivalence_add(test_equivalence_t *equivalence, size_t configuration) {
+    for (size_t i = 0; i < equivalence->nentries; ++i)
+        if (equivalence->entries[i].configuration ==
+            &test_equivalence_configurations[configuration])
+            return 1;
+
+    equivalence->entries[equivalence->nentries++] = (test_equivalence_entry_t){
+        .configuration = &test_equivalence_configurations[configuration],
+        .result        = TEST_EQUIVALENCE_RESULT_NOT_RUN,
+        .time          = 0};
+    return 0;
+}
+
+test_equivalence_t *test_equivalence_create(const char *configurations) {
+    test_equivalence_t *const equivalence = malloc(sizeof(test_equivalence_t));
+    if (!equivalence)
+        return NULL;
+    equivalence->nentries = 0;
+    equivalence->work_dir = NULL;
+    __test_equivalence_add(equivalence, 0);
+
+    for (const char *name = configurations;; name++) {
+        const size_t length = strcspn(name, ",");
+        if (length == strlen("all") && strncmp(name, "all", length) == 0) {
+            for (size_t i = 1; i < TEST_EQUIVALENCE_CONFIGURATION_COUNT; ++i)
+                __test_equivalence_add(equivalence, i);
+        } else {
+            /* The reference can't be chosen, as it's always run */
+            size_t i = 1;
+            while (i < TEST_EQUIVALENCE_CONFIGURATION_COUNT &&
+                   !(strlen(test_equivalence_configurations[i].name) == length &&
+                     strncmp(test_equivalence_configurations[i].name, name, length) == 0))
+                i++;
+
+            if (i == TEST_EQUIVALENCE_CONFIGURATION_COUNT ||
+                __test_equivalence_add(equivalence, i)) {
+                free(equivalence);
+                return NULL;
+            }
+        }
+
+        name += length;
+        if (!*name)
+            break;
+    }
+
+    return equivalence;
+}
+
+/**
+ * @brief   Executes the program again to run a configuration, in a child process.
+ * @details Sets the environment variables of the configuration, that must be set before the
+ *          program starts, and runs ::test_equivalence_run_configuration in the configuration's
+ *          directory. Never returns.
+ *
+ * @param equivalence     Verification the configuration is part of.
+ * @param configuration   Configuration to be run.
+ * @param dataset_dir     Absolute path to the directory containing the dataset.
+ * @param query_file_path Absolute path to the file containing the queries.
+ * @param nthreads        Number of threads of parallel configurations.
+ */
+void __test_equivalence_exec_configuration(const test_equivalence_t               *equivalence,
+                                           const test_equivalence_configuration_t *configuration,
+                                           char                                   *dataset_dir,
+                                           char                                   *query_file_path,
+                                           size_t                                  nthreads) {
+    char dir[PATH_MAX];
+    snprintf(dir, PATH_MAX, "%s/%s", equivalence->work_dir, configuration->name);
+    if ((mkdir(dir, 0755) && errno != EEXIST) || chdir(dir)) {
+        fprintf(stderr, "Failed to create the directory of configuration \"%s\"!\n", dir);
+        _exit(1);
+    }
+
+    const unsigned int optimizations = configuration->optimizations;
+    char               threads[32];
+    snprintf(threads,
+             sizeof(threads),
+             "%zu",
+             optimizations & TEST_EQUIVALENCE_PARALLEL ? nthreads : 1);
+    setenv(THREAD_POOL_ENVIRONMENT_VARIABLE, threads, 1);
+
+    if (optimizations & TEST_EQUIVALENCE_SIMD)
+        unsetenv(CPU_FEATURES_ENVIRONMENT_VARIABLE);
+    else
+        setenv(CPU_FEATURES_ENVIRONMENT_VARIABLE, "scalar", 1);
+
+    if (optimizations & TEST_EQUIVALENCE_SPECIALIZED)
+        unsetenv(DATASET_PARSER_GENERIC_ENVIRONMENT_VARIABLE);
+    else
+        setenv(DATASET_PARSER_GENERIC_ENVIRONMENT_VARIABLE, "1", 1);
+
+    /* Approximate or cached outputs aren't expected to be the same */
+    unsetenv(QUERY_TYPE_APPROXIMATE_ENVIRONMENT_VARIABLE);
+    unsetenv(QUERY_RESULT_CACHE_ENVIRONMENT_VARIABLE);
+
+    char executable[] = "/proc/self/exe", option[] = TEST_EQUIVALENCE_CONFIGURATION_OPTION;
+    char name[32];
+    snprintf(name, sizeof(name), "%s", configuration->name);
+
+    char *const argv[] = {executable, option, name, dataset_dir, query_file_path, NULL};
+    execv(executable, argv);
+
+    fputs("Failed to execute the program again!\n", stderr);
+    _exit(1);
+}
+
+/**
+ * @brief Runs a configuration in a child process, and waits for it to exit.
+ *
+ * @param equivalence     Verification the configuration is part of.
+ * @param entry           Configuration to be run. Its time is set.
+ * @param dataset_dir     Absolute path to the directory containing the dataset.
+ * @param query_file_path Absolute path to the file containing the queries.
+ * @param nthreads        Number of threads of parallel configurations.
+ *
+ * @retval 0 Success.
+ * @retval 1 The process couldn't be created or failed.
+ */
+int __test_equivalence_run_entry(const test_equivalence_t *equivalence,
+                                 test_equivalence_entry_t *entry,
+                                 char                     *dataset_dir,
+                                 char                     *query_file_path,
+                                 size_t                    nthreads) {
+    fflush(NULL); /* Don't let the child flush buffered IO from the parent */
+    const uint64_t start = __test_equivalence_get_time();
+    const pid_t    pid   = fork();
+    if (pid < 0)
+        return 1;
+    else if (pid == 0)
+        __test_equivalence_exec_configuration(equivalence,
+                                              entry->configuration,
+                                              dataset_dir,
+                                              query_file_path,
+                                              nthreads);
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0)
+        if (errno != EINTR)
+            return 1;
+
+    entry->time = __test_equivalence_get_time() - start;
+    return !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+/**
+ * @brief   Compares the outputs of a configuration with the reference's.
+ * @details The differences are written to `diff.txt`, in the configuration's directory.
+ *
+ * @param equivalence Verification the configuration is part of.
+ * @param entry       Configuration that was run.
+ *
+ * @return ::TEST_EQUIVALENCE_RESULT_IDENTICAL, ::TEST_EQUIVALENCE_RESULT_DIFFERENT, or
+ *         ::TEST_EQUIVALENCE_RESULT_FAILED on failure (reported to `stderr`).
+ */
+test_equivalence_result_t __test_equivalence_compare(const test_equivalence_t       *equivalence,
+                                                     const test_equivalence_entry_t *entry) {
+    const char *const name = entry->configuration->name;
+    char              results[PATH_MAX], expected[PATH_MAX], diff_path[PATH_MAX];
+    snprintf(results,
+             PATH_MAX,
+             "%s/%s/%s",
+             equivalence->work_dir,
+             name,
+             entry->configuration->optimizations & TEST_EQUIVALENCE_PACKED ? BATCH_MODE_PACK_PATH
+                                                                           : "Resultados");
+    snprintf(expected,
+             PATH_MAX,
+             "%s/%s/Resultados",
+             equivalence->work_dir,
+             test_equivalence_configurations[0].name);
+    snprintf(diff_path, PATH_MAX, "%s/%s/diff.txt", equivalence->work_dir, name);
+
+    test_diff_t *const diff = test_diff_create(results, expected);
+    if (!diff) {
+        fprintf(stderr, "Failed to compare the outputs of configuration \"%s\"!\n", name);
+        return TEST_EQUIVALENCE_RESULT_FAILED;
+    }
+
+    test_equivalence_result_t result = test_diff_has_differences(diff)
+                                           ? TEST_EQUIVALENCE_RESULT_DIFFERENT
+                                           : TEST_EQUIVALENCE_RESULT_IDENTICAL;
+
+    FILE *const diff_output = fopen(diff_path, "w");
+    if (diff_output) {
+        test_diff_output_print(diff_output, diff);
+        if (fclose(diff_output))
+            result = TEST_EQUIVALENCE_RESULT_FAILED;
+    } else {
+        result = TEST_EQUIVALENCE_RESULT_FAILED;
+    }
+
+    if (result == TEST_EQUIVALENCE_RESULT_FAILED)
+        fprintf(stderr, "Failed to write the differences of configuration \"%s\"!\n", name);
+    test_diff_free(diff);
+    return result;
+}
+
+int test_equivalence_run(test_equivalence_t *equivalence,
+                         const char         *dataset_dir,
+                         const char         *query_file_path,
+                         const char         *work_dir) {
+    if (mkdir(work_dir, 0755) && errno != EEXIST) {
+        fprintf(stderr, "Failed to create directory \"%s\"!\n", work_dir);
+        return 1;
+    }
+
+    free(equivalence->work_dir);
+    equivalence->work_dir = realpath(work_dir, NULL);
+    if (!equivalence->work_dir) {
+        fprintf(stderr, "Failed to find directory \"%s\"!\n", work_dir);
+        return 1;
+    }
+
+    /* Each configuration runs in its own directory */
+    int         retval  = 1;
+    char *const dataset = realpath(dataset_dir, NULL);
+    char *const queries = realpath(query_file_path, NULL);
+    if (!dataset || !queries) {
+        fputs("Failed to find the dataset or the query file!\n", stderr);
+        goto DEFER;
+    }
+
+    const size_t nthreads = thread_pool_get_default_thread_count();
+    for (size_t i = 0; i < equivalence->nentries; ++i) {
+        test_equivalence_entry_t *const entry = &equivalence->entries[i];
+        if (__test_equivalence_run_entry(equivalence, entry, dataset, queries, nthreads)) {
+            fprintf(stderr, "Failed to run configuration \"%s\"!\n", entry->configuration->name);
+            entry->result = TEST_EQUIVALENCE_RESULT_FAILED;
+            if (i == 0)
+                goto DEFER; /* Nothing to compare the other configurations with */
+        } else {
+            entry->result = i ? __test_equivalence_compare(equivalence, entry)
+                              : TEST_EQUIVALENCE_RESULT_IDENTICAL;
+        }
+    }
+
+    retval = 0;
+    for (size_t i = 0; i < equivalence->nentries; ++i)
+        if (equivalence->entries[i].result == TEST_EQUIVALENCE_RESULT_FAILED)
+            retval = 1;
+
+DEFER:
+    free(dataset);
+    free(queries);
+    return retval;
+}
+
+int test_equivalence_run_configuration(const char *configuration,
+                                       const char *dataset_dir,
+                                       const char *query_file_path) {
+    for (size_t i = 0; i < TEST_EQUIVALENCE_CONFIGURATION_COUNT; ++i) {
+        if (strcmp(test_equivalence_configurations[i].name, configuration))
+            continue;
+
+        if (test_equivalence_configurations[i].optimizations & TEST_EQUIVALENCE_PACKED)
+            return batch_mode_run_packed(dataset_dir, query_file_path, NULL);
+        else
+            return batch_mode_run(dataset_dir, query_file_path, NULL);
+    }
+
+    fprintf(stderr, "Unknown configuration \"%s\"!\n", configuration);
+    return 1;
+}
+
+int test_equivalence_passed(const test_equivalence_t *equivalence) {
+    for (size_t i = 0; i < equivalence->nentries; ++i)
+        if (equivalence->entries[i].result != TEST_EQUIVALENCE_RESULT_IDENTICAL)
+            return 0;
+    return 1;
+}
+
+void test_equivalence_print(FILE *output, const test_equivalence_t *equivalence) {
+    /* To know if ANSI escape codes for bold and underline can be used. */
+    const int tty = isatty(fileno(output));
+
+    if (tty)
+        fprintf(output, "\n\x1b[1;4mEQUIVALENCE VERIFICATION\x1b[22;24m\n\n");
+    else
+        fprintf(output, "\nEQUIVALENCE VERIFICATION\n\n");
+
+    table_t *const table = table_create(4, equivalence->nentries + 1);
+    if (!table) {
+        fputs("Failed to allocate table!\n", output);
+        return;
+    }
+
+    const char *const results[] = {"Not run", "Identical", "Different outputs", "Failed"};
+
+    table_insert_format(table, 0, 0, "Configuration");
+    table_insert_format(table, 1, 0, "Result");
+    table_insert_format(table, 2, 0, "Time");
+    table_insert_format(table, 3, 0, "Speedup");
+
+    const test_equivalence_entry_t *const reference = &equivalence->entries[0];
+    size_t                                identical = 0;
+    for (size_t i = 0; i < equivalence->nentries; ++i) {
+        const test_equivalence_entry_t *const entry = &equivalence->entries[i];
+        identical += i && entry->result == TEST_EQUIVALENCE_RESULT_IDENTICAL;
+
+        table_insert_format(table, 0, i + 1, "%s", entry->configuration->name);
+        if (i == 0 && entry->result == TEST_EQUIVALENCE_RESULT_IDENTICAL)
+            table_insert_format(table, 1, i + 1, "Reference");
+        else
+            table_insert_format(table, 1, i + 1, "%s", results[entry->result]);
+
+        if (entry->time) {
+            table_insert_format(table, 2, i + 1, "%.2lf ms", entry->time / 1000.0);
+            table_insert_format(table,
+                                3,
+                                i + 1,
+                                "%.2lfx",
+                                (double) reference->time / (double) entry->time);
+        } else {
+            table_insert_format(table, 2, i + 1, "-");
+            table_insert_format(table, 3, i + 1, "-");
+        }
+    }
+
+    table_draw(output, table);
+    table_free(table);
+    fprintf(output,
+            "\n%zu of %zu configurations gave the same outputs as the reference. Outputs and "
+            "differences of each configuration are in %s/<configuration>.\n",
+            identical,
+            equivalence->nentries - 1,
+            equivalence->work_dir ? equivalence->work_dir : "-");
+}
+
+void test_equivalence_free(test_equivalence_t *equivalence) {
+    if (!equivalence)
+        return;
+
+    free(equivalence->work_dir);
+    free(equivalence);
+}
@@ -0,0 +1,767 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  test_runner.c
+ * @brief Implementation of methods in include/testing/test_runner.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref test_runner_example).
+ */
+
+/** @cond FALSE */
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE /* For realpath */
+#endif
+/** @endcond */
+
+#include <dirent.h>
+#include <errno.h>
+#include <glib.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "batch_mode.h"
+#include "dataset/dataset_loader.h"
+#include "testing/performance_metrics_export.h"
+#include "testing/test_diff_output.h"
+#include "testing/test_runner.h"
+#include "utils/int_utils.h"
+#include "utils/stream_utils.h"
+#include "utils/table.h"
+#include "utils/thread_pool.h"
+
+/** @brief Exit status of a scenario's process when its outputs aren't the expected ones. */
+#define TEST_RUNNER_EXIT_WRONG 2
+
+/** @brief Outcome of running a test scenario. */
+typedef enum {
+    TEST_RUNNER_RESULT_NOT_RUN, /**< The scenario hasn't been run yet. */
+    TEST_RUNNER_RESULT_PASSED,  /**< All outputs are the expected ones. */
+    TEST_RUNNER_RESULT_WRONG,   /**< Some outputs are extra, missing or different. */
+    TEST_RUNNER_RESULT_FAILED   /**< The scenario failed to run. */
+} test_runner_result_t;
+
+/** @brief Names of each ::test_runner_result_t, for exports. */
+const char *const test_runner_result_names[] = {"not_run", "passed", "wrong", "failed"};
+
+/**
+ * @struct test_runner_scenario_t
+ * @brief  A test scenario from a manifest.
+ *
+ * @var test_runner_scenario_t::name
+ *     @brief Name of the scenario, also the name of its directory.
+ * @var test_runner_scenario_t::dataset
+ *     @brief Absolute path to the dataset.
+ * @var test_runner_scenario_t::queries
+ *     @brief Absolute path to the query file.
+ * @var test_runner_scenario_t::expected
+ *     @brief Absolute path to the expected output directory.
+ * @var test_runner_scenario_t::result
+ *     @brief Outcome of running the scenario.
+ * @var test_runner_scenario_t::load_time
+ *     @brief Wall-clock time (in microseconds) of loading the dataset, shared by all scenarios
+ *            with the same dataset.
+ * @var test_runner_scenario_t::run_time
+ *     @brief Wall-clock time (in microseconds) of running the queries and comparing their outputs.
+ * @var test_runner_scenario_t::start
+ *     @brief Value of ::__test_runner_get_time when the scenario's process was created.
+ * @var test_runner_scenario_t::pid
+ *     @brief Identifier of the scenario's process, while it's running.
+ */
+typedef struct {
+    char                *name, *dataset, *queries, *expected;
+    test_runner_result_t result;
+    uint64_t             load_time, run_time, start;
+    pid_t                pid;
+} test_runner_scenario_t;
+
+/**
+ * @struct test_runner
+ * @brief  Test scenarios from a manifest, and their results after being run.
+ *
+ * @var test_runner::scenarios
+ *     @brief Array of ::test_runner_scenario_t, in the order of the manifest.
+ * @var test_runner::work_dir
+ *     @brief Absolute path to the directory of the scenarios' directories, after being run.
+ */
+struct test_runner {
+    GArray *scenarios;
+    char   *work_dir;
+};
+
+/**
+ * @brief  Gets the current value of the system's monotonic clock.
+ * @return The value of the clock in microseconds.
+ */
+uint64_t __test_runner_get_time(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000 + time.tv_nsec / 1000;
+}
+
+/**
+ * @brief Frees the strings in a test scenario.
+ * @param scenario Scenario whose strings are to be freed.
+ */
+void __test_runner_scenario_free(test_runner_scenario_t *scenario) {
+    free(scenario->name);
+    free(scenario->dataset);
+    free(scenario->queries);
+    free(scenario->expected);
+}
+
+/**
+ * @brief Resolves a path in a manifest to an absolute path.
+ *
+ * @param manifest_dir Absolute path to the manifest's directory.
+ * @param path         Path in the manifest, absolute or relative to @p manifest_dir.
+ *
+ * @return A `malloc`-allocated absolute path, or `NULL` if @p path doesn't exist.
+ */
+char *__test_runner_resolve_path(const char *manifest_dir, const char *path) {
+    if (*path == '/')
+        return realpath(path, NULL);
+
+    char joined[PATH_MAX];
+    if (snprintf(joined, PATH_MAX, "%s/%s", manifest_dir, path) >= PATH_MAX)
+        return NULL;
+    return realpath(joined, NULL);
+}
+
+/**
+ * @brief  Checks if the name of a scenario can be used as the name of its directory.
+ * @param  name Name of the scenario.
+ * @return Whether @p name is non-empty, doesn't start with `.` and only contains letters, digits,
+ *         `-`, `_` and `.`.
+ */
+int __test_runner_is_valid_name(const char *name) {
+    if (!*name || *name == '.')
+        return 0;
+
+    for (const char *c = name; *c; ++c)
+        if (!g_ascii_isalnum(*c) && *c != '-' && *c != '_' && *c != '.')
+            return 0;
+    return 1;
+}
+
+/**
+ * @brief Parses a line of a manifest, adding its scenario to a runner.
+ *
+ * @param runner       Runner to add the scenario to.
+ * @param manifest_dir Absolute path to the manifest's directory.
+ * @param line         Line to be parsed, without its line terminator. Modified while parsing.
+ * @param line_number  Number of @p line, for error messages.
+ *
+ * @retval 0 Success.
+ * @retval 1 Invalid line (reported to `stderr`).
+ */
+int __test_runner_parse_line(test_runner_t *runner,
+                             const char    *manifest_dir,
+                             char          *line,
+                             size_t         line_number) {
+    char  *fields[4], *field = line;
+    size_t nfields = 0;
+    for (; field && nfields < 4; ++nfields) {
+        fields[nfields]       = field;
+        char *const separator = strchr(field, ';');
+        if (separator)
+            *separator = '\0';
+        field = separator ? separator + 1 : NULL;
+    }
+
+    if (nfields != 4 || field) {
+        fprintf(stderr, "Line %zu of the manifest doesn't have 4 fields!\n", line_number);
+        return 1;
+    }
+
+    if (!__test_runner_is_valid_name(fields[0])) {
+        fprintf(stderr, "Invalid scenario name in line %zu of the manifest!\n", line_number);
+        return 1;
+    }
+    for (size_t i = 0; i < runner->scenarios->len; ++i) {
+        const test_runner_scenario_t *const other =
+            &g_array_index(runner->scenarios, test_runner_scenario_t, i);
+        if (strcmp(other->name, fields[0]) == 0) {
+            fprintf(stderr, "Repeated scenario name in line %zu of the manifest!\n", line_number);
+            return 1;
+        }
+    }
+
+    test_runner_scenario_t scenario = {
+        .name      = strdup(fields[0]),
+        .dataset   = __test_runner_resolve_path(manifest_dir, fields[1]),
+        .queries   = __test_runner_resolve_path(manifest_dir, fields[2]),
+        .expected  = __test_runner_resolve_path(manifest_dir, fields[3]),
+        .result    = TEST_RUNNER_RESULT_NOT_RUN,
+        .load_time = 0,
+        .run_time  = 0,
+        .start     = 0,
+        .pid       = 0};
+
+    if (!scenario.name || !scenario.dataset || !scenario.queries || !scenario.expected) {
+        fprintf(stderr,
+                "A path in line %zu of the manifest doesn't exist (or out of memory)!\n",
+                line_number);
+        __test_runner_scenario_free(&scenario);
+        return 1;
+    }
+
+    g_array_append_val(runner->scenarios, scenario);
+    return 0;
+}
+
+test_runner_t *test_runner_create(const char *manifest_path) {
+    char *const manifest_dir = realpath(manifest_path, NULL);
+    if (!manifest_dir) {
+        fprintf(stderr, "Failed to find manifest \"%s\"!\n", manifest_path);
+        return NULL;
+    }
+    *strrchr(manifest_dir, '/') = '\0'; /* Absolute paths always have a slash */
+
+    FILE *const manifest = fopen(manifest_path, "r");
+    if (!manifest) {
+        fprintf(stderr, "Failed to open manifest \"%s\"!\n", manifest_path);
+        free(manifest_dir);
+        return NULL;
+    }
+
+    test_runner_t *runner = malloc(sizeof(test_runner_t));
+    if (!runner) {
+        fputs("Failed to allocate test runner!\n", stderr);
+        goto DEFER_1;
+    }
+    runner->scenarios = g_array_new(FALSE, FALSE, sizeof(test_runner_scenario_t));
+    runner->work_dir  = NULL;
+
+    char   *line     = NULL;
+    size_t  capacity = 0, line_number = 0;
+    ssize_t length;
+    while ((length = getline(&line, &capacity, manifest)) >= 0) {
+        line_number++;
+        while (length && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+            line[--length] = '\0';
+        if (!length || *line == '#')
+            continue;
+
+        if (__test_runner_parse_line(runner, manifest_dir, line, line_number)) {
+            test_runner_free(runner);
+            runner = NULL;
+            goto DEFER_2;
+        }
+    }
+
+    if (!runner->scenarios->len) {
+        fputs("The manifest has no scenarios!\n", stderr);
+        test_runner_free(runner);
+        runner = NULL;
+    }
+
+DEFER_2:
+    free(line);
+DEFER_1:
+    fclose(manifest);
+    free(manifest_dir);
+    return runner;
+}
+
+/**
+ * @brief   Places the error files of a dataset in the output directory of a scenario.
+ * @details The files are hard links to the originals when possible, and copies otherwise, as error
+ *          files are only written once for all scenarios with the same dataset.
+ *
+ * @param errors_dir Directory the dataset's error files were written to.
+ *
+ * @retval 0 Success.
+ * @retval 1 File IO failure.
+ */
+int __test_runner_link_error_files(const char *errors_dir) {
+    DIR *const dir = opendir(errors_dir);
+    if (!dir)
+        return errno != ENOENT; /* No error files */
+
+    int            retval = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+
+        char source[PATH_MAX], destination[PATH_MAX];
+        snprintf(source, PATH_MAX, "%s/%s", errors_dir, entry->d_name);
+        snprintf(destination, PATH_MAX, "Resultados/%s", entry->d_name);
+
+        unlink(destination); /* Files from previous runs must be replaced */
+        if (link(source, destination) && stream_copy_file(source, destination))
+            retval = 1;
+    }
+
+    closedir(dir);
+    return retval;
+}
+
+/**
+ * @brief Exports performance metrics and test results to a file in the current directory.
+ *
+ * @param path        Path to the file to be created.
+ * @param metrics     Performance metrics to be exported.
+ * @param diff        Differences between generated and expected output.
+ * @param export_func ::performance_metrics_export_json or ::performance_metrics_export_csv.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO failure.
+ */
+int __test_runner_export_scenario(
+    const char                  *path,
+    const performance_metrics_t *metrics,
+    const test_diff_t           *diff,
+    int (*export_func)(FILE *, const performance_metrics_t *, const test_diff_t *)) {
+
+    FILE *const file = fopen(path, "w");
+    if (!file)
+        return 1;
+
+    int retval = export_func(file, metrics, diff);
+    if (fclose(file))
+        retval = 1;
+    return retval;
+}
+
+/**
+ * @brief   Runs the queries of a scenario, in its own directory, and compares their outputs.
+ * @details Runs in the scenario's process, whose working directory is changed. Outputs are written
+ *          to `Resultados`, and the performance metrics (`metrics.json` and `metrics.csv`) and the
+ *          differences to the expected outputs (`diff.txt`) next to it.
+ *
+ * @param runner     Runner the scenario is part of.
+ * @param scenario   Scenario to be run.
+ * @param database   Database with the scenario's dataset.
+ * @param metrics    Performance metrics of loading the dataset, where query metrics are added to.
+ * @param errors_dir Directory the dataset's error files were written to.
+ * @param nthreads   Number of threads the scenario can use.
+ *
+ * @return `0` if the outputs are the expected ones, ::TEST_RUNNER_EXIT_WRONG if they aren't, and
+ *         `1` on failure (reported to `stderr`).
+ */
+int __test_runner_run_scenario(const test_runner_t          *runner,
+                               const test_runner_scenario_t *scenario,
+                               const database_t             *database,
+                               performance_metrics_t        *metrics,
+                               const char                   *errors_dir,
+                               size_t                        nthreads) {
+    char dir[PATH_MAX];
+    snprintf(dir, PATH_MAX, "%s/%s", runner->work_dir, scenario->name);
+    if ((mkdir(dir, 0755) && errno != EEXIST) || chdir(dir)) {
+        fprintf(stderr, "Failed to create the directory of scenario \"%s\"!\n", scenario->name);
+        return 1;
+    }
+
+    thread_pool_set_default_thread_count(nthreads);
+    if (batch_mode_run_loaded(database, scenario->queries, metrics))
+        return 1;
+    performance_metrics_measure_whole_program(metrics);
+
+    if (__test_runner_link_error_files(errors_dir)) {
+        fprintf(stderr, "Failed to write the error files of scenario \"%s\"!\n", scenario->name);
+        return 1;
+    }
+
+    test_diff_t *const diff = test_diff_create("Resultados", scenario->expected);
+    if (!diff) {
+        fprintf(stderr, "Failed to compare the results of scenario \"%s\"!\n", scenario->name);
+        return 1;
+    }
+
+    int         retval      = test_diff_has_differences(diff) ? TEST_RUNNER_EXIT_WRONG : 0;
+    FILE *const diff_output = fopen("diff.txt", "w");
+    if (diff_output) {
+        test_diff_output_print(diff_output, diff);
+        if (fclose(diff_output))
+            retval = 1;
+    } else {
+        retval = 1;
+    }
+
+    if (__test_runner_export_scenario("metrics.json",
+                                      metrics,
+                                      diff,
+                                      performance_metrics_export_json) ||
+        __test_runner_export_scenario("metrics.csv",
+                                      metrics,
+                                      diff,
+                                      performance_metrics_export_csv))
+        retval = 1;
+
+    if (retval == 1)
+        fprintf(stderr, "Failed to write the results of scenario \"%s\"!\n", scenario->name);
+    test_diff_free(diff);
+    return retval;
+}
+
+/**
+ * @brief   Runs a scenario in a child process.
+ * @details See ::__test_runner_run_scenario. The child process never returns from this function.
+ *
+ * @param runner     Runner the scenario is part of.
+ * @param scenario   Scenario to be run. Its start time and process identifier are set.
+ * @param database   Database with the scenario's dataset. Shared with the child through
+ *                   copy-on-write pages.
+ * @param metrics    Performance metrics of loading the dataset.
+ * @param errors_dir Directory the dataset's error files were written to.
+ * @param nthreads   Number of threads the scenario can use.
+ *
+ * @retval 0 Success.
+ * @retval 1 The process couldn't be created.
+ */
+int __test_runner_fork_scenario(const test_runner_t    *runner,
+                                test_runner_scenario_t *scenario,
+                                const database_t       *database,
+                                performance_metrics_t  *metrics,
+                                const char             *errors_dir,
+                                size_t                  nthreads) {
+    fflush(NULL); /* Don't let the child flush buffered IO from the parent */
+    scenario->start = __test_runner_get_time();
+    scenario->pid   = fork();
+    if (scenario->pid > 0)
+        return 0;
+    else if (scenario->pid < 0)
+        return 1;
+
+    const int retval =
+        __test_runner_run_scenario(runner, scenario, database, metrics, errors_dir, nthreads);
+    fflush(NULL);
+    _exit(retval); /* Don't free the database, as that would touch (and copy) all its pages */
+}
+
+/**
+ * @brief Waits for any scenario's process to exit, and registers its result.
+ * @param runner Runner with the scenarios being run.
+ */
+void __test_runner_wait_any(test_runner_t *runner) {
+    int   status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, 0)) < 0)
+        if (errno != EINTR)
+            return;
+
+    for (size_t i = 0; i < runner->scenarios->len; ++i) {
+        test_runner_scenario_t *const scenario =
+            &g_array_index(runner->scenarios, test_runner_scenario_t, i);
+        if (scenario->pid != pid)
+            continue;
+
+        scenario->run_time = __test_runner_get_time() - scenario->start;
+        scenario->pid      = 0;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+            scenario->result = TEST_RUNNER_RESULT_PASSED;
+        else if (WIFEXITED(status) && WEXITSTATUS(status) == TEST_RUNNER_EXIT_WRONG)
+            scenario->result = TEST_RUNNER_RESULT_WRONG;
+        else
+            scenario->result = TEST_RUNNER_RESULT_FAILED;
+        return;
+    }
+}
+
+/**
+ * @brief   Loads a dataset and runs all scenarios that use it.
+ * @details Error files are written to `<work directory>/.errors-<first>`, that no scenario can be
+ *          named after.
+ *
+ * @param runner     Runner with the scenarios to be run.
+ * @param first      Index of the first scenario with the dataset.
+ * @param jobs       Maximum number of scenarios running at the same time.
+ * @param query_mode How to measure query executions.
+ * @param sampling   Sampling interval of query executions.
+ *
+ * @retval 0 Every scenario was run.
+ * @retval 1 The dataset failed to load, or a scenario failed to run.
+ */
+int __test_runner_run_dataset(test_runner_t                   *runner,
+                              size_t                           first,
+                              size_t                           jobs,
+                              performance_metrics_query_mode_t query_mode,
+                              size_t                           sampling) {
+    const char *const dataset =
+        g_array_index(runner->scenarios, test_runner_scenario_t, first).dataset;
+
+    size_t nscenarios = 0;
+    for (size_t i = first; i < runner->scenarios->len; ++i) {
+        const test_runner_scenario_t *const scenario =
+            &g_array_index(runner->scenarios, test_runner_scenario_t, i);
+        nscenarios += strcmp(scenario->dataset, dataset) == 0;
+    }
+
+    char errors_dir[PATH_MAX];
+    snprintf(errors_dir, PATH_MAX, "%s/.errors-%zu", runner->work_dir, first);
+
+    int                          retval   = 1;
+    performance_metrics_t *const metrics  = performance_metrics_create();
+    database_t *const            database = database_create();
+    if (!metrics || !database) {
+        fputs("Failed to allocate database and performance metrics!\n", stderr);
+        goto DEFER;
+    }
+    performance_metrics_set_query_sampling(metrics, query_mode, sampling);
+    performance_metrics_measure_query_overhead(metrics);
+
+    const uint64_t start = __test_runner_get_time();
+    if (dataset_loader_load(database, dataset, errors_dir, metrics, NULL)) {
+        fprintf(stderr, "Failed to load dataset \"%s\"!\n", dataset);
+        goto DEFER;
+    }
+    const uint64_t load_time = __test_runner_get_time() - start;
+
+    /* The default number of threads is split among the scenarios running at the same time */
+    const size_t running_max = min(jobs, nscenarios);
+    const size_t nthreads    = max(thread_pool_get_default_thread_count() / running_max, 1);
+
+    retval         = 0;
+    size_t running = 0;
+    for (size_t i = first; i < runner->scenarios->len; ++i) {
+        test_runner_scenario_t *const scenario =
+            &g_array_index(runner->scenarios, test_runner_scenario_t, i);
+        if (strcmp(scenario->dataset, dataset))
+            continue;
+
+        if (running == running_max) {
+            __test_runner_wait_any(runner);
+            running--;
+        }
+
+        scenario->load_time = load_time;
+        const int failed =
+            __test_runner_fork_scenario(runner, scenario, database, metrics, errors_dir, nthreads);
+        if (failed) {
+            fprintf(stderr, "Failed to start scenario \"%s\"!\n", scenario->name);
+            scenario->result = TEST_RUNNER_RESULT_FAILED;
+        } else {
+            running++;
+        }
+    }
+    for (; running; --running)
+        __test_runner_wait_any(runner);
+
+DEFER:
+    for (size_t i = first; i < runner->scenarios->len; ++i) {
+        test_runner_scenario_t *const scenario =
+            &g_array_index(runner->scenarios, test_runner_scenario_t, i);
+        if (strcmp(scenario->dataset, dataset))
+            continue;
+
+        if (scenario->result == TEST_RUNNER_RESULT_NOT_RUN)
+            scenario->result = TEST_RUNNER_RESULT_FAILED;
+        if (scenario->result == TEST_RUNNER_RESULT_FAILED)
+            retval = 1;
+    }
+
+    if (database)
+        database_free(database);
+    if (metrics)
+        performance_metrics_free(metrics);
+    return retval;
+}
+
+int test_runner_run(test_runner_t                   *runner,
+                    const char                      *work_dir,
+                    size_t                           jobs,
+                    performance_metrics_query_mode_t query_mode,
+                    size_t                           sampling) {
+    if (mkdir(work_dir, 0755) && errno != EEXIST) {
+        fprintf(stderr, "Failed to create directory \"%s\"!\n", work_dir);
+        return 1;
+    }
+
+    free(runner->work_dir);
+    runner->work_dir = realpath(work_dir, NULL);
+    if (!runner->work_dir) {
+        fprintf(stderr, "Failed to find directory \"%s\"!\n", work_dir);
+        return 1;
+    }
+
+    int retval = 0;
+    for (size_t i = 0; i < runner->scenarios->len; ++i) {
+        /* Scenarios already run with a previous one with the same dataset */
+        if (g_array_index(runner->scenarios, test_runner_scenario_t, i).result !=
+            TEST_RUNNER_RESULT_NOT_RUN)
+            continue;
+
+        if (__test_runner_run_dataset(runner, i, jobs, query_mode, sampling))
+            retval = 1;
+    }
+    return retval;
+}
+
+int test_runner_passed(const test_runner_t *runner) {
+    for (size_t i = 0; i < runner->scenarios->len; ++i)
+        if (g_array_index(runner->scenarios, test_runner_scenario_t, i).result !=
+            TEST_RUNNER_RESULT_PASSED)
+            return 0;
+    return 1;
+}
+
+void test_runner_print(FILE *output, const test_runner_t *runner) {
+    /* To know if ANSI escape codes for bold and underline can be used. */
+    const int tty = isatty(fileno(output));
+
+    if (tty)
+        fprintf(output, "\n\x1b[1;4mTEST SCENARIOS\x1b[22;24m\n\n");
+    else
+        fprintf(output, "\nTEST SCENARIOS\n\n");
+
+    table_t *const table = table_create(4, runner->scenarios->len + 1);
+    if (!table) {
+        fputs("Failed to allocate table!\n", output);
+        return;
+    }
+
+    const char *const results[] = {"Not run", "Passed", "Wrong outputs", "Failed"};
+
+    table_insert_format(table, 0, 0, "Scenario");
+    table_insert_format(table, 1, 0, "Result");
+    table_insert_format(table, 2, 0, "Dataset loading");
+    table_insert_format(table, 3, 0, "Queries and diff");
+
+    size_t passed = 0;
+    for (size_t i = 0; i < runner->scenarios->len; ++i) {
+        const test_runner_scenario_t *const scenario =
+            &g_array_index(runner->scenarios, test_runner_scenario_t, i);
+        passed += scenario->result == TEST_RUNNER_RESULT_PASSED;
+
+        table_insert_format(table, 0, i + 1, "%s", scenario->name);
+        table_insert_format(table, 1, i + 1, "%s", results[scenario->result]);
+        table_insert_format(table, 2, i + 1, "%.2lf ms", scenario->load_time / 1000.0);
+        table_insert_format(table, 3, i + 1, "%.2lf ms", scenario->run_time / 1000.0);
+    }
+
+    table_draw(output, table);
+    table_free(table);
+    fprintf(output,
+            "\n%zu of %zu scenarios passed. Outputs, differences and metrics of each scenario are "
+            "in %s/<scenario>.\nDatasets are loaded once for all scenarios using them.\n",
+            passed,
+            (size_t) runner->scenarios->len,
+            runner->work_dir ? runner->work_dir : "-");
+}
+
+/**
+ * @brief Opens a file in a scenario's directory, for reading.
+ *
+ * @param runner   Runner whose scenarios were run.
+ * @param scenario Scenario whose directory the file is in.
+ * @param name     Name of the file.
+ *
+ * @return The opened file, or `NULL` if the scenario failed or on IO failure.
+ */
+FILE *__test_runner_open_result(const test_runner_t          *runner,
+                                const test_runner_scenario_t *scenario,
+                                const char                   *name) {
+    if (!runner->work_dir || scenario->result == TEST_RUNNER_RESULT_FAILED ||
+        scenario->result == TEST_RUNNER_RESULT_NOT_RUN)
+        return NULL;
+
+    char path[PATH_MAX];
+    snprintf(path, PATH_MAX, "%s/%s/%s", runner->work_dir, scenario->name, name);
+    return fopen(path, "r");
+}
+
+int test_runner_export_json(FILE *output, const test_runner_t *runner) {
+    fprintf(output,
+            "{\n  \"schema_version\": %d,\n"
+            "  \"build\": {\"type\": \"%s\", \"revision\": \"%s\"},\n"
+            "  \"scenarios\": [",
+            PERFORMANCE_METRICS_EXPORT_SCHEMA_VERSION,
+            performance_metrics_export_get_build_type(),
+            performance_metrics_export_get_revision());
+
+    for (size_t i = 0; i < runner->scenarios->len; ++i) {
+        const test_runner_scenario_t *const scenario =
+            &g_array_index(runner->scenarios, test_runner_scenario_t, i);
+
+        /* Names only have characters that don't need to be escaped */
+        fprintf(output,
+                "%s\n    {\"name\": \"%s\", \"result\": \"%s\", \"load_time_us\": %" PRIu64
+                ", \"run_time_us\": %" PRIu64 ", \"metrics\": ",
+                i ? "," : "",
+                scenario->name,
+                test_runner_result_names[scenario->result],
+                scenario->load_time,
+                scenario->run_time);
+
+        FILE *const metrics = __test_runner_open_result(runner, scenario, "metrics.json");
+        if (metrics) {
+            int c;
+            while ((c = fgetc(metrics)) != EOF)
+                fputc(c, output);
+            fclose(metrics);
+        } else {
+            fputs("null", output);
+        }
+        fputc('}', output);
+    }
+    fputs("\n  ]\n}\n", output);
+
+    return ferror(output) ? 1 : 0;
+}
+
+int test_runner_export_csv(FILE *output, const test_runner_t *runner) {
+    char  *line     = NULL;
+    size_t capacity = 0;
+    int    header   = 0;
+
+    for (size_t i = 0; i < runner->scenarios->len; ++i) {
+        const test_runner_scenario_t *const scenario =
+            &g_array_index(runner->scenarios, test_runner_scenario_t, i);
+        FILE *const metrics = __test_runner_open_result(runner, scenario, "metrics.csv");
+        if (!metrics)
+            continue;
+
+        /* The header of every scenario's table is the same */
+        for (size_t j = 0; getline(&line, &capacity, metrics) >= 0; ++j) {
+            if (j == 0) {
+                if (!header)
+                    fprintf(output, "scenario,result,%s", line);
+                header = 1;
+            } else {
+                fprintf(output,
+                        "%s,%s,%s",
+                        scenario->name,
+                        test_runner_result_names[scenario->result],
+                        line);
+            }
+        }
+        fclose(metrics);
+    }
+
+    free(line);
+    return ferror(output) ? 1 : 0;
+}
+
+void test_runner_free(test_runner_t *runner) {
+    if (!runner)
+        return;
+
+    for (size_t i = 0; i < runner->scenarios->len; ++i)
+        __test_runner_scenario_free(&g_array_index(runner->scenarios, test_runner_scenario_t, i));
+    g_array_unref(runner->scenarios);
+    free(runner->work_dir);
+    free(runner);
+}
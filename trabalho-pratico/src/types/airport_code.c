@@ -22,31 +22,30 @@
  * See [the header file's documentation](@ref airport_code_examples).
  */
 
-#include "types/airport_code.h"
+#include <string.h>
 
-/**
- * @brief   Macro implementation of `isalpha` (for inlining).
- * @details See musl's implementation of `isalpha` for source.
- */
-#define inline_isalpha(c) ((((unsigned) (c) | 32) - 'a') < 26)
+#include "types/airport_code.h"
+#include "utils/character_class.h"
 
 int airport_code_from_string(airport_code_t *output, const char *input) {
-    if (input[0] && input[1] && input[2] && !input[3]) { /* inline strlen(input) == 3 */
-        if (inline_isalpha(input[0]) && inline_isalpha(input[1]) && inline_isalpha(input[2])) {
-
-            /*
-             * "Vectorized" toupper, when we're certain all characters are letters.
-             * In musl's implementation of toupper, c & 0x5f is done.
-             *
-             * Why do this? Because I have a test about vectorization tomorrow and want to study.
-             */
+    /* Short-circuiting keeps reads from going past the end of the string */
+    if ((character_class_get(input[0]) & CHARACTER_CLASS_LETTER) &&
+        (character_class_get(input[1]) & CHARACTER_CLASS_LETTER) &&
+        (character_class_get(input[2]) & CHARACTER_CLASS_LETTER) && !input[3]) {
+
+        /*
+         * "Vectorized" toupper, when we're certain all characters are letters: all letters are
+         * upper-cased with a single mask, that also keeps the null terminator. In musl's
+         * implementation of toupper, c & 0x5f is done.
+         */
+        airport_code_t packed;
+        memcpy(&packed, input, sizeof(airport_code_t));
 #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
-            *output = (*(const int32_t *) input) & 0x5f5f5f00;
+        *output = packed & 0x5f5f5f00;
 #else
-            *output = (*(const int32_t *) input) & 0x005f5f5f;
+        *output = packed & 0x005f5f5f;
 #endif
-            return 0;
-        }
+        return 0;
     }
     return 1;
 }
@@ -54,3 +53,20 @@ int airport_code_from_string(airport_code_t *output, const char *input) {
 void airport_code_sprintf(char *output, airport_code_t airport) {
     *((airport_code_t *) output) = airport;
 }
+
+size_t airport_code_to_index(airport_code_t airport) {
+    char str[AIRPORT_CODE_SPRINTF_MIN_BUFFER_SIZE];
+    airport_code_sprintf(str, airport);
+    return ((size_t) (str[0] - 'A') * 26 + (size_t) (str[1] - 'A')) * 26 + (size_t) (str[2] - 'A');
+}
+
+airport_code_t airport_code_from_index(size_t index) {
+    const char str[AIRPORT_CODE_SPRINTF_MIN_BUFFER_SIZE] = {(char) ('A' + index / (26 * 26)),
+                                                            (char) ('A' + index / 26 % 26),
+                                                            (char) ('A' + index % 26),
+                                                            '\0'};
+
+    airport_code_t airport;
+    memcpy(&airport, str, sizeof(airport_code_t));
+    return airport;
+}
@@ -22,27 +22,24 @@
  * See [the header file's documentation](@ref country_code_examples).
  */
 
-#include "types/country_code.h"
+#include <string.h>
 
-/**
- * @brief   Macro implementation of `isalpha` (for inlining).
- * @details See musl's implementation of `isalpha` for source.
- */
-#define inline_isalpha(c) ((((unsigned) c | 32) - 'a') < 26)
+#include "types/country_code.h"
+#include "utils/character_class.h"
 
 int country_code_from_string(country_code_t *output, const char *input) {
-    if (input[0] && input[1] && !input[2]) { /* inline strlen(input) == 2 */
-        if (inline_isalpha(input[0]) && inline_isalpha(input[1])) {
-
-            /*
-             * "Vectorized" toupper, when all characters are certain to be letters.
-             * In musl's implementation of toupper, c & 0x5f is done.
-             *
-             * Why do this? Because I have a test about vectorization tomorrow and want to study.
-             */
-            *output = *(const country_code_t *) input & 0x5f5f;
-            return 0;
-        }
+    /* Short-circuiting keeps reads from going past the end of the string */
+    if ((character_class_get(input[0]) & CHARACTER_CLASS_LETTER) &&
+        (character_class_get(input[1]) & CHARACTER_CLASS_LETTER) && !input[2]) {
+
+        /*
+         * "Vectorized" toupper, when all characters are certain to be letters: both letters are
+         * upper-cased with a single mask. In musl's implementation of toupper, c & 0x5f is done.
+         */
+        country_code_t packed;
+        memcpy(&packed, input, sizeof(country_code_t));
+        *output = packed & 0x5f5f;
+        return 0;
     }
     return 1;
 }
@@ -51,3 +48,17 @@ void country_code_sprintf(char *output, country_code_t country) {
     *((country_code_t *) output) = country;
     output[2]                    = '\0';
 }
+
+size_t country_code_to_index(country_code_t country) {
+    char str[COUNTRY_CODE_SPRINTF_MIN_BUFFER_SIZE];
+    country_code_sprintf(str, country);
+    return (size_t) (str[0] - 'A') * 26 + (size_t) (str[1] - 'A');
+}
+
+country_code_t country_code_from_index(size_t index) {
+    const char str[2] = {(char) ('A' + index / 26), (char) ('A' + index % 26)};
+
+    country_code_t country;
+    memcpy(&country, str, sizeof(country_code_t));
+    return country;
+}
@@ -22,98 +22,48 @@
  * See [the header file's documentation](@ref email_examples).
  */
 
-#include <stdlib.h>
-#include <string.h>
-
 #include "types/email.h"
-#include "utils/fixed_n_delimiter_parser.h"
+#include "utils/character_class.h"
 
 /**
- * @brief   Grammar for validating emails.
- * @details Shall not be modified apart from its creation. It's not constant because it requires
- *          run-time initialization. This global variable is justified for the following reasons:
+ * @brief Skips over a part of an email, stopping at the first separator or at the string's end.
  *
- *          -# It's not modified (no mutable global state);
- *          -# It's module-local (no breaking of encapsulation);
- *          -# Helps performance, as a new grammar doesn't need to be generated for every email to
- *             be validated.
- */
-fixed_n_delimiter_parser_grammar_t *__email_grammar = NULL;
-
-/**
- * @brief   Grammar for validating email domains.
- * @details Shall not be modified apart from its creation. It's not constant because it requires
- *          run-time initialization. This global variable is justified for the following reasons:
+ * @param input Start of the part of the email.
  *
- *          -# It's not modified (no mutable global state);
- *          -# It's module-local (no breaking of encapsulation);
- *          -# Helps performance, as a new grammar doesn't need to be generated for every email to
- *             be validated.
- */
-fixed_n_delimiter_parser_grammar_t *__email_domain_grammar = NULL;
-
-/** @brief Auxiliary method for ::email_validate_string. Validates the username in an email. */
-int __email_validate_username(void *user_data, char *token, size_t ntoken) {
-    (void) user_data;
-    (void) ntoken;
-    return (*token == '\0'); /* Fail on empty string */
-}
-
-/** @brief Auxiliary method for ::__email_validate_domain. Validates the name of an email's domain. */
-int __email_validate_domain_name(void *user_data, char *token, size_t ntoken) {
-    (void) user_data;
-    (void) ntoken;
-    return (*token == '\0'); /* Fail on empty string */
-}
-
-/** @brief Auxiliary method for ::__email_validate_domain. Validates the TLD in an email's domain. */
-int __email_validate_domain_tld(void *user_data, char *token, size_t ntoken) {
-    (void) user_data;
-    (void) ntoken;
-    return (strlen(token) < 2);
-}
-
-/** @brief Auxiliary method for ::email_validate_string. Validates a domain in an email. */
-int __email_validate_domain(void *user_data, char *token, size_t ntoken) {
-    (void) user_data;
-    (void) ntoken;
-    return fixed_n_delimiter_parser_parse_string(token, __email_domain_grammar, NULL);
-}
-
-/**
- * @brief Automatically initializes ::__email_grammar and ::__email_domain_grammar when the program
- *        starts.
+ * @return A pointer to the first character in @p input that is a `'@'`, a `'.'` or `'\0'`.
  */
-void __attribute__((constructor)) __email_grammars_create(void) {
-    const fixed_n_delimiter_parser_iter_callback_t email_callbacks[2] = {__email_validate_username,
-                                                                         __email_validate_domain};
-    __email_grammar = fixed_n_delimiter_parser_grammar_new('@', 2, email_callbacks);
-
-    const fixed_n_delimiter_parser_iter_callback_t domain_callbacks[2] = {
-        __email_validate_domain_name,
-        __email_validate_domain_tld};
-    __email_domain_grammar = fixed_n_delimiter_parser_grammar_new('.', 2, domain_callbacks);
-}
-
-/**
- * @brief Automatically frees ::__email_grammar and ::__email_domain_grammar when the program
- *        terminates.
- */
-void __attribute__((destructor)) __email_grammars_free(void) {
-    fixed_n_delimiter_parser_grammar_free(__email_grammar);
-    fixed_n_delimiter_parser_grammar_free(__email_domain_grammar);
+const char *__email_skip_part(const char *input) {
+    /* A single table lookup per character, instead of three comparisons */
+    const uint8_t separators = CHARACTER_CLASS_END | CHARACTER_CLASS_AT | CHARACTER_CLASS_DOT;
+    while (!(character_class_get(*input) & separators))
+        input++;
+    return input;
 }
 
 int email_validate_string(char *input) {
-    return fixed_n_delimiter_parser_parse_string(input, __email_grammar, NULL) != 0;
+    return email_validate_string_const(input);
 }
 
 int email_validate_string_const(const char *input) {
-    char *const buffer = strdup(input);
-    if (!buffer)
+    /* Username: can't be empty, and may contain dots */
+    const char *username_end = input;
+    while (1) {
+        username_end = __email_skip_part(username_end);
+        if (*username_end != '.')
+            break;
+        username_end++;
+    }
+    if (*username_end != '@' || username_end == input)
+        return 1;
+
+    /* Domain name: can't be empty */
+    const char *const domain     = username_end + 1;
+    const char *const domain_end  = __email_skip_part(domain);
+    if (*domain_end != '.' || domain_end == domain)
         return 1;
 
-    const int retval = email_validate_string(buffer);
-    free(buffer);
-    return retval;
+    /* TLD: at least two characters long, without any more separators */
+    const char *const tld     = domain_end + 1;
+    const char *const tld_end = __email_skip_part(tld);
+    return *tld_end != '\0' || tld_end - tld < 2;
 }
@@ -32,49 +32,42 @@
  * @details Some fields in the project's requirements (such as real arrival date, pilot, copilot
  *          and notes) aren't put here, as they aren't required by any of the queries.
  *
- * @var flight::airline
- *     @brief Airline of a given flight.
- * @var flight::plane_model
- *     @brief Plane model of a given flight.
- * @var flight::origin
- *     @brief Origin airport of a given flight.
- * @var flight::destination
- *     @brief Destination airport of a given flight.
- * @var flight::id
- *     @brief Identifier of a given flight.
+ *          Fields are ordered from the most to the least frequently accessed, and so that there's
+ *          no padding. Flights don't keep track of what they own: a flight allocated in a pool
+ *          never owns itself nor its strings, while a `malloc`-allocated one owns everything.
+ *
  * @var flight::schedule_departure_date
  *     @brief Scheduled departure date of a given flight.
  * @var flight::real_departure_date
  *     @brief Real departure date of a given flight.
  * @var flight::schedule_arrival_date
  *     @brief Scheduled arrival date of a given flight.
+ * @var flight::id
+ *     @brief Identifier of a given flight.
+ * @var flight::origin
+ *     @brief Origin airport of a given flight.
+ * @var flight::destination
+ *     @brief Destination airport of a given flight.
  * @var flight::number_of_passengers
  *     @brief Number of passengers of a given flight.
  * @var flight::total_seats
  *     @brief Total number of seats of a given flight.
- * @var flight::owns_itself
- *     @brief   Whether, when `free`ing this flight, the flight pointer should be `free`'d.
- *     @details A false value means that the flight is allocated in a pool.
- * @var flight::owns_airline
- *     @brief   Whether ::flight::airline should be `free`d.
- *     @details A false value means that this string is allocated in a pool.
- * @var flight::owns_plane_model
- *     @brief   Whether ::flight::plane_model should be `free`d.
- *     @details A false value means that this string is allocated in a pool.
+ * @var flight::airline
+ *     @brief Airline of a given flight.
+ * @var flight::plane_model
+ *     @brief Plane model of a given flight.
  */
 struct flight {
-    const char     *airline;
-    const char     *plane_model;
     date_and_time_t schedule_departure_date;
     date_and_time_t real_departure_date;
     date_and_time_t schedule_arrival_date;
+    flight_id_t     id;
     airport_code_t  origin;
     airport_code_t  destination;
-    flight_id_t     id;
     uint16_t        number_of_passengers;
     uint16_t        total_seats;
-
-    int owns_itself : 1, owns_airline : 1, owns_plane_model : 1;
+    const char     *airline;
+    const char     *plane_model;
 };
 
 flight_t *flight_create(pool_t *allocator) {
@@ -83,8 +76,7 @@ flight_t *flight_create(pool_t *allocator) {
     if (!ret)
         return NULL;
 
-    ret->owns_itself  = allocator == NULL;
-    ret->owns_airline = ret->owns_plane_model = 0; /* Don't free in first setter call */
+    ret->airline = ret->plane_model = NULL; /* Don't free in first setter call */
 
     /* For first comparisons to work */
     flight_reset_schedule_dates(ret);
@@ -101,14 +93,13 @@ flight_t *flight_clone(pool_t                      *allocator,
         return NULL;
 
     memcpy(ret, flight, sizeof(flight_t));
-    ret->owns_itself  = allocator == NULL;
-    ret->owns_airline = ret->owns_plane_model = 0; /* Don't free in first setter call */
+    ret->airline = ret->plane_model = NULL; /* Don't free in first setter call */
 
     if (flight_set_airline(string_allocator, ret, flight->airline) ||
         flight_set_plane_model(string_allocator, ret, flight->plane_model)) {
 
-        if (ret->owns_itself)
-            free(ret);
+        if (!allocator)
+            flight_free(ret);
         return NULL;
     }
 
@@ -126,10 +117,9 @@ int flight_set_airline(string_pool_no_duplicates_t *allocator,
     if (!new_airline)
         return 1;
 
-    if (flight->owns_airline)
+    if (!allocator)
         /* Purposely remove const. We know it was allocated by this module */
         free((char *) (size_t) flight->airline);
-    flight->owns_airline = allocator == NULL;
 
     flight->airline = new_airline;
     return 0;
@@ -146,10 +136,9 @@ int flight_set_plane_model(string_pool_no_duplicates_t *allocator,
     if (!new_plane_model)
         return 1;
 
-    if (flight->owns_plane_model)
+    if (!allocator)
         /* Purposely remove const. We know it was allocated by this module */
         free((char *) (size_t) flight->plane_model);
-    flight->owns_plane_model = allocator == NULL;
 
     flight->plane_model = new_plane_model;
     return 0;
@@ -185,7 +174,7 @@ int flight_set_schedule_arrival_date(flight_t *flight, date_and_time_t schedule_
 
 void flight_reset_schedule_dates(flight_t *flight) {
     flight->schedule_departure_date = 0;
-    flight->schedule_arrival_date   = 0xFFFFFFFFFFFFFFFF;
+    flight->schedule_arrival_date   = DATE_AND_TIME_LATEST;
 }
 
 int flight_set_number_of_passengers(flight_t *flight, uint16_t number_of_passengers) {
@@ -266,14 +255,8 @@ void flight_invalidate(flight_t *flight) {
 }
 
 void flight_free(flight_t *flight) {
-    if (flight->owns_airline)
-        /* Purposely remove const. We know it was allocated by this module */
-        free((char *) (size_t) flight->airline);
-
-    if (flight->owns_plane_model)
-        /* Purposely remove const. We know it was allocated by this module */
-        free((char *) (size_t) flight->plane_model);
-
-    if (flight->owns_itself)
-        free(flight);
+    /* Purposely remove const. We know these were allocated by this module */
+    free((char *) (size_t) flight->airline);
+    free((char *) (size_t) flight->plane_model);
+    free(flight);
 }
@@ -32,54 +32,48 @@
  * @details Some fields in the project's requirements (such as address, room details and comments)
  *          aren't put here, as they aren't required by any of the queries.
  *
- * @var reservation::user_id
- *     @brief Identifier of the user that booked a given reservation.
- * @var reservation::hotel_name
- *     @brief Name of the hotel of a given reservation.
- * @var reservation::includes_breakfast
- *     @brief Whether or not this booling includes breakfast.
+ *          Fields are ordered from the most to the least frequently accessed, and so that there's
+ *          no padding. Reservations don't keep track of what they own: a reservation allocated in
+ *          a pool never owns itself nor its hotel name, while a `malloc`-allocated one owns
+ *          everything.
+ *
  * @var reservation::begin_date
  *     @brief The beginning date of a given reservation.
  * @var reservation::end_date
  *     @brief The end date of a given reservation.
  * @var reservation::id
  *     @brief Identifier of a given reservation.
+ * @var reservation::user_index
+ *     @brief Index of the user that booked a given reservation, in the database's
+ *            ::user_manager_t.
+ * @var reservation::hotel_id
+ *     @brief Identifier of the hotel of a given reservation.
+ * @var reservation::price_per_night
+ *     @brief Price per night of a given reservation.
  * @var reservation::rating
  *     @brief Rating of a given reservation. It's a value between 1 and 5 (inclusive), or
  *            ::RESERVATION_NO_RATING, meaning
- * @var reservation::hotel_id
- *     @brief Identifier of the hotel of a given reservation.
- * @var reservation::hotel_stars
- *     @brief Number of stars of the hotel of a given reservation.
  * @var reservation::city_tax
  *     @brief City tax of a given reservation.
- * @var reservation::price_per_night
- *     @brief Price per night of a given reservation.
- * @var reservation::owns_itself
- *     @brief   Whether, when `free`ing this reservation, the reservation pointer should be
- *              `free`'d.
- *     @details A false value means that the reservation is allocated in a pool.
- * @var reservation::owns_user_id
- *     @brief   Whether ::reservation::user_id should be `free`d.
- *     @details A false value means that this string is allocated in a pool.
- * @var reservation::owns_hotel_name
- *     @brief   Whether ::reservation::hotel_name should be `free`d.
- *     @details A false value means that this string is allocated in a pool.
+ * @var reservation::hotel_stars
+ *     @brief Number of stars of the hotel of a given reservation.
+ * @var reservation::includes_breakfast
+ *     @brief Whether or not this booling includes breakfast.
+ * @var reservation::hotel_name
+ *     @brief Name of the hotel of a given reservation.
  */
 struct reservation {
-    char                *user_id;
-    const char          *hotel_name;
     date_t               begin_date;
     date_t               end_date;
     reservation_id_t     id;
+    uint32_t             user_index;
     hotel_id_t           hotel_id;
     uint16_t             price_per_night;
-    uint8_t              city_tax;
     uint8_t              rating;
+    uint8_t              city_tax;
     uint8_t              hotel_stars;
     includes_breakfast_t includes_breakfast : 1;
-
-    int owns_itself : 1, owns_user_id : 1, owns_hotel_name : 1;
+    const char          *hotel_name;
 };
 
 reservation_t *reservation_create(pool_t *allocator) {
@@ -88,15 +82,13 @@ reservation_t *reservation_create(pool_t *allocator) {
     if (!ret)
         return NULL;
 
-    ret->owns_itself  = allocator == NULL;
-    ret->owns_user_id = ret->owns_hotel_name = 0; /* Don't free in first setter call */
-    reservation_reset_dates(ret);                 /* For first comparisons to work */
+    ret->hotel_name = NULL;       /* Don't free in first setter call */
+    reservation_reset_dates(ret); /* For first comparisons to work */
 
     return ret;
 }
 
 reservation_t *reservation_clone(pool_t                      *allocator,
-                                 string_pool_t               *user_id_allocator,
                                  string_pool_no_duplicates_t *hotel_name_allocator,
                                  const reservation_t         *reservation) {
 
@@ -105,36 +97,19 @@ reservation_t *reservation_clone(pool_t                      *allocator,
         return NULL;
 
     memcpy(ret, reservation, sizeof(reservation_t));
-    ret->owns_itself  = allocator == NULL;
-    ret->owns_user_id = ret->owns_hotel_name = 0; /* Don't free in first setter call */
+    ret->hotel_name = NULL; /* Don't free in first setter call */
 
-    if (reservation_set_user_id(user_id_allocator, ret, reservation->user_id) ||
-        reservation_set_hotel_name(hotel_name_allocator, ret, reservation->hotel_name)) {
-
-        if (ret->owns_itself)
-            free(ret);
+    if (reservation_set_hotel_name(hotel_name_allocator, ret, reservation->hotel_name)) {
+        if (!allocator)
+            reservation_free(ret);
         return NULL;
     }
 
     return ret;
 }
 
-int reservation_set_user_id(string_pool_t *allocator,
-                            reservation_t *reservation,
-                            const char    *user_id) {
-    if (!*user_id)
-        return 1;
-
-    char *const new_user_id = allocator ? string_pool_put(allocator, user_id) : strdup(user_id);
-    if (!new_user_id)
-        return 1;
-
-    if (reservation->owns_user_id)
-        free(reservation->user_id);
-    reservation->owns_user_id = allocator == NULL;
-
-    reservation->user_id = new_user_id;
-    return 0;
+void reservation_set_user_index(reservation_t *reservation, uint32_t user_index) {
+    reservation->user_index = user_index;
 }
 
 int reservation_set_hotel_name(string_pool_no_duplicates_t *allocator,
@@ -148,10 +123,9 @@ int reservation_set_hotel_name(string_pool_no_duplicates_t *allocator,
     if (!new_hotel_name)
         return 1;
 
-    if (reservation->owns_hotel_name)
+    if (!allocator)
         /* Purposely remove const. We know it was allocated by this module */
         free((char *) (size_t) reservation->hotel_name);
-    reservation->owns_hotel_name = allocator == NULL;
 
     reservation->hotel_name = new_hotel_name;
     return 0;
@@ -180,7 +154,7 @@ int reservation_set_end_date(reservation_t *reservation, date_t end_date) {
 
 void reservation_reset_dates(reservation_t *reservation) {
     reservation->begin_date = 0;
-    reservation->end_date   = 0xFFFFFFFF;
+    reservation->end_date   = DATE_LATEST;
 }
 
 void reservation_set_id(reservation_t *reservation, reservation_id_t id) {
@@ -219,8 +193,8 @@ int reservation_set_price_per_night(reservation_t *reservation, uint16_t price_p
     return 0;
 }
 
-const char *reservation_get_const_user_id(const reservation_t *reservation) {
-    return reservation->user_id;
+uint32_t reservation_get_user_index(const reservation_t *reservation) {
+    return reservation->user_index;
 }
 
 const char *reservation_get_const_hotel_name(const reservation_t *reservation) {
@@ -279,18 +253,13 @@ double reservation_calculate_hotel_profit(const reservation_t *reservation) {
     return reservation->price_per_night * date_diff(reservation->end_date, reservation->begin_date);
 }
 
-double reservation_calculate_price(const reservation_t *reservation) {
-    return reservation_calculate_hotel_profit(reservation) * (1 + 0.01 * reservation->city_tax);
+uint64_t reservation_calculate_price_cents(const reservation_t *reservation) {
+    const uint64_t nights = date_diff(reservation->end_date, reservation->begin_date);
+    return (uint64_t) reservation->price_per_night * nights * (100 + reservation->city_tax);
 }
 
 void reservation_free(reservation_t *reservation) {
-    if (reservation->owns_user_id)
-        free(reservation->user_id);
-
-    if (reservation->owns_hotel_name)
-        /* Purposely remove const. We know it was allocated by this module */
-        free((char *) (size_t) reservation->hotel_name);
-
-    if (reservation->owns_itself)
-        free(reservation);
+    /* Purposely remove const. We know it was allocated by this module */
+    free((char *) (size_t) reservation->hotel_name);
+    free(reservation);
 }
@@ -26,6 +26,30 @@
 #include <string.h>
 
 #include "types/user.h"
+#include "utils/small_string.h"
+#include "utils/utf8.h"
+
+/**
+ * @struct  user_cold_t
+ * @brief   Fields of a ::user that are rarely accessed.
+ * @details Only query 1 and database snapshots read these, so they're kept away from the fields
+ *          used in scans of all users (see ::user).
+ *
+ * @var user_cold_t::birth_date
+ *     @brief Date of birth of a given user.
+ * @var user_cold_t::country_code
+ *     @brief Code of the country of a given user.
+ * @var user_cold_t::sex
+ *     @brief Sex of a given user.
+ * @var user_cold_t::passport
+ *     @brief Passport number of a given user.
+ */
+typedef struct {
+    date_t         birth_date;
+    country_code_t country_code;
+    sex_t          sex : 1;
+    small_string_t passport;
+} user_cold_t;
 
 /**
  * @struct  user
@@ -33,74 +57,86 @@
  * @details Some fields in the project's requirements (such as emails, phone numbers, addresses
  *          and payment methods) aren't put here, as they aren't required by any of the queries.
  *
+ *          Fields are split between a hot record, with what queries that scan many users need, and
+ *          a cold one (::user_cold_t), allocated separately. That way, scans touch less memory.
+ *          Fields are ordered from the most to the least frequently accessed, and so that there's
+ *          as little padding as possible. Users don't keep track of what they own: a user allocated
+ *          in a pool never owns itself nor its strings, while a `malloc`-allocated one owns
+ *          everything.
+ *
+ *          Identifiers and passport numbers are almost always short, so they're stored in place
+ *          when possible (see ::small_string_t), instead of taking a separate allocation.
+ *
+ * @var user::account_creation_date
+ *     @brief Date of creation of a given user's account.
  * @var user::id
  *     @brief Identifier of a given user.
  * @var user::name
  *     @brief Full name of a given user.
- * @var user::birth_date
- *     @brief Date of birth of a given user.
- * @var user::sex
- *     @brief Sex of a given user.
- * @var user::passport
- *     @brief Passport number of a given user.
- * @var user::country_code
- *     @brief Code of the country of a given user.
- * @var user::account_creation_date
- *     @brief Date of creation of a given user's account.
+ * @var user::cold
+ *     @brief Fields of a given user that are rarely accessed.
  * @var user::account_status
  *     @brief Whether a user's account is active or inactive.
- * @var user::owns_itself
- *     @brief   Whether, when `free`ing this user, the user pointer should be `free`'d.
- *     @details A false value means that the user is allocated in a pool.
- * @var user::owns_id
- *     @brief   Whether ::user::id should be `free`d.
- *     @details A false value means that this string is allocated in a pool.
- * @var user::owns_name
- *     @brief   Whether ::user::name should be `free`d.
- *     @details A false value means that this string is allocated in a pool.
- * @var user::owns_passport
- *     @brief   Whether ::user::passport should be `free`d.
- *     @details A false value means that this string is allocated in a pool.
+ * @var user::name_is_ascii
+ *     @brief Whether ::user::name is made only of ASCII characters, so that it can be collated and
+ *            measured without decoding multibyte characters.
  */
 struct user {
-    char            *id;
-    char            *name;
-    char            *passport;
     date_and_time_t  account_creation_date;
-    date_t           birth_date;
-    country_code_t   country_code;
-    sex_t            sex            : 1;
+    small_string_t   id;
+    char            *name;
+    user_cold_t     *cold;
     account_status_t account_status : 1;
-
-    int owns_itself : 1, owns_id : 1, owns_name : 1, owns_passport : 1;
+    unsigned int     name_is_ascii  : 1;
 };
 
-user_t *user_create(pool_t *allocator) {
+user_t *user_create(pool_t *allocator, pool_t *cold_allocator) {
     user_t *const ret = allocator ? pool_alloc_item(user_t, allocator) : malloc(sizeof(user_t));
     if (!ret)
         return NULL;
 
-    ret->owns_itself = allocator == NULL;
-    ret->owns_id = ret->owns_name = ret->owns_passport = 0; /* Don't free in first setter call */
-    user_reset_dates(ret);                                  /* For first comparisons to work */
+    ret->cold = allocator ? pool_alloc_item(user_cold_t, cold_allocator)
+                          : malloc(sizeof(user_cold_t));
+    if (!ret->cold) {
+        if (!allocator)
+            free(ret);
+        return NULL;
+    }
+
+    /* Don't free in first setter call */
+    small_string_init(&ret->id);
+    small_string_init(&ret->cold->passport);
+    ret->name = NULL;
+
+    user_reset_dates(ret); /* For first comparisons to work */
     return ret;
 }
 
-user_t *user_clone(pool_t *allocator, string_pool_t *string_allocator, const user_t *user) {
-    user_t *const ret = user_create(allocator);
+user_t *user_clone(pool_t        *allocator,
+                   pool_t        *cold_allocator,
+                   string_pool_t *string_allocator,
+                   const user_t  *user) {
+
+    user_t *const ret = user_create(allocator, cold_allocator);
     if (!ret)
         return NULL;
 
+    user_cold_t *const cold = ret->cold;
     memcpy(ret, user, sizeof(user_t));
-    ret->owns_itself = allocator == NULL;
-    ret->owns_id = ret->owns_name = ret->owns_passport = 0; /* Don't free in first setter call */
+    memcpy(cold, user->cold, sizeof(user_cold_t));
+    ret->cold = cold;
+
+    /* Don't free in first setter call */
+    small_string_init(&ret->id);
+    small_string_init(&ret->cold->passport);
+    ret->name = NULL;
 
-    if (user_set_id(string_allocator, ret, user->id) ||
+    if (user_set_id(string_allocator, ret, small_string_get(&user->id)) ||
         user_set_name(string_allocator, ret, user->name) ||
-        user_set_passport(string_allocator, ret, user->passport)) {
+        user_set_passport(string_allocator, ret, small_string_get(&user->cold->passport))) {
 
-        if (ret->owns_itself)
-            free(ret);
+        if (!allocator)
+            user_free(ret);
         return NULL;
     }
 
@@ -111,16 +147,7 @@ int user_set_id(string_pool_t *allocator, user_t *user, const char *id) {
     if (!*id)
         return 1;
 
-    char *const new_id = allocator ? string_pool_put(allocator, id) : strdup(id);
-    if (!new_id)
-        return 1;
-
-    if (user->owns_id)
-        free(user->id);
-    user->owns_id = allocator == NULL;
-
-    user->id = new_id;
-    return 0;
+    return small_string_set(allocator, &user->id, id);
 }
 
 int user_set_name(string_pool_t *allocator, user_t *user, const char *name) {
@@ -131,11 +158,11 @@ int user_set_name(string_pool_t *allocator, user_t *user, const char *name) {
     if (!new_name)
         return 1;
 
-    if (user->owns_name)
+    if (!allocator)
         free(user->name);
-    user->owns_name = allocator == NULL;
 
-    user->name = new_name;
+    user->name          = new_name;
+    user->name_is_ascii = utf8_is_ascii(new_name, strlen(new_name));
     return 0;
 }
 
@@ -143,7 +170,7 @@ int user_set_birth_date(user_t *user, date_t birth_date) {
     if (date_diff(birth_date, date_and_time_get_date(user->account_creation_date)) > 0)
         return 1;
 
-    user->birth_date = birth_date;
+    user->cold->birth_date = birth_date;
     return 0;
 }
 
@@ -151,24 +178,15 @@ int user_set_passport(string_pool_t *allocator, user_t *user, const char *passpo
     if (!*passport)
         return 1;
 
-    char *const new_passport = allocator ? string_pool_put(allocator, passport) : strdup(passport);
-    if (!new_passport)
-        return 1;
-
-    if (user->owns_passport)
-        free(user->passport);
-    user->owns_passport = allocator == NULL;
-
-    user->passport = new_passport;
-    return 0;
+    return small_string_set(allocator, &user->cold->passport, passport);
 }
 
 void user_set_country_code(user_t *user, country_code_t country_code) {
-    user->country_code = country_code;
+    user->cold->country_code = country_code;
 }
 
 void user_set_sex(user_t *user, sex_t sex) {
-    user->sex = sex;
+    user->cold->sex = sex;
 }
 
 void user_set_account_status(user_t *user, account_status_t account_status) {
@@ -176,7 +194,7 @@ void user_set_account_status(user_t *user, account_status_t account_status) {
 }
 
 int user_set_account_creation_date(user_t *user, date_and_time_t account_creation_date) {
-    if (date_diff(user->birth_date, date_and_time_get_date(account_creation_date)) > 0)
+    if (date_diff(user->cold->birth_date, date_and_time_get_date(account_creation_date)) > 0)
         return 1;
 
     user->account_creation_date = account_creation_date;
@@ -184,32 +202,36 @@ int user_set_account_creation_date(user_t *user, date_and_time_t account_creatio
 }
 
 void user_reset_dates(user_t *user) {
-    user->birth_date            = 0;
-    user->account_creation_date = 0xFFFFFFFFFFFFFFFF;
+    user->cold->birth_date      = 0;
+    user->account_creation_date = DATE_AND_TIME_LATEST;
 }
 
 const char *user_get_const_id(const user_t *user) {
-    return user->id;
+    return small_string_get(&user->id);
 }
 
 const char *user_get_const_name(const user_t *user) {
     return user->name;
 }
 
+int user_get_name_is_ascii(const user_t *user) {
+    return user->name_is_ascii;
+}
+
 date_t user_get_birth_date(const user_t *user) {
-    return user->birth_date;
+    return user->cold->birth_date;
 }
 
 const char *user_get_const_passport(const user_t *user) {
-    return user->passport;
+    return small_string_get(&user->cold->passport);
 }
 
 country_code_t user_get_country_code(const user_t *user) {
-    return user->country_code;
+    return user->cold->country_code;
 }
 
 sex_t user_get_sex(const user_t *user) {
-    return user->sex;
+    return user->cold->sex;
 }
 
 account_status_t user_get_account_status(const user_t *user) {
@@ -224,28 +246,26 @@ size_t user_sizeof(void) {
     return sizeof(user_t);
 }
 
+size_t user_cold_sizeof(void) {
+    return sizeof(user_cold_t);
+}
+
 int user_is_valid(const user_t *user) {
-    return user->id == NULL;
+    return small_string_get(&user->id) == NULL;
 }
 
 void user_invalidate(user_t *user) {
-    if (user->owns_id)
-        free(user->id);
-    user->id = NULL;
+    small_string_init(&user->id);
 }
 
 int32_t user_calculate_age(const user_t *user) {
-    return date_diff(DATE_CURRENT, user->birth_date) / 372;
+    return date_diff(DATE_CURRENT, user->cold->birth_date) / 372;
 }
 
 void user_free(user_t *user) {
-    if (user->owns_id)
-        free(user->id);
-    if (user->owns_name)
-        free(user->name);
-    if (user->owns_passport)
-        free(user->passport);
-
-    if (user->owns_itself)
-        free(user);
+    small_string_free(&user->id);
+    free(user->name);
+    small_string_free(&user->cold->passport);
+    free(user->cold);
+    free(user);
 }
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  arena.c
+ * @brief Implementation of methods in include/utils/arena.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref arena_examples).
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/arena.h"
+#include "utils/pool.h"
+
+/**
+ * @union arena_unit_t
+ * @brief Unit of allocation in an ::arena_t, with the alignment required by all supported types.
+ *
+ * @var arena_unit_t::pointer
+ *     @brief Forces pointer alignment.
+ * @var arena_unit_t::integer
+ *     @brief Forces 64-bit integer alignment.
+ * @var arena_unit_t::floating
+ *     @brief Forces `double` alignment.
+ */
+typedef union {
+    void    *pointer;
+    uint64_t integer;
+    double   floating;
+} arena_unit_t;
+
+/**
+ * @struct arena
+ * @brief  An allocator for objects of different sizes, that are all freed at once.
+ *
+ * @var arena::units
+ *     @brief Pool of ::arena_unit_t, where each object is stored in a run of contiguous units.
+ */
+struct arena {
+    pool_t *units;
+};
+
+arena_t *arena_create(size_t block_size) {
+    arena_t *const arena = malloc(sizeof(arena_t));
+    if (!arena)
+        return NULL;
+
+    const size_t block_units = (block_size + sizeof(arena_unit_t) - 1) / sizeof(arena_unit_t);
+    arena->units             = pool_create(arena_unit_t, block_units ? block_units : 1);
+    if (!arena->units) {
+        free(arena);
+        return NULL;
+    }
+
+    return arena;
+}
+
+void *arena_allocate(arena_t *arena, size_t size) {
+    const size_t units = (size + sizeof(arena_unit_t) - 1) / sizeof(arena_unit_t);
+    return pool_alloc_items(arena_unit_t, arena->units, units ? units : 1);
+}
+
+void *arena_put(arena_t *arena, const void *data, size_t size) {
+    void *const ret = arena_allocate(arena, size);
+    if (ret)
+        memcpy(ret, data, size);
+    return ret;
+}
+
+char *arena_put_string(arena_t *arena, const char *str) {
+    return arena_put(arena, str, strlen(str) + 1);
+}
+
+void arena_get_memory_usage(const arena_t *arena, memory_usage_t *out) {
+    pool_get_memory_usage(arena->units, out);
+}
+
+void arena_free(arena_t *arena) {
+    pool_free(arena->units);
+    free(arena);
+}
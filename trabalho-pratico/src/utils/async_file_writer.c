@@ -0,0 +1,636 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  async_file_writer.c
+ * @brief Implementation of methods in include/utils/async_file_writer.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref async_file_writer_examples).
+ */
+
+/** @cond FALSE */
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE /* For syscall */
+#endif
+/** @endcond */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "utils/async_file_writer.h"
+
+/** @brief Operation whose completion is reported by an `io_uring` completion queue entry. */
+typedef enum {
+    ASYNC_FILE_WRITER_OP_OPEN,  /**< @brief File creation. */
+    ASYNC_FILE_WRITER_OP_WRITE, /**< @brief Write of (part of) the file's contents. */
+    ASYNC_FILE_WRITER_OP_CLOSE, /**< @brief File closing. */
+} async_file_writer_op_t;
+
+/**
+ * @struct async_file_writer_job_t
+ * @brief  A file being written through `io_uring`.
+ *
+ * @var async_file_writer_job_t::path
+ *     @brief Path to the file (owned by the job).
+ * @var async_file_writer_job_t::contents
+ *     @brief Contents of the file (owned by the job).
+ * @var async_file_writer_job_t::length
+ *     @brief Number of bytes in ::async_file_writer_job_t::contents.
+ * @var async_file_writer_job_t::written
+ *     @brief Number of bytes in ::async_file_writer_job_t::contents already written.
+ * @var async_file_writer_job_t::fd
+ *     @brief File descriptor of the file, once opened.
+ * @var async_file_writer_job_t::pending
+ *     @brief Number of operations submitted and not yet completed.
+ * @var async_file_writer_job_t::failed
+ *     @brief Whether any operation failed.
+ * @var async_file_writer_job_t::canceled
+ *     @brief   Whether the file wasn't closed, for its write being short.
+ *     @details Writes and closes are linked, so a short write cancels the close after it.
+ */
+typedef struct {
+    char  *path;
+    char  *contents;
+    size_t length, written;
+    int    fd;
+    int    pending;
+    int    failed, canceled;
+} async_file_writer_job_t;
+
+/**
+ * @struct async_file_writer
+ * @brief  A way of writing many whole files, possibly asynchronously.
+ *
+ * @var async_file_writer::statistics
+ *     @brief Information about the files written so far.
+ * @var async_file_writer::ring_fd
+ *     @brief File descriptor of the `io_uring` instance, or `-1` for synchronous writes.
+ * @var async_file_writer::sq_ring
+ *     @brief Memory mapping of the submission queue ring.
+ * @var async_file_writer::cq_ring
+ *     @brief Memory mapping of the completion queue ring (may be the same as
+ *            ::async_file_writer::sq_ring).
+ * @var async_file_writer::sq_ring_size
+ *     @brief Size, in bytes, of ::async_file_writer::sq_ring.
+ * @var async_file_writer::cq_ring_size
+ *     @brief Size, in bytes, of ::async_file_writer::cq_ring (`0` if it's shared with
+ *            ::async_file_writer::sq_ring).
+ * @var async_file_writer::sqes
+ *     @brief Array of submission queue entries.
+ * @var async_file_writer::cqes
+ *     @brief Array of completion queue entries.
+ * @var async_file_writer::sq_entries
+ *     @brief Number of elements in ::async_file_writer::sqes.
+ * @var async_file_writer::sq_head
+ *     @brief Index of the first submission queue entry not yet consumed by the kernel.
+ * @var async_file_writer::sq_tail
+ *     @brief Index after the last submission queue entry.
+ * @var async_file_writer::sq_mask
+ *     @brief Mask to get a position in the submission queue from an index.
+ * @var async_file_writer::sq_array
+ *     @brief Indices of the entries in ::async_file_writer::sqes, in submission order.
+ * @var async_file_writer::cq_head
+ *     @brief Index of the first completion queue entry not yet consumed.
+ * @var async_file_writer::cq_tail
+ *     @brief Index after the last completion queue entry.
+ * @var async_file_writer::cq_mask
+ *     @brief Mask to get a position in the completion queue from an index.
+ * @var async_file_writer::to_submit
+ *     @brief Number of entries added to the submission queue and not yet submitted.
+ * @var async_file_writer::jobs
+ *     @brief Files in flight (only the ones with a non-`NULL` path are in use).
+ * @var async_file_writer::free_jobs
+ *     @brief Stack of indices of unused slots in ::async_file_writer::jobs.
+ * @var async_file_writer::free_jobs_length
+ *     @brief Number of elements in ::async_file_writer::free_jobs.
+ * @var async_file_writer::max_in_flight
+ *     @brief Number of elements in ::async_file_writer::jobs.
+ */
+struct async_file_writer {
+    async_file_writer_statistics_t statistics;
+
+    int                  ring_fd;
+    void                *sq_ring, *cq_ring;
+    size_t               sq_ring_size, cq_ring_size;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    unsigned             sq_entries;
+    unsigned            *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned            *cq_head, *cq_tail, *cq_mask;
+    unsigned             to_submit;
+
+    async_file_writer_job_t *jobs;
+    size_t                  *free_jobs;
+    size_t                   free_jobs_length, max_in_flight;
+};
+
+/**
+ * @brief   Number of submission queue entries that are submitted together.
+ * @details Larger batches mean fewer system calls, but files start being written later.
+ */
+#define ASYNC_FILE_WRITER_SUBMIT_BATCH 32
+
+/** @brief Maximum number of bytes written by a single `io_uring` write operation. */
+#define ASYNC_FILE_WRITER_MAX_WRITE (1U << 30)
+
+/** @brief Gets the current time (in nanoseconds) from a monotonic clock. */
+uint64_t __async_file_writer_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + (uint64_t) now.tv_nsec;
+}
+
+/**
+ * @brief   Checks if an `io_uring` instance supports all operations needed to write files.
+ * @details Auxiliary method for ::__async_file_writer_setup_ring.
+ *
+ * @param ring_fd File descriptor of the `io_uring` instance.
+ *
+ * @retval 0 All operations are supported.
+ * @retval 1 Some operation isn't supported, or the kernel can't be probed.
+ */
+int __async_file_writer_probe(int ring_fd) {
+    const size_t             nops  = 256;
+    struct io_uring_probe   *probe = calloc(1, sizeof(struct io_uring_probe) +
+                                                 nops * sizeof(struct io_uring_probe_op));
+    if (!probe)
+        return 1;
+
+    int retval = 1;
+    if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, nops) < 0)
+        goto DEFER_1;
+
+    const int ops[3] = {IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_CLOSE};
+    for (size_t i = 0; i < 3; ++i)
+        if (ops[i] > probe->last_op || !(probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED))
+            goto DEFER_1;
+
+    retval = 0;
+DEFER_1:
+    free(probe);
+    return retval;
+}
+
+/**
+ * @brief   Creates and maps an `io_uring` instance.
+ * @details Auxiliary method for ::async_file_writer_create.
+ *
+ * @param writer  Writer whose ring fields are to be initialized.
+ * @param entries Minimum number of submission queue entries.
+ *
+ * @retval 0 Success.
+ * @retval 1 `io_uring` isn't available. ::async_file_writer::ring_fd is left as `-1`.
+ */
+int __async_file_writer_setup_ring(async_file_writer_t *writer, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(struct io_uring_params));
+
+    const long ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (ring_fd < 0)
+        return 1;
+    if (__async_file_writer_probe(ring_fd))
+        goto DEFER_1;
+
+    writer->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    writer->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (writer->cq_ring_size > writer->sq_ring_size)
+            writer->sq_ring_size = writer->cq_ring_size;
+        writer->cq_ring_size = 0;
+    }
+
+    writer->sq_ring = mmap(NULL,
+                           writer->sq_ring_size,
+                           PROT_READ | PROT_WRITE,
+                           MAP_SHARED,
+                           ring_fd,
+                           IORING_OFF_SQ_RING);
+    if (writer->sq_ring == MAP_FAILED)
+        goto DEFER_1;
+
+    writer->cq_ring = writer->sq_ring;
+    if (writer->cq_ring_size) {
+        writer->cq_ring = mmap(NULL,
+                               writer->cq_ring_size,
+                               PROT_READ | PROT_WRITE,
+                               MAP_SHARED,
+                               ring_fd,
+                               IORING_OFF_CQ_RING);
+        if (writer->cq_ring == MAP_FAILED)
+            goto DEFER_2;
+    }
+
+    writer->sq_entries = params.sq_entries;
+    writer->sqes       = mmap(NULL,
+                        params.sq_entries * sizeof(struct io_uring_sqe),
+                        PROT_READ | PROT_WRITE,
+                        MAP_SHARED,
+                        ring_fd,
+                        IORING_OFF_SQES);
+    if (writer->sqes == MAP_FAILED)
+        goto DEFER_3;
+
+    char *const sq_ring = writer->sq_ring;
+    char *const cq_ring = writer->cq_ring;
+    writer->sq_head     = (unsigned *) (sq_ring + params.sq_off.head);
+    writer->sq_tail     = (unsigned *) (sq_ring + params.sq_off.tail);
+    writer->sq_mask     = (unsigned *) (sq_ring + params.sq_off.ring_mask);
+    writer->sq_array    = (unsigned *) (sq_ring + params.sq_off.array);
+    writer->cq_head     = (unsigned *) (cq_ring + params.cq_off.head);
+    writer->cq_tail     = (unsigned *) (cq_ring + params.cq_off.tail);
+    writer->cq_mask     = (unsigned *) (cq_ring + params.cq_off.ring_mask);
+    writer->cqes        = (struct io_uring_cqe *) (cq_ring + params.cq_off.cqes);
+
+    writer->ring_fd   = ring_fd;
+    writer->to_submit = 0;
+    return 0;
+
+DEFER_3:
+    if (writer->cq_ring_size)
+        munmap(writer->cq_ring, writer->cq_ring_size);
+DEFER_2:
+    munmap(writer->sq_ring, writer->sq_ring_size);
+DEFER_1:
+    close(ring_fd);
+    return 1;
+}
+
+async_file_writer_t *async_file_writer_create(async_file_writer_method_t method,
+                                              size_t                     max_in_flight) {
+    async_file_writer_t *const writer = malloc(sizeof(async_file_writer_t));
+    if (!writer)
+        return NULL;
+
+    writer->statistics = (async_file_writer_statistics_t) {.method = ASYNC_FILE_WRITER_METHOD_SYNC,
+                                                           .files  = 0,
+                                                           .failures     = 0,
+                                                           .bytes        = 0,
+                                                           .syscalls     = 0,
+                                                           .blocked_time = 0};
+    writer->ring_fd          = -1;
+    writer->jobs             = NULL;
+    writer->free_jobs        = NULL;
+    writer->free_jobs_length = 0;
+    writer->max_in_flight    = 0;
+
+    if (method == ASYNC_FILE_WRITER_METHOD_SYNC)
+        return writer;
+
+    writer->jobs      = malloc(sizeof(async_file_writer_job_t) * max_in_flight);
+    writer->free_jobs = malloc(sizeof(size_t) * max_in_flight);
+    if (!writer->jobs || !writer->free_jobs) {
+        free(writer->jobs);
+        free(writer->free_jobs);
+        free(writer);
+        return NULL;
+    }
+
+    /* Each file has, at most, a write and a close submitted at the same time */
+    if (__async_file_writer_setup_ring(writer, (unsigned) max_in_flight * 2)) {
+        free(writer->jobs);
+        free(writer->free_jobs);
+        writer->jobs      = NULL;
+        writer->free_jobs = NULL;
+        return writer;
+    }
+
+    for (size_t i = 0; i < max_in_flight; ++i) {
+        writer->jobs[i].path = NULL;
+        writer->free_jobs[i] = max_in_flight - i - 1;
+    }
+    writer->free_jobs_length  = max_in_flight;
+    writer->max_in_flight     = max_in_flight;
+    writer->statistics.method = ASYNC_FILE_WRITER_METHOD_IO_URING;
+    return writer;
+}
+
+/**
+ * @brief   Submits queued submission queue entries and, optionally, waits for completions.
+ * @details Auxiliary method for `io_uring` writes.
+ *
+ * @param writer   Writer of files.
+ * @param min_wait Number of completions to wait for.
+ *
+ * @retval 0 Success.
+ * @retval 1 The kernel refused the submission.
+ */
+int __async_file_writer_submit(async_file_writer_t *writer, unsigned min_wait) {
+    while (1) {
+        writer->statistics.syscalls++;
+        const long submitted = syscall(__NR_io_uring_enter,
+                                       writer->ring_fd,
+                                       writer->to_submit,
+                                       min_wait,
+                                       min_wait ? IORING_ENTER_GETEVENTS : 0,
+                                       NULL,
+                                       0);
+
+        if (submitted >= 0) {
+            writer->to_submit -= (unsigned) submitted;
+            if (!writer->to_submit)
+                return 0;
+            min_wait = 0; /* Waited for completions already. Just submit the rest */
+        } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            return 1;
+        }
+    }
+}
+
+/**
+ * @brief   Gets a free submission queue entry.
+ * @details Auxiliary method for `io_uring` writes. The submission queue is submitted if it's full.
+ *
+ * @param writer Writer of files.
+ *
+ * @return A zeroed submission queue entry, already in the submission queue.
+ */
+struct io_uring_sqe *__async_file_writer_get_sqe(async_file_writer_t *writer) {
+    const unsigned head = __atomic_load_n(writer->sq_head, __ATOMIC_ACQUIRE);
+    const unsigned tail = *writer->sq_tail;
+    if (tail - head == writer->sq_entries)
+        __async_file_writer_submit(writer, 0);
+
+    const unsigned index = tail & *writer->sq_mask;
+    struct io_uring_sqe *const sqe = &writer->sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+    writer->sq_array[index] = index;
+    __atomic_store_n(writer->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    writer->to_submit++;
+    return sqe;
+}
+
+/**
+ * @brief   Queues the operations needed after a file is opened (or after a short write).
+ * @details A write linked to a close, or only a close when there's nothing left to write.
+ *
+ * @param writer Writer of files.
+ * @param slot   Index of the file in ::async_file_writer::jobs.
+ */
+void __async_file_writer_queue_write(async_file_writer_t *writer, size_t slot) {
+    async_file_writer_job_t *const job = &writer->jobs[slot];
+
+    if (job->written < job->length && !job->failed) {
+        const size_t remaining = job->length - job->written;
+
+        struct io_uring_sqe *const write_sqe = __async_file_writer_get_sqe(writer);
+        write_sqe->opcode = IORING_OP_WRITE;
+        write_sqe->flags  = IOSQE_IO_LINK;
+        write_sqe->fd     = job->fd;
+        write_sqe->addr   = (uintptr_t) (job->contents + job->written);
+        write_sqe->len =
+            remaining > ASYNC_FILE_WRITER_MAX_WRITE ? ASYNC_FILE_WRITER_MAX_WRITE : remaining;
+        write_sqe->off       = job->written;
+        write_sqe->user_data = slot << 2 | ASYNC_FILE_WRITER_OP_WRITE;
+        job->pending++;
+    }
+
+    struct io_uring_sqe *const close_sqe = __async_file_writer_get_sqe(writer);
+    close_sqe->opcode    = IORING_OP_CLOSE;
+    close_sqe->fd        = job->fd;
+    close_sqe->user_data = slot << 2 | ASYNC_FILE_WRITER_OP_CLOSE;
+    job->pending++;
+}
+
+/**
+ * @brief   Handles the completion of an `io_uring` operation.
+ * @details Auxiliary method for ::__async_file_writer_reap.
+ *
+ * @param writer Writer of files.
+ * @param cqe    Completion queue entry.
+ */
+void __async_file_writer_complete(async_file_writer_t *writer, const struct io_uring_cqe *cqe) {
+    const size_t                   slot = cqe->user_data >> 2;
+    async_file_writer_job_t *const job  = &writer->jobs[slot];
+    job->pending--;
+
+    switch ((async_file_writer_op_t) (cqe->user_data & 3)) {
+        case ASYNC_FILE_WRITER_OP_OPEN:
+            if (cqe->res < 0) {
+                job->failed = 1;
+            } else {
+                job->fd = cqe->res;
+                __async_file_writer_queue_write(writer, slot);
+            }
+            break;
+        case ASYNC_FILE_WRITER_OP_WRITE:
+            if (cqe->res < 0)
+                job->failed = 1;
+            else
+                job->written += (size_t) cqe->res;
+            break;
+        case ASYNC_FILE_WRITER_OP_CLOSE:
+            if (cqe->res == -ECANCELED)
+                job->canceled = 1;
+            else if (cqe->res < 0)
+                job->failed = 1;
+            break;
+    }
+
+    if (job->pending)
+        return;
+
+    if (job->canceled) {
+        /* Short write: write the rest (unless the write failed) and close the file again */
+        job->canceled = 0;
+        __async_file_writer_queue_write(writer, slot);
+        return;
+    }
+
+    /* Done with this file */
+    writer->statistics.bytes += job->written;
+    writer->statistics.failures += job->failed || job->written != job->length;
+    free(job->path);
+    free(job->contents);
+    job->path                                     = NULL;
+    writer->free_jobs[writer->free_jobs_length++] = slot;
+}
+
+/**
+ * @brief   Handles all `io_uring` operations that have completed.
+ * @details Auxiliary method for `io_uring` writes.
+ * @param   writer Writer of files.
+ */
+void __async_file_writer_reap(async_file_writer_t *writer) {
+    unsigned       head = *writer->cq_head;
+    const unsigned tail = __atomic_load_n(writer->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; ++head)
+        __async_file_writer_complete(writer, &writer->cqes[head & *writer->cq_mask]);
+
+    __atomic_store_n(writer->cq_head, head, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief   Writes a file with blocking system calls.
+ * @details Auxiliary method for ::async_file_writer_write.
+ *
+ * @param writer   Writer of files.
+ * @param path     Path to the file to be written.
+ * @param contents Contents of the file.
+ * @param length   Number of bytes in @p contents.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO failure.
+ */
+int __async_file_writer_write_sync(async_file_writer_t *writer,
+                                   const char          *path,
+                                   const char          *contents,
+                                   size_t               length) {
+    writer->statistics.syscalls++;
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+        return 1;
+
+    int    retval  = 0;
+    size_t written = 0;
+    while (written < length) {
+        writer->statistics.syscalls++;
+        const ssize_t w = write(fd, contents + written, length - written);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            retval = 1;
+            break;
+        }
+        written += (size_t) w;
+    }
+
+    writer->statistics.syscalls++;
+    writer->statistics.bytes += written;
+    return close(fd) || retval;
+}
+
+int async_file_writer_write(async_file_writer_t *writer,
+                            const char          *path,
+                            char                *contents,
+                            size_t               length) {
+    const uint64_t start = __async_file_writer_now();
+    writer->statistics.files++;
+
+    int retval = 0;
+    if (writer->ring_fd < 0) {
+        retval = __async_file_writer_write_sync(writer, path, contents, length);
+        writer->statistics.failures += retval;
+        free(contents);
+        goto DEFER_1;
+    }
+
+    char *const path_copy = strdup(path);
+    if (!path_copy) {
+        writer->statistics.failures++;
+        free(contents);
+        retval = 1;
+        goto DEFER_1;
+    }
+
+    /* Wait for a file to finish, when too many are in flight */
+    __async_file_writer_reap(writer);
+    while (!writer->free_jobs_length) {
+        if (__async_file_writer_submit(writer, 1))
+            break;
+        __async_file_writer_reap(writer);
+    }
+
+    if (!writer->free_jobs_length) { /* io_uring failure */
+        writer->statistics.failures++;
+        free(path_copy);
+        free(contents);
+        retval = 1;
+        goto DEFER_1;
+    }
+
+    const size_t                   slot = writer->free_jobs[--writer->free_jobs_length];
+    async_file_writer_job_t *const job  = &writer->jobs[slot];
+    *job = (async_file_writer_job_t) {.path     = path_copy,
+                                      .contents = contents,
+                                      .length   = length,
+                                      .written  = 0,
+                                      .fd       = -1,
+                                      .pending  = 1,
+                                      .failed   = 0,
+                                      .canceled = 0};
+
+    struct io_uring_sqe *const sqe = __async_file_writer_get_sqe(writer);
+    sqe->opcode     = IORING_OP_OPENAT;
+    sqe->fd         = AT_FDCWD;
+    sqe->addr       = (uintptr_t) job->path;
+    sqe->len        = 0666;
+    sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+    sqe->user_data  = slot << 2 | ASYNC_FILE_WRITER_OP_OPEN;
+
+    if (writer->to_submit >= ASYNC_FILE_WRITER_SUBMIT_BATCH &&
+        __async_file_writer_submit(writer, 0))
+        retval = 1;
+
+DEFER_1:
+    writer->statistics.blocked_time += __async_file_writer_now() - start;
+    return retval;
+}
+
+int async_file_writer_finish(async_file_writer_t *writer) {
+    const uint64_t start = __async_file_writer_now();
+
+    if (writer->ring_fd >= 0) {
+        __async_file_writer_reap(writer);
+        while (writer->free_jobs_length < writer->max_in_flight) {
+            if (__async_file_writer_submit(writer, 1))
+                break; /* Files in flight can't be waited for. Give up on them */
+            __async_file_writer_reap(writer);
+        }
+    }
+
+    writer->statistics.blocked_time += __async_file_writer_now() - start;
+    return writer->statistics.failures != 0;
+}
+
+const async_file_writer_statistics_t *
+    async_file_writer_get_statistics(const async_file_writer_t *writer) {
+    return &writer->statistics;
+}
+
+void async_file_writer_free(async_file_writer_t *writer) {
+    if (writer->ring_fd >= 0) {
+        async_file_writer_finish(writer);
+
+        /* Closing the ring cancels any operations that couldn't be waited for */
+        munmap(writer->sqes, writer->sq_entries * sizeof(struct io_uring_sqe));
+        if (writer->cq_ring_size)
+            munmap(writer->cq_ring, writer->cq_ring_size);
+        munmap(writer->sq_ring, writer->sq_ring_size);
+        close(writer->ring_fd);
+
+        for (size_t i = 0; i < writer->max_in_flight; ++i) {
+            if (writer->jobs[i].path) {
+                free(writer->jobs[i].path);
+                free(writer->jobs[i].contents);
+            }
+        }
+    }
+
+    free(writer->jobs);
+    free(writer->free_jobs);
+    free(writer);
+}
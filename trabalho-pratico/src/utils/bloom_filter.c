@@ -0,0 +1,182 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  bloom_filter.c
+ * @brief Implementation of methods in include/utils/bloom_filter.h
+ *
+ * ### Example
+ * See [the header file's documentation](@ref bloom_filter_example).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/bloom_filter.h"
+
+/** @brief Number of 64-bit words in a block of a ::bloom_filter_t (a 64-byte cache line). */
+#define BLOOM_FILTER_BLOCK_WORDS 8
+
+/** @brief Number of bytes in a block of a ::bloom_filter_t. */
+#define BLOOM_FILTER_BLOCK_SIZE (BLOOM_FILTER_BLOCK_WORDS * sizeof(uint64_t))
+
+/** @brief Number of bits of a block of a ::bloom_filter_t needed to choose one of its bits. */
+#define BLOOM_FILTER_BLOCK_BITS_LOG 9
+
+/**
+ * @struct bloom_filter
+ * @brief  Blocked Bloom filter.
+ *
+ * @var bloom_filter::blocks
+ *     @brief Bits of the filter, in cache-line-aligned blocks of ::BLOOM_FILTER_BLOCK_WORDS words.
+ * @var bloom_filter::nblocks
+ *     @brief Number of blocks in ::bloom_filter::blocks.
+ * @var bloom_filter::statistics
+ *     @brief   How lookups were answered.
+ *     @details Allocated separately, as it's updated by lookups in `const` filters.
+ */
+struct bloom_filter {
+    uint64_t                  *blocks;
+    size_t                     nblocks;
+    bloom_filter_statistics_t *statistics;
+};
+
+uint64_t bloom_filter_hash_string(const char *str) {
+    /* FNV-1a, followed by the mixing of ::bloom_filter_hash_integer */
+    uint64_t hash = 0xcbf29ce484222325;
+    for (; *str; ++str)
+        hash = (hash ^ (uint8_t) *str) * 0x100000001b3;
+    return bloom_filter_hash_integer(hash);
+}
+
+uint64_t bloom_filter_hash_integer(uint64_t value) {
+    /* Finalizer of MurmurHash3, so that every bit of the result depends on every bit of value */
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccd;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53;
+    value ^= value >> 33;
+    return value;
+}
+
+bloom_filter_t *bloom_filter_create(size_t capacity) {
+    bloom_filter_t *const filter = malloc(sizeof(bloom_filter_t));
+    if (!filter)
+        goto DEFER_1;
+
+    const size_t block_bits = BLOOM_FILTER_BLOCK_SIZE * 8;
+    filter->nblocks = (capacity * BLOOM_FILTER_BITS_PER_KEY + block_bits - 1) / block_bits;
+    if (!filter->nblocks)
+        filter->nblocks = 1;
+
+    const size_t blocks_size = filter->nblocks * BLOOM_FILTER_BLOCK_SIZE;
+    void        *blocks;
+    if (posix_memalign(&blocks, BLOOM_FILTER_BLOCK_SIZE, blocks_size))
+        goto DEFER_2;
+    memset(blocks, 0, blocks_size);
+    filter->blocks = blocks;
+
+    filter->statistics = calloc(1, sizeof(bloom_filter_statistics_t));
+    if (!filter->statistics)
+        goto DEFER_3;
+
+    return filter;
+
+DEFER_3:
+    free(blocks);
+DEFER_2:
+    free(filter);
+DEFER_1:
+    return NULL;
+}
+
+/**
+ * @brief Gets the block of a Bloom filter a key belongs to.
+ *
+ * @param filter Filter to get the block from.
+ * @param hash   Hash of the key.
+ *
+ * @return The index of the first word of the block in ::bloom_filter::blocks.
+ */
+size_t __bloom_filter_get_block(const bloom_filter_t *filter, uint64_t hash) {
+    /* Multiply-shift instead of a modulo, with the high bits of the hash */
+    return (((hash >> 32) * filter->nblocks) >> 32) * BLOOM_FILTER_BLOCK_WORDS;
+}
+
+/**
+ * @brief  Gets the bits of a block that a key sets.
+ * @param  hash Hash of the key.
+ * @return A value whose ::BLOOM_FILTER_HASHES fields of ::BLOOM_FILTER_BLOCK_BITS_LOG bits are the
+ *         indices of the bits in the block.
+ */
+uint64_t __bloom_filter_get_positions(uint64_t hash) {
+    /* Remix, so that positions don't depend on the same bits as the block */
+    return (hash * 0x9e3779b97f4a7c15) >> (64 - BLOOM_FILTER_HASHES * BLOOM_FILTER_BLOCK_BITS_LOG);
+}
+
+void bloom_filter_add(bloom_filter_t *filter, uint64_t hash) {
+    uint64_t *const block     = filter->blocks + __bloom_filter_get_block(filter, hash);
+    uint64_t        positions = __bloom_filter_get_positions(hash);
+
+    for (size_t i = 0; i < BLOOM_FILTER_HASHES; ++i) {
+        const size_t bit = positions & ((1 << BLOOM_FILTER_BLOCK_BITS_LOG) - 1);
+        block[bit / 64] |= (uint64_t) 1 << (bit % 64);
+        positions >>= BLOOM_FILTER_BLOCK_BITS_LOG;
+    }
+}
+
+int bloom_filter_may_contain(const bloom_filter_t *filter, uint64_t hash) {
+    const uint64_t *const block     = filter->blocks + __bloom_filter_get_block(filter, hash);
+    uint64_t              positions = __bloom_filter_get_positions(hash);
+
+    for (size_t i = 0; i < BLOOM_FILTER_HASHES; ++i) {
+        const size_t bit = positions & ((1 << BLOOM_FILTER_BLOCK_BITS_LOG) - 1);
+        if (!((block[bit / 64] >> (bit % 64)) & 1)) {
+            __atomic_fetch_add(&filter->statistics->rejected, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+        positions >>= BLOOM_FILTER_BLOCK_BITS_LOG;
+    }
+
+    __atomic_fetch_add(&filter->statistics->passed, 1, __ATOMIC_RELAXED);
+    return 1;
+}
+
+void bloom_filter_count_false_positive(const bloom_filter_t *filter) {
+    __atomic_fetch_add(&filter->statistics->false_positives, 1, __ATOMIC_RELAXED);
+}
+
+void bloom_filter_get_statistics(const bloom_filter_t      *filter,
+                                 bloom_filter_statistics_t *statistics) {
+    statistics->rejected = __atomic_load_n(&filter->statistics->rejected, __ATOMIC_RELAXED);
+    statistics->passed   = __atomic_load_n(&filter->statistics->passed, __ATOMIC_RELAXED);
+    statistics->false_positives =
+        __atomic_load_n(&filter->statistics->false_positives, __ATOMIC_RELAXED);
+}
+
+size_t bloom_filter_get_size(const bloom_filter_t *filter) {
+    return sizeof(bloom_filter_t) + filter->nblocks * BLOOM_FILTER_BLOCK_SIZE +
+           sizeof(bloom_filter_statistics_t);
+}
+
+void bloom_filter_free(bloom_filter_t *filter) {
+    if (!filter)
+        return;
+
+    free(filter->blocks);
+    free(filter->statistics);
+    free(filter);
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  cpu_features.c
+ * @brief Implementation of methods in include/utils/cpu_features.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref cpu_features_examples).
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/cpu_features.h"
+
+/**
+ * @struct cpu_features_level_t
+ * @brief  A level of features, that can be chosen with ::CPU_FEATURES_ENVIRONMENT_VARIABLE.
+ *
+ * @var cpu_features_level_t::name
+ *     @brief Name of the level.
+ * @var cpu_features_level_t::features
+ *     @brief Features in the level (and in all levels before it).
+ */
+typedef struct {
+    const char  *name;
+    unsigned int features;
+} cpu_features_level_t;
+
+/** @brief All levels of features, from the worst to the best. */
+const cpu_features_level_t cpu_features_levels[] = {
+    {"scalar", 0},
+    {"sse4.1", CPU_FEATURE_SSE41},
+    {"avx2", CPU_FEATURE_SSE41 | CPU_FEATURE_AVX2},
+    {"avx512", CPU_FEATURE_SSE41 | CPU_FEATURE_AVX2 | CPU_FEATURE_AVX512},
+};
+
+/** @brief Number of elements in ::cpu_features_levels. */
+#define CPU_FEATURES_LEVEL_COUNT (sizeof(cpu_features_levels) / sizeof(*cpu_features_levels))
+
+/** @brief Features returned by ::cpu_features_get, once detected. */
+unsigned int cpu_features_detected = 0;
+
+/** @brief Guarantees ::cpu_features_detected is only set once. */
+pthread_once_t cpu_features_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief   Detects the features of the CPU and sets ::cpu_features_detected.
+ * @details Auxiliary method for ::cpu_features_get, called through `pthread_once`.
+ */
+void __cpu_features_detect(void) {
+    unsigned int features = 0;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1"))
+        features |= CPU_FEATURE_SSE41;
+    if (__builtin_cpu_supports("avx2"))
+        features |= CPU_FEATURE_AVX2;
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        features |= CPU_FEATURE_AVX512;
+#endif
+
+    /* Levels imply the previous ones, so a CPU that skips one is limited to the one before it */
+    unsigned int supported = 0;
+    for (size_t i = 0; i < CPU_FEATURES_LEVEL_COUNT; ++i) {
+        if ((features & cpu_features_levels[i].features) != cpu_features_levels[i].features)
+            break;
+        supported = cpu_features_levels[i].features;
+    }
+
+    const char *const environment = getenv(CPU_FEATURES_ENVIRONMENT_VARIABLE);
+    for (size_t i = 0; environment && i < CPU_FEATURES_LEVEL_COUNT; ++i)
+        if (strcmp(environment, cpu_features_levels[i].name) == 0)
+            supported &= cpu_features_levels[i].features;
+
+    cpu_features_detected = supported;
+}
+
+unsigned int cpu_features_get(void) {
+    pthread_once(&cpu_features_once, __cpu_features_detect);
+    return cpu_features_detected;
+}
+
+size_t cpu_features_select(const unsigned int *requirements, size_t n) {
+    const unsigned int features = cpu_features_get();
+    for (size_t i = 0; i < n; ++i)
+        if ((requirements[i] & features) == requirements[i])
+            return i;
+    return n - 1;
+}
+
+const char *cpu_features_get_name(unsigned int features) {
+    const char *name = cpu_features_levels[0].name;
+    for (size_t i = 1; i < CPU_FEATURES_LEVEL_COUNT; ++i)
+        if ((features & cpu_features_levels[i].features) == cpu_features_levels[i].features)
+            name = cpu_features_levels[i].name;
+    return name;
+}
@@ -31,31 +31,20 @@
 #include "utils/int_utils.h"
 
 /**
- * @union date_union_helper_t
- * @brief Date with `union`, to easily extract fields from a date integer.
+ * @struct date_fields_t
+ * @brief  Individual fields of a date, decoded from its ordinal representation.
  *
- * @var date_union_helper_t::date
- *     @brief Compact date format, exposed to the outside of this module.
- * @var date_union_helper_t::fields
- *     @brief Individual fields within ::date_union_helper_t::date.
- * @var date_union_helper_t::year
- *     @brief Year in @p ::date_union_helper_t::date. Must be between ::DATE_YEAR_MIN and
- *            ::DATE_YEAR_MAX.
- * @var date_union_helper_t::month
- *     @brief Month in @p ::date_union_helper_t::date. Must be between ::DATE_MONTH_MIN and
- *            ::DATE_MONTH_MAX.
- * @var date_union_helper_t::day
- *     @brief Day in @p ::date_union_helper_t::date. Must be between ::DATE_DAY_MIN and
- *            ::DATE_DAY_MAX.
+ * @var date_fields_t::year
+ *     @brief Year of the date. Must be between ::DATE_YEAR_MIN and ::DATE_YEAR_MAX.
+ * @var date_fields_t::month
+ *     @brief Month of the date. Must be between ::DATE_MONTH_MIN and ::DATE_MONTH_MAX.
+ * @var date_fields_t::day
+ *     @brief Day of the date. Must be between ::DATE_DAY_MIN and ::DATE_DAY_MAX.
  */
-typedef union {
-    const date_t date;
-
-    struct {
-        uint16_t year;
-        uint8_t  month, day;
-    } fields;
-} date_union_helper_t;
+typedef struct {
+    uint16_t year;
+    uint8_t  month, day;
+} date_fields_t;
 
 /** @brief The minimum value (inclusive) that a year in a date may take. */
 #define DATE_YEAR_MIN  1
@@ -70,27 +59,42 @@ typedef union {
 /** @brief The maximum value (inclusive) that a day in a date may take. */
 #define DATE_DAY_MAX   31
 
-int date_from_values(date_t *output, uint16_t year, uint8_t month, uint8_t day) {
-    date_union_helper_t date_union;
+/**
+ * @brief Encodes the fields of a date into its ordinal representation.
+ * @param fields Fields to be encoded. Must be within range.
+ * @return The day ordinal of the date, assuming all months have `31` days.
+ */
+date_t __date_encode(date_fields_t fields) {
+    return ((uint32_t) fields.year * 12 + (uint32_t) (fields.month - DATE_MONTH_MIN)) * 31 +
+           (uint32_t) (fields.day - DATE_DAY_MIN);
+}
+
+/**
+ * @brief Decodes a date's ordinal representation into its individual fields.
+ * @param date Date to be decoded.
+ * @return The fields of @p date.
+ */
+date_fields_t __date_decode(date_t date) {
+    return (date_fields_t) {.year  = date / (12 * 31),
+                            .month = date / 31 % 12 + DATE_MONTH_MIN,
+                            .day   = date % 31 + DATE_DAY_MIN};
+}
 
+int date_from_values(date_t *output, uint16_t year, uint8_t month, uint8_t day) {
     if (year < DATE_YEAR_MIN || year > DATE_YEAR_MAX || month < DATE_MONTH_MIN ||
         month > DATE_MONTH_MAX || day < DATE_DAY_MIN || day > DATE_DAY_MAX) {
 
         return 1;
     }
 
-    date_union.fields.year  = year;
-    date_union.fields.month = month;
-    date_union.fields.day   = day;
-
-    *output = date_union.date;
+    *output = __date_encode((date_fields_t) {.year = year, .month = month, .day = day});
     return 0;
 }
 
 /**
  * @brief Auxiliary method for ::date_from_string. Parses any of the integers in a date.
  *
- * @param date_data A pointer to a ::date_union_helper_t, whose fields are filled in as the date
+ * @param date_data A pointer to a ::date_fields_t, whose fields are filled in as the date
  *                  is parsed.
  * @param token     Number between slashes to be parsed.
  * @param ntoken    Tokens already parsed (number of the current token, `0`-indexed).
@@ -99,7 +103,7 @@ int date_from_values(date_t *output, uint16_t year, uint8_t month, uint8_t day)
  * @retval 1 Integer parsing failure.
  */
 int __date_from_string_parse_field(void *date_data, char *token, size_t ntoken) {
-    date_union_helper_t *const date = date_data;
+    date_fields_t *const date = date_data;
 
     const uint64_t mins[3]    = {DATE_YEAR_MIN, DATE_MONTH_MIN, DATE_DAY_MIN};
     const uint64_t maxs[3]    = {DATE_YEAR_MAX, DATE_MONTH_MAX, DATE_DAY_MAX};
@@ -120,13 +124,13 @@ int __date_from_string_parse_field(void *date_data, char *token, size_t ntoken)
 
     switch (ntoken) {
         case 0:
-            date->fields.year = parsed;
+            date->year = parsed;
             break;
         case 1:
-            date->fields.month = parsed;
+            date->month = parsed;
             break;
         case 2:
-            date->fields.day = parsed;
+            date->day = parsed;
             break;
         default: /* unreachable */
             break;
@@ -144,6 +148,27 @@ int __date_from_string_parse_field(void *date_data, char *token, size_t ntoken)
  *          -# Helps performance, as a new grammar doesn't need to be generated for every date to
  *             be parsed.
  */
+/**
+ * @brief   Parses a string containing a date in the format `"YYYY/MM/DD"`, without a grammar.
+ * @details Fast path for ::date_from_string, for valid dates. Any other input makes this method
+ *          fail, so that it's handled (and its error reported) by the grammar instead.
+ *
+ * @param output Where the parsed date is placed. Won't be modified on failure.
+ * @param input  String to parse.
+ *
+ * @retval 0 Parsing success.
+ * @retval 1 @p input must be parsed by the grammar.
+ */
+int __date_from_string_fast(date_t *output, const char *input) {
+    uint64_t year, month, day;
+    if (int_utils_parse_digits(&year, input, 4) || input[4] != '/' ||
+        int_utils_parse_digits(&month, input + 5, 2) || input[7] != '/' ||
+        int_utils_parse_digits(&day, input + 8, 2) || input[10] != '\0')
+        return 1;
+
+    return date_from_values(output, year, month, day);
+}
+
 fixed_n_delimiter_parser_grammar_t *__date_grammar = NULL;
 
 /** @brief Automatically initializes ::__date_grammar when the program starts. */
@@ -160,12 +185,15 @@ void __attribute__((destructor)) __date_grammar_free(void) {
 }
 
 int date_from_string(date_t *output, char *input) {
-    date_union_helper_t tmp_date;
-    const int retval = fixed_n_delimiter_parser_parse_string(input, __date_grammar, &tmp_date);
+    if (!__date_from_string_fast(output, input))
+        return 0;
+
+    date_fields_t tmp_date;
+    const int     retval = fixed_n_delimiter_parser_parse_string(input, __date_grammar, &tmp_date);
     if (retval) {
         return retval;
     } else {
-        *output = tmp_date.date;
+        *output = __date_encode(tmp_date);
         return 0;
     }
 }
@@ -182,40 +210,34 @@ int date_from_string_const(date_t *output, const char *input) {
 }
 
 void date_sprintf(char *output, date_t date) {
-    const date_union_helper_t date_union = {.date = date};
+    const date_fields_t fields = __date_decode(date);
 
-    sprintf(output,
-            "%04d/%02d/%02d",
-            date_union.fields.year,
-            date_union.fields.month,
-            date_union.fields.day);
+    output += int_utils_sprintf_padded(output, fields.year, 4);
+    *(output++) = '/';
+    output += int_utils_sprintf_padded(output, fields.month, 2);
+    *(output++) = '/';
+    int_utils_sprintf_padded(output, fields.day, 2);
 }
 
 int64_t date_diff(date_t a, date_t b) {
-    const date_union_helper_t a_union = {.date = a};
-    const date_union_helper_t b_union = {.date = b};
-
-    const int64_t a_days = (int64_t) a_union.fields.year * 12 * 31 +
-                           (int64_t) a_union.fields.month * 31 + (int64_t) a_union.fields.day;
-    const int64_t b_days = (int64_t) b_union.fields.year * 12 * 31 +
-                           (int64_t) b_union.fields.month * 31 + (int64_t) b_union.fields.day;
+    return (int64_t) a - (int64_t) b;
+}
 
-    return a_days - b_days;
+int32_t date_to_day_number(date_t date) {
+    return (int32_t) date;
 }
 
 /**
  * @brief Helper macro for defining getters.
- * @param property Property to get in ::date_union_helper_t::fields.
+ * @param property Property to get in ::date_fields_t.
  */
-#define DATE_GETTER_FUNCTION_BODY(property)                                                        \
-    const date_union_helper_t date_union = {.date = date};                                         \
-    return date_union.fields.property;
+#define DATE_GETTER_FUNCTION_BODY(property) return __date_decode(date).property;
 
 /**
  * @brief Helper macro for defining setters.
  *
- * @param property    Property to set in ::date_union_helper_t::fields. Name must match the name of
- *                    the argument in the setter method.
+ * @param property    Property to set in ::date_fields_t. Name must match the name of the argument
+ *                    in the setter method.
  * @param lower_bound Minimum value (inclusive) that @p property can take.
  * @param upper_bound Maximum value (inclusive) that @p property can take.
  */
@@ -224,9 +246,9 @@ int64_t date_diff(date_t a, date_t b) {
         return 1;                                                                                  \
     }                                                                                              \
                                                                                                    \
-    date_union_helper_t date_union = {.date = *date};                                              \
-    date_union.fields.property     = property;                                                     \
-    *date                          = date_union.date;                                              \
+    date_fields_t fields = __date_decode(*date);                                                   \
+    fields.property      = property;                                                               \
+    *date                = __date_encode(fields);                                                  \
     return 0;
 
 uint16_t date_get_year(date_t date) {
@@ -254,14 +276,9 @@ int date_set_day(date_t *date, uint8_t day) {
 }
 
 uint32_t date_generate_dayless(date_t date) {
-    date_union_helper_t date_union = {.date = date};
-    date_union.fields.day          = 0;
-    return date_union.date;
+    return date - date % 31;
 }
 
 uint32_t date_generate_monthless(date_t date) {
-    date_union_helper_t date_union = {.date = date};
-    date_union.fields.day          = 0;
-    date_union.fields.month        = 0;
-    return date_union.date;
+    return date - date % (12 * 31);
 }
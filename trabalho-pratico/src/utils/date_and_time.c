@@ -31,40 +31,32 @@
 #include "utils/daytime.h"
 #include "utils/fixed_n_delimiter_parser.h"
 
+/** @brief Number of seconds in a day. */
+#define DATE_AND_TIME_SECONDS_PER_DAY (24 * 60 * 60)
+
 /**
- * @union date_and_time_union_helper_t
- * @brief Timed date with `union`, to easily extract fields from a timed date integer.
+ * @struct date_and_time_fields_t
+ * @brief  Individual fields of a timed date, filled in while it's being parsed.
  *
- * @var date_and_time_union_helper_t::date_and_time
- *     @brief Compact timed date format, exposed to the outside of this module.
- * @var date_and_time_union_helper_t::fields
- *     @brief Individual fields within ::date_and_time_union_helper_t::date_and_time.
- * @var date_and_time_union_helper_t::date
- *     @brief Date in ::date_and_time_union_helper_t::date_and_time.
- * @var date_and_time_union_helper_t::time
- *     @brief Time of the day in ::date_and_time_union_helper_t::date_and_time.
+ * @var date_and_time_fields_t::date
+ *     @brief Date of the timed date.
+ * @var date_and_time_fields_t::time
+ *     @brief Time of the day of the timed date.
  */
-typedef union {
-    const date_and_time_t date_and_time;
-
-    struct {
-        date_t    date;
-        daytime_t time;
-    } fields;
-} date_and_time_union_helper_t;
+typedef struct {
+    date_t    date;
+    daytime_t time;
+} date_and_time_fields_t;
 
 void date_and_time_from_values(date_and_time_t *output, date_t date, daytime_t time) {
-    date_and_time_union_helper_t date_and_time_union;
-    date_and_time_union.fields.date = date;
-    date_and_time_union.fields.time = time;
-    *output                         = date_and_time_union.date_and_time;
+    *output = (date_and_time_t) date * DATE_AND_TIME_SECONDS_PER_DAY + time;
 }
 
 /**
  * @brief Auxiliary method for ::date_and_time_from_string. Parses dates.
  *
- * @param date_and_time_data A pointer to a ::date_and_time_union_helper_t, whose fields are filled
- *                           in as the timed date is parsed.
+ * @param date_and_time_data A pointer to a ::date_and_time_fields_t, whose fields are filled in as
+ *                           the timed date is parsed.
  * @param token              Date being parsed.
  * @param ntoken             Tokens already parsed (number of the current token, `0`-indexed).
  *
@@ -73,15 +65,15 @@ void date_and_time_from_values(date_and_time_t *output, date_t date, daytime_t t
  */
 int __date_and_time_from_string_parse_date(void *date_and_time_data, char *token, size_t ntoken) {
     (void) ntoken;
-    date_and_time_union_helper_t *const date_and_time = date_and_time_data;
-    return date_from_string(&date_and_time->fields.date, token);
+    date_and_time_fields_t *const date_and_time = date_and_time_data;
+    return date_from_string(&date_and_time->date, token);
 }
 
 /**
  * @brief Auxiliary method for ::date_and_time_from_string. Parses times in the day.
  *
- * @param date_and_time_data A pointer to a ::date_and_time_union_helper_t, whose fields are filled
- *                           in as the timed date is parsed.
+ * @param date_and_time_data A pointer to a ::date_and_time_fields_t, whose fields are filled in as
+ *                           the timed date is parsed.
  * @param token              Time being parsed.
  * @param ntoken             Tokens already parsed (number of the current token, `0`-indexed).
  *
@@ -92,8 +84,8 @@ int __date_and_time_from_string_parse_daytime(void  *date_and_time_data,
                                               char  *token,
                                               size_t ntoken) {
     (void) ntoken;
-    date_and_time_union_helper_t *const date_and_time = date_and_time_data;
-    return daytime_from_string(&date_and_time->fields.time, token);
+    date_and_time_fields_t *const date_and_time = date_and_time_data;
+    return daytime_from_string(&date_and_time->time, token);
 }
 
 /**
@@ -106,6 +98,39 @@ int __date_and_time_from_string_parse_daytime(void  *date_and_time_data,
  *          -# Helps performance, as a new grammar doesn't need to be generated for every timed date
  *             to be parsed.
  */
+/**
+ * @brief   Parses a string in the format `"YYYY/MM/DD HH:MM:SS"`, without a grammar.
+ * @details Fast path for ::date_and_time_from_string, for valid dates and times. The string is only
+ *          split at its fixed position (no tokenization), and each part goes directly to the fast
+ *          paths of ::date_from_string and ::daytime_from_string. Any other input makes this
+ *          method fail, so that it's handled (and its error reported) by the grammar instead.
+ *
+ * @param output Where the parsed date and time is placed. Won't be modified on failure.
+ * @param input  String to parse, temporarily modified.
+ *
+ * @retval 0 Parsing success.
+ * @retval 1 @p input must be parsed by the grammar.
+ */
+int __date_and_time_from_string_fast(date_and_time_t *output, char *input) {
+    if (strlen(input) != DATE_SPRINTF_MIN_BUFFER_SIZE + DAYTIME_SPRINTF_MIN_BUFFER_SIZE - 1 ||
+        input[DATE_SPRINTF_MIN_BUFFER_SIZE - 1] != ' ')
+        return 1;
+
+    date_t    date;
+    daytime_t time;
+
+    input[DATE_SPRINTF_MIN_BUFFER_SIZE - 1] = '\0';
+    const int retval = date_from_string(&date, input) ||
+                       daytime_from_string(&time, input + DATE_SPRINTF_MIN_BUFFER_SIZE);
+    input[DATE_SPRINTF_MIN_BUFFER_SIZE - 1] = ' ';
+
+    if (retval)
+        return 1;
+
+    date_and_time_from_values(output, date, time);
+    return 0;
+}
+
 fixed_n_delimiter_parser_grammar_t *__date_and_time_grammar = NULL;
 
 /** @brief Automatically initializes ::__date_and_time_grammar when the program starts. */
@@ -123,13 +148,16 @@ void __attribute__((destructor)) __date_and_time_grammar_free(void) {
 }
 
 int date_and_time_from_string(date_and_time_t *output, char *input) {
-    date_and_time_union_helper_t tmp_date;
-    const int                    retval =
+    if (!__date_and_time_from_string_fast(output, input))
+        return 0;
+
+    date_and_time_fields_t tmp_date;
+    const int              retval =
         fixed_n_delimiter_parser_parse_string(input, __date_and_time_grammar, &tmp_date);
     if (retval) {
         return retval;
     } else {
-        *output = tmp_date.date_and_time;
+        date_and_time_from_values(output, tmp_date.date, tmp_date.time);
         return 0;
     }
 }
@@ -146,43 +174,29 @@ int date_and_time_from_string_const(date_and_time_t *output, const char *input)
 }
 
 void date_and_time_sprintf(char *output, date_and_time_t date_and_time) {
-    const date_and_time_union_helper_t date_and_time_union = {.date_and_time = date_and_time};
-
-    char date_str[DATE_SPRINTF_MIN_BUFFER_SIZE];
-    date_sprintf(date_str, date_and_time_union.fields.date);
-
-    char time_str[DAYTIME_SPRINTF_MIN_BUFFER_SIZE];
-    daytime_sprintf(time_str, date_and_time_union.fields.time);
-
-    sprintf(output, "%s %s", date_str, time_str);
+    /* Write both parts in place: the date's null terminator is replaced by a space */
+    date_sprintf(output, date_and_time_get_date(date_and_time));
+    output += DATE_SPRINTF_MIN_BUFFER_SIZE - 1;
+    *(output++) = ' ';
+    daytime_sprintf(output, date_and_time_get_time(date_and_time));
 }
 
 int64_t date_and_time_diff(date_and_time_t a, date_and_time_t b) {
-    const date_and_time_union_helper_t a_union = {.date_and_time = a};
-    const date_and_time_union_helper_t b_union = {.date_and_time = b};
-
-    return date_diff(a_union.fields.date, b_union.fields.date) * (24 * 60 * 60) +
-           daytime_diff(a_union.fields.time, b_union.fields.time);
+    return (int64_t) a - (int64_t) b;
 }
 
 date_t date_and_time_get_date(date_and_time_t date_and_time) {
-    const date_and_time_union_helper_t date_and_time_union = {.date_and_time = date_and_time};
-    return date_and_time_union.fields.date;
+    return date_and_time / DATE_AND_TIME_SECONDS_PER_DAY;
 }
 
 void date_and_time_set_date(date_and_time_t *date_and_time, date_t date) {
-    date_and_time_union_helper_t date_and_time_union = {.date_and_time = *date_and_time};
-    date_and_time_union.fields.date                  = date;
-    *date_and_time                                   = date_and_time_union.date_and_time;
+    date_and_time_from_values(date_and_time, date, date_and_time_get_time(*date_and_time));
 }
 
 daytime_t date_and_time_get_time(date_and_time_t date_and_time) {
-    const date_and_time_union_helper_t date_and_time_union = {.date_and_time = date_and_time};
-    return date_and_time_union.fields.time;
+    return date_and_time % DATE_AND_TIME_SECONDS_PER_DAY;
 }
 
 void date_and_time_set_time(date_and_time_t *date_and_time, daytime_t time) {
-    date_and_time_union_helper_t date_and_time_union = {.date_and_time = *date_and_time};
-    date_and_time_union.fields.time                  = time;
-    *date_and_time                                   = date_and_time_union.date_and_time;
+    date_and_time_from_values(date_and_time, date_and_time_get_date(*date_and_time), time);
 }
@@ -31,30 +31,19 @@
 #include "utils/int_utils.h"
 
 /**
- * @union daytime_union_helper_t
- * @brief Time with `union`, to easily extract fields from a time integer.
+ * @struct daytime_fields_t
+ * @brief  Individual fields of a time, decoded from its representation in seconds.
  *
- * @var daytime_union_helper_t::daytime
- *     @brief Compact time format, exposed to the outside of this module.
- * @var daytime_union_helper_t::fields
- *     @brief Individual fields within ::daytime_union_helper_t::daytime.
- * @var daytime_union_helper_t::hours
- *     @brief Hour in @p ::daytime_union_helper_t::daytime. Must be between `0` and
- *            ::DAYTIME_HOURS_MAX.
- * @var daytime_union_helper_t::minutes
- *     @brief Minute in @p ::daytime_union_helper_t::daytime. Must be between `0` and
- *            ::DAYTIME_MINUTES_MAX.
- * @var daytime_union_helper_t::seconds
- *     @brief Second in @p ::daytime_union_helper_t::daytime. Must be between `0` and
- *            ::DAYTIME_SECONDS_MAX.
+ * @var daytime_fields_t::hours
+ *     @brief Hour of the time. Must be between `0` and ::DAYTIME_HOURS_MAX.
+ * @var daytime_fields_t::minutes
+ *     @brief Minute of the time. Must be between `0` and ::DAYTIME_MINUTES_MAX.
+ * @var daytime_fields_t::seconds
+ *     @brief Second of the time. Must be between `0` and ::DAYTIME_SECONDS_MAX.
  */
-typedef union {
-    const daytime_t daytime;
-
-    struct {
-        uint8_t hours, minutes, seconds;
-    } fields;
-} daytime_union_helper_t;
+typedef struct {
+    uint8_t hours, minutes, seconds;
+} daytime_fields_t;
 
 /** @brief The maximum value (inclusive) that hours in a time may take. */
 #define DAYTIME_HOURS_MAX   23
@@ -63,26 +52,42 @@ typedef union {
 /** @brief The maximum value (inclusive) that seconds in a time may take. */
 #define DAYTIME_SECONDS_MAX 59
 
-int daytime_from_values(daytime_t *output, uint8_t hours, uint8_t minutes, uint8_t seconds) {
-    daytime_union_helper_t daytime_union;
+/**
+ * @brief  Encodes the fields of a time into a number of seconds since midnight.
+ * @param  fields Fields to be encoded. Must be within range.
+ * @return The number of seconds since midnight.
+ */
+daytime_t __daytime_encode(daytime_fields_t fields) {
+    return (uint32_t) fields.hours * 3600 + (uint32_t) fields.minutes * 60 +
+           (uint32_t) fields.seconds;
+}
+
+/**
+ * @brief  Decodes a time in seconds since midnight into its individual fields.
+ * @param  daytime Time to be decoded.
+ * @return The fields of @p daytime.
+ */
+daytime_fields_t __daytime_decode(daytime_t daytime) {
+    return (daytime_fields_t) {.hours   = daytime / 3600,
+                               .minutes = daytime / 60 % 60,
+                               .seconds = daytime % 60};
+}
 
+int daytime_from_values(daytime_t *output, uint8_t hours, uint8_t minutes, uint8_t seconds) {
     if (hours > DAYTIME_HOURS_MAX || minutes > DAYTIME_MINUTES_MAX ||
         seconds > DAYTIME_SECONDS_MAX) {
         return 1;
     }
 
-    daytime_union.fields.hours   = hours;
-    daytime_union.fields.minutes = minutes;
-    daytime_union.fields.seconds = seconds;
-
-    *output = daytime_union.daytime;
+    *output = __daytime_encode(
+        (daytime_fields_t) {.hours = hours, .minutes = minutes, .seconds = seconds});
     return 0;
 }
 
 /**
  * @brief Auxiliary method for ::daytime_from_string. Parses any of the integers in a time.
  *
- * @param daytime_data A pointer to a ::daytime_union_helper_t, whose fields are filled in as the
+ * @param daytime_data A pointer to a ::daytime_fields_t, whose fields are filled in as the
  *                     time is parsed.
  * @param token        Number between colons to be parsed.
  * @param ntoken       Tokens already parsed (number of the current token, `0`-indexed).
@@ -91,12 +96,10 @@ int daytime_from_values(daytime_t *output, uint8_t hours, uint8_t minutes, uint8
  * @retval 1 Integer parsing failure.
  */
 int __daytime_from_string_parse_field(void *daytime_data, char *token, size_t ntoken) {
-    daytime_union_helper_t *const daytime = daytime_data;
+    daytime_fields_t *const daytime = daytime_data;
 
     const uint64_t maxs[3]    = {DAYTIME_HOURS_MAX, DAYTIME_MINUTES_MAX, DAYTIME_SECONDS_MAX};
-    uint8_t       *outputs[3] = {&daytime->fields.hours,
-                                 &daytime->fields.minutes,
-                                 &daytime->fields.seconds};
+    uint8_t       *outputs[3] = {&daytime->hours, &daytime->minutes, &daytime->seconds};
 
     const size_t token_length = strlen(token);
     if (token_length != 2)
@@ -122,6 +125,27 @@ int __daytime_from_string_parse_field(void *daytime_data, char *token, size_t nt
  *          -# Helps performance, as a new grammar doesn't need to be generated for every time to
  *             be parsed.
  */
+/**
+ * @brief   Parses a string containing a time in the format `"HH:MM:SS"`, without a grammar.
+ * @details Fast path for ::daytime_from_string, for valid times. Any other input makes this method
+ *          fail, so that it's handled (and its error reported) by the grammar instead.
+ *
+ * @param output Where the parsed time is placed. Won't be modified on failure.
+ * @param input  String to parse.
+ *
+ * @retval 0 Parsing success.
+ * @retval 1 @p input must be parsed by the grammar.
+ */
+int __daytime_from_string_fast(daytime_t *output, const char *input) {
+    uint64_t hours, minutes, seconds;
+    if (int_utils_parse_digits(&hours, input, 2) || input[2] != ':' ||
+        int_utils_parse_digits(&minutes, input + 3, 2) || input[5] != ':' ||
+        int_utils_parse_digits(&seconds, input + 6, 2) || input[8] != '\0')
+        return 1;
+
+    return daytime_from_values(output, hours, minutes, seconds);
+}
+
 fixed_n_delimiter_parser_grammar_t *__daytime_grammar = NULL;
 
 /** @brief Automatically initializes ::__daytime_grammar when the program starts. */
@@ -140,13 +164,16 @@ void __attribute__((destructor)) __daytime_grammar_free(void) {
 }
 
 int daytime_from_string(daytime_t *output, char *input) {
-    daytime_union_helper_t tmp_daytime;
-    const int              retval =
+    if (!__daytime_from_string_fast(output, input))
+        return 0;
+
+    daytime_fields_t tmp_daytime;
+    const int        retval =
         fixed_n_delimiter_parser_parse_string(input, __daytime_grammar, &tmp_daytime);
     if (retval) {
         return retval;
     } else {
-        *output = tmp_daytime.daytime;
+        *output = __daytime_encode(tmp_daytime);
         return 0;
     }
 }
@@ -163,41 +190,29 @@ int daytime_from_string_const(daytime_t *output, const char *input) {
 }
 
 void daytime_sprintf(char *output, daytime_t daytime) {
-    const daytime_union_helper_t daytime_union = {.daytime = daytime};
+    const daytime_fields_t fields = __daytime_decode(daytime);
 
-    sprintf(output,
-            "%02d:%02d:%02d",
-            daytime_union.fields.hours,
-            daytime_union.fields.minutes,
-            daytime_union.fields.seconds);
+    output += int_utils_sprintf_padded(output, fields.hours, 2);
+    *(output++) = ':';
+    output += int_utils_sprintf_padded(output, fields.minutes, 2);
+    *(output++) = ':';
+    int_utils_sprintf_padded(output, fields.seconds, 2);
 }
 
 int32_t daytime_diff(daytime_t a, daytime_t b) {
-    const daytime_union_helper_t a_union = {.daytime = a};
-    const daytime_union_helper_t b_union = {.daytime = b};
-
-    const uint32_t a_seconds = (uint32_t) a_union.fields.hours * 3600 +
-                               (uint32_t) a_union.fields.minutes * 60 +
-                               (uint32_t) a_union.fields.seconds;
-    const uint32_t b_seconds = (uint32_t) b_union.fields.hours * 3600 +
-                               (uint32_t) b_union.fields.minutes * 60 +
-                               (uint32_t) b_union.fields.seconds;
-
-    return a_seconds - b_seconds;
+    return (int32_t) a - (int32_t) b;
 }
 
 /**
  * @brief Helper macro for defining getters.
- * @param property Property to get in ::daytime_union_helper_t::fields.
+ * @param property Property to get in ::daytime_fields_t.
  */
-#define DAYTIME_GETTER_FUNCTION_BODY(property)                                                     \
-    const daytime_union_helper_t daytime_union = {.daytime = time};                                \
-    return daytime_union.fields.property;
+#define DAYTIME_GETTER_FUNCTION_BODY(property) return __daytime_decode(time).property;
 
 /**
  * @brief Helper macro for defining setters.
- * @param property    Property to set in ::daytime_union_helper_t::fields. Name must match the name
- *                    of the argument in the setter method.
+ * @param property    Property to set in ::daytime_fields_t. Name must match the name of the
+ *                    argument in the setter method.
  * @param upper_bound Maximum value (inclusive) that @p property can take.
  */
 #define DAYTIME_SETTER_FUNCTION_BODY(property, upper_bound)                                        \
@@ -205,9 +220,9 @@ int32_t daytime_diff(daytime_t a, daytime_t b) {
         return 1;                                                                                  \
     }                                                                                              \
                                                                                                    \
-    daytime_union_helper_t daytime_union = {.daytime = *time};                                     \
-    daytime_union.fields.property        = property;                                               \
-    *time                                = daytime_union.daytime;                                  \
+    daytime_fields_t fields = __daytime_decode(*time);                                             \
+    fields.property         = property;                                                            \
+    *time                   = __daytime_encode(fields);                                            \
     return 0;
 
 uint8_t daytime_get_hours(daytime_t time) {
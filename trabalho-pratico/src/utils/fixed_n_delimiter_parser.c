@@ -159,6 +159,41 @@ int fixed_n_delimiter_parser_parse_string(char
     }
 }
 
+int fixed_n_delimiter_parser_parse_slice(char                                     *input,
+                                         size_t                                    length,
+                                         const fixed_n_delimiter_parser_grammar_t *grammar,
+                                         void                                     *user_data) {
+
+    fixed_n_delimiter_parser_t parser = {.grammar     = grammar,
+                                         .token_count = 0,
+                                         .user_data   = user_data};
+
+    char *const end   = input + length;
+    char       *token = input;
+    while (1) {
+        /* memchr is vectorized by the C library, and doesn't need to look for '\0' */
+        char *const next = memchr(token, grammar->delimiter, end - token);
+        if (next)
+            *next = '\0';
+
+        const int cb_ret = __parse_string_iter(&parser, token);
+        if (next)
+            *next = grammar->delimiter; /* Restore string */
+
+        if (cb_ret)
+            return cb_ret;
+        if (!next)
+            break;
+        token = next + 1;
+    }
+
+    if (parser.token_count < grammar->n) {
+        return FIXED_N_DELIMITER_PARSER_PARSE_STRING_RET_NOT_ENOUGH_ITEMS;
+    } else {
+        return 0;
+    }
+}
+
 int fixed_n_delimiter_parser_parse_string_const(const char                               *input,
                                                 const fixed_n_delimiter_parser_grammar_t *grammar,
                                                 void *user_data) {
@@ -33,6 +33,10 @@ gconstpointer g_const_ptr_array_index(const GConstPtrArray *array, guint index)
     return g_ptr_array_index((GPtrArray *) (size_t) array, index);
 }
 
+void g_const_ptr_array_set(GConstPtrArray *array, guint index, gconstpointer data) {
+    g_ptr_array_index((GPtrArray *) array, index) = (gpointer) (size_t) data;
+}
+
 guint g_const_ptr_array_get_length(const GConstPtrArray *array) {
     return ((const GPtrArray *) array)->len;
 }
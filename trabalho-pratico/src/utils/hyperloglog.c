@@ -0,0 +1,140 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  hyperloglog.c
+ * @brief Implementation of methods in include/utils/hyperloglog.h
+ *
+ * ### Example
+ * See [the header file's documentation](@ref hyperloglog_example).
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "utils/hyperloglog.h"
+
+/**
+ * @struct hyperloglog
+ * @brief  Sketch for estimating the number of distinct elements in a set.
+ *
+ * @var hyperloglog::precision
+ *     @brief Base-2 logarithm of the number of registers.
+ * @var hyperloglog::registers
+ *     @brief   Largest rank seen in each register.
+ *     @details The rank of a hash is the position of the first set bit after the bits that select
+ *              the register (starting at `1`).
+ */
+struct hyperloglog {
+    unsigned int precision;
+    uint8_t      registers[];
+};
+
+uint64_t hyperloglog_hash_string(const char *str) {
+    /* FNV-1a, followed by a finalizer, as FNV's high bits (the register) mix poorly */
+    uint64_t hash = 0xcbf29ce484222325;
+    for (; *str; ++str)
+        hash = (hash ^ (uint8_t) *str) * 0x100000001b3;
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccd;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+hyperloglog_t *hyperloglog_create(unsigned int precision) {
+    if (precision < HYPERLOGLOG_MIN_PRECISION || precision > HYPERLOGLOG_MAX_PRECISION)
+        return NULL;
+
+    hyperloglog_t *const sketch = calloc(1, sizeof(hyperloglog_t) + ((size_t) 1 << precision));
+    if (!sketch)
+        return NULL;
+
+    sketch->precision = precision;
+    return sketch;
+}
+
+void hyperloglog_add(hyperloglog_t *sketch, uint64_t hash) {
+    const size_t register_index = hash >> (64 - sketch->precision);
+
+    /* Guard bit, so that the rank can't be larger than the number of remaining bits */
+    const uint64_t guard     = (uint64_t) 1 << (sketch->precision - 1);
+    const uint64_t remaining = (hash << sketch->precision) | guard;
+    const uint8_t  rank      = __builtin_clzll(remaining) + 1;
+
+    if (rank > sketch->registers[register_index])
+        sketch->registers[register_index] = rank;
+}
+
+int hyperloglog_merge(hyperloglog_t *sketch, const hyperloglog_t *other) {
+    if (sketch->precision != other->precision)
+        return 1;
+
+    const size_t m = (size_t) 1 << sketch->precision;
+    for (size_t i = 0; i < m; ++i)
+        if (other->registers[i] > sketch->registers[i])
+            sketch->registers[i] = other->registers[i];
+    return 0;
+}
+
+uint64_t hyperloglog_estimate(const hyperloglog_t *sketch) {
+    const size_t m = (size_t) 1 << sketch->precision;
+
+    double sum   = 0;
+    size_t zeros = 0;
+    for (size_t i = 0; i < m; ++i) {
+        sum += ldexp(1.0, -sketch->registers[i]);
+        zeros += !sketch->registers[i];
+    }
+
+    double alpha;
+    switch (m) {
+        case 16:
+            alpha = 0.673;
+            break;
+        case 32:
+            alpha = 0.697;
+            break;
+        case 64:
+            alpha = 0.709;
+            break;
+        default:
+            alpha = 0.7213 / (1.0 + 1.079 / m);
+            break;
+    }
+
+    /* Linear counting for small cardinalities, where the raw estimate is biased */
+    const double estimate = alpha * m * m / sum;
+    if (estimate <= 2.5 * m && zeros)
+        return round(m * log((double) m / zeros));
+
+    /* Hashes have 64 bits, so no large range correction is needed */
+    return round(estimate);
+}
+
+double hyperloglog_get_relative_error(const hyperloglog_t *sketch) {
+    return 1.04 / sqrt((double) ((size_t) 1 << sketch->precision));
+}
+
+size_t hyperloglog_get_size(const hyperloglog_t *sketch) {
+    return sizeof(hyperloglog_t) + ((size_t) 1 << sketch->precision);
+}
+
+void hyperloglog_free(hyperloglog_t *sketch) {
+    free(sketch);
+}
@@ -0,0 +1,553 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  id_table.c
+ * @brief Implementation of methods in include/utils/id_table.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref id_table_examples).
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/id_table.h"
+#include "utils/numa_topology.h"
+
+/** @brief Value of ::id_table_slot_t::value in empty slots. */
+#define ID_TABLE_EMPTY UINT32_MAX
+
+/** @brief Minimum number of slots in an ::id_table_t. Must be a power of two. */
+#define ID_TABLE_MIN_SLOTS 16
+
+/**
+ * @brief   Maximum ratio between the range of keys and the number of entries in a table for
+ *          ::id_table_compact to make it direct-indexed.
+ * @details At `2`, a direct-indexed array never takes more memory than the slots it replaces.
+ */
+#define ID_TABLE_DENSE_MAX_SPREAD 2
+
+/**
+ * @struct id_table_slot_t
+ * @brief  An entry in an ::id_table_t.
+ *
+ * @var id_table_slot_t::key
+ *     @brief Key of the entry. Only meaningful if ::id_table_slot_t::value isn't ::ID_TABLE_EMPTY.
+ * @var id_table_slot_t::value
+ *     @brief Value associated to ::id_table_slot_t::key, or ::ID_TABLE_EMPTY for empty slots.
+ */
+typedef struct {
+    uint32_t key;
+    uint32_t value;
+} id_table_slot_t;
+
+/**
+ * @struct id_table
+ * @brief  Hash table from 32-bit integer identifiers to 32-bit integer values.
+ *
+ * @var id_table::slots
+ *     @brief Array of ::id_table::mask + 1 slots (a power of two), or `NULL` when the table is
+ *            direct-indexed (see ::id_table::dense).
+ * @var id_table::mask
+ *     @brief Number of slots minus one, used to wrap slot indices around.
+ * @var id_table::shift
+ *     @brief Right shift that turns a 32-bit hash into a slot index.
+ * @var id_table::count
+ *     @brief Number of entries.
+ * @var id_table::dense
+ *     @brief   Values of a direct-indexed table, or `NULL` when the table is hashed.
+ *     @details The value of key `k` is at index `k - ::id_table::dense_first`, and missing keys
+ *              have the value ::ID_TABLE_EMPTY. See ::id_table_compact.
+ * @var id_table::dense_first
+ *     @brief Smallest key that fits in ::id_table::dense.
+ * @var id_table::dense_length
+ *     @brief Number of values in ::id_table::dense.
+ * @var id_table::replicas
+ *     @brief   Copy of the table on every NUMA node (see ::id_table_replicate), or `NULL` if it
+ *              isn't replicated.
+ *     @details Arrays of replicas are allocated with ::numa_topology_allocate, and replicas aren't
+ *              replicated themselves.
+ */
+struct id_table {
+    id_table_slot_t *slots;
+    size_t           mask;
+    unsigned int     shift;
+    size_t           count;
+
+    uint32_t *dense;
+    uint32_t  dense_first;
+    size_t    dense_length;
+
+    id_table_t **replicas;
+};
+
+/**
+ * @brief   Calculates the number of slots needed to store some entries in an ::id_table_t.
+ * @details The load factor is kept under `3/4`, so that probe sequences stay short.
+ *
+ * @param capacity  Number of entries to be stored.
+ * @param slots     Where to write the number of slots (a power of two) to.
+ * @param log_slots Where to write the base-2 logarithm of @p slots to.
+ */
+void __id_table_slots_for_capacity(size_t capacity, size_t *slots, unsigned int *log_slots) {
+    size_t       n   = ID_TABLE_MIN_SLOTS;
+    unsigned int log = 4;
+    while (n / 4 * 3 < capacity && log < 32) {
+        n <<= 1;
+        log++;
+    }
+
+    *slots     = n;
+    *log_slots = log;
+}
+
+/**
+ * @brief   Calculates the home slot of a key in an ::id_table_t.
+ * @details Uses Fibonacci hashing, so that sequential identifiers get spread across the table.
+ *
+ * @param table Table where @p key is going to be looked up.
+ * @param key   Key to be hashed.
+ *
+ * @return The index of the first slot where @p key may be.
+ */
+size_t __id_table_home_slot(const id_table_t *table, uint32_t key) {
+    return (uint32_t) (key * UINT32_C(2654435769)) >> table->shift;
+}
+
+/**
+ * @brief Finds the slot of a key in an ::id_table_t, or the empty slot where it would be inserted.
+ *
+ * @param table Table to search in.
+ * @param key   Key to be searched for.
+ *
+ * @return The index of the found slot.
+ */
+size_t __id_table_find_slot(const id_table_t *table, uint32_t key) {
+    size_t i = __id_table_home_slot(table, key);
+    while (table->slots[i].value != ID_TABLE_EMPTY && table->slots[i].key != key)
+        i = (i + 1) & table->mask;
+    return i;
+}
+
+/**
+ * @brief Replaces the slots of an ::id_table_t with a new (empty) array of slots.
+ *
+ * @param table     Table to be modified. Its old slots aren't freed.
+ * @param slots     Number of slots (a power of two).
+ * @param log_slots Base-2 logarithm of @p slots.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p table is left unchanged).
+ */
+int __id_table_allocate_slots(id_table_t *table, size_t slots, unsigned int log_slots) {
+    id_table_slot_t *const new_slots = malloc(slots * sizeof(id_table_slot_t));
+    if (!new_slots)
+        return 1;
+
+    memset(new_slots, 0xFF, slots * sizeof(id_table_slot_t)); /* All values are ID_TABLE_EMPTY */
+    table->slots = new_slots;
+    table->mask  = slots - 1;
+    table->shift = 32 - log_slots;
+    return 0;
+}
+
+id_table_t *id_table_create(size_t capacity) {
+    id_table_t *const table = malloc(sizeof(id_table_t));
+    if (!table)
+        return NULL;
+
+    size_t       slots;
+    unsigned int log_slots;
+    __id_table_slots_for_capacity(capacity, &slots, &log_slots);
+    if (__id_table_allocate_slots(table, slots, log_slots)) {
+        free(table);
+        return NULL;
+    }
+
+    table->count        = 0;
+    table->dense        = NULL;
+    table->dense_first  = 0;
+    table->dense_length = 0;
+    table->replicas     = NULL;
+    return table;
+}
+
+/**
+ * @brief   Frees the copies of a table on every NUMA node.
+ * @details Called before a table is modified, as its copies would become outdated.
+ * @param   table Table that may be replicated (see ::id_table_replicate).
+ */
+void __id_table_free_replicas(id_table_t *table) {
+    if (!table->replicas)
+        return;
+
+    for (size_t i = 0; i < numa_topology_get_node_count(); ++i) {
+        id_table_t *const replica = table->replicas[i];
+        if (replica) {
+            numa_topology_free(replica->slots, (replica->mask + 1) * sizeof(id_table_slot_t));
+            numa_topology_free(replica->dense, replica->dense_length * sizeof(uint32_t));
+            free(replica);
+        }
+    }
+    free(table->replicas);
+    table->replicas = NULL;
+}
+
+/**
+ * @brief  Gets the copy of a table that's closest to the calling thread.
+ * @param  table Table that may be replicated (see ::id_table_replicate).
+ * @return The copy of @p table on the calling thread's NUMA node, or @p table itself if it isn't
+ *         replicated.
+ */
+const id_table_t *__id_table_get_local(const id_table_t *table) {
+    return table->replicas ? table->replicas[numa_topology_get_current_node()] : table;
+}
+
+/**
+ * @brief Gets the index of a key in ::id_table::dense.
+ *
+ * @param table Direct-indexed table.
+ * @param key   Key to be found.
+ *
+ * @return The index of @p key in ::id_table::dense, that is out of bounds (at least
+ *         ::id_table::dense_length) if @p key doesn't fit in the array.
+ */
+size_t __id_table_dense_offset(const id_table_t *table, uint32_t key) {
+    return (uint32_t) (key - table->dense_first); /* Keys before the first one wrap around */
+}
+
+/**
+ * @brief   Turns a direct-indexed table back into a hashed one.
+ * @details Auxiliary method for methods that need to store keys outside of ::id_table::dense.
+ *
+ * @param table    Direct-indexed table to be modified.
+ * @param capacity Number of entries the new slots must fit (at least the current number).
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p table is left unchanged).
+ */
+int __id_table_undensify(id_table_t *table, size_t capacity) {
+    size_t       slots;
+    unsigned int log_slots;
+    __id_table_slots_for_capacity(capacity > table->count ? capacity : table->count,
+                                  &slots,
+                                  &log_slots);
+    if (__id_table_allocate_slots(table, slots, log_slots))
+        return 1;
+
+    for (size_t i = 0; i < table->dense_length; ++i) {
+        if (table->dense[i] != ID_TABLE_EMPTY) {
+            const uint32_t key = table->dense_first + i;
+            table->slots[__id_table_find_slot(table, key)] =
+                (id_table_slot_t) {.key = key, .value = table->dense[i]};
+        }
+    }
+
+    free(table->dense);
+    table->dense        = NULL;
+    table->dense_first  = 0;
+    table->dense_length = 0;
+    return 0;
+}
+
+/**
+ * @brief Moves all entries of an ::id_table_t to a new array of slots.
+ *
+ * @param table     Table to be modified.
+ * @param slots     Number of slots (a power of two, enough for all entries in @p table).
+ * @param log_slots Base-2 logarithm of @p slots.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p table is left unchanged).
+ */
+int __id_table_rehash(id_table_t *table, size_t slots, unsigned int log_slots) {
+    id_table_slot_t *const old_slots  = table->slots;
+    const size_t           old_length = table->mask + 1;
+    if (__id_table_allocate_slots(table, slots, log_slots))
+        return 1;
+
+    for (size_t i = 0; i < old_length; ++i)
+        if (old_slots[i].value != ID_TABLE_EMPTY)
+            table->slots[__id_table_find_slot(table, old_slots[i].key)] = old_slots[i];
+
+    free(old_slots);
+    return 0;
+}
+
+int id_table_reserve(id_table_t *table, size_t capacity) {
+    __id_table_free_replicas(table);
+    if (table->dense) /* New keys may not fit in the array */
+        return capacity > table->count && __id_table_undensify(table, capacity);
+
+    size_t       slots;
+    unsigned int log_slots;
+    __id_table_slots_for_capacity(capacity, &slots, &log_slots);
+    if (slots <= table->mask + 1)
+        return 0;
+
+    return __id_table_rehash(table, slots, log_slots);
+}
+
+int id_table_shrink_to_fit(id_table_t *table) {
+    __id_table_free_replicas(table);
+    if (table->dense)
+        return 0;
+
+    size_t       slots;
+    unsigned int log_slots;
+    __id_table_slots_for_capacity(table->count, &slots, &log_slots);
+    if (slots >= table->mask + 1)
+        return 0;
+
+    return __id_table_rehash(table, slots, log_slots);
+}
+
+int id_table_compact(id_table_t *table) {
+    __id_table_free_replicas(table);
+    if (table->dense)
+        return 0;
+
+    uint32_t first = UINT32_MAX, last = 0;
+    for (size_t i = 0; i <= table->mask; ++i) {
+        if (table->slots[i].value != ID_TABLE_EMPTY) {
+            first = table->slots[i].key < first ? table->slots[i].key : first;
+            last  = table->slots[i].key > last ? table->slots[i].key : last;
+        }
+    }
+
+    /* Direct indexing is only an optimization: fall back to hashing if it isn't worth it */
+    const size_t length = table->count ? (size_t) last - first + 1 : 0;
+    if (!table->count || length > table->count * ID_TABLE_DENSE_MAX_SPREAD)
+        return id_table_shrink_to_fit(table);
+
+    uint32_t *const dense = malloc(length * sizeof(uint32_t));
+    if (!dense)
+        return id_table_shrink_to_fit(table);
+
+    memset(dense, 0xFF, length * sizeof(uint32_t)); /* All values are ID_TABLE_EMPTY */
+    for (size_t i = 0; i <= table->mask; ++i)
+        if (table->slots[i].value != ID_TABLE_EMPTY)
+            dense[table->slots[i].key - first] = table->slots[i].value;
+
+    free(table->slots);
+    table->slots        = NULL;
+    table->mask         = 0;
+    table->shift        = 0;
+    table->dense        = dense;
+    table->dense_first  = first;
+    table->dense_length = length;
+    return 0;
+}
+
+/**
+ * @brief   Associates a value to a key in a direct-indexed table.
+ * @details Auxiliary method for ::id_table_insert.
+ *
+ * @param table Direct-indexed table to insert the association in.
+ * @param key   Key to be inserted.
+ * @param value Value associated to @p key.
+ *
+ * @retval 0 Success (@p key wasn't in @p table before).
+ * @retval 1 Allocation failure (@p table is left unchanged).
+ * @retval 2 Success (@p key was already in @p table, and its value was replaced).
+ */
+int __id_table_dense_insert(id_table_t *table, uint32_t key, uint32_t value) {
+    const size_t offset = __id_table_dense_offset(table, key);
+    if (offset >= table->dense_length) {
+        if (__id_table_undensify(table, table->count + 1))
+            return 1;
+        return id_table_insert(table, key, value);
+    }
+
+    const int replaced   = table->dense[offset] != ID_TABLE_EMPTY;
+    table->dense[offset] = value;
+    if (!replaced)
+        table->count++;
+    return replaced ? 2 : 0;
+}
+
+int id_table_insert(id_table_t *table, uint32_t key, uint32_t value) {
+    __id_table_free_replicas(table);
+    if (table->dense)
+        return __id_table_dense_insert(table, key, value);
+
+    size_t i = __id_table_find_slot(table, key);
+    if (table->slots[i].value != ID_TABLE_EMPTY) {
+        table->slots[i].value = value;
+        return 2;
+    }
+
+    if ((table->count + 1) > (table->mask + 1) / 4 * 3) {
+        if (id_table_reserve(table, (table->mask + 1) / 4 * 3 + 1))
+            return 1;
+        i = __id_table_find_slot(table, key);
+    }
+
+    table->slots[i] = (id_table_slot_t) {.key = key, .value = value};
+    table->count++;
+    return 0;
+}
+
+/**
+ * @brief   Copies a table to a NUMA node.
+ * @details Auxiliary method for ::id_table_replicate.
+ *
+ * @param table Table to be copied.
+ * @param node  NUMA node to copy @p table to.
+ *
+ * @return The copy of @p table, or `NULL` on allocation failure.
+ */
+id_table_t *__id_table_replicate_on_node(const id_table_t *table, size_t node) {
+    id_table_t *const replica = malloc(sizeof(id_table_t));
+    if (!replica)
+        return NULL;
+
+    *replica          = *table;
+    replica->replicas = NULL;
+
+    /* Each replica only has one of the arrays */
+    const void  *source = table->dense ? (const void *) table->dense : (const void *) table->slots;
+    const size_t size   = table->dense ? table->dense_length * sizeof(uint32_t)
+                                       : (table->mask + 1) * sizeof(id_table_slot_t);
+    void *const  copy   = size ? numa_topology_allocate(size, node) : NULL;
+    if (size && !copy) {
+        free(replica);
+        return NULL;
+    }
+
+    if (size)
+        memcpy(copy, source, size);
+    if (table->dense)
+        replica->dense = copy;
+    else
+        replica->slots = copy;
+    return replica;
+}
+
+int id_table_replicate(id_table_t *table) {
+    __id_table_free_replicas(table);
+
+    const size_t nodes = numa_topology_get_node_count();
+    if (nodes == 1)
+        return 0;
+
+    table->replicas = calloc(nodes, sizeof(id_table_t *));
+    if (!table->replicas)
+        return 1;
+
+    for (size_t i = 0; i < nodes; ++i) {
+        table->replicas[i] = __id_table_replicate_on_node(table, i);
+        if (!table->replicas[i]) {
+            __id_table_free_replicas(table);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int id_table_lookup(const id_table_t *table, uint32_t key, uint32_t *value) {
+    table = __id_table_get_local(table);
+    if (table->dense) {
+        const size_t offset = __id_table_dense_offset(table, key);
+        if (offset >= table->dense_length || table->dense[offset] == ID_TABLE_EMPTY)
+            return 1;
+
+        *value = table->dense[offset];
+        return 0;
+    }
+
+    const id_table_slot_t *const slot = &table->slots[__id_table_find_slot(table, key)];
+    if (slot->value == ID_TABLE_EMPTY)
+        return 1;
+
+    *value = slot->value;
+    return 0;
+}
+
+void id_table_prefetch(const id_table_t *table, uint32_t key) {
+    table = __id_table_get_local(table);
+    if (table->dense) {
+        const size_t offset = __id_table_dense_offset(table, key);
+        if (offset < table->dense_length)
+            __builtin_prefetch(&table->dense[offset], 1);
+    } else {
+        __builtin_prefetch(&table->slots[__id_table_home_slot(table, key)], 1);
+    }
+}
+
+int id_table_remove(id_table_t *table, uint32_t key) {
+    __id_table_free_replicas(table);
+    if (table->dense) {
+        const size_t offset = __id_table_dense_offset(table, key);
+        if (offset >= table->dense_length || table->dense[offset] == ID_TABLE_EMPTY)
+            return 1;
+
+        table->dense[offset] = ID_TABLE_EMPTY;
+        table->count--;
+        return 0;
+    }
+
+    size_t i = __id_table_find_slot(table, key);
+    if (table->slots[i].value == ID_TABLE_EMPTY)
+        return 1;
+
+    /*
+     * Backward shift deletion: move later entries in the same probe sequence into the hole, so
+     * that no tombstones are needed. An entry at j can fill the hole at i if its home slot isn't
+     * cyclically in (i, j].
+     */
+    size_t j = i;
+    while (1) {
+        j = (j + 1) & table->mask;
+        if (table->slots[j].value == ID_TABLE_EMPTY)
+            break;
+
+        const size_t home = __id_table_home_slot(table, table->slots[j].key);
+        if (((j - home) & table->mask) >= ((j - i) & table->mask)) {
+            table->slots[i] = table->slots[j];
+            i               = j;
+        }
+    }
+
+    table->slots[i].value = ID_TABLE_EMPTY;
+    table->count--;
+    return 0;
+}
+
+void id_table_get_memory_usage(const id_table_t *table, memory_usage_t *out) {
+    const size_t copies = table->replicas ? numa_topology_get_node_count() + 1 : 1;
+    if (table->dense) {
+        out->blocks         = copies;
+        out->reserved_bytes = copies * table->dense_length * sizeof(uint32_t);
+        out->used_bytes     = copies * table->count * sizeof(uint32_t);
+        out->wasted_bytes   = 0;
+        return;
+    }
+
+    out->blocks         = copies;
+    out->reserved_bytes = copies * (table->mask + 1) * sizeof(id_table_slot_t);
+    out->used_bytes     = copies * table->count * sizeof(id_table_slot_t);
+    out->wasted_bytes   = 0;
+}
+
+void id_table_free(id_table_t *table) {
+    __id_table_free_replicas(table);
+    free(table->slots);
+    free(table->dense);
+    free(table);
+}
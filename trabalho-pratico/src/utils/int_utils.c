@@ -22,6 +22,8 @@
  * See [the header file's documentation](@ref int_utils_examples).
  */
 
+#include <string.h>
+
 #include "utils/int_utils.h"
 
 int int_utils_parse_positive(uint64_t *output, const char *input) {
@@ -47,3 +49,47 @@ int int_utils_parse_positive(uint64_t *output, const char *input) {
     *output = acc;
     return 0;
 }
+
+int int_utils_parse_digits(uint64_t *output, const char *input, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const unsigned int d = (unsigned char) input[i] - '0';
+        if (d >= 10)
+            return 1;
+        acc = acc * 10 + d;
+    }
+
+    *output = acc;
+    return 0;
+}
+
+size_t int_utils_sprintf_padded(char *output, uint64_t value, size_t width) {
+    /* Write digits backwards to a temporary buffer */
+    char  digits[INT_UTILS_SPRINTF_MIN_BUFFER_SIZE];
+    char *digit = digits + INT_UTILS_SPRINTF_MIN_BUFFER_SIZE;
+    do {
+        *(--digit) = '0' + (value % 10);
+        value /= 10;
+    } while (value);
+
+    const size_t ndigits = (size_t) (digits + INT_UTILS_SPRINTF_MIN_BUFFER_SIZE - digit);
+    const size_t padding = width > ndigits ? width - ndigits : 0;
+
+    memset(output, '0', padding);
+    memcpy(output + padding, digit, ndigits);
+    output[padding + ndigits] = '\0';
+    return padding + ndigits;
+}
+
+size_t int_utils_sprintf_unsigned(char *output, uint64_t value) {
+    return int_utils_sprintf_padded(output, value, 0);
+}
+
+size_t int_utils_sprintf_signed(char *output, int64_t value) {
+    if (value >= 0)
+        return int_utils_sprintf_padded(output, (uint64_t) value, 0);
+
+    /* Conversion to unsigned before negation, so that INT64_MIN doesn't overflow */
+    *output = '-';
+    return 1 + int_utils_sprintf_padded(output + 1, -(uint64_t) value, 0);
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  mapped_file.c
+ * @brief Implementation of methods in include/utils/mapped_file.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref mapped_file_examples).
+ */
+
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE /* For MADV_DONTNEED */
+#endif
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/mapped_file.h"
+
+/**
+ * @struct mapped_file
+ * @brief  A read-only memory mapping of a file, with a reference counter.
+ *
+ * @var mapped_file::data
+ *     @brief Start of the mapping.
+ * @var mapped_file::size
+ *     @brief Number of bytes in ::mapped_file::data.
+ * @var mapped_file::references
+ *     @brief Number of users of the mapping, changed atomically.
+ * @var mapped_file::access
+ *     @brief Usual access pattern of the mapping (see ::mapped_file_set_access). Accessed
+ *            atomically.
+ * @var mapped_file::scans
+ *     @brief Number of scans running (see ::mapped_file_begin_scan), changed atomically.
+ */
+struct mapped_file {
+    const char          *data;
+    size_t               size;
+    size_t               references;
+    mapped_file_access_t access;
+    size_t               scans;
+};
+
+mapped_file_t *mapped_file_open(const char *path) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) || file_stat.st_size == 0) { /* mmap refuses empty mappings */
+        close(fd);
+        return NULL;
+    }
+
+    const size_t size = file_stat.st_size;
+    void *const  map  = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    mapped_file_t *const file = malloc(sizeof(mapped_file_t));
+    if (!file) {
+        munmap(map, size);
+        return NULL;
+    }
+
+    file->data       = map;
+    file->size       = size;
+    file->references = 1;
+    file->access     = MAPPED_FILE_ACCESS_NORMAL;
+    file->scans      = 0;
+    return file;
+}
+
+const char *mapped_file_get_data(const mapped_file_t *file) {
+    return file->data;
+}
+
+size_t mapped_file_get_size(const mapped_file_t *file) {
+    return file->size;
+}
+
+int mapped_file_contains(const mapped_file_t *file, const char *ptr) {
+    /* Compare addresses as integers, as pointers to different objects can't be compared */
+    return (uintptr_t) ptr - (uintptr_t) file->data < file->size;
+}
+
+/**
+ * @brief Advises the kernel on how pages of a mapped file will be accessed.
+ * @param file   Mapped file.
+ * @param access Access pattern of @p file.
+ */
+void __mapped_file_advise(mapped_file_t *file, mapped_file_access_t access) {
+    const int advice[] = {POSIX_MADV_NORMAL, POSIX_MADV_RANDOM, POSIX_MADV_SEQUENTIAL};
+
+    /* Only a hint, so failure is ignored */
+    posix_madvise((void *) (uintptr_t) file->data, file->size, advice[access]);
+}
+
+void mapped_file_set_access(mapped_file_t *file, mapped_file_access_t access) {
+    __atomic_store_n(&file->access, access, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&file->scans, __ATOMIC_RELAXED) == 0)
+        __mapped_file_advise(file, access);
+}
+
+void mapped_file_evict(mapped_file_t *file) {
+    madvise((void *) (uintptr_t) file->data, file->size, MADV_DONTNEED); /* Clean pages only */
+}
+
+void mapped_file_begin_scan(mapped_file_t *file) {
+    if (file && __atomic_fetch_add(&file->scans, 1, __ATOMIC_RELAXED) == 0 &&
+        __atomic_load_n(&file->access, __ATOMIC_RELAXED) != MAPPED_FILE_ACCESS_NORMAL)
+        __mapped_file_advise(file, MAPPED_FILE_ACCESS_SEQUENTIAL);
+}
+
+void mapped_file_end_scan(mapped_file_t *file) {
+    if (!file || __atomic_sub_fetch(&file->scans, 1, __ATOMIC_RELAXED))
+        return;
+
+    /* A scan starting meanwhile may run with the usual access pattern, which is only slower */
+    const mapped_file_access_t access = __atomic_load_n(&file->access, __ATOMIC_RELAXED);
+    if (access != MAPPED_FILE_ACCESS_NORMAL)
+        __mapped_file_advise(file, access);
+}
+
+mapped_file_t *mapped_file_ref(mapped_file_t *file) {
+    __atomic_add_fetch(&file->references, 1, __ATOMIC_RELAXED);
+    return file;
+}
+
+void mapped_file_unref(mapped_file_t *file) {
+    if (file && __atomic_sub_fetch(&file->references, 1, __ATOMIC_ACQ_REL) == 0) {
+        munmap((void *) (uintptr_t) file->data, file->size);
+        free(file);
+    }
+}
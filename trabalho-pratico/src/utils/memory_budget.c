@@ -0,0 +1,125 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  memory_budget.c
+ * @brief Implementation of methods in include/utils/memory_budget.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref memory_budget_examples).
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "utils/memory_budget.h"
+
+/** @brief Number of values in ::memory_budget_degradation_t. */
+#define MEMORY_BUDGET_DEGRADATION_COUNT 4
+
+/** @brief Descriptions of every ::memory_budget_degradation_t, reported when they kick in. */
+const char *const memory_budget_degradation_names[MEMORY_BUDGET_DEGRADATION_COUNT] = {
+    "optional indexes are no longer built eagerly",
+    "caches of statistical data and query outputs are emptied",
+    "statistical data is generated by scanning instead of indexing",
+    "statistical data is approximated"};
+
+/** @brief Memory budget in bytes (`0` for no limit), read once from the environment. */
+size_t memory_budget_limit = 0;
+
+/** @brief Guarantees ::memory_budget_limit is only set once. */
+pthread_once_t memory_budget_once = PTHREAD_ONCE_INIT;
+
+/** @brief Bytes charged to the budget. Accessed atomically. */
+size_t memory_budget_used = 0;
+
+/** @brief Bitwise OR of the degradations that kicked in. Accessed atomically. */
+unsigned int memory_budget_degradations = 0;
+
+/**
+ * @brief   Reads the memory budget from the environment and sets ::memory_budget_limit.
+ * @details Auxiliary method for ::memory_budget_get_limit, called through `pthread_once`.
+ */
+void __memory_budget_read_limit(void) {
+    const char *const limit_env = getenv(MEMORY_BUDGET_ENVIRONMENT_VARIABLE);
+    if (!limit_env)
+        return;
+
+    char *end;
+    errno                          = 0;
+    const unsigned long long limit = strtoull(limit_env, &end, 10);
+    if (errno || *end || end == limit_env || limit > SIZE_MAX >> 20) {
+        fputs("Invalid memory budget! Memory won't be limited.\n", stderr);
+        return;
+    }
+
+    memory_budget_limit = (size_t) limit << 20;
+}
+
+size_t memory_budget_get_limit(void) {
+    pthread_once(&memory_budget_once, __memory_budget_read_limit);
+    return memory_budget_limit;
+}
+
+size_t memory_budget_get_used(void) {
+    return __atomic_load_n(&memory_budget_used, __ATOMIC_RELAXED);
+}
+
+int memory_budget_reserve(size_t bytes) {
+    const size_t limit = memory_budget_get_limit();
+    const size_t used  = __atomic_add_fetch(&memory_budget_used, bytes, __ATOMIC_RELAXED);
+    if (limit && used > limit) {
+        __atomic_sub_fetch(&memory_budget_used, bytes, __ATOMIC_RELAXED);
+        return 1;
+    }
+    return 0;
+}
+
+void memory_budget_release(size_t bytes) {
+    __atomic_sub_fetch(&memory_budget_used, bytes, __ATOMIC_RELAXED);
+}
+
+int memory_budget_is_under_pressure(void) {
+    const size_t limit = memory_budget_get_limit();
+    return limit && memory_budget_get_used() > limit / 100 * MEMORY_BUDGET_PRESSURE_PERCENT;
+}
+
+int memory_budget_should_degrade(memory_budget_degradation_t degradation) {
+    if (!memory_budget_is_under_pressure())
+        return 0;
+
+    const unsigned int previous =
+        __atomic_fetch_or(&memory_budget_degradations, degradation, __ATOMIC_RELAXED);
+    if (!(previous & degradation)) {
+        size_t i = 0;
+        while (i < MEMORY_BUDGET_DEGRADATION_COUNT - 1 && !(degradation & (1u << i)))
+            i++;
+
+        fprintf(stderr,
+                "Memory budget: %zu of %zu MiB used, %s\n",
+                memory_budget_get_used() >> 20,
+                memory_budget_get_limit() >> 20,
+                memory_budget_degradation_names[i]);
+    }
+    return 1;
+}
+
+unsigned int memory_budget_get_degradations(void) {
+    return __atomic_load_n(&memory_budget_degradations, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  memory_report.c
+ * @brief Implementation of methods in include/utils/memory_report.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref memory_report_examples).
+ */
+
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/memory_report.h"
+
+/**
+ * @struct memory_report_entry_t
+ * @brief  A named ::memory_usage_t in a ::memory_report_t.
+ *
+ * @var memory_report_entry_t::name
+ *     @brief Name of the data structure (owned by the report).
+ * @var memory_report_entry_t::usage
+ *     @brief Memory accounting counters of the data structure.
+ */
+typedef struct {
+    char          *name;
+    memory_usage_t usage;
+} memory_report_entry_t;
+
+/**
+ * @struct memory_report
+ * @brief  A list of named ::memory_usage_t.
+ *
+ * @var memory_report::entries
+ *     @brief Array of ::memory_report_entry_t, in the order they were added.
+ */
+struct memory_report {
+    GArray *entries;
+};
+
+/** @brief Minimum number of buckets in a `GHashTable`. */
+#define MEMORY_REPORT_HASH_TABLE_MIN_BUCKETS 8
+
+void memory_usage_add(memory_usage_t *total, const memory_usage_t *usage) {
+    total->blocks += usage->blocks;
+    total->reserved_bytes += usage->reserved_bytes;
+    total->used_bytes += usage->used_bytes;
+    total->wasted_bytes += usage->wasted_bytes;
+}
+
+void memory_usage_add_arrays(memory_usage_t *usage, size_t n, GArray *const arrays[n]) {
+    for (size_t i = 0; i < n; ++i) {
+        const size_t bytes = arrays[i]->len * g_array_get_element_size(arrays[i]);
+        usage->blocks++;
+        usage->reserved_bytes += bytes;
+        usage->used_bytes += bytes;
+    }
+}
+
+size_t memory_report_estimate_hash_table(size_t entries) {
+    /* GLib resizes its tables when they're more than 3/4 full */
+    size_t buckets = MEMORY_REPORT_HASH_TABLE_MIN_BUCKETS;
+    while (buckets * 3 / 4 < entries)
+        buckets *= 2;
+
+    return buckets * (sizeof(gpointer) * 2 + sizeof(guint));
+}
+
+/**
+ * @brief Frees the name in a ::memory_report_entry_t, when it's removed from a ::memory_report_t.
+ * @param entry Entry to be cleared.
+ */
+void __memory_report_entry_clear(void *entry) {
+    free(((memory_report_entry_t *) entry)->name);
+}
+
+memory_report_t *memory_report_create(void) {
+    memory_report_t *const report = malloc(sizeof(memory_report_t));
+    if (!report)
+        return NULL;
+
+    report->entries = g_array_new(FALSE, FALSE, sizeof(memory_report_entry_t));
+    g_array_set_clear_func(report->entries, __memory_report_entry_clear);
+    return report;
+}
+
+memory_report_t *memory_report_clone(const memory_report_t *report) {
+    memory_report_t *const clone = memory_report_create();
+    if (!clone)
+        return NULL;
+
+    for (size_t i = 0; i < report->entries->len; ++i) {
+        const memory_report_entry_t *const entry =
+            &g_array_index(report->entries, memory_report_entry_t, i);
+
+        if (memory_report_add(clone, entry->name, &entry->usage)) {
+            memory_report_free(clone);
+            return NULL;
+        }
+    }
+
+    return clone;
+}
+
+int memory_report_add(memory_report_t *report, const char *name, const memory_usage_t *usage) {
+    memory_report_entry_t entry = {.name = strdup(name), .usage = *usage};
+    if (!entry.name)
+        return 1;
+
+    g_array_append_val(report->entries, entry);
+    return 0;
+}
+
+int memory_report_add_allocation(memory_report_t *report,
+                                 const char      *name,
+                                 size_t           reserved_bytes,
+                                 size_t           used_bytes) {
+    const memory_usage_t usage = {.blocks         = reserved_bytes ? 1 : 0,
+                                  .reserved_bytes = reserved_bytes,
+                                  .used_bytes     = used_bytes,
+                                  .wasted_bytes   = 0};
+    return memory_report_add(report, name, &usage);
+}
+
+size_t memory_report_get_count(const memory_report_t *report) {
+    return report->entries->len;
+}
+
+const char *memory_report_get_name(const memory_report_t *report, size_t i) {
+    return g_array_index(report->entries, memory_report_entry_t, i).name;
+}
+
+const memory_usage_t *memory_report_get_usage(const memory_report_t *report, size_t i) {
+    return &g_array_index(report->entries, memory_report_entry_t, i).usage;
+}
+
+void memory_report_get_total(const memory_report_t *report, memory_usage_t *out) {
+    *out = (memory_usage_t) {0};
+    for (size_t i = 0; i < report->entries->len; ++i)
+        memory_usage_add(out, &g_array_index(report->entries, memory_report_entry_t, i).usage);
+}
+
+void memory_report_free(memory_report_t *report) {
+    g_array_unref(report->entries);
+    free(report);
+}
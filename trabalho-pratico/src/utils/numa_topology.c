@@ -0,0 +1,388 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  numa_topology.c
+ * @brief Implementation of methods in include/utils/numa_topology.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref numa_topology_examples).
+ */
+
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE /* For syscall and MAP_ANONYMOUS */
+#endif
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "utils/int_utils.h"
+#include "utils/numa_topology.h"
+
+/** @brief Maximum number of CPUs that threads can be pinned to. */
+#define NUMA_TOPOLOGY_MAX_CPUS 1024
+
+/** @brief Number of bits in an `unsigned long`, the unit of CPU and node masks in system calls. */
+#define NUMA_TOPOLOGY_LONG_BITS (sizeof(unsigned long) * CHAR_BIT)
+
+/** @brief Memory policy (for `mbind`) that prefers allocating pages on a node. */
+#define NUMA_TOPOLOGY_MPOL_PREFERRED 1
+
+/** @brief Memory policy (for `mbind`) that spreads pages among nodes. */
+#define NUMA_TOPOLOGY_MPOL_INTERLEAVE 3
+
+/** @brief Flag for `mbind` to migrate pages already in memory. */
+#define NUMA_TOPOLOGY_MPOL_MF_MOVE 2
+
+/** @brief Mask of the CPUs in a NUMA node, in the format of `sched_setaffinity`. */
+typedef unsigned long numa_topology_cpu_mask_t[NUMA_TOPOLOGY_MAX_CPUS / NUMA_TOPOLOGY_LONG_BITS];
+
+/** @brief Number of NUMA nodes, set once by ::__numa_topology_read. */
+size_t numa_topology_node_count = 1;
+
+/** @brief CPUs of each NUMA node, set once by ::__numa_topology_read. */
+numa_topology_cpu_mask_t numa_topology_node_cpus[NUMA_TOPOLOGY_MAX_NODES];
+
+/** @brief Guarantees the topology is only read once. */
+pthread_once_t numa_topology_once = PTHREAD_ONCE_INIT;
+
+/** @brief CPUs threads are allowed to run on, set once by ::__numa_topology_read_cpus. */
+numa_topology_cpu_mask_t numa_topology_cpus;
+
+/** @brief Number of bits set in ::numa_topology_cpus. */
+size_t numa_topology_cpu_count = 1;
+
+/** @brief Guarantees ::numa_topology_cpus is only read from the kernel once. */
+pthread_once_t numa_topology_cpus_once = PTHREAD_ONCE_INIT;
+
+/** @brief Node the calling thread was pinned to, or `SIZE_MAX` if it wasn't pinned. */
+__thread size_t numa_topology_thread_node = SIZE_MAX;
+
+/**
+ * @brief   Parses a list of numbers, such as `0-3,8-11`, into a bit mask.
+ * @details Auxiliary method for ::__numa_topology_parse_list_file and ::numa_topology_set_cpus.
+ *
+ * @param str  List to be parsed. Parsing stops at its end, or at a newline.
+ * @param mask Where to set the bits of the numbers in the list. Must be zeroed.
+ * @param bits Number of bits in @p mask. Numbers that don't fit are an error.
+ *
+ * @retval 0 Success.
+ * @retval 1 @p str isn't a list of numbers that fit in @p mask.
+ */
+int __numa_topology_parse_list(const char *str, unsigned long *mask, size_t bits) {
+    while (*str && *str != '\n') {
+        char               *end;
+        const unsigned long first = strtoul(str, &end, 10);
+        unsigned long       last  = first;
+        if (end == str || *str == '-' || *str == '+')
+            return 1;
+
+        if (*end == '-') {
+            str  = end + 1;
+            last = strtoul(str, &end, 10);
+            if (end == str || *str == '-' || *str == '+')
+                return 1;
+        }
+
+        if (last >= bits || first > last)
+            return 1;
+        for (unsigned long i = first; i <= last; ++i)
+            mask[i / NUMA_TOPOLOGY_LONG_BITS] |= 1UL << (i % NUMA_TOPOLOGY_LONG_BITS);
+
+        if (*end == ',')
+            str = end + 1;
+        else if (*end && *end != '\n')
+            return 1;
+        else
+            str = end;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Parses a list of numbers in a `sysfs` file, such as `0-3,8-11`, into a bit mask.
+ * @details Auxiliary method for ::__numa_topology_read.
+ *
+ * @param path Path to the file to be parsed.
+ * @param mask Where to set the bits of the numbers in the list. Must be zeroed.
+ * @param bits Number of bits in @p mask. Numbers that don't fit are an error.
+ *
+ * @retval 0 Success.
+ * @retval 1 IO failure, or the file isn't a list of numbers that fit in @p mask.
+ */
+int __numa_topology_parse_list_file(const char *path, unsigned long *mask, size_t bits) {
+    FILE *const file = fopen(path, "r");
+    if (!file)
+        return 1;
+
+    char      line[4096];
+    const int failed = fgets(line, sizeof(line), file) == NULL;
+    fclose(file);
+    if (failed)
+        return 1;
+
+    return __numa_topology_parse_list(line, mask, bits);
+}
+
+/**
+ * @brief   Reads the NUMA topology of the machine.
+ * @details Auxiliary method for ::numa_topology_get_node_count, called through `pthread_once`. Sets
+ *          ::numa_topology_node_count and ::numa_topology_node_cpus.
+ */
+void __numa_topology_read(void) {
+    const char *const numa_env = getenv(NUMA_TOPOLOGY_ENVIRONMENT_VARIABLE);
+    if (numa_env && strcmp(numa_env, "0") == 0)
+        return;
+
+    unsigned long nodes = 0;
+    if (__numa_topology_parse_list_file("/sys/devices/system/node/online",
+                                        &nodes,
+                                        NUMA_TOPOLOGY_MAX_NODES))
+        return;
+
+    /* Only contiguous node numbers, starting at 0, are supported */
+    const size_t count = __builtin_popcountl(nodes);
+    if (nodes != (1UL << count) - 1)
+        return;
+
+    for (size_t i = 0; i < count; ++i) {
+        char path[PATH_MAX];
+        snprintf(path, PATH_MAX, "/sys/devices/system/node/node%zu/cpulist", i);
+
+        unsigned long *const cpus = numa_topology_node_cpus[i];
+        if (__numa_topology_parse_list_file(path, cpus, NUMA_TOPOLOGY_MAX_CPUS))
+            return;
+
+        /* Threads can't be pinned to nodes without CPUs (e.g.: memory expanders) */
+        int empty = 1;
+        for (size_t j = 0; j < NUMA_TOPOLOGY_MAX_CPUS / NUMA_TOPOLOGY_LONG_BITS; ++j)
+            empty &= !cpus[j];
+        if (empty)
+            return;
+    }
+
+    numa_topology_node_count = count;
+}
+
+size_t numa_topology_get_node_count(void) {
+    pthread_once(&numa_topology_once, __numa_topology_read);
+    return numa_topology_node_count;
+}
+
+size_t numa_topology_get_current_node(void) {
+    if (numa_topology_thread_node != SIZE_MAX)
+        return numa_topology_thread_node;
+
+    const size_t count = numa_topology_get_node_count();
+    if (count == 1)
+        return 0;
+
+#ifdef SYS_getcpu
+    unsigned int cpu, node;
+    if (!syscall(SYS_getcpu, &cpu, &node, NULL) && node < count)
+        return node;
+#endif
+    return 0;
+}
+
+/**
+ * @brief  Checks if a CPU is in a CPU mask.
+ * @param  mask Mask to look for @p cpu in.
+ * @param  cpu  Number of the CPU. Must be lower than ::NUMA_TOPOLOGY_MAX_CPUS.
+ * @return Whether @p cpu is in @p mask.
+ */
+int __numa_topology_has_cpu(const numa_topology_cpu_mask_t mask, size_t cpu) {
+    return (mask[cpu / NUMA_TOPOLOGY_LONG_BITS] >> (cpu % NUMA_TOPOLOGY_LONG_BITS)) & 1;
+}
+
+/**
+ * @brief   Counts the bits set in a CPU mask.
+ * @details Auxiliary method for ::__numa_topology_read_cpus and ::numa_topology_set_cpus.
+ *
+ * @param mask Mask to count the CPUs in.
+ * @return The number of CPUs in @p mask.
+ */
+size_t __numa_topology_count_cpus(const numa_topology_cpu_mask_t mask) {
+    size_t count = 0;
+    for (size_t i = 0; i < NUMA_TOPOLOGY_MAX_CPUS / NUMA_TOPOLOGY_LONG_BITS; ++i)
+        count += __builtin_popcountl(mask[i]);
+    return count;
+}
+
+/**
+ * @brief   Reads the CPUs the process is allowed to run on.
+ * @details Auxiliary method for ::numa_topology_get_cpu_count, called through `pthread_once`. Sets
+ *          ::numa_topology_cpus and ::numa_topology_cpu_count. If the affinity of the process
+ *          can't be known, the first online processors are assumed.
+ */
+void __numa_topology_read_cpus(void) {
+    unsigned long *const cpus = numa_topology_cpus;
+    if (syscall(SYS_sched_getaffinity, 0, sizeof(numa_topology_cpu_mask_t), cpus) > 0 &&
+        (numa_topology_cpu_count = __numa_topology_count_cpus(cpus)))
+        return;
+
+    const long   processors = sysconf(_SC_NPROCESSORS_ONLN);
+    const size_t count      = processors < 1 ? 1 : min((size_t) processors, NUMA_TOPOLOGY_MAX_CPUS);
+    memset(numa_topology_cpus, 0, sizeof(numa_topology_cpu_mask_t));
+    for (size_t i = 0; i < count; ++i)
+        numa_topology_cpus[i / NUMA_TOPOLOGY_LONG_BITS] |= 1UL << (i % NUMA_TOPOLOGY_LONG_BITS);
+    numa_topology_cpu_count = count;
+}
+
+size_t numa_topology_get_cpu_count(void) {
+    pthread_once(&numa_topology_cpus_once, __numa_topology_read_cpus);
+    return numa_topology_cpu_count;
+}
+
+int numa_topology_set_cpus(const char *list) {
+    numa_topology_cpu_mask_t cpus = {0};
+    if (__numa_topology_parse_list(list, cpus, NUMA_TOPOLOGY_MAX_CPUS) ||
+        !__numa_topology_count_cpus(cpus))
+        return 1;
+
+    if (syscall(SYS_sched_setaffinity, 0, sizeof(numa_topology_cpu_mask_t), cpus))
+        return 1;
+
+    pthread_once(&numa_topology_cpus_once, __numa_topology_read_cpus);
+    memcpy(numa_topology_cpus, cpus, sizeof(numa_topology_cpu_mask_t));
+    numa_topology_cpu_count = __numa_topology_count_cpus(cpus);
+    return 0;
+}
+
+void numa_topology_pin_thread_to_cpu(size_t position) {
+    position %= numa_topology_get_cpu_count();
+
+    size_t cpu = 0;
+    while (!__numa_topology_has_cpu(numa_topology_cpus, cpu) || position--)
+        cpu++;
+
+    numa_topology_cpu_mask_t mask = {0};
+    mask[cpu / NUMA_TOPOLOGY_LONG_BITS] |= 1UL << (cpu % NUMA_TOPOLOGY_LONG_BITS);
+    if (syscall(SYS_sched_setaffinity, 0, sizeof(numa_topology_cpu_mask_t), mask))
+        return;
+
+    const size_t nodes = numa_topology_get_node_count();
+    for (size_t i = 0; i < nodes && nodes > 1; ++i)
+        if (__numa_topology_has_cpu(numa_topology_node_cpus[i], cpu))
+            numa_topology_thread_node = i;
+}
+
+void numa_topology_format_cpus(char *out, size_t size) {
+    numa_topology_get_cpu_count();
+    if (!size)
+        return;
+    *out = '\0';
+
+    size_t written = 0;
+    for (size_t cpu = 0; cpu < NUMA_TOPOLOGY_MAX_CPUS; ++cpu) {
+        if (!__numa_topology_has_cpu(numa_topology_cpus, cpu))
+            continue;
+
+        const char *const sep  = written ? "," : "";
+        size_t            last = cpu;
+        while (last + 1 < NUMA_TOPOLOGY_MAX_CPUS &&
+               __numa_topology_has_cpu(numa_topology_cpus, last + 1))
+            last++;
+
+        char *const  end  = out + written;
+        const size_t left = size - written;
+        const int    n    = last == cpu ? snprintf(end, left, "%s%zu", sep, cpu)
+                                        : snprintf(end, left, "%s%zu-%zu", sep, cpu, last);
+        if (n < 0 || (size_t) n >= left) {
+            *end = '\0'; /* Truncated: only whole CPUs and ranges */
+            return;
+        }
+        written += n;
+        cpu = last;
+    }
+}
+
+void numa_topology_pin_thread(size_t node) {
+    if (node >= numa_topology_get_node_count() || numa_topology_node_count == 1)
+        return;
+
+    /* Only the node's CPUs that the process is allowed to run on (see numa_topology_set_cpus) */
+    numa_topology_get_cpu_count();
+    numa_topology_cpu_mask_t mask;
+    for (size_t i = 0; i < NUMA_TOPOLOGY_MAX_CPUS / NUMA_TOPOLOGY_LONG_BITS; ++i)
+        mask[i] = numa_topology_node_cpus[node][i] & numa_topology_cpus[i];
+    if (!__numa_topology_count_cpus(mask))
+        return;
+
+    if (!syscall(SYS_sched_setaffinity, 0, sizeof(numa_topology_cpu_mask_t), mask))
+        numa_topology_thread_node = node;
+}
+
+/**
+ * @brief   Sets the memory policy of some pages.
+ * @details Auxiliary method for ::numa_topology_interleave and ::numa_topology_allocate.
+ *
+ * @param data   Beginning of the memory. Must be page-aligned.
+ * @param size   Size of the memory, in bytes.
+ * @param policy Memory policy (e.g.: ::NUMA_TOPOLOGY_MPOL_INTERLEAVE).
+ * @param nodes  Mask of the nodes in the policy.
+ * @param flags  Flags for `mbind` (e.g.: ::NUMA_TOPOLOGY_MPOL_MF_MOVE).
+ */
+void __numa_topology_bind(void *data, size_t size, int policy, unsigned long nodes, int flags) {
+#ifdef SYS_mbind
+    /* The kernel reads one bit less than the maximum node given to it */
+    syscall(SYS_mbind, data, size, policy, &nodes, NUMA_TOPOLOGY_LONG_BITS + 1, flags);
+#else
+    (void) data;
+    (void) size;
+    (void) policy;
+    (void) nodes;
+    (void) flags;
+#endif
+}
+
+void numa_topology_interleave(const void *data, size_t size) {
+    const size_t count = numa_topology_get_node_count();
+    if (count == 1)
+        return;
+
+    const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    const uintptr_t begin     = ((uintptr_t) data + page_size - 1) / page_size * page_size;
+    const uintptr_t end       = ((uintptr_t) data + size) / page_size * page_size;
+    if (begin < end)
+        __numa_topology_bind((void *) begin,
+                             end - begin,
+                             NUMA_TOPOLOGY_MPOL_INTERLEAVE,
+                             (1UL << count) - 1,
+                             NUMA_TOPOLOGY_MPOL_MF_MOVE);
+}
+
+void *numa_topology_allocate(size_t size, size_t node) {
+    void *const data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+        return NULL;
+
+    if (node < numa_topology_get_node_count() && numa_topology_node_count > 1)
+        __numa_topology_bind(data, size, NUMA_TOPOLOGY_MPOL_PREFERRED, 1UL << node, 0);
+    return data;
+}
+
+void numa_topology_free(void *data, size_t size) {
+    if (data)
+        munmap(data, size);
+}
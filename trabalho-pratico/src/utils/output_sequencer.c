@@ -0,0 +1,198 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  output_sequencer.c
+ * @brief Implementation of methods in include/utils/output_sequencer.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref output_sequencer_examples).
+ */
+
+#include <glib.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "utils/output_sequencer.h"
+
+/**
+ * @struct output_sequencer
+ * @brief  Outputs being committed in order.
+ *
+ * @var output_sequencer::ring
+ *     @brief   Reorder ring of outputs waiting to be committed (`NULL` for empty slots).
+ *     @details The output with sequence number `n` is in slot `n % capacity`, as long as it's
+ *              less than ::output_sequencer::capacity ahead of ::output_sequencer::next.
+ * @var output_sequencer::capacity
+ *     @brief Number of slots in ::output_sequencer::ring.
+ * @var output_sequencer::overflow
+ *     @brief Outputs too far ahead to fit in ::output_sequencer::ring, by sequence number.
+ * @var output_sequencer::next
+ *     @brief Sequence number of the next output to be committed.
+ * @var output_sequencer::committing
+ *     @brief Whether a thread is committing outputs (outside ::output_sequencer::mutex).
+ * @var output_sequencer::failed
+ *     @brief Whether any commit has failed.
+ * @var output_sequencer::commit
+ *     @brief Method called to commit each output.
+ * @var output_sequencer::user_data
+ *     @brief Argument passed to ::output_sequencer::commit.
+ * @var output_sequencer::mutex
+ *     @brief Protects every field but the constant ones.
+ */
+struct output_sequencer {
+    void                             **ring;
+    size_t                             capacity;
+    GHashTable                        *overflow;
+    size_t                             next;
+    int                                committing, failed;
+    output_sequencer_commit_callback_t commit;
+    void                              *user_data;
+    pthread_mutex_t                    mutex;
+};
+
+output_sequencer_t *output_sequencer_create(size_t                             capacity,
+                                            output_sequencer_commit_callback_t commit,
+                                            void                              *user_data) {
+    output_sequencer_t *const sequencer = malloc(sizeof(output_sequencer_t));
+    if (!sequencer)
+        return NULL;
+
+    sequencer->capacity = capacity ? capacity : 1;
+    sequencer->ring     = calloc(sequencer->capacity, sizeof(void *));
+    if (!sequencer->ring) {
+        free(sequencer);
+        return NULL;
+    }
+
+    sequencer->overflow   = g_hash_table_new(g_direct_hash, g_direct_equal);
+    sequencer->next       = 0;
+    sequencer->committing = 0;
+    sequencer->failed     = 0;
+    sequencer->commit     = commit;
+    sequencer->user_data  = user_data;
+    pthread_mutex_init(&sequencer->mutex, NULL);
+    return sequencer;
+}
+
+/**
+ * @brief   Removes the next output to be committed, if it's been submitted, and advances
+ *          ::output_sequencer::next.
+ * @details Auxiliary method for ::output_sequencer_submit. Must be called with
+ *          ::output_sequencer::mutex locked.
+ *
+ * @param sequencer Sequencer to take the output from.
+ *
+ * @return The next output, or `NULL` if it hasn't been submitted yet.
+ */
+void *__output_sequencer_take_next(output_sequencer_t *sequencer) {
+    void **const slot = &sequencer->ring[sequencer->next % sequencer->capacity];
+    void *const  item = *slot;
+    if (!item)
+        return NULL;
+
+    /* The freed slot now belongs to the last sequence number of the ring */
+    sequencer->next++;
+    const size_t last = sequencer->next + sequencer->capacity - 1;
+    *slot             = g_hash_table_lookup(sequencer->overflow, GSIZE_TO_POINTER(last));
+    if (*slot)
+        g_hash_table_remove(sequencer->overflow, GSIZE_TO_POINTER(last));
+    return item;
+}
+
+int output_sequencer_submit(output_sequencer_t *sequencer, size_t sequence, void *item) {
+    pthread_mutex_lock(&sequencer->mutex);
+
+    if (sequence < sequencer->next) {
+        pthread_mutex_unlock(&sequencer->mutex);
+        return 1;
+    } else if (sequence - sequencer->next < sequencer->capacity) {
+        void **const slot = &sequencer->ring[sequence % sequencer->capacity];
+        if (*slot) {
+            pthread_mutex_unlock(&sequencer->mutex);
+            return 1;
+        }
+        *slot = item;
+    } else if (g_hash_table_contains(sequencer->overflow, GSIZE_TO_POINTER(sequence))) {
+        pthread_mutex_unlock(&sequencer->mutex);
+        return 1;
+    } else {
+        g_hash_table_insert(sequencer->overflow, GSIZE_TO_POINTER(sequence), item);
+    }
+
+    /* Only one thread commits at a time, so that commits stay in order */
+    if (!sequencer->committing) {
+        sequencer->committing = 1;
+
+        void *next_item;
+        while ((next_item = __output_sequencer_take_next(sequencer))) {
+            const size_t next_sequence = sequencer->next - 1;
+            pthread_mutex_unlock(&sequencer->mutex);
+            const int failed =
+                sequencer->commit(sequencer->user_data, next_sequence, next_item) != 0;
+            pthread_mutex_lock(&sequencer->mutex);
+            sequencer->failed |= failed;
+        }
+
+        sequencer->committing = 0;
+    }
+
+    pthread_mutex_unlock(&sequencer->mutex);
+    return 0;
+}
+
+/** @brief Comparison function for sorting sequence numbers in ::output_sequencer_finish. */
+gint __output_sequencer_compare_sequences(gconstpointer a, gconstpointer b) {
+    const size_t sequence_a = *(const size_t *) a, sequence_b = *(const size_t *) b;
+    return (sequence_a > sequence_b) - (sequence_a < sequence_b);
+}
+
+int output_sequencer_finish(output_sequencer_t *sequencer) {
+    /* Outputs left behind missing ones are collected, and committed in order */
+    GArray *const remaining = g_array_new(FALSE, FALSE, sizeof(size_t));
+    for (size_t i = 0; i < sequencer->capacity; ++i) {
+        const size_t sequence = sequencer->next + i;
+        if (sequencer->ring[sequence % sequencer->capacity])
+            g_array_append_val(remaining, sequence);
+    }
+
+    GHashTableIter iter;
+    gpointer       key;
+    g_hash_table_iter_init(&iter, sequencer->overflow);
+    while (g_hash_table_iter_next(&iter, &key, NULL)) {
+        const size_t sequence = GPOINTER_TO_SIZE(key);
+        g_array_append_val(remaining, sequence);
+    }
+    g_array_sort(remaining, __output_sequencer_compare_sequences);
+
+    int retval = sequencer->failed;
+    for (size_t i = 0; i < remaining->len; ++i) {
+        const size_t sequence = g_array_index(remaining, size_t, i);
+        void *const  item =
+            sequence - sequencer->next < sequencer->capacity
+                 ? sequencer->ring[sequence % sequencer->capacity]
+                 : g_hash_table_lookup(sequencer->overflow, GSIZE_TO_POINTER(sequence));
+        retval |= sequencer->commit(sequencer->user_data, sequence, item) != 0;
+    }
+    g_array_free(remaining, TRUE);
+
+    pthread_mutex_destroy(&sequencer->mutex);
+    g_hash_table_unref(sequencer->overflow);
+    free(sequencer->ring);
+    free(sequencer);
+    return retval;
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  parallel_sort.c
+ * @brief Implementation of methods in include/utils/parallel_sort.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref parallel_sort_examples).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/int_utils.h"
+#include "utils/parallel_sort.h"
+
+/**
+ * @brief Runs shorter than this are sorted with insertion sort before being merged, as merging
+ *        them would only add overhead.
+ */
+#define PARALLEL_SORT_INSERTION_THRESHOLD 32
+
+/**
+ * @struct parallel_sort_data_t
+ * @brief  Work shared by all threads sorting an array.
+ *
+ * @var parallel_sort_data_t::items
+ *     @brief Items being sorted, in sorted runs of ::parallel_sort_data_t::width items.
+ * @var parallel_sort_data_t::buffer
+ *     @brief Space for as many items as ::parallel_sort_data_t::items, for merging.
+ * @var parallel_sort_data_t::n
+ *     @brief Number of items in ::parallel_sort_data_t::items.
+ * @var parallel_sort_data_t::size
+ *     @brief Size of each item, in bytes.
+ * @var parallel_sort_data_t::width
+ *     @brief Length of the sorted runs being merged.
+ * @var parallel_sort_data_t::compare
+ *     @brief Comparison function.
+ */
+typedef struct {
+    char                            *items, *buffer;
+    size_t                           n, size, width;
+    parallel_sort_compare_callback_t compare;
+} parallel_sort_data_t;
+
+/**
+ * @brief Sorts a short range of items with insertion sort.
+ *
+ * @param items   Array containing the range to be sorted.
+ * @param temp    Space for one item, outside of the range.
+ * @param start   Index of the first item to be sorted.
+ * @param end     Index after the last item to be sorted.
+ * @param size    Size of each item, in bytes.
+ * @param compare Comparison function.
+ */
+void __parallel_sort_insertion(char                            *items,
+                               char                            *temp,
+                               size_t                           start,
+                               size_t                           end,
+                               size_t                           size,
+                               parallel_sort_compare_callback_t compare) {
+    for (size_t i = start + 1; i < end; ++i) {
+        size_t j = i;
+        if (compare(items + (j - 1) * size, items + i * size) <= 0)
+            continue;
+
+        memcpy(temp, items + i * size, size);
+        do {
+            --j;
+        } while (j > start && compare(items + (j - 1) * size, temp) > 0);
+
+        memmove(items + (j + 1) * size, items + j * size, (i - j) * size);
+        memcpy(items + j * size, temp, size);
+    }
+}
+
+/**
+ * @brief   Merges two adjacent sorted runs of items.
+ * @details Items from the first run go first when equivalent, keeping the merge stable.
+ *
+ * @param source      Array containing both runs.
+ * @param destination Array to write the merged run to, at the same indices as in @p source.
+ * @param begin       Index of the first item of the first run.
+ * @param middle      Index of the first item of the second run.
+ * @param finish      Index after the last item of the second run.
+ * @param size        Size of each item, in bytes.
+ * @param compare     Comparison function.
+ */
+void __parallel_sort_merge(const char                      *source,
+                           char                            *destination,
+                           size_t                           begin,
+                           size_t                           middle,
+                           size_t                           finish,
+                           size_t                           size,
+                           parallel_sort_compare_callback_t compare) {
+    size_t i = begin, j = middle, out = begin;
+    while (i < middle && j < finish) {
+        if (compare(source + j * size, source + i * size) < 0)
+            memcpy(destination + out++ * size, source + j++ * size, size);
+        else
+            memcpy(destination + out++ * size, source + i++ * size, size);
+    }
+    memcpy(destination + out * size, source + i * size, (middle - i) * size);
+    out += middle - i;
+    memcpy(destination + out * size, source + j * size, (finish - j) * size);
+}
+
+/**
+ * @brief   Sorts a range of items in the calling thread.
+ * @details Auxiliary method for ::parallel_sort, run in parallel by ::thread_pool_parallel_for,
+ *          with ranges of ::parallel_sort_data_t::width items. The same range of
+ *          ::parallel_sort_data_t::buffer is used for merging, and the sorted items are left in
+ *          ::parallel_sort_data_t::items.
+ *
+ * @param sort_data_data A ::parallel_sort_data_t.
+ * @param start          Index of the first item.
+ * @param end            Index after the last item.
+ */
+void __parallel_sort_range(void *sort_data_data, size_t start, size_t end) {
+    const parallel_sort_data_t *const sort_data = sort_data_data;
+    const size_t                      size      = sort_data->size;
+
+    for (size_t run = start; run < end; run += PARALLEL_SORT_INSERTION_THRESHOLD)
+        __parallel_sort_insertion(sort_data->items,
+                                  sort_data->buffer + start * size,
+                                  run,
+                                  min(run + PARALLEL_SORT_INSERTION_THRESHOLD, end),
+                                  size,
+                                  sort_data->compare);
+
+    char *source = sort_data->items, *destination = sort_data->buffer;
+    for (size_t width = PARALLEL_SORT_INSERTION_THRESHOLD; width < end - start; width *= 2) {
+        for (size_t begin = start; begin < end; begin += 2 * width) {
+            const size_t middle = min(begin + width, end);
+            const size_t finish = min(middle + width, end);
+            __parallel_sort_merge(source,
+                                  destination,
+                                  begin,
+                                  middle,
+                                  finish,
+                                  size,
+                                  sort_data->compare);
+        }
+
+        char *const swap = source;
+        source           = destination;
+        destination      = swap;
+    }
+
+    if (source != sort_data->items)
+        memcpy(sort_data->items + start * size, source + start * size, (end - start) * size);
+}
+
+/**
+ * @brief   Merges pairs of sorted runs of items into ::parallel_sort_data_t::buffer.
+ * @details Auxiliary method for ::parallel_sort, run in parallel by ::thread_pool_parallel_for.
+ *
+ * @param sort_data_data A ::parallel_sort_data_t.
+ * @param start          Index of the first pair of runs.
+ * @param end            Index after the last pair of runs.
+ */
+void __parallel_sort_merge_range(void *sort_data_data, size_t start, size_t end) {
+    const parallel_sort_data_t *const sort_data = sort_data_data;
+
+    for (size_t pair = start; pair < end; ++pair) {
+        const size_t begin  = pair * 2 * sort_data->width;
+        const size_t middle = min(begin + sort_data->width, sort_data->n);
+        const size_t finish = min(middle + sort_data->width, sort_data->n);
+        __parallel_sort_merge(sort_data->items,
+                              sort_data->buffer,
+                              begin,
+                              middle,
+                              finish,
+                              sort_data->size,
+                              sort_data->compare);
+    }
+}
+
+int parallel_sort(void                            *base,
+                  size_t                           n,
+                  size_t                           size,
+                  parallel_sort_compare_callback_t compare,
+                  thread_pool_t                   *pool) {
+    if (n < 2)
+        return 0;
+
+    char *const buffer = malloc(n * size);
+    if (!buffer)
+        return 1;
+
+    parallel_sort_data_t sort_data = {.items   = base,
+                                      .buffer  = buffer,
+                                      .n       = n,
+                                      .size    = size,
+                                      .width   = n,
+                                      .compare = compare};
+
+    /* Only use more threads if each of them has enough items for that to be worth it */
+    const size_t nthreads = pool ? min(thread_pool_get_thread_count(pool),
+                                       max(n / PARALLEL_SORT_MIN_ITEMS_PER_THREAD, 1))
+                                 : 1;
+    if (nthreads == 1) {
+        __parallel_sort_range(&sort_data, 0, n);
+        free(buffer);
+        return 0;
+    }
+
+    sort_data.width = (n + nthreads - 1) / nthreads;
+    thread_pool_parallel_for(pool, n, sort_data.width, __parallel_sort_range, &sort_data);
+
+    for (; sort_data.width < n; sort_data.width *= 2) {
+        const size_t npairs = (n + 2 * sort_data.width - 1) / (2 * sort_data.width);
+        thread_pool_parallel_for(pool, npairs, 1, __parallel_sort_merge_range, &sort_data);
+
+        char *const swap = sort_data.items;
+        sort_data.items  = sort_data.buffer;
+        sort_data.buffer = swap;
+    }
+
+    if (sort_data.items != (char *) base)
+        memcpy(base, sort_data.items, n * size);
+    free(buffer);
+    return 0;
+}
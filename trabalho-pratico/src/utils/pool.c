@@ -14,10 +14,23 @@
  * limitations under the License.
  */
 
+/** @cond FALSE */
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE /* For MAP_ANONYMOUS, MAP_HUGETLB, MADV_HUGEPAGE and MADV_DONTNEED */
+#endif
+/** @endcond */
+
+#include <errno.h>
 #include <glib.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
+#include "testing/performance_allocations.h"
+#include "utils/memory_budget.h"
 #include "utils/pool.h"
 
 /**
@@ -28,31 +41,283 @@
  * See [the header file's documentation](@ref pool_examples).
  */
 
+/**
+ * @struct pool_block_info_t
+ * @brief  Information about a block in a ::pool_t.
+ *
+ * @var pool_block_info_t::capacity
+ *     @brief Number of items that fit in the block.
+ * @var pool_block_info_t::length
+ *     @brief Number of items in the block (not kept up to date for the top block).
+ */
+typedef struct {
+    size_t capacity;
+    size_t length;
+} pool_block_info_t;
+
 /**
  * @struct pool
  * @brief  Pool allocator for objects of the same size.
  *
  * @var pool::blocks
  *     @brief Array of blocks (`uint8_t *`'s) in the pool.
+ * @var pool::block_info
+ *     @brief   Capacity and number of items of each block (::pool_block_info_t).
+ *     @details The number of items in the top block is ::pool::top_block_used instead. Blocks of
+ *              ::pool_cache_t are left partially filled, and are inserted below the top block, so
+ *              neither capacities nor lengths can be calculated from a block's index.
  * @var pool::item_size
  *     @brief Size (in bytes) of an item in the pool.
  * @var pool::block_capacity
- *     @brief Capacity of each pool block (in items).
+ *     @brief Capacity of each new pool block (in items). See ::pool_reserve for an exception.
  * @var pool::top_block_used
  *     @brief Number of items already in the top block of the pool.
  * @var pool::can_iterate
  *     @brief If a pool can be iterated over (::pool_put_items hasn't been called).
+ * @var pool::pages
+ *     @brief Kind of memory pages that back the blocks of the pool.
+ * @var pool::reserved_bytes
+ *     @brief Memory requested for all blocks (see ::memory_usage_t::reserved_bytes).
+ * @var pool::used_bytes
+ *     @brief Memory taken by allocated items (see ::memory_usage_t::used_bytes).
+ * @var pool::wasted_bytes
+ *     @brief Memory left behind in old top blocks (see ::memory_usage_t::wasted_bytes).
+ * @var pool::cache_mutex
+ *     @brief Mutex locked by a ::pool_cache_t to add a block to the pool.
  */
 struct pool {
     GPtrArray *blocks;
+    GArray    *block_info;
 
     size_t item_size;
     size_t block_capacity;
     size_t top_block_used;
 
-    int can_iterate;
+    int          can_iterate;
+    pool_pages_t pages;
+
+    size_t reserved_bytes;
+    size_t used_bytes;
+    size_t wasted_bytes;
+
+    pthread_mutex_t cache_mutex;
 };
 
+/**
+ * @struct pool_cache
+ * @brief  Per-thread allocation front-end of a ::pool_t.
+ *
+ * @var pool_cache::pool
+ *     @brief Pool where blocks are taken from.
+ * @var pool_cache::block
+ *     @brief Block items are currently allocated from (`NULL` before the first allocation).
+ * @var pool_cache::block_index
+ *     @brief Index of ::pool_cache::block in ::pool::blocks.
+ * @var pool_cache::capacity
+ *     @brief Capacity of ::pool_cache::block, in items.
+ * @var pool_cache::used
+ *     @brief Number of items already allocated in ::pool_cache::block.
+ * @var pool_cache::added_array
+ *     @brief Whether an array of items was allocated (see ::POOL_ITER_RET_ADDED_ARRAY).
+ */
+struct pool_cache {
+    pool_t  *pool;
+    uint8_t *block;
+    size_t   block_index;
+    size_t   capacity;
+    size_t   used;
+    int      added_array;
+};
+
+/** @brief Size of a huge page, the granularity of blocks in pools of ::POOL_PAGES_HUGE. */
+#define POOL_HUGE_PAGE_SIZE ((size_t) 1 << 21)
+
+/**
+ * @brief   Space before the items of a mapped block, where its ::pool_mapped_block_header_t is.
+ * @details A whole cache line is used, so that items stay as aligned as they'd be with `malloc`.
+ */
+#define POOL_MAPPED_BLOCK_HEADER_SIZE 64
+
+/**
+ * @struct pool_mapped_block_header_t
+ * @brief  Information needed to unmap a block of a pool of ::POOL_PAGES_HUGE.
+ *
+ * @var pool_mapped_block_header_t::mapping
+ *     @brief Start of the memory mapping (where this header is).
+ * @var pool_mapped_block_header_t::length
+ *     @brief Length of the memory mapping, in bytes.
+ */
+typedef struct {
+    void  *mapping;
+    size_t length;
+} pool_mapped_block_header_t;
+
+/** @brief Whether ::POOL_PAGES_HUGE is respected (see ::pool_set_huge_pages_enabled). */
+int __pool_huge_pages_enabled = 1;
+
+/**
+ * @brief  Calculates the length of the mapping needed for a block of a pool of ::POOL_PAGES_HUGE.
+ * @param  bytes Number of bytes for items needed in the block.
+ * @return The length of the mapping, a multiple of ::POOL_HUGE_PAGE_SIZE.
+ */
+size_t __pool_get_mapping_length(size_t bytes) {
+    const size_t total = bytes + POOL_MAPPED_BLOCK_HEADER_SIZE;
+    return (total + POOL_HUGE_PAGE_SIZE - 1) / POOL_HUGE_PAGE_SIZE * POOL_HUGE_PAGE_SIZE;
+}
+
+/**
+ * @brief   Rounds up the capacity of a block, so that it fills all the pages that back it.
+ * @details Nothing is done for pools of ::POOL_PAGES_NORMAL.
+ *
+ * @param pool     Pool where the block is going to be.
+ * @param capacity Minimum capacity (in items) of the block.
+ *
+ * @return The capacity of the block.
+ */
+size_t __pool_round_block_capacity(const pool_t *pool, size_t capacity) {
+    if (pool->pages == POOL_PAGES_NORMAL)
+        return capacity;
+
+    const size_t length = __pool_get_mapping_length(capacity * pool->item_size);
+    return (length - POOL_MAPPED_BLOCK_HEADER_SIZE) / pool->item_size;
+}
+
+/**
+ * @brief   Maps memory for a block of a pool of ::POOL_PAGES_HUGE.
+ * @details Explicit huge pages are tried first. If there are none available, a 2 MiB-aligned
+ *          mapping is created and transparent huge pages are requested for it. `errno` is
+ *          preserved when either of those fails, as neither is an actual allocation failure.
+ *
+ * @param bytes Number of bytes for items needed in the block.
+ *
+ * @return A pointer to the space for items in the block, or `NULL` on allocation failure.
+ */
+uint8_t *__pool_map_block(size_t bytes) {
+    const size_t length    = __pool_get_mapping_length(bytes);
+    const int    old_errno = errno;
+    uint8_t     *mapping;
+
+#ifdef MAP_HUGETLB
+    mapping = mmap(NULL,
+                   length,
+                   PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                   -1,
+                   0);
+    if (mapping == MAP_FAILED)
+#endif
+    {
+        /* Map an extra huge page, so that the mapping can be trimmed to an aligned address */
+        uint8_t *const raw = mmap(NULL,
+                                  length + POOL_HUGE_PAGE_SIZE,
+                                  PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS,
+                                  -1,
+                                  0);
+        if (raw == MAP_FAILED)
+            return NULL;
+
+        mapping = (uint8_t *) (((uintptr_t) raw + POOL_HUGE_PAGE_SIZE - 1) &
+                               ~(uintptr_t) (POOL_HUGE_PAGE_SIZE - 1));
+        if (mapping > raw)
+            munmap(raw, mapping - raw);
+        if (raw + POOL_HUGE_PAGE_SIZE > mapping)
+            munmap(mapping + length, raw + POOL_HUGE_PAGE_SIZE - mapping);
+
+#ifdef MADV_HUGEPAGE
+        madvise(mapping, length, MADV_HUGEPAGE); /* Only a hint, so failure is ignored */
+#endif
+        errno = old_errno;
+    }
+
+    pool_mapped_block_header_t *const header = (pool_mapped_block_header_t *) mapping;
+    header->mapping                          = mapping;
+    header->length                           = length;
+    return mapping + POOL_MAPPED_BLOCK_HEADER_SIZE;
+}
+
+/**
+ * @brief Unmaps a block allocated with ::__pool_map_block.
+ * @param block Pointer to the space for items in the block.
+ */
+void __pool_unmap_block(void *block) {
+    const pool_mapped_block_header_t *const header =
+        (const pool_mapped_block_header_t *) ((uint8_t *) block - POOL_MAPPED_BLOCK_HEADER_SIZE);
+    munmap(header->mapping, header->length);
+}
+
+/**
+ * @brief Calculates how much memory is requested from the system for a block of a pool.
+ *
+ * @param pool     Pool where the block is.
+ * @param capacity Capacity of the block, in items.
+ *
+ * @return The number of bytes in the allocation (or mapping) of the block.
+ */
+size_t __pool_get_block_reserved_bytes(const pool_t *pool, size_t capacity) {
+    if (pool->pages == POOL_PAGES_HUGE)
+        return __pool_get_mapping_length(pool->item_size * capacity);
+    return pool->item_size * capacity;
+}
+
+/**
+ * @brief   Allocates memory for a block of a pool, backed by the pool's kind of pages.
+ * @details The block is charged to the [memory budget](@ref memory_budget.h), and released from it
+ *          when ::pool::reserved_bytes decreases.
+ *
+ * @param pool     Pool where the block is going to be.
+ * @param capacity Capacity of the block, in items.
+ *
+ * @return The allocated block, or `NULL` on allocation failure (or if it exceeds the budget).
+ */
+uint8_t *__pool_allocate_block_memory(const pool_t *pool, size_t capacity) {
+    const size_t reserved = __pool_get_block_reserved_bytes(pool, capacity);
+    if (memory_budget_reserve(reserved))
+        return NULL;
+
+    uint8_t *const block = pool->pages == POOL_PAGES_HUGE
+                               ? __pool_map_block(pool->item_size * capacity)
+                               : malloc(pool->item_size * capacity);
+    if (!block)
+        memory_budget_release(reserved);
+    return block;
+}
+
+/**
+ * @brief Gets the capacity (in items) of a block in a pool.
+ *
+ * @param pool  Pool where the block is.
+ * @param block Index of the block in ::pool::blocks.
+ *
+ * @return The number of items that fit in the block.
+ */
+size_t __pool_get_block_capacity(const pool_t *pool, size_t block) {
+    return g_array_index(pool->block_info, pool_block_info_t, block).capacity;
+}
+
+/**
+ * @brief Gets the number of items in a block of a pool.
+ *
+ * @param pool  Pool where the block is.
+ * @param block Index of the block in ::pool::blocks.
+ *
+ * @return The number of items allocated in the block.
+ */
+size_t __pool_get_block_length(const pool_t *pool, size_t block) {
+    if (block == pool->blocks->len - 1)
+        return pool->top_block_used;
+    return g_array_index(pool->block_info, pool_block_info_t, block).length;
+}
+
+/**
+ * @brief Gets the capacity (in items) of the top block of a pool.
+ * @param pool Pool to get the top block from.
+ * @return The number of items that fit in the top block of @p pool.
+ */
+size_t __pool_get_top_block_capacity(const pool_t *pool) {
+    return __pool_get_block_capacity(pool, pool->blocks->len - 1);
+}
+
 /**
  * @brief Adds a new block to the top of the pool.
  * @param pool Pool to add block to.
@@ -61,15 +326,45 @@ struct pool {
  * @retval 1 Allocation failure
  */
 int __pool_allocate_block(pool_t *pool) {
-    uint8_t *const block = malloc(pool->item_size * pool->block_capacity);
+    uint8_t *const block = __pool_allocate_block_memory(pool, pool->block_capacity);
     if (!block)
         return 1;
 
+    if (pool->blocks->len) { /* Space left in the old top block will never be used */
+        pool->wasted_bytes +=
+            (__pool_get_top_block_capacity(pool) - pool->top_block_used) * pool->item_size;
+        g_array_index(pool->block_info, pool_block_info_t, pool->blocks->len - 1).length =
+            pool->top_block_used;
+    }
+    pool->reserved_bytes += __pool_get_block_reserved_bytes(pool, pool->block_capacity);
+
+    const pool_block_info_t info = {.capacity = pool->block_capacity, .length = 0};
+    g_array_append_val(pool->block_info, info);
     g_ptr_array_add(pool->blocks, block);
     pool->top_block_used = 0;
     return 0;
 }
 
+/**
+ * @brief   Adds a block to a pool, right below its top block.
+ * @details Indices of blocks other than the top one never change, as blocks are only inserted
+ *          below the top one or pushed on top of it.
+ *
+ * @param pool     Pool to add the block to.
+ * @param block    Block to be added, allocated with ::__pool_allocate_block_memory.
+ * @param capacity Capacity of @p block, in items.
+ * @param length   Number of items in @p block.
+ *
+ * @return The index of the block in ::pool::blocks.
+ */
+size_t __pool_insert_block(pool_t *pool, uint8_t *block, size_t capacity, size_t length) {
+    const pool_block_info_t info = {.capacity = capacity, .length = length};
+    g_array_insert_val(pool->block_info, pool->blocks->len - 1, info);
+    g_ptr_array_insert(pool->blocks, pool->blocks->len - 1, block);
+    pool->reserved_bytes += __pool_get_block_reserved_bytes(pool, capacity);
+    return pool->blocks->len - 2;
+}
+
 /**
  * @brief   Adds a new block to the middle of a pool, that will only be used for storing a single
  *          array of items.
@@ -82,36 +377,50 @@ int __pool_allocate_block(pool_t *pool) {
  * @retval 1 Allocation failure
  */
 int __pool_allocate_single_use_block(pool_t *pool, size_t n) {
-    uint8_t *const block = malloc(pool->item_size * n);
+    uint8_t *const block = __pool_allocate_block_memory(pool, n);
     if (!block)
         return 1;
 
-    g_ptr_array_insert(pool->blocks, pool->blocks->len - 1, block);
+    __pool_insert_block(pool, block, n, n);
     return 0;
 }
 
 pool_t *pool_create_from_size(size_t item_size, size_t block_capacity) {
+    return pool_create_from_size_and_pages(item_size, block_capacity, POOL_PAGES_NORMAL);
+}
+
+pool_t *
+    pool_create_from_size_and_pages(size_t item_size, size_t block_capacity, pool_pages_t pages) {
     pool_t *const pool = malloc(sizeof(pool_t));
     if (!pool)
         return NULL;
 
-    pool->blocks         = g_ptr_array_new_with_free_func(free);
-    pool->item_size      = item_size;
-    pool->block_capacity = block_capacity;
+    pool->item_size = item_size;
+    pool->pages     = __pool_huge_pages_enabled ? pages : POOL_PAGES_NORMAL;
+    pool->blocks    = g_ptr_array_new_with_free_func(
+        pool->pages == POOL_PAGES_HUGE ? __pool_unmap_block : free);
+    pool->block_info = g_array_new(FALSE, FALSE, sizeof(pool_block_info_t));
+
+    pool->block_capacity = __pool_round_block_capacity(pool, block_capacity);
     pool->top_block_used = 0;
     pool->can_iterate    = 1;
+    pool->reserved_bytes = 0;
+    pool->used_bytes     = 0;
+    pool->wasted_bytes   = 0;
 
     if (__pool_allocate_block(pool)) {
+        g_array_unref(pool->block_info);
         g_ptr_array_unref(pool->blocks);
         free(pool);
         return NULL;
     }
 
+    pthread_mutex_init(&pool->cache_mutex, NULL);
     return pool;
 }
 
 void *__pool_alloc_item(pool_t *pool) {
-    if (pool->top_block_used == pool->block_capacity) {
+    if (pool->top_block_used == __pool_get_top_block_capacity(pool)) {
         if (__pool_allocate_block(pool))
             return NULL;
     }
@@ -119,6 +428,8 @@ void *__pool_alloc_item(pool_t *pool) {
     uint8_t *const retval = (uint8_t *) g_ptr_array_index(pool->blocks, pool->blocks->len - 1) +
                             pool->item_size * pool->top_block_used;
     pool->top_block_used++;
+    pool->used_bytes += pool->item_size;
+    performance_allocations_count_pool(pool->item_size);
     return retval;
 }
 
@@ -129,9 +440,11 @@ void *__pool_alloc_items(pool_t *pool, size_t n) {
         if (__pool_allocate_single_use_block(pool, n))
             return NULL;
 
+        pool->used_bytes += pool->item_size * n;
+        performance_allocations_count_pool(pool->item_size * n);
         return g_ptr_array_index(pool->blocks, pool->blocks->len - 2);
     } else {
-        const size_t block_left = pool->block_capacity - pool->top_block_used;
+        const size_t block_left = __pool_get_top_block_capacity(pool) - pool->top_block_used;
         if (n > block_left)
             if (__pool_allocate_block(pool))
                 return NULL;
@@ -139,6 +452,8 @@ void *__pool_alloc_items(pool_t *pool, size_t n) {
         uint8_t *retval = (uint8_t *) g_ptr_array_index(pool->blocks, pool->blocks->len - 1) +
                           pool->item_size * pool->top_block_used;
         pool->top_block_used += n;
+        pool->used_bytes += pool->item_size * n;
+        performance_allocations_count_pool(pool->item_size * n);
         return retval;
     }
 }
@@ -167,8 +482,7 @@ int pool_iter(const pool_t *pool, pool_iter_callback_t callback, void *user_data
 
     for (size_t i = 0; i < pool->blocks->len; ++i) {
         const uint8_t *const block = g_ptr_array_index(pool->blocks, i);
-        const size_t         item_count =
-            i == pool->blocks->len - 1 ? pool->top_block_used : pool->block_capacity;
+        const size_t         item_count = __pool_get_block_length(pool, i);
 
         for (size_t j = 0; j < item_count; ++j) {
             const void *const item   = block + pool->item_size * j;
@@ -182,13 +496,230 @@ int pool_iter(const pool_t *pool, pool_iter_callback_t callback, void *user_data
     return 0;
 }
 
+int pool_reserve(pool_t *pool, size_t count) {
+    if (pool->blocks->len != 1 || pool->top_block_used ||
+        count <= __pool_get_top_block_capacity(pool))
+        return 0;
+
+    const size_t   capacity = __pool_round_block_capacity(pool, count);
+    uint8_t *const block    = __pool_allocate_block_memory(pool, capacity);
+    if (!block)
+        return 1;
+
+    g_ptr_array_remove_index(pool->blocks, 0); /* Frees the old block */
+    g_ptr_array_add(pool->blocks, block);
+    memory_budget_release(pool->reserved_bytes);
+    pool->reserved_bytes = __pool_get_block_reserved_bytes(pool, capacity);
+    g_array_index(pool->block_info, pool_block_info_t, 0).capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief   Gives the memory pages after the last item of a block of a pool back to the system.
+ * @details Auxiliary method for ::pool_trim. Blocks are never moved, as items in them may be
+ *          pointed to. Mapped blocks are unmapped past their last huge page in use, and the pages
+ *          of allocated blocks are discarded (`MADV_DONTNEED`), but stay allocated.
+ *
+ * @param pool   Pool where the block is.
+ * @param block  Block to be trimmed.
+ * @param length Number of items in @p block.
+ * @param info   Capacity of @p block, that's set to @p length.
+ *
+ * @return The number of bytes given back to the system.
+ */
+size_t __pool_trim_block(pool_t *pool, uint8_t *block, size_t length, pool_block_info_t *info) {
+    size_t released = 0;
+
+    if (pool->pages == POOL_PAGES_HUGE) {
+        pool_mapped_block_header_t *const header =
+            (pool_mapped_block_header_t *) (block - POOL_MAPPED_BLOCK_HEADER_SIZE);
+        const size_t kept = __pool_get_mapping_length(length * pool->item_size);
+
+        if (kept < header->length && !munmap((uint8_t *) header->mapping + kept,
+                                             header->length - kept)) {
+            released       = header->length - kept;
+            header->length = kept;
+        }
+    } else {
+        const uintptr_t page_size = (uintptr_t) sysconf(_SC_PAGESIZE);
+        const uintptr_t begin =
+            ((uintptr_t) (block + length * pool->item_size) + page_size - 1) & ~(page_size - 1);
+        const uintptr_t end =
+            (uintptr_t) (block + info->capacity * pool->item_size) & ~(page_size - 1);
+
+        if (begin < end && !madvise((void *) begin, end - begin, MADV_DONTNEED))
+            released = end - begin;
+    }
+
+    info->capacity = length;
+    return released;
+}
+
+void pool_trim(pool_t *pool) {
+    for (size_t i = 0; i < pool->blocks->len; ++i) {
+        pool_block_info_t *const info = &g_array_index(pool->block_info, pool_block_info_t, i);
+
+        const int    top    = i == pool->blocks->len - 1;
+        const size_t length = top ? pool->top_block_used : info->length;
+        if (length == info->capacity)
+            continue;
+
+        uint8_t *const block    = g_ptr_array_index(pool->blocks, i);
+        const size_t   unused   = (info->capacity - length) * pool->item_size;
+        const size_t   released = __pool_trim_block(pool, block, length, info);
+        pool->reserved_bytes -= released;
+        memory_budget_release(released);
+
+        /*
+         * The unused space of old blocks was already counted as wasted, while that of the top
+         * block only becomes wasted now, as nothing else will be allocated in it.
+         */
+        const size_t released_unused = released < unused ? released : unused;
+        if (top)
+            pool->wasted_bytes += unused - released_unused;
+        else
+            pool->wasted_bytes -= released_unused;
+    }
+}
+
+void pool_set_huge_pages_enabled(int enabled) {
+    __pool_huge_pages_enabled = enabled;
+}
+
+int pool_get_huge_pages_enabled(void) {
+    return __pool_huge_pages_enabled;
+}
+
+void pool_get_memory_usage(const pool_t *pool, memory_usage_t *out) {
+    out->blocks         = pool->blocks->len;
+    out->reserved_bytes = pool->reserved_bytes;
+    out->used_bytes     = pool->used_bytes;
+    out->wasted_bytes   = pool->wasted_bytes;
+}
+
 void pool_empty(pool_t *pool) {
     g_ptr_array_set_size(pool->blocks, 1);
+    g_array_set_size(pool->block_info, 1);
     pool->top_block_used = 0;
     pool->can_iterate    = 1;
+
+    /* Pages of the first block given back by pool_trim aren't counted again */
+    const size_t reserved_bytes =
+        __pool_get_block_reserved_bytes(pool, __pool_get_block_capacity(pool, 0));
+    if (pool->reserved_bytes > reserved_bytes) {
+        memory_budget_release(pool->reserved_bytes - reserved_bytes);
+        pool->reserved_bytes = reserved_bytes;
+    }
+    pool->used_bytes   = 0;
+    pool->wasted_bytes = 0;
+}
+
+pool_cache_t *pool_cache_create(pool_t *pool) {
+    pool_cache_t *const cache = malloc(sizeof(pool_cache_t));
+    if (!cache)
+        return NULL;
+
+    cache->pool        = pool;
+    cache->block       = NULL;
+    cache->block_index = 0;
+    cache->capacity    = 0;
+    cache->used        = 0;
+    cache->added_array = 0;
+    return cache;
+}
+
+/**
+ * @brief   Gives the current block of a cache back to its pool.
+ * @details The pool's ::pool::cache_mutex must be locked.
+ *
+ * @param cache Cache whose block is to be given back.
+ */
+void __pool_cache_release_block(pool_cache_t *cache) {
+    pool_t *const pool = cache->pool;
+    if (cache->block) {
+        g_array_index(pool->block_info, pool_block_info_t, cache->block_index).length = cache->used;
+        pool->used_bytes += cache->used * pool->item_size;
+        pool->wasted_bytes += (cache->capacity - cache->used) * pool->item_size;
+    }
+
+    if (cache->added_array)
+        pool->can_iterate = 0;
+
+    cache->block    = NULL;
+    cache->capacity = 0;
+    cache->used     = 0;
+}
+
+/**
+ * @brief   Allocates items in a cache when they don't fit in its current block.
+ * @details Auxiliary method for ::__pool_cache_alloc_items, and the only one that locks the pool.
+ *
+ * @param cache Cache where to allocate the items.
+ * @param n     Number of items to allocate.
+ *
+ * @return The pointer to the allocated items, `NULL` on failure.
+ */
+void *__pool_cache_alloc_items_slow(pool_cache_t *cache, size_t n) {
+    pool_t *const pool   = cache->pool;
+    uint8_t      *retval = NULL;
+
+    pthread_mutex_lock(&pool->cache_mutex);
+    if (n > pool->block_capacity) { /* Very large array: keep the current block */
+        retval = __pool_allocate_block_memory(pool, n);
+        if (retval) {
+            __pool_insert_block(pool, retval, n, n);
+            pool->used_bytes += n * pool->item_size;
+            pool->can_iterate = 0;
+        }
+    } else {
+        uint8_t *const block = __pool_allocate_block_memory(pool, pool->block_capacity);
+        if (block) {
+            __pool_cache_release_block(cache);
+            cache->block_index = __pool_insert_block(pool, block, pool->block_capacity, 0);
+            cache->block       = block;
+            cache->capacity    = pool->block_capacity;
+            cache->used        = n;
+            retval             = block;
+        }
+    }
+    pthread_mutex_unlock(&pool->cache_mutex);
+
+    return retval;
+}
+
+void *__pool_cache_alloc_items(pool_cache_t *cache, size_t n) {
+    if (n > 1)
+        cache->added_array = 1;
+    performance_allocations_count_pool(cache->pool->item_size * n);
+
+    if (cache->capacity - cache->used < n)
+        return __pool_cache_alloc_items_slow(cache, n);
+
+    uint8_t *const retval = cache->block + cache->pool->item_size * cache->used;
+    cache->used += n;
+    return retval;
+}
+
+void *__pool_cache_put_items(pool_cache_t *cache, const void *items_location, size_t n) {
+    void *const dest = __pool_cache_alloc_items(cache, n);
+    if (!dest)
+        return NULL;
+
+    memcpy(dest, items_location, cache->pool->item_size * n);
+    return dest;
+}
+
+void pool_cache_free(pool_cache_t *cache) {
+    pthread_mutex_lock(&cache->pool->cache_mutex);
+    __pool_cache_release_block(cache);
+    pthread_mutex_unlock(&cache->pool->cache_mutex);
+    free(cache);
 }
 
 void pool_free(pool_t *pool) {
+    memory_budget_release(pool->reserved_bytes);
+    pthread_mutex_destroy(&pool->cache_mutex);
+    g_array_unref(pool->block_info);
     g_ptr_array_unref(pool->blocks);
     free(pool);
 }
@@ -0,0 +1,323 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  prefix_trie.c
+ * @brief Implementation of methods in include/utils/prefix_trie.h
+ *
+ * ### Example
+ * See [the header file's documentation](@ref prefix_trie_example).
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/prefix_trie.h"
+
+/**
+ * @struct prefix_trie_node_t
+ * @brief  Node of a ::prefix_trie_t.
+ *
+ * @var prefix_trie_node_t::first
+ *     @brief Index of the first key in the node's subtree.
+ * @var prefix_trie_node_t::end
+ *     @brief Index of the key after the last one in the node's subtree.
+ * @var prefix_trie_node_t::depth
+ *     @brief Length of the prefix shared by all keys in the node's subtree.
+ * @var prefix_trie_node_t::children
+ *     @brief Index of the node's first child in ::prefix_trie::nodes. Children are contiguous and
+ *            sorted by ::prefix_trie_node_t::label.
+ * @var prefix_trie_node_t::nchildren
+ *     @brief Number of children of the node.
+ * @var prefix_trie_node_t::label
+ *     @brief Byte of the node's keys right after the prefix of its parent.
+ * @var prefix_trie_node_t::reserved
+ *     @brief Always `0`, so that nodes have no uninitialized padding when they're stored.
+ */
+typedef struct {
+    uint32_t first, end;
+    uint32_t depth;
+    uint32_t children;
+    uint16_t nchildren;
+    uint8_t  label;
+    uint8_t  reserved;
+} prefix_trie_node_t;
+
+/**
+ * @struct prefix_trie
+ * @brief  Path-compressed trie over a sorted array of strings.
+ *
+ * @var prefix_trie::nodes
+ *     @brief Nodes of the trie. The root is the first one, and children always come after their
+ *            parents.
+ * @var prefix_trie::nnodes
+ *     @brief Number of nodes in ::prefix_trie::nodes.
+ */
+struct prefix_trie {
+    prefix_trie_node_t *nodes;
+    size_t              nnodes;
+};
+
+/**
+ * @brief Calculates the length of the prefix shared by two strings.
+ *
+ * @param a     First string.
+ * @param b     Second string.
+ * @param start Number of bytes already known to be shared.
+ *
+ * @return The length of the longest common prefix of @p a and @p b.
+ */
+size_t __prefix_trie_common_prefix(const char *a, const char *b, size_t start) {
+    size_t i = start;
+    while (a[i] && a[i] == b[i])
+        ++i;
+    return i;
+}
+
+/**
+ * @brief   Adds the children of a node to a trie being built, and then builds their subtrees.
+ * @details Auxiliary method for ::prefix_trie_create. Recursion depth is bounded by the length of
+ *          the longest key.
+ *
+ * @param trie      Trie being built, with enough space for all of its nodes.
+ * @param index     Index of the node whose children are to be added.
+ * @param key       Callback for getting each key.
+ * @param user_data Argument passed to @p key.
+ */
+void __prefix_trie_build_children(prefix_trie_t             *trie,
+                                  size_t                     index,
+                                  prefix_trie_key_callback_t key,
+                                  void                      *user_data) {
+    const uint32_t end   = trie->nodes[index].end;
+    const uint32_t depth = trie->nodes[index].depth;
+
+    /* Keys that end at this node come first, as they're prefixes of all others */
+    uint32_t i = trie->nodes[index].first;
+    while (i < end && key(user_data, i)[depth] == '\0')
+        ++i;
+
+    const size_t children = trie->nnodes;
+    while (i < end) {
+        const char *const   first_key = key(user_data, i);
+        const unsigned char label     = first_key[depth];
+
+        uint32_t j = i + 1;
+        while (j < end && (unsigned char) key(user_data, j)[depth] == label)
+            ++j;
+
+        const size_t child_depth =
+            __prefix_trie_common_prefix(first_key, key(user_data, j - 1), depth + 1);
+        trie->nodes[trie->nnodes++] = (prefix_trie_node_t) {.first     = i,
+                                                            .end       = j,
+                                                            .depth     = child_depth,
+                                                            .children  = 0,
+                                                            .nchildren = 0,
+                                                            .label     = label,
+                                                            .reserved  = 0};
+        i = j;
+    }
+
+    trie->nodes[index].children  = children;
+    trie->nodes[index].nchildren = trie->nnodes - children;
+    for (size_t c = children; c < children + trie->nodes[index].nchildren; ++c)
+        __prefix_trie_build_children(trie, c, key, user_data);
+}
+
+prefix_trie_t *prefix_trie_create(size_t n, prefix_trie_key_callback_t key, void *user_data) {
+    if (n >= UINT32_MAX)
+        return NULL;
+
+    prefix_trie_t *const trie = malloc(sizeof(prefix_trie_t));
+    if (!trie)
+        return NULL;
+
+    /*
+     * Every node other than the root has keys ending in it or at least two children (otherwise, it
+     * would have been merged with its only child). So, there are at most 2n + 1 nodes.
+     */
+    trie->nodes = malloc((2 * n + 1) * sizeof(prefix_trie_node_t));
+    if (!trie->nodes) {
+        free(trie);
+        return NULL;
+    }
+
+    const size_t depth =
+        n ? __prefix_trie_common_prefix(key(user_data, 0), key(user_data, n - 1), 0) : 0;
+    trie->nodes[0] = (prefix_trie_node_t) {.first     = 0,
+                                           .end       = n,
+                                           .depth     = depth,
+                                           .children  = 0,
+                                           .nchildren = 0,
+                                           .label     = 0,
+                                           .reserved  = 0};
+    trie->nnodes   = 1;
+    if (n)
+        __prefix_trie_build_children(trie, 0, key, user_data);
+
+    /* Release the nodes that weren't needed */
+    prefix_trie_node_t *const nodes =
+        realloc(trie->nodes, trie->nnodes * sizeof(prefix_trie_node_t));
+    if (nodes)
+        trie->nodes = nodes;
+    return trie;
+}
+
+/**
+ * @brief   Checks if the nodes of a trie are consistent with its keys.
+ * @details Auxiliary method for ::prefix_trie_create_from_data.
+ *
+ * @param trie      Trie to be checked.
+ * @param n         Number of keys.
+ * @param key       Callback for getting each key.
+ * @param user_data Argument passed to @p key.
+ *
+ * @return Whether lookups in @p trie can't read out of bounds.
+ */
+int __prefix_trie_is_valid(const prefix_trie_t       *trie,
+                           size_t                     n,
+                           prefix_trie_key_callback_t key,
+                           void                      *user_data) {
+    const prefix_trie_node_t *const root = &trie->nodes[0];
+    if (root->first != 0 || root->end != n)
+        return 0;
+
+    for (size_t i = 0; i < trie->nnodes; ++i) {
+        const prefix_trie_node_t *const node = &trie->nodes[i];
+        if (node->first > node->end || node->end > n ||
+            (node->first < node->end && node->depth > strlen(key(user_data, node->first))))
+            return 0;
+
+        /* Children coming after their parents guarantees that lookups end */
+        if (node->nchildren &&
+            (node->children <= i || node->children + node->nchildren > trie->nnodes))
+            return 0;
+
+        for (size_t c = node->children; c < (size_t) node->children + node->nchildren; ++c) {
+            const prefix_trie_node_t *const child = &trie->nodes[c];
+            if (child->first < node->first || child->end > node->end ||
+                child->first >= child->end || child->depth <= node->depth)
+                return 0;
+        }
+    }
+    return 1;
+}
+
+prefix_trie_t *prefix_trie_create_from_data(const void                *data,
+                                            size_t                     length,
+                                            size_t                     n,
+                                            prefix_trie_key_callback_t key,
+                                            void                      *user_data) {
+    if (!length || length % sizeof(prefix_trie_node_t) || n >= UINT32_MAX)
+        return NULL;
+
+    prefix_trie_t *const trie = malloc(sizeof(prefix_trie_t));
+    if (!trie)
+        return NULL;
+
+    trie->nodes = malloc(length);
+    if (!trie->nodes) {
+        free(trie);
+        return NULL;
+    }
+    memcpy(trie->nodes, data, length);
+    trie->nnodes = length / sizeof(prefix_trie_node_t);
+
+    if (!__prefix_trie_is_valid(trie, n, key, user_data)) {
+        prefix_trie_free(trie);
+        return NULL;
+    }
+    return trie;
+}
+
+/**
+ * @brief   Finds the child of a node whose keys continue with a given byte.
+ * @details Auxiliary method for ::prefix_trie_find.
+ *
+ * @param trie  Trie where to perform the lookup.
+ * @param node  Node whose children are to be searched.
+ * @param label Byte after the prefix of @p node.
+ *
+ * @return The child, or `NULL` if there's none.
+ */
+const prefix_trie_node_t *__prefix_trie_find_child(const prefix_trie_t      *trie,
+                                                   const prefix_trie_node_t *node,
+                                                   unsigned char             label) {
+    size_t low = node->children, high = (size_t) node->children + node->nchildren;
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (trie->nodes[middle].label < label)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    if (low < (size_t) node->children + node->nchildren && trie->nodes[low].label == label)
+        return &trie->nodes[low];
+    return NULL;
+}
+
+void prefix_trie_find(const prefix_trie_t       *trie,
+                      const char                *prefix,
+                      prefix_trie_key_callback_t key,
+                      void                      *user_data,
+                      size_t                    *first,
+                      size_t                    *count) {
+    *first = 0;
+    *count = 0;
+
+    const prefix_trie_node_t *node = &trie->nodes[0];
+    if (node->first == node->end)
+        return;
+
+    const size_t length  = strlen(prefix);
+    size_t       matched = 0;
+    for (;;) {
+        /* Check the part of the prefix compressed into this node, against any of its keys */
+        const char *const node_key = key(user_data, node->first);
+        const size_t      limit    = node->depth < length ? node->depth : length;
+        if (memcmp(node_key + matched, prefix + matched, limit - matched))
+            return;
+
+        if (length <= node->depth) {
+            *first = node->first;
+            *count = node->end - node->first;
+            return;
+        }
+
+        matched = node->depth;
+        node    = __prefix_trie_find_child(trie, node, (unsigned char) prefix[matched]);
+        if (!node)
+            return;
+    }
+}
+
+const void *prefix_trie_get_data(const prefix_trie_t *trie, size_t *length) {
+    *length = trie->nnodes * sizeof(prefix_trie_node_t);
+    return trie->nodes;
+}
+
+size_t prefix_trie_get_size(const prefix_trie_t *trie) {
+    return sizeof(prefix_trie_t) + trie->nnodes * sizeof(prefix_trie_node_t);
+}
+
+void prefix_trie_free(prefix_trie_t *trie) {
+    if (!trie)
+        return;
+
+    free(trie->nodes);
+    free(trie);
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  quantile_histogram.c
+ * @brief Implementation of methods in include/utils/quantile_histogram.h
+ *
+ * ### Example
+ * See [the header file's documentation](@ref quantile_histogram_example).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/int_utils.h"
+#include "utils/quantile_histogram.h"
+
+/** @brief Number of values recorded exactly, before values start being grouped in buckets. */
+#define QUANTILE_HISTOGRAM_SUB_BUCKETS (1 << QUANTILE_HISTOGRAM_SUB_BUCKET_BITS)
+
+/**
+ * @struct quantile_histogram
+ * @brief  Bounded log-bucketed histogram.
+ *
+ * @var quantile_histogram::buckets
+ *     @brief   Number of values in each bucket (see ::__quantile_histogram_get_bucket).
+ *     @details Only allocated up to the bucket of the largest value.
+ * @var quantile_histogram::nbuckets
+ *     @brief Number of elements in ::quantile_histogram::buckets.
+ * @var quantile_histogram::count
+ *     @brief Total number of values.
+ * @var quantile_histogram::min
+ *     @brief Smallest value.
+ * @var quantile_histogram::max
+ *     @brief Largest value.
+ */
+struct quantile_histogram {
+    uint32_t *buckets;
+    size_t    nbuckets;
+    size_t    count;
+    uint64_t  min, max;
+};
+
+/**
+ * @brief Calculates the index of the bucket a value belongs to.
+ * @param value Value to be recorded.
+ * @return The index of the bucket in ::quantile_histogram::buckets.
+ */
+size_t __quantile_histogram_get_bucket(uint64_t value) {
+    if (value < QUANTILE_HISTOGRAM_SUB_BUCKETS)
+        return value;
+
+    /* Keep the QUANTILE_HISTOGRAM_SUB_BUCKET_BITS most significant bits */
+    const int      shift = 63 - __builtin_clzll(value) - QUANTILE_HISTOGRAM_SUB_BUCKET_BITS + 1;
+    const uint64_t sub   = (value >> shift) - QUANTILE_HISTOGRAM_SUB_BUCKETS / 2;
+    return (size_t) shift * QUANTILE_HISTOGRAM_SUB_BUCKETS / 2 +
+           QUANTILE_HISTOGRAM_SUB_BUCKETS / 2 + sub;
+}
+
+/**
+ * @brief Calculates the value in the middle of a bucket.
+ * @param bucket Index of the bucket in ::quantile_histogram::buckets.
+ * @return The middle of the range of values ::__quantile_histogram_get_bucket maps to @p bucket.
+ */
+uint64_t __quantile_histogram_get_bucket_middle(size_t bucket) {
+    if (bucket < QUANTILE_HISTOGRAM_SUB_BUCKETS)
+        return bucket;
+
+    const size_t   half  = QUANTILE_HISTOGRAM_SUB_BUCKETS / 2;
+    const size_t   shift = (bucket - half) / half;
+    const uint64_t sub   = (bucket - half) % half + half;
+    return (sub << shift) + ((((uint64_t) 1 << shift) - 1) >> 1);
+}
+
+quantile_histogram_t *quantile_histogram_create(void) {
+    return calloc(1, sizeof(quantile_histogram_t));
+}
+
+int quantile_histogram_record(quantile_histogram_t *histogram, uint64_t value) {
+    const size_t bucket = __quantile_histogram_get_bucket(value);
+    if (bucket >= histogram->nbuckets) {
+        const size_t    nbuckets = max(bucket + 1, histogram->nbuckets * 2);
+        uint32_t *const buckets  = realloc(histogram->buckets, nbuckets * sizeof(uint32_t));
+        if (!buckets)
+            return 1;
+
+        memset(buckets + histogram->nbuckets,
+               0,
+               (nbuckets - histogram->nbuckets) * sizeof(uint32_t));
+        histogram->buckets  = buckets;
+        histogram->nbuckets = nbuckets;
+    }
+
+    histogram->buckets[bucket]++;
+    if (!histogram->count || value < histogram->min)
+        histogram->min = value;
+    if (!histogram->count || value > histogram->max)
+        histogram->max = value;
+    histogram->count++;
+    return 0;
+}
+
+size_t quantile_histogram_get_count(const quantile_histogram_t *histogram) {
+    return histogram->count;
+}
+
+uint64_t quantile_histogram_get_rank(const quantile_histogram_t *histogram, size_t rank) {
+    size_t seen = 0;
+    for (size_t i = 0; i < histogram->nbuckets; ++i) {
+        seen += histogram->buckets[i];
+        if (seen > rank) {
+            const uint64_t middle = __quantile_histogram_get_bucket_middle(i);
+            return min(max(middle, histogram->min), histogram->max);
+        }
+    }
+    return histogram->max;
+}
+
+size_t quantile_histogram_get_size(const quantile_histogram_t *histogram) {
+    return sizeof(quantile_histogram_t) + histogram->nbuckets * sizeof(uint32_t);
+}
+
+void quantile_histogram_free(quantile_histogram_t *histogram) {
+    if (!histogram)
+        return;
+
+    free(histogram->buckets);
+    free(histogram);
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  radix_sort.c
+ * @brief Implementation of methods in include/utils/radix_sort.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref radix_sort_examples).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/radix_sort.h"
+
+/**
+ * @brief Arrays shorter than this are sorted with insertion sort, as the cost of counting every
+ *        byte of the keys would dominate.
+ */
+#define RADIX_SORT_INSERTION_THRESHOLD 64
+
+/** @brief Number of bytes in the keys of a ::radix_sort_entry_t (tiebreak first). */
+#define RADIX_SORT_DIGITS (sizeof(uint32_t) + sizeof(uint64_t))
+
+/**
+ * @brief Gets a byte of the keys of an entry.
+ *
+ * @param entry Entry to get the byte from.
+ * @param digit Index of the byte, starting from the least significant byte of
+ *              ::radix_sort_entry_t::tiebreak, and ending on the most significant byte of
+ *              ::radix_sort_entry_t::key.
+ */
+#define radix_sort_get_digit(entry, digit)                                                         \
+    ((uint8_t) ((digit) < sizeof(uint32_t)                                                         \
+                    ? (entry)->tiebreak >> ((digit) * 8)                                           \
+                    : (entry)->key >> (((digit) - sizeof(uint32_t)) * 8)))
+
+/**
+ * @brief Checks if an entry comes before another in sorted order.
+ *
+ * @param a First entry.
+ * @param b Second entry.
+ */
+#define radix_sort_less_than(a, b)                                                                 \
+    ((a)->key < (b)->key || ((a)->key == (b)->key && (a)->tiebreak < (b)->tiebreak))
+
+/**
+ * @brief   Sorts a short array of entries.
+ * @details Auxiliary method for ::radix_sort.
+ *
+ * @param entries Items to be sorted.
+ * @param length  Number of items in @p entries.
+ */
+void __radix_sort_insertion(radix_sort_entry_t *entries, size_t length) {
+    for (size_t i = 1; i < length; ++i) {
+        const radix_sort_entry_t entry = entries[i];
+
+        size_t j = i;
+        for (; j > 0 && radix_sort_less_than(&entry, &entries[j - 1]); --j)
+            entries[j] = entries[j - 1];
+        entries[j] = entry;
+    }
+}
+
+int radix_sort(radix_sort_entry_t *entries, size_t length) {
+    if (length < RADIX_SORT_INSERTION_THRESHOLD) {
+        __radix_sort_insertion(entries, length);
+        return 0;
+    }
+
+    radix_sort_entry_t *const buffer = malloc(length * sizeof(radix_sort_entry_t));
+    if (!buffer)
+        return 1;
+
+    /* Count all digits in a single pass over the entries */
+    size_t(*const counts)[256] = calloc(RADIX_SORT_DIGITS, sizeof(size_t[256]));
+    if (!counts) {
+        free(buffer);
+        return 1;
+    }
+
+    for (size_t i = 0; i < length; ++i)
+        for (size_t d = 0; d < RADIX_SORT_DIGITS; ++d)
+            counts[d][radix_sort_get_digit(&entries[i], d)]++;
+
+    radix_sort_entry_t *from = entries, *to = buffer;
+    for (size_t d = 0; d < RADIX_SORT_DIGITS; ++d) {
+        /* Skip digits that are the same in all entries */
+        if (counts[d][radix_sort_get_digit(&entries[0], d)] == length)
+            continue;
+
+        size_t offsets[256];
+        size_t sum = 0;
+        for (size_t b = 0; b < 256; ++b) {
+            offsets[b] = sum;
+            sum += counts[d][b];
+        }
+
+        for (size_t i = 0; i < length; ++i)
+            to[offsets[radix_sort_get_digit(&from[i], d)]++] = from[i];
+
+        radix_sort_entry_t *const tmp = from;
+        from                          = to;
+        to                            = tmp;
+    }
+
+    if (from != entries)
+        memcpy(entries, from, length * sizeof(radix_sort_entry_t));
+
+    free(counts);
+    free(buffer);
+    return 0;
+}
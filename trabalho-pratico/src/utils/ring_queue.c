@@ -0,0 +1,436 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  ring_queue.c
+ * @brief Implementation of methods in include/utils/ring_queue.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref ring_queue_examples).
+ */
+
+/** @cond FALSE */
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE /* For syscall */
+#endif
+/** @endcond */
+
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "utils/int_utils.h"
+#include "utils/ring_queue.h"
+
+/** @brief Size of a cache line, so that producers and consumers don't write to the same line. */
+#define RING_QUEUE_CACHE_LINE_SIZE 64
+
+/**
+ * @brief Number of times ::ring_queue_push_wait and ::ring_queue_pop_wait retry before sleeping,
+ *        as the other side is often only a few instructions away from being ready.
+ */
+#define RING_QUEUE_SPIN_COUNT 256
+
+/**
+ * @struct ring_queue_cell_t
+ * @brief  A slot of a queue in ::RING_QUEUE_MPMC mode.
+ *
+ * @var ring_queue_cell_t::sequence
+ *     @brief   Index of the push (or, minus one, of the pop) the slot is ready for.
+ *     @details Equal to the index of a push when the slot is free for it, to that index plus one
+ *              once the item is written, and to that index plus the capacity once it's popped.
+ * @var ring_queue_cell_t::item
+ *     @brief Item in the slot.
+ */
+typedef struct {
+    size_t sequence;
+    void  *item;
+} ring_queue_cell_t;
+
+/**
+ * @struct ring_queue_side_t
+ * @brief  Index of one of the ends of a queue, in a cache line of its own.
+ *
+ * @var ring_queue_side_t::index
+ *     @brief Number of items pushed (for producers) or popped (for consumers) so far.
+ * @var ring_queue_side_t::cached
+ *     @brief   Last value read from the other side's ::ring_queue_side_t::index.
+ *     @details Only used in ::RING_QUEUE_SPSC mode, so that the other side's cache line is only
+ *              read when the queue seems full or empty.
+ * @var ring_queue_side_t::padding
+ *     @brief Unused.
+ */
+typedef struct {
+    size_t index, cached;
+    char   padding[RING_QUEUE_CACHE_LINE_SIZE - 2 * sizeof(size_t)];
+} ring_queue_side_t;
+
+/**
+ * @struct ring_queue_waiters_t
+ * @brief  State of the threads sleeping on a queue, in a cache line of its own.
+ *
+ * @var ring_queue_waiters_t::not_empty
+ *     @brief Futex that consumers sleep on, incremented when items are pushed and someone sleeps.
+ * @var ring_queue_waiters_t::not_full
+ *     @brief Futex that producers sleep on, incremented when items are popped and someone sleeps.
+ * @var ring_queue_waiters_t::consumers
+ *     @brief Number of consumers sleeping (or about to sleep) on ::ring_queue_waiters_t::not_empty.
+ * @var ring_queue_waiters_t::producers
+ *     @brief Number of producers sleeping (or about to sleep) on ::ring_queue_waiters_t::not_full.
+ * @var ring_queue_waiters_t::closed
+ *     @brief Whether ::ring_queue_close has been called.
+ * @var ring_queue_waiters_t::padding
+ *     @brief Unused.
+ */
+typedef struct {
+    uint32_t not_empty, not_full;
+    uint32_t consumers, producers;
+    uint32_t closed;
+    char     padding[RING_QUEUE_CACHE_LINE_SIZE - 5 * sizeof(uint32_t)];
+} ring_queue_waiters_t;
+
+/**
+ * @struct ring_queue
+ * @brief  A bounded lock-free queue of pointers.
+ *
+ * @var ring_queue::producer
+ *     @brief Index of the tail of the queue.
+ * @var ring_queue::consumer
+ *     @brief Index of the head of the queue.
+ * @var ring_queue::waiters
+ *     @brief Threads waiting for items or for space.
+ * @var ring_queue::mode
+ *     @brief Which threads may use the queue.
+ * @var ring_queue::mask
+ *     @brief Capacity of the queue minus one, to get a slot from an index.
+ * @var ring_queue::items
+ *     @brief Slots of the queue in ::RING_QUEUE_SPSC mode (`NULL` otherwise).
+ * @var ring_queue::cells
+ *     @brief Slots of the queue in ::RING_QUEUE_MPMC mode (`NULL` otherwise).
+ */
+struct ring_queue {
+    ring_queue_side_t    producer;
+    ring_queue_side_t    consumer;
+    ring_queue_waiters_t waiters;
+
+    ring_queue_mode_t  mode;
+    size_t             mask;
+    void             **items;
+    ring_queue_cell_t *cells;
+};
+
+ring_queue_t *ring_queue_create(size_t capacity, ring_queue_mode_t mode) {
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        if (rounded > SIZE_MAX / 2 / sizeof(ring_queue_cell_t))
+            return NULL;
+        rounded *= 2;
+    }
+
+    void *queue_data;
+    if (posix_memalign(&queue_data, RING_QUEUE_CACHE_LINE_SIZE, sizeof(ring_queue_t)))
+        return NULL;
+    ring_queue_t *const queue = queue_data;
+
+    queue->producer = (ring_queue_side_t) {.index = 0, .cached = 0, .padding = {0}};
+    queue->consumer = (ring_queue_side_t) {.index = 0, .cached = 0, .padding = {0}};
+    queue->waiters  = (ring_queue_waiters_t) {.not_empty = 0,
+                                              .not_full  = 0,
+                                              .consumers = 0,
+                                              .producers = 0,
+                                              .closed    = 0,
+                                              .padding   = {0}};
+    queue->mode     = mode;
+    queue->mask     = rounded - 1;
+    queue->items    = NULL;
+    queue->cells    = NULL;
+
+    if (mode == RING_QUEUE_SPSC) {
+        queue->items = malloc(rounded * sizeof(void *));
+        if (!queue->items)
+            goto DEFER_1;
+    } else {
+        queue->cells = malloc(rounded * sizeof(ring_queue_cell_t));
+        if (!queue->cells)
+            goto DEFER_1;
+
+        for (size_t i = 0; i < rounded; ++i)
+            queue->cells[i] = (ring_queue_cell_t) {.sequence = i, .item = NULL};
+    }
+    return queue;
+
+DEFER_1:
+    free(queue);
+    return NULL;
+}
+
+size_t ring_queue_get_capacity(const ring_queue_t *queue) {
+    return queue->mask + 1;
+}
+
+/**
+ * @brief   Gets the number of items in a queue (or about to be).
+ * @details Only an estimate, as other threads may be modifying the queue.
+ *
+ * @param queue Queue to get the length of.
+ */
+size_t __ring_queue_get_length(const ring_queue_t *queue) {
+    const size_t head = __atomic_load_n(&queue->consumer.index, __ATOMIC_ACQUIRE);
+    const size_t tail = __atomic_load_n(&queue->producer.index, __ATOMIC_ACQUIRE);
+    return tail - head;
+}
+
+/**
+ * @brief   Wakes up the threads sleeping on a futex of a queue, if there are any.
+ * @details The fence pairs with the one in ::__ring_queue_sleep: either the sleeping thread sees
+ *          the items (or space) just published, or this method sees it's sleeping.
+ *
+ * @param futex   Futex to wake threads sleeping on.
+ * @param waiting Number of threads sleeping on @p futex.
+ */
+void __ring_queue_wake(uint32_t *futex, const uint32_t *waiting) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(waiting, __ATOMIC_RELAXED))
+        return;
+
+    __atomic_fetch_add(futex, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, futex, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+/**
+ * @brief   Sleeps on a futex of a queue, unless what the thread waits for has already happened.
+ * @details May return spuriously, so callers must check what they're waiting for again.
+ *
+ * @param queue     Queue to sleep on.
+ * @param futex     Futex to sleep on (::ring_queue_waiters_t::not_empty or
+ *                  ::ring_queue_waiters_t::not_full).
+ * @param waiting   Number of threads sleeping on @p futex.
+ * @param consumer  Whether the thread waits for items (or else for space).
+ */
+void __ring_queue_sleep(ring_queue_t *queue, uint32_t *futex, uint32_t *waiting, int consumer) {
+    const uint32_t value = __atomic_load_n(futex, __ATOMIC_ACQUIRE);
+    __atomic_fetch_add(waiting, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    const size_t length = __ring_queue_get_length(queue);
+    const int    ready  = consumer ? length > 0 : length <= queue->mask;
+    if (!ready && !__atomic_load_n(&queue->waiters.closed, __ATOMIC_ACQUIRE))
+        syscall(SYS_futex, futex, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+
+    __atomic_fetch_sub(waiting, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Pushes items to a queue in ::RING_QUEUE_SPSC mode. See ::ring_queue_push.
+ *
+ * @param queue Queue to push items to.
+ * @param items Items to be pushed.
+ * @param n     Number of items in @p items.
+ *
+ * @return The number of items pushed.
+ */
+size_t __ring_queue_spsc_push(ring_queue_t *queue, void *const *items, size_t n) {
+    const size_t tail     = queue->producer.index; /* Only written by this thread */
+    const size_t capacity = queue->mask + 1;
+    if (capacity - (tail - queue->producer.cached) < n)
+        queue->producer.cached = __atomic_load_n(&queue->consumer.index, __ATOMIC_ACQUIRE);
+
+    const size_t count = min(n, capacity - (tail - queue->producer.cached));
+    for (size_t i = 0; i < count; ++i)
+        queue->items[(tail + i) & queue->mask] = items[i];
+
+    if (count)
+        __atomic_store_n(&queue->producer.index, tail + count, __ATOMIC_RELEASE);
+    return count;
+}
+
+/**
+ * @brief Pops items from a queue in ::RING_QUEUE_SPSC mode. See ::ring_queue_pop.
+ *
+ * @param queue Queue to pop items from.
+ * @param items Where to write the popped items to.
+ * @param n     Maximum number of items to pop.
+ *
+ * @return The number of items popped.
+ */
+size_t __ring_queue_spsc_pop(ring_queue_t *queue, void **items, size_t n) {
+    const size_t head = queue->consumer.index; /* Only written by this thread */
+    if (queue->consumer.cached - head < n)
+        queue->consumer.cached = __atomic_load_n(&queue->producer.index, __ATOMIC_ACQUIRE);
+
+    const size_t count = min(n, queue->consumer.cached - head);
+    for (size_t i = 0; i < count; ++i)
+        items[i] = queue->items[(head + i) & queue->mask];
+
+    if (count)
+        __atomic_store_n(&queue->consumer.index, head + count, __ATOMIC_RELEASE);
+    return count;
+}
+
+/**
+ * @brief Pushes an item to a queue in ::RING_QUEUE_MPMC mode.
+ *
+ * @param queue Queue to push the item to.
+ * @param item  Item to be pushed.
+ *
+ * @retval 0 Success.
+ * @retval 1 The queue is full.
+ */
+int __ring_queue_mpmc_push_one(ring_queue_t *queue, void *item) {
+    size_t position = __atomic_load_n(&queue->producer.index, __ATOMIC_RELAXED);
+    for (;;) {
+        ring_queue_cell_t *const cell     = &queue->cells[position & queue->mask];
+        const size_t             sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        const ptrdiff_t          distance = (ptrdiff_t) (sequence - position);
+
+        if (distance == 0) {
+            /* On failure, position is updated to the current tail */
+            if (__atomic_compare_exchange_n(&queue->producer.index,
+                                            &position,
+                                            position + 1,
+                                            1,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                cell->item = item;
+                __atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+                return 0;
+            }
+        } else if (distance < 0) {
+            return 1; /* The slot still holds an item from the previous lap */
+        } else {
+            position = __atomic_load_n(&queue->producer.index, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * @brief Pops an item from a queue in ::RING_QUEUE_MPMC mode.
+ *
+ * @param queue Queue to pop the item from.
+ * @param item  Where to write the popped item to.
+ *
+ * @retval 0 Success.
+ * @retval 1 The queue is empty.
+ */
+int __ring_queue_mpmc_pop_one(ring_queue_t *queue, void **item) {
+    size_t position = __atomic_load_n(&queue->consumer.index, __ATOMIC_RELAXED);
+    for (;;) {
+        ring_queue_cell_t *const cell     = &queue->cells[position & queue->mask];
+        const size_t             sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        const ptrdiff_t          distance = (ptrdiff_t) (sequence - (position + 1));
+
+        if (distance == 0) {
+            /* On failure, position is updated to the current head */
+            if (__atomic_compare_exchange_n(&queue->consumer.index,
+                                            &position,
+                                            position + 1,
+                                            1,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                *item = cell->item;
+                __atomic_store_n(&cell->sequence, position + queue->mask + 1, __ATOMIC_RELEASE);
+                return 0;
+            }
+        } else if (distance < 0) {
+            return 1; /* The slot's item hasn't been pushed yet */
+        } else {
+            position = __atomic_load_n(&queue->consumer.index, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+size_t ring_queue_push(ring_queue_t *queue, void *const *items, size_t n) {
+    size_t count = 0;
+    if (queue->mode == RING_QUEUE_SPSC)
+        count = __ring_queue_spsc_push(queue, items, n);
+    else
+        while (count < n && !__ring_queue_mpmc_push_one(queue, items[count]))
+            count++;
+
+    if (count)
+        __ring_queue_wake(&queue->waiters.not_empty, &queue->waiters.consumers);
+    return count;
+}
+
+size_t ring_queue_pop(ring_queue_t *queue, void **items, size_t n) {
+    size_t count = 0;
+    if (queue->mode == RING_QUEUE_SPSC)
+        count = __ring_queue_spsc_pop(queue, items, n);
+    else
+        while (count < n && !__ring_queue_mpmc_pop_one(queue, &items[count]))
+            count++;
+
+    if (count)
+        __ring_queue_wake(&queue->waiters.not_full, &queue->waiters.producers);
+    return count;
+}
+
+int ring_queue_push_wait(ring_queue_t *queue, void *const *items, size_t n) {
+    size_t pushed = 0, spins = 0;
+    while (pushed < n) {
+        if (__atomic_load_n(&queue->waiters.closed, __ATOMIC_ACQUIRE))
+            return 1;
+
+        const size_t count = ring_queue_push(queue, items + pushed, n - pushed);
+        pushed += count;
+        if (count) {
+            spins = 0;
+        } else if (++spins >= RING_QUEUE_SPIN_COUNT) {
+            __ring_queue_sleep(queue, &queue->waiters.not_full, &queue->waiters.producers, 0);
+            spins = 0;
+        }
+    }
+    return 0;
+}
+
+size_t ring_queue_pop_wait(ring_queue_t *queue, void **items, size_t n) {
+    for (size_t spins = 0;; ++spins) {
+        const size_t count = ring_queue_pop(queue, items, n);
+        if (count)
+            return count;
+
+        /* Items pushed before the queue was closed must still be popped */
+        if (__atomic_load_n(&queue->waiters.closed, __ATOMIC_ACQUIRE))
+            return ring_queue_pop(queue, items, n);
+
+        if (spins >= RING_QUEUE_SPIN_COUNT) {
+            __ring_queue_sleep(queue, &queue->waiters.not_empty, &queue->waiters.consumers, 1);
+            spins = 0;
+        }
+    }
+}
+
+void ring_queue_close(ring_queue_t *queue) {
+    __atomic_store_n(&queue->waiters.closed, 1, __ATOMIC_SEQ_CST);
+
+    __atomic_fetch_add(&queue->waiters.not_empty, 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&queue->waiters.not_full, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &queue->waiters.not_empty, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    syscall(SYS_futex, &queue->waiters.not_full, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+void ring_queue_free(ring_queue_t *queue) {
+    if (!queue)
+        return;
+
+    free(queue->items);
+    free(queue->cells);
+    free(queue);
+}
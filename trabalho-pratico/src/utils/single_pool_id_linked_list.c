@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+
 /**
  * @file  single_pool_id_linked_list.c
  * @brief Implementation of methods in include/utils/single_pool_id_linked_list.h
@@ -22,81 +23,177 @@
  * See [the header file's documentation](@ref single_pool_id_linked_list_examples).
  */
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "utils/single_pool_id_linked_list.h"
 
 /**
- * @struct single_pool_id_linked_list
+ * @struct single_pool_id_linked_list_node_t
  * @brief A node in a ::single_pool_id_linked_list_t.
  *
- * @var single_pool_id_linked_list::value
+ * @var single_pool_id_linked_list_node_t::value
  *     @brief Value stored in this node.
- * @var single_pool_id_linked_list::next
- *     @brief Pointer to the next node.
+ * @var single_pool_id_linked_list_node_t::next
+ *     @brief Index of the next node in the pool (`0` for the end of the list).
+ */
+typedef struct {
+    uint32_t                     value;
+    single_pool_id_linked_list_t next;
+} single_pool_id_linked_list_node_t;
+
+/**
+ * @struct single_pool_id_linked_list_pool
+ * @brief  Allocator for the nodes of many ::single_pool_id_linked_list_t.
+ *
+ * @var single_pool_id_linked_list_pool::nodes
+ *     @brief   Array of all nodes in the pool.
+ *     @details Index `0` is never used, so that it can represent the empty list.
+ * @var single_pool_id_linked_list_pool::length
+ *     @brief Number of used positions in ::single_pool_id_linked_list_pool::nodes.
+ * @var single_pool_id_linked_list_pool::capacity
+ *     @brief Number of positions allocated in ::single_pool_id_linked_list_pool::nodes.
  */
-struct single_pool_id_linked_list {
-    const uint32_t                value;
-    single_pool_id_linked_list_t *next;
+struct single_pool_id_linked_list_pool {
+    single_pool_id_linked_list_node_t *nodes;
+    size_t                             length;
+    size_t                             capacity;
 };
 
-single_pool_id_linked_list_t *single_pool_id_linked_list_create(void) {
-    return NULL;
+/**
+ * @brief Maximum number of positions in ::single_pool_id_linked_list_pool::nodes, so that every
+ *        node can be referred to by a ::single_pool_id_linked_list_t.
+ */
+#define SINGLE_POOL_ID_LINKED_LIST_MAX_CAPACITY ((size_t) UINT32_MAX + 1)
+
+single_pool_id_linked_list_t single_pool_id_linked_list_create(void) {
+    return 0;
 }
 
-single_pool_id_linked_list_t *
-    single_pool_id_linked_list_clone(pool_t *allocator, const single_pool_id_linked_list_t *list) {
+single_pool_id_linked_list_pool_t *single_pool_id_linked_list_create_pool(size_t initial_capacity) {
+    single_pool_id_linked_list_pool_t *const pool =
+        malloc(sizeof(single_pool_id_linked_list_pool_t));
+    if (!pool)
+        return NULL;
 
-    if (!list)
+    pool->length   = 1; /* Reserved empty list */
+    pool->capacity = 1;
+    pool->nodes    = malloc(sizeof(single_pool_id_linked_list_node_t));
+    if (!pool->nodes || single_pool_id_linked_list_reserve(pool, initial_capacity)) {
+        single_pool_id_linked_list_free_pool(pool);
         return NULL;
+    }
 
-    single_pool_id_linked_list_t *const ret =
-        pool_put_item(single_pool_id_linked_list_t, allocator, list);
-    if (!ret)
+    return pool;
+}
+
+single_pool_id_linked_list_pool_t *
+    single_pool_id_linked_list_clone_pool(const single_pool_id_linked_list_pool_t *pool) {
+
+    single_pool_id_linked_list_pool_t *const clone =
+        single_pool_id_linked_list_create_pool(pool->length - 1);
+    if (!clone)
         return NULL;
 
-    single_pool_id_linked_list_t *prev = ret;
-    list                               = list->next;
-    while (list) {
-        single_pool_id_linked_list_t *const node =
-            pool_put_item(single_pool_id_linked_list_t, allocator, list);
-        if (!node)
-            return NULL;
-
-        prev->next = node;
-        prev       = node;
-        list       = list->next;
-    }
+    memcpy(clone->nodes, pool->nodes, pool->length * sizeof(single_pool_id_linked_list_node_t));
+    clone->length = pool->length;
+    return clone;
+}
 
-    return ret;
+int single_pool_id_linked_list_reserve(single_pool_id_linked_list_pool_t *pool, size_t count) {
+    if (count > SINGLE_POOL_ID_LINKED_LIST_MAX_CAPACITY - pool->length)
+        return 1;
+
+    const size_t needed = pool->length + count;
+    if (needed <= pool->capacity)
+        return 0;
+
+    /* Grow geometrically, so that appending one node at a time is amortized O(1) */
+    size_t new_capacity = pool->capacity;
+    while (new_capacity < needed)
+        new_capacity *= 2;
+    if (new_capacity > SINGLE_POOL_ID_LINKED_LIST_MAX_CAPACITY)
+        new_capacity = SINGLE_POOL_ID_LINKED_LIST_MAX_CAPACITY;
+
+    single_pool_id_linked_list_node_t *const new_nodes =
+        realloc(pool->nodes, new_capacity * sizeof(single_pool_id_linked_list_node_t));
+    if (!new_nodes)
+        return 1;
+
+    pool->nodes    = new_nodes;
+    pool->capacity = new_capacity;
+    return 0;
 }
 
-single_pool_id_linked_list_t *
-    single_pool_id_linked_list_append_beginning(pool_t                       *allocator,
-                                                single_pool_id_linked_list_t *list,
-                                                uint32_t                      value) {
+int single_pool_id_linked_list_append_beginning(single_pool_id_linked_list_pool_t *pool,
+                                                single_pool_id_linked_list_t      *list,
+                                                uint32_t                           value) {
 
-    const single_pool_id_linked_list_t item = {.value = value, .next = list};
-    return pool_put_item(single_pool_id_linked_list_t, allocator, &item);
+    if (single_pool_id_linked_list_reserve(pool, 1))
+        return 1;
+
+    pool->nodes[pool->length] = (single_pool_id_linked_list_node_t) {.value = value, .next = *list};
+    *list                     = pool->length;
+    pool->length++;
+    return 0;
 }
 
-pool_t *single_pool_id_linked_list_create_pool(size_t block_capacity) {
-    return pool_create(single_pool_id_linked_list_t, block_capacity);
+int single_pool_id_linked_list_allocate_nodes(single_pool_id_linked_list_pool_t *pool,
+                                              size_t                             count,
+                                              single_pool_id_linked_list_t      *first) {
+
+    if (single_pool_id_linked_list_reserve(pool, count))
+        return 1;
+
+    *first = pool->length;
+    pool->length += count;
+    return 0;
 }
 
-uint32_t single_pool_id_linked_list_get_value(const single_pool_id_linked_list_t *list) {
-    return list->value;
+void single_pool_id_linked_list_append_beginning_in_node(single_pool_id_linked_list_pool_t *pool,
+                                                         single_pool_id_linked_list_t      *list,
+                                                         single_pool_id_linked_list_t       node,
+                                                         uint32_t                           value) {
+
+    pool->nodes[node] = (single_pool_id_linked_list_node_t) {.value = value, .next = *list};
+    *list             = node;
 }
 
-const single_pool_id_linked_list_t *
-    single_pool_id_linked_list_get_next(const single_pool_id_linked_list_t *list) {
+uint32_t single_pool_id_linked_list_get_value(const single_pool_id_linked_list_pool_t *pool,
+                                              single_pool_id_linked_list_t             list) {
 
-    return list->next;
+    return pool->nodes[list].value;
 }
 
-size_t single_pool_id_linked_list_length(const single_pool_id_linked_list_t *list) {
+single_pool_id_linked_list_t
+    single_pool_id_linked_list_get_next(const single_pool_id_linked_list_pool_t *pool,
+                                        single_pool_id_linked_list_t             list) {
+
+    return pool->nodes[list].next;
+}
+
+size_t single_pool_id_linked_list_length(const single_pool_id_linked_list_pool_t *pool,
+                                         single_pool_id_linked_list_t             list) {
+
     size_t length = 0;
     while (list) {
         length++;
-        list = list->next;
+        list = pool->nodes[list].next;
     }
     return length;
 }
+
+void single_pool_id_linked_list_get_memory_usage(const single_pool_id_linked_list_pool_t *pool,
+                                                 memory_usage_t                          *out) {
+
+    *out = (memory_usage_t) {
+        .blocks         = 1,
+        .reserved_bytes = pool->capacity * sizeof(single_pool_id_linked_list_node_t),
+        .used_bytes     = pool->length * sizeof(single_pool_id_linked_list_node_t),
+        .wasted_bytes   = 0};
+}
+
+void single_pool_id_linked_list_free_pool(single_pool_id_linked_list_pool_t *pool) {
+    free(pool->nodes);
+    free(pool);
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  small_string.c
+ * @brief Implementation of methods in include/utils/small_string.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref small_string_examples).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/small_string.h"
+
+/** @brief Index of the tag character in ::small_string_t::chars. */
+#define SMALL_STRING_TAG_INDEX SMALL_STRING_INLINE_CAPACITY
+
+void small_string_init(small_string_t *string) {
+    memset(string, 0, sizeof(small_string_t));
+    string->pointer                       = NULL;
+    string->chars[SMALL_STRING_TAG_INDEX] = 1;
+}
+
+int small_string_set(string_pool_t *allocator, small_string_t *string, const char *value) {
+    const size_t length = strlen(value);
+
+    small_string_t new_string;
+    memset(&new_string, 0, sizeof(small_string_t));
+    if (length <= SMALL_STRING_INLINE_CAPACITY) {
+        memcpy(new_string.chars, value, length);
+    } else {
+        new_string.pointer = allocator ? string_pool_put(allocator, value) : strdup(value);
+        if (!new_string.pointer)
+            return 1;
+        new_string.chars[SMALL_STRING_TAG_INDEX] = 1;
+    }
+
+    if (!allocator)
+        small_string_free(string);
+
+    *string = new_string;
+    return 0;
+}
+
+const char *small_string_get(const small_string_t *string) {
+    return string->chars[SMALL_STRING_TAG_INDEX] ? string->pointer : string->chars;
+}
+
+int small_string_equals(const small_string_t *a, const small_string_t *b) {
+    /*
+     * A string is stored in place if and only if it's short, so different tags mean different
+     * lengths. Also, null padding makes equal strings stored in place equal byte by byte.
+     */
+    if (a->chars[SMALL_STRING_TAG_INDEX] != b->chars[SMALL_STRING_TAG_INDEX])
+        return 0;
+    else if (!a->chars[SMALL_STRING_TAG_INDEX])
+        return a->words[0] == b->words[0] && a->words[1] == b->words[1];
+    else
+        return strcmp(a->pointer, b->pointer) == 0;
+}
+
+void small_string_free(small_string_t *string) {
+    if (string->chars[SMALL_STRING_TAG_INDEX])
+        free(string->pointer);
+    small_string_init(string);
+}
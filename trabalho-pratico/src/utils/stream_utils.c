@@ -22,11 +22,49 @@
  * See [the header file's documentation](@ref stream_utils_examples).
  */
 
+/** @cond FALSE */
+#ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE /* For MADV_DONTNEED */
+#endif
+/** @endcond */
+
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "utils/stream_utils.h"
 
+/** @brief Initial size of the buffer for reading non-mappable files in ::stream_tokenize_slices. */
+#define STREAM_TOKENIZE_READ_BUFFER_SIZE (1 << 20)
+
+/**
+ * @brief   Size of the windows memory-mapped files are tokenized in.
+ * @details After each window, the pages behind the last token are released, so that a file with
+ *          delimiters in every page (whose pages are copied when delimiters are replaced by `'\0'`)
+ *          doesn't end up fully copied to anonymous memory.
+ */
+#define STREAM_TOKENIZE_WINDOW_SIZE (1 << 24)
+
+/** @brief Size of each block read ahead by a ::stream_tokenize_pipeline_t. */
+#define STREAM_TOKENIZE_PIPELINE_BLOCK_SIZE (1 << 20)
+
+/** @brief Number of blocks in a ::stream_tokenize_pipeline_t (read ahead or being tokenized). */
+#define STREAM_TOKENIZE_PIPELINE_BLOCKS 4
+
+/** @brief Size of the buffer used by ::stream_copy_file. */
+#define STREAM_COPY_BUFFER_SIZE 65536
+
+void stream_prefetch(int fd) {
+    /* Only hints, so failure (e.g.: on pipes) is ignored */
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+}
+
 int stream_tokenize(FILE                    *file,
                     char                     delimiter,
                     tokenize_iter_callback_t callback,
@@ -57,3 +95,687 @@ int stream_tokenize(FILE                    *file,
         free(token);
     return 0;
 }
+
+/**
+ * @brief Checks if a file can be memory-mapped by ::stream_tokenize_slices.
+ * @param fd  File descriptor of the file.
+ * @param out Where to output information about the file to.
+ * @return Whether @p fd refers to a non-empty regular file.
+ */
+int __stream_tokenize_is_mappable(int fd, struct stat *out) {
+    return !fstat(fd, out) && S_ISREG(out->st_mode) && out->st_size > 0;
+}
+
+stream_tokenize_method_t stream_tokenize_get_method(FILE *file) {
+    struct stat st;
+    return __stream_tokenize_is_mappable(fileno(file), &st) ? STREAM_TOKENIZE_METHOD_MMAP
+                                                            : STREAM_TOKENIZE_METHOD_READ;
+}
+
+/**
+ * @brief   Calls @p callback for every token in a buffer that is followed by a delimiter.
+ * @details Auxiliary method for ::stream_tokenize_slices. Delimiters are replaced by `'\0'`.
+ *
+ * @param buffer       Buffer to be tokenized.
+ * @param length       Number of bytes in @p buffer.
+ * @param delimiter    Character to separate tokens.
+ * @param callback     Function called for every token read.
+ * @param user_data    Pointer passed to every call of @p callback.
+ * @param out_consumed Where to write the number of bytes of @p buffer that were processed (tokens
+ *                     and their delimiters).
+ *
+ * @return `0` on success, or the value returned by @p callback if it ordered tokenization to stop.
+ */
+int __stream_tokenize_slices_buffer(char                          *buffer,
+                                    size_t                         length,
+                                    char                           delimiter,
+                                    tokenize_slice_iter_callback_t callback,
+                                    void                          *user_data,
+                                    size_t                        *out_consumed) {
+
+    char *const end   = buffer + length;
+    char       *token = buffer;
+    char       *next;
+
+    while ((next = memchr(token, delimiter, end - token))) {
+        *next               = '\0';
+        const int cb_result = callback(user_data, token, next - token);
+        token               = next + 1;
+
+        if (cb_result) {
+            *out_consumed = token - buffer;
+            return cb_result;
+        }
+    }
+
+    *out_consumed = token - buffer;
+    return 0;
+}
+
+/**
+ * @brief   Releases the pages of a memory-mapped file between two offsets.
+ * @details Auxiliary method for ::__stream_tokenize_slices_region. Only pages fully inside the
+ *          range are released, as the others may be being tokenized by another thread. Released
+ *          pages are read from the file again if accessed, undoing the replacement of delimiters.
+ *
+ * @param map   Private, writable mapping of the whole file.
+ * @param start Offset in @p map of the first byte that may be released.
+ * @param end   Offset in @p map of the first byte that can't be released.
+ */
+void __stream_tokenize_release(char *map, size_t start, size_t end) {
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    start                  = (start + page_size - 1) / page_size * page_size;
+    end                    = end / page_size * page_size;
+
+    if (start < end)
+        madvise(map + start, end - start, MADV_DONTNEED); /* Failure only means more memory used */
+}
+
+/**
+ * @brief   Tokenizes a region of a memory-mapped file.
+ * @details Auxiliary method for ::stream_tokenize_slices and ::stream_tokenize_slices_chunked. The
+ *          region is tokenized in windows of ::STREAM_TOKENIZE_WINDOW_SIZE bytes (ending right
+ *          after a delimiter), and the pages of each window are released once it's tokenized.
+ *
+ * @param map          Private, writable mapping of the whole file.
+ * @param start        Offset in @p map where to start tokenizing.
+ * @param end          Offset in @p map where to stop tokenizing. Must be right after a delimiter,
+ *                     or the end of the file.
+ * @param delimiter    Character to separate tokens.
+ * @param callback     Function called for every token read.
+ * @param user_data    Pointer passed to every call of @p callback.
+ * @param out_position Where to write the offset in @p map after the last token processed.
+ *
+ * @return `0` on success, the value returned by @p callback when it ordered tokenization to stop,
+ *         or ::STREAM_TOKENIZE_RET_ALLOCATION_FAILURE.
+ */
+int __stream_tokenize_slices_region(char                          *map,
+                                    size_t                         start,
+                                    size_t                         end,
+                                    char                           delimiter,
+                                    tokenize_slice_iter_callback_t callback,
+                                    void                          *user_data,
+                                    size_t                        *out_position) {
+
+    int    retval   = 0;
+    size_t position = start;
+    while (!retval && position < end) {
+        size_t window_end = end;
+        if (end - position > STREAM_TOKENIZE_WINDOW_SIZE) {
+            const size_t      target = position + STREAM_TOKENIZE_WINDOW_SIZE;
+            const char *const next   = memchr(map + target, delimiter, end - target);
+            if (next)
+                window_end = next - map + 1;
+        }
+
+        size_t consumed;
+        retval = __stream_tokenize_slices_buffer(map + position,
+                                                 window_end - position,
+                                                 delimiter,
+                                                 callback,
+                                                 user_data,
+                                                 &consumed);
+        position += consumed;
+        if (window_end == end)
+            break;
+
+        /* Callbacks can't keep tokens, as buffers are reused when files aren't mapped */
+        __stream_tokenize_release(map, start, position);
+    }
+
+    if (!retval && position < end) {
+        /* No delimiter after the last token and maybe no space for '\0'. Copy it to a new buffer */
+        const size_t length = end - position;
+        char *const  last   = malloc(length + 1);
+        if (last) {
+            memcpy(last, map + position, length);
+            last[length] = '\0';
+
+            retval   = callback(user_data, last, length);
+            position = end;
+            free(last);
+        } else {
+            retval = STREAM_TOKENIZE_RET_ALLOCATION_FAILURE;
+        }
+    }
+
+    *out_position = position;
+    return retval;
+}
+
+/**
+ * @brief   Tokenizes a memory-mapped file.
+ * @details Auxiliary method for ::stream_tokenize_slices.
+ *
+ * @param fd        File descriptor of the mapped file, to be positioned after the last token read.
+ * @param map       Private, writable mapping of the whole file.
+ * @param start     Offset in @p map where to start tokenizing.
+ * @param size      Size of the file.
+ * @param delimiter Character to separate tokens.
+ * @param callback  Function called for every token read.
+ * @param user_data Pointer passed to every call of @p callback.
+ *
+ * @return `0` on success, the value returned by @p callback when it ordered tokenization to stop,
+ *         or ::STREAM_TOKENIZE_RET_ALLOCATION_FAILURE.
+ */
+int __stream_tokenize_slices_mapped(int                            fd,
+                                    char                          *map,
+                                    size_t                         start,
+                                    size_t                         size,
+                                    char                           delimiter,
+                                    tokenize_slice_iter_callback_t callback,
+                                    void                          *user_data) {
+
+    posix_madvise(map, size, POSIX_MADV_SEQUENTIAL); /* Failure only means a slower read */
+
+    size_t    position;
+    const int retval = __stream_tokenize_slices_region(map,
+                                                       start,
+                                                       size,
+                                                       delimiter,
+                                                       callback,
+                                                       user_data,
+                                                       &position);
+
+    lseek(fd, position, SEEK_SET);
+    return retval;
+}
+
+/**
+ * @struct stream_tokenize_pipeline_t
+ * @brief  Blocks of a non-seekable file (e.g.: a pipe from a decompressor), read ahead by a
+ *         background thread while previous blocks are tokenized.
+ *
+ * @var stream_tokenize_pipeline_t::fd
+ *     @brief File descriptor of the file being read.
+ * @var stream_tokenize_pipeline_t::blocks
+ *     @brief Ring of blocks of ::STREAM_TOKENIZE_PIPELINE_BLOCK_SIZE bytes. Block `i` of the file
+ *            is in `blocks[i % STREAM_TOKENIZE_PIPELINE_BLOCKS]`.
+ * @var stream_tokenize_pipeline_t::lengths
+ *     @brief Number of bytes read into each block.
+ * @var stream_tokenize_pipeline_t::produced
+ *     @brief Number of blocks read by the background thread.
+ * @var stream_tokenize_pipeline_t::consumed
+ *     @brief Number of blocks fully copied by ::__stream_tokenize_pipeline_read.
+ * @var stream_tokenize_pipeline_t::offset
+ *     @brief Number of bytes of the block being copied (number
+ *            ::stream_tokenize_pipeline_t::consumed) that were already copied.
+ * @var stream_tokenize_pipeline_t::done
+ *     @brief Whether the background thread stopped reading (end of file or error).
+ * @var stream_tokenize_pipeline_t::error
+ *     @brief `errno` of the failed read, or `0` if the end of the file was reached.
+ * @var stream_tokenize_pipeline_t::mutex
+ *     @brief Mutex protecting the counters of blocks and the state of the background thread.
+ * @var stream_tokenize_pipeline_t::cond
+ *     @brief Signaled when a block is read, or when a block is free to be read into.
+ * @var stream_tokenize_pipeline_t::thread
+ *     @brief Background thread reading blocks.
+ */
+typedef struct {
+    int             fd;
+    char           *blocks[STREAM_TOKENIZE_PIPELINE_BLOCKS];
+    size_t          lengths[STREAM_TOKENIZE_PIPELINE_BLOCKS];
+    size_t          produced, consumed, offset;
+    int             done, error;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    pthread_t       thread;
+} stream_tokenize_pipeline_t;
+
+/**
+ * @brief   Reads data from a pipeline's file into a block.
+ * @details Auxiliary method for ::__stream_tokenize_pipeline_run. Only one successful `read` is
+ *          made, so that data is available as soon as it arrives, even if it doesn't fill the
+ *          block. The thread can only be cancelled while waiting for data, when no lock is held.
+ *
+ * @param pipeline Pipeline whose file is read.
+ * @param block    Block to be read into.
+ * @param length   Where to write the number of bytes read to.
+ *
+ * @return `0` on success, `-1` on end of file, or `errno` on failure.
+ */
+int __stream_tokenize_pipeline_fill(stream_tokenize_pipeline_t *pipeline,
+                                    char                       *block,
+                                    size_t                     *length) {
+    ssize_t nread;
+    do {
+        int old_state;
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_state);
+        nread = read(pipeline->fd, block, STREAM_TOKENIZE_PIPELINE_BLOCK_SIZE);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
+    } while (nread < 0 && errno == EINTR);
+
+    *length = nread > 0 ? (size_t) nread : 0;
+    if (nread < 0)
+        return errno;
+    return nread == 0 ? -1 : 0;
+}
+
+/**
+ * @brief   Reads blocks of a file into a pipeline, while there's space for them.
+ * @details Thread entry point for ::__stream_tokenize_pipeline_start.
+ *
+ * @param pipeline_data Pointer to a ::stream_tokenize_pipeline_t.
+ *
+ * @return Always `NULL`.
+ */
+void *__stream_tokenize_pipeline_run(void *pipeline_data) {
+    stream_tokenize_pipeline_t *const pipeline = pipeline_data;
+
+    int old_state;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_state);
+
+    int done = 0;
+    while (!done) {
+        pthread_mutex_lock(&pipeline->mutex);
+        while (pipeline->produced - pipeline->consumed == STREAM_TOKENIZE_PIPELINE_BLOCKS)
+            pthread_cond_wait(&pipeline->cond, &pipeline->mutex);
+        const size_t index = pipeline->produced % STREAM_TOKENIZE_PIPELINE_BLOCKS;
+        pthread_mutex_unlock(&pipeline->mutex);
+
+        /* The block is only published after it's filled, so it can be filled without a lock */
+        size_t    length;
+        const int result =
+            __stream_tokenize_pipeline_fill(pipeline, pipeline->blocks[index], &length);
+        done = result != 0;
+
+        pthread_mutex_lock(&pipeline->mutex);
+        pipeline->lengths[index] = length;
+        pipeline->produced++;
+        if (done) {
+            pipeline->done  = 1;
+            pipeline->error = result > 0 ? result : 0;
+        }
+        pthread_cond_broadcast(&pipeline->cond);
+        pthread_mutex_unlock(&pipeline->mutex);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief   Starts reading a file ahead, in a background thread.
+ * @details Auxiliary method for ::__stream_tokenize_slices_read.
+ *
+ * @param pipeline Where to initialize the pipeline.
+ * @param fd       File descriptor of the file to be read.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure, or failure to create the thread.
+ */
+int __stream_tokenize_pipeline_start(stream_tokenize_pipeline_t *pipeline, int fd) {
+    pipeline->blocks[0] = malloc(STREAM_TOKENIZE_PIPELINE_BLOCKS *
+                                 (size_t) STREAM_TOKENIZE_PIPELINE_BLOCK_SIZE);
+    if (!pipeline->blocks[0])
+        return 1;
+
+    for (size_t i = 0; i < STREAM_TOKENIZE_PIPELINE_BLOCKS; ++i) {
+        pipeline->blocks[i]  = pipeline->blocks[0] + i * STREAM_TOKENIZE_PIPELINE_BLOCK_SIZE;
+        pipeline->lengths[i] = 0;
+    }
+
+    pipeline->fd       = fd;
+    pipeline->produced = pipeline->consumed = pipeline->offset = 0;
+    pipeline->done     = pipeline->error = 0;
+    pthread_mutex_init(&pipeline->mutex, NULL);
+    pthread_cond_init(&pipeline->cond, NULL);
+
+    if (pthread_create(&pipeline->thread, NULL, __stream_tokenize_pipeline_run, pipeline)) {
+        pthread_cond_destroy(&pipeline->cond);
+        pthread_mutex_destroy(&pipeline->mutex);
+        free(pipeline->blocks[0]);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Copies data read ahead by a pipeline, with the semantics of `read`.
+ * @details Auxiliary method for ::__stream_tokenize_slices_read.
+ *
+ * @param pipeline Pipeline to read from.
+ * @param buffer   Where to copy data to.
+ * @param size     Maximum number of bytes to copy.
+ *
+ * @return The number of bytes copied, `0` on end of file, or `-1` on failure (`errno` is set).
+ */
+ssize_t __stream_tokenize_pipeline_read(stream_tokenize_pipeline_t *pipeline,
+                                        char                       *buffer,
+                                        size_t                      size) {
+    pthread_mutex_lock(&pipeline->mutex);
+    while (1) {
+        if (pipeline->consumed < pipeline->produced) {
+            const size_t index = pipeline->consumed % STREAM_TOKENIZE_PIPELINE_BLOCKS;
+            if (pipeline->offset < pipeline->lengths[index])
+                break;
+
+            /* Block fully copied. Give it back to the background thread. */
+            pipeline->consumed++;
+            pipeline->offset = 0;
+            pthread_cond_broadcast(&pipeline->cond);
+        } else if (pipeline->done) {
+            const int error = pipeline->error;
+            pthread_mutex_unlock(&pipeline->mutex);
+
+            if (!error)
+                return 0;
+            errno = error;
+            return -1;
+        } else {
+            pthread_cond_wait(&pipeline->cond, &pipeline->mutex);
+        }
+    }
+
+    const size_t index = pipeline->consumed % STREAM_TOKENIZE_PIPELINE_BLOCKS;
+    pthread_mutex_unlock(&pipeline->mutex);
+
+    /* Blocks before produced are only written to after being consumed */
+    const size_t available = pipeline->lengths[index] - pipeline->offset;
+    const size_t copied    = size < available ? size : available;
+    memcpy(buffer, pipeline->blocks[index] + pipeline->offset, copied);
+    pipeline->offset += copied;
+    return copied;
+}
+
+/**
+ * @brief   Stops a pipeline's background thread and frees the pipeline's blocks.
+ * @details Auxiliary method for ::__stream_tokenize_slices_read. Data read ahead is lost.
+ * @param   pipeline Pipeline to be stopped.
+ */
+void __stream_tokenize_pipeline_stop(stream_tokenize_pipeline_t *pipeline) {
+    pthread_cancel(pipeline->thread); /* Only acted upon while waiting for data */
+
+    pthread_mutex_lock(&pipeline->mutex);
+    pipeline->consumed = pipeline->produced; /* Wake the thread up, if waiting for space */
+    pthread_cond_broadcast(&pipeline->cond);
+    pthread_mutex_unlock(&pipeline->mutex);
+
+    pthread_join(pipeline->thread, NULL);
+    pthread_cond_destroy(&pipeline->cond);
+    pthread_mutex_destroy(&pipeline->mutex);
+    free(pipeline->blocks[0]);
+}
+
+/**
+ * @brief   Tokenizes a file that can't be memory-mapped, reading it in large blocks.
+ * @details Auxiliary method for ::stream_tokenize_slices. Non-seekable files (e.g.: pipes from
+ *          decompressors) are read ahead in a background thread (see
+ *          ::stream_tokenize_pipeline_t), so that waiting for data overlaps with tokenization.
+ *          Seekable files are read directly, so that data that wasn't tokenized can be given back.
+ *
+ * @param fd        File descriptor of the file to be read.
+ * @param delimiter Character to separate tokens.
+ * @param callback  Function called for every token read.
+ * @param user_data Pointer passed to every call of @p callback.
+ *
+ * @return `0` on success, the value returned by @p callback when it ordered tokenization to stop,
+ *         ::STREAM_TOKENIZE_RET_ALLOCATION_FAILURE or ::STREAM_TOKENIZE_RET_IO_FAILURE.
+ */
+int __stream_tokenize_slices_read(int                            fd,
+                                  char                           delimiter,
+                                  tokenize_slice_iter_callback_t callback,
+                                  void                          *user_data) {
+
+    size_t capacity = STREAM_TOKENIZE_READ_BUFFER_SIZE;
+    size_t used     = 0; /* Bytes of an incomplete token at the beginning of the buffer */
+    char  *buffer   = malloc(capacity);
+    if (!buffer)
+        return STREAM_TOKENIZE_RET_ALLOCATION_FAILURE;
+
+    stream_tokenize_pipeline_t pipeline;
+    const int                  pipelined = lseek(fd, 0, SEEK_CUR) < 0 && errno == ESPIPE &&
+                              !__stream_tokenize_pipeline_start(&pipeline, fd);
+
+    int retval = 0;
+    while (1) {
+        if (used == capacity - 1) { /* Token doesn't fit in the buffer. Keep space for '\0'. */
+            char *const new_buffer = realloc(buffer, capacity * 2);
+            if (!new_buffer) {
+                retval = STREAM_TOKENIZE_RET_ALLOCATION_FAILURE;
+                break;
+            }
+
+            buffer = new_buffer;
+            capacity *= 2;
+        }
+
+        const size_t  size  = capacity - used - 1;
+        const ssize_t nread = pipelined
+                                  ? __stream_tokenize_pipeline_read(&pipeline, buffer + used, size)
+                                  : read(fd, buffer + used, size);
+        if (nread < 0) {
+            if (errno == EINTR)
+                continue;
+
+            retval = STREAM_TOKENIZE_RET_IO_FAILURE;
+            break;
+        } else if (nread == 0) { /* End of file */
+            if (used) {
+                buffer[used] = '\0';
+                retval       = callback(user_data, buffer, used);
+            }
+            break;
+        }
+
+        const size_t filled = used + nread;
+        size_t       consumed;
+        retval = __stream_tokenize_slices_buffer(buffer,
+                                                 filled,
+                                                 delimiter,
+                                                 callback,
+                                                 user_data,
+                                                 &consumed);
+        if (retval) {
+            /* Give back data that wasn't processed. This fails on pipes, which is expected. */
+            lseek(fd, -(off_t) (filled - consumed), SEEK_CUR);
+            break;
+        }
+
+        used = filled - consumed;
+        memmove(buffer, buffer + consumed, used);
+    }
+
+    if (pipelined)
+        __stream_tokenize_pipeline_stop(&pipeline);
+    free(buffer);
+    return retval;
+}
+
+int stream_tokenize_slices(FILE                          *file,
+                           char                           delimiter,
+                           tokenize_slice_iter_callback_t callback,
+                           void                          *user_data) {
+
+    fflush(file); /* Synchronize the file descriptor's offset with the stream's position */
+    const int fd = fileno(file);
+
+    struct stat st;
+    if (__stream_tokenize_is_mappable(fd, &st)) {
+        const off_t start = lseek(fd, 0, SEEK_CUR);
+        if (start >= st.st_size)
+            return 0;
+
+        char *const map =
+            start < 0 ? MAP_FAILED
+                      : mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            const int retval = __stream_tokenize_slices_mapped(fd,
+                                                               map,
+                                                               start,
+                                                               st.st_size,
+                                                               delimiter,
+                                                               callback,
+                                                               user_data);
+            munmap(map, st.st_size);
+            return retval;
+        }
+    }
+
+    return __stream_tokenize_slices_read(fd, delimiter, callback, user_data);
+}
+
+/**
+ * @struct stream_tokenize_chunk_t
+ * @brief  Part of a memory-mapped file, tokenized in ::stream_tokenize_slices_chunked.
+ *
+ * @var stream_tokenize_chunk_t::map
+ *     @brief Private, writable mapping of the whole file.
+ * @var stream_tokenize_chunk_t::start
+ *     @brief Offset in ::stream_tokenize_chunk_t::map where the chunk starts.
+ * @var stream_tokenize_chunk_t::end
+ *     @brief Offset in ::stream_tokenize_chunk_t::map where the chunk ends.
+ * @var stream_tokenize_chunk_t::delimiter
+ *     @brief Character to separate tokens.
+ * @var stream_tokenize_chunk_t::callback
+ *     @brief Function called for every token in the chunk.
+ * @var stream_tokenize_chunk_t::user_data
+ *     @brief Pointer passed to every call of ::stream_tokenize_chunk_t::callback.
+ * @var stream_tokenize_chunk_t::retval
+ *     @brief Result of tokenizing the chunk (see ::__stream_tokenize_slices_region).
+ */
+typedef struct {
+    char                          *map;
+    size_t                         start;
+    size_t                         end;
+    char                           delimiter;
+    tokenize_slice_iter_callback_t callback;
+    void                          *user_data;
+    int                            retval;
+} stream_tokenize_chunk_t;
+
+/**
+ * @brief   Tokenizes a chunk of a memory-mapped file.
+ * @details Thread entry point for ::stream_tokenize_slices_chunked, that can also be called
+ *          directly.
+ *
+ * @param chunk_data Pointer to a ::stream_tokenize_chunk_t, whose
+ *                   ::stream_tokenize_chunk_t::retval will be set.
+ *
+ * @return Always `NULL`.
+ */
+void *__stream_tokenize_chunk_run(void *chunk_data) {
+    stream_tokenize_chunk_t *const chunk = chunk_data;
+
+    size_t position;
+    chunk->retval = __stream_tokenize_slices_region(chunk->map,
+                                                    chunk->start,
+                                                    chunk->end,
+                                                    chunk->delimiter,
+                                                    chunk->callback,
+                                                    chunk->user_data,
+                                                    &position);
+    return NULL;
+}
+
+int stream_tokenize_slices_chunked(FILE                          *file,
+                                   char                           delimiter,
+                                   size_t                         n,
+                                   tokenize_slice_iter_callback_t callback,
+                                   void *const                    user_data[n]) {
+
+    if (n <= 1)
+        return stream_tokenize_slices(file, delimiter, callback, user_data[0]);
+
+    fflush(file); /* Synchronize the file descriptor's offset with the stream's position */
+    const int fd = fileno(file);
+
+    struct stat st;
+    const off_t start = __stream_tokenize_is_mappable(fd, &st) ? lseek(fd, 0, SEEK_CUR) : -1;
+    if (start < 0)
+        return __stream_tokenize_slices_read(fd, delimiter, callback, user_data[0]);
+    else if (start >= st.st_size)
+        return 0;
+
+    const size_t size = st.st_size;
+    char *const  map  = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+        return __stream_tokenize_slices_read(fd, delimiter, callback, user_data[0]);
+    posix_madvise(map, size, POSIX_MADV_WILLNEED); /* Failure only means a slower read */
+
+    /* Split the file into chunks of similar sizes, that end right after a delimiter */
+    stream_tokenize_chunk_t chunks[n];
+    size_t                  chunk_start = start;
+    for (size_t i = 0; i < n; ++i) {
+        size_t chunk_end = size;
+        if (i < n - 1) {
+            size_t target = start + (size - start) * (i + 1) / n;
+            if (target < chunk_start)
+                target = chunk_start;
+
+            const char *const next = memchr(map + target, delimiter, size - target);
+            if (next)
+                chunk_end = next - map + 1;
+        }
+
+        chunks[i] = (stream_tokenize_chunk_t) {.map       = map,
+                                               .start     = chunk_start,
+                                               .end       = chunk_end,
+                                               .delimiter = delimiter,
+                                               .callback  = callback,
+                                               .user_data = user_data[i],
+                                               .retval    = 0};
+        chunk_start = chunk_end;
+    }
+
+    /* The first chunk is tokenized in the calling thread */
+    pthread_t threads[n];
+    int       started[n];
+    for (size_t i = 1; i < n; ++i)
+        started[i] = !pthread_create(&threads[i], NULL, __stream_tokenize_chunk_run, &chunks[i]);
+
+    __stream_tokenize_chunk_run(&chunks[0]);
+    for (size_t i = 1; i < n; ++i) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            __stream_tokenize_chunk_run(&chunks[i]); /* Fall back to the calling thread */
+    }
+
+    munmap(map, size);
+    lseek(fd, size, SEEK_SET);
+
+    for (size_t i = 0; i < n; ++i)
+        if (chunks[i].retval)
+            return chunks[i].retval;
+    return 0;
+}
+
+int stream_copy_file(const char *source, const char *destination) {
+    int retval = 0;
+
+    const int in = open(source, O_RDONLY);
+    if (in < 0)
+        return 1;
+
+    const int out = open(destination, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (out < 0) {
+        close(in);
+        return 1;
+    }
+
+    char    buffer[STREAM_COPY_BUFFER_SIZE];
+    ssize_t nread;
+    while ((nread = read(in, buffer, STREAM_COPY_BUFFER_SIZE)) != 0) {
+        if (nread < 0) {
+            if (errno == EINTR)
+                continue;
+            retval = 1;
+            break;
+        }
+
+        ssize_t written = 0;
+        while (written < nread) {
+            const ssize_t w = write(out, buffer + written, (size_t) (nread - written));
+            if (w < 0 && errno != EINTR) {
+                retval = 1;
+                goto DEFER;
+            }
+            written += w > 0 ? w : 0;
+        }
+    }
+
+DEFER:
+    close(out);
+    close(in);
+    return retval;
+}
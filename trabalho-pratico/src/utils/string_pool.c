@@ -22,6 +22,7 @@
  * See [the header file's documentation](@ref string_pool_examples).
  */
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -34,22 +35,45 @@
  *
  * @var string_pool::pool
  *   @brief Standard pool, used to implement the string pool.
+ * @var string_pool::borrowed
+ *   @brief File whose strings are returned without being copied (see ::string_pool_borrow), or
+ *          `NULL`.
  */
 struct string_pool {
-    pool_t *pool;
+    pool_t        *pool;
+    mapped_file_t *borrowed;
+};
+
+/**
+ * @struct string_pool_cache
+ * @brief  Per-thread allocation front-end of a string pool.
+ *
+ * @var string_pool_cache::pool
+ *   @brief String pool the cache allocates strings in.
+ * @var string_pool_cache::cache
+ *   @brief Cache of the standard pool used to implement the string pool.
+ */
+struct string_pool_cache {
+    const string_pool_t *pool;
+    pool_cache_t        *cache;
 };
 
 string_pool_t *string_pool_create(size_t block_capacity) {
+    return string_pool_create_with_pages(block_capacity, POOL_PAGES_NORMAL);
+}
+
+string_pool_t *string_pool_create_with_pages(size_t block_capacity, pool_pages_t pages) {
     string_pool_t *const pool = malloc(sizeof(string_pool_t));
     if (!pool)
         return NULL;
 
-    pool->pool = pool_create(char, block_capacity);
+    pool->pool = pool_create_with_pages(char, block_capacity, pages);
     if (!pool->pool) {
         free(pool);
         return NULL;
     }
 
+    pool->borrowed = NULL;
     return pool;
 }
 
@@ -58,14 +82,73 @@ char *string_pool_allocate(string_pool_t *pool, size_t length) {
 }
 
 char *string_pool_put(string_pool_t *pool, const char *str) {
+    if (string_pool_is_borrowed(pool, str))
+        return (char *) (uintptr_t) str; /* Callers promise not to modify borrowed strings */
+
     return pool_put_items(char, pool->pool, str, strlen(str) + 1);
 }
 
+int string_pool_borrow(string_pool_t *pool, mapped_file_t *file) {
+    if (pool->borrowed)
+        return 1;
+
+    pool->borrowed = mapped_file_ref(file);
+    return 0;
+}
+
+int string_pool_is_borrowed(const string_pool_t *pool, const char *str) {
+    return pool->borrowed && mapped_file_contains(pool->borrowed, str);
+}
+
+mapped_file_t *string_pool_get_borrowed(const string_pool_t *pool) {
+    return pool->borrowed;
+}
+
+string_pool_cache_t *string_pool_cache_create(string_pool_t *pool) {
+    string_pool_cache_t *const cache = malloc(sizeof(string_pool_cache_t));
+    if (!cache)
+        return NULL;
+
+    cache->pool  = pool;
+    cache->cache = pool_cache_create(pool->pool);
+    if (!cache->cache) {
+        free(cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+char *string_pool_cache_allocate(string_pool_cache_t *cache, size_t length) {
+    return pool_cache_alloc_items(char, cache->cache, length + 1);
+}
+
+char *string_pool_cache_put(string_pool_cache_t *cache, const char *str) {
+    if (string_pool_is_borrowed(cache->pool, str))
+        return (char *) (uintptr_t) str; /* Callers promise not to modify borrowed strings */
+
+    return pool_cache_put_items(char, cache->cache, str, strlen(str) + 1);
+}
+
+void string_pool_cache_free(string_pool_cache_t *cache) {
+    pool_cache_free(cache->cache);
+    free(cache);
+}
+
+void string_pool_get_memory_usage(const string_pool_t *pool, memory_usage_t *out) {
+    pool_get_memory_usage(pool->pool, out);
+}
+
+void string_pool_trim(string_pool_t *pool) {
+    pool_trim(pool->pool);
+}
+
 void string_pool_empty(string_pool_t *pool) {
     pool_empty(pool->pool);
 }
 
 void string_pool_free(string_pool_t *pool) {
     pool_free(pool->pool);
+    mapped_file_unref(pool->borrowed);
     free(pool);
 }
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+
 /**
  * @file  string_pool_no_duplicates.c
  * @brief Implementation of methods in include/utils/string_pool_no_duplicates.h
@@ -22,25 +23,144 @@
  * See [the header file's documentation](@ref string_pool_no_duplicates_examples).
  */
 
-#include <glib.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "utils/memory_report.h"
 #include "utils/string_pool.h"
 #include "utils/string_pool_no_duplicates.h"
 
+/**
+ * @struct string_pool_no_duplicates_entry_t
+ * @brief  An entry in ::string_pool_no_duplicates::table.
+ *
+ * @var string_pool_no_duplicates_entry_t::hash
+ *     @brief Hash of ::string_pool_no_duplicates_entry_t::string.
+ * @var string_pool_no_duplicates_entry_t::string
+ *     @brief String in ::string_pool_no_duplicates::strings (or borrowed from its file, see
+ *            ::string_pool_borrow), or `NULL` for an empty entry.
+ * @var string_pool_no_duplicates_entry_t::length
+ *     @brief Length of ::string_pool_no_duplicates_entry_t::string.
+ */
+typedef struct {
+    uint64_t    hash;
+    const char *string;
+    size_t      length;
+} string_pool_no_duplicates_entry_t;
+
 /**
  * @struct string_pool_no_duplicates
  * @brief  A string pool with an auxiliary hash table to prevent string duplicate allocations.
  *
  * @var string_pool_no_duplicates::strings
  *   @brief Pool where the strings are stored.
- * @var string_pool_no_duplicates::already_stored
- *   @brief Hash table that contains all the strings that have been stored.
+ * @var string_pool_no_duplicates::table
+ *   @brief   Open addressing (linear probing) hash table with all the strings that have been
+ *            stored.
+ *   @details Its capacity is always a power of two.
+ * @var string_pool_no_duplicates::capacity
+ *   @brief Number of entries in ::string_pool_no_duplicates::table.
+ * @var string_pool_no_duplicates::count
+ *   @brief Number of non-empty entries in ::string_pool_no_duplicates::table.
  */
 struct string_pool_no_duplicates {
-    string_pool_t *strings;
-    GHashTable    *already_stored;
+    string_pool_t                     *strings;
+    string_pool_no_duplicates_entry_t *table;
+    size_t                             capacity;
+    size_t                             count;
 };
 
+/** @brief Initial number of entries in ::string_pool_no_duplicates::table. */
+#define STRING_POOL_NO_DUPLICATES_INITIAL_CAPACITY 64
+
+/**
+ * @brief   Hashes a string.
+ * @details FNV-1a, applied to 8-byte words (and then to the remaining bytes), followed by a final
+ *          mix, so that the low bits (used for indexing) depend on every input byte.
+ *
+ * @param str    Characters of the string.
+ * @param length Number of characters in @p str.
+ *
+ * @return The hash of @p str.
+ */
+uint64_t __string_pool_no_duplicates_hash(const char *str, size_t length) {
+    uint64_t hash = 0xcbf29ce484222325;
+
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, str + i, sizeof(uint64_t));
+        hash = (hash ^ word) * 0x100000001b3;
+    }
+
+    for (; i < length; ++i)
+        hash = (hash ^ (uint8_t) str[i]) * 0x100000001b3;
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccd;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+ * @brief Finds the entry where a string is, or where it should be inserted.
+ *
+ * @param table    Hash table (::string_pool_no_duplicates::table). Must have an empty entry.
+ * @param capacity Number of entries in @p table (a power of two).
+ * @param hash     Hash of @p str (see ::__string_pool_no_duplicates_hash).
+ * @param str      Characters of the string to look for. Can be `NULL` to find an empty entry.
+ * @param length   Number of characters in @p str.
+ *
+ * @return The entry containing @p str, or the empty entry where it should be inserted.
+ */
+string_pool_no_duplicates_entry_t *
+    __string_pool_no_duplicates_find(string_pool_no_duplicates_entry_t *table,
+                                     size_t                             capacity,
+                                     uint64_t                           hash,
+                                     const char                        *str,
+                                     size_t                             length) {
+
+    const size_t mask = capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        string_pool_no_duplicates_entry_t *const entry = &table[i];
+        if (!entry->string)
+            return entry;
+
+        if (str && entry->hash == hash && entry->length == length &&
+            memcmp(entry->string, str, length) == 0)
+            return entry;
+    }
+}
+
+/**
+ * @brief Doubles the capacity of ::string_pool_no_duplicates::table.
+ *
+ * @param pool Pool whose table is going to be grown.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p pool is left unchanged).
+ */
+int __string_pool_no_duplicates_grow(string_pool_no_duplicates_t *pool) {
+    const size_t                             new_capacity = pool->capacity * 2;
+    string_pool_no_duplicates_entry_t *const new_table    =
+        calloc(new_capacity, sizeof(string_pool_no_duplicates_entry_t));
+    if (!new_table)
+        return 1;
+
+    for (size_t i = 0; i < pool->capacity; ++i) {
+        const string_pool_no_duplicates_entry_t *const entry = &pool->table[i];
+        if (entry->string)
+            *__string_pool_no_duplicates_find(new_table, new_capacity, entry->hash, NULL, 0) =
+                *entry;
+    }
+
+    free(pool->table);
+    pool->table    = new_table;
+    pool->capacity = new_capacity;
+    return 0;
+}
+
 string_pool_no_duplicates_t *string_pool_no_duplicates_create(size_t block_capacity) {
     string_pool_no_duplicates_t *const no_dups_pool =
         malloc(sizeof(struct string_pool_no_duplicates));
@@ -48,31 +168,90 @@ string_pool_no_duplicates_t *string_pool_no_duplicates_create(size_t block_capac
         return NULL;
 
     no_dups_pool->strings = string_pool_create(block_capacity);
-    if (!no_dups_pool->strings) {
-        free(no_dups_pool);
-        return NULL;
-    }
-    no_dups_pool->already_stored = g_hash_table_new(g_str_hash, g_str_equal);
+    if (!no_dups_pool->strings)
+        goto DEFER_1;
+
+    no_dups_pool->capacity = STRING_POOL_NO_DUPLICATES_INITIAL_CAPACITY;
+    no_dups_pool->count    = 0;
+    no_dups_pool->table =
+        calloc(no_dups_pool->capacity, sizeof(string_pool_no_duplicates_entry_t));
+    if (!no_dups_pool->table)
+        goto DEFER_2;
 
     return no_dups_pool;
+
+DEFER_2:
+    string_pool_free(no_dups_pool->strings);
+DEFER_1:
+    free(no_dups_pool);
+    return NULL;
 }
 
 const char *string_pool_no_duplicates_put(string_pool_no_duplicates_t *pool, const char *str) {
-    const char *const data = g_hash_table_lookup(pool->already_stored, str);
-    if (!data) {
-        char *const pool_string = string_pool_put(pool->strings, str);
-        if (!pool_string)
+    return string_pool_no_duplicates_put_length(pool, str, strlen(str));
+}
+
+const char *string_pool_no_duplicates_put_length(string_pool_no_duplicates_t *pool,
+                                                 const char                  *str,
+                                                 size_t                       length) {
+
+    const uint64_t                     hash  = __string_pool_no_duplicates_hash(str, length);
+    string_pool_no_duplicates_entry_t *entry =
+        __string_pool_no_duplicates_find(pool->table, pool->capacity, hash, str, length);
+    if (entry->string)
+        return entry->string;
+
+    /* Keep the load factor at or below 1/2, so that probe sequences stay short */
+    if ((pool->count + 1) * 2 > pool->capacity) {
+        if (__string_pool_no_duplicates_grow(pool))
             return NULL;
+        entry = __string_pool_no_duplicates_find(pool->table, pool->capacity, hash, NULL, 0);
+    }
 
-        g_hash_table_insert(pool->already_stored, pool_string, pool_string);
-        return pool_string;
+    const char *pool_string;
+    if (string_pool_is_borrowed(pool->strings, str) &&
+        string_pool_is_borrowed(pool->strings, str + length) && str[length] == '\0') {
+
+        pool_string = str;
+    } else {
+        char *const new_string = string_pool_allocate(pool->strings, length);
+        if (!new_string)
+            return NULL;
+        memcpy(new_string, str, length);
+        new_string[length] = '\0';
+        pool_string = new_string;
     }
 
-    return data;
+    *entry = (string_pool_no_duplicates_entry_t) {.hash   = hash,
+                                                  .string = pool_string,
+                                                  .length = length};
+    pool->count++;
+    return pool_string;
+}
+
+int string_pool_no_duplicates_borrow(string_pool_no_duplicates_t *pool, mapped_file_t *file) {
+    return string_pool_borrow(pool->strings, file);
+}
+
+mapped_file_t *string_pool_no_duplicates_get_borrowed(const string_pool_no_duplicates_t *pool) {
+    return string_pool_get_borrowed(pool->strings);
+}
+
+void string_pool_no_duplicates_trim(string_pool_no_duplicates_t *pool) {
+    string_pool_trim(pool->strings);
+}
+
+void string_pool_no_duplicates_get_memory_usage(const string_pool_no_duplicates_t *pool,
+                                                memory_usage_t                    *out) {
+    string_pool_get_memory_usage(pool->strings, out);
+
+    out->blocks++;
+    out->reserved_bytes += pool->capacity * sizeof(string_pool_no_duplicates_entry_t);
+    out->used_bytes += pool->count * sizeof(string_pool_no_duplicates_entry_t);
 }
 
 void string_pool_no_duplicates_free(string_pool_no_duplicates_t *pool) {
     string_pool_free(pool->strings);
-    g_hash_table_destroy(pool->already_stored);
+    free(pool->table);
     free(pool);
 }
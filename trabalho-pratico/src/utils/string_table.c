@@ -0,0 +1,434 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  string_table.c
+ * @brief Implementation of methods in include/utils/string_table.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref string_table_examples).
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+
+    /** @brief Defined when groups of control bytes are compared with SSE2 instructions. */
+    #define STRING_TABLE_SSE2
+#endif
+
+#include "utils/numa_topology.h"
+#include "utils/string_table.h"
+
+/** @brief Number of slots (and of control bytes) in a group. */
+#define STRING_TABLE_GROUP_SIZE 16
+
+/** @brief Control byte of empty slots. Control bytes of full slots have their highest bit unset. */
+#define STRING_TABLE_EMPTY 0x80
+
+/**
+ * @struct string_table_slot_t
+ * @brief  An entry in a ::string_table_t.
+ *
+ * @var string_table_slot_t::hash
+ *     @brief Hash of ::string_table_slot_t::key (see ::string_table_hash).
+ * @var string_table_slot_t::key
+ *     @brief Key of the entry. Only meaningful if the control byte of the slot isn't
+ *            ::STRING_TABLE_EMPTY.
+ * @var string_table_slot_t::value
+ *     @brief Value associated to ::string_table_slot_t::key.
+ */
+typedef struct {
+    uint64_t    hash;
+    const char *key;
+    uint32_t    value;
+} string_table_slot_t;
+
+/**
+ * @struct string_table
+ * @brief  Hash table from strings to 32-bit integer values.
+ *
+ * @var string_table::control
+ *     @brief Control byte of each slot: ::STRING_TABLE_EMPTY, or the highest 7 bits of the hash of
+ *            the slot's key.
+ * @var string_table::slots
+ *     @brief Array of (::string_table::group_mask + 1) * ::STRING_TABLE_GROUP_SIZE slots.
+ * @var string_table::group_mask
+ *     @brief Number of groups minus one (a power of two minus one), used to wrap group indices
+ *            around.
+ * @var string_table::count
+ *     @brief Number of full slots.
+ * @var string_table::replicas
+ *     @brief   Copy of the table on every NUMA node (see ::string_table_replicate), or `NULL` if
+ *              it isn't replicated.
+ *     @details Arrays of replicas are allocated with ::numa_topology_allocate, and replicas aren't
+ *              replicated themselves.
+ */
+struct string_table {
+    uint8_t             *control;
+    string_table_slot_t *slots;
+    size_t               group_mask;
+    size_t               count;
+    string_table_t     **replicas;
+};
+
+/**
+ * @brief   Mixes a word of a string into a hash.
+ * @details Auxiliary method for ::string_table_hash.
+ *
+ * @param hash Hash of the previous words.
+ * @param word Word to be mixed into @p hash.
+ *
+ * @return The new hash.
+ */
+uint64_t __string_table_hash_mix(uint64_t hash, uint64_t word) {
+    hash = (hash ^ word) * 0x9e3779b97f4a7c15;
+    return hash ^ (hash >> 29);
+}
+
+uint64_t string_table_hash(const char *key) {
+    const size_t length = strlen(key);
+    uint64_t     hash   = 0xcbf29ce484222325 ^ length;
+
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, key + i, sizeof(uint64_t)); /* Unaligned load */
+        hash = __string_table_hash_mix(hash, word);
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, key + i, length - i);
+    hash = __string_table_hash_mix(hash, tail);
+
+    /* Finalizer of MurmurHash3, so that both the lowest and the highest bits are well mixed */
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccd;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+ * @brief Gets the control byte of a full slot for a hash.
+ * @param hash Hash of a key.
+ * @return The highest 7 bits of @p hash.
+ */
+uint8_t __string_table_control_byte(uint64_t hash) {
+    return hash >> 57;
+}
+
+/**
+ * @brief Finds the slots in a group whose control byte is equal to a value.
+ *
+ * @param control First control byte of the group.
+ * @param byte    Value to compare control bytes with.
+ *
+ * @return A bitmask, where bit `i` is set if the control byte of the `i`-th slot is @p byte.
+ */
+uint32_t __string_table_group_match(const uint8_t *control, uint8_t byte) {
+#ifdef STRING_TABLE_SSE2
+    const __m128i group = _mm_loadu_si128((const __m128i *) control);
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char) byte)));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < STRING_TABLE_GROUP_SIZE; ++i)
+        mask |= (uint32_t) (control[i] == byte) << i;
+    return mask;
+#endif
+}
+
+/**
+ * @brief   Calculates the number of groups needed to store some entries in a ::string_table_t.
+ * @details The load factor is kept under `7/8`, as a lookup checks a whole group at once.
+ *
+ * @param capacity Number of entries to be stored.
+ *
+ * @return The number of groups (a power of two).
+ */
+size_t __string_table_groups_for_capacity(size_t capacity) {
+    size_t groups = 1;
+    while (groups * STRING_TABLE_GROUP_SIZE / 8 * 7 < capacity)
+        groups <<= 1;
+    return groups;
+}
+
+/**
+ * @brief Finds the first empty slot in the probe sequence of a hash.
+ *
+ * @param table Table to search in. Must have at least one empty slot.
+ * @param hash  Hash of the key to be inserted.
+ *
+ * @return The index of the empty slot.
+ */
+size_t __string_table_find_empty(const string_table_t *table, uint64_t hash) {
+    size_t group = hash & table->group_mask;
+    while (1) {
+        const size_t   first = group * STRING_TABLE_GROUP_SIZE;
+        const uint32_t empty =
+            __string_table_group_match(table->control + first, STRING_TABLE_EMPTY);
+        if (empty)
+            return first + __builtin_ctz(empty);
+
+        group = (group + 1) & table->group_mask;
+    }
+}
+
+/**
+ * @brief   Finds the slot of a key in a ::string_table_t.
+ * @details As entries are never removed, the probe sequence of a key ends at the first group with
+ *          an empty slot.
+ *
+ * @param table Table to search in.
+ * @param key   Key to be searched for.
+ * @param hash  Hash of @p key.
+ * @param slot  Where to write the index of the found slot to.
+ *
+ * @retval 0 Success.
+ * @retval 1 @p key not in @p table.
+ */
+int __string_table_find_slot(const string_table_t *table,
+                             const char           *key,
+                             uint64_t              hash,
+                             size_t               *slot) {
+    const uint8_t byte  = __string_table_control_byte(hash);
+    size_t        group = hash & table->group_mask;
+    while (1) {
+        const size_t         first   = group * STRING_TABLE_GROUP_SIZE;
+        const uint8_t *const control = table->control + first;
+        for (uint32_t matches = __string_table_group_match(control, byte); matches;
+             matches &= matches - 1) {
+
+            const size_t i = first + __builtin_ctz(matches);
+            if (table->slots[i].hash == hash && strcmp(table->slots[i].key, key) == 0) {
+                *slot = i;
+                return 0;
+            }
+        }
+
+        if (__string_table_group_match(control, STRING_TABLE_EMPTY))
+            return 1;
+        group = (group + 1) & table->group_mask;
+    }
+}
+
+/**
+ * @brief   Frees the copies of a table on every NUMA node.
+ * @details Called before a table is modified, as its copies would become outdated.
+ * @param   table Table that may be replicated (see ::string_table_replicate).
+ */
+void __string_table_free_replicas(string_table_t *table) {
+    if (!table->replicas)
+        return;
+
+    for (size_t i = 0; i < numa_topology_get_node_count(); ++i) {
+        string_table_t *const replica = table->replicas[i];
+        if (replica) {
+            const size_t slots = (replica->group_mask + 1) * STRING_TABLE_GROUP_SIZE;
+            numa_topology_free(replica->control, slots);
+            numa_topology_free(replica->slots, slots * sizeof(string_table_slot_t));
+            free(replica);
+        }
+    }
+    free(table->replicas);
+    table->replicas = NULL;
+}
+
+/**
+ * @brief Moves all entries of a ::string_table_t to new (larger or smaller) arrays.
+ *
+ * @param table  Table to be modified.
+ * @param groups Number of groups (a power of two, enough for all entries in @p table).
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure (@p table is left unchanged).
+ */
+int __string_table_rehash(string_table_t *table, size_t groups) {
+    __string_table_free_replicas(table);
+
+    const size_t               slots   = groups * STRING_TABLE_GROUP_SIZE;
+    uint8_t *const             control = malloc(slots);
+    string_table_slot_t *const array   = malloc(slots * sizeof(string_table_slot_t));
+    if (!control || !array) {
+        free(control);
+        free(array);
+        return 1;
+    }
+    memset(control, STRING_TABLE_EMPTY, slots);
+
+    uint8_t *const             old_control = table->control;
+    string_table_slot_t *const old_slots   = table->slots;
+    const size_t old_length = old_control ? (table->group_mask + 1) * STRING_TABLE_GROUP_SIZE : 0;
+
+    table->control    = control;
+    table->slots      = array;
+    table->group_mask = groups - 1;
+
+    /* Keys are known to be unique, so there's no need to compare them */
+    for (size_t i = 0; i < old_length; ++i) {
+        if (old_control[i] != STRING_TABLE_EMPTY) {
+            const size_t j = __string_table_find_empty(table, old_slots[i].hash);
+            control[j]     = old_control[i];
+            array[j]       = old_slots[i];
+        }
+    }
+
+    free(old_control);
+    free(old_slots);
+    return 0;
+}
+
+string_table_t *string_table_create(size_t capacity) {
+    string_table_t *const table = malloc(sizeof(string_table_t));
+    if (!table)
+        return NULL;
+
+    table->control  = NULL;
+    table->slots    = NULL;
+    table->count    = 0;
+    table->replicas = NULL;
+    if (__string_table_rehash(table, __string_table_groups_for_capacity(capacity))) {
+        free(table);
+        return NULL;
+    }
+    return table;
+}
+
+int string_table_reserve(string_table_t *table, size_t capacity) {
+    const size_t groups = __string_table_groups_for_capacity(capacity);
+    if (groups <= table->group_mask + 1)
+        return 0;
+
+    return __string_table_rehash(table, groups);
+}
+
+int string_table_shrink_to_fit(string_table_t *table) {
+    const size_t groups = __string_table_groups_for_capacity(table->count);
+    if (groups >= table->group_mask + 1)
+        return 0;
+
+    return __string_table_rehash(table, groups);
+}
+
+/**
+ * @brief   Copies a table to a NUMA node.
+ * @details Auxiliary method for ::string_table_replicate.
+ *
+ * @param table Table to be copied.
+ * @param node  NUMA node to copy @p table to.
+ *
+ * @return The copy of @p table, or `NULL` on allocation failure.
+ */
+string_table_t *__string_table_replicate_on_node(const string_table_t *table, size_t node) {
+    string_table_t *const replica = malloc(sizeof(string_table_t));
+    if (!replica)
+        return NULL;
+
+    const size_t slots = (table->group_mask + 1) * STRING_TABLE_GROUP_SIZE;
+    *replica           = *table;
+    replica->replicas  = NULL;
+    replica->control   = numa_topology_allocate(slots, node);
+    replica->slots     = numa_topology_allocate(slots * sizeof(string_table_slot_t), node);
+    if (!replica->control || !replica->slots) {
+        numa_topology_free(replica->control, slots);
+        numa_topology_free(replica->slots, slots * sizeof(string_table_slot_t));
+        free(replica);
+        return NULL;
+    }
+
+    memcpy(replica->control, table->control, slots);
+    memcpy(replica->slots, table->slots, slots * sizeof(string_table_slot_t));
+    return replica;
+}
+
+int string_table_replicate(string_table_t *table) {
+    __string_table_free_replicas(table);
+
+    const size_t nodes = numa_topology_get_node_count();
+    if (nodes == 1)
+        return 0;
+
+    table->replicas = calloc(nodes, sizeof(string_table_t *));
+    if (!table->replicas)
+        return 1;
+
+    for (size_t i = 0; i < nodes; ++i) {
+        table->replicas[i] = __string_table_replicate_on_node(table, i);
+        if (!table->replicas[i]) {
+            __string_table_free_replicas(table);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int string_table_insert(string_table_t *table, const char *key, uint32_t value) {
+    __string_table_free_replicas(table);
+    const uint64_t hash = string_table_hash(key);
+
+    size_t i;
+    if (!__string_table_find_slot(table, key, hash, &i)) {
+        table->slots[i].key   = key;
+        table->slots[i].value = value;
+        return 2;
+    }
+
+    if (string_table_reserve(table, table->count + 1))
+        return 1;
+
+    i                 = __string_table_find_empty(table, hash);
+    table->control[i] = __string_table_control_byte(hash);
+    table->slots[i]   = (string_table_slot_t) {.hash = hash, .key = key, .value = value};
+    table->count++;
+    return 0;
+}
+
+int string_table_lookup(const string_table_t *table, const char *key, uint32_t *value) {
+    if (table->replicas)
+        table = table->replicas[numa_topology_get_current_node()];
+
+    size_t i;
+    if (__string_table_find_slot(table, key, string_table_hash(key), &i))
+        return 1;
+
+    *value = table->slots[i].value;
+    return 0;
+}
+
+size_t string_table_get_count(const string_table_t *table) {
+    return table->count;
+}
+
+void string_table_get_memory_usage(const string_table_t *table, memory_usage_t *out) {
+    const size_t copies = table->replicas ? numa_topology_get_node_count() + 1 : 1;
+    const size_t slots  = (table->group_mask + 1) * STRING_TABLE_GROUP_SIZE;
+    out->blocks         = copies * 2;
+    out->reserved_bytes = copies * slots * (1 + sizeof(string_table_slot_t));
+    out->used_bytes     = copies * table->count * (1 + sizeof(string_table_slot_t));
+    out->wasted_bytes   = 0;
+}
+
+void string_table_free(string_table_t *table) {
+    __string_table_free_replicas(table);
+    free(table->control);
+    free(table->slots);
+    free(table);
+}
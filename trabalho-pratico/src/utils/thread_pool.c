@@ -0,0 +1,820 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file  thread_pool.c
+ * @brief Implementation of methods in include/utils/thread_pool.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref thread_pool_examples).
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/int_utils.h"
+#include "utils/numa_topology.h"
+#include "utils/thread_pool.h"
+
+/** @brief Initial number of tasks that fit in a ::thread_pool_deque_t. */
+#define THREAD_POOL_DEQUE_INITIAL_CAPACITY 64
+
+/** @brief Number of ranges per thread chosen by ::thread_pool_parallel_for when `grain` is `0`. */
+#define THREAD_POOL_RANGES_PER_THREAD 4
+
+/**
+ * @struct thread_pool_task_t
+ * @brief  A task waiting to be run.
+ *
+ * @var thread_pool_task_t::callback
+ *     @brief Method that runs the task.
+ * @var thread_pool_task_t::user_data
+ *     @brief Argument passed to ::thread_pool_task_t::callback.
+ * @var thread_pool_task_t::group
+ *     @brief Group the task belongs to.
+ */
+typedef struct {
+    thread_pool_task_callback_t callback;
+    void                       *user_data;
+    thread_pool_group_t        *group;
+} thread_pool_task_t;
+
+/**
+ * @struct thread_pool_deque_t
+ * @brief  A double-ended queue of tasks, implemented as a growable ring buffer.
+ *
+ * @var thread_pool_deque_t::mutex
+ *     @brief Mutex that must be locked to access any other field.
+ * @var thread_pool_deque_t::tasks
+ *     @brief Ring buffer of tasks.
+ * @var thread_pool_deque_t::capacity
+ *     @brief Number of tasks that fit in ::thread_pool_deque_t::tasks.
+ * @var thread_pool_deque_t::front
+ *     @brief Index of the oldest task in ::thread_pool_deque_t::tasks.
+ * @var thread_pool_deque_t::length
+ *     @brief Number of tasks in ::thread_pool_deque_t::tasks.
+ */
+typedef struct {
+    pthread_mutex_t     mutex;
+    thread_pool_task_t *tasks;
+    size_t              capacity, front, length;
+} thread_pool_deque_t;
+
+/**
+ * @struct thread_pool_worker_t
+ * @brief  A worker thread in a ::thread_pool_t.
+ *
+ * @var thread_pool_worker_t::pool
+ *     @brief Pool the worker belongs to.
+ * @var thread_pool_worker_t::index
+ *     @brief Index of the worker's deque in ::thread_pool::deques.
+ * @var thread_pool_worker_t::thread
+ *     @brief The worker's thread.
+ */
+typedef struct {
+    thread_pool_t *pool;
+    size_t         index;
+    pthread_t      thread;
+} thread_pool_worker_t;
+
+/**
+ * @struct thread_pool
+ * @brief  A set of worker threads that run tasks.
+ *
+ * @var thread_pool::nthreads
+ *     @brief Number of threads the pool was created with (including the calling one).
+ * @var thread_pool::nworkers
+ *     @brief Number of worker threads actually started.
+ * @var thread_pool::workers
+ *     @brief Worker threads.
+ * @var thread_pool::deques
+ *     @brief   Task queues, one per worker, followed by the queue shared by other threads.
+ *     @details Has `::thread_pool::nworkers + 1` elements.
+ * @var thread_pool::worker_key
+ *     @brief Thread-specific pointer to the ::thread_pool_worker_t running in each thread.
+ * @var thread_pool::mutex
+ *     @brief Mutex for ::thread_pool::pending (when waiting for it) and ::thread_pool::stopping.
+ * @var thread_pool::work_available
+ *     @brief Condition signaled when a task is submitted, or when the pool is stopping.
+ * @var thread_pool::pending
+ *     @brief Number of tasks queued but not yet taken by any thread.
+ * @var thread_pool::stopping
+ *     @brief Whether ::thread_pool_free was called, and workers must exit.
+ */
+struct thread_pool {
+    size_t               nthreads, nworkers;
+    thread_pool_worker_t workers[THREAD_POOL_MAX_THREADS - 1];
+    thread_pool_deque_t  deques[THREAD_POOL_MAX_THREADS];
+    pthread_key_t        worker_key;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  work_available;
+    size_t          pending;
+    int             stopping;
+};
+
+/**
+ * @struct thread_pool_group
+ * @brief  A set of tasks in a ::thread_pool_t that can be waited for.
+ *
+ * @var thread_pool_group::pool
+ *     @brief Pool where tasks are run.
+ * @var thread_pool_group::mutex
+ *     @brief Mutex that must be locked to modify ::thread_pool_group::remaining.
+ * @var thread_pool_group::done
+ *     @brief Condition signaled when ::thread_pool_group::remaining reaches `0`.
+ * @var thread_pool_group::remaining
+ *     @brief Number of tasks submitted but not yet finished.
+ */
+struct thread_pool_group {
+    thread_pool_t  *pool;
+    pthread_mutex_t mutex;
+    pthread_cond_t  done;
+    size_t          remaining;
+};
+
+/** @brief Names of every ::thread_pool_stage_t, as used in the command line and environment. */
+const char *const thread_pool_stage_names[THREAD_POOL_STAGE_COUNT] = {"load", "queries", "diff"};
+
+/** @brief Number of threads set with ::thread_pool_set_default_thread_count (`0` if not set). */
+size_t thread_pool_default_thread_count = 0;
+
+/** @brief Threads of each stage (`0` if not limited). */
+size_t thread_pool_stage_thread_counts[THREAD_POOL_STAGE_COUNT] = {0};
+
+/** @brief Whether ::thread_pool_stage_thread_counts was set on the command line. */
+int thread_pool_stage_thread_counts_set = 0;
+
+/** @brief Whether the CPUs of the program were chosen on the command line. */
+int thread_pool_cpus_set = 0;
+
+/** @brief Whether workers are pinned to a CPU each (`-1` if not set on the command line). */
+int thread_pool_pinning = -1;
+
+/** @brief Guarantees the environment is only read once, by ::__thread_pool_configure. */
+pthread_once_t thread_pool_configure_once = PTHREAD_ONCE_INIT;
+
+/** @brief Pool returned by ::thread_pool_get_shared. */
+thread_pool_t *thread_pool_shared = NULL;
+
+/** @brief Guarantees ::thread_pool_shared is only created once. */
+pthread_once_t thread_pool_shared_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief   Parses a list of stages and their numbers of threads, such as `load=4,queries=8`.
+ * @details Auxiliary method for ::thread_pool_set_stage_thread_counts and
+ *          ::__thread_pool_configure.
+ *
+ * @param list   List to be parsed.
+ * @param counts Where to write the number of threads of each stage to (`0` for stages not in
+ *               @p list). Only modified on success.
+ *
+ * @retval 0 Success.
+ * @retval 1 Invalid @p list.
+ */
+int __thread_pool_parse_stage_thread_counts(const char *list, size_t *counts) {
+    size_t      parsed[THREAD_POOL_STAGE_COUNT] = {0};
+    const char *str                             = list;
+    for (;;) {
+        size_t stage  = 0;
+        size_t length = 0;
+        for (; stage < THREAD_POOL_STAGE_COUNT; ++stage) {
+            length = strlen(thread_pool_stage_names[stage]);
+            if (strncmp(str, thread_pool_stage_names[stage], length) == 0 && str[length] == '=')
+                break;
+        }
+        if (stage == THREAD_POOL_STAGE_COUNT)
+            return 1;
+
+        str += length + 1;
+        char *end;
+        errno                           = 0;
+        const unsigned long long number = strtoull(str, &end, 10);
+        if (*str < '0' || *str > '9' || errno || number == 0)
+            return 1;
+        parsed[stage] = min(number, THREAD_POOL_MAX_THREADS);
+
+        if (*end == '\0')
+            break;
+        else if (*end != ',')
+            return 1;
+        str = end + 1;
+    }
+
+    memcpy(counts, parsed, sizeof(parsed));
+    return 0;
+}
+
+/**
+ * @brief   Applies the thread configuration in the environment, unless overridden on the command
+ *          line.
+ * @details Called through `pthread_once`, before the configuration is first needed. Invalid values
+ *          are reported to `stderr`, and ignored.
+ */
+void __thread_pool_configure(void) {
+    const char *const stages_env = getenv(THREAD_POOL_STAGE_THREADS_ENVIRONMENT_VARIABLE);
+    if (!thread_pool_stage_thread_counts_set && stages_env &&
+        __thread_pool_parse_stage_thread_counts(stages_env, thread_pool_stage_thread_counts))
+        fputs("Invalid number of threads per stage! Stages won't be limited.\n", stderr);
+
+    const char *const cpus_env = getenv(THREAD_POOL_CPUS_ENVIRONMENT_VARIABLE);
+    if (!thread_pool_cpus_set && cpus_env && numa_topology_set_cpus(cpus_env))
+        fputs("Invalid set of CPUs! All CPUs will be used.\n", stderr);
+
+    const char *const pin_env = getenv(THREAD_POOL_PIN_ENVIRONMENT_VARIABLE);
+    if (thread_pool_pinning == -1)
+        thread_pool_pinning = pin_env && strcmp(pin_env, "1") == 0;
+}
+
+size_t thread_pool_get_default_thread_count(void) {
+    pthread_once(&thread_pool_configure_once, __thread_pool_configure);
+    uint64_t nthreads = thread_pool_default_thread_count;
+
+    const char *const environment = getenv(THREAD_POOL_ENVIRONMENT_VARIABLE);
+    if (!nthreads && environment && int_utils_parse_positive(&nthreads, environment))
+        nthreads = 0; /* Invalid value: ignore */
+
+    if (!nthreads)
+        nthreads = numa_topology_get_cpu_count();
+
+    return min(max(nthreads, 1), THREAD_POOL_MAX_THREADS);
+}
+
+void thread_pool_set_default_thread_count(size_t nthreads) {
+    thread_pool_default_thread_count = nthreads;
+}
+
+const char *thread_pool_stage_get_name(thread_pool_stage_t stage) {
+    return thread_pool_stage_names[stage];
+}
+
+int thread_pool_set_stage_thread_counts(const char *list) {
+    if (__thread_pool_parse_stage_thread_counts(list, thread_pool_stage_thread_counts))
+        return 1;
+
+    thread_pool_stage_thread_counts_set = 1;
+    return 0;
+}
+
+size_t thread_pool_get_stage_thread_count(thread_pool_stage_t stage) {
+    const size_t nthreads = thread_pool_get_default_thread_count();
+    const size_t limit    = thread_pool_stage_thread_counts[stage];
+    return limit ? min(limit, nthreads) : nthreads;
+}
+
+int thread_pool_set_cpus(const char *list) {
+    if (numa_topology_set_cpus(list))
+        return 1;
+
+    thread_pool_cpus_set = 1;
+    return 0;
+}
+
+void thread_pool_set_pinning(int pin) {
+    thread_pool_pinning = pin;
+}
+
+int thread_pool_get_pinning(void) {
+    pthread_once(&thread_pool_configure_once, __thread_pool_configure);
+    return thread_pool_pinning;
+}
+
+/**
+ * @brief   Adds a task to the back of a deque.
+ * @details The deque's mutex must be locked.
+ *
+ * @param deque Deque to add @p task to.
+ * @param task  Task to be added.
+ *
+ * @retval 0 Success.
+ * @retval 1 Allocation failure.
+ */
+int __thread_pool_deque_push_back(thread_pool_deque_t *deque, const thread_pool_task_t *task) {
+    if (deque->length == deque->capacity) {
+        const size_t new_capacity =
+            deque->capacity ? deque->capacity * 2 : THREAD_POOL_DEQUE_INITIAL_CAPACITY;
+        thread_pool_task_t *const new_tasks =
+            realloc(deque->tasks, new_capacity * sizeof(thread_pool_task_t));
+        if (!new_tasks)
+            return 1;
+
+        /* Move tasks that wrapped around the end of the old buffer to after its end */
+        const size_t end = deque->front + deque->length;
+        if (end > deque->capacity)
+            memcpy(new_tasks + deque->capacity,
+                   new_tasks,
+                   (end - deque->capacity) * sizeof(thread_pool_task_t));
+
+        deque->tasks    = new_tasks;
+        deque->capacity = new_capacity;
+    }
+
+    deque->tasks[(deque->front + deque->length) % deque->capacity] = *task;
+    deque->length++;
+    return 0;
+}
+
+/**
+ * @brief Takes a task from a deque, locking its mutex.
+ *
+ * @param deque Deque to take a task from.
+ * @param back  Whether to take the newest task (the owner of the deque), instead of the oldest one
+ *              (a thief).
+ * @param out   Where to write the task to, only on success.
+ *
+ * @retval 0 Success.
+ * @retval 1 Empty deque.
+ */
+int __thread_pool_deque_take(thread_pool_deque_t *deque, int back, thread_pool_task_t *out) {
+    pthread_mutex_lock(&deque->mutex);
+    if (!deque->length) {
+        pthread_mutex_unlock(&deque->mutex);
+        return 1;
+    }
+
+    if (back) {
+        *out = deque->tasks[(deque->front + deque->length - 1) % deque->capacity];
+    } else {
+        *out         = deque->tasks[deque->front];
+        deque->front = (deque->front + 1) % deque->capacity;
+    }
+    deque->length--;
+
+    pthread_mutex_unlock(&deque->mutex);
+    return 0;
+}
+
+/**
+ * @brief   Finds a task to be run by the calling thread.
+ * @details Workers look in their own deque first, then in the shared one, and then steal from
+ *          other workers. Other threads look in the shared deque, and then steal from workers.
+ *
+ * @param pool Pool to find a task in.
+ * @param out  Where to write the task to, only on success.
+ *
+ * @retval 0 Success.
+ * @retval 1 No task found.
+ */
+int __thread_pool_find_task(thread_pool_t *pool, thread_pool_task_t *out) {
+    const thread_pool_worker_t *const self  = pthread_getspecific(pool->worker_key);
+    const size_t                      ndeques = pool->nworkers + 1;
+    const size_t                      first   = self ? self->index : pool->nworkers;
+
+    int found = !__thread_pool_deque_take(&pool->deques[first], 1, out);
+    if (!found && self)
+        found = !__thread_pool_deque_take(&pool->deques[pool->nworkers], 0, out);
+
+    for (size_t i = 1; i < ndeques && !found; ++i) {
+        const size_t victim = (first + i) % ndeques;
+        if (victim != pool->nworkers)
+            found = !__thread_pool_deque_take(&pool->deques[victim], 0, out);
+    }
+
+    if (found)
+        __atomic_fetch_sub(&pool->pending, 1, __ATOMIC_RELAXED);
+    return !found;
+}
+
+/**
+ * @brief   Marks a task in a group as finished.
+ * @details The group's mutex is held while signaling, so that a waiting thread can't free the group
+ *          before this method stops using it.
+ *
+ * @param group Group of the finished task.
+ */
+void __thread_pool_group_finish_task(thread_pool_group_t *group) {
+    pthread_mutex_lock(&group->mutex);
+    if (--group->remaining == 0)
+        pthread_cond_broadcast(&group->done);
+    pthread_mutex_unlock(&group->mutex);
+}
+
+/**
+ * @brief Runs a task and marks it as finished.
+ * @param task Task to be run.
+ */
+void __thread_pool_run_task(const thread_pool_task_t *task) {
+    task->callback(task->user_data);
+    __thread_pool_group_finish_task(task->group);
+}
+
+/**
+ * @brief   Runs tasks until the pool is freed.
+ * @details Thread entry point.
+ *
+ * @param worker_data Pointer to a ::thread_pool_worker_t.
+ * @return Always `NULL`.
+ */
+void *__thread_pool_worker_run(void *worker_data) {
+    thread_pool_worker_t *const worker = worker_data;
+    thread_pool_t *const        pool   = worker->pool;
+    pthread_setspecific(pool->worker_key, worker);
+
+    /*
+     * Pin workers to a CPU each, or spread them among NUMA nodes, counting the thread that waits
+     * for tasks as on the first CPU or node 0.
+     */
+    const size_t nodes = numa_topology_get_node_count();
+    if (thread_pool_get_pinning())
+        numa_topology_pin_thread_to_cpu(worker->index + 1);
+    else if (nodes > 1)
+        numa_topology_pin_thread((worker->index + 1) % nodes);
+
+    /* Wait for thread_pool_create to start all workers (::thread_pool::nworkers must be final) */
+    pthread_mutex_lock(&pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (;;) {
+        thread_pool_task_t task;
+        if (!__thread_pool_find_task(pool, &task)) {
+            __thread_pool_run_task(&task);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->mutex);
+        while (!__atomic_load_n(&pool->pending, __ATOMIC_RELAXED) && !pool->stopping)
+            pthread_cond_wait(&pool->work_available, &pool->mutex);
+        const int stop = pool->stopping && !__atomic_load_n(&pool->pending, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (stop)
+            return NULL;
+    }
+}
+
+thread_pool_t *thread_pool_create(size_t nthreads) {
+    thread_pool_t *const pool = malloc(sizeof(thread_pool_t));
+    if (!pool)
+        return NULL;
+
+    if (pthread_key_create(&pool->worker_key, NULL)) {
+        free(pool);
+        return NULL;
+    }
+
+    pool->nthreads = nthreads ? min(nthreads, THREAD_POOL_MAX_THREADS)
+                              : thread_pool_get_default_thread_count();
+    pool->nworkers = 0;
+    pool->pending  = 0;
+    pool->stopping = 0;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_available, NULL);
+
+    for (size_t i = 0; i < pool->nthreads; ++i) {
+        pthread_mutex_init(&pool->deques[i].mutex, NULL);
+        pool->deques[i].tasks    = NULL;
+        pool->deques[i].capacity = 0;
+        pool->deques[i].front    = 0;
+        pool->deques[i].length   = 0;
+    }
+
+    /* Workers wait for this mutex, not to look for tasks before nworkers is final */
+    pthread_mutex_lock(&pool->mutex);
+    for (; pool->nworkers + 1 < pool->nthreads; ++pool->nworkers) {
+        thread_pool_worker_t *const worker = &pool->workers[pool->nworkers];
+        worker->pool                       = pool;
+        worker->index                      = pool->nworkers;
+        if (pthread_create(&worker->thread, NULL, __thread_pool_worker_run, worker))
+            break;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return pool;
+}
+
+/** @brief Creates ::thread_pool_shared. Called with `pthread_once`. */
+void __thread_pool_create_shared(void) {
+    thread_pool_shared = thread_pool_create(0);
+}
+
+thread_pool_t *thread_pool_get_shared(void) {
+    pthread_once(&thread_pool_shared_once, __thread_pool_create_shared);
+    return thread_pool_shared;
+}
+
+size_t thread_pool_get_thread_count(const thread_pool_t *pool) {
+    return pool->nworkers + 1;
+}
+
+thread_pool_group_t *thread_pool_group_create(thread_pool_t *pool) {
+    thread_pool_group_t *const group = malloc(sizeof(thread_pool_group_t));
+    if (!group)
+        return NULL;
+
+    group->pool      = pool;
+    group->remaining = 0;
+    pthread_mutex_init(&group->mutex, NULL);
+    pthread_cond_init(&group->done, NULL);
+    return group;
+}
+
+void thread_pool_group_submit(thread_pool_group_t        *group,
+                              thread_pool_task_callback_t callback,
+                              void                       *user_data) {
+    thread_pool_t *const pool = group->pool;
+    if (!pool->nworkers) { /* Single-thread mode */
+        callback(user_data);
+        return;
+    }
+
+    const thread_pool_task_t task = {.callback = callback, .user_data = user_data, .group = group};
+
+    pthread_mutex_lock(&group->mutex);
+    group->remaining++;
+    pthread_mutex_unlock(&group->mutex);
+
+    const thread_pool_worker_t *const self  = pthread_getspecific(pool->worker_key);
+    thread_pool_deque_t *const        deque = &pool->deques[self ? self->index : pool->nworkers];
+
+    /* Count the task before it can be taken, so that pending never underflows */
+    __atomic_fetch_add(&pool->pending, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&deque->mutex);
+    const int failure = __thread_pool_deque_push_back(deque, &task);
+    pthread_mutex_unlock(&deque->mutex);
+
+    if (failure) {
+        __atomic_fetch_sub(&pool->pending, 1, __ATOMIC_RELAXED);
+        __thread_pool_run_task(&task);
+        return;
+    }
+
+    /* Signal with the mutex locked, so that workers can't miss it between checking and waiting */
+    pthread_mutex_lock(&pool->mutex);
+    pthread_cond_signal(&pool->work_available);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void thread_pool_group_wait(thread_pool_group_t *group) {
+    thread_pool_t *const pool = group->pool;
+
+    for (;;) {
+        pthread_mutex_lock(&group->mutex);
+        const size_t remaining = group->remaining;
+        pthread_mutex_unlock(&group->mutex);
+        if (!remaining)
+            return;
+
+        thread_pool_task_t task;
+        if (!__thread_pool_find_task(pool, &task)) {
+            __thread_pool_run_task(&task);
+            continue;
+        }
+
+        /* All remaining tasks are running in other threads */
+        pthread_mutex_lock(&group->mutex);
+        if (group->remaining)
+            pthread_cond_wait(&group->done, &group->mutex);
+        pthread_mutex_unlock(&group->mutex);
+    }
+}
+
+void thread_pool_group_free(thread_pool_group_t *group) {
+    pthread_cond_destroy(&group->done);
+    pthread_mutex_destroy(&group->mutex);
+    free(group);
+}
+
+/**
+ * @struct thread_pool_parallel_for_data_t
+ * @brief  Data shared by all threads running a ::thread_pool_parallel_for loop.
+ *
+ * @var thread_pool_parallel_for_data_t::callback
+ *     @brief Method called for each range.
+ * @var thread_pool_parallel_for_data_t::user_data
+ *     @brief Argument passed to ::thread_pool_parallel_for_data_t::callback.
+ * @var thread_pool_parallel_for_data_t::n
+ *     @brief Number of indices in the loop.
+ * @var thread_pool_parallel_for_data_t::grain
+ *     @brief Number of indices in each range.
+ * @var thread_pool_parallel_for_data_t::next
+ *     @brief First index of the next range to be taken by a thread.
+ */
+typedef struct {
+    thread_pool_range_callback_t callback;
+    void                        *user_data;
+    size_t                       n, grain, next;
+} thread_pool_parallel_for_data_t;
+
+/**
+ * @brief   Runs ranges of a ::thread_pool_parallel_for loop until there are none left.
+ * @details Task run by every thread taking part in the loop.
+ *
+ * @param loop_data A ::thread_pool_parallel_for_data_t.
+ */
+void __thread_pool_parallel_for_run(void *loop_data) {
+    thread_pool_parallel_for_data_t *const loop = loop_data;
+
+    size_t start;
+    while ((start = __atomic_fetch_add(&loop->next, loop->grain, __ATOMIC_RELAXED)) < loop->n)
+        loop->callback(loop->user_data, start, min(start + loop->grain, loop->n));
+}
+
+/**
+ * @brief   Runs a loop over `[0, n[` in parallel, in at most @p nthreads threads.
+ * @details Auxiliary method for ::thread_pool_parallel_for and ::thread_pool_parallel_for_stage.
+ *
+ * @param pool      Thread pool to run the loop in.
+ * @param nthreads  Maximum number of threads, including the calling one. Must be `1` if @p pool is
+ *                  `NULL`, and not more than the threads in @p pool otherwise.
+ * @param n         Number of indices.
+ * @param grain     Number of indices in each range. `0` to choose based on @p nthreads.
+ * @param callback  Method called for each range.
+ * @param user_data Argument passed to @p callback.
+ */
+void __thread_pool_parallel_for_threads(thread_pool_t               *pool,
+                                        size_t                       nthreads,
+                                        size_t                       n,
+                                        size_t                       grain,
+                                        thread_pool_range_callback_t callback,
+                                        void                        *user_data) {
+    if (!grain)
+        grain = max(n / (nthreads * THREAD_POOL_RANGES_PER_THREAD), 1);
+
+    thread_pool_parallel_for_data_t loop = {.callback  = callback,
+                                            .user_data = user_data,
+                                            .n         = n,
+                                            .grain     = grain,
+                                            .next      = 0};
+
+    const size_t ranges = n / grain + (n % grain != 0);
+    if (nthreads == 1 || ranges <= 1) { /* Ranges in order, in the calling thread */
+        __thread_pool_parallel_for_run(&loop);
+        return;
+    }
+
+    /* Stack-allocated group, not to fail on allocation */
+    thread_pool_group_t group = {.pool = pool, .remaining = 0};
+    pthread_mutex_init(&group.mutex, NULL);
+    pthread_cond_init(&group.done, NULL);
+
+    const size_t helpers = min(ranges, nthreads) - 1;
+    for (size_t i = 0; i < helpers; ++i)
+        thread_pool_group_submit(&group, __thread_pool_parallel_for_run, &loop);
+
+    __thread_pool_parallel_for_run(&loop);
+    thread_pool_group_wait(&group);
+
+    pthread_cond_destroy(&group.done);
+    pthread_mutex_destroy(&group.mutex);
+}
+
+/**
+ * @brief   Gets the maximum number of threads a loop can use in a pool.
+ * @details Loops in the shared pool use at most ::thread_pool_get_default_thread_count threads, as
+ *          it may have been lowered after the shared pool was created.
+ *
+ * @param pool Thread pool to run the loop in. Can be `NULL`, for a single thread.
+ *
+ * @return The number of threads to use, including the calling one.
+ */
+size_t __thread_pool_get_loop_thread_count(const thread_pool_t *pool) {
+    if (!pool)
+        return 1;
+
+    const size_t nthreads = thread_pool_get_thread_count(pool);
+    return pool == thread_pool_shared ? min(nthreads, thread_pool_get_default_thread_count())
+                                      : nthreads;
+}
+
+void thread_pool_parallel_for(thread_pool_t               *pool,
+                              size_t                       n,
+                              size_t                       grain,
+                              thread_pool_range_callback_t callback,
+                              void                        *user_data) {
+    const size_t nthreads = __thread_pool_get_loop_thread_count(pool);
+    __thread_pool_parallel_for_threads(pool, nthreads, n, grain, callback, user_data);
+}
+
+void thread_pool_parallel_for_stage(thread_pool_t               *pool,
+                                    thread_pool_stage_t          stage,
+                                    size_t                       n,
+                                    size_t                       grain,
+                                    thread_pool_range_callback_t callback,
+                                    void                        *user_data) {
+    const size_t nthreads =
+        pool ? min(thread_pool_get_thread_count(pool), thread_pool_get_stage_thread_count(stage))
+             : 1;
+    __thread_pool_parallel_for_threads(pool, nthreads, n, grain, callback, user_data);
+}
+
+/**
+ * @struct thread_pool_parallel_reduce_data_t
+ * @brief  Data shared by all threads running a ::thread_pool_parallel_reduce loop.
+ *
+ * @var thread_pool_parallel_reduce_data_t::init
+ *     @brief Method called to create the accumulator of each range.
+ * @var thread_pool_parallel_reduce_data_t::callback
+ *     @brief Method called for each range.
+ * @var thread_pool_parallel_reduce_data_t::user_data
+ *     @brief Argument passed to ::thread_pool_parallel_reduce_data_t::init and
+ *            ::thread_pool_parallel_reduce_data_t::callback.
+ * @var thread_pool_parallel_reduce_data_t::accumulators
+ *     @brief Accumulator of every range (`NULL` for ranges whose accumulator couldn't be created).
+ * @var thread_pool_parallel_reduce_data_t::n
+ *     @brief Number of indices in the loop.
+ * @var thread_pool_parallel_reduce_data_t::grain
+ *     @brief Number of indices in each range.
+ */
+typedef struct {
+    thread_pool_reduce_init_callback_t  init;
+    thread_pool_reduce_range_callback_t callback;
+    void                               *user_data;
+    void                              **accumulators;
+    size_t                              n, grain;
+} thread_pool_parallel_reduce_data_t;
+
+/**
+ * @brief   Processes ranges of a ::thread_pool_parallel_reduce loop, each with a new accumulator.
+ * @details Callback for ::thread_pool_parallel_for, looping over ranges instead of indices.
+ *
+ * @param reduce_data A ::thread_pool_parallel_reduce_data_t.
+ * @param start       First range to be processed.
+ * @param end         Range after the last one to be processed.
+ */
+void __thread_pool_parallel_reduce_run(void *reduce_data, size_t start, size_t end) {
+    const thread_pool_parallel_reduce_data_t *const reduce = reduce_data;
+
+    for (size_t r = start; r < end; ++r) {
+        void *const accumulator = reduce->init(reduce->user_data);
+        reduce->accumulators[r] = accumulator;
+        if (accumulator)
+            reduce->callback(reduce->user_data,
+                             accumulator,
+                             r * reduce->grain,
+                             min((r + 1) * reduce->grain, reduce->n));
+    }
+}
+
+int thread_pool_parallel_reduce(thread_pool_t                      *pool,
+                                size_t                              n,
+                                size_t                              grain,
+                                thread_pool_reduce_init_callback_t  init,
+                                thread_pool_reduce_range_callback_t callback,
+                                thread_pool_reduce_merge_callback_t merge,
+                                void                               *user_data) {
+    const size_t nthreads = __thread_pool_get_loop_thread_count(pool);
+    if (!grain)
+        grain = max(n / nthreads + (n % nthreads != 0), 1);
+
+    const size_t ranges       = n / grain + (n % grain != 0);
+    void **const accumulators = calloc(max(ranges, 1), sizeof(void *));
+    if (!accumulators)
+        return 1;
+
+    thread_pool_parallel_reduce_data_t reduce = {.init         = init,
+                                                 .callback     = callback,
+                                                 .user_data    = user_data,
+                                                 .accumulators = accumulators,
+                                                 .n            = n,
+                                                 .grain        = grain};
+    thread_pool_parallel_for(pool, ranges, 1, __thread_pool_parallel_reduce_run, &reduce);
+
+    int retval = 0;
+    for (size_t r = 0; r < ranges; ++r) {
+        if (accumulators[r])
+            merge(user_data, accumulators[r]);
+        else
+            retval = 1;
+    }
+
+    free(accumulators);
+    return retval;
+}
+
+void thread_pool_free(thread_pool_t *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->work_available);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (size_t i = 0; i < pool->nworkers; ++i)
+        pthread_join(pool->workers[i].thread, NULL);
+
+    for (size_t i = 0; i < pool->nthreads; ++i) {
+        pthread_mutex_destroy(&pool->deques[i].mutex);
+        free(pool->deques[i].tasks);
+    }
+
+    pthread_cond_destroy(&pool->work_available);
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_key_delete(pool->worker_key);
+    free(pool);
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  top_k.c
+ * @brief Implementation of methods in include/utils/top_k.h
+ *
+ * ### Examples
+ * See [the header file's documentation](@ref top_k_examples).
+ */
+
+#include <glib.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/top_k.h"
+
+/**
+ * @struct top_k
+ * @brief  Bounded selection of the first `k` items of a sequence.
+ *
+ * @var top_k::heap
+ *     @brief Binary heap of items, whose root is the item that would come last in a sorted array.
+ * @var top_k::item_size
+ *     @brief Size (in bytes) of each item.
+ * @var top_k::k
+ *     @brief Maximum number of items in ::top_k::heap.
+ * @var top_k::compare_func
+ *     @brief Comparison function between items.
+ */
+struct top_k {
+    GArray      *heap;
+    size_t       item_size;
+    size_t       k;
+    GCompareFunc compare_func;
+};
+
+top_k_t *top_k_create(size_t item_size, size_t k, GCompareFunc compare_func) {
+    top_k_t *const top_k = malloc(sizeof(top_k_t));
+    if (!top_k)
+        return NULL;
+
+    top_k->heap         = g_array_new(FALSE, FALSE, item_size);
+    top_k->item_size    = item_size;
+    top_k->k            = k;
+    top_k->compare_func = compare_func;
+    return top_k;
+}
+
+/**
+ * @brief Gets a pointer to an item in the heap of a top-`k` selection.
+ *
+ * @param top_k Selection to get the item from.
+ * @param i     Index of the item in the heap.
+ *
+ * @return A pointer to the item.
+ */
+void *__top_k_item(const top_k_t *top_k, size_t i) {
+    return top_k->heap->data + i * top_k->item_size;
+}
+
+/**
+ * @brief Swaps two items in the heap of a top-`k` selection.
+ *
+ * @param top_k Selection containing the items.
+ * @param i     Index of one of the items.
+ * @param j     Index of the other item.
+ */
+void __top_k_swap(top_k_t *top_k, size_t i, size_t j) {
+    uint8_t *const a = __top_k_item(top_k, i);
+    uint8_t *const b = __top_k_item(top_k, j);
+
+    for (size_t byte = 0; byte < top_k->item_size; ++byte) {
+        const uint8_t tmp = a[byte];
+        a[byte]           = b[byte];
+        b[byte]           = tmp;
+    }
+}
+
+/**
+ * @brief Restores the heap property of a top-`k` selection after its root is replaced.
+ * @param top_k Selection whose root was replaced.
+ */
+void __top_k_sift_down(top_k_t *top_k) {
+    const size_t length = top_k->heap->len;
+
+    size_t i = 0;
+    while (1) {
+        const size_t left = 2 * i + 1, right = left + 1;
+        size_t       last = i;
+
+        if (left < length &&
+            top_k->compare_func(__top_k_item(top_k, left), __top_k_item(top_k, last)) > 0)
+            last = left;
+        if (right < length &&
+            top_k->compare_func(__top_k_item(top_k, right), __top_k_item(top_k, last)) > 0)
+            last = right;
+
+        if (last == i)
+            break;
+
+        __top_k_swap(top_k, i, last);
+        i = last;
+    }
+}
+
+void top_k_add(top_k_t *top_k, const void *item) {
+    if (top_k->heap->len < top_k->k) {
+        g_array_append_vals(top_k->heap, item, 1);
+
+        /* Sift up */
+        size_t i = top_k->heap->len - 1;
+        while (i) {
+            const size_t parent = (i - 1) / 2;
+            if (top_k->compare_func(__top_k_item(top_k, i), __top_k_item(top_k, parent)) <= 0)
+                break;
+
+            __top_k_swap(top_k, i, parent);
+            i = parent;
+        }
+    } else if (top_k->k && top_k->compare_func(item, __top_k_item(top_k, 0)) < 0) {
+        memcpy(__top_k_item(top_k, 0), item, top_k->item_size);
+        __top_k_sift_down(top_k);
+    }
+}
+
+GArray *top_k_free_to_array(top_k_t *top_k) {
+    GArray *const ret = top_k->heap;
+    g_array_sort(ret, top_k->compare_func);
+    free(top_k);
+    return ret;
+}
+
+void top_k_free(top_k_t *top_k) {
+    g_array_unref(top_k->heap);
+    free(top_k);
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2023 Humberto Gomes, José Lopes, José Matos
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * @file  utf8.c
+ * @brief Implementation of methods in include/utils/utf8.h
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+
+    /** @brief Defined when blocks of bytes are checked for ASCII with SSE2 instructions. */
+    #define UTF8_SSE2
+#endif
+
+#include "utils/utf8.h"
+
+#ifdef UTF8_SSE2
+    /** @brief Number of bytes checked for ASCII characters at a time. */
+    #define UTF8_BLOCK_SIZE 16
+#else
+    /** @brief Number of bytes checked for ASCII characters at a time. */
+    #define UTF8_BLOCK_SIZE 8
+#endif
+
+/**
+ * @brief  Checks if a block of ::UTF8_BLOCK_SIZE bytes is made only of ASCII characters.
+ * @param  block Start of the block. Doesn't need to be aligned.
+ * @return `1` if no byte in @p block has its highest bit set, `0` otherwise.
+ */
+int __utf8_block_is_ascii(const char *block) {
+#ifdef UTF8_SSE2
+    return !_mm_movemask_epi8(_mm_loadu_si128((const __m128i *) block));
+#else
+    uint64_t word;
+    memcpy(&word, block, sizeof(uint64_t)); /* Unaligned load */
+    return !(word & 0x8080808080808080);
+#endif
+}
+
+int utf8_is_ascii(const char *str, size_t length) {
+    size_t i = 0;
+    for (; i + UTF8_BLOCK_SIZE <= length; i += UTF8_BLOCK_SIZE)
+        if (!__utf8_block_is_ascii(str + i))
+            return 0;
+
+    for (; i < length; ++i)
+        if ((unsigned char) str[i] & 0x80)
+            return 0;
+    return 1;
+}
+
+/**
+ * @brief   Validates a multibyte UTF-8 sequence.
+ * @details Auxiliary method for ::utf8_validate. Only the second byte of a sequence has a range
+ *          that depends on the first byte (to reject overlong encodings, surrogates and code
+ *          points above `U+10FFFF`). The following ones are always continuation bytes.
+ *
+ * @param seq       Start of the sequence, whose first byte isn't ASCII.
+ * @param remaining Number of bytes from @p seq to the end of the string.
+ *
+ * @return The length of the sequence, or `0` if it's invalid.
+ */
+size_t __utf8_validate_sequence(const unsigned char *seq, size_t remaining) {
+    size_t        length;
+    unsigned char min = 0x80, max = 0xBF; /* Range of the second byte */
+
+    if (seq[0] >= 0xC2 && seq[0] <= 0xDF) {
+        length = 2;
+    } else if (seq[0] >= 0xE0 && seq[0] <= 0xEF) {
+        length = 3;
+        if (seq[0] == 0xE0)
+            min = 0xA0;
+        else if (seq[0] == 0xED)
+            max = 0x9F;
+    } else if (seq[0] >= 0xF0 && seq[0] <= 0xF4) {
+        length = 4;
+        if (seq[0] == 0xF0)
+            min = 0x90;
+        else if (seq[0] == 0xF4)
+            max = 0x8F;
+    } else {
+        return 0; /* Continuation byte, overlong 2-byte sequence or above U+10FFFF */
+    }
+
+    if (remaining < length || seq[1] < min || seq[1] > max)
+        return 0;
+
+    for (size_t i = 2; i < length; ++i)
+        if ((seq[i] & 0xC0) != 0x80)
+            return 0;
+    return length;
+}
+
+int utf8_validate(const char *str, size_t length) {
+    const unsigned char *const ustr = (const unsigned char *) str;
+
+    size_t i = 0;
+    while (i < length) {
+        while (i + UTF8_BLOCK_SIZE <= length && __utf8_block_is_ascii(str + i))
+            i += UTF8_BLOCK_SIZE;
+
+        if (i >= length)
+            break;
+
+        if (ustr[i] < 0x80) {
+            i++;
+        } else {
+            const size_t sequence_length = __utf8_validate_sequence(ustr + i, length - i);
+            if (!sequence_length)
+                return 1;
+            i += sequence_length;
+        }
+    }
+
+    return 0;
+}